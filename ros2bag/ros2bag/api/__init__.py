@@ -14,9 +14,12 @@
 
 from argparse import ArgumentTypeError
 import os
+import re
 from typing import Any
 from typing import Dict
+from typing import List
 from typing import Optional
+from typing import Tuple
 
 from rclpy.duration import Duration
 from rclpy.qos import QoSDurabilityPolicy
@@ -24,6 +27,7 @@ from rclpy.qos import QoSHistoryPolicy
 from rclpy.qos import QoSLivelinessPolicy
 from rclpy.qos import QoSProfile
 from rclpy.qos import QoSReliabilityPolicy
+import yaml
 
 # This map needs to be updated when new policies are introduced
 _QOS_POLICY_FROM_SHORT_NAME = {
@@ -75,6 +79,102 @@ def convert_yaml_to_qos_profile(qos_profile_dict: Dict) -> Dict[str, QoSProfile]
     return topic_profile_dict
 
 
+def convert_yaml_to_topic_throttles(throttle_dict: Dict) -> Dict[str, Tuple[int, float]]:
+    """Convert a YAML file of topic throttles to (decimation, max_frequency) tuples."""
+    topic_throttles = {}
+    for topic, throttle in throttle_dict.items():
+        unexpected_keys = set(throttle) - {'decimation', 'max_frequency'}
+        if unexpected_keys:
+            raise ValueError('Unexpected key `{}` for topic throttle.'.format(
+                unexpected_keys.pop()))
+        decimation = int(throttle.get('decimation', 1))
+        max_frequency = float(throttle.get('max_frequency', 0.0))
+        if decimation < 1 or max_frequency < 0.0:
+            raise ValueError(
+                'Throttle of topic `{}` needs a decimation >= 1 and a max_frequency >= 0.'.format(
+                    topic))
+        topic_throttles[topic] = (decimation, max_frequency)
+    return topic_throttles
+
+
+def convert_yaml_to_thread_scheduling(
+        scheduling_dict: Dict, roles: List[str]) -> Dict[str, Tuple[List[int], int, int]]:
+    """Convert a YAML file of thread roles to (cpu_affinity, nice, realtime_priority) tuples."""
+    thread_scheduling = {}
+    for role, scheduling in scheduling_dict.items():
+        if role not in roles:
+            raise ValueError('Unexpected thread role `{}`, expected one of {}.'.format(
+                role, ', '.join(roles)))
+        unexpected_keys = set(scheduling) - {'cpu_affinity', 'nice', 'realtime_priority'}
+        if unexpected_keys:
+            raise ValueError('Unexpected key `{}` for thread scheduling.'.format(
+                unexpected_keys.pop()))
+        cpu_affinity = [int(cpu) for cpu in scheduling.get('cpu_affinity', [])]
+        nice = int(scheduling.get('nice', 0))
+        realtime_priority = int(scheduling.get('realtime_priority', 0))
+        if any(cpu < 0 for cpu in cpu_affinity):
+            raise ValueError('CPUs of thread role `{}` must not be negative.'.format(role))
+        if not -20 <= nice <= 19 or not 0 <= realtime_priority <= 99:
+            raise ValueError(
+                'Thread role `{}` needs a nice value from -20 to 19 and a realtime_priority '
+                'from 0 to 99.'.format(role))
+        thread_scheduling[role] = (cpu_affinity, nice, realtime_priority)
+    return thread_scheduling
+
+
+def convert_yaml_to_topic_compression(
+        compression_dict: Dict) -> Dict[str, Tuple[str, Optional[int]]]:
+    """Convert a YAML file of topic compression settings to (format, level) tuples."""
+    topic_compression = {}
+    for topic, compression in compression_dict.items():
+        unexpected_keys = set(compression) - {'format', 'level'}
+        if unexpected_keys:
+            raise ValueError('Unexpected key `{}` for topic compression.'.format(
+                unexpected_keys.pop()))
+        compression_format = str(compression.get('format', ''))
+        if compression_format not in ['', 'none', 'zstd', 'lz4', 'lz4hc', 'image', 'video']:
+            raise ValueError(
+                'Compression of topic `{}` needs a format of none, zstd, lz4, lz4hc, image or '
+                'video.'.format(topic))
+        level = compression.get('level')
+        topic_compression[str(topic)] = (
+            compression_format, int(level) if level is not None else None)
+    return topic_compression
+
+
+def convert_yaml_to_topic_groups(group_dict: Dict) -> List[Tuple[str, str, int]]:
+    """Convert a YAML file of topic groups to (name, topics, min_message_size) tuples."""
+    topic_groups = []
+    for name, group in group_dict.items():
+        unexpected_keys = set(group) - {'topics', 'min_message_size'}
+        if unexpected_keys:
+            raise ValueError('Unexpected key `{}` for topic group.'.format(
+                unexpected_keys.pop()))
+        topics = str(group.get('topics', ''))
+        min_message_size = int(group.get('min_message_size', 0))
+        if not name or os.sep in str(name) or min_message_size < 0:
+            raise ValueError(
+                'Topic group `{}` needs a folder name and a min_message_size >= 0.'.format(name))
+        topic_groups.append((str(name), topics, min_message_size))
+    return topic_groups
+
+
+def convert_yaml_to_message_transforms(transform_list: List) -> List[Tuple[str, str]]:
+    """Convert a YAML list of message transforms to (name, parameters) tuples."""
+    transforms = []
+    for transform in transform_list:
+        unexpected_keys = set(transform) - {'name', 'parameters'}
+        if unexpected_keys:
+            raise ValueError('Unexpected key `{}` for message transform.'.format(
+                unexpected_keys.pop()))
+        name = str(transform.get('name', ''))
+        if not name:
+            raise ValueError('Message transform needs a name.')
+        parameters = transform.get('parameters')
+        transforms.append((name, yaml.safe_dump(parameters) if parameters is not None else ''))
+    return transforms
+
+
 def create_bag_directory(uri: str) -> Optional[str]:
     """Create a directory."""
     try:
@@ -83,6 +183,36 @@ def create_bag_directory(uri: str) -> Optional[str]:
         return print_error("Could not create bag folder '{}'.".format(uri))
 
 
+def find_bag_files(bag_directory: str) -> List[str]:
+    """
+    Find the bagfiles of a bag, relative to its directory.
+
+    Bagfiles are named after the folder they are in, followed by their index, e.g. `bag_0.db3`
+    in the bag directory or `camera/camera_0.db3` in the folder of a topic group, and those of
+    shards by their shard as well, e.g. `bag_shard1_0.db3`. The files of every folder are ordered
+    by their shard and index.
+    """
+    bag_files = []
+    bag_directory = os.path.normpath(bag_directory)
+    for directory, subdirectories, file_names in os.walk(bag_directory):
+        subdirectories.sort()
+        pattern = re.compile(
+            r'^{}_(?:shard(\d+)_)?(\d+)(\.[^.-]+)*$'.format(
+                re.escape(os.path.basename(directory))))
+        indexed_files = []
+        for file_name in file_names:
+            match = pattern.match(file_name)
+            if match:
+                indexed_files.append(
+                    ((int(match.group(1) or 0), int(match.group(2))), file_name))
+        relative_directory = os.path.relpath(directory, bag_directory)
+        for _, file_name in sorted(indexed_files):
+            bag_files.append(
+                file_name if relative_directory == os.curdir
+                else os.path.join(relative_directory, file_name))
+    return bag_files
+
+
 def check_positive_float(value: Any) -> float:
     """Argparse validator to verify that a value is a float and positive."""
     try:
@@ -94,10 +224,85 @@ def check_positive_float(value: Any) -> float:
         raise ArgumentTypeError('{} is not the valid type (float)'.format(value))
 
 
+def check_not_negative_float(value: Any) -> float:
+    """Argparse validator to verify that a value is a float and not negative."""
+    try:
+        fvalue = float(value)
+        if fvalue < 0.0:
+            raise ArgumentTypeError('{} is not in the valid range (>= 0.0)'.format(value))
+        return fvalue
+    except ValueError:
+        raise ArgumentTypeError('{} is not the valid type (float)'.format(value))
+
+
+def check_not_negative_int(value: Any) -> int:
+    """Argparse validator to verify that a value is an int and not negative."""
+    try:
+        ivalue = int(value)
+        if ivalue < 0:
+            raise ArgumentTypeError('{} is not in the valid range (>= 0)'.format(value))
+        return ivalue
+    except ValueError:
+        raise ArgumentTypeError('{} is not the valid type (int)'.format(value))
+
+
+def check_nice_value(value: Any) -> int:
+    """Argparse validator to verify that a value is a nice value from -20 to 19."""
+    try:
+        ivalue = int(value)
+        if not -20 <= ivalue <= 19:
+            raise ArgumentTypeError('{} is not in the valid range (-20 to 19)'.format(value))
+        return ivalue
+    except ValueError:
+        raise ArgumentTypeError('{} is not the valid type (int)'.format(value))
+
+
+def add_resource_arguments(parser) -> None:
+    """Add the arguments configuring the background threads and memory of rosbag2 to a verb."""
+    parser.add_argument(
+        '--background-threads', type=check_not_negative_int, default=0,
+        help='number of threads of the pool running short background work like opening, '
+             'closing and decompressing bagfiles. Default is 0, which uses one thread per '
+             'processor.')
+    parser.add_argument(
+        '--background-cpus', type=check_not_negative_int, nargs='+', default=[], metavar='CPU',
+        help='CPUs to pin the background threads of rosbag2 to, e.g. to keep them off the CPUs '
+             'of the robot software. Linux only.')
+    parser.add_argument(
+        '--background-nice', type=check_nice_value, default=0,
+        help='nice value from -20 to 19 of the background threads of rosbag2. Higher values '
+             'give them a lower priority. Negative values need privileges. Linux only.')
+    parser.add_argument(
+        '--memory-budget', type=check_not_negative_int, default=0, metavar='BYTES',
+        help='bytes of message data held in memory at most by the writer cache, the compression '
+             'chunk, the snapshot buffer and the player queue together. While it is exhausted, '
+             'they write, compress or stop reading ahead early. Default is 0, which does not '
+             'limit them beyond their own limits.')
+    parser.add_argument(
+        '--huge-page-arena', type=check_not_negative_int, default=0, metavar='BYTES',
+        help='bytes of memory backed by huge pages the buffers of messages are allocated from, '
+             'e.g. the writer cache and the player queue, mapped and touched when the bag is '
+             'opened so buffering never page-faults. Messages beyond it use the heap. Default '
+             'is 0, which allocates all from the heap. Huge pages are Linux only.')
+    parser.add_argument(
+        '--explicit-huge-pages', action='store_true',
+        help='use huge pages reserved through /proc/sys/vm/nr_hugepages for --huge-page-arena '
+             'instead of transparent huge pages.')
+    parser.add_argument(
+        '--huge-page-numa-node', type=int, default=-1, metavar='NODE',
+        help='NUMA node to bind the memory of --huge-page-arena to. Default is -1, the node '
+             'rosbag2 starts on. Linux only.')
+
+
+def is_remote_uri(value: str) -> bool:
+    """Whether the bag file is a binary log in object storage rather than a local path."""
+    return value.startswith(('http://', 's3://'))
+
+
 def check_path_exists(value: Any) -> str:
-    """Argparse validator to verify a path exists."""
+    """Argparse validator to verify a path exists, or is the URL of a remote bag file."""
     try:
-        if os.path.exists(value):
+        if os.path.exists(value) or is_remote_uri(value):
             return value
         raise ArgumentTypeError("Bag file '{}' does not exist!".format(value))
     except ValueError:
@@ -0,0 +1,158 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from argparse import FileType
+import os
+
+from ros2bag.api import add_resource_arguments
+from ros2bag.api import check_path_exists
+from ros2bag.api import convert_yaml_to_topic_groups
+from ros2bag.api import print_error
+from ros2bag.verb import VerbExtension
+import yaml
+
+
+class ConvertVerb(VerbExtension):
+    """ros2 bag convert."""
+
+    def add_arguments(self, parser, cli_name):  # noqa: D102
+        parser.add_argument(
+            'bag_files', type=check_path_exists, nargs='+',
+            help='bag files to convert. Several bags are merged into one bag ordered by the '
+                 'time stamps of their messages.')
+        parser.add_argument(
+            '-o', '--output', required=True,
+            help='destination of the converted bag, which must not exist')
+        parser.add_argument(
+            '--input-storage', default='',
+            help='storage identifier of the bags to convert. Defaults to the storage of its '
+                 'metadata, required if there is none.')
+        parser.add_argument(
+            '-s', '--storage', default='sqlite3',
+            help='storage identifier of the converted bag, defaults to "sqlite3"')
+        parser.add_argument(
+            '--topics', type=str, default=[], nargs='+',
+            help='topics to convert, by default all topics are converted')
+        parser.add_argument(
+            '-x', '--exclude', default='',
+            help='leave out the topics with a name matching this regular expression')
+        parser.add_argument(
+            '-f', '--serialization-format', default='',
+            help='serialization format of the messages of the converted bag, '
+                 'defaults to the format of the bag')
+        parser.add_argument(
+            '-b', '--max-bag-size', type=int, default=0,
+            help='maximum size in bytes before the converted bagfile will be split. '
+                 'Default it is zero, the bag is written in a single bagfile.')
+        parser.add_argument(
+            '-d', '--max-bag-duration', type=int, default=0,
+            help='maximum time span in seconds of the messages in a converted bagfile before it '
+                 'will be split. Default it is zero, splitting by duration is disabled.')
+        parser.add_argument(
+            '--topic-groups-path', type=FileType('r'),
+            help='Path to a yaml file of topic groups as for "ros2 bag record", to split the '
+                 'converted bag by topic into folders of the groups.')
+        parser.add_argument(
+            '--compression-mode', type=str, default='none',
+            choices=['none', 'file', 'message', 'chunk'],
+            help='Determine whether to compress by file, message or chunks of messages. '
+                 'Default is "none".')
+        parser.add_argument(
+            '--compression-format', type=str, default='',
+            choices=['zstd', 'lz4', 'lz4hc', 'image'],
+            help='Specify the compression format/algorithm. Default is none.')
+        parser.add_argument(
+            '--compression-level', type=int, default=1,
+            help='compression level of the compression format. Higher levels compress better '
+                 'but slower. Default is 1.')
+        parser.add_argument(
+            '--compression-threads', type=int, default=1,
+            help='number of threads compressing closed bagfiles in "file" compression mode. '
+                 'Default is 1.')
+        parser.add_argument(
+            '--keep-splits', action='store_true',
+            help='convert every bagfile into a bagfile of its own, all at once, instead of '
+                 'reading the whole bag in order. Requires an uncompressed bag without stripes '
+                 'or topic groups, and cannot be combined with splitting the converted bag.')
+        parser.add_argument(
+            '-j', '--threads', type=int, default=0,
+            help='maximum number of threads converting the serialization format, or '
+                 'bagfiles at once with --keep-splits. '
+                 'Default is 0, which uses one thread per processor.')
+        add_resource_arguments(parser)
+
+    def main(self, *, args):  # noqa: D102
+        if os.path.isdir(args.output):
+            return print_error("Output folder '{}' already exists.".format(args.output))
+        if args.compression_format and args.compression_mode == 'none':
+            return print_error('Invalid choice: Cannot specify compression format '
+                               'without a compression mode.')
+        if (args.max_bag_size < 0 or args.max_bag_duration < 0 or args.threads < 0 or
+                args.compression_threads < 0):
+            return print_error('Invalid choice: Sizes, durations and numbers of threads must '
+                               'not be negative.')
+        if args.keep_splits and (
+                args.max_bag_size > 0 or args.max_bag_duration > 0 or args.topic_groups_path):
+            return print_error('Invalid choice: --keep-splits cannot be combined with '
+                               'splitting the converted bag.')
+        if args.keep_splits and len(args.bag_files) > 1:
+            return print_error('Invalid choice: --keep-splits cannot be combined with '
+                               'merging bags.')
+        if args.topic_groups_path and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot compress bags written with topic groups.')
+        topic_groups = []
+        if args.topic_groups_path:
+            try:
+                topic_groups = convert_yaml_to_topic_groups(
+                    yaml.safe_load(args.topic_groups_path) or {})
+            except (AttributeError, TypeError, ValueError) as e:
+                return print_error('Invalid topic groups: {}'.format(e))
+        # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
+        #               combined with constrained environments (as imposed by colcon test)
+        #               may result in DLL loading failures when attempting to import a C
+        #               extension. Therefore, do not import rosbag2_transport at the module
+        #               level but on demand, right before first use.
+        from rosbag2_transport import rosbag2_transport_py
+        rosbag2_transport_py.configure_threads(
+            size=args.background_threads, cpu_affinity=args.background_cpus,
+            nice=args.background_nice)
+        rosbag2_transport_py.set_memory_budget(max_bytes=args.memory_budget)
+        rosbag2_transport_py.configure_memory_arena(
+            size=args.huge_page_arena, explicit_huge_pages=args.explicit_huge_pages,
+            numa_node=args.huge_page_numa_node)
+        try:
+            message_count, size, seconds = rosbag2_transport_py.convert(
+                input_uris=args.bag_files,
+                input_storage_id=args.input_storage,
+                output_uri=args.output,
+                output_storage_id=args.storage,
+                max_bagfile_size=args.max_bag_size,
+                max_bagfile_duration=args.max_bag_duration,
+                topics=args.topics,
+                topic_groups=topic_groups,
+                exclude=args.exclude,
+                serialization_format=args.serialization_format,
+                compression_mode=args.compression_mode,
+                compression_format=args.compression_format,
+                compression_level=args.compression_level,
+                compression_threads=args.compression_threads,
+                keep_splits=args.keep_splits,
+                max_threads=args.threads)
+        except RuntimeError as e:
+            return print_error(str(e))
+        megabytes = size / (1024 * 1024)
+        print("Converted {} to '{}' with {} messages of {:.1f} MiB in {:.1f} s ({:.1f} MiB/s)."
+              .format(', '.join("'{}'".format(bag_file) for bag_file in args.bag_files),
+                      args.output, message_count, megabytes, seconds,
+                      megabytes / seconds if seconds > 0 else 0.0))
@@ -0,0 +1,82 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+from ros2bag.api import print_error
+from ros2bag.verb import VerbExtension
+
+
+class DatasetVerb(VerbExtension):
+    """ros2 bag dataset."""
+
+    def add_arguments(self, parser, cli_name):  # noqa: D102
+        parser.add_argument(
+            'bag_file', help='bag directory whose messages are exported')
+        parser.add_argument(
+            '-o', '--output', required=True,
+            help='directory of the shards, which is created if needed')
+        parser.add_argument(
+            '-t', '--topics', nargs='+', required=True,
+            help='topics of the samples, a message of each per sample. The messages of several '
+                 'topics are synchronized by their time stamps.')
+        parser.add_argument(
+            '-f', '--format', choices=['webdataset', 'tfrecord'], default='webdataset',
+            help='format of the shards: tar archives of a file per message, or TFRecord files '
+                 'of a tf.train.Example per sample. Default is webdataset.')
+        parser.add_argument(
+            '-n', '--samples-per-shard', type=int, default=1000,
+            help='number of samples per shard. Default is 1000.')
+        parser.add_argument(
+            '--slop', type=float, default=0.0,
+            help='maximum time difference in seconds between the messages of a sample. '
+                 'Default is 0, which only synchronizes messages of the same time.')
+        parser.add_argument(
+            '--by-publish-time', action='store_true',
+            help='synchronize messages by their publish time stamps instead of the time '
+                 'they were received.')
+        parser.add_argument(
+            '-j', '--threads', type=int, default=0,
+            help='maximum number of threads writing shards. '
+                 'Default is 0, which uses one thread per processor.')
+        parser.add_argument(
+            '-s', '--storage', default='',
+            help='storage identifier of the bag. Default is the one of its metadata.')
+
+    def main(self, *, args):  # noqa: D102
+        bag_file = args.bag_file
+        if not os.path.isdir(bag_file):
+            return print_error("Bag directory '{}' does not exist!".format(bag_file))
+        if args.samples_per_shard < 1:
+            return print_error('Invalid choice: A shard holds at least one sample.')
+        if args.slop < 0:
+            return print_error('Invalid choice: The slop must not be negative.')
+        if args.threads < 0:
+            return print_error('Invalid choice: The number of threads must not be negative.')
+        # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
+        #               combined with constrained environments (as imposed by colcon test)
+        #               may result in DLL loading failures when attempting to import a C
+        #               extension. Therefore, do not import rosbag2_transport at the module
+        #               level but on demand, right before first use.
+        from rosbag2_transport import rosbag2_transport_py
+        try:
+            shard_paths, sample_count = rosbag2_transport_py.export_dataset(
+                uri=bag_file, directory=args.output, topics=args.topics, format=args.format,
+                samples_per_shard=args.samples_per_shard, slop=int(args.slop * 1e9),
+                by_publish_time=args.by_publish_time, max_threads=args.threads,
+                storage_id=args.storage)
+        except (RuntimeError, ValueError) as e:
+            return print_error(str(e))
+        print("Exported {} samples of '{}' to {} shards in '{}'.".format(
+            sample_count, bag_file, len(shard_paths), args.output))
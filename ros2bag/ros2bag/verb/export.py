@@ -0,0 +1,62 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+from ros2bag.api import print_error
+from ros2bag.verb import VerbExtension
+
+
+class ExportVerb(VerbExtension):
+    """ros2 bag export."""
+
+    def add_arguments(self, parser, cli_name):  # noqa: D102
+        parser.add_argument(
+            'bag_file', help='bag directory whose messages are exported')
+        parser.add_argument(
+            '-o', '--output', required=True,
+            help='directory of the exported files, one per topic, which is created if needed')
+        parser.add_argument(
+            '-f', '--format', choices=['ndjson', 'csv'], default='ndjson',
+            help='format of the exported files: a JSON object per line, or a CSV row per '
+                 'message with a column per field. Default is ndjson.')
+        parser.add_argument(
+            '-t', '--topics', nargs='+', default=[],
+            help='topics to export. Default is every topic serialized as CDR.')
+        parser.add_argument(
+            '-j', '--threads', type=int, default=0,
+            help='maximum number of bagfiles exported in parallel. '
+                 'Default is 0, which uses one thread per processor.')
+
+    def main(self, *, args):  # noqa: D102
+        bag_file = args.bag_file
+        if not os.path.isdir(bag_file):
+            return print_error("Bag directory '{}' does not exist!".format(bag_file))
+        if args.threads < 0:
+            return print_error('Invalid choice: The number of threads must not be negative.')
+        # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
+        #               combined with constrained environments (as imposed by colcon test)
+        #               may result in DLL loading failures when attempting to import a C
+        #               extension. Therefore, do not import rosbag2_transport at the module
+        #               level but on demand, right before first use.
+        from rosbag2_transport import rosbag2_transport_py
+        try:
+            topics = rosbag2_transport_py.export_text(
+                uri=bag_file, directory=args.output, format=args.format, topics=args.topics,
+                max_threads=args.threads)
+        except RuntimeError as e:
+            return print_error(str(e))
+        for topic_name, file_path, message_count in topics:
+            print('{}: {} messages to {}'.format(topic_name, message_count, file_path))
+        print("Exported {} topics of '{}'.".format(len(topics), bag_file))
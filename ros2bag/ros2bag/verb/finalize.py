@@ -0,0 +1,61 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+from ros2bag.api import print_error
+from ros2bag.verb import VerbExtension
+
+
+def find_host_folders(bag_directory):
+    """Find the folders of a bag directory holding the bag of a host, ordered by name."""
+    def has_metadata(folder):
+        return any(
+            os.path.isfile(os.path.join(bag_directory, folder, metadata_file))
+            for metadata_file in ('metadata.yaml', 'metadata.bin'))
+    return sorted(entry for entry in os.listdir(bag_directory) if has_metadata(entry))
+
+
+class FinalizeVerb(VerbExtension):
+    """ros2 bag finalize."""
+
+    def add_arguments(self, parser, cli_name):  # noqa: D102
+        parser.add_argument(
+            'bag_file', help='bag directory holding the bags recorded by several hosts with the '
+                             'same bag id, each in a folder of its own')
+        parser.add_argument(
+            'host_folders', nargs='*', default=[],
+            help='folders of the bags of the hosts, relative to the bag directory. Defaults to '
+                 'all folders of the bag directory with a metadata file.')
+
+    def main(self, *, args):  # noqa: D102
+        bag_file = args.bag_file
+        if not os.path.isdir(bag_file):
+            return print_error("Bag directory '{}' does not exist!".format(bag_file))
+        host_folders = args.host_folders or find_host_folders(bag_file)
+        if not host_folders:
+            return print_error("No bags of hosts were found in '{}'.".format(bag_file))
+        # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
+        #               combined with constrained environments (as imposed by colcon test)
+        #               may result in DLL loading failures when attempting to import a C
+        #               extension. Therefore, do not import rosbag2_transport at the module
+        #               level but on demand, right before first use.
+        from rosbag2_transport import rosbag2_transport_py
+        try:
+            message_count = rosbag2_transport_py.finalize(
+                uri=bag_file, host_folders=host_folders)
+        except RuntimeError as e:
+            return print_error(str(e))
+        print("Finalized '{}' of {} hosts with {} messages.".format(
+            bag_file, len(host_folders), message_count))
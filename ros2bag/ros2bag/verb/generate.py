@@ -0,0 +1,68 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import datetime
+import os
+
+from ros2bag.api import check_path_exists
+from ros2bag.api import print_error
+from ros2bag.verb import VerbExtension
+
+
+class GenerateVerb(VerbExtension):
+    """ros2 bag generate."""
+
+    def add_arguments(self, parser, cli_name):  # noqa: D102
+        parser.add_argument(
+            'spec', type=check_path_exists,
+            help='yaml file with the seed, the duration in seconds and the topics of the bag, '
+                 'each with a name, an optional type, a rate in Hz and a size or a min_size '
+                 'and max_size in bytes')
+        parser.add_argument(
+            '-o', '--output',
+            help='destination of the bagfile to create, '
+                 'defaults to a timestamped folder in the current directory')
+        parser.add_argument(
+            '-s', '--storage', default='sqlite3',
+            help='storage identifier to be used, defaults to "sqlite3"')
+        parser.add_argument(
+            '-b', '--max-bag-size', type=int, default=0,
+            help='maximum size in bytes before the bagfile will be split. '
+                 'Default it is zero, the bag is written in a single bagfile.')
+        parser.add_argument(
+            '-j', '--threads', type=int, default=0,
+            help='maximum number of threads generating messages. '
+                 'Default is 0, which uses one thread per processor.')
+
+    def main(self, *, args):  # noqa: D102
+        uri = args.output or datetime.datetime.now().strftime('rosbag2_%Y_%m_%d-%H_%M_%S')
+        if os.path.isdir(uri):
+            return print_error("Output folder '{}' already exists.".format(uri))
+        if args.max_bag_size < 0:
+            return print_error('Invalid choice: The maximum bag size must not be negative.')
+        if args.threads < 0:
+            return print_error('Invalid choice: The number of threads must not be negative.')
+        # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
+        #               combined with constrained environments (as imposed by colcon test)
+        #               may result in DLL loading failures when attempting to import a C
+        #               extension. Therefore, do not import rosbag2_transport at the module
+        #               level but on demand, right before first use.
+        from rosbag2_transport import rosbag2_transport_py
+        try:
+            message_count = rosbag2_transport_py.generate(
+                uri=uri, spec=args.spec, storage_id=args.storage,
+                max_bagfile_size=args.max_bag_size, max_threads=args.threads)
+        except RuntimeError as e:
+            return print_error(str(e))
+        print("Generated '{}' with {} messages.".format(uri, message_count))
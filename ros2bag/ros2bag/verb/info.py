@@ -14,6 +14,7 @@
 
 import os
 
+from ros2bag.api import is_remote_uri
 from ros2bag.verb import VerbExtension
 
 
@@ -27,10 +28,14 @@ class InfoVerb(VerbExtension):
             '-s', '--storage', default='sqlite3',
             help='storage identifier to be used to open storage, if no yaml file exists.'
                  ' Defaults to "sqlite3"')
+        parser.add_argument(
+            '-v', '--verbose', action='store_true',
+            help='print the size, average and largest message size, rate and bandwidth of every'
+                 ' topic, scanning the bagfiles if the bag was recorded without them')
 
     def main(self, *, args):  # noqa: D102
         bag_file = args.bag_file
-        if not os.path.exists(bag_file):
+        if not os.path.exists(bag_file) and not is_remote_uri(bag_file):
             return "[ERROR] [ros2bag]: bag file '{}' does not exist!".format(bag_file)
         # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
         #               combined with constrained environments (as imposed by colcon test)
@@ -38,4 +43,4 @@ class InfoVerb(VerbExtension):
         #               extension. Therefore, do not import rosbag2_transport at the module
         #               level but on demand, right before first use.
         from rosbag2_transport import rosbag2_transport_py
-        rosbag2_transport_py.info(uri=bag_file, storage_id=args.storage)
+        rosbag2_transport_py.info(uri=bag_file, storage_id=args.storage, verbose=args.verbose)
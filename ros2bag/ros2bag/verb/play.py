@@ -15,9 +15,13 @@
 from argparse import FileType
 
 from rclpy.qos import InvalidQoSProfileException
+from ros2bag.api import add_resource_arguments
+from ros2bag.api import check_not_negative_float
 from ros2bag.api import check_path_exists
 from ros2bag.api import check_positive_float
+from ros2bag.api import convert_yaml_to_message_transforms
 from ros2bag.api import convert_yaml_to_qos_profile
+from ros2bag.api import convert_yaml_to_thread_scheduling
 from ros2bag.api import print_error
 from ros2bag.verb import VerbExtension
 from ros2cli.node import NODE_NAME_PREFIX
@@ -29,7 +33,8 @@ class PlayVerb(VerbExtension):
 
     def add_arguments(self, parser, cli_name):  # noqa: D102
         parser.add_argument(
-            'bag_file', type=check_path_exists, help='bag file to replay')
+            'bag_file', type=check_path_exists, nargs='+',
+            help='bag file to replay. Several bags are played together, merged by time stamp.')
         parser.add_argument(
             '-s', '--storage', default='sqlite3',
             help='storage identifier to be used, defaults to "sqlite3"')
@@ -38,6 +43,11 @@ class PlayVerb(VerbExtension):
             help='size of message queue rosbag tries to hold in memory to help deterministic '
                  'playback. Larger size will result in larger memory needs but might prevent '
                  'delay of message playback.')
+        parser.add_argument(
+            '--read-ahead-queue-bytes', type=int, default=0,
+            help='bytes of serialized messages rosbag holds in memory at most, in addition to '
+                 'the --read-ahead-queue-size limit. Useful for bags with large messages. '
+                 'Defaults to 0, which does not limit the bytes.')
         parser.add_argument(
             '-r', '--rate', type=check_positive_float, default=1.0,
             help='rate at which to play back messages. Valid range > 0.0.')
@@ -48,12 +58,153 @@ class PlayVerb(VerbExtension):
         parser.add_argument(
             '--qos-profile-overrides-path', type=FileType('r'),
             help='Path to a yaml file defining overrides of the QoS profile for specific topics.')
+        parser.add_argument(
+            '--latched-topics', type=str, default=[], nargs='+',
+            help='topics whose latest message before the time playback starts at or seeks to is '
+                 'published right away, e.g. topics published once like a map. Topics recorded '
+                 'with transient local durability, like /tf_static, are latched in any case.')
         parser.add_argument(
             '-l', '--loop', action='store_true',
             help='enables loop playback when playing a bagfile: it starts back at the beginning '
                  'on reaching the end and plays indefinitely.')
+        parser.add_argument(
+            '--loop-cache-bytes', type=int, default=0,
+            help='keep the played messages in memory when looping if their serialized data does '
+                 'not exceed this many bytes, so the bag is only read once. Defaults to 0, which '
+                 'reads it again in every loop.')
+        parser.add_argument(
+            '--preload', action='store_true',
+            help='read the whole bag into memory before playing, so playback does not access '
+                 'the storage.')
+        parser.add_argument(
+            '--preload-max-bytes', type=int, default=0,
+            help='play bags with more serialized data than this from storage instead of '
+                 'preloading them. Defaults to 0, which preloads any bag.')
+        parser.add_argument(
+            '--start-offset', type=check_not_negative_float, default=0.0,
+            help='seconds into the bag to start playback at. The messages before are skipped '
+                 'without being read. Defaults to 0.0, the start of the bag.')
+        parser.add_argument(
+            '--duration', type=check_not_negative_float, default=0.0,
+            help='seconds of the bag to play back, counted from the start offset. '
+                 'Defaults to 0.0, which plays until the end of the bag.')
+        parser.add_argument(
+            '--order-by-publish-time', action='store_true',
+            help='play back messages in the order and at the time they were published at, '
+                 'instead of the time they were recorded at.')
+        parser.add_argument(
+            '--decompression-directory', type=str, default='',
+            help='existing directory to decompress the files of bags compressed in "file" mode '
+                 'to, e.g. a tmpfs directory like /dev/shm to keep them in memory. Defaults to '
+                 'the bag directory.')
+        parser.add_argument(
+            '--decompression-threads', type=int, default=0,
+            help='threads decompressing the messages read ahead from bags compressed in '
+                 '"message" or "chunk" mode, in addition to the thread reading them. Defaults '
+                 'to 0, which decompresses on the reading thread only.')
+        parser.add_argument(
+            '--encryption-key-file', type=str, default='',
+            help='file holding the master key an encrypted bag was recorded with.')
+        parser.add_argument(
+            '--busy-wait-us', type=int, default=0,
+            help='microseconds before a message is due at which playback stops sleeping and '
+                 'busy-waits instead, for more precise timing at the cost of a busy core. '
+                 'Defaults to 0, which only sleeps.')
+        parser.add_argument(
+            '--realtime-priority', type=int, default=0,
+            help='SCHED_FIFO priority from 1 to 99 of the thread publishing the messages. '
+                 'Requires the permission to use real-time scheduling. Linux only. Defaults to 0, '
+                 'which keeps the normal scheduling.')
+        parser.add_argument(
+            '--cpu-affinity', type=int, nargs='+', default=[], metavar='CPU',
+            help='CPUs to pin the thread publishing the messages to. Linux only.')
+        parser.add_argument(
+            '--thread-scheduling-path', type=FileType('r'),
+            help='Path to a yaml file mapping the thread role player, the --publishing-threads, '
+                 'to the cpu_affinity, nice value and SCHED_FIFO realtime_priority of its '
+                 'threads. Linux only.')
+        parser.add_argument(
+            '--transforms-path', type=FileType('r'),
+            help='Path to a yaml file listing message transforms by the "name" of a registered '
+                 'transform or a transform plugin and their "parameters". They transform the '
+                 'topics and messages in order, in process, e.g. to remap, filter or downsample '
+                 'topics without relay nodes.')
+        parser.add_argument(
+            '--publishing-threads', type=int, default=0,
+            help='number of threads publishing the messages, which share the topics among them. '
+                 'A slow publish then only delays the topics of its thread. The messages of a '
+                 'topic stay in order. Defaults to 0, which publishes on the playing thread.')
+        parser.add_argument(
+            '--as-fast-as-possible', action='store_true',
+            help='publish the messages as fast as possible instead of at their recorded timing, '
+                 'ignoring the rate. Reports the achieved messages per second when done.')
+        parser.add_argument(
+            '--wait-for-subscribers', type=int, default=0, metavar='N',
+            help='wait until every topic is matched with at least N subscriptions before '
+                 'playing. Defaults to 0, which starts right away.')
+        parser.add_argument(
+            '--lazy-publishers', action='store_true',
+            help='create the publisher of a topic when its first message is about to be played '
+                 'instead of creating the publishers of all topics before playing, e.g. to play '
+                 'a few topics of a bag with many. Subscribers may miss the first messages of a '
+                 'topic until they discovered its publisher. Ignored with '
+                 '--wait-for-subscribers.')
+        parser.add_argument(
+            '--clock', type=check_not_negative_float, nargs='?', const=40.0, default=0.0,
+            metavar='HZ',
+            help='publish the bag time on /clock at HZ, 40 if not given, for nodes using '
+                 'use_sim_time. The time follows the --rate. Defaults to 0, which does not '
+                 'publish it.')
+        parser.add_argument(
+            '--rewrite-header-stamps', action='store_true',
+            help='rewrite the header.stamp of the played messages to the time they are '
+                 'published at, the bag time with --clock and the system time otherwise, without '
+                 'deserializing them. Messages without header.stamp are played unchanged.')
+        parser.add_argument(
+            '--start-paused', action='store_true',
+            help='start paused. Playback is controlled by the ~/pause, ~/resume, ~/play_next, '
+                 '~/set_rate and ~/seek services of the player node.')
+        parser.add_argument(
+            '--host', default='',
+            help='folder of the bag of a host in a bag finalized from the bags of several hosts '
+                 'with "ros2 bag finalize". Plays only the topics the host recorded, on the '
+                 'timeline of the whole bag, so a player on every host replays its own topics.')
+        parser.add_argument(
+            '--start-at', type=check_not_negative_float, default=0.0, metavar='SECONDS',
+            help='time of the reference clock in seconds since epoch at which to start playing, '
+                 'so the players of several hosts start together. Defaults to 0, which starts '
+                 'right away.')
+        parser.add_argument(
+            '--clock-offset', type=int, default=0,
+            help='nanoseconds to add to the clock of this host to get the reference clock of '
+                 'the hosts for --start-at, e.g. as estimated by chrony or PTP. Default is 0.')
+        add_resource_arguments(parser)
 
     def main(self, *, args):  # noqa: D102
+        if args.read_ahead_queue_bytes < 0:
+            return print_error('Invalid choice: The read-ahead queue bytes must not be negative.')
+        if args.loop_cache_bytes < 0:
+            return print_error('Invalid choice: The loop cache bytes must not be negative.')
+        if args.preload_max_bytes < 0:
+            return print_error('Invalid choice: The preload limit must not be negative.')
+        if args.decompression_threads < 0:
+            return print_error('Invalid choice: The number of decompression threads must not be '
+                               'negative.')
+        if args.busy_wait_us < 0:
+            return print_error('Invalid choice: The busy wait period must not be negative.')
+        if not 0 <= args.realtime_priority <= 99:
+            return print_error('Invalid choice: The real-time priority must be from 0 to 99.')
+        if any(cpu < 0 for cpu in args.cpu_affinity):
+            return print_error('Invalid choice: CPU numbers must not be negative.')
+        if args.publishing_threads < 0:
+            return print_error('Invalid choice: The number of publishing threads must not be '
+                               'negative.')
+        if args.wait_for_subscribers < 0:
+            return print_error('Invalid choice: The number of subscribers must not be negative.')
+        if args.host and len(args.bag_file) > 1:
+            return print_error('Invalid choice: Cannot play the bag of a host together with '
+                               'other bags.')
+
         qos_profile_overrides = {}  # Specify a valid default
         if args.qos_profile_overrides_path:
             qos_profile_dict = yaml.safe_load(args.qos_profile_overrides_path)
@@ -63,18 +214,68 @@ class PlayVerb(VerbExtension):
             except (InvalidQoSProfileException, ValueError) as e:
                 return print_error(str(e))
 
+        thread_scheduling = {}
+        if args.thread_scheduling_path:
+            try:
+                thread_scheduling = convert_yaml_to_thread_scheduling(
+                    yaml.safe_load(args.thread_scheduling_path) or {}, ['player'])
+            except (AttributeError, TypeError, ValueError) as e:
+                return print_error('Invalid thread scheduling: {}'.format(e))
+
+        transforms = []
+        if args.transforms_path:
+            try:
+                transforms = convert_yaml_to_message_transforms(
+                    yaml.safe_load(args.transforms_path) or [])
+            except (AttributeError, TypeError, ValueError) as e:
+                return print_error('Invalid message transforms: {}'.format(e))
+
         # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
         #               combined with constrained environments (as imposed by colcon test)
         #               may result in DLL loading failures when attempting to import a C
         #               extension. Therefore, do not import rosbag2_transport at the module
         #               level but on demand, right before first use.
         from rosbag2_transport import rosbag2_transport_py
+        rosbag2_transport_py.configure_threads(
+            size=args.background_threads, cpu_affinity=args.background_cpus,
+            nice=args.background_nice)
+        rosbag2_transport_py.set_memory_budget(max_bytes=args.memory_budget)
+        rosbag2_transport_py.configure_memory_arena(
+            size=args.huge_page_arena, explicit_huge_pages=args.explicit_huge_pages,
+            numa_node=args.huge_page_numa_node)
         rosbag2_transport_py.play(
-            uri=args.bag_file,
+            uri=args.bag_file[0],
+            uris=args.bag_file[1:],
             storage_id=args.storage,
             node_prefix=NODE_NAME_PREFIX,
             read_ahead_queue_size=args.read_ahead_queue_size,
             rate=args.rate,
             topics=args.topics,
             qos_profile_overrides=qos_profile_overrides,
-            loop=args.loop)
+            loop=args.loop,
+            start_offset=args.start_offset,
+            duration=args.duration,
+            order_by_publish_time=args.order_by_publish_time,
+            decompression_directory=args.decompression_directory,
+            decompression_threads=args.decompression_threads,
+            encryption_key_file=args.encryption_key_file,
+            read_ahead_queue_bytes=args.read_ahead_queue_bytes,
+            busy_wait_us=args.busy_wait_us,
+            realtime_priority=args.realtime_priority,
+            cpu_affinity=args.cpu_affinity,
+            publishing_threads=args.publishing_threads,
+            as_fast_as_possible=args.as_fast_as_possible,
+            wait_for_subscribers=args.wait_for_subscribers,
+            lazy_publishers=args.lazy_publishers,
+            clock_publish_frequency=args.clock,
+            start_paused=args.start_paused,
+            rewrite_header_stamps=args.rewrite_header_stamps,
+            loop_cache_bytes=args.loop_cache_bytes,
+            preload=args.preload,
+            preload_max_bytes=args.preload_max_bytes,
+            latched_topics=args.latched_topics,
+            thread_scheduling=thread_scheduling,
+            host_folder=args.host,
+            start_at_ns=int(round(args.start_at * 1e9)),
+            clock_offset_ns=args.clock_offset,
+            transforms=transforms)
@@ -17,7 +17,13 @@ import datetime
 import os
 
 from rclpy.qos import InvalidQoSProfileException
+from ros2bag.api import add_resource_arguments
+from ros2bag.api import convert_yaml_to_message_transforms
 from ros2bag.api import convert_yaml_to_qos_profile
+from ros2bag.api import convert_yaml_to_thread_scheduling
+from ros2bag.api import convert_yaml_to_topic_groups
+from ros2bag.api import convert_yaml_to_topic_compression
+from ros2bag.api import convert_yaml_to_topic_throttles
 from ros2bag.api import create_bag_directory
 from ros2bag.api import print_error
 from ros2bag.verb import VerbExtension
@@ -34,6 +40,13 @@ class RecordVerb(VerbExtension):
             help='recording all topics, required if no topics are listed explicitly.')
         parser.add_argument(
             'topics', nargs='*', help='topics to be recorded')
+        parser.add_argument(
+            '-e', '--regex', default='',
+            help='record only the topics with a name matching this regular expression.')
+        parser.add_argument(
+            '-x', '--exclude', default='',
+            help='leave out the topics with a name matching this regular expression when '
+                 'recording with -a or --regex.')
         parser.add_argument(
             '-o', '--output',
             help='destination of the bagfile to create, \
@@ -51,7 +64,8 @@ class RecordVerb(VerbExtension):
                  'startup will be recorded')
         parser.add_argument(
             '-p', '--polling-interval', type=int, default=100,
-            help='time in ms to wait between querying available topics for recording. '
+            help='longest time in ms to wait for changes of the available topics, which are '
+                  'subscribed as soon as they are discovered. '
                   'It has no effect if --no-discovery is enabled.'
         )
         parser.add_argument(
@@ -60,20 +74,264 @@ class RecordVerb(VerbExtension):
                   'Default it is zero, recording written in single bagfile and splitting '
                   'is disabled.'
         )
+        parser.add_argument(
+            '-d', '--max-bag-duration', type=int, default=0,
+            help='maximum time span in seconds of the messages in a bagfile before it will be '
+                 'split. Default it is zero, splitting by duration is disabled.'
+        )
+        parser.add_argument(
+            '--max-bag-messages', type=int, default=0,
+            help='maximum number of messages in a bagfile before it will be split. '
+                 'Default it is zero, splitting by message count is disabled.'
+        )
+        parser.add_argument(
+            '--precreate-next-bagfile', action='store_true',
+            help='open the next bagfile in the background while recording, so splitting does '
+                 'not stall recording.'
+        )
+        parser.add_argument(
+            '--retention-max-size', type=int, default=0,
+            help='maximum size in bytes of all bagfiles of a split bag. Once it is exceeded, the '
+                 'oldest closed bagfiles are deleted, so continuous recording keeps the newest '
+                 'messages on disk. Default it is zero, the size is not limited.'
+        )
+        parser.add_argument(
+            '--retention-max-age', type=int, default=0,
+            help='delete the closed bagfiles of a split bag which end more than this many '
+                 'seconds before the newest message. Default it is zero, the age is not limited.'
+        )
+        parser.add_argument(
+            '--staging-directory', default='',
+            help='absolute path of a directory on a fast device, e.g. a tmpfs, the bagfiles are '
+                 'written to. Every closed bagfile is moved to the bag directory in the '
+                 'background, so recording does not stall on a slow device.'
+        )
+        parser.add_argument(
+            '--migration-rate', type=int, default=0,
+            help='maximum rate in bytes per second of copying closed bagfiles from the staging '
+                 'directory to another device. Default it is zero, the rate is not limited.'
+        )
+        parser.add_argument(
+            '--preallocate-bagfiles', action='store_true',
+            help='reserve the disk space of every bagfile up to the maximum bag size when it is '
+                 'created, so bagfiles written at high rates are not fragmented. Requires '
+                 '--max-bag-size.'
+        )
+        parser.add_argument(
+            '--writeback-interval', type=int, default=0,
+            help='hand the data written to a bagfile to the kernel to write back every this many '
+                 'bytes, e.g. 8388608, which spreads writing to disk evenly instead of stalling '
+                 'on flushes of many dirty pages. Default is 0, which leaves it to the kernel.'
+        )
+        parser.add_argument(
+            '--storage-preset-profile', type=str, default='',
+            help='select a configuration preset for the storage plugin. '
+                 'For sqlite3: "resilient" syncs every write to disk, "max_throughput" turns '
+                 'off journaling and syncing; a crash during recording likely corrupts the bag. '
+                 'Default is empty, using the storage defaults.'
+        )
+        parser.add_argument(
+            '--defer-index-creation', action='store_true',
+            help='build the storage indices only when a bagfile is closed or split. '
+                 'Speeds up recording, but a bagfile that is not closed properly stays '
+                 'unindexed and is slower to read.'
+        )
+        parser.add_argument(
+            '--topic-timestamp-index', action='store_true',
+            help='additionally index messages by topic, which speeds up playing back a few '
+                 'topics out of many at the cost of a larger bagfile.'
+        )
+        parser.add_argument(
+            '--cluster-messages-by-topic', action='store_true',
+            help='store the messages of every topic together in time stamp order, so playing '
+                 'back a few topics out of many reads contiguous parts of the bagfile. Writing '
+                 'is slower. Only supported by the sqlite3 storage.'
+        )
+        parser.add_argument(
+            '--checksums', action='store_true',
+            help='store a CRC-32C checksum of every message, so corrupt messages are detected '
+                 'when read or by "ros2 bag verify". The binary_log storage always checksums '
+                 'its chunks.'
+        )
+        parser.add_argument(
+            '--deduplicate-topics', type=str, nargs='+', default=[],
+            help='store messages of these topics with the same data as an earlier message of '
+                 'their topic in the same bagfile as references to it instead of storing the '
+                 'data again.'
+        )
+        parser.add_argument(
+            '--delta-encode-topics', type=str, nargs='+', default=[],
+            help='store messages of these topics, e.g. occupancy grids or costmaps, as the bytes '
+                 'changed since the previous message of their topic, before compressing them.'
+        )
+        parser.add_argument(
+            '--delta-keyframe-interval', type=int, default=100,
+            help='store every n-th message of the delta encoded topics in full, so playback '
+                 'seeking into the bag decodes few messages. Default is 100. Zero stores only '
+                 'the first message of every bagfile in full.'
+        )
+        parser.add_argument(
+            '--large-message-threshold', type=int, default=0,
+            help='write messages larger than this many bytes to a data file next to the sqlite3 '
+                 'database instead of into it. Default is zero, storing all messages in the '
+                 'database. Ignored in file compression mode.'
+        )
+        parser.add_argument(
+            '--transaction-max-messages', type=int, default=0,
+            help='commit messages to the storage in transactions of at most this many messages. '
+                 'Default is zero, committing every message on its own.'
+        )
+        parser.add_argument(
+            '--transaction-max-bytes', type=int, default=0,
+            help='commit the current storage transaction once it holds this many bytes. '
+                 'Default is zero, disabling the limit.'
+        )
+        parser.add_argument(
+            '--transaction-max-duration', type=int, default=0,
+            help='commit the current storage transaction once it is open for this many '
+                 'milliseconds, checked whenever a message is written. '
+                 'Default is zero, disabling the limit.'
+        )
         parser.add_argument(
             '--max-cache-size', type=int, default=0,
             help='maximum amount of messages to hold in cache before writing to disk. '
                  'Default it is zero, writing every message directly to disk.'
         )
+        parser.add_argument(
+            '--max-cache-size-bytes', type=int, default=0,
+            help='maximum amount of serialized message data in bytes to hold in cache before '
+                 'writing to disk. Can be combined with --max-cache-size, the cache is written '
+                 'when either limit is reached. Default it is zero, disabling the byte limit.'
+        )
         parser.add_argument(
             '--compression-mode', type=str, default='none',
-            choices=['none', 'file', 'message'],
-            help='Determine whether to compress by file or message. Default is "none".'
+            choices=['none', 'file', 'message', 'chunk'],
+            help='Determine whether to compress by file, message or chunks of messages. '
+                 'Default is "none".'
         )
         parser.add_argument(
-            '--compression-format', type=str, default='', choices=['zstd'],
+            '--compression-format', type=str, default='',
+            choices=['zstd', 'lz4', 'lz4hc', 'image', 'video'],
             help='Specify the compression format/algorithm. Default is none.'
         )
+        parser.add_argument(
+            '--compression-threads', type=int, default=1,
+            help='number of threads compressing closed bagfiles in "file" compression mode '
+                 'while recording continues. 0 compresses them on the recording thread. '
+                 'Default is 1.'
+        )
+        parser.add_argument(
+            '--compression-queue-size', type=int, default=1,
+            help='maximum number of closed bagfiles waiting to be compressed in "file" '
+                 'compression mode. Recording blocks while it is reached. 0 means unbounded. '
+                 'Default is 1.'
+        )
+        parser.add_argument(
+            '--compression-level', type=int, default=1,
+            help='compression level of the compression format. Higher levels compress better '
+                 'but slower. Negative levels make lz4 faster, lz4hc uses levels 3 to 12. '
+                 'Default is 1.'
+        )
+        parser.add_argument(
+            '--compression-worker-threads', type=int, default=0,
+            help='number of threads compressing a single bagfile in "file" compression mode. '
+                 '0 compresses every bagfile in a single thread. Default is 0.'
+        )
+        parser.add_argument(
+            '--compression-dictionary-training-messages', type=int, default=0,
+            help='number of messages per topic type used to train a compression dictionary in '
+                 '"message" compression mode, which improves the compression of small messages. '
+                 '0 disables training. Default is 0.'
+        )
+        parser.add_argument(
+            '--compression-dictionary', type=str, default='',
+            help='path of a dictionary compressing the messages of all topics in "message" '
+                 'compression mode, used instead of training dictionaries.'
+        )
+        parser.add_argument(
+            '--compression-chunk-size', type=int, default=1024 * 1024,
+            help='maximum size in bytes of the messages compressed together in "chunk" '
+                 'compression mode. 0 disables the limit. Default is 1 MiB.'
+        )
+        parser.add_argument(
+            '--compression-chunk-duration', type=int, default=0,
+            help='maximum time span in milliseconds of the messages compressed together in '
+                 '"chunk" compression mode. 0 disables the limit. Default is 0.'
+        )
+        parser.add_argument(
+            '--topic-compression-path', type=FileType('r'),
+            help='Path to a yaml file mapping topic names or types to the compression format '
+                 '(none, zstd, lz4, lz4hc, image or video) and level their messages are '
+                 'compressed with in "message" compression mode, e.g. none for topics compressed '
+                 'already.'
+        )
+        parser.add_argument(
+            '--topic-compression', nargs=2, action='append', metavar=('TOPIC', 'FORMAT'),
+            default=[],
+            help='compress the messages of a topic name or type with FORMAT (none, zstd, lz4, '
+                 'lz4hc, image or video) in "message" compression mode. Can be given multiple '
+                 'times.'
+        )
+        parser.add_argument(
+            '--compression-sample-messages', type=int, default=0,
+            help='number of messages of each topic compressed in "message" compression mode to '
+                 'sample how well the topic compresses. Topics which barely compress are written '
+                 'uncompressed until they are sampled again. 0 disables sampling. Default is 0.'
+        )
+        parser.add_argument(
+            '--compression-resample-interval', type=int, default=1000,
+            help='number of messages of a topic after which it is sampled again with '
+                 '--compression-sample-messages. 0 samples only once. Default is 1000.'
+        )
+        parser.add_argument(
+            '--incompressible-ratio', type=float, default=0.95,
+            help='ratio of compressed to uncompressed size of the sampled messages at or above '
+                 'which a topic is written uncompressed. Default is 0.95.'
+        )
+        parser.add_argument(
+            '--encryption-key-file', type=str, default='',
+            help='file holding a master key of 32 bytes or 64 hexadecimal digits. Every message '
+                 'or chunk is encrypted with AES-256-GCM after it is compressed, with a random '
+                 'key of the bag, which the metadata stores encrypted with the master key. '
+                 'Requires "message" or "chunk" compression mode.'
+        )
+        parser.add_argument(
+            '--adaptive-compression-level', action='store_true',
+            help='lower the compression level while compression falls behind the recorded data '
+                 'and raise it again once it keeps up, within --compression-level-min and '
+                 '--compression-level-max, starting at --compression-level.'
+        )
+        parser.add_argument(
+            '--compression-level-min', type=int, default=1,
+            help='lowest compression level used with --adaptive-compression-level. Default is 1.'
+        )
+        parser.add_argument(
+            '--compression-level-max', type=int, default=9,
+            help='highest compression level used with --adaptive-compression-level. '
+                 'Default is 9.'
+        )
+        parser.add_argument(
+            '--recorder-threads', type=int, default=1,
+            help='number of threads receiving messages. With more than one, topics are received '
+                 'in parallel and written by a separate thread. 0 uses one thread per CPU core. '
+                 'Default is 1.'
+        )
+        parser.add_argument(
+            '--snapshot-mode', action='store_true',
+            help='keep the latest messages in memory instead of writing them, and write them to '
+                 'the bag only when the ~/snapshot service of the recorder node is called. '
+                 'Requires --snapshot-max-bytes or --snapshot-duration.'
+        )
+        parser.add_argument(
+            '--snapshot-max-bytes', type=int, default=0,
+            help='largest amount of serialized message data, in bytes, kept in snapshot mode. '
+                 'The oldest messages are discarded beyond it. Default is 0, no limit.'
+        )
+        parser.add_argument(
+            '--snapshot-duration', type=int, default=0,
+            help='longest time span of messages, in seconds, kept in snapshot mode. '
+                 'The oldest messages are discarded beyond it. Default is 0, no limit.'
+        )
         parser.add_argument(
             '--include-hidden-topics', action='store_true',
             help='record also hidden topics.'
@@ -82,12 +340,129 @@ class RecordVerb(VerbExtension):
             '--qos-profile-overrides-path', type=FileType('r'),
             help='Path to a yaml file defining overrides of the QoS profile for specific topics.'
         )
+        parser.add_argument(
+            '--topic-throttles-path', type=FileType('r'),
+            help='Path to a yaml file mapping topic names to a decimation, to record only every '
+                 'n-th message, and a max_frequency in Hz, to record at most that many messages '
+                 'per second.'
+        )
+        parser.add_argument(
+            '--transforms-path', type=FileType('r'),
+            help='Path to a yaml file listing message transforms by the "name" of a registered '
+                 'transform or a transform plugin and their "parameters". They transform the '
+                 'topics and messages in order, in process, e.g. to remap, filter or downsample '
+                 'topics without relay nodes.'
+        )
+        parser.add_argument(
+            '--thread-scheduling-path', type=FileType('r'),
+            help='Path to a yaml file mapping the thread roles recorder, writer and compression '
+                 'to the cpu_affinity, nice value and SCHED_FIFO realtime_priority of their '
+                 'threads, applied when the threads start, e.g. to keep them off the CPUs of '
+                 'latency-critical processes. Roles not given are scheduled like the background '
+                 'threads. Linux only.'
+        )
+        parser.add_argument(
+            '--decimate', nargs=2, action='append', metavar=('TOPIC', 'N'), default=[],
+            help='record only every N-th message of a topic. Can be given multiple times.'
+        )
+        parser.add_argument(
+            '--max-frequency', nargs=2, action='append', metavar=('TOPIC', 'HZ'), default=[],
+            help='record at most HZ messages per second of a topic. Can be given multiple times.'
+        )
+        parser.add_argument(
+            '--statistics-interval', type=int, default=0,
+            help='publish the message rates, queue depth and write latencies of the recorder '
+                 'every this many milliseconds on ~/statistics, a diagnostic_msgs/DiagnosticArray '
+                 'topic of the recorder node. Default is 0, which does not publish them.'
+        )
+        parser.add_argument(
+            '--stripe-directories', type=str, nargs='+', default=[],
+            help='directories, typically on other disks, in which a folder named after the bag '
+                 'is written in addition to the bag folder. The messages are spread over all of '
+                 'them and the bag folder lists the files of all of them.'
+        )
+        parser.add_argument(
+            '--striping-policy', default='round_robin',
+            choices=['round_robin', 'topic_affinity'],
+            help='how messages are spread over the stripe directories: "round_robin" writes '
+                 'each message to the next directory, "topic_affinity" writes all messages of '
+                 'a topic to the same directory. Default is round_robin.'
+        )
+        parser.add_argument(
+            '--shards', type=int, default=0,
+            help='number of further writers of the bag folder the topics are spread over, topic '
+                 'by topic, each writing bagfiles of its own. With --max-cache-size, every '
+                 'writer writes on a thread of its own, so a storage writing one file at a time, '
+                 'like sqlite3, uses a core per shard. '
+                 'Default is 0, which writes all topics to the same bagfiles.'
+        )
+        parser.add_argument(
+            '--topic-groups-path', type=FileType('r'),
+            help='Path to a yaml file mapping group names to a "topics" regular expression and a '
+                 '"min_message_size" in bytes. Topics matching the expression of a group, or '
+                 'else whose first message reaches the size of a group, are written to files of '
+                 'their own in a folder of the bag named after the group, so playing back a few '
+                 'topics reads only their files.'
+        )
+        parser.add_argument(
+            '--metadata-checkpoint-interval', type=int, default=0,
+            help='write the metadata of the bag every this many milliseconds and on every split, '
+                 'so a recording which is killed keeps its metadata up to the last checkpoint. '
+                 'Use "ros2 bag reindex" to rebuild it completely. '
+                 'Default is 0, which writes the metadata only when recording stops.'
+        )
+        parser.add_argument(
+            '--reorder-window', type=int, default=0,
+            help='hold messages back until they are this many milliseconds older than the latest '
+                 'message, and write them in time stamp order, e.g. 50. Bags written in order '
+                 'are read without sorting. Default is 0, which writes messages as they arrive.'
+        )
+        parser.add_argument(
+            '--write-latency-budget', type=int, default=0,
+            help='warn when writing to the storage takes longer than this many milliseconds, '
+                 'or messages back up in front of the storage, naming the topics contributing '
+                 'the most bytes. The warnings are limited to one every 5 seconds. '
+                 'Default is 0, which does not monitor the writes.'
+        )
+        parser.add_argument(
+            '--bag-id', default='',
+            help='identity of the bag shared by the recorders of several hosts recording at the '
+                 'same time, stored in the metadata. Their bags are merged into a single bag '
+                 'with "ros2 bag finalize" once recorded.'
+        )
+        parser.add_argument(
+            '--clock-offset', type=int, default=0,
+            help='nanoseconds to add to the clock of this host to get the reference clock of '
+                 'the hosts, e.g. as estimated by chrony or PTP. It is added to the time stamps '
+                 'of the messages recorded. Default is 0.'
+        )
+        parser.add_argument(
+            '--stream-to', default='',
+            help='"host:port" of an ingest server, started with "ros2 run '
+                 'rosbag2_storage_default_plugins binary_log_ingest <port> <directory>", the '
+                 'bagfiles are streamed to while recording instead of writing them. Requires '
+                 '"-s binary_log". Run "ros2 bag reindex" on the received bag to get its metadata.'
+        )
+        parser.add_argument(
+            '--stream-max-memory', type=int, default=64 * 1024 * 1024,
+            help='bytes not yet acknowledged by the ingest server kept in memory, the data '
+                 'beyond is spilled to the bag directory until the link catches up. '
+                 'Default is 64 MiB.'
+        )
+        add_resource_arguments(parser)
         self._subparser = parser
 
     def main(self, *, args):  # noqa: D102
         if args.all and args.topics:
             return print_error('Invalid choice: Can not specify topics and -a at the same time.')
 
+        if args.regex and args.topics:
+            return print_error('Invalid choice: Can not specify topics and --regex at the same '
+                               'time.')
+
+        if args.exclude and not (args.all or args.regex):
+            return print_error('Invalid choice: --exclude requires -a or --regex.')
+
         uri = args.output or datetime.datetime.now().strftime('rosbag2_%Y_%m_%d-%H_%M_%S')
 
         if os.path.isdir(uri):
@@ -97,6 +472,105 @@ class RecordVerb(VerbExtension):
             return print_error('Invalid choice: Cannot specify compression format '
                                'without a compression mode.')
 
+        if args.snapshot_mode and args.snapshot_max_bytes <= 0 and args.snapshot_duration <= 0:
+            return print_error('Invalid choice: Snapshot mode requires --snapshot-max-bytes or '
+                               '--snapshot-duration.')
+
+        if (args.topic_compression_path or args.topic_compression) and \
+                args.compression_mode != 'message':
+            return print_error('Invalid choice: Topics can only be compressed on their own in '
+                               '"message" compression mode.')
+
+        if args.compression_sample_messages < 0 or args.compression_resample_interval < 0:
+            return print_error('Invalid choice: The number of sampled messages and the resample '
+                               'interval must not be negative.')
+
+        if args.compression_sample_messages > 0 and args.compression_mode != 'message':
+            return print_error('Invalid choice: Compression can only be sampled in "message" '
+                               'compression mode.')
+
+        if args.incompressible_ratio <= 0:
+            return print_error('Invalid choice: The incompressible ratio must be greater than 0.')
+
+        if args.encryption_key_file and args.compression_mode not in ('message', 'chunk'):
+            return print_error('Invalid choice: Bags can only be encrypted in "message" or '
+                               '"chunk" compression mode.')
+
+        if args.encryption_key_file and not os.path.isfile(args.encryption_key_file):
+            return print_error("Encryption key file '{}' does not exist.".format(
+                args.encryption_key_file))
+
+        if args.snapshot_mode and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot compress bags in snapshot mode.')
+
+        if args.recorder_threads < 0:
+            return print_error('Invalid choice: The number of recorder threads must not be '
+                               'negative.')
+
+        if args.statistics_interval < 0:
+            return print_error('Invalid choice: The statistics interval must not be negative.')
+
+        if args.deduplicate_topics and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot deduplicate topics of compressed bags.')
+
+        if set(args.deduplicate_topics) & set(args.delta_encode_topics):
+            return print_error('Invalid choice: Cannot both deduplicate and delta encode a '
+                               'topic.')
+
+        if args.delta_keyframe_interval < 0:
+            return print_error('Invalid choice: The delta keyframe interval must not be '
+                               'negative.')
+
+        if args.stripe_directories and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot compress bags written to stripe '
+                               'directories.')
+
+        if args.shards < 0:
+            return print_error('Invalid choice: The number of shards must not be negative.')
+
+        if args.shards and (args.stripe_directories or args.topic_groups_path):
+            return print_error('Invalid choice: Cannot write shards with stripe directories or '
+                               'topic groups.')
+
+        if args.shards and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot compress bags written with shards.')
+
+        if args.topic_groups_path and args.stripe_directories:
+            return print_error('Invalid choice: Cannot write topic groups to stripe '
+                               'directories.')
+
+        if args.topic_groups_path and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot compress bags written with topic groups.')
+
+        if args.metadata_checkpoint_interval < 0:
+            return print_error('Invalid choice: The metadata checkpoint interval must not be '
+                               'negative.')
+
+        if args.metadata_checkpoint_interval and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot write metadata checkpoints of compressed '
+                               'bags.')
+
+        if args.reorder_window < 0:
+            return print_error('Invalid choice: The reorder window must not be negative.')
+
+        if args.write_latency_budget < 0:
+            return print_error('Invalid choice: The write latency budget must not be negative.')
+
+        if args.stream_to and args.storage != 'binary_log':
+            return print_error('Invalid choice: Only the binary_log storage can be streamed.')
+
+        if args.stream_to and args.compression_mode != 'none':
+            return print_error('Invalid choice: Cannot compress streamed bags.')
+
+        if args.stream_max_memory <= 0:
+            return print_error('Invalid choice: The stream memory must be positive.')
+
+        if args.preallocate_bagfiles and args.max_bag_size == 0:
+            return print_error('Invalid choice: Preallocating bagfiles requires --max-bag-size.')
+
+        if args.writeback_interval < 0:
+            return print_error('Invalid choice: The writeback interval must not be negative.')
+
         args.compression_mode = args.compression_mode.upper()
 
         qos_profile_overrides = {}  # Specify a valid default
@@ -108,9 +582,58 @@ class RecordVerb(VerbExtension):
             except (InvalidQoSProfileException, ValueError) as e:
                 return print_error(str(e))
 
+        topic_throttles = {}
+        try:
+            throttle_dict = {}
+            if args.topic_throttles_path:
+                throttle_dict = yaml.safe_load(args.topic_throttles_path) or {}
+            for topic, decimation in args.decimate:
+                throttle_dict.setdefault(topic, {})['decimation'] = decimation
+            for topic, max_frequency in args.max_frequency:
+                throttle_dict.setdefault(topic, {})['max_frequency'] = max_frequency
+            topic_throttles = convert_yaml_to_topic_throttles(throttle_dict)
+        except (AttributeError, TypeError, ValueError) as e:
+            return print_error('Invalid topic throttles: {}'.format(e))
+
+        thread_scheduling = {}
+        if args.thread_scheduling_path:
+            try:
+                thread_scheduling = convert_yaml_to_thread_scheduling(
+                    yaml.safe_load(args.thread_scheduling_path) or {},
+                    ['recorder', 'writer', 'compression'])
+            except (AttributeError, TypeError, ValueError) as e:
+                return print_error('Invalid thread scheduling: {}'.format(e))
+
+        transforms = []
+        if args.transforms_path:
+            try:
+                transforms = convert_yaml_to_message_transforms(
+                    yaml.safe_load(args.transforms_path) or [])
+            except (AttributeError, TypeError, ValueError) as e:
+                return print_error('Invalid message transforms: {}'.format(e))
+
+        topic_compression = {}
+        try:
+            compression_dict = {}
+            if args.topic_compression_path:
+                compression_dict = yaml.safe_load(args.topic_compression_path) or {}
+            for topic, compression_format in args.topic_compression:
+                compression_dict.setdefault(topic, {})['format'] = compression_format
+            topic_compression = convert_yaml_to_topic_compression(compression_dict)
+        except (AttributeError, TypeError, ValueError) as e:
+            return print_error('Invalid topic compression: {}'.format(e))
+
+        topic_groups = []
+        if args.topic_groups_path:
+            try:
+                topic_groups = convert_yaml_to_topic_groups(
+                    yaml.safe_load(args.topic_groups_path) or {})
+            except (AttributeError, TypeError, ValueError) as e:
+                return print_error('Invalid topic groups: {}'.format(e))
+
         create_bag_directory(uri)
 
-        if args.all:
+        if args.all or args.regex:
             # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
             #               combined with constrained environments (as imposed by colcon test)
             #               may result in DLL loading failures when attempting to import a C
@@ -118,6 +641,13 @@ class RecordVerb(VerbExtension):
             #               level but on demand, right before first use.
             from rosbag2_transport import rosbag2_transport_py
 
+            rosbag2_transport_py.configure_threads(
+                size=args.background_threads, cpu_affinity=args.background_cpus,
+                nice=args.background_nice)
+            rosbag2_transport_py.set_memory_budget(max_bytes=args.memory_budget)
+            rosbag2_transport_py.configure_memory_arena(
+                size=args.huge_page_arena, explicit_huge_pages=args.explicit_huge_pages,
+                numa_node=args.huge_page_numa_node)
             rosbag2_transport_py.record(
                 uri=uri,
                 storage_id=args.storage,
@@ -131,7 +661,67 @@ class RecordVerb(VerbExtension):
                 max_bagfile_size=args.max_bag_size,
                 max_cache_size=args.max_cache_size,
                 include_hidden_topics=args.include_hidden_topics,
-                qos_profile_overrides=qos_profile_overrides)
+                qos_profile_overrides=qos_profile_overrides,
+                storage_preset_profile=args.storage_preset_profile,
+                defer_index_creation=args.defer_index_creation,
+                transaction_max_messages=args.transaction_max_messages,
+                transaction_max_bytes=args.transaction_max_bytes,
+                transaction_max_duration=args.transaction_max_duration,
+                max_cache_size_bytes=args.max_cache_size_bytes,
+                max_bagfile_duration=args.max_bag_duration,
+                max_bagfile_messages=args.max_bag_messages,
+                precreate_next_bagfile=args.precreate_next_bagfile,
+                retention_max_bytes=args.retention_max_size,
+                retention_max_age=args.retention_max_age,
+                staging_directory=args.staging_directory,
+                migration_max_bytes_per_second=args.migration_rate,
+                topic_timestamp_index=args.topic_timestamp_index,
+                cluster_messages_by_topic=args.cluster_messages_by_topic,
+                checksums=args.checksums,
+                large_message_threshold=args.large_message_threshold,
+                deduplicate_topics=args.deduplicate_topics,
+                delta_encode_topics=args.delta_encode_topics,
+                delta_keyframe_interval=args.delta_keyframe_interval,
+                reorder_window_ms=args.reorder_window,
+                preallocate_bagfiles=args.preallocate_bagfiles,
+                writeback_interval_bytes=args.writeback_interval,
+                encryption_format='aes_gcm' if args.encryption_key_file else '',
+                encryption_key_file=args.encryption_key_file,
+                compression_threads=args.compression_threads,
+                compression_queue_size=args.compression_queue_size,
+                compression_level=args.compression_level,
+                compression_worker_threads=args.compression_worker_threads,
+                dictionary_training_messages=args.compression_dictionary_training_messages,
+                compression_dictionary=args.compression_dictionary,
+                chunk_max_bytes=args.compression_chunk_size,
+                chunk_max_duration_ms=args.compression_chunk_duration,
+                adaptive_compression_level=args.adaptive_compression_level,
+                compression_level_min=args.compression_level_min,
+                compression_level_max=args.compression_level_max,
+                topic_compression=topic_compression,
+                compression_sample_messages=args.compression_sample_messages,
+                compression_resample_interval=args.compression_resample_interval,
+                incompressible_ratio=args.incompressible_ratio,
+                recorder_threads=args.recorder_threads,
+                snapshot_mode=args.snapshot_mode,
+                snapshot_max_bytes=args.snapshot_max_bytes,
+                snapshot_duration=args.snapshot_duration,
+                topic_throttles=topic_throttles,
+                thread_scheduling=thread_scheduling,
+                transforms=transforms,
+                regex=args.regex,
+                exclude=args.exclude,
+                statistics_interval_ms=args.statistics_interval,
+                stripe_directories=[os.path.abspath(d) for d in args.stripe_directories],
+                striping_policy=args.striping_policy,
+                shards=args.shards,
+                topic_groups=topic_groups,
+                metadata_checkpoint_interval_ms=args.metadata_checkpoint_interval,
+                write_latency_budget_ms=args.write_latency_budget,
+                bag_id=args.bag_id,
+                clock_offset_ns=args.clock_offset,
+                stream_address=args.stream_to,
+                stream_max_memory_bytes=args.stream_max_memory)
         elif args.topics and len(args.topics) > 0:
             # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
             #               combined with constrained environments (as imposed by colcon test)
@@ -140,6 +730,13 @@ class RecordVerb(VerbExtension):
             #               level but on demand, right before first use.
             from rosbag2_transport import rosbag2_transport_py
 
+            rosbag2_transport_py.configure_threads(
+                size=args.background_threads, cpu_affinity=args.background_cpus,
+                nice=args.background_nice)
+            rosbag2_transport_py.set_memory_budget(max_bytes=args.memory_budget)
+            rosbag2_transport_py.configure_memory_arena(
+                size=args.huge_page_arena, explicit_huge_pages=args.explicit_huge_pages,
+                numa_node=args.huge_page_numa_node)
             rosbag2_transport_py.record(
                 uri=uri,
                 storage_id=args.storage,
@@ -153,7 +750,67 @@ class RecordVerb(VerbExtension):
                 max_cache_size=args.max_cache_size,
                 topics=args.topics,
                 include_hidden_topics=args.include_hidden_topics,
-                qos_profile_overrides=qos_profile_overrides)
+                qos_profile_overrides=qos_profile_overrides,
+                storage_preset_profile=args.storage_preset_profile,
+                defer_index_creation=args.defer_index_creation,
+                transaction_max_messages=args.transaction_max_messages,
+                transaction_max_bytes=args.transaction_max_bytes,
+                transaction_max_duration=args.transaction_max_duration,
+                max_cache_size_bytes=args.max_cache_size_bytes,
+                max_bagfile_duration=args.max_bag_duration,
+                max_bagfile_messages=args.max_bag_messages,
+                precreate_next_bagfile=args.precreate_next_bagfile,
+                retention_max_bytes=args.retention_max_size,
+                retention_max_age=args.retention_max_age,
+                staging_directory=args.staging_directory,
+                migration_max_bytes_per_second=args.migration_rate,
+                topic_timestamp_index=args.topic_timestamp_index,
+                cluster_messages_by_topic=args.cluster_messages_by_topic,
+                checksums=args.checksums,
+                large_message_threshold=args.large_message_threshold,
+                deduplicate_topics=args.deduplicate_topics,
+                delta_encode_topics=args.delta_encode_topics,
+                delta_keyframe_interval=args.delta_keyframe_interval,
+                reorder_window_ms=args.reorder_window,
+                preallocate_bagfiles=args.preallocate_bagfiles,
+                writeback_interval_bytes=args.writeback_interval,
+                encryption_format='aes_gcm' if args.encryption_key_file else '',
+                encryption_key_file=args.encryption_key_file,
+                compression_threads=args.compression_threads,
+                compression_queue_size=args.compression_queue_size,
+                compression_level=args.compression_level,
+                compression_worker_threads=args.compression_worker_threads,
+                dictionary_training_messages=args.compression_dictionary_training_messages,
+                compression_dictionary=args.compression_dictionary,
+                chunk_max_bytes=args.compression_chunk_size,
+                chunk_max_duration_ms=args.compression_chunk_duration,
+                adaptive_compression_level=args.adaptive_compression_level,
+                compression_level_min=args.compression_level_min,
+                compression_level_max=args.compression_level_max,
+                topic_compression=topic_compression,
+                compression_sample_messages=args.compression_sample_messages,
+                compression_resample_interval=args.compression_resample_interval,
+                incompressible_ratio=args.incompressible_ratio,
+                recorder_threads=args.recorder_threads,
+                snapshot_mode=args.snapshot_mode,
+                snapshot_max_bytes=args.snapshot_max_bytes,
+                snapshot_duration=args.snapshot_duration,
+                topic_throttles=topic_throttles,
+                thread_scheduling=thread_scheduling,
+                transforms=transforms,
+                regex=args.regex,
+                exclude=args.exclude,
+                statistics_interval_ms=args.statistics_interval,
+                stripe_directories=[os.path.abspath(d) for d in args.stripe_directories],
+                striping_policy=args.striping_policy,
+                shards=args.shards,
+                topic_groups=topic_groups,
+                metadata_checkpoint_interval_ms=args.metadata_checkpoint_interval,
+                write_latency_budget_ms=args.write_latency_budget,
+                bag_id=args.bag_id,
+                clock_offset_ns=args.clock_offset,
+                stream_address=args.stream_to,
+                stream_max_memory_bytes=args.stream_max_memory)
         else:
             self._subparser.print_help()
 
@@ -0,0 +1,55 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+from ros2bag.api import find_bag_files
+from ros2bag.api import print_error
+from ros2bag.verb import VerbExtension
+
+
+class ReindexVerb(VerbExtension):
+    """ros2 bag reindex."""
+
+    def add_arguments(self, parser, cli_name):  # noqa: D102
+        parser.add_argument(
+            'bag_file', help='bag directory whose metadata is rebuilt from its bagfiles')
+        parser.add_argument(
+            '-s', '--storage', default='',
+            help='storage identifier of the bagfiles. Defaults to the storage of the existing '
+                 'metadata, required if there is none.')
+        parser.add_argument(
+            '-j', '--threads', type=int, default=0,
+            help='maximum number of bagfiles summarized in parallel. '
+                 'Default is 0, which uses one thread per processor.')
+
+    def main(self, *, args):  # noqa: D102
+        bag_file = args.bag_file
+        if not os.path.isdir(bag_file):
+            return print_error("Bag directory '{}' does not exist!".format(bag_file))
+        if args.threads < 0:
+            return print_error('Invalid choice: The number of threads must not be negative.')
+        # NOTE(hidmic): in merged install workspaces on Windows, Python entrypoint lookups
+        #               combined with constrained environments (as imposed by colcon test)
+        #               may result in DLL loading failures when attempting to import a C
+        #               extension. Therefore, do not import rosbag2_transport at the module
+        #               level but on demand, right before first use.
+        from rosbag2_transport import rosbag2_transport_py
+        try:
+            message_count = rosbag2_transport_py.reindex(
+                uri=bag_file, storage_id=args.storage,
+                relative_file_paths=find_bag_files(bag_file), max_threads=args.threads)
+        except RuntimeError as e:
+            return print_error(str(e))
+        print("Reindexed '{}' with {} messages.".format(bag_file, message_count))
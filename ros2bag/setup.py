@@ -38,9 +38,17 @@ The package provides the rosbag command for the ROS 2 command line tools.""",
             'ros2bag.verb = ros2bag.verb:VerbExtension',
         ],
         'ros2bag.verb': [
+            'convert = ros2bag.verb.convert:ConvertVerb',
+            'dataset = ros2bag.verb.dataset:DatasetVerb',
+            'export = ros2bag.verb.export:ExportVerb',
+            'finalize = ros2bag.verb.finalize:FinalizeVerb',
+            'generate = ros2bag.verb.generate:GenerateVerb',
             'info = ros2bag.verb.info:InfoVerb',
             'play = ros2bag.verb.play:PlayVerb',
             'record = ros2bag.verb.record:RecordVerb',
+            'reindex = ros2bag.verb.reindex:ReindexVerb',
+            'slice = ros2bag.verb.slice:SliceVerb',
+            'verify = ros2bag.verb.verify:VerifyVerb',
         ],
     }
 )
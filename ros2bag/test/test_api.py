@@ -12,13 +12,19 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import os
+import tempfile
 import unittest
 
 from rclpy.qos import QoSDurabilityPolicy
 from rclpy.qos import QoSHistoryPolicy
 from rclpy.qos import QoSReliabilityPolicy
 from ros2bag.api import convert_yaml_to_qos_profile
+from ros2bag.api import convert_yaml_to_topic_compression
+from ros2bag.api import convert_yaml_to_topic_groups
+from ros2bag.api import convert_yaml_to_topic_throttles
 from ros2bag.api import dict_to_duration
+from ros2bag.api import find_bag_files
 from ros2bag.api import interpret_dict_as_qos_profile
 
 
@@ -74,3 +80,50 @@ class TestRos2BagRecord(unittest.TestCase):
         assert qos_profiles[topic_name_2].avoid_ros_namespace_conventions == expected_convention
         assert qos_profiles[topic_name_2].history == \
             QoSHistoryPolicy.RMW_QOS_POLICY_HISTORY_KEEP_ALL
+
+    def test_convert_yaml_to_topic_throttles(self):
+        throttle_dict = {'/image': {'decimation': 5}, '/scan': {'max_frequency': 2}}
+        topic_throttles = convert_yaml_to_topic_throttles(throttle_dict)
+        assert topic_throttles == {'/image': (5, 0.0), '/scan': (1, 2.0)}
+
+    def test_convert_yaml_to_topic_throttles_invalid(self):
+        with self.assertRaises(ValueError):
+            convert_yaml_to_topic_throttles({'/image': {'rate': 5}})
+        with self.assertRaises(ValueError):
+            convert_yaml_to_topic_throttles({'/image': {'decimation': 0}})
+
+    def test_convert_yaml_to_topic_compression(self):
+        compression_dict = {
+            'sensor_msgs/msg/CompressedImage': {'format': 'none'},
+            '/points': {'format': 'lz4', 'level': -2}, '/scan': {'level': 9}}
+        topic_compression = convert_yaml_to_topic_compression(compression_dict)
+        assert topic_compression == {
+            'sensor_msgs/msg/CompressedImage': ('none', None), '/points': ('lz4', -2),
+            '/scan': ('', 9)}
+
+    def test_convert_yaml_to_topic_compression_invalid(self):
+        with self.assertRaises(ValueError):
+            convert_yaml_to_topic_compression({'/points': {'mode': 'message'}})
+        with self.assertRaises(ValueError):
+            convert_yaml_to_topic_compression({'/points': {'format': 'gzip'}})
+
+    def test_convert_yaml_to_topic_groups(self):
+        group_dict = {'camera': {'topics': '/camera/.*'}, 'large': {'min_message_size': 4096}}
+        topic_groups = convert_yaml_to_topic_groups(group_dict)
+        assert topic_groups == [('camera', '/camera/.*', 0), ('large', '', 4096)]
+
+    def test_convert_yaml_to_topic_groups_invalid(self):
+        with self.assertRaises(ValueError):
+            convert_yaml_to_topic_groups({'camera': {'regex': '/camera/.*'}})
+        with self.assertRaises(ValueError):
+            convert_yaml_to_topic_groups({'large': {'min_message_size': -1}})
+
+    def test_find_bag_files(self):
+        with tempfile.TemporaryDirectory() as temporary_directory:
+            bag_directory = os.path.join(temporary_directory, 'bag')
+            os.makedirs(os.path.join(bag_directory, 'camera'))
+            for path in ['bag_10.db3', 'bag_2.db3', 'bag_2.db3-wal', 'metadata.yaml',
+                         os.path.join('camera', 'camera_0.db3'), os.path.join('camera', 'bag_1')]:
+                open(os.path.join(bag_directory, path), 'w').close()
+            assert find_bag_files(bag_directory) == [
+                'bag_2.db3', 'bag_10.db3', os.path.join('camera', 'camera_0.db3')]
@@ -0,0 +1,92 @@
+# Copyright 2020 Amazon.com, Inc. or its affiliates. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import tempfile
+import unittest
+
+from rosbag2_transport import rosbag2_transport_py
+
+
+class TestReaderWriter(unittest.TestCase):
+
+    def setUp(self):
+        self.temp_dir = tempfile.TemporaryDirectory()
+        self.uri = os.path.join(self.temp_dir.name, 'bag')
+        with rosbag2_transport_py.Writer(self.uri, storage_id='sqlite3') as writer:
+            writer.create_topic('/a', 'std_msgs/msg/ByteMultiArray')
+            writer.create_topic('/b', 'std_msgs/msg/ByteMultiArray')
+            writer.write_batch(
+                rosbag2_transport_py.BagMessage('/a' if i % 2 == 0 else '/b', i, bytes([i] * 4))
+                for i in range(100))
+
+    def tearDown(self):
+        self.temp_dir.cleanup()
+
+    def test_reads_the_messages_written(self):
+        with rosbag2_transport_py.Reader(self.uri, storage_id='sqlite3') as reader:
+            topics = sorted(reader.get_all_topics_and_types())
+            assert topics == [
+                ('/a', 'std_msgs/msg/ByteMultiArray', 'cdr'),
+                ('/b', 'std_msgs/msg/ByteMultiArray', 'cdr')]
+            messages = list(reader)
+        assert [message.time_stamp for message in messages] == list(range(100))
+        assert messages[1].topic_name == '/b'
+        assert bytes(messages[3]) == bytes([3] * 4)
+
+    def test_exposes_the_data_without_copying_it(self):
+        with rosbag2_transport_py.Reader(self.uri, storage_id='sqlite3') as reader:
+            message = reader.read_next()
+        view = memoryview(message)
+        assert view.readonly
+        assert view.nbytes == 4
+        # The view keeps the message alive.
+        del message
+        assert view.tobytes() == bytes(4)
+
+    def test_refuses_to_reinitialize_messages_with_exported_data(self):
+        message = rosbag2_transport_py.BagMessage('/a', 1, bytes(4))
+        view = memoryview(message)
+        with self.assertRaises(BufferError):
+            message.__init__('/b', 2, bytes(8))
+        assert view.tobytes() == bytes(4)
+        view.release()
+        message.__init__('/b', 2, bytes(8))
+        assert message.topic_name == '/b'
+        assert bytes(message) == bytes(8)
+
+    def test_reads_batches_of_filtered_topics(self):
+        with rosbag2_transport_py.Reader(self.uri, storage_id='sqlite3') as reader:
+            reader.set_filter(['/b'])
+            batch = reader.read_next_batch(max_messages=10)
+            assert len(batch) == 10
+            assert all(message.topic_name == '/b' for message in batch)
+            reader.seek(90)
+            assert [message.time_stamp for message in reader] == [91, 93, 95, 97, 99]
+            assert reader.read_next_batch() == []
+
+    def test_filters_topics_by_regex_and_type(self):
+        with rosbag2_transport_py.Reader(self.uri, storage_id='sqlite3') as reader:
+            reader.set_filter(topics_regex='/[b-z]', topic_types=['std_msgs/msg/ByteMultiArray'])
+            assert {message.topic_name for message in reader} == {'/b'}
+            reader.set_filter(topic_types=['std_msgs/msg/String'])
+            assert reader.read_next_batch() == []
+
+    def test_raises_on_closed_readers_and_missing_bags(self):
+        reader = rosbag2_transport_py.Reader(self.uri, storage_id='sqlite3')
+        reader.close()
+        with self.assertRaises(RuntimeError):
+            reader.has_next()
+        with self.assertRaises(RuntimeError):
+            rosbag2_transport_py.Reader(os.path.join(self.temp_dir.name, 'missing'))
@@ -0,0 +1,69 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__AES_GCM_DECRYPTOR_HPP_
+#define ROSBAG2_COMPRESSION__AES_GCM_DECRYPTOR_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/base_decryptor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+class AesGcmCipher;
+
+/**
+ * A BaseDecryptorInterface decrypting the messages encrypted by AesGcmEncryptor.
+ * Every instance keeps a cipher context, so it may only be used by one thread at a time.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC AesGcmDecryptor : public BaseDecryptorInterface
+{
+public:
+  /**
+   * \param key The 32 byte key of the bag.
+   * \throws std::invalid_argument if the key does not have 32 bytes.
+   */
+  explicit AesGcmDecryptor(const std::vector<uint8_t> & key);
+
+  ~AesGcmDecryptor() override;
+
+  void decrypt_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  std::string get_decryption_identifier() const override;
+
+private:
+  std::unique_ptr<AesGcmCipher> cipher_;
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__AES_GCM_DECRYPTOR_HPP_
@@ -0,0 +1,77 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__AES_GCM_ENCRYPTOR_HPP_
+#define ROSBAG2_COMPRESSION__AES_GCM_ENCRYPTOR_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/base_encryptor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+class AesGcmCipher;
+
+/**
+ * A BaseEncryptorInterface encrypting messages with AES-256-GCM, which authenticates the data,
+ * the topic name and the time stamp of the message along with encrypting it.
+ *
+ * The nonce and the tag are stored after the encrypted data, which grows by 28 bytes.
+ * Nonces are a random prefix per instance followed by a counter, so they are never reused as
+ * long as the key is only used by instances of a single bag.
+ * Every instance keeps a cipher context, so it may only be used by one thread at a time.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC AesGcmEncryptor : public BaseEncryptorInterface
+{
+public:
+  /**
+   * \param key The 32 byte key of the bag.
+   * \throws std::invalid_argument if the key does not have 32 bytes.
+   */
+  explicit AesGcmEncryptor(const std::vector<uint8_t> & key);
+
+  ~AesGcmEncryptor() override;
+
+  void encrypt_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  std::string get_encryption_identifier() const override;
+
+private:
+  std::unique_ptr<AesGcmCipher> cipher_;
+  std::array<uint8_t, 4> nonce_prefix_{};
+  uint64_t nonce_counter_{0};
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__AES_GCM_ENCRYPTOR_HPP_
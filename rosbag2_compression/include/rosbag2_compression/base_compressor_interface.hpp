@@ -15,10 +15,16 @@
 #ifndef ROSBAG2_COMPRESSION__BASE_COMPRESSOR_INTERFACE_HPP_
 #define ROSBAG2_COMPRESSION__BASE_COMPRESSOR_INTERFACE_HPP_
 
+#include <exception>
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
 
+#include "compression_options.hpp"
 #include "visibility_control.hpp"
 
 namespace rosbag2_compression
@@ -69,6 +75,114 @@ public:
    * This is appended to the extension of the compressed file.
    */
   virtual std::string get_compression_identifier() const = 0;
+
+  /**
+   * Applies the compression level and number of worker threads of the compression options to
+   * all following compressions. Compressors which cannot be tuned ignore them.
+   *
+   * \param compression_options The options of the writer using the compressor.
+   * \throws std::invalid_argument if the options are not supported by the compressor.
+   */
+  virtual void set_compression_options(const CompressionOptions & compression_options)
+  {
+    (void) compression_options;
+  }
+
+  /**
+   * Announces a topic whose messages are going to be compressed, so that compressors adapting to
+   * the data, e.g. by training dictionaries, can tell messages of different types apart.
+   *
+   * \param topic The name and type of the topic.
+   */
+  virtual void register_topic(const rosbag2_storage::TopicMetadata & topic)
+  {
+    (void) topic;
+  }
+
+  /**
+   * Checks if a message may be written without compressing it in MESSAGE mode, e.g. because it
+   * barely compresses. This requires the decompressor to tell such messages apart from the
+   * compressed ones with BaseDecompressorInterface::is_compressed_message, which is why
+   * messages are always compressed unless implemented.
+   *
+   * \param bag_message An uncompressed serialized bag message.
+   * \return True if the decompressor recognizes the message as not compressed.
+   */
+  virtual bool can_store_uncompressed(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const
+  {
+    (void) bag_message;
+    return false;
+  }
+
+  /**
+   * Writes the dictionaries which were used for compressing messages into a directory.
+   * They are needed by BaseDecompressorInterface::load_dictionaries to decompress the messages.
+   *
+   * \param directory The directory of the bag.
+   * \return The paths of the written files.
+   * \throws std::runtime_error if a file could not be written.
+   */
+  virtual std::vector<std::string> write_dictionaries(const std::string & directory)
+  {
+    (void) directory;
+    return {};
+  }
+
+  /**
+   * Checks if the compressor stores the messages of a topic as deltas to the previous message of
+   * the topic, in the format of rosbag2_cpp::writers::MessageDeltaEncoder, e.g. to compress a
+   * stream of images as video. Readers decode the messages of such topics after decompressing
+   * them, so the writer marks them as delta encoded in the metadata.
+   *
+   * \param topic_name The name of a topic registered with register_topic.
+   */
+  virtual bool is_delta_encoded(const std::string & topic_name) const
+  {
+    (void) topic_name;
+    return false;
+  }
+
+  /**
+   * Stores the next message of every topic delta encoded by the compressor as a keyframe. The
+   * writer calls it whenever it starts a new file, as readers only decode deltas from messages of
+   * the same file.
+   */
+  virtual void reset_deltas() {}
+
+  /**
+   * Checks if the compressor works asynchronously, e.g. by offloading the compression to a GPU or
+   * an accelerator card. The writer then submits the chunks of CHUNK mode with
+   * compress_serialized_bag_messages_async and keeps recording while they are compressed.
+   */
+  virtual bool is_asynchronous() const
+  {
+    return false;
+  }
+
+  /**
+   * Starts compressing the serialized_data of a batch of serialized bag messages in place.
+   * The messages must not be accessed until the returned future is ready. Unless implemented,
+   * the messages are compressed synchronously with compress_serialized_bag_message.
+   *
+   * \param bag_messages Serialized bag messages.
+   * \return A future which is ready once all messages are compressed, and which holds the
+   * exception of a failed compression.
+   */
+  virtual std::future<void> compress_serialized_bag_messages_async(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> bag_messages)
+  {
+    std::promise<void> compressed;
+    try {
+      for (const auto & bag_message : bag_messages) {
+        compress_serialized_bag_message(bag_message.get());
+      }
+      compressed.set_value();
+    } catch (...) {
+      compressed.set_exception(std::current_exception());
+    }
+    return compressed.get_future();
+  }
 };
 
 }  // namespace rosbag2_compression
@@ -17,6 +17,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "rosbag2_storage/serialized_bag_message.hpp"
 
@@ -58,6 +59,23 @@ public:
    */
   virtual std::string decompress_uri(const std::string & uri) = 0;
 
+  /**
+   * Decompress a file on disk into another directory, e.g. a tmpfs directory to keep the
+   * decompressed file in memory, or a scratch directory if the bag is on a read-only file system.
+   * Decompresses next to the compressed file unless implemented.
+   *
+   * \param uri Input file to decompress with file extension.
+   * \param directory Existing directory to write the decompressed file to. If empty, the file is
+   *   decompressed next to the compressed file.
+   * \return The path to the decompressed file.
+   */
+  virtual std::string decompress_uri_to_directory(
+    const std::string & uri, const std::string & directory)
+  {
+    (void) directory;
+    return decompress_uri(uri);
+  }
+
   /**
    * Decompress the serialized_data of a serialized bag message in place.
    *
@@ -71,6 +89,46 @@ public:
    * compressed file.
    */
   virtual std::string get_decompression_identifier() const = 0;
+
+  /**
+   * Checks if a message read in MESSAGE mode was compressed, since the writer may write messages
+   * which barely compress without compressing them, see
+   * BaseCompressorInterface::can_store_uncompressed.
+   *
+   * \param bag_message A serialized bag message read from the storage.
+   * \return True if the message needs to be decompressed.
+   */
+  virtual bool is_compressed_message(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const
+  {
+    (void) bag_message;
+    return true;
+  }
+
+  /**
+   * Loads the dictionaries written by BaseCompressorInterface::write_dictionaries, which are
+   * needed to decompress the messages compressed with them.
+   *
+   * \param uris The paths of the dictionary files.
+   * \throws std::runtime_error if a file could not be read.
+   */
+  virtual void load_dictionaries(const std::vector<std::string> & uris)
+  {
+    (void) uris;
+  }
+
+  /**
+   * Shares the dictionaries another decompressor of the same bag loaded, so that the dictionary
+   * files are not read again for every decompressor.
+   *
+   * \param other A decompressor the dictionaries were loaded into.
+   * \return False if the dictionaries cannot be shared, so they need to be loaded.
+   */
+  virtual bool share_dictionaries(const BaseDecompressorInterface & other)
+  {
+    (void) other;
+    return false;
+  }
 };
 
 }  // namespace rosbag2_compression
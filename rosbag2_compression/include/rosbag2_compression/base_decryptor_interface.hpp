@@ -0,0 +1,63 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__BASE_DECRYPTOR_INTERFACE_HPP_
+#define ROSBAG2_COMPRESSION__BASE_DECRYPTOR_INTERFACE_HPP_
+
+#include <string>
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "visibility_control.hpp"
+
+namespace rosbag2_compression
+{
+
+/**
+ * An interface for developers adding a new decryption algorithm to rosbag2.
+ * Readers decrypt every message or chunk of an encrypted bag before decompressing it.
+ * A corresponding encryptor with an identical encryption format must also be implemented.
+ *
+ * Example message decryption usage:
+ *
+ * MyDecryptor my_decryptor(key);
+ * std::shared_ptr<SerializedBagMessage> bag_message = storage.read_next();
+ * my_decryptor.decrypt_serialized_bag_message(bag_message.get());
+ * my_decompressor.decompress_serialized_bag_message(bag_message.get());
+ */
+class ROSBAG2_COMPRESSION_PUBLIC BaseDecryptorInterface
+{
+public:
+  virtual ~BaseDecryptorInterface() = default;
+
+  /**
+   * Decrypt the serialized_data of a serialized bag message into a new buffer, which replaces
+   * it, so the encrypted data may be shared with other messages or mapped from a file.
+   *
+   * \param[in,out] bag_message A serialized bag message.
+   * \throws std::runtime_error if the message was not encrypted with the key of the decryptor,
+   *   or was changed after it was encrypted.
+   */
+  virtual void decrypt_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) = 0;
+
+  /**
+   * Get the identifier of the encryption algorithm, which is stored in the metadata.
+   */
+  virtual std::string get_decryption_identifier() const = 0;
+};
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__BASE_DECRYPTOR_INTERFACE_HPP_
@@ -0,0 +1,64 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__BASE_ENCRYPTOR_INTERFACE_HPP_
+#define ROSBAG2_COMPRESSION__BASE_ENCRYPTOR_INTERFACE_HPP_
+
+#include <string>
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "visibility_control.hpp"
+
+namespace rosbag2_compression
+{
+
+/**
+ * An interface for developers adding a new encryption algorithm to rosbag2.
+ * Writers compressing by message or by chunk encrypt every message or chunk after compressing it,
+ * so the data is encrypted as it is written and never stored in the clear.
+ * A corresponding decryptor with an identical encryption format must also be implemented.
+ *
+ * Example message encryption usage:
+ *
+ * MyEncryptor my_encryptor(key);
+ * std::shared_ptr<SerializedBagMessage> bag_message = std::make_shared<SerializedBagMessage>();
+ * ...fill message
+ * my_compressor.compress_serialized_bag_message(bag_message.get());
+ * my_encryptor.encrypt_serialized_bag_message(bag_message.get());
+ */
+class ROSBAG2_COMPRESSION_PUBLIC BaseEncryptorInterface
+{
+public:
+  virtual ~BaseEncryptorInterface() = default;
+
+  /**
+   * Encrypt the serialized_data of a serialized bag message into a new buffer, which replaces
+   * it. The topic name and time stamp of the message may be authenticated along with the data,
+   * so the message can only be decrypted under the same topic name and time stamp.
+   *
+   * \param[in,out] bag_message A serialized bag message.
+   */
+  virtual void encrypt_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) = 0;
+
+  /**
+   * Get the identifier of the encryption algorithm, which is stored in the metadata.
+   */
+  virtual std::string get_encryption_identifier() const = 0;
+};
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__BASE_ENCRYPTOR_INTERFACE_HPP_
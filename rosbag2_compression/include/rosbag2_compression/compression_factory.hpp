@@ -15,6 +15,7 @@
 #ifndef ROSBAG2_COMPRESSION__COMPRESSION_FACTORY_HPP_
 #define ROSBAG2_COMPRESSION__COMPRESSION_FACTORY_HPP_
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -43,6 +44,11 @@ class CompressionFactoryImpl;
 class ROSBAG2_COMPRESSION_PUBLIC CompressionFactory
 {
 public:
+  using CompressorCreator =
+    std::function<std::unique_ptr<rosbag2_compression::BaseCompressorInterface>()>;
+  using DecompressorCreator =
+    std::function<std::unique_ptr<rosbag2_compression::BaseDecompressorInterface>()>;
+
   CompressionFactory();
   virtual ~CompressionFactory();
 
@@ -66,6 +72,21 @@ public:
   virtual std::unique_ptr<rosbag2_compression::BaseDecompressorInterface>
   create_decompressor(const std::string & compression_format);
 
+  /**
+   * Makes a compression format available to all compression factories of the process, e.g. one
+   * implemented by a library offloading the compression to a GPU or an accelerator card.
+   * Registering a format again replaces its creators.
+   *
+   * \param compression_format The compression format as a string, compared case-insensitively.
+   * \param compressor_creator Creates the compressors of the format.
+   * \param decompressor_creator Creates the decompressors of the format.
+   * \throw invalid_argument If the format is built in or a creator is empty.
+   */
+  static void register_compression_format(
+    const std::string & compression_format,
+    CompressorCreator compressor_creator,
+    DecompressorCreator decompressor_creator);
+
 private:
   std::unique_ptr<CompressionFactoryImpl> impl_;
 };
@@ -15,7 +15,9 @@
 #ifndef ROSBAG2_COMPRESSION__COMPRESSION_OPTIONS_HPP_
 #define ROSBAG2_COMPRESSION__COMPRESSION_OPTIONS_HPP_
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 
 #include "visibility_control.hpp"
 
@@ -23,7 +25,8 @@ namespace rosbag2_compression
 {
 
 /**
- * Modes are used to specify whether to compress by individual serialized bag messages or by file.
+ * Modes are used to specify whether to compress by individual serialized bag messages, by chunks
+ * of messages or by file.
  * rosbag2_cpp defaults to NONE.
  */
 enum class ROSBAG2_COMPRESSION_PUBLIC CompressionMode: uint32_t
@@ -31,14 +34,16 @@ enum class ROSBAG2_COMPRESSION_PUBLIC CompressionMode: uint32_t
   NONE = 0,
   FILE,
   MESSAGE,
-  LAST_MODE = MESSAGE
+  CHUNK,
+  LAST_MODE = CHUNK
 };
 
 /**
  * Converts a string into a rosbag2_compression::CompressionMode enum.
  *
- * \param compression_mode A case insensitive string that is either "FILE" or "MESSAGE".
- * \return CompressionMode NONE if compression_mode is invalid. FILE or MESSAGE otherwise.
+ * \param compression_mode A case insensitive string that is either "FILE", "MESSAGE" or
+ * "CHUNK".
+ * \return CompressionMode NONE if compression_mode is invalid. FILE, MESSAGE or CHUNK otherwise.
  */
 ROSBAG2_COMPRESSION_PUBLIC CompressionMode compression_mode_from_string(
   const std::string & compression_mode);
@@ -51,6 +56,24 @@ ROSBAG2_COMPRESSION_PUBLIC CompressionMode compression_mode_from_string(
  */
 ROSBAG2_COMPRESSION_PUBLIC std::string compression_mode_to_string(CompressionMode compression_mode);
 
+/**
+ * Compression format of a topic whose messages are written uncompressed in MESSAGE mode.
+ */
+constexpr const char kUncompressedTopicFormat[] = "none";
+
+/**
+ * Compression of the messages of a topic in MESSAGE mode, if it differs from the one of the bag.
+ */
+struct TopicCompressionOptions
+{
+  // Format the messages are compressed with, empty for the compression format of the bag, or
+  // kUncompressedTopicFormat to write them uncompressed, e.g. for images compressed already.
+  std::string compression_format = "";
+  // Compression level of the format, if has_compression_level is set, else the level of the bag.
+  bool has_compression_level = false;
+  int compression_level = 0;
+};
+
 /**
  * Compression options used in the writer which are passed down from the CLI in rosbag2_transport.
  */
@@ -58,6 +81,59 @@ struct CompressionOptions
 {
   std::string compression_format;
   CompressionMode compression_mode;
+  // Number of threads compressing closed bagfiles in FILE mode while recording continues.
+  // With 0 threads, bagfiles are compressed by the thread writing the message causing the split.
+  uint64_t compression_threads = 1;
+  // Maximum number of closed bagfiles waiting for a compression thread. Writing blocks while the
+  // limit is reached, which bounds the disk space taken by uncompressed files. 0 means unbounded.
+  uint64_t compression_queue_size = 1;
+  // Compression level of the format. Higher levels compress better and slower. For zstd, 0 selects
+  // zstd's default level of 3 and negative levels trade compression ratio for speed.
+  int compression_level = 1;
+  // Number of threads a compressor may use in addition to the calling thread for compressing a
+  // single file. 0 compresses in the calling thread only.
+  uint64_t compression_worker_threads = 0;
+  // Number of messages per topic type used to train a compression dictionary in MESSAGE mode.
+  // Messages of the type are compressed with the dictionary once it is trained. 0 disables it.
+  uint64_t dictionary_training_messages = 0;
+  // Path of a dictionary compressing the messages of all topics in MESSAGE mode, used instead of
+  // training dictionaries. Empty if none.
+  std::string compression_dictionary = "";
+  // Limits of the serialized size and of the time span of the messages compressed together in
+  // CHUNK mode. 0 disables a limit. Chunks also end when the bagfile is split or closed.
+  uint64_t chunk_max_bytes = 1024 * 1024;
+  uint64_t chunk_max_duration_ms = 0;
+  // If set, the compression level is adapted within [compression_level_min,
+  // compression_level_max] to keep up with the recorded data, starting at compression_level.
+  // It is lowered while closed bagfiles wait for a compression thread in FILE mode, or while
+  // compressing takes more than half of the time in MESSAGE and CHUNK mode, and raised again
+  // when there is no backlog.
+  bool adaptive_compression_level = false;
+  int compression_level_min = 1;
+  int compression_level_max = 9;
+  // Compression of topics in MESSAGE mode which differs from the one of the bag, by topic name or
+  // by topic type, where the name takes precedence. The format of a topic is stored in the
+  // metadata, so the reader only decompresses what needs it. Topics with a format or level of
+  // their own are neither compressed with dictionaries nor at an adaptive level.
+  std::unordered_map<std::string, TopicCompressionOptions> topic_compression{};
+  // Number of messages of a topic after which compressors which delta encode it, e.g. the "video"
+  // format, store one in full, so readers seeking into the bag decode few messages. The writer
+  // passes the delta_keyframe_interval of its storage options.
+  uint64_t keyframe_interval = 100;
+  // Number of messages of a topic sampled in MESSAGE mode to measure how well the topic
+  // compresses, once it is created and again every compression_resample_interval messages.
+  // Topics whose sampled messages compress to at least incompressible_ratio of their size are
+  // written uncompressed until the next sample, if the compression format tells uncompressed
+  // messages apart. 0 disables sampling, and a resample interval of 0 samples only once.
+  uint64_t compression_sample_messages = 0;
+  uint64_t compression_resample_interval = 1000;
+  double incompressible_ratio = 0.95;
+  // Format every message in MESSAGE mode, or every chunk in CHUNK mode, is encrypted with after
+  // it is compressed, e.g. "aes_gcm". Empty if the bag is not encrypted.
+  std::string encryption_format = "";
+  // File holding the master key, 32 bytes or 64 hexadecimal digits. The bag is encrypted with a
+  // random key of its own, which is stored in the metadata encrypted with the master key.
+  std::string encryption_key_file = "";
 };
 
 }  // namespace rosbag2_compression
@@ -0,0 +1,58 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__COMPRESSION_STATISTICS_HPP_
+#define ROSBAG2_COMPRESSION__COMPRESSION_STATISTICS_HPP_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace rosbag2_compression
+{
+
+/**
+ * The latest compression sample of a topic, see CompressionOptions::compression_sample_messages.
+ */
+struct TopicCompressionSample
+{
+  // Compressed size of the sampled messages divided by their uncompressed size.
+  double compression_ratio = 1.0;
+  // Whether the messages of the topic are compressed until the next sample.
+  bool compressed = true;
+  // Number of messages of the topic which were written uncompressed.
+  uint64_t uncompressed_message_count = 0;
+};
+
+/**
+ * Statistics of the compression done by a writer, i.e. of the files compressed in FILE mode,
+ * and of the messages or chunks compressed in MESSAGE or CHUNK mode.
+ */
+struct CompressionStatistics
+{
+  uint64_t compression_count = 0;
+  uint64_t uncompressed_bytes = 0;
+  uint64_t compressed_bytes = 0;
+  // Number of compressions done at each compression level, which only differ with
+  // CompressionOptions::adaptive_compression_level.
+  std::map<int, uint64_t> compression_count_by_level{};
+  // Level the next compression is done at.
+  int current_compression_level = 0;
+  // Latest compression sample of each sampled topic in MESSAGE mode.
+  std::map<std::string, TopicCompressionSample> topic_samples{};
+};
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__COMPRESSION_STATISTICS_HPP_
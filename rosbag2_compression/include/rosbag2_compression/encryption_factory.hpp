@@ -0,0 +1,65 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__ENCRYPTION_FACTORY_HPP_
+#define ROSBAG2_COMPRESSION__ENCRYPTION_FACTORY_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base_decryptor_interface.hpp"
+#include "base_encryptor_interface.hpp"
+#include "visibility_control.hpp"
+
+namespace rosbag2_compression
+{
+
+/**
+ * Creates the encryptors and decryptors of the encryption formats, in the same way as
+ * CompressionFactory does for compression formats.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC EncryptionFactory
+{
+public:
+  EncryptionFactory() = default;
+  virtual ~EncryptionFactory() = default;
+
+  /**
+   * Create an encryptor based on the specified encryption format.
+   *
+   * \param encryption_format The encryption format as a string.
+   * \param key The key of the bag.
+   * \return A unique pointer to the newly created encryptor.
+   * \throw invalid_argument If the encryption format does not exist or the key does not fit it.
+   */
+  virtual std::unique_ptr<rosbag2_compression::BaseEncryptorInterface>
+  create_encryptor(const std::string & encryption_format, const std::vector<uint8_t> & key);
+
+  /**
+   * Create a decryptor based on the specified encryption format.
+   *
+   * \param encryption_format The encryption format as a string.
+   * \param key The key of the bag.
+   * \return A unique pointer to the newly created decryptor.
+   * \throw invalid_argument If the encryption format does not exist or the key does not fit it.
+   */
+  virtual std::unique_ptr<rosbag2_compression::BaseDecryptorInterface>
+  create_decryptor(const std::string & encryption_format, const std::vector<uint8_t> & key);
+};
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__ENCRYPTION_FACTORY_HPP_
@@ -0,0 +1,69 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__ENCRYPTION_KEYS_HPP_
+#define ROSBAG2_COMPRESSION__ENCRYPTION_KEYS_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "visibility_control.hpp"
+
+namespace rosbag2_compression
+{
+
+// Every encrypted bag has a random key of its own, which is stored in its metadata encrypted with
+// a master key the user keeps, along with the id of the master key. So the master key is never
+// stored with the bag, and a leaked bag key does not reveal other bags.
+
+/**
+ * Reads a master key from a file holding either its 32 bytes or 64 hexadecimal digits.
+ *
+ * \throws std::runtime_error if the file cannot be read or does not hold a key.
+ */
+ROSBAG2_COMPRESSION_PUBLIC std::vector<uint8_t> read_encryption_key_file(const std::string & path);
+
+/**
+ * Generates a random 32 byte key for a bag from the random number generator of the system.
+ *
+ * \throws std::runtime_error if no random bytes could be generated.
+ */
+ROSBAG2_COMPRESSION_PUBLIC std::vector<uint8_t> generate_encryption_key();
+
+/**
+ * Id of a key stored in the metadata, which tells which master key a bag was encrypted with
+ * without revealing the key: the first 8 bytes of its SHA-256 hash in hexadecimal.
+ */
+ROSBAG2_COMPRESSION_PUBLIC std::string get_encryption_key_id(const std::vector<uint8_t> & key);
+
+/**
+ * Encrypts the key of a bag with a master key using AES-256-GCM.
+ *
+ * \return The encrypted key in hexadecimal.
+ */
+ROSBAG2_COMPRESSION_PUBLIC std::string encrypt_key(
+  const std::vector<uint8_t> & key, const std::vector<uint8_t> & master_key);
+
+/**
+ * Decrypts the key of a bag encrypted by encrypt_key().
+ *
+ * \throws std::runtime_error if the key was not encrypted with the master key.
+ */
+ROSBAG2_COMPRESSION_PUBLIC std::vector<uint8_t> decrypt_key(
+  const std::string & encrypted_key, const std::vector<uint8_t> & master_key);
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__ENCRYPTION_KEYS_HPP_
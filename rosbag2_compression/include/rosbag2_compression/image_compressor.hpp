@@ -0,0 +1,83 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__IMAGE_COMPRESSOR_HPP_
+#define ROSBAG2_COMPRESSION__IMAGE_COMPRESSOR_HPP_
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "rosbag2_compression/base_compressor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+#include "rosbag2_compression/zstd_compressor.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+/**
+ * A BaseCompressorInterface for topics of raw images, selected with the "image" compression
+ * format, e.g. for the sensor_msgs/msg/Image topic type in MESSAGE mode.
+ *
+ * The pixel rows of sensor_msgs/msg/Image messages are replaced by their difference to the
+ * previous row before the message is compressed with ZStandard, which compresses smooth images
+ * considerably better than ZStandard alone. The filter works on the bytes of the rows, so it is
+ * lossless for every image encoding, and ImageDecompressor restores the serialized message
+ * bit-exactly. Messages of other topic types, and files, are compressed with ZStandard alone.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC ImageCompressor : public BaseCompressorInterface
+{
+public:
+  ImageCompressor() = default;
+
+  ~ImageCompressor() override = default;
+
+  std::string compress_uri(const std::string & uri) override;
+
+  void compress_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  std::string get_compression_identifier() const override;
+
+  bool can_store_uncompressed(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const override;
+
+  /// Applies the options to the ZStandard compression, see ZstdCompressor.
+  void set_compression_options(const CompressionOptions & compression_options) override;
+
+  /// Remembers the topics of type sensor_msgs/msg/Image, whose messages are filtered.
+  void register_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  std::vector<std::string> write_dictionaries(const std::string & directory) override;
+
+private:
+  ZstdCompressor zstd_compressor_{};
+  std::unordered_set<std::string> image_topics_{};
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__IMAGE_COMPRESSOR_HPP_
@@ -0,0 +1,62 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__IMAGE_DECOMPRESSOR_HPP_
+#define ROSBAG2_COMPRESSION__IMAGE_DECOMPRESSOR_HPP_
+
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/base_decompressor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+#include "rosbag2_compression/zstd_decompressor.hpp"
+
+namespace rosbag2_compression
+{
+
+/**
+ * A BaseDecompressorInterface for the messages and files compressed by ImageCompressor.
+ * The pixel rows filtered by the compressor are restored after the ZStandard decompression.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC ImageDecompressor : public BaseDecompressorInterface
+{
+public:
+  ImageDecompressor() = default;
+
+  ~ImageDecompressor() override = default;
+
+  std::string decompress_uri(const std::string & uri) override;
+
+  std::string decompress_uri_to_directory(
+    const std::string & uri, const std::string & directory) override;
+
+  void decompress_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  std::string get_decompression_identifier() const override;
+
+  bool is_compressed_message(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const override;
+
+  void load_dictionaries(const std::vector<std::string> & uris) override;
+
+  bool share_dictionaries(const BaseDecompressorInterface & other) override;
+
+private:
+  ZstdDecompressor zstd_decompressor_{};
+};
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__IMAGE_DECOMPRESSOR_HPP_
@@ -0,0 +1,93 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__LZ4_COMPRESSOR_HPP_
+#define ROSBAG2_COMPRESSION__LZ4_COMPRESSOR_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/base_compressor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+
+// Declared by lz4frame.h, which is only included by the implementation.
+struct LZ4F_cctx_s;
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+/**
+ * A BaseCompressorInterface that is used to compress bagfiles and messages into LZ4 frames.
+ *
+ * LZ4 compresses several times faster than ZStandard at a lower compression ratio, which suits
+ * recording at high data rates. The high compression variant (LZ4-HC) compresses slower at a
+ * better ratio, and is decompressed just as fast.
+ *
+ * Lz4Compressor should only be initialized by Writer.
+ * Every instance keeps a compression context and buffer, which are reused for all messages.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC Lz4Compressor : public BaseCompressorInterface
+{
+public:
+  explicit Lz4Compressor(bool high_compression = false);
+
+  ~Lz4Compressor() = default;
+
+  Lz4Compressor(Lz4Compressor &&) = default;
+  Lz4Compressor & operator=(Lz4Compressor &&) = default;
+
+  std::string compress_uri(const std::string & uri) override;
+
+  void compress_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  /// "lz4" or "lz4hc" for the high compression variant.
+  std::string get_compression_identifier() const override;
+
+  bool can_store_uncompressed(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const override;
+
+  /**
+   * Negative compression levels select faster compression for LZ4, other levels select its
+   * default. For LZ4-HC, levels are clamped to the supported range, and levels below it select
+   * its default.
+   * Compression worker threads and dictionaries are not supported and ignored with a warning.
+   */
+  void set_compression_options(const CompressionOptions & compression_options) override;
+
+private:
+  using ContextPointer = std::unique_ptr<LZ4F_cctx_s, void (*)(LZ4F_cctx_s *)>;
+
+  bool high_compression_;
+  int compression_level_;
+  ContextPointer lz4_context_;
+  std::vector<uint8_t> compressed_buffer_{};
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__LZ4_COMPRESSOR_HPP_
@@ -0,0 +1,82 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__LZ4_DECOMPRESSOR_HPP_
+#define ROSBAG2_COMPRESSION__LZ4_DECOMPRESSOR_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/base_decompressor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+
+// Declared by lz4frame.h, which is only included by the implementation.
+struct LZ4F_dctx_s;
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+/**
+ * A BaseDecompressorInterface that is used to decompress bagfiles and messages compressed into
+ * LZ4 frames, by either LZ4 or LZ4-HC.
+ *
+ * Lz4Decompressor should only be initialized by Reader.
+ * Every instance keeps a decompression context and buffer, which are reused for all messages.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC Lz4Decompressor : public BaseDecompressorInterface
+{
+public:
+  Lz4Decompressor();
+
+  ~Lz4Decompressor() = default;
+
+  Lz4Decompressor(Lz4Decompressor &&) = default;
+  Lz4Decompressor & operator=(Lz4Decompressor &&) = default;
+
+  std::string decompress_uri(const std::string & uri) override;
+
+  std::string decompress_uri_to_directory(
+    const std::string & uri, const std::string & directory) override;
+
+  void decompress_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  std::string get_decompression_identifier() const override;
+
+  bool is_compressed_message(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const override;
+
+private:
+  using ContextPointer = std::unique_ptr<LZ4F_dctx_s, void (*)(LZ4F_dctx_s *)>;
+
+  ContextPointer lz4_context_;
+  std::vector<uint8_t> compressed_buffer_{};
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__LZ4_DECOMPRESSOR_HPP_
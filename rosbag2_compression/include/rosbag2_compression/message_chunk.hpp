@@ -0,0 +1,112 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__MESSAGE_CHUNK_HPP_
+#define ROSBAG2_COMPRESSION__MESSAGE_CHUNK_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rcutils/time.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/message_pool.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+// Topic which the compressed chunks are stored on in CHUNK compression mode.
+constexpr const char kChunkTopicName[] = "/_rosbag2/compressed_chunks";
+constexpr const char kChunkTopicType[] = "rosbag2_compression/MessageChunk";
+
+/**
+ * Messages collected for being compressed together in CHUNK compression mode.
+ *
+ * A chunk is serialized as the sequence of its messages, each consisting of the length and
+ * characters of the topic name, the time stamp, the publish time stamp, and the length and bytes
+ * of the serialized data. Numbers are stored in the byte order of the recording machine.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC MessageChunk
+{
+public:
+  void add_message(const rosbag2_storage::SerializedBagMessage & message);
+
+  bool empty() const;
+
+  size_t get_message_count() const;
+
+  /// Size of the serialized chunk in bytes.
+  size_t get_size() const;
+
+  /// Earliest and latest time stamp of the messages in the chunk.
+  rcutils_time_point_value_t get_start_time() const;
+  rcutils_time_point_value_t get_end_time() const;
+
+  /**
+   * Moves the serialized chunk into a message on the chunk topic and empties the chunk.
+   * The time stamp of the message is the end time of the chunk and the publish time stamp is its
+   * start time, so the storage indexes chunks by the time range of their messages.
+   */
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> release();
+
+  /**
+   * Restores the messages of a serialized chunk.
+   *
+   * \param serialized_chunk The data of a message returned by release().
+   * \param message_pool Pool the messages and their data are taken from, if not null.
+   * \return The messages of the chunk in the order they were added.
+   * \throws std::runtime_error if the chunk is truncated.
+   */
+  static std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> parse(
+    const rcutils_uint8_array_t & serialized_chunk,
+    rosbag2_storage::MessagePool * message_pool = nullptr);
+
+  /**
+   * Restores the messages of a serialized chunk without copying their data, which references the
+   * chunk instead, see rosbag2_storage::make_serialized_data_view(). The chunk is kept in memory
+   * as long as any of its messages.
+   *
+   * \param message_pool Pool the messages are taken from, if not null.
+   * \throws std::runtime_error if the chunk is truncated.
+   */
+  static std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> parse(
+    const std::shared_ptr<const rcutils_uint8_array_t> & serialized_chunk,
+    rosbag2_storage::MessagePool * message_pool = nullptr);
+
+private:
+  std::vector<uint8_t> data_{};
+  size_t message_count_{0};
+  rcutils_time_point_value_t start_time_{0};
+  rcutils_time_point_value_t end_time_{0};
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__MESSAGE_CHUNK_HPP_
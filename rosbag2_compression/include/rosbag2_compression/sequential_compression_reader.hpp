@@ -15,12 +15,19 @@
 #ifndef ROSBAG2_COMPRESSION__SEQUENTIAL_COMPRESSION_READER_HPP_
 #define ROSBAG2_COMPRESSION__SEQUENTIAL_COMPRESSION_READER_HPP_
 
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "rosbag2_compression/base_decompressor_interface.hpp"
+#include "rosbag2_compression/base_decryptor_interface.hpp"
 #include "rosbag2_compression/compression_options.hpp"
+#include "rosbag2_compression/encryption_factory.hpp"
 
 #include "rosbag2_cpp/converter.hpp"
 #include "rosbag2_cpp/readers/sequential_reader.hpp"
@@ -62,12 +69,59 @@ public:
 
   virtual ~SequentialCompressionReader();
 
+  /**
+   * Waits for the decompression of the next file and removes the files decompressed for reading.
+   */
+  void reset() override;
+
+  /**
+   * In FILE mode, decompresses the first file and starts decompressing the second file in the
+   * background. Files are decompressed into storage_options.decompression_directory if set.
+   * In MESSAGE and CHUNK mode, batches of messages and the next chunks are decompressed by
+   * storage_options.decompression_threads threads in addition to the reading thread.
+   * Encrypted bags are decrypted with the key of the bag, which is decrypted with the master key
+   * read from storage_options.encryption_key_file.
+   */
   void open(
     const rosbag2_cpp::StorageOptions & storage_options,
     const rosbag2_cpp::ConverterOptions & converter_options) override;
 
+  /**
+   * In CHUNK mode, decompresses the next chunks once all messages of the current one are read,
+   * one per decompression thread.
+   */
+  bool has_next() override;
+
   std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
 
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes) override;
+
+  /// The messages are decompressed, so their views are taken from read_next_batch().
+  bool visit_next_batch(
+    const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+    size_t max_messages, size_t max_bytes) override;
+
+  /**
+   * In CHUNK mode, the storage only skips chunks ending before the start time. The filter is
+   * applied to the messages of the decompressed chunks, which keep the order they were written in.
+   */
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  void reset_filter() override;
+
+  /**
+   * In CHUNK mode, continues reading in the first chunk ending at or after the given time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * \throws std::runtime_error as the latest messages are not read from compressed files.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override;
+
 protected:
   /**
    * Increment the current file iterator to point to the next file in the list of relative file
@@ -78,18 +132,105 @@ protected:
    */
   void load_next_file() override;
 
+  /**
+   * Decompresses the current file if compression mode is FILE and it is not decompressed yet.
+   * The next file is decompressed in the background while the current one is read, and
+   * decompressed files which are neither are removed again, as long as their compressed file
+   * exists.
+   *
+   * \throws std::runtime_error If the decompressor was not initialized.
+   */
+  void preprocess_current_file() override;
+
   /**
    * Initializes the decompressor if a compression mode is specified in the metadata.
    *
    * \throws std::invalid_argument If compression format doesn't exist.
+   * \throws std::runtime_error If the bag is encrypted and the key file is missing or does not
+   *   hold the master key the bag was encrypted with.
    */
   virtual void setup_decompression();
 
+  /**
+   * Decompresses the messages, or in CHUNK mode the chunks, read to decode delta encoded
+   * messages.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  read_stored_messages_of_current_file(
+    const std::string & topic_name, rcutils_time_point_value_t end_time) override;
+
 private:
-  std::unique_ptr<rosbag2_compression::BaseDecompressorInterface> decompressor_{};
+  // Decompressors used by a single thread, as decompressors keep state between messages.
+  struct Decompressors
+  {
+    std::unique_ptr<rosbag2_compression::BaseDecompressorInterface> decompressor{};
+    // Decompressors of the topics listed in the metadata with a compression format of their own
+    // in MESSAGE mode, by format, and the decompressor of each such topic, null if not compressed.
+    std::unordered_map<
+      std::string, std::unique_ptr<rosbag2_compression::BaseDecompressorInterface>>
+    topic_format_decompressors{};
+    std::unordered_map<std::string, rosbag2_compression::BaseDecompressorInterface *>
+    topic_decompressors{};
+    // Decrypts the messages or chunks before they are decompressed, null if not encrypted.
+    std::unique_ptr<rosbag2_compression::BaseDecryptorInterface> decryptor{};
+  };
+
+  // Decompressors of the reading thread, and of each decompression thread in MESSAGE and CHUNK
+  // mode, which decompress consecutive parts of a batch while the reading thread does the first.
+  Decompressors decompressors_{};
+  std::vector<Decompressors> thread_decompressors_{};
   rosbag2_compression::CompressionMode compression_mode_{
     rosbag2_compression::CompressionMode::NONE};
   std::unique_ptr<rosbag2_compression::CompressionFactory> compression_factory_{};
+  std::unique_ptr<rosbag2_compression::EncryptionFactory> encryption_factory_{
+    std::make_unique<rosbag2_compression::EncryptionFactory>()};
+  std::string encryption_key_file_{};
+  // Key of an encrypted bag, decrypted with the master key, empty if the bag is not encrypted.
+  std::vector<uint8_t> encryption_key_{};
+  std::unordered_set<std::string> decompressed_files_{};
+  std::string decompression_directory_{};
+  size_t decompression_threads_{0};
+  // Decompression of the file at next_file_index_ running in the background in FILE mode.
+  std::future<std::string> next_file_decompression_{};
+  size_t next_file_index_{0};
+  // Messages of the current chunk in CHUNK mode which are still to be read.
+  std::deque<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> chunk_messages_{};
+  // Filter set on the reader in CHUNK mode, while storage_filter_ selects the chunks.
+  rosbag2_storage::StorageFilter message_filter_{};
+  // Names of the topics listed in the metadata which pass message_filter_, unless it
+  // passes all topics.
+  bool message_filter_selects_all_topics_{true};
+  std::unordered_set<std::string> message_filter_topics_{};
+
+  // Reads the master key and decrypts the key of the bag with it, if the bag is encrypted.
+  void load_encryption_key();
+
+  // Creates the decompressors of the bag and of the topics listed in the metadata, and the
+  // decryptor of an encrypted bag. The dictionaries of already loaded decompressors are shared.
+  Decompressors create_decompressors(const Decompressors * loaded = nullptr) const;
+
+  // Calls decompress_part with the decompressors of a thread for consecutive parts of count
+  // items, in parallel if there are decompression threads, and rethrows the first error.
+  void decompress_in_parallel(
+    size_t count,
+    const std::function<void(size_t begin, size_t end, Decompressors & decompressors)> &
+    decompress_part);
+
+  // Reads the next chunks, one per thread, decompresses them and keeps those of their messages
+  // which pass the filter and seek time.
+  void read_chunks();
+
+  bool passes_message_filter(const rosbag2_storage::SerializedBagMessage & message) const;
+
+  // Decrypts a message read in MESSAGE mode if the bag is encrypted, and decompresses it with the
+  // decompressor of its topic, if any.
+  void decompress_message(
+    rosbag2_storage::SerializedBagMessage & message, Decompressors & decompressors) const;
+
+  void decompress_file(size_t file_index);
+  void decompress_next_file_async();
+  void wait_for_next_file();
+  void remove_decompressed_files(size_t keep_from_index, size_t keep_to_index);
 };
 
 }  // namespace rosbag2_compression
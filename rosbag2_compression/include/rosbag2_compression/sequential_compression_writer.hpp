@@ -15,27 +15,43 @@
 #ifndef ROSBAG2_COMPRESSION__SEQUENTIAL_COMPRESSION_WRITER_HPP_
 #define ROSBAG2_COMPRESSION__SEQUENTIAL_COMPRESSION_WRITER_HPP_
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "rosbag2_cpp/bag_events.hpp"
 #include "rosbag2_cpp/converter.hpp"
 #include "rosbag2_cpp/converter_options.hpp"
+#include "rosbag2_cpp/memory_budget.hpp"
 #include "rosbag2_cpp/serialization_format_converter_factory.hpp"
 #include "rosbag2_cpp/serialization_format_converter_factory_interface.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
 #include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+#include "rosbag2_cpp/writers/message_reorder_buffer.hpp"
 
 #include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/storage_config.hpp"
 #include "rosbag2_storage/storage_factory.hpp"
 #include "rosbag2_storage/storage_factory_interface.hpp"
 
 #include "rosbag2_compression/compression_options.hpp"
 
 #include "base_compressor_interface.hpp"
+#include "base_encryptor_interface.hpp"
 #include "compression_factory.hpp"
 #include "compression_options.hpp"
+#include "compression_statistics.hpp"
+#include "encryption_factory.hpp"
+#include "message_chunk.hpp"
 #include "visibility_control.hpp"
 
 #ifdef _WIN32
@@ -103,6 +119,21 @@ public:
    */
   void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override;
 
+  /**
+   * Registers callbacks for bag events. The split callback is invoked after the closed file
+   * was compressed, and also for the last bagfile on reset().
+   * Files compressed in the background are reported from the compression thread.
+   */
+  void add_event_callbacks(const rosbag2_cpp::bag_events::WriterEventCallbacks & callbacks)
+  override;
+
+  /**
+   * Statistics of the compression since the writer was opened, including the compression levels
+   * chosen with CompressionOptions::adaptive_compression_level.
+   * Files compressed in the background are counted once they are compressed.
+   */
+  CompressionStatistics get_compression_statistics() const;
+
 protected:
   /**
    * Compress the most recent file and update the metadata file path.
@@ -126,6 +157,15 @@ protected:
    */
   virtual void setup_compression();
 
+  /**
+   * Initializes the encryptor with a new key for the bag if an encryption format is specified.
+   *
+   * \throws std::invalid_argument if the bag is not compressed by message or chunk, or no key
+   *   file is specified.
+   * \throws std::runtime_error if the key file cannot be read.
+   */
+  virtual void setup_encryption();
+
 private:
   std::string base_folder_;
   std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_{};
@@ -133,11 +173,41 @@ private:
   std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage_{};
   std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_{};
   std::unique_ptr<rosbag2_cpp::Converter> converter_{};
+  rosbag2_storage::StorageConfig storage_config_{};
   std::unique_ptr<rosbag2_compression::BaseCompressorInterface> compressor_{};
   std::unique_ptr<rosbag2_compression::CompressionFactory> compression_factory_{};
+  std::unique_ptr<rosbag2_compression::EncryptionFactory> encryption_factory_{
+    std::make_unique<rosbag2_compression::EncryptionFactory>()};
+
+  // Encrypts the messages or chunks once they are compressed, null if the bag is not encrypted,
+  // and the id of the master key and the key of the bag encrypted with it, for the metadata.
+  std::unique_ptr<rosbag2_compression::BaseEncryptorInterface> encryptor_{};
+  std::string encryption_key_id_;
+  std::string encrypted_key_;
 
   // Used in bagfile splitting; specifies the best-effort maximum sub-section of a bagfile in bytes.
   uint64_t max_bagfile_size_{rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT};
+  // Maximum time span of messages and maximum message count of a bagfile, 0 if unused.
+  std::chrono::nanoseconds max_bagfile_duration_{0};
+  uint64_t max_bagfile_messages_{0};
+  // Timestamp of the first message and number of messages in the current bagfile.
+  rcutils_time_point_value_t current_file_starting_time_{0};
+  uint64_t current_file_message_count_{0};
+  // Index of every topic of the current bagfile in the topics listed in its metadata.
+  std::unordered_map<std::string, size_t> current_file_topic_indices_;
+  // Identity shared with the bags of other hosts and offset added to the time stamps of the
+  // messages written, see rosbag2_cpp::StorageOptions.
+  std::string bag_id_;
+  std::chrono::nanoseconds clock_offset_{0};
+  // Delta encodes the messages of the delta encoded topics before they are compressed, null if
+  // no topic is delta encoded. Reset on every split.
+  std::unique_ptr<rosbag2_cpp::writers::MessageDeltaEncoder> delta_encoder_{};
+  // Puts the messages written in time stamp order, null if no reorder window is set. Flushed
+  // when the writer is closed. Reordered holds the messages released by the last write.
+  std::unique_ptr<rosbag2_cpp::writers::MessageReorderBuffer> reorder_buffer_{};
+  rosbag2_cpp::writers::MessageReorderBuffer::Messages reordered_messages_{};
+
+  std::vector<rosbag2_cpp::bag_events::WriterEventCallbacks> event_callbacks_{};
 
   // Used to track topic -> message count
   std::unordered_map<std::string, rosbag2_storage::TopicInformation> topics_names_to_info_{};
@@ -148,11 +218,151 @@ private:
 
   bool should_compress_last_file_{true};
 
+  // Messages collected for compression in CHUNK mode and the topic the chunks are written to.
+  MessageChunk chunk_{};
+  rosbag2_storage::TopicMetadata chunk_topic_{};
+  // Books the bytes of the chunk on the shared memory budget. The chunk is compressed and written
+  // early while the budget is exhausted.
+  std::unique_ptr<rosbag2_cpp::MemoryBudget::Account> chunk_memory_account_{
+    rosbag2_cpp::MemoryBudget::get_shared().open_account("compression chunk")};
+  // Chunks submitted to an asynchronous compressor, in the order they are written to the storage.
+  struct PendingChunk
+  {
+    std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+    std::future<void> compressed;
+    uint64_t uncompressed_size;
+  };
+  std::deque<PendingChunk> pending_chunks_{};
+
+  // Compressors of the topics with a compression format or level of their own in MESSAGE mode,
+  // by format and level, and the compressor of each such topic, null if it is not compressed.
+  struct TopicCompressor
+  {
+    rosbag2_compression::BaseCompressorInterface * compressor;
+    int compression_level;
+  };
+  std::unordered_map<std::string, std::unique_ptr<rosbag2_compression::BaseCompressorInterface>>
+  topic_format_compressors_{};
+  std::unordered_map<std::string, TopicCompressor> topic_compressors_{};
+
+  // Compression sample of each topic in MESSAGE mode, see
+  // CompressionOptions::compression_sample_messages. Only used by the writing thread.
+  struct CompressionSampler
+  {
+    bool sampling = true;
+    bool compress = true;
+    // Messages and sizes sampled so far, or messages written since the last sample.
+    uint64_t message_count = 0;
+    uint64_t uncompressed_bytes = 0;
+    uint64_t compressed_bytes = 0;
+  };
+  std::unordered_map<std::string, CompressionSampler> compression_samplers_{};
+
+  // A closed bagfile waiting for compression in FILE mode and the file opened after it.
+  struct CompressionJob
+  {
+    size_t file_index;
+    std::string opened_file;
+    int compression_level = 0;
+    // Written next to the compressed file.
+    rosbag2_storage::BagMetadata summary{};
+  };
+
+  // Guards the queue, the relative file paths in the metadata, the compression level and the
+  // statistics while compression threads run.
+  mutable std::mutex compression_mutex_;
+  std::condition_variable compression_job_added_;
+  std::condition_variable compression_job_taken_;
+  std::queue<CompressionJob> compression_queue_{};
+  bool stop_compression_{false};
+  // Compressors of all but the first compression thread, which uses compressor_.
+  std::vector<std::unique_ptr<rosbag2_compression::BaseCompressorInterface>>
+  additional_compressors_{};
+  std::vector<std::thread> compression_threads_{};
+
+  // Level the next file, message or chunk is compressed at.
+  int compression_level_{0};
+  CompressionStatistics compression_statistics_{};
+  // Time spent compressing messages or chunks since the start of the current adaptation window.
+  std::chrono::steady_clock::time_point adaptation_window_start_{};
+  std::chrono::nanoseconds adaptation_window_compression_time_{0};
+
+  // Starts the compression threads configured in the compression options for FILE mode.
+  void start_compression_threads();
+
+  // Compresses the queued files and stops the compression threads.
+  void stop_compression_threads();
+
+  // Queues the closed file for compression, waiting while the queue is full.
+  void enqueue_compression(CompressionJob job);
+
+  // Summary of the file in FILE mode, with the topics and time range of its messages, which is
+  // written uncompressed next to the compressed file.
+  rosbag2_storage::BagMetadata make_file_summary(size_t file_index) const;
+
+  void run_compression_thread(rosbag2_compression::BaseCompressorInterface & compressor);
+
+  // Changes the compression level by the step within the configured bounds. In MESSAGE and CHUNK
+  // mode, the compressor is changed to the new level, too. Must be called with the lock held.
+  void change_compression_level(int step);
+
+  // Adapts the compression level to the fraction of time spent compressing in MESSAGE and
+  // CHUNK mode, once per adaptation window. Must be called with the lock held.
+  void adapt_message_compression_level(
+    std::chrono::nanoseconds compression_time, std::chrono::steady_clock::time_point now);
+
+  // Adds a compression to the statistics. Must be called with the lock held.
+  void record_compression(int level, uint64_t uncompressed_size, uint64_t compressed_size);
+
+  // Removes files which were dropped by the compression threads because they were empty.
+  void remove_dropped_files();
+
+  // Selects the compressor of a topic created with the compression options of its name or type,
+  // and stores its compression format in its information if it is not the one of the bag.
+  void setup_topic_compression(rosbag2_storage::TopicInformation & info);
+
+  // Compresses a message of a topic with a compressor of its own.
+  void compress_topic_message(
+    const TopicCompressor & topic_compressor, rosbag2_storage::SerializedBagMessage & message);
+
+  // Checks if a message is written uncompressed, since the last sample of its topic did not
+  // compress well, and starts the next sample once it is due.
+  bool skip_incompressible_message(
+    const rosbag2_compression::BaseCompressorInterface & compressor,
+    const rosbag2_storage::SerializedBagMessage & message);
+
+  // Adds a compressed message to the sample of its topic, if it is sampled, and decides whether
+  // the topic is compressed once the sample is complete.
+  void sample_compression(
+    const std::string & topic_name, uint64_t uncompressed_size, uint64_t compressed_size);
+
+  // Checks if the current chunk reached the limits given in the compression options, or if the
+  // shared memory budget is exhausted.
+  bool is_chunk_full() const;
+
+  // Compresses the current chunk, if any, and writes it to the storage. An asynchronous compressor
+  // compresses it in the background while it is pending.
+  void write_chunk();
+
+  // Writes the pending chunks which are compressed, in order, and waits for the oldest ones while
+  // more than max_pending_chunks are pending.
+  void write_pending_chunks(size_t max_pending_chunks);
+
+  // Writes a message in time stamp order to the current bagfile, or its chunk.
+  void write_in_order(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
+
+  // Writes the messages held by the reorder buffer, if any.
+  void flush_reorder_buffer();
+
   // Closes the current backed storage and opens the next bagfile.
   void split_bagfile();
 
-  // Checks if the current recording bagfile needs to be split and rolled over to a new file.
-  bool should_split_bagfile() const;
+  // Checks if the current recording bagfile needs to be split and rolled over to a new file
+  // before the given message is written.
+  bool should_split_bagfile(const rosbag2_storage::SerializedBagMessage & message) const;
+
+  // Invokes the split callbacks.
+  void notify_split(const rosbag2_cpp::bag_events::BagSplitInfo & split_info) const;
 
   // Prepares the metadata by setting initial values.
   void init_metadata();
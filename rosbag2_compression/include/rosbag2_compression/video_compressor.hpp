@@ -0,0 +1,108 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__VIDEO_COMPRESSOR_HPP_
+#define ROSBAG2_COMPRESSION__VIDEO_COMPRESSOR_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_compression/base_compressor_interface.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+#include "rosbag2_compression/zstd_compressor.hpp"
+
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_compression
+{
+
+/**
+ * A lossy BaseCompressorInterface for streams of raw images, selected with the "video"
+ * compression format, e.g. for the sensor_msgs/msg/Image topic type in MESSAGE mode.
+ *
+ * The compression level is the largest difference of a pixel byte read to the one recorded, 0
+ * keeps the images lossless. Every block of 16 bytes of a row which differs from the same block
+ * of the previous image of the topic by at most that much keeps the previous block, and the other
+ * blocks are quantized to steps of the level plus one. The images are then delta encoded
+ * like the topics of rosbag2_cpp::writers::MessageDeltaEncoder, so an image of a static scene
+ * only stores the blocks which changed, and every keyframe_interval-th image is a keyframe from
+ * which readers seeking into the bag start decoding. Keyframes are compressed like with
+ * ImageCompressor and deltas with ZStandard, so VideoDecompressor restores the stored images,
+ * which readers then decode as delta encoded topics.
+ *
+ * Messages of other topic types, and files, are compressed with ZStandard alone.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC VideoCompressor : public BaseCompressorInterface
+{
+public:
+  VideoCompressor() = default;
+
+  ~VideoCompressor() override = default;
+
+  std::string compress_uri(const std::string & uri) override;
+
+  void compress_serialized_bag_message(
+    rosbag2_storage::SerializedBagMessage * bag_message) override;
+
+  std::string get_compression_identifier() const override;
+
+  /**
+   * Takes the compression level as the largest difference of a pixel byte, and the keyframe
+   * interval. ZStandard compresses at its fastest default level.
+   * \throws std::invalid_argument if the level is not within [0, 255].
+   */
+  void set_compression_options(const CompressionOptions & compression_options) override;
+
+  /// Remembers the topics of type sensor_msgs/msg/Image, which are compressed as video.
+  void register_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  bool is_delta_encoded(const std::string & topic_name) const override;
+
+  void reset_deltas() override;
+
+private:
+  struct Stream
+  {
+    std::unique_ptr<rosbag2_cpp::writers::MessageDeltaEncoder> delta_encoder;
+    // Data of the previous image as stored, whose blocks are kept if they barely changed.
+    std::shared_ptr<rcutils_uint8_array_t> reference;
+  };
+
+  ZstdCompressor zstd_compressor_{};
+  uint8_t tolerance_{1};
+  uint64_t keyframe_interval_{100};
+  // Streams by topic of type sensor_msgs/msg/Image.
+  std::unordered_map<std::string, Stream> streams_{};
+};
+
+}  // namespace rosbag2_compression
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_COMPRESSION__VIDEO_COMPRESSOR_HPP_
@@ -0,0 +1,45 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__VIDEO_DECOMPRESSOR_HPP_
+#define ROSBAG2_COMPRESSION__VIDEO_DECOMPRESSOR_HPP_
+
+#include <string>
+
+#include "rosbag2_compression/image_decompressor.hpp"
+#include "rosbag2_compression/visibility_control.hpp"
+
+namespace rosbag2_compression
+{
+
+/**
+ * A BaseDecompressorInterface for the messages and files compressed by VideoCompressor.
+ *
+ * Its frames are the ones of ImageCompressor, so messages are restored as they were stored by
+ * VideoCompressor, as keyframes or deltas which readers decode like the messages of delta
+ * encoded topics.
+ */
+class ROSBAG2_COMPRESSION_PUBLIC VideoDecompressor : public ImageDecompressor
+{
+public:
+  VideoDecompressor() = default;
+
+  ~VideoDecompressor() override = default;
+
+  std::string get_decompression_identifier() const override;
+};
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__VIDEO_DECOMPRESSOR_HPP_
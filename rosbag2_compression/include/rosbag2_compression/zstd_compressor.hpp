@@ -22,10 +22,20 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "rosbag2_compression/base_compressor_interface.hpp"
 #include "rosbag2_compression/visibility_control.hpp"
 
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
 namespace rosbag2_compression
 {
 
@@ -33,22 +43,83 @@ namespace rosbag2_compression
  * A BaseCompressorInterface that is used to compress bagfiles stored using ZStandard compression.
  *
  * ZstdCompressor should only be initialized by Writer.
+ * Every instance keeps a compression context and buffer, which are reused for all messages.
+ *
+ * In MESSAGE mode, messages can be compressed with a dictionary, which improves the compression
+ * of small messages. Either a dictionary is loaded from CompressionOptions::compression_dictionary,
+ * or one is trained for every topic type from its first messages.
  */
 class ROSBAG2_COMPRESSION_PUBLIC ZstdCompressor : public BaseCompressorInterface
 {
 public:
-  ZstdCompressor() = default;
+  ZstdCompressor();
 
   ~ZstdCompressor() = default;
 
+  ZstdCompressor(ZstdCompressor &&) = default;
+  ZstdCompressor & operator=(ZstdCompressor &&) = default;
+
   std::string compress_uri(const std::string & uri) override;
 
   void compress_serialized_bag_message(
     rosbag2_storage::SerializedBagMessage * bag_message) override;
 
   std::string get_compression_identifier() const override;
+
+  bool can_store_uncompressed(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const override;
+
+  /**
+   * Files are compressed by compression_worker_threads threads if libzstd was built with
+   * multithreading support, and by the calling thread otherwise.
+   * Messages are always compressed by the calling thread.
+   * \throws std::invalid_argument if the compression level is not supported.
+   */
+  void set_compression_options(const CompressionOptions & compression_options) override;
+
+  void register_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  /**
+   * Writes every dictionary into a file named after its dictionary id.
+   */
+  std::vector<std::string> write_dictionaries(const std::string & directory) override;
+
+private:
+  struct Dictionary
+  {
+    std::vector<uint8_t> content;
+    // Null if the dictionary could not be trained, so the type is compressed without one.
+    std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> compression_dictionary;
+  };
+
+  // Messages collected for training the dictionary of a topic type.
+  struct TrainingSamples
+  {
+    std::vector<uint8_t> data;
+    std::vector<size_t> sizes;
+  };
+
+  Dictionary make_dictionary(std::vector<uint8_t> content) const;
+  const ZSTD_CDict * get_dictionary(const rosbag2_storage::SerializedBagMessage & bag_message);
+  void train_dictionary(const std::string & topic_type, const TrainingSamples & samples);
+
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> zstd_context_;
+  std::vector<uint8_t> compressed_buffer_{};
+  int compression_level_;
+  int worker_threads_{0};
+  uint64_t dictionary_training_messages_{0};
+  std::unordered_map<std::string, std::string> topic_types_{};
+  std::unique_ptr<Dictionary> shared_dictionary_{};
+  // File shared_dictionary_ was read from, which is not read again when only the level changes.
+  std::string shared_dictionary_uri_{};
+  std::unordered_map<std::string, Dictionary> dictionaries_{};
+  std::unordered_map<std::string, TrainingSamples> training_samples_{};
 };
 
 }  // namespace rosbag2_compression
 
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
 #endif  // ROSBAG2_COMPRESSION__ZSTD_COMPRESSOR_HPP_
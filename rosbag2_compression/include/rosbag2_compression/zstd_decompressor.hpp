@@ -22,10 +22,20 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "rosbag2_compression/base_decompressor_interface.hpp"
 #include "rosbag2_compression/visibility_control.hpp"
 
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
 namespace rosbag2_compression
 {
 
@@ -33,22 +43,58 @@ namespace rosbag2_compression
  * A BaseDecompressorInterface that is used to decompress bagfiles stored using ZStandard compression.
  *
  * ZstdDecompressor should only be initialized by Reader.
+ * Every instance keeps a decompression context and buffers, which are reused for all files and
+ * messages.
  */
 class ROSBAG2_COMPRESSION_PUBLIC ZstdDecompressor : public BaseDecompressorInterface
 {
 public:
-  ZstdDecompressor() = default;
+  ZstdDecompressor();
 
   ~ZstdDecompressor() = default;
 
+  ZstdDecompressor(ZstdDecompressor &&) = default;
+  ZstdDecompressor & operator=(ZstdDecompressor &&) = default;
+
   std::string decompress_uri(const std::string & uri) override;
 
+  std::string decompress_uri_to_directory(
+    const std::string & uri, const std::string & directory) override;
+
   void decompress_serialized_bag_message(
     rosbag2_storage::SerializedBagMessage * bag_message) override;
 
   std::string get_decompression_identifier() const override;
+
+  bool is_compressed_message(const rosbag2_storage::SerializedBagMessage & bag_message)
+  const override;
+
+  /**
+   * Messages name the id of the dictionary they were compressed with, which is looked up among
+   * the loaded dictionaries.
+   */
+  void load_dictionaries(const std::vector<std::string> & uris) override;
+
+  /**
+   * Loaded dictionaries are immutable, so they are shared with other ZstdDecompressors.
+   */
+  bool share_dictionaries(const BaseDecompressorInterface & other) override;
+
+private:
+  using DictionaryPointer = std::shared_ptr<const ZSTD_DDict>;
+
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> zstd_context_;
+  std::vector<uint8_t> compressed_buffer_{};
+  // Chunks files are read and decompressed in.
+  std::vector<uint8_t> input_chunk_{};
+  std::vector<uint8_t> output_chunk_{};
+  std::unordered_map<unsigned, DictionaryPointer> dictionaries_{};
 };
 
 }  // namespace rosbag2_compression
 
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
 #endif  // ROSBAG2_COMPRESSION__ZSTD_DECOMPRESSOR_HPP_
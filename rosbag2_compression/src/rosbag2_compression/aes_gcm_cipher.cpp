@@ -0,0 +1,126 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aes_gcm_cipher.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rosbag2_compression
+{
+
+namespace
+{
+void throw_on_openssl_error(int result, const char * operation)
+{
+  if (result != 1) {
+    throw std::runtime_error{std::string("AES-GCM failed to ") + operation + "."};
+  }
+}
+}  // namespace
+
+AesGcmCipher::AesGcmCipher(const std::vector<uint8_t> & key, bool encrypt)
+: context_{EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free},
+  encrypt_{encrypt}
+{
+  if (key.size() != kAesGcmKeySize) {
+    throw std::invalid_argument{
+            "AES-GCM requires a key of " + std::to_string(kAesGcmKeySize) + " bytes, not " +
+            std::to_string(key.size()) + " bytes."};
+  }
+  if (!context_) {
+    throw std::runtime_error{"Could not create an AES-GCM cipher context."};
+  }
+  // The key schedule is computed once, every message only sets its nonce.
+  throw_on_openssl_error(
+    EVP_CipherInit_ex(
+      context_.get(), EVP_aes_256_gcm(), nullptr, key.data(), nullptr, encrypt_ ? 1 : 0),
+    "set the key");
+}
+
+void AesGcmCipher::seal(
+  const uint8_t * nonce, const std::vector<uint8_t> & additional_data,
+  const uint8_t * data, size_t size, uint8_t * output, uint8_t * tag)
+{
+  if (!encrypt_) {
+    throw std::logic_error{"The AES-GCM cipher was set up for decryption."};
+  }
+  throw_on_openssl_error(
+    EVP_CipherInit_ex(context_.get(), nullptr, nullptr, nullptr, nonce, -1), "set the nonce");
+  update(additional_data.data(), nullptr, additional_data.size());
+  update(data, output, size);
+  int final_size = 0;
+  throw_on_openssl_error(
+    EVP_CipherFinal_ex(context_.get(), output + size, &final_size), "finish the encryption");
+  throw_on_openssl_error(
+    EVP_CIPHER_CTX_ctrl(
+      context_.get(), EVP_CTRL_GCM_GET_TAG, static_cast<int>(kAesGcmTagSize), tag),
+    "get the tag");
+}
+
+bool AesGcmCipher::open(
+  const uint8_t * nonce, const std::vector<uint8_t> & additional_data,
+  const uint8_t * data, size_t size, const uint8_t * tag, uint8_t * output)
+{
+  if (encrypt_) {
+    throw std::logic_error{"The AES-GCM cipher was set up for encryption."};
+  }
+  throw_on_openssl_error(
+    EVP_CipherInit_ex(context_.get(), nullptr, nullptr, nullptr, nonce, -1), "set the nonce");
+  update(additional_data.data(), nullptr, additional_data.size());
+  update(data, output, size);
+  // OpenSSL only reads the tag, which it takes as non-const.
+  throw_on_openssl_error(
+    EVP_CIPHER_CTX_ctrl(
+      context_.get(), EVP_CTRL_GCM_SET_TAG, static_cast<int>(kAesGcmTagSize),
+      const_cast<uint8_t *>(tag)),
+    "set the tag");
+  int final_size = 0;
+  return EVP_CipherFinal_ex(context_.get(), output + size, &final_size) == 1;
+}
+
+void AesGcmCipher::update(const uint8_t * input, uint8_t * output, size_t size)
+{
+  constexpr size_t kMaxPartSize = INT_MAX & ~static_cast<size_t>(15);
+  while (size > 0) {
+    const auto part_size = std::min(size, kMaxPartSize);
+    int output_size = 0;
+    throw_on_openssl_error(
+      EVP_CipherUpdate(
+        context_.get(), output, &output_size, input, static_cast<int>(part_size)),
+      "process the data");
+    input += part_size;
+    if (output) {
+      output += part_size;
+    }
+    size -= part_size;
+  }
+}
+
+std::vector<uint8_t> make_aes_gcm_additional_data(
+  const rosbag2_storage::SerializedBagMessage & bag_message)
+{
+  const auto & topic_name = bag_message.topic_name;
+  std::vector<uint8_t> additional_data(topic_name.begin(), topic_name.end());
+  auto time_stamp = static_cast<uint64_t>(bag_message.time_stamp);
+  for (size_t i = 0; i < sizeof(time_stamp); ++i, time_stamp >>= 8) {
+    additional_data.push_back(static_cast<uint8_t>(time_stamp & 0xFFu));
+  }
+  return additional_data;
+}
+
+}  // namespace rosbag2_compression
@@ -0,0 +1,85 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__AES_GCM_CIPHER_HPP_
+#define ROSBAG2_COMPRESSION__AES_GCM_CIPHER_HPP_
+
+#include <openssl/evp.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+namespace rosbag2_compression
+{
+
+// Sizes of the key, and of the nonce and authentication tag stored after the encrypted data.
+constexpr const size_t kAesGcmKeySize = 32;
+constexpr const size_t kAesGcmNonceSize = 12;
+constexpr const size_t kAesGcmTagSize = 16;
+
+/**
+ * AES-256 in Galois/Counter Mode with a key which is set up once for all messages.
+ * OpenSSL encrypts with the AES-NI instructions and computes the tag with carry-less
+ * multiplication where the processor has them, which takes less than a cycle per byte.
+ * Every instance keeps a cipher context, so it may only be used by one thread at a time.
+ */
+class AesGcmCipher
+{
+public:
+  /**
+   * \throws std::invalid_argument if the key does not have kAesGcmKeySize bytes.
+   * \throws std::runtime_error if the cipher context could not be created.
+   */
+  AesGcmCipher(const std::vector<uint8_t> & key, bool encrypt);
+
+  /**
+   * Encrypts the data into the output of the same size and writes the tag authenticating it and
+   * the additional data. A nonce must never be used twice with the same key.
+   */
+  void seal(
+    const uint8_t * nonce, const std::vector<uint8_t> & additional_data,
+    const uint8_t * data, size_t size, uint8_t * output, uint8_t * tag);
+
+  /**
+   * Decrypts the data into the output of the same size.
+   * \return False if the tag does not authenticate the data and the additional data, and the
+   *   output is then not to be used.
+   */
+  bool open(
+    const uint8_t * nonce, const std::vector<uint8_t> & additional_data,
+    const uint8_t * data, size_t size, const uint8_t * tag, uint8_t * output);
+
+private:
+  std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> context_;
+  bool encrypt_;
+
+  // Passes the data to the cipher in parts which fit the int sizes of OpenSSL.
+  void update(const uint8_t * input, uint8_t * output, size_t size);
+};
+
+/**
+ * The additional data authenticated with a message, its topic name followed by its time stamp
+ * in little endian, so an encrypted message is neither moved to another topic nor to another
+ * time without being detected.
+ */
+std::vector<uint8_t> make_aes_gcm_additional_data(
+  const rosbag2_storage::SerializedBagMessage & bag_message);
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__AES_GCM_CIPHER_HPP_
@@ -0,0 +1,78 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_compression/aes_gcm_decryptor.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "aes_gcm_cipher.hpp"
+
+namespace
+{
+
+// String constant used to identify AesGcmDecryptor.
+constexpr const char kDecryptionIdentifier[] = "aes_gcm";
+
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+AesGcmDecryptor::AesGcmDecryptor(const std::vector<uint8_t> & key)
+: cipher_{std::make_unique<AesGcmCipher>(key, false)}
+{}
+
+AesGcmDecryptor::~AesGcmDecryptor() = default;
+
+void AesGcmDecryptor::decrypt_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot decrypt message without serialized data."};
+  }
+  const auto & serialized_data = *bag_message->serialized_data;
+  if (serialized_data.buffer_length < kAesGcmNonceSize + kAesGcmTagSize) {
+    throw std::runtime_error{
+            "A message of topic \"" + bag_message->topic_name + "\" is too short to be encrypted."};
+  }
+  const auto size = serialized_data.buffer_length - kAesGcmNonceSize - kAesGcmTagSize;
+  const auto nonce = serialized_data.buffer + size;
+
+  // The encrypted data may be a view of a mapped file or a chunk shared with other messages,
+  // so it is decrypted into a new buffer.
+  auto decrypted_data = rosbag2_storage::make_empty_serialized_message(size);
+  if (!cipher_->open(
+      nonce, make_aes_gcm_additional_data(*bag_message), serialized_data.buffer, size,
+      nonce + kAesGcmNonceSize, decrypted_data->buffer))
+  {
+    throw std::runtime_error{
+            "A message of topic \"" + bag_message->topic_name + "\" could not be decrypted. "
+            "It was either encrypted with another key or changed after it was written."};
+  }
+  decrypted_data->buffer_length = size;
+  bag_message->serialized_data = std::move(decrypted_data);
+}
+
+std::string AesGcmDecryptor::get_decryption_identifier() const
+{
+  return kDecryptionIdentifier;
+}
+
+}  // namespace rosbag2_compression
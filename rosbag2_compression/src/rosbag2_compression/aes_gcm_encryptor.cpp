@@ -0,0 +1,82 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <openssl/rand.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_compression/aes_gcm_encryptor.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "aes_gcm_cipher.hpp"
+
+namespace
+{
+
+// String constant used to identify AesGcmEncryptor.
+constexpr const char kEncryptionIdentifier[] = "aes_gcm";
+
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+AesGcmEncryptor::AesGcmEncryptor(const std::vector<uint8_t> & key)
+: cipher_{std::make_unique<AesGcmCipher>(key, true)}
+{
+  if (RAND_bytes(nonce_prefix_.data(), static_cast<int>(nonce_prefix_.size())) != 1) {
+    throw std::runtime_error{"Could not generate the nonces of the AES-GCM encryptor."};
+  }
+}
+
+AesGcmEncryptor::~AesGcmEncryptor() = default;
+
+void AesGcmEncryptor::encrypt_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot encrypt message without serialized data."};
+  }
+  const auto & serialized_data = *bag_message->serialized_data;
+  const auto size = serialized_data.buffer_length;
+  const auto encrypted_size = size + kAesGcmNonceSize + kAesGcmTagSize;
+
+  // The data may be shared, e.g. with other writers, so it is encrypted into a new buffer.
+  auto encrypted_data = rosbag2_storage::make_empty_serialized_message(encrypted_size);
+  const auto nonce = encrypted_data->buffer + size;
+  std::memcpy(nonce, nonce_prefix_.data(), nonce_prefix_.size());
+  auto counter = nonce_counter_++;
+  for (auto i = kAesGcmNonceSize; i-- > nonce_prefix_.size(); counter >>= 8) {
+    nonce[i] = static_cast<uint8_t>(counter & 0xFFu);
+  }
+
+  cipher_->seal(
+    nonce, make_aes_gcm_additional_data(*bag_message), serialized_data.buffer, size,
+    encrypted_data->buffer, nonce + kAesGcmNonceSize);
+  encrypted_data->buffer_length = encrypted_size;
+  bag_message->serialized_data = std::move(encrypted_data);
+}
+
+std::string AesGcmEncryptor::get_encryption_identifier() const
+{
+  return kEncryptionIdentifier;
+}
+
+}  // namespace rosbag2_compression
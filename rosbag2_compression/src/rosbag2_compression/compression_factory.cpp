@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "rosbag2_compression/compression_factory.hpp"
 
@@ -39,4 +40,13 @@ CompressionFactory::create_decompressor(const std::string & compression_format)
   return impl_->create_decompressor(compression_format);
 }
 
+void CompressionFactory::register_compression_format(
+  const std::string & compression_format,
+  CompressorCreator compressor_creator,
+  DecompressorCreator decompressor_creator)
+{
+  CompressionFactoryImpl::register_compression_format(
+    compression_format, std::move(compressor_creator), std::move(decompressor_creator));
+}
+
 }  // namespace rosbag2_compression
@@ -16,12 +16,23 @@
 #define ROSBAG2_COMPRESSION__COMPRESSION_FACTORY_IMPL_HPP_
 
 #include <algorithm>
+#include <cctype>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 #include "logging.hpp"
 #include "rosbag2_compression/compression_factory.hpp"
+#include "rosbag2_compression/image_compressor.hpp"
+#include "rosbag2_compression/image_decompressor.hpp"
+#include "rosbag2_compression/lz4_compressor.hpp"
+#include "rosbag2_compression/lz4_decompressor.hpp"
+#include "rosbag2_compression/video_compressor.hpp"
+#include "rosbag2_compression/video_decompressor.hpp"
 #include "rosbag2_compression/zstd_compressor.hpp"
 #include "rosbag2_compression/zstd_decompressor.hpp"
 
@@ -29,6 +40,10 @@ namespace
 {
 
 constexpr const char kCompressionFormatZstd[] = "zstd";
+constexpr const char kCompressionFormatLz4[] = "lz4";
+constexpr const char kCompressionFormatLz4Hc[] = "lz4hc";
+constexpr const char kCompressionFormatImage[] = "image";
+constexpr const char kCompressionFormatVideo[] = "video";
 
 /// Verify whether two case-insensitive chars are equal
 bool compare_char(const char c1, const char c2)
@@ -42,6 +57,14 @@ bool case_insensitive_compare(const std::string & str1, const std::string & str2
   return (str1.size() == str2.size()) &&
          std::equal(str1.begin(), str1.end(), str2.begin(), &compare_char);
 }
+
+std::string to_lower(std::string str)
+{
+  std::transform(
+    str.begin(), str.end(), str.begin(),
+    [](unsigned char c) {return static_cast<char>(std::tolower(c));});
+  return str;
+}
 }  // namespace
 
 namespace rosbag2_compression
@@ -60,6 +83,16 @@ public:
   {
     if (case_insensitive_compare(compression_format, kCompressionFormatZstd)) {
       return std::make_unique<rosbag2_compression::ZstdCompressor>();
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatLz4)) {
+      return std::make_unique<rosbag2_compression::Lz4Compressor>();
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatLz4Hc)) {
+      return std::make_unique<rosbag2_compression::Lz4Compressor>(true);
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatImage)) {
+      return std::make_unique<rosbag2_compression::ImageCompressor>();
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatVideo)) {
+      return std::make_unique<rosbag2_compression::VideoCompressor>();
+    } else if (const auto format = find_registered_format(compression_format)) {
+      return format->compressor_creator();
     } else {
       std::stringstream errmsg;
       errmsg << "Compression format \"" << compression_format << "\" is not supported.";
@@ -74,6 +107,17 @@ public:
   {
     if (case_insensitive_compare(compression_format, kCompressionFormatZstd)) {
       return std::make_unique<rosbag2_compression::ZstdDecompressor>();
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatLz4) ||
+      case_insensitive_compare(compression_format, kCompressionFormatLz4Hc))
+    {
+      // Both variants write the same frame format.
+      return std::make_unique<rosbag2_compression::Lz4Decompressor>();
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatImage)) {
+      return std::make_unique<rosbag2_compression::ImageDecompressor>();
+    } else if (case_insensitive_compare(compression_format, kCompressionFormatVideo)) {
+      return std::make_unique<rosbag2_compression::VideoDecompressor>();
+    } else if (const auto format = find_registered_format(compression_format)) {
+      return format->decompressor_creator();
     } else {
       std::stringstream errmsg;
       errmsg << "Compression format \"" << compression_format << "\" is not supported.";
@@ -81,6 +125,61 @@ public:
       throw std::invalid_argument{errmsg.str()};
     }
   }
+
+  /// See CompressionFactory::register_compression_format for documentation.
+  static void register_compression_format(
+    const std::string & compression_format,
+    CompressionFactory::CompressorCreator compressor_creator,
+    CompressionFactory::DecompressorCreator decompressor_creator)
+  {
+    if (case_insensitive_compare(compression_format, kCompressionFormatZstd) ||
+      case_insensitive_compare(compression_format, kCompressionFormatLz4) ||
+      case_insensitive_compare(compression_format, kCompressionFormatLz4Hc) ||
+      case_insensitive_compare(compression_format, kCompressionFormatImage) ||
+      case_insensitive_compare(compression_format, kCompressionFormatVideo))
+    {
+      throw std::invalid_argument{
+              "Compression format \"" + compression_format + "\" is built in."};
+    }
+    if (!compressor_creator || !decompressor_creator) {
+      throw std::invalid_argument{
+              "Compression format \"" + compression_format + "\" needs both creators."};
+    }
+    auto & registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.formats[to_lower(compression_format)] = std::make_shared<const RegisteredFormat>(
+      RegisteredFormat{std::move(compressor_creator), std::move(decompressor_creator)});
+  }
+
+private:
+  struct RegisteredFormat
+  {
+    CompressionFactory::CompressorCreator compressor_creator;
+    CompressionFactory::DecompressorCreator decompressor_creator;
+  };
+
+  // Formats registered by CompressionFactory::register_compression_format, by lower case name.
+  struct Registry
+  {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const RegisteredFormat>> formats;
+  };
+
+  static Registry & get_registry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  // The creators are called outside the lock, so that they may create compressors of other formats.
+  static std::shared_ptr<const RegisteredFormat> find_registered_format(
+    const std::string & compression_format)
+  {
+    auto & registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const auto format = registry.formats.find(to_lower(compression_format));
+    return format == registry.formats.end() ? nullptr : format->second;
+  }
 };
 }  // namespace rosbag2_compression
 
@@ -27,6 +27,7 @@ namespace
 constexpr const char kCompressionModeNoneStr[] = "NONE";
 constexpr const char kCompressionModeFileStr[] = "FILE";
 constexpr const char kCompressionModeMessageStr[] = "MESSAGE";
+constexpr const char kCompressionModeChunkStr[] = "CHUNK";
 
 std::string to_upper(const std::string & text)
 {
@@ -45,6 +46,8 @@ CompressionMode compression_mode_from_string(const std::string & compression_mod
     return CompressionMode::FILE;
   } else if (compression_mode_upper == kCompressionModeMessageStr) {
     return CompressionMode::MESSAGE;
+  } else if (compression_mode_upper == kCompressionModeChunkStr) {
+    return CompressionMode::CHUNK;
   } else {
     ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
       "CompressionMode: \"" << compression_mode << "\" is not supported!");
@@ -61,6 +64,8 @@ std::string compression_mode_to_string(const CompressionMode compression_mode)
       return kCompressionModeFileStr;
     case CompressionMode::MESSAGE:
       return kCompressionModeMessageStr;
+    case CompressionMode::CHUNK:
+      return kCompressionModeChunkStr;
     default:
       ROSBAG2_COMPRESSION_LOG_ERROR_STREAM("CompressionMode not supported!");
       return kCompressionModeNoneStr;
@@ -0,0 +1,81 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/aes_gcm_decryptor.hpp"
+#include "rosbag2_compression/aes_gcm_encryptor.hpp"
+#include "rosbag2_compression/encryption_factory.hpp"
+
+#include "logging.hpp"
+
+namespace
+{
+
+constexpr const char kEncryptionFormatAesGcm[] = "aes_gcm";
+
+/// Verify whether two case-insensitive chars are equal
+bool compare_char(const char c1, const char c2)
+{
+  return c1 == c2 ||
+         std::tolower(static_cast<unsigned char>(c1)) ==
+         std::tolower(static_cast<unsigned char>(c2));
+}
+
+/// Performs a case-insensitive comparison of two strings
+bool case_insensitive_compare(const std::string & str1, const std::string & str2) noexcept
+{
+  return (str1.size() == str2.size()) &&
+         std::equal(str1.begin(), str1.end(), str2.begin(), &compare_char);
+}
+
+[[noreturn]] void throw_unsupported_format(const std::string & encryption_format)
+{
+  std::stringstream errmsg;
+  errmsg << "Encryption format \"" << encryption_format << "\" is not supported.";
+  ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(errmsg.str());
+  throw std::invalid_argument{errmsg.str()};
+}
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+std::unique_ptr<rosbag2_compression::BaseEncryptorInterface>
+EncryptionFactory::create_encryptor(
+  const std::string & encryption_format, const std::vector<uint8_t> & key)
+{
+  if (case_insensitive_compare(encryption_format, kEncryptionFormatAesGcm)) {
+    return std::make_unique<rosbag2_compression::AesGcmEncryptor>(key);
+  }
+  throw_unsupported_format(encryption_format);
+}
+
+std::unique_ptr<rosbag2_compression::BaseDecryptorInterface>
+EncryptionFactory::create_decryptor(
+  const std::string & encryption_format, const std::vector<uint8_t> & key)
+{
+  if (case_insensitive_compare(encryption_format, kEncryptionFormatAesGcm)) {
+    return std::make_unique<rosbag2_compression::AesGcmDecryptor>(key);
+  }
+  throw_unsupported_format(encryption_format);
+}
+
+}  // namespace rosbag2_compression
@@ -0,0 +1,155 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/encryption_keys.hpp"
+
+#include "aes_gcm_cipher.hpp"
+
+namespace rosbag2_compression
+{
+
+namespace
+{
+constexpr const char kHexDigits[] = "0123456789abcdef";
+// Number of bytes of the hash of a key which make up its id.
+constexpr const size_t kKeyIdSize = 8;
+
+std::string to_hex(const uint8_t * data, size_t size)
+{
+  std::string hex;
+  hex.reserve(2 * size);
+  for (size_t i = 0; i < size; ++i) {
+    hex.push_back(kHexDigits[data[i] >> 4]);
+    hex.push_back(kHexDigits[data[i] & 0xFu]);
+  }
+  return hex;
+}
+
+int from_hex_digit(char digit)
+{
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  }
+  const auto lower = std::tolower(static_cast<unsigned char>(digit));
+  if (lower >= 'a' && lower <= 'f') {
+    return lower - 'a' + 10;
+  }
+  return -1;
+}
+
+// Returns false if the string is not made of pairs of hexadecimal digits.
+bool from_hex(const std::string & hex, std::vector<uint8_t> & data)
+{
+  if (hex.size() % 2 != 0) {
+    return false;
+  }
+  data.resize(hex.size() / 2);
+  for (size_t i = 0; i < data.size(); ++i) {
+    const auto high = from_hex_digit(hex[2 * i]);
+    const auto low = from_hex_digit(hex[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    data[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  return true;
+}
+}  // namespace
+
+std::vector<uint8_t> read_encryption_key_file(const std::string & path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error{"Could not open the encryption key file \"" + path + "\"."};
+  }
+  std::string contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  if (contents.size() == kAesGcmKeySize) {
+    return std::vector<uint8_t>(contents.begin(), contents.end());
+  }
+
+  // Keys in hexadecimal usually end with a line break.
+  while (!contents.empty() && std::isspace(static_cast<unsigned char>(contents.back()))) {
+    contents.pop_back();
+  }
+  std::vector<uint8_t> key;
+  if (contents.size() != 2 * kAesGcmKeySize || !from_hex(contents, key)) {
+    throw std::runtime_error{
+            "The encryption key file \"" + path + "\" holds neither " +
+            std::to_string(kAesGcmKeySize) + " bytes nor " + std::to_string(2 * kAesGcmKeySize) +
+            " hexadecimal digits."};
+  }
+  return key;
+}
+
+std::vector<uint8_t> generate_encryption_key()
+{
+  std::vector<uint8_t> key(kAesGcmKeySize);
+  if (RAND_bytes(key.data(), static_cast<int>(key.size())) != 1) {
+    throw std::runtime_error{"Could not generate an encryption key."};
+  }
+  return key;
+}
+
+std::string get_encryption_key_id(const std::vector<uint8_t> & key)
+{
+  uint8_t hash[EVP_MAX_MD_SIZE];
+  unsigned int hash_size = 0;
+  if (EVP_Digest(key.data(), key.size(), hash, &hash_size, EVP_sha256(), nullptr) != 1) {
+    throw std::runtime_error{"Could not hash the encryption key."};
+  }
+  return to_hex(hash, kKeyIdSize);
+}
+
+std::string encrypt_key(const std::vector<uint8_t> & key, const std::vector<uint8_t> & master_key)
+{
+  // Laid out like the messages: the encrypted key followed by the nonce and the tag.
+  std::vector<uint8_t> encrypted_key(key.size() + kAesGcmNonceSize + kAesGcmTagSize);
+  const auto nonce = encrypted_key.data() + key.size();
+  if (RAND_bytes(nonce, static_cast<int>(kAesGcmNonceSize)) != 1) {
+    throw std::runtime_error{"Could not generate the nonce of the encrypted key."};
+  }
+  AesGcmCipher{master_key, true}.seal(
+    nonce, {}, key.data(), key.size(), encrypted_key.data(), nonce + kAesGcmNonceSize);
+  return to_hex(encrypted_key.data(), encrypted_key.size());
+}
+
+std::vector<uint8_t> decrypt_key(
+  const std::string & encrypted_key, const std::vector<uint8_t> & master_key)
+{
+  std::vector<uint8_t> key;
+  if (!from_hex(encrypted_key, key) || key.size() < kAesGcmNonceSize + kAesGcmTagSize) {
+    throw std::runtime_error{"The encrypted key of the bag is malformed."};
+  }
+  const auto size = key.size() - kAesGcmNonceSize - kAesGcmTagSize;
+  const auto nonce = key.data() + size;
+  std::vector<uint8_t> decrypted_key(size);
+  if (!AesGcmCipher{master_key, false}.open(
+      nonce, {}, key.data(), size, nonce + kAesGcmNonceSize, decrypted_key.data()))
+  {
+    throw std::runtime_error{"The key of the bag could not be decrypted with the given key."};
+  }
+  return decrypted_key;
+}
+
+}  // namespace rosbag2_compression
@@ -0,0 +1,92 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/image_compressor.hpp"
+
+#include "image_frame.hpp"
+#include "magic_number.hpp"
+
+namespace
+{
+
+// String constant used to identify ImageCompressor.
+constexpr const char kCompressionIdentifier[] = "image";
+// Topic type whose messages are filtered before compressing them.
+constexpr const char kImageTopicType[] = "sensor_msgs/msg/Image";
+
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+std::string ImageCompressor::compress_uri(const std::string & uri)
+{
+  return zstd_compressor_.compress_uri(uri);
+}
+
+void ImageCompressor::compress_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot compress message without serialized data."};
+  }
+  ImageRows image_rows{0, 0, 0};
+  if (image_topics_.count(bag_message->topic_name) > 0 &&
+    find_image_rows(*bag_message->serialized_data, image_rows))
+  {
+    filter_image_rows(bag_message->serialized_data->buffer, image_rows);
+  } else {
+    image_rows = ImageRows{0, 0, 0};
+  }
+  zstd_compressor_.compress_serialized_bag_message(bag_message);
+  prepend_image_frame_header(*bag_message->serialized_data, image_rows);
+}
+
+std::string ImageCompressor::get_compression_identifier() const
+{
+  return kCompressionIdentifier;
+}
+
+bool ImageCompressor::can_store_uncompressed(
+  const rosbag2_storage::SerializedBagMessage & bag_message) const
+{
+  // Messages starting like a frame would be mistaken for compressed ones by the reader.
+  return !starts_with_magic_number(bag_message, kImageFrameMagicNumber);
+}
+
+void ImageCompressor::set_compression_options(const CompressionOptions & compression_options)
+{
+  zstd_compressor_.set_compression_options(compression_options);
+}
+
+void ImageCompressor::register_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  if (topic.type == kImageTopicType) {
+    image_topics_.insert(topic.name);
+  } else {
+    image_topics_.erase(topic.name);
+  }
+  zstd_compressor_.register_topic(topic);
+}
+
+std::vector<std::string> ImageCompressor::write_dictionaries(const std::string & directory)
+{
+  return zstd_compressor_.write_dictionaries(directory);
+}
+
+}  // namespace rosbag2_compression
@@ -0,0 +1,109 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/image_decompressor.hpp"
+
+#include "image_frame.hpp"
+#include "magic_number.hpp"
+
+namespace
+{
+
+// String constant used to identify ImageDecompressor.
+constexpr const char kDecompressionIdentifier[] = "image";
+
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+std::string ImageDecompressor::decompress_uri(const std::string & uri)
+{
+  return zstd_decompressor_.decompress_uri(uri);
+}
+
+std::string ImageDecompressor::decompress_uri_to_directory(
+  const std::string & uri, const std::string & directory)
+{
+  return zstd_decompressor_.decompress_uri_to_directory(uri, directory);
+}
+
+void ImageDecompressor::decompress_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot decompress message without serialized data."};
+  }
+  if (!is_compressed_message(*bag_message) ||
+    bag_message->serialized_data->buffer_length < kImageFrameHeaderSize)
+  {
+    std::stringstream errmsg;
+    errmsg << "Message of topic \"" << bag_message->topic_name << "\" is not an image frame!";
+    throw std::runtime_error{errmsg.str()};
+  }
+
+  auto & serialized_data = *bag_message->serialized_data;
+  const auto image_rows = read_image_frame_header(serialized_data.buffer);
+  serialized_data.buffer_length -= kImageFrameHeaderSize;
+  std::memmove(
+    serialized_data.buffer, serialized_data.buffer + kImageFrameHeaderSize,
+    serialized_data.buffer_length);
+  zstd_decompressor_.decompress_serialized_bag_message(bag_message);
+
+  if (image_rows.rows == 0) {
+    return;
+  }
+  const auto & decompressed_data = *bag_message->serialized_data;
+  if (image_rows.data_offset > decompressed_data.buffer_length ||
+    static_cast<uint64_t>(image_rows.step) * image_rows.rows >
+    decompressed_data.buffer_length - image_rows.data_offset)
+  {
+    std::stringstream errmsg;
+    errmsg << "Image rows of a message of topic \"" << bag_message->topic_name <<
+      "\" exceed the message!";
+    throw std::runtime_error{errmsg.str()};
+  }
+  unfilter_image_rows(decompressed_data.buffer, image_rows);
+}
+
+std::string ImageDecompressor::get_decompression_identifier() const
+{
+  return kDecompressionIdentifier;
+}
+
+bool ImageDecompressor::is_compressed_message(
+  const rosbag2_storage::SerializedBagMessage & bag_message) const
+{
+  return starts_with_magic_number(bag_message, kImageFrameMagicNumber);
+}
+
+void ImageDecompressor::load_dictionaries(const std::vector<std::string> & uris)
+{
+  zstd_decompressor_.load_dictionaries(uris);
+}
+
+bool ImageDecompressor::share_dictionaries(const BaseDecompressorInterface & other)
+{
+  const auto image_decompressor = dynamic_cast<const ImageDecompressor *>(&other);
+  return image_decompressor &&
+         zstd_decompressor_.share_dictionaries(image_decompressor->zstd_decompressor_);
+}
+
+}  // namespace rosbag2_compression
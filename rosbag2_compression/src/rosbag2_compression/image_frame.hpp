@@ -0,0 +1,172 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__IMAGE_FRAME_HPP_
+#define ROSBAG2_COMPRESSION__IMAGE_FRAME_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "rcutils/error_handling.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "magic_number.hpp"
+
+namespace rosbag2_compression
+{
+
+// Frames of the image compression format start with a header of four little endian uint32: the
+// magic number, and the offset, step and row count of the pixel data in the serialized message,
+// whose rows were replaced by their difference to the previous row. A row count of zero means
+// the message was not filtered. The header is followed by a zstd frame of the message.
+constexpr const size_t kImageFrameHeaderSize = 4 * sizeof(uint32_t);
+
+// Location of the rows of pixel data in a serialized sensor_msgs/msg/Image.
+struct ImageRows
+{
+  uint32_t data_offset;
+  uint32_t step;
+  uint32_t rows;
+};
+
+// Finds the pixel data of a sensor_msgs/msg/Image serialized as plain CDR of either endianness.
+// Returns false if the data is not such a message or has fewer than two rows.
+inline bool find_image_rows(const rcutils_uint8_array_t & data, ImageRows & image_rows)
+{
+  // The encapsulation header names the endianness, and alignment is relative to its end.
+  constexpr size_t kEncapsulationSize = 4;
+  if (data.buffer_length < kEncapsulationSize || data.buffer[0] != 0 || data.buffer[1] > 1) {
+    return false;
+  }
+  const bool little_endian = data.buffer[1] == 1;
+  size_t position = kEncapsulationSize;
+  const auto read_uint32 = [&data, &position, little_endian](uint32_t & value) {
+      position += (4 - (position - kEncapsulationSize) % 4) % 4;
+      if (position + 4 > data.buffer_length) {
+        return false;
+      }
+      const auto bytes = data.buffer + position;
+      value = little_endian ?
+        static_cast<uint32_t>(bytes[0] | bytes[1] << 8 | bytes[2] << 16 | bytes[3] << 24) :
+        static_cast<uint32_t>(bytes[3] | bytes[2] << 8 | bytes[1] << 16 | bytes[0] << 24);
+      position += 4;
+      return true;
+    };
+  const auto skip_string = [&data, &position, &read_uint32]() {
+      uint32_t length = 0;
+      if (!read_uint32(length) || length > data.buffer_length - position) {
+        return false;
+      }
+      position += length;
+      return true;
+    };
+
+  uint32_t unused = 0;
+  uint32_t height = 0;
+  uint32_t data_length = 0;
+  // header.stamp, header.frame_id, height, width, encoding, is_bigendian, step and data.
+  if (!read_uint32(unused) || !read_uint32(unused) || !skip_string() ||
+    !read_uint32(height) || !read_uint32(unused) || !skip_string())
+  {
+    return false;
+  }
+  position += 1;
+  if (!read_uint32(image_rows.step) || !read_uint32(data_length)) {
+    return false;
+  }
+  image_rows.data_offset = static_cast<uint32_t>(position);
+  image_rows.rows = height;
+  return height > 1 && image_rows.step > 0 &&
+         static_cast<uint64_t>(image_rows.step) * height == data_length &&
+         data_length <= data.buffer_length - position;
+}
+
+// Replaces every row but the first by its difference to the previous row, which leaves mostly
+// small values in smooth images. The loops over the bytes of a row are vectorized by compilers.
+inline void filter_image_rows(uint8_t * data, const ImageRows & image_rows)
+{
+  uint8_t * pixels = data + image_rows.data_offset;
+  for (size_t row = image_rows.rows - 1; row > 0; --row) {
+    uint8_t * current = pixels + row * image_rows.step;
+    const uint8_t * previous = current - image_rows.step;
+    for (size_t i = 0; i < image_rows.step; ++i) {
+      current[i] = static_cast<uint8_t>(current[i] - previous[i]);
+    }
+  }
+}
+
+// Restores the rows replaced by filter_image_rows.
+inline void unfilter_image_rows(uint8_t * data, const ImageRows & image_rows)
+{
+  uint8_t * pixels = data + image_rows.data_offset;
+  for (size_t row = 1; row < image_rows.rows; ++row) {
+    uint8_t * current = pixels + row * image_rows.step;
+    const uint8_t * previous = current - image_rows.step;
+    for (size_t i = 0; i < image_rows.step; ++i) {
+      current[i] = static_cast<uint8_t>(current[i] + previous[i]);
+    }
+  }
+}
+
+inline void write_image_frame_header(uint8_t * header, const ImageRows & image_rows)
+{
+  const uint32_t fields[] = {
+    kImageFrameMagicNumber, image_rows.data_offset, image_rows.step, image_rows.rows};
+  for (size_t field = 0; field < 4; ++field) {
+    for (size_t byte = 0; byte < 4; ++byte) {
+      header[field * 4 + byte] = static_cast<uint8_t>(fields[field] >> (8 * byte));
+    }
+  }
+}
+
+// Puts the header in front of the zstd frame of a message, usually within its buffer.
+inline void prepend_image_frame_header(
+  rcutils_uint8_array_t & serialized_data, const ImageRows & image_rows)
+{
+  const auto compressed_length = serialized_data.buffer_length;
+  if (serialized_data.buffer_capacity < compressed_length + kImageFrameHeaderSize) {
+    if (rcutils_uint8_array_resize(
+        &serialized_data, compressed_length + kImageFrameHeaderSize) != RCUTILS_RET_OK)
+    {
+      std::stringstream errmsg;
+      errmsg << "Unable to resize serialized message: " << rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error{errmsg.str()};
+    }
+  }
+  std::memmove(
+    serialized_data.buffer + kImageFrameHeaderSize, serialized_data.buffer, compressed_length);
+  write_image_frame_header(serialized_data.buffer, image_rows);
+  serialized_data.buffer_length = compressed_length + kImageFrameHeaderSize;
+}
+
+// Reads the rows of a header written by write_image_frame_header, without the magic number.
+inline ImageRows read_image_frame_header(const uint8_t * header)
+{
+  const auto read_field = [header](size_t field) {
+      uint32_t value = 0;
+      for (size_t byte = 0; byte < 4; ++byte) {
+        value |= static_cast<uint32_t>(header[field * 4 + byte]) << (8 * byte);
+      }
+      return value;
+    };
+  return {read_field(1), read_field(2), read_field(3)};
+}
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__IMAGE_FRAME_HPP_
@@ -0,0 +1,342 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <lz4frame.h>
+#include <lz4hc.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rcutils/error_handling.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_compression/lz4_compressor.hpp"
+
+#include "logging.hpp"
+#include "magic_number.hpp"
+
+namespace
+{
+
+// String constants used to identify Lz4Compressor.
+constexpr const char kCompressionIdentifier[] = "lz4";
+constexpr const char kHighCompressionIdentifier[] = "lz4hc";
+// Extension of compressed files, which are decompressed alike for both variants.
+constexpr const char kFileExtension[] = "lz4";
+// Size of the chunks files are read and compressed in.
+constexpr const size_t kInputChunkSize = 64 * 1024;
+
+/**
+ * Open a file using the OS-specific C API.
+ * \param uri is the path to the file.
+ * \param read_mode is the read mode accepted by OS-specific fopen.
+ * \return the FILE pointer or nullptr if the file was not opened.
+ */
+FILE * open_file(const std::string & uri, const std::string & read_mode)
+{
+  FILE * fp{nullptr};
+#ifdef _WIN32
+  fopen_s(&fp, uri.c_str(), read_mode.c_str());
+#else
+  fp = std::fopen(uri.c_str(), read_mode.c_str());
+#endif
+  return fp;
+}
+
+using FilePointer = std::unique_ptr<FILE, decltype(&std::fclose)>;
+
+/**
+ * Open a file for binary reading or writing.
+ * \param uri is the path to the file.
+ * \param read_mode is the read mode accepted by OS-specific fopen.
+ * \return the FILE pointer, which closes the file when destroyed.
+ * \throws std::runtime_error if the file could not be opened.
+ */
+FilePointer open_binary_file(const std::string & uri, const std::string & read_mode)
+{
+  auto file_pointer = FilePointer{open_file(uri, read_mode), &std::fclose};
+  if (file_pointer == nullptr) {
+    std::stringstream errmsg;
+    errmsg << "Error opening file: \"" << uri <<
+      "\" for binary " << (read_mode == "rb" ? "reading" : "writing") <<
+      "! errno(" << errno << ")";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+  return file_pointer;
+}
+
+/**
+ * Writes a chunk of compressed data to a file.
+ * \param chunk is the data to write.
+ * \param chunk_size is the number of bytes to write.
+ * \param file_pointer is the file to write to.
+ * \param uri is the relative file path to the output storage.
+ */
+void write_output_chunk(
+  const uint8_t * chunk, size_t chunk_size, FILE * file_pointer, const std::string & uri)
+{
+  const auto write_count = fwrite(chunk, sizeof(uint8_t), chunk_size, file_pointer);
+
+  if (write_count != chunk_size) {
+    ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
+      "Bytes written (" << write_count << ") != chunk size (" << chunk_size << ")!");
+    // An error indicator is set by fwrite, so the following check will throw.
+  }
+
+  if (ferror(file_pointer)) {
+    std::stringstream errmsg;
+    errmsg << "Unable to write compressed data to file: \"" << uri << "\"!";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+}
+
+/**
+ * Checks the result of an LZ4F function and throws a runtime_error if there was an LZ4 error.
+ * \param result is the return value of the LZ4F function.
+ * \return the result, if it is not an error.
+ */
+size_t throw_on_lz4_error(const size_t result)
+{
+  if (LZ4F_isError(result)) {
+    std::stringstream error;
+    error << "LZ4 compression error: " << LZ4F_getErrorName(result);
+    throw std::runtime_error{error.str()};
+  }
+  return result;
+}
+
+void free_compression_context(LZ4F_cctx * context)
+{
+  LZ4F_freeCompressionContext(context);
+}
+
+LZ4F_cctx * create_compression_context()
+{
+  LZ4F_cctx * context = nullptr;
+  if (LZ4F_isError(LZ4F_createCompressionContext(&context, LZ4F_VERSION))) {
+    throw std::runtime_error{"Unable to create LZ4 compression context."};
+  }
+  return context;
+}
+
+/**
+ * Prints compression statistics to the debug log stream.
+ * The log statement is formatted in JSON.
+ * Time is formatted as a decimal of seconds.
+ *
+ * Example:
+ *   "Compression statistics: {"Time" : 1.2, "Compression Ratio" : 0.5}
+ */
+void print_compression_statistics(
+  std::chrono::high_resolution_clock::time_point start,
+  std::chrono::high_resolution_clock::time_point end,
+  size_t decompressed_size, size_t compressed_size)
+{
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  const auto compression_ratio =
+    static_cast<double>(decompressed_size) / static_cast<double>(compressed_size);
+  ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM(
+    "\"Compression statistics\" : {" <<
+      "\"Time\" : " << (duration.count() / 1000.0) <<
+      ", \"Compression Ratio\" : " << compression_ratio <<
+      "}"
+  );
+}
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+Lz4Compressor::Lz4Compressor(bool high_compression)
+: high_compression_(high_compression),
+  // Zero selects the default level of either variant.
+  compression_level_(0),
+  lz4_context_(create_compression_context(), &free_compression_context)
+{}
+
+std::string Lz4Compressor::compress_uri(const std::string & uri)
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+  const auto compressed_uri = uri + "." + kFileExtension;
+
+  const auto file_path = rcpputils::fs::path{uri};
+  const auto decompressed_size = file_path.exists() ? file_path.file_size() : 0u;
+  if (decompressed_size == 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to get size of file: \"" << uri << "\"";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+
+  LZ4F_preferences_t preferences{};
+  preferences.compressionLevel = compression_level_;
+  preferences.frameInfo.contentSize = decompressed_size;
+
+  const auto input_file = open_binary_file(uri, "rb");
+  auto output_file = open_binary_file(compressed_uri, "wb");
+  size_t compressed_size = 0;
+  try {
+    // The file is compressed in chunks, so memory use does not depend on the file size.
+    std::vector<uint8_t> input_chunk(kInputChunkSize);
+    // Large enough for the frame header, any chunk, and the end of the frame.
+    std::vector<uint8_t> output_chunk(LZ4F_compressBound(input_chunk.size(), &preferences));
+
+    auto output_size = throw_on_lz4_error(
+      LZ4F_compressBegin(
+        lz4_context_.get(), output_chunk.data(), output_chunk.size(), &preferences));
+    write_output_chunk(output_chunk.data(), output_size, output_file.get(), compressed_uri);
+    compressed_size += output_size;
+
+    size_t read_size = 0;
+    size_t read_count = 0;
+    // The file is expected to have the size stored above, even if it is still growing.
+    while (read_size < decompressed_size &&
+      (read_count = fread(
+        input_chunk.data(), sizeof(uint8_t),
+        std::min<size_t>(input_chunk.size(), decompressed_size - read_size),
+        input_file.get())) > 0)
+    {
+      read_size += read_count;
+      output_size = throw_on_lz4_error(
+        LZ4F_compressUpdate(
+          lz4_context_.get(), output_chunk.data(), output_chunk.size(),
+          input_chunk.data(), read_count, nullptr));
+      write_output_chunk(output_chunk.data(), output_size, output_file.get(), compressed_uri);
+      compressed_size += output_size;
+    }
+    if (ferror(input_file.get())) {
+      std::stringstream errmsg;
+      errmsg << "Unable to read binary data from file: \"" << uri << "\"!";
+
+      throw std::runtime_error{errmsg.str()};
+    }
+
+    output_size = throw_on_lz4_error(
+      LZ4F_compressEnd(lz4_context_.get(), output_chunk.data(), output_chunk.size(), nullptr));
+    write_output_chunk(output_chunk.data(), output_size, output_file.get(), compressed_uri);
+    compressed_size += output_size;
+  } catch (...) {
+    // Do not leave a partially compressed file behind.
+    output_file.reset();
+    rcpputils::fs::remove(rcpputils::fs::path{compressed_uri});
+    throw;
+  }
+  if (std::fclose(output_file.release()) != 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to write compressed data to file: \"" << compressed_uri << "\"!";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+
+  const auto end = std::chrono::high_resolution_clock::now();
+  print_compression_statistics(start, end, decompressed_size, compressed_size);
+  return compressed_uri;
+}
+
+void Lz4Compressor::compress_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot compress message without serialized data."};
+  }
+  auto & serialized_data = *bag_message->serialized_data;
+
+  // The frame stores the message size, so the decompressor can allocate the buffer at once.
+  LZ4F_preferences_t preferences{};
+  preferences.compressionLevel = compression_level_;
+  preferences.frameInfo.contentSize = serialized_data.buffer_length;
+  preferences.autoFlush = 1;
+
+  // The buffer only grows, so messages of similar size are compressed without allocating.
+  const auto compressed_buffer_length =
+    LZ4F_compressFrameBound(serialized_data.buffer_length, &preferences);
+  if (compressed_buffer_.size() < compressed_buffer_length) {
+    compressed_buffer_.resize(compressed_buffer_length);
+  }
+
+  // Reusing the context avoids allocating the compression state for every message.
+  const auto buffer = compressed_buffer_.data();
+  const auto capacity = compressed_buffer_.size();
+  auto compressed_size = throw_on_lz4_error(
+    LZ4F_compressBegin(lz4_context_.get(), buffer, capacity, &preferences));
+  compressed_size += throw_on_lz4_error(
+    LZ4F_compressUpdate(
+      lz4_context_.get(), buffer + compressed_size, capacity - compressed_size,
+      serialized_data.buffer, serialized_data.buffer_length, nullptr));
+  compressed_size += throw_on_lz4_error(
+    LZ4F_compressEnd(
+      lz4_context_.get(), buffer + compressed_size, capacity - compressed_size, nullptr));
+
+  // The compressed data usually fits into the buffer of the message, which is then reused.
+  if (serialized_data.buffer_capacity < compressed_size) {
+    if (rcutils_uint8_array_resize(&serialized_data, compressed_size) != RCUTILS_RET_OK) {
+      std::stringstream errmsg;
+      errmsg << "Unable to resize serialized message: " << rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error{errmsg.str()};
+    }
+  }
+  std::memcpy(serialized_data.buffer, buffer, compressed_size);
+  serialized_data.buffer_length = compressed_size;
+}
+
+std::string Lz4Compressor::get_compression_identifier() const
+{
+  return high_compression_ ? kHighCompressionIdentifier : kCompressionIdentifier;
+}
+
+bool Lz4Compressor::can_store_uncompressed(
+  const rosbag2_storage::SerializedBagMessage & bag_message) const
+{
+  // Messages starting like a frame would be mistaken for compressed ones by the reader.
+  return !starts_with_magic_number(bag_message, kLz4FrameMagicNumber);
+}
+
+void Lz4Compressor::set_compression_options(const CompressionOptions & compression_options)
+{
+  // LZ4F compresses with LZ4 below LZ4HC_CLEVEL_MIN and with LZ4-HC from it on.
+  const auto level = compression_options.compression_level;
+  if (high_compression_) {
+    compression_level_ = level < LZ4HC_CLEVEL_MIN ?
+      LZ4HC_CLEVEL_DEFAULT : std::min(level, LZ4HC_CLEVEL_MAX);
+  } else {
+    // Negative levels are accelerations, trading compression ratio for speed.
+    compression_level_ = std::min(level, 0);
+  }
+
+  if (compression_options.compression_worker_threads > 0) {
+    ROSBAG2_COMPRESSION_LOG_WARN(
+      "LZ4 does not support compression worker threads, compressing on the calling thread.");
+  }
+  if (compression_options.dictionary_training_messages > 0 ||
+    !compression_options.compression_dictionary.empty())
+  {
+    ROSBAG2_COMPRESSION_LOG_WARN(
+      "LZ4 does not support compression dictionaries, compressing without dictionary.");
+  }
+}
+
+}  // namespace rosbag2_compression
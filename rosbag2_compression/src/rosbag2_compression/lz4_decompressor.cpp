@@ -0,0 +1,352 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <lz4frame.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rcutils/error_handling.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_compression/lz4_decompressor.hpp"
+
+#include "logging.hpp"
+#include "magic_number.hpp"
+
+namespace
+{
+
+// String constant used to identify Lz4Decompressor.
+constexpr const char kDecompressionIdentifier[] = "lz4";
+// Size of the chunks files are read and decompressed in.
+constexpr const size_t kInputChunkSize = 64 * 1024;
+constexpr const size_t kOutputChunkSize = 256 * 1024;
+
+/**
+ * Open a file using the C API.
+ * This function calls OS-specific implementation of fopen.
+ *
+ * \param uri is the path to the file
+ * \param read_mode is the read mode string accepted by fopen.
+ * \return the FILE pointer or nullptr if the file was not opened.
+ */
+FILE * open_file(const std::string & uri, const std::string & read_mode)
+{
+  FILE * fp{nullptr};
+#ifdef _WIN32
+  fopen_s(&fp, uri.c_str(), read_mode.c_str());
+#else
+  fp = std::fopen(uri.c_str(), read_mode.c_str());
+#endif
+  return fp;
+}
+
+using FilePointer = std::unique_ptr<FILE, decltype(&std::fclose)>;
+
+/**
+ * Open a file for binary reading or writing.
+ *
+ * \param uri is the path to the file.
+ * \param read_mode is the read mode string accepted by fopen.
+ * \return the FILE pointer, which closes the file when destroyed.
+ * \throws std::runtime_error if the file could not be opened.
+ */
+FilePointer open_binary_file(const std::string & uri, const std::string & read_mode)
+{
+  auto file_pointer = FilePointer{open_file(uri, read_mode), &std::fclose};
+  if (file_pointer == nullptr) {
+    std::stringstream errmsg;
+    errmsg << "Failed to open file: \"" << uri <<
+      "\" for binary " << (read_mode == "rb" ? "reading" : "writing") <<
+      "! errno(" << errno << ")";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+  return file_pointer;
+}
+
+/**
+ * Path of the file a file is decompressed to, which is named like the file without its
+ * compression extension.
+ * \param uri_path is the path to the compressed file.
+ * \param directory is the directory to decompress to, or empty for the directory of uri_path.
+ * \throws std::runtime_error if the directory does not exist.
+ */
+std::string get_decompressed_uri(
+  const rcpputils::fs::path & uri_path, const std::string & directory)
+{
+  const auto decompressed_path = rcpputils::fs::remove_extension(uri_path);
+  if (directory.empty()) {
+    return decompressed_path.string();
+  }
+  const auto directory_path = rcpputils::fs::path{directory};
+  if (!directory_path.is_directory()) {
+    std::stringstream errmsg;
+    errmsg << "Decompression directory: \"" << directory << "\" does not exist!";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+  return (directory_path / decompressed_path.filename()).string();
+}
+
+/**
+ * Writes a chunk of decompressed data to a file.
+ * \param chunk is the data to write.
+ * \param chunk_size is the number of bytes to write.
+ * \param file_pointer is the file to write to.
+ * \param uri is the relative file path to the output storage.
+ */
+void write_output_chunk(
+  const uint8_t * chunk, size_t chunk_size, FILE * file_pointer, const std::string & uri)
+{
+  const auto write_count = fwrite(chunk, sizeof(uint8_t), chunk_size, file_pointer);
+
+  if (write_count != chunk_size) {
+    ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
+      "Bytes written (" << write_count << ") != chunk size (" << chunk_size << ")!");
+    // An error indicator is set by fwrite, so the following check will throw.
+  }
+
+  if (ferror(file_pointer)) {
+    std::stringstream errmsg;
+    errmsg << "Unable to write decompressed data to file: \"" << uri << "\"!";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+}
+
+/**
+ * Checks the result of an LZ4F function and throws a runtime_error if there was an LZ4 error.
+ * \param result is the return value of the LZ4F function.
+ * \return the result, if it is not an error.
+ */
+size_t throw_on_lz4_error(const size_t result)
+{
+  if (LZ4F_isError(result)) {
+    std::stringstream error;
+    error << "LZ4 decompression error: " << LZ4F_getErrorName(result);
+
+    throw std::runtime_error{error.str()};
+  }
+  return result;
+}
+
+void free_decompression_context(LZ4F_dctx * context)
+{
+  LZ4F_freeDecompressionContext(context);
+}
+
+LZ4F_dctx * create_decompression_context()
+{
+  LZ4F_dctx * context = nullptr;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION))) {
+    throw std::runtime_error{"Unable to create LZ4 decompression context."};
+  }
+  return context;
+}
+
+/**
+ * Prints decompression statistics to the debug log stream.
+ * The log statement is formatted as JSON.
+ * Time is formatted as a decimal of seconds.
+ *
+ * Example:
+ *  "Decompression statistics" : {"Time" : 1.2, "Compression Ratio" : 0.5}
+ *
+ * \param start is the time_point when compression started.
+ * \param end is the time_point when compression ended.
+ * \param decompressed_size is the file size after decompression
+ * \param compressed_size is the compressed file size
+ */
+void print_decompression_statistics(
+  const std::chrono::high_resolution_clock::time_point start,
+  const std::chrono::high_resolution_clock::time_point end,
+  const size_t decompressed_size,
+  const size_t compressed_size)
+{
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  const auto decompression_ratio =
+    static_cast<double>(decompressed_size) / static_cast<double>(compressed_size);
+
+  ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM(
+    "\"Decompression statistics\" : {" <<
+      "\"Time\" : " << (duration.count() / 1000.0) <<
+      ", \"Decompression Ratio\" : " << decompression_ratio <<
+      "}");
+}
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+Lz4Decompressor::Lz4Decompressor()
+: lz4_context_(create_decompression_context(), &free_decompression_context)
+{}
+
+std::string Lz4Decompressor::decompress_uri(const std::string & uri)
+{
+  return decompress_uri_to_directory(uri, "");
+}
+
+std::string Lz4Decompressor::decompress_uri_to_directory(
+  const std::string & uri, const std::string & directory)
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+  const auto uri_path = rcpputils::fs::path{uri};
+  const auto decompressed_uri = get_decompressed_uri(uri_path, directory);
+
+  const auto compressed_size = uri_path.exists() ? uri_path.file_size() : 0u;
+  if (compressed_size == 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to get size of file: \"" << uri << "\"";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+
+  const auto input_file = open_binary_file(uri, "rb");
+  auto output_file = open_binary_file(decompressed_uri, "wb");
+  size_t decompressed_size = 0;
+  try {
+    // The file is decompressed in chunks, so memory use does not depend on the file size.
+    LZ4F_resetDecompressionContext(lz4_context_.get());
+
+    std::vector<uint8_t> input_chunk(kInputChunkSize);
+    std::vector<uint8_t> output_chunk(kOutputChunkSize);
+    // Zero once a frame is completely decoded and flushed.
+    size_t last_result = 0;
+    size_t read_count = 0;
+    while ((read_count = fread(
+        input_chunk.data(), sizeof(uint8_t), input_chunk.size(), input_file.get())) > 0)
+    {
+      size_t input_position = 0;
+      while (input_position < read_count) {
+        size_t input_size = read_count - input_position;
+        size_t output_size = output_chunk.size();
+        last_result = throw_on_lz4_error(
+          LZ4F_decompress(
+            lz4_context_.get(), output_chunk.data(), &output_size,
+            input_chunk.data() + input_position, &input_size, nullptr));
+        write_output_chunk(output_chunk.data(), output_size, output_file.get(), decompressed_uri);
+        decompressed_size += output_size;
+        input_position += input_size;
+      }
+    }
+
+    if (ferror(input_file.get())) {
+      std::stringstream errmsg;
+      errmsg << "Unable to read binary data from file: \"" << uri << "\"!";
+
+      throw std::runtime_error{errmsg.str()};
+    }
+    if (last_result != 0) {
+      std::stringstream errmsg;
+      errmsg << "Compressed file: \"" << uri << "\" is truncated!";
+
+      throw std::runtime_error{errmsg.str()};
+    }
+  } catch (...) {
+    // Do not leave a partially decompressed file behind.
+    output_file.reset();
+    rcpputils::fs::remove(rcpputils::fs::path{decompressed_uri});
+    throw;
+  }
+  if (std::fclose(output_file.release()) != 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to write decompressed data to file: \"" << decompressed_uri << "\"!";
+
+    throw std::runtime_error{errmsg.str()};
+  }
+
+  const auto end = std::chrono::high_resolution_clock::now();
+  print_decompression_statistics(start, end, decompressed_size, compressed_size);
+
+  return decompressed_uri;
+}
+
+void Lz4Decompressor::decompress_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot decompress message without serialized data."};
+  }
+  auto & serialized_data = *bag_message->serialized_data;
+
+  // The message buffer receives the decompressed data, so the smaller compressed data is
+  // copied aside. The copy only grows, so it is rarely allocated.
+  compressed_buffer_.assign(
+    serialized_data.buffer, serialized_data.buffer + serialized_data.buffer_length);
+
+  // A frame left unfinished by a previous error must not affect this message.
+  LZ4F_resetDecompressionContext(lz4_context_.get());
+  LZ4F_frameInfo_t frame_info{};
+  size_t input_position = compressed_buffer_.size();
+  throw_on_lz4_error(
+    LZ4F_getFrameInfo(
+      lz4_context_.get(), &frame_info, compressed_buffer_.data(), &input_position));
+
+  // The compressor stores the size of every message in the frame.
+  const auto decompressed_buffer_length = static_cast<size_t>(frame_info.contentSize);
+  if (serialized_data.buffer_capacity < decompressed_buffer_length) {
+    if (rcutils_uint8_array_resize(
+        &serialized_data, decompressed_buffer_length) != RCUTILS_RET_OK)
+    {
+      std::stringstream errmsg;
+      errmsg << "Unable to resize serialized message: " << rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error{errmsg.str()};
+    }
+  }
+
+  size_t output_position = 0;
+  size_t result = 1;
+  while (result != 0) {
+    size_t input_size = compressed_buffer_.size() - input_position;
+    size_t output_size = serialized_data.buffer_capacity - output_position;
+    result = throw_on_lz4_error(
+      LZ4F_decompress(
+        lz4_context_.get(), serialized_data.buffer + output_position, &output_size,
+        compressed_buffer_.data() + input_position, &input_size, nullptr));
+    if (result != 0 && input_size == 0 && output_size == 0) {
+      std::stringstream errmsg;
+      errmsg << "Compressed message of topic \"" << bag_message->topic_name <<
+        "\" is truncated or larger than stored in its frame!";
+      throw std::runtime_error{errmsg.str()};
+    }
+    input_position += input_size;
+    output_position += output_size;
+  }
+  serialized_data.buffer_length = output_position;
+}
+
+std::string Lz4Decompressor::get_decompression_identifier() const
+{
+  return kDecompressionIdentifier;
+}
+
+bool Lz4Decompressor::is_compressed_message(
+  const rosbag2_storage::SerializedBagMessage & bag_message) const
+{
+  return starts_with_magic_number(bag_message, kLz4FrameMagicNumber);
+}
+
+}  // namespace rosbag2_compression
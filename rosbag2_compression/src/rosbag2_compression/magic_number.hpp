@@ -0,0 +1,51 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_COMPRESSION__MAGIC_NUMBER_HPP_
+#define ROSBAG2_COMPRESSION__MAGIC_NUMBER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+namespace rosbag2_compression
+{
+
+// Magic number starting LZ4 frames, which lz4frame.h does not declare.
+constexpr const uint32_t kLz4FrameMagicNumber = 0x184D2204;
+
+// Magic number starting the frames of the image compression format, "RIMG" in little endian.
+constexpr const uint32_t kImageFrameMagicNumber = 0x474D4952;
+
+// Checks if the serialized data of a message starts with the little endian magic number of a
+// compressed frame.
+inline bool starts_with_magic_number(
+  const rosbag2_storage::SerializedBagMessage & message, uint32_t magic_number)
+{
+  const auto & data = message.serialized_data;
+  if (!data || data->buffer_length < sizeof(magic_number)) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(magic_number); ++i) {
+    if (data->buffer[i] != static_cast<uint8_t>(magic_number >> (8 * i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace rosbag2_compression
+
+#endif  // ROSBAG2_COMPRESSION__MAGIC_NUMBER_HPP_
@@ -0,0 +1,199 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_compression/message_chunk.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+namespace
+{
+
+template<typename T>
+void append_value(std::vector<uint8_t> & data, const T & value)
+{
+  const auto bytes = reinterpret_cast<const uint8_t *>(&value);
+  data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+// Reads from a serialized chunk and checks that it is not read past its end.
+class ChunkParser
+{
+public:
+  explicit ChunkParser(const rcutils_uint8_array_t & serialized_chunk)
+  : data_(serialized_chunk.buffer), size_(serialized_chunk.buffer_length)
+  {}
+
+  bool at_end() const
+  {
+    return offset_ == size_;
+  }
+
+  template<typename T>
+  T read_value()
+  {
+    T value;
+    std::memcpy(&value, read_bytes(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  const uint8_t * read_bytes(size_t count)
+  {
+    if (size_ - offset_ < count) {
+      throw std::runtime_error{"Message chunk is truncated."};
+    }
+    const auto bytes = data_ + offset_;
+    offset_ += count;
+    return bytes;
+  }
+
+private:
+  const uint8_t * data_;
+  size_t size_;
+  size_t offset_{0};
+};
+
+// Restores the messages of a serialized chunk, whose data is made by make_data(data, length).
+template<typename MakeData>
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> parse_chunk(
+  const rcutils_uint8_array_t & serialized_chunk, rosbag2_storage::MessagePool * message_pool,
+  const MakeData & make_data)
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  ChunkParser parser{serialized_chunk};
+  while (!parser.at_end()) {
+    auto message = message_pool ?
+      message_pool->make_message() : std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    const auto topic_name_length = parser.read_value<uint32_t>();
+    const auto topic_name = reinterpret_cast<const char *>(parser.read_bytes(topic_name_length));
+    message->topic_name.assign(topic_name, topic_name_length);
+    message->time_stamp = parser.read_value<rcutils_time_point_value_t>();
+    message->publish_time_stamp = parser.read_value<rcutils_time_point_value_t>();
+    const auto data_length = static_cast<size_t>(parser.read_value<uint64_t>());
+    message->serialized_data = make_data(parser.read_bytes(data_length), data_length);
+    messages.push_back(std::move(message));
+  }
+  return messages;
+}
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+void MessageChunk::add_message(const rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto topic_name_length = static_cast<uint32_t>(message.topic_name.size());
+  const auto data_length = static_cast<uint64_t>(
+    message.serialized_data ? message.serialized_data->buffer_length : 0u);
+
+  append_value(data_, topic_name_length);
+  data_.insert(data_.end(), message.topic_name.begin(), message.topic_name.end());
+  append_value(data_, message.time_stamp);
+  append_value(data_, message.publish_time_stamp);
+  append_value(data_, data_length);
+  if (data_length > 0) {
+    const auto buffer = message.serialized_data->buffer;
+    data_.insert(data_.end(), buffer, buffer + data_length);
+  }
+
+  if (message_count_ == 0) {
+    start_time_ = message.time_stamp;
+    end_time_ = message.time_stamp;
+  }
+  start_time_ = std::min(start_time_, message.time_stamp);
+  end_time_ = std::max(end_time_, message.time_stamp);
+  ++message_count_;
+}
+
+bool MessageChunk::empty() const
+{
+  return message_count_ == 0;
+}
+
+size_t MessageChunk::get_message_count() const
+{
+  return message_count_;
+}
+
+size_t MessageChunk::get_size() const
+{
+  return data_.size();
+}
+
+rcutils_time_point_value_t MessageChunk::get_start_time() const
+{
+  return start_time_;
+}
+
+rcutils_time_point_value_t MessageChunk::get_end_time() const
+{
+  return end_time_;
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> MessageChunk::release()
+{
+  auto chunk_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  chunk_message->topic_name = kChunkTopicName;
+  chunk_message->time_stamp = end_time_;
+  chunk_message->publish_time_stamp = start_time_;
+  chunk_message->serialized_data = rosbag2_storage::make_serialized_message(
+    data_.data(), data_.size());
+
+  // The capacity is kept for the next chunk.
+  data_.clear();
+  message_count_ = 0;
+  start_time_ = 0;
+  end_time_ = 0;
+  return chunk_message;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> MessageChunk::parse(
+  const rcutils_uint8_array_t & serialized_chunk, rosbag2_storage::MessagePool * message_pool)
+{
+  return parse_chunk(
+    serialized_chunk, message_pool,
+    [message_pool](const uint8_t * data, size_t data_length) {
+      if (!message_pool) {
+        return rosbag2_storage::make_serialized_message(data, data_length);
+      }
+      // Pooled buffers of released messages are reused for the messages of the next chunks.
+      auto serialized_data = message_pool->make_empty_serialized_message(data_length);
+      if (data_length > 0) {
+        std::memcpy(serialized_data->buffer, data, data_length);
+      }
+      serialized_data->buffer_length = data_length;
+      return serialized_data;
+    });
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> MessageChunk::parse(
+  const std::shared_ptr<const rcutils_uint8_array_t> & serialized_chunk,
+  rosbag2_storage::MessagePool * message_pool)
+{
+  return parse_chunk(
+    *serialized_chunk, message_pool,
+    [&serialized_chunk](const uint8_t * data, size_t data_length) {
+      return rosbag2_storage::make_serialized_data_view({data, data_length, serialized_chunk});
+    });
+}
+
+}  // namespace rosbag2_compression
@@ -14,6 +14,10 @@
 
 #include "rosbag2_compression/sequential_compression_reader.hpp"
 
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -23,7 +27,11 @@
 #include "rcpputils/filesystem_helper.hpp"
 
 #include "rosbag2_compression/compression_options.hpp"
+#include "rosbag2_compression/encryption_keys.hpp"
+#include "rosbag2_compression/message_chunk.hpp"
 #include "rosbag2_compression/zstd_decompressor.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_storage/tracing.hpp"
 #include "logging.hpp"
 
 
@@ -40,16 +48,84 @@ SequentialCompressionReader::SequentialCompressionReader(
 {}
 
 SequentialCompressionReader::~SequentialCompressionReader()
-{}
+{
+  reset();
+}
+
+void SequentialCompressionReader::reset()
+{
+  wait_for_next_file();
+  SequentialReader::reset();
+  remove_decompressed_files(0, 0);
+}
+
+SequentialCompressionReader::Decompressors
+SequentialCompressionReader::create_decompressors(const Decompressors * loaded) const
+{
+  Decompressors decompressors;
+  decompressors.decompressor =
+    compression_factory_->create_decompressor(metadata_.compression_format);
+  // The dictionaries of the bag are read once and shared by the decompressors of all threads.
+  if (!loaded || !decompressors.decompressor->share_dictionaries(*loaded->decompressor)) {
+    decompressors.decompressor->load_dictionaries(metadata_.compression_dictionaries);
+  }
+  for (const auto & topic : metadata_.topics_with_message_count) {
+    if (compression_mode_ != rosbag2_compression::CompressionMode::MESSAGE ||
+      topic.compression_format.empty())
+    {
+      continue;
+    }
+    if (topic.compression_format == kUncompressedTopicFormat) {
+      decompressors.topic_decompressors[topic.topic_metadata.name] = nullptr;
+      continue;
+    }
+    auto & decompressor = decompressors.topic_format_decompressors[topic.compression_format];
+    if (!decompressor) {
+      decompressor = compression_factory_->create_decompressor(topic.compression_format);
+    }
+    decompressors.topic_decompressors[topic.topic_metadata.name] = decompressor.get();
+  }
+  if (!encryption_key_.empty()) {
+    decompressors.decryptor =
+      encryption_factory_->create_decryptor(metadata_.encryption_format, encryption_key_);
+  }
+  return decompressors;
+}
+
+void SequentialCompressionReader::load_encryption_key()
+{
+  encryption_key_.clear();
+  if (metadata_.encryption_format.empty()) {
+    return;
+  }
+  if (encryption_key_file_.empty()) {
+    throw std::runtime_error{"The bag is encrypted, but no encryption key file was given."};
+  }
+  const auto master_key = read_encryption_key_file(encryption_key_file_);
+  if (get_encryption_key_id(master_key) != metadata_.encryption_key_id) {
+    throw std::runtime_error{
+            "The bag was encrypted with the key \"" + metadata_.encryption_key_id +
+            "\", not with the key of \"" + encryption_key_file_ + "\"."};
+  }
+  encryption_key_ = decrypt_key(metadata_.encrypted_key, master_key);
+}
 
 void SequentialCompressionReader::setup_decompression()
 {
   compression_mode_ = rosbag2_compression::compression_mode_from_string(metadata_.compression_mode);
   if (compression_mode_ != rosbag2_compression::CompressionMode::NONE) {
-    decompressor_ = compression_factory_->create_decompressor(metadata_.compression_format);
-    // Decompress the first file so that it is readable.
-    ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM("Decompressing " << get_current_file().c_str());
-    *current_file_iterator_ = decompressor_->decompress_uri(get_current_file());
+    load_encryption_key();
+    decompressors_ = create_decompressors();
+    thread_decompressors_.clear();
+    if (compression_mode_ != rosbag2_compression::CompressionMode::FILE) {
+      for (size_t i = 0; i < decompression_threads_; ++i) {
+        thread_decompressors_.push_back(create_decompressors(&decompressors_));
+      }
+    }
+    if (compression_mode_ == rosbag2_compression::CompressionMode::FILE) {
+      // Decompress the first file so that it is readable.
+      decompress_file(0);
+    }
   } else {
     throw std::invalid_argument{
             "SequentialCompressionReader requires a CompressionMode that is not NONE!"};
@@ -60,14 +136,38 @@ void SequentialCompressionReader::open(
   const rosbag2_cpp::StorageOptions & storage_options,
   const rosbag2_cpp::ConverterOptions & converter_options)
 {
-  if (metadata_io_->metadata_file_exists(storage_options.uri)) {
-    metadata_ = metadata_io_->read_metadata(storage_options.uri);
+  // Finishes with a previously opened bag, whose decompressed files are removed.
+  reset();
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  message_filter_ = rosbag2_storage::StorageFilter();
+  message_filter_selects_all_topics_ = true;
+  message_filter_topics_.clear();
+  chunk_messages_.clear();
+  seek_time_ = 0;
+  conversion_threads_ = converter_options.conversion_threads;
+  delta_message_decoder_.reset();
+  decompression_directory_ = storage_options.decompression_directory;
+  decompression_threads_ = storage_options.decompression_threads;
+  encryption_key_file_ = storage_options.encryption_key_file;
+  message_pool_ = storage_options.message_pool_size > 0 ?
+    std::make_shared<rosbag2_storage::MessagePool>(storage_options.message_pool_size) : nullptr;
+  if (storage_options.follow_poll_interval_ms > 0) {
+    throw std::runtime_error{"Following bags being recorded is not supported when compressing."};
+  }
+
+  // Files compressed as a whole have summaries next to them in case the metadata file is lost.
+  const bool has_metadata_file = metadata_io_->metadata_file_exists(storage_options.uri);
+  if (has_metadata_file || metadata_io_->file_summaries_exist(storage_options.uri)) {
+    metadata_ = has_metadata_file ?
+      metadata_io_->read_metadata(storage_options.uri) :
+      metadata_io_->read_file_summaries(storage_options.uri);
     if (metadata_.relative_file_paths.empty()) {
       ROSBAG2_COMPRESSION_LOG_WARN("No file paths were found in metadata.");
       return;
     }
     file_paths_ = metadata_.relative_file_paths;
     current_file_iterator_ = file_paths_.begin();
+    decompressed_files_.clear();
     setup_decompression();
 
     storage_ = storage_factory_->open_read_only(
@@ -79,6 +179,10 @@ void SequentialCompressionReader::open(
 
       throw std::runtime_error{errmsg.str()};
     }
+    if (storage_->get_capabilities().message_pool) {
+      storage_->set_message_pool(message_pool_);
+    }
+    decompress_next_file_async();
   } else {
     std::stringstream errmsg;
     errmsg << "Could not find metadata for bag: \"" << storage_options.uri <<
@@ -90,26 +194,306 @@ void SequentialCompressionReader::open(
     ROSBAG2_COMPRESSION_LOG_WARN("No topics were listed in metadata.");
     return;
   }
+  setup_delta_decoding();
+
+  setup_converter(converter_options.output_serialization_format, topics);
+}
 
-  // Currently a bag file can only be played if all topics have the same serialization format.
-  check_topics_serialization_formats(topics);
-  check_converter_serialization_format(
-    converter_options.output_serialization_format,
-    topics[0].topic_metadata.serialization_format);
+bool SequentialCompressionReader::has_next()
+{
+  if (compression_mode_ != rosbag2_compression::CompressionMode::CHUNK) {
+    return SequentialReader::has_next();
+  }
+  while (chunk_messages_.empty()) {
+    if (!SequentialReader::has_next()) {
+      return false;
+    }
+    read_chunks();
+  }
+  return true;
 }
 
 std::shared_ptr<rosbag2_storage::SerializedBagMessage> SequentialCompressionReader::read_next()
 {
-  if (storage_ && decompressor_) {
+  if (storage_ && decompressors_.decompressor) {
+    if (compression_mode_ == rosbag2_compression::CompressionMode::CHUNK) {
+      if (!has_next()) {
+        throw std::runtime_error{"There are no more messages to read."};
+      }
+      auto message = std::move(chunk_messages_.front());
+      chunk_messages_.pop_front();
+      ROSBAG2_TRACEPOINT(read_next, message->topic_name.c_str(), message->time_stamp);
+      if (delta_message_decoder_) {
+        delta_message_decoder_->decode(*message);
+      }
+      return converter_ ? converter_->convert(message) : message;
+    }
     auto message = storage_->read_next();
-    if (compression_mode_ == rosbag2_compression::CompressionMode::MESSAGE) {
-      decompressor_->decompress_serialized_bag_message(message.get());
+    ROSBAG2_TRACEPOINT(read_next, message->topic_name.c_str(), message->time_stamp);
+    decompress_message(*message, decompressors_);
+    if (delta_message_decoder_) {
+      delta_message_decoder_->decode(*message);
     }
     return converter_ ? converter_->convert(message) : message;
   }
   throw std::runtime_error{"Bag is not open. Call open() before reading."};
 }
 
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialCompressionReader::read_next_batch(size_t max_messages, size_t max_bytes)
+{
+  if (!storage_ || !decompressors_.decompressor) {
+    throw std::runtime_error{"Bag is not open. Call open() before reading."};
+  }
+  if (compression_mode_ == rosbag2_compression::CompressionMode::CHUNK) {
+    // Messages are taken from the decompressed chunks one by one.
+    return BaseReaderInterface::read_next_batch(max_messages, max_bytes);
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  size_t bytes = 0;
+  // has_next() loads and decompresses the next file, so a batch may span several files.
+  while ((max_messages == 0 || messages.size() < max_messages) &&
+    (max_bytes == 0 || bytes < max_bytes) && has_next())
+  {
+    auto storage_messages = storage_->read_next_batch(
+      max_messages == 0 ? 0 : max_messages - messages.size(),
+      max_bytes == 0 ? 0 : max_bytes - bytes);
+    decompress_in_parallel(
+      storage_messages.size(),
+      [this, &storage_messages](size_t begin, size_t end, Decompressors & decompressors) {
+        for (auto i = begin; i < end; ++i) {
+          decompress_message(*storage_messages[i], decompressors);
+        }
+      });
+    // Deltas are decoded in order, after the messages they were encoded from.
+    for (auto & message : storage_messages) {
+      ROSBAG2_TRACEPOINT(read_next, message->topic_name.c_str(), message->time_stamp);
+      if (delta_message_decoder_) {
+        delta_message_decoder_->decode(*message);
+      }
+      bytes += message->serialized_data ? message->serialized_data->buffer_length : 0;
+      messages.push_back(std::move(message));
+    }
+  }
+  if (converter_) {
+    converter_->convert(messages);
+  }
+  return messages;
+}
+
+bool SequentialCompressionReader::visit_next_batch(
+  const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+  size_t max_messages, size_t max_bytes)
+{
+  return BaseReaderInterface::visit_next_batch(callback, max_messages, max_bytes);
+}
+
+void SequentialCompressionReader::set_filter(
+  const rosbag2_storage::StorageFilter & storage_filter)
+{
+  if (compression_mode_ != rosbag2_compression::CompressionMode::CHUNK) {
+    SequentialReader::set_filter(storage_filter);
+    return;
+  }
+  // The storage reads the chunks ending after the start time, which are the ones holding
+  // messages after it, as they are stored at the latest time stamp of their messages.
+  rosbag2_storage::StorageFilter chunk_filter{};
+  chunk_filter.topics = {kChunkTopicName};
+  chunk_filter.start_time = storage_filter.start_time;
+  SequentialReader::set_filter(chunk_filter);
+  message_filter_ = storage_filter;
+  // The topics are resolved by name and type once, so messages are filtered by name only.
+  const rosbag2_storage::TopicFilter topic_filter(message_filter_);
+  message_filter_selects_all_topics_ = topic_filter.selects_all_topics();
+  message_filter_topics_.clear();
+  for (const auto & topic_information : metadata_.topics_with_message_count) {
+    const auto & topic = topic_information.topic_metadata;
+    if (topic_filter.is_selected(topic.name, topic.type)) {
+      message_filter_topics_.insert(topic.name);
+    }
+  }
+  chunk_messages_.clear();
+}
+
+void SequentialCompressionReader::reset_filter()
+{
+  SequentialReader::reset_filter();
+  message_filter_ = rosbag2_storage::StorageFilter();
+  message_filter_selects_all_topics_ = true;
+  message_filter_topics_.clear();
+  chunk_messages_.clear();
+}
+
+void SequentialCompressionReader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  SequentialReader::seek(timestamp);
+  chunk_messages_.clear();
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialCompressionReader::read_latest_messages(
+  const std::vector<std::string> &, const rcutils_time_point_value_t &)
+{
+  throw std::runtime_error{"The latest messages cannot be read from compressed bags."};
+}
+
+void SequentialCompressionReader::decompress_in_parallel(
+  size_t count,
+  const std::function<void(size_t begin, size_t end, Decompressors & decompressors)> &
+  decompress_part)
+{
+  if (thread_decompressors_.empty() || count < 2) {
+    decompress_part(0, count, decompressors_);
+    return;
+  }
+
+  // Consecutive parts, so messages of a topic mostly stay with the same decompressor.
+  const auto thread_count = std::min(thread_decompressors_.size(), count - 1);
+  const auto part_size = (count + thread_count) / (thread_count + 1);
+  std::vector<std::future<void>> parts;
+  for (size_t i = 0; i < thread_count; ++i) {
+    const auto begin = std::min(count, (i + 1) * part_size);
+    const auto end = std::min(count, begin + part_size);
+    auto & decompressors = thread_decompressors_[i];
+    parts.push_back(
+      rosbag2_cpp::ThreadPool::get_shared().submit(
+        [&decompress_part, &decompressors, begin, end]() {
+          decompress_part(begin, end, decompressors);
+        }));
+  }
+
+  std::exception_ptr error;
+  try {
+    decompress_part(0, std::min(count, part_size), decompressors_);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  // The threads reference the items until they are done.
+  for (auto & part : parts) {
+    try {
+      part.get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void SequentialCompressionReader::read_chunks()
+{
+  // Chunks are stored with their earliest time stamp as publish time stamp, so chunks
+  // starting after the end of the time range are skipped without decompressing them.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> chunk_messages;
+  while (chunk_messages.size() <= thread_decompressors_.size() && SequentialReader::has_next()) {
+    auto chunk_message = storage_->read_next();
+    if (message_filter_.end_time == 0 ||
+      chunk_message->publish_time_stamp <= message_filter_.end_time)
+    {
+      chunk_messages.push_back(std::move(chunk_message));
+    }
+  }
+  decompress_in_parallel(
+    chunk_messages.size(),
+    [&chunk_messages](size_t begin, size_t end, Decompressors & decompressors) {
+      for (auto i = begin; i < end; ++i) {
+        if (decompressors.decryptor) {
+          decompressors.decryptor->decrypt_serialized_bag_message(chunk_messages[i].get());
+        }
+        decompressors.decompressor->decompress_serialized_bag_message(chunk_messages[i].get());
+      }
+    });
+  // The messages reference the decompressed chunks instead of copies of their data.
+  for (const auto & chunk_message : chunk_messages) {
+    for (auto & message : MessageChunk::parse(chunk_message->serialized_data, message_pool_.get()))
+    {
+      if (passes_message_filter(*message)) {
+        chunk_messages_.push_back(std::move(message));
+      }
+    }
+  }
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialCompressionReader::read_stored_messages_of_current_file(
+  const std::string & topic_name, rcutils_time_point_value_t end_time)
+{
+  if (compression_mode_ != rosbag2_compression::CompressionMode::CHUNK) {
+    auto messages = SequentialReader::read_stored_messages_of_current_file(topic_name, end_time);
+    for (auto & message : messages) {
+      decompress_message(*message, decompressors_);
+    }
+    return messages;
+  }
+
+  auto storage = storage_factory_->open_read_only(
+    get_current_file(), metadata_.storage_identifier);
+  if (!storage) {
+    throw std::runtime_error{"No storage could be initialized. Abort"};
+  }
+  rosbag2_storage::StorageFilter chunk_filter{};
+  chunk_filter.topics = {kChunkTopicName};
+  storage->set_filter(chunk_filter);
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  while (storage->has_next()) {
+    auto chunk_message = storage->read_next();
+    // Chunks starting after the end time hold no messages before it.
+    if (chunk_message->publish_time_stamp > end_time) {
+      continue;
+    }
+    if (decompressors_.decryptor) {
+      decompressors_.decryptor->decrypt_serialized_bag_message(chunk_message.get());
+    }
+    decompressors_.decompressor->decompress_serialized_bag_message(chunk_message.get());
+    for (auto & message : MessageChunk::parse(chunk_message->serialized_data)) {
+      if (message->topic_name == topic_name && message->time_stamp <= end_time) {
+        messages.push_back(std::move(message));
+      }
+    }
+  }
+  return messages;
+}
+
+bool SequentialCompressionReader::passes_message_filter(
+  const rosbag2_storage::SerializedBagMessage & message) const
+{
+  if (!message_filter_selects_all_topics_ &&
+    message_filter_topics_.find(message.topic_name) == message_filter_topics_.end())
+  {
+    return false;
+  }
+  const auto time_stamp = message_filter_.order_by_publish_time && message.publish_time_stamp != 0 ?
+    message.publish_time_stamp : message.time_stamp;
+  return time_stamp >= seek_time_ && time_stamp >= message_filter_.start_time &&
+         (message_filter_.end_time == 0 || time_stamp <= message_filter_.end_time);
+}
+
+void SequentialCompressionReader::decompress_message(
+  rosbag2_storage::SerializedBagMessage & message, Decompressors & decompressors) const
+{
+  if (compression_mode_ != rosbag2_compression::CompressionMode::MESSAGE) {
+    return;
+  }
+  if (decompressors.decryptor) {
+    decompressors.decryptor->decrypt_serialized_bag_message(&message);
+  }
+  auto decompressor = decompressors.decompressor.get();
+  const auto & topic_decompressors = decompressors.topic_decompressors;
+  if (!topic_decompressors.empty()) {
+    const auto topic_decompressor = topic_decompressors.find(message.topic_name);
+    if (topic_decompressor != topic_decompressors.end()) {
+      decompressor = topic_decompressor->second;
+    }
+  }
+  // Messages of topics which barely compressed may have been written uncompressed.
+  if (decompressor && decompressor->is_compressed_message(message)) {
+    decompressor->decompress_serialized_bag_message(&message);
+  }
+}
 
 void SequentialCompressionReader::load_next_file()
 {
@@ -122,16 +506,106 @@ void SequentialCompressionReader::load_next_file()
   }
 
   ++current_file_iterator_;
-  if (compression_mode_ == rosbag2_compression::CompressionMode::FILE) {
-    if (decompressor_ == nullptr) {
-      throw std::runtime_error{
-              "The bag file was not properly opened. "
-              "Somehow the compression mode was set without opening a decompressor."
-      };
-    }
+}
+
+void SequentialCompressionReader::preprocess_current_file()
+{
+  if (compression_mode_ != rosbag2_compression::CompressionMode::FILE) {
+    return;
+  }
+  if (decompressors_.decompressor == nullptr) {
+    throw std::runtime_error{
+            "The bag file was not properly opened. "
+            "Somehow the compression mode was set without opening a decompressor."
+    };
+  }
+
+  const auto file_index = static_cast<size_t>(current_file_iterator_ - file_paths_.begin());
+  wait_for_next_file();
+  // Only the current and the next file are kept decompressed, so disk usage does not double.
+  remove_decompressed_files(file_index, 2);
+  // Files are decompressed when they are first opened, unless done in the background while the
+  // file before was read. Seeking may skip files.
+  if (decompressed_files_.count(get_current_file()) == 0) {
+    decompress_file(file_index);
+  }
+  decompress_next_file_async();
+}
+
+void SequentialCompressionReader::decompress_file(size_t file_index)
+{
+  ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM("Decompressing " << file_paths_[file_index].c_str());
+  file_paths_[file_index] = decompressors_.decompressor->decompress_uri_to_directory(
+    file_paths_[file_index], decompression_directory_);
+  decompressed_files_.insert(file_paths_[file_index]);
+}
+
+void SequentialCompressionReader::decompress_next_file_async()
+{
+  if (compression_mode_ != rosbag2_compression::CompressionMode::FILE ||
+    next_file_decompression_.valid() || !has_next_file())
+  {
+    return;
+  }
+  // The next file read is the next one which may hold messages passing the filter.
+  auto file_index = static_cast<size_t>(current_file_iterator_ - file_paths_.begin()) + 1;
+  while (file_index + 1 < file_paths_.size() && !is_file_selected(file_index)) {
+    ++file_index;
+  }
+  const auto uri = file_paths_[file_index];
+  if (decompressed_files_.count(uri) > 0) {
+    return;
+  }
 
-    ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM("Decompressing " << get_current_file().c_str());
-    *current_file_iterator_ = decompressor_->decompress_uri(get_current_file());
+  // The decompressor is only used by the background thread until its result is taken.
+  next_file_index_ = file_index;
+  next_file_decompression_ = rosbag2_cpp::ThreadPool::get_shared().submit(
+    [this, uri]() {
+      ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM("Decompressing " << uri.c_str() << " in background");
+      return decompressors_.decompressor->decompress_uri_to_directory(
+        uri, decompression_directory_);
+    });
+}
+
+void SequentialCompressionReader::wait_for_next_file()
+{
+  if (!next_file_decompression_.valid()) {
+    return;
+  }
+  try {
+    file_paths_[next_file_index_] = next_file_decompression_.get();
+    decompressed_files_.insert(file_paths_[next_file_index_]);
+  } catch (const std::exception & e) {
+    // The file stays compressed, so the error is raised again when it is opened.
+    ROSBAG2_COMPRESSION_LOG_WARN_STREAM(
+      "Decompressing " << file_paths_[next_file_index_] << " in background failed: " <<
+        e.what());
+  }
+}
+
+void SequentialCompressionReader::remove_decompressed_files(
+  size_t first_kept_index, size_t kept_count)
+{
+  if (file_paths_.size() != metadata_.relative_file_paths.size()) {
+    return;
+  }
+  for (size_t i = 0; i < file_paths_.size(); ++i) {
+    const auto & decompressed_file = file_paths_[i];
+    const auto & compressed_file = metadata_.relative_file_paths[i];
+    if ((i >= first_kept_index && i - first_kept_index < kept_count) ||
+      decompressed_files_.count(decompressed_file) == 0 ||
+      decompressed_file == compressed_file ||
+      !rcpputils::fs::exists(rcpputils::fs::path{compressed_file}))
+    {
+      // Files which cannot be decompressed again are kept.
+      continue;
+    }
+    // The storage might still have the file open.
+    storage_.reset();
+    ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM("Removing decompressed " << decompressed_file.c_str());
+    rcpputils::fs::remove(rcpputils::fs::path{decompressed_file});
+    decompressed_files_.erase(decompressed_file);
+    file_paths_[i] = compressed_file;
   }
 }
 }  // namespace rosbag2_compression
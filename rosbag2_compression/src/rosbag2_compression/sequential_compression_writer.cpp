@@ -16,17 +16,25 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 #include "rcutils/filesystem.h"
 
+#include "rosbag2_compression/encryption_keys.hpp"
 #include "rosbag2_compression/zstd_compressor.hpp"
 #include "rosbag2_cpp/info.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+// Defines the tracepoints of rosbag2_compression.
+#define ROSBAG2_TRACEPOINT_DEFINE
+#include "rosbag2_storage/tracing.hpp"
 
 #include "logging.hpp"
 
@@ -35,6 +43,37 @@ namespace rosbag2_compression
 
 namespace
 {
+// Time over which the fraction of time spent compressing messages is measured for adapting the
+// compression level, and the fractions below and above which the level is raised and lowered.
+constexpr const std::chrono::seconds kAdaptationWindow{1};
+constexpr const double kMinCompressionTimeFraction = 0.1;
+constexpr const double kMaxCompressionTimeFraction = 0.5;
+// Number of chunks an asynchronous compressor may compress at once before the writer waits.
+constexpr const size_t kMaxPendingChunks = 4;
+
+uint64_t get_file_size(const std::string & uri)
+{
+  const auto path = rcpputils::fs::path{uri};
+  return path.exists() ? path.file_size() : 0u;
+}
+
+uint64_t get_serialized_size(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return message.serialized_data ? message.serialized_data->buffer_length : 0u;
+}
+
+// Copies the message, sharing its data, with its time stamps moved by the clock offset.
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> shift_time_stamps(
+  const rosbag2_storage::SerializedBagMessage & message, std::chrono::nanoseconds clock_offset)
+{
+  auto shifted_message = std::make_shared<rosbag2_storage::SerializedBagMessage>(message);
+  shifted_message->time_stamp += clock_offset.count();
+  if (shifted_message->publish_time_stamp != 0) {
+    shifted_message->publish_time_stamp += clock_offset.count();
+  }
+  return shifted_message;
+}
+
 std::string format_storage_uri(const std::string & base_folder, uint64_t storage_count)
 {
   // Right now `base_folder_` is always just the folder name for where to install the bagfile.
@@ -45,6 +84,67 @@ std::string format_storage_uri(const std::string & base_folder, uint64_t storage
 
   return (rcpputils::fs::path(base_folder) / storage_file_name.str()).string();
 }
+
+void update_file_time_range(
+  rosbag2_storage::FileInformation & file,
+  const std::chrono::time_point<std::chrono::high_resolution_clock> & message_timestamp,
+  bool is_first_message)
+{
+  if (is_first_message) {
+    file.starting_time = message_timestamp;
+    file.duration = std::chrono::nanoseconds{0};
+    return;
+  }
+  const auto ending_time = std::max(file.starting_time + file.duration, message_timestamp);
+  file.starting_time = std::min(file.starting_time, message_timestamp);
+  file.duration = ending_time - file.starting_time;
+}
+
+// Compresses the file and removes the uncompressed one. Returns the path of the compressed file,
+// or an empty path if the file was dropped because it is empty or does not exist.
+std::string compress_file(
+  rosbag2_compression::BaseCompressorInterface & compressor, const std::string & uri)
+{
+  const auto to_compress = rcpputils::fs::path{uri};
+
+  if (to_compress.exists() && to_compress.file_size() > 0u) {
+    ROSBAG2_TRACEPOINT(compression_begin, uri.c_str(), 0, to_compress.file_size());
+    const auto compressed_uri = compressor.compress_uri(to_compress.string());
+    ROSBAG2_TRACEPOINT(
+      compression_end, uri.c_str(), 0, rcpputils::fs::path{compressed_uri}.file_size());
+
+    if (!rcpputils::fs::remove(to_compress)) {
+      ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
+        "Failed to remove uncompressed bag: \"" << to_compress.string() << "\"");
+    }
+    return compressed_uri;
+  }
+
+  ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM(
+    "Removing file: \"" << to_compress.string() <<
+      "\" because it either is empty or does not exist.");
+  return "";
+}
+
+// The summary lets the bag be queried without decompressing it, so failing to write it does not
+// fail the recording.
+void write_file_summary(
+  rosbag2_storage::MetadataIo & metadata_io, rosbag2_storage::BagMetadata summary,
+  const std::string & compressed_uri)
+{
+  const auto file_name = rcpputils::fs::path{compressed_uri}.filename().string();
+  summary.relative_file_paths = {file_name};
+  for (auto & file : summary.files) {
+    file.path = file_name;
+    file.size = get_file_size(compressed_uri);
+  }
+  try {
+    metadata_io.write_file_summary(compressed_uri, summary);
+  } catch (const std::exception & e) {
+    ROSBAG2_COMPRESSION_LOG_WARN_STREAM(
+      "Could not write the summary of bag file: \"" << compressed_uri << "\".\n" << e.what());
+  }
+}
 }  // namespace
 
 SequentialCompressionWriter::SequentialCompressionWriter(
@@ -84,6 +184,13 @@ void SequentialCompressionWriter::init_metadata()
   metadata_.compression_format = compression_options_.compression_format;
   metadata_.compression_mode =
     rosbag2_compression::compression_mode_to_string(compression_options_.compression_mode);
+  metadata_.bag_id = bag_id_;
+  metadata_.clock_offset = clock_offset_;
+  if (encryptor_) {
+    metadata_.encryption_format = compression_options_.encryption_format;
+    metadata_.encryption_key_id = encryption_key_id_;
+    metadata_.encrypted_key = encrypted_key_;
+  }
 }
 
 void SequentialCompressionWriter::setup_compression()
@@ -92,15 +199,122 @@ void SequentialCompressionWriter::setup_compression()
     throw std::invalid_argument{
             "SequentialCompressionWriter requires a CompressionMode that is not NONE!"};
   }
+  if (compression_options_.adaptive_compression_level) {
+    if (compression_options_.compression_level_min > compression_options_.compression_level_max) {
+      throw std::invalid_argument{
+              "The minimum compression level must not be greater than the maximum level!"};
+    }
+    // The compressors start at the given level, moved into the bounds.
+    compression_options_.compression_level = std::max(
+      compression_options_.compression_level_min,
+      std::min(compression_options_.compression_level, compression_options_.compression_level_max));
+  }
+  if (!compression_options_.topic_compression.empty() &&
+    compression_options_.compression_mode != rosbag2_compression::CompressionMode::MESSAGE)
+  {
+    throw std::invalid_argument{"Topics can only be compressed on their own in MESSAGE mode!"};
+  }
+  if (compression_options_.compression_sample_messages > 0u) {
+    if (compression_options_.compression_mode != rosbag2_compression::CompressionMode::MESSAGE) {
+      throw std::invalid_argument{"Compression can only be sampled in MESSAGE mode!"};
+    }
+    if (compression_options_.incompressible_ratio <= 0.0) {
+      throw std::invalid_argument{"The incompressible ratio must be greater than 0!"};
+    }
+  }
+  topic_format_compressors_.clear();
+  topic_compressors_.clear();
+  compression_samplers_.clear();
+  compression_level_ = compression_options_.compression_level;
+  compression_statistics_ = CompressionStatistics{};
+  compression_statistics_.current_compression_level = compression_level_;
+
   compressor_ = compression_factory_->create_compressor(compression_options_.compression_format);
+  if (compressor_) {
+    compressor_->set_compression_options(compression_options_);
+  }
+}
+
+void SequentialCompressionWriter::setup_encryption()
+{
+  encryptor_.reset();
+  encryption_key_id_.clear();
+  encrypted_key_.clear();
+  if (compression_options_.encryption_format.empty()) {
+    return;
+  }
+  if (compression_options_.compression_mode != rosbag2_compression::CompressionMode::MESSAGE &&
+    compression_options_.compression_mode != rosbag2_compression::CompressionMode::CHUNK)
+  {
+    throw std::invalid_argument{"Bags can only be encrypted in MESSAGE or CHUNK mode!"};
+  }
+  if (compression_options_.encryption_key_file.empty()) {
+    throw std::invalid_argument{"Encrypting a bag requires an encryption key file!"};
+  }
+
+  // Every bag gets a key of its own, which is only stored encrypted with the master key.
+  const auto master_key = read_encryption_key_file(compression_options_.encryption_key_file);
+  const auto key = generate_encryption_key();
+  encryptor_ = encryption_factory_->create_encryptor(compression_options_.encryption_format, key);
+  encryption_key_id_ = get_encryption_key_id(master_key);
+  encrypted_key_ = encrypt_key(key, master_key);
 }
 
 void SequentialCompressionWriter::open(
   const rosbag2_cpp::StorageOptions & storage_options,
   const rosbag2_cpp::ConverterOptions & converter_options)
 {
+  if (storage_options.snapshot_mode) {
+    throw std::invalid_argument{"Snapshot mode is not supported when compressing bags."};
+  }
+  if (!storage_options.stream_address.empty()) {
+    throw std::invalid_argument{"Streaming is not supported when compressing bags."};
+  }
+  if (!storage_options.deduplicate_topics.empty()) {
+    throw std::invalid_argument{"Deduplication is not supported when compressing bags."};
+  }
+  if (storage_options.retention_max_bytes > 0u || storage_options.retention_max_age > 0u) {
+    throw std::invalid_argument{"Retention of bagfiles is not supported when compressing bags."};
+  }
+  if (!storage_options.staging_directory.empty()) {
+    throw std::invalid_argument{"Staging bagfiles is not supported when compressing bags."};
+  }
   max_bagfile_size_ = storage_options.max_bagfile_size;
+  max_bagfile_duration_ = std::chrono::seconds(storage_options.max_bagfile_duration);
+  max_bagfile_messages_ = storage_options.max_bagfile_messages;
+  current_file_message_count_ = 0;
+  current_file_topic_indices_.clear();
   base_folder_ = storage_options.uri;
+  bag_id_ = storage_options.bag_id;
+  clock_offset_ = std::chrono::nanoseconds(storage_options.clock_offset_ns);
+  delta_encoder_ = storage_options.delta_encode_topics.empty() ?
+    nullptr : std::make_unique<rosbag2_cpp::writers::MessageDeltaEncoder>(
+    storage_options.delta_encode_topics, storage_options.delta_keyframe_interval);
+  compression_options_.keyframe_interval = storage_options.delta_keyframe_interval;
+  reorder_buffer_ = storage_options.reorder_window_ms == 0 ?
+    nullptr : std::make_unique<rosbag2_cpp::writers::MessageReorderBuffer>(
+    std::chrono::milliseconds(storage_options.reorder_window_ms));
+  storage_config_.preset_profile = storage_options.storage_preset_profile;
+  storage_config_.defer_index_creation = storage_options.defer_index_creation;
+  storage_config_.topic_timestamp_index = storage_options.topic_timestamp_index;
+  storage_config_.cluster_messages_by_topic = storage_options.cluster_messages_by_topic;
+  storage_config_.checksums = storage_options.checksums;
+  // A compressed file is decompressed on its own, without the data file next to it.
+  storage_config_.large_message_threshold =
+    compression_options_.compression_mode == rosbag2_compression::CompressionMode::FILE ?
+    0 : storage_options.large_message_threshold;
+  storage_config_.transaction_max_messages = storage_options.transaction_max_messages;
+  storage_config_.transaction_max_bytes = storage_options.transaction_max_bytes;
+  storage_config_.transaction_max_duration =
+    std::chrono::milliseconds(storage_options.transaction_max_duration_ms);
+  if (storage_options.preallocate_bagfiles && storage_options.max_bagfile_size == 0) {
+    throw std::invalid_argument{"Preallocating bagfiles needs a maximum bagfile size."};
+  }
+  storage_config_.preallocate_size =
+    storage_options.preallocate_bagfiles ? storage_options.max_bagfile_size : 0;
+  storage_config_.writeback_interval_bytes = storage_options.writeback_interval_bytes;
+  storage_config_.memory_chunk_size = storage_options.memory_chunk_size;
+  storage_config_.memory_max_bytes = storage_options.memory_max_bytes;
 
   if (converter_options.output_serialization_format !=
     converter_options.input_serialization_format)
@@ -109,7 +323,8 @@ void SequentialCompressionWriter::open(
   }
 
   const auto storage_uri = format_storage_uri(base_folder_, 0);
-  storage_ = storage_factory_->open_read_write(storage_uri, storage_options.storage_id);
+  storage_ = storage_factory_->open_read_write(
+    storage_uri, storage_options.storage_id, storage_config_);
   if (!storage_) {
     throw std::runtime_error{"No storage could be initialized. Abort"};
   }
@@ -122,7 +337,17 @@ void SequentialCompressionWriter::open(
   }
 
   setup_compression();
+  setup_encryption();
   init_metadata();
+  start_compression_threads();
+  adaptation_window_start_ = std::chrono::steady_clock::now();
+  adaptation_window_compression_time_ = std::chrono::nanoseconds{0};
+
+  if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::CHUNK) {
+    chunk_topic_ = {
+      kChunkTopicName, kChunkTopicType, converter_options.output_serialization_format, ""};
+    storage_->create_topic(chunk_topic_);
+  }
 }
 
 void SequentialCompressionWriter::reset()
@@ -132,20 +357,71 @@ void SequentialCompressionWriter::reset()
       throw std::runtime_error{"Compressor was not opened!"};
     }
 
+    // Storage must be closed before it can be compressed or its metadata is finalized.
+    const bool was_open = storage_ != nullptr;
+    if (was_open) {
+      try {
+        flush_reorder_buffer();
+        write_chunk();
+        write_pending_chunks(0);
+      } catch (const std::runtime_error & e) {
+        ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
+          "Could not write the last messages or chunk.\n" << e.what());
+      }
+    }
+    pending_chunks_.clear();
+    storage_.reset();
+    stop_compression_threads();
+    remove_dropped_files();
+    const auto file_count = metadata_.relative_file_paths.size();
+
     // Reset may be called before initializing the compressor (ex. bad options).
     // We compress the last file only if it hasn't been compressed earlier (ex. in split_bagfile()).
     if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::FILE &&
       should_compress_last_file_)
     {
       try {
-        storage_.reset();  // Storage must be closed before it can be compressed.
         compress_last_file();
       } catch (const std::runtime_error & e) {
         ROSBAG2_COMPRESSION_LOG_WARN_STREAM("Could not compress the last bag file.\n" << e.what());
       }
     }
+    if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::MESSAGE ||
+      compression_options_.compression_mode == rosbag2_compression::CompressionMode::CHUNK)
+    {
+      try {
+        metadata_.compression_dictionaries = compressor_->write_dictionaries(base_folder_);
+      } catch (const std::runtime_error & e) {
+        ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
+          "Could not write the compression dictionaries.\n" << e.what());
+      }
+    }
     finalize_metadata();
     metadata_io_->write_metadata(base_folder_, metadata_);
+
+    const auto statistics = get_compression_statistics();
+    if (compression_options_.adaptive_compression_level && statistics.compression_count > 0) {
+      std::stringstream levels;
+      for (const auto & level : statistics.compression_count_by_level) {
+        levels << " " << level.first << " (" << level.second << "x)";
+      }
+      ROSBAG2_COMPRESSION_LOG_INFO_STREAM(
+        "Compressed " << statistics.uncompressed_bytes << " bytes into " <<
+          statistics.compressed_bytes << " bytes at compression levels" << levels.str());
+    }
+    for (const auto & sample : statistics.topic_samples) {
+      if (sample.second.uncompressed_message_count > 0u) {
+        ROSBAG2_COMPRESSION_LOG_INFO_STREAM(
+          "Wrote " << sample.second.uncompressed_message_count << " messages of topic \"" <<
+            sample.first << "\" uncompressed, whose last sample compressed to a ratio of " <<
+            sample.second.compression_ratio);
+      }
+    }
+
+    // The last file is dropped by compress_last_file() if it is empty.
+    if (was_open && file_count > 0u && metadata_.relative_file_paths.size() == file_count) {
+      notify_split({metadata_.relative_file_paths.back(), ""});
+    }
   }
 
   storage_.reset();  // Necessary to ensure that the storage is destroyed before the factory
@@ -168,6 +444,25 @@ void SequentialCompressionWriter::create_topic(
   {
     rosbag2_storage::TopicInformation info{};
     info.topic_metadata = topic_with_type;
+    info.delta_encoded = delta_encoder_ && delta_encoder_->is_delta_encoded(topic_with_type.name);
+    setup_topic_compression(info);
+    const auto topic_compressor = topic_compressors_.find(topic_with_type.name);
+    const auto compressor = topic_compressor == topic_compressors_.end() ?
+      compressor_.get() : topic_compressor->second.compressor;
+    if (compressor) {
+      compressor->register_topic(topic_with_type);
+      // Compressors of video store the messages of the topic as deltas, which readers decode.
+      if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::MESSAGE &&
+        compressor->is_delta_encoded(topic_with_type.name))
+      {
+        if (info.delta_encoded) {
+          throw std::invalid_argument{
+                  "Topic \"" + topic_with_type.name + "\" cannot be both delta encoded and "
+                  "compressed as " + compressor->get_compression_identifier() + "!"};
+        }
+        info.delta_encoded = true;
+      }
+    }
 
     const auto insert_res = topics_names_to_info_.insert(
       std::make_pair(topic_with_type.name, info));
@@ -182,6 +477,55 @@ void SequentialCompressionWriter::create_topic(
   }
 }
 
+void SequentialCompressionWriter::setup_topic_compression(
+  rosbag2_storage::TopicInformation & info)
+{
+  const auto & topic_compression = compression_options_.topic_compression;
+  auto topic_options = topic_compression.find(info.topic_metadata.name);
+  if (topic_options == topic_compression.end()) {
+    topic_options = topic_compression.find(info.topic_metadata.type);
+  }
+  if (topic_options == topic_compression.end()) {
+    return;
+  }
+
+  if (topic_options->second.compression_format == kUncompressedTopicFormat) {
+    info.compression_format = kUncompressedTopicFormat;
+    topic_compressors_[info.topic_metadata.name] = {nullptr, 0};
+    return;
+  }
+  auto compression_options = compression_options_;
+  if (!topic_options->second.compression_format.empty()) {
+    compression_options.compression_format = topic_options->second.compression_format;
+  }
+  if (topic_options->second.has_compression_level) {
+    compression_options.compression_level = topic_options->second.compression_level;
+  }
+  // Dictionaries are only written for the compressor of the bag.
+  compression_options.dictionary_training_messages = 0;
+  compression_options.compression_dictionary = "";
+
+  // Topics with the same format and level share a compressor.
+  auto & compressor = topic_format_compressors_[
+    compression_options.compression_format + ":" +
+    std::to_string(compression_options.compression_level)];
+  if (!compressor) {
+    compressor = compression_factory_->create_compressor(compression_options.compression_format);
+    if (!compressor) {
+      throw std::invalid_argument{
+              "No compressor for the compression format \"" +
+              compression_options.compression_format + "\" of topic \"" +
+              info.topic_metadata.name + "\"!"};
+    }
+    compressor->set_compression_options(compression_options);
+  }
+  if (compression_options.compression_format != compression_options_.compression_format) {
+    info.compression_format = compression_options.compression_format;
+  }
+  topic_compressors_[info.topic_metadata.name] = {
+    compressor.get(), compression_options.compression_level};
+}
+
 void SequentialCompressionWriter::remove_topic(
   const rosbag2_storage::TopicMetadata & topic_with_type)
 {
@@ -190,6 +534,8 @@ void SequentialCompressionWriter::remove_topic(
   }
 
   if (topics_names_to_info_.erase(topic_with_type.name) > 0) {
+    topic_compressors_.erase(topic_with_type.name);
+    compression_samplers_.erase(topic_with_type.name);
     storage_->remove_topic(topic_with_type);
   } else {
     std::stringstream errmsg;
@@ -204,23 +550,192 @@ void SequentialCompressionWriter::compress_last_file()
     throw std::runtime_error{"Compressor was not opened!"};
   }
 
-  const auto to_compress = rcpputils::fs::path{metadata_.relative_file_paths.back()};
-
-  if (to_compress.exists() && to_compress.file_size() > 0u) {
-    const auto compressed_uri = compressor_->compress_uri(to_compress.string());
+  // No compression thread uses the compressor here, which may still be at the level of the
+  // last file it compressed.
+  if (compression_options_.adaptive_compression_level) {
+    auto compression_options = compression_options_;
+    compression_options.compression_level = compression_level_;
+    compressor_->set_compression_options(compression_options);
+  }
 
+  const auto uri = metadata_.relative_file_paths.back();
+  const auto uncompressed_size = get_file_size(uri);
+  const auto compressed_uri = compress_file(*compressor_, uri);
+  if (!compressed_uri.empty()) {
+    write_file_summary(
+      *metadata_io_, make_file_summary(metadata_.relative_file_paths.size() - 1), compressed_uri);
+    std::lock_guard<std::mutex> lock(compression_mutex_);
+    record_compression(compression_level_, uncompressed_size, get_file_size(compressed_uri));
+  }
+  if (compressed_uri.empty()) {
+    metadata_.relative_file_paths.pop_back();
+  } else {
     metadata_.relative_file_paths.back() = compressed_uri;
+  }
+}
 
-    if (!rcpputils::fs::remove(to_compress)) {
-      ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
-        "Failed to remove uncompressed bag: \"" << to_compress.string() << "\"");
+void SequentialCompressionWriter::start_compression_threads()
+{
+  if (compression_options_.compression_mode != rosbag2_compression::CompressionMode::FILE ||
+    !compressor_)
+  {
+    return;
+  }
+
+  stop_compression_ = false;
+  for (uint64_t i = 0; i < compression_options_.compression_threads; ++i) {
+    auto compressor = compressor_.get();
+    if (i > 0) {
+      // Compressors keep state between files, so every thread needs its own.
+      additional_compressors_.push_back(
+        compression_factory_->create_compressor(compression_options_.compression_format));
+      compressor = additional_compressors_.back().get();
+      compressor->set_compression_options(compression_options_);
     }
-  } else {
-    ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM(
-      "Removing last file: \"" << to_compress.string() <<
-        "\" because it either is empty or does not exist.");
+    compression_threads_.emplace_back(
+      [this, compressor]() {
+        rosbag2_cpp::ThreadPool::configure_current_thread(
+          rosbag2_cpp::ThreadRole::COMPRESSION);
+        run_compression_thread(*compressor);
+      });
+  }
+}
 
-    metadata_.relative_file_paths.pop_back();
+void SequentialCompressionWriter::stop_compression_threads()
+{
+  {
+    std::lock_guard<std::mutex> lock(compression_mutex_);
+    stop_compression_ = true;
+  }
+  compression_job_added_.notify_all();
+  for (auto & compression_thread : compression_threads_) {
+    compression_thread.join();
+  }
+  compression_threads_.clear();
+  additional_compressors_.clear();
+}
+
+void SequentialCompressionWriter::enqueue_compression(CompressionJob job)
+{
+  job.summary = make_file_summary(job.file_index);
+  {
+    std::unique_lock<std::mutex> lock(compression_mutex_);
+    if (compression_options_.adaptive_compression_level) {
+      // Files still waiting for a compression thread mean that compression falls behind.
+      change_compression_level(compression_queue_.empty() ? 1 : -1);
+    }
+    job.compression_level = compression_level_;
+    const auto max_queue_size = compression_options_.compression_queue_size;
+    compression_job_taken_.wait(
+      lock, [this, max_queue_size]() {
+        return max_queue_size == 0 || compression_queue_.size() < max_queue_size;
+      });
+    compression_queue_.push(std::move(job));
+  }
+  compression_job_added_.notify_one();
+}
+
+rosbag2_storage::BagMetadata SequentialCompressionWriter::make_file_summary(
+  size_t file_index) const
+{
+  rosbag2_storage::BagMetadata summary{};
+  summary.storage_identifier = metadata_.storage_identifier;
+  summary.compression_format = metadata_.compression_format;
+  summary.compression_mode = metadata_.compression_mode;
+  summary.bag_id = metadata_.bag_id;
+  summary.clock_offset = metadata_.clock_offset;
+  summary.duration = std::chrono::nanoseconds{0};
+  summary.message_count = 0;
+  // Files without messages have no file information.
+  if (file_index >= metadata_.files.size()) {
+    return summary;
+  }
+
+  const auto & file = metadata_.files[file_index];
+  summary.files = {file};
+  summary.starting_time = file.starting_time;
+  summary.duration = file.duration;
+  summary.message_count = file.message_count;
+  // All topics are listed, as in the metadata of the bag, with the messages they have in the file.
+  for (const auto & topic : topics_names_to_info_) {
+    rosbag2_storage::TopicInformation topic_information{};
+    topic_information.topic_metadata = topic.second.topic_metadata;
+    topic_information.message_count = 0;
+    const auto file_topic = std::find(file.topics.begin(), file.topics.end(), topic.first);
+    if (file_topic != file.topics.end()) {
+      topic_information.message_count =
+        file.topic_message_counts[static_cast<size_t>(file_topic - file.topics.begin())];
+    }
+    summary.topics_with_message_count.push_back(topic_information);
+  }
+  return summary;
+}
+
+void SequentialCompressionWriter::run_compression_thread(
+  rosbag2_compression::BaseCompressorInterface & compressor)
+{
+  auto compressor_level = compression_options_.compression_level;
+  while (true) {
+    CompressionJob job{};
+    std::string uri;
+    {
+      std::unique_lock<std::mutex> lock(compression_mutex_);
+      compression_job_added_.wait(
+        lock, [this]() {return stop_compression_ || !compression_queue_.empty();});
+      // Queued files are still compressed when stopping.
+      if (compression_queue_.empty()) {
+        return;
+      }
+      job = std::move(compression_queue_.front());
+      compression_queue_.pop();
+      uri = metadata_.relative_file_paths[job.file_index];
+    }
+    compression_job_taken_.notify_one();
+
+    auto compressed_uri = uri;
+    const auto uncompressed_size = get_file_size(uri);
+    bool compressed = false;
+    try {
+      if (job.compression_level != compressor_level) {
+        auto compression_options = compression_options_;
+        compression_options.compression_level = job.compression_level;
+        compressor.set_compression_options(compression_options);
+        compressor_level = job.compression_level;
+      }
+      compressed_uri = compress_file(compressor, uri);
+      compressed = !compressed_uri.empty();
+      if (compressed) {
+        write_file_summary(*metadata_io_, std::move(job.summary), compressed_uri);
+      }
+    } catch (const std::exception & e) {
+      ROSBAG2_COMPRESSION_LOG_WARN_STREAM(
+        "Could not compress bag file: \"" << uri << "\".\n" << e.what());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(compression_mutex_);
+      metadata_.relative_file_paths[job.file_index] = compressed_uri;
+      if (compressed) {
+        record_compression(
+          job.compression_level, uncompressed_size, get_file_size(compressed_uri));
+      }
+    }
+    if (!compressed_uri.empty() && !job.opened_file.empty()) {
+      notify_split({compressed_uri, job.opened_file});
+    }
+  }
+}
+
+void SequentialCompressionWriter::remove_dropped_files()
+{
+  auto & paths = metadata_.relative_file_paths;
+  for (size_t i = paths.size(); i-- > 0; ) {
+    if (paths[i].empty()) {
+      paths.erase(paths.begin() + static_cast<std::ptrdiff_t>(i));
+      if (i < metadata_.files.size()) {
+        metadata_.files.erase(metadata_.files.begin() + static_cast<std::ptrdiff_t>(i));
+      }
+    }
   }
 }
 
@@ -230,10 +745,23 @@ void SequentialCompressionWriter::split_bagfile()
     base_folder_,
     metadata_.relative_file_paths.size());
 
-  storage_ = storage_factory_->open_read_write(storage_uri, metadata_.storage_identifier);
+  storage_ = storage_factory_->open_read_write(
+    storage_uri, metadata_.storage_identifier, storage_config_);
 
+  const auto file_count = metadata_.relative_file_paths.size();
+  const bool compress_in_background = !compression_threads_.empty();
   if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::FILE) {
-    compress_last_file();
+    if (compress_in_background) {
+      // The compression thread reports the split once the file is compressed.
+      enqueue_compression({file_count - 1, storage_ ? storage_->get_relative_file_path() : ""});
+    } else {
+      compress_last_file();
+    }
+  }
+  // The closed file is dropped by compress_last_file() if it is empty.
+  rosbag2_cpp::bag_events::BagSplitInfo split_info;
+  if (!compress_in_background && metadata_.relative_file_paths.size() == file_count) {
+    split_info.closed_file = metadata_.relative_file_paths.back();
   }
 
   if (!storage_) {
@@ -246,14 +774,58 @@ void SequentialCompressionWriter::split_bagfile()
     throw std::runtime_error{errmsg.str()};
   }
 
-  metadata_.relative_file_paths.push_back(storage_->get_relative_file_path());
+  {
+    std::lock_guard<std::mutex> lock(compression_mutex_);
+    metadata_.relative_file_paths.push_back(storage_->get_relative_file_path());
+  }
+  current_file_message_count_ = 0;
+  current_file_topic_indices_.clear();
+  // Deltas only refer to messages in the same file.
+  if (delta_encoder_) {
+    delta_encoder_->reset();
+  }
+  if (compressor_) {
+    compressor_->reset_deltas();
+  }
+  for (const auto & topic_format_compressor : topic_format_compressors_) {
+    topic_format_compressor.second->reset_deltas();
+  }
 
   // Re-register all topics since we rolled-over to a new bagfile.
+  std::vector<rosbag2_storage::TopicMetadata> topics;
   for (const auto & topic : topics_names_to_info_) {
-    storage_->create_topic(topic.second.topic_metadata);
+    topics.push_back(topic.second.topic_metadata);
+  }
+  if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::CHUNK) {
+    topics.push_back(chunk_topic_);
+  }
+  storage_->create_topics(topics);
+  // Files compressed in the background are closed after the split is traced.
+  ROSBAG2_TRACEPOINT(
+    split, split_info.closed_file.c_str(), storage_->get_relative_file_path().c_str());
+
+  if (!split_info.closed_file.empty()) {
+    split_info.opened_file = storage_->get_relative_file_path();
+    notify_split(split_info);
+  }
+}
+
+void SequentialCompressionWriter::notify_split(
+  const rosbag2_cpp::bag_events::BagSplitInfo & split_info) const
+{
+  for (const auto & callbacks : event_callbacks_) {
+    if (callbacks.write_split_callback) {
+      callbacks.write_split_callback(split_info);
+    }
   }
 }
 
+void SequentialCompressionWriter::add_event_callbacks(
+  const rosbag2_cpp::bag_events::WriterEventCallbacks & callbacks)
+{
+  event_callbacks_.push_back(callbacks);
+}
+
 void SequentialCompressionWriter::compress_message(
   std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
 {
@@ -261,7 +833,155 @@ void SequentialCompressionWriter::compress_message(
     throw std::runtime_error{"Cannot compress message; Writer is not open!"};
   }
 
+  const auto uncompressed_size = get_serialized_size(*message);
+  const auto start = std::chrono::steady_clock::now();
+  ROSBAG2_TRACEPOINT(
+    compression_begin, message->topic_name.c_str(), message->time_stamp, uncompressed_size);
   compressor_->compress_serialized_bag_message(message.get());
+  ROSBAG2_TRACEPOINT(
+    compression_end, message->topic_name.c_str(), message->time_stamp,
+    get_serialized_size(*message));
+  const auto end = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(compression_mutex_);
+  record_compression(compression_level_, uncompressed_size, get_serialized_size(*message));
+  if (compression_options_.adaptive_compression_level) {
+    adapt_message_compression_level(end - start, end);
+  }
+}
+
+void SequentialCompressionWriter::compress_topic_message(
+  const TopicCompressor & topic_compressor, rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto uncompressed_size = get_serialized_size(message);
+  ROSBAG2_TRACEPOINT(
+    compression_begin, message.topic_name.c_str(), message.time_stamp, uncompressed_size);
+  topic_compressor.compressor->compress_serialized_bag_message(&message);
+  ROSBAG2_TRACEPOINT(
+    compression_end, message.topic_name.c_str(), message.time_stamp,
+    get_serialized_size(message));
+
+  std::lock_guard<std::mutex> lock(compression_mutex_);
+  record_compression(
+    topic_compressor.compression_level, uncompressed_size, get_serialized_size(message));
+}
+
+bool SequentialCompressionWriter::skip_incompressible_message(
+  const rosbag2_compression::BaseCompressorInterface & compressor,
+  const rosbag2_storage::SerializedBagMessage & message)
+{
+  if (compression_options_.compression_sample_messages == 0u) {
+    return false;
+  }
+  auto & sampler = compression_samplers_[message.topic_name];
+  if (sampler.sampling) {
+    return false;
+  }
+  const auto resample_interval = compression_options_.compression_resample_interval;
+  if (resample_interval > 0u && ++sampler.message_count > resample_interval) {
+    // Topics may compress differently later on, e.g. once a camera looks at another scene.
+    sampler = CompressionSampler{true, sampler.compress};
+    return false;
+  }
+  if (sampler.compress || !compressor.can_store_uncompressed(message)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(compression_mutex_);
+  ++compression_statistics_.topic_samples[message.topic_name].uncompressed_message_count;
+  return true;
+}
+
+void SequentialCompressionWriter::sample_compression(
+  const std::string & topic_name, uint64_t uncompressed_size, uint64_t compressed_size)
+{
+  if (compression_options_.compression_sample_messages == 0u) {
+    return;
+  }
+  auto & sampler = compression_samplers_[topic_name];
+  if (!sampler.sampling) {
+    return;
+  }
+  sampler.uncompressed_bytes += uncompressed_size;
+  sampler.compressed_bytes += compressed_size;
+  if (++sampler.message_count < compression_options_.compression_sample_messages) {
+    return;
+  }
+
+  const auto compression_ratio = sampler.uncompressed_bytes == 0u ? 1.0 :
+    static_cast<double>(sampler.compressed_bytes) / static_cast<double>(sampler.uncompressed_bytes);
+  const bool compress = compression_ratio < compression_options_.incompressible_ratio;
+  if (compress != sampler.compress) {
+    ROSBAG2_COMPRESSION_LOG_INFO_STREAM(
+      (compress ? "Compressing" : "Not compressing") << " the messages of topic \"" <<
+        topic_name << "\", which compressed to a ratio of " << compression_ratio);
+  }
+  sampler = CompressionSampler{false, compress};
+
+  std::lock_guard<std::mutex> lock(compression_mutex_);
+  auto & sample = compression_statistics_.topic_samples[topic_name];
+  sample.compression_ratio = compression_ratio;
+  sample.compressed = compress;
+}
+
+void SequentialCompressionWriter::adapt_message_compression_level(
+  std::chrono::nanoseconds compression_time, std::chrono::steady_clock::time_point now)
+{
+  adaptation_window_compression_time_ += compression_time;
+  const auto window_duration = now - adaptation_window_start_;
+  if (window_duration < kAdaptationWindow) {
+    return;
+  }
+
+  // Messages are compressed by the thread writing them, which falls behind the recorded data
+  // once it is busy compressing most of the time.
+  const auto compression_time_fraction =
+    static_cast<double>(adaptation_window_compression_time_.count()) /
+    static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      window_duration).count());
+  if (compression_time_fraction > kMaxCompressionTimeFraction) {
+    change_compression_level(-1);
+  } else if (compression_time_fraction < kMinCompressionTimeFraction) {
+    change_compression_level(1);
+  }
+  adaptation_window_start_ = now;
+  adaptation_window_compression_time_ = std::chrono::nanoseconds{0};
+}
+
+void SequentialCompressionWriter::change_compression_level(int step)
+{
+  const auto level = std::max(
+    compression_options_.compression_level_min,
+    std::min(compression_level_ + step, compression_options_.compression_level_max));
+  if (level == compression_level_) {
+    return;
+  }
+  ROSBAG2_COMPRESSION_LOG_DEBUG_STREAM(
+    "Changing compression level from " << compression_level_ << " to " << level);
+  compression_level_ = level;
+  compression_statistics_.current_compression_level = level;
+
+  // In FILE mode, the compression threads change the level of their compressors.
+  if (compression_options_.compression_mode != rosbag2_compression::CompressionMode::FILE) {
+    auto compression_options = compression_options_;
+    compression_options.compression_level = level;
+    compressor_->set_compression_options(compression_options);
+  }
+}
+
+void SequentialCompressionWriter::record_compression(
+  int level, uint64_t uncompressed_size, uint64_t compressed_size)
+{
+  ++compression_statistics_.compression_count;
+  compression_statistics_.uncompressed_bytes += uncompressed_size;
+  compression_statistics_.compressed_bytes += compressed_size;
+  ++compression_statistics_.compression_count_by_level[level];
+}
+
+CompressionStatistics SequentialCompressionWriter::get_compression_statistics() const
+{
+  std::lock_guard<std::mutex> lock(compression_mutex_);
+  return compression_statistics_;
 }
 
 void SequentialCompressionWriter::write(
@@ -271,13 +991,53 @@ void SequentialCompressionWriter::write(
     throw std::runtime_error{"Bag is not open. Call open() before writing."};
   }
 
+  if (reorder_buffer_) {
+    reordered_messages_.clear();
+    reorder_buffer_->add(std::move(message), reordered_messages_);
+    for (auto & reordered_message : reordered_messages_) {
+      write_in_order(std::move(reordered_message));
+    }
+    return;
+  }
+  write_in_order(std::move(message));
+}
+
+void SequentialCompressionWriter::flush_reorder_buffer()
+{
+  if (!reorder_buffer_) {
+    return;
+  }
+  reordered_messages_.clear();
+  reorder_buffer_->flush(reordered_messages_);
+  for (auto & reordered_message : reordered_messages_) {
+    write_in_order(std::move(reordered_message));
+  }
+  reordered_messages_.clear();
+}
+
+void SequentialCompressionWriter::write_in_order(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
   // Update the message count for the Topic.
-  ++topics_names_to_info_.at(message->topic_name).message_count;
+  auto & topic_info = topics_names_to_info_.at(message->topic_name);
+  ++topic_info.message_count;
+
+  if (clock_offset_.count() != 0) {
+    message = shift_time_stamps(*message, clock_offset_);
+  }
 
-  if (should_split_bagfile()) {
+  if (should_split_bagfile(*message)) {
+    // Chunks do not span bagfiles, so every file can be read on its own.
+    write_chunk();
+    write_pending_chunks(0);
     split_bagfile();
   }
 
+  if (current_file_message_count_ == 0) {
+    current_file_starting_time_ = message->time_stamp;
+  }
+  ++current_file_message_count_;
+
   const auto message_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>{
     std::chrono::nanoseconds(message->time_stamp)};
   metadata_.starting_time = std::min(metadata_.starting_time, message_timestamp);
@@ -285,33 +1045,165 @@ void SequentialCompressionWriter::write(
   const auto duration = message_timestamp - metadata_.starting_time;
   metadata_.duration = std::max(metadata_.duration, duration);
 
+  if (metadata_.files.size() < metadata_.relative_file_paths.size()) {
+    metadata_.files.resize(metadata_.relative_file_paths.size());
+  }
+  update_file_time_range(
+    metadata_.files.back(), message_timestamp, current_file_message_count_ == 1u);
+  auto & file = metadata_.files.back();
+  file.message_count = current_file_message_count_;
+  // Readers skip the files without any of the topics they read, before decompressing them.
+  const auto file_topic = current_file_topic_indices_.emplace(
+    message->topic_name, file.topics.size());
+  if (file_topic.second) {
+    file.topics.push_back(message->topic_name);
+    file.topic_message_counts.push_back(0);
+  }
+  ++file.topic_message_counts[file_topic.first->second];
+
   auto converted_message = converter_ ? converter_->convert(message) : message;
+  const auto message_size = get_serialized_size(*converted_message);
+  topic_info.total_size += message_size;
+  topic_info.max_message_size = std::max(topic_info.max_message_size, message_size);
+  if (delta_encoder_ && delta_encoder_->is_delta_encoded(message->topic_name)) {
+    converted_message = delta_encoder_->encode(*converted_message);
+  }
   if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::MESSAGE) {
-    compress_message(converted_message);
+    const auto topic_compressor = topic_compressors_.find(message->topic_name);
+    if (topic_compressor == topic_compressors_.end()) {
+      if (!compressor_ || !skip_incompressible_message(*compressor_, *converted_message)) {
+        compress_message(converted_message);
+        sample_compression(
+          message->topic_name, message_size, get_serialized_size(*converted_message));
+      }
+    } else if (topic_compressor->second.compressor &&
+      !skip_incompressible_message(*topic_compressor->second.compressor, *converted_message))
+    {
+      compress_topic_message(topic_compressor->second, *converted_message);
+      sample_compression(
+        message->topic_name, message_size, get_serialized_size(*converted_message));
+    }
+    topic_info.compressed_size += get_serialized_size(*converted_message);
+    if (encryptor_) {
+      encryptor_->encrypt_serialized_bag_message(converted_message.get());
+    }
+  } else if (compression_options_.compression_mode == rosbag2_compression::CompressionMode::CHUNK) {
+    chunk_.add_message(*converted_message);
+    chunk_memory_account_->set_allocated(chunk_.get_size());
+    if (is_chunk_full()) {
+      write_chunk();
+    }
+    return;
   }
 
   storage_->write(converted_message);
 }
 
-bool SequentialCompressionWriter::should_split_bagfile() const
+bool SequentialCompressionWriter::is_chunk_full() const
 {
-  if (max_bagfile_size_ == rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT) {
-    return false;
-  } else {
-    return storage_->get_bagfile_size() > max_bagfile_size_;
+  if ((compression_options_.chunk_max_bytes > 0u &&
+    chunk_.get_size() >= compression_options_.chunk_max_bytes) ||
+    chunk_memory_account_->is_budget_exhausted())
+  {
+    return true;
   }
+
+  const auto max_duration = std::chrono::milliseconds(compression_options_.chunk_max_duration_ms);
+  return max_duration.count() > 0 &&
+         std::chrono::nanoseconds(chunk_.get_end_time() - chunk_.get_start_time()) >= max_duration;
+}
+
+void SequentialCompressionWriter::write_chunk()
+{
+  if (chunk_.empty()) {
+    return;
+  }
+  auto chunk_message = chunk_.release();
+  chunk_memory_account_->set_allocated(0);
+  if (compressor_ && compressor_->is_asynchronous()) {
+    const auto uncompressed_size = get_serialized_size(*chunk_message);
+    ROSBAG2_TRACEPOINT(
+      compression_begin, chunk_message->topic_name.c_str(), chunk_message->time_stamp,
+      uncompressed_size);
+    auto compressed = compressor_->compress_serialized_bag_messages_async({chunk_message});
+    pending_chunks_.push_back({chunk_message, std::move(compressed), uncompressed_size});
+    write_pending_chunks(kMaxPendingChunks);
+    return;
+  }
+  compress_message(chunk_message);
+  if (encryptor_) {
+    encryptor_->encrypt_serialized_bag_message(chunk_message.get());
+  }
+  storage_->write(chunk_message);
+}
+
+void SequentialCompressionWriter::write_pending_chunks(size_t max_pending_chunks)
+{
+  while (!pending_chunks_.empty()) {
+    auto & chunk = pending_chunks_.front();
+    if (pending_chunks_.size() <= max_pending_chunks &&
+      chunk.compressed.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      return;
+    }
+    auto pending_chunk = std::move(chunk);
+    pending_chunks_.pop_front();
+    // Rethrows the exception of a failed compression.
+    pending_chunk.compressed.get();
+    const auto & chunk_message = pending_chunk.message;
+    ROSBAG2_TRACEPOINT(
+      compression_end, chunk_message->topic_name.c_str(), chunk_message->time_stamp,
+      get_serialized_size(*chunk_message));
+    {
+      std::lock_guard<std::mutex> lock(compression_mutex_);
+      record_compression(
+        compression_level_, pending_chunk.uncompressed_size, get_serialized_size(*chunk_message));
+    }
+    if (encryptor_) {
+      encryptor_->encrypt_serialized_bag_message(chunk_message.get());
+    }
+    storage_->write(chunk_message);
+  }
+}
+
+bool SequentialCompressionWriter::should_split_bagfile(
+  const rosbag2_storage::SerializedBagMessage & message) const
+{
+  if (max_bagfile_size_ != rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT &&
+    storage_->get_bagfile_size() > max_bagfile_size_)
+  {
+    return true;
+  }
+
+  if (max_bagfile_messages_ > 0u && current_file_message_count_ >= max_bagfile_messages_) {
+    return true;
+  }
+
+  return max_bagfile_duration_.count() > 0 && current_file_message_count_ > 0u &&
+         std::chrono::nanoseconds(message.time_stamp - current_file_starting_time_) >=
+         max_bagfile_duration_;
 }
 
 void SequentialCompressionWriter::finalize_metadata()
 {
   metadata_.bag_size = 0;
+  // The time ranges of the files are kept up to date while writing.
+  metadata_.files.resize(metadata_.relative_file_paths.size());
 
-  for (const auto & path : metadata_.relative_file_paths) {
+  for (size_t i = 0; i < metadata_.relative_file_paths.size(); ++i) {
+    const auto & path = metadata_.relative_file_paths[i];
     const auto bag_path = rcpputils::fs::path{path};
 
     if (bag_path.exists()) {
       metadata_.bag_size += bag_path.file_size();
     }
+    metadata_.files[i].path = path;
+    metadata_.files[i].indexed = true;
+  }
+
+  // With deferred index creation, a file is only indexed once its storage is closed.
+  if (storage_ && storage_config_.defer_index_creation && !metadata_.files.empty()) {
+    metadata_.files.back().indexed = false;
   }
 
   metadata_.topics_with_message_count.clear();
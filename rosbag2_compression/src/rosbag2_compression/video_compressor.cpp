@@ -0,0 +1,190 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_compression/video_compressor.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "image_frame.hpp"
+
+namespace
+{
+
+// String constant used to identify VideoCompressor.
+constexpr const char kCompressionIdentifier[] = "video";
+// Topic type whose messages are compressed as video.
+constexpr const char kImageTopicType[] = "sensor_msgs/msg/Image";
+// Bytes of a row which are kept or replaced together, so the unchanged bytes form long runs.
+constexpr const size_t kBlockSize = 16;
+// ZStandard level of the frames, as most of the compression is done before.
+constexpr const int kZstdCompressionLevel = 1;
+
+// Rounds to a multiple of tolerance + 1, which is at most half the tolerance away, so the noise of
+// a static scene up to the other half keeps the blocks of the next image.
+uint8_t quantize(uint8_t value, unsigned tolerance)
+{
+  const unsigned step = tolerance + 1u;
+  return static_cast<uint8_t>(std::min(255u, (value + step / 2u) / step * step));
+}
+
+// Keeps the blocks of the rows which differ from the same blocks of the reference by at most the
+// tolerance, and quantizes the other blocks, or all of them without a reference.
+void replenish_image_rows(
+  uint8_t * data, const uint8_t * reference, const rosbag2_compression::ImageRows & image_rows,
+  unsigned tolerance)
+{
+  for (size_t row = 0; row < image_rows.rows; ++row) {
+    const size_t row_offset = image_rows.data_offset + row * image_rows.step;
+    uint8_t * current = data + row_offset;
+    const uint8_t * previous = reference ? reference + row_offset : nullptr;
+    for (size_t begin = 0; begin < image_rows.step; begin += kBlockSize) {
+      const auto end = std::min<size_t>(image_rows.step, begin + kBlockSize);
+      bool is_unchanged = previous != nullptr;
+      for (auto i = begin; i < end && is_unchanged; ++i) {
+        is_unchanged = static_cast<unsigned>(std::abs(current[i] - previous[i])) <= tolerance;
+      }
+      if (is_unchanged) {
+        std::memcpy(current + begin, previous + begin, end - begin);
+      } else {
+        for (auto i = begin; i < end; ++i) {
+          current[i] = quantize(current[i], tolerance);
+        }
+      }
+    }
+  }
+}
+
+bool have_same_rows(
+  const rosbag2_compression::ImageRows & rows, const rosbag2_compression::ImageRows & other_rows)
+{
+  return rows.data_offset == other_rows.data_offset && rows.step == other_rows.step &&
+         rows.rows == other_rows.rows;
+}
+
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+std::string VideoCompressor::compress_uri(const std::string & uri)
+{
+  return zstd_compressor_.compress_uri(uri);
+}
+
+void VideoCompressor::compress_serialized_bag_message(
+  rosbag2_storage::SerializedBagMessage * bag_message)
+{
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot compress message without serialized data."};
+  }
+  const auto stream = streams_.find(bag_message->topic_name);
+  if (stream == streams_.end()) {
+    zstd_compressor_.compress_serialized_bag_message(bag_message);
+    prepend_image_frame_header(*bag_message->serialized_data, ImageRows{0, 0, 0});
+    return;
+  }
+
+  // Messages which are no images are delta encoded as well, as readers decode all of the topic.
+  const auto data = bag_message->serialized_data;
+  ImageRows image_rows{0, 0, 0};
+  const bool is_image = find_image_rows(*data, image_rows);
+  if (is_image) {
+    // The message may be shared with other writers or callbacks, so a copy is quantized.
+    auto quantized_data = rosbag2_storage::make_serialized_message(
+      data->buffer, data->buffer_length);
+    const auto & reference = stream->second.reference;
+    ImageRows reference_rows{0, 0, 0};
+    const bool has_reference =
+      reference && reference->buffer_length == quantized_data->buffer_length &&
+      find_image_rows(*reference, reference_rows) && have_same_rows(reference_rows, image_rows);
+    replenish_image_rows(
+      quantized_data->buffer, has_reference ? reference->buffer : nullptr, image_rows,
+      tolerance_);
+    // The delta encoder keeps the data as well, which is not changed once written.
+    stream->second.reference = quantized_data;
+    bag_message->serialized_data = std::move(quantized_data);
+  }
+  bag_message->serialized_data =
+    stream->second.delta_encoder->encode(*bag_message)->serialized_data;
+
+  // Keyframes hold the message after their frame type byte.
+  auto & encoded_data = *bag_message->serialized_data;
+  const auto keyframe = static_cast<uint8_t>(rosbag2_cpp::writers::DeltaFrameType::KEYFRAME);
+  ImageRows frame_rows{0, 0, 0};
+  if (is_image && encoded_data.buffer_length > 0 && encoded_data.buffer[0] == keyframe) {
+    frame_rows = image_rows;
+    frame_rows.data_offset += 1;
+    filter_image_rows(encoded_data.buffer, frame_rows);
+  }
+  zstd_compressor_.compress_serialized_bag_message(bag_message);
+  prepend_image_frame_header(*bag_message->serialized_data, frame_rows);
+}
+
+std::string VideoCompressor::get_compression_identifier() const
+{
+  return kCompressionIdentifier;
+}
+
+void VideoCompressor::set_compression_options(const CompressionOptions & compression_options)
+{
+  const auto level = compression_options.compression_level;
+  if (level < 0 || level > 255) {
+    std::stringstream errmsg;
+    errmsg << "Video compression level " << level << " is not in the supported range [0, 255].";
+    throw std::invalid_argument{errmsg.str()};
+  }
+  tolerance_ = static_cast<uint8_t>(level);
+  keyframe_interval_ = compression_options.keyframe_interval;
+
+  auto zstd_options = compression_options;
+  zstd_options.compression_level = kZstdCompressionLevel;
+  zstd_options.dictionary_training_messages = 0;
+  zstd_options.compression_dictionary = "";
+  zstd_compressor_.set_compression_options(zstd_options);
+}
+
+void VideoCompressor::register_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  if (topic.type != kImageTopicType) {
+    streams_.erase(topic.name);
+  } else if (streams_.find(topic.name) == streams_.end()) {
+    streams_[topic.name].delta_encoder =
+      std::make_unique<rosbag2_cpp::writers::MessageDeltaEncoder>(
+      std::vector<std::string>{topic.name}, keyframe_interval_);
+  }
+}
+
+bool VideoCompressor::is_delta_encoded(const std::string & topic_name) const
+{
+  return streams_.find(topic_name) != streams_.end();
+}
+
+void VideoCompressor::reset_deltas()
+{
+  for (auto & stream : streams_) {
+    stream.second.delta_encoder->reset();
+  }
+}
+
+}  // namespace rosbag2_compression
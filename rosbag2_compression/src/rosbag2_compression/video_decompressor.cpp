@@ -0,0 +1,35 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "rosbag2_compression/video_decompressor.hpp"
+
+namespace
+{
+
+// String constant used to identify VideoDecompressor.
+constexpr const char kDecompressionIdentifier[] = "video";
+
+}  // namespace
+
+namespace rosbag2_compression
+{
+
+std::string VideoDecompressor::get_decompression_identifier() const
+{
+  return kDecompressionIdentifier;
+}
+
+}  // namespace rosbag2_compression
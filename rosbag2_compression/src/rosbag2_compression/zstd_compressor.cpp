@@ -12,17 +12,30 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <zdict.h>
+
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
+#include "rcutils/error_handling.h"
+#include "rcutils/types/uint8_array.h"
+
 #include "rosbag2_compression/zstd_compressor.hpp"
 
 #include "logging.hpp"
+#include "magic_number.hpp"
 
 namespace
 {
@@ -32,8 +45,13 @@ namespace
 // Setting to zero uses Zstd's default value of 3.
 constexpr const int kDefaultZstdCompressionLevel = 1;
 
+// Maximum size of trained dictionaries. Larger dictionaries only pay off for larger messages.
+constexpr const size_t kMaxDictionarySize = 16 * 1024;
+
 // String constant used to identify ZstdCompressor.
 constexpr const char kCompressionIdentifier[] = "zstd";
+// Extension of the files dictionaries are written to.
+constexpr const char kDictionaryExtension[] = "zstd_dict";
 // Used as a parameter type in a function that accepts the output of ZSTD_compress.
 using ZstdCompressReturnType = decltype(ZSTD_compress(nullptr, 0, nullptr, 0, 0));
 
@@ -54,99 +72,72 @@ FILE * open_file(const std::string & uri, const std::string & read_mode)
   return fp;
 }
 
+using FilePointer = std::unique_ptr<FILE, decltype(&std::fclose)>;
+
 /**
- * Read a file from the supplied uri into a vector.
+ * Open a file for binary reading or writing.
  * \param uri is the path to the file.
- * \return the contents of the buffer as a vector.
+ * \param read_mode is the read mode accepted by OS-specific fopen.
+ * \return the FILE pointer, which closes the file when destroyed.
+ * \throws std::runtime_error if the file could not be opened.
  */
-std::vector<uint8_t> get_input_buffer(const std::string & uri)
+FilePointer open_binary_file(const std::string & uri, const std::string & read_mode)
 {
-  // Read in buffer, handling accordingly
-  const auto file_pointer = open_file(uri.c_str(), "rb");
+  auto file_pointer = FilePointer{open_file(uri, read_mode), &std::fclose};
   if (file_pointer == nullptr) {
     std::stringstream errmsg;
     errmsg << "Error opening file: \"" << uri <<
-      "\" for binary reading! errno(" << errno << ")";
+      "\" for binary " << (read_mode == "rb" ? "reading" : "writing") <<
+      "! errno(" << errno << ")";
 
     throw std::runtime_error{errmsg.str()};
   }
+  return file_pointer;
+}
 
-  const auto file_path = rcpputils::fs::path{uri};
-  const auto decompressed_buffer_length = file_path.exists() ? file_path.file_size() : 0u;
-
-  if (decompressed_buffer_length == 0) {
-    fclose(file_pointer);
-
-    std::stringstream errmsg;
-    errmsg << "Unable to get size of file: \"" << uri << "\"";
-
-    throw std::runtime_error{errmsg.str()};
-  }
-
-  // Allocate and read in
-  std::vector<uint8_t> decompressed_buffer(decompressed_buffer_length);
-
-  const auto read_count = fread(
-    decompressed_buffer.data(), sizeof(uint8_t), decompressed_buffer.size(), file_pointer);
-
-  if (read_count != decompressed_buffer_length) {
-    ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
-      "Bytes read (" << read_count <<
-        ") != decompressed_buffer_length (" << decompressed_buffer.size() << ")!");
-    // An error indicator is set by this, so the following check will throw
-  }
-
-  if (ferror(file_pointer)) {
-    fclose(file_pointer);
-
+/**
+ * Reads a whole binary file into memory.
+ * \param uri is the path to the file.
+ * \return the contents of the file.
+ * \throws std::runtime_error if the file could not be read.
+ */
+std::vector<uint8_t> read_binary_file(const std::string & uri)
+{
+  std::ifstream input{uri, std::ios::binary};
+  if (!input) {
     std::stringstream errmsg;
-    errmsg << "Unable to read binary data from file: \"" << uri << "\"!";
+    errmsg << "Error opening file: \"" << uri << "\" for binary reading!";
 
     throw std::runtime_error{errmsg.str()};
   }
-  fclose(file_pointer);
-  return decompressed_buffer;
+  return std::vector<uint8_t>{
+    std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
 }
 
 /**
- * Writes the output buffer to the specified file path.
- * \param output_buffer is the data to write.
+ * Writes a chunk of compressed data to a file.
+ * \param chunk is the data to write.
+ * \param chunk_size is the number of bytes to write.
+ * \param file_pointer is the file to write to.
  * \param uri is the relative file path to the output storage.
  */
-void write_output_buffer(
-  const std::vector<uint8_t> & output_buffer,
-  const std::string & uri)
+void write_output_chunk(
+  const uint8_t * chunk, size_t chunk_size, FILE * file_pointer, const std::string & uri)
 {
-  if (output_buffer.empty()) {
-    std::stringstream errmsg;
-    errmsg << "Cannot write empty buffer to file: \"" << uri << "\"";
-
-    throw std::runtime_error{errmsg.str()};
-  }
-
-  const auto file_pointer = open_file(uri.c_str(), "wb");
-  const auto write_count = fwrite(
-    output_buffer.data(),
-    sizeof(uint8_t),
-    output_buffer.size(),
-    file_pointer);
+  const auto write_count = fwrite(chunk, sizeof(uint8_t), chunk_size, file_pointer);
 
-  if (write_count != output_buffer.size()) {
+  if (write_count != chunk_size) {
     ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
-      "Bytes written (" << write_count <<
-        ") != output_buffer size (" << output_buffer.size() << ")!");
+      "Bytes written (" << write_count << ") != chunk size (" << chunk_size << ")!");
     // An error indicator is set by fwrite, so the following check will throw.
   }
 
   if (ferror(file_pointer)) {
-    fclose(file_pointer);
-
     std::stringstream errmsg;
     errmsg << "Unable to write compressed data to file: \"" << uri << "\"!";
 
     throw std::runtime_error{errmsg.str()};
   }
-  fclose(file_pointer);
 }
 
 /**
@@ -190,37 +181,127 @@ void print_compression_statistics(
 namespace rosbag2_compression
 {
 
+ZstdCompressor::ZstdCompressor()
+: zstd_context_(ZSTD_createCCtx(), &ZSTD_freeCCtx),
+  compression_level_(kDefaultZstdCompressionLevel)
+{
+  if (!zstd_context_) {
+    throw std::runtime_error{"Unable to create ZSTD compression context."};
+  }
+}
+
 std::string ZstdCompressor::compress_uri(const std::string & uri)
 {
   const auto start = std::chrono::high_resolution_clock::now();
   const auto compressed_uri = uri + "." + get_compression_identifier();
-  const auto decompressed_buffer = get_input_buffer(uri);
 
-  // Allocate based on compression bound and compress
-  const auto compressed_buffer_length = ZSTD_compressBound(decompressed_buffer.size());
-  std::vector<uint8_t> compressed_buffer(compressed_buffer_length);
+  const auto file_path = rcpputils::fs::path{uri};
+  const auto decompressed_size = file_path.exists() ? file_path.file_size() : 0u;
+  if (decompressed_size == 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to get size of file: \"" << uri << "\"";
 
-  // Perform compression and check.
-  // compression_result is either the actual compressed size or an error code.
-  const auto compression_result = ZSTD_compress(
-    compressed_buffer.data(), compressed_buffer.size(),
-    decompressed_buffer.data(), decompressed_buffer.size(), kDefaultZstdCompressionLevel);
-  throw_on_zstd_error(compression_result);
+    throw std::runtime_error{errmsg.str()};
+  }
 
-  // Compression_buffer_length might be larger than the actual compression size
-  // Resize compressed_buffer so its size is the actual compression size.
-  compressed_buffer.resize(compression_result);
-  write_output_buffer(compressed_buffer, compressed_uri);
+  const auto input_file = open_binary_file(uri, "rb");
+  auto output_file = open_binary_file(compressed_uri, "wb");
+  size_t compressed_size = 0;
+  try {
+    // The file is compressed in chunks, so memory use does not depend on the file size.
+    // The size is still stored in the frame, as decompressing whole files relied on it.
+    throw_on_zstd_error(ZSTD_CCtx_reset(zstd_context_.get(), ZSTD_reset_session_only));
+    throw_on_zstd_error(
+      ZSTD_CCtx_setParameter(zstd_context_.get(), ZSTD_c_compressionLevel, compression_level_));
+    // With workers, ZSTD_compressStream2 hands the input over to them and returns early.
+    throw_on_zstd_error(
+      ZSTD_CCtx_setParameter(zstd_context_.get(), ZSTD_c_nbWorkers, worker_threads_));
+    throw_on_zstd_error(ZSTD_CCtx_setPledgedSrcSize(zstd_context_.get(), decompressed_size));
+
+    std::vector<uint8_t> input_chunk(ZSTD_CStreamInSize());
+    std::vector<uint8_t> output_chunk(ZSTD_CStreamOutSize());
+    size_t read_size = 0;
+    bool is_last_chunk = false;
+    while (!is_last_chunk) {
+      const auto read_count = fread(
+        input_chunk.data(), sizeof(uint8_t), input_chunk.size(), input_file.get());
+      if (ferror(input_file.get())) {
+        std::stringstream errmsg;
+        errmsg << "Unable to read binary data from file: \"" << uri << "\"!";
+
+        throw std::runtime_error{errmsg.str()};
+      }
+      read_size += read_count;
+      // The file is expected to have the size pledged above, even if it is still growing.
+      is_last_chunk = read_count < input_chunk.size() || read_size >= decompressed_size;
+
+      ZSTD_inBuffer input{input_chunk.data(), read_count, 0};
+      bool is_chunk_done = false;
+      while (!is_chunk_done) {
+        ZSTD_outBuffer output{output_chunk.data(), output_chunk.size(), 0};
+        // remaining is either the number of bytes left to flush or an error code.
+        const auto remaining = ZSTD_compressStream2(
+          zstd_context_.get(), &output, &input, is_last_chunk ? ZSTD_e_end : ZSTD_e_continue);
+        throw_on_zstd_error(remaining);
+        write_output_chunk(output_chunk.data(), output.pos, output_file.get(), compressed_uri);
+        compressed_size += output.pos;
+        is_chunk_done = is_last_chunk ? remaining == 0 : input.pos == input.size;
+      }
+    }
+  } catch (...) {
+    // Do not leave a partially compressed file behind.
+    output_file.reset();
+    rcpputils::fs::remove(rcpputils::fs::path{compressed_uri});
+    throw;
+  }
+  if (std::fclose(output_file.release()) != 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to write compressed data to file: \"" << compressed_uri << "\"!";
+
+    throw std::runtime_error{errmsg.str()};
+  }
 
   const auto end = std::chrono::high_resolution_clock::now();
-  print_compression_statistics(start, end, decompressed_buffer.size(), compression_result);
+  print_compression_statistics(start, end, decompressed_size, compressed_size);
   return compressed_uri;
 }
 
 void ZstdCompressor::compress_serialized_bag_message(
-  rosbag2_storage::SerializedBagMessage *)
+  rosbag2_storage::SerializedBagMessage * bag_message)
 {
-  throw std::logic_error{"Not implemented"};
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot compress message without serialized data."};
+  }
+  auto & serialized_data = *bag_message->serialized_data;
+  const auto dictionary = get_dictionary(*bag_message);
+
+  // The buffer only grows, so messages of similar size are compressed without allocating.
+  const auto compressed_buffer_length = ZSTD_compressBound(serialized_data.buffer_length);
+  if (compressed_buffer_.size() < compressed_buffer_length) {
+    compressed_buffer_.resize(compressed_buffer_length);
+  }
+
+  // The frame names the id of the dictionary, so the decompressor can pick it.
+  const auto compression_result = dictionary ?
+    ZSTD_compress_usingCDict(
+    zstd_context_.get(), compressed_buffer_.data(), compressed_buffer_.size(),
+    serialized_data.buffer, serialized_data.buffer_length, dictionary) :
+    ZSTD_compressCCtx(
+    zstd_context_.get(), compressed_buffer_.data(), compressed_buffer_.size(),
+    serialized_data.buffer, serialized_data.buffer_length, compression_level_);
+  throw_on_zstd_error(compression_result);
+
+  // The compressed data usually fits into the buffer of the message, which is then reused.
+  if (serialized_data.buffer_capacity < compression_result) {
+    if (rcutils_uint8_array_resize(&serialized_data, compression_result) != RCUTILS_RET_OK) {
+      std::stringstream errmsg;
+      errmsg << "Unable to resize serialized message: " << rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error{errmsg.str()};
+    }
+  }
+  std::memcpy(serialized_data.buffer, compressed_buffer_.data(), compression_result);
+  serialized_data.buffer_length = compression_result;
 }
 
 std::string ZstdCompressor::get_compression_identifier() const
@@ -228,4 +309,163 @@ std::string ZstdCompressor::get_compression_identifier() const
   return kCompressionIdentifier;
 }
 
+bool ZstdCompressor::can_store_uncompressed(
+  const rosbag2_storage::SerializedBagMessage & bag_message) const
+{
+  // Messages starting like a frame would be mistaken for compressed ones by the reader.
+  return !starts_with_magic_number(bag_message, ZSTD_MAGICNUMBER);
+}
+
+void ZstdCompressor::set_compression_options(const CompressionOptions & compression_options)
+{
+  const auto level = compression_options.compression_level;
+  if (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel()) {
+    std::stringstream errmsg;
+    errmsg << "Zstd compression level " << level << " is not in the supported range [" <<
+      ZSTD_minCLevel() << ", " << ZSTD_maxCLevel() << "].";
+    throw std::invalid_argument{errmsg.str()};
+  }
+  const auto level_changed = level != compression_level_;
+  compression_level_ = level;
+
+  // The upper bound is 0 if libzstd was built without multithreading support.
+  const auto worker_bounds = ZSTD_cParam_getBounds(ZSTD_c_nbWorkers);
+  const auto max_worker_threads = ZSTD_isError(worker_bounds.error) ?
+    0u : static_cast<uint64_t>(worker_bounds.upperBound);
+  const auto worker_threads = compression_options.compression_worker_threads;
+  if (worker_threads > max_worker_threads) {
+    ROSBAG2_COMPRESSION_LOG_WARN_STREAM(
+      "Zstd supports at most " << max_worker_threads << " compression worker threads, " <<
+        worker_threads << " were requested.");
+  }
+  worker_threads_ = static_cast<int>(std::min(worker_threads, max_worker_threads));
+
+  dictionary_training_messages_ = compression_options.dictionary_training_messages;
+  const auto & dictionary_uri = compression_options.compression_dictionary;
+  if (dictionary_uri.empty()) {
+    shared_dictionary_.reset();
+    shared_dictionary_uri_.clear();
+  } else if (shared_dictionary_ && dictionary_uri == shared_dictionary_uri_) {
+    // The compression dictionary is bound to the level, but its content is kept.
+    if (level_changed) {
+      shared_dictionary_ = std::make_unique<Dictionary>(
+        make_dictionary(std::move(shared_dictionary_->content)));
+    }
+  } else {
+    shared_dictionary_.reset();
+    auto content = read_binary_file(dictionary_uri);
+    // Frames compressed with raw content dictionaries would not name the dictionary.
+    if (ZSTD_getDictID_fromDict(content.data(), content.size()) == 0) {
+      std::stringstream errmsg;
+      errmsg << "File \"" << dictionary_uri << "\" is not a zstd dictionary. " <<
+        "Dictionaries can be trained with \"zstd --train\".";
+      throw std::invalid_argument{errmsg.str()};
+    }
+    shared_dictionary_ = std::make_unique<Dictionary>(make_dictionary(std::move(content)));
+    shared_dictionary_uri_ = dictionary_uri;
+  }
+}
+
+void ZstdCompressor::register_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  topic_types_[topic.name] = topic.type;
+}
+
+std::vector<std::string> ZstdCompressor::write_dictionaries(const std::string & directory)
+{
+  std::vector<const Dictionary *> dictionaries;
+  if (shared_dictionary_) {
+    dictionaries.push_back(shared_dictionary_.get());
+  }
+  for (const auto & dictionary : dictionaries_) {
+    if (dictionary.second.compression_dictionary) {
+      dictionaries.push_back(&dictionary.second);
+    }
+  }
+
+  std::vector<std::string> uris;
+  for (const auto dictionary : dictionaries) {
+    const auto dictionary_id =
+      ZSTD_getDictID_fromDict(dictionary->content.data(), dictionary->content.size());
+    const auto uri = (rcpputils::fs::path{directory} /
+      ("dictionary_" + std::to_string(dictionary_id) + "." + kDictionaryExtension)).string();
+    std::ofstream output{uri, std::ios::binary};
+    output.write(
+      reinterpret_cast<const char *>(dictionary->content.data()),
+      static_cast<std::streamsize>(dictionary->content.size()));
+    output.close();
+    if (!output) {
+      std::stringstream errmsg;
+      errmsg << "Unable to write compression dictionary to file: \"" << uri << "\"!";
+
+      throw std::runtime_error{errmsg.str()};
+    }
+    uris.push_back(uri);
+  }
+  return uris;
+}
+
+ZstdCompressor::Dictionary ZstdCompressor::make_dictionary(std::vector<uint8_t> content) const
+{
+  Dictionary dictionary{std::move(content), {nullptr, &ZSTD_freeCDict}};
+  dictionary.compression_dictionary.reset(
+    ZSTD_createCDict(dictionary.content.data(), dictionary.content.size(), compression_level_));
+  if (!dictionary.compression_dictionary) {
+    throw std::runtime_error{"Unable to create ZSTD compression dictionary."};
+  }
+  return dictionary;
+}
+
+const ZSTD_CDict * ZstdCompressor::get_dictionary(
+  const rosbag2_storage::SerializedBagMessage & bag_message)
+{
+  if (shared_dictionary_) {
+    return shared_dictionary_->compression_dictionary.get();
+  }
+  if (dictionary_training_messages_ == 0) {
+    return nullptr;
+  }
+
+  // Messages of topics which were not registered are told apart by their topic name.
+  const auto topic_type = topic_types_.find(bag_message.topic_name);
+  const auto & key =
+    topic_type != topic_types_.end() ? topic_type->second : bag_message.topic_name;
+  const auto dictionary = dictionaries_.find(key);
+  if (dictionary != dictionaries_.end()) {
+    return dictionary->second.compression_dictionary.get();
+  }
+
+  // Messages are compressed without dictionary until enough samples were collected.
+  auto & samples = training_samples_[key];
+  const auto & serialized_data = *bag_message.serialized_data;
+  samples.data.insert(
+    samples.data.end(), serialized_data.buffer,
+    serialized_data.buffer + serialized_data.buffer_length);
+  samples.sizes.push_back(serialized_data.buffer_length);
+  if (samples.sizes.size() >= dictionary_training_messages_) {
+    train_dictionary(key, samples);
+    training_samples_.erase(key);
+  }
+  return nullptr;
+}
+
+void ZstdCompressor::train_dictionary(
+  const std::string & topic_type, const TrainingSamples & samples)
+{
+  std::vector<uint8_t> content(kMaxDictionarySize);
+  const auto dictionary_size = ZDICT_trainFromBuffer(
+    content.data(), content.size(), samples.data.data(), samples.sizes.data(),
+    static_cast<unsigned>(samples.sizes.size()));
+  if (ZDICT_isError(dictionary_size)) {
+    // An empty dictionary is kept, so the type is not trained again.
+    ROSBAG2_COMPRESSION_LOG_WARN_STREAM(
+      "Unable to train a compression dictionary for \"" << topic_type << "\": " <<
+        ZDICT_getErrorName(dictionary_size) << ". Its messages are compressed without.");
+    dictionaries_.emplace(topic_type, Dictionary{{}, {nullptr, &ZSTD_freeCDict}});
+    return;
+  }
+  content.resize(dictionary_size);
+  dictionaries_.emplace(topic_type, make_dictionary(std::move(content)));
+}
+
 }  // namespace rosbag2_compression
@@ -12,17 +12,27 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
+#include "rcutils/error_handling.h"
+#include "rcutils/types/uint8_array.h"
+
 #include "rosbag2_compression/zstd_decompressor.hpp"
 
 #include "logging.hpp"
+#include "magic_number.hpp"
 
 namespace
 {
@@ -53,112 +63,97 @@ FILE * open_file(const std::string & uri, const std::string & read_mode)
   return fp;
 }
 
+using FilePointer = std::unique_ptr<FILE, decltype(&std::fclose)>;
+
 /**
- * Read a file from the supplied uri into a vector.
+ * Open a file for binary reading or writing.
  *
  * \param uri is the path to the file.
- * \return the contents of the buffer as a vector.
+ * \param read_mode is the read mode string accepted by fopen.
+ * \return the FILE pointer, which closes the file when destroyed.
+ * \throws std::runtime_error if the file could not be opened.
  */
-std::vector<uint8_t> get_input_buffer(const std::string & uri)
+FilePointer open_binary_file(const std::string & uri, const std::string & read_mode)
 {
-  // Read in buffer, handling accordingly
-  const auto file_pointer = open_file(uri.c_str(), "rb");
+  auto file_pointer = FilePointer{open_file(uri, read_mode), &std::fclose};
   if (file_pointer == nullptr) {
     std::stringstream errmsg;
     errmsg << "Failed to open file: \"" << uri <<
-      "\" for binary reading! errno(" << errno << ")";
+      "\" for binary " << (read_mode == "rb" ? "reading" : "writing") <<
+      "! errno(" << errno << ")";
 
     throw std::runtime_error{errmsg.str()};
   }
+  return file_pointer;
+}
 
-  const auto file_path = rcpputils::fs::path{uri};
-  const auto compressed_buffer_length = file_path.exists() ? file_path.file_size() : 0u;
-  if (compressed_buffer_length == 0) {
-    fclose(file_pointer);
-
+/**
+ * Reads a whole binary file into memory.
+ * \param uri is the path to the file.
+ * \return the contents of the file.
+ * \throws std::runtime_error if the file could not be read.
+ */
+std::vector<uint8_t> read_binary_file(const std::string & uri)
+{
+  std::ifstream input{uri, std::ios::binary};
+  if (!input) {
     std::stringstream errmsg;
-    errmsg << "Unable to get size of file: \"" << uri << "\"";
+    errmsg << "Failed to open file: \"" << uri << "\" for binary reading!";
 
     throw std::runtime_error{errmsg.str()};
   }
+  return std::vector<uint8_t>{
+    std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+}
 
-  // Initialize compress_buffer with size = compressed_buffer_length.
-  // Uniform initialization cannot be used here since it will choose
-  // the initializer list constructor instead.
-  std::vector<uint8_t> compressed_buffer(compressed_buffer_length);
-
-  const auto read_count = fread(
-    compressed_buffer.data(), sizeof(decltype(compressed_buffer)::value_type),
-    compressed_buffer_length, file_pointer);
-
-  if (read_count != compressed_buffer_length) {
-    ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
-      "Bytes read !(" <<
-        read_count << ") != compressed_buffer size (" << compressed_buffer.size() <<
-        ")!");
-    // An error indicator is set by fread, so the following check will throw.
+/**
+ * Path of the file a file is decompressed to, which is named like the file without its
+ * compression extension.
+ * \param uri_path is the path to the compressed file.
+ * \param directory is the directory to decompress to, or empty for the directory of uri_path.
+ * \throws std::runtime_error if the directory does not exist.
+ */
+std::string get_decompressed_uri(
+  const rcpputils::fs::path & uri_path, const std::string & directory)
+{
+  const auto decompressed_path = rcpputils::fs::remove_extension(uri_path);
+  if (directory.empty()) {
+    return decompressed_path.string();
   }
-
-  if (ferror(file_pointer)) {
-    fclose(file_pointer);
-
+  const auto directory_path = rcpputils::fs::path{directory};
+  if (!directory_path.is_directory()) {
     std::stringstream errmsg;
-    errmsg << "Unable to read binary data from file: \"" << uri << "\"!";
+    errmsg << "Decompression directory: \"" << directory << "\" does not exist!";
 
     throw std::runtime_error{errmsg.str()};
   }
-
-  fclose(file_pointer);
-  return compressed_buffer;
+  return (directory_path / decompressed_path.filename()).string();
 }
 
 /**
- * Writes the output buffer to the specified file path.
- * \param output_buffer is the data to write.
+ * Writes a chunk of decompressed data to a file.
+ * \param chunk is the data to write.
+ * \param chunk_size is the number of bytes to write.
+ * \param file_pointer is the file to write to.
  * \param uri is the relative file path to the output storage.
  */
-void write_output_buffer(
-  const std::vector<uint8_t> & output_buffer,
-  const std::string & uri)
+void write_output_chunk(
+  const uint8_t * chunk, size_t chunk_size, FILE * file_pointer, const std::string & uri)
 {
-  if (output_buffer.empty()) {
-    std::stringstream errmsg;
-    errmsg << "Cannot write empty buffer to file: \"" << uri << "\"";
-
-    throw std::runtime_error{errmsg.str()};
-  }
-
-  const auto file_pointer = open_file(uri.c_str(), "wb");
-  if (file_pointer == nullptr) {
-    std::stringstream errmsg;
-    errmsg << "Failed to open file: \"" << uri <<
-      "\" for binary writing! errno(" << errno << ")";
+  const auto write_count = fwrite(chunk, sizeof(uint8_t), chunk_size, file_pointer);
 
-    throw std::runtime_error{errmsg.str()};
-  }
-
-  const auto write_count = fwrite(
-    output_buffer.data(), sizeof(uint8_t),
-    output_buffer.size(), file_pointer);
-
-  if (write_count != output_buffer.size()) {
+  if (write_count != chunk_size) {
     ROSBAG2_COMPRESSION_LOG_ERROR_STREAM(
-      "Bytes written (" <<
-        write_count << " != output_buffer size (" << output_buffer.size() <<
-        ")!");
+      "Bytes written (" << write_count << ") != chunk size (" << chunk_size << ")!");
     // An error indicator is set by fwrite, so the following check will throw.
   }
 
   if (ferror(file_pointer)) {
-    fclose(file_pointer);
-
     std::stringstream errmsg;
     errmsg << "Unable to write decompressed data to file: \"" << uri << "\"!";
 
     throw std::runtime_error{errmsg.str()};
   }
-
-  fclose(file_pointer);
 }
 
 /**
@@ -223,47 +218,179 @@ void print_decompression_statistics(
 namespace rosbag2_compression
 {
 
+ZstdDecompressor::ZstdDecompressor()
+: zstd_context_(ZSTD_createDCtx(), &ZSTD_freeDCtx)
+{
+  if (!zstd_context_) {
+    throw std::runtime_error{"Unable to create ZSTD decompression context."};
+  }
+}
+
 std::string ZstdDecompressor::decompress_uri(const std::string & uri)
+{
+  return decompress_uri_to_directory(uri, "");
+}
+
+std::string ZstdDecompressor::decompress_uri_to_directory(
+  const std::string & uri, const std::string & directory)
 {
   const auto start = std::chrono::high_resolution_clock::now();
   const auto uri_path = rcpputils::fs::path{uri};
-  const auto decompressed_uri = rcpputils::fs::remove_extension(uri_path).string();
-  const auto compressed_buffer = get_input_buffer(uri);
-  const auto compressed_buffer_length = compressed_buffer.size();
-
-  const auto decompressed_buffer_length =
-    ZSTD_getFrameContentSize(compressed_buffer.data(), compressed_buffer_length);
-
-  throw_on_invalid_frame_content(decompressed_buffer_length);
+  const auto decompressed_uri = get_decompressed_uri(uri_path, directory);
 
-  // Initializes decompressed_buffer with size = decompressed_buffer_length.
-  // Uniform initialization cannot be used here since it will choose
-  // the initializer list constructor instead.
-  std::vector<uint8_t> decompressed_buffer(decompressed_buffer_length);
+  const auto compressed_size = uri_path.exists() ? uri_path.file_size() : 0u;
+  if (compressed_size == 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to get size of file: \"" << uri << "\"";
 
-  const auto decompression_result = ZSTD_decompress(
-    decompressed_buffer.data(), decompressed_buffer_length,
-    compressed_buffer.data(), compressed_buffer_length);
+    throw std::runtime_error{errmsg.str()};
+  }
 
-  throw_on_zstd_error(decompression_result);
-  decompressed_buffer.resize(decompression_result);
+  const auto input_file = open_binary_file(uri, "rb");
+  auto output_file = open_binary_file(decompressed_uri, "wb");
+  size_t decompressed_size = 0;
+  try {
+    // The file is decompressed in chunks, so memory use does not depend on the file size.
+    throw_on_zstd_error(ZSTD_DCtx_reset(zstd_context_.get(), ZSTD_reset_session_only));
+
+    // The chunks are allocated once for all files decompressed by this instance.
+    input_chunk_.resize(ZSTD_DStreamInSize());
+    output_chunk_.resize(ZSTD_DStreamOutSize());
+    // Zero once a frame is completely decoded and flushed.
+    size_t last_result = 0;
+    size_t read_count = 0;
+    while ((read_count = fread(
+        input_chunk_.data(), sizeof(uint8_t), input_chunk_.size(), input_file.get())) > 0)
+    {
+      ZSTD_inBuffer input{input_chunk_.data(), read_count, 0};
+      while (input.pos < input.size) {
+        ZSTD_outBuffer output{output_chunk_.data(), output_chunk_.size(), 0};
+        last_result = ZSTD_decompressStream(zstd_context_.get(), &output, &input);
+        throw_on_zstd_error(last_result);
+        write_output_chunk(output_chunk_.data(), output.pos, output_file.get(), decompressed_uri);
+        decompressed_size += output.pos;
+      }
+    }
+
+    if (ferror(input_file.get())) {
+      std::stringstream errmsg;
+      errmsg << "Unable to read binary data from file: \"" << uri << "\"!";
+
+      throw std::runtime_error{errmsg.str()};
+    }
+    if (last_result != 0) {
+      std::stringstream errmsg;
+      errmsg << "Compressed file: \"" << uri << "\" is truncated!";
+
+      throw std::runtime_error{errmsg.str()};
+    }
+  } catch (...) {
+    // Do not leave a partially decompressed file behind.
+    output_file.reset();
+    rcpputils::fs::remove(rcpputils::fs::path{decompressed_uri});
+    throw;
+  }
+  if (std::fclose(output_file.release()) != 0) {
+    std::stringstream errmsg;
+    errmsg << "Unable to write decompressed data to file: \"" << decompressed_uri << "\"!";
 
-  write_output_buffer(decompressed_buffer, decompressed_uri);
+    throw std::runtime_error{errmsg.str()};
+  }
 
   const auto end = std::chrono::high_resolution_clock::now();
-  print_decompression_statistics(start, end, decompression_result, compressed_buffer_length);
+  print_decompression_statistics(start, end, decompressed_size, compressed_size);
 
   return decompressed_uri;
 }
 
 void ZstdDecompressor::decompress_serialized_bag_message(
-  rosbag2_storage::SerializedBagMessage *)
+  rosbag2_storage::SerializedBagMessage * bag_message)
 {
-  throw std::logic_error{"Not implemented"};
+  if (!bag_message->serialized_data) {
+    throw std::runtime_error{"Cannot decompress message without serialized data."};
+  }
+  auto & serialized_data = *bag_message->serialized_data;
+
+  const auto decompressed_buffer_length =
+    ZSTD_getFrameContentSize(serialized_data.buffer, serialized_data.buffer_length);
+  throw_on_invalid_frame_content(decompressed_buffer_length);
+
+  // Frames compressed with a dictionary name its id.
+  const auto dictionary_id =
+    ZSTD_getDictID_fromFrame(serialized_data.buffer, serialized_data.buffer_length);
+  const ZSTD_DDict * dictionary = nullptr;
+  if (dictionary_id != 0) {
+    const auto loaded_dictionary = dictionaries_.find(dictionary_id);
+    if (loaded_dictionary == dictionaries_.end()) {
+      std::stringstream errmsg;
+      errmsg << "Cannot decompress message of topic \"" << bag_message->topic_name <<
+        "\" without compression dictionary " << dictionary_id << "!";
+      throw std::runtime_error{errmsg.str()};
+    }
+    dictionary = loaded_dictionary->second.get();
+  }
+
+  // The message buffer receives the decompressed data, so the smaller compressed data is
+  // copied aside. The copy only grows, so it is rarely allocated.
+  compressed_buffer_.assign(
+    serialized_data.buffer, serialized_data.buffer + serialized_data.buffer_length);
+  if (serialized_data.buffer_capacity < decompressed_buffer_length) {
+    if (rcutils_uint8_array_resize(
+        &serialized_data, static_cast<size_t>(decompressed_buffer_length)) != RCUTILS_RET_OK)
+    {
+      std::stringstream errmsg;
+      errmsg << "Unable to resize serialized message: " << rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error{errmsg.str()};
+    }
+  }
+
+  const auto decompression_result = dictionary ?
+    ZSTD_decompress_usingDDict(
+    zstd_context_.get(), serialized_data.buffer, serialized_data.buffer_capacity,
+    compressed_buffer_.data(), compressed_buffer_.size(), dictionary) :
+    ZSTD_decompressDCtx(
+    zstd_context_.get(), serialized_data.buffer, serialized_data.buffer_capacity,
+    compressed_buffer_.data(), compressed_buffer_.size());
+  throw_on_zstd_error(decompression_result);
+  serialized_data.buffer_length = decompression_result;
 }
 
 std::string ZstdDecompressor::get_decompression_identifier() const
 {
   return kDecompressionIdentifier;
 }
+
+bool ZstdDecompressor::is_compressed_message(
+  const rosbag2_storage::SerializedBagMessage & bag_message) const
+{
+  return starts_with_magic_number(bag_message, ZSTD_MAGICNUMBER);
+}
+
+void ZstdDecompressor::load_dictionaries(const std::vector<std::string> & uris)
+{
+  for (const auto & uri : uris) {
+    const auto content = read_binary_file(uri);
+    auto dictionary = DictionaryPointer{
+      ZSTD_createDDict(content.data(), content.size()), &ZSTD_freeDDict};
+    if (!dictionary) {
+      std::stringstream errmsg;
+      errmsg << "Unable to load compression dictionary from file: \"" << uri << "\"!";
+      throw std::runtime_error{errmsg.str()};
+    }
+    const auto dictionary_id = ZSTD_getDictID_fromDDict(dictionary.get());
+    dictionaries_.erase(dictionary_id);
+    dictionaries_.emplace(dictionary_id, std::move(dictionary));
+  }
+}
+
+bool ZstdDecompressor::share_dictionaries(const BaseDecompressorInterface & other)
+{
+  const auto zstd_decompressor = dynamic_cast<const ZstdDecompressor *>(&other);
+  if (!zstd_decompressor) {
+    return false;
+  }
+  dictionaries_ = zstd_decompressor->dictionaries_;
+  return true;
+}
 }  // namespace rosbag2_compression
@@ -0,0 +1,199 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/aes_gcm_decryptor.hpp"
+#include "rosbag2_compression/aes_gcm_encryptor.hpp"
+#include "rosbag2_compression/encryption_factory.hpp"
+#include "rosbag2_compression/encryption_keys.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "gmock/gmock.h"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, const std::string & data)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+}  // namespace
+
+class AesGcmEncryptorTest : public rosbag2_test_common::TemporaryDirectoryFixture
+{
+public:
+  AesGcmEncryptorTest()
+  : key_{rosbag2_compression::generate_encryption_key()}
+  {}
+
+  std::vector<uint8_t> key_;
+};
+
+TEST_F(AesGcmEncryptorTest, encrypted_messages_are_decrypted_into_new_buffers)
+{
+  const std::string data = "some data of a message";
+  auto message = make_message("/topic", data);
+  const auto plain_data = message->serialized_data;
+  rosbag2_compression::AesGcmEncryptor encryptor{key_};
+  encryptor.encrypt_serialized_bag_message(message.get());
+
+  // The nonce and the tag are stored after the encrypted data.
+  ASSERT_THAT(message->serialized_data->buffer_length, Eq(data.size() + 28u));
+  EXPECT_THAT(get_data(*message).substr(0, data.size()), Ne(data));
+
+  // The encrypted data may be shared, e.g. with a mapped file, and is left unchanged.
+  const auto encrypted_data = message->serialized_data;
+  const auto encrypted = get_data(*message);
+  rosbag2_compression::AesGcmDecryptor decryptor{key_};
+  decryptor.decrypt_serialized_bag_message(message.get());
+  EXPECT_THAT(get_data(*message), Eq(data));
+  EXPECT_THAT(
+    std::string(
+      reinterpret_cast<const char *>(encrypted_data->buffer), encrypted_data->buffer_length),
+    Eq(encrypted));
+  EXPECT_THAT(
+    std::string(reinterpret_cast<const char *>(plain_data->buffer), plain_data->buffer_length),
+    Eq(data));
+}
+
+TEST_F(AesGcmEncryptorTest, equal_messages_are_encrypted_with_different_nonces)
+{
+  auto first_message = make_message("/topic", "data");
+  auto second_message = make_message("/topic", "data");
+  rosbag2_compression::AesGcmEncryptor encryptor{key_};
+  encryptor.encrypt_serialized_bag_message(first_message.get());
+  encryptor.encrypt_serialized_bag_message(second_message.get());
+
+  EXPECT_THAT(get_data(*first_message), Ne(get_data(*second_message)));
+}
+
+TEST_F(AesGcmEncryptorTest, changed_messages_are_not_decrypted)
+{
+  rosbag2_compression::AesGcmEncryptor encryptor{key_};
+  rosbag2_compression::AesGcmDecryptor decryptor{key_};
+
+  auto changed_data = make_message("/topic", "data");
+  encryptor.encrypt_serialized_bag_message(changed_data.get());
+  changed_data->serialized_data->buffer[0] ^= 1u;
+  EXPECT_THROW(decryptor.decrypt_serialized_bag_message(changed_data.get()), std::runtime_error);
+
+  // The topic name is authenticated along with the data.
+  auto changed_topic = make_message("/topic", "data");
+  encryptor.encrypt_serialized_bag_message(changed_topic.get());
+  changed_topic->topic_name = "/other_topic";
+  EXPECT_THROW(decryptor.decrypt_serialized_bag_message(changed_topic.get()), std::runtime_error);
+
+  // So is the time stamp, so messages cannot be reordered within their topic.
+  auto changed_time_stamp = make_message("/topic", "data");
+  changed_time_stamp->time_stamp = 1;
+  encryptor.encrypt_serialized_bag_message(changed_time_stamp.get());
+  changed_time_stamp->time_stamp = 2;
+  EXPECT_THROW(
+    decryptor.decrypt_serialized_bag_message(changed_time_stamp.get()), std::runtime_error);
+
+  auto truncated = make_message("/topic", "data");
+  truncated->serialized_data->buffer_length = 3;
+  EXPECT_THROW(decryptor.decrypt_serialized_bag_message(truncated.get()), std::runtime_error);
+}
+
+TEST_F(AesGcmEncryptorTest, messages_are_not_decrypted_with_another_key)
+{
+  auto message = make_message("/topic", "data");
+  rosbag2_compression::AesGcmEncryptor{key_}.encrypt_serialized_bag_message(message.get());
+
+  rosbag2_compression::AesGcmDecryptor decryptor{
+    rosbag2_compression::generate_encryption_key()};
+  EXPECT_THROW(decryptor.decrypt_serialized_bag_message(message.get()), std::runtime_error);
+}
+
+TEST_F(AesGcmEncryptorTest, keys_of_the_wrong_size_are_rejected)
+{
+  EXPECT_THROW(
+    rosbag2_compression::AesGcmEncryptor(std::vector<uint8_t>(16)), std::invalid_argument);
+  EXPECT_THROW(
+    rosbag2_compression::AesGcmDecryptor(std::vector<uint8_t>(16)), std::invalid_argument);
+}
+
+TEST_F(AesGcmEncryptorTest, factory_creates_aes_gcm_and_rejects_unknown_formats)
+{
+  rosbag2_compression::EncryptionFactory factory;
+  EXPECT_THAT(
+    factory.create_encryptor("AES_GCM", key_)->get_encryption_identifier(), Eq("aes_gcm"));
+  EXPECT_THAT(
+    factory.create_decryptor("aes_gcm", key_)->get_decryption_identifier(), Eq("aes_gcm"));
+  EXPECT_THROW(factory.create_encryptor("rot13", key_), std::invalid_argument);
+  EXPECT_THROW(factory.create_decryptor("rot13", key_), std::invalid_argument);
+}
+
+TEST_F(AesGcmEncryptorTest, bag_keys_are_only_decrypted_with_their_master_key)
+{
+  const auto master_key = rosbag2_compression::generate_encryption_key();
+  const auto encrypted_key = rosbag2_compression::encrypt_key(key_, master_key);
+
+  EXPECT_THAT(rosbag2_compression::decrypt_key(encrypted_key, master_key), Eq(key_));
+  EXPECT_THROW(
+    rosbag2_compression::decrypt_key(
+      encrypted_key, rosbag2_compression::generate_encryption_key()),
+    std::runtime_error);
+  EXPECT_THROW(rosbag2_compression::decrypt_key("not hex", master_key), std::runtime_error);
+}
+
+TEST_F(AesGcmEncryptorTest, key_files_hold_raw_or_hexadecimal_keys)
+{
+  const auto hex_file = temporary_dir_path_ + "/hex.key";
+  std::ofstream{hex_file} <<
+    "00112233445566778899aabbccddeeff00112233445566778899AABBCCDDEEFF\n";
+  const auto hex_key = rosbag2_compression::read_encryption_key_file(hex_file);
+  ASSERT_THAT(hex_key, SizeIs(32u));
+  EXPECT_THAT(hex_key[1], Eq(0x11));
+  EXPECT_THAT(hex_key[31], Eq(0xFF));
+
+  const auto raw_file = temporary_dir_path_ + "/raw.key";
+  std::ofstream{raw_file, std::ios::binary}.write(
+    reinterpret_cast<const char *>(key_.data()), static_cast<std::streamsize>(key_.size()));
+  EXPECT_THAT(rosbag2_compression::read_encryption_key_file(raw_file), Eq(key_));
+  EXPECT_THAT(
+    rosbag2_compression::get_encryption_key_id(key_),
+    Eq(rosbag2_compression::get_encryption_key_id(
+      rosbag2_compression::read_encryption_key_file(raw_file))));
+
+  const auto short_file = temporary_dir_path_ + "/short.key";
+  std::ofstream{short_file} << "0011";
+  EXPECT_THROW(rosbag2_compression::read_encryption_key_file(short_file), std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_compression::read_encryption_key_file(temporary_dir_path_ + "/missing.key"),
+    std::runtime_error);
+}
@@ -14,10 +14,13 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
 #include <string>
 #include <algorithm>
 
 #include "rosbag2_compression/compression_factory.hpp"
+#include "rosbag2_compression/lz4_compressor.hpp"
+#include "rosbag2_compression/lz4_decompressor.hpp"
 
 namespace
 {
@@ -89,3 +92,52 @@ TEST_F(CompressionFactoryTest, throws_on_bad_decompressor_format) {
   const auto compression_format = "bar";
   ASSERT_THROW(factory.create_decompressor(compression_format), std::invalid_argument);
 }
+
+TEST_F(CompressionFactoryTest, creates_lz4_compressors)
+{
+  EXPECT_EQ("lz4", factory.create_compressor("lz4")->get_compression_identifier());
+  EXPECT_EQ("lz4hc", factory.create_compressor("LZ4HC")->get_compression_identifier());
+}
+
+TEST_F(CompressionFactoryTest, creates_lz4_decompressor_for_both_variants)
+{
+  EXPECT_EQ("lz4", factory.create_decompressor("lz4")->get_decompression_identifier());
+  EXPECT_EQ("lz4", factory.create_decompressor("lz4hc")->get_decompression_identifier());
+}
+
+TEST_F(CompressionFactoryTest, creates_image_compressor_and_decompressor)
+{
+  EXPECT_EQ("image", factory.create_compressor("image")->get_compression_identifier());
+  EXPECT_EQ("image", factory.create_decompressor("Image")->get_decompression_identifier());
+}
+
+TEST_F(CompressionFactoryTest, creates_video_compressor_and_decompressor)
+{
+  EXPECT_EQ("video", factory.create_compressor("video")->get_compression_identifier());
+  EXPECT_EQ("video", factory.create_decompressor("Video")->get_decompression_identifier());
+}
+
+TEST_F(CompressionFactoryTest, creates_compressors_of_registered_formats)
+{
+  rosbag2_compression::CompressionFactory::register_compression_format(
+    "registered_lz4",
+    [] {return std::make_unique<rosbag2_compression::Lz4Compressor>();},
+    [] {return std::make_unique<rosbag2_compression::Lz4Decompressor>();});
+  EXPECT_EQ("lz4", factory.create_compressor("Registered_LZ4")->get_compression_identifier());
+  EXPECT_EQ("lz4", factory.create_decompressor("registered_lz4")->get_decompression_identifier());
+}
+
+TEST_F(CompressionFactoryTest, throws_on_registering_built_in_or_incomplete_formats)
+{
+  EXPECT_THROW(
+    rosbag2_compression::CompressionFactory::register_compression_format(
+      "ZSTD",
+      [] {return std::make_unique<rosbag2_compression::Lz4Compressor>();},
+      [] {return std::make_unique<rosbag2_compression::Lz4Decompressor>();}),
+    std::invalid_argument);
+  EXPECT_THROW(
+    rosbag2_compression::CompressionFactory::register_compression_format(
+      "incomplete", [] {return std::make_unique<rosbag2_compression::Lz4Compressor>();}, {}),
+    std::invalid_argument);
+  EXPECT_THROW(factory.create_compressor("incomplete"), std::invalid_argument);
+}
@@ -74,6 +74,14 @@ TEST(CompressionOptionsFromStringTest, MessageStringReturnsMessageMode)
   EXPECT_EQ(compression_mode, rosbag2_compression::CompressionMode::MESSAGE);
 }
 
+TEST(CompressionOptionsFromStringTest, MixedCaseChunkStringReturnsChunkMode)
+{
+  const std::string compression_mode_string{"ChUnK"};
+  const auto compression_mode = rosbag2_compression::compression_mode_from_string(
+    compression_mode_string);
+  EXPECT_EQ(compression_mode, rosbag2_compression::CompressionMode::CHUNK);
+}
+
 TEST(CompressionOptionsToStringTest, BadModeReturnsNoneString)
 {
   // Get an out of bounds enum from CompressionMode
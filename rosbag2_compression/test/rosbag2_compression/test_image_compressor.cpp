@@ -0,0 +1,153 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/image_compressor.hpp"
+#include "rosbag2_compression/image_decompressor.hpp"
+#include "rosbag2_compression/zstd_compressor.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "gmock/gmock.h"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+constexpr const char kImageTopic[] = "/camera/image_raw";
+
+// Serializes a sensor_msgs/msg/Image with a smooth rgb8 gradient as CDR of either endianness.
+std::string make_image_cdr(uint32_t height, uint32_t width, bool little_endian)
+{
+  std::string cdr{'\0', little_endian ? '\1' : '\0', '\0', '\0'};
+  const auto align = [&cdr]() {
+      while ((cdr.size() - 4) % 4 != 0) {
+        cdr.push_back('\0');
+      }
+    };
+  const auto add_uint32 = [&cdr, &align, little_endian](uint32_t value) {
+      align();
+      for (int byte = 0; byte < 4; ++byte) {
+        const auto shift = 8 * (little_endian ? byte : 3 - byte);
+        cdr.push_back(static_cast<char>(value >> shift));
+      }
+    };
+  const auto add_string = [&cdr, &add_uint32](const std::string & value) {
+      add_uint32(static_cast<uint32_t>(value.size() + 1));
+      cdr += value;
+      cdr.push_back('\0');
+    };
+
+  add_uint32(1234);
+  add_uint32(5678);
+  add_string("camera_frame");
+  add_uint32(height);
+  add_uint32(width);
+  add_string("rgb8");
+  cdr.push_back('\0');
+  add_uint32(width * 3);
+  add_uint32(height * width * 3);
+  for (uint32_t row = 0; row < height; ++row) {
+    for (uint32_t column = 0; column < width; ++column) {
+      cdr.push_back(static_cast<char>(row + column));
+      cdr.push_back(static_cast<char>(row * 2));
+      cdr.push_back(static_cast<char>(column * 3 + (row * column) % 5));
+    }
+  }
+  return cdr;
+}
+
+rosbag2_storage::SerializedBagMessage make_message(
+  const std::string & data, const std::string & topic_name = kImageTopic)
+{
+  rosbag2_storage::SerializedBagMessage message;
+  message.topic_name = topic_name;
+  message.serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+}  // namespace
+
+class ImageCompressorTest : public Test
+{
+public:
+  ImageCompressorTest()
+  {
+    compressor_.register_topic({kImageTopic, "sensor_msgs/msg/Image", "cdr", ""});
+    compressor_.register_topic({"/points", "sensor_msgs/msg/PointCloud2", "cdr", ""});
+  }
+
+  rosbag2_compression::ImageCompressor compressor_{};
+  rosbag2_compression::ImageDecompressor decompressor_{};
+};
+
+TEST_F(ImageCompressorTest, restores_images_of_either_endianness_bit_exactly)
+{
+  for (const bool little_endian : {true, false}) {
+    const auto image = make_image_cdr(48, 64, little_endian);
+    auto message = make_message(image);
+    compressor_.compress_serialized_bag_message(&message);
+    EXPECT_TRUE(decompressor_.is_compressed_message(message));
+    decompressor_.decompress_serialized_bag_message(&message);
+    EXPECT_THAT(get_data(message), Eq(image));
+  }
+}
+
+TEST_F(ImageCompressorTest, images_compress_better_than_with_zstd_alone)
+{
+  const auto image = make_image_cdr(240, 320, true);
+  auto image_message = make_message(image);
+  compressor_.compress_serialized_bag_message(&image_message);
+  auto zstd_message = make_message(image);
+  rosbag2_compression::ZstdCompressor{}.compress_serialized_bag_message(&zstd_message);
+
+  EXPECT_THAT(
+    image_message.serialized_data->buffer_length,
+    Lt(zstd_message.serialized_data->buffer_length));
+}
+
+TEST_F(ImageCompressorTest, restores_messages_of_other_topics_and_malformed_images)
+{
+  const auto image = make_image_cdr(16, 16, true);
+  const auto truncated_image = image.substr(0, image.size() - 1);
+  for (const auto & message_data : {image, truncated_image}) {
+    for (const std::string topic_name : {"/points", "/unregistered", kImageTopic}) {
+      auto message = make_message(message_data, topic_name);
+      compressor_.compress_serialized_bag_message(&message);
+      decompressor_.decompress_serialized_bag_message(&message);
+      EXPECT_THAT(get_data(message), Eq(message_data));
+    }
+  }
+}
+
+TEST_F(ImageCompressorTest, tells_uncompressed_messages_apart_from_frames)
+{
+  const auto message = make_message(make_image_cdr(4, 4, true));
+  EXPECT_TRUE(compressor_.can_store_uncompressed(message));
+  EXPECT_FALSE(decompressor_.is_compressed_message(message));
+  auto not_a_frame = make_message("not a frame");
+  EXPECT_THROW(
+    decompressor_.decompress_serialized_bag_message(&not_a_frame), std::runtime_error);
+}
@@ -0,0 +1,156 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_compression/compression_options.hpp"
+#include "rosbag2_compression/lz4_compressor.hpp"
+#include "rosbag2_compression/lz4_decompressor.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "gmock/gmock.h"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+constexpr const char kGarbageStatement[] = "garbage";
+
+/**
+ * Creates a text file of a few MiB, which is compressible but not trivially so.
+ * \param uri File path to write file.
+ */
+void create_garbage_file(const std::string & uri)
+{
+  auto out = std::ofstream{uri};
+  out.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+  const auto num_iterations = 1024 * 1024 / static_cast<int>(strlen(kGarbageStatement));
+  for (int i = 0; i < num_iterations; i++) {
+    out << kGarbageStatement << i;
+  }
+}
+
+std::vector<char> read_file(const std::string & uri)
+{
+  auto infile = std::ifstream{uri, std::ios_base::binary};
+  infile.exceptions(std::ifstream::badbit);
+  return std::vector<char>{
+    std::istreambuf_iterator<char>{infile}, std::istreambuf_iterator<char>{}};
+}
+
+rosbag2_storage::SerializedBagMessage make_message(const std::string & data)
+{
+  rosbag2_storage::SerializedBagMessage message;
+  message.topic_name = "/test_topic";
+  message.serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+}  // namespace
+
+class Lz4CompressorTest
+  : public rosbag2_test_common::TemporaryDirectoryFixture, public WithParamInterface<bool>
+{
+};
+
+TEST_P(Lz4CompressorTest, compresses_and_decompresses_file)
+{
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "file1.txt").string();
+  create_garbage_file(uri);
+  const auto initial_contents = read_file(uri);
+
+  auto compressor = rosbag2_compression::Lz4Compressor{GetParam()};
+  rosbag2_compression::CompressionOptions options{};
+  options.compression_level = GetParam() ? 9 : -1;
+  compressor.set_compression_options(options);
+  const auto compressed_uri = compressor.compress_uri(uri);
+
+  EXPECT_EQ(compressed_uri, uri + ".lz4");
+  EXPECT_LT(
+    rcpputils::fs::file_size(rcpputils::fs::path{compressed_uri}),
+    rcpputils::fs::file_size(rcpputils::fs::path{uri}));
+  ASSERT_TRUE(rcpputils::fs::remove(rcpputils::fs::path{uri}));
+
+  auto decompressor = rosbag2_compression::Lz4Decompressor{};
+  const auto decompressed_uri = decompressor.decompress_uri(compressed_uri);
+
+  EXPECT_EQ(decompressed_uri, uri);
+  EXPECT_EQ(read_file(decompressed_uri), initial_contents);
+}
+
+TEST_P(Lz4CompressorTest, compresses_and_decompresses_messages)
+{
+  auto compressor = rosbag2_compression::Lz4Compressor{GetParam()};
+  auto decompressor = rosbag2_compression::Lz4Decompressor{};
+
+  // The buffers of compressor and decompressor are reused for messages of different size.
+  const std::vector<std::string> contents{
+    std::string(10000, 'a'), "", "short message", std::string(500, 'b') + "end"};
+  for (const auto & content : contents) {
+    auto message = make_message(content);
+    compressor.compress_serialized_bag_message(&message);
+    if (content.size() > 100) {
+      EXPECT_LT(message.serialized_data->buffer_length, content.size());
+    }
+
+    decompressor.decompress_serialized_bag_message(&message);
+    EXPECT_EQ(get_data(message), content);
+  }
+}
+
+TEST_P(Lz4CompressorTest, rejects_truncated_message)
+{
+  auto compressor = rosbag2_compression::Lz4Compressor{GetParam()};
+  auto message = make_message(std::string(10000, 'a'));
+  compressor.compress_serialized_bag_message(&message);
+  message.serialized_data->buffer_length -= 4;
+
+  auto decompressor = rosbag2_compression::Lz4Decompressor{};
+  EXPECT_THROW(
+    decompressor.decompress_serialized_bag_message(&message), std::runtime_error);
+}
+
+TEST_P(Lz4CompressorTest, tells_uncompressed_messages_apart_from_frames)
+{
+  auto compressor = rosbag2_compression::Lz4Compressor{GetParam()};
+  auto decompressor = rosbag2_compression::Lz4Decompressor{};
+  auto message = make_message("uncompressed");
+  EXPECT_TRUE(compressor.can_store_uncompressed(message));
+  EXPECT_FALSE(decompressor.is_compressed_message(message));
+
+  compressor.compress_serialized_bag_message(&message);
+  EXPECT_FALSE(compressor.can_store_uncompressed(message));
+  EXPECT_TRUE(decompressor.is_compressed_message(message));
+}
+
+INSTANTIATE_TEST_CASE_P(
+  Lz4CompressorTests, Lz4CompressorTest, Values(false, true));
@@ -0,0 +1,133 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "rosbag2_compression/message_chunk.hpp"
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, rcutils_time_point_value_t time_stamp, const std::string & data)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->time_stamp = time_stamp;
+  message->publish_time_stamp = time_stamp - 1;
+  message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+}  // namespace
+
+TEST(MessageChunkTest, parse_restores_released_messages)
+{
+  rosbag2_compression::MessageChunk chunk;
+  EXPECT_TRUE(chunk.empty());
+  chunk.add_message(*make_message("/tf", 20, "first"));
+  chunk.add_message(*make_message("/diagnostics", 10, ""));
+  chunk.add_message(*make_message("/tf", 30, "third"));
+
+  EXPECT_THAT(chunk.get_message_count(), Eq(3u));
+  EXPECT_THAT(chunk.get_start_time(), Eq(10));
+  EXPECT_THAT(chunk.get_end_time(), Eq(30));
+
+  const auto chunk_message = chunk.release();
+  EXPECT_TRUE(chunk.empty());
+  EXPECT_THAT(chunk.get_size(), Eq(0u));
+  EXPECT_THAT(chunk_message->topic_name, Eq(rosbag2_compression::kChunkTopicName));
+  EXPECT_THAT(chunk_message->publish_time_stamp, Eq(10));
+  EXPECT_THAT(chunk_message->time_stamp, Eq(30));
+
+  const auto messages = rosbag2_compression::MessageChunk::parse(*chunk_message->serialized_data);
+  ASSERT_THAT(messages, SizeIs(3u));
+  EXPECT_THAT(messages[0]->topic_name, Eq("/tf"));
+  EXPECT_THAT(messages[0]->time_stamp, Eq(20));
+  EXPECT_THAT(messages[0]->publish_time_stamp, Eq(19));
+  EXPECT_THAT(get_data(*messages[0]), Eq("first"));
+  EXPECT_THAT(messages[1]->topic_name, Eq("/diagnostics"));
+  EXPECT_THAT(get_data(*messages[1]), Eq(""));
+  EXPECT_THAT(messages[2]->time_stamp, Eq(30));
+  EXPECT_THAT(get_data(*messages[2]), Eq("third"));
+}
+
+TEST(MessageChunkTest, parse_takes_messages_and_data_from_pool)
+{
+  rosbag2_compression::MessageChunk chunk;
+  chunk.add_message(*make_message("/tf", 20, "first"));
+  chunk.add_message(*make_message("/tf", 30, "second"));
+  const auto chunk_message = chunk.release();
+
+  rosbag2_storage::MessagePool message_pool;
+  rosbag2_compression::MessageChunk::parse(*chunk_message->serialized_data, &message_pool);
+  EXPECT_THAT(message_pool.get_pooled_message_count(), Eq(2u));
+  EXPECT_THAT(message_pool.get_pooled_buffer_count(), Eq(2u));
+
+  // The messages released by the first parse are handed out again.
+  const auto messages =
+    rosbag2_compression::MessageChunk::parse(*chunk_message->serialized_data, &message_pool);
+  EXPECT_THAT(message_pool.get_pooled_message_count(), Eq(0u));
+  EXPECT_THAT(message_pool.get_pooled_buffer_count(), Eq(0u));
+  ASSERT_THAT(messages, SizeIs(2u));
+  EXPECT_THAT(messages[0]->topic_name, Eq("/tf"));
+  EXPECT_THAT(get_data(*messages[0]), Eq("first"));
+  EXPECT_THAT(messages[1]->time_stamp, Eq(30));
+  EXPECT_THAT(get_data(*messages[1]), Eq("second"));
+}
+
+TEST(MessageChunkTest, parsed_messages_reference_the_shared_chunk)
+{
+  rosbag2_compression::MessageChunk chunk;
+  chunk.add_message(*make_message("/tf", 20, "first"));
+  chunk.add_message(*make_message("/tf", 30, "second"));
+  auto chunk_data = chunk.release()->serialized_data;
+  const auto chunk_begin = chunk_data->buffer;
+  const auto chunk_end = chunk_data->buffer + chunk_data->buffer_length;
+
+  const auto messages = rosbag2_compression::MessageChunk::parse(chunk_data);
+  chunk_data.reset();
+  ASSERT_THAT(messages, SizeIs(2u));
+  EXPECT_TRUE(rosbag2_storage::is_serialized_data_view(*messages[0]->serialized_data));
+  EXPECT_THAT(messages[0]->serialized_data->buffer, AllOf(Ge(chunk_begin), Lt(chunk_end)));
+  EXPECT_THAT(get_data(*messages[0]), Eq("first"));
+  EXPECT_THAT(messages[1]->time_stamp, Eq(30));
+  EXPECT_THAT(get_data(*messages[1]), Eq("second"));
+}
+
+TEST(MessageChunkTest, parse_throws_on_truncated_chunk)
+{
+  rosbag2_compression::MessageChunk chunk;
+  chunk.add_message(*make_message("/tf", 20, "data"));
+  const auto chunk_message = chunk.release();
+  --chunk_message->serialized_data->buffer_length;
+
+  EXPECT_THROW(
+    rosbag2_compression::MessageChunk::parse(*chunk_message->serialized_data),
+    std::runtime_error);
+}
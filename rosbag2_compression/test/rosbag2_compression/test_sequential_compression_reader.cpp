@@ -14,15 +14,25 @@
 
 #include <gmock/gmock.h>
 
+#include <fstream>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_compression/aes_gcm_encryptor.hpp"
+#include "rosbag2_compression/encryption_keys.hpp"
 #include "rosbag2_compression/sequential_compression_reader.hpp"
+#include "rosbag2_compression/zstd_compressor.hpp"
 
 #include "rosbag2_cpp/reader.hpp"
 
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_converter_factory.hpp"
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_metadata_io.hpp"
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_storage.hpp"
@@ -33,7 +43,7 @@
 
 using namespace testing;  // NOLINT
 
-class SequentialCompressionReaderTest : public Test
+class SequentialCompressionReaderTest : public rosbag2_test_common::TemporaryDirectoryFixture
 {
 public:
   SequentialCompressionReaderTest()
@@ -188,3 +198,345 @@ TEST_F(SequentialCompressionReaderTest, compression_called_when_splitting_bagfil
   EXPECT_EQ(compression_reader->has_next(), true);
   compression_reader->read_next();
 }
+
+TEST_F(SequentialCompressionReaderTest, decompresses_next_file_ahead_and_removes_read_files)
+{
+  const auto compressed_path_1 = (rcpputils::fs::path(temporary_dir_path_) / "storage1.zstd");
+  const auto compressed_path_2 = (rcpputils::fs::path(temporary_dir_path_) / "storage2.zstd");
+  std::ofstream{compressed_path_1.string()} << "compressed";
+  std::ofstream{compressed_path_2.string()} << "compressed";
+  const auto decompressed_path_1 = rcpputils::fs::remove_extension(compressed_path_1);
+  const auto decompressed_path_2 = rcpputils::fs::remove_extension(compressed_path_2);
+
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {compressed_path_1.string(), compressed_path_2.string()};
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 10});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::FILE);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  auto decompressor = std::make_unique<NiceMock<MockDecompressor>>();
+  ON_CALL(*decompressor, decompress_uri(_)).WillByDefault(
+    Invoke(
+      [](const std::string & uri) {
+        const auto decompressed_uri =
+        rcpputils::fs::remove_extension(rcpputils::fs::path{uri}).string();
+        std::ofstream{decompressed_uri} << "decompressed";
+        return decompressed_uri;
+      }));
+  // Every file is decompressed once, the second one while the first one is read.
+  EXPECT_CALL(*decompressor, decompress_uri(compressed_path_1.string())).Times(1);
+  EXPECT_CALL(*decompressor, decompress_uri(compressed_path_2.string())).Times(1);
+
+  auto compression_factory = std::make_unique<StrictMock<MockCompressionFactory>>();
+  ON_CALL(*compression_factory, create_decompressor(_))
+  .WillByDefault(Return(ByMove(std::move(decompressor))));
+  EXPECT_CALL(*compression_factory, create_decompressor(_)).Times(1);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(2);
+  EXPECT_CALL(*storage_, has_next())
+  .WillOnce(Return(false))
+  .WillRepeatedly(Return(true));
+
+  auto compression_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::move(compression_factory),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+
+  compression_reader->open(
+    rosbag2_cpp::StorageOptions(), {"", storage_serialization_format_});
+  EXPECT_TRUE(decompressed_path_1.exists());
+
+  // Moving on to the second file removes the decompressed first file.
+  EXPECT_TRUE(compression_reader->has_next());
+  EXPECT_FALSE(decompressed_path_1.exists());
+  EXPECT_TRUE(decompressed_path_2.exists());
+  EXPECT_TRUE(compressed_path_1.exists());
+
+  compression_reader->reset();
+  EXPECT_FALSE(decompressed_path_2.exists());
+  EXPECT_TRUE(compressed_path_2.exists());
+}
+
+TEST_F(SequentialCompressionReaderTest, files_without_filtered_topics_are_not_decompressed_ahead)
+{
+  std::vector<rcpputils::fs::path> compressed_paths;
+  rosbag2_storage::BagMetadata metadata;
+  for (const auto & file_topic : {"topic", "topic", "other", "topic"}) {
+    compressed_paths.push_back(
+      rcpputils::fs::path(temporary_dir_path_) /
+      ("storage" + std::to_string(compressed_paths.size()) + ".zstd"));
+    std::ofstream{compressed_paths.back().string()} << "compressed";
+    metadata.relative_file_paths.push_back(compressed_paths.back().string());
+    rosbag2_storage::FileInformation file;
+    file.path = compressed_paths.back().string();
+    file.topics = {file_topic};
+    metadata.files.push_back(file);
+  }
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 10});
+  metadata.topics_with_message_count.push_back(
+    {{"other", "test_msgs/BasicTypes", storage_serialization_format_, ""}, 10});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::FILE);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  auto decompressor = std::make_unique<NiceMock<MockDecompressor>>();
+  ON_CALL(*decompressor, decompress_uri(_)).WillByDefault(
+    Invoke(
+      [](const std::string & uri) {
+        const auto decompressed_uri =
+        rcpputils::fs::remove_extension(rcpputils::fs::path{uri}).string();
+        std::ofstream{decompressed_uri} << "decompressed";
+        return decompressed_uri;
+      }));
+  // Reading the second file decompresses the fourth one ahead, skipping the third one.
+  EXPECT_CALL(*decompressor, decompress_uri(compressed_paths[0].string())).Times(1);
+  EXPECT_CALL(*decompressor, decompress_uri(compressed_paths[1].string())).Times(1);
+  EXPECT_CALL(*decompressor, decompress_uri(compressed_paths[2].string())).Times(0);
+  EXPECT_CALL(*decompressor, decompress_uri(compressed_paths[3].string())).Times(1);
+
+  auto compression_factory = std::make_unique<StrictMock<MockCompressionFactory>>();
+  ON_CALL(*compression_factory, create_decompressor(_))
+  .WillByDefault(Return(ByMove(std::move(decompressor))));
+  EXPECT_CALL(*compression_factory, create_decompressor(_)).Times(1);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(2);
+  EXPECT_CALL(*storage_, has_next())
+  .WillOnce(Return(false))
+  .WillRepeatedly(Return(true));
+
+  auto compression_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::move(compression_factory),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+
+  compression_reader->open(
+    rosbag2_cpp::StorageOptions(), {"", storage_serialization_format_});
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic"};
+  compression_reader->set_filter(storage_filter);
+
+  EXPECT_TRUE(compression_reader->has_next());
+  EXPECT_THAT(
+    compression_reader->get_current_file(),
+    Eq(rcpputils::fs::remove_extension(compressed_paths[1]).string()));
+  compression_reader->reset();
+}
+
+TEST_F(SequentialCompressionReaderTest, messages_of_uncompressed_topics_are_not_decompressed)
+{
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"/path/to/storage"};
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 1});
+  metadata.topics_with_message_count.push_back(
+    {{"image", "sensor_msgs/msg/CompressedImage", storage_serialization_format_, ""},
+      1, 0, 0, 0, 0, rosbag2_compression::kUncompressedTopicFormat});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::MESSAGE);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  auto image_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  image_message->topic_name = "image";
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_with_type_.name;
+  EXPECT_CALL(*storage_, read_next()).WillOnce(Return(image_message)).WillOnce(Return(message));
+
+  auto decompressor = std::make_unique<NiceMock<MockDecompressor>>();
+  EXPECT_CALL(*decompressor, decompress_serialized_bag_message(message.get())).Times(1);
+  auto compression_factory = std::make_unique<StrictMock<MockCompressionFactory>>();
+  EXPECT_CALL(*compression_factory, create_decompressor("zstd"))
+  .WillOnce(Return(ByMove(std::move(decompressor))));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(1);
+
+  auto sequential_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::move(compression_factory),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(sequential_reader));
+  reader_->open(rosbag2_cpp::StorageOptions(), {"", storage_serialization_format_});
+
+  EXPECT_THAT(reader_->read_next(), Eq(image_message));
+  EXPECT_THAT(reader_->read_next(), Eq(message));
+}
+
+TEST_F(SequentialCompressionReaderTest, messages_written_uncompressed_are_not_decompressed)
+{
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"/path/to/storage"};
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 2});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::MESSAGE);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  // The writer skips compressing topics which barely compressed when they were sampled.
+  const std::string data = "barely compressible";
+  auto uncompressed_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  uncompressed_message->topic_name = topic_with_type_.name;
+  uncompressed_message->serialized_data =
+    rosbag2_storage::make_serialized_message(data.data(), data.size());
+  auto compressed_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  compressed_message->topic_name = topic_with_type_.name;
+  compressed_message->serialized_data =
+    rosbag2_storage::make_serialized_message(data.data(), data.size());
+  rosbag2_compression::ZstdCompressor{}.compress_serialized_bag_message(compressed_message.get());
+  EXPECT_CALL(*storage_, read_next())
+  .WillOnce(Return(uncompressed_message)).WillOnce(Return(compressed_message));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(1);
+
+  auto sequential_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(sequential_reader));
+  reader_->open(rosbag2_cpp::StorageOptions(), {"", storage_serialization_format_});
+
+  for (int i = 0; i < 2; ++i) {
+    const auto message = reader_->read_next();
+    ASSERT_THAT(message->serialized_data->buffer_length, Eq(data.size()));
+    EXPECT_THAT(
+      std::string(
+        reinterpret_cast<const char *>(message->serialized_data->buffer),
+        message->serialized_data->buffer_length),
+      Eq(data));
+  }
+}
+
+TEST_F(SequentialCompressionReaderTest, batches_are_decompressed_in_parallel_in_order)
+{
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"/path/to/storage"};
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 7});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::MESSAGE);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  std::vector<std::string> contents;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> storage_messages;
+  rosbag2_compression::ZstdCompressor compressor;
+  for (int i = 0; i < 7; ++i) {
+    contents.push_back(std::string(100 + i, static_cast<char>('a' + i)));
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_with_type_.name;
+    message->serialized_data =
+      rosbag2_storage::make_serialized_message(contents.back().data(), contents.back().size());
+    compressor.compress_serialized_bag_message(message.get());
+    storage_messages.push_back(message);
+  }
+  size_t read_count = 0;
+  ON_CALL(*storage_, has_next()).WillByDefault(
+    Invoke([&]() {return read_count < storage_messages.size();}));
+  ON_CALL(*storage_, read_next()).WillByDefault(
+    Invoke([&]() {return storage_messages[read_count++];}));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(1);
+
+  auto sequential_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(sequential_reader));
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.decompression_threads = 2;
+  reader_->open(storage_options, {"", storage_serialization_format_});
+
+  const auto messages = reader_->read_next_batch(0, 0);
+  ASSERT_THAT(messages, SizeIs(contents.size()));
+  for (size_t i = 0; i < contents.size(); ++i) {
+    EXPECT_THAT(
+      std::string(
+        reinterpret_cast<const char *>(messages[i]->serialized_data->buffer),
+        messages[i]->serialized_data->buffer_length),
+      Eq(contents[i]));
+  }
+}
+
+TEST_F(SequentialCompressionReaderTest, encrypted_messages_are_decrypted_with_the_key_of_the_bag)
+{
+  const auto key_file = temporary_dir_path_ + "/master.key";
+  std::ofstream{key_file} << std::string(64, 'a');
+  const auto master_key = rosbag2_compression::read_encryption_key_file(key_file);
+  const auto key = rosbag2_compression::generate_encryption_key();
+
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"/path/to/storage"};
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 1});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::MESSAGE);
+  metadata.encryption_format = "aes_gcm";
+  metadata.encryption_key_id = rosbag2_compression::get_encryption_key_id(master_key);
+  metadata.encrypted_key = rosbag2_compression::encrypt_key(key, master_key);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  const std::string data = "secret data";
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_with_type_.name;
+  message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  rosbag2_compression::ZstdCompressor{}.compress_serialized_bag_message(message.get());
+  rosbag2_compression::AesGcmEncryptor{key}.encrypt_serialized_bag_message(message.get());
+  EXPECT_CALL(*storage_, read_next()).WillOnce(Return(message));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(1);
+
+  auto sequential_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(sequential_reader));
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.encryption_key_file = key_file;
+  reader_->open(storage_options, {"", storage_serialization_format_});
+
+  const auto read_message = reader_->read_next();
+  EXPECT_THAT(
+    std::string(
+      reinterpret_cast<const char *>(read_message->serialized_data->buffer),
+      read_message->serialized_data->buffer_length),
+    Eq(data));
+}
+
+TEST_F(SequentialCompressionReaderTest, open_throws_without_the_key_of_an_encrypted_bag)
+{
+  const auto key_file = temporary_dir_path_ + "/other.key";
+  std::ofstream{key_file} << std::string(64, 'b');
+  const auto master_key = rosbag2_compression::generate_encryption_key();
+
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"/path/to/storage"};
+  metadata.topics_with_message_count.push_back({{topic_with_type_}, 1});
+  metadata.compression_format = "zstd";
+  metadata.compression_mode =
+    rosbag2_compression::compression_mode_to_string(rosbag2_compression::CompressionMode::CHUNK);
+  metadata.encryption_format = "aes_gcm";
+  metadata.encryption_key_id = rosbag2_compression::get_encryption_key_id(master_key);
+  metadata.encrypted_key = rosbag2_compression::encrypt_key(
+    rosbag2_compression::generate_encryption_key(), master_key);
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  auto sequential_reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>(
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(sequential_reader));
+  rosbag2_cpp::StorageOptions storage_options;
+  EXPECT_THROW(
+    reader_->open(storage_options, {"", storage_serialization_format_}), std::runtime_error);
+  storage_options.encryption_key_file = key_file;
+  EXPECT_THROW(
+    reader_->open(storage_options, {"", storage_serialization_format_}), std::runtime_error);
+}
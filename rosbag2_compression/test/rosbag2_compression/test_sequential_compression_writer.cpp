@@ -14,26 +14,73 @@
 
 #include <gmock/gmock.h>
 
+#include <fstream>
+#include <future>
+#include <map>
 #include <memory>
+#include <random>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "rosbag2_compression/aes_gcm_decryptor.hpp"
 #include "rosbag2_compression/compression_options.hpp"
+#include "rosbag2_compression/encryption_keys.hpp"
+#include "rosbag2_compression/lz4_decompressor.hpp"
+#include "rosbag2_compression/message_chunk.hpp"
 #include "rosbag2_compression/sequential_compression_writer.hpp"
+#include "rosbag2_compression/zstd_compressor.hpp"
+#include "rosbag2_compression/zstd_decompressor.hpp"
 
 #include "rosbag2_cpp/writer.hpp"
 
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "rcpputils/filesystem_helper.hpp"
+
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_converter_factory.hpp"
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_metadata_io.hpp"
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_storage.hpp"
 #include "../../rosbag2_cpp/test/rosbag2_cpp/mock_storage_factory.hpp"
 
+#include "mock_compression.hpp"
 #include "mock_compression_factory.hpp"
 
 using namespace testing;  // NOLINT
 
-class SequentialCompressionWriterTest : public Test
+namespace
+{
+// Compresses batches of messages on a thread of its own, like a compressor offloading the
+// compression to an accelerator.
+class AsynchronousZstdCompressor : public rosbag2_compression::ZstdCompressor
+{
+public:
+  bool is_asynchronous() const override
+  {
+    return true;
+  }
+
+  std::future<void> compress_serialized_bag_messages_async(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> bag_messages) override
+  {
+    ++submitted_batches;
+    return std::async(
+      std::launch::async, [this, bag_messages]() {
+        for (const auto & bag_message : bag_messages) {
+          compress_serialized_bag_message(bag_message.get());
+        }
+      });
+  }
+
+  static size_t submitted_batches;
+};
+
+size_t AsynchronousZstdCompressor::submitted_batches = 0;
+}  // namespace
+
+class SequentialCompressionWriterTest : public rosbag2_test_common::TemporaryDirectoryFixture
 {
 public:
   SequentialCompressionWriterTest()
@@ -111,3 +158,652 @@ TEST_F(SequentialCompressionWriterTest, writer_calls_create_compressor)
   writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
   writer_->open(rosbag2_cpp::StorageOptions(), {serialization_format_, serialization_format_});
 }
+
+TEST_F(SequentialCompressionWriterTest, closed_files_are_compressed_on_compression_threads)
+{
+  // Every storage is backed by a file, so it can be compressed.
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    Invoke(
+      [](const std::string & uri, const std::string &) {
+        std::ofstream{uri} << "data";
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+        return storage;
+      }));
+
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE, 2, 1};
+  auto compression_factory = std::make_unique<StrictMock<MockCompressionFactory>>();
+  EXPECT_CALL(*compression_factory, create_compressor(_)).Times(2).WillRepeatedly(
+    Invoke(
+      [](const std::string &) {
+        auto compressor = std::make_unique<NiceMock<MockCompressor>>();
+        ON_CALL(*compressor, compress_uri(_)).WillByDefault(
+          Invoke([](const std::string & uri) {return uri + ".fake_comp";}));
+        return compressor;
+      }));
+
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(_, _)).WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::move(compression_factory),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  storage_options_.max_bagfile_messages = 1;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"topic", "type", serialization_format_, ""});
+  for (int i = 0; i < 4; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->time_stamp = i;
+    writer_->write(message);
+  }
+  // Waits for the compression threads before writing the metadata.
+  writer_.reset();
+
+  ASSERT_THAT(metadata.relative_file_paths, SizeIs(4));
+  for (const auto & path : metadata.relative_file_paths) {
+    EXPECT_THAT(path, EndsWith(".fake_comp"));
+    // The uncompressed files are removed once they are compressed.
+    EXPECT_FALSE(rcpputils::fs::exists(rcpputils::fs::remove_extension(rcpputils::fs::path{path})));
+  }
+}
+
+TEST_F(SequentialCompressionWriterTest, files_compressed_as_a_whole_have_summaries_next_to_them)
+{
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    Invoke(
+      [](const std::string & uri, const std::string &) {
+        std::ofstream{uri} << "data";
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+        return storage;
+      }));
+
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE};
+  auto compression_factory = std::make_unique<StrictMock<MockCompressionFactory>>();
+  EXPECT_CALL(*compression_factory, create_compressor(_)).WillOnce(
+    Invoke(
+      [](const std::string &) {
+        auto compressor = std::make_unique<NiceMock<MockCompressor>>();
+        ON_CALL(*compressor, compress_uri(_)).WillByDefault(
+          Invoke([](const std::string & uri) {return uri + ".fake_comp";}));
+        return compressor;
+      }));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::move(compression_factory),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  storage_options_.max_bagfile_messages = 2;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"topic1", "type1", serialization_format_, ""});
+  writer_->create_topic({"topic2", "type2", serialization_format_, ""});
+  for (const auto & topic_name : {"topic1", "topic1", "topic1", "topic2"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_name;
+    message->time_stamp = 10;
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  // The metadata file is written by the mock, so the bag is queried by its summaries alone.
+  rosbag2_storage::MetadataIo metadata_io;
+  ASSERT_TRUE(metadata_io.file_summaries_exist(temporary_dir_path_));
+  const auto metadata = metadata_io.read_file_summaries(temporary_dir_path_);
+  EXPECT_THAT(metadata.compression_mode, Eq("FILE"));
+  ASSERT_THAT(metadata.relative_file_paths, SizeIs(2));
+  EXPECT_THAT(metadata.relative_file_paths[0], EndsWith("_0.fake_comp"));
+  EXPECT_THAT(metadata.message_count, Eq(4u));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(2));
+  for (const auto & topic : metadata.topics_with_message_count) {
+    EXPECT_THAT(topic.message_count, Eq(topic.topic_metadata.name == "topic1" ? 3u : 1u));
+  }
+}
+
+TEST_F(SequentialCompressionWriterTest, adaptive_level_is_lowered_while_files_wait_for_compression)
+{
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    Invoke(
+      [](const std::string & uri, const std::string &) {
+        std::ofstream{uri} << "data";
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+        return storage;
+      }));
+
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE, 1, 0};
+  compression_options.compression_level = 5;
+  compression_options.adaptive_compression_level = true;
+  compression_options.compression_level_min = 3;
+  compression_options.compression_level_max = 7;
+  // The compression thread is held up until all messages are written, so closed files queue up.
+  std::promise<void> release_compression;
+  auto compression_released = release_compression.get_future().share();
+  auto compression_factory = std::make_unique<StrictMock<MockCompressionFactory>>();
+  EXPECT_CALL(*compression_factory, create_compressor(_)).WillOnce(
+    Invoke(
+      [compression_released](const std::string &) {
+        auto compressor = std::make_unique<NiceMock<MockCompressor>>();
+        ON_CALL(*compressor, compress_uri(_)).WillByDefault(
+          Invoke(
+            [compression_released](const std::string & uri) {
+              compression_released.wait();
+              return uri + ".fake_comp";
+            }));
+        return compressor;
+      }));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::move(compression_factory),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  const auto compression_writer = sequential_writer.get();
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  storage_options_.max_bagfile_messages = 1;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"topic", "type", serialization_format_, ""});
+  for (int i = 0; i < 6; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->time_stamp = i;
+    writer_->write(message);
+  }
+
+  // The first one or two closed files raise the level, the files queued behind them lower it.
+  const auto level = compression_writer->get_compression_statistics().current_compression_level;
+  EXPECT_THAT(level, AllOf(Ge(3), Le(4)));
+
+  release_compression.set_value();
+  writer_.reset();
+}
+
+TEST_F(SequentialCompressionWriterTest, open_throws_on_inverted_adaptive_level_bounds)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+  compression_options.adaptive_compression_level = true;
+  compression_options.compression_level_min = 5;
+  compression_options.compression_level_max = 3;
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {serialization_format_, serialization_format_}),
+    std::invalid_argument);
+}
+
+TEST_F(SequentialCompressionWriterTest, chunk_mode_writes_compressed_chunks_of_messages)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::CHUNK};
+  compression_options.chunk_max_bytes = 0;
+  compression_options.chunk_max_duration_ms = 1;
+
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> chunk_messages;
+  EXPECT_CALL(
+    *storage_, write(Matcher<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>(_)))
+  .WillRepeatedly(
+    Invoke(
+      [&chunk_messages](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+        chunk_messages.push_back(message);
+      }));
+  EXPECT_CALL(
+    *storage_, create_topic(Field(&rosbag2_storage::TopicMetadata::name, Eq("topic"))));
+  EXPECT_CALL(
+    *storage_, create_topic(
+      Field(&rosbag2_storage::TopicMetadata::name, Eq(rosbag2_compression::kChunkTopicName))));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"topic", "type", serialization_format_, ""});
+  // A chunk is full once it spans 1 ms, so the messages are written in chunks of 3 and 2.
+  const std::string data{"data"};
+  for (int i = 0; i < 5; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->time_stamp = i * 500000;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(chunk_messages, SizeIs(2u));
+  EXPECT_THAT(chunk_messages[0]->topic_name, Eq(rosbag2_compression::kChunkTopicName));
+  EXPECT_THAT(chunk_messages[0]->publish_time_stamp, Eq(0));
+  EXPECT_THAT(chunk_messages[0]->time_stamp, Eq(1000000));
+
+  auto decompressor = rosbag2_compression::ZstdDecompressor{};
+  std::vector<size_t> chunk_sizes;
+  for (const auto & chunk_message : chunk_messages) {
+    rosbag2_storage::SerializedBagMessage chunk{*chunk_message};
+    chunk.serialized_data = rosbag2_storage::make_serialized_message(
+      chunk_message->serialized_data->buffer, chunk_message->serialized_data->buffer_length);
+    decompressor.decompress_serialized_bag_message(&chunk);
+    const auto messages = rosbag2_compression::MessageChunk::parse(*chunk.serialized_data);
+    chunk_sizes.push_back(messages.size());
+    for (const auto & message : messages) {
+      EXPECT_THAT(message->topic_name, Eq("topic"));
+      EXPECT_THAT(
+        std::string(
+          reinterpret_cast<const char *>(message->serialized_data->buffer),
+          message->serialized_data->buffer_length),
+        Eq(data));
+    }
+  }
+  EXPECT_THAT(chunk_sizes, ElementsAre(3u, 2u));
+}
+
+TEST_F(SequentialCompressionWriterTest, chunks_are_compressed_asynchronously_and_written_in_order)
+{
+  rosbag2_compression::CompressionFactory::register_compression_format(
+    "async_zstd",
+    [] {return std::make_unique<AsynchronousZstdCompressor>();},
+    [] {return std::make_unique<rosbag2_compression::ZstdDecompressor>();});
+  rosbag2_compression::CompressionOptions compression_options{
+    "async_zstd", rosbag2_compression::CompressionMode::CHUNK};
+  compression_options.chunk_max_bytes = 0;
+  compression_options.chunk_max_duration_ms = 1;
+
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> chunk_messages;
+  EXPECT_CALL(
+    *storage_, write(Matcher<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>(_)))
+  .WillRepeatedly(
+    Invoke(
+      [&chunk_messages](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+        chunk_messages.push_back(message);
+      }));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"topic", "type", serialization_format_, ""});
+  // Every third message fills a chunk, so more chunks are pending than are compressed at once.
+  AsynchronousZstdCompressor::submitted_batches = 0;
+  for (int i = 0; i < 20; ++i) {
+    const auto data = std::to_string(i);
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->time_stamp = i * 500000;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_THAT(AsynchronousZstdCompressor::submitted_batches, Eq(chunk_messages.size()));
+  auto decompressor = rosbag2_compression::ZstdDecompressor{};
+  std::vector<std::string> data;
+  for (const auto & chunk_message : chunk_messages) {
+    rosbag2_storage::SerializedBagMessage chunk{*chunk_message};
+    chunk.serialized_data = rosbag2_storage::make_serialized_message(
+      chunk_message->serialized_data->buffer, chunk_message->serialized_data->buffer_length);
+    decompressor.decompress_serialized_bag_message(&chunk);
+    for (const auto & message : rosbag2_compression::MessageChunk::parse(*chunk.serialized_data)) {
+      data.emplace_back(
+        reinterpret_cast<const char *>(message->serialized_data->buffer),
+        message->serialized_data->buffer_length);
+    }
+  }
+  ASSERT_THAT(data, SizeIs(20u));
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_THAT(data[i], Eq(std::to_string(i)));
+  }
+}
+
+TEST_F(SequentialCompressionWriterTest, metadata_lists_topics_of_every_file)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::CHUNK};
+  rosbag2_storage::BagMetadata metadata{};
+  ON_CALL(*metadata_io_, write_metadata(_, _)).WillByDefault(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  storage_options_.max_bagfile_messages = 3;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"/a", "type", serialization_format_, ""});
+  writer_->create_topic({"/b", "type", serialization_format_, ""});
+  const std::string data{"data"};
+  for (const auto & topic : {"/a", "/b", "/a", "/a"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  // The topics of the messages in the chunks, not the topic of the chunks.
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_THAT(metadata.files[0].topics, ElementsAre("/a", "/b"));
+  EXPECT_THAT(metadata.files[0].topic_message_counts, ElementsAre(2u, 1u));
+  EXPECT_THAT(metadata.files[0].message_count, Eq(3u));
+  EXPECT_THAT(metadata.files[1].topics, ElementsAre("/a"));
+  EXPECT_THAT(metadata.files[1].topic_message_counts, ElementsAre(1u));
+  EXPECT_THAT(metadata.files[1].message_count, Eq(1u));
+}
+
+TEST_F(SequentialCompressionWriterTest, topics_are_compressed_with_their_own_compression_options)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+  compression_options.topic_compression["sensor_msgs/msg/CompressedImage"].compression_format =
+    rosbag2_compression::kUncompressedTopicFormat;
+  compression_options.topic_compression["/points"].compression_format = "lz4";
+
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> written_messages;
+  EXPECT_CALL(
+    *storage_, write(Matcher<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>(_)))
+  .WillRepeatedly(
+    Invoke(
+      [&written_messages](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+        written_messages.push_back(message);
+      }));
+  rosbag2_storage::BagMetadata metadata{};
+  ON_CALL(*metadata_io_, write_metadata(_, _)).WillByDefault(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"/image", "sensor_msgs/msg/CompressedImage", serialization_format_, ""});
+  writer_->create_topic({"/points", "sensor_msgs/msg/PointCloud2", serialization_format_, ""});
+  writer_->create_topic({"/tf", "tf2_msgs/msg/TFMessage", serialization_format_, ""});
+  const std::string data(1024, 'd');
+  for (const auto & topic : {"/image", "/points", "/tf"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(written_messages, SizeIs(3u));
+  EXPECT_THAT(written_messages[0]->serialized_data->buffer_length, Eq(data.size()));
+  rosbag2_storage::SerializedBagMessage points{*written_messages[1]};
+  rosbag2_compression::Lz4Decompressor{}.decompress_serialized_bag_message(&points);
+  EXPECT_THAT(points.serialized_data->buffer_length, Eq(data.size()));
+  rosbag2_storage::SerializedBagMessage tf{*written_messages[2]};
+  rosbag2_compression::ZstdDecompressor{}.decompress_serialized_bag_message(&tf);
+  EXPECT_THAT(tf.serialized_data->buffer_length, Eq(data.size()));
+
+  std::map<std::string, std::string> topic_formats;
+  for (const auto & topic : metadata.topics_with_message_count) {
+    topic_formats[topic.topic_metadata.name] = topic.compression_format;
+  }
+  EXPECT_THAT(
+    topic_formats, ElementsAre(
+      Pair("/image", rosbag2_compression::kUncompressedTopicFormat), Pair("/points", "lz4"),
+      Pair("/tf", "")));
+}
+
+TEST_F(SequentialCompressionWriterTest, topics_compressed_as_video_are_delta_encoded)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+  compression_options.topic_compression["sensor_msgs/msg/Image"].compression_format = "video";
+  rosbag2_storage::BagMetadata metadata{};
+  ON_CALL(*metadata_io_, write_metadata(_, _)).WillByDefault(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"/image", "sensor_msgs/msg/Image", serialization_format_, ""});
+  writer_->create_topic({"/tf", "tf2_msgs/msg/TFMessage", serialization_format_, ""});
+  writer_.reset();
+
+  std::map<std::string, bool> topics_delta_encoded;
+  for (const auto & topic : metadata.topics_with_message_count) {
+    topics_delta_encoded[topic.topic_metadata.name] = topic.delta_encoded;
+  }
+  EXPECT_THAT(topics_delta_encoded, ElementsAre(Pair("/image", true), Pair("/tf", false)));
+}
+
+TEST_F(SequentialCompressionWriterTest, create_topic_throws_on_delta_encoding_video_topics)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+  compression_options.topic_compression["/image"].compression_format = "video";
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  storage_options_.delta_encode_topics = {"/image"};
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  EXPECT_THROW(
+    writer_->create_topic({"/image", "sensor_msgs/msg/Image", serialization_format_, ""}),
+    std::invalid_argument);
+}
+
+TEST_F(SequentialCompressionWriterTest, topics_which_barely_compress_are_written_uncompressed)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+  compression_options.compression_sample_messages = 2;
+  compression_options.compression_resample_interval = 4;
+
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> written_messages;
+  EXPECT_CALL(
+    *storage_, write(Matcher<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>(_)))
+  .WillRepeatedly(
+    Invoke(
+      [&written_messages](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+        written_messages.push_back(message);
+      }));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  const auto compression_writer = sequential_writer.get();
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"/noise", "std_msgs/msg/ByteMultiArray", serialization_format_, ""});
+  writer_->create_topic({"/tf", "tf2_msgs/msg/TFMessage", serialization_format_, ""});
+  std::mt19937 random_engine{42};
+  std::uniform_int_distribution<int> random_byte{0, 255};
+  std::string noise(1024, '\0');
+  for (auto & byte : noise) {
+    byte = static_cast<char>(random_byte(random_engine));
+  }
+  const std::map<std::string, std::string> topic_data{
+    {"/noise", noise}, {"/tf", std::string(1024, 't')}};
+  for (int i = 0; i < 8; ++i) {
+    for (const auto & data : topic_data) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->topic_name = data.first;
+      message->serialized_data =
+        rosbag2_storage::make_serialized_message(data.second.data(), data.second.size());
+      writer_->write(message);
+    }
+  }
+  const auto statistics = compression_writer->get_compression_statistics();
+  writer_.reset();
+
+  // The first two messages of each topic are sampled, and the noise is sampled again after four
+  // uncompressed messages.
+  rosbag2_compression::ZstdDecompressor decompressor;
+  std::vector<bool> noise_compressed;
+  for (const auto & message : written_messages) {
+    if (message->topic_name == "/noise") {
+      noise_compressed.push_back(decompressor.is_compressed_message(*message));
+    } else {
+      EXPECT_TRUE(decompressor.is_compressed_message(*message));
+    }
+  }
+  EXPECT_THAT(noise_compressed, ElementsAre(true, true, false, false, false, false, true, true));
+
+  ASSERT_THAT(statistics.topic_samples, SizeIs(2u));
+  const auto & noise_sample = statistics.topic_samples.at("/noise");
+  EXPECT_FALSE(noise_sample.compressed);
+  EXPECT_THAT(noise_sample.compression_ratio, Ge(compression_options.incompressible_ratio));
+  EXPECT_THAT(noise_sample.uncompressed_message_count, Eq(4u));
+  const auto & tf_sample = statistics.topic_samples.at("/tf");
+  EXPECT_TRUE(tf_sample.compressed);
+  EXPECT_THAT(tf_sample.compression_ratio, Lt(0.5));
+  EXPECT_THAT(tf_sample.uncompressed_message_count, Eq(0u));
+}
+
+TEST_F(SequentialCompressionWriterTest, open_throws_on_topic_compression_in_file_mode)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE};
+  compression_options.topic_compression["/points"].compression_format = "lz4";
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {serialization_format_, serialization_format_}),
+    std::invalid_argument);
+}
+
+
+TEST_F(SequentialCompressionWriterTest, chunks_are_encrypted_with_a_key_of_the_bag)
+{
+  const auto key_file = temporary_dir_path_ + "/master.key";
+  std::ofstream{key_file} << std::string(64, 'a');
+  const auto master_key = rosbag2_compression::read_encryption_key_file(key_file);
+
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::CHUNK};
+  compression_options.encryption_format = "aes_gcm";
+  compression_options.encryption_key_file = key_file;
+
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> chunk_messages;
+  EXPECT_CALL(
+    *storage_, write(Matcher<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>(_)))
+  .WillRepeatedly(
+    Invoke(
+      [&chunk_messages](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+        chunk_messages.push_back(message);
+      }));
+  rosbag2_storage::BagMetadata metadata{};
+  ON_CALL(*metadata_io_, write_metadata(_, _)).WillByDefault(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  writer_->open(storage_options_, {serialization_format_, serialization_format_});
+  writer_->create_topic({"topic", "type", serialization_format_, ""});
+  const std::string data(1024, 'd');
+  for (int i = 0; i < 3; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  // Only the key of the bag encrypted with the master key is stored.
+  EXPECT_THAT(metadata.encryption_format, Eq("aes_gcm"));
+  EXPECT_THAT(
+    metadata.encryption_key_id, Eq(rosbag2_compression::get_encryption_key_id(master_key)));
+  const auto key = rosbag2_compression::decrypt_key(metadata.encrypted_key, master_key);
+
+  ASSERT_THAT(chunk_messages, SizeIs(1u));
+  rosbag2_storage::SerializedBagMessage chunk{*chunk_messages[0]};
+  chunk.serialized_data = rosbag2_storage::make_serialized_message(
+    chunk_messages[0]->serialized_data->buffer, chunk_messages[0]->serialized_data->buffer_length);
+  rosbag2_compression::AesGcmDecryptor{key}.decrypt_serialized_bag_message(&chunk);
+  rosbag2_compression::ZstdDecompressor{}.decompress_serialized_bag_message(&chunk);
+  EXPECT_THAT(rosbag2_compression::MessageChunk::parse(*chunk.serialized_data), SizeIs(3u));
+}
+
+TEST_F(SequentialCompressionWriterTest, open_throws_on_encryption_in_file_mode)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE};
+  compression_options.encryption_format = "aes_gcm";
+  compression_options.encryption_key_file = temporary_dir_path_ + "/master.key";
+  auto sequential_writer = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+    compression_options,
+    std::make_unique<rosbag2_compression::CompressionFactory>(),
+    std::move(storage_factory_),
+    converter_factory_,
+    std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = temporary_dir_path_;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {serialization_format_, serialization_format_}),
+    std::invalid_argument);
+}
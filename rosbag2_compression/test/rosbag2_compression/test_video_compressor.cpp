@@ -0,0 +1,265 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/compression_options.hpp"
+#include "rosbag2_compression/video_compressor.hpp"
+#include "rosbag2_compression/video_decompressor.hpp"
+
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "gmock/gmock.h"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+constexpr const char kImageTopic[] = "/camera/image_raw";
+constexpr const char kImageTopicType[] = "sensor_msgs/msg/Image";
+constexpr const uint32_t kHeight = 48;
+constexpr const uint32_t kWidth = 64;
+
+// Serializes a little endian sensor_msgs/msg/Image of rgb8 pixels given by their row and column.
+template<typename Pixel>
+std::string make_image_cdr(Pixel pixel)
+{
+  std::string cdr{'\0', '\1', '\0', '\0'};
+  const auto add_uint32 = [&cdr](uint32_t value) {
+      while ((cdr.size() - 4) % 4 != 0) {
+        cdr.push_back('\0');
+      }
+      for (int byte = 0; byte < 4; ++byte) {
+        cdr.push_back(static_cast<char>(value >> (8 * byte)));
+      }
+    };
+  const auto add_string = [&cdr, &add_uint32](const std::string & value) {
+      add_uint32(static_cast<uint32_t>(value.size() + 1));
+      cdr += value;
+      cdr.push_back('\0');
+    };
+
+  add_uint32(1234);
+  add_uint32(5678);
+  add_string("camera_frame");
+  add_uint32(kHeight);
+  add_uint32(kWidth);
+  add_string("rgb8");
+  cdr.push_back('\0');
+  add_uint32(kWidth * 3);
+  add_uint32(kHeight * kWidth * 3);
+  for (uint32_t row = 0; row < kHeight; ++row) {
+    for (uint32_t column = 0; column < kWidth; ++column) {
+      for (uint32_t channel = 0; channel < 3; ++channel) {
+        cdr.push_back(static_cast<char>(pixel(row, column, channel)));
+      }
+    }
+  }
+  return cdr;
+}
+
+// A gradient moving by a column per frame, with noise of at most one.
+std::string make_frame(uint32_t frame)
+{
+  return make_image_cdr(
+    [frame](uint32_t row, uint32_t column, uint32_t channel) {
+      return (row * 3 + (column + frame) * 2 + channel * 40 + (row * column + frame) % 2) % 256;
+    });
+}
+
+rosbag2_storage::SerializedBagMessage make_message(
+  const std::string & data, rcutils_time_point_value_t time_stamp,
+  const std::string & topic_name = kImageTopic)
+{
+  rosbag2_storage::SerializedBagMessage message;
+  message.topic_name = topic_name;
+  message.time_stamp = time_stamp;
+  message.serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+
+// The largest difference of a byte of two strings of the same size.
+int get_largest_difference(const std::string & data, const std::string & other_data)
+{
+  int largest_difference = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    largest_difference = std::max(
+      largest_difference,
+      std::abs(static_cast<uint8_t>(data[i]) - static_cast<uint8_t>(other_data[i])));
+  }
+  return largest_difference;
+}
+
+// Metadata of a bag whose image topic is delta encoded, as written with VideoCompressor.
+rosbag2_storage::BagMetadata make_metadata()
+{
+  rosbag2_storage::TopicInformation image_topic{};
+  image_topic.topic_metadata = {kImageTopic, kImageTopicType, "cdr", ""};
+  image_topic.delta_encoded = true;
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.topics_with_message_count.push_back(image_topic);
+  return metadata;
+}
+}  // namespace
+
+class VideoCompressorTest : public Test
+{
+public:
+  void set_up_compressor(int compression_level, uint64_t keyframe_interval = 100)
+  {
+    rosbag2_compression::CompressionOptions compression_options{
+      "video", rosbag2_compression::CompressionMode::MESSAGE};
+    compression_options.compression_level = compression_level;
+    compression_options.keyframe_interval = keyframe_interval;
+    compressor_.set_compression_options(compression_options);
+    compressor_.register_topic({kImageTopic, kImageTopicType, "cdr", ""});
+    compressor_.register_topic({"/points", "sensor_msgs/msg/PointCloud2", "cdr", ""});
+  }
+
+  // Stores the message and reads it back, returning the size of the data stored.
+  size_t write_and_read(rosbag2_storage::SerializedBagMessage & message)
+  {
+    compressor_.compress_serialized_bag_message(&message);
+    const auto stored_size = message.serialized_data->buffer_length;
+    decompressor_.decompress_serialized_bag_message(&message);
+    decoder_.decode(message);
+    return stored_size;
+  }
+
+  rosbag2_compression::VideoCompressor compressor_{};
+  rosbag2_compression::VideoDecompressor decompressor_{};
+  rosbag2_cpp::readers::DeltaMessageDecoder decoder_{
+    make_metadata(), [](const std::string &, rcutils_time_point_value_t) {
+      return rosbag2_cpp::readers::DeltaMessageDecoder::Messages{};
+    }};
+};
+
+TEST_F(VideoCompressorTest, images_are_restored_within_the_compression_level)
+{
+  set_up_compressor(3, 10);
+  for (uint32_t frame = 0; frame < 25; ++frame) {
+    const auto image = make_frame(frame);
+    auto message = make_message(image, frame + 1);
+    write_and_read(message);
+    const auto read_image = get_data(message);
+    ASSERT_THAT(read_image.size(), Eq(image.size()));
+    EXPECT_THAT(get_largest_difference(read_image, image), Le(3)) << "frame " << frame;
+  }
+}
+
+TEST_F(VideoCompressorTest, images_are_restored_bit_exactly_at_level_zero)
+{
+  set_up_compressor(0, 10);
+  for (uint32_t frame = 0; frame < 15; ++frame) {
+    const auto image = make_frame(frame);
+    auto message = make_message(image, frame + 1);
+    write_and_read(message);
+    EXPECT_THAT(get_data(message), Eq(image)) << "frame " << frame;
+  }
+}
+
+TEST_F(VideoCompressorTest, images_are_quantized_without_changing_the_data_of_the_message)
+{
+  set_up_compressor(3, 10);
+  for (uint32_t frame = 0; frame < 3; ++frame) {
+    const auto image = make_frame(frame);
+    auto message = make_message(image, frame + 1);
+    // Other writers or callbacks may hold the data of the message as well.
+    const auto shared_data = message.serialized_data;
+    compressor_.compress_serialized_bag_message(&message);
+    EXPECT_THAT(
+      std::string(
+        reinterpret_cast<const char *>(shared_data->buffer), shared_data->buffer_length),
+      Eq(image)) << "frame " << frame;
+  }
+}
+
+TEST_F(VideoCompressorTest, images_of_a_static_scene_store_little_beyond_the_first_one)
+{
+  set_up_compressor(2);
+  std::vector<size_t> stored_sizes;
+  for (uint32_t frame = 0; frame < 5; ++frame) {
+    // The noise of at most one is within half the compression level.
+    const auto image = make_image_cdr(
+      [frame](uint32_t row, uint32_t column, uint32_t channel) {
+        return row + column + channel * 40 + (row + column + frame) % 2;
+      });
+    auto message = make_message(image, frame + 1);
+    stored_sizes.push_back(write_and_read(message));
+  }
+  for (size_t frame = 1; frame < stored_sizes.size(); ++frame) {
+    EXPECT_THAT(stored_sizes[frame] * 4, Lt(stored_sizes[0])) << "frame " << frame;
+  }
+}
+
+TEST_F(VideoCompressorTest, only_image_topics_are_delta_encoded)
+{
+  set_up_compressor(1);
+  EXPECT_TRUE(compressor_.is_delta_encoded(kImageTopic));
+  EXPECT_FALSE(compressor_.is_delta_encoded("/points"));
+  EXPECT_FALSE(compressor_.is_delta_encoded("/unregistered"));
+
+  const std::string points(1024, 'p');
+  for (const std::string topic_name : {"/points", "/unregistered"}) {
+    auto message = make_message(points, 1, topic_name);
+    write_and_read(message);
+    EXPECT_THAT(get_data(message), Eq(points));
+  }
+}
+
+TEST_F(VideoCompressorTest, reset_deltas_stores_the_next_image_as_keyframe)
+{
+  set_up_compressor(1);
+  auto first_message = make_message(make_frame(0), 1);
+  const auto keyframe_size = write_and_read(first_message);
+  auto second_message = make_message(make_frame(0), 2);
+  EXPECT_THAT(write_and_read(second_message), Lt(keyframe_size));
+
+  compressor_.reset_deltas();
+  auto third_message = make_message(make_frame(0), 3);
+  compressor_.compress_serialized_bag_message(&third_message);
+  decompressor_.decompress_serialized_bag_message(&third_message);
+  ASSERT_THAT(third_message.serialized_data->buffer_length, Gt(0u));
+  EXPECT_THAT(
+    third_message.serialized_data->buffer[0],
+    Eq(static_cast<uint8_t>(rosbag2_cpp::writers::DeltaFrameType::KEYFRAME)));
+}
+
+TEST_F(VideoCompressorTest, set_compression_options_throws_on_levels_out_of_range)
+{
+  for (const int level : {-1, 256}) {
+    rosbag2_compression::CompressionOptions compression_options{
+      "video", rosbag2_compression::CompressionMode::MESSAGE};
+    compression_options.compression_level = level;
+    EXPECT_THROW(compressor_.set_compression_options(compression_options), std::invalid_argument);
+  }
+}
@@ -13,17 +13,24 @@
 // limitations under the License.
 
 #include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 
 #include "rcpputils/filesystem_helper.hpp"
 
+#include "rosbag2_compression/compression_options.hpp"
 #include "rosbag2_compression/zstd_compressor.hpp"
 #include "rosbag2_compression/zstd_decompressor.hpp"
 
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
 #include "rosbag2_test_common/temporary_directory_fixture.hpp"
 
 #include "gmock/gmock.h"
@@ -51,6 +58,12 @@ void create_garbage_file(const std::string & uri, int size = kDefaultGarbageFile
   }
 }
 
+// Another temporary directory, which is removed when going out of scope.
+class ScratchDirectory : public rosbag2_test_common::TemporaryDirectoryFixture
+{
+  void TestBody() override {}
+};
+
 std::vector<char> read_file(const std::string & uri)
 {
   auto infile = std::ifstream{uri, std::ios_base::binary | std::ios::ate};
@@ -200,6 +213,67 @@ TEST_F(CompressionHelperFixture, zstd_decompress_file_contents)
   EXPECT_EQ(initial_data, decompressed_data);
 }
 
+TEST_F(CompressionHelperFixture, zstd_compress_file_with_level_and_worker_threads)
+{
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "file4.txt").string();
+  create_garbage_file(uri);
+  const auto initial_data = read_file(uri);
+
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE};
+  compression_options.compression_level = 9;
+  compression_options.compression_worker_threads = 2;
+  auto compressor = rosbag2_compression::ZstdCompressor{};
+  // Compression falls back to the calling thread if libzstd lacks multithreading support.
+  compressor.set_compression_options(compression_options);
+  const auto compressed_uri = compressor.compress_uri(uri);
+  ASSERT_EQ(0, std::remove(uri.c_str()));
+
+  auto decompressor = rosbag2_compression::ZstdDecompressor{};
+  const auto decompressed_uri = decompressor.decompress_uri(compressed_uri);
+
+  EXPECT_EQ(uri, decompressed_uri);
+  EXPECT_EQ(initial_data, read_file(decompressed_uri));
+}
+
+TEST_F(CompressionHelperFixture, zstd_decompress_file_to_directory)
+{
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "file5.txt").string();
+  create_garbage_file(uri);
+  const auto initial_data = read_file(uri);
+
+  auto compressor = rosbag2_compression::ZstdCompressor{};
+  const auto compressed_uri = compressor.compress_uri(uri);
+  ASSERT_EQ(0, std::remove(uri.c_str()));
+
+  const ScratchDirectory scratch_directory{};
+  auto decompressor = rosbag2_compression::ZstdDecompressor{};
+  const auto decompressed_uri = decompressor.decompress_uri_to_directory(
+    compressed_uri, scratch_directory.temporary_dir_path_);
+
+  EXPECT_EQ(
+    (rcpputils::fs::path(scratch_directory.temporary_dir_path_) / "file5.txt").string(),
+    decompressed_uri);
+  EXPECT_FALSE(rcpputils::fs::exists(uri));
+  EXPECT_EQ(initial_data, read_file(decompressed_uri));
+
+  EXPECT_THROW(
+    decompressor.decompress_uri_to_directory(
+      compressed_uri, (rcpputils::fs::path(temporary_dir_path_) / "missing").string()),
+    std::runtime_error);
+}
+
+TEST_F(CompressionHelperFixture, zstd_rejects_unsupported_compression_level)
+{
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::FILE};
+  compression_options.compression_level = ZSTD_maxCLevel() + 1;
+
+  auto compressor = rosbag2_compression::ZstdCompressor{};
+  EXPECT_THROW(
+    compressor.set_compression_options(compression_options), std::invalid_argument);
+}
+
 TEST_F(CompressionHelperFixture, zstd_decompress_fails_on_bad_file)
 {
   const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "file3.txt").string();
@@ -218,3 +292,106 @@ TEST_F(CompressionHelperFixture, zstd_decompress_fails_on_bad_uri)
   EXPECT_THROW(decompressor.decompress_uri(bad_uri), std::runtime_error) <<
     "Expected decompress_uri(\"" << bad_uri << "\") to fail!";
 }
+
+TEST_F(CompressionHelperFixture, zstd_compress_and_decompress_serialized_bag_messages)
+{
+  auto zstd_compressor = rosbag2_compression::ZstdCompressor{};
+  auto zstd_decompressor = rosbag2_compression::ZstdDecompressor{};
+
+  // The contexts and buffers are reused for messages of different sizes.
+  for (const size_t message_size : {size_t{1024}, size_t{64}, size_t{0}, size_t{1024 * 1024}}) {
+    std::string data;
+    while (data.size() < message_size) {
+      data += kGarbageStatement;
+    }
+    data.resize(message_size);
+    rosbag2_storage::SerializedBagMessage bag_message;
+    bag_message.serialized_data =
+      rosbag2_storage::make_serialized_message(data.data(), data.size());
+
+    zstd_compressor.compress_serialized_bag_message(&bag_message);
+    if (message_size > 0) {
+      EXPECT_LT(bag_message.serialized_data->buffer_length, message_size);
+    }
+
+    zstd_decompressor.decompress_serialized_bag_message(&bag_message);
+    ASSERT_EQ(bag_message.serialized_data->buffer_length, message_size);
+    EXPECT_EQ(
+      std::string(
+        reinterpret_cast<const char *>(bag_message.serialized_data->buffer),
+        bag_message.serialized_data->buffer_length),
+      data);
+  }
+}
+
+TEST_F(CompressionHelperFixture, zstd_compresses_serialized_bag_messages_with_trained_dictionary)
+{
+  constexpr const size_t kTrainingMessages = 1000;
+  rosbag2_compression::CompressionOptions compression_options{
+    "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+  compression_options.dictionary_training_messages = kTrainingMessages;
+  auto zstd_compressor = rosbag2_compression::ZstdCompressor{};
+  zstd_compressor.set_compression_options(compression_options);
+  zstd_compressor.register_topic({"/diagnostics", "diagnostic_msgs/DiagnosticArray", "cdr", ""});
+
+  // Small messages which are similar, but not equal to each other.
+  auto make_message = [](size_t index) {
+      std::string data = "status: OK, name: sensor_" + std::to_string(index % 17) +
+        ", hardware_id: " + std::to_string(index * 7919) + ", values: [level: " +
+        std::to_string(index % 5) + ", message: " + kGarbageStatement + "]";
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->topic_name = "/diagnostics";
+      bag_message->serialized_data =
+        rosbag2_storage::make_serialized_message(data.data(), data.size());
+      return std::make_pair(data, bag_message);
+    };
+
+  std::vector<std::pair<std::string, std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+  messages;
+  size_t last_untrained_size = 0;
+  size_t first_trained_size = 0;
+  for (size_t i = 0; i <= kTrainingMessages; ++i) {
+    messages.push_back(make_message(i));
+    zstd_compressor.compress_serialized_bag_message(messages.back().second.get());
+    if (i == kTrainingMessages - 1) {
+      last_untrained_size = messages.back().second->serialized_data->buffer_length;
+    } else if (i == kTrainingMessages) {
+      first_trained_size = messages.back().second->serialized_data->buffer_length;
+    }
+  }
+  EXPECT_LT(first_trained_size, last_untrained_size);
+
+  const auto dictionaries = zstd_compressor.write_dictionaries(temporary_dir_path_);
+  ASSERT_EQ(dictionaries.size(), 1u);
+  EXPECT_TRUE(rcpputils::fs::exists(dictionaries[0]));
+
+  auto zstd_decompressor = rosbag2_compression::ZstdDecompressor{};
+  EXPECT_THROW(
+    zstd_decompressor.decompress_serialized_bag_message(messages.back().second.get()),
+    std::runtime_error);
+
+  auto loading_decompressor = rosbag2_compression::ZstdDecompressor{};
+  loading_decompressor.load_dictionaries(dictionaries);
+  // Shared dictionaries are not read from their files again.
+  rcpputils::fs::remove(dictionaries[0]);
+  ASSERT_TRUE(zstd_decompressor.share_dictionaries(loading_decompressor));
+  for (auto & message : messages) {
+    zstd_decompressor.decompress_serialized_bag_message(message.second.get());
+    const auto & serialized_data = *message.second->serialized_data;
+    EXPECT_EQ(
+      std::string(
+        reinterpret_cast<const char *>(serialized_data.buffer), serialized_data.buffer_length),
+      message.first);
+  }
+}
+
+TEST_F(CompressionHelperFixture, zstd_decompress_fails_on_uncompressed_serialized_bag_message)
+{
+  const std::string data{"not compressed"};
+  rosbag2_storage::SerializedBagMessage bag_message;
+  bag_message.serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+
+  auto zstd_decompressor = rosbag2_compression::ZstdDecompressor{};
+  EXPECT_THROW(
+    zstd_decompressor.decompress_serialized_bag_message(&bag_message), std::runtime_error);
+}
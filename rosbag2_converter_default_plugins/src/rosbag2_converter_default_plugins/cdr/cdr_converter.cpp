@@ -15,86 +15,23 @@
 #include "cdr_converter.hpp"
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 
-#include "ament_index_cpp/get_resources.hpp"
-#include "ament_index_cpp/get_package_prefix.hpp"
-
-#include "rcpputils/shared_library.hpp"
-#include "rcutils/strdup.h"
+#include "rcutils/error_handling.h"
 
 #include "rosbag2_cpp/types.hpp"
 
+#include "rosidl_runtime_c/message_type_support_struct.h"
 #include "rosidl_runtime_cpp/message_type_support_decl.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
 
+#include "cdr_serialization.hpp"
 #include "../logging.hpp"
 
 namespace rosbag2_converter_default_plugins
 {
 
-inline
-std::string get_package_library_path(const std::string & package_name)
-{
-  const char * filename_prefix;
-  const char * filename_extension;
-  const char * dynamic_library_folder;
-#ifdef _WIN32
-  filename_prefix = "";
-  filename_extension = ".dll";
-  dynamic_library_folder = "/bin/";
-#elif __APPLE__
-  filename_prefix = "lib";
-  filename_extension = ".dylib";
-  dynamic_library_folder = "/lib/";
-#else
-  filename_prefix = "lib";
-  filename_extension = ".so";
-  dynamic_library_folder = "/lib/";
-#endif
-
-  auto package_prefix = ament_index_cpp::get_package_prefix(package_name);
-  auto library_path = package_prefix + dynamic_library_folder + filename_prefix +
-    package_name + filename_extension;
-
-  return library_path;
-}
-
-CdrConverter::CdrConverter()
-{
-  auto library_path = get_package_library_path("rmw_fastrtps_cpp");
-  try {
-    library = std::make_shared<rcpputils::SharedLibrary>(library_path);
-  } catch (std::runtime_error &) {
-    throw std::runtime_error(
-            std::string("rcpputils exception: library could not be found:") + library_path);
-  }
-
-  std::string serialize_symbol = "rmw_serialize";
-  std::string deserialize_symbol = "rmw_deserialize";
-
-  if (!library->has_symbol(serialize_symbol.c_str())) {
-    throw std::runtime_error{std::string("rcutils exception: symbol not found: ") +
-            serialize_symbol};
-  }
-
-  if (!library->has_symbol(deserialize_symbol.c_str())) {
-    throw std::runtime_error{
-            std::string("rcutils exception: symbol not found: ") + deserialize_symbol};
-  }
-
-  serialize_fcn_ = (decltype(serialize_fcn_))library->get_symbol(serialize_symbol.c_str());
-  if (!serialize_fcn_) {
-    throw std::runtime_error{
-            std::string("rcutils exception: symbol of wrong type: ") + serialize_symbol};
-  }
-
-  deserialize_fcn_ = (decltype(deserialize_fcn_))library->get_symbol(deserialize_symbol.c_str());
-  if (!deserialize_fcn_) {
-    throw std::runtime_error{
-            std::string("rcutils exception: symbol of wrong type: ") + deserialize_symbol};
-  }
-}
-
 void CdrConverter::deserialize(
   const std::shared_ptr<const rosbag2_storage::SerializedBagMessage> serialized_message,
   const rosidl_message_type_support_t * type_support,
@@ -104,10 +41,12 @@ void CdrConverter::deserialize(
     introspection_message.get(), serialized_message->topic_name.c_str());
   introspection_message->time_stamp = serialized_message->time_stamp;
 
-  auto ret = deserialize_fcn_(
-    serialized_message->serialized_data.get(), type_support, introspection_message->message);
-  if (ret != RMW_RET_OK) {
-    ROSBAG2_CONVERTER_DEFAULT_PLUGINS_LOG_ERROR("Failed to deserialize message.");
+  try {
+    deserialize_cdr(
+      *serialized_message->serialized_data, get_message_members(type_support),
+      introspection_message->message);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_CONVERTER_DEFAULT_PLUGINS_LOG_ERROR("Failed to deserialize message: %s", e.what());
   }
 }
 
@@ -119,11 +58,33 @@ void CdrConverter::serialize(
   serialized_message->topic_name = std::string(introspection_message->topic_name);
   serialized_message->time_stamp = introspection_message->time_stamp;
 
-  auto ret = serialize_fcn_(
-    introspection_message->message, type_support, serialized_message->serialized_data.get());
-  if (ret != RMW_RET_OK) {
-    ROSBAG2_CONVERTER_DEFAULT_PLUGINS_LOG_ERROR("Failed to serialize message.");
+  try {
+    serialize_cdr(
+      introspection_message->message, get_message_members(type_support),
+      serialized_message->serialized_data.get());
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_CONVERTER_DEFAULT_PLUGINS_LOG_ERROR("Failed to serialize message: %s", e.what());
+  }
+}
+
+const rosidl_typesupport_introspection_cpp::MessageMembers * CdrConverter::get_message_members(
+  const rosidl_message_type_support_t * type_support)
+{
+  const auto cached_members = message_members_.find(type_support);
+  if (cached_members != message_members_.end()) {
+    return cached_members->second;
+  }
+
+  const auto introspection_type_support = get_message_typesupport_handle(
+    type_support, rosidl_typesupport_introspection_cpp::typesupport_identifier);
+  if (!introspection_type_support) {
+    rcutils_reset_error();
+    throw std::runtime_error("No introspection type support found for message.");
   }
+  const auto members = static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+    introspection_type_support->data);
+  message_members_.emplace(type_support, members);
+  return members;
 }
 
 }  // namespace rosbag2_converter_default_plugins
@@ -17,12 +17,10 @@
 
 #include <memory>
 #include <string>
-
-#include "rmw/types.h"
+#include <unordered_map>
 
 #include "rosidl_runtime_cpp/message_type_support_decl.hpp"
-
-#include "rcpputils/shared_library.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
 
 #include "rosbag2_cpp/converter_interfaces/serialization_format_converter.hpp"
 #include "rosbag2_cpp/types.hpp"
@@ -30,10 +28,15 @@
 namespace rosbag2_converter_default_plugins
 {
 
+/**
+ * Converts between CDR and C++ ROS messages with an embedded CDR implementation driven by the
+ * introspection type support of the messages, so no middleware library is loaded.
+ * A converter is not thread-safe, but cheap to create, e.g. one for every thread.
+ */
 class CdrConverter : public rosbag2_cpp::converter_interfaces::SerializationFormatConverter
 {
 public:
-  CdrConverter();
+  CdrConverter() = default;
 
   void deserialize(
     std::shared_ptr<const rosbag2_storage::SerializedBagMessage> serialized_message,
@@ -46,18 +49,13 @@ public:
     std::shared_ptr<rosbag2_storage::SerializedBagMessage> serialized_message) override;
 
 private:
-  std::shared_ptr<rcpputils::SharedLibrary> library;
-
-protected:
-  rmw_ret_t (* serialize_fcn_)(
-    const void *,
-    const rosidl_message_type_support_t *,
-    rmw_serialized_message_t *) = nullptr;
+  /// \throws std::runtime_error if there is no introspection type support for the message.
+  const rosidl_typesupport_introspection_cpp::MessageMembers * get_message_members(
+    const rosidl_message_type_support_t * type_support);
 
-  rmw_ret_t (* deserialize_fcn_)(
-    const rmw_serialized_message_t *,
+  std::unordered_map<
     const rosidl_message_type_support_t *,
-    void *) = nullptr;
+    const rosidl_typesupport_introspection_cpp::MessageMembers *> message_members_;
 };
 
 }  // namespace rosbag2_converter_default_plugins
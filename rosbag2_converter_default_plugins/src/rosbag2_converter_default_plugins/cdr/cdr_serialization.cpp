@@ -0,0 +1,537 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cdr_serialization.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcutils/types/rcutils_ret.h"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+
+namespace rosbag2_converter_default_plugins
+{
+
+namespace
+{
+
+using rosidl_typesupport_introspection_cpp::MessageMember;
+using rosidl_typesupport_introspection_cpp::MessageMembers;
+
+// CDR data starts with a header stating the representation, of which the second byte is 1 for
+// little endian data. Values are aligned to their size relative to the end of the header.
+constexpr size_t kEncapsulationSize = 4;
+constexpr size_t kMaxAlignment = 8;
+
+bool is_little_endian_host()
+{
+  const uint16_t value = 1;
+  uint8_t first_byte;
+  std::memcpy(&first_byte, &value, 1);
+  return first_byte == 1;
+}
+
+template<typename T>
+void swap_bytes(T & value)
+{
+  uint8_t bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  std::reverse(bytes, bytes + sizeof(T));
+  std::memcpy(&value, bytes, sizeof(T));
+}
+
+const MessageMembers * get_nested_members(const MessageMember & member)
+{
+  return static_cast<const MessageMembers *>(member.members_->data);
+}
+
+bool is_fixed_size_array(const MessageMember & member)
+{
+  return member.is_array_ && member.array_size_ > 0 && !member.is_upper_bound_;
+}
+
+class CdrWriter
+{
+public:
+  explicit CdrWriter(rcutils_uint8_array_t * buffer)
+  : buffer_(buffer)
+  {
+    buffer_->buffer_length = 0;
+    const uint8_t header[kEncapsulationSize] =
+    {0, static_cast<uint8_t>(is_little_endian_host() ? 1 : 0), 0, 0};
+    write_bytes(header, kEncapsulationSize);
+  }
+
+  template<typename T>
+  void write(const T & value)
+  {
+    align(sizeof(T));
+    write_bytes(&value, sizeof(T));
+  }
+
+  template<typename T>
+  void write_array(const T * values, size_t count)
+  {
+    // Like the middlewares, empty arrays are not aligned.
+    if (count > 0) {
+      align(sizeof(T));
+      write_bytes(values, sizeof(T) * count);
+    }
+  }
+
+  void write_string(const std::string & value)
+  {
+    // The length includes the terminating null character.
+    write(static_cast<uint32_t>(value.size() + 1));
+    write_bytes(value.c_str(), value.size() + 1);
+  }
+
+  void write_wstring(const std::u16string & value)
+  {
+    // Wide characters are written with four bytes, without terminating null character.
+    write(static_cast<uint32_t>(value.size()));
+    for (const auto character : value) {
+      write(static_cast<uint32_t>(character));
+    }
+  }
+
+private:
+  void align(size_t alignment)
+  {
+    static const uint8_t padding[kMaxAlignment] = {};
+    const auto misalignment = (buffer_->buffer_length - kEncapsulationSize) % alignment;
+    if (misalignment != 0) {
+      write_bytes(padding, alignment - misalignment);
+    }
+  }
+
+  void write_bytes(const void * data, size_t size)
+  {
+    const auto required_capacity = buffer_->buffer_length + size;
+    if (required_capacity > buffer_->buffer_capacity) {
+      const auto capacity = std::max(required_capacity, 2 * buffer_->buffer_capacity);
+      if (rcutils_uint8_array_resize(buffer_, capacity) != RCUTILS_RET_OK) {
+        throw std::runtime_error("Failed to allocate memory for serialized message.");
+      }
+    }
+    std::memcpy(buffer_->buffer + buffer_->buffer_length, data, size);
+    buffer_->buffer_length += size;
+  }
+
+  rcutils_uint8_array_t * buffer_;
+};
+
+class CdrReader
+{
+public:
+  explicit CdrReader(const rcutils_uint8_array_t & buffer)
+  : data_(buffer.buffer), size_(buffer.buffer_length)
+  {
+    const auto header = read_bytes(kEncapsulationSize);
+    const bool little_endian_data = (header[1] & 1u) == 1u;
+    swap_bytes_ = little_endian_data != is_little_endian_host();
+  }
+
+  template<typename T>
+  T read()
+  {
+    align(sizeof(T));
+    T value;
+    std::memcpy(&value, read_bytes(sizeof(T)), sizeof(T));
+    if (swap_bytes_) {
+      swap_bytes(value);
+    }
+    return value;
+  }
+
+  template<typename T>
+  void read_array(T * values, size_t count)
+  {
+    if (count == 0) {
+      return;
+    }
+    align(sizeof(T));
+    check_remaining(count, sizeof(T));
+    std::memcpy(values, read_bytes(sizeof(T) * count), sizeof(T) * count);
+    if (swap_bytes_ && sizeof(T) > 1) {
+      std::for_each(values, values + count, [](T & value) {swap_bytes(value);});
+    }
+  }
+
+  void read_string(std::string & value)
+  {
+    const auto length = read<uint32_t>();
+    const auto characters = reinterpret_cast<const char *>(read_bytes(length));
+    // Strings are terminated by a null character, which is included in the length.
+    value.assign(characters, length > 0 ? length - 1 : 0);
+  }
+
+  void read_wstring(std::u16string & value)
+  {
+    const auto length = read<uint32_t>();
+    check_remaining(length, sizeof(uint32_t));
+    value.resize(length);
+    for (auto & character : value) {
+      character = static_cast<char16_t>(read<uint32_t>());
+    }
+  }
+
+  /// Reads the length of a sequence and checks it against its bound and the remaining data.
+  size_t read_sequence_length(const MessageMember & member)
+  {
+    const auto length = read<uint32_t>();
+    if (member.is_upper_bound_ && length > member.array_size_) {
+      throw std::runtime_error(
+              std::string("Serialized sequence exceeds the bound of field '") + member.name_ +
+              "'.");
+    }
+    // Every element takes at least one byte.
+    check_remaining(length, 1);
+    return length;
+  }
+
+private:
+  void align(size_t alignment)
+  {
+    const auto misalignment = (offset_ - kEncapsulationSize) % alignment;
+    if (misalignment != 0) {
+      read_bytes(alignment - misalignment);
+    }
+  }
+
+  void check_remaining(size_t count, size_t element_size) const
+  {
+    if (count > (size_ - offset_) / element_size) {
+      throw std::runtime_error("Serialized message is truncated.");
+    }
+  }
+
+  const uint8_t * read_bytes(size_t count)
+  {
+    check_remaining(count, 1);
+    const auto bytes = data_ + offset_;
+    offset_ += count;
+    return bytes;
+  }
+
+  const uint8_t * data_;
+  size_t size_;
+  size_t offset_{0};
+  bool swap_bytes_{false};
+};
+
+template<typename T>
+struct TypeTag
+{
+  using type = T;
+};
+
+/**
+ * Calls the visitor with a TypeTag of the C++ type of a non-message field. Sequences of the type
+ * are std::vector, or rosidl_runtime_cpp::BoundedVector, which has the same layout.
+ */
+template<typename Visitor>
+void visit_field_type(const MessageMember & member, Visitor && visitor)
+{
+  namespace types = rosidl_typesupport_introspection_cpp;
+  switch (member.type_id_) {
+    case types::ROS_TYPE_FLOAT:
+      visitor(TypeTag<float>{});
+      break;
+    case types::ROS_TYPE_DOUBLE:
+      visitor(TypeTag<double>{});
+      break;
+    case types::ROS_TYPE_CHAR:
+    case types::ROS_TYPE_OCTET:
+    case types::ROS_TYPE_UINT8:
+      visitor(TypeTag<uint8_t>{});
+      break;
+    case types::ROS_TYPE_BOOLEAN:
+      visitor(TypeTag<bool>{});
+      break;
+    case types::ROS_TYPE_INT8:
+      visitor(TypeTag<int8_t>{});
+      break;
+    case types::ROS_TYPE_UINT16:
+      visitor(TypeTag<uint16_t>{});
+      break;
+    case types::ROS_TYPE_INT16:
+      visitor(TypeTag<int16_t>{});
+      break;
+    case types::ROS_TYPE_UINT32:
+      visitor(TypeTag<uint32_t>{});
+      break;
+    case types::ROS_TYPE_INT32:
+      visitor(TypeTag<int32_t>{});
+      break;
+    case types::ROS_TYPE_UINT64:
+      visitor(TypeTag<uint64_t>{});
+      break;
+    case types::ROS_TYPE_INT64:
+      visitor(TypeTag<int64_t>{});
+      break;
+    case types::ROS_TYPE_STRING:
+      visitor(TypeTag<std::string>{});
+      break;
+    case types::ROS_TYPE_WSTRING:
+      visitor(TypeTag<std::u16string>{});
+      break;
+    default:
+      throw std::runtime_error(
+              std::string("Field '") + member.name_ + "' has a type not supported by CDR.");
+  }
+}
+
+template<typename T>
+void write_element(CdrWriter & writer, const T & value)
+{
+  writer.write(value);
+}
+
+void write_element(CdrWriter & writer, const bool & value)
+{
+  writer.write(static_cast<uint8_t>(value));
+}
+
+void write_element(CdrWriter & writer, const std::string & value)
+{
+  writer.write_string(value);
+}
+
+void write_element(CdrWriter & writer, const std::u16string & value)
+{
+  writer.write_wstring(value);
+}
+
+template<typename T>
+void write_elements(CdrWriter & writer, const T * values, size_t count)
+{
+  writer.write_array(values, count);
+}
+
+template<typename T>
+void write_each_element(CdrWriter & writer, const T * values, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    write_element(writer, values[i]);
+  }
+}
+
+void write_elements(CdrWriter & writer, const bool * values, size_t count)
+{
+  write_each_element(writer, values, count);
+}
+
+void write_elements(CdrWriter & writer, const std::string * values, size_t count)
+{
+  write_each_element(writer, values, count);
+}
+
+void write_elements(CdrWriter & writer, const std::u16string * values, size_t count)
+{
+  write_each_element(writer, values, count);
+}
+
+template<typename T>
+void write_sequence(CdrWriter & writer, const std::vector<T> & sequence)
+{
+  writer.write(static_cast<uint32_t>(sequence.size()));
+  write_elements(writer, sequence.data(), sequence.size());
+}
+
+void write_sequence(CdrWriter & writer, const std::vector<bool> & sequence)
+{
+  writer.write(static_cast<uint32_t>(sequence.size()));
+  for (const bool value : sequence) {
+    write_element(writer, value);
+  }
+}
+
+template<typename T>
+void read_element(CdrReader & reader, T & value)
+{
+  value = reader.read<T>();
+}
+
+void read_element(CdrReader & reader, bool & value)
+{
+  value = reader.read<uint8_t>() != 0;
+}
+
+void read_element(CdrReader & reader, std::string & value)
+{
+  reader.read_string(value);
+}
+
+void read_element(CdrReader & reader, std::u16string & value)
+{
+  reader.read_wstring(value);
+}
+
+template<typename T>
+void read_elements(CdrReader & reader, T * values, size_t count)
+{
+  reader.read_array(values, count);
+}
+
+template<typename T>
+void read_each_element(CdrReader & reader, T * values, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    read_element(reader, values[i]);
+  }
+}
+
+void read_elements(CdrReader & reader, bool * values, size_t count)
+{
+  read_each_element(reader, values, count);
+}
+
+void read_elements(CdrReader & reader, std::string * values, size_t count)
+{
+  read_each_element(reader, values, count);
+}
+
+void read_elements(CdrReader & reader, std::u16string * values, size_t count)
+{
+  read_each_element(reader, values, count);
+}
+
+template<typename T>
+void read_sequence(CdrReader & reader, std::vector<T> & sequence, size_t length)
+{
+  sequence.resize(length);
+  read_elements(reader, sequence.data(), length);
+}
+
+void read_sequence(CdrReader & reader, std::vector<bool> & sequence, size_t length)
+{
+  sequence.resize(length);
+  for (size_t i = 0; i < length; ++i) {
+    bool value;
+    read_element(reader, value);
+    sequence[i] = value;
+  }
+}
+
+void serialize_message(CdrWriter & writer, const MessageMembers * members, const void * message);
+
+void deserialize_message(CdrReader & reader, const MessageMembers * members, void * message);
+
+void serialize_message_field(CdrWriter & writer, const MessageMember & member, const void * field)
+{
+  const auto nested_members = get_nested_members(member);
+  if (!member.is_array_) {
+    serialize_message(writer, nested_members, field);
+    return;
+  }
+  const auto count = member.size_function(field);
+  if (!is_fixed_size_array(member)) {
+    writer.write(static_cast<uint32_t>(count));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    serialize_message(writer, nested_members, member.get_const_function(field, i));
+  }
+}
+
+void deserialize_message_field(CdrReader & reader, const MessageMember & member, void * field)
+{
+  const auto nested_members = get_nested_members(member);
+  if (!member.is_array_) {
+    deserialize_message(reader, nested_members, field);
+    return;
+  }
+  size_t count = member.array_size_;
+  if (!is_fixed_size_array(member)) {
+    count = reader.read_sequence_length(member);
+    member.resize_function(field, count);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    deserialize_message(reader, nested_members, member.get_function(field, i));
+  }
+}
+
+void serialize_message(CdrWriter & writer, const MessageMembers * members, const void * message)
+{
+  for (uint32_t i = 0; i < members->member_count_; ++i) {
+    const auto & member = members->members_[i];
+    const auto field = static_cast<const uint8_t *>(message) + member.offset_;
+    if (member.type_id_ == rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE) {
+      serialize_message_field(writer, member, field);
+      continue;
+    }
+    visit_field_type(
+      member, [&writer, &member, field](auto type_tag) {
+        using T = typename decltype(type_tag)::type;
+        if (!member.is_array_) {
+          write_element(writer, *reinterpret_cast<const T *>(field));
+        } else if (is_fixed_size_array(member)) {
+          write_elements(writer, reinterpret_cast<const T *>(field), member.array_size_);
+        } else {
+          write_sequence(writer, *reinterpret_cast<const std::vector<T> *>(field));
+        }
+      });
+  }
+}
+
+void deserialize_message(CdrReader & reader, const MessageMembers * members, void * message)
+{
+  for (uint32_t i = 0; i < members->member_count_; ++i) {
+    const auto & member = members->members_[i];
+    const auto field = static_cast<uint8_t *>(message) + member.offset_;
+    if (member.type_id_ == rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE) {
+      deserialize_message_field(reader, member, field);
+      continue;
+    }
+    visit_field_type(
+      member, [&reader, &member, field](auto type_tag) {
+        using T = typename decltype(type_tag)::type;
+        if (!member.is_array_) {
+          read_element(reader, *reinterpret_cast<T *>(field));
+        } else if (is_fixed_size_array(member)) {
+          read_elements(reader, reinterpret_cast<T *>(field), member.array_size_);
+        } else {
+          const auto length = reader.read_sequence_length(member);
+          read_sequence(reader, *reinterpret_cast<std::vector<T> *>(field), length);
+        }
+      });
+  }
+}
+
+}  // namespace
+
+void serialize_cdr(
+  const void * ros_message,
+  const MessageMembers * members,
+  rcutils_uint8_array_t * serialized_message)
+{
+  CdrWriter writer{serialized_message};
+  serialize_message(writer, members, ros_message);
+}
+
+void deserialize_cdr(
+  const rcutils_uint8_array_t & serialized_message,
+  const MessageMembers * members,
+  void * ros_message)
+{
+  CdrReader reader{serialized_message};
+  deserialize_message(reader, members, ros_message);
+}
+
+}  // namespace rosbag2_converter_default_plugins
@@ -0,0 +1,57 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CONVERTER_DEFAULT_PLUGINS__CDR__CDR_SERIALIZATION_HPP_
+#define ROSBAG2_CONVERTER_DEFAULT_PLUGINS__CDR__CDR_SERIALIZATION_HPP_
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+namespace rosbag2_converter_default_plugins
+{
+
+/**
+ * Serializes a C++ ROS message into CDR by walking its introspection type support, with the
+ * same layout as the CDR written by the DDS middlewares. The data is written in the byte order of
+ * this machine, which is stated in the encapsulation header.
+ *
+ * \param ros_message The C++ ROS message.
+ * \param members The introspection type support of the message.
+ * \param serialized_message Buffer which is overwritten and grown as needed.
+ * \throws std::runtime_error if the message contains a type not supported by CDR in ROS 2
+ * or the buffer cannot be grown.
+ */
+void serialize_cdr(
+  const void * ros_message,
+  const rosidl_typesupport_introspection_cpp::MessageMembers * members,
+  rcutils_uint8_array_t * serialized_message);
+
+/**
+ * Deserializes CDR of either byte order into a C++ ROS message.
+ *
+ * \param serialized_message The CDR data including the encapsulation header.
+ * \param members The introspection type support of the message.
+ * \param ros_message Initialized C++ ROS message which is overwritten.
+ * \throws std::runtime_error if the data is truncated, exceeds the bound of a sequence
+ * or contains a type not supported by CDR in ROS 2.
+ */
+void deserialize_cdr(
+  const rcutils_uint8_array_t & serialized_message,
+  const rosidl_typesupport_introspection_cpp::MessageMembers * members,
+  void * ros_message);
+
+}  // namespace rosbag2_converter_default_plugins
+
+#endif  // ROSBAG2_CONVERTER_DEFAULT_PLUGINS__CDR__CDR_SERIALIZATION_HPP_
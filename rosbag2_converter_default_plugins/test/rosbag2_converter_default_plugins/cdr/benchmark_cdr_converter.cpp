@@ -0,0 +1,360 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "rcutils/allocator.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+#include "rosbag2_cpp/types.hpp"
+
+#include "sensor_msgs/msg/image.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+#include "sensor_msgs/msg/point_field.hpp"
+#include "test_msgs/message_fixtures.hpp"
+#include "tf2_msgs/msg/tf_message.hpp"
+
+#include "../../../src/rosbag2_converter_default_plugins/cdr/cdr_converter.hpp"
+
+// Every allocation of this process, by operator new or by the rcutils allocator given to the
+// converter, is counted to report the allocations per converted message.
+namespace
+{
+std::atomic<size_t> g_allocations{0};
+}  // namespace
+
+void * operator new(std::size_t size)
+{
+  ++g_allocations;
+  void * pointer = std::malloc(size == 0 ? 1 : size);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void * pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+namespace
+{
+
+void * counting_allocate(size_t size, void * state)
+{
+  (void) state;
+  ++g_allocations;
+  return std::malloc(size);
+}
+
+void counting_deallocate(void * pointer, void * state)
+{
+  (void) state;
+  std::free(pointer);
+}
+
+void * counting_reallocate(void * pointer, size_t size, void * state)
+{
+  (void) state;
+  ++g_allocations;
+  return std::realloc(pointer, size);
+}
+
+void * counting_zero_allocate(size_t number_of_elements, size_t size_of_element, void * state)
+{
+  (void) state;
+  ++g_allocations;
+  return std::calloc(number_of_elements, size_of_element);
+}
+
+rcutils_allocator_t get_counting_allocator()
+{
+  rcutils_allocator_t allocator = rcutils_get_zero_initialized_allocator();
+  allocator.allocate = counting_allocate;
+  allocator.deallocate = counting_deallocate;
+  allocator.reallocate = counting_reallocate;
+  allocator.zero_allocate = counting_zero_allocate;
+  allocator.state = nullptr;
+  return allocator;
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_serialized_message(
+  rcutils_allocator_t allocator)
+{
+  auto serialized_data = std::shared_ptr<rcutils_uint8_array_t>(
+    new rcutils_uint8_array_t,
+    [](rcutils_uint8_array_t * data) {
+      rcutils_uint8_array_fini(data);
+      delete data;
+    });
+  *serialized_data = rcutils_get_zero_initialized_uint8_array();
+  if (rcutils_uint8_array_init(serialized_data.get(), 0, &allocator) != RCUTILS_RET_OK) {
+    throw std::runtime_error("Could not initialize serialized message.");
+  }
+  auto serialized_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  serialized_message->serialized_data = serialized_data;
+  return serialized_message;
+}
+
+sensor_msgs::msg::Image make_image(size_t size)
+{
+  sensor_msgs::msg::Image image;
+  image.header.frame_id = "camera";
+  image.encoding = "mono8";
+  image.width = 1024;
+  image.height = static_cast<uint32_t>(size / image.width);
+  image.step = image.width;
+  image.data.resize(image.step * image.height, 0x7f);
+  return image;
+}
+
+sensor_msgs::msg::PointCloud2 make_point_cloud(size_t number_of_points)
+{
+  sensor_msgs::msg::PointCloud2 point_cloud;
+  point_cloud.header.frame_id = "lidar";
+  for (const auto & name : {"x", "y", "z", "intensity"}) {
+    sensor_msgs::msg::PointField field;
+    field.name = name;
+    field.offset = static_cast<uint32_t>(point_cloud.fields.size() * sizeof(float));
+    field.datatype = sensor_msgs::msg::PointField::FLOAT32;
+    field.count = 1;
+    point_cloud.fields.push_back(field);
+  }
+  point_cloud.height = 1;
+  point_cloud.width = static_cast<uint32_t>(number_of_points);
+  point_cloud.point_step = static_cast<uint32_t>(point_cloud.fields.size() * sizeof(float));
+  point_cloud.row_step = point_cloud.point_step * point_cloud.width;
+  point_cloud.is_dense = true;
+  point_cloud.data.resize(point_cloud.row_step, 0x7f);
+  return point_cloud;
+}
+
+tf2_msgs::msg::TFMessage make_tf(size_t number_of_transforms)
+{
+  tf2_msgs::msg::TFMessage tf;
+  tf.transforms.resize(number_of_transforms);
+  for (size_t i = 0; i < number_of_transforms; ++i) {
+    tf.transforms[i].header.frame_id = "odom";
+    tf.transforms[i].child_frame_id = "link_" + std::to_string(i);
+    tf.transforms[i].transform.rotation.w = 1.0;
+  }
+  return tf;
+}
+
+/// Holds a message together with its CDR, both reused for all iterations like by the reader.
+template<typename MessageT>
+class ConversionBenchmark
+{
+public:
+  explicit ConversionBenchmark(MessageT message)
+  : message_(std::move(message)),
+    type_support_(rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>()),
+    allocator_(get_counting_allocator()),
+    introspection_message_(std::make_shared<rosbag2_cpp::rosbag2_introspection_message_t>()),
+    serialized_message_(make_serialized_message(allocator_)),
+    converted_message_(make_serialized_message(allocator_))
+  {
+    introspection_message_->message = &message_;
+    introspection_message_->topic_name = nullptr;
+    introspection_message_->time_stamp = 0;
+    introspection_message_->allocator = allocator_;
+    rosbag2_cpp::introspection_message_set_topic_name(introspection_message_.get(), "/topic");
+
+    converter_.serialize(introspection_message_, type_support_, serialized_message_);
+    if (serialized_message_->serialized_data->buffer_length == 0) {
+      throw std::runtime_error("Could not serialize message.");
+    }
+  }
+
+  ~ConversionBenchmark()
+  {
+    allocator_.deallocate(introspection_message_->topic_name, allocator_.state);
+  }
+
+  void run_deserialize(benchmark::State & state)
+  {
+    run(
+      state, [this]() {
+        converter_.deserialize(serialized_message_, type_support_, introspection_message_);
+      });
+  }
+
+  void run_serialize(benchmark::State & state)
+  {
+    run(
+      state, [this]() {
+        converter_.serialize(introspection_message_, type_support_, serialized_message_);
+      });
+  }
+
+  // The path of rosbag2_cpp::Converter between two serialization formats.
+  void run_convert(benchmark::State & state)
+  {
+    run(
+      state, [this]() {
+        converter_.deserialize(serialized_message_, type_support_, introspection_message_);
+        converter_.serialize(introspection_message_, type_support_, converted_message_);
+      });
+  }
+
+private:
+  template<typename ConvertT>
+  void run(benchmark::State & state, ConvertT && convert)
+  {
+    // Grows the buffers before counting, as for every message after the first one.
+    convert();
+
+    const size_t allocations_before = g_allocations;
+    for (auto _ : state) {
+      convert();
+      benchmark::ClobberMemory();
+    }
+    const size_t allocations = g_allocations - allocations_before;
+
+    const auto serialized_size = serialized_message_->serialized_data->buffer_length;
+    state.SetBytesProcessed(
+      static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(serialized_size));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["serialized_size"] = static_cast<double>(serialized_size);
+    state.counters["allocations_per_message"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+  }
+
+  MessageT message_;
+  const rosidl_message_type_support_t * type_support_;
+  rcutils_allocator_t allocator_;
+  rosbag2_converter_default_plugins::CdrConverter converter_;
+  std::shared_ptr<rosbag2_cpp::rosbag2_introspection_message_t> introspection_message_;
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> serialized_message_;
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> converted_message_;
+};
+
+// Image sizes are in bytes, point clouds in points and TF messages in transforms.
+
+void BM_deserialize_image(benchmark::State & state)
+{
+  ConversionBenchmark<sensor_msgs::msg::Image>(make_image(state.range(0))).run_deserialize(state);
+}
+
+void BM_serialize_image(benchmark::State & state)
+{
+  ConversionBenchmark<sensor_msgs::msg::Image>(make_image(state.range(0))).run_serialize(state);
+}
+
+void BM_convert_image(benchmark::State & state)
+{
+  ConversionBenchmark<sensor_msgs::msg::Image>(make_image(state.range(0))).run_convert(state);
+}
+
+void BM_deserialize_point_cloud(benchmark::State & state)
+{
+  ConversionBenchmark<sensor_msgs::msg::PointCloud2>(
+    make_point_cloud(state.range(0))).run_deserialize(state);
+}
+
+void BM_serialize_point_cloud(benchmark::State & state)
+{
+  ConversionBenchmark<sensor_msgs::msg::PointCloud2>(
+    make_point_cloud(state.range(0))).run_serialize(state);
+}
+
+void BM_convert_point_cloud(benchmark::State & state)
+{
+  ConversionBenchmark<sensor_msgs::msg::PointCloud2>(
+    make_point_cloud(state.range(0))).run_convert(state);
+}
+
+void BM_deserialize_tf(benchmark::State & state)
+{
+  ConversionBenchmark<tf2_msgs::msg::TFMessage>(make_tf(state.range(0))).run_deserialize(state);
+}
+
+void BM_serialize_tf(benchmark::State & state)
+{
+  ConversionBenchmark<tf2_msgs::msg::TFMessage>(make_tf(state.range(0))).run_serialize(state);
+}
+
+void BM_convert_tf(benchmark::State & state)
+{
+  ConversionBenchmark<tf2_msgs::msg::TFMessage>(make_tf(state.range(0))).run_convert(state);
+}
+
+void BM_deserialize_basic_types(benchmark::State & state)
+{
+  ConversionBenchmark<test_msgs::msg::BasicTypes>(
+    *get_messages_basic_types()[1]).run_deserialize(state);
+}
+
+void BM_serialize_basic_types(benchmark::State & state)
+{
+  ConversionBenchmark<test_msgs::msg::BasicTypes>(
+    *get_messages_basic_types()[1]).run_serialize(state);
+}
+
+void BM_convert_basic_types(benchmark::State & state)
+{
+  ConversionBenchmark<test_msgs::msg::BasicTypes>(
+    *get_messages_basic_types()[1]).run_convert(state);
+}
+
+void BM_deserialize_strings(benchmark::State & state)
+{
+  ConversionBenchmark<test_msgs::msg::Strings>(*get_messages_strings()[1]).run_deserialize(state);
+}
+
+void BM_serialize_strings(benchmark::State & state)
+{
+  ConversionBenchmark<test_msgs::msg::Strings>(*get_messages_strings()[1]).run_serialize(state);
+}
+
+void BM_convert_strings(benchmark::State & state)
+{
+  ConversionBenchmark<test_msgs::msg::Strings>(*get_messages_strings()[1]).run_convert(state);
+}
+
+}  // namespace
+
+BENCHMARK(BM_deserialize_image)->RangeMultiplier(8)->Range(64 << 10, 8 << 20);
+BENCHMARK(BM_serialize_image)->RangeMultiplier(8)->Range(64 << 10, 8 << 20);
+BENCHMARK(BM_convert_image)->RangeMultiplier(8)->Range(64 << 10, 8 << 20);
+BENCHMARK(BM_deserialize_point_cloud)->RangeMultiplier(8)->Range(1 << 10, 1 << 17);
+BENCHMARK(BM_serialize_point_cloud)->RangeMultiplier(8)->Range(1 << 10, 1 << 17);
+BENCHMARK(BM_convert_point_cloud)->RangeMultiplier(8)->Range(1 << 10, 1 << 17);
+BENCHMARK(BM_deserialize_tf)->RangeMultiplier(4)->Range(1, 64);
+BENCHMARK(BM_serialize_tf)->RangeMultiplier(4)->Range(1, 64);
+BENCHMARK(BM_convert_tf)->RangeMultiplier(4)->Range(1, 64);
+BENCHMARK(BM_deserialize_basic_types);
+BENCHMARK(BM_serialize_basic_types);
+BENCHMARK(BM_convert_basic_types);
+BENCHMARK(BM_deserialize_strings);
+BENCHMARK(BM_serialize_strings);
+BENCHMARK(BM_convert_strings);
+
+BENCHMARK_MAIN();
@@ -331,3 +331,43 @@ TEST_F(CdrConverterTestFixture, serialize_converts_ros_message_into_cdr_for_mult
   EXPECT_THAT(serialized_message->topic_name, StrEq(topic_name_));
   EXPECT_THAT(serialized_message->time_stamp, Eq(ros_message->time_stamp));
 }
+
+TEST_F(CdrConverterTestFixture, deserialize_converts_cdr_into_ros_message_for_bounded_sequence) {
+  auto message = get_messages_bounded_sequences()[1];
+  auto serialized_data = memory_management_->serialize_message(message);
+  auto serialized_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  serialized_message->serialized_data = serialized_data;
+  serialized_message->topic_name = topic_name_;
+  serialized_message->time_stamp = 1;
+
+  auto ros_message = make_shared_ros_message();
+  test_msgs::msg::BoundedSequences bounded_sequences_message;
+  ros_message->message = &bounded_sequences_message;
+  std::shared_ptr<rcpputils::SharedLibrary> library;
+  auto type_support =
+    rosbag2_cpp::get_typesupport("test_msgs/BoundedSequences", "rosidl_typesupport_cpp", library);
+
+  converter_->deserialize(serialized_message, type_support, ros_message);
+
+  auto cast_message = static_cast<test_msgs::msg::BoundedSequences *>(ros_message->message);
+  EXPECT_THAT(*cast_message, Eq(*message));
+}
+
+TEST_F(CdrConverterTestFixture, serialize_converts_ros_message_into_cdr_for_bounded_sequence) {
+  auto ros_message = make_shared_ros_message(topic_name_);
+  ros_message->time_stamp = 1;
+  auto message = get_messages_bounded_sequences()[1];
+  ros_message->message = message.get();
+
+  auto serialized_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  serialized_message->serialized_data = memory_management_->make_initialized_message();
+  std::shared_ptr<rcpputils::SharedLibrary> library;
+  auto type_support =
+    rosbag2_cpp::get_typesupport("test_msgs/BoundedSequences", "rosidl_typesupport_cpp", library);
+
+  converter_->serialize(ros_message, type_support, serialized_message);
+
+  auto deserialized_msg = memory_management_->
+    deserialize_message<test_msgs::msg::BoundedSequences>(serialized_message->serialized_data);
+  EXPECT_THAT(*deserialized_msg, Eq(*message));
+}
@@ -0,0 +1,59 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__BAG_EVENTS_HPP_
+#define ROSBAG2_CPP__BAG_EVENTS_HPP_
+
+#include <functional>
+#include <string>
+
+namespace rosbag2_cpp
+{
+namespace bag_events
+{
+
+struct BagSplitInfo
+{
+  // Path of the bagfile which was closed, after compression if the bag is compressed per file.
+  std::string closed_file;
+  // Path of the bagfile which is written next. Empty if the bag was closed for good.
+  std::string opened_file;
+};
+
+using BagSplitCallbackType = std::function<void (const BagSplitInfo &)>;
+
+struct BagRetireInfo
+{
+  // Path of the closed bagfile which the retention policy dropped from the bag.
+  std::string retired_file;
+};
+
+using BagRetireCallbackType = std::function<void (const BagRetireInfo &)>;
+
+// Callbacks a writer invokes on bag events. Callbacks which are not set are ignored.
+struct WriterEventCallbacks
+{
+  // Called once a bagfile is closed and complete, either on a split or when the bag is closed.
+  // May be called from a background thread of the writer.
+  BagSplitCallbackType write_split_callback;
+  // Called from a background thread of the writer once the retention policy dropped a bagfile
+  // from the bag. If set, the file is handed over to the callback, e.g. to archive it, instead of
+  // being deleted.
+  BagRetireCallbackType write_retire_callback;
+};
+
+}  // namespace bag_events
+}  // namespace rosbag2_cpp
+
+#endif  // ROSBAG2_CPP__BAG_EVENTS_HPP_
@@ -0,0 +1,132 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__BAG_GENERATOR_HPP_
+#define ROSBAG2_CPP__BAG_GENERATOR_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/// A topic of a generated bag, published at a fixed rate.
+struct GeneratedTopic
+{
+  std::string name;
+  std::string type = "std_msgs/msg/ByteMultiArray";
+  double rate_hz = 0.0;
+  // Sizes of the serialized messages, which are uniformly distributed between both.
+  size_t min_size = 0;
+  size_t max_size = 0;
+};
+
+/// Describes the content of a generated bag, see BagGenerator::parse_spec for its YAML form.
+struct GeneratorSpec
+{
+  // The same spec and seed always generate the same messages.
+  uint64_t seed = 0;
+  std::chrono::nanoseconds duration{0};
+  // Time stamp of the first message of every topic.
+  rcutils_time_point_value_t start_time = 0;
+  std::vector<GeneratedTopic> topics;
+};
+
+/**
+ * Writes bags of synthetic messages, e.g. to test the performance of storages and playback with
+ * bags of any size, which are reproducible without recording them.
+ *
+ * The content of every message is derived from the seed, its topic and its index only, so it
+ * does not depend on the number of threads generating the messages. Messages of at least 16
+ * bytes are valid CDR serialized std_msgs/msg/ByteMultiArray or UInt8MultiArray messages, whose
+ * data is random. Messages of other types can be stored, read and played back, but subscribers
+ * cannot deserialize them.
+ */
+class ROSBAG2_CPP_PUBLIC BagGenerator
+{
+public:
+  explicit BagGenerator(
+    std::unique_ptr<writer_interfaces::BaseWriterInterface> writer_impl =
+    std::make_unique<writers::SequentialWriter>());
+
+  /**
+   * Parses a spec from YAML, e.g.
+   *
+   *     seed: 42
+   *     duration: 60.0  # seconds
+   *     start_time: 0  # nanoseconds, optional
+   *     topics:
+   *       - name: /camera/image
+   *         type: sensor_msgs/msg/Image  # optional, defaults to std_msgs/msg/ByteMultiArray
+   *         rate: 30.0  # Hz
+   *         size: 921600  # bytes, or min_size and max_size for random sizes
+   *
+   * \throws std::invalid_argument if the YAML is malformed or the spec is not valid.
+   */
+  static GeneratorSpec parse_spec(const std::string & yaml);
+
+  /**
+   * Parses the spec of the YAML file at path, see parse_spec.
+   *
+   * \throws std::runtime_error if the file cannot be read.
+   * \throws std::invalid_argument if the YAML is malformed or the spec is not valid.
+   */
+  static GeneratorSpec load_spec(const std::string & path);
+
+  /**
+   * Writes the messages of the spec to a new bag, in the order of their time stamps.
+   *
+   * The messages are generated in parallel while the previous ones are written.
+   *
+   * \param spec Topics and duration of the bag.
+   * \param storage_options Options of the bag to write, e.g. its uri and storage.
+   * \param max_threads Maximum number of threads generating messages, 0 for one per processor.
+   * \return The number of messages written.
+   * \throws std::invalid_argument if the spec is not valid.
+   * \throws std::runtime_error if the bag cannot be written.
+   */
+  uint64_t generate(
+    const GeneratorSpec & spec, const StorageOptions & storage_options, size_t max_threads = 0);
+
+private:
+  Writer writer_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__BAG_GENERATOR_HPP_
@@ -0,0 +1,90 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__BAG_SLICER_HPP_
+#define ROSBAG2_CPP__BAG_SLICER_HPP_
+
+#include <memory>
+#include <string>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_cpp/reindexer.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_factory_interface.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Cuts the messages of a time range out of a bag into a new bag.
+ *
+ * Every bagfile is sliced by its storage, which copies the stored messages as they are, without
+ * reading them one by one through a reader and a writer, so slicing takes about the time of
+ * copying the bytes of the slice.
+ */
+class ROSBAG2_CPP_PUBLIC BagSlicer
+{
+public:
+  explicit BagSlicer(
+    std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory =
+    std::make_unique<rosbag2_storage::StorageFactory>(),
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>(),
+    std::unique_ptr<Reindexer> reindexer = std::make_unique<Reindexer>());
+
+  /**
+   * Writes the messages of the bag with time stamps in the inclusive range from start_time to
+   * end_time to a new bag, along with all topics.
+   *
+   * Bagfiles whose time range in the metadata lies outside of the range are skipped, the others
+   * are sliced into bagfiles named after the output directory, e.g. `slice/slice_0.db3`. The
+   * metadata of the new bag is summarized from its bagfiles by the reindexer.
+   *
+   * \param uri Directory of the bag.
+   * \param output_uri Directory of the new bag, which must not exist.
+   * \return The metadata of the new bag.
+   * \throws std::invalid_argument if the time range is empty.
+   * \throws std::runtime_error if the bag has no metadata, is compressed or encrypted, the output
+   * directory exists, no bagfile has messages in the range, or the storage cannot slice.
+   */
+  rosbag2_storage::BagMetadata slice(
+    const std::string & uri, const std::string & output_uri,
+    const rcutils_time_point_value_t & start_time, const rcutils_time_point_value_t & end_time);
+
+private:
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_;
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
+  std::unique_ptr<Reindexer> reindexer_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__BAG_SLICER_HPP_
@@ -0,0 +1,111 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__CDR_FIELD_EXTRACTOR_HPP_
+#define ROSBAG2_CPP__CDR_FIELD_EXTRACTOR_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "rcutils/time.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rosidl_runtime_cpp/message_type_support_decl.hpp"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Reads a single field of CDR serialized messages of one type without deserializing them,
+ * e.g. to scan many messages for their header.stamp without allocating any message.
+ *
+ * On construction, the fields preceding the extracted field are compiled from the introspection
+ * type support into a plan of offsets and alignments. Fields up to the first string or sequence
+ * are skipped at once at a precomputed offset, strings and sequences after it by reading
+ * their length. An extractor can be used from multiple threads.
+ */
+class ROSBAG2_CPP_PUBLIC CdrFieldExtractor
+{
+public:
+  /**
+   * \param type_support Type support of the message type, e.g. as returned by get_typesupport.
+   * \param field_path Names of the field and the messages containing it, separated by dots,
+   * e.g. "header.stamp". The field and the messages containing it must not be arrays or
+   * sequences.
+   * \throws std::runtime_error if there is no introspection type support for the message type,
+   * the field does not exist or cannot be extracted.
+   */
+  CdrFieldExtractor(
+    const rosidl_message_type_support_t * type_support, const std::string & field_path);
+
+  /// Type of the field as rosidl_typesupport_introspection_cpp::ROS_TYPE_*.
+  uint8_t get_field_type() const;
+
+  /**
+   * Extracts a boolean, character, octet or integer field.
+   * \throws std::runtime_error if the field has another type or the message is truncated.
+   */
+  int64_t extract_integer(const rcutils_uint8_array_t & serialized_message) const;
+
+  /**
+   * Extracts a floating point or integer field.
+   * \throws std::runtime_error if the field has another type or the message is truncated.
+   */
+  double extract_floating_point(const rcutils_uint8_array_t & serialized_message) const;
+
+  /**
+   * Extracts a string field.
+   * \throws std::runtime_error if the field has another type or the message is truncated.
+   */
+  std::string extract_string(const rcutils_uint8_array_t & serialized_message) const;
+
+  /**
+   * Extracts a builtin_interfaces/Time or builtin_interfaces/Duration field in nanoseconds.
+   * \throws std::runtime_error if the field has another type or the message is truncated.
+   */
+  rcutils_time_point_value_t extract_time(const rcutils_uint8_array_t & serialized_message) const;
+
+  /**
+   * Overwrites a builtin_interfaces/Time or builtin_interfaces/Duration field in place, in the
+   * byte order of the message, e.g. to restamp messages without serializing them again.
+   * \throws std::runtime_error if the field has another type or the message is truncated.
+   */
+  void rewrite_time(
+    rcutils_uint8_array_t & serialized_message, rcutils_time_point_value_t time) const;
+
+private:
+  // The compiled steps to the field.
+  struct Plan;
+
+  std::shared_ptr<const Plan> plan_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__CDR_FIELD_EXTRACTOR_HPP_
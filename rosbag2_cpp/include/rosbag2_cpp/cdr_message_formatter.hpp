@@ -0,0 +1,99 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__CDR_MESSAGE_FORMATTER_HPP_
+#define ROSBAG2_CPP__CDR_MESSAGE_FORMATTER_HPP_
+
+#include <memory>
+#include <string>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosidl_runtime_cpp/message_type_support_decl.hpp"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Formats CDR serialized messages of one type as JSON objects or CSV rows without deserializing
+ * them, e.g. to export a bag for tools which cannot read CDR.
+ *
+ * The fields of the type are compiled from the introspection type support once, the messages
+ * are then formatted by reading their fields in order and appending the text to a string,
+ * which allocates only when the string grows. Numbers are formatted without going through
+ * streams: integers two digits at a time, floating point numbers with the fewest digits which
+ * read back to the same value. A formatter can be used from multiple threads.
+ */
+class ROSBAG2_CPP_PUBLIC CdrMessageFormatter
+{
+public:
+  /**
+   * \param type_support Type support of the message type, e.g. as returned by get_typesupport.
+   * \throws std::runtime_error if there is no introspection type support for the message type
+   * or it has a field of a type which cannot be formatted, i.e. a long double.
+   */
+  explicit CdrMessageFormatter(const rosidl_message_type_support_t * type_support);
+
+  /**
+   * Appends the message as a JSON object with a member per field.
+   *
+   * Arrays and sequences are JSON arrays, nested messages JSON objects. Floating point numbers
+   * which are not finite are null, as JSON has no representation for them.
+   * \throws std::runtime_error if the message is truncated.
+   */
+  void append_json(const rcutils_uint8_array_t & serialized_message, std::string & output) const;
+
+  /**
+   * Appends the names of the CSV columns of the type, separated by commas.
+   *
+   * Fields of nested messages have columns of their own, named by the path of the field, e.g.
+   * "header.stamp.sec". Arrays and sequences have a single column.
+   */
+  void append_csv_header(std::string & output) const;
+
+  /**
+   * Appends the message as a CSV row with the columns of append_csv_header(), without a line
+   * break.
+   *
+   * Arrays and sequences are quoted JSON arrays, floating point numbers which are not finite
+   * nan, inf or -inf. Strings are quoted if they contain commas, quotes or line breaks.
+   * \throws std::runtime_error if the message is truncated.
+   */
+  void append_csv_row(const rcutils_uint8_array_t & serialized_message, std::string & output)
+  const;
+
+private:
+  // The compiled fields of the type.
+  struct Plan;
+
+  std::shared_ptr<const Plan> plan_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__CDR_MESSAGE_FORMATTER_HPP_
@@ -0,0 +1,120 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__COLUMNAR_EXPORTER_HPP_
+#define ROSBAG2_CPP__COLUMNAR_EXPORTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/// A topic to export and the paths of its fields, e.g. "pose.pose.position.x".
+struct ColumnarTopic
+{
+  std::string topic_name;
+  std::vector<std::string> field_paths;
+};
+
+/// The values of one field of all messages of a topic, in the order of the messages.
+struct FieldColumn
+{
+  std::string field_path;
+  // Type of the field as rosidl_typesupport_introspection_cpp::ROS_TYPE_*.
+  uint8_t field_type;
+  // Floating point fields are held in floating_points. uint64 fields are held in
+  // unsigned_integers, as their values do not all fit into int64. Other boolean, character, octet
+  // and integer fields are held in integers, as are builtin_interfaces/Time and Duration fields
+  // in nanoseconds.
+  std::vector<int64_t> integers;
+  std::vector<uint64_t> unsigned_integers;
+  std::vector<double> floating_points;
+};
+
+struct TopicColumns
+{
+  std::string topic_name;
+  std::string topic_type;
+  // Receive time stamps of the messages.
+  std::vector<rcutils_time_point_value_t> time_stamps;
+  std::vector<FieldColumn> columns;
+};
+
+/**
+ * Exports scalar fields of topics as one contiguous column per field, so analysis reads arrays
+ * of numbers instead of deserializing every message.
+ *
+ * The bag is read in a single pass. The fields are extracted with a CdrFieldExtractor from the
+ * CDR serialized messages without deserializing them, every topic on a thread of its own.
+ */
+class ROSBAG2_CPP_PUBLIC ColumnarExporter
+{
+public:
+  /**
+   * \param topics Topics to export and their fields. Fields must be numbers, booleans or
+   * characters, or builtin_interfaces/Time or Duration messages, and must not be in arrays or
+   * sequences.
+   * \param batch_size Number of messages handed to the thread of a topic at once.
+   */
+  explicit ColumnarExporter(std::vector<ColumnarTopic> topics, size_t batch_size = 1024);
+
+  /**
+   * Reads the remaining messages of the topics and returns their columns, in the order of the
+   * topics. The reader is filtered by the topics, in addition to the time range of the
+   * storage filter, if any.
+   * \throws std::runtime_error if a topic is not in the bag or not serialized as CDR, a field
+   * cannot be exported or a message is truncated.
+   */
+  std::vector<TopicColumns> export_columns(
+    Reader & reader, rosbag2_storage::StorageFilter storage_filter = {}) const;
+
+  /**
+   * Writes the time stamps and every column of the topics to NumPy .npy files of their own, in
+   * a folder of the directory named after the topic, e.g. "odom/time_stamp.npy" and
+   * "odom/pose.pose.position.x.npy".
+   * \throws std::runtime_error if a folder or file cannot be written.
+   */
+  static void write_npy_files(
+    const std::vector<TopicColumns> & topics_columns, const std::string & directory);
+
+private:
+  std::vector<ColumnarTopic> topics_;
+  size_t batch_size_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__COLUMNAR_EXPORTER_HPP_
@@ -15,8 +15,14 @@
 #ifndef ROSBAG2_CPP__CONVERTER_HPP_
 #define ROSBAG2_CPP__CONVERTER_HPP_
 
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -26,6 +32,7 @@
 #include "rosbag2_cpp/serialization_format_converter_factory_interface.hpp"
 #include "rosbag2_cpp/visibility_control.hpp"
 
+#include "rosbag2_storage/message_pool.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
 
 #include "rcpputils/shared_library.hpp"
@@ -69,7 +76,11 @@ public:
   /**
    * Converts the given SerializedBagMessage into the output format of the converter. The
    * serialization format of the input message must be identical to the input format of the
-   * converter.
+   * converter. If the output format is the same, the message is passed through and shares its
+   * serialized data.
+   *
+   * Messages of one topic are deserialized into the same ROS message, so the converter must not
+   * be used from multiple threads at once.
    *
    * \param message Message to convert
    * \returns Converted message
@@ -77,15 +88,114 @@ public:
   std::shared_ptr<rosbag2_storage::SerializedBagMessage>
   convert(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message);
 
+  /**
+   * Converts a batch of messages in place.
+   *
+   * With conversion threads, the batch is split into consecutive parts, which are converted in
+   * parallel by converters of their own. The converted messages keep the order of the batch.
+   * The messages are passed to the deserialize_batch and serialize_batch functions of the
+   * converter plugins in batches of up to 64 messages.
+   *
+   * \param messages Messages to convert, replaced by the converted messages
+   * \throws the first error of any part after all parts are done
+   */
+  void convert(std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages);
+  void convert(
+    std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages);
+
   void add_topic(const std::string & topic, const std::string & type);
 
+  /**
+   * Adds a topic stored in the given serialization format, which may differ from the input
+   * format of the converter, e.g. for bags with topics of several formats. Messages of topics
+   * stored in the output format are passed through like messages of a converter whose input and
+   * output formats are the same.
+   *
+   * \throws runtime_error if there is no converter for the format
+   */
+  void add_topic(
+    const std::string & topic, const std::string & type, const std::string & serialization_format);
+
 private:
+  struct ConvertedTopic;
+
+  template<typename MessageT>
+  void convert_batch(std::vector<std::shared_ptr<MessageT>> & messages);
+  // Converts the messages from begin to end with single batch calls of the converter plugins.
+  template<typename MessageT>
+  void convert_range(std::vector<std::shared_ptr<MessageT>> & messages, size_t begin, size_t end);
+  // Converts the messages of the plugin batch with its deserializer and the output serializer.
+  template<typename MessageT>
+  void convert_plugin_batch(std::vector<std::shared_ptr<MessageT>> & messages);
+  // Returns the deserializer of the format, loaded when first needed.
+  converter_interfaces::SerializationFormatDeserializer * get_input_converter(
+    const std::string & serialization_format);
+  // Returns the ROS message of the topic with the given index, allocated when first needed.
+  std::shared_ptr<rosbag2_introspection_message_t> get_ros_message(
+    ConvertedTopic & topic, size_t index);
+  void run_conversion_worker(size_t worker_index);
+
   std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory_;
-  std::unique_ptr<converter_interfaces::SerializationFormatDeserializer> input_converter_;
+  std::string input_format_;
+  std::string output_format_;
+  // Whether all messages are passed through, i.e. no topic is stored in another format than the
+  // output format.
+  bool passes_through_;
+  // Deserializers of the formats of the topics, starting with the input format.
+  std::unordered_map<
+    std::string, std::unique_ptr<converter_interfaces::SerializationFormatDeserializer>>
+  input_converters_;
   std::unique_ptr<converter_interfaces::SerializationFormatSerializer> output_converter_;
-  std::unordered_map<std::string, ConverterTypeSupport> topics_and_types_;
+  struct ConvertedTopic
+  {
+    ConverterTypeSupport type_support;
+    // Deserializer of the format the topic is stored in, null if it is the output format.
+    converter_interfaces::SerializationFormatDeserializer * input_converter;
+    // Reused for the messages of the topic, one for every message of the topic in a batch.
+    std::vector<std::shared_ptr<rosbag2_introspection_message_t>> ros_messages;
+    size_t last_serialized_size;
+  };
+
+  // Arguments of the batch calls of the converter plugins, kept to reuse their memory.
+  struct PluginBatch
+  {
+    std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> input_messages;
+    std::vector<const rosidl_message_type_support_t *> type_supports;
+    std::vector<std::shared_ptr<rosbag2_introspection_message_t>> ros_messages;
+    std::vector<std::shared_ptr<const rosbag2_introspection_message_t>> const_ros_messages;
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> output_messages;
+    std::vector<ConvertedTopic *> topics;
+    std::unordered_map<ConvertedTopic *, size_t> topic_message_counts;
+    // Indices of the messages in the converted messages, all of one input format.
+    std::vector<size_t> indices;
+    converter_interfaces::SerializationFormatDeserializer * input_converter{nullptr};
+
+    void clear();
+  };
+  PluginBatch plugin_batch_;
+
+  rosbag2_storage::MessagePool message_pool_;
+  std::unordered_map<std::string, ConvertedTopic> topics_and_types_;
   std::shared_ptr<rcpputils::SharedLibrary> library_rosidl_typesupport_cpp_;
   std::shared_ptr<rcpputils::SharedLibrary> library_rosidl_typesupport_introspection_cpp_;
+
+  struct ConversionWorker
+  {
+    std::unique_ptr<Converter> converter;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<ConversionWorker>> workers_;
+  std::mutex batch_mutex_;
+  std::condition_variable batch_available_;
+  std::condition_variable batch_done_;
+  // Converts the part of the current batch with the given index using the given converter.
+  // Part 0 is converted by the calling thread, part i + 1 by worker i.
+  std::function<void(size_t, Converter &)> batch_job_;
+  uint64_t batch_generation_ {0};
+  size_t pending_workers_ {0};
+  bool stop_workers_ {false};
+  std::exception_ptr worker_error_;
 };
 
 }  // namespace rosbag2_cpp
@@ -15,7 +15,9 @@
 #ifndef ROSBAG2_CPP__CONVERTER_INTERFACES__SERIALIZATION_FORMAT_DESERIALIZER_HPP_
 #define ROSBAG2_CPP__CONVERTER_INTERFACES__SERIALIZATION_FORMAT_DESERIALIZER_HPP_
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 #include "rosbag2_cpp/types/introspection_message.hpp"
 
@@ -37,6 +39,27 @@ public:
     std::shared_ptr<const rosbag2_storage::SerializedBagMessage> serialized_message,
     const rosidl_message_type_support_t * type_support,
     std::shared_ptr<rosbag2_introspection_message_t> ros_message) = 0;
+
+  /**
+   * Deserializes a batch of messages, e.g. vectorized or in parallel. Every message is
+   * deserialized with the type support and into the ROS message at the same index, which are
+   * distinct for all messages of the batch. Unless implemented, deserialize is called for every
+   * message in order.
+   *
+   * \param serialized_messages Messages to deserialize
+   * \param type_supports The rmw type support of every message
+   * \param ros_messages The ROS message every message is deserialized into
+   */
+  virtual void deserialize_batch(
+    const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> &
+    serialized_messages,
+    const std::vector<const rosidl_message_type_support_t *> & type_supports,
+    const std::vector<std::shared_ptr<rosbag2_introspection_message_t>> & ros_messages)
+  {
+    for (size_t i = 0; i < serialized_messages.size(); ++i) {
+      deserialize(serialized_messages[i], type_supports[i], ros_messages[i]);
+    }
+  }
 };
 
 }  // namespace converter_interfaces
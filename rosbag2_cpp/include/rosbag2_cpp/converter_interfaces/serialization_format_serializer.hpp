@@ -15,7 +15,9 @@
 #ifndef ROSBAG2_CPP__CONVERTER_INTERFACES__SERIALIZATION_FORMAT_SERIALIZER_HPP_
 #define ROSBAG2_CPP__CONVERTER_INTERFACES__SERIALIZATION_FORMAT_SERIALIZER_HPP_
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 #include "rosbag2_cpp/types/introspection_message.hpp"
 
@@ -37,6 +39,26 @@ public:
     std::shared_ptr<const rosbag2_introspection_message_t> ros_message,
     const rosidl_message_type_support_t * type_support,
     std::shared_ptr<rosbag2_storage::SerializedBagMessage> serialized_message) = 0;
+
+  /**
+   * Serializes a batch of ROS messages, e.g. vectorized or in parallel. Every ROS message is
+   * serialized with the type support and into the message at the same index. Unless
+   * implemented, serialize is called for every ROS message in order.
+   *
+   * \param ros_messages ROS messages to serialize
+   * \param type_supports The rmw type support of every ROS message
+   * \param serialized_messages The message every ROS message is serialized into
+   */
+  virtual void serialize_batch(
+    const std::vector<std::shared_ptr<const rosbag2_introspection_message_t>> & ros_messages,
+    const std::vector<const rosidl_message_type_support_t *> & type_supports,
+    const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> &
+    serialized_messages)
+  {
+    for (size_t i = 0; i < ros_messages.size(); ++i) {
+      serialize(ros_messages[i], type_supports[i], serialized_messages[i]);
+    }
+  }
 };
 
 }  // namespace converter_interfaces
@@ -15,6 +15,7 @@
 #ifndef ROSBAG2_CPP__CONVERTER_OPTIONS_HPP_
 #define ROSBAG2_CPP__CONVERTER_OPTIONS_HPP_
 
+#include <cstddef>
 #include <string>
 
 namespace rosbag2_cpp
@@ -24,6 +25,9 @@ struct ConverterOptions
 {
   std::string input_serialization_format;
   std::string output_serialization_format;
+  // Threads converting batches of messages in addition to the calling thread, 0 to convert on
+  // the calling thread only.
+  size_t conversion_threads = 0;
 };
 
 }  // namespace rosbag2_cpp
@@ -0,0 +1,126 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__DATASET_EXPORTER_HPP_
+#define ROSBAG2_CPP__DATASET_EXPORTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/converter_options.hpp"
+#include "rosbag2_cpp/readers/parallel_reader.hpp"
+#include "rosbag2_cpp/readers/synchronizing_reader.hpp"
+#include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+enum class DatasetShardFormat
+{
+  // A tar archive per shard, as read by WebDataset. Every sample is a file per topic,
+  // "<key>.<topic>.<serialization format>", and "<key>.json" of the time stamps of the messages,
+  // with the slashes within the topic names replaced by double underscores.
+  WEBDATASET,
+  // A TFRecord file per shard of a tf.train.Example per sample. The features are the serialized
+  // message of every topic as a bytes list named after the topic, and its time stamp as an int64
+  // list named "<topic>/time_stamp".
+  TFRECORD,
+};
+
+struct DatasetExportOptions
+{
+  // Topics of the samples, with a message per topic, and how their messages are synchronized.
+  // A single topic makes every one of its messages a sample.
+  readers::SynchronizationOptions synchronization;
+  DatasetShardFormat format = DatasetShardFormat::WEBDATASET;
+  size_t samples_per_shard = 1000;
+  // Number of threads reading and writing at once, the number of cores if 0.
+  size_t max_threads = 0;
+  // Number of time ranges the bag is split into, four per thread if 0. More partitions balance
+  // the threads better, but leave more samples over to be gathered at the end.
+  size_t partition_count = 0;
+};
+
+struct DatasetExportResult
+{
+  // Paths of the shards, "<prefix>-000000.tar" or ".tfrecord" and so on.
+  std::vector<std::string> shard_paths;
+  uint64_t sample_count = 0;
+};
+
+/**
+ * Writes the synchronized messages of a bag as shards of a fixed number of samples for training
+ * pipelines, in the WebDataset or TFRecord format.
+ *
+ * The time range of the bag is split into partitions, which a ParallelReader reads on several
+ * threads at once. Every partition is read with a margin of twice the slop before and after its
+ * range, synchronized by a SynchronizingReader, and keeps the samples whose message of the first
+ * topic was received within its range. The samples are written to the shards of the partition as
+ * they are read, so the memory held per thread is the queues of the synchronization and a single
+ * sample.
+ *
+ * Samples are in time order within a shard. The samples of a partition which do not fill a shard
+ * are gathered into the last shards once every partition is written, so every shard but the last
+ * one has the same number of samples.
+ */
+class ROSBAG2_CPP_PUBLIC DatasetExporter
+{
+public:
+  /**
+   * \param reader_factory creates the readers of the partitions, a SequentialReader if empty.
+   *   Bags written with compression need a SequentialCompressionReader.
+   * \throws std::invalid_argument if there are no topics, the synchronization options are
+   *   invalid or there are 0 samples per shard.
+   */
+  explicit DatasetExporter(
+    DatasetExportOptions options, readers::ParallelReader::ReaderFactory reader_factory = nullptr);
+
+  /**
+   * Writes the samples of the bag, within the time range of the storage filter if it sets one,
+   * to shards named "<prefix>-<shard index>" in the directory, which is created if needed.
+   *
+   * \throws std::runtime_error if a topic is not in the bag, a shard cannot be written, or a
+   *   sample of the WebDataset format has a file name longer than the 100 characters of a tar
+   *   header. Shards written before the error are left in the directory.
+   */
+  DatasetExportResult export_shards(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options,
+    const std::string & directory, const std::string & prefix = "shard",
+    const rosbag2_storage::StorageFilter & storage_filter = {}) const;
+
+private:
+  DatasetExportOptions options_;
+  readers::ParallelReader::ReaderFactory reader_factory_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__DATASET_EXPORTER_HPP_
@@ -0,0 +1,80 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__DISTRIBUTED_BAG_FINALIZER_HPP_
+#define ROSBAG2_CPP__DISTRIBUTED_BAG_FINALIZER_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/metadata_io.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Merges the bags recorded at the same time by the recorders of several hosts into a single bag.
+ *
+ * Every host records its local topics to a bag of its own, with the bag id shared by all hosts
+ * and the offset of its clock to the reference clock of the hosts, see StorageOptions.
+ * Once recorded, the bags are gathered as folders of one directory, e.g. by recording to a network
+ * share or by copying them. The metadata written to that directory lists the files of all hosts,
+ * each host as a stripe of its own, so the bag is read as one with a MergingReader.
+ */
+class ROSBAG2_CPP_PUBLIC DistributedBagFinalizer
+{
+public:
+  explicit DistributedBagFinalizer(
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>());
+
+  /**
+   * Writes the metadata of the bag of all hosts.
+   *
+   * The files, topics and time ranges of the bags of the hosts are merged. The time stamps of the
+   * messages were already moved to the reference clock when they were recorded.
+   *
+   * \param uri Directory of the bag of all hosts.
+   * \param host_folders Folders of the bags of the hosts, relative to the directory.
+   * \return The metadata written.
+   * \throws std::invalid_argument if no host folder is given.
+   * \throws std::runtime_error if the bag of a host has no metadata, was recorded without a bag
+   * id or with another one than the other hosts, with another storage, or is compressed.
+   */
+  rosbag2_storage::BagMetadata finalize(
+    const std::string & uri, const std::vector<std::string> & host_folders);
+
+private:
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__DISTRIBUTED_BAG_FINALIZER_HPP_
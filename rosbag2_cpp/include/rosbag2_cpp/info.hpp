@@ -15,7 +15,11 @@
 #ifndef ROSBAG2_CPP__INFO_HPP_
 #define ROSBAG2_CPP__INFO_HPP_
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "rosbag2_cpp/visibility_control.hpp"
 
@@ -24,6 +28,23 @@
 namespace rosbag2_cpp
 {
 
+/// Messages and bytes of the topics of a bag per time bucket, on a grid shared by all topics.
+struct Timeline
+{
+  struct Topic
+  {
+    std::string name;
+    std::vector<uint64_t> message_counts;
+    std::vector<uint64_t> sizes;
+  };
+
+  std::chrono::time_point<std::chrono::high_resolution_clock> starting_time;
+  /// Zero if no topic of the bag has a histogram, e.g. because it was recorded by an older
+  /// version.
+  std::chrono::nanoseconds bucket_duration{0};
+  std::vector<Topic> topics;
+};
+
 class ROSBAG2_CPP_PUBLIC Info
 {
 public:
@@ -31,6 +52,28 @@ public:
 
   virtual rosbag2_storage::BagMetadata read_metadata(
     const std::string & uri, const std::string & storage_id);
+
+  /**
+   * Adds the sizes of the messages of every topic to metadata read by read_metadata(), if it has
+   * none, e.g. because the bag was recorded by an older version. The bagfiles are scanned by
+   * their storage plugins in parallel.
+   *
+   * Bags compressed per file or chunk are not scanned, and those compressed per message get only
+   * their compressed sizes. Topics stay without sizes if the storage plugin does not support it.
+   * \param uri Bag directory, or bagfile if the bag has no metadata file.
+   * \throws std::runtime_error if a bagfile cannot be opened.
+   */
+  virtual void read_topic_sizes(const std::string & uri, rosbag2_storage::BagMetadata & metadata);
+
+  /**
+   * Aligns the histograms of the topics recorded in the metadata to a common grid, so tools can
+   * draw an overview of a bag without reading its messages.
+   *
+   * \param metadata Metadata returned by read_metadata().
+   * \param max_buckets Buckets of the timeline at most, its bucket duration is doubled until
+   * it covers the bag with them. Zero keeps the bucket duration of the histograms.
+   */
+  Timeline get_timeline(const rosbag2_storage::BagMetadata & metadata, size_t max_buckets) const;
 };
 
 }  // namespace rosbag2_cpp
@@ -0,0 +1,136 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__MEMORY_BUDGET_HPP_
+#define ROSBAG2_CPP__MEMORY_BUDGET_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+struct MemoryStageUsage
+{
+  uint64_t bytes = 0;
+  uint64_t peak_bytes = 0;
+};
+
+struct MemoryUsage
+{
+  // 0 if the budget is unlimited.
+  uint64_t max_bytes = 0;
+  uint64_t bytes = 0;
+  uint64_t peak_bytes = 0;
+  // Usage of every stage by name, e.g. "writer cache", summed over the accounts of the stage.
+  std::map<std::string, MemoryStageUsage> stages;
+};
+
+/**
+ * Bytes of message data held in memory by the buffering stages of rosbag2, e.g. the cache of the
+ * writer, the chunk collected for compression and the queue of the player, against a budget
+ * shared by all of them.
+ *
+ * The budget does not allocate memory itself. Every stage books the bytes it holds on an account
+ * of its own, and applies back-pressure while the budget is exhausted as it does when it reaches
+ * its own limits: the writer writes its cache, the compression writer compresses its chunk and the
+ * player stops reading ahead. A stage holding nothing may always take one more message, so the
+ * budget can be exceeded by one message per stage, but the stages never stall each other.
+ */
+class ROSBAG2_CPP_PUBLIC MemoryBudget
+{
+public:
+  /// Bytes booked by one buffering stage, released when the account is destroyed.
+  class ROSBAG2_CPP_PUBLIC Account
+  {
+public:
+    ~Account();
+
+    Account(const Account &) = delete;
+    Account & operator=(const Account &) = delete;
+
+    void allocate(uint64_t bytes);
+    void release(uint64_t bytes);
+    /// Books the bytes the stage holds now, instead of the change.
+    void set_allocated(uint64_t bytes);
+    uint64_t get_allocated() const;
+
+    /// Whether the stages of the budget hold all of it, always false if it is unlimited.
+    bool is_budget_exhausted() const;
+
+    /// Bytes left of the budget, the maximum of uint64_t if it is unlimited.
+    uint64_t get_available_bytes() const;
+
+private:
+    friend class MemoryBudget;
+    Account(MemoryBudget & budget, std::string stage);
+
+    MemoryBudget & budget_;
+    const std::string stage_;
+    // Guarded by the mutex of the budget, since the stages allocate and release on several threads.
+    uint64_t allocated_ {0};
+  };
+
+  /// \param max_bytes the budget, 0 for an unlimited budget which only keeps the statistics.
+  explicit MemoryBudget(uint64_t max_bytes = 0);
+
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget & operator=(const MemoryBudget &) = delete;
+
+  /// Opens an account of the stage. The budget must outlive it.
+  std::unique_ptr<Account> open_account(const std::string & stage);
+
+  /// Changes the budget. Stages above it release memory as they continue.
+  void set_max_bytes(uint64_t max_bytes);
+  uint64_t get_max_bytes() const;
+
+  MemoryUsage get_usage() const;
+
+  /// The budget shared by the buffering stages of rosbag2, unlimited until set.
+  static MemoryBudget & get_shared();
+
+private:
+  void update_account(Account & account, const std::function<uint64_t(uint64_t)> & update);
+  bool is_exhausted() const;
+  uint64_t get_available_bytes() const;
+
+  mutable std::mutex mutex_;
+  uint64_t max_bytes_;
+  MemoryUsage usage_;
+  // A warning with the usage of the stages is logged at most every 5 seconds while exhausted.
+  std::chrono::steady_clock::time_point last_warning_time_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__MEMORY_BUDGET_HPP_
@@ -0,0 +1,110 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__MESSAGE_TRANSFORM_CHAIN_HPP_
+#define ROSBAG2_CPP__MESSAGE_TRANSFORM_CHAIN_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/transform_interfaces/message_transform.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+// A transform of a chain and its parameters, see transform_interfaces::MessageTransform.
+struct MessageTransformOptions
+{
+  // Name of a registered transform, or class name of a transform plugin.
+  std::string name;
+  std::string parameters;
+};
+
+/**
+ * Transforms in the order they are given in, each transforming the topics and messages the one
+ * before returned. An empty chain leaves topics and messages unchanged.
+ *
+ * The messages of the topics a transform dropped are dropped before they reach it, so they are
+ * neither played nor recorded.
+ */
+class ROSBAG2_CPP_PUBLIC MessageTransformChain
+{
+public:
+  using TransformCreator =
+    std::function<std::unique_ptr<transform_interfaces::MessageTransform>()>;
+
+  MessageTransformChain();
+
+  /**
+   * Creates and configures the transforms, registered ones before plugins of the same name.
+   *
+   * \throws std::runtime_error if a transform is neither registered nor a declared plugin.
+   * \throws std::invalid_argument if a transform rejects its parameters.
+   */
+  explicit MessageTransformChain(const std::vector<MessageTransformOptions> & transforms);
+
+  ~MessageTransformChain();
+  MessageTransformChain(MessageTransformChain &&);
+  MessageTransformChain & operator=(MessageTransformChain &&);
+
+  bool empty() const;
+
+  /**
+   * Changes a topic by every transform, and remembers the topic if a transform drops it.
+   *
+   * \return False if a transform dropped the topic.
+   */
+  bool transform_topic(rosbag2_storage::TopicMetadata & topic) const;
+
+  /// Transforms the messages, dropping those of the topics the transforms dropped.
+  void transform(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages) const;
+
+  /**
+   * Makes a transform available to all chains of the process by name, e.g. one linked into the
+   * application instead of loaded as a plugin. Registering a name again replaces its creator.
+   *
+   * \throws std::invalid_argument if the creator is empty.
+   */
+  static void register_transform(const std::string & name, TransformCreator creator);
+
+private:
+  struct DroppedTopics;
+
+  std::vector<std::unique_ptr<transform_interfaces::MessageTransform>> transforms_;
+  // Topics may be transformed while messages are, e.g. when the recorder discovers them.
+  std::unique_ptr<DroppedTopics> dropped_topics_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__MESSAGE_TRANSFORM_CHAIN_HPP_
@@ -16,6 +16,8 @@
 #ifndef ROSBAG2_CPP__READER_HPP_
 #define ROSBAG2_CPP__READER_HPP_
 
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,6 +28,7 @@
 
 #include "rosbag2_storage/bag_metadata.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/serialized_bag_message_view.hpp"
 #include "rosbag2_storage/storage_filter.hpp"
 #include "rosbag2_storage/topic_metadata.hpp"
 
@@ -89,6 +92,63 @@ public:
    */
   std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next();
 
+  /**
+   * Read the next messages from storage at once, which saves the per message overhead of
+   * has_next() and read_next() when processing many messages.
+   *
+   * Expected usage:
+   * while (!(messages = reader.read_next_batch(1000, 0)).empty()) {...}
+   *
+   * \param max_messages Maximum number of messages to read, 0 for no limit
+   * \param max_bytes Stop after the message which brings the serialized data read to this
+   *   size, 0 for no limit
+   * \return next messages in serialized form, none only if there are no more messages
+   * \throws runtime_error if the Reader is not open.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes);
+
+  /**
+   * Read the next messages like read_next_batch() without waiting for them, so reading overlaps
+   * with other work on the calling thread. A reader reading ahead fulfills the future from its
+   * reading thread and calls ready_callback then, which lets an event loop or coroutine resume
+   * the consumer instead of blocking on the future. Only one read can be pending.
+   *
+   * Expected usage:
+   * auto messages = reader.read_next_batch_async(1000, 0, [&] {loop.post(consume);});
+   *
+   * \param ready_callback Called once the future is ready, also when the read is cancelled
+   * \return future of the next messages, none only if there are no more messages
+   * \throws runtime_error if the Reader is not open or another read is pending.
+   */
+  std::future<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+  read_next_batch_async(
+    size_t max_messages, size_t max_bytes, const std::function<void()> & ready_callback = nullptr);
+
+  /**
+   * Cancel the pending read_next_batch_async(), whose future then throws std::future_error.
+   * Seeking and setting or resetting the filter cancel it as well.
+   *
+   * \return whether a read was pending
+   */
+  bool cancel_async_read();
+
+  /**
+   * Pass the remaining messages passing the filter to the callback, in reading order. The
+   * storage hands the messages over in batches of views into its buffers where it can, which
+   * saves taking ownership of every message when they are not kept. The filter stays set.
+   *
+   * Expected usage:
+   * reader.for_each([&](const auto & message) {size += message.serialized_data.size;}, filter);
+   *
+   * \param callback Called with every message, whose view is valid only during the call
+   * \param storage_filter Filter to apply to reading
+   * \throws runtime_error if the Reader is not open.
+   */
+  void for_each(
+    const std::function<void(const rosbag2_storage::SerializedBagMessageView &)> & callback,
+    const rosbag2_storage::StorageFilter & storage_filter = {});
+
   /**
     * Ask bagfile for its full metadata.
     *
@@ -118,6 +178,27 @@ public:
    */
   void reset_filter();
 
+  /**
+   * Continue reading with the first message at or after the given time.
+   * The filter set for reading still applies.
+   *
+   * \param timestamp Time to seek to, in nanoseconds since epoch
+   * \throws runtime_error if the Reader is not open or does not support seeking.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp);
+
+  /**
+   * Read the latest message before the given time of each of the topics which has one, e.g. the
+   * last values of latched topics when seeking. The filter and the position are not changed.
+   *
+   * \param topic_names Topics to read the latest message of
+   * \param timestamp Time before which the messages were recorded, in nanoseconds since epoch
+   * \return the messages read, in the order of the topics
+   * \throws runtime_error if the Reader is not open or does not support reading them.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_latest_messages(
+    const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp);
+
   reader_interfaces::BaseReaderInterface & get_implementation_handle() const
   {
     return *reader_impl_;
@@ -15,7 +15,12 @@
 #ifndef ROSBAG2_CPP__READER_INTERFACES__BASE_READER_INTERFACE_HPP_
 #define ROSBAG2_CPP__READER_INTERFACES__BASE_READER_INTERFACE_HPP_
 
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "rosbag2_cpp/converter_options.hpp"
@@ -24,6 +29,7 @@
 
 #include "rosbag2_storage/bag_metadata.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/serialized_bag_message_view.hpp"
 #include "rosbag2_storage/storage_filter.hpp"
 #include "rosbag2_storage/topic_metadata.hpp"
 
@@ -46,6 +52,84 @@ public:
 
   virtual std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() = 0;
 
+  /**
+   * Reads the next messages, up to max_messages messages, stopping after the message which
+   * brings the serialized data read to max_bytes. A limit of 0 disables it.
+   * \return the messages read, which are none only if there are no more messages.
+   */
+  virtual std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes)
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+    size_t bytes = 0;
+    while ((max_messages == 0 || messages.size() < max_messages) &&
+      (max_bytes == 0 || bytes < max_bytes) && has_next())
+    {
+      messages.push_back(read_next());
+      bytes += messages.back()->serialized_data ?
+        messages.back()->serialized_data->buffer_length : 0;
+    }
+    return messages;
+  }
+
+  /**
+   * Reads the next messages like read_next_batch() without waiting for them. The future is
+   * fulfilled with the messages, with none at the end of the bag, or with the error raised while
+   * reading, and ready_callback is called after it, if set. Readers which read ahead fulfill it
+   * from their reading thread as soon as messages are read, so the callback should only hand them
+   * over, e.g. resume a consumer waiting on an event loop, and must not seek, filter or reset the
+   * reader. By default the messages are read before returning.
+   * \throws std::runtime_error if another read is pending
+   */
+  virtual std::future<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+  read_next_batch_async(
+    size_t max_messages, size_t max_bytes, const std::function<void()> & ready_callback)
+  {
+    std::promise<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>> promise;
+    try {
+      promise.set_value(read_next_batch(max_messages, max_bytes));
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+    if (ready_callback) {
+      ready_callback();
+    }
+    return promise.get_future();
+  }
+
+  /**
+   * Cancels the pending read_next_batch_async(), whose future then throws std::future_error with
+   * std::future_errc::broken_promise, and calls its ready_callback.
+   * \return whether a read was pending
+   */
+  virtual bool cancel_async_read()
+  {
+    return false;
+  }
+
+  /**
+   * Passes the next messages to the callback as views, with the limits of read_next_batch().
+   * Readers which do not change the messages read pass the views of the storage through, by
+   * default the messages are read with read_next_batch().
+   * \return whether any message was passed, which is false only if there are no more messages.
+   */
+  virtual bool visit_next_batch(
+    const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+    size_t max_messages, size_t max_bytes)
+  {
+    const auto messages = read_next_batch(max_messages, max_bytes);
+    if (messages.empty()) {
+      return false;
+    }
+    std::vector<rosbag2_storage::SerializedBagMessageView> views;
+    views.reserve(messages.size());
+    for (const auto & message : messages) {
+      views.push_back(rosbag2_storage::make_message_view(*message));
+    }
+    callback(views);
+    return true;
+  }
+
   virtual const rosbag2_storage::BagMetadata & get_metadata() const = 0;
 
   virtual std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const = 0;
@@ -53,6 +137,25 @@ public:
   virtual void set_filter(const rosbag2_storage::StorageFilter & storage_filter) = 0;
 
   virtual void reset_filter() = 0;
+
+  virtual void seek(const rcutils_time_point_value_t & timestamp)
+  {
+    (void) timestamp;
+    throw std::runtime_error("This reader does not support seeking.");
+  }
+
+  /**
+   * Reads the latest message before the given time of each of the topics which has one, in the
+   * order of the topics, without changing the filter or the position of read_next().
+   */
+  virtual std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  read_latest_messages(
+    const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+  {
+    (void) topic_names;
+    (void) timestamp;
+    throw std::runtime_error("This reader does not support reading the latest messages.");
+  }
 };
 
 }  // namespace reader_interfaces
@@ -0,0 +1,87 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__DEDUPLICATED_MESSAGE_EXPANDER_HPP_
+#define ROSBAG2_CPP__READERS__DEDUPLICATED_MESSAGE_EXPANDER_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Gives the references written by writers::MessageDeduplicator, i.e. the messages without data
+ * of the deduplicated topics of a bag, the data of the previous message of their topic with data
+ * in the same file again.
+ *
+ * The data of the previous message of every topic read from a file is kept for this. If reading
+ * did not start at the beginning of the file, e.g. after seeking, the data a reference refers to
+ * is read from the file on its own, once per topic.
+ */
+class ROSBAG2_CPP_PUBLIC DeduplicatedMessageExpander
+{
+public:
+  /// Opens the file being read once more, to read data read before reading started.
+  using OpenFile =
+    std::function<std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>()>;
+
+  DeduplicatedMessageExpander(const rosbag2_storage::BagMetadata & metadata, OpenFile open_file);
+
+  /// Whether the bag has any deduplicated topics, else no message needs to be expanded.
+  bool has_deduplicated_topics() const;
+
+  /// Gives the message the data it refers to, if it is a reference.
+  void expand(rosbag2_storage::SerializedBagMessage & message);
+
+  /// Forgets the data read, to be called when reading another file or continuing elsewhere.
+  void reset();
+
+private:
+  std::shared_ptr<rcutils_uint8_array_t> read_referenced_data(
+    const rosbag2_storage::SerializedBagMessage & reference);
+
+  OpenFile open_file_;
+  // Data of the previous message of every deduplicated topic, null if none was read yet.
+  std::unordered_map<std::string, std::shared_ptr<rcutils_uint8_array_t>> previous_data_;
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__DEDUPLICATED_MESSAGE_EXPANDER_HPP_
@@ -0,0 +1,109 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__DELTA_MESSAGE_DECODER_HPP_
+#define ROSBAG2_CPP__READERS__DELTA_MESSAGE_DECODER_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Decodes the messages of the delta encoded topics of a bag, as written by
+ * writers::MessageDeltaEncoder, back to their data.
+ *
+ * The data of the previous message of every topic read is kept, and a delta is applied to it if
+ * it is the message the delta was encoded from. Otherwise, e.g. after seeking, the messages of
+ * the topic stored in the file being read up to that message are decoded on their own, which
+ * are few as keyframes are stored regularly.
+ */
+class ROSBAG2_CPP_PUBLIC DeltaMessageDecoder
+{
+public:
+  using Messages = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+  /// The messages of the topic stored in the file being read up to the given time stamp, in time
+  /// stamp order and decompressed, but not decoded.
+  using ReadStoredMessages =
+    std::function<Messages(const std::string & topic_name, rcutils_time_point_value_t end_time)>;
+
+  DeltaMessageDecoder(
+    const rosbag2_storage::BagMetadata & metadata, ReadStoredMessages read_stored_messages);
+
+  /// Whether the bag has any delta encoded topics, else no message needs to be decoded.
+  bool has_delta_encoded_topics() const;
+
+  /**
+   * Replaces the data of a message of a delta encoded topic by its decoded data.
+   *
+   * \throws std::runtime_error if the data is malformed or the message it was encoded from
+   *   cannot be found in the file.
+   */
+  void decode(rosbag2_storage::SerializedBagMessage & message);
+
+  /// Forgets the data read, to be called when reading another file.
+  void reset();
+
+  /// Reads the messages of the topic stored in the storage up to the given time stamp.
+  static Messages read_stored_messages(
+    rosbag2_storage::storage_interfaces::ReadOnlyInterface & storage,
+    const std::string & topic_name, rcutils_time_point_value_t end_time);
+
+private:
+  struct PreviousMessage
+  {
+    std::shared_ptr<rcutils_uint8_array_t> data;
+    rcutils_time_point_value_t time_stamp;
+  };
+
+  std::shared_ptr<rcutils_uint8_array_t> decode_data(
+    const rosbag2_storage::SerializedBagMessage & message, const PreviousMessage & previous) const;
+  PreviousMessage find_previous_message(
+    const std::string & topic_name, rcutils_time_point_value_t time_stamp) const;
+
+  ReadStoredMessages read_stored_messages_;
+  // Previous message by delta encoded topic, without data if none was decoded yet.
+  std::unordered_map<std::string, PreviousMessage> previous_messages_;
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__DELTA_MESSAGE_DECODER_HPP_
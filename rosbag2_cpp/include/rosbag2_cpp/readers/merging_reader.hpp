@@ -0,0 +1,124 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__MERGING_READER_HPP_
+#define ROSBAG2_CPP__READERS__MERGING_READER_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/readers/prefetching_reader.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Reads all files of a bag at once and returns their messages ordered by time stamp, for bags
+ * whose files overlap in time, e.g. when recorded by several processes.
+ *
+ * Every file is read ahead on a thread of its own by up to read_ahead_messages messages.
+ * Messages with the same time stamp are returned in the order of the files in the metadata.
+ * If the storage filter orders by publish time, the files are merged by publish time as well.
+ */
+class ROSBAG2_CPP_PUBLIC MergingReader : public SequentialReader
+{
+public:
+  MergingReader(
+    std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory =
+    std::make_unique<rosbag2_storage::StorageFactory>(),
+    std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory =
+    std::make_shared<SerializationFormatConverterFactory>(),
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>(),
+    size_t read_ahead_messages = 100);
+
+  virtual ~MergingReader();
+
+  void open(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options) override;
+
+  void reset() override;
+
+  bool has_next() override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes) override;
+
+  bool visit_next_batch(
+    const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+    size_t max_messages, size_t max_bytes) override;
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  void reset_filter() override;
+
+  /**
+   * Continues reading all files at the given time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+private:
+  struct NextMessage
+  {
+    std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+    // Receive or publish time stamp, depending on the order of the storage filter.
+    rcutils_time_point_value_t time_stamp;
+    size_t file_index;
+  };
+
+  static bool is_later_than(const NextMessage & lhs, const NextMessage & rhs);
+
+  void check_is_open(const std::string & action) const;
+  void fill_next_messages();
+  // Whether the file may hold messages of the topics of the storage filter.
+  bool is_file_selected(size_t file_index) const;
+  // Opens the file with the current storage filter and seek time.
+  void open_file_reader(size_t file_index);
+  void push_next_message(size_t file_index);
+
+  const size_t read_ahead_messages_;
+  StorageOptions storage_options_{};
+  ConverterOptions converter_options_{};
+  // Reader of every file, null until the file is first read.
+  std::vector<std::unique_ptr<PrefetchingReader>> file_readers_{};
+  // Min-heap on the time stamp of the next message of every file not read completely.
+  std::vector<NextMessage> next_messages_{};
+  bool next_messages_filled_{false};
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__MERGING_READER_HPP_
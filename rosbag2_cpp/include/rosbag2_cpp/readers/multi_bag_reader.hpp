@@ -0,0 +1,145 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__MULTI_BAG_READER_HPP_
+#define ROSBAG2_CPP__READERS__MULTI_BAG_READER_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/prefetching_reader.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Reads several bags as one and returns their messages ordered by time stamp, e.g. to play the
+ * bags recorded by the recorders of several subsystems during the same run together.
+ *
+ * Every bag is read by a reader of its own, which a PrefetchingReader reads ahead on a thread of
+ * its own by up to read_ahead_messages messages, and the next messages of the bags are merged
+ * through a min-heap. Messages with the same time stamp are returned in the order of the bags.
+ * If the storage filter orders by publish time, the bags are merged by publish time as well.
+ *
+ * The metadata is that of all bags: their files, with paths including the bag directory, their
+ * topics with the messages of all bags, and a time range spanning all of them.
+ */
+class ROSBAG2_CPP_PUBLIC MultiBagReader : public reader_interfaces::BaseReaderInterface
+{
+public:
+  using ReaderFactory = std::function<
+    std::unique_ptr<reader_interfaces::BaseReaderInterface>(const StorageOptions &)>;
+
+  /**
+   * \param reader_factory creates the reader of a bag, a SequentialReader if empty. Bags written
+   *   with compression need a SequentialCompressionReader.
+   */
+  explicit MultiBagReader(
+    ReaderFactory reader_factory = nullptr, size_t read_ahead_messages = 1000);
+
+  virtual ~MultiBagReader();
+
+  /**
+   * Reads a single bag.
+   */
+  void open(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options) override;
+
+  /**
+   * Opens every bag with its storage options, converting all of them to the same format.
+   * \throws std::invalid_argument if there is no bag.
+   * \throws std::runtime_error if a topic has different types in different bags.
+   */
+  void open(
+    const std::vector<StorageOptions> & storage_options,
+    const ConverterOptions & converter_options);
+
+  void reset() override;
+
+  bool has_next() override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override;
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override;
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  void reset_filter() override;
+
+  /**
+   * Continues reading all bags at the given time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * Reads the latest message of every topic from every bag, keeping the latest one of all bags.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override;
+
+private:
+  struct NextMessage
+  {
+    std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+    // Receive or publish time stamp, depending on the order of the storage filter.
+    rcutils_time_point_value_t time_stamp;
+    size_t bag_index;
+  };
+
+  static bool is_later_than(const NextMessage & lhs, const NextMessage & rhs);
+
+  void check_is_open(const std::string & action) const;
+  void fill_next_messages();
+  void push_next_message(size_t bag_index);
+  void merge_bag_metadata(const std::string & uri, const rosbag2_storage::BagMetadata & metadata);
+
+  ReaderFactory reader_factory_;
+  const size_t read_ahead_messages_;
+  std::vector<std::unique_ptr<PrefetchingReader>> bag_readers_{};
+  rosbag2_storage::BagMetadata metadata_{};
+  std::vector<rosbag2_storage::TopicMetadata> topics_{};
+  rosbag2_storage::StorageFilter storage_filter_{};
+  // Min-heap on the time stamp of the next message of every bag not read completely.
+  std::vector<NextMessage> next_messages_{};
+  bool next_messages_filled_{false};
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__MULTI_BAG_READER_HPP_
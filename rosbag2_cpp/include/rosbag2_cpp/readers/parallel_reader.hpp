@@ -0,0 +1,140 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__PARALLEL_READER_HPP_
+#define ROSBAG2_CPP__READERS__PARALLEL_READER_HPP_
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/converter_options.hpp"
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Reads partitions of a bag on several threads at once, for offline processing which scales
+ * with the number of cores.
+ *
+ * A partition is the storage filter a reader of its own is opened with, so every worker thread
+ * reads through storage connections of its own. partition_by_time() splits a bag into time
+ * ranges of the same length, partition_by_topic() into topics of about the same number of
+ * messages.
+ *
+ * Readers are opened and released one at a time, as loading storage and converter plugins is
+ * not thread-safe. Reading and processing the messages of the partitions runs concurrently.
+ */
+class ROSBAG2_CPP_PUBLIC ParallelReader
+{
+public:
+  using ReaderFactory = std::function<std::unique_ptr<reader_interfaces::BaseReaderInterface>()>;
+  // Reads the partition of the given index from a reader opened and filtered for it.
+  using ReadPartition =
+    std::function<void (size_t partition_index, reader_interfaces::BaseReaderInterface & reader)>;
+
+  /**
+   * \param reader_factory creates the reader of every partition, a SequentialReader if empty.
+   *   Bags written with compression need a SequentialCompressionReader.
+   * \param max_threads number of worker threads, the number of cores if 0.
+   */
+  explicit ParallelReader(ReaderFactory reader_factory = nullptr, size_t max_threads = 0);
+
+  /**
+   * Calls read_partition for every partition on up to max_threads threads at once.
+   * Partitions are handed to the threads in their order as the threads become free.
+   *
+   * \throws the first error raised while opening or reading a partition, after the partitions
+   *   being read have finished. Partitions not started by then are skipped.
+   */
+  void read(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options,
+    const std::vector<rosbag2_storage::StorageFilter> & partitions,
+    const ReadPartition & read_partition);
+
+  /**
+   * Like read(), but returns the result of read_partition for every partition, in the order of
+   * the partitions. The result has to be default constructible and must not be bool, as the
+   * elements of a std::vector<bool> cannot be written concurrently.
+   */
+  template<typename ReadPartitionT>
+  auto transform(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options,
+    const std::vector<rosbag2_storage::StorageFilter> & partitions,
+    ReadPartitionT read_partition)
+  -> std::vector<decltype(read_partition(
+      size_t{}, std::declval<reader_interfaces::BaseReaderInterface &>()))>
+  {
+    std::vector<decltype(read_partition(
+        size_t{}, std::declval<reader_interfaces::BaseReaderInterface &>()))>
+    results(partitions.size());
+    // Every partition writes its own element, so no synchronization is needed.
+    read(
+      storage_options, converter_options, partitions,
+      [&results, &read_partition](
+        size_t partition_index, reader_interfaces::BaseReaderInterface & reader) {
+        results[partition_index] = read_partition(partition_index, reader);
+      });
+    return results;
+  }
+
+  /**
+   * Splits the time range of the bag, or of the storage filter if it sets one, into up to count
+   * consecutive time ranges of the same length. Every partition keeps the topics and order of
+   * the storage filter, and its sampling, which restarts at the beginning of every partition.
+   */
+  static std::vector<rosbag2_storage::StorageFilter> partition_by_time(
+    const rosbag2_storage::BagMetadata & metadata, size_t count,
+    const rosbag2_storage::StorageFilter & storage_filter = {});
+
+  /**
+   * Distributes the topics selected by the storage filter over up to count partitions, so
+   * that every partition holds about the same number of messages. Every partition keeps the
+   * time ranges, order and sampling of the storage filter. There is no partition if no topic
+   * is selected.
+   */
+  static std::vector<rosbag2_storage::StorageFilter> partition_by_topic(
+    const rosbag2_storage::BagMetadata & metadata, size_t count,
+    const rosbag2_storage::StorageFilter & storage_filter = {});
+
+private:
+  ReaderFactory reader_factory_;
+  size_t max_threads_;
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__PARALLEL_READER_HPP_
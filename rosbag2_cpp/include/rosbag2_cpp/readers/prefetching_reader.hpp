@@ -0,0 +1,179 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__PREFETCHING_READER_HPP_
+#define ROSBAG2_CPP__READERS__PREFETCHING_READER_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Reads ahead of the consumer on a thread of its own, so that stepping through the storage,
+ * copying messages, converting them and opening split files overlap with processing the
+ * messages read before.
+ *
+ * Wraps another reader, e.g. a SequentialReader, and buffers up to max_messages messages and
+ * up to max_bytes bytes of serialized data. A message larger than max_bytes is still buffered
+ * on its own. A limit of 0 disables it, but at least one of them has to be set.
+ *
+ * Reading ahead starts with the first call to has_next() or read_next(), so a filter set
+ * right after opening applies to all messages.
+ */
+class ROSBAG2_CPP_PUBLIC PrefetchingReader
+  : public ::rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  /**
+   * \throws std::invalid_argument if neither max_messages nor max_bytes is set.
+   */
+  explicit PrefetchingReader(
+    std::unique_ptr<reader_interfaces::BaseReaderInterface> reader =
+    std::make_unique<SequentialReader>(),
+    size_t max_messages = 1000,
+    uint64_t max_bytes = 0);
+
+  virtual ~PrefetchingReader();
+
+  void open(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options) override;
+
+  void reset() override;
+
+  /**
+   * Waits for the next message to be read ahead unless the bag is read completely
+   * \throws any error raised by the wrapped reader while reading ahead
+   */
+  bool has_next() override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
+
+  /**
+   * Takes the messages read ahead at once. Waits for messages only if none were read ahead.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes) override;
+
+  /**
+   * Takes the messages read ahead at once, or registers the read to be fulfilled by the prefetch
+   * thread with the next message read ahead, at the end of the bag or with an error.
+   */
+  std::future<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+  read_next_batch_async(
+    size_t max_messages, size_t max_bytes, const std::function<void()> & ready_callback) override;
+
+  /**
+   * Seeking, setting or resetting the filter and resetting cancel the pending read as well.
+   */
+  bool cancel_async_read() override;
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override;
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override;
+
+  /**
+   * Discards the messages read ahead, so the filter should be set before reading.
+   */
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  /**
+   * Discards the messages read ahead, so the filter should be reset before reading.
+   */
+  void reset_filter() override;
+
+  /**
+   * Discards the messages read ahead and continues reading ahead at the given time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * Reads the latest messages with the wrapped reader, in between the messages read ahead.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override;
+
+private:
+  struct PendingRead
+  {
+    std::promise<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>> promise;
+    size_t max_messages;
+    size_t max_bytes;
+    std::function<void()> ready_callback;
+  };
+
+  void start_prefetching();
+  void stop_prefetching();
+  void prefetch();
+  bool is_buffer_full() const;
+  // Called with the buffer lock held.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> take_batch(
+    size_t max_messages, size_t max_bytes);
+  void fulfill(PendingRead & read);
+
+  std::unique_ptr<reader_interfaces::BaseReaderInterface> reader_;
+  // Serializes the access to the wrapped reader from the prefetch thread and the consumer.
+  mutable std::mutex reader_mutex_;
+  const size_t max_messages_;
+  const uint64_t max_bytes_;
+  bool is_open_ {false};
+
+  std::thread prefetch_thread_;
+  // Protects the members below.
+  std::mutex buffer_mutex_;
+  std::condition_variable buffer_not_full_;
+  std::condition_variable buffer_not_empty_;
+  std::deque<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> buffer_;
+  uint64_t buffer_size_bytes_ {0};
+  bool stop_requested_ {false};
+  bool reached_end_ {true};
+  std::exception_ptr prefetch_error_;
+  std::unique_ptr<PendingRead> pending_read_;
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__PREFETCHING_READER_HPP_
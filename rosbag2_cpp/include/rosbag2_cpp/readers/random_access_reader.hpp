@@ -0,0 +1,129 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__RANDOM_ACCESS_READER_HPP_
+#define ROSBAG2_CPP__READERS__RANDOM_ACCESS_READER_HPP_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rosbag2_cpp/readers/deduplicated_message_expander.hpp"
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+/**
+ * Reads the messages of a topic by their index, e.g. to step through a bag back and forth, next
+ * to reading it sequentially.
+ *
+ * The messages of a topic are counted from 0 in the order of the files in the metadata and in
+ * time stamp order within every file. Every file is opened once it is first read from, and its
+ * storage plugin has to support random access. Compressed bags are not supported.
+ */
+class ROSBAG2_CPP_PUBLIC RandomAccessReader : public SequentialReader
+{
+public:
+  RandomAccessReader(
+    std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory =
+    std::make_unique<rosbag2_storage::StorageFactory>(),
+    std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory =
+    std::make_shared<SerializationFormatConverterFactory>(),
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>());
+
+  virtual ~RandomAccessReader();
+
+  /**
+   * \throws std::runtime_error if the bag is compressed.
+   */
+  void open(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options) override;
+
+  void reset() override;
+
+  /// Number of messages of the topic in all files of the bag.
+  uint64_t get_topic_message_count(const std::string & topic_name);
+
+  /**
+   * Reads the message of the topic with the given index, without changing the position of
+   * read_next().
+   *
+   * \throws std::out_of_range if the topic has no message with the index.
+   */
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_topic_message(
+    const std::string & topic_name, uint64_t index);
+
+  /**
+   * Index of the first message of the topic with a time stamp at or after the given time, or
+   * the message count of the topic if there is none.
+   */
+  uint64_t find_topic_message(
+    const std::string & topic_name, const rcutils_time_point_value_t & timestamp);
+
+  /**
+   * Reads the message of the topic with the time stamp closest to the given time, the earlier
+   * one if two are as close, or null if the topic has no messages.
+   */
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_nearest_topic_message(
+    const std::string & topic_name, const rcutils_time_point_value_t & timestamp);
+
+private:
+  struct FileStorage
+  {
+    std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> storage;
+    // Only set for bags with deduplicated topics.
+    std::unique_ptr<DeduplicatedMessageExpander> deduplicated_message_expander;
+    // Only set for bags with delta encoded topics.
+    std::unique_ptr<DeltaMessageDecoder> delta_message_decoder;
+    // Topic and index of the message read last, which references read next may refer to.
+    std::string last_topic_name;
+    uint64_t last_index{0};
+  };
+
+  void check_is_open() const;
+  FileStorage & get_file_storage(size_t file_index);
+  // Index of the first message of the topic in every file, followed by the message count.
+  const std::vector<uint64_t> & get_first_indices(const std::string & topic_name);
+  // Whether the file has no messages after the given time, by the time range in the metadata.
+  bool ends_before(size_t file_index, rcutils_time_point_value_t timestamp) const;
+
+  StorageOptions storage_options_{};
+  // Storage of every file, null until the file is first read from.
+  std::vector<std::unique_ptr<FileStorage>> file_storages_{};
+  std::unordered_map<std::string, std::vector<uint64_t>> first_indices_{};
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__RANDOM_ACCESS_READER_HPP_
@@ -15,16 +15,20 @@
 #ifndef ROSBAG2_CPP__READERS__SEQUENTIAL_READER_HPP_
 #define ROSBAG2_CPP__READERS__SEQUENTIAL_READER_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "rosbag2_cpp/converter.hpp"
+#include "rosbag2_cpp/readers/deduplicated_message_expander.hpp"
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
 #include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
 #include "rosbag2_cpp/serialization_format_converter_factory.hpp"
 #include "rosbag2_cpp/serialization_format_converter_factory_interface.hpp"
 #include "rosbag2_cpp/visibility_control.hpp"
 
+#include "rosbag2_storage/message_pool.hpp"
 #include "rosbag2_storage/metadata_io.hpp"
 #include "rosbag2_storage/storage_factory.hpp"
 #include "rosbag2_storage/storage_factory_interface.hpp"
@@ -63,10 +67,25 @@ public:
 
   void reset() override;
 
+  /**
+   * When following a bag which is being recorded, waits until there is another message or the
+   * recording stopped.
+   */
   bool has_next() override;
 
   std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
 
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes) override;
+
+  /**
+   * Passes the views of the storage through if the messages are neither converted nor decoded,
+   * i.e. the bag has no deduplicated or delta encoded topics.
+   */
+  bool visit_next_batch(
+    const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+    size_t max_messages, size_t max_bytes) override;
+
   const rosbag2_storage::BagMetadata & get_metadata() const override;
 
   std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override;
@@ -75,6 +94,21 @@ public:
 
   void reset_filter() override;
 
+  /**
+   * Opens the file holding messages at the given time, according to the time ranges of the files
+   * in the metadata, and continues reading there. Files without a time range in the metadata,
+   * e.g. of bags recorded by older versions, are read from the first one.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * Reads the latest messages from the files starting before the given time, latest first, which
+   * list any of the topics in the metadata. Every file is opened on its own for this.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override;
+
   /**
    * Ask whether there is another database file to read from the list of relative
    * file paths.
@@ -104,40 +138,99 @@ protected:
   virtual void load_next_file();
 
   /**
-   * Checks if all topics in the bagfile have the same RMW serialization format.
-   * Currently a bag file can only be played if all topics have the same serialization format.
-   *
-   * \param topics Vector of TopicInformation with metadata.
-   * \throws runtime_error if any topic has a different serialization format from the rest.
-   */
-  virtual void check_topics_serialization_formats(
-    const std::vector<rosbag2_storage::TopicInformation> & topics);
+  * Open the storage of the file pointed to by the current file iterator and apply the filter
+  * and seek time set on the reader.
+  */
+  virtual void load_current_file();
 
   /**
+  * Prepare the current file for opening its storage. Does nothing by default.
+  */
+  virtual void preprocess_current_file() {}
 
-  * Checks if the serialization format of the converter factory is the same as that of the storage
-  * factory.
-  * If not, changes the serialization format of the converter factory to use the serialization
-  * format of the storage factory.
-  *
-  * \param converter_serialization_format
-  * \param storage_serialization_format
+  /**
+  * Whether the file of the given index may hold messages passing the filter and seek time,
+  * judged by the time range and topics of the file in the metadata. Files without them may hold
+  * any messages.
   */
-  virtual void check_converter_serialization_format(
-    const std::string & converter_serialization_format,
-    const std::string & storage_serialization_format);
+  bool is_file_selected(size_t file_index) const;
+
+  bool is_current_file_selected() const;
+
+  /**
+  * Create the decoder of the delta encoded topics listed in the metadata, if there are any.
+  */
+  void setup_delta_decoding();
+
+  /**
+  * Read the messages of the topic stored in the current file up to the given time stamp, as
+  * they are stored but decompressed, which the decoder of the delta encoded topics continues from
+  * after seeking or filtering.
+  */
+  virtual std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  read_stored_messages_of_current_file(
+    const std::string & topic_name, rcutils_time_point_value_t end_time);
+
+  /**
+  * Forget the messages read by the expander of references and the decoder of deltas, whose
+  * next messages do not follow them anymore.
+  */
+  void reset_message_decoding();
+
+  /**
+   * Sets up the converter for the topics which are not stored in the requested serialization
+   * format, if any. Topics may be stored in different formats, messages of topics stored in the
+   * requested format are passed through.
+   *
+   * \param output_serialization_format Format the messages are read in
+   * \param topics Topics of the bag with the formats they are stored in
+   * \throws runtime_error if there is no converter for one of the formats
+   */
+  virtual void setup_converter(
+    const std::string & output_serialization_format,
+    const std::vector<rosbag2_storage::TopicInformation> & topics);
 
   std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_{};
   std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> storage_{};
   std::unique_ptr<Converter> converter_{};
+  size_t conversion_threads_{0};
   std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_{};
   rosbag2_storage::BagMetadata metadata_{};
   std::vector<rosbag2_storage::TopicMetadata> topics_metadata_{};
   std::vector<std::string> file_paths_{};  // List of database files.
   std::vector<std::string>::iterator current_file_iterator_{};  // Index of file to read from
+  // Applied to every storage opened, so the filter and seek time also hold for split files.
+  rosbag2_storage::StorageFilter storage_filter_{};
+  rcutils_time_point_value_t seek_time_{0};
+  std::shared_ptr<rosbag2_storage::MessagePool> message_pool_{};
+  // Only set for bags with deduplicated topics.
+  std::unique_ptr<DeduplicatedMessageExpander> deduplicated_message_expander_{};
+  // Only set for bags with delta encoded topics.
+  std::unique_ptr<DeltaMessageDecoder> delta_message_decoder_{};
 
 private:
+  // Storages which cannot seek are given the seek time as start time of their filter instead.
+  void set_storage_filter();
+  void seek_storage();
+
+  // Moves on to the next file which may hold messages passing the filter, or to the last file.
+  void skip_unselected_files();
+
+  // Reads the metadata of the followed bag again, and returns whether it lists new files.
+  bool update_followed_metadata();
+
+  // Whether the recorder closed the followed bag, which is when it writes the YAML metadata.
+  bool is_followed_recording_finished() const;
+
+  // Reads the latest messages of the topics from the file, expanded and decoded but not converted.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_latest_messages_of_file(
+    size_t file_index, const std::vector<std::string> & topic_names,
+    rcutils_time_point_value_t timestamp);
+
   std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory_{};
+  // URI of the bag while following it, i.e. until its recording is finished and read.
+  std::string followed_uri_{};
+  std::chrono::milliseconds follow_poll_interval_{0};
 };
 
 }  // namespace readers
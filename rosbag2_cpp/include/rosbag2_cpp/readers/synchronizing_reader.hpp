@@ -0,0 +1,146 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__READERS__SYNCHRONIZING_READER_HPP_
+#define ROSBAG2_CPP__READERS__SYNCHRONIZING_READER_HPP_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_cpp/converter_options.hpp"
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+struct SynchronizationOptions
+{
+  // Topics of the tuples, in the order of the messages of a tuple. At least two.
+  std::vector<std::string> topics;
+  // Maximum difference, in nanoseconds, between the time stamps of the messages of a tuple and
+  // the time stamp of its reference message. 0 only synchronizes messages of the same time.
+  rcutils_duration_value_t slop = 0;
+  // Messages kept per topic while waiting for the messages of the other topics. The oldest
+  // message of a topic is discarded when another one arrives at a full queue.
+  size_t queue_size = 10;
+  // If set, messages are read and synchronized by their publish time stamps, which are close to
+  // the time the data was acquired, instead of the time they were received. Messages of bags
+  // without publish time stamps are synchronized by the time they were received.
+  bool by_publish_time = false;
+};
+
+/**
+ * Reads tuples of messages of several topics, one message per topic, whose time stamps are
+ * close to each other, e.g. camera images with the lidar scans and odometry of the same time.
+ *
+ * The messages of the topics are queued as they are read. Once every topic has a message queued,
+ * the reference message of the next tuple is the latest of the oldest queued messages of the
+ * topics. Messages too old to be within the slop of it are discarded. Every other topic
+ * contributes the queued message closest to the reference message, which is decided once the
+ * topic has a message queued at or after its time, or the bag is read completely. Messages
+ * queued before those of a tuple are discarded with it.
+ */
+class ROSBAG2_CPP_PUBLIC SynchronizingReader
+{
+public:
+  /**
+   * \param reader reads the messages of the topics, a SequentialReader by default. Bags written
+   *   with compression need a SequentialCompressionReader.
+   * \throws std::invalid_argument if there are fewer than two topics, a topic is listed twice,
+   *   the slop is negative or the queue size is 0.
+   */
+  explicit SynchronizingReader(
+    const SynchronizationOptions & synchronization_options,
+    std::unique_ptr<reader_interfaces::BaseReaderInterface> reader =
+    std::make_unique<SequentialReader>());
+
+  /**
+   * Synchronizes the messages of a reader which is open already and filtered for the topics,
+   * e.g. the reader of a partition of a ParallelReader. The reader has to outlive this one.
+   * \throws std::invalid_argument like the constructor above.
+   */
+  SynchronizingReader(
+    const SynchronizationOptions & synchronization_options,
+    reader_interfaces::BaseReaderInterface & opened_reader);
+
+  /**
+   * Opens the bag and filters it for the topics of the tuples.
+   */
+  void open(const StorageOptions & storage_options, const ConverterOptions & converter_options);
+
+  /**
+   * Reads messages until they complete the next tuple.
+   * \return false if the bag has no more tuples.
+   */
+  bool has_next();
+
+  /**
+   * \return the messages of the next tuple, in the order of the topics.
+   * \throws std::runtime_error if the bag has no more tuples.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next();
+
+  /**
+   * Discards the queued messages and continues with the tuples at or after the given time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp);
+
+  const rosbag2_storage::BagMetadata & get_metadata() const;
+
+private:
+  void clear();
+  void enqueue(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
+  // Forms the next tuple of the queued messages, if they are enough to decide it.
+  bool synchronize();
+  rcutils_time_point_value_t get_time(const rosbag2_storage::SerializedBagMessage & message) const;
+
+  std::unique_ptr<reader_interfaces::BaseReaderInterface> owned_reader_;
+  reader_interfaces::BaseReaderInterface * reader_;
+  const SynchronizationOptions options_;
+  std::unordered_map<std::string, size_t> topic_indices_;
+  // Queued messages per topic, in time order.
+  std::vector<std::deque<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>> queues_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> next_tuple_;
+  bool reached_end_ {false};
+};
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__READERS__SYNCHRONIZING_READER_HPP_
@@ -0,0 +1,108 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__REINDEXER_HPP_
+#define ROSBAG2_CPP__REINDEXER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_factory_interface.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Rebuilds the metadata of a bag from its bagfiles, e.g. of a recording which was killed before
+ * its metadata was written, or whose last metadata checkpoint is outdated.
+ *
+ * Every bagfile is summarized by its storage, and the files are summarized in parallel, so a bag
+ * of many split files is reindexed in about the time of its largest file.
+ */
+class ROSBAG2_CPP_PUBLIC Reindexer
+{
+public:
+  explicit Reindexer(
+    std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory =
+    std::make_unique<rosbag2_storage::StorageFactory>(),
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>());
+
+  /**
+   * Summarizes the bagfiles of the bag and writes its metadata.
+   *
+   * The bagfiles are the given ones, relative to the bag directory, and those of the existing
+   * metadata of the bag, if any, which still exist, e.g. the files of stripe directories.
+   * The stripes and QoS profiles of the existing metadata are kept.
+   *
+   * \param uri Bag directory.
+   * \param storage_id Storage of the bagfiles, or empty to take it from the existing metadata.
+   * \param relative_file_paths Bagfiles found in the bag directory, e.g. written after the last
+   * metadata checkpoint.
+   * \param max_threads Maximum number of files summarized at once, 0 for one per processor.
+   * \return The metadata written.
+   * \throws std::invalid_argument if the storage is not given and there is no existing metadata.
+   * \throws std::runtime_error if no bagfile exists, a bagfile cannot be opened, or the bag is
+   * compressed per file.
+   */
+  rosbag2_storage::BagMetadata reindex(
+    const std::string & uri, const std::string & storage_id,
+    const std::vector<std::string> & relative_file_paths = {}, size_t max_threads = 0);
+
+  /**
+   * Summarizes the bagfiles of the bag as reindex() does, without writing its metadata, e.g. to
+   * inspect a bag whose metadata file is missing.
+   * \throws std::invalid_argument, std::runtime_error as reindex().
+   */
+  rosbag2_storage::BagMetadata summarize(
+    const std::string & uri, const std::string & storage_id,
+    const std::vector<std::string> & relative_file_paths = {}, size_t max_threads = 0);
+
+  /**
+   * Finds the bagfiles of a bag, relative to its directory.
+   *
+   * Bagfiles are named after the folder they are in, followed by their index, e.g. `bag_0.db3`
+   * in the bag directory or `camera/camera_0.db3` in the folder of a topic group, and those of
+   * shards by their shard as well, e.g. `bag_shard1_0.db3`. The files of every folder are
+   * ordered by their shard and index.
+   */
+  static std::vector<std::string> find_bagfiles(const std::string & uri);
+
+private:
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_;
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__REINDEXER_HPP_
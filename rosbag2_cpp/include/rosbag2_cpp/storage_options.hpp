@@ -15,11 +15,59 @@
 #ifndef ROSBAG2_CPP__STORAGE_OPTIONS_HPP_
 #define ROSBAG2_CPP__STORAGE_OPTIONS_HPP_
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace rosbag2_cpp
 {
 
+// Determines what happens to incoming messages when the double buffered cache is full
+// while the previous cache is still being written to disk.
+enum class CacheOverflowPolicy : uint8_t
+{
+  // Block the caller of write() until the previous cache has been written.
+  BLOCK,
+  // Discard the oldest message in the cache to make room for the incoming one.
+  DROP_OLDEST,
+  // Discard the incoming message.
+  DROP_NEWEST
+};
+
+// Importance of the messages of a topic when the double buffered cache backs up.
+enum class TopicPriority : uint8_t
+{
+  // Thinned out first once the cache fills up, and discarded rather than blocking.
+  LOW,
+  NORMAL,
+  // Never discarded: writing blocks until the previous cache has been written instead.
+  HIGH
+};
+
+// Determines which stripe directory a message is written to.
+enum class StripingPolicy : uint8_t
+{
+  // Every message goes to the next directory in turn.
+  ROUND_ROBIN,
+  // All messages of a topic go to the same directory, the topics are spread over the
+  // directories in the order they are created.
+  TOPIC_AFFINITY
+};
+
+// Topics written to bagfiles of their own, in a folder of the bag directory named after the group.
+struct TopicGroup
+{
+  // Name of the folder, which must not contain path separators or "..".
+  std::string name;
+  // Topics whose names match this regular expression belong to the group. Empty matches none.
+  std::string topics_regex;
+  // Topics not matched by the regular expression of any group belong to the first group whose
+  // min_message_size is reached by the first message of the topic, e.g. to separate camera
+  // images from small messages. 0 does not select topics by message size.
+  uint64_t min_message_size = 0;
+};
+
 struct StorageOptions
 {
 public:
@@ -30,10 +78,231 @@ public:
   // A value of 0 indicates that bagfile splitting will not be used.
   uint64_t max_bagfile_size = 0;
 
+  // The maximum time span of messages in a bagfile, in seconds, before it is split.
+  // A value of 0 indicates that splitting by duration will not be used.
+  uint64_t max_bagfile_duration = 0;
+
+  // The maximum number of messages in a bagfile before it is split.
+  // A value of 0 indicates that splitting by message count will not be used.
+  uint64_t max_bagfile_messages = 0;
+
+  // If set and splitting is used, the next bagfile is opened and its topics are created in the
+  // background, so that a split does not stall writing. The unused file is removed on close.
+  bool precreate_next_bagfile = false;
+
+  // Rolling retention of a split bag, for continuous recording into a bounded window on disk.
+  // Once the bagfiles hold more than retention_max_bytes in total, or a closed bagfile ends more
+  // than retention_max_age seconds before the newest message, the oldest closed bagfiles are
+  // deleted and dropped from the metadata. Bagfiles still closing and the current one are kept.
+  // With stripe directories, shards or topic groups, each of their writers applies the limits to
+  // its own bagfiles. Needs splitting and cannot be combined with large message data files,
+  // 0 disables either limit.
+  uint64_t retention_max_bytes = 0;
+  uint64_t retention_max_age = 0;
+
+  // Absolute path of a directory on a fast device, e.g. a tmpfs or an NVMe drive, the bagfiles
+  // are written to in a folder named after the bag, so recording does not stall on a slow device.
+  // Every closed bagfile is moved to the bag directory on a background thread, copied at most
+  // migration_max_bytes_per_second fast if that is set and the directories are on different
+  // devices. The metadata lists the absolute path of a bagfile until it is moved.
+  // Cannot be combined with stripe directories or large message data files.
+  std::string staging_directory{};
+  uint64_t migration_max_bytes_per_second = 0;
+
   // The cache size indiciates how many messages can maximally be hold in cache
   // before these being written to disk.
   // Defaults to 0, and effectively disables the caching.
   uint64_t max_cache_size = 0;
+
+  // The maximum amount of serialized message data, in bytes, to hold in cache before
+  // writing to disk. The cache is written as soon as either limit is reached.
+  // Defaults to 0, which disables the byte budget.
+  uint64_t max_cache_size_bytes = 0;
+
+  // If set, a full cache is handed over to a dedicated I/O thread which writes it to disk,
+  // while a second cache keeps accepting messages in the meantime.
+  // Has no effect if both max_cache_size and max_cache_size_bytes are 0.
+  bool double_buffered_cache = false;
+
+  // Back-pressure policy applied when the double buffered cache is full and the
+  // I/O thread has not yet finished writing the previous cache.
+  CacheOverflowPolicy cache_overflow_policy = CacheOverflowPolicy::BLOCK;
+
+  // Priorities of topics by name, topics not listed are NORMAL. While the I/O thread is busy and
+  // the cache is filled to priority_threshold_percent of its message count or byte budget, only
+  // every low_priority_decimation-th message of a LOW topic is kept, 0 keeps none of them. A full
+  // cache then makes room by discarding cached messages of a lower priority than the incoming
+  // one, before cache_overflow_policy applies, which never discards HIGH messages. The messages
+  // discarded are counted per topic in the metadata.
+  // Has no effect without double_buffered_cache. Defaults to empty, which treats all topics alike.
+  std::unordered_map<std::string, TopicPriority> topic_priorities{};
+  uint64_t priority_threshold_percent = 50;
+  uint64_t low_priority_decimation = 0;
+
+  // Storage specific preset profile, e.g. "resilient" or "max_throughput" for sqlite3.
+  // Defaults to empty, which selects the storage's default settings.
+  std::string storage_preset_profile{};
+
+  // If set, the storage builds its indices only when a bagfile is closed. Previous bagfiles
+  // are then closed on a background thread when splitting, so indexing does not block writing.
+  bool defer_index_creation = false;
+
+  // If set, messages are additionally indexed by topic and time, which speeds up playing back
+  // a few topics out of many.
+  bool topic_timestamp_index = false;
+
+  // If set, the messages of every topic are stored together in time stamp order, so playing
+  // back a few topics out of many reads contiguous parts of the bagfile. Writing is slower.
+  bool cluster_messages_by_topic = false;
+
+  // If set, the storage keeps a checksum of every message, so corrupt messages are detected
+  // when they are read or the bag is verified. The binary_log storage always checksums its
+  // chunks.
+  bool checksums = false;
+
+  // Messages larger than this many bytes are written to a sequential data file next to the
+  // sqlite3 database instead of into it, which keeps the database small and fast to write.
+  // Defaults to 0, which stores all messages in the database.
+  uint64_t large_message_threshold = 0;
+
+  // Topics whose messages repeating the data of the previous message of the topic, e.g. maps or
+  // robot descriptions published again and again, are stored without their data. Readers restore
+  // the data transparently. Not supported when compressing bags.
+  std::vector<std::string> deduplicate_topics{};
+
+  // Topics whose messages change little from one to the next, e.g. occupancy grids or costmaps,
+  // which are stored as the bytes changed since the previous message of the topic, before any
+  // compression. Every delta_keyframe_interval-th message, and the first of every file, is
+  // stored in full, so readers seeking into the bag decode few messages. A topic cannot be both
+  // deduplicated and delta encoded.
+  std::vector<std::string> delta_encode_topics{};
+  uint64_t delta_keyframe_interval = 100;
+
+  // Single message writes are batched into a storage transaction which is committed after
+  // this many messages, bytes or milliseconds, whichever comes first.
+  // Defaults to 0 for each, which commits every message on its own.
+  uint64_t transaction_max_messages = 0;
+  uint64_t transaction_max_bytes = 0;
+  uint64_t transaction_max_duration_ms = 0;
+
+  // "host:port" of an ingest server the bagfiles are streamed to while recording instead of
+  // being written to the bag directory, which only keeps the metadata and the data spilled
+  // while the link is too slow. Only the binary_log storage supports it.
+  // Defaults to empty, which writes the bagfiles.
+  std::string stream_address{};
+  // Data not yet acknowledged by the ingest server kept in memory, the rest is spilled to disk.
+  uint64_t stream_max_memory_bytes = 64 * 1024 * 1024;
+
+  // If set, the disk space of every bagfile is reserved up to max_bagfile_size when it is
+  // created, so a bagfile written at high rates is not fragmented. The space not used is
+  // released when the bagfile is closed. Requires max_bagfile_size.
+  // Defaults to false, which lets the file system allocate the space as the bagfile grows.
+  bool preallocate_bagfiles = false;
+
+  // If set, the data written to a bagfile is handed to the kernel to write back every this many
+  // bytes, which spreads writing to disk evenly instead of stalling the writes when the kernel
+  // flushes many dirty pages at once, e.g. on a commit or a split.
+  // Defaults to 0, which leaves writing back to the kernel.
+  uint64_t writeback_interval_bytes = 0;
+
+  // Size of the chunks of memory the memory storage copies the messages into, and the memory all
+  // bags of the memory storage may use together, after which writing fails. Only the memory
+  // storage uses them.
+  // Defaults to chunks of 1 MiB and 0, which keeps the limit of the memory bag store.
+  uint64_t memory_chunk_size = 1024 * 1024;
+  uint64_t memory_max_bytes = 0;
+
+  // When reading, the number of released messages, and as many data buffers, kept to be reused
+  // for the next messages read, if the storage supports it.
+  // Defaults to 0, which allocates every message read.
+  uint64_t message_pool_size = 0;
+
+  // If set, the bag is read while it is still being recorded: once all messages written so far
+  // are read, has_next() waits for more, checking the last file and the metadata for new messages
+  // and split files every this many milliseconds, until the recorder closes the bag. Requires the
+  // metadata checkpoints of the recorder, see metadata_checkpoint_interval_ms. Messages are read
+  // in the order they were written. Not supported for compressed bags.
+  // Defaults to 0, which reads the messages the bag holds when it is opened.
+  uint64_t follow_poll_interval_ms = 0;
+
+  // When reading a bag compressed in FILE mode, the existing directory its files are
+  // decompressed to, e.g. a tmpfs directory to keep them in memory, or a scratch directory
+  // if the bag is on a read-only file system. The decompressed files are removed once read.
+  // Defaults to empty, which decompresses the files next to their compressed files.
+  std::string decompression_directory{};
+
+  // When reading a bag compressed in MESSAGE or CHUNK mode, the number of threads decompressing
+  // the messages of a batch read, or the next chunks, in addition to the reading thread.
+  // Defaults to 0, which decompresses on the reading thread only.
+  uint64_t decompression_threads = 0;
+
+  // When reading an encrypted bag, the file holding the master key the key of the bag was
+  // encrypted with, see rosbag2_compression::CompressionOptions::encryption_key_file.
+  std::string encryption_key_file{};
+
+  // If set, messages are not written as they arrive but kept in memory, and only the messages kept
+  // are written to the bag when a snapshot is taken. The oldest messages are discarded once the
+  // kept messages hold more than snapshot_max_bytes of serialized data or span more than
+  // snapshot_duration seconds. At least one of the limits must be set, 0 disables either one.
+  bool snapshot_mode = false;
+  uint64_t snapshot_max_bytes = 0;
+  uint64_t snapshot_duration = 0;
+
+  // Absolute paths of existing directories, e.g. on further drives, which the messages are
+  // spread over in addition to the bag directory. Every directory gets a folder named after the
+  // bag, with bagfiles of its own which are split independently and written at the same time,
+  // each by its own I/O thread with double_buffered_cache. The metadata of the bag lists the
+  // files of all directories. Their time ranges overlap, so they are read with a MergingReader.
+  // Defaults to empty, which writes all bagfiles to the bag directory.
+  std::vector<std::string> stripe_directories{};
+  StripingPolicy striping_policy = StripingPolicy::ROUND_ROBIN;
+
+  // Number of further writers of the bag directory the topics are spread over, topic by topic
+  // in the order they are created, so a storage writing one database at a time, like SQLite,
+  // uses a core per shard. Every shard writes bagfiles of its own into the bag directory, named
+  // `<bag>_shard<n>_<index>`, which are split independently. The writers double buffer their
+  // caches, so every shard is written by its own I/O thread if a cache size is set. The metadata
+  // lists the files of every shard as a stripe of its own, so they are read with a MergingReader.
+  // Cannot be combined with stripe_directories or topic_groups.
+  // Defaults to 0, which writes all topics to the same bagfiles.
+  uint64_t shards = 0;
+
+  // Groups of topics written to bagfiles of their own, each split independently. Topics of no
+  // group are written to the bagfiles of the bag directory. The metadata of the bag lists the
+  // topics of every file, so reading a few topics opens only the files holding them.
+  // Cannot be combined with stripe_directories.
+  // Defaults to empty, which writes all topics to the same bagfiles.
+  std::vector<TopicGroup> topic_groups{};
+
+  // If set, the metadata of the bag is written every this many milliseconds, checked whenever a
+  // message is written, and on every split, so a recording which is killed keeps a metadata file
+  // with the message counts of all its files up to the last checkpoint instead of none at all.
+  // Defaults to 0, which writes the metadata only when the writer is closed.
+  uint64_t metadata_checkpoint_interval_ms = 0;
+
+  // If set, messages are held back until they are this many milliseconds older than the latest
+  // message written, and written in time stamp order, which messages received on several threads
+  // are not quite in. Readers then read the bagfiles in the order they are stored, without
+  // sorting. Messages arriving later than that are written as they arrive.
+  // Defaults to 0, which writes messages in the order they arrive.
+  uint64_t reorder_window_ms = 0;
+
+  // If set, a warning is logged when writing to the storage takes longer than this many
+  // milliseconds, or when messages back up because the double buffered cache is full, naming the
+  // topics contributing the most bytes. The warnings are limited to one every 5 seconds.
+  // Defaults to 0, which does not monitor the writes.
+  uint64_t write_latency_budget_ms = 0;
+
+  // Identity of the bag shared by the recorders of several hosts recording at the same time,
+  // stored in the metadata, so that their bags can be merged into a single one once recorded.
+  // Defaults to empty, for bags recorded on their own.
+  std::string bag_id{};
+
+  // Nanoseconds to add to this host's clock to get the reference clock of the hosts, e.g. as
+  // estimated by chrony or PTP. It is added to the receive and publish time stamps of the
+  // messages written, so that the bags of all hosts share one timeline. Stored in the metadata.
+  // Defaults to 0, which keeps the time stamps as they are.
+  int64_t clock_offset_ns = 0;
 };
 
 }  // namespace rosbag2_cpp
@@ -0,0 +1,108 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__TEXT_EXPORTER_HPP_
+#define ROSBAG2_CPP__TEXT_EXPORTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_factory_interface.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+enum class TextFormat
+{
+  // A JSON object per line, {"time_stamp":<nanoseconds>,"message":{<fields>}}.
+  NDJSON,
+  // A header line, then a line per message of its time stamp in nanoseconds and its fields.
+  CSV,
+};
+
+/// A topic written by the TextExporter.
+struct ExportedTopic
+{
+  std::string topic_name;
+  std::string file_path;
+  uint64_t message_count = 0;
+};
+
+/**
+ * Writes the messages of a bag as text, a file per topic, e.g. to load them into tools which
+ * cannot read CDR.
+ *
+ * The messages are formatted by a CdrMessageFormatter per topic without deserializing them.
+ * Every bagfile is read and formatted on a thread of its own into parts of the topic files,
+ * which are joined in the order of the bagfiles afterwards, so a bag of many split files is
+ * exported in about the time of its largest file.
+ */
+class ROSBAG2_CPP_PUBLIC TextExporter
+{
+public:
+  explicit TextExporter(
+    std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory =
+    std::make_unique<rosbag2_storage::StorageFactory>(),
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>());
+
+  /**
+   * Writes the messages of the topics to a file per topic in the directory.
+   *
+   * A file is named after its topic, with the slashes within the name replaced by double
+   * underscores and the extension of the format, e.g. "camera__info.ndjson" for
+   * "/camera/info". Its messages are in the order of the bagfiles, in which they are ordered
+   * by their time stamp.
+   *
+   * \param uri Bag directory.
+   * \param directory Directory of the files, which is created if it does not exist.
+   * \param format Format of the files.
+   * \param topic_names Topics to export, all CDR serialized topics if empty.
+   * \param max_threads Maximum number of bagfiles read at once, 0 for one per processor.
+   * \return The exported topics, in the order of the metadata.
+   * \throws std::runtime_error if the bag has no metadata or is compressed, a topic is not in
+   * the bag or not serialized as CDR, its type support cannot be found, or a message cannot be
+   * read or formatted.
+   */
+  std::vector<ExportedTopic> export_bag(
+    const std::string & uri, const std::string & directory, TextFormat format,
+    const std::vector<std::string> & topic_names = {}, size_t max_threads = 0);
+
+private:
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_;
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__TEXT_EXPORTER_HPP_
@@ -0,0 +1,178 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__THREAD_POOL_HPP_
+#define ROSBAG2_CPP__THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+struct ThreadPoolOptions
+{
+  // Number of threads of the pool.
+  // Defaults to 0, which uses as many as the processor has hardware threads.
+  size_t size = 0;
+
+  // CPUs the threads of the pool, and all other background threads of rosbag2, are pinned to,
+  // e.g. to keep them away from the cores of real-time threads. Only supported on Linux.
+  // Defaults to empty, which lets them run on any CPU.
+  std::vector<size_t> cpu_affinity;
+
+  // Nice value of the threads, from -20 to 19, higher values giving them a lower priority than
+  // the other threads of the process. Only supported on Linux.
+  // Defaults to 0, the priority of other threads.
+  int nice = 0;
+
+  bool operator==(const ThreadPoolOptions & other) const
+  {
+    return size == other.size && cpu_affinity == other.cpu_affinity && nice == other.nice;
+  }
+};
+
+/// The threads rosbag2 starts, by what they do, so each kind can be scheduled on its own.
+enum class ThreadRole
+{
+  // Threads of the shared pool and other background work, configured by the ThreadPoolOptions.
+  BACKGROUND,
+  // Threads of the recorder receiving the messages.
+  RECORDER,
+  // Threads writing messages to storage, i.e. the cache thread of a writer and the thread of the
+  // recorder writing the messages it received.
+  WRITER,
+  // Threads compressing messages or bagfiles.
+  COMPRESSION,
+  // Threads of the player publishing the messages.
+  PLAYER,
+};
+
+struct ThreadScheduling
+{
+  // CPUs the threads are pinned to. Only supported on Linux.
+  // Defaults to empty, which lets them run on any CPU.
+  std::vector<size_t> cpu_affinity;
+
+  // Nice value of the threads, from -20 to 19. Only supported on Linux.
+  // Defaults to 0, the priority of other threads.
+  int nice = 0;
+
+  // Priority of the threads from 1 to 99 under the real-time SCHED_FIFO policy, which preempts
+  // all threads of the normal policy. Usually needs privileges. Only supported on Linux.
+  // Defaults to 0, which keeps the normal policy.
+  int realtime_priority = 0;
+};
+
+/**
+ * Runs tasks on a fixed number of threads, in the order they are submitted.
+ *
+ * rosbag2 submits its short background work to the pool shared by the process, e.g. opening the
+ * next bagfile or decompressing a file, instead of starting a thread per task. Work that runs as
+ * long as a reader or writer, e.g. writing the cache or compressing, has threads of its own,
+ * which are configured by their role, see configure_current_thread().
+ *
+ * Tasks must not wait for other tasks of the same pool, which may never start if all threads
+ * are waiting.
+ */
+class ROSBAG2_CPP_PUBLIC ThreadPool
+{
+public:
+  explicit ThreadPool(const ThreadPoolOptions & options = ThreadPoolOptions{});
+
+  /// Runs the tasks submitted before returning.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  /**
+   * Runs the function on a thread of the pool.
+   * \return the future of its result, or of the exception it throws. Unlike the futures of
+   * std::async, destroying it does not wait for the function.
+   */
+  template<typename Function>
+  std::future<decltype(std::declval<Function &>()())> submit(Function && function)
+  {
+    using Result = decltype(std::declval<Function &>()());
+    // std::function needs a copyable task.
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    auto future = task->get_future();
+    push([task]() {(*task)();});
+    return future;
+  }
+
+  size_t get_size() const;
+
+  /// The pool shared by the background work of rosbag2, started on first use.
+  static ThreadPool & get_shared();
+
+  /**
+   * Sets the options of the shared pool, and of all background threads rosbag2 starts from now on.
+   * \throws std::logic_error if the shared pool was started already with other options.
+   */
+  static void configure_shared(const ThreadPoolOptions & options);
+
+  /**
+   * Sets the scheduling of the threads of a role rosbag2 starts from now on. Roles which are not
+   * configured are scheduled like the threads of the shared pool.
+   * \throws std::invalid_argument for the background role, which is configured by
+   * configure_shared(), or for a nice value or real-time priority out of range.
+   */
+  static void configure_role(ThreadRole role, const ThreadScheduling & scheduling);
+
+  /**
+   * Pins the calling thread to the CPUs of its role and sets its nice value and real-time
+   * priority. Called first by every thread rosbag2 starts. Logs a warning if the platform does not
+   * support it.
+   */
+  static void configure_current_thread(ThreadRole role = ThreadRole::BACKGROUND);
+
+private:
+  void push(std::function<void()> task);
+  void run();
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::deque<std::function<void()>> tasks_;
+  bool is_stopping_ {false};
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__THREAD_POOL_HPP_
@@ -0,0 +1,83 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__TRANSFORM_INTERFACES__MESSAGE_TRANSFORM_HPP_
+#define ROSBAG2_CPP__TRANSFORM_INTERFACES__MESSAGE_TRANSFORM_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+namespace rosbag2_cpp
+{
+namespace transform_interfaces
+{
+
+/**
+ * Transforms the serialized messages played or recorded in the process of the player or
+ * recorder, e.g. to remap, filter or downsample topics without a relay node.
+ *
+ * Implemented by plugins of the base class rosbag2_cpp::transform_interfaces::MessageTransform,
+ * or registered with MessageTransformChain::register_transform. A transform is called by one
+ * thread at a time.
+ */
+class MessageTransform
+{
+public:
+  virtual ~MessageTransform() = default;
+
+  /**
+   * Called once before any topic or message is transformed.
+   *
+   * \param parameters Parameters of the transform as given by the user, e.g. YAML.
+   * \throws std::invalid_argument if the parameters are not valid.
+   */
+  virtual void configure(const std::string & parameters)
+  {
+    (void) parameters;
+  }
+
+  /**
+   * Changes a topic to the name, type or QoS profiles its messages are published or recorded
+   * with. May be called several times for the same topic.
+   *
+   * \param topic The topic as recorded, or as changed by the transforms before.
+   * \return False to drop the topic, whose messages are dropped as well.
+   */
+  virtual bool transform_topic(rosbag2_storage::TopicMetadata & topic)
+  {
+    (void) topic;
+    return true;
+  }
+
+  /**
+   * Transforms a batch of messages in the order they are played or were received in.
+   *
+   * Messages may be removed, added, reordered or replaced, and their topic names changed to the
+   * names transform_topic gives their topics. Serialized data must not be changed in place, as it
+   * may be shared, e.g. with the loop cache of the player, but may be replaced.
+   *
+   * \param messages The batch, which is played or recorded once transformed.
+   */
+  virtual void transform(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages) = 0;
+};
+
+}  // namespace transform_interfaces
+}  // namespace rosbag2_cpp
+
+#endif  // ROSBAG2_CPP__TRANSFORM_INTERFACES__MESSAGE_TRANSFORM_HPP_
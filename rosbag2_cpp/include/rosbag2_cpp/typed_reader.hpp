@@ -0,0 +1,136 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__TYPED_READER_HPP_
+#define ROSBAG2_CPP__TYPED_READER_HPP_
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "rcutils/error_handling.h"
+#include "rcutils/time.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rmw/rmw.h"
+
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Reads the messages of a topic of a type known at compile time from a Reader into a message
+ * object of the caller, which is reused for every message, so its strings and sequences keep
+ * their memory. The messages are deserialized with the type support the message type is compiled
+ * against, without looking up the type or introspecting it per message.
+ *
+ * The Reader must be open with the serialization format of the rmw implementation as output
+ * format, and outlive the TypedReader.
+ *
+ * Expected usage:
+ * TypedReader<sensor_msgs::msg::Imu> imu_reader(reader, "/imu");
+ * sensor_msgs::msg::Imu imu;
+ * while (imu_reader.read_next(imu)) {...}
+ */
+template<typename MessageT>
+class TypedReader
+{
+public:
+  /**
+   * Sets the filter of the reader to the topic.
+   *
+   * \param reader Open reader to read the messages from
+   * \param topic_name Topic of the messages to read
+   * \throws std::runtime_error if the bag has no such topic or its messages have another type.
+   */
+  TypedReader(Reader & reader, const std::string & topic_name)
+  : reader_(reader)
+  {
+    std::string type;
+    for (const auto & topic : reader_.get_all_topics_and_types()) {
+      if (topic.name == topic_name) {
+        type = topic.type;
+      }
+    }
+    if (type.empty()) {
+      throw std::runtime_error("The bag has no topic '" + topic_name + "'.");
+    }
+    // Types are stored with or without the msg module, e.g. std_msgs/String.
+    const auto stored_type = extract_type_identifier(type);
+    const auto expected_type = extract_type_identifier(get_type_name<MessageT>());
+    if (std::get<0>(stored_type) != std::get<0>(expected_type) ||
+      std::get<2>(stored_type) != std::get<2>(expected_type))
+    {
+      throw std::runtime_error(
+              "Topic '" + topic_name + "' has type '" + type + "' instead of '" +
+              get_type_name<MessageT>() + "'.");
+    }
+
+    rosbag2_storage::StorageFilter storage_filter;
+    storage_filter.topics = {topic_name};
+    reader_.set_filter(storage_filter);
+  }
+
+  /**
+   * Deserializes the next message of the topic into the message.
+   *
+   * \param message Message to overwrite, reusing the memory it holds
+   * \return false, leaving the message unchanged, if there are no more messages
+   * \throws std::runtime_error if the message cannot be deserialized.
+   */
+  bool read_next(MessageT & message)
+  {
+    if (!reader_.has_next()) {
+      return false;
+    }
+    const auto bag_message = reader_.read_next();
+    deserialize(*bag_message->serialized_data, message);
+    time_stamp_ = bag_message->time_stamp;
+    return true;
+  }
+
+  /// Time stamp of the message read last, 0 if none was read yet.
+  rcutils_time_point_value_t get_time_stamp() const
+  {
+    return time_stamp_;
+  }
+
+  /**
+   * Deserializes a message of the type, e.g. read by a Reader reading several topics.
+   * \throws std::runtime_error if the message cannot be deserialized.
+   */
+  static void deserialize(const rcutils_uint8_array_t & serialized_data, MessageT & message)
+  {
+    const auto type_support = rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>();
+    if (rmw_deserialize(&serialized_data, type_support, &message) != RMW_RET_OK) {
+      const std::string error = rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error("Failed to deserialize message: " + error);
+    }
+  }
+
+private:
+  Reader & reader_;
+  rcutils_time_point_value_t time_stamp_ {0};
+};
+
+}  // namespace rosbag2_cpp
+
+#endif  // ROSBAG2_CPP__TYPED_READER_HPP_
@@ -0,0 +1,115 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__TYPED_WRITER_HPP_
+#define ROSBAG2_CPP__TYPED_WRITER_HPP_
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "rcutils/error_handling.h"
+#include "rcutils/time.h"
+
+#include "rmw/rmw.h"
+
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+#include "rosbag2_cpp/writer.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+namespace rosbag2_cpp
+{
+
+/**
+ * Writes messages of a type known at compile time to a topic of a Writer. The messages are
+ * serialized with the type support the message type is compiled against, without looking up the
+ * type or introspecting it per message, into a buffer which is reused once the writer released
+ * the message written before, e.g. right away unless it is cached.
+ *
+ * The Writer must be open with the serialization format of the rmw implementation as input
+ * format, and outlive the TypedWriter.
+ */
+template<typename MessageT>
+class TypedWriter
+{
+public:
+  /**
+   * Creates the topic in the writer.
+   *
+   * \param writer Open writer to write the messages to
+   * \param topic_name Topic to write the messages to
+   * \param offered_qos_profiles QoS profiles stored for the topic, see TopicMetadata
+   * \throws runtime_error if the Writer is not open.
+   */
+  TypedWriter(
+    Writer & writer, const std::string & topic_name,
+    const std::string & offered_qos_profiles = "")
+  : writer_(writer), topic_name_(topic_name)
+  {
+    rosbag2_storage::TopicMetadata topic;
+    topic.name = topic_name;
+    topic.type = get_type_name<MessageT>();
+    topic.serialization_format = rmw_get_serialization_format();
+    topic.offered_qos_profiles = offered_qos_profiles;
+    writer_.create_topic(topic);
+  }
+
+  /**
+   * Serializes the message and writes it to the topic.
+   *
+   * \param message Message to write
+   * \param time_stamp Time stamp of the message in the bag, in nanoseconds since epoch
+   * \throws std::runtime_error if the message cannot be serialized or the Writer is not open.
+   */
+  void write(const MessageT & message, rcutils_time_point_value_t time_stamp)
+  {
+    // The writer may still hold the message written before, e.g. in its cache.
+    if (!bag_message_ || bag_message_.use_count() > 1 ||
+      !bag_message_->serialized_data || bag_message_->serialized_data.use_count() > 1)
+    {
+      bag_message_ = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message_->serialized_data = rosbag2_storage::make_empty_serialized_message(0);
+    } else {
+      auto serialized_data = std::move(bag_message_->serialized_data);
+      *bag_message_ = rosbag2_storage::SerializedBagMessage();
+      bag_message_->serialized_data = std::move(serialized_data);
+    }
+    bag_message_->topic_name = topic_name_;
+    bag_message_->time_stamp = time_stamp;
+
+    const auto type_support = rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>();
+    if (rmw_serialize(&message, type_support, bag_message_->serialized_data.get()) != RMW_RET_OK) {
+      const std::string error = rcutils_get_error_string().str;
+      rcutils_reset_error();
+      throw std::runtime_error("Failed to serialize message: " + error);
+    }
+    writer_.write(bag_message_);
+  }
+
+private:
+  Writer & writer_;
+  std::string topic_name_;
+  // Message written last, reused for the next one unless the writer still holds it.
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> bag_message_;
+};
+
+}  // namespace rosbag2_cpp
+
+#endif  // ROSBAG2_CPP__TYPED_WRITER_HPP_
@@ -25,10 +25,20 @@
 #include "rcpputils/shared_library.hpp"
 
 #include "rosidl_runtime_cpp/message_type_support_decl.hpp"
+#include "rosidl_runtime_cpp/traits.hpp"
 
 namespace rosbag2_cpp
 {
 
+/**
+ * Loads the typesupport of a message type.
+ *
+ * Libraries and handles are cached for the whole process, so each library is loaded once
+ * however many types and topics use it. Safe to call from multiple threads.
+ *
+ * \param library Set to the library the handle was loaded from, which must outlive its use.
+ * \throws std::runtime_error if the library or symbol cannot be found.
+ */
 ROSBAG2_CPP_PUBLIC
 const rosidl_message_type_support_t *
 get_typesupport(
@@ -39,6 +49,19 @@ ROSBAG2_CPP_PUBLIC
 const std::tuple<std::string, std::string, std::string>
 extract_type_identifier(const std::string & full_type);
 
+/// Type of a message as stored in bags, e.g. std_msgs/msg/String for std_msgs::msg::String.
+template<typename MessageT>
+std::string get_type_name()
+{
+  std::string type_name = rosidl_generator_traits::data_type<MessageT>();
+  for (auto separator = type_name.find("::"); separator != std::string::npos;
+    separator = type_name.find("::", separator + 1))
+  {
+    type_name.replace(separator, 2, "/");
+  }
+  return type_name;
+}
+
 }  // namespace rosbag2_cpp
 
 #endif  // ROSBAG2_CPP__TYPESUPPORT_HELPERS_HPP_
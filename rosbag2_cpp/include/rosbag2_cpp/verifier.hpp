@@ -0,0 +1,101 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__VERIFIER_HPP_
+#define ROSBAG2_CPP__VERIFIER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_factory_interface.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+
+/// Result of verifying one bagfile.
+struct FileVerification
+{
+  // Path of the bagfile, as listed in the metadata or given.
+  std::string path;
+  // Number of messages read before the end of the file or the first error.
+  uint64_t message_count = 0;
+  // Why the file is corrupt, empty if it is intact.
+  std::string error;
+};
+
+/**
+ * Checks that every message of a bag can be read, e.g. after a recording on an SD card lost
+ * power.
+ *
+ * Every bagfile is read completely by its storage, which checks the checksums of the messages,
+ * i.e. of the chunks of binary logs and of every message of sqlite3 files recorded with
+ * checksums. The files are read in parallel, so a bag of many split files is verified in about
+ * the time of its largest file.
+ */
+class ROSBAG2_CPP_PUBLIC Verifier
+{
+public:
+  explicit Verifier(
+    std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory =
+    std::make_unique<rosbag2_storage::StorageFactory>(),
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>());
+
+  /**
+   * Reads every message of every bagfile of the bag.
+   *
+   * The bagfiles are those of the metadata of the bag, if any, and the given ones, relative to
+   * the bag directory. A file is corrupt if it is missing or cannot be opened, if reading one
+   * of its messages fails, or if it has fewer or more messages than its metadata lists.
+   *
+   * \param uri Bag directory.
+   * \param storage_id Storage of the bagfiles, or empty to take it from the metadata.
+   * \param relative_file_paths Bagfiles found in the bag directory, e.g. of a bag without
+   * metadata.
+   * \param max_threads Maximum number of files read at once, 0 for one per processor.
+   * \return The result of every file, in the order of the metadata and then the given files.
+   * \throws std::invalid_argument if the storage is not given and there is no metadata.
+   * \throws std::runtime_error if there are no bagfiles or the bag is compressed per file.
+   */
+  std::vector<FileVerification> verify(
+    const std::string & uri, const std::string & storage_id,
+    const std::vector<std::string> & relative_file_paths = {}, size_t max_threads = 0);
+
+private:
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_;
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
+};
+
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__VERIFIER_HPP_
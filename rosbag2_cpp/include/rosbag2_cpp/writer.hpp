@@ -20,6 +20,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "rosbag2_cpp/bag_events.hpp"
 #include "rosbag2_cpp/converter_options.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
 #include "rosbag2_cpp/visibility_control.hpp"
@@ -45,6 +46,9 @@ class BaseWriterInterface;
 /**
  * The Writer allows writing messages to a new bag. For every topic, information about its type
  * needs to be added before writing the first message.
+ *
+ * The Writer is only thread-safe if its implementation is, e.g. a writers::ConcurrentWriter,
+ * which takes messages from several threads at once.
  */
 class ROSBAG2_CPP_PUBLIC Writer final
 {
@@ -71,6 +75,15 @@ public:
    */
   void create_topic(const rosbag2_storage::TopicMetadata & topic_with_type);
 
+  /**
+   * Create several topics in the underlying storage at once, which is faster than creating them
+   * one by one, e.g. the SQLite storage inserts them in a single transaction.
+   *
+   * \param topics_with_type names and type identifiers of the topics to be created
+   * \throws runtime_error if the Writer is not open.
+   */
+  void create_topics(const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type);
+
   /**
    * Remove a new topic in the underlying storage.
    * If creation of subscription fails remove the topic
@@ -89,6 +102,32 @@ public:
    */
   void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
 
+  /**
+   * Returns the handle of a created topic. Setting it as the topic_handle of the messages of the
+   * topic spares the writer and the storage from looking the topic up by its name.
+   *
+   * \param topic_name name of a topic created before
+   * \return The handle, or INVALID_TOPIC_HANDLE if the topic was not created or the writer does
+   * not use handles.
+   */
+  rosbag2_storage::TopicHandle get_topic_handle(const std::string & topic_name) const;
+
+  /**
+   * Registers callbacks for bag events, e.g. to start processing a bagfile as soon as it is
+   * closed on a split.
+   *
+   * \param callbacks the callbacks to invoke on bag events
+   */
+  void add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks);
+
+  /**
+   * Writes the messages kept in snapshot mode to the bag, see StorageOptions::snapshot_mode.
+   *
+   * \return Whether a snapshot was taken, which is false if the writer is not in snapshot mode.
+   * \throws runtime_error if the Writer is not open.
+   */
+  bool take_snapshot();
+
   writer_interfaces::BaseWriterInterface & get_implementation_handle() const
   {
     return *writer_impl_;
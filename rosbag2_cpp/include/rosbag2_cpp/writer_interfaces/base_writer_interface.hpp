@@ -16,7 +16,10 @@
 #define ROSBAG2_CPP__WRITER_INTERFACES__BASE_WRITER_INTERFACE_HPP_
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "rosbag2_cpp/bag_events.hpp"
 #include "rosbag2_cpp/converter_options.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
 #include "rosbag2_cpp/visibility_control.hpp"
@@ -41,9 +44,49 @@ public:
 
   virtual void create_topic(const rosbag2_storage::TopicMetadata & topic_with_type) = 0;
 
+  /**
+   * Creates the topics like create_topic() does. Writers may create them in the storage at once.
+   */
+  virtual void create_topics(const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type)
+  {
+    for (const auto & topic_with_type : topics_with_type) {
+      create_topic(topic_with_type);
+    }
+  }
+
   virtual void remove_topic(const rosbag2_storage::TopicMetadata & topic_with_type) = 0;
 
   virtual void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) = 0;
+
+  /**
+   * Returns the handle of a created topic, which callers may set in its messages to spare the
+   * writer from looking it up by name. Writers which do not use handles return
+   * INVALID_TOPIC_HANDLE.
+   */
+  virtual rosbag2_storage::TopicHandle get_topic_handle(const std::string & topic_name) const
+  {
+    (void) topic_name;
+    return rosbag2_storage::INVALID_TOPIC_HANDLE;
+  }
+
+  /**
+   * Registers callbacks for bag events. Writers which do not produce events ignore them.
+   */
+  virtual void add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks)
+  {
+    (void) callbacks;
+  }
+
+  /**
+   * Writes the messages kept in snapshot mode to the bag. Writers without snapshot mode
+   * do nothing.
+   *
+   * \return Whether a snapshot was taken.
+   */
+  virtual bool take_snapshot()
+  {
+    return false;
+  }
 };
 
 }  // namespace writer_interfaces
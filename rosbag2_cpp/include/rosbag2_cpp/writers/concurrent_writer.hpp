@@ -0,0 +1,155 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__WRITERS__CONCURRENT_WRITER_HPP_
+#define ROSBAG2_CPP__WRITERS__CONCURRENT_WRITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+#include "rosbag2_cpp/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+/**
+ * Writes messages coming from several threads, e.g. of drivers logging their data without
+ * subscribing to it. All functions may be called from any thread.
+ *
+ * Wraps another writer, e.g. a SequentialWriter, which is only called from one thread at a
+ * time. Every thread writing messages stages them in a buffer of its own, so writers only
+ * contend with the storage thread taking the messages of their buffer. The storage thread
+ * merges the staged messages by time stamp, keeping the order of every thread for equal time
+ * stamps, and writes them every flush_interval, or as soon as a buffer is half full. A thread
+ * whose buffer holds max_staged_messages messages waits until they are taken.
+ *
+ * Topics have to be created before their messages are written, like with any writer.
+ */
+class ROSBAG2_CPP_PUBLIC ConcurrentWriter
+  : public ::rosbag2_cpp::writer_interfaces::BaseWriterInterface
+{
+public:
+  /**
+   * \throws std::invalid_argument if max_staged_messages is 0.
+   */
+  explicit ConcurrentWriter(
+    std::unique_ptr<writer_interfaces::BaseWriterInterface> writer =
+    std::make_unique<SequentialWriter>(),
+    size_t max_staged_messages = 1000,
+    std::chrono::milliseconds flush_interval = std::chrono::milliseconds(10));
+
+  ~ConcurrentWriter() override;
+
+  void open(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options) override;
+
+  /// Writes the staged messages before resetting the wrapped writer.
+  void reset() override;
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override;
+
+  void create_topics(const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type)
+  override;
+
+  /// Writes the staged messages before removing the topic.
+  void remove_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override;
+
+  /**
+   * Stages the message in the buffer of the calling thread.
+   * \throws runtime_error if the writer is not open.
+   * \throws any error raised by the wrapped writer while writing staged messages, once.
+   */
+  void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override;
+
+  rosbag2_storage::TopicHandle get_topic_handle(const std::string & topic_name) const override;
+
+  void add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks) override;
+
+  /// Writes the staged messages before taking the snapshot.
+  bool take_snapshot() override;
+
+  /**
+   * Writes the messages staged by all threads so far on the calling thread.
+   * \throws any error raised by the wrapped writer.
+   */
+  void flush();
+
+private:
+  struct StagingBuffer
+  {
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  };
+
+  StagingBuffer & get_staging_buffer();
+  void write_staged_messages();
+  void start_storage_thread();
+  void stop_storage_thread();
+  void storage_thread_main();
+  void rethrow_write_error();
+
+  std::unique_ptr<writer_interfaces::BaseWriterInterface> writer_;
+  // Serializes the calls to the wrapped writer, and keeps the staged messages in order.
+  mutable std::mutex writer_mutex_;
+  const size_t max_staged_messages_;
+  const std::chrono::milliseconds flush_interval_;
+  // Distinguishes writers in the staging buffers cached by every thread.
+  const uint64_t id_;
+  std::atomic<bool> is_open_ {false};
+
+  // Buffers of all threads which wrote messages, which are kept until the writer is destroyed.
+  std::mutex staging_buffers_mutex_;
+  std::unordered_map<std::thread::id, std::unique_ptr<StagingBuffer>> staging_buffers_;
+
+  std::thread storage_thread_;
+  // Set by threads whose buffer is half full, without waking the storage thread if it is busy.
+  std::atomic<bool> is_write_requested_ {false};
+  // Protects the members below.
+  std::mutex state_mutex_;
+  std::condition_variable write_requested_;
+  bool stop_requested_ {false};
+  std::exception_ptr write_error_;
+  std::atomic<bool> has_write_error_ {false};
+};
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__WRITERS__CONCURRENT_WRITER_HPP_
@@ -0,0 +1,97 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__WRITERS__MESSAGE_DEDUPLICATOR_HPP_
+#define ROSBAG2_CPP__WRITERS__MESSAGE_DEDUPLICATOR_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+/**
+ * Replaces messages of the given topics whose data equals the data of the previous message of
+ * their topic stored since the last reset by references, which are copies of the messages with
+ * empty data. Readers expand a reference to the data of the previous message of its topic with
+ * data in the same file, so the deduplicator is reset whenever a new file is started.
+ *
+ * The data is compared by a hash first, and only byte by byte if the hashes match. The data of the
+ * previous message of every topic is kept, so it must not be changed once written, as is the
+ * case for all messages written. Messages of deduplicated topics must not be empty, which
+ * serialized messages never are.
+ */
+class ROSBAG2_CPP_PUBLIC MessageDeduplicator
+{
+public:
+  using Messages = std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>;
+
+  explicit MessageDeduplicator(const std::vector<std::string> & topics);
+
+  bool is_deduplicated(const std::string & topic_name) const;
+
+  /// The message itself if its data is to be stored, else a reference to the previous data.
+  std::shared_ptr<const rosbag2_storage::SerializedBagMessage> deduplicate(
+    std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message);
+
+  /// The messages to be stored in place of the given ones, in the same order.
+  Messages deduplicate(const Messages & messages);
+
+  /// Forgets the stored data of all topics, so the next message of every topic is stored.
+  void reset();
+
+  /// Number of messages replaced by references since the deduplicator was created.
+  uint64_t get_deduplicated_message_count() const;
+
+private:
+  struct StoredData
+  {
+    uint64_t hash;
+    std::shared_ptr<rcutils_uint8_array_t> data;
+  };
+
+  // Stored data by deduplicated topic, without data until the first message since a reset.
+  std::unordered_map<std::string, StoredData> stored_data_;
+  // Data of the references, not null so storages store it as empty rather than missing data.
+  std::shared_ptr<rcutils_uint8_array_t> empty_data_;
+  uint64_t deduplicated_message_count_{0};
+};
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__WRITERS__MESSAGE_DEDUPLICATOR_HPP_
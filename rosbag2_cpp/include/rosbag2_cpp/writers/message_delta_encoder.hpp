@@ -0,0 +1,111 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__WRITERS__MESSAGE_DELTA_ENCODER_HPP_
+#define ROSBAG2_CPP__WRITERS__MESSAGE_DELTA_ENCODER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+/// First byte of the stored data of every message of a delta encoded topic.
+enum class DeltaFrameType : uint8_t
+{
+  // Followed by the data of the message.
+  KEYFRAME = 0,
+  // Followed by the time stamp of the previous message of the topic as 8 bytes in little endian,
+  // the size of its data, and runs of unchanged and changed bytes. Each run is stored as the
+  // number of unchanged bytes, the number of changed bytes and the changed bytes, with the
+  // numbers as unsigned LEB128. The bytes after the last run are unchanged.
+  DELTA = 1,
+};
+
+/**
+ * Stores the messages of the given topics as the bytes changed since the previous message of
+ * their topic written since the last reset, which is the same size. Messages whose data changed
+ * in size or too much, the first message of every topic and every keyframe_interval-th message
+ * are stored as keyframes instead, as are messages not stamped later than the previous message
+ * of their topic, so reading a file in time stamp order decodes every topic in the order written.
+ * Readers decode a delta from the previous message of its topic in the same file, so the encoder
+ * is reset whenever a new file is started.
+ *
+ * The data of the previous message of every topic is kept, so it must not be changed once
+ * written, as is the case for all messages written. Empty messages are stored as they are.
+ */
+class ROSBAG2_CPP_PUBLIC MessageDeltaEncoder
+{
+public:
+  using Messages = std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>;
+
+  MessageDeltaEncoder(const std::vector<std::string> & topics, uint64_t keyframe_interval);
+
+  bool is_delta_encoded(const std::string & topic_name) const;
+
+  /// A copy of the message of a delta encoded topic with its data encoded as keyframe or delta.
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> encode(
+    const rosbag2_storage::SerializedBagMessage & message);
+
+  /// The messages to be stored in place of the given ones, in the same order.
+  Messages encode(const Messages & messages);
+
+  /// Forgets the previous message of all topics, so the next message of every topic is a keyframe.
+  void reset();
+
+  /// Number of messages stored as deltas since the encoder was created.
+  uint64_t get_delta_count() const;
+
+private:
+  struct PreviousMessage
+  {
+    std::shared_ptr<rcutils_uint8_array_t> data;
+    rcutils_time_point_value_t time_stamp;
+    // Messages stored since the last keyframe of the topic.
+    uint64_t deltas_since_keyframe;
+  };
+
+  uint64_t keyframe_interval_;
+  // Previous message by delta encoded topic, without data until the first message since a reset.
+  std::unordered_map<std::string, PreviousMessage> previous_messages_;
+  uint64_t delta_count_{0};
+};
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__WRITERS__MESSAGE_DELTA_ENCODER_HPP_
@@ -0,0 +1,107 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__WRITERS__MESSAGE_REORDER_BUFFER_HPP_
+#define ROSBAG2_CPP__WRITERS__MESSAGE_REORDER_BUFFER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+/**
+ * Holds back the messages written until they are older than a window of time before the latest
+ * time stamp written, so that messages whose time stamps were taken on several threads, and which
+ * arrive slightly out of order, are released in time stamp order. Storages then store them in
+ * the order they are read in, without sorting them when reading.
+ *
+ * The messages are kept in a min-heap of their time stamps. Messages of the same time stamp are
+ * released in the order they were added. A message older than a message released already arrived
+ * too late to be put in order, and is released right away.
+ */
+class ROSBAG2_CPP_PUBLIC MessageReorderBuffer
+{
+public:
+  using Messages = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+
+  explicit MessageReorderBuffer(std::chrono::nanoseconds window);
+
+  /// Adds the message, and appends the messages it releases to released, oldest first.
+  void add(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message, Messages & released);
+
+  /// Appends all messages held to released, oldest first, e.g. before closing the bag.
+  void flush(Messages & released);
+
+  bool empty() const;
+
+  /// Number of messages which arrived too late to be put in order since the buffer was created.
+  uint64_t get_late_message_count() const;
+
+private:
+  struct HeldMessage
+  {
+    rcutils_time_point_value_t time_stamp;
+    uint64_t sequence_number;
+    std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+  };
+
+  // Orders the heap to hold the oldest message, and the first added of those, on top.
+  struct IsLater
+  {
+    bool operator()(const HeldMessage & a, const HeldMessage & b) const
+    {
+      return a.time_stamp != b.time_stamp ?
+             a.time_stamp > b.time_stamp : a.sequence_number > b.sequence_number;
+    }
+  };
+
+  void release_oldest(Messages & released);
+
+  const std::chrono::nanoseconds window_;
+  std::priority_queue<HeldMessage, std::vector<HeldMessage>, IsLater> held_messages_;
+  uint64_t next_sequence_number_{0};
+  rcutils_time_point_value_t latest_time_stamp_{0};
+  bool has_released_{false};
+  rcutils_time_point_value_t released_time_stamp_{0};
+  uint64_t late_message_count_{0};
+};
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__WRITERS__MESSAGE_REORDER_BUFFER_HPP_
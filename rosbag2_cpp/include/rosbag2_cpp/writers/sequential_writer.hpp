@@ -15,18 +15,34 @@
 #ifndef ROSBAG2_CPP__WRITERS__SEQUENTIAL_WRITER_HPP_
 #define ROSBAG2_CPP__WRITERS__SEQUENTIAL_WRITER_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <regex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "rosbag2_cpp/bag_events.hpp"
 #include "rosbag2_cpp/converter.hpp"
+#include "rosbag2_cpp/memory_budget.hpp"
 #include "rosbag2_cpp/serialization_format_converter_factory.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
 #include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+#include "rosbag2_cpp/writers/message_deduplicator.hpp"
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+#include "rosbag2_cpp/writers/message_reorder_buffer.hpp"
+#include "rosbag2_cpp/writers/write_latency_monitor.hpp"
 #include "rosbag2_cpp/visibility_control.hpp"
 
 #include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/storage_config.hpp"
 #include "rosbag2_storage/storage_factory.hpp"
 #include "rosbag2_storage/storage_factory_interface.hpp"
 #include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
@@ -47,6 +63,11 @@ namespace writers
 /**
  * The Writer allows writing messages to a new bag. For every topic, information about its type
  * needs to be added before writing the first message.
+ *
+ * With stripe directories, the messages are spread over the bag directory and a writer of its
+ * own for every stripe directory, and the metadata of the bag lists the files of all of them.
+ * Likewise, every topic group is written by a writer of its own into a folder of the bag
+ * directory, and every shard by a writer of its own into the bag directory itself.
  */
 class ROSBAG2_CPP_PUBLIC SequentialWriter
   : public rosbag2_cpp::writer_interfaces::BaseWriterInterface
@@ -84,6 +105,9 @@ public:
    */
   void create_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override;
 
+  void create_topics(const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type)
+  override;
+
   /**
    * Remove a new topic in the underlying storage.
    * If creation of subscription fails remove the topic
@@ -102,38 +126,365 @@ public:
    */
   void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override;
 
+  /**
+   * Handle of a created topic, which stays the same for the topic in all bagfiles, stripes and
+   * topic groups of the bag.
+   */
+  rosbag2_storage::TopicHandle get_topic_handle(const std::string & topic_name) const override;
+
+  /**
+   * Registers callbacks for bag events. The split callback is also invoked for the last
+   * bagfile on reset(). With deferred index creation it is called from a background thread.
+   */
+  void add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks) override;
+
+  /**
+   * Number of messages discarded by the cache overflow policy so far, in all stripes.
+   * Only the double buffered cache drops messages, so this is always 0 otherwise.
+   */
+  uint64_t get_dropped_messages_count() const;
+
+  /**
+   * Writes the messages kept in snapshot mode into a bagfile of their own and discards them.
+   * Every snapshot after the first one starts a new bagfile.
+   */
+  bool take_snapshot() override;
+
 private:
   std::string base_folder_;
+  // Folder the bagfiles are written to, the bag directory or its folder in the staging directory,
+  // and the throughput limit of moving closed bagfiles out of the latter, 0 if unlimited.
+  std::string storage_folder_;
+  uint64_t migration_max_bytes_per_second_{0};
   std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory_;
   std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory_;
   std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage_;
   std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
   std::unique_ptr<Converter> converter_;
+  rosbag2_storage::StorageConfig storage_config_;
 
   // Used in bagfile splitting; specifies the best-effort maximum sub-section of a bagfile in bytes.
   uint64_t max_bagfile_size_;
+  // Maximum time span of messages and maximum message count of a bagfile, 0 if unused.
+  std::chrono::nanoseconds max_bagfile_duration_{0};
+  uint64_t max_bagfile_messages_{0};
+  // Timestamp of the first message and number of messages in the current bagfile.
+  rcutils_time_point_value_t current_file_starting_time_{0};
+  uint64_t current_file_message_count_{0};
+  // Number of the next bagfile, which keeps counting when bagfiles are retired.
+  uint64_t next_file_number_{1};
+
+  // Rolling retention of the closed bagfiles, 0 if unused, see StorageOptions.
+  uint64_t retention_max_bytes_{0};
+  std::chrono::nanoseconds retention_max_age_{0};
+  // Serialized bytes of the topics of every bagfile, in the order of the topics in its metadata,
+  // to take retired bagfiles out of the sizes of the topics.
+  std::deque<std::vector<uint64_t>> file_topic_sizes_;
+  // Retired bagfiles which are being deleted or handed over in the background.
+  std::vector<std::future<void>> retiring_files_;
+
+  std::vector<bag_events::WriterEventCallbacks> event_callbacks_;
+
+  // Next bagfile, opened in the background, and the topics it was created with.
+  bool precreate_next_bagfile_{false};
+  std::future<std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface>>
+  next_storage_;
+  std::vector<rosbag2_storage::TopicMetadata> next_storage_topics_;
 
   // Intermediate cache to write multiple messages into the storage.
   // `max_cache_size` is the amount of messages to hold in storage before writing to disk.
   uint64_t max_cache_size_;
+  // `max_cache_size_bytes` is the amount of serialized bytes to hold before writing to disk.
+  uint64_t max_cache_size_bytes_{0};
   std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> cache_;
+  uint64_t cache_size_bytes_{0};
+  // Largest amount of serialized bytes held by the caches at once, reported in the metadata.
+  uint64_t cache_high_water_mark_bytes_{0};
+
+  // Double buffered cache: while `cache_` is being filled by write(), `flush_cache_`
+  // is written to the storage by `cache_io_thread_`. While a flush is pending, only the I/O
+  // thread uses `storage_` and the topics, so create_topics() and remove_topic() wait for it.
+  bool double_buffered_cache_{false};
+  CacheOverflowPolicy cache_overflow_policy_{CacheOverflowPolicy::BLOCK};
+  std::unordered_map<std::string, TopicPriority> topic_priorities_;
+  uint64_t priority_threshold_percent_{50};
+  uint64_t low_priority_decimation_{0};
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> flush_cache_;
+  uint64_t flush_cache_size_bytes_{0};
+  // Books the bytes of both caches on the shared memory budget. The cache counts as full while
+  // the budget is exhausted.
+  std::unique_ptr<MemoryBudget::Account> cache_memory_account_;
+  bool flush_pending_{false};
+  bool stop_cache_io_thread_{false};
+  std::mutex cache_mutex_;
+  std::condition_variable flush_requested_;
+  std::condition_variable flush_done_;
+  std::thread cache_io_thread_;
+  std::atomic<uint64_t> dropped_messages_count_{0};
+
+  // Messages kept in snapshot mode, oldest first, and their serialized size.
+  bool snapshot_mode_{false};
+  uint64_t snapshot_max_bytes_{0};
+  std::chrono::nanoseconds snapshot_duration_{0};
+  std::deque<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> snapshot_buffer_;
+  uint64_t snapshot_buffer_size_bytes_{0};
+  // The oldest messages kept are discarded while the shared memory budget is exhausted, too.
+  std::unique_ptr<MemoryBudget::Account> snapshot_memory_account_;
+
+  // Size of a bagfile once it is closed and its path in the metadata, which changes once it is
+  // moved out of the staging directory.
+  struct ClosedFile
+  {
+    uint64_t size;
+    std::string path;
+  };
 
-  // Used to track topic -> message count
-  std::unordered_map<std::string, rosbag2_storage::TopicInformation> topics_names_to_info_;
+  // Previous bagfiles which are closed in the background when indices are built on close or
+  // bagfiles are staged, with the index of their file in the metadata.
+  struct ClosingStorage
+  {
+    size_t file_index;
+    std::future<ClosedFile> closed_file;
+  };
+  std::vector<ClosingStorage> closing_storages_;
+
+  struct TopicEntry
+  {
+    rosbag2_storage::TopicInformation info;
+    // Handle of the topic in this writer, which every storage is told on its creation.
+    rosbag2_storage::TopicHandle handle{rosbag2_storage::INVALID_TOPIC_HANDLE};
+    // Index of the topic in the topics listed in the metadata of the current bagfile, or the
+    // maximum if it has no message in it yet.
+    size_t file_topic_index{std::numeric_limits<size_t>::max()};
+    TopicPriority priority{TopicPriority::NORMAL};
+    // Low priority messages seen since the cache reached the priority threshold, for decimation.
+    uint64_t decimation_count{0};
+  };
+
+  // Used to track topic -> message count and storage handle
+  std::unordered_map<std::string, TopicEntry> topics_names_to_info_;
+  // Topics by their handle, null for removed topics. Writers of stripes and topic groups use
+  // the handles of the writer of the bag, so messages keep their handle when forwarded.
+  std::vector<TopicEntry *> topics_by_handle_;
+  SequentialWriter * parent_writer_{nullptr};
 
   rosbag2_storage::BagMetadata metadata_;
 
+  // Writers of the stripe directories followed by the shards of the bag directory, the rest of
+  // the bag directory is written by this writer itself.
+  std::vector<std::unique_ptr<SequentialWriter>> stripe_writers_;
+  // Name the bagfiles of this writer are numbered after if it is a shard, e.g. "bag_shard1",
+  // else empty for the name of its folder.
+  std::string shard_name_;
+  StripingPolicy striping_policy_{StripingPolicy::ROUND_ROBIN};
+  size_t next_stripe_{0};
+  // Stripe of every topic with topic affinity, 0 for the bag directory.
+  std::unordered_map<std::string, size_t> topic_stripes_;
+
+  // Writers of the topic groups, topics of no group are written by this writer itself.
+  std::vector<std::unique_ptr<SequentialWriter>> group_writers_;
+  std::vector<TopicGroup> topic_groups_;
+  std::vector<std::regex> topic_group_regexes_;
+  // Topic group of every topic, starting at 1 with 0 for no group. Topics grouped by message
+  // size are added with their first message.
+  std::unordered_map<std::string, size_t> topic_groups_of_topics_;
+  // Interval of the metadata checkpoints, 0 if unused, and when the last one was written.
+  std::chrono::milliseconds metadata_checkpoint_interval_{0};
+  std::chrono::steady_clock::time_point last_metadata_checkpoint_{};
+
+  // Identity shared with the bags of other hosts and offset added to the time stamps of the
+  // messages written, see StorageOptions.
+  std::string bag_id_;
+  std::chrono::nanoseconds clock_offset_{0};
+
+  // Monitors the writes to the storage if a write latency budget is set, else null.
+  std::unique_ptr<WriteLatencyMonitor> write_latency_monitor_;
+
+  // Replaces repeated messages of the deduplicated topics by references as they are written to
+  // the storage, null if no topic is deduplicated. Reset on every split.
+  std::unique_ptr<MessageDeduplicator> deduplicator_;
+  // Stores the messages of the delta encoded topics as changes to the previous message of their
+  // topic as they are written to the storage, null if no topic is delta encoded. Reset on every
+  // split.
+  std::unique_ptr<MessageDeltaEncoder> delta_encoder_;
+
+  // Puts the messages written in time stamp order before they are written to the stripes, topic
+  // groups or storage, null if no reorder window is set. Flushed when the writer is closed and
+  // before taking a snapshot. Reordered holds the messages released by the last write.
+  std::unique_ptr<MessageReorderBuffer> reorder_buffer_;
+  MessageReorderBuffer::Messages reordered_messages_;
+
+  // Opens a writer of its own for the given storage options, which shares the storage factory.
+  std::unique_ptr<SequentialWriter> open_child_writer(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options,
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io,
+    const std::string & shard_name = "");
+
+  // Opens a writer in a folder named after the bag in every stripe directory, followed by the
+  // writers of the shards of the bag directory.
+  void open_stripe_writers(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options);
+
+  // Opens a writer in a folder named after the group in the bag directory for every topic group.
+  void open_group_writers(
+    const StorageOptions & storage_options, const ConverterOptions & converter_options);
+
+  // Stripe the message is written to, 0 for the bag directory.
+  size_t select_stripe(const rosbag2_storage::SerializedBagMessage & message);
+
+  // Adds a new topic to the first topic group whose regex matches its name, if any.
+  void assign_topic_group(const std::string & topic_name);
+  void add_topic_to_group(const std::string & topic_name, size_t topic_group);
+
+  // Topic group the message is written to, 0 for no group.
+  size_t select_topic_group(const rosbag2_storage::SerializedBagMessage & message);
+
+  // Adds the files, topics and time ranges of the stripe and topic group writers to the metadata.
+  void merge_child_metadata(rosbag2_storage::BagMetadata & metadata) const;
+
+  // Adds the files of this writer, in the given folder, and its topics and time range to the
+  // metadata of a parent writer.
+  void merge_metadata_into(
+    rosbag2_storage::BagMetadata & metadata, const std::string & folder, size_t stripe) const;
+
+  // Writes a message in time stamp order to its stripe, topic group, snapshot or bagfile.
+  void write_in_order(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
+
+  // Writes the messages held by the reorder buffer, if any.
+  void flush_reorder_buffer();
+
+  // Topic of a message by its handle if it has one, else by its name, null for unknown topics.
+  TopicEntry * find_topic(const rosbag2_storage::SerializedBagMessage & message);
+
+  // Writes a message to the current bagfile, or its cache, and splits the bagfile if needed.
+  void write_to_storage(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
+
+  // Keeps a message in snapshot mode and discards the oldest ones which exceed the limits.
+  void add_to_snapshot_buffer(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
+
   // Closes the current backed storage and opens the next bagfile.
   void split_bagfile();
 
-  // Checks if the current recording bagfile needs to be split and rolled over to a new file.
-  bool should_split_bagfile() const;
+  // Hands a storage over to a background thread which destroys it and notifies about the split.
+  void close_storage_in_background(
+    std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage,
+    const bag_events::BagSplitInfo & split_info, size_t file_index);
+
+  // Stores the size of a closed bagfile in its metadata, so the bag size is summed up without
+  // checking the file again.
+  void set_file_size(size_t file_index, uint64_t file_size);
+
+  // Stores the size and path of a bagfile closed in the background in its metadata.
+  void set_closed_file(size_t file_index, const ClosedFile & closed_file);
+
+  // Path of a bagfile in the metadata, relative to the bag directory unless it is staged.
+  std::string get_path_in_metadata(const std::string & storage_path) const;
+
+  // Full path of a bagfile listed in the metadata.
+  std::string resolve_path(const std::string & path_in_metadata) const;
+
+  // Moves a closed bagfile from the staging directory to the bag directory and returns its path
+  // in the metadata, the staged path if it could not be moved.
+  std::string migrate_file(const std::string & staged_path) const;
+
+  // Invokes the split callbacks.
+  void notify_split(const bag_events::BagSplitInfo & split_info) const;
+
+  // Drops the oldest closed bagfiles from the bag while the retention limits are exceeded.
+  void apply_retention();
+
+  // Deletes a retired bagfile, or hands it over to the retire callbacks, in the background.
+  void retire_file(const std::string & path);
+
+  // Starts opening the bagfile following the current one in the background.
+  void precreate_next_storage();
+
+  // Waits for the precreated bagfile and registers the topics it is still missing.
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> take_next_storage();
+
+  // Closes the precreated bagfile and removes it again.
+  void discard_next_storage();
+
+  // Whether any of the bagfile splitting limits is set.
+  bool is_splitting_enabled() const;
+
+  // Writes all cached messages to the current storage.
+  void flush_cache();
+
+  // Converts the single cache, if needed, and writes it to the storage.
+  void write_cache_to_storage();
+
+  // Writes the messages to the storage, timed by the write latency monitor if there is one.
+  void write_messages_to_storage(const WriteLatencyMonitor::Messages & messages);
+
+  // Writes the messages to the storage, delta encoded and with references in place of repeated
+  // data.
+  void write_encoded_messages(const WriteLatencyMonitor::Messages & messages);
+
+  // Records a write started at the given time with the write latency monitor, and logs its
+  // warning if any.
+  void record_write_latency(
+    const WriteLatencyMonitor::Messages & messages, std::chrono::steady_clock::time_point start);
+
+  // Blocks until all storages closed in the background are destroyed.
+  void wait_for_closing_storages();
+
+  // Stores the sizes of the files of storages closed in the background which are finished.
+  void collect_closed_file_sizes();
+
+  // Checks if the current recording bagfile needs to be split and rolled over to a new file
+  // before the given message is written.
+  bool should_split_bagfile(const rosbag2_storage::SerializedBagMessage & message) const;
 
   // Prepares the metadata by setting initial values.
   void init_metadata();
 
   // Record TopicInformation into metadata
   void finalize_metadata();
+
+  // Writes the metadata of the bag as it is so far, including the stripe and topic group writers.
+  void write_metadata_checkpoint();
+
+  // Whether messages are cached at all, i.e. a message count or byte budget is set.
+  bool is_cache_enabled() const;
+
+  // Whether `cache_` reached the message count or the byte budget, or holds messages while the
+  // shared memory budget is exhausted.
+  bool is_cache_full() const;
+
+  // Books the bytes held by both caches on the memory budget.
+  void update_cache_memory_account();
+
+  // Appends a message to `cache_` and updates the byte statistics.
+  void add_to_cache(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message);
+
+  // Adds a message to the double buffered cache, applying the overflow policy if needed.
+  void write_to_double_buffered_cache(
+    std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message);
+
+  // Whether `cache_` reached the priority threshold of the message count or the byte budget.
+  bool is_cache_above_priority_threshold() const;
+
+  // Takes a message written but not cached back out of the topic statistics, counting it as
+  // dropped. Must be called with `cache_mutex_` held.
+  void discard_message(const rosbag2_storage::SerializedBagMessage & message);
+
+  // Discards the oldest cached messages of topics below the given priority until `cache_` is no
+  // longer full. Must be called with `cache_mutex_` held.
+  void discard_cached_messages_below(TopicPriority priority);
+
+  // Hands `cache_` over to the I/O thread. Must be called with `cache_mutex_` held
+  // and no flush pending.
+  void swap_caches();
+
+  // Blocks until the I/O thread has written the cache handed over to it.
+  void wait_for_pending_flush();
+
+  // Writes the remaining cached messages and stops the I/O thread.
+  void stop_cache_io_thread();
+
+  // Main loop of the I/O thread.
+  void cache_io_thread_main();
 };
 
 }  // namespace writers
@@ -0,0 +1,118 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__WRITERS__WRITE_LATENCY_MONITOR_HPP_
+#define ROSBAG2_CPP__WRITERS__WRITE_LATENCY_MONITOR_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/visibility_control.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+/**
+ * Follows how long the writes of a writer to its storage take, and produces warnings about writes
+ * which take longer than a budget and about messages backing up in front of the storage.
+ *
+ * The durations are kept in a histogram of power of two buckets whose counts decay exponentially,
+ * so its percentiles describe the recent writes. Warnings name the topics contributing the most
+ * bytes, and are produced at most once per warning interval, counting the ones left out.
+ * The monitor may be used from several threads.
+ */
+class ROSBAG2_CPP_PUBLIC WriteLatencyMonitor
+{
+public:
+  using Messages = std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>;
+
+  explicit WriteLatencyMonitor(
+    std::chrono::nanoseconds budget,
+    std::chrono::nanoseconds warning_interval = std::chrono::seconds(5),
+    std::chrono::nanoseconds decay_half_life = std::chrono::seconds(10));
+
+  /**
+   * Records a write of the given messages to the storage.
+   * \return a warning if the write took longer than the budget, or empty if it did not or a
+   * warning was produced within the warning interval.
+   */
+  std::string record_write(
+    const Messages & messages, std::chrono::nanoseconds duration,
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+  /**
+   * Records that the given messages have to wait for the storage, e.g. because a cache is full
+   * while the previous one is still being written.
+   * \return a warning, or empty if a warning was produced within the warning interval.
+   */
+  std::string record_backlog(
+    const Messages & messages,
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+  /// Duration not exceeded by the given fraction of the recent writes, rounded up to a bucket.
+  std::chrono::nanoseconds get_percentile(double fraction) const;
+
+  /// Number of writes which took longer than the budget, including those without a warning.
+  uint64_t get_slow_write_count() const;
+
+private:
+  // Bucket i holds the durations up to 2^i microseconds.
+  static constexpr size_t kBucketCount = 32;
+
+  void decay(std::chrono::steady_clock::time_point now);
+  std::chrono::nanoseconds get_percentile_locked(double fraction) const;
+  // Percentiles of the recent writes for a warning, empty if there were none.
+  std::string format_recent_writes() const;
+  // Whether a warning may be produced, else it is counted as suppressed.
+  bool take_warning(std::chrono::steady_clock::time_point now);
+  std::string format_suppressed_warnings();
+
+  const std::chrono::nanoseconds budget_;
+  const std::chrono::nanoseconds warning_interval_;
+  const std::chrono::nanoseconds decay_half_life_;
+
+  mutable std::mutex mutex_;
+  std::array<double, kBucketCount> buckets_{};
+  std::chrono::steady_clock::time_point last_decay_{};
+  bool has_warned_{false};
+  std::chrono::steady_clock::time_point last_warning_{};
+  uint64_t suppressed_warnings_{0};
+  uint64_t slow_write_count_{0};
+};
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_CPP__WRITERS__WRITE_LATENCY_MONITOR_HPP_
@@ -0,0 +1,359 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/bag_generator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#ifdef _WIN32
+// This is necessary because of a bug in yaml-cpp's cmake
+#define YAML_CPP_DLL
+// This is necessary because yaml-cpp does not always use dllimport/dllexport consistently
+# pragma warning(push)
+# pragma warning(disable:4251)
+# pragma warning(disable:4275)
+#endif
+#include "yaml-cpp/yaml.h"
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+
+constexpr const auto SERIALIZATION_FORMAT = "cdr";
+// Messages are generated in batches of at most this many messages or bytes, so that the next
+// batch is generated while the previous one is written, without holding much of the bag.
+constexpr const size_t MAX_BATCH_MESSAGES = 4096;
+constexpr const size_t MAX_BATCH_BYTES = 64 * 1024 * 1024;
+// Size of the CDR encapsulation, the empty layout and the length of the data of a
+// std_msgs/msg/ByteMultiArray.
+constexpr const size_t BYTE_MULTI_ARRAY_HEADER_SIZE = 16;
+
+/// SplitMix64, a fast generator whose output is the same on every platform.
+class RandomBits
+{
+public:
+  explicit RandomBits(uint64_t seed)
+  : state_(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+private:
+  uint64_t state_;
+};
+
+uint64_t message_seed(uint64_t seed, size_t topic_index, uint64_t message_index)
+{
+  RandomBits bits(seed);
+  RandomBits topic_bits(bits.next() ^ static_cast<uint64_t>(topic_index));
+  RandomBits message_bits(topic_bits.next() ^ message_index);
+  return message_bits.next();
+}
+
+struct PlannedMessage
+{
+  size_t topic_index;
+  uint64_t message_index;
+  rcutils_time_point_value_t time_stamp;
+};
+
+/// Yields the messages of all topics in the order of their time stamps.
+class MessageSchedule
+{
+public:
+  explicit MessageSchedule(const GeneratorSpec & spec)
+  : spec_(spec)
+  {
+    for (size_t i = 0; i < spec.topics.size(); ++i) {
+      // Messages are sent at the start of every period within the duration.
+      const auto count = static_cast<uint64_t>(
+        std::floor(static_cast<double>(spec.duration.count()) * spec.topics[i].rate_hz / 1e9));
+      message_counts_.push_back(count);
+      if (count > 0) {
+        queue_.push(PlannedMessage{i, 0, spec.start_time});
+      }
+    }
+  }
+
+  bool next(PlannedMessage & message)
+  {
+    if (queue_.empty()) {
+      return false;
+    }
+    message = queue_.top();
+    queue_.pop();
+    const auto next_index = message.message_index + 1;
+    if (next_index < message_counts_[message.topic_index]) {
+      queue_.push(
+        PlannedMessage{message.topic_index, next_index, time_stamp(
+            message.topic_index, next_index)});
+    }
+    return true;
+  }
+
+private:
+  rcutils_time_point_value_t time_stamp(size_t topic_index, uint64_t message_index) const
+  {
+    return spec_.start_time + static_cast<rcutils_time_point_value_t>(
+      static_cast<double>(message_index) * 1e9 / spec_.topics[topic_index].rate_hz);
+  }
+
+  // Orders the queue by time stamp, and messages of the same time by topic.
+  struct Later
+  {
+    bool operator()(const PlannedMessage & lhs, const PlannedMessage & rhs) const
+    {
+      return lhs.time_stamp > rhs.time_stamp ||
+             (lhs.time_stamp == rhs.time_stamp && lhs.topic_index > rhs.topic_index);
+    }
+  };
+
+  const GeneratorSpec & spec_;
+  std::vector<uint64_t> message_counts_;
+  std::priority_queue<PlannedMessage, std::vector<PlannedMessage>, Later> queue_;
+};
+
+size_t message_size(const GeneratedTopic & topic, uint64_t seed)
+{
+  if (topic.max_size <= topic.min_size) {
+    return topic.min_size;
+  }
+  const auto range = static_cast<uint64_t>(topic.max_size - topic.min_size) + 1;
+  return topic.min_size + static_cast<size_t>(RandomBits(~seed).next() % range);
+}
+
+void fill_message(uint8_t * data, size_t size, uint64_t seed)
+{
+  RandomBits bits(seed);
+  size_t offset = 0;
+  if (size >= BYTE_MULTI_ARRAY_HEADER_SIZE) {
+    // Little endian CDR encapsulation, no dimensions in the layout, a data offset of 0 and the
+    // length of the data.
+    const uint8_t encapsulation[4] = {0x00, 0x01, 0x00, 0x00};
+    std::memcpy(data, encapsulation, sizeof(encapsulation));
+    std::memset(data + 4, 0, 8);
+    const auto data_size = static_cast<uint32_t>(size - BYTE_MULTI_ARRAY_HEADER_SIZE);
+    for (size_t i = 0; i < 4; ++i) {
+      data[12 + i] = static_cast<uint8_t>(data_size >> (8 * i));
+    }
+    offset = BYTE_MULTI_ARRAY_HEADER_SIZE;
+  }
+  for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+    const auto value = bits.next();
+    std::memcpy(data + offset, &value, sizeof(value));
+  }
+  if (offset < size) {
+    const auto value = bits.next();
+    std::memcpy(data + offset, &value, size - offset);
+  }
+}
+
+std::vector<PlannedMessage> plan_batch(const GeneratorSpec & spec, MessageSchedule & schedule)
+{
+  std::vector<PlannedMessage> batch;
+  size_t batch_bytes = 0;
+  PlannedMessage message{};
+  while (batch.size() < MAX_BATCH_MESSAGES && batch_bytes < MAX_BATCH_BYTES &&
+    schedule.next(message))
+  {
+    batch.push_back(message);
+    batch_bytes += spec.topics[message.topic_index].max_size;
+  }
+  return batch;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> generate_batch(
+  const GeneratorSpec & spec, const std::vector<PlannedMessage> & batch, size_t max_threads)
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages(batch.size());
+  std::vector<std::exception_ptr> errors(batch.size());
+  std::atomic<size_t> next_message{0};
+  const auto generate_messages = [&]() {
+      for (size_t i = next_message++; i < batch.size(); i = next_message++) {
+        try {
+          const auto & planned = batch[i];
+          const auto & topic = spec.topics[planned.topic_index];
+          const auto seed = message_seed(spec.seed, planned.topic_index, planned.message_index);
+          auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+          message->serialized_data =
+            rosbag2_storage::make_empty_serialized_message(message_size(topic, seed));
+          message->serialized_data->buffer_length = message->serialized_data->buffer_capacity;
+          fill_message(
+            message->serialized_data->buffer, message->serialized_data->buffer_length, seed);
+          message->time_stamp = planned.time_stamp;
+          message->topic_name = topic.name;
+          messages[i] = std::move(message);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      }
+    };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(max_threads, batch.size()); ++i) {
+    threads.emplace_back(
+      [&generate_messages]() {
+        ThreadPool::configure_current_thread();
+        generate_messages();
+      });
+  }
+  generate_messages();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  for (const auto & error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return messages;
+}
+
+void validate_spec(const GeneratorSpec & spec)
+{
+  if (spec.duration.count() <= 0) {
+    throw std::invalid_argument("The duration of the generated bag must be positive.");
+  }
+  if (spec.topics.empty()) {
+    throw std::invalid_argument("The generated bag needs at least one topic.");
+  }
+  for (const auto & topic : spec.topics) {
+    if (topic.name.empty() || topic.type.empty()) {
+      throw std::invalid_argument("Every generated topic needs a name and a type.");
+    }
+    if (!(topic.rate_hz > 0.0)) {
+      throw std::invalid_argument("The rate of topic '" + topic.name + "' must be positive.");
+    }
+    if (topic.max_size < topic.min_size) {
+      throw std::invalid_argument(
+              "The maximum message size of topic '" + topic.name +
+              "' must not be smaller than its minimum size.");
+    }
+  }
+}
+
+}  // namespace
+
+BagGenerator::BagGenerator(std::unique_ptr<writer_interfaces::BaseWriterInterface> writer_impl)
+: writer_(std::move(writer_impl))
+{}
+
+GeneratorSpec BagGenerator::parse_spec(const std::string & yaml)
+{
+  GeneratorSpec spec{};
+  try {
+    const auto node = YAML::Load(yaml);
+    spec.seed = node["seed"] ? node["seed"].as<uint64_t>() : 0;
+    spec.duration = std::chrono::nanoseconds(
+      static_cast<int64_t>(std::llround(node["duration"].as<double>() * 1e9)));
+    spec.start_time = node["start_time"] ? node["start_time"].as<int64_t>() : 0;
+    for (const auto & topic_node : node["topics"]) {
+      GeneratedTopic topic{};
+      topic.name = topic_node["name"].as<std::string>();
+      if (topic_node["type"]) {
+        topic.type = topic_node["type"].as<std::string>();
+      }
+      topic.rate_hz = topic_node["rate"].as<double>();
+      if (topic_node["size"]) {
+        topic.min_size = topic_node["size"].as<size_t>();
+        topic.max_size = topic.min_size;
+      } else {
+        topic.min_size = topic_node["min_size"].as<size_t>();
+        topic.max_size = topic_node["max_size"].as<size_t>();
+      }
+      spec.topics.push_back(topic);
+    }
+  } catch (const YAML::Exception & e) {
+    throw std::invalid_argument(std::string("Invalid bag generator spec: ") + e.what());
+  }
+  validate_spec(spec);
+  return spec;
+}
+
+GeneratorSpec BagGenerator::load_spec(const std::string & path)
+{
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Could not read the bag generator spec '" + path + "'.");
+  }
+  std::stringstream yaml;
+  yaml << file.rdbuf();
+  return parse_spec(yaml.str());
+}
+
+uint64_t BagGenerator::generate(
+  const GeneratorSpec & spec, const StorageOptions & storage_options, size_t max_threads)
+{
+  validate_spec(spec);
+  if (max_threads == 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  writer_.open(storage_options, {SERIALIZATION_FORMAT, SERIALIZATION_FORMAT});
+  for (const auto & topic : spec.topics) {
+    writer_.create_topic({topic.name, topic.type, SERIALIZATION_FORMAT, ""});
+  }
+
+  MessageSchedule schedule(spec);
+  const auto generate_next_batch = [&spec, &schedule, max_threads]() {
+      return std::async(
+        std::launch::async, [&spec, max_threads](std::vector<PlannedMessage> batch) {
+          ThreadPool::configure_current_thread();
+          return generate_batch(spec, batch, max_threads);
+        }, plan_batch(spec, schedule));
+    };
+  uint64_t message_count = 0;
+  auto next_batch = generate_next_batch();
+  for (auto messages = next_batch.get(); !messages.empty(); messages = next_batch.get()) {
+    next_batch = generate_next_batch();
+    for (auto & message : messages) {
+      writer_.write(std::move(message));
+      ++message_count;
+    }
+  }
+  writer_.get_implementation_handle().reset();
+  return message_count;
+}
+
+}  // namespace rosbag2_cpp
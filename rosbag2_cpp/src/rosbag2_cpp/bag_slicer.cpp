@@ -0,0 +1,116 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/bag_slicer.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+std::string resolve_path(const std::string & uri, const std::string & relative_file_path)
+{
+  const auto path = rcpputils::fs::path(relative_file_path);
+  return path.is_absolute() ? path.string() : (rcpputils::fs::path(uri) / path).string();
+}
+
+// Whether the metadata of the bagfile rules out messages in the time range. Files without
+// message count in the metadata may have messages at any time.
+bool is_outside_of_range(
+  const rosbag2_storage::BagMetadata & metadata, const std::string & relative_file_path,
+  rcutils_time_point_value_t start_time, rcutils_time_point_value_t end_time)
+{
+  const auto file = std::find_if(
+    metadata.files.begin(), metadata.files.end(),
+    [&relative_file_path](const rosbag2_storage::FileInformation & candidate) {
+      return candidate.path == relative_file_path;
+    });
+  if (file == metadata.files.end() || file->message_count == 0) {
+    return false;
+  }
+  const auto file_start_time = file->starting_time.time_since_epoch().count();
+  const auto file_end_time = file_start_time + file->duration.count();
+  return file_end_time < start_time || file_start_time > end_time;
+}
+}  // namespace
+
+BagSlicer::BagSlicer(
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io,
+  std::unique_ptr<Reindexer> reindexer)
+: storage_factory_(std::move(storage_factory)),
+  metadata_io_(std::move(metadata_io)),
+  reindexer_(std::move(reindexer))
+{}
+
+rosbag2_storage::BagMetadata BagSlicer::slice(
+  const std::string & uri, const std::string & output_uri,
+  const rcutils_time_point_value_t & start_time, const rcutils_time_point_value_t & end_time)
+{
+  if (end_time < start_time) {
+    throw std::invalid_argument("The time range to slice the bag \"" + uri + "\" is empty.");
+  }
+  if (!metadata_io_->metadata_file_exists(uri)) {
+    throw std::runtime_error("The bag \"" + uri + "\" has no metadata.");
+  }
+  const auto metadata = metadata_io_->read_metadata(uri);
+  // The messages of compressed or encrypted bagfiles cannot be selected without decoding them.
+  if (!metadata.compression_mode.empty() || !metadata.encryption_format.empty()) {
+    throw std::runtime_error(
+            "The bag \"" + uri + "\" is compressed or encrypted and cannot be sliced.");
+  }
+  const auto output_path = rcpputils::fs::path(output_uri);
+  if (output_path.exists()) {
+    throw std::runtime_error("The output directory \"" + output_uri + "\" already exists.");
+  }
+
+  std::vector<std::string> relative_file_paths;
+  for (const auto & relative_file_path : metadata.relative_file_paths) {
+    if (is_outside_of_range(metadata, relative_file_path, start_time, end_time)) {
+      continue;
+    }
+    auto storage = storage_factory_->open_read_only(
+      resolve_path(uri, relative_file_path), metadata.storage_identifier);
+    if (!storage) {
+      throw std::runtime_error("The bagfile \"" + relative_file_path + "\" could not be opened.");
+    }
+    if (relative_file_paths.empty()) {
+      rcpputils::fs::create_directories(output_path);
+    }
+    // Named like the bagfiles of a recording, so the bag is found by Reindexer::find_bagfiles.
+    const auto slice_uri = output_path /
+      (output_path.filename().string() + "_" + std::to_string(relative_file_paths.size()));
+    const auto slice_path = storage->slice(slice_uri.string(), start_time, end_time);
+    relative_file_paths.push_back(rcpputils::fs::path(slice_path).filename().string());
+  }
+  if (relative_file_paths.empty()) {
+    throw std::runtime_error(
+            "No bagfile of the bag \"" + uri + "\" has messages in the time range.");
+  }
+
+  return reindexer_->reindex(output_uri, metadata.storage_identifier, relative_file_paths);
+}
+
+}  // namespace rosbag2_cpp
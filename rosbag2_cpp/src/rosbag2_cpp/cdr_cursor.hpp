@@ -0,0 +1,154 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_CPP__CDR_CURSOR_HPP_
+#define ROSBAG2_CPP__CDR_CURSOR_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+namespace rosbag2_cpp
+{
+namespace cdr
+{
+
+// CDR data starts with a header stating the representation, of which the second byte is 1 for
+// little endian data. Values are aligned to their size relative to the end of the header.
+constexpr size_t kEncapsulationSize = 4;
+
+/// Size of a primitive type in CDR, 0 for other types.
+inline size_t get_primitive_size(uint8_t type_id)
+{
+  namespace introspection = rosidl_typesupport_introspection_cpp;
+  switch (type_id) {
+    case introspection::ROS_TYPE_BOOLEAN:
+    case introspection::ROS_TYPE_CHAR:
+    case introspection::ROS_TYPE_OCTET:
+    case introspection::ROS_TYPE_UINT8:
+    case introspection::ROS_TYPE_INT8:
+      return 1;
+    case introspection::ROS_TYPE_UINT16:
+    case introspection::ROS_TYPE_INT16:
+      return 2;
+    case introspection::ROS_TYPE_FLOAT:
+    case introspection::ROS_TYPE_UINT32:
+    case introspection::ROS_TYPE_INT32:
+      return 4;
+    case introspection::ROS_TYPE_DOUBLE:
+    case introspection::ROS_TYPE_UINT64:
+    case introspection::ROS_TYPE_INT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+inline const rosidl_typesupport_introspection_cpp::MessageMembers * get_nested_members(
+  const rosidl_typesupport_introspection_cpp::MessageMember & member)
+{
+  return static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+    member.members_->data);
+}
+
+/// Reads the values of a CDR serialized message in order, swapping their bytes if necessary.
+/// Values can be overwritten in place as well, in the byte order of the message.
+class Cursor
+{
+public:
+  explicit Cursor(const rcutils_uint8_array_t & serialized_message)
+  : data_(serialized_message.buffer), size_(serialized_message.buffer_length)
+  {
+    const auto header = read_bytes(kEncapsulationSize);
+    const bool little_endian_data = (header[1] & 1u) == 1u;
+    const uint16_t probe = 1;
+    uint8_t first_byte;
+    std::memcpy(&first_byte, &probe, 1);
+    swap_bytes_ = little_endian_data != (first_byte == 1);
+  }
+
+  void skip_to(size_t offset)
+  {
+    skip(kEncapsulationSize + offset - offset_);
+  }
+
+  void align(size_t alignment)
+  {
+    const auto misalignment = (offset_ - kEncapsulationSize) % alignment;
+    if (misalignment != 0) {
+      skip(alignment - misalignment);
+    }
+  }
+
+  void skip(size_t count)
+  {
+    read_bytes(count);
+  }
+
+  template<typename T>
+  T read()
+  {
+    align(sizeof(T));
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, read_bytes(sizeof(T)), sizeof(T));
+    if (swap_bytes_) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+  }
+
+  /// Overwrites the next value of the message the cursor was created for.
+  template<typename T>
+  void write(rcutils_uint8_array_t & serialized_message, T value)
+  {
+    align(sizeof(T));
+    const auto offset = offset_;
+    read_bytes(sizeof(T));
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (swap_bytes_) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+    std::memcpy(serialized_message.buffer + offset, bytes, sizeof(T));
+  }
+
+  const uint8_t * read_bytes(size_t count)
+  {
+    if (count > size_ - offset_) {
+      throw std::runtime_error("Serialized message is truncated.");
+    }
+    const auto bytes = data_ + offset_;
+    offset_ += count;
+    return bytes;
+  }
+
+private:
+  const uint8_t * data_;
+  size_t size_;
+  size_t offset_ {0};
+  bool swap_bytes_ {false};
+};
+
+}  // namespace cdr
+}  // namespace rosbag2_cpp
+
+#endif  // ROSBAG2_CPP__CDR_CURSOR_HPP_
@@ -0,0 +1,362 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/cdr_field_extractor.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcutils/error_handling.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+#include "./cdr_cursor.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+
+namespace introspection = rosidl_typesupport_introspection_cpp;
+using introspection::MessageMember;
+using introspection::MessageMembers;
+using cdr::Cursor;
+using cdr::get_nested_members;
+using cdr::get_primitive_size;
+
+// Skips one or more fields preceding the extracted field.
+struct Step
+{
+  enum class Kind
+  {
+    // Aligns to alignment and skips size bytes.
+    FIXED_SIZE,
+    STRING,
+    WSTRING,
+    // Skips a sequence of primitive elements with a size of alignment bytes.
+    PRIMITIVE_SEQUENCE,
+    // Skips count elements with element_steps, or a sequence of them if count is 0.
+    REPEATED,
+  };
+
+  Kind kind;
+  size_t alignment;
+  size_t size;
+  size_t count;
+  std::shared_ptr<const std::vector<Step>> element_steps;
+};
+
+bool is_integer_type(uint8_t type_id)
+{
+  return type_id != introspection::ROS_TYPE_FLOAT &&
+         type_id != introspection::ROS_TYPE_DOUBLE &&
+         get_primitive_size(type_id) > 0;
+}
+
+bool is_time_message(const MessageMembers * members)
+{
+  return std::strcmp(members->message_namespace_, "builtin_interfaces::msg") == 0 &&
+         (std::strcmp(members->message_name_, "Time") == 0 ||
+         std::strcmp(members->message_name_, "Duration") == 0);
+}
+
+void add_member_steps(const MessageMember & member, std::vector<Step> & steps);
+
+void add_message_steps(
+  const MessageMembers * members, uint32_t member_count, std::vector<Step> & steps)
+{
+  for (uint32_t i = 0; i < member_count; ++i) {
+    add_member_steps(members->members_[i], steps);
+  }
+}
+
+/// Steps skipping a single value of the type of a field, ignoring whether it is an array.
+std::vector<Step> get_value_steps(const MessageMember & member)
+{
+  std::vector<Step> steps;
+  const auto size = get_primitive_size(member.type_id_);
+  if (size > 0) {
+    steps.push_back({Step::Kind::FIXED_SIZE, size, size, 0, nullptr});
+  } else if (member.type_id_ == introspection::ROS_TYPE_STRING) {
+    steps.push_back({Step::Kind::STRING, 0, 0, 0, nullptr});
+  } else if (member.type_id_ == introspection::ROS_TYPE_WSTRING) {
+    steps.push_back({Step::Kind::WSTRING, 0, 0, 0, nullptr});
+  } else if (member.type_id_ == introspection::ROS_TYPE_MESSAGE) {
+    const auto nested_members = get_nested_members(member);
+    add_message_steps(nested_members, nested_members->member_count_, steps);
+  } else {
+    throw std::runtime_error(
+            std::string("Field '") + member.name_ + "' has a type not supported by CDR.");
+  }
+  return steps;
+}
+
+void add_member_steps(const MessageMember & member, std::vector<Step> & steps)
+{
+  if (!member.is_array_) {
+    const auto value_steps = get_value_steps(member);
+    steps.insert(steps.end(), value_steps.begin(), value_steps.end());
+    return;
+  }
+
+  const bool is_fixed_size_array = member.array_size_ > 0 && !member.is_upper_bound_;
+  const auto element_size = get_primitive_size(member.type_id_);
+  if (element_size > 0 && is_fixed_size_array) {
+    steps.push_back(
+      {Step::Kind::FIXED_SIZE, element_size, element_size * member.array_size_, 0, nullptr});
+  } else if (element_size > 0) {
+    steps.push_back({Step::Kind::PRIMITIVE_SEQUENCE, element_size, 0, 0, nullptr});
+  } else {
+    steps.push_back(
+      {Step::Kind::REPEATED, 0, 0, is_fixed_size_array ? member.array_size_ : 0,
+        std::make_shared<const std::vector<Step>>(get_value_steps(member))});
+  }
+}
+
+void skip_steps(Cursor & cursor, const std::vector<Step> & steps)
+{
+  for (const auto & step : steps) {
+    switch (step.kind) {
+      case Step::Kind::FIXED_SIZE:
+        cursor.align(step.alignment);
+        cursor.skip(step.size);
+        break;
+      case Step::Kind::STRING:
+        cursor.skip(cursor.read<uint32_t>());
+        break;
+      case Step::Kind::WSTRING:
+        // Wide characters are serialized with four bytes.
+        cursor.skip(static_cast<size_t>(cursor.read<uint32_t>()) * 4);
+        break;
+      case Step::Kind::PRIMITIVE_SEQUENCE:
+        {
+          const auto length = cursor.read<uint32_t>();
+          if (length > 0) {
+            cursor.align(step.alignment);
+            cursor.skip(static_cast<size_t>(length) * step.alignment);
+          }
+          break;
+        }
+      case Step::Kind::REPEATED:
+        {
+          const size_t count = step.count > 0 ? step.count : cursor.read<uint32_t>();
+          for (size_t i = 0; i < count; ++i) {
+            skip_steps(cursor, *step.element_steps);
+          }
+          break;
+        }
+    }
+  }
+}
+
+}  // namespace
+
+struct CdrFieldExtractor::Plan
+{
+  std::string field_path;
+  uint8_t field_type;
+  bool is_time_field;
+  // Offset of the first variable sized field preceding the extracted field, or of the extracted
+  // field if there is none, relative to the end of the encapsulation header.
+  size_t constant_offset;
+  // Steps skipping the fields after the constant offset.
+  std::vector<Step> steps;
+
+  Cursor locate_field(const rcutils_uint8_array_t & serialized_message) const
+  {
+    Cursor cursor{serialized_message};
+    cursor.skip_to(constant_offset);
+    skip_steps(cursor, steps);
+    return cursor;
+  }
+
+  std::runtime_error type_mismatch(const std::string & expected_type) const
+  {
+    return std::runtime_error("Field '" + field_path + "' is not " + expected_type + ".");
+  }
+};
+
+CdrFieldExtractor::CdrFieldExtractor(
+  const rosidl_message_type_support_t * type_support, const std::string & field_path)
+{
+  const auto introspection_type_support = get_message_typesupport_handle(
+    type_support, introspection::typesupport_identifier);
+  if (!introspection_type_support) {
+    rcutils_reset_error();
+    throw std::runtime_error("No introspection type support found for message type.");
+  }
+
+  auto members = static_cast<const MessageMembers *>(introspection_type_support->data);
+  std::vector<Step> steps;
+  const MessageMember * field = nullptr;
+  std::string::size_type name_start = 0;
+  while (true) {
+    const auto name_end = field_path.find('.', name_start);
+    const auto name = field_path.substr(name_start, name_end - name_start);
+    const auto members_end = members->members_ + members->member_count_;
+    field = std::find_if(
+      members->members_, members_end,
+      [&name](const MessageMember & member) {return name == member.name_;});
+    if (field == members_end) {
+      throw std::runtime_error(
+              "Message type '" + std::string(members->message_namespace_) + "::" +
+              members->message_name_ + "' has no field '" + name + "'.");
+    }
+    if (field->is_array_) {
+      throw std::runtime_error(
+              "Field '" + name + "' is an array or sequence and cannot be extracted.");
+    }
+    add_message_steps(members, static_cast<uint32_t>(field - members->members_), steps);
+    if (name_end == std::string::npos) {
+      break;
+    }
+    if (field->type_id_ != introspection::ROS_TYPE_MESSAGE) {
+      throw std::runtime_error("Field '" + name + "' is not a message.");
+    }
+    members = get_nested_members(*field);
+    name_start = name_end + 1;
+  }
+
+  auto plan = std::make_shared<Plan>();
+  plan->field_path = field_path;
+  plan->field_type = field->type_id_;
+  plan->is_time_field = field->type_id_ == introspection::ROS_TYPE_MESSAGE &&
+    is_time_message(get_nested_members(*field));
+  if (field->type_id_ == introspection::ROS_TYPE_MESSAGE && !plan->is_time_field) {
+    throw std::runtime_error(
+            "Field '" + field_path + "' is a message other than builtin_interfaces/Time or "
+            "builtin_interfaces/Duration and cannot be extracted.");
+  }
+  if (get_primitive_size(field->type_id_) == 0 &&
+    field->type_id_ != introspection::ROS_TYPE_STRING && !plan->is_time_field)
+  {
+    throw std::runtime_error("Field '" + field_path + "' has a type which cannot be extracted.");
+  }
+
+  // The fields up to the first variable sized one are at the same offset in every message.
+  size_t offset = 0;
+  auto variable_step = steps.begin();
+  for (; variable_step != steps.end() && variable_step->kind == Step::Kind::FIXED_SIZE;
+    ++variable_step)
+  {
+    offset += (variable_step->alignment - offset % variable_step->alignment) %
+      variable_step->alignment;
+    offset += variable_step->size;
+  }
+  plan->constant_offset = offset;
+  plan->steps.assign(variable_step, steps.end());
+  plan_ = plan;
+}
+
+uint8_t CdrFieldExtractor::get_field_type() const
+{
+  return plan_->field_type;
+}
+
+int64_t CdrFieldExtractor::extract_integer(
+  const rcutils_uint8_array_t & serialized_message) const
+{
+  if (!is_integer_type(plan_->field_type)) {
+    throw plan_->type_mismatch("an integer");
+  }
+  auto cursor = plan_->locate_field(serialized_message);
+  switch (plan_->field_type) {
+    case introspection::ROS_TYPE_INT8:
+      return cursor.read<int8_t>();
+    case introspection::ROS_TYPE_UINT16:
+      return cursor.read<uint16_t>();
+    case introspection::ROS_TYPE_INT16:
+      return cursor.read<int16_t>();
+    case introspection::ROS_TYPE_UINT32:
+      return cursor.read<uint32_t>();
+    case introspection::ROS_TYPE_INT32:
+      return cursor.read<int32_t>();
+    case introspection::ROS_TYPE_UINT64:
+      return static_cast<int64_t>(cursor.read<uint64_t>());
+    case introspection::ROS_TYPE_INT64:
+      return cursor.read<int64_t>();
+    default:
+      return cursor.read<uint8_t>();
+  }
+}
+
+double CdrFieldExtractor::extract_floating_point(
+  const rcutils_uint8_array_t & serialized_message) const
+{
+  if (plan_->field_type == introspection::ROS_TYPE_FLOAT) {
+    return plan_->locate_field(serialized_message).read<float>();
+  }
+  if (plan_->field_type == introspection::ROS_TYPE_DOUBLE) {
+    return plan_->locate_field(serialized_message).read<double>();
+  }
+  if (!is_integer_type(plan_->field_type)) {
+    throw plan_->type_mismatch("a number");
+  }
+  return static_cast<double>(extract_integer(serialized_message));
+}
+
+std::string CdrFieldExtractor::extract_string(
+  const rcutils_uint8_array_t & serialized_message) const
+{
+  if (plan_->field_type != introspection::ROS_TYPE_STRING) {
+    throw plan_->type_mismatch("a string");
+  }
+  auto cursor = plan_->locate_field(serialized_message);
+  const auto length = cursor.read<uint32_t>();
+  const auto characters = reinterpret_cast<const char *>(cursor.read_bytes(length));
+  // Strings are terminated by a null character, which is included in the length.
+  return std::string(characters, length > 0 ? length - 1 : 0);
+}
+
+rcutils_time_point_value_t CdrFieldExtractor::extract_time(
+  const rcutils_uint8_array_t & serialized_message) const
+{
+  if (!plan_->is_time_field) {
+    throw plan_->type_mismatch("a builtin_interfaces/Time or builtin_interfaces/Duration");
+  }
+  auto cursor = plan_->locate_field(serialized_message);
+  const auto sec = cursor.read<int32_t>();
+  const auto nanosec = cursor.read<uint32_t>();
+  return RCUTILS_S_TO_NS(static_cast<rcutils_time_point_value_t>(sec)) + nanosec;
+}
+
+void CdrFieldExtractor::rewrite_time(
+  rcutils_uint8_array_t & serialized_message, rcutils_time_point_value_t time) const
+{
+  if (!plan_->is_time_field) {
+    throw plan_->type_mismatch("a builtin_interfaces/Time or builtin_interfaces/Duration");
+  }
+  // Rounded down, so the nanoseconds are not negative for times before the epoch.
+  auto sec = time / RCUTILS_S_TO_NS(1);
+  if (time % RCUTILS_S_TO_NS(1) < 0) {
+    --sec;
+  }
+  auto cursor = plan_->locate_field(serialized_message);
+  // Checked before writing, so a truncated message is left unchanged.
+  auto end = cursor;
+  end.read<int32_t>();
+  end.read<uint32_t>();
+  cursor.write(serialized_message, static_cast<int32_t>(sec));
+  cursor.write(serialized_message, static_cast<uint32_t>(time - RCUTILS_S_TO_NS(sec)));
+}
+
+}  // namespace rosbag2_cpp
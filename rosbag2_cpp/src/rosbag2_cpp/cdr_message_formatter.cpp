@@ -0,0 +1,455 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/cdr_message_formatter.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcutils/error_handling.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+#include "./cdr_cursor.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+
+namespace introspection = rosidl_typesupport_introspection_cpp;
+using introspection::MessageMember;
+using introspection::MessageMembers;
+using cdr::Cursor;
+
+struct Field
+{
+  // The name as a JSON key followed by a colon, e.g. "\"stamp\":".
+  std::string json_key;
+  uint8_t type_id;
+  bool is_array;
+  // The length of an array, 0 for a sequence, which is preceded by its length.
+  size_t array_size;
+  // The fields of a nested message.
+  std::vector<Field> members;
+};
+
+enum class Format
+{
+  JSON,
+  CSV,
+};
+
+std::vector<Field> compile_fields(const MessageMembers * members)
+{
+  std::vector<Field> fields;
+  for (uint32_t i = 0; i < members->member_count_; ++i) {
+    const auto & member = members->members_[i];
+    if (member.type_id_ == introspection::ROS_TYPE_LONG_DOUBLE) {
+      throw std::runtime_error(
+              std::string("Field '") + member.name_ + "' is a long double, which cannot be "
+              "formatted.");
+    }
+    Field field;
+    field.json_key = std::string("\"") + member.name_ + "\":";
+    field.type_id = member.type_id_;
+    field.is_array = member.is_array_;
+    field.array_size = member.is_upper_bound_ ? 0 : member.array_size_;
+    if (member.type_id_ == introspection::ROS_TYPE_MESSAGE) {
+      field.members = compile_fields(cdr::get_nested_members(member));
+    }
+    fields.push_back(std::move(field));
+  }
+  return fields;
+}
+
+void append_csv_columns(
+  const MessageMembers * members, const std::string & prefix, std::string & output)
+{
+  for (uint32_t i = 0; i < members->member_count_; ++i) {
+    const auto & member = members->members_[i];
+    if (member.type_id_ == introspection::ROS_TYPE_MESSAGE && !member.is_array_) {
+      append_csv_columns(
+        cdr::get_nested_members(member), prefix + member.name_ + ".", output);
+      continue;
+    }
+    if (!output.empty()) {
+      output.push_back(',');
+    }
+    output += prefix;
+    output += member.name_;
+  }
+}
+
+void append_unsigned(uint64_t value, std::string & output)
+{
+  static const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+  // The longest 64 bit integer has 20 digits.
+  char buffer[20];
+  char * const end = buffer + sizeof(buffer);
+  char * begin = end;
+  while (value >= 100) {
+    const auto pair = static_cast<size_t>(value % 100) * 2;
+    value /= 100;
+    begin -= 2;
+    std::memcpy(begin, kDigitPairs + pair, 2);
+  }
+  if (value >= 10) {
+    begin -= 2;
+    std::memcpy(begin, kDigitPairs + value * 2, 2);
+  } else {
+    *--begin = static_cast<char>('0' + value);
+  }
+  output.append(begin, end);
+}
+
+void append_signed(int64_t value, std::string & output)
+{
+  if (value < 0) {
+    output.push_back('-');
+    // Negating in unsigned arithmetic is defined for the smallest value as well.
+    append_unsigned(0u - static_cast<uint64_t>(value), output);
+  } else {
+    append_unsigned(static_cast<uint64_t>(value), output);
+  }
+}
+
+template<typename T>
+T parse_floating_point(const char * text);
+
+template<>
+float parse_floating_point<float>(const char * text)
+{
+  return std::strtof(text, nullptr);
+}
+
+template<>
+double parse_floating_point<double>(const char * text)
+{
+  return std::strtod(text, nullptr);
+}
+
+// Appends the value with the fewest digits of the usual ones which read back to the value.
+template<typename T>
+void append_floating_point(T value, Format format, std::string & output)
+{
+  if (!std::isfinite(value)) {
+    if (format == Format::JSON) {
+      output += "null";
+    } else {
+      output += std::isnan(value) ? "nan" : value < 0 ? "-inf" : "inf";
+    }
+    return;
+  }
+  // Float and double values read back from 9 and 17 significant digits respectively.
+  const int short_precision = sizeof(T) == sizeof(float) ? 6 : 15;
+  const int exact_precision = sizeof(T) == sizeof(float) ? 9 : 17;
+  char buffer[32];
+  auto length = std::snprintf(
+    buffer, sizeof(buffer), "%.*g", short_precision, static_cast<double>(value));
+  if (parse_floating_point<T>(buffer) != value) {
+    length = std::snprintf(
+      buffer, sizeof(buffer), "%.*g", exact_precision, static_cast<double>(value));
+  }
+  output.append(buffer, static_cast<size_t>(length));
+}
+
+void append_json_character(uint32_t character, std::string & output)
+{
+  static const char kHexDigits[] = "0123456789abcdef";
+  switch (character) {
+    case '"':
+      output += "\\\"";
+      break;
+    case '\\':
+      output += "\\\\";
+      break;
+    case '\n':
+      output += "\\n";
+      break;
+    case '\r':
+      output += "\\r";
+      break;
+    case '\t':
+      output += "\\t";
+      break;
+    default:
+      if (character < 0x20) {
+        output += "\\u00";
+        output.push_back(kHexDigits[character >> 4]);
+        output.push_back(kHexDigits[character & 0xF]);
+      } else {
+        output.push_back(static_cast<char>(character));
+      }
+  }
+}
+
+void append_utf8(uint32_t code_point, Format format, std::string & output)
+{
+  if (code_point < 0x80) {
+    if (format == Format::JSON) {
+      append_json_character(code_point, output);
+    } else {
+      output.push_back(static_cast<char>(code_point));
+    }
+  } else if (code_point < 0x800) {
+    output.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    output.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    output.push_back(static_cast<char>(0xF0 | ((code_point >> 18) & 0x07)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+// Strings are serialized with their terminating null character, which is not appended.
+void append_string(Cursor & cursor, Format format, std::string & output)
+{
+  auto length = static_cast<size_t>(cursor.read<uint32_t>());
+  const auto characters = reinterpret_cast<const char *>(cursor.read_bytes(length));
+  if (length > 0 && characters[length - 1] == '\0') {
+    --length;
+  }
+  if (format == Format::JSON) {
+    output.push_back('"');
+    for (size_t i = 0; i < length; ++i) {
+      append_json_character(static_cast<uint8_t>(characters[i]), output);
+    }
+    output.push_back('"');
+  } else {
+    output.append(characters, length);
+  }
+}
+
+// Wide characters are serialized with four bytes and appended as UTF-8.
+void append_wide_string(Cursor & cursor, Format format, std::string & output)
+{
+  const auto length = cursor.read<uint32_t>();
+  if (format == Format::JSON) {
+    output.push_back('"');
+  }
+  for (uint32_t i = 0; i < length; ++i) {
+    append_utf8(cursor.read<uint32_t>(), format, output);
+  }
+  if (format == Format::JSON) {
+    output.push_back('"');
+  }
+}
+
+void append_json_object(Cursor & cursor, const std::vector<Field> & fields, std::string & output);
+
+void append_json_value(Cursor & cursor, const Field & field, std::string & output)
+{
+  switch (field.type_id) {
+    case introspection::ROS_TYPE_BOOLEAN:
+      output += cursor.read<uint8_t>() != 0 ? "true" : "false";
+      break;
+    case introspection::ROS_TYPE_CHAR:
+    case introspection::ROS_TYPE_OCTET:
+    case introspection::ROS_TYPE_UINT8:
+      append_unsigned(cursor.read<uint8_t>(), output);
+      break;
+    case introspection::ROS_TYPE_INT8:
+      append_signed(cursor.read<int8_t>(), output);
+      break;
+    case introspection::ROS_TYPE_UINT16:
+      append_unsigned(cursor.read<uint16_t>(), output);
+      break;
+    case introspection::ROS_TYPE_INT16:
+      append_signed(cursor.read<int16_t>(), output);
+      break;
+    case introspection::ROS_TYPE_UINT32:
+      append_unsigned(cursor.read<uint32_t>(), output);
+      break;
+    case introspection::ROS_TYPE_INT32:
+      append_signed(cursor.read<int32_t>(), output);
+      break;
+    case introspection::ROS_TYPE_UINT64:
+      append_unsigned(cursor.read<uint64_t>(), output);
+      break;
+    case introspection::ROS_TYPE_INT64:
+      append_signed(cursor.read<int64_t>(), output);
+      break;
+    case introspection::ROS_TYPE_FLOAT:
+      append_floating_point(cursor.read<float>(), Format::JSON, output);
+      break;
+    case introspection::ROS_TYPE_DOUBLE:
+      append_floating_point(cursor.read<double>(), Format::JSON, output);
+      break;
+    case introspection::ROS_TYPE_STRING:
+      append_string(cursor, Format::JSON, output);
+      break;
+    case introspection::ROS_TYPE_WSTRING:
+      append_wide_string(cursor, Format::JSON, output);
+      break;
+    default:
+      append_json_object(cursor, field.members, output);
+  }
+}
+
+// Appends a value, or an array or sequence of values.
+void append_json_field(Cursor & cursor, const Field & field, std::string & output)
+{
+  if (!field.is_array) {
+    append_json_value(cursor, field, output);
+    return;
+  }
+  const size_t count = field.array_size > 0 ? field.array_size : cursor.read<uint32_t>();
+  output.push_back('[');
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0) {
+      output.push_back(',');
+    }
+    append_json_value(cursor, field, output);
+  }
+  output.push_back(']');
+}
+
+void append_json_object(Cursor & cursor, const std::vector<Field> & fields, std::string & output)
+{
+  output.push_back('{');
+  for (size_t i = 0; i < fields.size(); ++i) {
+    if (i > 0) {
+      output.push_back(',');
+    }
+    output += fields[i].json_key;
+    append_json_field(cursor, fields[i], output);
+  }
+  output.push_back('}');
+}
+
+// Quotes the text from begin to the end of the output in place if it has to be or contains
+// characters which would otherwise end the cell, doubling the quotes within it.
+void quote_csv_cell(size_t begin, bool always, std::string & output)
+{
+  size_t quote_count = 0;
+  bool needs_quotes = always;
+  for (size_t i = begin; i < output.size(); ++i) {
+    const char character = output[i];
+    quote_count += character == '"' ? 1 : 0;
+    needs_quotes = needs_quotes || character == ',' || character == '"' || character == '\n' ||
+      character == '\r';
+  }
+  if (!needs_quotes) {
+    return;
+  }
+  auto source = output.size();
+  output.resize(output.size() + quote_count + 2);
+  auto destination = output.size();
+  output[--destination] = '"';
+  while (source > begin) {
+    const char character = output[--source];
+    output[--destination] = character;
+    if (character == '"') {
+      output[--destination] = '"';
+    }
+  }
+  output[--destination] = '"';
+}
+
+void append_csv_cells(
+  Cursor & cursor, const std::vector<Field> & fields, bool & is_first_cell, std::string & output)
+{
+  for (const auto & field : fields) {
+    if (field.type_id == introspection::ROS_TYPE_MESSAGE && !field.is_array) {
+      append_csv_cells(cursor, field.members, is_first_cell, output);
+      continue;
+    }
+    if (!is_first_cell) {
+      output.push_back(',');
+    }
+    is_first_cell = false;
+    const auto cell_begin = output.size();
+    if (field.is_array) {
+      append_json_field(cursor, field, output);
+      quote_csv_cell(cell_begin, true, output);
+    } else if (field.type_id == introspection::ROS_TYPE_STRING) {
+      append_string(cursor, Format::CSV, output);
+      quote_csv_cell(cell_begin, false, output);
+    } else if (field.type_id == introspection::ROS_TYPE_WSTRING) {
+      append_wide_string(cursor, Format::CSV, output);
+      quote_csv_cell(cell_begin, false, output);
+    } else if (field.type_id == introspection::ROS_TYPE_FLOAT) {
+      append_floating_point(cursor.read<float>(), Format::CSV, output);
+    } else if (field.type_id == introspection::ROS_TYPE_DOUBLE) {
+      append_floating_point(cursor.read<double>(), Format::CSV, output);
+    } else {
+      append_json_value(cursor, field, output);
+    }
+  }
+}
+
+}  // namespace
+
+struct CdrMessageFormatter::Plan
+{
+  std::vector<Field> fields;
+  std::string csv_header;
+};
+
+CdrMessageFormatter::CdrMessageFormatter(const rosidl_message_type_support_t * type_support)
+{
+  const auto introspection_type_support = get_message_typesupport_handle(
+    type_support, introspection::typesupport_identifier);
+  if (!introspection_type_support) {
+    rcutils_reset_error();
+    throw std::runtime_error("No introspection type support found for message type.");
+  }
+
+  const auto members = static_cast<const MessageMembers *>(introspection_type_support->data);
+  auto plan = std::make_shared<Plan>();
+  plan->fields = compile_fields(members);
+  append_csv_columns(members, "", plan->csv_header);
+  plan_ = plan;
+}
+
+void CdrMessageFormatter::append_json(
+  const rcutils_uint8_array_t & serialized_message, std::string & output) const
+{
+  Cursor cursor{serialized_message};
+  append_json_object(cursor, plan_->fields, output);
+}
+
+void CdrMessageFormatter::append_csv_header(std::string & output) const
+{
+  output += plan_->csv_header;
+}
+
+void CdrMessageFormatter::append_csv_row(
+  const rcutils_uint8_array_t & serialized_message, std::string & output) const
+{
+  Cursor cursor{serialized_message};
+  bool is_first_cell = true;
+  append_csv_cells(cursor, plan_->fields, is_first_cell, output);
+}
+
+}  // namespace rosbag2_cpp
@@ -0,0 +1,340 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/columnar_exporter.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+#include "rcpputils/shared_library.hpp"
+
+#include "rosbag2_cpp/cdr_field_extractor.hpp"
+#include "rosbag2_cpp/logging.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+
+namespace introspection = rosidl_typesupport_introspection_cpp;
+
+using MessageBatch = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+
+// Batches queued for a topic at most, so reading does not run ahead of the extraction.
+constexpr size_t kMaxQueuedBatches = 4;
+
+bool is_floating_point_field(uint8_t field_type)
+{
+  return field_type == introspection::ROS_TYPE_FLOAT ||
+         field_type == introspection::ROS_TYPE_DOUBLE;
+}
+
+// Extracts the columns of one topic from batches of its messages on a thread of its own.
+class TopicColumnsExtractor
+{
+public:
+  TopicColumnsExtractor(
+    const rosidl_message_type_support_t * type_support, const ColumnarTopic & topic,
+    TopicColumns & topic_columns)
+  : topic_columns_(topic_columns)
+  {
+    for (const auto & field_path : topic.field_paths) {
+      extractors_.emplace_back(type_support, field_path);
+      const auto field_type = extractors_.back().get_field_type();
+      if (field_type == introspection::ROS_TYPE_STRING ||
+        field_type == introspection::ROS_TYPE_WSTRING ||
+        field_type == introspection::ROS_TYPE_LONG_DOUBLE)
+      {
+        throw std::runtime_error(
+                "Field '" + field_path + "' of topic '" + topic.topic_name +
+                "' is not a number and cannot be exported.");
+      }
+      topic_columns_.columns.push_back({field_path, field_type, {}, {}, {}});
+    }
+    thread_ = std::thread(&TopicColumnsExtractor::extract_batches, this);
+  }
+
+  ~TopicColumnsExtractor()
+  {
+    if (!thread_.joinable()) {
+      return;
+    }
+    // Only reached without finish() if exporting failed already, so the error is only logged.
+    try {
+      finish();
+    } catch (const std::exception & e) {
+      ROSBAG2_CPP_LOG_ERROR_STREAM("Failed to extract columns: " << e.what());
+    }
+  }
+
+  // Blocks while kMaxQueuedBatches batches of the topic are waiting to be extracted.
+  // Returns an empty batch whose capacity is reused, if a batch was extracted already.
+  MessageBatch push(MessageBatch batch)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    batch_extracted_.wait(lock, [this] {return queued_batches_.size() < kMaxQueuedBatches;});
+    queued_batches_.push_back(std::move(batch));
+    batch_queued_.notify_one();
+    MessageBatch extracted_batch;
+    if (!extracted_batches_.empty()) {
+      extracted_batch = std::move(extracted_batches_.back());
+      extracted_batches_.pop_back();
+    }
+    return extracted_batch;
+  }
+
+  /// \throws std::runtime_error if a message could not be extracted.
+  void finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_finished_ = true;
+    }
+    batch_queued_.notify_one();
+    thread_.join();
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+private:
+  void extract_batches()
+  {
+    ThreadPool::configure_current_thread();
+    while (true) {
+      MessageBatch batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batch_queued_.wait(lock, [this] {return is_finished_ || !queued_batches_.empty();});
+        if (queued_batches_.empty()) {
+          return;
+        }
+        batch = std::move(queued_batches_.front());
+        queued_batches_.pop_front();
+      }
+      batch_extracted_.notify_one();
+      // Once extracting failed, the remaining batches are discarded.
+      if (!error_) {
+        try {
+          extract(batch);
+        } catch (...) {
+          error_ = std::current_exception();
+        }
+      }
+      // The messages are released, while the batch is kept for being filled again.
+      batch.clear();
+      std::lock_guard<std::mutex> lock(mutex_);
+      extracted_batches_.push_back(std::move(batch));
+    }
+  }
+
+  void extract(const MessageBatch & batch)
+  {
+    for (const auto & message : batch) {
+      topic_columns_.time_stamps.push_back(message->time_stamp);
+    }
+    for (size_t i = 0; i < extractors_.size(); ++i) {
+      const auto & extractor = extractors_[i];
+      auto & column = topic_columns_.columns[i];
+      if (is_floating_point_field(column.field_type)) {
+        for (const auto & message : batch) {
+          column.floating_points.push_back(
+            extractor.extract_floating_point(*message->serialized_data));
+        }
+      } else if (column.field_type == introspection::ROS_TYPE_MESSAGE) {
+        for (const auto & message : batch) {
+          column.integers.push_back(extractor.extract_time(*message->serialized_data));
+        }
+      } else if (column.field_type == introspection::ROS_TYPE_UINT64) {
+        // The extractor returns the bits of the uint64 value, which are converted back.
+        for (const auto & message : batch) {
+          column.unsigned_integers.push_back(
+            static_cast<uint64_t>(extractor.extract_integer(*message->serialized_data)));
+        }
+      } else {
+        for (const auto & message : batch) {
+          column.integers.push_back(extractor.extract_integer(*message->serialized_data));
+        }
+      }
+    }
+  }
+
+  std::vector<CdrFieldExtractor> extractors_;
+  TopicColumns & topic_columns_;
+  std::deque<MessageBatch> queued_batches_;
+  std::vector<MessageBatch> extracted_batches_;
+  bool is_finished_ {false};
+  std::mutex mutex_;
+  std::condition_variable batch_queued_;
+  std::condition_variable batch_extracted_;
+  std::exception_ptr error_;
+  std::thread thread_;
+};
+
+// Writes a one-dimensional array in the NumPy .npy format, version 1.0.
+template<typename T>
+void write_npy_file(
+  const rcpputils::fs::path & file_path, char type_kind, const std::vector<T> & values)
+{
+  const uint16_t one = 1;
+  const char byte_order = *reinterpret_cast<const uint8_t *>(&one) == 1 ? '<' : '>';
+  std::string header = "{'descr': '" + std::string(1, byte_order) + type_kind +
+    std::to_string(sizeof(T)) + "', 'fortran_order': False, 'shape': (" +
+    std::to_string(values.size()) + ",), }";
+  // The magic string, version and header length take 10 bytes, the data starts aligned to 64.
+  const size_t prefix_size = 10;
+  header.append(63 - (prefix_size + header.size()) % 64, ' ');
+  header.push_back('\n');
+
+  std::ofstream file(file_path.string(), std::ios::binary);
+  const auto header_size = static_cast<uint16_t>(header.size());
+  const char prefix[prefix_size] = {
+    '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+    static_cast<char>(header_size & 0xFF), static_cast<char>(header_size >> 8)};
+  file.write(prefix, prefix_size);
+  file.write(header.data(), header.size());
+  file.write(
+    reinterpret_cast<const char *>(values.data()),
+    static_cast<std::streamsize>(values.size() * sizeof(T)));
+  if (!file) {
+    throw std::runtime_error("Failed to write \"" + file_path.string() + "\".");
+  }
+}
+
+}  // namespace
+
+ColumnarExporter::ColumnarExporter(std::vector<ColumnarTopic> topics, size_t batch_size)
+: topics_(std::move(topics)), batch_size_(std::max<size_t>(batch_size, 1u))
+{}
+
+std::vector<TopicColumns> ColumnarExporter::export_columns(
+  Reader & reader, rosbag2_storage::StorageFilter storage_filter) const
+{
+  const auto bag_topics = reader.get_all_topics_and_types();
+  std::vector<TopicColumns> topics_columns(topics_.size());
+  std::vector<std::shared_ptr<rcpputils::SharedLibrary>> libraries(topics_.size());
+  std::unordered_map<std::string, size_t> topic_indices;
+  storage_filter.topics.clear();
+  storage_filter.topics_regex.clear();
+  storage_filter.topic_types.clear();
+
+  for (size_t i = 0; i < topics_.size(); ++i) {
+    const auto & topic_name = topics_[i].topic_name;
+    const auto bag_topic = std::find_if(
+      bag_topics.begin(), bag_topics.end(),
+      [&topic_name](const rosbag2_storage::TopicMetadata & topic) {
+        return topic.name == topic_name;
+      });
+    if (bag_topic == bag_topics.end()) {
+      throw std::runtime_error("Topic '" + topic_name + "' is not in the bag.");
+    }
+    if (bag_topic->serialization_format != "cdr") {
+      throw std::runtime_error(
+              "Topic '" + topic_name + "' is serialized as '" + bag_topic->serialization_format +
+              "' instead of CDR.");
+    }
+    topics_columns[i].topic_name = topic_name;
+    topics_columns[i].topic_type = bag_topic->type;
+    topic_indices.emplace(topic_name, i);
+    storage_filter.topics.push_back(topic_name);
+  }
+
+  // The extractors are destroyed before the libraries of their type supports.
+  std::vector<std::unique_ptr<TopicColumnsExtractor>> extractors;
+  for (size_t i = 0; i < topics_.size(); ++i) {
+    const auto type_support = get_typesupport(
+      topics_columns[i].topic_type, "rosidl_typesupport_cpp", libraries[i]);
+    extractors.push_back(
+      std::make_unique<TopicColumnsExtractor>(type_support, topics_[i], topics_columns[i]));
+  }
+
+  reader.set_filter(storage_filter);
+  std::vector<MessageBatch> batches(topics_.size());
+  while (reader.has_next()) {
+    auto message = reader.read_next();
+    const auto topic_index = topic_indices.find(message->topic_name);
+    if (topic_index == topic_indices.end()) {
+      continue;
+    }
+    auto & batch = batches[topic_index->second];
+    batch.push_back(std::move(message));
+    if (batch.size() >= batch_size_) {
+      batch = extractors[topic_index->second]->push(std::move(batch));
+      batch.reserve(batch_size_);
+    }
+  }
+  for (size_t i = 0; i < topics_.size(); ++i) {
+    if (!batches[i].empty()) {
+      extractors[i]->push(std::move(batches[i]));
+    }
+    extractors[i]->finish();
+  }
+  return topics_columns;
+}
+
+void ColumnarExporter::write_npy_files(
+  const std::vector<TopicColumns> & topics_columns, const std::string & directory)
+{
+  for (const auto & topic_columns : topics_columns) {
+    auto topic_folder = rcpputils::fs::path(directory);
+    // Every part of the topic name is a folder of its own.
+    std::string::size_type name_start = 0;
+    while (name_start < topic_columns.topic_name.size()) {
+      auto name_end = topic_columns.topic_name.find('/', name_start);
+      if (name_end == std::string::npos) {
+        name_end = topic_columns.topic_name.size();
+      }
+      if (name_end > name_start) {
+        topic_folder = topic_folder /
+          topic_columns.topic_name.substr(name_start, name_end - name_start);
+      }
+      name_start = name_end + 1;
+    }
+    if (!topic_folder.is_directory() && !rcpputils::fs::create_directories(topic_folder)) {
+      throw std::runtime_error("Failed to create folder \"" + topic_folder.string() + "\".");
+    }
+
+    write_npy_file(topic_folder / "time_stamp.npy", 'i', topic_columns.time_stamps);
+    for (const auto & column : topic_columns.columns) {
+      const auto file_path = topic_folder / (column.field_path + ".npy");
+      if (is_floating_point_field(column.field_type)) {
+        write_npy_file(file_path, 'f', column.floating_points);
+      } else if (column.field_type == introspection::ROS_TYPE_UINT64) {
+        write_npy_file(file_path, 'u', column.unsigned_integers);
+      } else {
+        write_npy_file(file_path, 'i', column.integers);
+      }
+    }
+  }
+}
+
+}  // namespace rosbag2_cpp
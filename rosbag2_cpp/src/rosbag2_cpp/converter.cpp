@@ -14,15 +14,21 @@
 
 #include "rosbag2_cpp/converter.hpp"
 
+#include <algorithm>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "rosbag2_cpp/info.hpp"
 #include "rosbag2_cpp/typesupport_helpers.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_cpp/types/introspection_message.hpp"
 
 #include "rosbag2_storage/metadata_io.hpp"
 #include "rosbag2_storage/ros_helper.hpp"
@@ -30,6 +36,13 @@
 namespace rosbag2_cpp
 {
 
+namespace
+{
+// Maximum number of messages passed to a single batch call of the converter plugins, which
+// bounds the ROS messages kept for every topic.
+constexpr const size_t kMaxPluginBatchSize = 64;
+}  // namespace
+
 Converter::Converter(
   const std::string & input_format,
   const std::string & output_format,
@@ -41,24 +54,51 @@ Converter::Converter(
   const ConverterOptions & converter_options,
   std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory)
 : converter_factory_(converter_factory),
-  input_converter_(converter_factory_->load_deserializer(
-      converter_options.input_serialization_format)),
-  output_converter_(converter_factory_->load_serializer(
-      converter_options.output_serialization_format))
+  input_format_(converter_options.input_serialization_format),
+  output_format_(converter_options.output_serialization_format),
+  passes_through_(input_format_ == output_format_)
 {
-  if (!input_converter_) {
-    throw std::runtime_error(
-            "Could not find converter for format " + converter_options.input_serialization_format);
+  // Messages of the same format are passed through without being deserialized, so neither
+  // plugins nor threads are needed.
+  if (passes_through_) {
+    return;
+  }
+  auto input_converter = converter_factory_->load_deserializer(input_format_);
+  output_converter_ = converter_factory_->load_serializer(output_format_);
+  if (!input_converter) {
+    throw std::runtime_error("Could not find converter for format " + input_format_);
   }
   if (!output_converter_) {
-    throw std::runtime_error(
-            "Could not find converter for format " + converter_options.output_serialization_format);
+    throw std::runtime_error("Could not find converter for format " + output_format_);
+  }
+  input_converters_.emplace(input_format_, std::move(input_converter));
+
+  // Each worker has its own converter, which keeps its messages for reuse.
+  for (size_t i = 0; i < converter_options.conversion_threads; ++i) {
+    workers_.push_back(std::make_unique<ConversionWorker>());
+    workers_.back()->converter = std::make_unique<Converter>(
+      ConverterOptions{
+        converter_options.input_serialization_format,
+        converter_options.output_serialization_format},
+      converter_factory_);
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread = std::thread(&Converter::run_conversion_worker, this, i);
   }
 }
 
 Converter::~Converter()
 {
-  input_converter_.reset();
+  {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    stop_workers_ = true;
+  }
+  batch_available_.notify_all();
+  for (auto & worker : workers_) {
+    worker->thread.join();
+  }
+  workers_.clear();
+  input_converters_.clear();
   output_converter_.reset();
   converter_factory_.reset();  // needs to be destroyed only after the converters
 }
@@ -66,21 +106,245 @@ Converter::~Converter()
 std::shared_ptr<rosbag2_storage::SerializedBagMessage> Converter::convert(
   std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
 {
-  auto ts = topics_and_types_.at(message->topic_name).rmw_type_support;
-  auto introspection_ts = topics_and_types_.at(message->topic_name).introspection_type_support;
-  auto allocator = rcutils_get_default_allocator();
-  std::shared_ptr<rosbag2_introspection_message_t> allocated_ros_message =
-    allocate_introspection_message(introspection_ts, &allocator);
+  if (passes_through_) {
+    // Shares the serialized data, which is left untouched.
+    return std::make_shared<rosbag2_storage::SerializedBagMessage>(*message);
+  }
+  auto & topic = topics_and_types_.at(message->topic_name);
+  if (!topic.input_converter) {
+    return std::make_shared<rosbag2_storage::SerializedBagMessage>(*message);
+  }
+  auto ts = topic.type_support.rmw_type_support;
+  // The message of the topic is deserialized into again, which reuses the memory of its fields.
+  const auto ros_message = get_ros_message(topic, 0);
 
-  input_converter_->deserialize(message, ts, allocated_ros_message);
-  auto output_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
-  output_message->serialized_data = rosbag2_storage::make_empty_serialized_message(0);
-  output_converter_->serialize(allocated_ros_message, ts, output_message);
+  topic.input_converter->deserialize(message, ts, ros_message);
+  // Pooled, and sized like the last message of the topic, so serializing rarely has to grow it.
+  auto output_message = message_pool_.make_message();
+  output_message->serialized_data =
+    message_pool_.make_empty_serialized_message(topic.last_serialized_size);
+  output_converter_->serialize(ros_message, ts, output_message);
+  topic.last_serialized_size = output_message->serialized_data->buffer_length;
+  // Not part of the ROS message.
+  output_message->topic_handle = message->topic_handle;
+  output_message->publish_time_stamp = message->publish_time_stamp;
   return output_message;
 }
 
+void Converter::convert(
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages)
+{
+  convert_batch(messages);
+}
+
+void Converter::convert(
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
+{
+  convert_batch(messages);
+}
+
+template<typename MessageT>
+void Converter::convert_batch(std::vector<std::shared_ptr<MessageT>> & messages)
+{
+  if (passes_through_) {
+    return;
+  }
+  if (workers_.empty() || messages.size() < 2) {
+    convert_range(messages, 0, messages.size());
+    return;
+  }
+
+  // Consecutive parts, so messages of a topic mostly stay with the same converter.
+  const auto part_size = (messages.size() + workers_.size()) / (workers_.size() + 1);
+  auto convert_part = [&messages, part_size](size_t part, Converter & converter) {
+      const auto begin = std::min(messages.size(), part * part_size);
+      const auto end = std::min(messages.size(), begin + part_size);
+      converter.convert_range(messages, begin, end);
+    };
+  {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    batch_job_ = convert_part;
+    pending_workers_ = workers_.size();
+    worker_error_ = nullptr;
+    ++batch_generation_;
+  }
+  batch_available_.notify_all();
+
+  std::exception_ptr error;
+  try {
+    convert_part(0, *this);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  {
+    // The workers reference the batch until they are done.
+    std::unique_lock<std::mutex> lock(batch_mutex_);
+    batch_done_.wait(lock, [this]() {return pending_workers_ == 0;});
+    batch_job_ = nullptr;
+    if (!error) {
+      error = worker_error_;
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+template<typename MessageT>
+void Converter::convert_range(
+  std::vector<std::shared_ptr<MessageT>> & messages, size_t begin, size_t end)
+{
+  auto & batch = plugin_batch_;
+  // Left over if a plugin threw.
+  batch.clear();
+  for (auto i = begin; i < end; ++i) {
+    auto & topic = topics_and_types_.at(messages[i]->topic_name);
+    // Messages of topics stored in the output format are left as they are.
+    if (!topic.input_converter) {
+      continue;
+    }
+    // A batch is deserialized by a single plugin.
+    if (!batch.indices.empty() &&
+      (batch.indices.size() == kMaxPluginBatchSize ||
+      batch.input_converter != topic.input_converter))
+    {
+      convert_plugin_batch(messages);
+    }
+    batch.input_converter = topic.input_converter;
+    // Messages of the same topic in the batch are deserialized into ROS messages of their own.
+    const auto ros_message = get_ros_message(topic, batch.topic_message_counts[&topic]++);
+    // Pooled, and sized like the last message of the topic.
+    auto output_message = message_pool_.make_message();
+    output_message->serialized_data =
+      message_pool_.make_empty_serialized_message(topic.last_serialized_size);
+    batch.input_messages.push_back(messages[i]);
+    batch.type_supports.push_back(topic.type_support.rmw_type_support);
+    batch.ros_messages.push_back(ros_message);
+    batch.const_ros_messages.push_back(ros_message);
+    batch.output_messages.push_back(output_message);
+    batch.topics.push_back(&topic);
+    batch.indices.push_back(i);
+  }
+  if (!batch.indices.empty()) {
+    convert_plugin_batch(messages);
+  }
+}
+
+template<typename MessageT>
+void Converter::convert_plugin_batch(std::vector<std::shared_ptr<MessageT>> & messages)
+{
+  auto & batch = plugin_batch_;
+  batch.input_converter->deserialize_batch(
+    batch.input_messages, batch.type_supports, batch.ros_messages);
+  output_converter_->serialize_batch(
+    batch.const_ros_messages, batch.type_supports, batch.output_messages);
+
+  for (size_t j = 0; j < batch.output_messages.size(); ++j) {
+    auto & output_message = batch.output_messages[j];
+    const auto & input_message = batch.input_messages[j];
+    batch.topics[j]->last_serialized_size = output_message->serialized_data->buffer_length;
+    // Not part of the ROS message.
+    output_message->topic_handle = input_message->topic_handle;
+    output_message->publish_time_stamp = input_message->publish_time_stamp;
+    messages[batch.indices[j]] = std::move(output_message);
+  }
+  // The messages are referenced by the converted ones.
+  batch.clear();
+}
+
+void Converter::PluginBatch::clear()
+{
+  input_messages.clear();
+  type_supports.clear();
+  ros_messages.clear();
+  const_ros_messages.clear();
+  output_messages.clear();
+  topics.clear();
+  topic_message_counts.clear();
+  indices.clear();
+}
+
+std::shared_ptr<rosbag2_introspection_message_t> Converter::get_ros_message(
+  ConvertedTopic & topic, size_t index)
+{
+  while (topic.ros_messages.size() <= index) {
+    auto allocator = rcutils_get_default_allocator();
+    topic.ros_messages.push_back(
+      allocate_introspection_message(topic.type_support.introspection_type_support, &allocator));
+  }
+  return topic.ros_messages[index];
+}
+
+void Converter::run_conversion_worker(size_t worker_index)
+{
+  ThreadPool::configure_current_thread();
+  uint64_t generation = 0;
+  while (true) {
+    std::function<void(size_t, Converter &)> job;
+    {
+      std::unique_lock<std::mutex> lock(batch_mutex_);
+      batch_available_.wait(
+        lock, [this, generation]() {return stop_workers_ || batch_generation_ != generation;});
+      if (stop_workers_) {
+        return;
+      }
+      generation = batch_generation_;
+      job = batch_job_;
+    }
+
+    std::exception_ptr error;
+    try {
+      job(worker_index + 1, *workers_[worker_index]->converter);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      if (error && !worker_error_) {
+        worker_error_ = error;
+      }
+      --pending_workers_;
+    }
+    batch_done_.notify_one();
+  }
+}
+
+converter_interfaces::SerializationFormatDeserializer * Converter::get_input_converter(
+  const std::string & serialization_format)
+{
+  auto & input_converter = input_converters_[serialization_format];
+  if (!input_converter) {
+    input_converter = converter_factory_->load_deserializer(serialization_format);
+    if (!input_converter) {
+      input_converters_.erase(serialization_format);
+      throw std::runtime_error("Could not find converter for format " + serialization_format);
+    }
+  }
+  return input_converter.get();
+}
+
 void Converter::add_topic(const std::string & topic, const std::string & type)
 {
+  add_topic(topic, type, input_format_);
+}
+
+void Converter::add_topic(
+  const std::string & topic, const std::string & type, const std::string & serialization_format)
+{
+  // Neither type support nor plugins are needed to pass messages through.
+  if (serialization_format == output_format_) {
+    topics_and_types_.insert({topic, ConvertedTopic{{}, nullptr, {}, 0}});
+    return;
+  }
+  auto input_converter = get_input_converter(serialization_format);
+  if (!output_converter_) {
+    output_converter_ = converter_factory_->load_serializer(output_format_);
+    if (!output_converter_) {
+      throw std::runtime_error("Could not find converter for format " + output_format_);
+    }
+  }
+  passes_through_ = false;
+
   ConverterTypeSupport type_support;
   type_support.rmw_type_support = get_typesupport(
     type, "rosidl_typesupport_cpp",
@@ -90,7 +354,10 @@ void Converter::add_topic(const std::string & topic, const std::string & type)
     type, "rosidl_typesupport_introspection_cpp",
     library_rosidl_typesupport_introspection_cpp_);
 
-  topics_and_types_.insert({topic, type_support});
+  topics_and_types_.insert({topic, ConvertedTopic{type_support, input_converter, {}, 0}});
+  for (auto & worker : workers_) {
+    worker->converter->add_topic(topic, type, serialization_format);
+  }
 }
 
 }  // namespace rosbag2_cpp
@@ -0,0 +1,495 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/dataset_exporter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+
+using Sample = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+
+// Partitions per thread if their number is not given.
+constexpr size_t kPartitionsPerThread = 4;
+constexpr size_t kTarBlockSize = 512;
+// Largest file size of the 11 octal digits of a tar header.
+constexpr uint64_t kMaxTarFileSize = (uint64_t{1} << 33) - 1;
+
+// The shards of a partition.
+struct PartitionShards
+{
+  // Shards holding the samples per shard.
+  std::vector<std::string> full_shard_paths;
+  // The samples which did not fill a shard, without the end of a tar archive, if any.
+  std::string rest_path;
+  // Offset of the end of every sample of the rest.
+  std::vector<uint64_t> rest_sample_ends;
+  uint64_t sample_count = 0;
+};
+
+uint32_t crc32c(const uint8_t * data, size_t size)
+{
+  static const auto table = []() {
+      std::array<uint32_t, 256> crc_table;
+      for (uint32_t i = 0; i < crc_table.size(); ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+          crc = (crc >> 1) ^ ((crc & 1u) ? 0x82F63B78u : 0u);
+        }
+        crc_table[i] = crc;
+      }
+      return crc_table;
+    }();
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// The checksum of TFRecord files, masked as data may hold checksums of its own.
+uint32_t masked_crc32c(const char * data, size_t size)
+{
+  const auto crc = crc32c(reinterpret_cast<const uint8_t *>(data), size);
+  return ((crc >> 15) | (crc << 17)) + 0xA282EAD8u;
+}
+
+void append_little_endian(std::string & buffer, uint64_t value, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFFu));
+  }
+}
+
+size_t varint_size(uint64_t value)
+{
+  size_t size = 1;
+  while (value >= 0x80u) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+void append_varint(std::string & buffer, uint64_t value)
+{
+  while (value >= 0x80u) {
+    buffer.push_back(static_cast<char>((value & 0x7Fu) | 0x80u));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<char>(value));
+}
+
+// Size of a length delimited protobuf field of number 1 to 15 and the given content size.
+size_t field_size(size_t content_size)
+{
+  return 1 + varint_size(content_size) + content_size;
+}
+
+void append_field_header(std::string & buffer, uint8_t field_number, size_t content_size)
+{
+  // Wire type 2 is length delimited.
+  buffer.push_back(static_cast<char>(field_number << 3 | 2));
+  append_varint(buffer, content_size);
+}
+
+// Appends an entry of the feature map of tf.train.Features. The list of the feature is a
+// BytesList (field 1 of Feature) or an Int64List (field 3), whose values, field 1 of both, are
+// the given bytes.
+void append_feature(
+  std::string & buffer, const std::string & key, uint8_t list_field_number,
+  const char * values, size_t values_size)
+{
+  const auto list_size = field_size(values_size);
+  const auto feature_size = field_size(list_size);
+  append_field_header(buffer, 1, field_size(key.size()) + field_size(feature_size));
+  append_field_header(buffer, 1, key.size());
+  buffer.append(key);
+  append_field_header(buffer, 2, feature_size);
+  append_field_header(buffer, list_field_number, list_size);
+  append_field_header(buffer, 1, values_size);
+  buffer.append(values, values_size);
+}
+
+size_t feature_entry_size(const std::string & key, size_t values_size)
+{
+  return field_size(field_size(key.size()) + field_size(field_size(field_size(values_size))));
+}
+
+// Appends a TFRecord of a tf.train.Example of the sample.
+void append_tfrecord(
+  std::string & buffer, const std::vector<std::string> & topics, const Sample & sample)
+{
+  std::vector<std::string> time_stamps(sample.size());
+  std::vector<std::string> time_stamp_keys(sample.size());
+  size_t features_size = 0;
+  for (size_t i = 0; i < sample.size(); ++i) {
+    // int64 values are packed as varints of their two's complement.
+    append_varint(time_stamps[i], static_cast<uint64_t>(sample[i]->time_stamp));
+    time_stamp_keys[i] = topics[i] + "/time_stamp";
+    features_size +=
+      feature_entry_size(topics[i], sample[i]->serialized_data->buffer_length) +
+      feature_entry_size(time_stamp_keys[i], time_stamps[i].size());
+  }
+
+  const auto record_start = buffer.size();
+  // Length and its checksum, filled in once the example is complete.
+  buffer.append(12, '\0');
+  const auto data_start = buffer.size();
+  append_field_header(buffer, 1, features_size);
+  for (size_t i = 0; i < sample.size(); ++i) {
+    const auto & data = *sample[i]->serialized_data;
+    append_feature(
+      buffer, topics[i], 1, reinterpret_cast<const char *>(data.buffer), data.buffer_length);
+    append_feature(
+      buffer, time_stamp_keys[i], 3, time_stamps[i].data(), time_stamps[i].size());
+  }
+  const auto data_size = buffer.size() - data_start;
+
+  std::string length;
+  append_little_endian(length, data_size, 8);
+  append_little_endian(length, masked_crc32c(length.data(), length.size()), 4);
+  buffer.replace(record_start, length.size(), length);
+  append_little_endian(buffer, masked_crc32c(buffer.data() + data_start, data_size), 4);
+}
+
+// Appends a file to a tar archive as a ustar header and its data, padded to whole blocks.
+void append_tar_file(
+  std::string & buffer, const std::string & name, const char * data, size_t size)
+{
+  if (name.size() > 100) {
+    throw std::runtime_error(
+            "File name \"" + name + "\" is longer than the 100 characters of a tar header.");
+  }
+  if (size > kMaxTarFileSize) {
+    throw std::runtime_error("File \"" + name + "\" is too large for a tar header.");
+  }
+  char header[kTarBlockSize] = {};
+  std::memcpy(header, name.data(), name.size());
+  std::snprintf(header + 100, 8, "%07o", 0644u);
+  std::snprintf(header + 108, 8, "%07o", 0u);
+  std::snprintf(header + 116, 8, "%07o", 0u);
+  std::snprintf(header + 124, 12, "%011" PRIo64, static_cast<uint64_t>(size));
+  std::snprintf(header + 136, 12, "%011o", 0u);
+  header[156] = '0';
+  std::memcpy(header + 257, "ustar", 6);
+  std::memcpy(header + 263, "00", 2);
+  // The checksum is summed with its own field taken as spaces.
+  std::memset(header + 148, ' ', 8);
+  unsigned int checksum = 0;
+  for (const auto byte : header) {
+    checksum += static_cast<unsigned char>(byte);
+  }
+  std::snprintf(header + 148, 7, "%06o", checksum);
+
+  buffer.append(header, kTarBlockSize);
+  buffer.append(data, size);
+  buffer.append((kTarBlockSize - size % kTarBlockSize) % kTarBlockSize, '\0');
+}
+
+// Appends the files of a sample to a tar archive for WebDataset.
+void append_webdataset_sample(
+  std::string & buffer, const std::string & key, const std::vector<std::string> & file_names,
+  const std::vector<std::string> & topics, const Sample & sample)
+{
+  std::string json = "{\"time_stamps\":{";
+  for (size_t i = 0; i < sample.size(); ++i) {
+    const auto & data = *sample[i]->serialized_data;
+    append_tar_file(
+      buffer, key + file_names[i], reinterpret_cast<const char *>(data.buffer),
+      data.buffer_length);
+    if (i > 0) {
+      json.push_back(',');
+    }
+    json += "\"" + topics[i] + "\":" + std::to_string(sample[i]->time_stamp);
+  }
+  json += "}}";
+  append_tar_file(buffer, key + ".json", json.data(), json.size());
+}
+
+std::string shard_path(
+  const std::string & directory, const std::string & prefix, size_t shard_index,
+  DatasetShardFormat format)
+{
+  char index[32];
+  std::snprintf(index, sizeof(index), "-%06zu", shard_index);
+  return (rcpputils::fs::path(directory) /
+         (prefix + index + (format == DatasetShardFormat::TFRECORD ? ".tfrecord" : ".tar")))
+         .string();
+}
+
+void check_written(const std::ofstream & file, const std::string & path)
+{
+  if (!file) {
+    throw std::runtime_error("Failed to write \"" + path + "\".");
+  }
+}
+
+// Ends a shard and closes it.
+void finish_shard(std::ofstream & file, const std::string & path, DatasetShardFormat format)
+{
+  if (format == DatasetShardFormat::WEBDATASET) {
+    // A tar archive ends with two blocks of zeros.
+    const std::string end_of_archive(2 * kTarBlockSize, '\0');
+    file.write(end_of_archive.data(), static_cast<std::streamsize>(end_of_archive.size()));
+  }
+  file.close();
+  check_written(file, path);
+}
+
+}  // namespace
+
+DatasetExporter::DatasetExporter(
+  DatasetExportOptions options, readers::ParallelReader::ReaderFactory reader_factory)
+: options_(std::move(options)), reader_factory_(std::move(reader_factory))
+{
+  const auto & synchronization = options_.synchronization;
+  if (synchronization.topics.empty()) {
+    throw std::invalid_argument("A dataset is exported of at least one topic.");
+  }
+  std::unordered_set<std::string> topics;
+  for (const auto & topic : synchronization.topics) {
+    if (!topics.insert(topic).second) {
+      throw std::invalid_argument("Topic '" + topic + "' is listed twice for the dataset.");
+    }
+  }
+  if (synchronization.slop < 0) {
+    throw std::invalid_argument("The slop of synchronizing messages must not be negative.");
+  }
+  if (synchronization.queue_size == 0) {
+    throw std::invalid_argument("The queue size of synchronizing messages must not be 0.");
+  }
+  if (options_.samples_per_shard == 0) {
+    throw std::invalid_argument("A shard holds at least one sample.");
+  }
+  if (!reader_factory_) {
+    reader_factory_ = []() {return std::make_unique<readers::SequentialReader>();};
+  }
+}
+
+DatasetExportResult DatasetExporter::export_shards(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options,
+  const std::string & directory, const std::string & prefix,
+  const rosbag2_storage::StorageFilter & storage_filter) const
+{
+  const auto & topics = options_.synchronization.topics;
+  rosbag2_storage::BagMetadata metadata;
+  {
+    auto reader = reader_factory_();
+    reader->open(storage_options, converter_options);
+    metadata = reader->get_metadata();
+  }
+
+  // Names of the files of a sample after its key, e.g. ".camera__image.cdr".
+  std::vector<std::string> file_names;
+  for (const auto & topic : topics) {
+    const auto topic_information = std::find_if(
+      metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+      [&topic](const rosbag2_storage::TopicInformation & information) {
+        return information.topic_metadata.name == topic;
+      });
+    if (topic_information == metadata.topics_with_message_count.end()) {
+      throw std::runtime_error("Topic '" + topic + "' is not in the bag.");
+    }
+    std::string file_name = ".";
+    for (const auto character : topic.substr(topic.compare(0, 1, "/") == 0 ? 1 : 0)) {
+      file_name += character == '/' ? std::string("__") : std::string(1, character);
+    }
+    file_names.push_back(
+      file_name + "." + topic_information->topic_metadata.serialization_format);
+  }
+
+  const rcpputils::fs::path directory_path(directory);
+  if (!directory_path.is_directory() && !rcpputils::fs::create_directories(directory_path)) {
+    throw std::runtime_error("Failed to create folder \"" + directory + "\".");
+  }
+
+  const auto max_threads = options_.max_threads > 0 ?
+    options_.max_threads : std::max<size_t>(std::thread::hardware_concurrency(), 1u);
+  const auto partition_count = options_.partition_count > 0 ?
+    options_.partition_count : max_threads * kPartitionsPerThread;
+  auto partition_filter = storage_filter;
+  partition_filter.topics = topics;
+  partition_filter.topics_regex.clear();
+  partition_filter.topic_types.clear();
+  partition_filter.order_by_publish_time = options_.synchronization.by_publish_time;
+  const auto partitions =
+    readers::ParallelReader::partition_by_time(metadata, partition_count, partition_filter);
+
+  // Messages of a sample are within the slop of its reference message, so within twice the slop
+  // of its first message.
+  const auto margin = 2 * options_.synchronization.slop;
+  auto read_partitions = partitions;
+  for (auto & partition : read_partitions) {
+    if (partition.start_time > 0) {
+      partition.start_time = std::max<rcutils_time_point_value_t>(
+        partition.start_time - margin, 0);
+    }
+    if (partition.end_time > 0) {
+      partition.end_time += margin;
+    }
+  }
+
+  readers::ParallelReader parallel_reader(reader_factory_, max_threads);
+  auto partitions_shards = parallel_reader.transform(
+    storage_options, converter_options, read_partitions,
+    [&](size_t partition_index, reader_interfaces::BaseReaderInterface & reader) {
+      const auto & partition = partitions[partition_index];
+      std::unique_ptr<readers::SynchronizingReader> synchronizing_reader;
+      if (topics.size() > 1) {
+        synchronizing_reader = std::make_unique<readers::SynchronizingReader>(
+          options_.synchronization, reader);
+      }
+
+      PartitionShards shards;
+      std::ofstream file;
+      std::string path;
+      uint64_t file_size = 0;
+      std::string buffer;
+      Sample sample;
+      while (synchronizing_reader ? synchronizing_reader->has_next() : reader.has_next()) {
+        if (synchronizing_reader) {
+          sample = synchronizing_reader->read_next();
+        } else {
+          sample.assign(1, reader.read_next());
+        }
+        const auto time_stamp = sample.front()->time_stamp;
+        if (time_stamp < partition.start_time ||
+          (partition.end_time > 0 && time_stamp > partition.end_time))
+        {
+          continue;
+        }
+
+        if (!file.is_open()) {
+          char name[64];
+          std::snprintf(
+            name, sizeof(name), "-%06zu-%06zu.partial", partition_index,
+            shards.full_shard_paths.size());
+          path = (directory_path / (prefix + name)).string();
+          file.open(path, std::ios::binary);
+          check_written(file, path);
+          file_size = 0;
+          shards.rest_sample_ends.clear();
+        }
+        buffer.clear();
+        if (options_.format == DatasetShardFormat::TFRECORD) {
+          append_tfrecord(buffer, topics, sample);
+        } else {
+          char key[32];
+          std::snprintf(
+            key, sizeof(key), "%06zu_%09" PRIu64, partition_index, shards.sample_count);
+          append_webdataset_sample(buffer, key, file_names, topics, sample);
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        check_written(file, path);
+        file_size += buffer.size();
+        shards.rest_sample_ends.push_back(file_size);
+        ++shards.sample_count;
+
+        if (shards.rest_sample_ends.size() == options_.samples_per_shard) {
+          finish_shard(file, path, options_.format);
+          shards.full_shard_paths.push_back(path);
+        }
+      }
+      if (file.is_open()) {
+        file.close();
+        check_written(file, path);
+        shards.rest_path = path;
+      } else {
+        shards.rest_sample_ends.clear();
+      }
+      return shards;
+    });
+
+  DatasetExportResult result;
+  for (const auto & shards : partitions_shards) {
+    for (const auto & full_shard_path : shards.full_shard_paths) {
+      const auto path =
+        shard_path(directory, prefix, result.shard_paths.size(), options_.format);
+      if (std::rename(full_shard_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error(
+                "Failed to rename \"" + full_shard_path + "\" to \"" + path + "\".");
+      }
+      result.shard_paths.push_back(path);
+    }
+    result.sample_count += shards.sample_count;
+  }
+
+  // The rests of the partitions are copied sample by sample into the last shards.
+  std::ofstream file;
+  std::string path;
+  size_t samples_in_shard = 0;
+  std::vector<char> copy_buffer(64 * 1024);
+  for (const auto & shards : partitions_shards) {
+    if (shards.rest_path.empty()) {
+      continue;
+    }
+    std::ifstream rest(shards.rest_path, std::ios::binary);
+    uint64_t offset = 0;
+    for (const auto sample_end : shards.rest_sample_ends) {
+      if (!file.is_open()) {
+        path = shard_path(directory, prefix, result.shard_paths.size(), options_.format);
+        file.open(path, std::ios::binary);
+        check_written(file, path);
+      }
+      while (offset < sample_end) {
+        const auto size = static_cast<std::streamsize>(
+          std::min<uint64_t>(sample_end - offset, copy_buffer.size()));
+        if (!rest.read(copy_buffer.data(), size)) {
+          throw std::runtime_error("Failed to read \"" + shards.rest_path + "\".");
+        }
+        file.write(copy_buffer.data(), size);
+        offset += static_cast<uint64_t>(size);
+      }
+      check_written(file, path);
+      if (++samples_in_shard == options_.samples_per_shard) {
+        finish_shard(file, path, options_.format);
+        result.shard_paths.push_back(path);
+        samples_in_shard = 0;
+      }
+    }
+    rest.close();
+    std::remove(shards.rest_path.c_str());
+  }
+  if (file.is_open()) {
+    finish_shard(file, path, options_.format);
+    result.shard_paths.push_back(path);
+  }
+  return result;
+}
+
+}  // namespace rosbag2_cpp
@@ -0,0 +1,141 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/distributed_bag_finalizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/message_histogram.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+// Adds the topics of the bag of a host to the topics of the bag of all hosts.
+void merge_topics(
+  const std::vector<rosbag2_storage::TopicInformation> & host_topics,
+  std::vector<rosbag2_storage::TopicInformation> & topics)
+{
+  for (const auto & host_topic : host_topics) {
+    const auto topic = std::find_if(
+      topics.begin(), topics.end(),
+      [&host_topic](const rosbag2_storage::TopicInformation & candidate) {
+        return candidate.topic_metadata.name == host_topic.topic_metadata.name;
+      });
+    if (topic != topics.end()) {
+      topic->message_count += host_topic.message_count;
+      topic->total_size += host_topic.total_size;
+      topic->max_message_size = std::max(topic->max_message_size, host_topic.max_message_size);
+      topic->dropped_message_count += host_topic.dropped_message_count;
+      topic->deduplicated = topic->deduplicated || host_topic.deduplicated;
+      topic->delta_encoded = topic->delta_encoded || host_topic.delta_encoded;
+      rosbag2_storage::merge_histograms(topic->histogram, host_topic.histogram);
+    } else {
+      topics.push_back(host_topic);
+    }
+  }
+}
+}  // namespace
+
+DistributedBagFinalizer::DistributedBagFinalizer(
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io)
+: metadata_io_(std::move(metadata_io))
+{}
+
+rosbag2_storage::BagMetadata DistributedBagFinalizer::finalize(
+  const std::string & uri, const std::vector<std::string> & host_folders)
+{
+  if (host_folders.empty()) {
+    throw std::invalid_argument("No host folders of the bag \"" + uri + "\" were given.");
+  }
+
+  std::vector<rosbag2_storage::BagMetadata> host_metadata;
+  for (const auto & host_folder : host_folders) {
+    const auto host_uri = (rcpputils::fs::path(uri) / host_folder).string();
+    if (!metadata_io_->metadata_file_exists(host_uri)) {
+      throw std::runtime_error("The bag of host folder \"" + host_folder + "\" has no metadata.");
+    }
+    host_metadata.push_back(metadata_io_->read_metadata(host_uri));
+    const auto & metadata = host_metadata.back();
+    if (metadata.bag_id.empty()) {
+      throw std::runtime_error(
+              "The bag of host folder \"" + host_folder + "\" was recorded without a bag id.");
+    }
+    if (metadata.bag_id != host_metadata.front().bag_id) {
+      throw std::runtime_error(
+              "The bag of host folder \"" + host_folder + "\" has the bag id \"" +
+              metadata.bag_id + "\" instead of \"" + host_metadata.front().bag_id + "\".");
+    }
+    if (metadata.storage_identifier != host_metadata.front().storage_identifier) {
+      throw std::runtime_error(
+              "The bag of host folder \"" + host_folder + "\" was recorded with another storage.");
+    }
+    // Compressed files cannot be read at the same time by a MergingReader.
+    if (!metadata.compression_mode.empty()) {
+      throw std::runtime_error(
+              "The bag of host folder \"" + host_folder + "\" is compressed and cannot be merged.");
+    }
+  }
+
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.storage_identifier = host_metadata.front().storage_identifier;
+  metadata.bag_id = host_metadata.front().bag_id;
+  metadata.message_count = 0;
+  // Every host is a stripe of its own, as the files of all hosts overlap in time. Files in the
+  // folder of a host are listed relative to the bag directory, stripe files of a host keep their
+  // absolute path.
+  for (size_t host = 0; host < host_metadata.size(); ++host) {
+    const auto & host_bag = host_metadata[host];
+    for (auto file : host_bag.files) {
+      if (!rcpputils::fs::path(file.path).is_absolute()) {
+        file.path = (rcpputils::fs::path(host_folders[host]) / file.path).string();
+      }
+      file.stripe = host + 1;
+      metadata.relative_file_paths.push_back(file.path);
+      metadata.files.push_back(file);
+    }
+
+    merge_topics(host_bag.topics_with_message_count, metadata.topics_with_message_count);
+    if (host_bag.message_count > 0u) {
+      if (metadata.message_count == 0u) {
+        metadata.starting_time = host_bag.starting_time;
+        metadata.duration = host_bag.duration;
+      } else {
+        const auto ending_time = std::max(
+          metadata.starting_time + metadata.duration, host_bag.starting_time + host_bag.duration);
+        metadata.starting_time = std::min(metadata.starting_time, host_bag.starting_time);
+        metadata.duration = ending_time - metadata.starting_time;
+      }
+      metadata.message_count += host_bag.message_count;
+    }
+    metadata.bag_size += host_bag.bag_size;
+    // The caches of the hosts are held in the memory of different hosts.
+    metadata.cache_high_water_mark_bytes =
+      std::max(metadata.cache_high_water_mark_bytes, host_bag.cache_high_water_mark_bytes);
+  }
+
+  metadata_io_->write_metadata(uri, metadata);
+  return metadata;
+}
+
+}  // namespace rosbag2_cpp
@@ -14,16 +14,68 @@
 
 #include "rosbag2_cpp/info.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/reindexer.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+
+#include "rosbag2_storage/message_histogram.hpp"
 #include "rosbag2_storage/metadata_io.hpp"
 #include "rosbag2_storage/storage_factory.hpp"
 
 namespace rosbag2_cpp
 {
 
+namespace
+{
+bool has_topic_sizes(const rosbag2_storage::BagMetadata & metadata)
+{
+  return std::all_of(
+    metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+    [](const rosbag2_storage::TopicInformation & topic) {
+      return topic.message_count == 0u || topic.total_size > 0u;
+    });
+}
+
+std::string resolve_path(const std::string & uri, const std::string & relative_file_path)
+{
+  const auto path = rcpputils::fs::path(relative_file_path);
+  return path.is_absolute() ? path.string() : (rcpputils::fs::path(uri) / path).string();
+}
+
+int64_t get_start(const rosbag2_storage::MessageHistogram & histogram)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    histogram.starting_time.time_since_epoch()).count();
+}
+
+int64_t get_end(const rosbag2_storage::MessageHistogram & histogram)
+{
+  return get_start(histogram) +
+         static_cast<int64_t>(histogram.message_counts.size()) * histogram.bucket_duration.count();
+}
+
+int64_t floor_to_multiple(int64_t time, int64_t duration)
+{
+  auto remainder = time % duration;
+  if (remainder < 0) {
+    remainder += duration;
+  }
+  return time - remainder;
+}
+}  // namespace
+
 rosbag2_storage::BagMetadata Info::read_metadata(
   const std::string & uri, const std::string & storage_id)
 {
@@ -31,6 +83,18 @@ rosbag2_storage::BagMetadata Info::read_metadata(
   if (metadata_io.metadata_file_exists(uri)) {
     return metadata_io.read_metadata(uri);
   }
+  // Files compressed as a whole cannot be opened by the storage, but have summaries next to them.
+  if (metadata_io.file_summaries_exist(uri)) {
+    return metadata_io.read_file_summaries(uri);
+  }
+  // Bags whose metadata file was never written, e.g. of a killed recording, are summarized from
+  // all their split files at once.
+  if (!storage_id.empty() && rcpputils::fs::path(uri).is_directory()) {
+    const auto bagfiles = Reindexer::find_bagfiles(uri);
+    if (!bagfiles.empty()) {
+      return Reindexer().summarize(uri, storage_id, bagfiles);
+    }
+  }
   if (!storage_id.empty()) {
     rosbag2_storage::StorageFactory factory;
     std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> storage;
@@ -48,4 +112,154 @@ rosbag2_storage::BagMetadata Info::read_metadata(
           "storage id of the bagfile to query it directly");
 }
 
+void Info::read_topic_sizes(const std::string & uri, rosbag2_storage::BagMetadata & metadata)
+{
+  const bool is_compressed_per_message = metadata.compression_mode == "MESSAGE";
+  // Chunks hold the messages of several topics.
+  const bool is_compressed_per_file_or_chunk =
+    metadata.compression_mode == "FILE" || metadata.compression_mode == "CHUNK";
+  if (has_topic_sizes(metadata) || is_compressed_per_file_or_chunk) {
+    return;
+  }
+
+  std::vector<std::string> file_paths;
+  // Metadata rebuilt from the bagfiles of a bag directory lists them relative to it, too.
+  if (rosbag2_storage::MetadataIo().metadata_file_exists(uri) ||
+    rcpputils::fs::path(uri).is_directory())
+  {
+    for (const auto & path : metadata.relative_file_paths) {
+      file_paths.push_back(resolve_path(uri, path));
+    }
+  } else {
+    file_paths.push_back(uri);
+  }
+
+  // Storage plugins are loaded one at a time, only the messages are scanned in parallel.
+  rosbag2_storage::StorageFactory factory;
+  std::vector<std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>> storages;
+  for (const auto & path : file_paths) {
+    auto storage = factory.open_read_only(path, metadata.storage_identifier);
+    if (!storage) {
+      throw std::runtime_error("The bagfile \"" + path + "\" could not be opened.");
+    }
+    storages.push_back(std::move(storage));
+  }
+
+  std::vector<std::vector<rosbag2_storage::TopicInformation>> file_topics(storages.size());
+  std::vector<std::exception_ptr> errors(storages.size());
+  std::atomic<size_t> next_file{0};
+  const auto scan_files = [&]() {
+      for (size_t i = next_file++; i < storages.size(); i = next_file++) {
+        try {
+          file_topics[i] = storages[i]->get_topic_sizes();
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+        storages[i].reset();
+      }
+    };
+  std::vector<std::thread> threads;
+  const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 1; i < std::min(max_threads, storages.size()); ++i) {
+    threads.emplace_back(
+      [&scan_files]() {
+        ThreadPool::configure_current_thread();
+        scan_files();
+      });
+  }
+  scan_files();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  for (const auto & error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  for (auto & topic : metadata.topics_with_message_count) {
+    uint64_t total_size = 0;
+    uint64_t max_message_size = 0;
+    for (const auto & topics : file_topics) {
+      const auto file_topic = std::find_if(
+        topics.begin(), topics.end(),
+        [&topic](const rosbag2_storage::TopicInformation & candidate) {
+          return candidate.topic_metadata.name == topic.topic_metadata.name;
+        });
+      if (file_topic != topics.end()) {
+        total_size += file_topic->total_size;
+        max_message_size = std::max(max_message_size, file_topic->max_message_size);
+      }
+    }
+    if (is_compressed_per_message) {
+      topic.compressed_size = total_size;
+    } else {
+      topic.total_size = total_size;
+      topic.max_message_size = max_message_size;
+    }
+  }
+}
+
+Timeline Info::get_timeline(
+  const rosbag2_storage::BagMetadata & metadata, size_t max_buckets) const
+{
+  Timeline timeline;
+  std::vector<const rosbag2_storage::MessageHistogram *> histograms;
+  for (const auto & topic : metadata.topics_with_message_count) {
+    timeline.topics.push_back({topic.topic_metadata.name, {}, {}});
+    const auto & histogram = topic.histogram;
+    if (histogram.bucket_duration.count() > 0 && !histogram.message_counts.empty()) {
+      histograms.push_back(&histogram);
+      timeline.bucket_duration = std::max(timeline.bucket_duration, histogram.bucket_duration);
+    } else {
+      histograms.push_back(nullptr);
+    }
+  }
+  if (timeline.bucket_duration.count() == 0) {
+    return timeline;
+  }
+
+  // The buckets of all histograms start at multiples of their duration, which are powers of
+  // two of the same initial duration, so the coarsest one is a grid for all of them.
+  auto start = std::numeric_limits<int64_t>::max();
+  auto end = std::numeric_limits<int64_t>::min();
+  for (const auto * histogram : histograms) {
+    if (histogram) {
+      start = std::min(start, get_start(*histogram));
+      end = std::max(end, get_end(*histogram));
+    }
+  }
+  auto duration = timeline.bucket_duration.count();
+  const auto align = [&start, &end, &duration]() {
+      start = floor_to_multiple(start, duration);
+      end = floor_to_multiple(end - 1, duration) + duration;
+    };
+  align();
+  while (max_buckets > 0 && static_cast<uint64_t>((end - start) / duration) > max_buckets) {
+    duration *= 2;
+    align();
+  }
+  timeline.bucket_duration = std::chrono::nanoseconds(duration);
+  timeline.starting_time =
+    std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(start));
+
+  const auto bucket_count = static_cast<size_t>((end - start) / duration);
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    auto & topic = timeline.topics[i];
+    topic.message_counts.assign(bucket_count, 0u);
+    topic.sizes.assign(bucket_count, 0u);
+    if (!histograms[i]) {
+      continue;
+    }
+    const auto histogram =
+      rosbag2_storage::coarsen_histogram(*histograms[i], timeline.bucket_duration);
+    const auto offset = static_cast<size_t>((get_start(histogram) - start) / duration);
+    for (size_t j = 0; j < histogram.message_counts.size(); ++j) {
+      topic.message_counts[offset + j] = histogram.message_counts[j];
+      topic.sizes[offset + j] = histogram.sizes[j];
+    }
+  }
+  return timeline;
+}
+
 }  // namespace rosbag2_cpp
@@ -0,0 +1,161 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/memory_budget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "rosbag2_cpp/logging.hpp"
+
+namespace rosbag2_cpp
+{
+
+MemoryBudget::Account::Account(MemoryBudget & budget, std::string stage)
+: budget_(budget), stage_(std::move(stage))
+{}
+
+MemoryBudget::Account::~Account()
+{
+  set_allocated(0);
+}
+
+void MemoryBudget::Account::allocate(uint64_t bytes)
+{
+  budget_.update_account(*this, [bytes](uint64_t allocated) {return allocated + bytes;});
+}
+
+void MemoryBudget::Account::release(uint64_t bytes)
+{
+  budget_.update_account(
+    *this, [bytes](uint64_t allocated) {return allocated - std::min(bytes, allocated);});
+}
+
+void MemoryBudget::Account::set_allocated(uint64_t bytes)
+{
+  budget_.update_account(*this, [bytes](uint64_t) {return bytes;});
+}
+
+uint64_t MemoryBudget::Account::get_allocated() const
+{
+  std::lock_guard<std::mutex> lock(budget_.mutex_);
+  return allocated_;
+}
+
+bool MemoryBudget::Account::is_budget_exhausted() const
+{
+  return budget_.is_exhausted();
+}
+
+uint64_t MemoryBudget::Account::get_available_bytes() const
+{
+  return budget_.get_available_bytes();
+}
+
+MemoryBudget::MemoryBudget(uint64_t max_bytes)
+: max_bytes_(max_bytes)
+{
+  usage_.max_bytes = max_bytes;
+}
+
+std::unique_ptr<MemoryBudget::Account> MemoryBudget::open_account(const std::string & stage)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    usage_.stages.emplace(stage, MemoryStageUsage{});
+  }
+  return std::unique_ptr<Account>(new Account(*this, stage));
+}
+
+void MemoryBudget::set_max_bytes(uint64_t max_bytes)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_bytes_ = max_bytes;
+  usage_.max_bytes = max_bytes;
+}
+
+uint64_t MemoryBudget::get_max_bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_bytes_;
+}
+
+MemoryUsage MemoryBudget::get_usage() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_;
+}
+
+MemoryBudget & MemoryBudget::get_shared()
+{
+  static MemoryBudget shared_budget;
+  return shared_budget;
+}
+
+void MemoryBudget::update_account(
+  Account & account, const std::function<uint64_t(uint64_t)> & update)
+{
+  std::ostringstream warning;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto old_bytes = account.allocated_;
+    const auto new_bytes = update(old_bytes);
+    account.allocated_ = new_bytes;
+    // Accounts are only changed through the budget, so the totals include old_bytes.
+    auto & stage_usage = usage_.stages[account.stage_];
+    stage_usage.bytes = stage_usage.bytes - old_bytes + new_bytes;
+    stage_usage.peak_bytes = std::max(stage_usage.peak_bytes, stage_usage.bytes);
+    usage_.bytes = usage_.bytes - old_bytes + new_bytes;
+    usage_.peak_bytes = std::max(usage_.peak_bytes, usage_.bytes);
+
+    const auto now = std::chrono::steady_clock::now();
+    if (new_bytes > old_bytes && max_bytes_ > 0u && usage_.bytes >= max_bytes_ &&
+      now - last_warning_time_ >= std::chrono::seconds(5))
+    {
+      last_warning_time_ = now;
+      warning << "Memory budget of " << max_bytes_ << " bytes exhausted, holding back messages.";
+      for (const auto & held_stage : usage_.stages) {
+        warning << " " << held_stage.first << ": " << held_stage.second.bytes << " bytes.";
+      }
+    }
+  }
+  if (warning.tellp() > 0) {
+    ROSBAG2_CPP_LOG_WARN_STREAM(warning.str());
+  }
+}
+
+bool MemoryBudget::is_exhausted() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_bytes_ > 0u && usage_.bytes >= max_bytes_;
+}
+
+uint64_t MemoryBudget::get_available_bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (max_bytes_ == 0u) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return max_bytes_ - std::min(usage_.bytes, max_bytes_);
+}
+
+}  // namespace rosbag2_cpp
@@ -0,0 +1,165 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/message_transform_chain.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_storage/shared_class_loader.hpp"
+
+namespace rosbag2_cpp
+{
+
+using rosbag2_storage::SharedClassLoader;
+
+namespace
+{
+// Transforms registered by MessageTransformChain::register_transform, by name.
+struct Registry
+{
+  std::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<const MessageTransformChain::TransformCreator>>
+  creators;
+};
+
+Registry & get_registry()
+{
+  static Registry registry;
+  return registry;
+}
+
+// The creator is called outside the lock, so that it may create chains itself.
+std::shared_ptr<const MessageTransformChain::TransformCreator> find_registered_transform(
+  const std::string & name)
+{
+  auto & registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  const auto creator = registry.creators.find(name);
+  return creator == registry.creators.end() ? nullptr : creator->second;
+}
+
+std::unique_ptr<transform_interfaces::MessageTransform> create_transform(const std::string & name)
+{
+  if (const auto creator = find_registered_transform(name)) {
+    return (*creator)();
+  }
+  // The plugin descriptions are only parsed if a transform is not registered.
+  auto & class_loader = SharedClassLoader<transform_interfaces::MessageTransform>::get_instance(
+    "rosbag2_cpp", "rosbag2_cpp::transform_interfaces::MessageTransform");
+  if (!class_loader.is_declared(name)) {
+    throw std::runtime_error(
+            "Message transform \"" + name + "\" is neither registered nor a declared plugin.");
+  }
+  return std::unique_ptr<transform_interfaces::MessageTransform>(
+    class_loader.create_unmanaged_instance(name));
+}
+}  // namespace
+
+// The names of the topics each transform dropped, as the transforms before it named them.
+struct MessageTransformChain::DroppedTopics
+{
+  std::mutex mutex;
+  std::vector<std::unordered_set<std::string>> names;
+};
+
+MessageTransformChain::MessageTransformChain()
+: dropped_topics_(std::make_unique<DroppedTopics>())
+{}
+
+MessageTransformChain::MessageTransformChain(
+  const std::vector<MessageTransformOptions> & transforms)
+: MessageTransformChain()
+{
+  for (const auto & options : transforms) {
+    auto transform = create_transform(options.name);
+    if (!transform) {
+      throw std::runtime_error("Message transform \"" + options.name + "\" was not created.");
+    }
+    transform->configure(options.parameters);
+    transforms_.push_back(std::move(transform));
+  }
+  dropped_topics_->names.resize(transforms_.size());
+}
+
+MessageTransformChain::~MessageTransformChain() = default;
+
+MessageTransformChain::MessageTransformChain(MessageTransformChain &&) = default;
+
+MessageTransformChain & MessageTransformChain::operator=(MessageTransformChain &&) = default;
+
+bool MessageTransformChain::empty() const
+{
+  return transforms_.empty();
+}
+
+bool MessageTransformChain::transform_topic(rosbag2_storage::TopicMetadata & topic) const
+{
+  for (size_t i = 0; i < transforms_.size(); ++i) {
+    const auto name = topic.name;
+    const bool is_kept = transforms_[i]->transform_topic(topic);
+    // A topic transformed again may be kept this time.
+    std::lock_guard<std::mutex> lock(dropped_topics_->mutex);
+    auto & dropped_names = dropped_topics_->names[i];
+    if (!is_kept) {
+      dropped_names.insert(name);
+      return false;
+    }
+    dropped_names.erase(name);
+  }
+  return true;
+}
+
+void MessageTransformChain::transform(
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages) const
+{
+  for (size_t i = 0; i < transforms_.size(); ++i) {
+    {
+      std::lock_guard<std::mutex> lock(dropped_topics_->mutex);
+      const auto & dropped_names = dropped_topics_->names[i];
+      if (!dropped_names.empty()) {
+        messages.erase(
+          std::remove_if(
+            messages.begin(), messages.end(),
+            [&dropped_names](const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & m) {
+              return dropped_names.find(m->topic_name) != dropped_names.end();
+            }),
+          messages.end());
+      }
+    }
+    if (messages.empty()) {
+      return;
+    }
+    transforms_[i]->transform(messages);
+  }
+}
+
+void MessageTransformChain::register_transform(const std::string & name, TransformCreator creator)
+{
+  if (!creator) {
+    throw std::invalid_argument("Message transform \"" + name + "\" needs a creator.");
+  }
+  auto & registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.creators[name] = std::make_shared<const TransformCreator>(std::move(creator));
+}
+
+}  // namespace rosbag2_cpp
@@ -15,6 +15,8 @@
 
 #include "rosbag2_cpp/reader.hpp"
 
+#include <functional>
+#include <future>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -25,6 +27,12 @@
 namespace rosbag2_cpp
 {
 
+namespace
+{
+constexpr const size_t FOR_EACH_BATCH_MESSAGES = 1024;
+constexpr const size_t FOR_EACH_BATCH_BYTES = 16 * 1024 * 1024;
+}  // namespace
+
 Reader::Reader(std::unique_ptr<reader_interfaces::BaseReaderInterface> reader_impl)
 : reader_impl_(std::move(reader_impl))
 {}
@@ -51,6 +59,41 @@ std::shared_ptr<rosbag2_storage::SerializedBagMessage> Reader::read_next()
   return reader_impl_->read_next();
 }
 
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> Reader::read_next_batch(
+  size_t max_messages, size_t max_bytes)
+{
+  return reader_impl_->read_next_batch(max_messages, max_bytes);
+}
+
+std::future<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+Reader::read_next_batch_async(
+  size_t max_messages, size_t max_bytes, const std::function<void()> & ready_callback)
+{
+  return reader_impl_->read_next_batch_async(max_messages, max_bytes, ready_callback);
+}
+
+bool Reader::cancel_async_read()
+{
+  return reader_impl_->cancel_async_read();
+}
+
+void Reader::for_each(
+  const std::function<void(const rosbag2_storage::SerializedBagMessageView &)> & callback,
+  const rosbag2_storage::StorageFilter & storage_filter)
+{
+  reader_impl_->set_filter(storage_filter);
+  const auto visit_batch =
+    [&callback](const std::vector<rosbag2_storage::SerializedBagMessageView> & views) {
+      for (const auto & view : views) {
+        callback(view);
+      }
+    };
+  while (reader_impl_->visit_next_batch(
+      visit_batch, FOR_EACH_BATCH_MESSAGES, FOR_EACH_BATCH_BYTES))
+  {
+  }
+}
+
 const rosbag2_storage::BagMetadata & Reader::get_metadata() const
 {
   return reader_impl_->get_metadata();
@@ -71,4 +114,15 @@ void Reader::reset_filter()
   reader_impl_->reset_filter();
 }
 
+void Reader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  reader_impl_->seek(timestamp);
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> Reader::read_latest_messages(
+  const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+{
+  return reader_impl_->read_latest_messages(topic_names, timestamp);
+}
+
 }  // namespace rosbag2_cpp
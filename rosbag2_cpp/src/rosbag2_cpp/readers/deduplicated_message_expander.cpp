@@ -0,0 +1,90 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/deduplicated_message_expander.hpp"
+
+#include <memory>
+#include <utility>
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+DeduplicatedMessageExpander::DeduplicatedMessageExpander(
+  const rosbag2_storage::BagMetadata & metadata, OpenFile open_file)
+: open_file_(std::move(open_file))
+{
+  for (const auto & topic : metadata.topics_with_message_count) {
+    if (topic.deduplicated) {
+      previous_data_.emplace(topic.topic_metadata.name, nullptr);
+    }
+  }
+}
+
+bool DeduplicatedMessageExpander::has_deduplicated_topics() const
+{
+  return !previous_data_.empty();
+}
+
+void DeduplicatedMessageExpander::expand(rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto previous_data = previous_data_.find(message.topic_name);
+  if (previous_data == previous_data_.end() || !message.serialized_data) {
+    return;
+  }
+  if (message.serialized_data->buffer_length > 0) {
+    previous_data->second = message.serialized_data;
+    return;
+  }
+  if (!previous_data->second) {
+    previous_data->second = read_referenced_data(message);
+  }
+  if (previous_data->second) {
+    message.serialized_data = previous_data->second;
+  }
+}
+
+void DeduplicatedMessageExpander::reset()
+{
+  for (auto & previous_data : previous_data_) {
+    previous_data.second = nullptr;
+  }
+}
+
+std::shared_ptr<rcutils_uint8_array_t> DeduplicatedMessageExpander::read_referenced_data(
+  const rosbag2_storage::SerializedBagMessage & reference)
+{
+  auto storage = open_file_();
+  if (!storage) {
+    return nullptr;
+  }
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {reference.topic_name};
+  storage_filter.end_time = reference.time_stamp;
+  storage->set_filter(storage_filter);
+  std::shared_ptr<rcutils_uint8_array_t> data;
+  while (storage->has_next()) {
+    auto message = storage->read_next();
+    if (message->serialized_data && message->serialized_data->buffer_length > 0) {
+      data = message->serialized_data;
+    }
+  }
+  return data;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
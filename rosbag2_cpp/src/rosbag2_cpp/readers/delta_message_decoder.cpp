@@ -0,0 +1,218 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+namespace
+{
+using writers::DeltaFrameType;
+
+// Reads the stored data of a message of a delta encoded topic.
+class FrameReader
+{
+public:
+  explicit FrameReader(const rcutils_uint8_array_t & data)
+  : data_(data)
+  {}
+
+  bool at_end() const
+  {
+    return position_ == data_.buffer_length;
+  }
+
+  const uint8_t * get_bytes(uint64_t size)
+  {
+    if (size > data_.buffer_length - position_) {
+      throw std::runtime_error{"Delta encoded message is truncated."};
+    }
+    const auto bytes = data_.buffer + position_;
+    position_ += size;
+    return bytes;
+  }
+
+  uint8_t get_byte()
+  {
+    return *get_bytes(1);
+  }
+
+  rcutils_time_point_value_t get_time_stamp()
+  {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+      value |= static_cast<uint64_t>(get_byte()) << (8 * i);
+    }
+    return static_cast<rcutils_time_point_value_t>(value);
+  }
+
+  uint64_t get_varint()
+  {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      const auto byte = get_byte();
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw std::runtime_error{"Delta encoded message holds an invalid number."};
+  }
+
+  size_t get_remaining_size() const
+  {
+    return data_.buffer_length - position_;
+  }
+
+private:
+  const rcutils_uint8_array_t & data_;
+  size_t position_{0};
+};
+
+bool has_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return message.serialized_data && message.serialized_data->buffer_length > 0;
+}
+}  // namespace
+
+DeltaMessageDecoder::DeltaMessageDecoder(
+  const rosbag2_storage::BagMetadata & metadata, ReadStoredMessages read_stored_messages)
+: read_stored_messages_(std::move(read_stored_messages))
+{
+  for (const auto & topic : metadata.topics_with_message_count) {
+    if (topic.delta_encoded) {
+      previous_messages_.emplace(topic.topic_metadata.name, PreviousMessage{nullptr, 0});
+    }
+  }
+}
+
+bool DeltaMessageDecoder::has_delta_encoded_topics() const
+{
+  return !previous_messages_.empty();
+}
+
+void DeltaMessageDecoder::decode(rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto previous = previous_messages_.find(message.topic_name);
+  if (previous == previous_messages_.end() || !has_data(message)) {
+    return;
+  }
+  auto data = decode_data(message, previous->second);
+  if (!data) {
+    // Continues from the stored message the delta was encoded from.
+    FrameReader frame(*message.serialized_data);
+    frame.get_byte();
+    const auto previous_time_stamp = frame.get_time_stamp();
+    data = decode_data(message, find_previous_message(message.topic_name, previous_time_stamp));
+    if (!data) {
+      throw std::runtime_error{
+              "The message of topic " + message.topic_name + " at " +
+              std::to_string(message.time_stamp) +
+              " was delta encoded from a message which cannot be found."};
+    }
+  }
+  message.serialized_data = data;
+  previous->second = PreviousMessage{std::move(data), message.time_stamp};
+}
+
+void DeltaMessageDecoder::reset()
+{
+  for (auto & previous_message : previous_messages_) {
+    previous_message.second = PreviousMessage{nullptr, 0};
+  }
+}
+
+DeltaMessageDecoder::Messages DeltaMessageDecoder::read_stored_messages(
+  rosbag2_storage::storage_interfaces::ReadOnlyInterface & storage,
+  const std::string & topic_name, rcutils_time_point_value_t end_time)
+{
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {topic_name};
+  storage_filter.end_time = end_time;
+  storage.set_filter(storage_filter);
+  Messages messages;
+  while (storage.has_next()) {
+    messages.push_back(storage.read_next());
+  }
+  return messages;
+}
+
+std::shared_ptr<rcutils_uint8_array_t> DeltaMessageDecoder::decode_data(
+  const rosbag2_storage::SerializedBagMessage & message, const PreviousMessage & previous) const
+{
+  FrameReader frame(*message.serialized_data);
+  const auto frame_type = frame.get_byte();
+  if (frame_type == static_cast<uint8_t>(DeltaFrameType::KEYFRAME)) {
+    const auto size = frame.get_remaining_size();
+    return rosbag2_storage::make_serialized_message(frame.get_bytes(size), size);
+  }
+  if (frame_type != static_cast<uint8_t>(DeltaFrameType::DELTA)) {
+    throw std::runtime_error{"Delta encoded message has an unknown frame type."};
+  }
+
+  const auto previous_time_stamp = frame.get_time_stamp();
+  const auto size = frame.get_varint();
+  if (!previous.data || previous.time_stamp != previous_time_stamp ||
+    previous.data->buffer_length != size)
+  {
+    return nullptr;
+  }
+  auto data = rosbag2_storage::make_serialized_message(previous.data->buffer, size);
+  uint64_t position = 0;
+  while (!frame.at_end()) {
+    position += frame.get_varint();
+    const auto changed = frame.get_varint();
+    if (position > size || changed > size - position) {
+      throw std::runtime_error{"Delta encoded message changes bytes beyond its size."};
+    }
+    std::memcpy(data->buffer + position, frame.get_bytes(changed), changed);
+    position += changed;
+  }
+  return data;
+}
+
+DeltaMessageDecoder::PreviousMessage DeltaMessageDecoder::find_previous_message(
+  const std::string & topic_name, rcutils_time_point_value_t time_stamp) const
+{
+  // Decodes the topic from the start of the file, which is a keyframe, up to the message.
+  PreviousMessage decoded{nullptr, 0};
+  PreviousMessage found{nullptr, 0};
+  for (const auto & message : read_stored_messages_(topic_name, time_stamp)) {
+    if (!has_data(*message)) {
+      continue;
+    }
+    decoded = PreviousMessage{decode_data(*message, decoded), message->time_stamp};
+    if (decoded.data && message->time_stamp == time_stamp) {
+      found = decoded;
+    }
+  }
+  return found;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
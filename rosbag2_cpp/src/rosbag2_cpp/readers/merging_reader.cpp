@@ -0,0 +1,383 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/merging_reader.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/readers/deduplicated_message_expander.hpp"
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
+
+namespace
+{
+// Type of the topic as listed in the metadata, or an empty string if it is not listed.
+std::string find_topic_type(
+  const rosbag2_storage::BagMetadata & metadata, const std::string & topic_name)
+{
+  for (const auto & topic_information : metadata.topics_with_message_count) {
+    if (topic_information.topic_metadata.name == topic_name) {
+      return topic_information.topic_metadata.type;
+    }
+  }
+  return "";
+}
+
+// Reads the messages of a single storage, so it can be read ahead by a PrefetchingReader.
+class StorageReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  StorageReader(
+    std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> storage,
+    const rosbag2_storage::BagMetadata & metadata,
+    std::unique_ptr<rosbag2_cpp::readers::DeduplicatedMessageExpander>
+    deduplicated_message_expander,
+    std::unique_ptr<rosbag2_cpp::readers::DeltaMessageDecoder> delta_message_decoder)
+  : storage_(std::move(storage)), metadata_(metadata),
+    deduplicated_message_expander_(std::move(deduplicated_message_expander)),
+    delta_message_decoder_(std::move(delta_message_decoder))
+  {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {}
+
+  void reset() override
+  {
+    storage_.reset();
+  }
+
+  bool has_next() override
+  {
+    return storage_->has_next();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    auto message = storage_->read_next();
+    if (deduplicated_message_expander_) {
+      deduplicated_message_expander_->expand(*message);
+    }
+    if (delta_message_decoder_) {
+      delta_message_decoder_->decode(*message);
+    }
+    return message;
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return storage_->get_all_topics_and_types();
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    storage_filter_ = storage_filter;
+    set_storage_filter();
+  }
+
+  void reset_filter() override
+  {
+    storage_filter_ = rosbag2_storage::StorageFilter();
+    if (seek_time_ > 0 && !storage_->get_capabilities().seek) {
+      set_storage_filter();
+    } else {
+      reset_message_decoding();
+      storage_->reset_filter();
+    }
+  }
+
+  void seek(const rcutils_time_point_value_t & timestamp) override
+  {
+    seek_time_ = timestamp;
+    if (storage_->get_capabilities().seek) {
+      reset_message_decoding();
+      storage_->seek(seek_time_);
+    } else {
+      set_storage_filter();
+    }
+  }
+
+private:
+  // Storages which cannot seek are given the seek time as start time of their filter instead.
+  void set_storage_filter()
+  {
+    reset_message_decoding();
+    if (seek_time_ > 0 && !storage_->get_capabilities().seek) {
+      auto storage_filter = storage_filter_;
+      storage_filter.start_time = std::max(storage_filter.start_time, seek_time_);
+      storage_->set_filter(storage_filter);
+    } else {
+      storage_->set_filter(storage_filter_);
+    }
+  }
+
+  void reset_message_decoding()
+  {
+    if (deduplicated_message_expander_) {
+      deduplicated_message_expander_->reset();
+    }
+    if (delta_message_decoder_) {
+      delta_message_decoder_->reset();
+    }
+  }
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> storage_;
+  const rosbag2_storage::BagMetadata & metadata_;
+  std::unique_ptr<rosbag2_cpp::readers::DeduplicatedMessageExpander>
+  deduplicated_message_expander_;
+  std::unique_ptr<rosbag2_cpp::readers::DeltaMessageDecoder> delta_message_decoder_;
+  rosbag2_storage::StorageFilter storage_filter_{};
+  rcutils_time_point_value_t seek_time_{0};
+};
+}  // unnamed namespace
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+MergingReader::MergingReader(
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory,
+  std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io,
+  size_t read_ahead_messages)
+: SequentialReader(
+    std::move(storage_factory), std::move(converter_factory), std::move(metadata_io)),
+  read_ahead_messages_(read_ahead_messages)
+{}
+
+MergingReader::~MergingReader()
+{
+  reset();
+}
+
+void MergingReader::open(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  reset();
+  SequentialReader::open(storage_options, converter_options);
+  storage_options_ = storage_options;
+  converter_options_ = converter_options;
+  // The files are opened once they are read, so files skipped by the filter are not opened.
+  file_readers_.resize(std::max<size_t>(file_paths_.size(), 1u));
+}
+
+void MergingReader::reset()
+{
+  // Stops reading ahead before the storages are released.
+  file_readers_.clear();
+  next_messages_.clear();
+  next_messages_filled_ = false;
+  SequentialReader::reset();
+}
+
+bool MergingReader::has_next()
+{
+  check_is_open("reading");
+  if (!next_messages_filled_) {
+    fill_next_messages();
+  }
+  return !next_messages_.empty();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> MergingReader::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("There are no more messages to read.");
+  }
+
+  std::pop_heap(next_messages_.begin(), next_messages_.end(), is_later_than);
+  auto next_message = std::move(next_messages_.back());
+  next_messages_.pop_back();
+  push_next_message(next_message.file_index);
+
+  return converter_ ? converter_->convert(next_message.message) : next_message.message;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+MergingReader::read_next_batch(size_t max_messages, size_t max_bytes)
+{
+  // Messages are merged one by one, unlike reading a single storage.
+  return BaseReaderInterface::read_next_batch(max_messages, max_bytes);
+}
+
+bool MergingReader::visit_next_batch(
+  const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+  size_t max_messages, size_t max_bytes)
+{
+  return BaseReaderInterface::visit_next_batch(callback, max_messages, max_bytes);
+}
+
+void MergingReader::set_filter(const rosbag2_storage::StorageFilter & storage_filter)
+{
+  check_is_open("setting filter");
+  storage_filter_ = storage_filter;
+  for (auto & file_reader : file_readers_) {
+    if (file_reader) {
+      file_reader->set_filter(storage_filter_);
+    }
+  }
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+void MergingReader::reset_filter()
+{
+  check_is_open("resetting filter");
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  for (auto & file_reader : file_readers_) {
+    if (file_reader) {
+      file_reader->reset_filter();
+    }
+  }
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+void MergingReader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  check_is_open("seeking");
+  seek_time_ = timestamp;
+  for (auto & file_reader : file_readers_) {
+    if (file_reader) {
+      file_reader->seek(seek_time_);
+    }
+  }
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+void MergingReader::check_is_open(const std::string & action) const
+{
+  if (!storage_) {
+    throw std::runtime_error("Bag is not open. Call open() before " + action + ".");
+  }
+}
+
+void MergingReader::fill_next_messages()
+{
+  next_messages_.clear();
+  for (size_t i = 0; i < file_readers_.size(); ++i) {
+    if (!is_file_selected(i)) {
+      continue;
+    }
+    if (!file_readers_[i]) {
+      open_file_reader(i);
+    }
+    push_next_message(i);
+  }
+  next_messages_filled_ = true;
+}
+
+bool MergingReader::is_file_selected(size_t file_index) const
+{
+  if (file_index >= metadata_.files.size() || metadata_.files[file_index].topics.empty()) {
+    return true;
+  }
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter_);
+  if (topic_filter.selects_all_topics()) {
+    return true;
+  }
+  const auto & file_topics = metadata_.files[file_index].topics;
+  return std::any_of(
+    file_topics.begin(), file_topics.end(),
+    [this, &topic_filter](const std::string & topic) {
+      return topic_filter.is_selected(topic, find_topic_type(metadata_, topic));
+    });
+}
+
+void MergingReader::open_file_reader(size_t file_index)
+{
+  // The storage of the first file, or of the bag without metadata file, is opened already.
+  auto storage = file_index == 0 ? storage_ : storage_factory_->open_read_only(
+    file_paths_[file_index], storage_options_.storage_id);
+  if (!storage) {
+    throw std::runtime_error{"No storage could be initialized. Abort"};
+  }
+  if (file_index > 0 && storage->get_capabilities().message_pool) {
+    storage->set_message_pool(message_pool_);
+  }
+
+  const auto file_path = file_paths_[file_index];
+  std::unique_ptr<DeduplicatedMessageExpander> deduplicated_message_expander;
+  if (deduplicated_message_expander_) {
+    deduplicated_message_expander = std::make_unique<DeduplicatedMessageExpander>(
+      metadata_, [this, file_path]() {
+        return storage_factory_->open_read_only(file_path, storage_options_.storage_id);
+      });
+  }
+  std::unique_ptr<DeltaMessageDecoder> delta_message_decoder;
+  if (delta_message_decoder_) {
+    delta_message_decoder = std::make_unique<DeltaMessageDecoder>(
+      metadata_,
+      [this, file_path](const std::string & topic_name, rcutils_time_point_value_t end_time) {
+        auto storage = storage_factory_->open_read_only(file_path, storage_options_.storage_id);
+        if (!storage) {
+          throw std::runtime_error{"No storage could be initialized. Abort"};
+        }
+        return DeltaMessageDecoder::read_stored_messages(*storage, topic_name, end_time);
+      });
+  }
+
+  auto file_reader = std::make_unique<PrefetchingReader>(
+    std::make_unique<StorageReader>(
+      std::move(storage), metadata_, std::move(deduplicated_message_expander),
+      std::move(delta_message_decoder)),
+    read_ahead_messages_);
+  file_reader->open(storage_options_, converter_options_);
+  if (!storage_filter_.topics.empty() || !storage_filter_.topics_regex.empty() ||
+    !storage_filter_.topic_types.empty() || storage_filter_.start_time != 0 ||
+    storage_filter_.end_time != 0 || storage_filter_.order_by_publish_time ||
+    storage_filter_.sample_interval != 0 || storage_filter_.sample_stride != 0 ||
+    !storage_filter_.topic_time_ranges.empty())
+  {
+    file_reader->set_filter(storage_filter_);
+  }
+  if (seek_time_ != 0) {
+    file_reader->seek(seek_time_);
+  }
+  file_readers_[file_index] = std::move(file_reader);
+}
+
+void MergingReader::push_next_message(size_t file_index)
+{
+  auto & file_reader = file_readers_[file_index];
+  if (file_reader->has_next()) {
+    auto message = file_reader->read_next();
+    const auto time_stamp =
+      storage_filter_.order_by_publish_time && message->publish_time_stamp != 0 ?
+      message->publish_time_stamp : message->time_stamp;
+    next_messages_.push_back({std::move(message), time_stamp, file_index});
+    std::push_heap(next_messages_.begin(), next_messages_.end(), is_later_than);
+  }
+}
+
+bool MergingReader::is_later_than(const NextMessage & lhs, const NextMessage & rhs)
+{
+  if (lhs.time_stamp != rhs.time_stamp) {
+    return lhs.time_stamp > rhs.time_stamp;
+  }
+  return lhs.file_index > rhs.file_index;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
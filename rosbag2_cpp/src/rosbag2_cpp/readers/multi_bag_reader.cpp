@@ -0,0 +1,286 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/multi_bag_reader.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+
+#include "rosbag2_storage/message_histogram.hpp"
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+MultiBagReader::MultiBagReader(ReaderFactory reader_factory, size_t read_ahead_messages)
+: reader_factory_(std::move(reader_factory)),
+  read_ahead_messages_(read_ahead_messages)
+{
+  if (!reader_factory_) {
+    reader_factory_ = [](const StorageOptions &) {
+        return std::make_unique<SequentialReader>();
+      };
+  }
+}
+
+MultiBagReader::~MultiBagReader()
+{
+  reset();
+}
+
+void MultiBagReader::open(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  open(std::vector<StorageOptions>{storage_options}, converter_options);
+}
+
+void MultiBagReader::open(
+  const std::vector<StorageOptions> & storage_options,
+  const ConverterOptions & converter_options)
+{
+  if (storage_options.empty()) {
+    throw std::invalid_argument("MultiBagReader needs at least one bag to read.");
+  }
+  reset();
+
+  // A bag failing to open closes the bags opened before it.
+  try {
+    for (const auto & bag_storage_options : storage_options) {
+      auto bag_reader = std::make_unique<PrefetchingReader>(
+        reader_factory_(bag_storage_options), read_ahead_messages_);
+      bag_reader->open(bag_storage_options, converter_options);
+
+      for (const auto & topic : bag_reader->get_all_topics_and_types()) {
+        const auto known_topic = std::find_if(
+          topics_.begin(), topics_.end(),
+          [&topic](const rosbag2_storage::TopicMetadata & candidate) {
+            return candidate.name == topic.name;
+          });
+        if (known_topic == topics_.end()) {
+          topics_.push_back(topic);
+        } else if (known_topic->type != topic.type) {
+          throw std::runtime_error(
+                  "Topic '" + topic.name + "' has type '" + known_topic->type +
+                  "' in one bag and type '" + topic.type + "' in bag '" +
+                  bag_storage_options.uri + "'.");
+        }
+      }
+      merge_bag_metadata(bag_storage_options.uri, bag_reader->get_metadata());
+      bag_readers_.push_back(std::move(bag_reader));
+    }
+  } catch (...) {
+    reset();
+    throw;
+  }
+}
+
+void MultiBagReader::reset()
+{
+  // Stops reading ahead before the readers are released.
+  bag_readers_.clear();
+  metadata_ = rosbag2_storage::BagMetadata();
+  topics_.clear();
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+bool MultiBagReader::has_next()
+{
+  check_is_open("reading");
+  if (!next_messages_filled_) {
+    fill_next_messages();
+  }
+  return !next_messages_.empty();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> MultiBagReader::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("There are no more messages to read.");
+  }
+
+  std::pop_heap(next_messages_.begin(), next_messages_.end(), is_later_than);
+  auto next_message = std::move(next_messages_.back());
+  next_messages_.pop_back();
+  push_next_message(next_message.bag_index);
+  return next_message.message;
+}
+
+const rosbag2_storage::BagMetadata & MultiBagReader::get_metadata() const
+{
+  return metadata_;
+}
+
+std::vector<rosbag2_storage::TopicMetadata> MultiBagReader::get_all_topics_and_types() const
+{
+  return topics_;
+}
+
+void MultiBagReader::set_filter(const rosbag2_storage::StorageFilter & storage_filter)
+{
+  check_is_open("setting filter");
+  storage_filter_ = storage_filter;
+  for (auto & bag_reader : bag_readers_) {
+    bag_reader->set_filter(storage_filter_);
+  }
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+void MultiBagReader::reset_filter()
+{
+  check_is_open("resetting filter");
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  for (auto & bag_reader : bag_readers_) {
+    bag_reader->reset_filter();
+  }
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+void MultiBagReader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  check_is_open("seeking");
+  for (auto & bag_reader : bag_readers_) {
+    bag_reader->seek(timestamp);
+  }
+  next_messages_.clear();
+  next_messages_filled_ = false;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+MultiBagReader::read_latest_messages(
+  const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+{
+  check_is_open("reading the latest messages");
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> latest_messages(
+    topic_names.size());
+  for (auto & bag_reader : bag_readers_) {
+    for (auto & message : bag_reader->read_latest_messages(topic_names, timestamp)) {
+      const auto topic = std::find(topic_names.begin(), topic_names.end(), message->topic_name);
+      if (topic == topic_names.end()) {
+        continue;
+      }
+      auto & latest_message = latest_messages[topic - topic_names.begin()];
+      if (!latest_message || message->time_stamp > latest_message->time_stamp) {
+        latest_message = std::move(message);
+      }
+    }
+  }
+  latest_messages.erase(
+    std::remove(latest_messages.begin(), latest_messages.end(), nullptr), latest_messages.end());
+  return latest_messages;
+}
+
+void MultiBagReader::check_is_open(const std::string & action) const
+{
+  if (bag_readers_.empty()) {
+    throw std::runtime_error("Bag is not open. Call open() before " + action + ".");
+  }
+}
+
+void MultiBagReader::fill_next_messages()
+{
+  next_messages_.clear();
+  for (size_t i = 0; i < bag_readers_.size(); ++i) {
+    push_next_message(i);
+  }
+  next_messages_filled_ = true;
+}
+
+void MultiBagReader::push_next_message(size_t bag_index)
+{
+  auto & bag_reader = bag_readers_[bag_index];
+  if (bag_reader->has_next()) {
+    auto message = bag_reader->read_next();
+    const auto time_stamp =
+      storage_filter_.order_by_publish_time && message->publish_time_stamp != 0 ?
+      message->publish_time_stamp : message->time_stamp;
+    next_messages_.push_back({std::move(message), time_stamp, bag_index});
+    std::push_heap(next_messages_.begin(), next_messages_.end(), is_later_than);
+  }
+}
+
+bool MultiBagReader::is_later_than(const NextMessage & lhs, const NextMessage & rhs)
+{
+  if (lhs.time_stamp != rhs.time_stamp) {
+    return lhs.time_stamp > rhs.time_stamp;
+  }
+  return lhs.bag_index > rhs.bag_index;
+}
+
+void MultiBagReader::merge_bag_metadata(
+  const std::string & uri, const rosbag2_storage::BagMetadata & metadata)
+{
+  if (bag_readers_.empty()) {
+    metadata_.storage_identifier = metadata.storage_identifier;
+    metadata_.compression_format = metadata.compression_format;
+    metadata_.compression_mode = metadata.compression_mode;
+    metadata_.message_count = 0;
+  }
+
+  for (auto file : metadata.files) {
+    if (!uri.empty() && !rcpputils::fs::path(file.path).is_absolute()) {
+      file.path = (rcpputils::fs::path(uri) / file.path).string();
+    }
+    metadata_.relative_file_paths.push_back(file.path);
+    metadata_.files.push_back(file);
+  }
+
+  for (const auto & bag_topic : metadata.topics_with_message_count) {
+    const auto topic = std::find_if(
+      metadata_.topics_with_message_count.begin(), metadata_.topics_with_message_count.end(),
+      [&bag_topic](const rosbag2_storage::TopicInformation & candidate) {
+        return candidate.topic_metadata.name == bag_topic.topic_metadata.name;
+      });
+    if (topic != metadata_.topics_with_message_count.end()) {
+      topic->message_count += bag_topic.message_count;
+      topic->total_size += bag_topic.total_size;
+      topic->max_message_size = std::max(topic->max_message_size, bag_topic.max_message_size);
+      topic->compressed_size += bag_topic.compressed_size;
+      topic->dropped_message_count += bag_topic.dropped_message_count;
+      rosbag2_storage::merge_histograms(topic->histogram, bag_topic.histogram);
+    } else {
+      metadata_.topics_with_message_count.push_back(bag_topic);
+    }
+  }
+
+  if (metadata.message_count > 0u) {
+    if (metadata_.message_count == 0u) {
+      metadata_.starting_time = metadata.starting_time;
+      metadata_.duration = metadata.duration;
+    } else {
+      const auto ending_time = std::max(
+        metadata_.starting_time + metadata_.duration,
+        metadata.starting_time + metadata.duration);
+      metadata_.starting_time = std::min(metadata_.starting_time, metadata.starting_time);
+      metadata_.duration = ending_time - metadata_.starting_time;
+    }
+    metadata_.message_count += metadata.message_count;
+  }
+  metadata_.bag_size += metadata.bag_size;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
@@ -0,0 +1,218 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/parallel_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+ParallelReader::ParallelReader(ReaderFactory reader_factory, size_t max_threads)
+: reader_factory_(std::move(reader_factory)), max_threads_(max_threads)
+{
+  if (!reader_factory_) {
+    reader_factory_ = []() {return std::make_unique<SequentialReader>();};
+  }
+  if (max_threads_ == 0) {
+    max_threads_ = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+}
+
+void ParallelReader::read(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options,
+  const std::vector<rosbag2_storage::StorageFilter> & partitions,
+  const ReadPartition & read_partition)
+{
+  // Protects the members below and serializes opening and releasing readers.
+  std::mutex mutex;
+  size_t next_partition = 0;
+  std::exception_ptr error;
+
+  auto read_partitions = [&]() {
+      while (true) {
+        std::unique_ptr<reader_interfaces::BaseReaderInterface> reader;
+        size_t partition_index;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (error || next_partition >= partitions.size()) {
+            return;
+          }
+          partition_index = next_partition++;
+          try {
+            reader = reader_factory_();
+            if (!reader) {
+              throw std::runtime_error("The reader factory created no reader.");
+            }
+            reader->open(storage_options, converter_options);
+            reader->set_filter(partitions[partition_index]);
+          } catch (...) {
+            error = std::current_exception();
+            reader.reset();
+            return;
+          }
+        }
+
+        try {
+          read_partition(partition_index, *reader);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        reader.reset();
+      }
+    };
+
+  const auto thread_count = std::min(max_threads_, partitions.size());
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  try {
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back(
+        [&read_partitions]() {
+          ThreadPool::configure_current_thread();
+          read_partitions();
+        });
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+    for (auto & thread : threads) {
+      thread.join();
+    }
+    std::rethrow_exception(error);
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+std::vector<rosbag2_storage::StorageFilter> ParallelReader::partition_by_time(
+  const rosbag2_storage::BagMetadata & metadata, size_t count,
+  const rosbag2_storage::StorageFilter & storage_filter)
+{
+  if (count == 0) {
+    throw std::invalid_argument("The number of partitions has to be at least 1.");
+  }
+
+  const rcutils_time_point_value_t bag_start =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+    metadata.starting_time.time_since_epoch()).count();
+  const auto begin = storage_filter.start_time > 0 ? storage_filter.start_time : bag_start;
+  const auto end = storage_filter.end_time > 0 ?
+    storage_filter.end_time : bag_start + metadata.duration.count();
+  if (metadata.message_count == 0 || end <= begin) {
+    return {storage_filter};
+  }
+
+  // The ranges cover [begin, end] with both ends included, so a nanosecond more than end - begin.
+  const auto span = static_cast<uint64_t>(end - begin) + 1u;
+  const auto partition_count = std::min<uint64_t>(count, span);
+  auto lower_bound = [begin, span, partition_count](uint64_t partition_index) {
+      return begin + static_cast<rcutils_time_point_value_t>(
+        span / partition_count * partition_index +
+        std::min(partition_index, span % partition_count));
+    };
+
+  // The first and last partition keep the bounds of the storage filter, so that messages
+  // published before or after the time range of the metadata are read as well.
+  std::vector<rosbag2_storage::StorageFilter> partitions;
+  for (uint64_t i = 0; i < partition_count; ++i) {
+    auto partition = storage_filter;
+    if (i > 0) {
+      partition.start_time = lower_bound(i);
+    }
+    if (i + 1 < partition_count) {
+      partition.end_time = lower_bound(i + 1) - 1;
+    }
+    partitions.push_back(std::move(partition));
+  }
+  return partitions;
+}
+
+std::vector<rosbag2_storage::StorageFilter> ParallelReader::partition_by_topic(
+  const rosbag2_storage::BagMetadata & metadata, size_t count,
+  const rosbag2_storage::StorageFilter & storage_filter)
+{
+  if (count == 0) {
+    throw std::invalid_argument("The number of partitions has to be at least 1.");
+  }
+
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter);
+  std::vector<const rosbag2_storage::TopicInformation *> topics;
+  for (const auto & topic_information : metadata.topics_with_message_count) {
+    if (topic_filter.is_selected(
+        topic_information.topic_metadata.name, topic_information.topic_metadata.type))
+    {
+      topics.push_back(&topic_information);
+    }
+  }
+  std::sort(
+    topics.begin(), topics.end(),
+    [](const rosbag2_storage::TopicInformation * lhs,
+    const rosbag2_storage::TopicInformation * rhs) {
+      if (lhs->message_count != rhs->message_count) {
+        return lhs->message_count > rhs->message_count;
+      }
+      return lhs->topic_metadata.name < rhs->topic_metadata.name;
+    });
+
+  // Topics with the most messages first go to the partition with the fewest messages so far.
+  std::vector<rosbag2_storage::StorageFilter> partitions(std::min(count, topics.size()));
+  std::vector<size_t> message_counts(partitions.size(), 0u);
+  for (const auto * topic : topics) {
+    const auto lightest = static_cast<size_t>(
+      std::min_element(message_counts.begin(), message_counts.end()) - message_counts.begin());
+    partitions[lightest].topics.push_back(topic->topic_metadata.name);
+    message_counts[lightest] += topic->message_count;
+  }
+  // The topics are resolved already, so the regex and types are not needed any more.
+  for (auto & partition : partitions) {
+    partition.start_time = storage_filter.start_time;
+    partition.end_time = storage_filter.end_time;
+    partition.order_by_publish_time = storage_filter.order_by_publish_time;
+    partition.sample_interval = storage_filter.sample_interval;
+    partition.sample_stride = storage_filter.sample_stride;
+    partition.topic_time_ranges = storage_filter.topic_time_ranges;
+  }
+  return partitions;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
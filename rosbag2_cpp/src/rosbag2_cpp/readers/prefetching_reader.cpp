@@ -0,0 +1,340 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/prefetching_reader.hpp"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+namespace
+{
+uint64_t get_serialized_size(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return message.serialized_data ? message.serialized_data->buffer_length : 0u;
+}
+}  // namespace
+
+PrefetchingReader::PrefetchingReader(
+  std::unique_ptr<reader_interfaces::BaseReaderInterface> reader,
+  size_t max_messages,
+  uint64_t max_bytes)
+: reader_(std::move(reader)),
+  max_messages_(max_messages),
+  max_bytes_(max_bytes)
+{
+  if (max_messages_ == 0u && max_bytes_ == 0u) {
+    throw std::invalid_argument(
+            "PrefetchingReader needs a limit on the messages or bytes to read ahead.");
+  }
+}
+
+PrefetchingReader::~PrefetchingReader()
+{
+  reset();
+}
+
+void PrefetchingReader::open(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  stop_prefetching();
+  reader_->open(storage_options, converter_options);
+  is_open_ = true;
+}
+
+void PrefetchingReader::reset()
+{
+  stop_prefetching();
+  is_open_ = false;
+  reader_->reset();
+}
+
+bool PrefetchingReader::has_next()
+{
+  if (!is_open_) {
+    throw std::runtime_error("Bag is not open. Call open() before reading.");
+  }
+  if (!prefetch_thread_.joinable()) {
+    start_prefetching();
+  }
+
+  std::unique_lock<std::mutex> lock(buffer_mutex_);
+  buffer_not_empty_.wait(lock, [this] {return !buffer_.empty() || reached_end_;});
+  if (!buffer_.empty()) {
+    return true;
+  }
+  // Errors are raised once all messages read before are consumed.
+  if (prefetch_error_) {
+    std::rethrow_exception(std::exchange(prefetch_error_, nullptr));
+  }
+  return false;
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> PrefetchingReader::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("There are no more messages to read.");
+  }
+
+  std::lock_guard<std::mutex> lock(buffer_mutex_);
+  auto message = std::move(buffer_.front());
+  buffer_.pop_front();
+  buffer_size_bytes_ -= get_serialized_size(*message);
+  buffer_not_full_.notify_one();
+  return message;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+PrefetchingReader::read_next_batch(size_t max_messages, size_t max_bytes)
+{
+  if (!has_next()) {
+    return {};
+  }
+
+  std::lock_guard<std::mutex> lock(buffer_mutex_);
+  return take_batch(max_messages, max_bytes);
+}
+
+std::future<std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+PrefetchingReader::read_next_batch_async(
+  size_t max_messages, size_t max_bytes, const std::function<void()> & ready_callback)
+{
+  if (!is_open_) {
+    throw std::runtime_error("Bag is not open. Call open() before reading.");
+  }
+  if (!prefetch_thread_.joinable()) {
+    start_prefetching();
+  }
+
+  auto read = std::make_unique<PendingRead>();
+  read->max_messages = max_messages;
+  read->max_bytes = max_bytes;
+  read->ready_callback = ready_callback;
+  auto future = read->promise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    if (pending_read_) {
+      throw std::runtime_error("Another asynchronous read is pending.");
+    }
+    if (buffer_.empty() && !reached_end_) {
+      pending_read_ = std::move(read);
+      return future;
+    }
+    fulfill(*read);
+  }
+  if (read->ready_callback) {
+    read->ready_callback();
+  }
+  return future;
+}
+
+bool PrefetchingReader::cancel_async_read()
+{
+  std::unique_ptr<PendingRead> read;
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    read = std::move(pending_read_);
+  }
+  if (!read) {
+    return false;
+  }
+  // Destroying the promise breaks it before the consumer is resumed.
+  const auto ready_callback = std::move(read->ready_callback);
+  read.reset();
+  if (ready_callback) {
+    ready_callback();
+  }
+  return true;
+}
+
+const rosbag2_storage::BagMetadata & PrefetchingReader::get_metadata() const
+{
+  std::lock_guard<std::mutex> lock(reader_mutex_);
+  return reader_->get_metadata();
+}
+
+std::vector<rosbag2_storage::TopicMetadata> PrefetchingReader::get_all_topics_and_types() const
+{
+  std::lock_guard<std::mutex> lock(reader_mutex_);
+  return reader_->get_all_topics_and_types();
+}
+
+void PrefetchingReader::set_filter(const rosbag2_storage::StorageFilter & storage_filter)
+{
+  stop_prefetching();
+  reader_->set_filter(storage_filter);
+}
+
+void PrefetchingReader::reset_filter()
+{
+  stop_prefetching();
+  reader_->reset_filter();
+}
+
+void PrefetchingReader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  stop_prefetching();
+  reader_->seek(timestamp);
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+PrefetchingReader::read_latest_messages(
+  const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+{
+  std::lock_guard<std::mutex> lock(reader_mutex_);
+  return reader_->read_latest_messages(topic_names, timestamp);
+}
+
+void PrefetchingReader::start_prefetching()
+{
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    reached_end_ = false;
+  }
+  prefetch_thread_ = std::thread(&PrefetchingReader::prefetch, this);
+}
+
+void PrefetchingReader::stop_prefetching()
+{
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    stop_requested_ = true;
+  }
+  buffer_not_full_.notify_all();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    buffer_.clear();
+    buffer_size_bytes_ = 0;
+    stop_requested_ = false;
+    reached_end_ = true;
+    prefetch_error_ = nullptr;
+  }
+  cancel_async_read();
+}
+
+void PrefetchingReader::prefetch()
+{
+  ThreadPool::configure_current_thread();
+  try {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(buffer_mutex_);
+        buffer_not_full_.wait(lock, [this] {return stop_requested_ || !is_buffer_full();});
+        if (stop_requested_) {
+          return;
+        }
+      }
+
+      // Read without holding the buffer lock, so the consumer keeps taking messages meanwhile.
+      std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+      {
+        std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+        if (!reader_->has_next()) {
+          break;
+        }
+        message = reader_->read_next();
+      }
+
+      std::unique_ptr<PendingRead> read;
+      {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        buffer_size_bytes_ += get_serialized_size(*message);
+        buffer_.push_back(std::move(message));
+        buffer_not_empty_.notify_one();
+        if (pending_read_) {
+          read = std::move(pending_read_);
+          fulfill(*read);
+        }
+      }
+      if (read && read->ready_callback) {
+        read->ready_callback();
+      }
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    prefetch_error_ = std::current_exception();
+  }
+
+  std::unique_ptr<PendingRead> read;
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    reached_end_ = true;
+    buffer_not_empty_.notify_all();
+    if (pending_read_) {
+      read = std::move(pending_read_);
+      fulfill(*read);
+    }
+  }
+  if (read && read->ready_callback) {
+    read->ready_callback();
+  }
+}
+
+bool PrefetchingReader::is_buffer_full() const
+{
+  // A single message is always buffered, even if it exceeds the byte limit.
+  if (buffer_.empty()) {
+    return false;
+  }
+  if (max_messages_ > 0u && buffer_.size() >= max_messages_) {
+    return true;
+  }
+  return max_bytes_ > 0u && buffer_size_bytes_ >= max_bytes_;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+PrefetchingReader::take_batch(size_t max_messages, size_t max_bytes)
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  size_t bytes = 0;
+  while ((max_messages == 0 || messages.size() < max_messages) &&
+    (max_bytes == 0 || bytes < max_bytes) && !buffer_.empty())
+  {
+    const auto message_size = get_serialized_size(*buffer_.front());
+    bytes += message_size;
+    buffer_size_bytes_ -= message_size;
+    messages.push_back(std::move(buffer_.front()));
+    buffer_.pop_front();
+  }
+  buffer_not_full_.notify_one();
+  return messages;
+}
+
+void PrefetchingReader::fulfill(PendingRead & read)
+{
+  if (!buffer_.empty()) {
+    read.promise.set_value(take_batch(read.max_messages, read.max_bytes));
+  } else if (prefetch_error_) {
+    read.promise.set_exception(std::exchange(prefetch_error_, nullptr));
+  } else {
+    read.promise.set_value({});
+  }
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
@@ -0,0 +1,236 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/random_access_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+RandomAccessReader::RandomAccessReader(
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory,
+  std::shared_ptr<SerializationFormatConverterFactoryInterface> converter_factory,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io)
+: SequentialReader(
+    std::move(storage_factory), std::move(converter_factory), std::move(metadata_io))
+{}
+
+RandomAccessReader::~RandomAccessReader()
+{
+  reset();
+}
+
+void RandomAccessReader::open(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  reset();
+  SequentialReader::open(storage_options, converter_options);
+  if (!metadata_.compression_format.empty()) {
+    reset();
+    throw std::runtime_error("Messages of compressed bags cannot be read by index.");
+  }
+  storage_options_ = storage_options;
+  // The files are opened once they are read from, as most are not for a single message.
+  file_storages_.resize(std::max<size_t>(file_paths_.size(), 1u));
+}
+
+void RandomAccessReader::reset()
+{
+  file_storages_.clear();
+  first_indices_.clear();
+  SequentialReader::reset();
+}
+
+uint64_t RandomAccessReader::get_topic_message_count(const std::string & topic_name)
+{
+  check_is_open();
+  return get_first_indices(topic_name).back();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> RandomAccessReader::read_topic_message(
+  const std::string & topic_name, uint64_t index)
+{
+  check_is_open();
+  const auto & first_indices = get_first_indices(topic_name);
+  if (index >= first_indices.back()) {
+    throw std::out_of_range(
+            "Topic " + topic_name + " has no message with index " + std::to_string(index) + ".");
+  }
+  // The last file whose first message is at or before the index, skipping files without any.
+  const auto file_index = static_cast<size_t>(
+    std::upper_bound(first_indices.begin(), first_indices.end() - 1, index) -
+    first_indices.begin() - 1);
+  auto & file_storage = get_file_storage(file_index);
+  const auto index_in_file = index - first_indices[file_index];
+
+  auto message = file_storage.storage->read_topic_message(topic_name, index_in_file);
+  if (file_storage.deduplicated_message_expander) {
+    // A reference refers to the data of the previous message of its topic, unless that was read
+    // last the data is read from the file again.
+    if (file_storage.last_topic_name != topic_name ||
+      file_storage.last_index + 1 != index_in_file)
+    {
+      file_storage.deduplicated_message_expander->reset();
+    }
+    file_storage.deduplicated_message_expander->expand(*message);
+  }
+  if (file_storage.delta_message_decoder) {
+    file_storage.delta_message_decoder->decode(*message);
+  }
+  file_storage.last_topic_name = topic_name;
+  file_storage.last_index = index_in_file;
+  return converter_ ? converter_->convert(message) : message;
+}
+
+uint64_t RandomAccessReader::find_topic_message(
+  const std::string & topic_name, const rcutils_time_point_value_t & timestamp)
+{
+  check_is_open();
+  const auto & first_indices = get_first_indices(topic_name);
+  uint64_t index = 0;
+  for (size_t i = 0; i + 1 < first_indices.size(); ++i) {
+    const auto file_message_count = first_indices[i + 1] - first_indices[i];
+    if (file_message_count == 0) {
+      continue;
+    }
+    index += ends_before(i, timestamp) ? file_message_count :
+      get_file_storage(i).storage->find_topic_message(topic_name, timestamp);
+  }
+  return index;
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage>
+RandomAccessReader::read_nearest_topic_message(
+  const std::string & topic_name, const rcutils_time_point_value_t & timestamp)
+{
+  const auto index = find_topic_message(topic_name, timestamp);
+  const auto message_count = get_topic_message_count(topic_name);
+  if (message_count == 0) {
+    return nullptr;
+  }
+  if (index == 0) {
+    return read_topic_message(topic_name, 0);
+  }
+  auto earlier_message = read_topic_message(topic_name, index - 1);
+  if (index == message_count) {
+    return earlier_message;
+  }
+  auto later_message = read_topic_message(topic_name, index);
+  return later_message->time_stamp - timestamp < timestamp - earlier_message->time_stamp ?
+         later_message : earlier_message;
+}
+
+void RandomAccessReader::check_is_open() const
+{
+  if (!storage_) {
+    throw std::runtime_error("Bag is not open. Call open() before reading.");
+  }
+}
+
+RandomAccessReader::FileStorage & RandomAccessReader::get_file_storage(size_t file_index)
+{
+  auto & file_storage = file_storages_[file_index];
+  if (file_storage) {
+    return *file_storage;
+  }
+
+  file_storage = std::make_unique<FileStorage>();
+  // The storage of the first file, or of the bag without metadata file, is opened already.
+  file_storage->storage = file_index == 0 ? storage_ : storage_factory_->open_read_only(
+    file_paths_[file_index], storage_options_.storage_id);
+  if (!file_storage->storage) {
+    file_storage.reset();
+    throw std::runtime_error{"No storage could be initialized. Abort"};
+  }
+  if (!file_storage->storage->get_capabilities().random_access) {
+    file_storage.reset();
+    throw std::runtime_error(
+            "The storage plugin " + storage_options_.storage_id +
+            " does not support reading messages by index.");
+  }
+  if (file_index > 0 && file_storage->storage->get_capabilities().message_pool) {
+    file_storage->storage->set_message_pool(message_pool_);
+  }
+
+  const auto file_path = file_paths_[file_index];
+  if (deduplicated_message_expander_) {
+    file_storage->deduplicated_message_expander = std::make_unique<DeduplicatedMessageExpander>(
+      metadata_, [this, file_path]() {
+        return storage_factory_->open_read_only(file_path, storage_options_.storage_id);
+      });
+  }
+  if (delta_message_decoder_) {
+    file_storage->delta_message_decoder = std::make_unique<DeltaMessageDecoder>(
+      metadata_,
+      [this, file_path](const std::string & topic_name, rcutils_time_point_value_t end_time) {
+        auto storage = storage_factory_->open_read_only(file_path, storage_options_.storage_id);
+        if (!storage) {
+          throw std::runtime_error{"No storage could be initialized. Abort"};
+        }
+        return DeltaMessageDecoder::read_stored_messages(*storage, topic_name, end_time);
+      });
+  }
+  return *file_storage;
+}
+
+const std::vector<uint64_t> & RandomAccessReader::get_first_indices(
+  const std::string & topic_name)
+{
+  const auto found = first_indices_.find(topic_name);
+  if (found != first_indices_.end()) {
+    return found->second;
+  }
+
+  std::vector<uint64_t> first_indices{0};
+  for (size_t i = 0; i < file_storages_.size(); ++i) {
+    uint64_t file_message_count = 0;
+    // The message counts in the metadata spare opening files without messages of the topic.
+    if (i < metadata_.files.size() && !metadata_.files[i].topic_message_counts.empty()) {
+      const auto & file = metadata_.files[i];
+      const auto topic = std::find(file.topics.begin(), file.topics.end(), topic_name);
+      if (topic != file.topics.end()) {
+        file_message_count = file.topic_message_counts[topic - file.topics.begin()];
+      }
+    } else {
+      file_message_count = get_file_storage(i).storage->get_topic_message_count(topic_name);
+    }
+    first_indices.push_back(first_indices.back() + file_message_count);
+  }
+  return first_indices_.emplace(topic_name, std::move(first_indices)).first->second;
+}
+
+bool RandomAccessReader::ends_before(
+  size_t file_index, rcutils_time_point_value_t timestamp) const
+{
+  if (file_index >= metadata_.files.size()) {
+    return false;
+  }
+  const auto & file = metadata_.files[file_index];
+  const auto starting_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    file.starting_time.time_since_epoch()).count();
+  // Files written before their time range was recorded have none.
+  return starting_time != 0 && starting_time + file.duration.count() < timestamp;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
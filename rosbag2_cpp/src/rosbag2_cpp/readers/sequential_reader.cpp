@@ -12,9 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -24,6 +27,10 @@
 #include "rosbag2_cpp/logging.hpp"
 #include "rosbag2_cpp/readers/sequential_reader.hpp"
 
+#include "rosbag2_storage/memory_arena.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/tracing.hpp"
+
 namespace
 {
 void fill_topics_and_types(
@@ -36,6 +43,40 @@ void fill_topics_and_types(
     topics_and_types.push_back(topic_information.topic_metadata);
   }
 }
+
+// Type of the topic as listed in the metadata, or an empty string if it is not listed.
+std::string find_topic_type(
+  const rosbag2_storage::BagMetadata & metadata, const std::string & topic_name)
+{
+  for (const auto & topic_information : metadata.topics_with_message_count) {
+    if (topic_information.topic_metadata.name == topic_name) {
+      return topic_information.topic_metadata.type;
+    }
+  }
+  return "";
+}
+
+// Index of the first file which may hold messages at or after the timestamp.
+// Files without a time range are not skipped, as they might hold any messages.
+size_t find_file_for_time(
+  const rosbag2_storage::BagMetadata & metadata, size_t file_count,
+  rcutils_time_point_value_t timestamp)
+{
+  if (metadata.files.size() != file_count) {
+    return 0;
+  }
+  for (size_t i = 0; i < file_count; ++i) {
+    const auto & file = metadata.files[i];
+    const auto starting_time = file.starting_time.time_since_epoch().count();
+    if (starting_time == 0 && file.duration.count() == 0) {
+      return i;
+    }
+    if (starting_time + file.duration.count() >= timestamp) {
+      return i;
+    }
+  }
+  return file_count - 1;
+}
 }  // unnamed namespace
 
 namespace rosbag2_cpp
@@ -95,6 +136,26 @@ void SequentialReader::reset()
 void SequentialReader::open(
   const StorageOptions & storage_options, const ConverterOptions & converter_options)
 {
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  seek_time_ = 0;
+  conversion_threads_ = converter_options.conversion_threads;
+  deduplicated_message_expander_.reset();
+  delta_message_decoder_.reset();
+  // Maps and touches the memory of the messages before the first one is read.
+  rosbag2_storage::MemoryArena::get_shared();
+  message_pool_ = storage_options.message_pool_size > 0 ?
+    std::make_shared<rosbag2_storage::MessagePool>(storage_options.message_pool_size) : nullptr;
+  followed_uri_.clear();
+  follow_poll_interval_ = std::chrono::milliseconds(storage_options.follow_poll_interval_ms);
+  if (follow_poll_interval_.count() > 0) {
+    if (!metadata_io_->metadata_file_exists(storage_options.uri)) {
+      throw std::runtime_error(
+              "Could not find metadata for bag \"" + storage_options.uri + "\" to follow. "
+              "Its recorder has to write metadata checkpoints.");
+    }
+    followed_uri_ = storage_options.uri;
+  }
+
   // If there is a metadata.yaml file present, load it.
   // If not, let's ask the storage with the given URI for its metadata.
   // This is necessary for non ROS2 bags (aka ROS1 legacy bags).
@@ -114,12 +175,18 @@ void SequentialReader::open(
     if (!storage_) {
       throw std::runtime_error{"No storage could be initialized. Abort"};
     }
+    if (storage_->get_capabilities().message_pool) {
+      storage_->set_message_pool(message_pool_);
+    }
   } else {
     storage_ = storage_factory_->open_read_only(
       storage_options.uri, storage_options.storage_id);
     if (!storage_) {
       throw std::runtime_error{"No storage could be initialized. Abort"};
     }
+    if (storage_->get_capabilities().message_pool) {
+      storage_->set_message_pool(message_pool_);
+    }
     metadata_ = storage_->get_metadata();
     if (metadata_.relative_file_paths.empty()) {
       ROSBAG2_CPP_LOG_WARN("No file paths were found in metadata.");
@@ -135,25 +202,47 @@ void SequentialReader::open(
   }
   fill_topics_and_types(metadata_, topics_metadata_);
 
-  // Currently a bag file can only be played if all topics have the same serialization format.
-  check_topics_serialization_formats(topics);
-  check_converter_serialization_format(
-    converter_options.output_serialization_format,
-    topics[0].topic_metadata.serialization_format);
+  deduplicated_message_expander_ = std::make_unique<DeduplicatedMessageExpander>(
+    metadata_, [this]() {
+      return storage_factory_->open_read_only(get_current_file(), metadata_.storage_identifier);
+    });
+  if (!deduplicated_message_expander_->has_deduplicated_topics()) {
+    deduplicated_message_expander_.reset();
+  }
+  setup_delta_decoding();
+
+  setup_converter(converter_options.output_serialization_format, topics);
 }
 
 bool SequentialReader::has_next()
 {
   if (storage_) {
-    // If there's no new message, check if there's at least another file to read and update storage
-    // to read from there. Otherwise, check if there's another message.
-    if (!storage_->has_next() && has_next_file()) {
-      load_next_file();
-      storage_ = storage_factory_->open_read_only(
-        get_current_file(), metadata_.storage_identifier);
-    }
+    while (true) {
+      // If there's no new message, check if there's at least another file to read and update
+      // storage to read from there. Otherwise, check if there's another message. Files which
+      // cannot hold messages passing the filter are not opened at all.
+      while (!storage_->has_next() && has_next_file()) {
+        load_next_file();
+        skip_unselected_files();
+        load_current_file();
+      }
+      if (followed_uri_.empty() || storage_->has_next()) {
+        return storage_->has_next();
+      }
 
-    return storage_->has_next();
+      // Checked first, so that everything written before the recording finished is still read.
+      // A split file is listed only once its predecessor is complete, which is therefore polled
+      // before moving on to it.
+      const bool recording_finished = is_followed_recording_finished();
+      const bool has_new_files = update_followed_metadata();
+      if (!storage_->poll_new_messages() && !has_new_files) {
+        if (recording_finished) {
+          followed_uri_.clear();
+        } else {
+          std::this_thread::sleep_for(follow_poll_interval_);
+        }
+      }
+    }
   }
   throw std::runtime_error("Bag is not open. Call open() before reading.");
 }
@@ -162,11 +251,72 @@ std::shared_ptr<rosbag2_storage::SerializedBagMessage> SequentialReader::read_ne
 {
   if (storage_) {
     auto message = storage_->read_next();
+    ROSBAG2_TRACEPOINT(read_next, message->topic_name.c_str(), message->time_stamp);
+    if (deduplicated_message_expander_) {
+      deduplicated_message_expander_->expand(*message);
+    }
+    if (delta_message_decoder_) {
+      delta_message_decoder_->decode(*message);
+    }
     return converter_ ? converter_->convert(message) : message;
   }
   throw std::runtime_error("Bag is not open. Call open() before reading.");
 }
 
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialReader::read_next_batch(size_t max_messages, size_t max_bytes)
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  size_t bytes = 0;
+  // has_next() loads the next file, so a batch may span several files.
+  while ((max_messages == 0 || messages.size() < max_messages) &&
+    (max_bytes == 0 || bytes < max_bytes) && has_next())
+  {
+    auto storage_messages = storage_->read_next_batch(
+      max_messages == 0 ? 0 : max_messages - messages.size(),
+      max_bytes == 0 ? 0 : max_bytes - bytes);
+    for (auto & message : storage_messages) {
+      ROSBAG2_TRACEPOINT(read_next, message->topic_name.c_str(), message->time_stamp);
+      if (deduplicated_message_expander_) {
+        deduplicated_message_expander_->expand(*message);
+      }
+      if (delta_message_decoder_) {
+        delta_message_decoder_->decode(*message);
+      }
+      bytes += message->serialized_data ? message->serialized_data->buffer_length : 0;
+      messages.push_back(std::move(message));
+    }
+  }
+  // The whole batch at once, which lets the converter spread it over its threads.
+  if (converter_) {
+    converter_->convert(messages);
+  }
+  return messages;
+}
+
+bool SequentialReader::visit_next_batch(
+  const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+  size_t max_messages, size_t max_bytes)
+{
+  if (!storage_) {
+    throw std::runtime_error("Bag is not open. Call open() before reading.");
+  }
+  if (converter_ || deduplicated_message_expander_ || delta_message_decoder_) {
+    return BaseReaderInterface::visit_next_batch(callback, max_messages, max_bytes);
+  }
+  // A batch ends with the file, as the views of a storage are invalid once the next is opened.
+  if (!has_next()) {
+    return false;
+  }
+  return storage_->visit_next_batch(
+    [&callback](const std::vector<rosbag2_storage::SerializedBagMessageView> & views) {
+      for (size_t i = 0; i < views.size(); ++i) {
+        ROSBAG2_TRACEPOINT(read_next, views[i].topic_name->c_str(), views[i].time_stamp);
+      }
+      callback(views);
+    }, max_messages, max_bytes);
+}
+
 const rosbag2_storage::BagMetadata & SequentialReader::get_metadata() const
 {
   rcpputils::check_true(storage_ != nullptr, "Bag is not open. Call open() before reading.");
@@ -183,7 +333,20 @@ void SequentialReader::set_filter(
   const rosbag2_storage::StorageFilter & storage_filter)
 {
   if (storage_) {
-    storage_->set_filter(storage_filter);
+    storage_filter_ = storage_filter;
+    if ((storage_filter.sample_interval != 0 || storage_filter.sample_stride != 0) &&
+      !storage_->get_capabilities().sampling)
+    {
+      ROSBAG2_CPP_LOG_WARN_STREAM(
+        "The storage plugin " << metadata_.storage_identifier <<
+          " does not support sampling, all messages are read.");
+    }
+    if (!file_paths_.empty() && !is_current_file_selected() && has_next_file()) {
+      skip_unselected_files();
+      load_current_file();
+      return;
+    }
+    set_storage_filter();
     return;
   }
   throw std::runtime_error(
@@ -193,13 +356,101 @@ void SequentialReader::set_filter(
 void SequentialReader::reset_filter()
 {
   if (storage_) {
-    storage_->reset_filter();
+    storage_filter_ = rosbag2_storage::StorageFilter();
+    if (seek_time_ > 0 && !storage_->get_capabilities().seek) {
+      set_storage_filter();
+    } else {
+      reset_message_decoding();
+      storage_->reset_filter();
+    }
     return;
   }
   throw std::runtime_error(
           "Bag is not open. Call open() before resetting filter.");
 }
 
+void SequentialReader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  if (!storage_) {
+    throw std::runtime_error("Bag is not open. Call open() before seeking.");
+  }
+  seek_time_ = timestamp;
+  if (file_paths_.empty()) {
+    seek_storage();
+    return;
+  }
+
+  const auto seek_file = file_paths_.begin() +
+    find_file_for_time(metadata_, file_paths_.size(), timestamp);
+  if (seek_file != current_file_iterator_) {
+    current_file_iterator_ = seek_file;
+    skip_unselected_files();
+    load_current_file();
+  } else {
+    seek_storage();
+  }
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialReader::read_latest_messages(
+  const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+{
+  if (!storage_) {
+    throw std::runtime_error("Bag is not open. Call open() before reading.");
+  }
+  std::unordered_map<std::string, std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  latest_messages;
+  if (file_paths_.empty()) {
+    for (auto & message : storage_->read_latest_messages(topic_names, timestamp)) {
+      latest_messages[message->topic_name] = std::move(message);
+    }
+  }
+  for (size_t i = file_paths_.size(); i > 0; --i) {
+    const auto file_index = i - 1;
+    const auto * file = metadata_.files.size() == file_paths_.size() ?
+      &metadata_.files[file_index] : nullptr;
+    const auto starting_time = file ? file->starting_time.time_since_epoch().count() : 0;
+    const bool has_time_range = file && (starting_time != 0 || file->duration.count() != 0);
+    if (has_time_range && starting_time >= timestamp) {
+      continue;
+    }
+    std::vector<std::string> file_topic_names;
+    for (const auto & topic_name : topic_names) {
+      if (file && !file->topics.empty() &&
+        std::find(file->topics.begin(), file->topics.end(), topic_name) == file->topics.end())
+      {
+        continue;
+      }
+      // Files of stripes recorded at the same time may hold later messages than files after them.
+      const auto latest_message = latest_messages.find(topic_name);
+      if (latest_message == latest_messages.end() || (has_time_range &&
+        starting_time + file->duration.count() > latest_message->second->time_stamp))
+      {
+        file_topic_names.push_back(topic_name);
+      }
+    }
+    if (file_topic_names.empty()) {
+      continue;
+    }
+    for (auto & message : read_latest_messages_of_file(file_index, file_topic_names, timestamp)) {
+      auto & latest_message = latest_messages[message->topic_name];
+      if (!latest_message || message->time_stamp > latest_message->time_stamp) {
+        latest_message = std::move(message);
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  for (const auto & topic_name : topic_names) {
+    const auto latest_message = latest_messages.find(topic_name);
+    if (latest_message != latest_messages.end()) {
+      messages.push_back(converter_ ? converter_->convert(latest_message->second) :
+        latest_message->second);
+    }
+  }
+  return messages;
+}
+
 bool SequentialReader::has_next_file() const
 {
   return current_file_iterator_ + 1 != file_paths_.end();
@@ -211,6 +462,184 @@ void SequentialReader::load_next_file()
   current_file_iterator_++;
 }
 
+void SequentialReader::skip_unselected_files()
+{
+  while (!is_current_file_selected() && has_next_file()) {
+    load_next_file();
+  }
+}
+
+bool SequentialReader::update_followed_metadata()
+{
+  // Parsed again only if the metadata changed since it was last read.
+  metadata_ = metadata_io_->read_metadata(followed_uri_);
+  fill_topics_and_types(metadata_, topics_metadata_);
+  if (metadata_.relative_file_paths.size() <= file_paths_.size()) {
+    return false;
+  }
+  const auto current_file_index = current_file_iterator_ - file_paths_.begin();
+  file_paths_ = details::resolve_relative_paths(
+    followed_uri_, metadata_.relative_file_paths, metadata_.version);
+  current_file_iterator_ = file_paths_.begin() + current_file_index;
+  return true;
+}
+
+bool SequentialReader::is_followed_recording_finished() const
+{
+  return (rcpputils::fs::path(followed_uri_) /
+         rosbag2_storage::MetadataIo::metadata_filename).exists();
+}
+
+bool SequentialReader::is_current_file_selected() const
+{
+  return is_file_selected(static_cast<size_t>(current_file_iterator_ - file_paths_.begin()));
+}
+
+bool SequentialReader::is_file_selected(size_t file_index) const
+{
+  if (metadata_.files.size() != file_paths_.size()) {
+    return true;
+  }
+  const auto & file = metadata_.files[file_index];
+  // The time ranges of the files are those of the time stamps the messages were received at.
+  const auto starting_time = file.starting_time.time_since_epoch().count();
+  const auto ending_time = starting_time + file.duration.count();
+  const bool has_time_range = !storage_filter_.order_by_publish_time &&
+    (starting_time != 0 || file.duration.count() != 0);
+  // Files are skipped if none of their selected topics has a time range overlapping them.
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter_);
+  if ((!topic_filter.selects_all_topics() || topic_filter.has_topic_time_ranges()) &&
+    !file.topics.empty() &&
+    std::none_of(
+      file.topics.begin(), file.topics.end(),
+      [this, &topic_filter, has_time_range, starting_time, ending_time](
+        const std::string & topic) {
+        return topic_filter.is_selected(topic, find_topic_type(metadata_, topic)) &&
+        (!has_time_range ||
+        rosbag2_storage::TopicFilter::overlaps(
+          topic_filter.get_time_ranges(topic), starting_time, ending_time));
+      }))
+  {
+    return false;
+  }
+
+  if (!has_time_range) {
+    return true;
+  }
+  const auto start_time = std::max(storage_filter_.start_time, seek_time_);
+  if (start_time != 0 && ending_time < start_time) {
+    return false;
+  }
+  return storage_filter_.end_time == 0 || starting_time <= storage_filter_.end_time;
+}
+
+void SequentialReader::load_current_file()
+{
+  preprocess_current_file();
+  storage_ = storage_factory_->open_read_only(get_current_file(), metadata_.storage_identifier);
+  if (!storage_) {
+    throw std::runtime_error{"No storage could be initialized. Abort"};
+  }
+  if (storage_->get_capabilities().message_pool) {
+    storage_->set_message_pool(message_pool_);
+  }
+  set_storage_filter();
+  if (seek_time_ > 0 && storage_->get_capabilities().seek) {
+    storage_->seek(seek_time_);
+  }
+}
+
+void SequentialReader::set_storage_filter()
+{
+  reset_message_decoding();
+  if (seek_time_ > 0 && !storage_->get_capabilities().seek) {
+    auto storage_filter = storage_filter_;
+    storage_filter.start_time = std::max(storage_filter.start_time, seek_time_);
+    storage_->set_filter(storage_filter);
+  } else {
+    storage_->set_filter(storage_filter_);
+  }
+}
+
+void SequentialReader::seek_storage()
+{
+  if (storage_->get_capabilities().seek) {
+    reset_message_decoding();
+    storage_->seek(seek_time_);
+  } else {
+    set_storage_filter();
+  }
+}
+
+void SequentialReader::setup_delta_decoding()
+{
+  delta_message_decoder_ = std::make_unique<DeltaMessageDecoder>(
+    metadata_, [this](const std::string & topic_name, rcutils_time_point_value_t end_time) {
+      return read_stored_messages_of_current_file(topic_name, end_time);
+    });
+  if (!delta_message_decoder_->has_delta_encoded_topics()) {
+    delta_message_decoder_.reset();
+  }
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialReader::read_stored_messages_of_current_file(
+  const std::string & topic_name, rcutils_time_point_value_t end_time)
+{
+  auto storage = storage_factory_->open_read_only(
+    get_current_file(), metadata_.storage_identifier);
+  if (!storage) {
+    throw std::runtime_error{"No storage could be initialized. Abort"};
+  }
+  return DeltaMessageDecoder::read_stored_messages(*storage, topic_name, end_time);
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SequentialReader::read_latest_messages_of_file(
+  size_t file_index, const std::vector<std::string> & topic_names,
+  rcutils_time_point_value_t timestamp)
+{
+  // The storage being read is not used, as it may be read on other threads by derived readers.
+  const auto file_path = file_paths_[file_index];
+  auto storage = storage_factory_->open_read_only(file_path, metadata_.storage_identifier);
+  if (!storage) {
+    throw std::runtime_error{"No storage could be initialized. Abort"};
+  }
+  auto messages = storage->read_latest_messages(topic_names, timestamp);
+
+  // The messages the latest ones refer to or were encoded from are read from the file as well.
+  if (deduplicated_message_expander_) {
+    DeduplicatedMessageExpander deduplicated_message_expander(
+      metadata_, [this, file_path]() {
+        return storage_factory_->open_read_only(file_path, metadata_.storage_identifier);
+      });
+    for (auto & message : messages) {
+      deduplicated_message_expander.expand(*message);
+    }
+  }
+  if (delta_message_decoder_) {
+    DeltaMessageDecoder delta_message_decoder(
+      metadata_, [&storage](const std::string & topic_name, rcutils_time_point_value_t end_time) {
+        return DeltaMessageDecoder::read_stored_messages(*storage, topic_name, end_time);
+      });
+    for (auto & message : messages) {
+      delta_message_decoder.decode(*message);
+    }
+  }
+  return messages;
+}
+
+void SequentialReader::reset_message_decoding()
+{
+  // Messages read before are not the previous ones of the messages read next anymore.
+  if (deduplicated_message_expander_) {
+    deduplicated_message_expander_->reset();
+  }
+  if (delta_message_decoder_) {
+    delta_message_decoder_->reset();
+  }
+}
+
 std::string SequentialReader::get_current_file() const
 {
   return *current_file_iterator_;
@@ -223,32 +652,31 @@ std::string SequentialReader::get_current_uri() const
   return current_uri.string();
 }
 
-void SequentialReader::check_topics_serialization_formats(
+void SequentialReader::setup_converter(
+  const std::string & output_serialization_format,
   const std::vector<rosbag2_storage::TopicInformation> & topics)
 {
-  auto storage_serialization_format = topics[0].topic_metadata.serialization_format;
-  for (const auto & topic : topics) {
-    if (topic.topic_metadata.serialization_format != storage_serialization_format) {
-      throw std::runtime_error(
-              "Topics with different rwm serialization format have been found. "
-              "All topics must have the same serialization format.");
-    }
+  converter_.reset();
+  const auto converted_topic = std::find_if(
+    topics.begin(), topics.end(),
+    [&output_serialization_format](const rosbag2_storage::TopicInformation & topic) {
+      return topic.topic_metadata.serialization_format != output_serialization_format;
+    });
+  // Messages stored in the requested format are read without any converter.
+  if (converted_topic == topics.end()) {
+    return;
   }
-}
 
-void SequentialReader::check_converter_serialization_format(
-  const std::string & converter_serialization_format,
-  const std::string & storage_serialization_format)
-{
-  if (converter_serialization_format != storage_serialization_format) {
-    converter_ = std::make_unique<Converter>(
-      storage_serialization_format,
-      converter_serialization_format,
-      converter_factory_);
-    auto topics = storage_->get_all_topics_and_types();
-    for (const auto & topic_with_type : topics) {
-      converter_->add_topic(topic_with_type.name, topic_with_type.type);
-    }
+  converter_ = std::make_unique<Converter>(
+    ConverterOptions{
+      converted_topic->topic_metadata.serialization_format, output_serialization_format,
+      conversion_threads_},
+    converter_factory_);
+  // The topics from the metadata, which spares querying the storage for them again.
+  for (const auto & topic : topics) {
+    converter_->add_topic(
+      topic.topic_metadata.name, topic.topic_metadata.type,
+      topic.topic_metadata.serialization_format);
   }
 }
 }  // namespace readers
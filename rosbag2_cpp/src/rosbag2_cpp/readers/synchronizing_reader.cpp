@@ -0,0 +1,205 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/readers/synchronizing_reader.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+namespace rosbag2_cpp
+{
+namespace readers
+{
+
+SynchronizingReader::SynchronizingReader(
+  const SynchronizationOptions & synchronization_options,
+  std::unique_ptr<reader_interfaces::BaseReaderInterface> reader)
+: SynchronizingReader(synchronization_options, *reader)
+{
+  owned_reader_ = std::move(reader);
+}
+
+SynchronizingReader::SynchronizingReader(
+  const SynchronizationOptions & synchronization_options,
+  reader_interfaces::BaseReaderInterface & opened_reader)
+: reader_(&opened_reader),
+  options_(synchronization_options),
+  queues_(synchronization_options.topics.size())
+{
+  if (options_.topics.size() < 2) {
+    throw std::invalid_argument("Messages are synchronized across at least two topics.");
+  }
+  for (size_t i = 0; i < options_.topics.size(); ++i) {
+    if (!topic_indices_.emplace(options_.topics[i], i).second) {
+      throw std::invalid_argument(
+              "Topic '" + options_.topics[i] + "' is listed twice for synchronization.");
+    }
+  }
+  if (options_.slop < 0) {
+    throw std::invalid_argument("The slop of synchronizing messages must not be negative.");
+  }
+  if (options_.queue_size == 0) {
+    throw std::invalid_argument("The queue size of synchronizing messages must not be 0.");
+  }
+}
+
+void SynchronizingReader::open(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  clear();
+  reader_->open(storage_options, converter_options);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = options_.topics;
+  storage_filter.order_by_publish_time = options_.by_publish_time;
+  reader_->set_filter(storage_filter);
+}
+
+bool SynchronizingReader::has_next()
+{
+  while (next_tuple_.empty() && !synchronize()) {
+    if (reader_->has_next()) {
+      enqueue(reader_->read_next());
+    } else if (reached_end_) {
+      return false;
+    } else {
+      // The queued messages are all there is, so the closest ones are decided.
+      reached_end_ = true;
+    }
+  }
+  return true;
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SynchronizingReader::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("There are no more synchronized messages to read.");
+  }
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> tuple;
+  tuple.swap(next_tuple_);
+  return tuple;
+}
+
+void SynchronizingReader::seek(const rcutils_time_point_value_t & timestamp)
+{
+  clear();
+  reader_->seek(timestamp);
+}
+
+const rosbag2_storage::BagMetadata & SynchronizingReader::get_metadata() const
+{
+  return reader_->get_metadata();
+}
+
+void SynchronizingReader::clear()
+{
+  for (auto & queue : queues_) {
+    queue.clear();
+  }
+  next_tuple_.clear();
+  reached_end_ = false;
+}
+
+void SynchronizingReader::enqueue(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  const auto topic_index = topic_indices_.find(message->topic_name);
+  if (topic_index == topic_indices_.end()) {
+    return;
+  }
+  auto & queue = queues_[topic_index->second];
+  // Messages arrive in time order, unless they are synchronized by a time they are not read by.
+  const auto time = get_time(*message);
+  auto position = queue.end();
+  while (position != queue.begin() && get_time(**(position - 1)) > time) {
+    --position;
+  }
+  queue.insert(position, std::move(message));
+  if (queue.size() > options_.queue_size) {
+    queue.pop_front();
+  }
+}
+
+bool SynchronizingReader::synchronize()
+{
+  while (true) {
+    if (std::any_of(
+        queues_.begin(), queues_.end(), [](const auto & queue) {return queue.empty();}))
+    {
+      return false;
+    }
+    size_t reference_topic = 0;
+    for (size_t i = 1; i < queues_.size(); ++i) {
+      if (get_time(*queues_[i].front()) > get_time(*queues_[reference_topic].front())) {
+        reference_topic = i;
+      }
+    }
+    const auto reference_time = get_time(*queues_[reference_topic].front());
+
+    // Older messages are too far from this and every later reference message.
+    bool discarded = false;
+    for (auto & queue : queues_) {
+      while (!queue.empty() && get_time(*queue.front()) < reference_time - options_.slop) {
+        queue.pop_front();
+        discarded = true;
+      }
+    }
+    if (discarded) {
+      continue;
+    }
+
+    // Every oldest message is within the slop now, but a later one may be closer.
+    std::vector<size_t> closest(queues_.size(), 0);
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      const auto & queue = queues_[i];
+      auto distance = [this, &queue, reference_time](size_t index) {
+          const auto time = get_time(*queue[index]);
+          return time < reference_time ? reference_time - time : time - reference_time;
+        };
+      while (closest[i] + 1 < queue.size() && distance(closest[i] + 1) < distance(closest[i])) {
+        ++closest[i];
+      }
+      // Messages read later are at least as late as the last queued one.
+      const bool decided = i == reference_topic || distance(closest[i]) == 0 ||
+        get_time(*queue.back()) >= reference_time || reached_end_;
+      if (!decided) {
+        return false;
+      }
+    }
+
+    next_tuple_.clear();
+    next_tuple_.reserve(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      auto & queue = queues_[i];
+      next_tuple_.push_back(std::move(queue[closest[i]]));
+      queue.erase(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(closest[i] + 1));
+    }
+    return true;
+  }
+}
+
+rcutils_time_point_value_t SynchronizingReader::get_time(
+  const rosbag2_storage::SerializedBagMessage & message) const
+{
+  return options_.by_publish_time && message.publish_time_stamp != 0 ?
+         message.publish_time_stamp : message.time_stamp;
+}
+
+}  // namespace readers
+}  // namespace rosbag2_cpp
@@ -0,0 +1,411 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/reindexer.hpp"
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <dirent.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+#include "rosbag2_storage/message_histogram.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+std::string resolve_path(const std::string & uri, const std::string & relative_file_path)
+{
+  const auto path = rcpputils::fs::path(relative_file_path);
+  return path.is_absolute() ? path.string() : (rcpputils::fs::path(uri) / path).string();
+}
+
+std::vector<rosbag2_storage::FileInformation>::const_iterator find_file(
+  const std::vector<rosbag2_storage::FileInformation> & files, const std::string & path)
+{
+  return std::find_if(
+    files.begin(), files.end(), [&path](const rosbag2_storage::FileInformation & file) {
+      return file.path == path;
+    });
+}
+
+struct DirectoryEntry
+{
+  std::string name;
+  bool is_directory;
+};
+
+std::vector<DirectoryEntry> list_directory(const std::string & directory)
+{
+  std::vector<DirectoryEntry> entries;
+#ifdef _WIN32
+  WIN32_FIND_DATAA find_data;
+  const auto find_handle = FindFirstFileA((directory + "\\*").c_str(), &find_data);
+  if (find_handle == INVALID_HANDLE_VALUE) {
+    return entries;
+  }
+  do {
+    entries.push_back(
+      {find_data.cFileName, (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0});
+  } while (FindNextFileA(find_handle, &find_data));
+  FindClose(find_handle);
+#else
+  DIR * dir = opendir(directory.c_str());
+  if (!dir) {
+    return entries;
+  }
+  while (const struct dirent * entry = readdir(dir)) {
+    bool is_directory = entry->d_type == DT_DIR;
+    if (entry->d_type == DT_UNKNOWN) {
+      is_directory = rcpputils::fs::path(directory + "/" + entry->d_name).is_directory();
+    }
+    entries.push_back({entry->d_name, is_directory});
+  }
+  closedir(dir);
+#endif
+  entries.erase(
+    std::remove_if(
+      entries.begin(), entries.end(), [](const DirectoryEntry & entry) {
+        return entry.name == "." || entry.name == "..";
+      }), entries.end());
+  return entries;
+}
+
+// Parses the number at the position of the file name, moving past it, or returns -1.
+int64_t parse_number(const std::string & file_name, size_t & position)
+{
+  const auto start = position;
+  while (position < file_name.size() && file_name[position] >= '0' &&
+    file_name[position] <= '9')
+  {
+    ++position;
+  }
+  if (position == start) {
+    return -1;
+  }
+  return std::strtoll(file_name.substr(start, position - start).c_str(), nullptr, 10);
+}
+
+// Shard and index of a bagfile named after its folder, e.g. {0, 3} for "bag_3.db3" and {1, 3}
+// for "bag_shard1_3.db3" in the folder "bag", or an index of -1 if it is no bagfile.
+std::pair<int64_t, int64_t> get_bagfile_index(
+  const std::string & file_name, const std::string & folder_name)
+{
+  const std::pair<int64_t, int64_t> no_bagfile{0, -1};
+  const auto prefix = folder_name + "_";
+  if (file_name.compare(0, prefix.size(), prefix) != 0) {
+    return no_bagfile;
+  }
+  size_t position = prefix.size();
+  int64_t shard = 0;
+  const std::string shard_prefix = "shard";
+  if (file_name.compare(position, shard_prefix.size(), shard_prefix) == 0) {
+    position += shard_prefix.size();
+    shard = parse_number(file_name, position);
+    if (shard < 0 || position == file_name.size() || file_name[position] != '_') {
+      return no_bagfile;
+    }
+    ++position;
+  }
+  const auto index = parse_number(file_name, position);
+  if (index < 0 || (position < file_name.size() && file_name[position] != '.')) {
+    return no_bagfile;
+  }
+  // Extensions must not be empty, so files being written, e.g. "bag_0.db3-journal", are skipped.
+  for (size_t i = position; i < file_name.size(); ++i) {
+    if (file_name[i] == '-' ||
+      (file_name[i] == '.' && (i + 1 == file_name.size() || file_name[i + 1] == '.')))
+    {
+      return no_bagfile;
+    }
+  }
+  return {shard, index};
+}
+
+// Removes the trailing separators of a directory, which would leave it without a name.
+std::string strip_trailing_separators(std::string directory)
+{
+  while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\')) {
+    directory.pop_back();
+  }
+  return directory;
+}
+
+// Shard of the bag directory a bagfile was written by, 0 for none.
+size_t get_shard(const std::string & uri, const std::string & relative_file_path)
+{
+  const auto path = rcpputils::fs::path(resolve_path(uri, relative_file_path));
+  const auto shard = get_bagfile_index(
+    path.filename().string(), path.parent_path().filename().string());
+  return shard.second >= 0 ? static_cast<size_t>(shard.first) : 0u;
+}
+
+void find_bagfiles_in(
+  const std::string & directory, const std::string & relative_directory,
+  std::vector<std::string> & bagfiles)
+{
+  auto entries = list_directory(directory);
+  std::sort(
+    entries.begin(), entries.end(), [](const DirectoryEntry & a, const DirectoryEntry & b) {
+      return a.name < b.name;
+    });
+  const auto folder_name = rcpputils::fs::path(directory).filename().string();
+  std::vector<std::pair<std::pair<int64_t, int64_t>, std::string>> indexed_files;
+  for (const auto & entry : entries) {
+    if (!entry.is_directory) {
+      const auto index = get_bagfile_index(entry.name, folder_name);
+      if (index.second >= 0) {
+        indexed_files.emplace_back(index, entry.name);
+      }
+    }
+  }
+  std::sort(indexed_files.begin(), indexed_files.end());
+  for (const auto & file : indexed_files) {
+    bagfiles.push_back(
+      relative_directory.empty() ? file.second :
+      (rcpputils::fs::path(relative_directory) / file.second).string());
+  }
+  for (const auto & entry : entries) {
+    if (entry.is_directory) {
+      find_bagfiles_in(
+        (rcpputils::fs::path(directory) / entry.name).string(),
+        relative_directory.empty() ? entry.name :
+        (rcpputils::fs::path(relative_directory) / entry.name).string(),
+        bagfiles);
+    }
+  }
+}
+
+// Adds the topics of a file to the topics of the bag, with the QoS profiles of the old metadata.
+void merge_topics(
+  const std::vector<rosbag2_storage::TopicInformation> & file_topics,
+  const std::vector<rosbag2_storage::TopicInformation> & old_topics,
+  std::vector<rosbag2_storage::TopicInformation> & topics)
+{
+  const auto by_name = [](const std::string & name) {
+      return [&name](const rosbag2_storage::TopicInformation & topic) {
+               return topic.topic_metadata.name == name;
+             };
+    };
+  for (const auto & file_topic : file_topics) {
+    const auto & name = file_topic.topic_metadata.name;
+    const auto topic = std::find_if(topics.begin(), topics.end(), by_name(name));
+    if (topic != topics.end()) {
+      topic->message_count += file_topic.message_count;
+      topic->total_size += file_topic.total_size;
+      topic->max_message_size = std::max(topic->max_message_size, file_topic.max_message_size);
+      rosbag2_storage::merge_histograms(topic->histogram, file_topic.histogram);
+      continue;
+    }
+    topics.push_back(file_topic);
+    auto & offered_qos_profiles = topics.back().topic_metadata.offered_qos_profiles;
+    const auto old_topic = std::find_if(old_topics.begin(), old_topics.end(), by_name(name));
+    if (old_topic != old_topics.end() && offered_qos_profiles.empty()) {
+      offered_qos_profiles = old_topic->topic_metadata.offered_qos_profiles;
+    }
+    // The storage does not know how the messages of a topic were compressed.
+    if (old_topic != old_topics.end()) {
+      topics.back().compression_format = old_topic->compression_format;
+    }
+  }
+}
+}  // namespace
+
+Reindexer::Reindexer(
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io)
+: storage_factory_(std::move(storage_factory)),
+  metadata_io_(std::move(metadata_io))
+{}
+
+rosbag2_storage::BagMetadata Reindexer::reindex(
+  const std::string & uri, const std::string & storage_id,
+  const std::vector<std::string> & relative_file_paths, size_t max_threads)
+{
+  const auto metadata = summarize(uri, storage_id, relative_file_paths, max_threads);
+  metadata_io_->write_metadata(uri, metadata);
+  return metadata;
+}
+
+rosbag2_storage::BagMetadata Reindexer::summarize(
+  const std::string & uri, const std::string & storage_id,
+  const std::vector<std::string> & relative_file_paths, size_t max_threads)
+{
+  rosbag2_storage::BagMetadata old_metadata{};
+  if (metadata_io_->metadata_file_exists(uri)) {
+    old_metadata = metadata_io_->read_metadata(uri);
+  }
+  if (old_metadata.compression_mode == "FILE") {
+    throw std::runtime_error("Bags compressed per file cannot be reindexed.");
+  }
+  const auto storage_identifier = storage_id.empty() ?
+    old_metadata.storage_identifier : storage_id;
+  if (storage_identifier.empty()) {
+    throw std::invalid_argument(
+            "The bag has no metadata file. Please specify the storage id of its bagfiles.");
+  }
+
+  // Files of older metadata versions are listed relative to the parent of the bag directory.
+  auto file_paths = relative_file_paths;
+  if (old_metadata.version >= 4) {
+    for (const auto & path : old_metadata.relative_file_paths) {
+      if (std::find(file_paths.begin(), file_paths.end(), path) == file_paths.end() &&
+        rcpputils::fs::path(resolve_path(uri, path)).exists())
+      {
+        file_paths.push_back(path);
+      }
+    }
+  }
+  if (file_paths.empty()) {
+    throw std::runtime_error("No bagfiles of the bag \"" + uri + "\" were found.");
+  }
+
+  // Storage plugins are loaded one at a time, only the summaries are read in parallel.
+  std::vector<std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>> storages;
+  for (const auto & path : file_paths) {
+    auto storage = storage_factory_->open_read_only(resolve_path(uri, path), storage_identifier);
+    if (!storage) {
+      throw std::runtime_error("The bagfile \"" + path + "\" could not be opened.");
+    }
+    storages.push_back(std::move(storage));
+  }
+
+  std::vector<rosbag2_storage::BagMetadata> file_metadata(storages.size());
+  std::vector<std::exception_ptr> errors(storages.size());
+  std::atomic<size_t> next_file{0};
+  const auto summarize_files = [&]() {
+      for (size_t i = next_file++; i < storages.size(); i = next_file++) {
+        try {
+          file_metadata[i] = storages[i]->get_metadata();
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+        storages[i].reset();
+      }
+    };
+  if (max_threads == 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(max_threads, storages.size()); ++i) {
+    threads.emplace_back(
+      [&summarize_files]() {
+        ThreadPool::configure_current_thread();
+        summarize_files();
+      });
+  }
+  summarize_files();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  for (const auto & error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.storage_identifier = storage_identifier;
+  metadata.message_count = 0;
+  metadata.compression_format = old_metadata.compression_format;
+  metadata.compression_mode = old_metadata.compression_mode;
+  metadata.compression_dictionaries = old_metadata.compression_dictionaries;
+  metadata.cache_high_water_mark_bytes = old_metadata.cache_high_water_mark_bytes;
+  metadata.bag_id = old_metadata.bag_id;
+  metadata.clock_offset = old_metadata.clock_offset;
+  metadata.encryption_format = old_metadata.encryption_format;
+  metadata.encryption_key_id = old_metadata.encryption_key_id;
+  metadata.encrypted_key = old_metadata.encrypted_key;
+  // Files of topic groups are in folders of the bag directory, every file of such a bag lists
+  // its topics.
+  const bool list_file_topics = std::any_of(
+    file_paths.begin(), file_paths.end(), [](const std::string & path) {
+      const auto file_path = rcpputils::fs::path(path);
+      return !file_path.is_absolute() && !file_path.parent_path().string().empty();
+    }) || std::any_of(
+    old_metadata.files.begin(), old_metadata.files.end(),
+    [](const rosbag2_storage::FileInformation & file) {return !file.topics.empty();});
+
+  for (size_t i = 0; i < file_paths.size(); ++i) {
+    const auto & summary = file_metadata[i];
+    rosbag2_storage::FileInformation file{};
+    const auto old_file = find_file(old_metadata.files, file_paths[i]);
+    if (old_file != old_metadata.files.end()) {
+      file = *old_file;
+    } else {
+      // Shards are written at the same time, so they are read as stripes.
+      file.stripe = get_shard(strip_trailing_separators(uri), file_paths[i]);
+    }
+    file.path = file_paths[i];
+    file.starting_time = summary.starting_time;
+    file.duration = summary.duration;
+    file.message_count = summary.message_count;
+    if (list_file_topics) {
+      file.topics.clear();
+      for (const auto & topic : summary.topics_with_message_count) {
+        file.topics.push_back(topic.topic_metadata.name);
+      }
+    }
+    metadata.relative_file_paths.push_back(file.path);
+    metadata.files.push_back(file);
+
+    merge_topics(
+      summary.topics_with_message_count, old_metadata.topics_with_message_count,
+      metadata.topics_with_message_count);
+    if (summary.message_count > 0u) {
+      if (metadata.message_count == 0u) {
+        metadata.starting_time = summary.starting_time;
+        metadata.duration = summary.duration;
+      } else {
+        const auto ending_time = std::max(
+          metadata.starting_time + metadata.duration, summary.starting_time + summary.duration);
+        metadata.starting_time = std::min(metadata.starting_time, summary.starting_time);
+        metadata.duration = ending_time - metadata.starting_time;
+      }
+      metadata.message_count += summary.message_count;
+    }
+    metadata.bag_size += summary.bag_size;
+  }
+
+  return metadata;
+}
+
+std::vector<std::string> Reindexer::find_bagfiles(const std::string & uri)
+{
+  std::vector<std::string> bagfiles;
+  find_bagfiles_in(strip_trailing_separators(uri), "", bagfiles);
+  return bagfiles;
+}
+
+}  // namespace rosbag2_cpp
@@ -22,15 +22,17 @@
 #include <string>
 #include <vector>
 
-#include "pluginlib/class_loader.hpp"
-
 #include "rosbag2_cpp/converter_interfaces/serialization_format_converter.hpp"
 #include "rosbag2_cpp/logging.hpp"
 #include "rosbag2_cpp/visibility_control.hpp"
 
+#include "rosbag2_storage/shared_class_loader.hpp"
+
 namespace rosbag2_cpp
 {
 
+using rosbag2_storage::SharedClassLoader;
+
 const char * converter_suffix = "_converter";
 
 class SerializationFormatConverterFactoryImpl
@@ -40,16 +42,13 @@ public:
   {
     try {
       converter_class_loader_ =
-        std::make_unique<pluginlib::ClassLoader<
-            converter_interfaces::SerializationFormatConverter>>(
+        &SharedClassLoader<converter_interfaces::SerializationFormatConverter>::get_instance(
         "rosbag2_cpp", "rosbag2_cpp::converter_interfaces::SerializationFormatConverter");
       serializer_class_loader_ =
-        std::make_shared<pluginlib::ClassLoader<
-            converter_interfaces::SerializationFormatSerializer>>(
+        &SharedClassLoader<converter_interfaces::SerializationFormatSerializer>::get_instance(
         "rosbag2_cpp", "rosbag2_cpp::converter_interfaces::SerializationFormatSerializer");
       deserializer_class_loader_ =
-        std::make_shared<pluginlib::ClassLoader<
-            converter_interfaces::SerializationFormatDeserializer>>(
+        &SharedClassLoader<converter_interfaces::SerializationFormatDeserializer>::get_instance(
         "rosbag2_cpp", "rosbag2_cpp::converter_interfaces::SerializationFormatDeserializer");
     } catch (const std::exception & e) {
       ROSBAG2_CPP_LOG_ERROR_STREAM("Unable to create class loader instance: " << e.what());
@@ -72,64 +71,46 @@ public:
   }
 
 private:
-  bool is_plugin_registered(
-    const std::string & converter_id,
-    const std::vector<std::string> & registered_converter_classes,
-    const std::vector<std::string> & registered_interface_classes)
-  {
-    auto class_exists_in_converters = std::find(
-      registered_converter_classes.begin(),
-      registered_converter_classes.end(), converter_id);
-    auto class_exists_in_deserializers = std::find(
-      registered_interface_classes.begin(),
-      registered_interface_classes.end(), converter_id);
-    return class_exists_in_converters == registered_converter_classes.end() &&
-           class_exists_in_deserializers == registered_interface_classes.end();
-  }
-
   template<typename SerializationFormatIface>
   std::unique_ptr<SerializationFormatIface>
   load_interface(
     const std::string & format,
-    std::shared_ptr<pluginlib::ClassLoader<SerializationFormatIface>> class_loader)
+    SharedClassLoader<SerializationFormatIface> * class_loader)
   {
     auto converter_id = format + converter_suffix;
 
-    if (is_plugin_registered(
-        converter_id,
-        converter_class_loader_->getDeclaredClasses(),
-        class_loader->getDeclaredClasses()))
+    if (!converter_class_loader_->is_declared(converter_id) &&
+      !class_loader->is_declared(converter_id))
     {
       ROSBAG2_CPP_LOG_ERROR_STREAM(
         "Requested converter for format '" << format << "' does not exist");
       return nullptr;
     }
 
-    try {
-      return std::unique_ptr<SerializationFormatIface>(
-        class_loader->createUnmanagedInstance(converter_id));
-    } catch (const std::runtime_error & ex) {
-      (void) ex;  // Ignore, try to load converter instead
+    if (class_loader->is_declared(converter_id)) {
+      try {
+        return std::unique_ptr<SerializationFormatIface>(
+          class_loader->create_unmanaged_instance(converter_id));
+      } catch (const std::runtime_error & ex) {
+        (void) ex;  // Ignore, try to load converter instead
+      }
     }
 
     try {
       return std::unique_ptr<converter_interfaces::SerializationFormatConverter>(
-        converter_class_loader_->createUnmanagedInstance(converter_id));
+        converter_class_loader_->create_unmanaged_instance(converter_id));
     } catch (const std::runtime_error & ex) {
       ROSBAG2_CPP_LOG_ERROR_STREAM("Unable to load instance of converter interface: " << ex.what());
       return nullptr;
     }
   }
 
-  std::unique_ptr<
-    pluginlib::ClassLoader<converter_interfaces::SerializationFormatConverter>>
-  converter_class_loader_;
-  std::shared_ptr<
-    pluginlib::ClassLoader<converter_interfaces::SerializationFormatSerializer>>
-  serializer_class_loader_;
-  std::shared_ptr<
-    pluginlib::ClassLoader<converter_interfaces::SerializationFormatDeserializer>>
-  deserializer_class_loader_;
+  SharedClassLoader<converter_interfaces::SerializationFormatConverter> *
+    converter_class_loader_;
+  SharedClassLoader<converter_interfaces::SerializationFormatSerializer> *
+    serializer_class_loader_;
+  SharedClassLoader<converter_interfaces::SerializationFormatDeserializer> *
+    deserializer_class_loader_;
 };
 
 }  // namespace rosbag2_cpp
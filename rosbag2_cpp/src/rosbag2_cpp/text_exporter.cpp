@@ -0,0 +1,352 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/text_exporter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+#include "rcpputils/shared_library.hpp"
+
+#include "rosbag2_cpp/cdr_message_formatter.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/serialized_bag_message_view.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+
+// Data read from a bagfile at once.
+constexpr size_t kBatchBytes = 4 * 1024 * 1024;
+// Text formatted for a topic before it is written to its part file.
+constexpr size_t kFlushBytes = 1024 * 1024;
+
+struct Topic
+{
+  std::string name;
+  std::string file_path;
+  std::unique_ptr<CdrMessageFormatter> formatter;
+};
+
+std::string resolve_path(const rcpputils::fs::path & base_path, const std::string & file_path)
+{
+  const auto path = rcpputils::fs::path(file_path);
+  return path.is_absolute() ? path.string() : (base_path / path).string();
+}
+
+// Messages of deduplicated or delta encoded topics are not stored as serialized.
+bool is_stored_as_is(const rosbag2_storage::TopicInformation & topic)
+{
+  return !topic.deduplicated && !topic.delta_encoded;
+}
+
+std::string get_file_name(const std::string & topic_name, TextFormat format)
+{
+  std::string file_name;
+  for (size_t i = topic_name.find_first_not_of('/'); i < topic_name.size(); ++i) {
+    if (topic_name[i] == '/') {
+      file_name += "__";
+    } else {
+      file_name.push_back(topic_name[i]);
+    }
+  }
+  return file_name + (format == TextFormat::CSV ? ".csv" : ".ndjson");
+}
+
+// Unlike std::to_string, appending the digits does not allocate a string of its own.
+void append_time_stamp(rcutils_time_point_value_t time_stamp, std::string & text)
+{
+  char buffer[24];
+  const auto length = std::snprintf(buffer, sizeof(buffer), "%" PRId64, time_stamp);
+  text.append(buffer, static_cast<size_t>(length));
+}
+
+std::string get_part_path(const std::string & file_path, size_t file_index)
+{
+  return file_path + "." + std::to_string(file_index) + ".part";
+}
+
+// Formats the messages of one bagfile into a part of the file of every topic.
+class BagFileExporter
+{
+public:
+  BagFileExporter(
+    const std::vector<Topic> & topics, TextFormat format, size_t file_index,
+    std::vector<uint64_t> & message_counts)
+  : topics_(topics), format_(format), file_index_(file_index),
+    message_counts_(message_counts), texts_(topics.size()), part_files_(topics.size())
+  {
+    for (size_t i = 0; i < topics_.size(); ++i) {
+      topic_indices_.emplace(topics_[i].name, i);
+    }
+  }
+
+  void export_messages(rosbag2_storage::storage_interfaces::ReadOnlyInterface & storage)
+  {
+    const auto export_batch =
+      [this](const std::vector<rosbag2_storage::SerializedBagMessageView> & messages) {
+        for (const auto & message : messages) {
+          const auto topic_index = topic_indices_.find(*message.topic_name);
+          if (topic_index != topic_indices_.end()) {
+            append_message(topic_index->second, message);
+          }
+        }
+      };
+    while (storage.visit_next_batch(export_batch, 0, kBatchBytes)) {}
+    for (size_t i = 0; i < topics_.size(); ++i) {
+      flush(i);
+    }
+  }
+
+private:
+  void append_message(size_t topic_index, const rosbag2_storage::SerializedBagMessageView & view)
+  {
+    // The formatter only reads the serialized data.
+    rcutils_uint8_array_t serialized_data{};
+    serialized_data.buffer = const_cast<uint8_t *>(view.serialized_data.data);
+    serialized_data.buffer_length = view.serialized_data.size;
+    serialized_data.buffer_capacity = view.serialized_data.size;
+
+    const auto & topic = topics_[topic_index];
+    auto & text = texts_[topic_index];
+    const auto line_begin = text.size();
+    try {
+      if (format_ == TextFormat::CSV) {
+        append_time_stamp(view.time_stamp, text);
+        text.push_back(',');
+        topic.formatter->append_csv_row(serialized_data, text);
+      } else {
+        text += "{\"time_stamp\":";
+        append_time_stamp(view.time_stamp, text);
+        text += ",\"message\":";
+        topic.formatter->append_json(serialized_data, text);
+        text.push_back('}');
+      }
+    } catch (const std::exception & e) {
+      text.resize(line_begin);
+      throw std::runtime_error(
+              "Message " + std::to_string(message_counts_[topic_index] + 1) + " of topic '" +
+              topic.name + "' cannot be formatted: " + e.what());
+    }
+    text.push_back('\n');
+    ++message_counts_[topic_index];
+    if (text.size() >= kFlushBytes) {
+      flush(topic_index);
+    }
+  }
+
+  // Writes the formatted text of the topic to its part file, which is created on first use.
+  void flush(size_t topic_index)
+  {
+    auto & text = texts_[topic_index];
+    if (text.empty()) {
+      return;
+    }
+    auto & part_file = part_files_[topic_index];
+    const auto part_path = get_part_path(topics_[topic_index].file_path, file_index_);
+    if (!part_file) {
+      part_file = std::make_unique<std::ofstream>(part_path, std::ios::binary);
+    }
+    part_file->write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!*part_file) {
+      throw std::runtime_error("Failed to write \"" + part_path + "\".");
+    }
+    // Clearing keeps the capacity, so formatting the next messages does not allocate.
+    text.clear();
+  }
+
+  const std::vector<Topic> & topics_;
+  TextFormat format_;
+  size_t file_index_;
+  std::vector<uint64_t> & message_counts_;
+  std::unordered_map<std::string, size_t> topic_indices_;
+  std::vector<std::string> texts_;
+  std::vector<std::unique_ptr<std::ofstream>> part_files_;
+};
+}  // namespace
+
+TextExporter::TextExporter(
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io)
+: storage_factory_(std::move(storage_factory)),
+  metadata_io_(std::move(metadata_io))
+{}
+
+std::vector<ExportedTopic> TextExporter::export_bag(
+  const std::string & uri, const std::string & directory, TextFormat format,
+  const std::vector<std::string> & topic_names, size_t max_threads)
+{
+  if (!metadata_io_->metadata_file_exists(uri)) {
+    throw std::runtime_error("The bag \"" + uri + "\" has no metadata file.");
+  }
+  const auto metadata = metadata_io_->read_metadata(uri);
+  if (!metadata.compression_format.empty()) {
+    throw std::runtime_error("Compressed bags cannot be exported.");
+  }
+
+  const auto & bag_topics = metadata.topics_with_message_count;
+  for (const auto & topic_name : topic_names) {
+    const auto bag_topic = std::find_if(
+      bag_topics.begin(), bag_topics.end(),
+      [&topic_name](const rosbag2_storage::TopicInformation & topic) {
+        return topic.topic_metadata.name == topic_name;
+      });
+    if (bag_topic == bag_topics.end()) {
+      throw std::runtime_error("Topic '" + topic_name + "' is not in the bag.");
+    }
+    if (bag_topic->topic_metadata.serialization_format != "cdr") {
+      throw std::runtime_error(
+              "Topic '" + topic_name + "' is serialized as '" +
+              bag_topic->topic_metadata.serialization_format + "' instead of CDR.");
+    }
+    if (!is_stored_as_is(*bag_topic)) {
+      throw std::runtime_error(
+              "Topic '" + topic_name + "' is stored deduplicated or delta encoded and cannot be "
+              "exported.");
+    }
+  }
+
+  const auto output_path = rcpputils::fs::path(directory);
+  if (!output_path.is_directory() && !rcpputils::fs::create_directories(output_path)) {
+    throw std::runtime_error("Failed to create folder \"" + directory + "\".");
+  }
+  // The formatters are destroyed before the libraries of their type supports.
+  std::vector<std::shared_ptr<rcpputils::SharedLibrary>> libraries;
+  std::vector<Topic> topics;
+  for (const auto & bag_topic : bag_topics) {
+    const auto & topic_metadata = bag_topic.topic_metadata;
+    const bool is_selected = topic_names.empty() ?
+      topic_metadata.serialization_format == "cdr" && is_stored_as_is(bag_topic) :
+      std::find(
+      topic_names.begin(), topic_names.end(), topic_metadata.name) != topic_names.end();
+    if (!is_selected) {
+      continue;
+    }
+    libraries.emplace_back();
+    const auto type_support = get_typesupport(
+      topic_metadata.type, "rosidl_typesupport_cpp", libraries.back());
+    topics.push_back(
+      {topic_metadata.name, (output_path / get_file_name(topic_metadata.name, format)).string(),
+        std::make_unique<CdrMessageFormatter>(type_support)});
+  }
+
+  // Files of older metadata versions are listed relative to the parent of the bag directory.
+  const auto base_path = metadata.version >= 4 ?
+    rcpputils::fs::path(uri) : rcpputils::fs::path(uri).parent_path();
+  rosbag2_storage::StorageFilter storage_filter;
+  for (const auto & topic : topics) {
+    storage_filter.topics.push_back(topic.name);
+  }
+  // Storage plugins are loaded one at a time, only the messages are read in parallel.
+  const auto file_count = metadata.relative_file_paths.size();
+  std::vector<std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>> storages(
+    file_count);
+  for (size_t i = 0; i < file_count; ++i) {
+    const auto path = resolve_path(base_path, metadata.relative_file_paths[i]);
+    storages[i] = storage_factory_->open_read_only(path, metadata.storage_identifier);
+    if (!storages[i]) {
+      throw std::runtime_error("The bagfile \"" + path + "\" could not be opened.");
+    }
+    storages[i]->set_filter(storage_filter);
+  }
+
+  std::vector<std::vector<uint64_t>> message_counts(
+    file_count, std::vector<uint64_t>(topics.size(), 0u));
+  std::vector<std::exception_ptr> errors(file_count);
+  std::atomic<size_t> next_file{0};
+  const auto export_files = [&]() {
+      for (size_t i = next_file++; i < file_count; i = next_file++) {
+        try {
+          BagFileExporter(topics, format, i, message_counts[i]).export_messages(*storages[i]);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+        storages[i].reset();
+      }
+    };
+  if (max_threads == 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(max_threads, file_count); ++i) {
+    threads.emplace_back(
+      [&export_files]() {
+        ThreadPool::configure_current_thread();
+        export_files();
+      });
+  }
+  export_files();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  const auto error = std::find_if(
+    errors.begin(), errors.end(), [](const std::exception_ptr & error) {return error;});
+  std::vector<ExportedTopic> exported_topics;
+  for (size_t topic_index = 0; topic_index < topics.size(); ++topic_index) {
+    const auto & topic = topics[topic_index];
+    ExportedTopic exported_topic{topic.name, topic.file_path, 0u};
+    std::ofstream file;
+    if (error == errors.end()) {
+      file.open(topic.file_path, std::ios::binary);
+      if (format == TextFormat::CSV) {
+        std::string header = "time_stamp,";
+        topic.formatter->append_csv_header(header);
+        file << header << '\n';
+      }
+    }
+    // The parts are joined in the order of the bagfiles, or removed if exporting failed.
+    for (size_t file_index = 0; file_index < file_count; ++file_index) {
+      const auto part_path = get_part_path(topic.file_path, file_index);
+      if (!rcpputils::fs::exists(part_path)) {
+        continue;
+      }
+      if (file.is_open()) {
+        std::ifstream part_file(part_path, std::ios::binary);
+        file << part_file.rdbuf();
+        exported_topic.message_count += message_counts[file_index][topic_index];
+      }
+      rcpputils::fs::remove(part_path);
+    }
+    if (file.is_open() && !file) {
+      throw std::runtime_error("Failed to write \"" + topic.file_path + "\".");
+    }
+    exported_topics.push_back(std::move(exported_topic));
+  }
+  if (error != errors.end()) {
+    std::rethrow_exception(*error);
+  }
+  return exported_topics;
+}
+
+}  // namespace rosbag2_cpp
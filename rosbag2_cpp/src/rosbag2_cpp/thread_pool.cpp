@@ -0,0 +1,226 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+# include <sys/resource.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "rosbag2_cpp/logging.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+struct SharedThreadPool
+{
+  std::mutex mutex;
+  ThreadPoolOptions options;
+  std::map<ThreadRole, ThreadScheduling> roles;
+  std::unique_ptr<ThreadPool> pool;
+};
+
+SharedThreadPool & get_shared_thread_pool()
+{
+  // Destroyed before the statics it uses, joining the threads of the pool.
+  static SharedThreadPool shared_thread_pool;
+  return shared_thread_pool;
+}
+
+void check_nice(int nice)
+{
+  if (nice < -20 || nice > 19) {
+    throw std::invalid_argument("The nice value of threads is between -20 and 19.");
+  }
+}
+
+// Every thread would log the same warning otherwise.
+std::atomic_bool is_configuration_warning_logged {false};
+
+void warn_once(const std::string & warning)
+{
+  if (!is_configuration_warning_logged.exchange(true)) {
+    ROSBAG2_CPP_LOG_WARN_STREAM(warning);
+  }
+}
+}  // namespace
+
+ThreadPool::ThreadPool(const ThreadPoolOptions & options)
+{
+  const auto size = options.size > 0 ?
+    options.size : std::max<size_t>(1u, std::thread::hardware_concurrency());
+  threads_.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    threads_.emplace_back(&ThreadPool::run, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  task_available_.notify_all();
+  for (auto & thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t ThreadPool::get_size() const
+{
+  return threads_.size();
+}
+
+void ThreadPool::push(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  task_available_.notify_one();
+}
+
+void ThreadPool::run()
+{
+  configure_current_thread();
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_available_.wait(lock, [this]() {return is_stopping_ || !tasks_.empty();});
+      // The tasks submitted are run before stopping.
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    // Exceptions are stored in the future of the task.
+    task();
+  }
+}
+
+ThreadPool & ThreadPool::get_shared()
+{
+  auto & shared = get_shared_thread_pool();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  if (!shared.pool) {
+    // Its threads configure themselves once the lock is released.
+    shared.pool = std::make_unique<ThreadPool>(shared.options);
+  }
+  return *shared.pool;
+}
+
+void ThreadPool::configure_shared(const ThreadPoolOptions & options)
+{
+  check_nice(options.nice);
+  auto & shared = get_shared_thread_pool();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  if (shared.pool && !(shared.options == options)) {
+    throw std::logic_error("The shared thread pool was started already with other options.");
+  }
+  shared.options = options;
+}
+
+void ThreadPool::configure_role(ThreadRole role, const ThreadScheduling & scheduling)
+{
+  if (role == ThreadRole::BACKGROUND) {
+    throw std::invalid_argument("Background threads are configured by configure_shared().");
+  }
+  check_nice(scheduling.nice);
+  if (scheduling.realtime_priority < 0 || scheduling.realtime_priority > 99) {
+    throw std::invalid_argument("The real-time priority of threads is between 0 and 99.");
+  }
+  auto & shared = get_shared_thread_pool();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  shared.roles[role] = scheduling;
+}
+
+void ThreadPool::configure_current_thread(ThreadRole role)
+{
+  ThreadScheduling options;
+  {
+    auto & shared = get_shared_thread_pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    const auto role_it = shared.roles.find(role);
+    if (role_it != shared.roles.end()) {
+      options = role_it->second;
+    } else {
+      options.cpu_affinity = shared.options.cpu_affinity;
+      options.nice = shared.options.nice;
+    }
+  }
+#ifdef __linux__
+  if (!options.cpu_affinity.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (const auto cpu : options.cpu_affinity) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+    const auto result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (result != 0) {
+      warn_once(
+        std::string("Failed to pin the threads of rosbag2 to their CPUs: ") +
+        std::strerror(result));
+    }
+  }
+  // The nice value of a thread is set through its thread id.
+  if (options.nice != 0 &&
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.nice) != 0)
+  {
+    warn_once(
+      std::string("Failed to set the nice value of the threads of rosbag2: ") +
+      std::strerror(errno));
+  }
+  if (options.realtime_priority > 0) {
+    sched_param param{};
+    param.sched_priority = options.realtime_priority;
+    const auto result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+      warn_once(
+        std::string("Failed to set the real-time priority of the threads of rosbag2: ") +
+        std::strerror(result));
+    }
+  }
+#else
+  if (!options.cpu_affinity.empty() || options.nice != 0 || options.realtime_priority > 0) {
+    warn_once(
+      "Pinning threads and setting their nice value or real-time priority is only supported on "
+      "Linux.");
+  }
+#endif
+}
+
+}  // namespace rosbag2_cpp
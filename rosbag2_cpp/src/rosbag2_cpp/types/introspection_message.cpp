@@ -14,6 +14,7 @@
 
 #include "rosbag2_cpp/types/introspection_message.hpp"
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -53,6 +54,10 @@ allocate_introspection_message(
 void introspection_message_set_topic_name(
   rosbag2_introspection_message_t * msg, const char * topic_name)
 {
+  // Messages which are reused for a topic keep their copy of its name.
+  if (msg->topic_name && std::strcmp(msg->topic_name, topic_name) == 0) {
+    return;
+  }
   if (msg->topic_name) {
     msg->allocator.deallocate(msg->topic_name, msg->allocator.state);
     msg->topic_name = nullptr;
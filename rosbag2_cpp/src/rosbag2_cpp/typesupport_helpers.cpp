@@ -14,7 +14,9 @@
 
 #include "rosbag2_cpp/typesupport_helpers.hpp"
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -28,6 +30,35 @@
 
 #include "rosidl_runtime_cpp/message_type_support_decl.hpp"
 
+namespace
+{
+
+// Process-wide cache of the loaded typesupport libraries and handles, so every library and
+// symbol is only resolved once no matter how many topics share them.
+struct TypesupportRegistry
+{
+  struct Entry
+  {
+    std::shared_ptr<rcpputils::SharedLibrary> library;
+    const rosidl_message_type_support_t * type_support;
+  };
+
+  std::mutex mutex;
+  // Keyed by library path.
+  std::map<std::string, std::shared_ptr<rcpputils::SharedLibrary>> libraries;
+  // Keyed by type and typesupport identifier.
+  std::map<std::pair<std::string, std::string>, Entry> type_supports;
+};
+
+TypesupportRegistry & get_typesupport_registry()
+{
+  // Never destroyed, so libraries stay loaded for handles used during static destruction.
+  static auto registry = new TypesupportRegistry;
+  return *registry;
+}
+
+}  // namespace
+
 namespace rosbag2_cpp
 {
 
@@ -103,6 +134,17 @@ get_typesupport(
   const std::string & type, const std::string & typesupport_identifier,
   std::shared_ptr<rcpputils::SharedLibrary> & library)
 {
+  auto & registry = get_typesupport_registry();
+  const auto key = std::make_pair(type, typesupport_identifier);
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const auto cached_type_support = registry.type_supports.find(key);
+    if (cached_type_support != registry.type_supports.end()) {
+      library = cached_type_support->second.library;
+      return cached_type_support->second.type_support;
+    }
+  }
+
   std::string package_name;
   std::string middle_module;
   std::string type_name;
@@ -113,10 +155,18 @@ get_typesupport(
     "Something went wrong loading the typesupport library for message type " << package_name <<
     "/" << type_name << ".";
 
+  // The package is looked up in the ament index, which reads the file system, without holding
+  // the lock, so threads resolving types look them up in parallel. The dynamic loader serializes
+  // loading the libraries anyway.
   auto library_path = get_typesupport_library_path(package_name, typesupport_identifier);
 
+  std::lock_guard<std::mutex> lock(registry.mutex);
   try {
-    library = std::make_shared<rcpputils::SharedLibrary>(library_path);
+    auto & cached_library = registry.libraries[library_path];
+    if (!cached_library) {
+      cached_library = std::make_shared<rcpputils::SharedLibrary>(library_path);
+    }
+    library = cached_library;
 
     auto symbol_name = typesupport_identifier + "__get_message_type_support_handle__" +
       package_name + "__" + (middle_module.empty() ? "msg" : middle_module) + "__" + type_name;
@@ -136,6 +186,7 @@ get_typesupport(
               std::string(" Symbol of wrong type.")};
     }
     auto type_support = get_ts();
+    registry.type_supports[key] = {library, type_support};
     return type_support;
   } catch (std::runtime_error &) {
     throw std::runtime_error(rcutils_dynamic_loading_error.str() + " Library could not be found.");
@@ -0,0 +1,168 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/verifier.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+namespace rosbag2_cpp
+{
+
+namespace
+{
+struct BagFile
+{
+  std::string path;
+  std::string resolved_path;
+  // Zero if the metadata does not list the message count of the file.
+  uint64_t expected_message_count;
+};
+
+std::string resolve_path(const rcpputils::fs::path & base_path, const std::string & file_path)
+{
+  const auto path = rcpputils::fs::path(file_path);
+  return path.is_absolute() ? path.string() : (base_path / path).string();
+}
+
+void read_all_messages(
+  rosbag2_storage::storage_interfaces::ReadOnlyInterface & storage,
+  uint64_t expected_message_count, FileVerification & verification)
+{
+  try {
+    while (storage.has_next()) {
+      storage.read_next();
+      ++verification.message_count;
+    }
+  } catch (const std::exception & e) {
+    verification.error = "Reading message " + std::to_string(verification.message_count + 1) +
+      " failed: " + e.what();
+    return;
+  }
+  if (expected_message_count != 0 && verification.message_count != expected_message_count) {
+    verification.error = "The metadata lists " + std::to_string(expected_message_count) +
+      " messages, but the file has " + std::to_string(verification.message_count) + ".";
+  }
+}
+}  // namespace
+
+Verifier::Verifier(
+  std::unique_ptr<rosbag2_storage::StorageFactoryInterface> storage_factory,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io)
+: storage_factory_(std::move(storage_factory)),
+  metadata_io_(std::move(metadata_io))
+{}
+
+std::vector<FileVerification> Verifier::verify(
+  const std::string & uri, const std::string & storage_id,
+  const std::vector<std::string> & relative_file_paths, size_t max_threads)
+{
+  rosbag2_storage::BagMetadata metadata{};
+  const bool has_metadata = metadata_io_->metadata_file_exists(uri);
+  if (has_metadata) {
+    metadata = metadata_io_->read_metadata(uri);
+  }
+  if (metadata.compression_mode == "FILE") {
+    throw std::runtime_error("Bags compressed per file cannot be verified.");
+  }
+  const auto storage_identifier = storage_id.empty() ? metadata.storage_identifier : storage_id;
+  if (storage_identifier.empty()) {
+    throw std::invalid_argument(
+            "The bag has no metadata file. Please specify the storage id of its bagfiles.");
+  }
+
+  // Files of older metadata versions are listed relative to the parent of the bag directory.
+  // Chunks are stored as single messages, so their count differs from the listed one.
+  const auto base_path = rcpputils::fs::path(uri);
+  const bool compare_message_counts = metadata.compression_mode != "CHUNK";
+  std::vector<BagFile> files;
+  for (const auto & path : metadata.relative_file_paths) {
+    const auto file = std::find_if(
+      metadata.files.begin(), metadata.files.end(),
+      [&path](const rosbag2_storage::FileInformation & file) {return file.path == path;});
+    files.push_back(
+      {path, resolve_path(metadata.version >= 4 ? base_path : base_path.parent_path(), path),
+        file != metadata.files.end() && compare_message_counts ? file->message_count : 0u});
+  }
+  for (const auto & path : relative_file_paths) {
+    const auto resolved_path = resolve_path(base_path, path);
+    if (std::none_of(
+        files.begin(), files.end(),
+        [&resolved_path](const BagFile & file) {return file.resolved_path == resolved_path;}))
+    {
+      files.push_back({path, resolved_path, 0u});
+    }
+  }
+  if (files.empty()) {
+    throw std::runtime_error("No bagfiles of the bag \"" + uri + "\" were found.");
+  }
+
+  // Storage plugins are loaded one at a time, only the messages are read in parallel.
+  std::vector<FileVerification> verifications(files.size());
+  std::vector<std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>> storages(
+    files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    verifications[i].path = files[i].path;
+    if (!rcpputils::fs::path(files[i].resolved_path).exists()) {
+      verifications[i].error = "The file does not exist.";
+      continue;
+    }
+    storages[i] = storage_factory_->open_read_only(files[i].resolved_path, storage_identifier);
+    if (!storages[i]) {
+      verifications[i].error = "The file could not be opened.";
+    }
+  }
+
+  std::atomic<size_t> next_file{0};
+  const auto verify_files = [&]() {
+      for (size_t i = next_file++; i < storages.size(); i = next_file++) {
+        if (storages[i]) {
+          read_all_messages(*storages[i], files[i].expected_message_count, verifications[i]);
+          storages[i].reset();
+        }
+      }
+    };
+  if (max_threads == 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(max_threads, storages.size()); ++i) {
+    threads.emplace_back(
+      [&verify_files]() {
+        ThreadPool::configure_current_thread();
+        verify_files();
+      });
+  }
+  verify_files();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  return verifications;
+}
+
+}  // namespace rosbag2_cpp
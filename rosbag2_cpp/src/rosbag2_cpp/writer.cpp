@@ -20,6 +20,7 @@
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "rosbag2_cpp/info.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
@@ -51,14 +52,35 @@ void Writer::create_topic(const rosbag2_storage::TopicMetadata & topic_with_type
   writer_impl_->create_topic(topic_with_type);
 }
 
+void Writer::create_topics(
+  const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type)
+{
+  writer_impl_->create_topics(topics_with_type);
+}
+
 void Writer::remove_topic(const rosbag2_storage::TopicMetadata & topic_with_type)
 {
   writer_impl_->remove_topic(topic_with_type);
 }
 
+rosbag2_storage::TopicHandle Writer::get_topic_handle(const std::string & topic_name) const
+{
+  return writer_impl_->get_topic_handle(topic_name);
+}
+
+bool Writer::take_snapshot()
+{
+  return writer_impl_->take_snapshot();
+}
+
 void Writer::write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
 {
   writer_impl_->write(message);
 }
 
+void Writer::add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks)
+{
+  writer_impl_->add_event_callbacks(callbacks);
+}
+
 }  // namespace rosbag2_cpp
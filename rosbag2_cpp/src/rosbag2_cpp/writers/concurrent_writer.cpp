@@ -0,0 +1,271 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/writers/concurrent_writer.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/logging.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+namespace
+{
+std::atomic<uint64_t> next_writer_id {1};
+}  // namespace
+
+ConcurrentWriter::ConcurrentWriter(
+  std::unique_ptr<writer_interfaces::BaseWriterInterface> writer,
+  size_t max_staged_messages,
+  std::chrono::milliseconds flush_interval)
+: writer_(std::move(writer)),
+  max_staged_messages_(max_staged_messages),
+  flush_interval_(flush_interval),
+  id_(next_writer_id++)
+{
+  if (max_staged_messages_ == 0u) {
+    throw std::invalid_argument("ConcurrentWriter needs to stage at least one message.");
+  }
+}
+
+ConcurrentWriter::~ConcurrentWriter()
+{
+  try {
+    reset();
+  } catch (const std::exception & e) {
+    ROSBAG2_CPP_LOG_ERROR_STREAM("Failed to write the staged messages: " << e.what());
+  }
+}
+
+void ConcurrentWriter::open(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  is_open_ = false;
+  stop_storage_thread();
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    writer_->open(storage_options, converter_options);
+  }
+  is_open_ = true;
+  start_storage_thread();
+}
+
+void ConcurrentWriter::reset()
+{
+  // Threads staging a message check this with the lock of their buffer held, so every message
+  // staged before is taken by the storage thread before it stops.
+  is_open_ = false;
+  stop_storage_thread();
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    writer_->reset();
+  }
+  rethrow_write_error();
+}
+
+void ConcurrentWriter::create_topic(const rosbag2_storage::TopicMetadata & topic_with_type)
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  writer_->create_topic(topic_with_type);
+}
+
+void ConcurrentWriter::create_topics(
+  const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type)
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  writer_->create_topics(topics_with_type);
+}
+
+void ConcurrentWriter::remove_topic(const rosbag2_storage::TopicMetadata & topic_with_type)
+{
+  flush();
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  writer_->remove_topic(topic_with_type);
+}
+
+void ConcurrentWriter::write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  if (has_write_error_) {
+    rethrow_write_error();
+  }
+
+  auto & buffer = get_staging_buffer();
+  bool is_half_full = false;
+  {
+    std::unique_lock<std::mutex> lock(buffer.mutex);
+    buffer.not_full.wait(
+      lock, [this, &buffer] {
+        return !is_open_ || buffer.messages.size() < max_staged_messages_;
+      });
+    if (!is_open_) {
+      throw std::runtime_error("Bag is not open. Call open() before writing.");
+    }
+    buffer.messages.push_back(std::move(message));
+    is_half_full = buffer.messages.size() * 2 >= max_staged_messages_;
+  }
+  if (is_half_full && !is_write_requested_.exchange(true)) {
+    write_requested_.notify_one();
+  }
+}
+
+rosbag2_storage::TopicHandle ConcurrentWriter::get_topic_handle(
+  const std::string & topic_name) const
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  return writer_->get_topic_handle(topic_name);
+}
+
+void ConcurrentWriter::add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks)
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  writer_->add_event_callbacks(callbacks);
+}
+
+bool ConcurrentWriter::take_snapshot()
+{
+  flush();
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  return writer_->take_snapshot();
+}
+
+void ConcurrentWriter::flush()
+{
+  if (has_write_error_) {
+    rethrow_write_error();
+  }
+  write_staged_messages();
+}
+
+ConcurrentWriter::StagingBuffer & ConcurrentWriter::get_staging_buffer()
+{
+  // Threads mostly write to one writer, whose buffer is then found without any lock.
+  thread_local std::pair<uint64_t, StagingBuffer *> cached_buffer {0u, nullptr};
+  if (cached_buffer.first == id_) {
+    return *cached_buffer.second;
+  }
+
+  std::lock_guard<std::mutex> lock(staging_buffers_mutex_);
+  auto & buffer = staging_buffers_[std::this_thread::get_id()];
+  if (!buffer) {
+    buffer = std::make_unique<StagingBuffer>();
+  }
+  cached_buffer = {id_, buffer.get()};
+  return *buffer;
+}
+
+void ConcurrentWriter::write_staged_messages()
+{
+  // Held while taking the messages, so messages taken later are never written before them.
+  std::lock_guard<std::mutex> writer_lock(writer_mutex_);
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  {
+    std::lock_guard<std::mutex> lock(staging_buffers_mutex_);
+    for (auto & thread_and_buffer : staging_buffers_) {
+      auto & buffer = *thread_and_buffer.second;
+      {
+        std::lock_guard<std::mutex> buffer_lock(buffer.mutex);
+        // Moving the messages keeps the capacity of the buffer for the thread staging them.
+        std::move(
+          buffer.messages.begin(), buffer.messages.end(), std::back_inserter(messages));
+        buffer.messages.clear();
+      }
+      buffer.not_full.notify_all();
+    }
+  }
+
+  std::stable_sort(
+    messages.begin(), messages.end(),
+    [](const auto & lhs, const auto & rhs) {return lhs->time_stamp < rhs->time_stamp;});
+  for (auto & message : messages) {
+    writer_->write(std::move(message));
+  }
+}
+
+void ConcurrentWriter::start_storage_thread()
+{
+  storage_thread_ = std::thread(&ConcurrentWriter::storage_thread_main, this);
+}
+
+void ConcurrentWriter::stop_storage_thread()
+{
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    stop_requested_ = true;
+  }
+  write_requested_.notify_all();
+  if (storage_thread_.joinable()) {
+    storage_thread_.join();
+  }
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    stop_requested_ = false;
+  }
+
+  // Threads waiting for room in their buffer give up once the writer is closed.
+  std::lock_guard<std::mutex> lock(staging_buffers_mutex_);
+  for (auto & thread_and_buffer : staging_buffers_) {
+    auto & buffer = *thread_and_buffer.second;
+    {
+      std::lock_guard<std::mutex> buffer_lock(buffer.mutex);
+    }
+    buffer.not_full.notify_all();
+  }
+}
+
+void ConcurrentWriter::storage_thread_main()
+{
+  ThreadPool::configure_current_thread(ThreadRole::WRITER);
+  bool stop = false;
+  while (!stop) {
+    {
+      std::unique_lock<std::mutex> lock(state_mutex_);
+      write_requested_.wait_for(
+        lock, flush_interval_, [this] {return stop_requested_ || is_write_requested_;});
+      stop = stop_requested_;
+    }
+    is_write_requested_ = false;
+
+    // The messages staged until the writer was closed are written before stopping.
+    try {
+      write_staged_messages();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(state_mutex_);
+      if (!write_error_) {
+        write_error_ = std::current_exception();
+      }
+      has_write_error_ = true;
+    }
+  }
+}
+
+void ConcurrentWriter::rethrow_write_error()
+{
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  has_write_error_ = false;
+  if (write_error_) {
+    std::rethrow_exception(std::exchange(write_error_, nullptr));
+  }
+}
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
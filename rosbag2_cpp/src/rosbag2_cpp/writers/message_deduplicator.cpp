@@ -0,0 +1,120 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/writers/message_deduplicator.hpp"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+namespace
+{
+constexpr uint64_t kHashMultiplier = 0x9E3779B97F4A7C15ull;
+
+uint64_t mix(uint64_t value)
+{
+  value ^= value >> 32;
+  value *= kHashMultiplier;
+  return value ^ (value >> 29);
+}
+
+// Hashes eight bytes at a time, which keeps up with the disk on large messages.
+uint64_t hash_data(const uint8_t * data, size_t size)
+{
+  uint64_t hash = size * kHashMultiplier;
+  for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    hash = mix(hash ^ word);
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, data, size);
+  return mix(hash ^ tail);
+}
+
+bool equal_data(const rcutils_uint8_array_t & a, const rcutils_uint8_array_t & b)
+{
+  return a.buffer_length == b.buffer_length &&
+         (a.buffer_length == 0 || std::memcmp(a.buffer, b.buffer, a.buffer_length) == 0);
+}
+}  // namespace
+
+MessageDeduplicator::MessageDeduplicator(const std::vector<std::string> & topics)
+: empty_data_(rosbag2_storage::make_empty_serialized_message(1))
+{
+  empty_data_->buffer_length = 0;
+  for (const auto & topic : topics) {
+    stored_data_.emplace(topic, StoredData{0, nullptr});
+  }
+}
+
+bool MessageDeduplicator::is_deduplicated(const std::string & topic_name) const
+{
+  return stored_data_.find(topic_name) != stored_data_.end();
+}
+
+std::shared_ptr<const rosbag2_storage::SerializedBagMessage> MessageDeduplicator::deduplicate(
+  std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
+{
+  const auto stored = stored_data_.find(message->topic_name);
+  const auto & data = message->serialized_data;
+  if (stored == stored_data_.end() || !data || data->buffer_length == 0) {
+    return message;
+  }
+
+  const auto hash = hash_data(data->buffer, data->buffer_length);
+  if (stored->second.data && stored->second.hash == hash &&
+    equal_data(*stored->second.data, *data))
+  {
+    auto reference = std::make_shared<rosbag2_storage::SerializedBagMessage>(*message);
+    reference->serialized_data = empty_data_;
+    ++deduplicated_message_count_;
+    return reference;
+  }
+  stored->second = StoredData{hash, data};
+  return message;
+}
+
+MessageDeduplicator::Messages MessageDeduplicator::deduplicate(const Messages & messages)
+{
+  Messages deduplicated_messages;
+  deduplicated_messages.reserve(messages.size());
+  for (const auto & message : messages) {
+    deduplicated_messages.push_back(deduplicate(message));
+  }
+  return deduplicated_messages;
+}
+
+void MessageDeduplicator::reset()
+{
+  for (auto & stored : stored_data_) {
+    stored.second = StoredData{0, nullptr};
+  }
+}
+
+uint64_t MessageDeduplicator::get_deduplicated_message_count() const
+{
+  return deduplicated_message_count_;
+}
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
@@ -0,0 +1,184 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+namespace
+{
+// Unchanged bytes between two changed ones which end a run, as shorter gaps cost more to store
+// as a run of their own than as changed bytes.
+constexpr size_t kMinUnchangedBytes = 8;
+
+void put_byte(std::vector<uint8_t> & out, uint8_t value)
+{
+  out.push_back(value);
+}
+
+void put_varint(std::vector<uint8_t> & out, uint64_t value)
+{
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// End of the bytes equal in both buffers from the given offset, comparing eight bytes at a time.
+size_t skip_unchanged(const uint8_t * previous, const uint8_t * current, size_t begin, size_t size)
+{
+  while (begin + sizeof(uint64_t) <= size &&
+    std::memcmp(previous + begin, current + begin, sizeof(uint64_t)) == 0)
+  {
+    begin += sizeof(uint64_t);
+  }
+  while (begin < size && previous[begin] == current[begin]) {
+    ++begin;
+  }
+  return begin;
+}
+
+// Encodes the changes from the previous data to the current data of the same size into the
+// delta, which is left larger than max_size if it does not pay off.
+void encode_delta(
+  const rcutils_uint8_array_t & previous, const rcutils_uint8_array_t & current,
+  rcutils_time_point_value_t previous_time_stamp, size_t max_size, std::vector<uint8_t> & delta)
+{
+  put_byte(delta, static_cast<uint8_t>(DeltaFrameType::DELTA));
+  for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+    put_byte(delta, static_cast<uint8_t>(static_cast<uint64_t>(previous_time_stamp) >> (8 * i)));
+  }
+  put_varint(delta, current.buffer_length);
+
+  const auto size = current.buffer_length;
+  size_t run_end = 0;
+  size_t position = skip_unchanged(previous.buffer, current.buffer, 0, size);
+  while (position < size && delta.size() <= max_size) {
+    const auto changed_begin = position;
+    auto changed_end = position + 1;
+    size_t unchanged = 0;
+    for (++position; position < size && unchanged < kMinUnchangedBytes; ++position) {
+      if (previous.buffer[position] == current.buffer[position]) {
+        ++unchanged;
+      } else {
+        unchanged = 0;
+        changed_end = position + 1;
+      }
+    }
+    put_varint(delta, changed_begin - run_end);
+    put_varint(delta, changed_end - changed_begin);
+    delta.insert(delta.end(), current.buffer + changed_begin, current.buffer + changed_end);
+    run_end = changed_end;
+    position = skip_unchanged(previous.buffer, current.buffer, changed_end, size);
+  }
+}
+
+std::shared_ptr<rcutils_uint8_array_t> make_keyframe(const rcutils_uint8_array_t & data)
+{
+  auto keyframe = rosbag2_storage::make_empty_serialized_message(data.buffer_length + 1);
+  keyframe->buffer[0] = static_cast<uint8_t>(DeltaFrameType::KEYFRAME);
+  std::memcpy(keyframe->buffer + 1, data.buffer, data.buffer_length);
+  keyframe->buffer_length = data.buffer_length + 1;
+  return keyframe;
+}
+}  // namespace
+
+MessageDeltaEncoder::MessageDeltaEncoder(
+  const std::vector<std::string> & topics, uint64_t keyframe_interval)
+: keyframe_interval_(keyframe_interval)
+{
+  for (const auto & topic : topics) {
+    previous_messages_.emplace(topic, PreviousMessage{nullptr, 0, 0});
+  }
+}
+
+bool MessageDeltaEncoder::is_delta_encoded(const std::string & topic_name) const
+{
+  return previous_messages_.find(topic_name) != previous_messages_.end();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> MessageDeltaEncoder::encode(
+  const rosbag2_storage::SerializedBagMessage & message)
+{
+  auto encoded_message = std::make_shared<rosbag2_storage::SerializedBagMessage>(message);
+  const auto previous = previous_messages_.find(message.topic_name);
+  const auto & data = message.serialized_data;
+  if (previous == previous_messages_.end() || !data || data->buffer_length == 0) {
+    return encoded_message;
+  }
+
+  auto & previous_message = previous->second;
+  const bool may_be_delta = previous_message.data &&
+    previous_message.data->buffer_length == data->buffer_length &&
+    previous_message.time_stamp < message.time_stamp &&
+    (keyframe_interval_ == 0 || previous_message.deltas_since_keyframe + 1 < keyframe_interval_);
+  if (may_be_delta) {
+    std::vector<uint8_t> delta;
+    // A keyframe is stored unless the delta is at most half its size.
+    const auto max_size = data->buffer_length / 2;
+    encode_delta(
+      *previous_message.data, *data, previous_message.time_stamp, max_size, delta);
+    if (delta.size() <= max_size) {
+      encoded_message->serialized_data =
+        rosbag2_storage::make_serialized_message(delta.data(), delta.size());
+      previous_message = PreviousMessage{
+        data, message.time_stamp, previous_message.deltas_since_keyframe + 1};
+      ++delta_count_;
+      return encoded_message;
+    }
+  }
+  encoded_message->serialized_data = make_keyframe(*data);
+  previous_message = PreviousMessage{data, message.time_stamp, 0};
+  return encoded_message;
+}
+
+MessageDeltaEncoder::Messages MessageDeltaEncoder::encode(const Messages & messages)
+{
+  Messages encoded_messages;
+  encoded_messages.reserve(messages.size());
+  for (const auto & message : messages) {
+    if (is_delta_encoded(message->topic_name)) {
+      encoded_messages.push_back(encode(*message));
+    } else {
+      encoded_messages.push_back(message);
+    }
+  }
+  return encoded_messages;
+}
+
+void MessageDeltaEncoder::reset()
+{
+  for (auto & previous_message : previous_messages_) {
+    previous_message.second = PreviousMessage{nullptr, 0, 0};
+  }
+}
+
+uint64_t MessageDeltaEncoder::get_delta_count() const
+{
+  return delta_count_;
+}
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
@@ -0,0 +1,76 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/writers/message_reorder_buffer.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+MessageReorderBuffer::MessageReorderBuffer(std::chrono::nanoseconds window)
+: window_(window)
+{}
+
+void MessageReorderBuffer::add(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message, Messages & released)
+{
+  const auto time_stamp = message->time_stamp;
+  if (has_released_ && time_stamp < released_time_stamp_) {
+    ++late_message_count_;
+    released.push_back(std::move(message));
+    return;
+  }
+  held_messages_.push({time_stamp, next_sequence_number_++, std::move(message)});
+  latest_time_stamp_ = std::max(latest_time_stamp_, time_stamp);
+  while (!held_messages_.empty() &&
+    latest_time_stamp_ - held_messages_.top().time_stamp >= window_.count())
+  {
+    release_oldest(released);
+  }
+}
+
+void MessageReorderBuffer::flush(Messages & released)
+{
+  while (!held_messages_.empty()) {
+    release_oldest(released);
+  }
+}
+
+bool MessageReorderBuffer::empty() const
+{
+  return held_messages_.empty();
+}
+
+uint64_t MessageReorderBuffer::get_late_message_count() const
+{
+  return late_message_count_;
+}
+
+void MessageReorderBuffer::release_oldest(Messages & released)
+{
+  // The top is only read, so moving its message out does not break the order of the heap.
+  auto & oldest = const_cast<HeldMessage &>(held_messages_.top());
+  released_time_stamp_ = oldest.time_stamp;
+  has_released_ = true;
+  released.push_back(std::move(oldest.message));
+  held_messages_.pop();
+}
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
@@ -16,15 +16,31 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <limits>
 #include <memory>
+#include <regex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
 #include "rosbag2_cpp/info.hpp"
+#include "rosbag2_cpp/logging.hpp"
+#include "rosbag2_cpp/memory_budget.hpp"
 #include "rosbag2_cpp/storage_options.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+
+#include "rosbag2_storage/memory_arena.hpp"
+#include "rosbag2_storage/message_histogram.hpp"
+// Defines the tracepoints of rosbag2_cpp.
+#define ROSBAG2_TRACEPOINT_DEFINE
+#include "rosbag2_storage/tracing.hpp"
 
 namespace rosbag2_cpp
 {
@@ -33,13 +49,16 @@ namespace writers
 
 namespace
 {
-std::string format_storage_uri(const std::string & base_folder, uint64_t storage_count)
+std::string format_storage_uri(
+  const std::string & base_folder, const std::string & shard_name, uint64_t storage_count)
 {
   // Right now `base_folder_` is always just the folder name for where to install the bagfile.
   // The name of the folder needs to be queried in case
   // SequentialWriter is opened with a relative path.
+  const auto name =
+    shard_name.empty() ? rcpputils::fs::path(base_folder).filename().string() : shard_name;
   std::stringstream storage_file_name;
-  storage_file_name << rcpputils::fs::path(base_folder).filename().string() << "_" << storage_count;
+  storage_file_name << name << "_" << storage_count;
 
   return (rcpputils::fs::path(base_folder) / storage_file_name.str()).string();
 }
@@ -49,6 +68,142 @@ std::string strip_parent_path(const std::string & relative_path)
   return rcpputils::fs::path(relative_path).filename().string();
 }
 
+uint64_t get_serialized_size(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return message.serialized_data ? message.serialized_data->buffer_length : 0u;
+}
+
+// Copies the message, sharing its data, with its time stamps moved by the clock offset.
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> shift_time_stamps(
+  const rosbag2_storage::SerializedBagMessage & message, std::chrono::nanoseconds clock_offset)
+{
+  auto shifted_message = std::make_shared<rosbag2_storage::SerializedBagMessage>(message);
+  shifted_message->time_stamp += clock_offset.count();
+  if (shifted_message->publish_time_stamp != 0) {
+    shifted_message->publish_time_stamp += clock_offset.count();
+  }
+  return shifted_message;
+}
+
+// Size of a closed bagfile, 0 if there is no such file, e.g. for storages not writing to disk.
+uint64_t get_file_size(const std::string & path)
+{
+  const rcpputils::fs::path file_path(path);
+  return file_path.exists() ? file_path.file_size() : 0u;
+}
+
+// Moves a file, copying it at most max_bytes_per_second fast, 0 for no limit, if it is on another
+// file system. The file only appears under its new name once it is complete.
+bool move_file(
+  const std::string & source, const std::string & destination, uint64_t max_bytes_per_second)
+{
+  if (std::rename(source.c_str(), destination.c_str()) == 0) {
+    return true;
+  }
+
+  constexpr size_t kCopyChunkSize = 1024 * 1024;
+  const auto partial_destination = destination + ".part";
+  std::ifstream input(source, std::ios::binary);
+  std::ofstream output(partial_destination, std::ios::binary | std::ios::trunc);
+  if (!input || !output) {
+    return false;
+  }
+  std::vector<char> buffer(kCopyChunkSize);
+  uint64_t copied_bytes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  while (input) {
+    input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    output.write(buffer.data(), input.gcount());
+    copied_bytes += static_cast<uint64_t>(input.gcount());
+    if (max_bytes_per_second > 0u) {
+      std::this_thread::sleep_until(
+        start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(
+            static_cast<double>(copied_bytes) / static_cast<double>(max_bytes_per_second))));
+    }
+  }
+  output.close();
+  if (input.bad() || !output ||
+    std::rename(partial_destination.c_str(), destination.c_str()) != 0)
+  {
+    rcpputils::fs::remove(rcpputils::fs::path(partial_destination));
+    return false;
+  }
+  input.close();
+  rcpputils::fs::remove(rcpputils::fs::path(source));
+  return true;
+}
+
+void update_file_time_range(
+  rosbag2_storage::FileInformation & file,
+  const std::chrono::time_point<std::chrono::high_resolution_clock> & message_timestamp,
+  bool is_first_message)
+{
+  if (is_first_message) {
+    file.starting_time = message_timestamp;
+    file.duration = std::chrono::nanoseconds{0};
+    return;
+  }
+  const auto ending_time = std::max(file.starting_time + file.duration, message_timestamp);
+  file.starting_time = std::min(file.starting_time, message_timestamp);
+  file.duration = ending_time - file.starting_time;
+}
+
+// Opens the storages of a stripe or topic group writer with the storage factory of the writer
+// of the bag.
+class ForwardingStorageFactory : public rosbag2_storage::StorageFactoryInterface
+{
+public:
+  explicit ForwardingStorageFactory(rosbag2_storage::StorageFactoryInterface & storage_factory)
+  : storage_factory_(storage_factory)
+  {}
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>
+  open_read_only(const std::string & uri, const std::string & storage_id) override
+  {
+    return storage_factory_.open_read_only(uri, storage_id);
+  }
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface>
+  open_read_write(const std::string & uri, const std::string & storage_id) override
+  {
+    return storage_factory_.open_read_write(uri, storage_id);
+  }
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface>
+  open_read_write(
+    const std::string & uri, const std::string & storage_id,
+    const rosbag2_storage::StorageConfig & storage_config) override
+  {
+    return storage_factory_.open_read_write(uri, storage_id, storage_config);
+  }
+
+private:
+  rosbag2_storage::StorageFactoryInterface & storage_factory_;
+};
+
+// The metadata of a topic group is only written as part of the metadata of the bag.
+class DiscardingMetadataIo : public rosbag2_storage::MetadataIo
+{
+public:
+  void write_metadata(const std::string &, const rosbag2_storage::BagMetadata &) override {}
+  void append_metadata(const std::string &, const rosbag2_storage::BagMetadata &) override {}
+};
+
+// Storages which do not batch writes get the messages one by one.
+void write_messages(
+  rosbag2_storage::storage_interfaces::ReadWriteInterface & storage,
+  const WriteLatencyMonitor::Messages & messages)
+{
+  if (messages.size() != 1u && storage.get_capabilities().batch_write) {
+    storage.write(messages);
+    return;
+  }
+  for (const auto & message : messages) {
+    storage.write(message);
+  }
+}
+
 }  // namespace
 
 SequentialWriter::SequentialWriter(
@@ -63,7 +218,10 @@ SequentialWriter::SequentialWriter(
   max_bagfile_size_(rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT),
   topics_names_to_info_(),
   metadata_()
-{}
+{
+  cache_memory_account_ = MemoryBudget::get_shared().open_account("writer cache");
+  snapshot_memory_account_ = MemoryBudget::get_shared().open_account("snapshot buffer");
+}
 
 SequentialWriter::~SequentialWriter()
 {
@@ -76,7 +234,10 @@ void SequentialWriter::init_metadata()
   metadata_.storage_identifier = storage_->get_storage_identifier();
   metadata_.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
     std::chrono::nanoseconds::max());
-  metadata_.relative_file_paths = {strip_parent_path(storage_->get_relative_file_path())};
+  metadata_.relative_file_paths = {get_path_in_metadata(storage_->get_relative_file_path())};
+  file_topic_sizes_ = {{}};
+  metadata_.bag_id = bag_id_;
+  metadata_.clock_offset = clock_offset_;
 }
 
 void SequentialWriter::open(
@@ -85,7 +246,157 @@ void SequentialWriter::open(
 {
   base_folder_ = storage_options.uri;
   max_bagfile_size_ = storage_options.max_bagfile_size;
+  max_bagfile_duration_ = std::chrono::seconds(storage_options.max_bagfile_duration);
+  max_bagfile_messages_ = storage_options.max_bagfile_messages;
+  precreate_next_bagfile_ = storage_options.precreate_next_bagfile;
+  current_file_message_count_ = 0;
+  next_file_number_ = 1;
+  retention_max_bytes_ = storage_options.retention_max_bytes;
+  retention_max_age_ = std::chrono::seconds(storage_options.retention_max_age);
+  if ((retention_max_bytes_ > 0u || retention_max_age_.count() > 0) && !is_splitting_enabled()) {
+    throw std::invalid_argument("Retention of bagfiles needs splitting of the bag.");
+  }
+  if ((retention_max_bytes_ > 0u || retention_max_age_.count() > 0) &&
+    storage_options.large_message_threshold > 0u)
+  {
+    throw std::invalid_argument("Data files of large messages cannot be retired.");
+  }
+  snapshot_mode_ = storage_options.snapshot_mode;
+  snapshot_max_bytes_ = storage_options.snapshot_max_bytes;
+  snapshot_duration_ = std::chrono::seconds(storage_options.snapshot_duration);
+  snapshot_buffer_.clear();
+  snapshot_buffer_size_bytes_ = 0;
+  snapshot_memory_account_->set_allocated(0);
+  if (snapshot_mode_ && snapshot_max_bytes_ == 0 && snapshot_duration_.count() == 0) {
+    throw std::invalid_argument(
+            "Snapshot mode needs a maximum size or duration of the messages kept in memory.");
+  }
+  for (const auto & stripe_directory : storage_options.stripe_directories) {
+    if (!rcpputils::fs::path(stripe_directory).is_absolute()) {
+      throw std::invalid_argument(
+              "Stripe directory \"" + stripe_directory + "\" is not an absolute path.");
+    }
+  }
+  storage_folder_ = base_folder_;
+  migration_max_bytes_per_second_ = storage_options.migration_max_bytes_per_second;
+  if (!storage_options.staging_directory.empty()) {
+    if (!rcpputils::fs::path(storage_options.staging_directory).is_absolute()) {
+      throw std::invalid_argument(
+              "Staging directory \"" + storage_options.staging_directory +
+              "\" is not an absolute path.");
+    }
+    if (!storage_options.stripe_directories.empty()) {
+      throw std::invalid_argument(
+              "A staging directory cannot be combined with stripe directories.");
+    }
+    if (storage_options.large_message_threshold > 0u) {
+      throw std::invalid_argument("Data files of large messages cannot be staged.");
+    }
+    const auto staging_folder = rcpputils::fs::path(storage_options.staging_directory) /
+      rcpputils::fs::path(base_folder_).filename();
+    if (!staging_folder.is_directory() && !rcpputils::fs::create_directories(staging_folder)) {
+      throw std::runtime_error("Failed to create folder \"" + staging_folder.string() + "\".");
+    }
+    storage_folder_ = staging_folder.string();
+  }
+  if (!storage_options.topic_groups.empty() && !storage_options.stripe_directories.empty()) {
+    throw std::invalid_argument("Topic groups cannot be combined with stripe directories.");
+  }
+  if (storage_options.shards > 0 &&
+    (!storage_options.stripe_directories.empty() || !storage_options.topic_groups.empty()))
+  {
+    throw std::invalid_argument(
+            "Shards cannot be combined with stripe directories or topic groups.");
+  }
+  for (const auto & topic : storage_options.delta_encode_topics) {
+    if (std::find(
+        storage_options.deduplicate_topics.begin(), storage_options.deduplicate_topics.end(),
+        topic) != storage_options.deduplicate_topics.end())
+    {
+      throw std::invalid_argument(
+              "Topic \"" + topic + "\" cannot be both deduplicated and delta encoded.");
+    }
+  }
+  // Maps and touches the memory of the messages before the first one is received.
+  rosbag2_storage::MemoryArena::get_shared();
+  stripe_writers_.clear();
+  // Shards write the topics of their own.
+  striping_policy_ = storage_options.shards > 0 ?
+    StripingPolicy::TOPIC_AFFINITY : storage_options.striping_policy;
+  next_stripe_ = 0;
+  topic_stripes_.clear();
+  group_writers_.clear();
+  topic_groups_.clear();
+  topic_group_regexes_.clear();
+  for (const auto & topic_group : storage_options.topic_groups) {
+    if (topic_group.name.empty()) {
+      throw std::invalid_argument("Topic groups need a name.");
+    }
+    // The name is used as a folder of the bag, which must not be left.
+    if (topic_group.name.find_first_of("/\\") != std::string::npos ||
+      topic_group.name.find("..") != std::string::npos || topic_group.name == ".")
+    {
+      throw std::invalid_argument(
+              "Invalid name of topic group \"" + topic_group.name + "\": it must not contain "
+              "path separators or \"..\".");
+    }
+    try {
+      topic_group_regexes_.emplace_back(topic_group.topics_regex);
+    } catch (const std::regex_error & e) {
+      throw std::invalid_argument(
+              "Invalid topics regex of topic group \"" + topic_group.name + "\": " + e.what());
+    }
+    topic_groups_.push_back(topic_group);
+  }
+  topic_groups_of_topics_.clear();
+  metadata_checkpoint_interval_ =
+    std::chrono::milliseconds(storage_options.metadata_checkpoint_interval_ms);
   max_cache_size_ = storage_options.max_cache_size;
+  max_cache_size_bytes_ = storage_options.max_cache_size_bytes;
+  // Shards are written at the same time by the I/O threads of their caches.
+  double_buffered_cache_ = (storage_options.double_buffered_cache || storage_options.shards > 0) &&
+    is_cache_enabled();
+  cache_overflow_policy_ = storage_options.cache_overflow_policy;
+  if (storage_options.priority_threshold_percent > 100u) {
+    throw std::invalid_argument("The priority threshold is a percentage of the cache size.");
+  }
+  topic_priorities_ = storage_options.topic_priorities;
+  priority_threshold_percent_ = storage_options.priority_threshold_percent;
+  low_priority_decimation_ = storage_options.low_priority_decimation;
+  storage_config_.preset_profile = storage_options.storage_preset_profile;
+  storage_config_.defer_index_creation = storage_options.defer_index_creation;
+  storage_config_.topic_timestamp_index = storage_options.topic_timestamp_index;
+  storage_config_.cluster_messages_by_topic = storage_options.cluster_messages_by_topic;
+  storage_config_.checksums = storage_options.checksums;
+  storage_config_.large_message_threshold = storage_options.large_message_threshold;
+  storage_config_.transaction_max_messages = storage_options.transaction_max_messages;
+  storage_config_.transaction_max_bytes = storage_options.transaction_max_bytes;
+  storage_config_.transaction_max_duration =
+    std::chrono::milliseconds(storage_options.transaction_max_duration_ms);
+  storage_config_.stream_address = storage_options.stream_address;
+  storage_config_.stream_max_memory_bytes = storage_options.stream_max_memory_bytes;
+  if (storage_options.preallocate_bagfiles && storage_options.max_bagfile_size == 0) {
+    throw std::invalid_argument("Preallocating bagfiles needs a maximum bagfile size.");
+  }
+  storage_config_.preallocate_size =
+    storage_options.preallocate_bagfiles ? storage_options.max_bagfile_size : 0;
+  storage_config_.writeback_interval_bytes = storage_options.writeback_interval_bytes;
+  storage_config_.memory_chunk_size = storage_options.memory_chunk_size;
+  storage_config_.memory_max_bytes = storage_options.memory_max_bytes;
+  bag_id_ = storage_options.bag_id;
+  clock_offset_ = std::chrono::nanoseconds(storage_options.clock_offset_ns);
+  write_latency_monitor_ = storage_options.write_latency_budget_ms > 0 ?
+    std::make_unique<WriteLatencyMonitor>(
+    std::chrono::milliseconds(storage_options.write_latency_budget_ms)) :
+    nullptr;
+  deduplicator_ = storage_options.deduplicate_topics.empty() ?
+    nullptr : std::make_unique<MessageDeduplicator>(storage_options.deduplicate_topics);
+  delta_encoder_ = storage_options.delta_encode_topics.empty() ?
+    nullptr : std::make_unique<MessageDeltaEncoder>(
+    storage_options.delta_encode_topics, storage_options.delta_keyframe_interval);
+  reorder_buffer_ = storage_options.reorder_window_ms == 0 ?
+    nullptr : std::make_unique<MessageReorderBuffer>(
+    std::chrono::milliseconds(storage_options.reorder_window_ms));
 
   cache_.reserve(max_cache_size_);
 
@@ -95,9 +406,10 @@ void SequentialWriter::open(
     converter_ = std::make_unique<Converter>(converter_options, converter_factory_);
   }
 
-  const auto storage_uri = format_storage_uri(base_folder_, 0);
+  const auto storage_uri = format_storage_uri(storage_folder_, shard_name_, 0);
 
-  storage_ = storage_factory_->open_read_write(storage_uri, storage_options.storage_id);
+  storage_ = storage_factory_->open_read_write(
+    storage_uri, storage_options.storage_id, storage_config_);
   if (!storage_) {
     throw std::runtime_error("No storage could be initialized. Abort");
   }
@@ -110,37 +422,220 @@ void SequentialWriter::open(
   }
 
   init_metadata();
+
+  if (precreate_next_bagfile_ && is_splitting_enabled()) {
+    precreate_next_storage();
+  }
+
+  if (double_buffered_cache_) {
+    flush_cache_.reserve(max_cache_size_);
+    stop_cache_io_thread_ = false;
+    cache_io_thread_ = std::thread(&SequentialWriter::cache_io_thread_main, this);
+  }
+
+  open_stripe_writers(storage_options, converter_options);
+  open_group_writers(storage_options, converter_options);
+
+  if (metadata_checkpoint_interval_.count() > 0) {
+    write_metadata_checkpoint();
+  }
+}
+
+std::unique_ptr<SequentialWriter> SequentialWriter::open_child_writer(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io, const std::string & shard_name)
+{
+  const auto folder = rcpputils::fs::path(storage_options.uri);
+  if (!folder.is_directory() && !rcpputils::fs::create_directories(folder)) {
+    throw std::runtime_error("Failed to create folder \"" + storage_options.uri + "\".");
+  }
+
+  // Checkpoints are written by the writer of the bag, including the metadata of its children,
+  // which are written the messages it reordered.
+  auto child_options = storage_options;
+  child_options.metadata_checkpoint_interval_ms = 0;
+  child_options.reorder_window_ms = 0;
+  child_options.shards = 0;
+  auto child_writer = std::make_unique<SequentialWriter>(
+    std::make_unique<ForwardingStorageFactory>(*storage_factory_), converter_factory_,
+    std::move(metadata_io));
+  child_writer->shard_name_ = shard_name;
+  child_writer->parent_writer_ = this;
+  child_writer->open(child_options, converter_options);
+  for (const auto & callbacks : event_callbacks_) {
+    child_writer->add_event_callbacks(callbacks);
+  }
+  return child_writer;
+}
+
+void SequentialWriter::open_stripe_writers(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  const auto bag_name = rcpputils::fs::path(base_folder_).filename();
+  for (const auto & stripe_directory : storage_options.stripe_directories) {
+    auto stripe_options = storage_options;
+    stripe_options.uri = (rcpputils::fs::path(stripe_directory) / bag_name).string();
+    stripe_options.stripe_directories.clear();
+    stripe_writers_.push_back(
+      open_child_writer(
+        stripe_options, converter_options, std::make_unique<rosbag2_storage::MetadataIo>()));
+  }
+  // The metadata of the bag directory is written by this writer only.
+  auto shard_options = storage_options;
+  shard_options.double_buffered_cache = true;
+  for (uint64_t shard = 1; shard <= storage_options.shards; ++shard) {
+    stripe_writers_.push_back(
+      open_child_writer(
+        shard_options, converter_options, std::make_unique<DiscardingMetadataIo>(),
+        bag_name.string() + "_shard" + std::to_string(shard)));
+  }
+}
+
+void SequentialWriter::open_group_writers(
+  const StorageOptions & storage_options, const ConverterOptions & converter_options)
+{
+  for (const auto & topic_group : topic_groups_) {
+    auto group_options = storage_options;
+    group_options.uri = (rcpputils::fs::path(base_folder_) / topic_group.name).string();
+    group_options.topic_groups.clear();
+    // The bagfiles of the group are staged in a folder of the staged bag.
+    if (!group_options.staging_directory.empty()) {
+      group_options.staging_directory = storage_folder_;
+    }
+    auto group_writer = open_child_writer(
+      group_options, converter_options, std::make_unique<DiscardingMetadataIo>());
+    group_writers_.push_back(std::move(group_writer));
+  }
 }
 
 void SequentialWriter::reset()
 {
+  if (storage_) {
+    flush_reorder_buffer();
+  }
+  if (reorder_buffer_ && reorder_buffer_->get_late_message_count() > 0u) {
+    ROSBAG2_CPP_LOG_WARN_STREAM(
+      reorder_buffer_->get_late_message_count() << " messages arrived after the reorder window "
+        "and were written out of time stamp order.");
+  }
+  reorder_buffer_.reset();
+
+  // The stripe and topic group writers finish their metadata, which is merged into the
+  // metadata of the bag.
+  for (auto & stripe_writer : stripe_writers_) {
+    stripe_writer->reset();
+  }
+  for (auto & group_writer : group_writers_) {
+    group_writer->reset();
+  }
+
+  if (cache_io_thread_.joinable()) {
+    stop_cache_io_thread();
+  } else if (storage_ && !cache_.empty()) {
+    write_cache_to_storage();
+    cache_.clear();
+    cache_size_bytes_ = 0;
+    update_cache_memory_account();
+  }
+
+  // Messages kept for a snapshot which was never taken are not recorded.
+  snapshot_buffer_.clear();
+  snapshot_buffer_size_bytes_ = 0;
+  snapshot_memory_account_->set_allocated(0);
+
+  if (storage_ && dropped_messages_count_ > 0u) {
+    ROSBAG2_CPP_LOG_WARN_STREAM(
+      "Cache overflow: " << dropped_messages_count_ << " messages were dropped.");
+  }
+
+  // Close all storages before writing the metadata, so deferred indices are built and counted
+  // into the bag size. Storages must be destroyed before the factory.
+  std::string last_file;
+  if (storage_) {
+    last_file = storage_->get_relative_file_path();
+  }
+  storage_.reset();
+  discard_next_storage();
+  wait_for_closing_storages();
+  for (auto & retiring : retiring_files_) {
+    retiring.wait();
+  }
+  retiring_files_.clear();
+  if (!last_file.empty()) {
+    if (storage_folder_ != base_folder_ && !metadata_.relative_file_paths.empty()) {
+      metadata_.relative_file_paths.back() = migrate_file(last_file);
+      last_file = resolve_path(metadata_.relative_file_paths.back());
+    }
+    if (!metadata_.relative_file_paths.empty()) {
+      set_file_size(metadata_.relative_file_paths.size() - 1, get_file_size(last_file));
+    }
+    notify_split({last_file, ""});
+  }
+
   if (!base_folder_.empty()) {
     finalize_metadata();
-    metadata_io_->write_metadata(base_folder_, metadata_);
+    auto metadata = metadata_;
+    merge_child_metadata(metadata);
+    metadata_io_->write_metadata(base_folder_, metadata);
   }
 
-  storage_.reset();  // Necessary to ensure that the storage is destroyed before the factory
   storage_factory_.reset();
 }
 
 void SequentialWriter::create_topic(const rosbag2_storage::TopicMetadata & topic_with_type)
+{
+  create_topics({topic_with_type});
+}
+
+void SequentialWriter::create_topics(
+  const std::vector<rosbag2_storage::TopicMetadata> & topics_with_type)
 {
   if (!storage_) {
     throw std::runtime_error("Bag is not open. Call open() before writing.");
   }
-
-  if (converter_) {
-    converter_->add_topic(topic_with_type.name, topic_with_type.type);
+  // The I/O thread looks up the topics and writes to the storage while a flush is pending.
+  if (double_buffered_cache_) {
+    wait_for_pending_flush();
   }
 
-  if (topics_names_to_info_.find(topic_with_type.name) ==
-    topics_names_to_info_.end())
-  {
-    rosbag2_storage::TopicInformation info{};
-    info.topic_metadata = topic_with_type;
+  std::vector<rosbag2_storage::TopicMetadata> new_topics;
+  for (const auto & topic_with_type : topics_with_type) {
+    if (converter_) {
+      converter_->add_topic(topic_with_type.name, topic_with_type.type);
+    }
+
+    if (topics_names_to_info_.find(topic_with_type.name) !=
+      topics_names_to_info_.end())
+    {
+      continue;
+    }
+
+    TopicEntry entry{};
+    entry.info.topic_metadata = topic_with_type;
+    const auto priority = topic_priorities_.find(topic_with_type.name);
+    if (priority != topic_priorities_.end()) {
+      entry.priority = priority->second;
+    }
+    entry.info.deduplicated = deduplicator_ && deduplicator_->is_deduplicated(topic_with_type.name);
+    entry.info.delta_encoded =
+      delta_encoder_ && delta_encoder_->is_delta_encoded(topic_with_type.name);
+    entry.handle = parent_writer_ ?
+      parent_writer_->get_topic_handle(topic_with_type.name) :
+      static_cast<rosbag2_storage::TopicHandle>(topics_by_handle_.size());
+    // A topic removed and created again keeps its index in the current bagfile.
+    if (!metadata_.files.empty() &&
+      metadata_.files.size() == metadata_.relative_file_paths.size())
+    {
+      const auto & file_topics = metadata_.files.back().topics;
+      const auto file_topic =
+        std::find(file_topics.begin(), file_topics.end(), topic_with_type.name);
+      if (file_topic != file_topics.end()) {
+        entry.file_topic_index = static_cast<size_t>(file_topic - file_topics.begin());
+      }
+    }
 
     const auto insert_res = topics_names_to_info_.insert(
-      std::make_pair(topic_with_type.name, info));
+      std::make_pair(topic_with_type.name, entry));
 
     if (!insert_res.second) {
       std::stringstream errmsg;
@@ -148,8 +643,36 @@ void SequentialWriter::create_topic(const rosbag2_storage::TopicMetadata & topic
 
       throw std::runtime_error(errmsg.str());
     }
+    if (entry.handle >= 0) {
+      const auto index = static_cast<size_t>(entry.handle);
+      if (index >= topics_by_handle_.size()) {
+        topics_by_handle_.resize(index + 1, nullptr);
+      }
+      topics_by_handle_[index] = &insert_res.first->second;
+    }
+    new_topics.push_back(topic_with_type);
+  }
+  if (new_topics.empty()) {
+    return;
+  }
 
-    storage_->create_topic(topic_with_type);
+  storage_->create_topics(new_topics);
+  for (const auto & topic_with_type : new_topics) {
+    storage_->set_topic_handle(
+      topic_with_type.name, topics_names_to_info_.at(topic_with_type.name).handle);
+
+    // Every stripe knows all topics, so it can hold messages of any of them.
+    if (!stripe_writers_.empty()) {
+      topic_stripes_.emplace(
+        topic_with_type.name, topic_stripes_.size() % (stripe_writers_.size() + 1));
+    }
+
+    if (!topic_groups_.empty()) {
+      assign_topic_group(topic_with_type.name);
+    }
+  }
+  for (auto & stripe_writer : stripe_writers_) {
+    stripe_writer->create_topics(new_topics);
   }
 }
 
@@ -158,9 +681,28 @@ void SequentialWriter::remove_topic(const rosbag2_storage::TopicMetadata & topic
   if (!storage_) {
     throw std::runtime_error("Bag is not open. Call open() before removing.");
   }
+  if (double_buffered_cache_) {
+    wait_for_pending_flush();
+  }
 
-  if (topics_names_to_info_.erase(topic_with_type.name) > 0) {
+  const auto topic = topics_names_to_info_.find(topic_with_type.name);
+  if (topic != topics_names_to_info_.end()) {
+    const auto handle = topic->second.handle;
+    if (handle >= 0 && static_cast<size_t>(handle) < topics_by_handle_.size()) {
+      topics_by_handle_[static_cast<size_t>(handle)] = nullptr;
+    }
+    topics_names_to_info_.erase(topic);
     storage_->remove_topic(topic_with_type);
+    for (auto & stripe_writer : stripe_writers_) {
+      stripe_writer->remove_topic(topic_with_type);
+    }
+    const auto topic_group = topic_groups_of_topics_.find(topic_with_type.name);
+    if (topic_group != topic_groups_of_topics_.end()) {
+      if (topic_group->second > 0) {
+        group_writers_[topic_group->second - 1]->remove_topic(topic_with_type);
+      }
+      topic_groups_of_topics_.erase(topic_group);
+    }
   } else {
     std::stringstream errmsg;
     errmsg << "Failed to remove the non-existing topic \"" <<
@@ -172,10 +714,19 @@ void SequentialWriter::remove_topic(const rosbag2_storage::TopicMetadata & topic
 
 void SequentialWriter::split_bagfile()
 {
-  const auto storage_uri = format_storage_uri(
-    base_folder_,
-    metadata_.relative_file_paths.size());
-  storage_ = storage_factory_->open_read_write(storage_uri, metadata_.storage_identifier);
+  const auto storage_uri = format_storage_uri(storage_folder_, shard_name_, next_file_number_);
+
+  auto closed_storage = std::move(storage_);
+  bag_events::BagSplitInfo split_info;
+  split_info.closed_file = closed_storage->get_relative_file_path();
+
+  const bool precreated = next_storage_.valid();
+  if (precreated) {
+    storage_ = take_next_storage();
+  } else {
+    storage_ = storage_factory_->open_read_write(
+      storage_uri, metadata_.storage_identifier, storage_config_);
+  }
 
   if (!storage_) {
     std::stringstream errmsg;
@@ -184,27 +735,522 @@ void SequentialWriter::split_bagfile()
     throw std::runtime_error(errmsg.str());
   }
 
-  metadata_.relative_file_paths.push_back(strip_parent_path(storage_->get_relative_file_path()));
+  split_info.opened_file = storage_->get_relative_file_path();
+  ROSBAG2_TRACEPOINT(split, split_info.closed_file.c_str(), split_info.opened_file.c_str());
+  const auto closed_file_index = metadata_.relative_file_paths.size() - 1;
+  if (storage_config_.defer_index_creation || storage_folder_ != base_folder_) {
+    close_storage_in_background(std::move(closed_storage), split_info, closed_file_index);
+  } else {
+    closed_storage.reset();
+    set_file_size(closed_file_index, get_file_size(split_info.closed_file));
+    notify_split(split_info);
+  }
+
+  current_file_message_count_ = 0;
+  // References and deltas only refer to messages in the same file.
+  if (deduplicator_) {
+    deduplicator_->reset();
+  }
+  if (delta_encoder_) {
+    delta_encoder_->reset();
+  }
+  metadata_.relative_file_paths.push_back(get_path_in_metadata(storage_->get_relative_file_path()));
+  file_topic_sizes_.emplace_back();
+  ++next_file_number_;
 
   // Re-register all topics since we rolled-over to a new bagfile.
+  if (!precreated) {
+    std::vector<rosbag2_storage::TopicMetadata> topics;
+    for (const auto & topic : topics_names_to_info_) {
+      topics.push_back(topic.second.info.topic_metadata);
+    }
+    storage_->create_topics(topics);
+  }
+  for (auto & topic : topics_names_to_info_) {
+    storage_->set_topic_handle(topic.first, topic.second.handle);
+    topic.second.file_topic_index = std::numeric_limits<size_t>::max();
+  }
+
+  if (precreate_next_bagfile_) {
+    precreate_next_storage();
+  }
+
+  if (retention_max_bytes_ > 0u || retention_max_age_.count() > 0) {
+    apply_retention();
+  }
+
+  if (metadata_checkpoint_interval_.count() > 0) {
+    write_metadata_checkpoint();
+  }
+}
+
+void SequentialWriter::precreate_next_storage()
+{
+  const auto storage_uri = format_storage_uri(storage_folder_, shard_name_, next_file_number_);
+
+  next_storage_topics_.clear();
+  for (const auto & topic : topics_names_to_info_) {
+    next_storage_topics_.push_back(topic.second.info.topic_metadata);
+  }
+
+  next_storage_ = ThreadPool::get_shared().submit(
+    [this, storage_uri, storage_id = metadata_.storage_identifier,
+    topics = next_storage_topics_]() {
+      auto storage = storage_factory_->open_read_write(storage_uri, storage_id, storage_config_);
+      if (storage) {
+        storage->create_topics(topics);
+      }
+      return storage;
+    });
+}
+
+std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface>
+SequentialWriter::take_next_storage()
+{
+  auto storage = next_storage_.get();
+  if (!storage) {
+    return storage;
+  }
+
+  // Topics may have been created or removed while the storage was precreated.
+  for (const auto & topic : next_storage_topics_) {
+    if (topics_names_to_info_.find(topic.name) == topics_names_to_info_.end()) {
+      storage->remove_topic(topic);
+    }
+  }
   for (const auto & topic : topics_names_to_info_) {
-    storage_->create_topic(topic.second.topic_metadata);
+    const auto precreated_topic = std::find_if(
+      next_storage_topics_.begin(), next_storage_topics_.end(),
+      [&topic](const rosbag2_storage::TopicMetadata & candidate) {
+        return candidate.name == topic.first;
+      });
+    if (precreated_topic == next_storage_topics_.end()) {
+      storage->create_topic(topic.second.info.topic_metadata);
+    }
+  }
+  next_storage_topics_.clear();
+  return storage;
+}
+
+void SequentialWriter::discard_next_storage()
+{
+  if (!next_storage_.valid()) {
+    return;
+  }
+
+  std::string unused_file;
+  try {
+    auto storage = next_storage_.get();
+    if (storage) {
+      unused_file = storage->get_relative_file_path();
+    }
+  } catch (const std::exception & e) {
+    ROSBAG2_CPP_LOG_WARN_STREAM("Failed to precreate the next bagfile: " << e.what());
+  }
+  next_storage_topics_.clear();
+
+  if (!unused_file.empty() && rcpputils::fs::path(unused_file).exists() &&
+    !rcpputils::fs::remove(rcpputils::fs::path(unused_file)))
+  {
+    ROSBAG2_CPP_LOG_WARN_STREAM("Failed to remove unused bagfile \"" << unused_file << "\".");
   }
 }
 
+bool SequentialWriter::is_splitting_enabled() const
+{
+  return max_bagfile_size_ != rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT ||
+         max_bagfile_duration_.count() > 0 || max_bagfile_messages_ > 0u;
+}
+
+void SequentialWriter::close_storage_in_background(
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage,
+  const bag_events::BagSplitInfo & split_info, size_t file_index)
+{
+  // Drop the handles of storages which are closed already.
+  collect_closed_file_sizes();
+
+  // Building the deferred indices when the storage is destroyed and moving a staged bagfile may
+  // take a while.
+  closing_storages_.push_back(
+    {file_index, ThreadPool::get_shared().submit(
+        [this, storage, split_info]() mutable {
+          storage.reset();
+          ClosedFile closed_file;
+          closed_file.path = get_path_in_metadata(split_info.closed_file);
+          auto final_split_info = split_info;
+          if (storage_folder_ != base_folder_) {
+            // The split is announced once the bagfile is in its final place.
+            closed_file.path = migrate_file(split_info.closed_file);
+            final_split_info.closed_file = resolve_path(closed_file.path);
+          }
+          closed_file.size = get_file_size(final_split_info.closed_file);
+          notify_split(final_split_info);
+          return closed_file;
+        })});
+}
+
+void SequentialWriter::collect_closed_file_sizes()
+{
+  auto closing = closing_storages_.begin();
+  while (closing != closing_storages_.end()) {
+    if (closing->closed_file.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++closing;
+      continue;
+    }
+    set_closed_file(closing->file_index, closing->closed_file.get());
+    closing = closing_storages_.erase(closing);
+  }
+}
+
+void SequentialWriter::set_file_size(size_t file_index, uint64_t file_size)
+{
+  if (file_index >= metadata_.relative_file_paths.size()) {
+    return;
+  }
+  if (metadata_.files.size() < metadata_.relative_file_paths.size()) {
+    metadata_.files.resize(metadata_.relative_file_paths.size());
+  }
+  metadata_.files[file_index].size = file_size;
+}
+
+void SequentialWriter::set_closed_file(size_t file_index, const ClosedFile & closed_file)
+{
+  set_file_size(file_index, closed_file.size);
+  if (file_index < metadata_.relative_file_paths.size()) {
+    metadata_.relative_file_paths[file_index] = closed_file.path;
+  }
+}
+
+std::string SequentialWriter::get_path_in_metadata(const std::string & storage_path) const
+{
+  return storage_folder_ == base_folder_ ? strip_parent_path(storage_path) : storage_path;
+}
+
+std::string SequentialWriter::resolve_path(const std::string & path_in_metadata) const
+{
+  const auto path = rcpputils::fs::path(path_in_metadata);
+  return path.is_absolute() ? path.string() : (rcpputils::fs::path(base_folder_) / path).string();
+}
+
+std::string SequentialWriter::migrate_file(const std::string & staged_path) const
+{
+  const auto file_name = strip_parent_path(staged_path);
+  const auto destination = (rcpputils::fs::path(base_folder_) / file_name).string();
+  if (!move_file(staged_path, destination, migration_max_bytes_per_second_)) {
+    ROSBAG2_CPP_LOG_WARN_STREAM(
+      "Failed to move bagfile \"" << staged_path << "\" to \"" << destination <<
+        "\", it is kept in the staging directory.");
+    return staged_path;
+  }
+  return file_name;
+}
+
+void SequentialWriter::notify_split(const bag_events::BagSplitInfo & split_info) const
+{
+  for (const auto & callbacks : event_callbacks_) {
+    if (callbacks.write_split_callback) {
+      callbacks.write_split_callback(split_info);
+    }
+  }
+}
+
+void SequentialWriter::apply_retention()
+{
+  collect_closed_file_sizes();
+  if (metadata_.files.size() < metadata_.relative_file_paths.size()) {
+    metadata_.files.resize(metadata_.relative_file_paths.size());
+  }
+
+  // Only closed files are retired, neither the current one nor those still being closed.
+  auto closed_files = metadata_.relative_file_paths.size() - 1;
+  for (const auto & closing : closing_storages_) {
+    closed_files = std::min(closed_files, closing.file_index);
+  }
+  // Files still closing count as 0 until their size is known, the current one with the size
+  // estimated by its storage.
+  uint64_t bag_size = storage_->get_bagfile_size();
+  for (size_t i = 0; i + 1 < metadata_.files.size(); ++i) {
+    bag_size += metadata_.files[i].size;
+  }
+  const auto newest_time = metadata_.starting_time + metadata_.duration;
+
+  size_t retired_files = 0;
+  while (retired_files < closed_files) {
+    const auto & file = metadata_.files[retired_files];
+    const bool exceeds_size = retention_max_bytes_ > 0u && bag_size > retention_max_bytes_;
+    const bool exceeds_age = retention_max_age_.count() > 0 && file.message_count > 0u &&
+      newest_time - (file.starting_time + file.duration) > retention_max_age_;
+    if (!exceeds_size && !exceeds_age) {
+      break;
+    }
+    bag_size -= file.size;
+    ++retired_files;
+  }
+  if (retired_files == 0u) {
+    return;
+  }
+
+  for (size_t i = 0; i < retired_files; ++i) {
+    const auto & file = metadata_.files[i];
+    const auto & topic_sizes = file_topic_sizes_[i];
+    for (size_t j = 0; j < file.topics.size(); ++j) {
+      // Removed topics are not listed in the metadata anymore.
+      const auto topic = topics_names_to_info_.find(file.topics[j]);
+      if (topic == topics_names_to_info_.end()) {
+        continue;
+      }
+      topic->second.info.message_count -= file.topic_message_counts[j];
+      topic->second.info.total_size -= j < topic_sizes.size() ? topic_sizes[j] : 0u;
+    }
+    retire_file(resolve_path(metadata_.relative_file_paths[i]));
+  }
+  const auto retired_end = [retired_files](auto & container) {
+      return container.begin() + static_cast<std::ptrdiff_t>(retired_files);
+    };
+  metadata_.relative_file_paths.erase(
+    metadata_.relative_file_paths.begin(), retired_end(metadata_.relative_file_paths));
+  metadata_.files.erase(metadata_.files.begin(), retired_end(metadata_.files));
+  file_topic_sizes_.erase(file_topic_sizes_.begin(), retired_end(file_topic_sizes_));
+  for (auto & closing : closing_storages_) {
+    closing.file_index -= retired_files;
+  }
+
+  // The bag starts with the oldest message left, the histograms still count the retired ones.
+  auto starting_time = newest_time;
+  for (const auto & file : metadata_.files) {
+    if (file.message_count > 0u) {
+      starting_time = std::min(starting_time, file.starting_time);
+    }
+  }
+  metadata_.starting_time = starting_time;
+  metadata_.duration = newest_time - starting_time;
+}
+
+void SequentialWriter::retire_file(const std::string & path)
+{
+  retiring_files_.erase(
+    std::remove_if(
+      retiring_files_.begin(), retiring_files_.end(),
+      [](const std::future<void> & retiring) {
+        return retiring.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+      }),
+    retiring_files_.end());
+
+  // The callbacks are copied, add_event_callbacks may add to them on the writer thread meanwhile.
+  retiring_files_.push_back(
+    ThreadPool::get_shared().submit(
+      [path, event_callbacks = event_callbacks_]() {
+        bool handed_over = false;
+        for (const auto & callbacks : event_callbacks) {
+          if (callbacks.write_retire_callback) {
+            callbacks.write_retire_callback({path});
+            handed_over = true;
+          }
+        }
+        if (!handed_over && rcpputils::fs::path(path).exists() &&
+          !rcpputils::fs::remove(rcpputils::fs::path(path)))
+        {
+          ROSBAG2_CPP_LOG_WARN_STREAM("Failed to remove retired bagfile \"" << path << "\".");
+        }
+      }));
+}
+
+void SequentialWriter::add_event_callbacks(const bag_events::WriterEventCallbacks & callbacks)
+{
+  event_callbacks_.push_back(callbacks);
+  for (auto & stripe_writer : stripe_writers_) {
+    stripe_writer->add_event_callbacks(callbacks);
+  }
+  for (auto & group_writer : group_writers_) {
+    group_writer->add_event_callbacks(callbacks);
+  }
+}
+
+void SequentialWriter::wait_for_closing_storages()
+{
+  for (auto & closing : closing_storages_) {
+    set_closed_file(closing.file_index, closing.closed_file.get());
+  }
+  closing_storages_.clear();
+}
+
 void SequentialWriter::write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
 {
   if (!storage_) {
     throw std::runtime_error("Bag is not open. Call open() before writing.");
   }
+  ROSBAG2_TRACEPOINT(
+    writer_write, message->topic_name.c_str(), message->time_stamp,
+    message->serialized_data ? message->serialized_data->buffer_length : 0u);
+
+  if (metadata_checkpoint_interval_.count() > 0 &&
+    std::chrono::steady_clock::now() - last_metadata_checkpoint_ >= metadata_checkpoint_interval_)
+  {
+    write_metadata_checkpoint();
+  }
+
+  if (reorder_buffer_) {
+    reordered_messages_.clear();
+    reorder_buffer_->add(std::move(message), reordered_messages_);
+    for (auto & reordered_message : reordered_messages_) {
+      write_in_order(std::move(reordered_message));
+    }
+    return;
+  }
+  write_in_order(std::move(message));
+}
+
+void SequentialWriter::write_in_order(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  if (!group_writers_.empty()) {
+    const auto topic_group = select_topic_group(*message);
+    if (topic_group > 0) {
+      group_writers_[topic_group - 1]->write(std::move(message));
+      return;
+    }
+  }
+
+  if (!stripe_writers_.empty()) {
+    const auto stripe = select_stripe(*message);
+    if (stripe > 0) {
+      stripe_writers_[stripe - 1]->write(std::move(message));
+      return;
+    }
+  }
+
+  // Messages written to stripes and topic groups are shifted by their writers.
+  if (clock_offset_.count() != 0) {
+    message = shift_time_stamps(*message, clock_offset_);
+  }
+
+  if (snapshot_mode_) {
+    // Unknown topics are rejected right away rather than when the snapshot is taken.
+    if (!find_topic(*message)) {
+      throw std::out_of_range("Unknown topic \"" + message->topic_name + "\".");
+    }
+    add_to_snapshot_buffer(std::move(message));
+  } else {
+    write_to_storage(std::move(message));
+  }
+}
+
+void SequentialWriter::flush_reorder_buffer()
+{
+  if (!reorder_buffer_) {
+    return;
+  }
+  reordered_messages_.clear();
+  reorder_buffer_->flush(reordered_messages_);
+  for (auto & reordered_message : reordered_messages_) {
+    write_in_order(std::move(reordered_message));
+  }
+  reordered_messages_.clear();
+}
+
+bool SequentialWriter::take_snapshot()
+{
+  if (!snapshot_mode_) {
+    return false;
+  }
+  if (!storage_) {
+    throw std::runtime_error("Bag is not open. Call open() before taking a snapshot.");
+  }
+  flush_reorder_buffer();
+  for (auto & stripe_writer : stripe_writers_) {
+    stripe_writer->take_snapshot();
+  }
+  for (auto & group_writer : group_writers_) {
+    group_writer->take_snapshot();
+  }
+
+  if (current_file_message_count_ > 0u) {
+    flush_cache();
+    split_bagfile();
+  }
+  auto messages = std::move(snapshot_buffer_);
+  snapshot_buffer_.clear();
+  snapshot_buffer_size_bytes_ = 0;
+  snapshot_memory_account_->set_allocated(0);
+  for (auto & message : messages) {
+    write_to_storage(std::move(message));
+  }
+  flush_cache();
+  return true;
+}
+
+void SequentialWriter::add_to_snapshot_buffer(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  snapshot_buffer_size_bytes_ += get_serialized_size(*message);
+  snapshot_memory_account_->allocate(get_serialized_size(*message));
+  snapshot_buffer_.push_back(std::move(message));
+
+  const auto newest_time_stamp = snapshot_buffer_.back()->time_stamp;
+  while (snapshot_buffer_.size() > 1u) {
+    const auto & oldest_message = *snapshot_buffer_.front();
+    const bool exceeds_size = snapshot_max_bytes_ > 0u &&
+      snapshot_buffer_size_bytes_ > snapshot_max_bytes_;
+    const bool exceeds_duration = snapshot_duration_.count() > 0 &&
+      std::chrono::nanoseconds(newest_time_stamp - oldest_message.time_stamp) > snapshot_duration_;
+    if (!exceeds_size && !exceeds_duration && !snapshot_memory_account_->is_budget_exhausted()) {
+      break;
+    }
+    snapshot_buffer_size_bytes_ -= get_serialized_size(oldest_message);
+    snapshot_memory_account_->release(get_serialized_size(oldest_message));
+    snapshot_buffer_.pop_front();
+  }
+}
 
-  // Update the message count for the Topic.
-  ++topics_names_to_info_.at(message->topic_name).message_count;
+SequentialWriter::TopicEntry * SequentialWriter::find_topic(
+  const rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto handle = message.topic_handle;
+  if (handle >= 0 && static_cast<size_t>(handle) < topics_by_handle_.size() &&
+    topics_by_handle_[static_cast<size_t>(handle)])
+  {
+    return topics_by_handle_[static_cast<size_t>(handle)];
+  }
+  const auto topic = topics_names_to_info_.find(message.topic_name);
+  return topic != topics_names_to_info_.end() ? &topic->second : nullptr;
+}
 
-  if (should_split_bagfile()) {
+rosbag2_storage::TopicHandle SequentialWriter::get_topic_handle(
+  const std::string & topic_name) const
+{
+  const auto topic = topics_names_to_info_.find(topic_name);
+  return topic != topics_names_to_info_.end() ?
+         topic->second.handle : rosbag2_storage::INVALID_TOPIC_HANDLE;
+}
+
+void SequentialWriter::write_to_storage(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  auto * const found_topic = find_topic(*message);
+  if (!found_topic) {
+    throw std::out_of_range("Unknown topic \"" + message->topic_name + "\".");
+  }
+  auto & topic = *found_topic;
+
+  if (should_split_bagfile(*message)) {
+    // Cached messages belong to the current bagfile.
+    flush_cache();
     split_bagfile();
   }
 
+  // Update the message count and sizes for the Topic, after a split so its checkpoint does not
+  // count the message yet.
+  ++topic.info.message_count;
+  const auto message_size = get_serialized_size(*message);
+  topic.info.total_size += message_size;
+  topic.info.max_message_size = std::max(topic.info.max_message_size, message_size);
+  rosbag2_storage::add_to_histogram(topic.info.histogram, message->time_stamp, message_size);
+
+  if (current_file_message_count_ == 0) {
+    current_file_starting_time_ = message->time_stamp;
+  }
+  ++current_file_message_count_;
+
   const auto message_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>(
     std::chrono::nanoseconds(message->time_stamp));
   metadata_.starting_time = std::min(metadata_.starting_time, message_timestamp);
@@ -212,49 +1258,536 @@ void SequentialWriter::write(std::shared_ptr<rosbag2_storage::SerializedBagMessa
   const auto duration = message_timestamp - metadata_.starting_time;
   metadata_.duration = std::max(metadata_.duration, duration);
 
-  // if cache size is set to zero, we directly call write
-  if (max_cache_size_ == 0u) {
-    storage_->write(converter_ ? converter_->convert(message) : message);
+  if (metadata_.files.size() < metadata_.relative_file_paths.size()) {
+    metadata_.files.resize(metadata_.relative_file_paths.size());
+  }
+  update_file_time_range(
+    metadata_.files.back(), message_timestamp, current_file_message_count_ == 1u);
+  auto & file = metadata_.files.back();
+  file.message_count = current_file_message_count_;
+  // Readers skip the files without any of the topics they read.
+  if (topic.file_topic_index == std::numeric_limits<size_t>::max()) {
+    topic.file_topic_index = file.topics.size();
+    file.topics.push_back(message->topic_name);
+    file.topic_message_counts.push_back(0);
+  }
+  ++file.topic_message_counts[topic.file_topic_index];
+  auto & file_topic_sizes = file_topic_sizes_.back();
+  if (file_topic_sizes.size() < file.topics.size()) {
+    file_topic_sizes.resize(file.topics.size());
+  }
+  file_topic_sizes[topic.file_topic_index] += message_size;
+
+  // Messages for the single cache are converted in batches when it is written, which lets the
+  // converter spread them over its threads. The double buffered cache is written on its own
+  // thread, which must not convert while topics are added.
+  const bool converts_in_batches = is_cache_enabled() && !double_buffered_cache_;
+  auto converted_message = converter_ && !converts_in_batches ?
+    converter_->convert(message) : message;
+
+  // if both cache sizes are set to zero, we directly call write
+  if (!is_cache_enabled()) {
+    if (deduplicator_ || delta_encoder_) {
+      write_encoded_messages({converted_message});
+      return;
+    }
+    const auto start = write_latency_monitor_ ?
+      std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    storage_->write(converted_message);
+    if (write_latency_monitor_) {
+      record_write_latency({converted_message}, start);
+    }
+  } else if (double_buffered_cache_) {
+    write_to_double_buffered_cache(converted_message);
   } else {
-    cache_.push_back(converter_ ? converter_->convert(message) : message);
-    if (cache_.size() >= max_cache_size_) {
-      storage_->write(cache_);
+    add_to_cache(converted_message);
+    if (is_cache_full()) {
+      write_cache_to_storage();
       // reset cache
       cache_.clear();
       cache_.reserve(max_cache_size_);
+      cache_size_bytes_ = 0;
+      update_cache_memory_account();
     }
   }
 }
 
-bool SequentialWriter::should_split_bagfile() const
+bool SequentialWriter::is_cache_enabled() const
 {
-  if (max_bagfile_size_ == rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT) {
-    return false;
-  } else {
-    return storage_->get_bagfile_size() > max_bagfile_size_;
+  return max_cache_size_ > 0u || max_cache_size_bytes_ > 0u;
+}
+
+bool SequentialWriter::is_cache_full() const
+{
+  return (max_cache_size_ > 0u && cache_.size() >= max_cache_size_) ||
+         (max_cache_size_bytes_ > 0u && cache_size_bytes_ >= max_cache_size_bytes_) ||
+         (!cache_.empty() && cache_memory_account_->is_budget_exhausted());
+}
+
+void SequentialWriter::update_cache_memory_account()
+{
+  cache_memory_account_->set_allocated(cache_size_bytes_ + flush_cache_size_bytes_);
+}
+
+void SequentialWriter::add_to_cache(
+  std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
+{
+  cache_size_bytes_ += get_serialized_size(*message);
+  cache_.push_back(message);
+  update_cache_memory_account();
+  // Both caches are held in memory while the double buffered cache is flushed.
+  cache_high_water_mark_bytes_ =
+    std::max(cache_high_water_mark_bytes_, cache_size_bytes_ + flush_cache_size_bytes_);
+}
+
+uint64_t SequentialWriter::get_dropped_messages_count() const
+{
+  uint64_t dropped_messages_count = dropped_messages_count_;
+  for (const auto & stripe_writer : stripe_writers_) {
+    dropped_messages_count += stripe_writer->get_dropped_messages_count();
+  }
+  for (const auto & group_writer : group_writers_) {
+    dropped_messages_count += group_writer->get_dropped_messages_count();
+  }
+  return dropped_messages_count;
+}
+
+void SequentialWriter::assign_topic_group(const std::string & topic_name)
+{
+  for (size_t i = 0; i < topic_groups_.size(); ++i) {
+    if (!topic_groups_[i].topics_regex.empty() &&
+      std::regex_match(topic_name, topic_group_regexes_[i]))
+    {
+      add_topic_to_group(topic_name, i + 1);
+      return;
+    }
+  }
+  const bool is_grouped_by_size = std::any_of(
+    topic_groups_.begin(), topic_groups_.end(),
+    [](const TopicGroup & topic_group) {return topic_group.min_message_size > 0;});
+  // Otherwise the group is chosen by the size of the first message of the topic.
+  if (!is_grouped_by_size) {
+    add_topic_to_group(topic_name, 0);
+  }
+}
+
+void SequentialWriter::add_topic_to_group(const std::string & topic_name, size_t topic_group)
+{
+  topic_groups_of_topics_[topic_name] = topic_group;
+  if (topic_group > 0) {
+    group_writers_[topic_group - 1]->create_topic(
+      topics_names_to_info_.at(topic_name).info.topic_metadata);
+  }
+}
+
+size_t SequentialWriter::select_topic_group(const rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto topic_group = topic_groups_of_topics_.find(message.topic_name);
+  if (topic_group != topic_groups_of_topics_.end()) {
+    return topic_group->second;
+  }
+  // Messages of unknown topics are rejected by the writer of the bag directory.
+  if (topics_names_to_info_.find(message.topic_name) == topics_names_to_info_.end()) {
+    return 0u;
+  }
+
+  const auto message_size =
+    message.serialized_data ? message.serialized_data->buffer_length : 0u;
+  size_t selected_group = 0;
+  for (size_t i = 0; i < topic_groups_.size(); ++i) {
+    if (topic_groups_[i].min_message_size > 0 &&
+      message_size >= topic_groups_[i].min_message_size)
+    {
+      selected_group = i + 1;
+      break;
+    }
+  }
+  add_topic_to_group(message.topic_name, selected_group);
+  return selected_group;
+}
+
+size_t SequentialWriter::select_stripe(const rosbag2_storage::SerializedBagMessage & message)
+{
+  if (striping_policy_ == StripingPolicy::TOPIC_AFFINITY) {
+    // Messages of unknown topics are rejected by the writer of the bag directory.
+    const auto topic_stripe = topic_stripes_.find(message.topic_name);
+    return topic_stripe != topic_stripes_.end() ? topic_stripe->second : 0u;
+  }
+  const auto stripe = next_stripe_;
+  next_stripe_ = (next_stripe_ + 1) % (stripe_writers_.size() + 1);
+  return stripe;
+}
+
+void SequentialWriter::write_to_double_buffered_cache(
+  std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
+{
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  auto * const found_topic = find_topic(*message);
+  if (!found_topic) {
+    throw std::out_of_range("Unknown topic \"" + message->topic_name + "\".");
+  }
+  auto & topic = *found_topic;
+
+  // Low priority messages are thinned out while the I/O thread cannot keep up.
+  if (flush_pending_ && topic.priority == TopicPriority::LOW &&
+    is_cache_above_priority_threshold())
+  {
+    if (low_priority_decimation_ == 0u ||
+      topic.decimation_count++ % low_priority_decimation_ != 0u)
+    {
+      discard_message(*message);
+      return;
+    }
+  } else if (topic.priority == TopicPriority::LOW) {
+    topic.decimation_count = 0;
+  }
+
+  if (is_cache_full() && flush_pending_ && !topic_priorities_.empty()) {
+    if (topic.priority == TopicPriority::LOW) {
+      discard_message(*message);
+      return;
+    }
+    discard_cached_messages_below(topic.priority);
+  }
+
+  if (is_cache_full()) {
+    // Both caches are full: the I/O thread is still busy with the previous cache.
+    if (cache_overflow_policy_ == CacheOverflowPolicy::BLOCK ||
+      topic.priority == TopicPriority::HIGH)
+    {
+      flush_done_.wait(lock, [this] {return !flush_pending_;});
+    }
+
+    if (flush_pending_ && write_latency_monitor_) {
+      const auto warning = write_latency_monitor_->record_backlog(cache_);
+      if (!warning.empty()) {
+        ROSBAG2_CPP_LOG_WARN_STREAM(warning);
+      }
+    }
+    if (!flush_pending_) {
+      swap_caches();
+    } else if (cache_overflow_policy_ == CacheOverflowPolicy::DROP_NEWEST) {
+      discard_message(*message);
+      return;
+    } else {
+      discard_cached_messages_below(TopicPriority::HIGH);
+      if (is_cache_full()) {
+        // Only high priority messages are cached.
+        discard_message(*message);
+        return;
+      }
+    }
+  }
+
+  add_to_cache(message);
+  if (is_cache_full() && !flush_pending_) {
+    swap_caches();
+  }
+}
+
+bool SequentialWriter::is_cache_above_priority_threshold() const
+{
+  return (max_cache_size_ > 0u &&
+         cache_.size() * 100u >= max_cache_size_ * priority_threshold_percent_) ||
+         (max_cache_size_bytes_ > 0u &&
+         cache_size_bytes_ * 100u >= max_cache_size_bytes_ * priority_threshold_percent_);
+}
+
+void SequentialWriter::discard_message(const rosbag2_storage::SerializedBagMessage & message)
+{
+  auto * const topic = find_topic(message);
+  if (topic) {
+    --topic->info.message_count;
+    topic->info.total_size -= get_serialized_size(message);
+    rosbag2_storage::remove_from_histogram(
+      topic->info.histogram, message.time_stamp, get_serialized_size(message));
+    ++topic->info.dropped_message_count;
+  }
+  ++dropped_messages_count_;
+}
+
+void SequentialWriter::discard_cached_messages_below(TopicPriority priority)
+{
+  // A single message may not free enough bytes for the byte budget.
+  auto cached = cache_.begin();
+  while (cached != cache_.end() && is_cache_full()) {
+    const auto * const topic = find_topic(**cached);
+    const auto cached_priority = topic ? topic->priority : TopicPriority::NORMAL;
+    if (cached_priority < priority) {
+      cache_size_bytes_ -= get_serialized_size(**cached);
+      update_cache_memory_account();
+      discard_message(**cached);
+      cached = cache_.erase(cached);
+    } else {
+      ++cached;
+    }
+  }
+}
+
+void SequentialWriter::swap_caches()
+{
+  std::swap(cache_, flush_cache_);
+  std::swap(cache_size_bytes_, flush_cache_size_bytes_);
+  flush_pending_ = true;
+  flush_requested_.notify_one();
+}
+
+void SequentialWriter::flush_cache()
+{
+  if (double_buffered_cache_) {
+    // Hand the cache over to the I/O thread and wait until it is done with the current storage.
+    wait_for_pending_flush();
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    if (!cache_.empty()) {
+      swap_caches();
+      flush_done_.wait(lock, [this] {return !flush_pending_;});
+    }
+  } else if (!cache_.empty()) {
+    write_cache_to_storage();
+    cache_.clear();
+    cache_size_bytes_ = 0;
+    update_cache_memory_account();
+  }
+}
+
+void SequentialWriter::write_cache_to_storage()
+{
+  ROSBAG2_TRACEPOINT(cache_flush_begin, cache_.size());
+  if (converter_) {
+    converter_->convert(cache_);
+  }
+  write_messages_to_storage(cache_);
+  ROSBAG2_TRACEPOINT(cache_flush_end, cache_.size());
+}
+
+void SequentialWriter::write_messages_to_storage(const WriteLatencyMonitor::Messages & messages)
+{
+  if (deduplicator_ || delta_encoder_) {
+    write_encoded_messages(messages);
+    return;
+  }
+  if (!write_latency_monitor_) {
+    write_messages(*storage_, messages);
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  write_messages(*storage_, messages);
+  record_write_latency(messages, start);
+}
+
+void SequentialWriter::write_encoded_messages(const WriteLatencyMonitor::Messages & messages)
+{
+  auto encoded_messages = delta_encoder_ ? delta_encoder_->encode(messages) : messages;
+  if (deduplicator_) {
+    encoded_messages = deduplicator_->deduplicate(encoded_messages);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  try {
+    write_messages(*storage_, encoded_messages);
+  } catch (...) {
+    // The messages references and deltas refer to may not have been stored.
+    if (deduplicator_) {
+      deduplicator_->reset();
+    }
+    if (delta_encoder_) {
+      delta_encoder_->reset();
+    }
+    throw;
+  }
+  if (write_latency_monitor_) {
+    record_write_latency(encoded_messages, start);
+  }
+}
+
+void SequentialWriter::record_write_latency(
+  const WriteLatencyMonitor::Messages & messages, std::chrono::steady_clock::time_point start)
+{
+  const auto end = std::chrono::steady_clock::now();
+  const auto warning = write_latency_monitor_->record_write(messages, end - start, end);
+  if (!warning.empty()) {
+    ROSBAG2_CPP_LOG_WARN_STREAM(warning);
   }
 }
 
+void SequentialWriter::wait_for_pending_flush()
+{
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  flush_done_.wait(lock, [this] {return !flush_pending_;});
+}
+
+void SequentialWriter::stop_cache_io_thread()
+{
+  {
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    flush_done_.wait(lock, [this] {return !flush_pending_;});
+    if (!cache_.empty()) {
+      swap_caches();
+    }
+    stop_cache_io_thread_ = true;
+    flush_requested_.notify_one();
+  }
+  cache_io_thread_.join();
+}
+
+void SequentialWriter::cache_io_thread_main()
+{
+  ThreadPool::configure_current_thread(ThreadRole::WRITER);
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  while (true) {
+    flush_requested_.wait(lock, [this] {return flush_pending_ || stop_cache_io_thread_;});
+    if (!flush_pending_) {
+      break;
+    }
+
+    // `storage_` and `flush_cache_` are not touched by write() while a flush is pending.
+    lock.unlock();
+    ROSBAG2_TRACEPOINT(cache_flush_begin, flush_cache_.size());
+    try {
+      write_messages_to_storage(flush_cache_);
+    } catch (const std::exception & e) {
+      ROSBAG2_CPP_LOG_ERROR_STREAM(
+        "Failed to write " << flush_cache_.size() << " cached messages: " << e.what());
+    }
+    ROSBAG2_TRACEPOINT(cache_flush_end, flush_cache_.size());
+    lock.lock();
+
+    flush_cache_.clear();
+    flush_cache_size_bytes_ = 0;
+    update_cache_memory_account();
+    flush_pending_ = false;
+    flush_done_.notify_all();
+  }
+}
+
+bool SequentialWriter::should_split_bagfile(
+  const rosbag2_storage::SerializedBagMessage & message) const
+{
+  if (max_bagfile_size_ != rosbag2_storage::storage_interfaces::MAX_BAGFILE_SIZE_NO_SPLIT &&
+    storage_->get_bagfile_size() > max_bagfile_size_)
+  {
+    return true;
+  }
+
+  if (max_bagfile_messages_ > 0u && current_file_message_count_ >= max_bagfile_messages_) {
+    return true;
+  }
+
+  return max_bagfile_duration_.count() > 0 && current_file_message_count_ > 0u &&
+         std::chrono::nanoseconds(message.time_stamp - current_file_starting_time_) >=
+         max_bagfile_duration_;
+}
+
 void SequentialWriter::finalize_metadata()
 {
   metadata_.bag_size = 0;
+  // The time ranges, topics and sizes of the files are kept up to date while writing.
+  collect_closed_file_sizes();
+  metadata_.files.resize(metadata_.relative_file_paths.size());
 
-  for (const auto & path : metadata_.relative_file_paths) {
-    const auto bag_path = rcpputils::fs::path{path};
+  for (size_t i = 0; i < metadata_.relative_file_paths.size(); ++i) {
+    metadata_.files[i].path = metadata_.relative_file_paths[i];
+    metadata_.files[i].indexed = true;
+    metadata_.bag_size += metadata_.files[i].size;
+  }
+  // Only the storage knows the size of the file it is still writing.
+  if (storage_ && !metadata_.files.empty() && metadata_.files.back().size == 0u) {
+    metadata_.bag_size += storage_->get_bagfile_size();
+  }
 
-    if (bag_path.exists()) {
-      metadata_.bag_size += bag_path.file_size();
-    }
+  // With deferred index creation, a file is only indexed once its storage is closed.
+  if (storage_ && storage_config_.defer_index_creation && !metadata_.files.empty()) {
+    metadata_.files.back().indexed = false;
   }
 
+  metadata_.cache_high_water_mark_bytes = cache_high_water_mark_bytes_;
+
   metadata_.topics_with_message_count.clear();
   metadata_.topics_with_message_count.reserve(topics_names_to_info_.size());
   metadata_.message_count = 0;
 
   for (const auto & topic : topics_names_to_info_) {
-    metadata_.topics_with_message_count.push_back(topic.second);
-    metadata_.message_count += topic.second.message_count;
+    metadata_.topics_with_message_count.push_back(topic.second.info);
+    metadata_.message_count += topic.second.info.message_count;
+  }
+}
+
+void SequentialWriter::write_metadata_checkpoint()
+{
+  // Messages still held in a cache are already counted.
+  for (auto & stripe_writer : stripe_writers_) {
+    stripe_writer->finalize_metadata();
+  }
+  for (auto & group_writer : group_writers_) {
+    group_writer->finalize_metadata();
+  }
+  finalize_metadata();
+  auto metadata = metadata_;
+  merge_child_metadata(metadata);
+  metadata_io_->append_metadata(base_folder_, metadata);
+  last_metadata_checkpoint_ = std::chrono::steady_clock::now();
+}
+
+void SequentialWriter::merge_child_metadata(rosbag2_storage::BagMetadata & metadata) const
+{
+  // Files outside of the bag directory are listed with their absolute path.
+  for (size_t stripe = 1; stripe <= stripe_writers_.size(); ++stripe) {
+    const auto & stripe_writer = *stripe_writers_[stripe - 1];
+    // Files of shards are in the bag directory already.
+    stripe_writer.merge_metadata_into(
+      metadata, stripe_writer.shard_name_.empty() ? stripe_writer.base_folder_ : "", stripe);
+  }
+  for (size_t i = 0; i < group_writers_.size(); ++i) {
+    group_writers_[i]->merge_metadata_into(metadata, topic_groups_[i].name, 0);
+  }
+}
+
+void SequentialWriter::merge_metadata_into(
+  rosbag2_storage::BagMetadata & metadata, const std::string & folder, size_t stripe) const
+{
+  for (auto file : metadata_.files) {
+    if (!folder.empty() && !rcpputils::fs::path(file.path).is_absolute()) {
+      file.path = (rcpputils::fs::path(folder) / file.path).string();
+    }
+    file.stripe = stripe;
+    metadata.relative_file_paths.push_back(file.path);
+    metadata.files.push_back(file);
+  }
+
+  for (const auto & child_topic : metadata_.topics_with_message_count) {
+    const auto topic = std::find_if(
+      metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+      [&child_topic](const rosbag2_storage::TopicInformation & candidate) {
+        return candidate.topic_metadata.name == child_topic.topic_metadata.name;
+      });
+    if (topic != metadata.topics_with_message_count.end()) {
+      topic->message_count += child_topic.message_count;
+      topic->total_size += child_topic.total_size;
+      topic->max_message_size = std::max(topic->max_message_size, child_topic.max_message_size);
+      topic->dropped_message_count += child_topic.dropped_message_count;
+      topic->deduplicated = topic->deduplicated || child_topic.deduplicated;
+      topic->delta_encoded = topic->delta_encoded || child_topic.delta_encoded;
+      rosbag2_storage::merge_histograms(topic->histogram, child_topic.histogram);
+    } else {
+      metadata.topics_with_message_count.push_back(child_topic);
+    }
+  }
+
+  if (metadata_.message_count > 0u) {
+    if (metadata.message_count == 0u) {
+      metadata.starting_time = metadata_.starting_time;
+      metadata.duration = metadata_.duration;
+    } else {
+      const auto ending_time = std::max(
+        metadata.starting_time + metadata.duration,
+        metadata_.starting_time + metadata_.duration);
+      metadata.starting_time = std::min(metadata.starting_time, metadata_.starting_time);
+      metadata.duration = ending_time - metadata.starting_time;
+    }
+    metadata.message_count += metadata_.message_count;
   }
+  metadata.bag_size += metadata_.bag_size;
+  // The caches of all writers are held in memory at the same time.
+  metadata.cache_high_water_mark_bytes += metadata_.cache_high_water_mark_bytes;
 }
 
 }  // namespace writers
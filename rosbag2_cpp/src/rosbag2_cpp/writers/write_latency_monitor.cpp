@@ -0,0 +1,236 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_cpp/writers/write_latency_monitor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rosbag2_cpp
+{
+namespace writers
+{
+
+namespace
+{
+constexpr size_t kMaxReportedTopics = 3;
+
+uint64_t get_serialized_size(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return message.serialized_data ? message.serialized_data->buffer_length : 0u;
+}
+
+std::string format_bytes(uint64_t bytes)
+{
+  static const char * units[] = {"B", "KiB", "MiB", "GiB"};
+  double size = static_cast<double>(bytes);
+  size_t unit = 0;
+  while (size >= 1024 && unit < 3) {
+    size /= 1024;
+    ++unit;
+  }
+  std::stringstream formatted;
+  formatted << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << size << " " << units[unit];
+  return formatted.str();
+}
+
+std::string format_milliseconds(std::chrono::nanoseconds duration)
+{
+  std::stringstream formatted;
+  formatted << std::fixed << std::setprecision(1) <<
+    std::chrono::duration<double, std::milli>(duration).count() << " ms";
+  return formatted.str();
+}
+
+uint64_t get_total_size(const WriteLatencyMonitor::Messages & messages)
+{
+  uint64_t total_size = 0;
+  for (const auto & message : messages) {
+    total_size += get_serialized_size(*message);
+  }
+  return total_size;
+}
+
+std::string format_top_topics(const WriteLatencyMonitor::Messages & messages)
+{
+  std::unordered_map<std::string, uint64_t> bytes_by_topic;
+  for (const auto & message : messages) {
+    bytes_by_topic[message->topic_name] += get_serialized_size(*message);
+  }
+  std::vector<std::pair<std::string, uint64_t>> topics(
+    bytes_by_topic.begin(), bytes_by_topic.end());
+  const auto reported_topics = std::min(topics.size(), kMaxReportedTopics);
+  std::partial_sort(
+    topics.begin(), topics.begin() + reported_topics, topics.end(),
+    [](const std::pair<std::string, uint64_t> & lhs, const std::pair<std::string, uint64_t> & rhs)
+    {
+      return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+    });
+
+  std::stringstream formatted;
+  for (size_t i = 0; i < reported_topics; ++i) {
+    formatted << (i == 0 ? "" : ", ") << topics[i].first << " (" <<
+      format_bytes(topics[i].second) << ")";
+  }
+  return formatted.str();
+}
+}  // namespace
+
+WriteLatencyMonitor::WriteLatencyMonitor(
+  std::chrono::nanoseconds budget,
+  std::chrono::nanoseconds warning_interval,
+  std::chrono::nanoseconds decay_half_life)
+: budget_(budget), warning_interval_(warning_interval), decay_half_life_(decay_half_life)
+{}
+
+std::string WriteLatencyMonitor::record_write(
+  const Messages & messages, std::chrono::nanoseconds duration,
+  std::chrono::steady_clock::time_point now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  decay(now);
+  const auto microseconds =
+    std::chrono::duration_cast<std::chrono::microseconds>(duration + std::chrono::nanoseconds(999));
+  size_t bucket = 0;
+  while (bucket + 1 < kBucketCount && (uint64_t{1} << bucket) < uint64_t(microseconds.count())) {
+    ++bucket;
+  }
+  buckets_[bucket] += 1.0;
+
+  if (duration <= budget_) {
+    return "";
+  }
+  ++slow_write_count_;
+  if (!take_warning(now)) {
+    return "";
+  }
+  std::stringstream warning;
+  warning << "Writing " << messages.size() << " messages (" <<
+    format_bytes(get_total_size(messages)) << ") to the storage took " <<
+    format_milliseconds(duration) << ", over the budget of " << format_milliseconds(budget_) <<
+    ". " << format_recent_writes() << "Topics with the most bytes: " <<
+    format_top_topics(messages) << "." << format_suppressed_warnings();
+  return warning.str();
+}
+
+std::string WriteLatencyMonitor::record_backlog(
+  const Messages & messages, std::chrono::steady_clock::time_point now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  decay(now);
+  if (!take_warning(now)) {
+    return "";
+  }
+  std::stringstream warning;
+  warning << messages.size() << " messages (" << format_bytes(get_total_size(messages)) <<
+    ") are waiting for the storage, which falls behind the incoming messages. " <<
+    format_recent_writes() << "Topics with the most bytes: " << format_top_topics(messages) <<
+    "." << format_suppressed_warnings();
+  return warning.str();
+}
+
+std::chrono::nanoseconds WriteLatencyMonitor::get_percentile(double fraction) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return get_percentile_locked(fraction);
+}
+
+uint64_t WriteLatencyMonitor::get_slow_write_count() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slow_write_count_;
+}
+
+void WriteLatencyMonitor::decay(std::chrono::steady_clock::time_point now)
+{
+  if (last_decay_ == std::chrono::steady_clock::time_point{}) {
+    last_decay_ = now;
+    return;
+  }
+  if (now <= last_decay_ || decay_half_life_.count() <= 0) {
+    return;
+  }
+  const double half_lives = std::chrono::duration<double>(now - last_decay_).count() /
+    std::chrono::duration<double>(decay_half_life_).count();
+  const double factor = std::pow(0.5, half_lives);
+  for (auto & bucket : buckets_) {
+    bucket *= factor;
+  }
+  last_decay_ = now;
+}
+
+std::chrono::nanoseconds WriteLatencyMonitor::get_percentile_locked(double fraction) const
+{
+  double total = 0;
+  for (const auto bucket : buckets_) {
+    total += bucket;
+  }
+  if (total <= 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  // Tolerates the rounding of the decayed counts.
+  const double target = std::min(std::max(fraction, 0.0), 1.0) * total * (1.0 - 1e-9);
+  double cumulative = 0;
+  size_t bucket = 0;
+  for (; bucket + 1 < kBucketCount; ++bucket) {
+    cumulative += buckets_[bucket];
+    if (cumulative >= target && cumulative > 0) {
+      break;
+    }
+  }
+  return std::chrono::microseconds(uint64_t{1} << bucket);
+}
+
+std::string WriteLatencyMonitor::format_recent_writes() const
+{
+  const auto median = get_percentile_locked(0.5);
+  if (median.count() == 0) {
+    return "";
+  }
+  return "Recent writes took up to " + format_milliseconds(median) + " (p50) and " +
+         format_milliseconds(get_percentile_locked(0.99)) + " (p99). ";
+}
+
+bool WriteLatencyMonitor::take_warning(std::chrono::steady_clock::time_point now)
+{
+  if (has_warned_ && now - last_warning_ < warning_interval_) {
+    ++suppressed_warnings_;
+    return false;
+  }
+  has_warned_ = true;
+  last_warning_ = now;
+  return true;
+}
+
+std::string WriteLatencyMonitor::format_suppressed_warnings()
+{
+  if (suppressed_warnings_ == 0) {
+    return "";
+  }
+  std::stringstream formatted;
+  formatted << " " << suppressed_warnings_ <<
+    " similar warnings were suppressed since the last one.";
+  suppressed_warnings_ = 0;
+  return formatted.str();
+}
+
+}  // namespace writers
+}  // namespace rosbag2_cpp
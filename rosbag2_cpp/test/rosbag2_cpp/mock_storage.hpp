@@ -23,6 +23,7 @@
 
 #include "rosbag2_storage/bag_metadata.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_capabilities.hpp"
 #include "rosbag2_storage/storage_filter.hpp"
 #include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
 #include "rosbag2_storage/topic_metadata.hpp"
@@ -30,9 +31,20 @@
 class MockStorage : public rosbag2_storage::storage_interfaces::ReadWriteInterface
 {
 public:
+  MockStorage()
+  {
+    rosbag2_storage::StorageCapabilities capabilities;
+    capabilities.batch_write = true;
+    capabilities.seek = true;
+    capabilities.message_pool = true;
+    ON_CALL(*this, get_capabilities()).WillByDefault(::testing::Return(capabilities));
+  }
+
+  using rosbag2_storage::storage_interfaces::ReadWriteInterface::open;
   MOCK_METHOD2(open, void(const std::string &, rosbag2_storage::storage_interfaces::IOFlag));
   MOCK_METHOD1(create_topic, void(const rosbag2_storage::TopicMetadata &));
   MOCK_METHOD1(remove_topic, void(const rosbag2_storage::TopicMetadata &));
+  MOCK_METHOD2(set_topic_handle, void(const std::string &, rosbag2_storage::TopicHandle));
   MOCK_METHOD0(has_next, bool());
   MOCK_METHOD0(read_next, std::shared_ptr<rosbag2_storage::SerializedBagMessage>());
   MOCK_METHOD1(write, void(std::shared_ptr<const rosbag2_storage::SerializedBagMessage>));
@@ -43,10 +55,27 @@ public:
   MOCK_METHOD0(get_metadata, rosbag2_storage::BagMetadata());
   MOCK_METHOD0(reset_filter, void());
   MOCK_METHOD1(set_filter, void(const rosbag2_storage::StorageFilter &));
+  MOCK_METHOD1(seek, void(const rcutils_time_point_value_t &));
+  MOCK_METHOD1(get_topic_message_count, uint64_t(const std::string &));
+  MOCK_METHOD2(
+    read_topic_message,
+    std::shared_ptr<rosbag2_storage::SerializedBagMessage>(const std::string &, uint64_t));
+  MOCK_METHOD2(
+    find_topic_message, uint64_t(const std::string &, const rcutils_time_point_value_t &));
+  MOCK_METHOD2(
+    read_latest_messages,
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>(
+      const std::vector<std::string> &, const rcutils_time_point_value_t &));
+  MOCK_METHOD0(poll_new_messages, bool());
+  MOCK_METHOD3(
+    slice, std::string(
+      const std::string &, const rcutils_time_point_value_t &,
+      const rcutils_time_point_value_t &));
   MOCK_CONST_METHOD0(get_bagfile_size, uint64_t());
   MOCK_CONST_METHOD0(get_relative_file_path, std::string());
   MOCK_CONST_METHOD0(get_storage_identifier, std::string());
   MOCK_CONST_METHOD0(get_minimum_split_file_size, uint64_t());
+  MOCK_CONST_METHOD0(get_capabilities, rosbag2_storage::StorageCapabilities());
 };
 
 #endif  // ROSBAG2_CPP__MOCK_STORAGE_HPP_
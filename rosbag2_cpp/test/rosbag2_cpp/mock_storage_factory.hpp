@@ -27,6 +27,7 @@
 class MockStorageFactory : public rosbag2_storage::StorageFactoryInterface
 {
 public:
+  using rosbag2_storage::StorageFactoryInterface::open_read_write;
   MOCK_METHOD2(
     open_read_only,
     std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>(
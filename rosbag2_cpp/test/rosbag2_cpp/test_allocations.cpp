@@ -0,0 +1,145 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/converter.hpp"
+#include "rosbag2_cpp/converter_interfaces/serialization_format_converter.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "rosbag2_test_common/allocation_counter.hpp"
+#include "rosbag2_test_common/memory_management.hpp"
+
+#include "test_msgs/message_fixtures.hpp"
+
+#include "mock_converter_factory.hpp"
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+constexpr size_t MESSAGE_COUNT = 1000;
+constexpr size_t WARM_UP_MESSAGE_COUNT = 100;
+// The pool of the converter recycles the message and its buffer, only the control blocks of
+// their shared pointers are allocated.
+constexpr size_t MAX_POOLED_ALLOCATIONS_PER_MESSAGE = 2;
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> make_messages()
+{
+  MemoryManagement memory_management;
+  const auto basic_types_message = get_messages_basic_types()[0];
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  for (size_t i = 0; i < MESSAGE_COUNT; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->time_stamp = static_cast<rcutils_time_point_value_t>(i + 1);
+    message->serialized_data = memory_management.serialize_message(basic_types_message);
+    messages.push_back(message);
+  }
+  return messages;
+}
+
+// Leaves the messages untouched, so only the allocations of the Converter itself are counted.
+class NoOpConverter : public rosbag2_cpp::converter_interfaces::SerializationFormatConverter
+{
+public:
+  void deserialize(
+    std::shared_ptr<const rosbag2_storage::SerializedBagMessage>,
+    const rosidl_message_type_support_t *,
+    std::shared_ptr<rosbag2_cpp::rosbag2_introspection_message_t>) override
+  {}
+
+  void serialize(
+    std::shared_ptr<const rosbag2_cpp::rosbag2_introspection_message_t>,
+    const rosidl_message_type_support_t *,
+    std::shared_ptr<rosbag2_storage::SerializedBagMessage>) override
+  {}
+};
+}  // namespace
+
+// Matchers are not used while counting, as they allocate.
+
+TEST(AllocationsTest, sequential_writer_does_not_allocate_when_writing_to_the_cache) {
+  if (!AllocationCounter::is_supported()) {
+    return;
+  }
+  auto storage_factory = std::make_unique<NiceMock<MockStorageFactory>>();
+  auto storage = std::make_shared<NiceMock<MockStorage>>();
+  ON_CALL(*storage_factory, open_read_write(_, _)).WillByDefault(Return(storage));
+  rosbag2_cpp::writers::SequentialWriter writer(
+    std::move(storage_factory), std::make_shared<StrictMock<MockConverterFactory>>(),
+    std::make_unique<NiceMock<MockMetadataIo>>());
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.uri = "uri";
+  // The storage is a mock, which allocates when called, so the cache is not written.
+  storage_options.max_cache_size = MESSAGE_COUNT + 1;
+  writer.open(storage_options, {"rmw_format", "rmw_format"});
+  writer.create_topic({"topic", "test_msgs/BasicTypes", "rmw_format", ""});
+
+  const auto messages = make_messages();
+  size_t next_message = 0;
+  const auto allocations = count_steady_state_allocations(
+    [&writer, &messages, &next_message]() {writer.write(messages[next_message++]);},
+    WARM_UP_MESSAGE_COUNT, MESSAGE_COUNT - WARM_UP_MESSAGE_COUNT);
+
+  EXPECT_THAT(next_message, Eq(MESSAGE_COUNT));
+  EXPECT_THAT(allocations, Eq(0u));
+}
+
+TEST(AllocationsTest, converter_allocates_only_shared_pointers_for_converted_messages) {
+  if (!AllocationCounter::is_supported()) {
+    return;
+  }
+  auto converter_factory = std::make_shared<StrictMock<MockConverterFactory>>();
+  EXPECT_CALL(*converter_factory, load_deserializer("input_format")).WillOnce(
+    Invoke(
+      [](const std::string &)
+      -> std::unique_ptr<rosbag2_cpp::converter_interfaces::SerializationFormatDeserializer> {
+        return std::make_unique<NoOpConverter>();
+      }));
+  EXPECT_CALL(*converter_factory, load_serializer("output_format")).WillOnce(
+    Invoke(
+      [](const std::string &)
+      -> std::unique_ptr<rosbag2_cpp::converter_interfaces::SerializationFormatSerializer> {
+        return std::make_unique<NoOpConverter>();
+      }));
+  rosbag2_cpp::Converter converter("input_format", "output_format", converter_factory);
+  converter.add_topic("topic", "test_msgs/BasicTypes");
+
+  const auto messages = make_messages();
+  size_t next_message = 0;
+  // The converted messages are released right away, which returns them to the pool.
+  const auto allocations = count_steady_state_allocations(
+    [&converter, &messages, &next_message]() {
+      auto converted_message = converter.convert(messages[next_message++]);
+      ASSERT_TRUE(converted_message != nullptr);
+    },
+    WARM_UP_MESSAGE_COUNT, MESSAGE_COUNT - WARM_UP_MESSAGE_COUNT);
+
+  EXPECT_THAT(next_message, Eq(MESSAGE_COUNT));
+  EXPECT_THAT(
+    allocations,
+    Le(MAX_POOLED_ALLOCATIONS_PER_MESSAGE * (MESSAGE_COUNT - WARM_UP_MESSAGE_COUNT)));
+}
@@ -0,0 +1,190 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/bag_generator.hpp"
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+struct WrittenBag
+{
+  std::vector<rosbag2_storage::TopicMetadata> topics;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  bool closed = false;
+};
+
+class RecordingWriter : public rosbag2_cpp::writer_interfaces::BaseWriterInterface
+{
+public:
+  explicit RecordingWriter(WrittenBag & bag)
+  : bag_(bag) {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {}
+
+  void reset() override
+  {
+    bag_.closed = true;
+  }
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic) override
+  {
+    bag_.topics.push_back(topic);
+  }
+
+  void remove_topic(const rosbag2_storage::TopicMetadata &) override {}
+
+  void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override
+  {
+    bag_.messages.push_back(message);
+  }
+
+private:
+  WrittenBag & bag_;
+};
+
+std::vector<uint8_t> data_of(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::vector<uint8_t>(
+    message.serialized_data->buffer,
+    message.serialized_data->buffer + message.serialized_data->buffer_length);
+}
+}  // namespace
+
+class BagGeneratorTest : public Test
+{
+public:
+  BagGeneratorTest()
+  {
+    spec_.seed = 7;
+    spec_.duration = std::chrono::seconds(2);
+    spec_.start_time = 1000;
+    spec_.topics.push_back({"/fast", "std_msgs/msg/ByteMultiArray", 10.0, 100, 100});
+    spec_.topics.push_back({"/slow", "sensor_msgs/msg/Image", 2.0, 20, 5000});
+  }
+
+  WrittenBag generate(size_t max_threads)
+  {
+    WrittenBag bag;
+    rosbag2_cpp::BagGenerator generator(std::make_unique<RecordingWriter>(bag));
+    EXPECT_THAT(generator.generate(spec_, {}, max_threads), Eq(24u));
+    return bag;
+  }
+
+  rosbag2_cpp::GeneratorSpec spec_;
+};
+
+TEST_F(BagGeneratorTest, writes_the_messages_of_every_topic_in_time_order) {
+  auto bag = generate(1);
+
+  EXPECT_TRUE(bag.closed);
+  ASSERT_THAT(bag.topics, SizeIs(2));
+  EXPECT_THAT(bag.topics[1].name, StrEq("/slow"));
+  EXPECT_THAT(bag.topics[1].type, StrEq("sensor_msgs/msg/Image"));
+  EXPECT_THAT(bag.topics[1].serialization_format, StrEq("cdr"));
+  ASSERT_THAT(bag.messages, SizeIs(24));
+  size_t slow_messages = 0;
+  for (size_t i = 0; i < bag.messages.size(); ++i) {
+    const auto & message = *bag.messages[i];
+    if (i > 0) {
+      EXPECT_THAT(message.time_stamp, Ge(bag.messages[i - 1]->time_stamp));
+    }
+    if (message.topic_name == "/fast") {
+      EXPECT_THAT(message.serialized_data->buffer_length, Eq(100u));
+    } else {
+      EXPECT_THAT(message.serialized_data->buffer_length, AllOf(Ge(20u), Le(5000u)));
+      ++slow_messages;
+    }
+  }
+  EXPECT_THAT(slow_messages, Eq(4u));
+  EXPECT_THAT(bag.messages.front()->time_stamp, Eq(1000));
+  EXPECT_THAT(bag.messages.back()->time_stamp, Eq(1000 + 1900000000));
+}
+
+TEST_F(BagGeneratorTest, messages_are_cdr_serialized_byte_arrays) {
+  auto bag = generate(1);
+
+  const auto data = data_of(*bag.messages.front());
+  const std::vector<uint8_t> header{0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 84, 0, 0, 0};
+  EXPECT_THAT(std::vector<uint8_t>(data.begin(), data.begin() + 16), ContainerEq(header));
+}
+
+TEST_F(BagGeneratorTest, messages_only_depend_on_the_seed) {
+  auto single_threaded = generate(1);
+  auto multi_threaded = generate(4);
+
+  ASSERT_THAT(multi_threaded.messages, SizeIs(single_threaded.messages.size()));
+  for (size_t i = 0; i < single_threaded.messages.size(); ++i) {
+    EXPECT_THAT(
+      multi_threaded.messages[i]->topic_name, StrEq(single_threaded.messages[i]->topic_name));
+    EXPECT_THAT(data_of(*multi_threaded.messages[i]), Eq(data_of(*single_threaded.messages[i])));
+  }
+
+  spec_.seed = 8;
+  auto other_seed = generate(1);
+  EXPECT_THAT(data_of(*other_seed.messages[0]), Ne(data_of(*single_threaded.messages[0])));
+}
+
+TEST(BagGeneratorSpecTest, parses_topics_and_duration) {
+  const auto spec = rosbag2_cpp::BagGenerator::parse_spec(
+    "seed: 42\n"
+    "duration: 1.5\n"
+    "topics:\n"
+    "  - name: /image\n"
+    "    type: sensor_msgs/msg/Image\n"
+    "    rate: 30\n"
+    "    size: 921600\n"
+    "  - name: /bytes\n"
+    "    rate: 0.5\n"
+    "    min_size: 10\n"
+    "    max_size: 20\n");
+
+  EXPECT_THAT(spec.seed, Eq(42u));
+  EXPECT_THAT(spec.duration, Eq(std::chrono::milliseconds(1500)));
+  EXPECT_THAT(spec.start_time, Eq(0));
+  ASSERT_THAT(spec.topics, SizeIs(2));
+  EXPECT_THAT(spec.topics[0].type, StrEq("sensor_msgs/msg/Image"));
+  EXPECT_THAT(spec.topics[0].rate_hz, DoubleEq(30.0));
+  EXPECT_THAT(spec.topics[0].min_size, Eq(921600u));
+  EXPECT_THAT(spec.topics[0].max_size, Eq(921600u));
+  EXPECT_THAT(spec.topics[1].type, StrEq("std_msgs/msg/ByteMultiArray"));
+  EXPECT_THAT(spec.topics[1].min_size, Eq(10u));
+  EXPECT_THAT(spec.topics[1].max_size, Eq(20u));
+}
+
+TEST(BagGeneratorSpecTest, rejects_invalid_specs) {
+  EXPECT_THROW(
+    rosbag2_cpp::BagGenerator::parse_spec("topics: [{name: /a, rate: 1, size: 1}]"),
+    std::invalid_argument);
+  EXPECT_THROW(
+    rosbag2_cpp::BagGenerator::parse_spec("duration: 1\ntopics: [{name: /a, rate: 0, size: 1}]"),
+    std::invalid_argument);
+  EXPECT_THROW(
+    rosbag2_cpp::BagGenerator::parse_spec(
+      "duration: 1\ntopics: [{name: /a, rate: 1, min_size: 2, max_size: 1}]"),
+    std::invalid_argument);
+  EXPECT_THROW(rosbag2_cpp::BagGenerator::parse_spec("duration: 1\ntopics: []"),
+    std::invalid_argument);
+  EXPECT_THROW(rosbag2_cpp::BagGenerator::parse_spec("duration: [1"), std::invalid_argument);
+}
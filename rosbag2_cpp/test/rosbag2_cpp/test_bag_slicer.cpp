@@ -0,0 +1,165 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/bag_slicer.hpp"
+#include "rosbag2_cpp/reindexer.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+rosbag2_storage::FileInformation make_file(
+  const std::string & path, int64_t starting_time_ns, int64_t duration_ns,
+  uint64_t message_count)
+{
+  rosbag2_storage::FileInformation file{};
+  file.path = path;
+  file.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+    std::chrono::nanoseconds(starting_time_ns));
+  file.duration = std::chrono::nanoseconds(duration_ns);
+  file.message_count = message_count;
+  return file;
+}
+}  // namespace
+
+class BagSlicerTest : public TemporaryDirectoryFixture
+{
+public:
+  BagSlicerTest()
+  : storage_factory_(std::make_unique<StrictMock<MockStorageFactory>>()),
+    metadata_io_(std::make_unique<NiceMock<MockMetadataIo>>()),
+    reindex_storage_factory_(std::make_unique<NiceMock<MockStorageFactory>>()),
+    reindex_metadata_io_(std::make_unique<NiceMock<MockMetadataIo>>())
+  {
+    uri_ = (rcpputils::fs::path(temporary_dir_path_) / "bag").string();
+    output_uri_ = (rcpputils::fs::path(temporary_dir_path_) / "slice").string();
+    metadata_.storage_identifier = "sqlite3";
+    metadata_.relative_file_paths = {"bag_0.db3", "bag_1.db3", "bag_2.db3"};
+    metadata_.files = {
+      make_file("bag_0.db3", 0, 10, 5), make_file("bag_1.db3", 20, 10, 5),
+      make_file("bag_2.db3", 40, 10, 5)};
+    ON_CALL(*metadata_io_, metadata_file_exists(uri_)).WillByDefault(Return(true));
+    ON_CALL(*metadata_io_, read_metadata(uri_)).WillByDefault(ReturnPointee(&metadata_));
+
+    // Every bagfile is sliced into a file next to the uri, of one message per file.
+    ON_CALL(*storage_factory_, open_read_only(_, _)).WillByDefault(
+      [this](const std::string & path, const std::string &) {
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        ON_CALL(*storage, slice(_, _, _)).WillByDefault(
+          [this, path](
+            const std::string & slice_uri, const rcutils_time_point_value_t & start_time,
+            const rcutils_time_point_value_t & end_time) {
+            sliced_files_.emplace_back(path, slice_uri);
+            time_ranges_.emplace_back(start_time, end_time);
+            return slice_uri + ".db3";
+          });
+        return storage;
+      });
+    ON_CALL(*reindex_storage_factory_, open_read_only(_, _)).WillByDefault(
+      [](const std::string &, const std::string &) {
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        rosbag2_storage::BagMetadata file_metadata{};
+        file_metadata.message_count = 1;
+        file_metadata.topics_with_message_count = {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 1}};
+        ON_CALL(*storage, get_metadata()).WillByDefault(Return(file_metadata));
+        return storage;
+      });
+    ON_CALL(*reindex_metadata_io_, write_metadata(_, _)).WillByDefault(
+      [this](const std::string & uri, const rosbag2_storage::BagMetadata & metadata) {
+        written_uri_ = uri;
+        written_metadata_ = metadata;
+      });
+  }
+
+  rosbag2_cpp::BagSlicer make_slicer()
+  {
+    return rosbag2_cpp::BagSlicer(
+      std::move(storage_factory_), std::move(metadata_io_),
+      std::make_unique<rosbag2_cpp::Reindexer>(
+        std::move(reindex_storage_factory_), std::move(reindex_metadata_io_)));
+  }
+
+  std::unique_ptr<StrictMock<MockStorageFactory>> storage_factory_;
+  std::unique_ptr<MockMetadataIo> metadata_io_;
+  std::unique_ptr<MockStorageFactory> reindex_storage_factory_;
+  std::unique_ptr<MockMetadataIo> reindex_metadata_io_;
+  std::string uri_;
+  std::string output_uri_;
+  rosbag2_storage::BagMetadata metadata_;
+  std::vector<std::pair<std::string, std::string>> sliced_files_;
+  std::vector<std::pair<rcutils_time_point_value_t, rcutils_time_point_value_t>> time_ranges_;
+  std::string written_uri_;
+  rosbag2_storage::BagMetadata written_metadata_;
+};
+
+TEST_F(BagSlicerTest, bagfiles_in_the_time_range_are_sliced_into_the_output_bag) {
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(2);
+
+  auto slicer = make_slicer();
+  const auto metadata = slicer.slice(uri_, output_uri_, 25, 45);
+
+  const auto input_path = rcpputils::fs::path(uri_);
+  const auto output_path = rcpputils::fs::path(output_uri_);
+  EXPECT_TRUE(output_path.is_directory());
+  EXPECT_THAT(
+    sliced_files_, ElementsAre(
+      Pair((input_path / "bag_1.db3").string(), (output_path / "slice_0").string()),
+      Pair((input_path / "bag_2.db3").string(), (output_path / "slice_1").string())));
+  EXPECT_THAT(time_ranges_, Each(Pair(25, 45)));
+
+  EXPECT_THAT(written_uri_, Eq(output_uri_));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre("slice_0.db3", "slice_1.db3"));
+  EXPECT_THAT(metadata.message_count, Eq(2u));
+  EXPECT_THAT(written_metadata_.message_count, Eq(2u));
+}
+
+TEST_F(BagSlicerTest, bagfiles_without_time_range_in_the_metadata_are_sliced) {
+  metadata_.files.clear();
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(3);
+
+  auto slicer = make_slicer();
+  EXPECT_THAT(slicer.slice(uri_, output_uri_, 25, 45).relative_file_paths, SizeIs(3u));
+}
+
+TEST_F(BagSlicerTest, slice_throws_on_invalid_time_ranges_bags_and_outputs) {
+  auto slicer = make_slicer();
+  EXPECT_THROW(slicer.slice(uri_, output_uri_, 45, 25), std::invalid_argument);
+  // No bagfile has messages in the range.
+  EXPECT_THROW(slicer.slice(uri_, output_uri_, 11, 19), std::runtime_error);
+  EXPECT_FALSE(rcpputils::fs::exists(output_uri_));
+  EXPECT_THROW(slicer.slice(uri_, temporary_dir_path_, 25, 45), std::runtime_error);
+  EXPECT_THROW(slicer.slice(output_uri_, output_uri_ + "2", 25, 45), std::runtime_error);
+  metadata_.compression_mode = "FILE";
+  EXPECT_THROW(slicer.slice(uri_, output_uri_, 25, 45), std::runtime_error);
+}
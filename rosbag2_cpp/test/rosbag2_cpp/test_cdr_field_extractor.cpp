@@ -0,0 +1,134 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "rcpputils/shared_library.hpp"
+
+#include "rosbag2_cpp/cdr_field_extractor.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+
+#include "rosbag2_test_common/memory_management.hpp"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+
+#include "test_msgs/message_fixtures.hpp"
+
+using namespace ::testing;  // NOLINT
+
+class CdrFieldExtractorTest : public Test
+{
+public:
+  const rosidl_message_type_support_t * get_type_support(const std::string & type)
+  {
+    return rosbag2_cpp::get_typesupport(type, "rosidl_typesupport_cpp", library_);
+  }
+
+  rosbag2_test_common::MemoryManagement memory_management_;
+  std::shared_ptr<rcpputils::SharedLibrary> library_;
+};
+
+TEST_F(CdrFieldExtractorTest, extracts_field_of_nested_message) {
+  auto message = get_messages_nested()[0];
+  auto serialized_message = memory_management_.serialize_message(message);
+
+  rosbag2_cpp::CdrFieldExtractor extractor(
+    get_type_support("test_msgs/Nested"), "basic_types_value.int32_value");
+
+  EXPECT_THAT(
+    extractor.get_field_type(), Eq(rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32));
+  EXPECT_THAT(
+    extractor.extract_integer(*serialized_message), Eq(message->basic_types_value.int32_value));
+  EXPECT_THAT(
+    extractor.extract_floating_point(*serialized_message),
+    DoubleEq(message->basic_types_value.int32_value));
+}
+
+TEST_F(CdrFieldExtractorTest, extracts_field_following_sequences) {
+  auto message = get_messages_unbounded_sequences()[1];
+  message->alignment_check = 123456;
+  auto serialized_message = memory_management_.serialize_message(message);
+
+  rosbag2_cpp::CdrFieldExtractor extractor(
+    get_type_support("test_msgs/UnboundedSequences"), "alignment_check");
+
+  EXPECT_THAT(extractor.extract_integer(*serialized_message), Eq(123456));
+}
+
+TEST_F(CdrFieldExtractorTest, extracts_string_and_time) {
+  auto strings_message = get_messages_strings()[2];
+  auto serialized_strings_message = memory_management_.serialize_message(strings_message);
+  rosbag2_cpp::CdrFieldExtractor string_extractor(
+    get_type_support("test_msgs/Strings"), "string_value");
+
+  EXPECT_THAT(
+    string_extractor.extract_string(*serialized_strings_message),
+    StrEq(strings_message->string_value));
+
+  auto builtins_message = get_messages_builtins()[0];
+  auto serialized_builtins_message = memory_management_.serialize_message(builtins_message);
+  rosbag2_cpp::CdrFieldExtractor time_extractor(
+    get_type_support("test_msgs/Builtins"), "time_value");
+
+  EXPECT_THAT(
+    time_extractor.extract_time(*serialized_builtins_message),
+    Eq(
+      builtins_message->time_value.sec * 1000000000LL + builtins_message->time_value.nanosec));
+}
+
+TEST_F(CdrFieldExtractorTest, throws_for_fields_which_cannot_be_extracted) {
+  const auto type_support = get_type_support("test_msgs/Nested");
+
+  EXPECT_THROW(
+    rosbag2_cpp::CdrFieldExtractor(type_support, "basic_types_value.no_such_field"),
+    std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_cpp::CdrFieldExtractor(type_support, "basic_types_value.int32_value.sec"),
+    std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_cpp::CdrFieldExtractor(type_support, "basic_types_value"), std::runtime_error);
+
+  auto serialized_message = memory_management_.serialize_message(get_messages_nested()[0]);
+  rosbag2_cpp::CdrFieldExtractor extractor(type_support, "basic_types_value.int32_value");
+  EXPECT_THROW(extractor.extract_string(*serialized_message), std::runtime_error);
+  EXPECT_THROW(extractor.extract_time(*serialized_message), std::runtime_error);
+
+  serialized_message->buffer_length = 6;
+  EXPECT_THROW(extractor.extract_integer(*serialized_message), std::runtime_error);
+}
+
+TEST_F(CdrFieldExtractorTest, rewrites_time_in_place) {
+  auto message = get_messages_builtins()[0];
+  auto serialized_message = memory_management_.serialize_message(message);
+  const auto type_support = get_type_support("test_msgs/Builtins");
+  rosbag2_cpp::CdrFieldExtractor time_extractor(type_support, "time_value");
+  rosbag2_cpp::CdrFieldExtractor duration_extractor(type_support, "duration_value");
+  const auto duration = duration_extractor.extract_time(*serialized_message);
+
+  time_extractor.rewrite_time(*serialized_message, 1234567890123456789LL);
+
+  EXPECT_THAT(time_extractor.extract_time(*serialized_message), Eq(1234567890123456789LL));
+  EXPECT_THAT(duration_extractor.extract_time(*serialized_message), Eq(duration));
+
+  rosbag2_cpp::CdrFieldExtractor integer_extractor(
+    get_type_support("test_msgs/Nested"), "basic_types_value.int32_value");
+  EXPECT_THROW(integer_extractor.rewrite_time(*serialized_message, 0), std::runtime_error);
+
+  serialized_message->buffer_length = 8;
+  EXPECT_THROW(time_extractor.rewrite_time(*serialized_message, 0), std::runtime_error);
+}
@@ -0,0 +1,167 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/columnar_exporter.hpp"
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "rosbag2_test_common/memory_management.hpp"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+
+#include "test_msgs/message_fixtures.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+class FakeReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  explicit FakeReader(std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages)
+  : messages_(std::move(messages))
+  {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {}
+
+  void reset() override {}
+
+  bool has_next() override
+  {
+    return index_ < messages_.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    return messages_[index_++];
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return {
+      {"/basic_types", "test_msgs/BasicTypes", "cdr", ""},
+      {"/builtins", "test_msgs/Builtins", "cdr", ""},
+      {"/strings", "test_msgs/Strings", "cdr", ""}};
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter &) override {}
+
+  void reset_filter() override {}
+
+private:
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+  size_t index_ = 0;
+  rosbag2_storage::BagMetadata metadata_;
+};
+}  // namespace
+
+class ColumnarExporterTest : public Test
+{
+public:
+  template<typename T>
+  void add_message(const std::string & topic_name, std::shared_ptr<T> message)
+  {
+    auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    bag_message->topic_name = topic_name;
+    bag_message->time_stamp = static_cast<rcutils_time_point_value_t>(messages_.size());
+    bag_message->serialized_data = memory_management_.serialize_message(message);
+    messages_.push_back(bag_message);
+  }
+
+  std::unique_ptr<rosbag2_cpp::Reader> make_reader()
+  {
+    return std::make_unique<rosbag2_cpp::Reader>(std::make_unique<FakeReader>(messages_));
+  }
+
+  rosbag2_test_common::MemoryManagement memory_management_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+};
+
+TEST_F(ColumnarExporterTest, exports_every_field_as_a_column_in_message_order) {
+  const auto basic_types = get_messages_basic_types();
+  const auto builtins = get_messages_builtins()[0];
+  add_message("/basic_types", basic_types[0]);
+  add_message("/builtins", builtins);
+  add_message("/strings", get_messages_strings()[0]);
+  add_message("/basic_types", basic_types[1]);
+  auto reader = make_reader();
+
+  // Batches of one message test handing over several batches to the thread of a topic.
+  rosbag2_cpp::ColumnarExporter exporter(
+    {{"/basic_types", {"float64_value", "int32_value", "bool_value", "uint64_value"}},
+      {"/builtins", {"time_value"}}},
+    1);
+  const auto topics_columns = exporter.export_columns(*reader);
+
+  ASSERT_THAT(topics_columns, SizeIs(2u));
+  const auto & basic_types_columns = topics_columns[0];
+  EXPECT_THAT(basic_types_columns.topic_type, StrEq("test_msgs/BasicTypes"));
+  EXPECT_THAT(basic_types_columns.time_stamps, ElementsAre(0, 3));
+  ASSERT_THAT(basic_types_columns.columns, SizeIs(4u));
+  EXPECT_THAT(
+    basic_types_columns.columns[0].field_type,
+    Eq(rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE));
+  EXPECT_THAT(
+    basic_types_columns.columns[0].floating_points,
+    ElementsAre(basic_types[0]->float64_value, basic_types[1]->float64_value));
+  EXPECT_THAT(
+    basic_types_columns.columns[1].integers,
+    ElementsAre(basic_types[0]->int32_value, basic_types[1]->int32_value));
+  EXPECT_THAT(
+    basic_types_columns.columns[2].integers,
+    ElementsAre(basic_types[0]->bool_value, basic_types[1]->bool_value));
+  EXPECT_THAT(
+    basic_types_columns.columns[3].unsigned_integers,
+    ElementsAre(basic_types[0]->uint64_value, basic_types[1]->uint64_value));
+
+  const auto & builtins_columns = topics_columns[1];
+  EXPECT_THAT(builtins_columns.time_stamps, ElementsAre(1));
+  ASSERT_THAT(builtins_columns.columns, SizeIs(1u));
+  EXPECT_THAT(
+    builtins_columns.columns[0].integers,
+    ElementsAre(builtins->time_value.sec * 1000000000LL + builtins->time_value.nanosec));
+}
+
+TEST_F(ColumnarExporterTest, throws_for_topics_and_fields_which_cannot_be_exported) {
+  add_message("/strings", get_messages_strings()[0]);
+
+  auto reader = make_reader();
+  EXPECT_THROW(
+    rosbag2_cpp::ColumnarExporter(
+      std::vector<rosbag2_cpp::ColumnarTopic>{{"/no_such_topic", {"int32_value"}}})
+    .export_columns(*reader),
+    std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_cpp::ColumnarExporter(
+      std::vector<rosbag2_cpp::ColumnarTopic>{{"/strings", {"string_value"}}})
+    .export_columns(*reader),
+    std::runtime_error);
+}
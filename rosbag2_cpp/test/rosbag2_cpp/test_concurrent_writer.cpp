@@ -0,0 +1,191 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+#include "rosbag2_cpp/writers/concurrent_writer.hpp"
+
+#include "rosbag2_storage/topic_metadata.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+struct FakeWriterState
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  std::vector<std::string> removed_topics;
+  size_t messages_at_removal = 0;
+  std::atomic<int> concurrent_calls{0};
+  std::atomic<bool> had_concurrent_calls{false};
+  std::atomic<bool> fail_writes{false};
+};
+
+class FakeWriter : public rosbag2_cpp::writer_interfaces::BaseWriterInterface
+{
+public:
+  explicit FakeWriter(std::shared_ptr<FakeWriterState> state)
+  : state_(std::move(state))
+  {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {}
+
+  void reset() override {}
+
+  void create_topic(const rosbag2_storage::TopicMetadata &) override {}
+
+  void remove_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override
+  {
+    state_->removed_topics.push_back(topic_with_type.name);
+    state_->messages_at_removal = state_->messages.size();
+  }
+
+  void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override
+  {
+    if (++state_->concurrent_calls > 1) {
+      state_->had_concurrent_calls = true;
+    }
+    if (state_->fail_writes) {
+      --state_->concurrent_calls;
+      throw std::runtime_error("write error");
+    }
+    state_->messages.push_back(std::move(message));
+    --state_->concurrent_calls;
+  }
+
+private:
+  std::shared_ptr<FakeWriterState> state_;
+};
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, rcutils_time_point_value_t time_stamp)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->time_stamp = time_stamp;
+  return message;
+}
+}  // namespace
+
+class ConcurrentWriterTest : public Test
+{
+public:
+  ConcurrentWriterTest()
+  : state_(std::make_shared<FakeWriterState>())
+  {}
+
+  std::unique_ptr<rosbag2_cpp::writers::ConcurrentWriter> make_writer(
+    size_t max_staged_messages,
+    std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1))
+  {
+    auto writer = std::make_unique<rosbag2_cpp::writers::ConcurrentWriter>(
+      std::make_unique<FakeWriter>(state_), max_staged_messages, flush_interval);
+    writer->open({}, {});
+    return writer;
+  }
+
+  std::shared_ptr<FakeWriterState> state_;
+};
+
+TEST_F(ConcurrentWriterTest, messages_of_all_threads_are_written_in_their_order) {
+  const size_t thread_count = 4;
+  const size_t message_count = 2000;
+  auto writer = make_writer(16);
+
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+    threads.emplace_back(
+      [&writer, thread_index, message_count]() {
+        for (size_t i = 0; i < message_count; ++i) {
+          writer->write(
+            make_message(
+              "topic" + std::to_string(thread_index),
+              static_cast<rcutils_time_point_value_t>(i)));
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  writer->reset();
+
+  ASSERT_THAT(state_->messages, SizeIs(thread_count * message_count));
+  EXPECT_FALSE(state_->had_concurrent_calls);
+  std::map<std::string, rcutils_time_point_value_t> next_time_stamps;
+  for (const auto & message : state_->messages) {
+    EXPECT_THAT(message->time_stamp, Eq(next_time_stamps[message->topic_name]++));
+  }
+}
+
+TEST_F(ConcurrentWriterTest, staged_messages_are_written_before_removing_a_topic) {
+  auto writer = make_writer(1000);
+  writer->write(make_message("topic", 1));
+  writer->write(make_message("topic", 2));
+
+  writer->remove_topic({"topic", "type", "rmw", ""});
+
+  EXPECT_THAT(state_->removed_topics, ElementsAre("topic"));
+  EXPECT_THAT(state_->messages_at_removal, Eq(2u));
+}
+
+TEST_F(ConcurrentWriterTest, flush_merges_the_staged_messages_by_time_stamp) {
+  // The storage thread does not write the messages on its own meanwhile.
+  auto writer = make_writer(1000, std::chrono::hours(1));
+  std::thread([&writer]() {writer->write(make_message("topic2", 2));}).join();
+  writer->write(make_message("topic1", 3));
+  writer->write(make_message("topic1", 1));
+
+  writer->flush();
+
+  ASSERT_THAT(state_->messages, SizeIs(3u));
+  EXPECT_THAT(state_->messages[0]->time_stamp, Eq(1));
+  EXPECT_THAT(state_->messages[1]->time_stamp, Eq(2));
+  EXPECT_THAT(state_->messages[2]->time_stamp, Eq(3));
+}
+
+TEST_F(ConcurrentWriterTest, errors_of_the_storage_thread_are_raised_by_the_next_call) {
+  state_->fail_writes = true;
+  auto writer = make_writer(1);
+  writer->write(make_message("topic", 1));
+
+  const auto write_until_error = [&writer]() {
+      for (int i = 0; i < 1000; ++i) {
+        writer->write(make_message("topic", 2));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    };
+
+  EXPECT_THROW(write_until_error(), std::runtime_error);
+  state_->fail_writes = false;
+}
+
+TEST_F(ConcurrentWriterTest, write_throws_if_the_writer_is_not_open) {
+  rosbag2_cpp::writers::ConcurrentWriter writer(std::make_unique<FakeWriter>(state_));
+  EXPECT_THROW(writer.write(make_message("topic", 1)), std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_cpp::writers::ConcurrentWriter(std::make_unique<FakeWriter>(state_), 0),
+    std::invalid_argument);
+}
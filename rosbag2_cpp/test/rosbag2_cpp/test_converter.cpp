@@ -0,0 +1,220 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/converter.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "mock_converter.hpp"
+#include "mock_converter_factory.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+
+// Passes the time stamp through the ROS message, so the converted messages can be told apart.
+std::unique_ptr<NiceMock<MockConverter>> make_time_stamp_converter()
+{
+  auto converter = std::make_unique<NiceMock<MockConverter>>();
+  ON_CALL(*converter, deserialize(_, _, _)).WillByDefault(
+    Invoke(
+      [](
+        std::shared_ptr<const rosbag2_storage::SerializedBagMessage> serialized_message,
+        const rosidl_message_type_support_t *,
+        std::shared_ptr<rosbag2_cpp::rosbag2_introspection_message_t> ros_message) {
+        ros_message->time_stamp = serialized_message->time_stamp;
+      }));
+  ON_CALL(*converter, serialize(_, _, _)).WillByDefault(
+    Invoke(
+      [](
+        std::shared_ptr<const rosbag2_cpp::rosbag2_introspection_message_t> ros_message,
+        const rosidl_message_type_support_t *,
+        std::shared_ptr<rosbag2_storage::SerializedBagMessage> serialized_message) {
+        serialized_message->time_stamp = ros_message->time_stamp;
+      }));
+  return converter;
+}
+
+// Converts whole batches, recording their sizes and the ROS messages deserialized into.
+class BatchConverter : public NiceMock<MockConverter>
+{
+public:
+  void deserialize_batch(
+    const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> &
+    serialized_messages,
+    const std::vector<const rosidl_message_type_support_t *> &,
+    const std::vector<std::shared_ptr<rosbag2_cpp::rosbag2_introspection_message_t>> &
+    ros_messages) override
+  {
+    batch_sizes.push_back(serialized_messages.size());
+    ros_message_counts.push_back(
+      std::set<std::shared_ptr<rosbag2_cpp::rosbag2_introspection_message_t>>(
+        ros_messages.begin(), ros_messages.end()).size());
+    for (size_t i = 0; i < serialized_messages.size(); ++i) {
+      ros_messages[i]->time_stamp = serialized_messages[i]->time_stamp;
+    }
+  }
+
+  void serialize_batch(
+    const std::vector<std::shared_ptr<const rosbag2_cpp::rosbag2_introspection_message_t>> &
+    ros_messages,
+    const std::vector<const rosidl_message_type_support_t *> &,
+    const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> &
+    serialized_messages) override
+  {
+    for (size_t i = 0; i < ros_messages.size(); ++i) {
+      serialized_messages[i]->time_stamp = ros_messages[i]->time_stamp;
+    }
+  }
+
+  std::vector<size_t> batch_sizes;
+  std::vector<size_t> ros_message_counts;
+};
+
+}  // namespace
+
+TEST(ConverterTest, batch_converted_by_conversion_threads_keeps_order) {
+  const size_t conversion_threads = 3;
+  auto converter_factory = std::make_shared<StrictMock<MockConverterFactory>>();
+  // One pair of converters for the calling thread and each conversion thread.
+  EXPECT_CALL(*converter_factory, load_deserializer("input_format"))
+  .Times(conversion_threads + 1)
+  .WillRepeatedly(
+    Invoke(
+      [](const std::string &)
+      -> std::unique_ptr<rosbag2_cpp::converter_interfaces::SerializationFormatDeserializer> {
+        return make_time_stamp_converter();
+      }));
+  EXPECT_CALL(*converter_factory, load_serializer("output_format"))
+  .Times(conversion_threads + 1)
+  .WillRepeatedly(
+    Invoke(
+      [](const std::string &)
+      -> std::unique_ptr<rosbag2_cpp::converter_interfaces::SerializationFormatSerializer> {
+        return make_time_stamp_converter();
+      }));
+
+  rosbag2_cpp::Converter converter(
+    rosbag2_cpp::ConverterOptions{"input_format", "output_format", conversion_threads},
+    converter_factory);
+  converter.add_topic("topic", "test_msgs/BasicTypes");
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  for (int64_t i = 0; i < 100; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "topic";
+    message->time_stamp = i;
+    message->publish_time_stamp = i + 1000;
+    message->serialized_data = rosbag2_storage::make_empty_serialized_message(0);
+    messages.push_back(message);
+  }
+  const auto original_messages = messages;
+
+  converter.convert(messages);
+
+  ASSERT_THAT(messages, SizeIs(original_messages.size()));
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_THAT(messages[i], Ne(original_messages[i]));
+    EXPECT_THAT(messages[i]->time_stamp, Eq(static_cast<int64_t>(i)));
+    EXPECT_THAT(messages[i]->publish_time_stamp, Eq(static_cast<int64_t>(i) + 1000));
+  }
+}
+
+TEST(ConverterTest, batches_are_converted_with_the_batch_functions_of_the_plugins) {
+  auto converter_factory = std::make_shared<StrictMock<MockConverterFactory>>();
+  auto deserializer = std::make_unique<BatchConverter>();
+  auto deserializer_ptr = deserializer.get();
+  EXPECT_CALL(*deserializer_ptr, deserialize(_, _, _)).Times(0);
+  EXPECT_CALL(*converter_factory, load_deserializer("input_format"))
+  .WillOnce(Return(ByMove(std::move(deserializer))));
+  auto serializer = std::make_unique<BatchConverter>();
+  EXPECT_CALL(*serializer, serialize(_, _, _)).Times(0);
+  EXPECT_CALL(*converter_factory, load_serializer("output_format"))
+  .WillOnce(Return(ByMove(std::move(serializer))));
+
+  rosbag2_cpp::Converter converter("input_format", "output_format", converter_factory);
+  converter.add_topic("topic", "test_msgs/BasicTypes");
+  converter.add_topic("other_topic", "test_msgs/BasicTypes");
+
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> messages;
+  for (int64_t i = 0; i < 100; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = i % 2 == 0 ? "topic" : "other_topic";
+    message->time_stamp = i;
+    message->serialized_data = rosbag2_storage::make_empty_serialized_message(0);
+    messages.push_back(message);
+  }
+
+  converter.convert(messages);
+
+  // Every message of a batch is deserialized into a ROS message of its own.
+  EXPECT_THAT(deserializer_ptr->batch_sizes, ElementsAre(64u, 36u));
+  EXPECT_THAT(deserializer_ptr->ros_message_counts, ElementsAre(64u, 36u));
+  ASSERT_THAT(messages, SizeIs(100u));
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_THAT(messages[i]->time_stamp, Eq(static_cast<int64_t>(i)));
+  }
+}
+
+TEST(ConverterTest, only_topics_of_other_formats_than_the_output_format_are_converted) {
+  auto converter_factory = std::make_shared<StrictMock<MockConverterFactory>>();
+  auto deserializer = std::make_unique<BatchConverter>();
+  auto deserializer_ptr = deserializer.get();
+  EXPECT_CALL(*converter_factory, load_deserializer("input_format"))
+  .WillOnce(Return(ByMove(std::move(deserializer))));
+  auto other_deserializer = std::make_unique<BatchConverter>();
+  auto other_deserializer_ptr = other_deserializer.get();
+  EXPECT_CALL(*converter_factory, load_deserializer("other_format"))
+  .WillOnce(Return(ByMove(std::move(other_deserializer))));
+  EXPECT_CALL(*converter_factory, load_serializer("output_format"))
+  .WillOnce(Return(ByMove(std::make_unique<BatchConverter>())));
+
+  rosbag2_cpp::Converter converter("input_format", "output_format", converter_factory);
+  converter.add_topic("converted", "test_msgs/BasicTypes", "input_format");
+  converter.add_topic("other_converted", "test_msgs/BasicTypes", "other_format");
+  converter.add_topic("passed", "test_msgs/BasicTypes", "output_format");
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  for (const auto & topic : {"converted", "converted", "passed", "other_converted"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic;
+    message->time_stamp = static_cast<int64_t>(messages.size());
+    message->serialized_data = rosbag2_storage::make_empty_serialized_message(0);
+    messages.push_back(message);
+  }
+  const auto original_messages = messages;
+
+  converter.convert(messages);
+
+  // A batch is deserialized by the plugin of its format, messages of the output format are kept.
+  EXPECT_THAT(deserializer_ptr->batch_sizes, ElementsAre(2u));
+  EXPECT_THAT(other_deserializer_ptr->batch_sizes, ElementsAre(1u));
+  ASSERT_THAT(messages, SizeIs(4u));
+  EXPECT_THAT(messages[0], Ne(original_messages[0]));
+  EXPECT_THAT(messages[2], Eq(original_messages[2]));
+  EXPECT_THAT(messages[3], Ne(original_messages[3]));
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_THAT(messages[i]->time_stamp, Eq(static_cast<int64_t>(i)));
+  }
+  const auto passed_message = converter.convert(original_messages[2]);
+  EXPECT_THAT(passed_message->serialized_data, Eq(original_messages[2]->serialized_data));
+}
@@ -0,0 +1,304 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/dataset_exporter.hpp"
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+// Returns the messages of a bag which pass the topics and time range of its filter.
+class FakeReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  FakeReader(
+    const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages,
+    const rosbag2_storage::BagMetadata & metadata)
+  : messages_(messages), metadata_(metadata)
+  {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {}
+
+  void reset() override {}
+
+  bool has_next() override
+  {
+    while (index_ < messages_.size() && !is_selected(*messages_[index_])) {
+      ++index_;
+    }
+    return index_ < messages_.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    if (!has_next()) {
+      throw std::runtime_error("There are no more messages to read.");
+    }
+    return messages_[index_++];
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return {};
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    storage_filter_ = storage_filter;
+    index_ = 0;
+  }
+
+  void reset_filter() override
+  {
+    set_filter({});
+  }
+
+private:
+  bool is_selected(const rosbag2_storage::SerializedBagMessage & message) const
+  {
+    const auto & topics = storage_filter_.topics;
+    return (topics.empty() ||
+           std::find(topics.begin(), topics.end(), message.topic_name) != topics.end()) &&
+           (storage_filter_.start_time == 0 || message.time_stamp >= storage_filter_.start_time) &&
+           (storage_filter_.end_time == 0 || message.time_stamp <= storage_filter_.end_time);
+  }
+
+  const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages_;
+  const rosbag2_storage::BagMetadata & metadata_;
+  rosbag2_storage::StorageFilter storage_filter_{};
+  size_t index_ = 0;
+};
+}  // namespace
+
+class DatasetExporterTest : public TemporaryDirectoryFixture
+{
+public:
+  DatasetExporterTest()
+  {
+    // A camera every 10 ns from 1000 ns, a lidar 2 ns after it and odometry every 5 ns.
+    for (rcutils_time_point_value_t time_stamp = 1000; time_stamp < 1500; ++time_stamp) {
+      if (time_stamp % 10 == 0) {
+        add_message("/camera/image", time_stamp);
+      }
+      if (time_stamp % 10 == 2) {
+        add_message("/lidar", time_stamp);
+      }
+      if (time_stamp % 5 == 0) {
+        add_message("/odom", time_stamp);
+      }
+    }
+    metadata_.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::nanoseconds(1000));
+    metadata_.duration = std::chrono::nanoseconds(495);
+    metadata_.message_count = messages_.size();
+    for (const auto & topic : {"/camera/image", "/lidar", "/odom"}) {
+      rosbag2_storage::TopicInformation topic_information;
+      topic_information.topic_metadata = {topic, "test_msgs/msg/BasicTypes", "cdr", ""};
+      metadata_.topics_with_message_count.push_back(topic_information);
+    }
+  }
+
+  void add_message(const std::string & topic_name, rcutils_time_point_value_t time_stamp)
+  {
+    const auto data = topic_name + ":" + std::to_string(time_stamp);
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_name;
+    message->time_stamp = time_stamp;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    messages_.push_back(message);
+  }
+
+  rosbag2_cpp::DatasetExporter make_exporter(
+    const std::vector<std::string> & topics, rosbag2_cpp::DatasetShardFormat format,
+    size_t samples_per_shard)
+  {
+    rosbag2_cpp::DatasetExportOptions options;
+    options.synchronization.topics = topics;
+    options.synchronization.slop = 3;
+    options.format = format;
+    options.samples_per_shard = samples_per_shard;
+    options.max_threads = 3;
+    options.partition_count = 7;
+    return rosbag2_cpp::DatasetExporter(
+      options, [this]() {return std::make_unique<FakeReader>(messages_, metadata_);});
+  }
+
+  rosbag2_cpp::DatasetExportResult export_shards(const rosbag2_cpp::DatasetExporter & exporter)
+  {
+    return exporter.export_shards(
+      {"uri", "storage_id"}, {"cdr", "cdr"}, temporary_dir_path_ + "/dataset");
+  }
+
+  static std::string read_file(const std::string & path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  // Names and contents of the files of a tar archive.
+  static std::vector<std::pair<std::string, std::string>> read_tar(const std::string & path)
+  {
+    const auto archive = read_file(path);
+    std::vector<std::pair<std::string, std::string>> files;
+    size_t offset = 0;
+    while (offset + 512 <= archive.size() && archive[offset] != '\0') {
+      const auto name = std::string(archive.c_str() + offset);
+      const auto size = std::strtoull(archive.substr(offset + 124, 12).c_str(), nullptr, 8);
+      files.emplace_back(name, archive.substr(offset + 512, size));
+      offset += 512 + (size + 511) / 512 * 512;
+    }
+    EXPECT_THAT(archive.size(), Eq(offset + 1024));
+    return files;
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+  rosbag2_storage::BagMetadata metadata_{};
+};
+
+TEST_F(DatasetExporterTest, constructor_throws_on_invalid_options) {
+  EXPECT_THROW(
+    make_exporter({}, rosbag2_cpp::DatasetShardFormat::WEBDATASET, 10), std::invalid_argument);
+  EXPECT_THROW(
+    make_exporter({"/lidar", "/lidar"}, rosbag2_cpp::DatasetShardFormat::WEBDATASET, 10),
+    std::invalid_argument);
+  EXPECT_THROW(
+    make_exporter({"/lidar"}, rosbag2_cpp::DatasetShardFormat::WEBDATASET, 0),
+    std::invalid_argument);
+}
+
+TEST_F(DatasetExporterTest, export_throws_if_topic_is_not_in_bag) {
+  auto exporter = make_exporter({"/imu"}, rosbag2_cpp::DatasetShardFormat::WEBDATASET, 10);
+
+  EXPECT_THROW(export_shards(exporter), std::runtime_error);
+}
+
+TEST_F(DatasetExporterTest, single_topic_makes_every_message_a_sample) {
+  auto exporter = make_exporter({"/lidar"}, rosbag2_cpp::DatasetShardFormat::WEBDATASET, 20);
+
+  const auto result = export_shards(exporter);
+
+  EXPECT_THAT(result.sample_count, Eq(50u));
+  ASSERT_THAT(result.shard_paths, SizeIs(3));
+  EXPECT_THAT(result.shard_paths[0], EndsWith("dataset/shard-000000.tar"));
+  EXPECT_THAT(result.shard_paths[2], EndsWith("dataset/shard-000002.tar"));
+  std::vector<std::string> contents;
+  for (size_t i = 0; i < result.shard_paths.size(); ++i) {
+    const auto files = read_tar(result.shard_paths[i]);
+    // A file of the message and one of its time stamp per sample.
+    EXPECT_THAT(files, SizeIs(i < 2 ? 40u : 20u));
+    for (const auto & file : files) {
+      if (file.first.find(".lidar.cdr") != std::string::npos) {
+        contents.push_back(file.second);
+      }
+    }
+  }
+  std::sort(contents.begin(), contents.end());
+  ASSERT_THAT(contents, SizeIs(50));
+  EXPECT_THAT(contents.front(), StrEq("/lidar:1002"));
+  EXPECT_THAT(contents.back(), StrEq("/lidar:1492"));
+}
+
+TEST_F(DatasetExporterTest, webdataset_samples_hold_synchronized_message_of_every_topic) {
+  auto exporter = make_exporter(
+    {"/camera/image", "/lidar"}, rosbag2_cpp::DatasetShardFormat::WEBDATASET, 8);
+
+  const auto result = export_shards(exporter);
+
+  // Every camera image has its lidar scan, also where partitions meet.
+  EXPECT_THAT(result.sample_count, Eq(50u));
+  ASSERT_THAT(result.shard_paths, SizeIs(7));
+  std::vector<std::string> json_files;
+  for (size_t i = 0; i < result.shard_paths.size(); ++i) {
+    const auto files = read_tar(result.shard_paths[i]);
+    ASSERT_THAT(files, SizeIs(i < 6 ? 24u : 6u));
+    for (size_t j = 0; j < files.size(); j += 3) {
+      const auto key = files[j].first.substr(0, files[j].first.find('.'));
+      EXPECT_THAT(files[j].first, StrEq(key + ".camera__image.cdr"));
+      EXPECT_THAT(files[j + 1].first, StrEq(key + ".lidar.cdr"));
+      EXPECT_THAT(files[j + 2].first, StrEq(key + ".json"));
+      const auto time_stamp = files[j].second.substr(files[j].second.find(':') + 1);
+      EXPECT_THAT(
+        files[j + 1].second,
+        StrEq("/lidar:" + std::to_string(std::stoll(time_stamp) + 2)));
+      json_files.push_back(files[j + 2].second);
+    }
+  }
+  std::sort(json_files.begin(), json_files.end());
+  EXPECT_THAT(
+    json_files.front(), StrEq(R"({"time_stamps":{"/camera/image":1000,"/lidar":1002}})"));
+  EXPECT_THAT(
+    std::adjacent_find(json_files.begin(), json_files.end()) == json_files.end(), IsTrue());
+}
+
+TEST_F(DatasetExporterTest, tfrecord_shards_hold_a_record_per_sample) {
+  auto exporter = make_exporter(
+    {"/odom", "/camera/image"}, rosbag2_cpp::DatasetShardFormat::TFRECORD, 16);
+
+  const auto result = export_shards(exporter);
+
+  EXPECT_THAT(result.sample_count, Eq(50u));
+  ASSERT_THAT(result.shard_paths, SizeIs(4));
+  EXPECT_THAT(result.shard_paths[0], EndsWith("dataset/shard-000000.tfrecord"));
+  size_t record_count = 0;
+  for (const auto & shard_path : result.shard_paths) {
+    const auto shard = read_file(shard_path);
+    size_t offset = 0;
+    while (offset < shard.size()) {
+      uint64_t length = 0;
+      for (size_t i = 0; i < 8; ++i) {
+        length |= static_cast<uint64_t>(static_cast<uint8_t>(shard[offset + i])) << (8 * i);
+      }
+      // Length, its checksum, the example and its checksum.
+      const auto example = shard.substr(offset + 12, length);
+      EXPECT_THAT(example, HasSubstr("/odom/time_stamp"));
+      EXPECT_THAT(example, HasSubstr("/camera/image/time_stamp"));
+      EXPECT_THAT(example, HasSubstr("/camera/image:"));
+      offset += 12 + length + 4;
+      ++record_count;
+    }
+    EXPECT_THAT(offset, Eq(shard.size()));
+  }
+  EXPECT_THAT(record_count, Eq(50u));
+}
@@ -0,0 +1,131 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/readers/deduplicated_message_expander.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "mock_storage.hpp"
+
+using namespace ::testing;  // NOLINT
+using rosbag2_cpp::readers::DeduplicatedMessageExpander;
+
+namespace
+{
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, const std::string & data, rcutils_time_point_value_t time_stamp)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->time_stamp = time_stamp;
+  if (data.empty()) {
+    message->serialized_data = rosbag2_storage::make_empty_serialized_message(1);
+    message->serialized_data->buffer_length = 0;
+  } else {
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  }
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+
+rosbag2_storage::BagMetadata make_metadata()
+{
+  rosbag2_storage::BagMetadata metadata;
+  rosbag2_storage::TopicInformation map;
+  map.topic_metadata = {"/map", "nav_msgs/OccupancyGrid", "cdr", ""};
+  map.deduplicated = true;
+  rosbag2_storage::TopicInformation scan;
+  scan.topic_metadata = {"/scan", "sensor_msgs/LaserScan", "cdr", ""};
+  metadata.topics_with_message_count = {map, scan};
+  return metadata;
+}
+}  // namespace
+
+TEST(DeduplicatedMessageExpanderTest, references_are_given_the_data_of_the_previous_message) {
+  DeduplicatedMessageExpander expander(
+    make_metadata(), []() -> std::shared_ptr<MockStorage> {
+      ADD_FAILURE() << "The file should not be opened again.";
+      return nullptr;
+    });
+  EXPECT_TRUE(expander.has_deduplicated_topics());
+
+  auto map = make_message("/map", "the map", 1);
+  expander.expand(*map);
+  auto reference = make_message("/map", "", 2);
+  expander.expand(*reference);
+  EXPECT_THAT(get_data(*reference), Eq("the map"));
+
+  // Empty messages of other topics are no references.
+  auto scan = make_message("/scan", "", 3);
+  expander.expand(*scan);
+  EXPECT_THAT(scan->serialized_data->buffer_length, Eq(0u));
+
+  auto updated_map = make_message("/map", "the new map", 4);
+  expander.expand(*updated_map);
+  auto updated_reference = make_message("/map", "", 5);
+  expander.expand(*updated_reference);
+  EXPECT_THAT(get_data(*updated_reference), Eq("the new map"));
+}
+
+TEST(DeduplicatedMessageExpanderTest, data_read_before_reset_is_read_from_the_file_again) {
+  auto storage = std::make_shared<NiceMock<MockStorage>>();
+  rosbag2_storage::StorageFilter lookup_filter;
+  EXPECT_CALL(*storage, set_filter(_)).WillOnce(SaveArg<0>(&lookup_filter));
+  EXPECT_CALL(*storage, has_next()).WillOnce(Return(true)).WillOnce(Return(true))
+  .WillOnce(Return(false));
+  EXPECT_CALL(*storage, read_next())
+  .WillOnce(Return(make_message("/map", "the map", 1)))
+  .WillOnce(Return(make_message("/map", "", 2)));
+  int opened_files = 0;
+  DeduplicatedMessageExpander expander(
+    make_metadata(), [storage, &opened_files]() {
+      ++opened_files;
+      return storage;
+    });
+
+  auto map = make_message("/map", "another map", 1);
+  expander.expand(*map);
+  expander.reset();
+  auto reference = make_message("/map", "", 3);
+  expander.expand(*reference);
+  EXPECT_THAT(get_data(*reference), Eq("the map"));
+  EXPECT_THAT(lookup_filter.topics, ElementsAre("/map"));
+  EXPECT_THAT(lookup_filter.end_time, Eq(3));
+
+  // The data read from the file is kept for the next references.
+  auto next_reference = make_message("/map", "", 4);
+  expander.expand(*next_reference);
+  EXPECT_THAT(get_data(*next_reference), Eq("the map"));
+  EXPECT_THAT(opened_files, Eq(1));
+}
+
+TEST(DeduplicatedMessageExpanderTest, bags_without_deduplicated_topics_need_no_expanding) {
+  auto metadata = make_metadata();
+  metadata.topics_with_message_count[0].deduplicated = false;
+  DeduplicatedMessageExpander expander(metadata, []() {return nullptr;});
+  EXPECT_FALSE(expander.has_deduplicated_topics());
+}
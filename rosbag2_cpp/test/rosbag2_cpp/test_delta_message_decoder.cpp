@@ -0,0 +1,132 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "mock_storage.hpp"
+
+using namespace ::testing;  // NOLINT
+using rosbag2_cpp::readers::DeltaMessageDecoder;
+
+namespace
+{
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, const std::string & data, rcutils_time_point_value_t time_stamp)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->time_stamp = time_stamp;
+  message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+
+rosbag2_storage::BagMetadata make_metadata()
+{
+  rosbag2_storage::BagMetadata metadata;
+  rosbag2_storage::TopicInformation costmap;
+  costmap.topic_metadata = {"/costmap", "nav_msgs/OccupancyGrid", "cdr", ""};
+  costmap.delta_encoded = true;
+  rosbag2_storage::TopicInformation scan;
+  scan.topic_metadata = {"/scan", "sensor_msgs/LaserScan", "cdr", ""};
+  metadata.topics_with_message_count = {costmap, scan};
+  return metadata;
+}
+
+// The messages of the costmap as stored, each changing one more cell of the first.
+DeltaMessageDecoder::Messages make_stored_messages()
+{
+  rosbag2_cpp::writers::MessageDeltaEncoder encoder({"/costmap"}, 100);
+  DeltaMessageDecoder::Messages messages;
+  std::string grid(1000, '\0');
+  for (rcutils_time_point_value_t time_stamp = 1; time_stamp <= 4; ++time_stamp) {
+    grid[static_cast<size_t>(time_stamp) * 100] = 'x';
+    messages.push_back(encoder.encode(*make_message("/costmap", grid, time_stamp)));
+  }
+  return messages;
+}
+}  // namespace
+
+TEST(DeltaMessageDecoderTest, deltas_read_after_seeking_are_decoded_from_the_stored_messages) {
+  const auto stored_messages = make_stored_messages();
+  std::vector<rcutils_time_point_value_t> end_times;
+  DeltaMessageDecoder decoder(
+    make_metadata(),
+    [&stored_messages, &end_times](
+      const std::string & topic_name, rcutils_time_point_value_t end_time) {
+      EXPECT_THAT(topic_name, Eq("/costmap"));
+      end_times.push_back(end_time);
+      DeltaMessageDecoder::Messages messages;
+      for (const auto & message : stored_messages) {
+        if (message->time_stamp <= end_time) {
+          messages.push_back(std::make_shared<rosbag2_storage::SerializedBagMessage>(*message));
+        }
+      }
+      return messages;
+    });
+  EXPECT_TRUE(decoder.has_delta_encoded_topics());
+
+  // Reading starts at the third message, which was encoded from the second.
+  auto third = std::make_shared<rosbag2_storage::SerializedBagMessage>(*stored_messages[2]);
+  decoder.decode(*third);
+  std::string expected_grid(1000, '\0');
+  expected_grid[100] = expected_grid[200] = expected_grid[300] = 'x';
+  EXPECT_THAT(get_data(*third), Eq(expected_grid));
+  EXPECT_THAT(end_times, ElementsAre(2));
+
+  auto fourth = std::make_shared<rosbag2_storage::SerializedBagMessage>(*stored_messages[3]);
+  decoder.decode(*fourth);
+  expected_grid[400] = 'x';
+  EXPECT_THAT(get_data(*fourth), Eq(expected_grid));
+  EXPECT_THAT(end_times, SizeIs(1u));
+}
+
+TEST(DeltaMessageDecoderTest, deltas_whose_previous_message_is_missing_cannot_be_decoded) {
+  const auto stored_messages = make_stored_messages();
+  DeltaMessageDecoder decoder(
+    make_metadata(), [](const std::string &, rcutils_time_point_value_t) {
+      return DeltaMessageDecoder::Messages{};
+    });
+  auto delta = std::make_shared<rosbag2_storage::SerializedBagMessage>(*stored_messages[1]);
+  EXPECT_THROW(decoder.decode(*delta), std::runtime_error);
+}
+
+TEST(DeltaMessageDecoderTest, messages_are_read_up_to_the_end_time_of_the_topic) {
+  NiceMock<MockStorage> storage;
+  rosbag2_storage::StorageFilter filter;
+  EXPECT_CALL(storage, set_filter(_)).WillOnce(SaveArg<0>(&filter));
+  EXPECT_CALL(storage, has_next()).WillOnce(Return(true)).WillOnce(Return(false));
+  EXPECT_CALL(storage, read_next()).WillOnce(Return(make_message("/costmap", "data", 1)));
+
+  const auto messages = DeltaMessageDecoder::read_stored_messages(storage, "/costmap", 5);
+  EXPECT_THAT(messages, SizeIs(1u));
+  EXPECT_THAT(filter.topics, ElementsAre("/costmap"));
+  EXPECT_THAT(filter.end_time, Eq(5));
+}
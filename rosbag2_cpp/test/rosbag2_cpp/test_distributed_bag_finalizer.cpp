@@ -0,0 +1,131 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/distributed_bag_finalizer.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/metadata_io.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+std::chrono::time_point<std::chrono::high_resolution_clock> time_point(int64_t nanoseconds)
+{
+  return std::chrono::time_point<std::chrono::high_resolution_clock>(
+    std::chrono::nanoseconds(nanoseconds));
+}
+}  // namespace
+
+class DistributedBagFinalizerTest : public TemporaryDirectoryFixture
+{
+public:
+  // Writes the metadata of the bag of a host, with one file per topic.
+  void write_host_bag(
+    const std::string & host_folder, const std::string & bag_id,
+    const std::vector<std::string> & topics, int64_t starting_time_ns, int64_t duration_ns)
+  {
+    const auto host_uri = rcpputils::fs::path(temporary_dir_path_) / host_folder;
+    ASSERT_TRUE(rcpputils::fs::create_directories(host_uri));
+    rosbag2_storage::BagMetadata metadata{};
+    metadata.storage_identifier = "sqlite3";
+    metadata.bag_id = bag_id;
+    metadata.clock_offset = std::chrono::nanoseconds(250);
+    metadata.starting_time = time_point(starting_time_ns);
+    metadata.duration = std::chrono::nanoseconds(duration_ns);
+    metadata.message_count = 0;
+    for (size_t i = 0; i < topics.size(); ++i) {
+      const auto file_name = host_folder + "_" + std::to_string(i) + ".db3";
+      rosbag2_storage::FileInformation file{file_name, true};
+      file.starting_time = metadata.starting_time;
+      file.duration = metadata.duration;
+      file.message_count = 10;
+      metadata.relative_file_paths.push_back(file_name);
+      metadata.files.push_back(file);
+      metadata.topics_with_message_count.push_back({{topics[i], "type", "cdr", ""}, 10, 100, 20});
+      metadata.message_count += 10;
+    }
+    metadata.bag_size = 1000;
+    metadata_io_.write_metadata(host_uri.string(), metadata);
+  }
+
+  rosbag2_storage::MetadataIo metadata_io_{};
+};
+
+TEST_F(DistributedBagFinalizerTest, metadata_lists_files_of_all_hosts_as_stripes)
+{
+  write_host_bag("host_a", "run_1", {"/camera_front", "/tf"}, 1000, 500);
+  write_host_bag("host_b", "run_1", {"/camera_rear", "/tf"}, 800, 400);
+
+  rosbag2_cpp::DistributedBagFinalizer finalizer;
+  finalizer.finalize(temporary_dir_path_, {"host_a", "host_b"});
+
+  ASSERT_TRUE(metadata_io_.metadata_file_exists(temporary_dir_path_));
+  const auto read_metadata = metadata_io_.read_metadata(temporary_dir_path_);
+  EXPECT_THAT(read_metadata.bag_id, Eq("run_1"));
+  EXPECT_THAT(read_metadata.clock_offset, Eq(std::chrono::nanoseconds(0)));
+  EXPECT_THAT(read_metadata.storage_identifier, Eq("sqlite3"));
+  const auto host_a_file = (rcpputils::fs::path("host_a") / "host_a_0.db3").string();
+  const auto host_b_file = (rcpputils::fs::path("host_b") / "host_b_1.db3").string();
+  ASSERT_THAT(read_metadata.relative_file_paths, SizeIs(4u));
+  EXPECT_THAT(read_metadata.relative_file_paths[0], Eq(host_a_file));
+  EXPECT_THAT(read_metadata.relative_file_paths[3], Eq(host_b_file));
+  ASSERT_THAT(read_metadata.files, SizeIs(4u));
+  EXPECT_THAT(read_metadata.files[0].stripe, Eq(1u));
+  EXPECT_THAT(read_metadata.files[3].stripe, Eq(2u));
+  EXPECT_THAT(read_metadata.message_count, Eq(40u));
+  EXPECT_THAT(read_metadata.starting_time, Eq(time_point(800)));
+  EXPECT_THAT(read_metadata.duration, Eq(std::chrono::nanoseconds(700)));
+
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(3u));
+  const auto tf = std::find_if(
+    read_metadata.topics_with_message_count.begin(),
+    read_metadata.topics_with_message_count.end(),
+    [](const rosbag2_storage::TopicInformation & topic) {
+      return topic.topic_metadata.name == "/tf";
+    });
+  ASSERT_NE(tf, read_metadata.topics_with_message_count.end());
+  EXPECT_THAT(tf->message_count, Eq(20u));
+  EXPECT_THAT(tf->total_size, Eq(200u));
+}
+
+TEST_F(DistributedBagFinalizerTest, bags_of_other_recordings_are_not_merged)
+{
+  write_host_bag("host_a", "run_1", {"/tf"}, 1000, 500);
+  write_host_bag("host_b", "run_2", {"/tf"}, 1000, 500);
+  write_host_bag("host_c", "", {"/tf"}, 1000, 500);
+
+  rosbag2_cpp::DistributedBagFinalizer finalizer;
+  EXPECT_THROW(
+    finalizer.finalize(temporary_dir_path_, {"host_a", "host_b"}), std::runtime_error);
+  EXPECT_THROW(finalizer.finalize(temporary_dir_path_, {"host_c"}), std::runtime_error);
+  EXPECT_THROW(
+    finalizer.finalize(temporary_dir_path_, {"host_a", "host_d"}), std::runtime_error);
+  EXPECT_THROW(finalizer.finalize(temporary_dir_path_, {}), std::invalid_argument);
+  EXPECT_FALSE(metadata_io_.metadata_file_exists(temporary_dir_path_));
+}
@@ -175,3 +175,39 @@ TEST_F(TemporaryDirectoryFixture, read_metadata_makes_appropriate_call_to_metada
   EXPECT_EQ(read_metadata.compression_format, "zstd");
   EXPECT_EQ(read_metadata.compression_mode, "FILE");
 }
+
+TEST(InfoTest, timeline_aligns_the_histograms_of_topics_to_a_common_grid) {
+  using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+  const std::chrono::nanoseconds bucket_duration{1 << 24};
+  rosbag2_storage::BagMetadata metadata;
+  rosbag2_storage::TopicInformation fine_topic{{"fine", "type", "rmw", ""}, 4};
+  fine_topic.histogram.starting_time = TimePoint(bucket_duration * 3);
+  fine_topic.histogram.bucket_duration = bucket_duration;
+  fine_topic.histogram.message_counts = {1, 1, 2};
+  fine_topic.histogram.sizes = {10, 10, 20};
+  rosbag2_storage::TopicInformation coarse_topic{{"coarse", "type", "rmw", ""}, 1};
+  coarse_topic.histogram.starting_time = TimePoint(bucket_duration * 8);
+  coarse_topic.histogram.bucket_duration = bucket_duration * 2;
+  coarse_topic.histogram.message_counts = {1};
+  coarse_topic.histogram.sizes = {5};
+  // Bags recorded by older versions have no histograms.
+  rosbag2_storage::TopicInformation old_topic{{"old", "type", "rmw", ""}, 7};
+  metadata.topics_with_message_count = {fine_topic, coarse_topic, old_topic};
+
+  rosbag2_cpp::Info info;
+  auto timeline = info.get_timeline(metadata, 0);
+  EXPECT_EQ(timeline.starting_time, TimePoint(bucket_duration * 2));
+  EXPECT_EQ(timeline.bucket_duration, bucket_duration * 2);
+  ASSERT_THAT(timeline.topics, SizeIs(3u));
+  EXPECT_EQ(timeline.topics[0].name, "fine");
+  EXPECT_THAT(timeline.topics[0].message_counts, ElementsAre(1u, 3u, 0u, 0u));
+  EXPECT_THAT(timeline.topics[0].sizes, ElementsAre(10u, 30u, 0u, 0u));
+  EXPECT_THAT(timeline.topics[1].message_counts, ElementsAre(0u, 0u, 0u, 1u));
+  EXPECT_THAT(timeline.topics[2].message_counts, ElementsAre(0u, 0u, 0u, 0u));
+
+  timeline = info.get_timeline(metadata, 2);
+  EXPECT_EQ(timeline.starting_time, TimePoint(std::chrono::nanoseconds(0)));
+  EXPECT_EQ(timeline.bucket_duration, bucket_duration * 8);
+  EXPECT_THAT(timeline.topics[0].message_counts, ElementsAre(4u, 0u));
+  EXPECT_THAT(timeline.topics[1].message_counts, ElementsAre(0u, 1u));
+}
@@ -0,0 +1,90 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "rosbag2_cpp/memory_budget.hpp"
+
+using namespace ::testing;  // NOLINT
+
+using rosbag2_cpp::MemoryBudget;
+
+TEST(MemoryBudgetTest, usage_sums_the_accounts_of_every_stage) {
+  MemoryBudget budget(1000);
+  auto cache = budget.open_account("writer cache");
+  auto other_cache = budget.open_account("writer cache");
+  auto queue = budget.open_account("player queue");
+
+  cache->allocate(300);
+  other_cache->set_allocated(200);
+  queue->allocate(150);
+  queue->release(100);
+
+  auto usage = budget.get_usage();
+  EXPECT_THAT(usage.max_bytes, Eq(1000u));
+  EXPECT_THAT(usage.bytes, Eq(550u));
+  EXPECT_THAT(usage.peak_bytes, Eq(650u));
+  EXPECT_THAT(usage.stages.at("writer cache").bytes, Eq(500u));
+  EXPECT_THAT(usage.stages.at("player queue").bytes, Eq(50u));
+  EXPECT_THAT(usage.stages.at("player queue").peak_bytes, Eq(150u));
+
+  cache.reset();
+  usage = budget.get_usage();
+  EXPECT_THAT(usage.bytes, Eq(250u));
+  EXPECT_THAT(usage.stages.at("writer cache").bytes, Eq(200u));
+}
+
+TEST(MemoryBudgetTest, budget_is_exhausted_once_the_stages_hold_all_of_it) {
+  MemoryBudget budget(1000);
+  auto cache = budget.open_account("writer cache");
+  auto queue = budget.open_account("player queue");
+
+  cache->allocate(600);
+  EXPECT_FALSE(queue->is_budget_exhausted());
+  EXPECT_THAT(queue->get_available_bytes(), Eq(400u));
+
+  queue->allocate(500);
+  EXPECT_TRUE(cache->is_budget_exhausted());
+  EXPECT_THAT(cache->get_available_bytes(), Eq(0u));
+
+  cache->set_allocated(0);
+  EXPECT_FALSE(queue->is_budget_exhausted());
+
+  budget.set_max_bytes(400);
+  EXPECT_TRUE(queue->is_budget_exhausted());
+}
+
+TEST(MemoryBudgetTest, unlimited_budget_only_keeps_the_statistics) {
+  MemoryBudget budget;
+  auto cache = budget.open_account("writer cache");
+
+  cache->allocate(std::numeric_limits<uint32_t>::max());
+  EXPECT_FALSE(cache->is_budget_exhausted());
+  EXPECT_THAT(cache->get_available_bytes(), Eq(std::numeric_limits<uint64_t>::max()));
+  EXPECT_THAT(budget.get_usage().bytes, Eq(std::numeric_limits<uint32_t>::max()));
+}
+
+TEST(MemoryBudgetTest, releasing_more_than_allocated_releases_everything) {
+  MemoryBudget budget(1000);
+  auto queue = budget.open_account("player queue");
+
+  queue->allocate(100);
+  queue->release(200);
+  EXPECT_THAT(queue->get_allocated(), Eq(0u));
+  EXPECT_THAT(budget.get_usage().bytes, Eq(0u));
+}
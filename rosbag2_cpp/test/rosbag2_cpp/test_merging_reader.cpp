@@ -0,0 +1,194 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/merging_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "mock_converter_factory.hpp"
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+
+class MergingReaderTest : public Test
+{
+public:
+  MergingReaderTest()
+  : converter_factory_(std::make_shared<StrictMock<MockConverterFactory>>()),
+    storage_serialization_format_("rmw1_format"),
+    storage_id_("mock_storage"),
+    storage_uri_(rcpputils::fs::temp_directory_path().string()),
+    relative_file_paths_({"file_1", "file_2", "file_3"})
+  {}
+
+  // Every file holds the messages with the given time stamps, read in the order given.
+  void init(const std::vector<std::vector<rcutils_time_point_value_t>> & file_time_stamps)
+  {
+    auto topic_with_type = rosbag2_storage::TopicMetadata{
+      "topic", "test_msgs/BasicTypes", storage_serialization_format_, ""};
+    rosbag2_storage::BagMetadata metadata;
+    metadata.relative_file_paths = relative_file_paths_;
+    metadata.topics_with_message_count.push_back({topic_with_type, 0});
+
+    auto storage_factory = std::make_unique<StrictMock<MockStorageFactory>>();
+    for (size_t i = 0; i < relative_file_paths_.size(); ++i) {
+      auto storage = make_storage(file_time_stamps[i], topic_with_type);
+      EXPECT_CALL(
+        *storage_factory,
+        open_read_only(
+          (rcpputils::fs::path(storage_uri_) / relative_file_paths_[i]).string(), storage_id_))
+      .WillOnce(Return(storage));
+    }
+    auto metadata_io = std::make_unique<NiceMock<MockMetadataIo>>();
+    ON_CALL(*metadata_io, read_metadata(_)).WillByDefault(Return(metadata));
+    ON_CALL(*metadata_io, metadata_file_exists(_)).WillByDefault(Return(true));
+
+    auto merging_reader = std::make_unique<rosbag2_cpp::readers::MergingReader>(
+      std::move(storage_factory), converter_factory_, std::move(metadata_io), 2);
+    reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(merging_reader));
+    reader_->open({storage_uri_, storage_id_}, {"", storage_serialization_format_});
+  }
+
+  std::shared_ptr<NiceMock<MockStorage>> make_storage(
+    const std::vector<rcutils_time_point_value_t> & time_stamps,
+    const rosbag2_storage::TopicMetadata & topic_with_type)
+  {
+    auto messages = std::make_shared<
+      std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>();
+    for (const auto time_stamp : time_stamps) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->topic_name = topic_with_type.name;
+      message->time_stamp = time_stamp;
+      messages->push_back(message);
+    }
+    auto index = std::make_shared<size_t>(0);
+
+    auto storage = std::make_shared<NiceMock<MockStorage>>();
+    ON_CALL(*storage, get_all_topics_and_types())
+    .WillByDefault(Return(std::vector<rosbag2_storage::TopicMetadata>{topic_with_type}));
+    ON_CALL(*storage, has_next()).WillByDefault(
+      Invoke([messages, index]() {return *index < messages->size();}));
+    ON_CALL(*storage, read_next()).WillByDefault(
+      Invoke([messages, index]() {return (*messages)[(*index)++];}));
+    ON_CALL(*storage, seek(_)).WillByDefault(
+      Invoke(
+        [messages, index](const rcutils_time_point_value_t & timestamp) {
+          *index = 0;
+          while (*index < messages->size() && (*messages)[*index]->time_stamp < timestamp) {
+            ++(*index);
+          }
+        }));
+    return storage;
+  }
+
+  std::vector<rcutils_time_point_value_t> read_all_time_stamps()
+  {
+    std::vector<rcutils_time_point_value_t> time_stamps;
+    while (reader_->has_next()) {
+      time_stamps.push_back(reader_->read_next()->time_stamp);
+    }
+    return time_stamps;
+  }
+
+  std::shared_ptr<StrictMock<MockConverterFactory>> converter_factory_;
+  std::unique_ptr<rosbag2_cpp::Reader> reader_;
+  std::string storage_serialization_format_;
+  std::string storage_id_;
+  std::string storage_uri_;
+  std::vector<std::string> relative_file_paths_;
+};
+
+TEST_F(MergingReaderTest, merges_overlapping_files_by_time_stamp)
+{
+  init({{1, 4, 7, 10}, {2, 5, 8}, {3, 6, 9, 11, 12}});
+
+  EXPECT_THAT(read_all_time_stamps(), ElementsAre(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12));
+  EXPECT_THROW(reader_->read_next(), std::runtime_error);
+}
+
+TEST_F(MergingReaderTest, reads_files_without_overlap_in_order)
+{
+  init({{1, 2}, {}, {3, 4}});
+
+  EXPECT_THAT(read_all_time_stamps(), ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(MergingReaderTest, seek_continues_all_files_at_the_given_time)
+{
+  init({{1, 4, 7}, {2, 5, 8}, {3, 6, 9}});
+
+  ASSERT_TRUE(reader_->has_next());
+  EXPECT_THAT(reader_->read_next()->time_stamp, Eq(1));
+
+  reader_->seek(5);
+  EXPECT_THAT(read_all_time_stamps(), ElementsAre(5, 6, 7, 8, 9));
+}
+
+TEST_F(MergingReaderTest, files_without_filtered_topics_are_not_opened)
+{
+  auto topic_with_type = rosbag2_storage::TopicMetadata{
+    "topic", "test_msgs/BasicTypes", storage_serialization_format_, ""};
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = relative_file_paths_;
+  metadata.files = {{"file_1", true}, {"file_2", true}, {"file_3", true}};
+  metadata.files[0].topics = {"topic"};
+  metadata.files[1].topics = {"other_topic"};
+  metadata.topics_with_message_count.push_back({topic_with_type, 0});
+
+  // The first file is opened with the bag, the third file may hold any topic.
+  auto storage_factory = std::make_unique<StrictMock<MockStorageFactory>>();
+  EXPECT_CALL(
+    *storage_factory,
+    open_read_only((rcpputils::fs::path(storage_uri_) / "file_1").string(), storage_id_))
+  .WillOnce(Return(make_storage({1, 3}, topic_with_type)));
+  EXPECT_CALL(
+    *storage_factory,
+    open_read_only((rcpputils::fs::path(storage_uri_) / "file_3").string(), storage_id_))
+  .WillOnce(Return(make_storage({2}, topic_with_type)));
+  auto metadata_io = std::make_unique<NiceMock<MockMetadataIo>>();
+  ON_CALL(*metadata_io, read_metadata(_)).WillByDefault(Return(metadata));
+  ON_CALL(*metadata_io, metadata_file_exists(_)).WillByDefault(Return(true));
+
+  auto merging_reader = std::make_unique<rosbag2_cpp::readers::MergingReader>(
+    std::move(storage_factory), converter_factory_, std::move(metadata_io), 2);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(merging_reader));
+  reader_->open({storage_uri_, storage_id_}, {"", storage_serialization_format_});
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic"};
+  reader_->set_filter(storage_filter);
+
+  EXPECT_THAT(read_all_time_stamps(), ElementsAre(1, 2, 3));
+}
+
+TEST_F(MergingReaderTest, has_next_throws_if_not_open)
+{
+  rosbag2_cpp::readers::MergingReader reader(
+    std::make_unique<NiceMock<MockStorageFactory>>(), converter_factory_,
+    std::make_unique<NiceMock<MockMetadataIo>>());
+
+  EXPECT_THROW(reader.has_next(), std::runtime_error);
+}
@@ -0,0 +1,96 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/writers/message_deduplicator.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+using namespace ::testing;  // NOLINT
+using rosbag2_cpp::writers::MessageDeduplicator;
+
+namespace
+{
+std::shared_ptr<const rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, const std::string & data)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+}  // namespace
+
+TEST(MessageDeduplicatorTest, repeated_data_of_deduplicated_topics_is_replaced_by_references) {
+  MessageDeduplicator deduplicator({"/map"});
+
+  const auto map = make_message("/map", "the map");
+  EXPECT_THAT(deduplicator.deduplicate(map), Eq(map));
+
+  const auto reference = deduplicator.deduplicate(make_message("/map", "the map"));
+  EXPECT_THAT(reference->topic_name, Eq("/map"));
+  ASSERT_THAT(reference->serialized_data, NotNull());
+  EXPECT_THAT(reference->serialized_data->buffer_length, Eq(0u));
+  EXPECT_THAT(reference->serialized_data->buffer, NotNull());
+
+  const auto updated_map = make_message("/map", "the new map");
+  EXPECT_THAT(deduplicator.deduplicate(updated_map), Eq(updated_map));
+  EXPECT_THAT(get_data(*deduplicator.deduplicate(make_message("/map", "the map"))), Eq("the map"));
+  EXPECT_THAT(deduplicator.get_deduplicated_message_count(), Eq(1u));
+}
+
+TEST(MessageDeduplicatorTest, messages_of_other_topics_are_never_replaced) {
+  MessageDeduplicator deduplicator({"/map"});
+  EXPECT_FALSE(deduplicator.is_deduplicated("/status"));
+
+  const auto messages = MessageDeduplicator::Messages{
+    make_message("/status", "ok"), make_message("/status", "ok"), make_message("/map", "ok")};
+  EXPECT_THAT(deduplicator.deduplicate(messages), ElementsAreArray(messages));
+  EXPECT_THAT(deduplicator.get_deduplicated_message_count(), Eq(0u));
+}
+
+TEST(MessageDeduplicatorTest, data_differing_in_its_last_byte_is_stored) {
+  MessageDeduplicator deduplicator({"/status"});
+  const std::string data(1000, 'a');
+  auto other_data = data;
+  other_data[999] = 'b';
+
+  deduplicator.deduplicate(make_message("/status", data));
+  EXPECT_THAT(
+    get_data(*deduplicator.deduplicate(make_message("/status", other_data))), Eq(other_data));
+  EXPECT_THAT(
+    deduplicator.deduplicate(make_message("/status", other_data))->serialized_data->buffer_length,
+    Eq(0u));
+}
+
+TEST(MessageDeduplicatorTest, data_is_stored_again_after_reset) {
+  MessageDeduplicator deduplicator({"/map"});
+  deduplicator.deduplicate(make_message("/map", "the map"));
+  deduplicator.reset();
+
+  EXPECT_THAT(get_data(*deduplicator.deduplicate(make_message("/map", "the map"))), Eq("the map"));
+  EXPECT_THAT(deduplicator.get_deduplicated_message_count(), Eq(0u));
+}
@@ -0,0 +1,137 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/readers/delta_message_decoder.hpp"
+#include "rosbag2_cpp/writers/message_delta_encoder.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+using namespace ::testing;  // NOLINT
+using rosbag2_cpp::writers::DeltaFrameType;
+using rosbag2_cpp::writers::MessageDeltaEncoder;
+
+namespace
+{
+std::shared_ptr<const rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, const std::string & data, rcutils_time_point_value_t time_stamp)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->time_stamp = time_stamp;
+  message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  return message;
+}
+
+std::string get_data(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return std::string(
+    reinterpret_cast<const char *>(message.serialized_data->buffer),
+    message.serialized_data->buffer_length);
+}
+
+DeltaFrameType get_frame_type(const rosbag2_storage::SerializedBagMessage & message)
+{
+  return static_cast<DeltaFrameType>(message.serialized_data->buffer[0]);
+}
+
+std::string make_grid(size_t size, size_t changed_cell)
+{
+  std::string grid(size, '\0');
+  grid[changed_cell] = 100;
+  return grid;
+}
+
+rosbag2_storage::BagMetadata make_metadata()
+{
+  rosbag2_storage::BagMetadata metadata;
+  rosbag2_storage::TopicInformation costmap;
+  costmap.topic_metadata = {"/costmap", "nav_msgs/OccupancyGrid", "cdr", ""};
+  costmap.delta_encoded = true;
+  metadata.topics_with_message_count = {costmap};
+  return metadata;
+}
+}  // namespace
+
+TEST(MessageDeltaEncoderTest, messages_changing_little_are_stored_as_small_deltas) {
+  MessageDeltaEncoder encoder({"/costmap"}, 100);
+  EXPECT_TRUE(encoder.is_delta_encoded("/costmap"));
+  EXPECT_FALSE(encoder.is_delta_encoded("/scan"));
+
+  const auto keyframe = encoder.encode(*make_message("/costmap", make_grid(4000, 10), 1));
+  EXPECT_THAT(get_frame_type(*keyframe), Eq(DeltaFrameType::KEYFRAME));
+  EXPECT_THAT(keyframe->serialized_data->buffer_length, Eq(4001u));
+  EXPECT_THAT(keyframe->time_stamp, Eq(1));
+
+  const auto delta = encoder.encode(*make_message("/costmap", make_grid(4000, 2000), 2));
+  EXPECT_THAT(get_frame_type(*delta), Eq(DeltaFrameType::DELTA));
+  EXPECT_THAT(delta->serialized_data->buffer_length, Lt(30u));
+  EXPECT_THAT(encoder.get_delta_count(), Eq(1u));
+}
+
+TEST(MessageDeltaEncoderTest, keyframes_are_stored_when_deltas_cannot_be_decoded_in_order) {
+  MessageDeltaEncoder encoder({"/costmap"}, 3);
+  std::vector<DeltaFrameType> frame_types;
+  const auto encode = [&encoder, &frame_types](size_t size, rcutils_time_point_value_t stamp) {
+      frame_types.push_back(
+        get_frame_type(*encoder.encode(*make_message("/costmap", make_grid(size, 1), stamp))));
+    };
+  encode(100, 1);
+  encode(100, 2);
+  encode(100, 3);
+  // Every third message is a keyframe.
+  encode(100, 4);
+  // The size changed.
+  encode(200, 5);
+  // The time stamp is not later than the one of the previous message.
+  encode(200, 5);
+  encoder.reset();
+  encode(200, 6);
+  EXPECT_THAT(
+    frame_types, ElementsAre(
+      DeltaFrameType::KEYFRAME, DeltaFrameType::DELTA, DeltaFrameType::DELTA,
+      DeltaFrameType::KEYFRAME, DeltaFrameType::KEYFRAME, DeltaFrameType::KEYFRAME,
+      DeltaFrameType::KEYFRAME));
+}
+
+TEST(MessageDeltaEncoderTest, decoder_restores_the_data_of_encoded_messages) {
+  MessageDeltaEncoder encoder({"/costmap"}, 100);
+  const std::vector<std::string> grids = {
+    make_grid(1000, 0), make_grid(1000, 999), make_grid(1000, 500), "completely different"};
+  MessageDeltaEncoder::Messages messages;
+  rcutils_time_point_value_t time_stamp = 0;
+  for (const auto & grid : grids) {
+    messages.push_back(make_message("/costmap", grid, ++time_stamp));
+  }
+  messages.push_back(make_message("/scan", "not encoded", ++time_stamp));
+  const auto encoded_messages = encoder.encode(messages);
+  ASSERT_THAT(encoded_messages, SizeIs(5u));
+  EXPECT_THAT(encoded_messages[4], Eq(messages[4]));
+
+  rosbag2_cpp::readers::DeltaMessageDecoder decoder(
+    make_metadata(), [](const std::string &, rcutils_time_point_value_t) {
+      ADD_FAILURE() << "The file should not be read again.";
+      return rosbag2_cpp::readers::DeltaMessageDecoder::Messages{};
+    });
+  for (size_t i = 0; i < encoded_messages.size(); ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>(*encoded_messages[i]);
+    decoder.decode(*message);
+    EXPECT_THAT(get_data(*message), Eq(get_data(*messages[i])));
+  }
+}
@@ -0,0 +1,97 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/writers/message_reorder_buffer.hpp"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, rcutils_time_point_value_t time_stamp)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  message->time_stamp = time_stamp;
+  return message;
+}
+
+std::vector<rcutils_time_point_value_t> get_time_stamps(
+  const rosbag2_cpp::writers::MessageReorderBuffer::Messages & messages)
+{
+  std::vector<rcutils_time_point_value_t> time_stamps;
+  for (const auto & message : messages) {
+    time_stamps.push_back(message->time_stamp);
+  }
+  return time_stamps;
+}
+}  // namespace
+
+TEST(MessageReorderBufferTest, messages_are_released_in_time_stamp_order_after_the_window) {
+  rosbag2_cpp::writers::MessageReorderBuffer buffer(std::chrono::nanoseconds(10));
+  rosbag2_cpp::writers::MessageReorderBuffer::Messages released;
+  buffer.add(make_message("/a", 100), released);
+  buffer.add(make_message("/b", 95), released);
+  buffer.add(make_message("/a", 104), released);
+  EXPECT_THAT(released, IsEmpty());
+
+  buffer.add(make_message("/b", 107), released);
+  EXPECT_THAT(get_time_stamps(released), ElementsAre(95));
+  buffer.add(make_message("/a", 115), released);
+  EXPECT_THAT(get_time_stamps(released), ElementsAre(95, 100, 104));
+  EXPECT_FALSE(buffer.empty());
+
+  buffer.flush(released);
+  EXPECT_THAT(get_time_stamps(released), ElementsAre(95, 100, 104, 107, 115));
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(buffer.get_late_message_count(), 0u);
+}
+
+TEST(MessageReorderBufferTest, messages_of_the_same_time_stamp_keep_their_order) {
+  rosbag2_cpp::writers::MessageReorderBuffer buffer(std::chrono::nanoseconds(10));
+  rosbag2_cpp::writers::MessageReorderBuffer::Messages released;
+  for (const auto & topic_name : {"/a", "/b", "/c", "/d"}) {
+    buffer.add(make_message(topic_name, 5), released);
+  }
+  buffer.flush(released);
+
+  ASSERT_THAT(released, SizeIs(4u));
+  EXPECT_EQ(released[0]->topic_name, "/a");
+  EXPECT_EQ(released[1]->topic_name, "/b");
+  EXPECT_EQ(released[2]->topic_name, "/c");
+  EXPECT_EQ(released[3]->topic_name, "/d");
+}
+
+TEST(MessageReorderBufferTest, messages_arriving_after_the_window_are_released_right_away) {
+  rosbag2_cpp::writers::MessageReorderBuffer buffer(std::chrono::nanoseconds(10));
+  rosbag2_cpp::writers::MessageReorderBuffer::Messages released;
+  buffer.add(make_message("/a", 100), released);
+  buffer.add(make_message("/a", 120), released);
+  buffer.add(make_message("/b", 90), released);
+  buffer.add(make_message("/b", 115), released);
+
+  EXPECT_THAT(get_time_stamps(released), ElementsAre(100, 90));
+  EXPECT_EQ(buffer.get_late_message_count(), 1u);
+  buffer.flush(released);
+  EXPECT_THAT(get_time_stamps(released), ElementsAre(100, 90, 115, 120));
+}
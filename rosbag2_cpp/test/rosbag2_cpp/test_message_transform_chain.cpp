@@ -0,0 +1,184 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/message_transform_chain.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+using Messages = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+using Transforms = std::vector<rosbag2_cpp::MessageTransformOptions>;
+
+// Renames the topic given as parameter to the topic with its name and a "_raw" suffix.
+class RemapTransform : public rosbag2_cpp::transform_interfaces::MessageTransform
+{
+public:
+  void configure(const std::string & parameters) override
+  {
+    if (parameters.empty()) {
+      throw std::invalid_argument("No topic to remap.");
+    }
+    topic_name_ = parameters;
+  }
+
+  bool transform_topic(rosbag2_storage::TopicMetadata & topic) override
+  {
+    topic.name = remap(topic.name);
+    return true;
+  }
+
+  void transform(Messages & messages) override
+  {
+    for (auto & message : messages) {
+      message->topic_name = remap(message->topic_name);
+    }
+  }
+
+private:
+  std::string remap(const std::string & topic_name) const
+  {
+    return topic_name == topic_name_ ? topic_name + "_raw" : topic_name;
+  }
+
+  std::string topic_name_;
+};
+
+// Keeps every second message and drops the topic "/dropped".
+class DownsampleTransform : public rosbag2_cpp::transform_interfaces::MessageTransform
+{
+public:
+  bool transform_topic(rosbag2_storage::TopicMetadata & topic) override
+  {
+    return topic.name != "/dropped";
+  }
+
+  void transform(Messages & messages) override
+  {
+    Messages kept;
+    for (auto & message : messages) {
+      if (message_count_++ % 2 == 0) {
+        kept.push_back(message);
+      }
+    }
+    messages = kept;
+  }
+
+private:
+  size_t message_count_ = 0;
+};
+
+Messages make_messages(const std::string & topic_name, size_t count)
+{
+  Messages messages;
+  for (size_t i = 0; i < count; ++i) {
+    messages.push_back(std::make_shared<rosbag2_storage::SerializedBagMessage>());
+    messages.back()->topic_name = topic_name;
+    messages.back()->time_stamp = static_cast<rcutils_time_point_value_t>(i);
+  }
+  return messages;
+}
+}  // namespace
+
+class MessageTransformChainTest : public Test
+{
+public:
+  MessageTransformChainTest()
+  {
+    rosbag2_cpp::MessageTransformChain::register_transform(
+      "remap", [] {return std::make_unique<RemapTransform>();});
+    rosbag2_cpp::MessageTransformChain::register_transform(
+      "downsample", [] {return std::make_unique<DownsampleTransform>();});
+  }
+};
+
+TEST_F(MessageTransformChainTest, empty_chain_leaves_topics_and_messages_unchanged)
+{
+  rosbag2_cpp::MessageTransformChain chain;
+  EXPECT_TRUE(chain.empty());
+
+  rosbag2_storage::TopicMetadata topic{"/camera", "sensor_msgs/msg/Image", "cdr", ""};
+  EXPECT_TRUE(chain.transform_topic(topic));
+  EXPECT_THAT(topic.name, Eq("/camera"));
+
+  auto messages = make_messages("/camera", 3);
+  chain.transform(messages);
+  EXPECT_THAT(messages, SizeIs(3u));
+}
+
+TEST_F(MessageTransformChainTest, transforms_apply_in_order_with_their_parameters)
+{
+  rosbag2_cpp::MessageTransformChain chain(Transforms{{"remap", "/camera"}, {"downsample", ""}});
+  EXPECT_FALSE(chain.empty());
+
+  rosbag2_storage::TopicMetadata topic{"/camera", "sensor_msgs/msg/Image", "cdr", ""};
+  EXPECT_TRUE(chain.transform_topic(topic));
+  EXPECT_THAT(topic.name, Eq("/camera_raw"));
+
+  auto messages = make_messages("/camera", 3);
+  chain.transform(messages);
+  ASSERT_THAT(messages, SizeIs(2u));
+  EXPECT_THAT(messages[0]->topic_name, Eq("/camera_raw"));
+  EXPECT_THAT(messages[0]->time_stamp, Eq(0));
+  EXPECT_THAT(messages[1]->time_stamp, Eq(2));
+
+  // The state of a transform is kept between batches.
+  messages = make_messages("/camera", 2);
+  chain.transform(messages);
+  ASSERT_THAT(messages, SizeIs(1u));
+  EXPECT_THAT(messages[0]->time_stamp, Eq(1));
+}
+
+TEST_F(MessageTransformChainTest, transform_topic_reports_dropped_topics)
+{
+  rosbag2_cpp::MessageTransformChain chain(Transforms{{"downsample", ""}});
+
+  rosbag2_storage::TopicMetadata topic{"/dropped", "std_msgs/msg/String", "cdr", ""};
+  EXPECT_FALSE(chain.transform_topic(topic));
+}
+
+TEST_F(MessageTransformChainTest, messages_of_dropped_topics_are_dropped)
+{
+  rosbag2_cpp::MessageTransformChain chain(Transforms{{"remap", "/camera"}, {"downsample", ""}});
+  rosbag2_storage::TopicMetadata topic{"/dropped", "std_msgs/msg/String", "cdr", ""};
+  ASSERT_FALSE(chain.transform_topic(topic));
+
+  // The dropped messages do not reach the downsampling either.
+  auto messages = make_messages("/dropped", 3);
+  const auto camera_messages = make_messages("/camera", 2);
+  messages.insert(messages.begin() + 1, camera_messages.begin(), camera_messages.end());
+  chain.transform(messages);
+  ASSERT_THAT(messages, SizeIs(1u));
+  EXPECT_THAT(messages[0]->topic_name, Eq("/camera_raw"));
+  EXPECT_THAT(messages[0]->time_stamp, Eq(0));
+}
+
+TEST_F(MessageTransformChainTest, throws_on_invalid_parameters_or_unknown_transforms)
+{
+  EXPECT_THROW(
+    rosbag2_cpp::MessageTransformChain(Transforms{{"remap", ""}}), std::invalid_argument);
+  EXPECT_THROW(
+    rosbag2_cpp::MessageTransformChain(Transforms{{"unknown_package/UnknownTransform", ""}}),
+    std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_cpp::MessageTransformChain::register_transform("empty", nullptr),
+    std::invalid_argument);
+}
@@ -0,0 +1,316 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/multi_bag_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+struct FakeMessage
+{
+  std::string topic_name;
+  rcutils_time_point_value_t time_stamp;
+  rcutils_time_point_value_t publish_time_stamp;
+};
+
+// Reads the messages of a bag of a single file, whose topics all have the given type, and
+// counts the readers open, which fail to open if so asked.
+class FakeReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  FakeReader(
+    const std::vector<FakeMessage> & messages, const std::string & topic_type,
+    size_t & open_readers, bool fails_to_open = false)
+  : open_readers_(open_readers),
+    fails_to_open_(fails_to_open)
+  {
+    for (const auto & message : messages) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->topic_name = message.topic_name;
+      bag_message->time_stamp = message.time_stamp;
+      bag_message->publish_time_stamp = message.publish_time_stamp;
+      messages_.push_back(bag_message);
+
+      auto topic = std::find_if(
+        metadata_.topics_with_message_count.begin(), metadata_.topics_with_message_count.end(),
+        [&message](const rosbag2_storage::TopicInformation & candidate) {
+          return candidate.topic_metadata.name == message.topic_name;
+        });
+      if (topic == metadata_.topics_with_message_count.end()) {
+        rosbag2_storage::TopicInformation topic_information{};
+        topic_information.topic_metadata.name = message.topic_name;
+        topic_information.topic_metadata.type = topic_type;
+        metadata_.topics_with_message_count.push_back(topic_information);
+        topic = metadata_.topics_with_message_count.end() - 1;
+      }
+      ++topic->message_count;
+    }
+    metadata_.message_count = messages.size();
+    metadata_.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::nanoseconds(messages.front().time_stamp));
+    metadata_.duration =
+      std::chrono::nanoseconds(messages.back().time_stamp - messages.front().time_stamp);
+    rosbag2_storage::FileInformation file;
+    file.path = "bag_0.db3";
+    metadata_.files.push_back(file);
+    metadata_.relative_file_paths.push_back(file.path);
+  }
+
+  ~FakeReader() override
+  {
+    reset();
+  }
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {
+    if (fails_to_open_) {
+      throw std::runtime_error("The bag could not be opened.");
+    }
+    index_ = 0;
+    if (!is_open_) {
+      is_open_ = true;
+      ++open_readers_;
+    }
+  }
+
+  void reset() override
+  {
+    if (is_open_) {
+      is_open_ = false;
+      --open_readers_;
+    }
+  }
+
+  bool has_next() override
+  {
+    while (index_ < messages_.size() && !storage_filter_.topics.empty() &&
+      std::find(
+        storage_filter_.topics.begin(), storage_filter_.topics.end(),
+        messages_[index_]->topic_name) == storage_filter_.topics.end())
+    {
+      ++index_;
+    }
+    return index_ < messages_.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    return messages_[index_++];
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    std::vector<rosbag2_storage::TopicMetadata> topics;
+    for (const auto & topic : metadata_.topics_with_message_count) {
+      topics.push_back(topic.topic_metadata);
+    }
+    return topics;
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    storage_filter_ = storage_filter;
+  }
+
+  void reset_filter() override
+  {
+    storage_filter_ = rosbag2_storage::StorageFilter();
+  }
+
+  void seek(const rcutils_time_point_value_t & timestamp) override
+  {
+    index_ = 0;
+    while (index_ < messages_.size() && messages_[index_]->time_stamp < timestamp) {
+      ++index_;
+    }
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> latest_messages;
+    for (const auto & topic_name : topic_names) {
+      std::shared_ptr<rosbag2_storage::SerializedBagMessage> latest_message;
+      for (const auto & message : messages_) {
+        if (message->topic_name == topic_name && message->time_stamp < timestamp) {
+          latest_message = message;
+        }
+      }
+      if (latest_message) {
+        latest_messages.push_back(latest_message);
+      }
+    }
+    return latest_messages;
+  }
+
+private:
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+  rosbag2_storage::BagMetadata metadata_;
+  rosbag2_storage::StorageFilter storage_filter_;
+  size_t index_ {0};
+  size_t & open_readers_;
+  bool fails_to_open_;
+  bool is_open_ {false};
+};
+
+class MultiBagReaderTest : public Test
+{
+public:
+  MultiBagReaderTest()
+  : reader_(
+      [this](const rosbag2_cpp::StorageOptions & storage_options) {
+        return std::make_unique<FakeReader>(
+          bags_.at(storage_options.uri), bag_topic_types_[storage_options.uri], open_readers_,
+          failing_bags_.count(storage_options.uri) > 0u);
+      })
+  {
+    bags_["a"] = {{"/a", 1, 0}, {"/a", 3, 0}, {"/shared", 5, 2}, {"/a", 7, 0}};
+    bags_["b"] = {{"/b", 2, 0}, {"/shared", 3, 4}, {"/b", 8, 0}};
+    bag_topic_types_["a"] = "type";
+    bag_topic_types_["b"] = "type";
+  }
+
+  void open()
+  {
+    rosbag2_cpp::StorageOptions bag_a;
+    bag_a.uri = "a";
+    rosbag2_cpp::StorageOptions bag_b;
+    bag_b.uri = "b";
+    reader_.open(std::vector<rosbag2_cpp::StorageOptions>{bag_a, bag_b}, {});
+  }
+
+  std::vector<std::pair<std::string, rcutils_time_point_value_t>> read_all()
+  {
+    std::vector<std::pair<std::string, rcutils_time_point_value_t>> messages;
+    while (reader_.has_next()) {
+      const auto message = reader_.read_next();
+      messages.emplace_back(message->topic_name, message->time_stamp);
+    }
+    return messages;
+  }
+
+  std::map<std::string, std::vector<FakeMessage>> bags_;
+  std::map<std::string, std::string> bag_topic_types_;
+  std::set<std::string> failing_bags_;
+  size_t open_readers_ {0};
+  rosbag2_cpp::readers::MultiBagReader reader_;
+};
+}  // namespace
+
+TEST_F(MultiBagReaderTest, messages_of_all_bags_are_read_in_the_order_of_their_time_stamps) {
+  open();
+
+  EXPECT_THAT(
+    read_all(), ElementsAre(
+      Pair("/a", 1), Pair("/b", 2), Pair("/a", 3), Pair("/shared", 3), Pair("/shared", 5),
+      Pair("/a", 7), Pair("/b", 8)));
+  EXPECT_THROW(reader_.read_next(), std::runtime_error);
+}
+
+TEST_F(MultiBagReaderTest, messages_of_all_bags_are_read_by_publish_time_if_filtered_so) {
+  open();
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"/shared"};
+  storage_filter.order_by_publish_time = true;
+  reader_.set_filter(storage_filter);
+
+  EXPECT_THAT(read_all(), ElementsAre(Pair("/shared", 5), Pair("/shared", 3)));
+
+  reader_.reset_filter();
+  reader_.seek(0);
+  EXPECT_THAT(read_all(), SizeIs(7u));
+}
+
+TEST_F(MultiBagReaderTest, seeking_continues_reading_all_bags_at_the_given_time) {
+  open();
+  read_all();
+
+  reader_.seek(4);
+  EXPECT_THAT(read_all(), ElementsAre(Pair("/shared", 5), Pair("/a", 7), Pair("/b", 8)));
+}
+
+TEST_F(MultiBagReaderTest, metadata_spans_all_bags) {
+  open();
+  const auto & metadata = reader_.get_metadata();
+
+  EXPECT_THAT(metadata.message_count, Eq(7u));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch().count(), Eq(1));
+  EXPECT_THAT(metadata.duration.count(), Eq(7));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre("a/bag_0.db3", "b/bag_0.db3"));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(3u));
+  EXPECT_THAT(metadata.topics_with_message_count[1].topic_metadata.name, Eq("/shared"));
+  EXPECT_THAT(metadata.topics_with_message_count[1].message_count, Eq(2u));
+
+  std::vector<std::string> topic_names;
+  for (const auto & topic : reader_.get_all_topics_and_types()) {
+    topic_names.push_back(topic.name);
+  }
+  EXPECT_THAT(topic_names, ElementsAre("/a", "/shared", "/b"));
+}
+
+TEST_F(MultiBagReaderTest, latest_messages_are_the_latest_of_all_bags) {
+  open();
+
+  const auto latest_messages = reader_.read_latest_messages({"/b", "/shared", "/none"}, 6);
+  ASSERT_THAT(latest_messages, SizeIs(2u));
+  EXPECT_THAT(latest_messages[0]->time_stamp, Eq(2));
+  EXPECT_THAT(latest_messages[1]->time_stamp, Eq(5));
+}
+
+TEST_F(MultiBagReaderTest, topics_of_different_types_in_different_bags_are_rejected) {
+  bag_topic_types_["b"] = "other_type";
+
+  EXPECT_THROW(open(), std::runtime_error);
+  EXPECT_THROW(reader_.has_next(), std::runtime_error);
+  EXPECT_THAT(open_readers_, Eq(0u));
+}
+
+TEST_F(MultiBagReaderTest, bags_opened_before_a_failing_one_are_closed) {
+  failing_bags_.insert("b");
+
+  EXPECT_THROW(open(), std::runtime_error);
+  EXPECT_THROW(reader_.has_next(), std::runtime_error);
+  EXPECT_THAT(open_readers_, Eq(0u));
+  EXPECT_THAT(reader_.get_metadata().message_count, Eq(0u));
+}
+
+TEST_F(MultiBagReaderTest, opening_no_bags_is_rejected) {
+  EXPECT_THROW(
+    reader_.open(std::vector<rosbag2_cpp::StorageOptions>{}, {}), std::invalid_argument);
+}
@@ -14,6 +14,7 @@
 
 #include <gmock/gmock.h>
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
@@ -118,6 +119,26 @@ public:
   }
 };
 
+class MultifileReaderTestWithTimeRanges : public MultifileReaderTest
+{
+public:
+  // The files hold the messages of [10 s, 19 s], [20 s, 29 s] and [30 s, 39 s].
+  rosbag2_storage::BagMetadata get_metadata() const override
+  {
+    auto metadata = MultifileReaderTest::get_metadata();
+    metadata.files.resize(metadata.relative_file_paths.size());
+    for (size_t i = 0; i < metadata.files.size(); ++i) {
+      metadata.files[i].path = metadata.relative_file_paths[i];
+      metadata.files[i].starting_time =
+        std::chrono::time_point<std::chrono::high_resolution_clock>(
+        std::chrono::seconds(10 * (i + 1)));
+      metadata.files[i].duration = std::chrono::seconds(9);
+    }
+
+    return metadata;
+  }
+};
+
 TEST_F(MultifileReaderTest, has_next_reads_next_file)
 {
   init();
@@ -228,3 +249,54 @@ TEST_F(MultifileReaderTest, get_all_topics_and_types_returns_from_io_metadata)
   const auto all_topics_and_types = reader_->get_all_topics_and_types();
   EXPECT_FALSE(all_topics_and_types.empty());
 }
+
+TEST_F(MultifileReaderTest, seek_stays_in_first_file_without_time_ranges)
+{
+  init();
+  const rcutils_time_point_value_t second = 1000000000;
+  EXPECT_CALL(*storage_, seek(25 * second)).Times(1);
+  reader_->open(default_storage_options_, {"", storage_serialization_format_});
+
+  reader_->seek(25 * second);
+
+  auto & sr = static_cast<rosbag2_cpp::readers::SequentialReader &>(
+    reader_->get_implementation_handle());
+  EXPECT_EQ(
+    sr.get_current_file(), (rcpputils::fs::path(storage_uri_) / relative_path_1_).string());
+}
+
+TEST_F(MultifileReaderTestWithTimeRanges, seek_opens_the_file_holding_the_timestamp)
+{
+  init();
+  const rcutils_time_point_value_t second = 1000000000;
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic"};
+  EXPECT_CALL(*storage_, set_filter(_)).Times(AnyNumber());
+  // Set on the current storage and reapplied when opening the next file.
+  EXPECT_CALL(
+    *storage_, set_filter(Field(&rosbag2_storage::StorageFilter::topics, ElementsAre("topic"))))
+  .Times(2);
+  EXPECT_CALL(*storage_, seek(25 * second)).Times(1);
+  EXPECT_CALL(*storage_, seek(15 * second)).Times(2);
+  EXPECT_CALL(*storage_, has_next()).Times(2)
+  .WillOnce(Return(false))  // No message after the seek time, load next file
+  .WillOnce(Return(true));
+  reader_->open(default_storage_options_, {"", storage_serialization_format_});
+
+  auto & sr = static_cast<rosbag2_cpp::readers::SequentialReader &>(
+    reader_->get_implementation_handle());
+  auto resolved_relative_path_1 =
+    (rcpputils::fs::path(storage_uri_) / relative_path_1_).string();
+  auto resolved_relative_path_2 =
+    (rcpputils::fs::path(storage_uri_) / relative_path_2_).string();
+
+  reader_->seek(25 * second);
+  EXPECT_EQ(sr.get_current_file(), resolved_relative_path_2);
+
+  reader_->seek(15 * second);
+  EXPECT_EQ(sr.get_current_file(), resolved_relative_path_1);
+
+  reader_->set_filter(storage_filter);
+  EXPECT_TRUE(reader_->has_next());
+  EXPECT_EQ(sr.get_current_file(), resolved_relative_path_2);
+}
@@ -0,0 +1,285 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/parallel_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+struct FakeBag
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  std::atomic<size_t> open_readers{0};
+  std::atomic<size_t> readers_created{0};
+};
+
+// Returns the messages of a fake bag which pass the topics and time range of its filter.
+class FakeReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  explicit FakeReader(std::shared_ptr<FakeBag> bag)
+  : bag_(std::move(bag))
+  {
+    ++bag_->readers_created;
+  }
+
+  ~FakeReader() override
+  {
+    reset();
+  }
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {
+    is_open_ = true;
+    ++bag_->open_readers;
+  }
+
+  void reset() override
+  {
+    if (is_open_) {
+      is_open_ = false;
+      --bag_->open_readers;
+    }
+  }
+
+  bool has_next() override
+  {
+    while (index_ < bag_->messages.size() && !is_selected(*bag_->messages[index_])) {
+      ++index_;
+    }
+    return index_ < bag_->messages.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    if (!has_next()) {
+      throw std::runtime_error("There are no more messages to read.");
+    }
+    return bag_->messages[index_++];
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return {};
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    storage_filter_ = storage_filter;
+    index_ = 0;
+  }
+
+  void reset_filter() override
+  {
+    set_filter({});
+  }
+
+private:
+  bool is_selected(const rosbag2_storage::SerializedBagMessage & message) const
+  {
+    const auto & topics = storage_filter_.topics;
+    return (topics.empty() ||
+           std::find(topics.begin(), topics.end(), message.topic_name) != topics.end()) &&
+           (storage_filter_.start_time == 0 || message.time_stamp >= storage_filter_.start_time) &&
+           (storage_filter_.end_time == 0 || message.time_stamp <= storage_filter_.end_time);
+  }
+
+  std::shared_ptr<FakeBag> bag_;
+  rosbag2_storage::StorageFilter storage_filter_{};
+  size_t index_ = 0;
+  bool is_open_ = false;
+  rosbag2_storage::BagMetadata metadata_{};
+};
+
+rosbag2_storage::TopicInformation make_topic(const std::string & name, size_t message_count)
+{
+  rosbag2_storage::TopicInformation topic_information;
+  topic_information.topic_metadata = {name, "test_msgs/msg/BasicTypes", "cdr", ""};
+  topic_information.message_count = message_count;
+  return topic_information;
+}
+}  // namespace
+
+class ParallelReaderTest : public Test
+{
+public:
+  ParallelReaderTest()
+  : bag_(std::make_shared<FakeBag>())
+  {
+    for (rcutils_time_point_value_t time_stamp = 100; time_stamp < 200; ++time_stamp) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->topic_name = time_stamp % 4 == 0 ? "/odom" : "/imu";
+      message->time_stamp = time_stamp;
+      message->serialized_data = rosbag2_storage::make_empty_serialized_message(0);
+      bag_->messages.push_back(message);
+    }
+    metadata_.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::nanoseconds(100));
+    metadata_.duration = std::chrono::nanoseconds(99);
+    metadata_.message_count = 100;
+    metadata_.topics_with_message_count = {make_topic("/imu", 75), make_topic("/odom", 25)};
+  }
+
+  rosbag2_cpp::readers::ParallelReader make_reader(size_t max_threads)
+  {
+    auto bag = bag_;
+    return rosbag2_cpp::readers::ParallelReader(
+      [bag]() {return std::make_unique<FakeReader>(bag);}, max_threads);
+  }
+
+  std::shared_ptr<FakeBag> bag_;
+  rosbag2_storage::BagMetadata metadata_{};
+};
+
+TEST_F(ParallelReaderTest, partition_by_time_splits_time_range_into_consecutive_ranges) {
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"/imu"};
+
+  auto partitions =
+    rosbag2_cpp::readers::ParallelReader::partition_by_time(metadata_, 3, storage_filter);
+
+  ASSERT_THAT(partitions, SizeIs(3));
+  // The first and last range stay open, the 100 ns of the bag are split 34, 33 and 33 ns.
+  EXPECT_THAT(partitions[0].start_time, Eq(0));
+  EXPECT_THAT(partitions[0].end_time, Eq(133));
+  EXPECT_THAT(partitions[1].start_time, Eq(134));
+  EXPECT_THAT(partitions[1].end_time, Eq(166));
+  EXPECT_THAT(partitions[2].start_time, Eq(167));
+  EXPECT_THAT(partitions[2].end_time, Eq(0));
+  for (const auto & partition : partitions) {
+    EXPECT_THAT(partition.topics, ElementsAre("/imu"));
+  }
+}
+
+TEST_F(ParallelReaderTest, partition_by_time_splits_time_range_of_storage_filter) {
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.start_time = 150;
+  storage_filter.end_time = 151;
+
+  auto partitions =
+    rosbag2_cpp::readers::ParallelReader::partition_by_time(metadata_, 4, storage_filter);
+
+  ASSERT_THAT(partitions, SizeIs(2));
+  EXPECT_THAT(partitions[0].start_time, Eq(150));
+  EXPECT_THAT(partitions[0].end_time, Eq(150));
+  EXPECT_THAT(partitions[1].start_time, Eq(151));
+  EXPECT_THAT(partitions[1].end_time, Eq(151));
+}
+
+TEST_F(ParallelReaderTest, partition_by_topic_balances_message_counts) {
+  metadata_.topics_with_message_count = {
+    make_topic("/a", 10), make_topic("/b", 60), make_topic("/c", 30), make_topic("/d", 25)};
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics_regex = "/[abc]";
+  storage_filter.end_time = 150;
+
+  auto partitions =
+    rosbag2_cpp::readers::ParallelReader::partition_by_topic(metadata_, 2, storage_filter);
+
+  ASSERT_THAT(partitions, SizeIs(2));
+  EXPECT_THAT(partitions[0].topics, ElementsAre("/b"));
+  EXPECT_THAT(partitions[1].topics, ElementsAre("/c", "/a"));
+  for (const auto & partition : partitions) {
+    EXPECT_THAT(partition.topics_regex, IsEmpty());
+    EXPECT_THAT(partition.end_time, Eq(150));
+  }
+}
+
+TEST_F(ParallelReaderTest, partitions_throw_if_count_is_zero) {
+  EXPECT_THROW(
+    rosbag2_cpp::readers::ParallelReader::partition_by_time(metadata_, 0),
+    std::invalid_argument);
+  EXPECT_THROW(
+    rosbag2_cpp::readers::ParallelReader::partition_by_topic(metadata_, 0),
+    std::invalid_argument);
+}
+
+TEST_F(ParallelReaderTest, read_reads_every_partition_with_reader_of_its_own) {
+  auto reader = make_reader(4);
+  auto partitions = rosbag2_cpp::readers::ParallelReader::partition_by_time(metadata_, 10);
+  std::vector<size_t> message_counts(partitions.size(), 0u);
+
+  reader.read(
+    {"uri", "storage_id"}, {"", ""}, partitions,
+    [&message_counts](size_t partition_index, rosbag2_cpp::reader_interfaces::BaseReaderInterface &
+    partition_reader) {
+      while (partition_reader.has_next()) {
+        partition_reader.read_next();
+        ++message_counts[partition_index];
+      }
+    });
+
+  EXPECT_THAT(message_counts, Each(Eq(10u)));
+  EXPECT_THAT(bag_->readers_created.load(), Eq(10u));
+  EXPECT_THAT(bag_->open_readers.load(), Eq(0u));
+}
+
+TEST_F(ParallelReaderTest, transform_returns_results_in_order_of_partitions) {
+  auto reader = make_reader(2);
+  auto partitions = rosbag2_cpp::readers::ParallelReader::partition_by_topic(metadata_, 2);
+
+  auto topic_counts = reader.transform(
+    {"uri", "storage_id"}, {"", ""}, partitions,
+    [](size_t, rosbag2_cpp::reader_interfaces::BaseReaderInterface & partition_reader) {
+      std::pair<std::string, size_t> topic_count{"", 0u};
+      while (partition_reader.has_next()) {
+        topic_count.first = partition_reader.read_next()->topic_name;
+        ++topic_count.second;
+      }
+      return topic_count;
+    });
+
+  EXPECT_THAT(
+    topic_counts, ElementsAre(Pair("/imu", 75u), Pair("/odom", 25u)));
+}
+
+TEST_F(ParallelReaderTest, read_raises_error_of_partition_after_all_threads_finished) {
+  auto reader = make_reader(3);
+  auto partitions = rosbag2_cpp::readers::ParallelReader::partition_by_time(metadata_, 20);
+
+  EXPECT_THROW(
+    reader.read(
+      {"uri", "storage_id"}, {"", ""}, partitions,
+      [](size_t partition_index, rosbag2_cpp::reader_interfaces::BaseReaderInterface &) {
+        if (partition_index == 1) {
+          throw std::runtime_error("processing error");
+        }
+      }),
+    std::runtime_error);
+
+  EXPECT_THAT(bag_->open_readers.load(), Eq(0u));
+}
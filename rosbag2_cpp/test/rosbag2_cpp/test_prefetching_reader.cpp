@@ -0,0 +1,288 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <future>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/prefetching_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+struct FakeReaderState
+{
+  std::atomic<size_t> messages_read{0};
+  size_t fail_at_message = std::numeric_limits<size_t>::max();
+  size_t block_at_message = std::numeric_limits<size_t>::max();
+  std::shared_future<void> unblocked;
+};
+
+class FakeReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  FakeReader(std::shared_ptr<FakeReaderState> state, size_t message_count, size_t message_size)
+  : state_(std::move(state))
+  {
+    std::vector<uint8_t> data(message_size, 0u);
+    for (size_t i = 0; i < message_count; ++i) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->topic_name = "topic";
+      message->time_stamp = static_cast<rcutils_time_point_value_t>(i);
+      message->serialized_data =
+        rosbag2_storage::make_serialized_message(data.data(), data.size());
+      messages_.push_back(message);
+    }
+  }
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {
+    index_ = 0;
+  }
+
+  void reset() override {}
+
+  bool has_next() override
+  {
+    return index_ < messages_.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    if (state_->messages_read == state_->fail_at_message) {
+      throw std::runtime_error("read error");
+    }
+    if (state_->messages_read == state_->block_at_message) {
+      state_->unblocked.wait();
+    }
+    ++state_->messages_read;
+    return messages_[index_++];
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return {};
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter &) override {}
+
+  void reset_filter() override {}
+
+  void seek(const rcutils_time_point_value_t & timestamp) override
+  {
+    index_ = 0;
+    while (index_ < messages_.size() && messages_[index_]->time_stamp < timestamp) {
+      ++index_;
+    }
+  }
+
+private:
+  std::shared_ptr<FakeReaderState> state_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+  size_t index_ = 0;
+  rosbag2_storage::BagMetadata metadata_;
+};
+}  // namespace
+
+class PrefetchingReaderTest : public Test
+{
+public:
+  PrefetchingReaderTest()
+  : state_(std::make_shared<FakeReaderState>())
+  {}
+
+  std::unique_ptr<rosbag2_cpp::readers::PrefetchingReader> make_reader(
+    size_t message_count, size_t message_size, size_t max_messages, uint64_t max_bytes)
+  {
+    auto reader = std::make_unique<rosbag2_cpp::readers::PrefetchingReader>(
+      std::make_unique<FakeReader>(state_, message_count, message_size),
+      max_messages, max_bytes);
+    reader->open({"uri", "storage_id"}, {"", ""});
+    return reader;
+  }
+
+  std::shared_ptr<FakeReaderState> state_;
+};
+
+TEST_F(PrefetchingReaderTest, reads_all_messages_in_order) {
+  auto reader = make_reader(100, 1, 10, 0);
+
+  rcutils_time_point_value_t expected_time_stamp = 0;
+  while (reader->has_next()) {
+    EXPECT_THAT(reader->read_next()->time_stamp, Eq(expected_time_stamp));
+    ++expected_time_stamp;
+  }
+  EXPECT_THAT(expected_time_stamp, Eq(100));
+  EXPECT_THROW(reader->read_next(), std::runtime_error);
+}
+
+TEST_F(PrefetchingReaderTest, does_not_read_ahead_beyond_max_messages) {
+  const size_t max_messages = 3;
+  auto reader = make_reader(50, 1, max_messages, 0);
+
+  size_t consumed = 0;
+  while (reader->has_next()) {
+    EXPECT_THAT(state_->messages_read.load(), Le(consumed + max_messages));
+    reader->read_next();
+    ++consumed;
+  }
+  EXPECT_THAT(consumed, Eq(50u));
+}
+
+TEST_F(PrefetchingReaderTest, does_not_read_ahead_beyond_max_bytes) {
+  // Messages are read ahead until the buffer reaches 25 bytes, i.e. 3 messages of 10 bytes.
+  auto reader = make_reader(50, 10, 0, 25);
+
+  size_t consumed = 0;
+  while (reader->has_next()) {
+    EXPECT_THAT(state_->messages_read.load(), Le(consumed + 3));
+    reader->read_next();
+    ++consumed;
+  }
+  EXPECT_THAT(consumed, Eq(50u));
+}
+
+TEST_F(PrefetchingReaderTest, buffers_single_messages_larger_than_max_bytes) {
+  auto reader = make_reader(5, 100, 0, 10);
+
+  size_t consumed = 0;
+  while (reader->has_next()) {
+    reader->read_next();
+    ++consumed;
+  }
+  EXPECT_THAT(consumed, Eq(5u));
+}
+
+TEST_F(PrefetchingReaderTest, throws_if_no_limit_is_set) {
+  EXPECT_THROW(
+    rosbag2_cpp::readers::PrefetchingReader(std::make_unique<FakeReader>(state_, 1, 1), 0, 0),
+    std::invalid_argument);
+}
+
+TEST_F(PrefetchingReaderTest, has_next_throws_if_not_open) {
+  rosbag2_cpp::readers::PrefetchingReader reader(std::make_unique<FakeReader>(state_, 1, 1));
+
+  EXPECT_THROW(reader.has_next(), std::runtime_error);
+}
+
+TEST_F(PrefetchingReaderTest, read_errors_are_raised_after_messages_read_before) {
+  state_->fail_at_message = 5;
+  auto reader = make_reader(10, 1, 2, 0);
+
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(reader->has_next());
+    EXPECT_THAT(reader->read_next()->time_stamp, Eq(static_cast<int64_t>(i)));
+  }
+  EXPECT_THROW(reader->has_next(), std::runtime_error);
+}
+
+TEST_F(PrefetchingReaderTest, seek_discards_messages_read_ahead) {
+  auto reader = make_reader(100, 1, 10, 0);
+
+  ASSERT_TRUE(reader->has_next());
+  EXPECT_THAT(reader->read_next()->time_stamp, Eq(0));
+
+  reader->seek(50);
+  ASSERT_TRUE(reader->has_next());
+  EXPECT_THAT(reader->read_next()->time_stamp, Eq(50));
+
+  reader->seek(10);
+  ASSERT_TRUE(reader->has_next());
+  EXPECT_THAT(reader->read_next()->time_stamp, Eq(10));
+}
+
+TEST_F(PrefetchingReaderTest, read_next_batch_takes_up_to_max_messages_read_ahead) {
+  auto reader = make_reader(20, 1, 10, 0);
+
+  rcutils_time_point_value_t expected_time_stamp = 0;
+  for (auto batch = reader->read_next_batch(4, 0); !batch.empty();
+    batch = reader->read_next_batch(4, 0))
+  {
+    EXPECT_THAT(batch.size(), Le(4u));
+    for (const auto & message : batch) {
+      EXPECT_THAT(message->time_stamp, Eq(expected_time_stamp));
+      ++expected_time_stamp;
+    }
+  }
+  EXPECT_THAT(expected_time_stamp, Eq(20));
+}
+
+TEST_F(PrefetchingReaderTest, read_next_batch_async_reads_all_messages_in_order) {
+  auto reader = make_reader(20, 1, 10, 0);
+
+  std::atomic<size_t> ready_calls{0};
+  size_t reads = 0;
+  rcutils_time_point_value_t expected_time_stamp = 0;
+  while (true) {
+    auto batch = reader->read_next_batch_async(4, 0, [&ready_calls] {++ready_calls;}).get();
+    ++reads;
+    if (batch.empty()) {
+      break;
+    }
+    EXPECT_THAT(batch.size(), Le(4u));
+    for (const auto & message : batch) {
+      EXPECT_THAT(message->time_stamp, Eq(expected_time_stamp));
+      ++expected_time_stamp;
+    }
+  }
+  EXPECT_THAT(expected_time_stamp, Eq(20));
+  // The prefetch thread may still be calling the last callback after fulfilling the future.
+  reader->reset();
+  EXPECT_THAT(ready_calls.load(), Eq(reads));
+}
+
+TEST_F(PrefetchingReaderTest, read_next_batch_async_raises_read_errors) {
+  state_->fail_at_message = 0;
+  auto reader = make_reader(10, 1, 2, 0);
+
+  auto batch = reader->read_next_batch_async(4, 0, nullptr);
+  EXPECT_THROW(batch.get(), std::runtime_error);
+}
+
+TEST_F(PrefetchingReaderTest, cancel_async_read_breaks_pending_read) {
+  std::promise<void> unblock;
+  state_->block_at_message = 0;
+  state_->unblocked = unblock.get_future().share();
+  auto reader = make_reader(10, 1, 2, 0);
+
+  bool ready = false;
+  auto batch = reader->read_next_batch_async(4, 0, [&ready] {ready = true;});
+  EXPECT_THROW(reader->read_next_batch_async(4, 0, nullptr), std::runtime_error);
+
+  EXPECT_TRUE(reader->cancel_async_read());
+  EXPECT_TRUE(ready);
+  EXPECT_THROW(batch.get(), std::future_error);
+  EXPECT_FALSE(reader->cancel_async_read());
+
+  unblock.set_value();
+  EXPECT_THAT(reader->read_next_batch_async(4, 0, nullptr).get(), Not(IsEmpty()));
+}
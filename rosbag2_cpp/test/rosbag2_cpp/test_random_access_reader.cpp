@@ -0,0 +1,169 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/readers/random_access_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "mock_converter_factory.hpp"
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+
+class RandomAccessReaderTest : public Test
+{
+public:
+  RandomAccessReaderTest()
+  : converter_factory_(std::make_shared<StrictMock<MockConverterFactory>>()),
+    storage_serialization_format_("rmw1_format"),
+    storage_uri_(rcpputils::fs::temp_directory_path().string()),
+    relative_file_paths_({"file_1", "file_2", "file_3"}),
+    topic_with_type_({"topic", "test_msgs/BasicTypes", storage_serialization_format_, ""})
+  {
+    metadata_.relative_file_paths = relative_file_paths_;
+    metadata_.topics_with_message_count.push_back({topic_with_type_, 0});
+  }
+
+  // Every file holds the messages of the topic with the given time stamps. Files which are
+  // expected to stay closed are not given a storage.
+  void init(
+    const std::vector<std::vector<rcutils_time_point_value_t>> & file_time_stamps,
+    const std::vector<bool> & files_opened = {true, true, true})
+  {
+    auto storage_factory = std::make_unique<StrictMock<MockStorageFactory>>();
+    for (size_t i = 0; i < relative_file_paths_.size(); ++i) {
+      if (!files_opened[i]) {
+        continue;
+      }
+      EXPECT_CALL(
+        *storage_factory,
+        open_read_only((rcpputils::fs::path(storage_uri_) / relative_file_paths_[i]).string(), _))
+      .WillOnce(Return(make_storage(file_time_stamps[i])));
+    }
+    auto metadata_io = std::make_unique<NiceMock<MockMetadataIo>>();
+    ON_CALL(*metadata_io, read_metadata(_)).WillByDefault(Return(metadata_));
+    ON_CALL(*metadata_io, metadata_file_exists(_)).WillByDefault(Return(true));
+
+    reader_ = std::make_unique<rosbag2_cpp::readers::RandomAccessReader>(
+      std::move(storage_factory), converter_factory_, std::move(metadata_io));
+    reader_->open({storage_uri_, ""}, {"", storage_serialization_format_});
+  }
+
+  std::shared_ptr<NiceMock<MockStorage>> make_storage(
+    const std::vector<rcutils_time_point_value_t> & time_stamps)
+  {
+    auto storage = std::make_shared<NiceMock<MockStorage>>();
+    rosbag2_storage::StorageCapabilities capabilities;
+    capabilities.random_access = true;
+    ON_CALL(*storage, get_capabilities()).WillByDefault(Return(capabilities));
+    ON_CALL(*storage, get_all_topics_and_types())
+    .WillByDefault(Return(std::vector<rosbag2_storage::TopicMetadata>{topic_with_type_}));
+    ON_CALL(*storage, get_topic_message_count(topic_with_type_.name))
+    .WillByDefault(Return(time_stamps.size()));
+    ON_CALL(*storage, read_topic_message(topic_with_type_.name, _)).WillByDefault(
+      Invoke(
+        [this, time_stamps](const std::string &, uint64_t index) {
+          auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+          message->topic_name = topic_with_type_.name;
+          message->time_stamp = time_stamps.at(index);
+          return message;
+        }));
+    ON_CALL(*storage, find_topic_message(topic_with_type_.name, _)).WillByDefault(
+      Invoke(
+        [time_stamps](const std::string &, const rcutils_time_point_value_t & timestamp) {
+          return static_cast<uint64_t>(
+            std::lower_bound(time_stamps.begin(), time_stamps.end(), timestamp) -
+            time_stamps.begin());
+        }));
+    return storage;
+  }
+
+  std::shared_ptr<StrictMock<MockConverterFactory>> converter_factory_;
+  std::unique_ptr<rosbag2_cpp::readers::RandomAccessReader> reader_;
+  std::string storage_serialization_format_;
+  std::string storage_uri_;
+  std::vector<std::string> relative_file_paths_;
+  rosbag2_storage::TopicMetadata topic_with_type_;
+  rosbag2_storage::BagMetadata metadata_;
+};
+
+TEST_F(RandomAccessReaderTest, reads_messages_of_a_topic_across_files_by_index)
+{
+  init({{1, 2, 3}, {}, {4, 5}});
+
+  ASSERT_THAT(reader_->get_topic_message_count("topic"), Eq(5u));
+  EXPECT_THAT(reader_->read_topic_message("topic", 4)->time_stamp, Eq(5));
+  EXPECT_THAT(reader_->read_topic_message("topic", 0)->time_stamp, Eq(1));
+  EXPECT_THAT(reader_->read_topic_message("topic", 3)->time_stamp, Eq(4));
+  EXPECT_THAT(reader_->read_topic_message("topic", 2)->time_stamp, Eq(3));
+  EXPECT_THROW(reader_->read_topic_message("topic", 5), std::out_of_range);
+  EXPECT_THAT(reader_->get_topic_message_count("other_topic"), Eq(0u));
+}
+
+TEST_F(RandomAccessReaderTest, message_counts_in_metadata_spare_opening_files)
+{
+  for (const auto & path : relative_file_paths_) {
+    rosbag2_storage::FileInformation file;
+    file.path = path;
+    metadata_.files.push_back(file);
+  }
+  metadata_.files[0].topics = {"topic"};
+  metadata_.files[0].topic_message_counts = {2};
+  metadata_.files[1].topics = {"other_topic"};
+  metadata_.files[1].topic_message_counts = {7};
+  metadata_.files[2].topics = {"topic"};
+  metadata_.files[2].topic_message_counts = {1};
+  init({{1, 2}, {}, {3}}, {true, false, true});
+
+  EXPECT_THAT(reader_->get_topic_message_count("topic"), Eq(3u));
+  EXPECT_THAT(reader_->read_topic_message("topic", 2)->time_stamp, Eq(3));
+}
+
+TEST_F(RandomAccessReaderTest, finds_messages_of_a_topic_by_time)
+{
+  init({{10, 20, 30}, {40}, {50, 60}});
+
+  EXPECT_THAT(reader_->find_topic_message("topic", 0), Eq(0u));
+  EXPECT_THAT(reader_->find_topic_message("topic", 30), Eq(2u));
+  EXPECT_THAT(reader_->find_topic_message("topic", 35), Eq(3u));
+  EXPECT_THAT(reader_->find_topic_message("topic", 61), Eq(6u));
+
+  EXPECT_THAT(reader_->read_nearest_topic_message("topic", 0)->time_stamp, Eq(10));
+  EXPECT_THAT(reader_->read_nearest_topic_message("topic", 44)->time_stamp, Eq(40));
+  EXPECT_THAT(reader_->read_nearest_topic_message("topic", 46)->time_stamp, Eq(50));
+  EXPECT_THAT(reader_->read_nearest_topic_message("topic", 45)->time_stamp, Eq(40));
+  EXPECT_THAT(reader_->read_nearest_topic_message("topic", 100)->time_stamp, Eq(60));
+  EXPECT_THAT(reader_->read_nearest_topic_message("other_topic", 10), IsNull());
+}
+
+TEST_F(RandomAccessReaderTest, compressed_bags_are_not_supported)
+{
+  metadata_.compression_format = "zstd";
+  metadata_.compression_mode = "FILE";
+
+  EXPECT_THROW(init({{}, {}, {}}, {true, false, false}), std::runtime_error);
+}
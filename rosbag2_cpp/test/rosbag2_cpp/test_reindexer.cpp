@@ -0,0 +1,241 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/reindexer.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+rosbag2_storage::BagMetadata make_file_metadata(
+  std::vector<rosbag2_storage::TopicInformation> topics, int64_t starting_time_ns,
+  int64_t duration_ns)
+{
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.message_count = 0;
+  for (const auto & topic : topics) {
+    metadata.message_count += topic.message_count;
+  }
+  metadata.topics_with_message_count = std::move(topics);
+  metadata.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+    std::chrono::nanoseconds(starting_time_ns));
+  metadata.duration = std::chrono::nanoseconds(duration_ns);
+  metadata.bag_size = 100;
+  return metadata;
+}
+}  // namespace
+
+class ReindexerTest : public TemporaryDirectoryFixture
+{
+public:
+  ReindexerTest()
+  {
+    storage_factory_ = std::make_unique<StrictMock<MockStorageFactory>>();
+    metadata_io_ = std::make_unique<NiceMock<MockMetadataIo>>();
+
+    ON_CALL(*storage_factory_, open_read_only(_, _)).WillByDefault(
+      [this](const std::string & uri, const std::string &) {
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        ON_CALL(*storage, get_metadata()).WillByDefault(Return(file_metadata_.at(uri)));
+        return storage;
+      });
+    ON_CALL(*metadata_io_, write_metadata(_, _)).WillByDefault(
+      [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+        written_metadata_ = metadata;
+      });
+  }
+
+  std::string get_path(const std::string & relative_file_path) const
+  {
+    return (rcpputils::fs::path(temporary_dir_path_) / relative_file_path).string();
+  }
+
+  std::unique_ptr<StrictMock<MockStorageFactory>> storage_factory_;
+  std::unique_ptr<MockMetadataIo> metadata_io_;
+  std::map<std::string, rosbag2_storage::BagMetadata> file_metadata_;
+  rosbag2_storage::BagMetadata written_metadata_;
+};
+
+TEST_F(ReindexerTest, metadata_is_merged_from_the_summaries_of_all_files) {
+  file_metadata_[get_path("bag_0.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 10}}, 1000, 500);
+  file_metadata_[get_path("bag_1.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 5}, {{"/odom", "nav_msgs/Odometry", "cdr", ""}, 2}},
+    1500, 1000);
+  file_metadata_[get_path("bag_2.db3")] = make_file_metadata({}, 0, 0);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(3);
+  EXPECT_CALL(*metadata_io_, write_metadata(temporary_dir_path_, _)).Times(1);
+
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  const auto metadata = reindexer.reindex(
+    temporary_dir_path_, "sqlite3", {"bag_0.db3", "bag_1.db3", "bag_2.db3"}, 2);
+
+  EXPECT_THAT(written_metadata_.message_count, Eq(17u));
+  EXPECT_THAT(metadata.message_count, Eq(17u));
+  EXPECT_THAT(metadata.storage_identifier, Eq("sqlite3"));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre("bag_0.db3", "bag_1.db3", "bag_2.db3"));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch().count(), Eq(1000));
+  EXPECT_THAT(metadata.duration.count(), Eq(1500));
+  EXPECT_THAT(metadata.bag_size, Eq(300u));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(metadata.topics_with_message_count[0].topic_metadata.name, Eq("/tf"));
+  EXPECT_THAT(metadata.topics_with_message_count[0].message_count, Eq(15u));
+  EXPECT_THAT(metadata.topics_with_message_count[1].message_count, Eq(2u));
+  ASSERT_THAT(metadata.files, SizeIs(3u));
+  EXPECT_THAT(metadata.files[1].message_count, Eq(7u));
+  EXPECT_THAT(metadata.files[1].starting_time.time_since_epoch().count(), Eq(1500));
+  EXPECT_THAT(metadata.files[1].duration.count(), Eq(1000));
+  EXPECT_THAT(metadata.files[2].message_count, Eq(0u));
+  EXPECT_THAT(metadata.files[0].topics, IsEmpty());
+}
+
+TEST_F(ReindexerTest, existing_files_and_qos_profiles_of_the_old_metadata_are_kept) {
+  // Written after the last file found, e.g. by a writer of a stripe directory.
+  {
+    std::ofstream fout(get_path("bag_1.db3"));
+    fout << "data";
+  }
+  rosbag2_storage::BagMetadata old_metadata{};
+  old_metadata.version = 6;
+  old_metadata.storage_identifier = "sqlite3";
+  old_metadata.relative_file_paths = {"bag_0.db3", "bag_1.db3", "missing_0.db3"};
+  old_metadata.files = {{"bag_0.db3", true}, {"bag_1.db3", false}, {"missing_0.db3", true}};
+  old_metadata.files[1].stripe = 1;
+  old_metadata.topics_with_message_count = {{{"/tf", "tf2_msgs/TFMessage", "cdr", "qos"}, 3}};
+  EXPECT_CALL(*metadata_io_, metadata_file_exists(temporary_dir_path_)).WillOnce(Return(true));
+  EXPECT_CALL(*metadata_io_, read_metadata(temporary_dir_path_)).WillOnce(Return(old_metadata));
+
+  file_metadata_[get_path("bag_0.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 10}}, 1000, 500);
+  file_metadata_[get_path("bag_1.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 10}}, 1000, 500);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(2);
+
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  const auto metadata = reindexer.reindex(temporary_dir_path_, "", {"bag_0.db3"});
+
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre("bag_0.db3", "bag_1.db3"));
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_THAT(metadata.files[1].stripe, Eq(1u));
+  EXPECT_FALSE(metadata.files[1].indexed);
+  EXPECT_THAT(metadata.message_count, Eq(20u));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(1u));
+  EXPECT_THAT(
+    metadata.topics_with_message_count[0].topic_metadata.offered_qos_profiles, Eq("qos"));
+}
+
+TEST_F(ReindexerTest, files_of_topic_groups_list_their_topics) {
+  file_metadata_[get_path("bag_0.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 10}}, 1000, 500);
+  file_metadata_[get_path("camera/camera_0.db3")] = make_file_metadata(
+    {{{"/image", "sensor_msgs/Image", "cdr", ""}, 3}}, 1000, 500);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(2);
+
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  const auto metadata = reindexer.reindex(
+    temporary_dir_path_, "sqlite3", {"bag_0.db3", "camera/camera_0.db3"});
+
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_THAT(metadata.files[0].topics, ElementsAre("/tf"));
+  EXPECT_THAT(metadata.files[1].topics, ElementsAre("/image"));
+}
+
+TEST_F(ReindexerTest, reindex_throws_without_storage_id_or_metadata) {
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  EXPECT_THROW(
+    reindexer.reindex(temporary_dir_path_, "", {"bag_0.db3"}), std::invalid_argument);
+}
+
+TEST_F(ReindexerTest, reindex_throws_on_bags_compressed_per_file) {
+  rosbag2_storage::BagMetadata old_metadata{};
+  old_metadata.storage_identifier = "sqlite3";
+  old_metadata.compression_mode = "FILE";
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(old_metadata));
+
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  EXPECT_THROW(
+    reindexer.reindex(temporary_dir_path_, "", {"bag_0.db3.zstd"}), std::runtime_error);
+}
+
+TEST_F(ReindexerTest, files_of_shards_are_read_as_stripes) {
+  const auto bag_name = rcpputils::fs::path(temporary_dir_path_).filename().string();
+  const auto shard_file = bag_name + "_shard2_0.db3";
+  file_metadata_[get_path(bag_name + "_0.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 10}}, 1000, 500);
+  file_metadata_[get_path(shard_file)] = make_file_metadata(
+    {{{"/odom", "nav_msgs/Odometry", "cdr", ""}, 5}}, 1000, 500);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(2);
+
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  const auto metadata = reindexer.reindex(
+    temporary_dir_path_, "sqlite3", {bag_name + "_0.db3", shard_file});
+
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_THAT(metadata.files[0].stripe, Eq(0u));
+  EXPECT_THAT(metadata.files[1].stripe, Eq(2u));
+}
+
+TEST_F(ReindexerTest, summarize_does_not_write_the_metadata) {
+  file_metadata_[get_path("bag_0.db3")] = make_file_metadata(
+    {{{"/tf", "tf2_msgs/TFMessage", "cdr", ""}, 10}}, 1000, 500);
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(1);
+  EXPECT_CALL(*metadata_io_, write_metadata(_, _)).Times(0);
+
+  rosbag2_cpp::Reindexer reindexer(std::move(storage_factory_), std::move(metadata_io_));
+  const auto metadata = reindexer.summarize(temporary_dir_path_, "sqlite3", {"bag_0.db3"});
+
+  EXPECT_THAT(metadata.message_count, Eq(10u));
+}
+
+TEST_F(ReindexerTest, bagfiles_named_after_their_folder_are_found_in_order_of_their_index) {
+  const auto bag_directory = rcpputils::fs::path(temporary_dir_path_) / "bag";
+  const auto group_directory = bag_directory / "camera";
+  rcpputils::fs::create_directories(group_directory);
+  for (const auto & path : {
+      bag_directory / "bag_10.db3", bag_directory / "bag_2.db3", bag_directory / "bag_0.db3",
+      bag_directory / "bag_0.db3-journal", bag_directory / "metadata.yaml",
+      bag_directory / "other_1.db3", bag_directory / "bag_shard1_0.db3",
+      group_directory / "camera_0.db3.zstd"})
+  {
+    std::ofstream(path.string()) << "data";
+  }
+
+  EXPECT_THAT(
+    rosbag2_cpp::Reindexer::find_bagfiles(bag_directory.string() + "/"),
+    ElementsAre(
+      "bag_0.db3", "bag_2.db3", "bag_10.db3", "bag_shard1_0.db3",
+      (rcpputils::fs::path("camera") / "camera_0.db3.zstd").string()));
+}
@@ -14,6 +14,10 @@
 
 #include <gmock/gmock.h>
 
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -151,3 +155,268 @@ TEST_F(SequentialReaderTest, set_filter_calls_storage) {
   reader_->get_implementation_handle().reset_filter();
   reader_->read_next();
 }
+
+TEST_F(SequentialReaderTest, for_each_passes_the_filtered_messages_of_the_storage_as_views) {
+  uint8_t bytes[] = {1, 2, 3};
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "topic";
+  message->time_stamp = 42;
+  message->serialized_data = std::make_shared<rcutils_uint8_array_t>();
+  message->serialized_data->buffer = bytes;
+  message->serialized_data->buffer_length = sizeof(bytes);
+  size_t remaining_messages = 3;
+  ON_CALL(*storage_, has_next()).WillByDefault(
+    [&remaining_messages]() {return remaining_messages > 0;});
+  EXPECT_CALL(*storage_, read_next()).Times(3).WillRepeatedly(
+    [&remaining_messages, message]() {
+      --remaining_messages;
+      return message;
+    });
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics.push_back("topic");
+  EXPECT_CALL(*storage_, set_filter(_)).WillOnce(
+    [&storage_filter](const rosbag2_storage::StorageFilter & filter) {
+      EXPECT_THAT(filter.topics, ContainerEq(storage_filter.topics));
+    });
+
+  reader_->open(default_storage_options_, {"", storage_serialization_format_});
+  size_t message_count = 0;
+  reader_->for_each(
+    [&message_count, &bytes](const rosbag2_storage::SerializedBagMessageView & view) {
+      ++message_count;
+      EXPECT_THAT(*view.topic_name, StrEq("topic"));
+      EXPECT_THAT(view.time_stamp, Eq(42));
+      EXPECT_THAT(view.serialized_data.data, Eq(bytes));
+      EXPECT_THAT(view.serialized_data.size, Eq(sizeof(bytes)));
+    }, storage_filter);
+
+  EXPECT_THAT(message_count, Eq(3u));
+  EXPECT_FALSE(reader_->has_next());
+}
+
+TEST_F(SequentialReaderTest, seek_sets_the_filter_start_time_of_storages_which_cannot_seek) {
+  EXPECT_CALL(*storage_, get_capabilities())
+  .WillRepeatedly(Return(rosbag2_storage::StorageCapabilities{}));
+  EXPECT_CALL(*storage_, seek(_)).Times(0);
+  EXPECT_CALL(*storage_, set_filter(_)).Times(AnyNumber());
+  reader_->open(default_storage_options_, {"", storage_serialization_format_});
+
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics.push_back("topic");
+  storage_filter.start_time = 10;
+  EXPECT_CALL(
+    *storage_, set_filter(
+      AllOf(
+        Field(&rosbag2_storage::StorageFilter::topics, ElementsAre("topic")),
+        Field(&rosbag2_storage::StorageFilter::start_time, 20))));
+  reader_->get_implementation_handle().set_filter(storage_filter);
+  reader_->seek(20);
+
+  // The seek time still holds after the filter is reset.
+  EXPECT_CALL(*storage_, reset_filter()).Times(0);
+  EXPECT_CALL(
+    *storage_, set_filter(
+      AllOf(
+        Field(&rosbag2_storage::StorageFilter::topics, IsEmpty()),
+        Field(&rosbag2_storage::StorageFilter::start_time, 20))));
+  reader_->get_implementation_handle().reset_filter();
+}
+
+TEST(SequentialReaderFileSelectionTest, files_outside_of_the_filter_are_not_opened) {
+  const auto storage_uri = rcpputils::fs::temp_directory_path();
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"file_0", "file_1", "file_2", "file_3"};
+  metadata.topics_with_message_count.push_back({{"/a", "test_msgs/BasicTypes", "cdr", ""}, 3});
+  metadata.topics_with_message_count.push_back({{"/b", "test_msgs/BasicTypes", "cdr", ""}, 1});
+  const std::vector<std::pair<int64_t, std::string>> file_ranges{
+    {0, "/a"}, {100, "/a"}, {200, "/b"}, {300, "/a"}};
+  for (size_t i = 0; i < file_ranges.size(); ++i) {
+    rosbag2_storage::FileInformation file{};
+    file.path = metadata.relative_file_paths[i];
+    file.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::nanoseconds(file_ranges[i].first + 1));
+    file.duration = std::chrono::nanoseconds(50);
+    file.topics = {file_ranges[i].second};
+    file.topic_message_counts = {1};
+    metadata.files.push_back(file);
+  }
+  auto metadata_io = std::make_unique<NiceMock<MockMetadataIo>>();
+  ON_CALL(*metadata_io, metadata_file_exists(_)).WillByDefault(Return(true));
+  ON_CALL(*metadata_io, read_metadata(_)).WillByDefault(Return(metadata));
+
+  // Every file holds a single message.
+  std::vector<std::string> opened_files;
+  auto storage_factory = std::make_unique<NiceMock<MockStorageFactory>>();
+  ON_CALL(*storage_factory, open_read_only(_, _)).WillByDefault(
+    [&opened_files](const std::string & path, const std::string &) {
+      opened_files.push_back(rcpputils::fs::path(path).filename().string());
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      auto has_message = std::make_shared<bool>(true);
+      ON_CALL(*storage, has_next()).WillByDefault(
+        [has_message]() {
+          return *has_message;
+        });
+      ON_CALL(*storage, read_next()).WillByDefault(
+        [has_message]() {
+          *has_message = false;
+          return std::make_shared<rosbag2_storage::SerializedBagMessage>();
+        });
+      return storage;
+    });
+
+  rosbag2_cpp::readers::SequentialReader reader(
+    std::move(storage_factory), nullptr, std::move(metadata_io));
+  reader.open({storage_uri.string(), ""}, {"", "cdr"});
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"/a"};
+  storage_filter.start_time = 120;
+  reader.set_filter(storage_filter);
+  size_t message_count = 0;
+  while (reader.has_next()) {
+    reader.read_next();
+    ++message_count;
+  }
+
+  // The first file is opened with the bag, the third one holds no message of /a.
+  EXPECT_THAT(opened_files, ElementsAre("file_0", "file_1", "file_3"));
+  EXPECT_EQ(message_count, 2u);
+}
+
+TEST(SequentialReaderFileSelectionTest, latest_messages_are_read_from_files_before_the_time) {
+  const auto storage_uri = rcpputils::fs::temp_directory_path();
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"file_0", "file_1", "file_2", "file_3"};
+  metadata.topics_with_message_count.push_back({{"/a", "test_msgs/BasicTypes", "cdr", ""}, 3});
+  metadata.topics_with_message_count.push_back({{"/b", "test_msgs/BasicTypes", "cdr", ""}, 2});
+  const std::vector<std::pair<int64_t, std::vector<std::string>>> file_ranges{
+    {0, {"/a", "/b"}}, {100, {"/a"}}, {200, {"/b"}}, {300, {"/a"}}};
+  for (size_t i = 0; i < file_ranges.size(); ++i) {
+    rosbag2_storage::FileInformation file{};
+    file.path = metadata.relative_file_paths[i];
+    file.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::nanoseconds(file_ranges[i].first + 1));
+    file.duration = std::chrono::nanoseconds(50);
+    file.topics = file_ranges[i].second;
+    file.topic_message_counts = std::vector<uint64_t>(file.topics.size(), 1);
+    metadata.files.push_back(file);
+  }
+  auto metadata_io = std::make_unique<NiceMock<MockMetadataIo>>();
+  ON_CALL(*metadata_io, metadata_file_exists(_)).WillByDefault(Return(true));
+  ON_CALL(*metadata_io, read_metadata(_)).WillByDefault(Return(metadata));
+
+  // The latest message of every topic in a file is 10 ns after the start of the file.
+  std::vector<std::string> queried_files;
+  auto storage_factory = std::make_unique<NiceMock<MockStorageFactory>>();
+  ON_CALL(*storage_factory, open_read_only(_, _)).WillByDefault(
+    [&queried_files](const std::string & path, const std::string &) {
+      const auto file_name = rcpputils::fs::path(path).filename().string();
+      const auto file_index = std::stoi(file_name.substr(file_name.size() - 1));
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, read_latest_messages(_, _)).WillByDefault(
+        [&queried_files, file_name, file_index](
+          const std::vector<std::string> & topic_names, const rcutils_time_point_value_t &) {
+          queried_files.push_back(file_name);
+          std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+          for (const auto & topic_name : topic_names) {
+            auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+            message->topic_name = topic_name;
+            message->time_stamp = file_index * 100 + 11;
+            messages.push_back(message);
+          }
+          return messages;
+        });
+      return storage;
+    });
+
+  rosbag2_cpp::readers::SequentialReader reader(
+    std::move(storage_factory), nullptr, std::move(metadata_io));
+  reader.open({storage_uri.string(), ""}, {"", "cdr"});
+  const auto messages = reader.read_latest_messages({"/a", "/b", "/c"}, 250);
+
+  // The last file starts after the time, the first one ends before the messages found later.
+  EXPECT_THAT(queried_files, ElementsAre("file_2", "file_1"));
+  ASSERT_THAT(messages, SizeIs(2));
+  EXPECT_EQ(messages[0]->topic_name, "/a");
+  EXPECT_EQ(messages[0]->time_stamp, 111);
+  EXPECT_EQ(messages[1]->topic_name, "/b");
+  EXPECT_EQ(messages[1]->time_stamp, 211);
+}
+
+TEST(SequentialReaderFollowTest, messages_and_files_are_read_as_they_are_recorded) {
+  const auto bag_directory = rcpputils::fs::temp_directory_path() / "followed_bag";
+  rcpputils::fs::create_directories(bag_directory);
+  const auto yaml_file = bag_directory / rosbag2_storage::MetadataIo::metadata_filename;
+  rcpputils::fs::remove(yaml_file);
+  rosbag2_storage::BagMetadata metadata;
+  metadata.relative_file_paths = {"file_0"};
+  metadata.topics_with_message_count.push_back({{"/a", "test_msgs/BasicTypes", "cdr", ""}, 1});
+
+  // Time stamps of the messages of every file, which are committed when polled.
+  struct RecordedFile
+  {
+    std::deque<int64_t> committed;
+    std::deque<int64_t> pending;
+  };
+  std::map<std::string, RecordedFile> files;
+  files["file_0"].committed = {1};
+  // Every read of the metadata records a step, which the reader sees after polling.
+  size_t step = 0;
+  auto metadata_io = std::make_unique<NiceMock<MockMetadataIo>>();
+  ON_CALL(*metadata_io, metadata_file_exists(_)).WillByDefault(Return(true));
+  ON_CALL(*metadata_io, read_metadata(_)).WillByDefault(
+    [&metadata, &files, &step, &yaml_file](const std::string &) {
+      ++step;
+      if (step == 2) {
+        files["file_0"].pending.push_back(2);
+      } else if (step == 3) {
+        metadata.relative_file_paths.push_back("file_1");
+        files["file_0"].pending.push_back(3);
+        files["file_1"].pending.push_back(4);
+      } else if (step == 4) {
+        files["file_1"].pending.push_back(5);
+        std::ofstream{yaml_file.string()};
+      }
+      return metadata;
+    });
+
+  auto storage_factory = std::make_unique<NiceMock<MockStorageFactory>>();
+  ON_CALL(*storage_factory, open_read_only(_, _)).WillByDefault(
+    [&files](const std::string & path, const std::string &) {
+      auto & file = files[rcpputils::fs::path(path).filename().string()];
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, has_next()).WillByDefault(
+        [&file]() {return !file.committed.empty();});
+      ON_CALL(*storage, read_next()).WillByDefault(
+        [&file]() {
+          auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+          message->topic_name = "/a";
+          message->time_stamp = file.committed.front();
+          file.committed.pop_front();
+          return message;
+        });
+      ON_CALL(*storage, poll_new_messages()).WillByDefault(
+        [&file]() {
+          file.committed.insert(file.committed.end(), file.pending.begin(), file.pending.end());
+          file.pending.clear();
+          return !file.committed.empty();
+        });
+      return storage;
+    });
+
+  rosbag2_cpp::readers::SequentialReader reader(
+    std::move(storage_factory), nullptr, std::move(metadata_io));
+  rosbag2_cpp::StorageOptions storage_options{bag_directory.string(), ""};
+  storage_options.follow_poll_interval_ms = 1;
+  reader.open(storage_options, {"", "cdr"});
+  std::vector<int64_t> time_stamps;
+  while (reader.has_next()) {
+    time_stamps.push_back(reader.read_next()->time_stamp);
+  }
+
+  // The rest of the first file is read before the file recorded after it.
+  EXPECT_THAT(time_stamps, ElementsAre(1, 2, 3, 4, 5));
+  EXPECT_THAT(reader.get_metadata().relative_file_paths, SizeIs(2u));
+
+  rcpputils::fs::remove(yaml_file);
+  rcpputils::fs::remove(bag_directory);
+}
@@ -14,17 +14,26 @@
 
 #include <gmock/gmock.h>
 
+#include <chrono>
+#include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
+#include "rosbag2_cpp/memory_budget.hpp"
 #include "rosbag2_cpp/writers/sequential_writer.hpp"
 #include "rosbag2_cpp/writer.hpp"
 
 #include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/message_histogram.hpp"
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
 #include "rosbag2_storage/topic_metadata.hpp"
 
 #include "mock_converter.hpp"
@@ -255,6 +264,491 @@ TEST_F(SequentialWriterTest, writer_splits_when_storage_bagfile_size_gt_max_bagf
   }
 }
 
+TEST_F(SequentialWriterTest, writer_with_deferred_indices_reports_all_closed_files_indexed) {
+  const int message_count = 15;
+  const int max_bagfile_size = 5;
+  fake_storage_size_ = 0;
+
+  ON_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+    [this](std::shared_ptr<const rosbag2_storage::SerializedBagMessage>) {
+      fake_storage_size_ += 1;
+    });
+  ON_CALL(*storage_, get_bagfile_size).WillByDefault(
+    [this]() {
+      return fake_storage_size_;
+    });
+  ON_CALL(*storage_, get_relative_file_path).WillByDefault(
+    [this]() {
+      return fake_storage_uri_;
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+
+  storage_options_.max_bagfile_size = max_bagfile_size;
+  storage_options_.defer_index_creation = true;
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (auto i = 0; i < message_count; ++i) {
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(fake_metadata_.files, SizeIs(fake_metadata_.relative_file_paths.size()));
+  EXPECT_THAT(fake_metadata_.files, SizeIs(3u));
+  for (size_t i = 0; i < fake_metadata_.files.size(); ++i) {
+    EXPECT_EQ(fake_metadata_.files[i].path, fake_metadata_.relative_file_paths[i]);
+    EXPECT_TRUE(fake_metadata_.files[i].indexed);
+  }
+}
+
+TEST_F(SequentialWriterTest, writer_splits_by_message_count_and_notifies_closed_files) {
+  ON_CALL(*storage_, get_relative_file_path).WillByDefault(
+    [this]() {
+      return fake_storage_uri_;
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  std::vector<rosbag2_cpp::bag_events::BagSplitInfo> splits;
+  rosbag2_cpp::bag_events::WriterEventCallbacks callbacks;
+  callbacks.write_split_callback = [&splits](const rosbag2_cpp::bag_events::BagSplitInfo & info) {
+      splits.push_back(info);
+    };
+  writer_->add_event_callbacks(callbacks);
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+
+  storage_options_.max_bagfile_messages = 5;
+  storage_options_.max_cache_size = 2;
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (auto i = 0; i < 15; ++i) {
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_THAT(fake_metadata_.relative_file_paths, ElementsAre("uri_0", "uri_1", "uri_2"));
+  ASSERT_THAT(splits, SizeIs(3u));
+  EXPECT_EQ(splits[0].closed_file, "uri/uri_0");
+  EXPECT_EQ(splits[0].opened_file, "uri/uri_1");
+  EXPECT_EQ(splits[1].closed_file, "uri/uri_1");
+  EXPECT_EQ(splits[1].opened_file, "uri/uri_2");
+  EXPECT_EQ(splits[2].closed_file, "uri/uri_2");
+  EXPECT_EQ(splits[2].opened_file, "");
+}
+
+TEST_F(SequentialWriterTest, metadata_checkpoints_are_written_on_open_and_every_split) {
+  ON_CALL(*storage_, get_relative_file_path).WillByDefault(
+    [this]() {
+      return fake_storage_uri_;
+    });
+  std::vector<rosbag2_storage::BagMetadata> checkpoints;
+  // Checkpoints are appended, only the metadata written when closing replaces them.
+  EXPECT_CALL(*metadata_io_, append_metadata("uri", _)).Times(3).WillRepeatedly(
+    [&checkpoints](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      checkpoints.push_back(metadata);
+    });
+  EXPECT_CALL(*metadata_io_, write_metadata("uri", _)).Times(1).WillRepeatedly(
+    [&checkpoints](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      checkpoints.push_back(metadata);
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+
+  storage_options_.max_bagfile_messages = 5;
+  // Long enough to never be reached by the test.
+  storage_options_.metadata_checkpoint_interval_ms = 3600000;
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (auto i = 0; i < 12; ++i) {
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(checkpoints, SizeIs(4u));
+  EXPECT_THAT(checkpoints[0].message_count, Eq(0u));
+  EXPECT_THAT(checkpoints[1].relative_file_paths, ElementsAre("uri_0", "uri_1"));
+  EXPECT_THAT(checkpoints[1].message_count, Eq(5u));
+  ASSERT_THAT(checkpoints[2].files, SizeIs(3u));
+  EXPECT_THAT(checkpoints[2].message_count, Eq(10u));
+  EXPECT_THAT(checkpoints[2].files[0].message_count, Eq(5u));
+  EXPECT_THAT(checkpoints[2].files[1].message_count, Eq(5u));
+  EXPECT_THAT(checkpoints[2].files[2].message_count, Eq(0u));
+  EXPECT_THAT(checkpoints[3].message_count, Eq(12u));
+  ASSERT_THAT(checkpoints[3].files, SizeIs(3u));
+  EXPECT_THAT(checkpoints[3].files[2].message_count, Eq(2u));
+}
+
+TEST_F(SequentialWriterTest, files_list_their_topics_message_counts_and_sizes) {
+  const auto bag_directory = rcpputils::fs::temp_directory_path() / "file_topics_test_bag";
+  rcpputils::fs::create_directories(bag_directory);
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [](const std::string & uri, const std::string &) {
+      // Every bagfile has 4 bytes on disk.
+      std::ofstream(uri) << "data";
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+      return storage;
+    });
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(bag_directory.string(), _))
+  .WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = bag_directory.string();
+  storage_options_.max_bagfile_messages = 3;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"/a", "test_msgs/BasicTypes", "", ""});
+  writer_->create_topic({"/b", "test_msgs/BasicTypes", "", ""});
+  for (const auto & topic : {"/a", "/b", "/a", "/a"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic;
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_THAT(metadata.files[0].topics, ElementsAre("/a", "/b"));
+  EXPECT_THAT(metadata.files[0].topic_message_counts, ElementsAre(2u, 1u));
+  EXPECT_THAT(metadata.files[1].topics, ElementsAre("/a"));
+  EXPECT_THAT(metadata.files[1].topic_message_counts, ElementsAre(1u));
+  EXPECT_EQ(metadata.files[0].size, 4u);
+  EXPECT_EQ(metadata.files[1].size, 4u);
+  EXPECT_EQ(metadata.bag_size, 8u);
+
+  for (const auto & file : metadata.relative_file_paths) {
+    rcpputils::fs::remove(bag_directory / file);
+  }
+  rcpputils::fs::remove(bag_directory);
+}
+
+TEST_F(SequentialWriterTest, retention_deletes_the_oldest_closed_files_beyond_the_size_limit) {
+  const auto bag_directory = rcpputils::fs::temp_directory_path() / "retention_size_test_bag";
+  rcpputils::fs::create_directories(bag_directory);
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [](const std::string & uri, const std::string &) {
+      // Every bagfile has 4 bytes on disk.
+      std::ofstream(uri) << "data";
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+      return storage;
+    });
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(bag_directory.string(), _))
+  .WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = bag_directory.string();
+  storage_options_.max_bagfile_messages = 1;
+  storage_options_.retention_max_bytes = 8;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  const std::string data = "data";
+  for (rcutils_time_point_value_t time_stamp = 1; time_stamp <= 5; ++time_stamp) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    message->time_stamp = time_stamp;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  const auto bag_name = bag_directory.filename().string();
+  EXPECT_THAT(
+    metadata.relative_file_paths,
+    ElementsAre(bag_name + "_2", bag_name + "_3", bag_name + "_4"));
+  EXPECT_FALSE((bag_directory / (bag_name + "_0")).exists());
+  EXPECT_FALSE((bag_directory / (bag_name + "_1")).exists());
+  EXPECT_EQ(metadata.message_count, 3u);
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(1u));
+  EXPECT_EQ(metadata.topics_with_message_count[0].message_count, 3u);
+  EXPECT_EQ(metadata.topics_with_message_count[0].total_size, 12u);
+  EXPECT_EQ(metadata.starting_time.time_since_epoch(), std::chrono::nanoseconds(3));
+  EXPECT_EQ(metadata.duration, std::chrono::nanoseconds(2));
+  EXPECT_EQ(metadata.bag_size, 12u);
+
+  for (const auto & file : metadata.relative_file_paths) {
+    rcpputils::fs::remove(bag_directory / file);
+  }
+  rcpputils::fs::remove(bag_directory);
+}
+
+TEST_F(SequentialWriterTest, retention_hands_files_beyond_the_age_limit_to_the_callback) {
+  ON_CALL(*storage_, get_relative_file_path).WillByDefault(
+    [this]() {
+      return fake_storage_uri_;
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  std::mutex retired_files_mutex;
+  std::vector<std::string> retired_files;
+  rosbag2_cpp::bag_events::WriterEventCallbacks callbacks;
+  callbacks.write_retire_callback =
+    [&](const rosbag2_cpp::bag_events::BagRetireInfo & info) {
+      std::lock_guard<std::mutex> lock(retired_files_mutex);
+      retired_files.push_back(info.retired_file);
+    };
+  writer_->add_event_callbacks(callbacks);
+
+  storage_options_.max_bagfile_duration = 1;
+  storage_options_.retention_max_age = 1;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  // One file per second. On the last split, the newest message is 2 s after the first file.
+  for (const auto seconds : {0, 1, 2, 3}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    message->time_stamp = std::chrono::nanoseconds(std::chrono::seconds(seconds)).count();
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_THAT(retired_files, ElementsAre("uri/uri_0"));
+  EXPECT_THAT(fake_metadata_.relative_file_paths, ElementsAre("uri_1", "uri_2", "uri_3"));
+  EXPECT_EQ(fake_metadata_.message_count, 3u);
+}
+
+TEST_F(SequentialWriterTest, retention_needs_splitting) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.retention_max_bytes = 1024;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, retention_rejects_large_message_data_files) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.max_bagfile_size = 1024;
+  storage_options_.retention_max_bytes = 4096;
+  storage_options_.large_message_threshold = 256;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, staged_files_are_moved_to_the_bag_directory_once_closed) {
+  const auto bag_directory = rcpputils::fs::temp_directory_path() / "staged_test_bag";
+  const auto staging_directory = rcpputils::fs::temp_directory_path() / "staging_test_directory";
+  rcpputils::fs::create_directories(bag_directory);
+  std::vector<std::string> opened_files;
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [&opened_files](const std::string & uri, const std::string &) {
+      opened_files.push_back(uri);
+      std::ofstream(uri) << "data";
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+      return storage;
+    });
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(bag_directory.string(), _))
+  .WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  std::vector<std::string> closed_files;
+  rosbag2_cpp::bag_events::WriterEventCallbacks callbacks;
+  callbacks.write_split_callback =
+    [&closed_files](const rosbag2_cpp::bag_events::BagSplitInfo & info) {
+      closed_files.push_back(info.closed_file);
+    };
+  writer_->add_event_callbacks(callbacks);
+
+  storage_options_.uri = bag_directory.string();
+  storage_options_.max_bagfile_messages = 1;
+  storage_options_.staging_directory = staging_directory.string();
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (auto i = 0; i < 2; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  const auto staging_folder = staging_directory / "staged_test_bag";
+  EXPECT_THAT(
+    opened_files,
+    ElementsAre(
+      (staging_folder / "staged_test_bag_0").string(),
+      (staging_folder / "staged_test_bag_1").string()));
+  EXPECT_THAT(
+    metadata.relative_file_paths, ElementsAre("staged_test_bag_0", "staged_test_bag_1"));
+  EXPECT_THAT(
+    closed_files,
+    ElementsAre(
+      (bag_directory / "staged_test_bag_0").string(),
+      (bag_directory / "staged_test_bag_1").string()));
+  for (const auto & file : metadata.relative_file_paths) {
+    EXPECT_TRUE((bag_directory / file).exists());
+    EXPECT_FALSE((staging_folder / file).exists());
+    rcpputils::fs::remove(bag_directory / file);
+  }
+  EXPECT_EQ(metadata.bag_size, 8u);
+  rcpputils::fs::remove(bag_directory);
+  rcpputils::fs::remove(staging_folder);
+  rcpputils::fs::remove(staging_directory);
+}
+
+TEST_F(SequentialWriterTest, open_throws_error_on_relative_staging_directory) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.staging_directory = "relative/staging";
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, topics_count_their_messages_and_bytes_per_time_bucket) {
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(_, _)).WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"/a", "test_msgs/BasicTypes", "", ""});
+  const auto bucket_duration = rosbag2_storage::kInitialHistogramBucketDuration.count();
+  const std::string data = "data";
+  for (const auto time_stamp : {bucket_duration, bucket_duration + 1, 3 * bucket_duration}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "/a";
+    message->time_stamp = time_stamp;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(1u));
+  const auto & histogram = metadata.topics_with_message_count[0].histogram;
+  EXPECT_EQ(histogram.starting_time.time_since_epoch(), std::chrono::nanoseconds(bucket_duration));
+  EXPECT_EQ(histogram.bucket_duration, rosbag2_storage::kInitialHistogramBucketDuration);
+  EXPECT_THAT(histogram.message_counts, ElementsAre(2u, 0u, 1u));
+  EXPECT_THAT(histogram.sizes, ElementsAre(8u, 0u, 4u));
+}
+
+TEST_F(SequentialWriterTest, writer_splits_by_duration) {
+  ON_CALL(*storage_, get_relative_file_path).WillByDefault(
+    [this]() {
+      return fake_storage_uri_;
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.max_bagfile_duration = 2;
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (auto i = 0; i < 6; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    message->time_stamp = i * 1000000000LL;  // one message per second
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_THAT(fake_metadata_.relative_file_paths, SizeIs(3u));
+  ASSERT_THAT(fake_metadata_.files, SizeIs(3u));
+  for (size_t i = 0; i < fake_metadata_.files.size(); ++i) {
+    EXPECT_EQ(
+      fake_metadata_.files[i].starting_time.time_since_epoch(), std::chrono::seconds(2 * i));
+    EXPECT_EQ(fake_metadata_.files[i].duration, std::chrono::seconds(1));
+  }
+}
+
+TEST_F(SequentialWriterTest, writer_switches_to_precreated_bagfile_on_split) {
+  std::mutex opened_uris_mutex;
+  std::vector<std::string> opened_uris;
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [&opened_uris_mutex, &opened_uris](const std::string & uri, const std::string &) {
+      {
+        std::lock_guard<std::mutex> lock(opened_uris_mutex);
+        opened_uris.push_back(uri);
+      }
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path).WillByDefault(Return(uri));
+      EXPECT_CALL(*storage, create_topic(_)).Times(1);
+      return storage;
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+
+  storage_options_.max_bagfile_messages = 2;
+  storage_options_.precreate_next_bagfile = true;
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (auto i = 0; i < 5; ++i) {
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  // The last precreated bagfile is unused and not part of the bag.
+  EXPECT_THAT(fake_metadata_.relative_file_paths, ElementsAre("uri_0", "uri_1", "uri_2"));
+  EXPECT_THAT(opened_uris, ElementsAre("uri/uri_0", "uri/uri_1", "uri/uri_2", "uri/uri_3"));
+}
+
 TEST_F(SequentialWriterTest, only_write_after_cache_is_full) {
   const size_t counter = 1000;
   const uint64_t max_cache_size = 100;
@@ -287,34 +781,738 @@ TEST_F(SequentialWriterTest, only_write_after_cache_is_full) {
   }
 }
 
-TEST_F(SequentialWriterTest, do_not_use_cache_if_cache_size_is_zero) {
-  const size_t counter = 1000;
-  const uint64_t max_cache_size = 0;
+TEST_F(SequentialWriterTest, cache_is_written_when_byte_budget_is_reached) {
+  const size_t counter = 100;
+  const uint64_t message_size = 100;
+  const uint64_t max_cache_size_bytes = 1000;
 
   EXPECT_CALL(
     *storage_,
     write(An<const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> &>())).
-  Times(0);
+  Times(counter * message_size / max_cache_size_bytes);
   EXPECT_CALL(
     *storage_,
-    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).Times(counter);
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).Times(0);
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
 
   auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
     std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
   writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
 
-  std::string rmw_format = "rmw_format";
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+  message->serialized_data = std::make_shared<rcutils_uint8_array_t>();
+  message->serialized_data->buffer_length = message_size;
+
+  storage_options_.max_cache_size_bytes = max_cache_size_bytes;
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+
+  for (auto i = 0u; i < counter; ++i) {
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_EQ(fake_metadata_.cache_high_water_mark_bytes, max_cache_size_bytes);
+}
+
+TEST_F(SequentialWriterTest, cache_is_written_while_the_shared_memory_budget_is_exhausted) {
+  const size_t counter = 100;
+  const uint64_t message_size = 100;
+  const uint64_t memory_budget = 500;
+
+  EXPECT_CALL(
+    *storage_,
+    write(An<const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> &>())).
+  Times(counter * message_size / memory_budget);
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
 
   auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
   message->topic_name = "test_topic";
+  message->serialized_data = std::make_shared<rcutils_uint8_array_t>();
+  message->serialized_data->buffer_length = message_size;
 
-  storage_options_.max_bagfile_size = 0;
-  storage_options_.max_cache_size = max_cache_size;
+  storage_options_.max_cache_size_bytes = 1000;
+  rosbag2_cpp::MemoryBudget::get_shared().set_max_bytes(memory_budget);
 
-  writer_->open(storage_options_, {rmw_format, rmw_format});
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
   writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
 
   for (auto i = 0u; i < counter; ++i) {
     writer_->write(message);
+    EXPECT_LE(rosbag2_cpp::MemoryBudget::get_shared().get_usage().bytes, memory_budget);
+  }
+  writer_.reset();
+  rosbag2_cpp::MemoryBudget::get_shared().set_max_bytes(0);
+}
+
+TEST_F(SequentialWriterTest, do_not_use_cache_if_cache_size_is_zero) {
+  const size_t counter = 1000;
+  const uint64_t max_cache_size = 0;
+
+  EXPECT_CALL(
+    *storage_,
+    write(An<const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> &>())).
+  Times(0);
+  EXPECT_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).Times(counter);
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  std::string rmw_format = "rmw_format";
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+
+  storage_options_.max_bagfile_size = 0;
+  storage_options_.max_cache_size = max_cache_size;
+
+  writer_->open(storage_options_, {rmw_format, rmw_format});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+
+  for (auto i = 0u; i < counter; ++i) {
+    writer_->write(message);
+  }
+}
+
+TEST_F(SequentialWriterTest, writer_passes_its_topic_handles_to_the_storage) {
+  rosbag2_storage::TopicHandle storage_topic_handle = rosbag2_storage::INVALID_TOPIC_HANDLE;
+  EXPECT_CALL(*storage_, set_topic_handle("test_topic", _)).WillOnce(
+    [&storage_topic_handle](const std::string &, rosbag2_storage::TopicHandle handle) {
+      storage_topic_handle = handle;
+    });
+  std::shared_ptr<const rosbag2_storage::SerializedBagMessage> written_message;
+  EXPECT_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillOnce(
+    [&written_message](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+      written_message = message;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  std::string rmw_format = "rmw_format";
+
+  writer_->open(storage_options_, {rmw_format, rmw_format});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  const auto topic_handle = writer_->get_topic_handle("test_topic");
+  EXPECT_NE(topic_handle, rosbag2_storage::INVALID_TOPIC_HANDLE);
+  EXPECT_EQ(storage_topic_handle, topic_handle);
+  EXPECT_EQ(writer_->get_topic_handle("unknown_topic"), rosbag2_storage::INVALID_TOPIC_HANDLE);
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+  writer_->write(message);
+  // Messages without a handle are looked up by name, and left as they are.
+  EXPECT_EQ(message->topic_handle, rosbag2_storage::INVALID_TOPIC_HANDLE);
+  ASSERT_TRUE(written_message);
+  EXPECT_EQ(written_message->topic_handle, rosbag2_storage::INVALID_TOPIC_HANDLE);
+}
+
+TEST_F(SequentialWriterTest, repeated_messages_of_deduplicated_topics_are_written_without_data) {
+  std::vector<std::pair<std::string, size_t>> written_messages;
+  ON_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+    [&written_messages](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+      written_messages.emplace_back(message->topic_name, message->serialized_data->buffer_length);
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.deduplicate_topics = {"/map"};
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"/map", "nav_msgs/OccupancyGrid", "rmw_format", ""});
+  writer_->create_topic({"/scan", "sensor_msgs/LaserScan", "rmw_format", ""});
+
+  const std::string data = "the same data";
+  for (const auto & topic_name : {"/map", "/scan", "/map", "/scan"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_name;
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_THAT(
+    written_messages, ElementsAre(
+      Pair("/map", data.size()), Pair("/scan", data.size()), Pair("/map", 0u),
+      Pair("/scan", data.size())));
+  ASSERT_THAT(fake_metadata_.topics_with_message_count, SizeIs(2));
+  for (const auto & topic : fake_metadata_.topics_with_message_count) {
+    EXPECT_THAT(topic.deduplicated, Eq(topic.topic_metadata.name == "/map"));
+  }
+}
+
+TEST_F(SequentialWriterTest, messages_of_delta_encoded_topics_are_written_as_deltas) {
+  std::vector<std::vector<uint8_t>> written_data;
+  ON_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+    [&written_data](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+      const auto & data = *message->serialized_data;
+      written_data.emplace_back(data.buffer, data.buffer + data.buffer_length);
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.delta_encode_topics = {"/costmap"};
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"/costmap", "nav_msgs/OccupancyGrid", "rmw_format", ""});
+
+  std::string grid(1000, '\0');
+  for (rcutils_time_point_value_t time_stamp = 1; time_stamp <= 2; ++time_stamp) {
+    grid[static_cast<size_t>(time_stamp)] = 100;
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "/costmap";
+    message->time_stamp = time_stamp;
+    message->serialized_data = rosbag2_storage::make_serialized_message(grid.data(), grid.size());
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(written_data, SizeIs(2u));
+  EXPECT_THAT(
+    written_data[0][0], Eq(static_cast<uint8_t>(rosbag2_cpp::writers::DeltaFrameType::KEYFRAME)));
+  EXPECT_THAT(written_data[0], SizeIs(grid.size() + 1));
+  EXPECT_THAT(
+    written_data[1][0], Eq(static_cast<uint8_t>(rosbag2_cpp::writers::DeltaFrameType::DELTA)));
+  EXPECT_THAT(written_data[1].size(), Lt(grid.size() / 10));
+  ASSERT_THAT(fake_metadata_.topics_with_message_count, SizeIs(1u));
+  EXPECT_TRUE(fake_metadata_.topics_with_message_count[0].delta_encoded);
+}
+
+TEST_F(SequentialWriterTest, open_throws_error_on_topic_both_deduplicated_and_delta_encoded) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.deduplicate_topics = {"/map"};
+  storage_options_.delta_encode_topics = {"/map"};
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, clock_offset_moves_time_stamps_and_is_kept_with_the_bag_id) {
+  std::vector<std::pair<rcutils_time_point_value_t, rcutils_time_point_value_t>> written_stamps;
+  ON_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+    [&written_stamps](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+      written_stamps.emplace_back(message->time_stamp, message->publish_time_stamp);
+    });
+  ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+    [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+      fake_metadata_ = metadata;
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.bag_id = "run_1";
+  storage_options_.clock_offset_ns = -300;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = "test_topic";
+  message->time_stamp = 1000;
+  message->publish_time_stamp = 900;
+  writer_->write(message);
+  // Messages without publish time keep it unknown.
+  auto unstamped_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  unstamped_message->topic_name = "test_topic";
+  unstamped_message->time_stamp = 2000;
+  writer_->write(unstamped_message);
+  writer_.reset();
+
+  EXPECT_THAT(written_stamps, ElementsAre(Pair(700, 600), Pair(1700, 0)));
+  // The messages of the caller are left as they are.
+  EXPECT_THAT(message->time_stamp, Eq(1000));
+  EXPECT_THAT(fake_metadata_.bag_id, Eq("run_1"));
+  EXPECT_THAT(fake_metadata_.clock_offset, Eq(std::chrono::nanoseconds(-300)));
+  EXPECT_THAT(
+    fake_metadata_.starting_time,
+    Eq(std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(700))));
+}
+
+TEST_F(SequentialWriterTest, messages_within_the_reorder_window_are_written_in_order) {
+  std::vector<rcutils_time_point_value_t> written_timestamps;
+  ON_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+    [&written_timestamps](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+      written_timestamps.push_back(message->time_stamp);
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.reorder_window_ms = 1;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+
+  for (auto time_stamp : {1500000, 1000000, 1200000}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    message->time_stamp = time_stamp;
+    writer_->write(message);
+  }
+  // Nothing is written until a message is a full window older than the latest one.
+  EXPECT_THAT(written_timestamps, IsEmpty());
+  writer_.reset();
+
+  EXPECT_THAT(written_timestamps, ElementsAre(1000000, 1200000, 1500000));
+}
+
+TEST_F(SequentialWriterTest, snapshot_writes_only_the_messages_kept_within_the_duration) {
+  std::vector<rcutils_time_point_value_t> written_timestamps;
+  ON_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+    [&written_timestamps](std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+      written_timestamps.push_back(message->time_stamp);
+    });
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.snapshot_mode = true;
+  storage_options_.snapshot_duration = 2;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+
+  const rcutils_time_point_value_t second = 1000000000;
+  for (rcutils_time_point_value_t i = 0; i < 6; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    message->time_stamp = i * second;
+    writer_->write(message);
+  }
+  EXPECT_THAT(written_timestamps, IsEmpty());
+
+  EXPECT_TRUE(writer_->take_snapshot());
+  EXPECT_THAT(written_timestamps, ElementsAre(3 * second, 4 * second, 5 * second));
+
+  // The messages were handed over, so the next snapshot is empty.
+  written_timestamps.clear();
+  EXPECT_TRUE(writer_->take_snapshot());
+  EXPECT_THAT(written_timestamps, IsEmpty());
+}
+
+TEST_F(SequentialWriterTest, snapshot_mode_needs_a_size_or_duration_limit) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.snapshot_mode = true;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, preallocating_bagfiles_needs_a_maximum_bagfile_size) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.preallocate_bagfiles = true;
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, take_snapshot_does_nothing_outside_of_snapshot_mode) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  EXPECT_FALSE(writer_->take_snapshot());
+}
+
+TEST_F(SequentialWriterTest, stripes_share_the_messages_and_are_listed_in_the_metadata) {
+  std::unordered_map<std::string, size_t> messages_per_storage;
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [&messages_per_storage](const std::string & uri, const std::string &) {
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+      ON_CALL(
+        *storage,
+        write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+        [&messages_per_storage, uri](std::shared_ptr<const rosbag2_storage::SerializedBagMessage>) {
+          ++messages_per_storage[uri];
+        });
+      return storage;
+    });
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata("uri", _)).WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  const auto stripe_directory = rcpputils::fs::temp_directory_path() / "rosbag2_cpp_stripe";
+  const auto stripe_folder = stripe_directory / "uri";
+  storage_options_.stripe_directories = {stripe_directory.string()};
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  for (rcutils_time_point_value_t i = 0; i < 4; ++i) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = "test_topic";
+    message->time_stamp = i;
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  const auto stripe_file = (stripe_folder / "uri_0").string();
+  EXPECT_EQ(messages_per_storage[(rcpputils::fs::path("uri") / "uri_0").string()], 2u);
+  EXPECT_EQ(messages_per_storage[stripe_file], 2u);
+
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_EQ(metadata.files[0].stripe, 0u);
+  EXPECT_EQ(metadata.files[1].path, stripe_file);
+  EXPECT_EQ(metadata.files[1].stripe, 1u);
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre("uri_0", stripe_file));
+  EXPECT_EQ(metadata.message_count, 4u);
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(1u));
+  EXPECT_EQ(metadata.topics_with_message_count[0].message_count, 4u);
+  EXPECT_EQ(metadata.starting_time.time_since_epoch().count(), 0);
+  EXPECT_EQ(metadata.duration.count(), 3);
+
+  rcpputils::fs::remove(stripe_folder / rosbag2_storage::MetadataIo::metadata_filename);
+  rcpputils::fs::remove(stripe_folder / rosbag2_storage::MetadataIo::binary_metadata_filename);
+  rcpputils::fs::remove(stripe_folder);
+  rcpputils::fs::remove(stripe_directory);
+}
+
+TEST_F(SequentialWriterTest, shards_write_topics_of_their_own_into_the_bag_directory) {
+  std::unordered_map<std::string, std::vector<std::string>> topics_per_storage;
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [&topics_per_storage](const std::string & uri, const std::string &) {
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+      ON_CALL(
+        *storage,
+        write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+        [&topics_per_storage, uri](
+          std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+          topics_per_storage[uri].push_back(message->topic_name);
+        });
+      return storage;
+    });
+  const auto bag_directory = rcpputils::fs::temp_directory_path() / "rosbag2_cpp_shards";
+  rcpputils::fs::create_directories(bag_directory);
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(bag_directory.string(), _))
+  .WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.uri = bag_directory.string();
+  storage_options_.shards = 2;
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  for (const auto & topic : {"/a", "/b", "/c", "/d"}) {
+    writer_->create_topic({topic, "test_msgs/BasicTypes", "", ""});
+  }
+  for (const auto & topic : {"/a", "/b", "/c", "/d", "/a"}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic;
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  const auto shard_file = (bag_directory / "rosbag2_cpp_shards_shard1_0").string();
+  EXPECT_THAT(
+    topics_per_storage[(bag_directory / "rosbag2_cpp_shards_0").string()],
+    ElementsAre("/a", "/d", "/a"));
+  EXPECT_THAT(topics_per_storage[shard_file], ElementsAre("/b"));
+  EXPECT_THAT(
+    topics_per_storage[(bag_directory / "rosbag2_cpp_shards_shard2_0").string()],
+    ElementsAre("/c"));
+
+  ASSERT_THAT(metadata.files, SizeIs(3u));
+  EXPECT_EQ(metadata.files[0].stripe, 0u);
+  EXPECT_EQ(metadata.files[1].path, "rosbag2_cpp_shards_shard1_0");
+  EXPECT_EQ(metadata.files[1].stripe, 1u);
+  EXPECT_EQ(metadata.files[2].stripe, 2u);
+  EXPECT_EQ(metadata.message_count, 5u);
+
+  rcpputils::fs::remove(bag_directory);
+}
+
+TEST_F(SequentialWriterTest, open_throws_error_on_shards_with_stripe_directories) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.shards = 1;
+  storage_options_.stripe_directories = {
+    (rcpputils::fs::temp_directory_path() / "rosbag2_cpp_stripe").string()};
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+TEST_F(SequentialWriterTest, topic_groups_are_written_to_files_of_their_own) {
+  std::unordered_map<std::string, std::vector<std::string>> topics_per_storage;
+  ON_CALL(*storage_factory_, open_read_write(_, _)).WillByDefault(
+    [&topics_per_storage](const std::string & uri, const std::string &) {
+      auto storage = std::make_shared<NiceMock<MockStorage>>();
+      ON_CALL(*storage, get_relative_file_path()).WillByDefault(Return(uri));
+      ON_CALL(
+        *storage,
+        write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).WillByDefault(
+        [&topics_per_storage, uri](
+          std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) {
+          topics_per_storage[uri].push_back(message->topic_name);
+        });
+      return storage;
+    });
+  rosbag2_storage::BagMetadata metadata;
+  EXPECT_CALL(*metadata_io_, write_metadata(_, _)).WillOnce(SaveArg<1>(&metadata));
+
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  const auto bag_folder = rcpputils::fs::temp_directory_path() / "rosbag2_cpp_topic_groups";
+  storage_options_.uri = bag_folder.string();
+  storage_options_.topic_groups = {{"camera", "/camera/.*", 0}, {"large", "", 100}};
+  writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+  for (const auto & topic : {"/camera/image", "/tf", "/scan"}) {
+    writer_->create_topic({topic, "test_msgs/BasicTypes", "", ""});
+  }
+  const std::vector<std::pair<std::string, size_t>> messages = {
+    {"/camera/image", 10}, {"/tf", 10}, {"/scan", 200}, {"/scan", 10}};
+  for (const auto & topic_and_size : messages) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_and_size.first;
+    message->serialized_data = std::make_shared<rcutils_uint8_array_t>();
+    message->serialized_data->buffer_length = topic_and_size.second;
+    writer_->write(message);
+  }
+  writer_.reset();
+
+  EXPECT_THAT(topics_per_storage[(bag_folder / "rosbag2_cpp_topic_groups_0").string()],
+    ElementsAre("/tf"));
+  EXPECT_THAT(topics_per_storage[(bag_folder / "camera" / "camera_0").string()],
+    ElementsAre("/camera/image"));
+  // A topic stays in the group chosen by the size of its first message.
+  EXPECT_THAT(topics_per_storage[(bag_folder / "large" / "large_0").string()],
+    ElementsAre("/scan", "/scan"));
+
+  ASSERT_THAT(metadata.files, SizeIs(3u));
+  EXPECT_THAT(metadata.files[0].topics, ElementsAre("/tf"));
+  EXPECT_EQ(metadata.files[1].path, (rcpputils::fs::path("camera") / "camera_0").string());
+  EXPECT_THAT(metadata.files[1].topics, ElementsAre("/camera/image"));
+  EXPECT_EQ(metadata.files[2].path, (rcpputils::fs::path("large") / "large_0").string());
+  EXPECT_THAT(metadata.files[2].topics, ElementsAre("/scan"));
+  EXPECT_EQ(metadata.message_count, 4u);
+
+  rcpputils::fs::remove(bag_folder / "camera");
+  rcpputils::fs::remove(bag_folder / "large");
+  rcpputils::fs::remove(bag_folder);
+}
+
+TEST_F(SequentialWriterTest, topic_group_names_must_not_leave_the_bag_folder) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  for (const auto & name : {"..", "../camera", "cameras/front", ".", "cameras\\front"}) {
+    storage_options_.topic_groups = {{name, "/camera/.*", 0}};
+    EXPECT_THROW(
+      writer_->open(storage_options_, {"rmw_format", "rmw_format"}),
+      std::invalid_argument) << name;
+  }
+}
+
+TEST_F(SequentialWriterTest, open_throws_error_on_relative_stripe_directory) {
+  auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+    std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+  writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+  storage_options_.stripe_directories = {"stripe"};
+  EXPECT_THROW(
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"}), std::invalid_argument);
+}
+
+class SequentialWriterDoubleBufferedCacheTest : public SequentialWriterTest
+{
+public:
+  SequentialWriterDoubleBufferedCacheTest()
+  {
+    release_storage_ = release_storage_promise_.get_future().share();
+
+    using Messages = std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>;
+    ON_CALL(*storage_, write(An<const Messages &>()))
+    .WillByDefault(
+      [this](const Messages & msgs)
+      {
+        release_storage_.wait();
+        std::lock_guard<std::mutex> lock(written_mutex_);
+        for (const auto & msg : msgs) {
+          written_timestamps_.push_back(msg->time_stamp);
+        }
+      });
+
+    ON_CALL(*metadata_io_, write_metadata).WillByDefault(
+      [this](const std::string &, const rosbag2_storage::BagMetadata & metadata) {
+        fake_metadata_ = metadata;
+      });
+  }
+
+  void open_writer(rosbag2_cpp::CacheOverflowPolicy policy, uint64_t max_cache_size)
+  {
+    auto sequential_writer = std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+      std::move(storage_factory_), converter_factory_, std::move(metadata_io_));
+    sequential_writer_ = sequential_writer.get();
+    writer_ = std::make_unique<rosbag2_cpp::Writer>(std::move(sequential_writer));
+
+    storage_options_.max_cache_size = max_cache_size;
+    storage_options_.double_buffered_cache = true;
+    storage_options_.cache_overflow_policy = policy;
+
+    writer_->open(storage_options_, {"rmw_format", "rmw_format"});
+    writer_->create_topic({"test_topic", "test_msgs/BasicTypes", "", ""});
+  }
+
+  void write_message(
+    rcutils_time_point_value_t time_stamp, const std::string & topic_name = "test_topic")
+  {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_name;
+    message->time_stamp = time_stamp;
+    writer_->write(message);
+  }
+
+  std::promise<void> release_storage_promise_;
+  std::shared_future<void> release_storage_;
+  std::mutex written_mutex_;
+  std::vector<rcutils_time_point_value_t> written_timestamps_;
+  rosbag2_cpp::writers::SequentialWriter * sequential_writer_{nullptr};
+};
+
+TEST_F(SequentialWriterDoubleBufferedCacheTest, remaining_messages_are_written_on_reset) {
+  release_storage_promise_.set_value();
+  EXPECT_CALL(
+    *storage_,
+    write(An<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>>())).Times(0);
+
+  open_writer(rosbag2_cpp::CacheOverflowPolicy::BLOCK, 100);
+  for (auto i = 0; i < 250; ++i) {
+    write_message(i);
+  }
+  writer_.reset();
+
+  ASSERT_THAT(written_timestamps_, SizeIs(250u));
+  for (auto i = 0; i < 250; ++i) {
+    EXPECT_EQ(written_timestamps_[i], i);
+  }
+  ASSERT_THAT(fake_metadata_.topics_with_message_count, SizeIs(1u));
+  EXPECT_EQ(fake_metadata_.topics_with_message_count[0].message_count, 250u);
+}
+
+TEST_F(SequentialWriterDoubleBufferedCacheTest, drop_newest_discards_incoming_messages) {
+  open_writer(rosbag2_cpp::CacheOverflowPolicy::DROP_NEWEST, 2);
+
+  // The first two messages are handed to the I/O thread, which is blocked in the storage.
+  for (auto i = 1; i <= 5; ++i) {
+    write_message(i);
+  }
+  EXPECT_EQ(sequential_writer_->get_dropped_messages_count(), 1u);
+
+  release_storage_promise_.set_value();
+  writer_.reset();
+
+  EXPECT_THAT(written_timestamps_, ElementsAre(1, 2, 3, 4));
+  ASSERT_THAT(fake_metadata_.topics_with_message_count, SizeIs(1u));
+  EXPECT_EQ(fake_metadata_.topics_with_message_count[0].message_count, 4u);
+}
+
+TEST_F(SequentialWriterDoubleBufferedCacheTest, drop_oldest_discards_oldest_cached_messages) {
+  open_writer(rosbag2_cpp::CacheOverflowPolicy::DROP_OLDEST, 2);
+
+  for (auto i = 1; i <= 6; ++i) {
+    write_message(i);
+  }
+  EXPECT_EQ(sequential_writer_->get_dropped_messages_count(), 2u);
+
+  release_storage_promise_.set_value();
+  writer_.reset();
+
+  EXPECT_THAT(written_timestamps_, ElementsAre(1, 2, 5, 6));
+  ASSERT_THAT(fake_metadata_.topics_with_message_count, SizeIs(1u));
+  EXPECT_EQ(fake_metadata_.topics_with_message_count[0].message_count, 4u);
+}
+
+TEST_F(SequentialWriterDoubleBufferedCacheTest, low_priority_messages_are_dropped_first) {
+  storage_options_.topic_priorities = {
+    {"low_topic", rosbag2_cpp::TopicPriority::LOW},
+    {"high_topic", rosbag2_cpp::TopicPriority::HIGH}};
+  storage_options_.priority_threshold_percent = 50;
+  open_writer(rosbag2_cpp::CacheOverflowPolicy::DROP_NEWEST, 4);
+  writer_->create_topic({"low_topic", "test_msgs/BasicTypes", "", ""});
+  writer_->create_topic({"high_topic", "test_msgs/BasicTypes", "", ""});
+
+  // The first four messages are handed to the I/O thread, which is blocked in the storage.
+  for (auto i = 1; i <= 4; ++i) {
+    write_message(i);
+  }
+  // Low priority messages are discarded once the cache is half full.
+  for (auto i = 5; i <= 7; ++i) {
+    write_message(i, "low_topic");
+  }
+  write_message(8, "high_topic");
+  write_message(9);
+  // The full cache makes room by discarding the cached low priority messages.
+  write_message(10, "high_topic");
+  write_message(11);
+  write_message(12);
+  EXPECT_EQ(sequential_writer_->get_dropped_messages_count(), 4u);
+
+  release_storage_promise_.set_value();
+  writer_.reset();
+
+  EXPECT_THAT(written_timestamps_, ElementsAre(1, 2, 3, 4, 8, 9, 10, 11));
+  ASSERT_THAT(fake_metadata_.topics_with_message_count, SizeIs(3u));
+  for (const auto & topic : fake_metadata_.topics_with_message_count) {
+    if (topic.topic_metadata.name == "low_topic") {
+      EXPECT_EQ(topic.message_count, 0u);
+      EXPECT_EQ(topic.dropped_message_count, 3u);
+    } else if (topic.topic_metadata.name == "high_topic") {
+      EXPECT_EQ(topic.message_count, 2u);
+      EXPECT_EQ(topic.dropped_message_count, 0u);
+    } else {
+      EXPECT_EQ(topic.message_count, 6u);
+      EXPECT_EQ(topic.dropped_message_count, 1u);
+    }
   }
 }
@@ -0,0 +1,199 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/readers/synchronizing_reader.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+using namespace testing;  // NOLINT
+
+namespace
+{
+// Reads the given messages of topics and time stamps, and publish time stamps if any.
+class FakeReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  FakeReader(
+    const std::vector<std::pair<std::string, rcutils_time_point_value_t>> & messages,
+    rosbag2_storage::StorageFilter & storage_filter)
+  : storage_filter_(storage_filter)
+  {
+    for (const auto & message : messages) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->topic_name = message.first;
+      bag_message->time_stamp = message.second;
+      messages_.push_back(bag_message);
+    }
+  }
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {
+    index_ = 0;
+  }
+
+  void reset() override {}
+
+  bool has_next() override
+  {
+    return index_ < messages_.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    return messages_[index_++];
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return {};
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    storage_filter_ = storage_filter;
+  }
+
+  void reset_filter() override {}
+
+  void seek(const rcutils_time_point_value_t & timestamp) override
+  {
+    index_ = 0;
+    while (index_ < messages_.size() && messages_[index_]->time_stamp < timestamp) {
+      ++index_;
+    }
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+
+private:
+  rosbag2_storage::StorageFilter & storage_filter_;
+  rosbag2_storage::BagMetadata metadata_;
+  size_t index_ {0};
+};
+
+// Time stamps of the messages of every tuple read.
+std::vector<std::vector<rcutils_time_point_value_t>> read_tuples(
+  rosbag2_cpp::readers::SynchronizingReader & reader)
+{
+  std::vector<std::vector<rcutils_time_point_value_t>> tuples;
+  while (reader.has_next()) {
+    std::vector<rcutils_time_point_value_t> tuple;
+    for (const auto & message : reader.read_next()) {
+      tuple.push_back(message->time_stamp);
+    }
+    tuples.push_back(tuple);
+  }
+  return tuples;
+}
+}  // namespace
+
+TEST(SynchronizingReaderTest, messages_of_the_same_time_are_synchronized_without_slop) {
+  rosbag2_storage::StorageFilter storage_filter;
+  auto reader = std::make_unique<FakeReader>(
+    std::vector<std::pair<std::string, rcutils_time_point_value_t>>{
+    {"/a", 1}, {"/b", 1}, {"/a", 2}, {"/b", 3}, {"/a", 3}, {"/a", 4}}, storage_filter);
+  rosbag2_cpp::readers::SynchronizationOptions options;
+  options.topics = {"/a", "/b"};
+  rosbag2_cpp::readers::SynchronizingReader synchronizing_reader(options, std::move(reader));
+  synchronizing_reader.open({}, {});
+
+  EXPECT_THAT(storage_filter.topics, ElementsAre("/a", "/b"));
+  EXPECT_FALSE(storage_filter.order_by_publish_time);
+  EXPECT_THAT(read_tuples(synchronizing_reader), ElementsAre(ElementsAre(1, 1), ElementsAre(3, 3)));
+  EXPECT_THROW(synchronizing_reader.read_next(), std::runtime_error);
+
+  synchronizing_reader.seek(2);
+  EXPECT_THAT(read_tuples(synchronizing_reader), ElementsAre(ElementsAre(3, 3)));
+}
+
+TEST(SynchronizingReaderTest, closest_messages_within_the_slop_are_synchronized) {
+  rosbag2_storage::StorageFilter storage_filter;
+  auto reader = std::make_unique<FakeReader>(
+    std::vector<std::pair<std::string, rcutils_time_point_value_t>>{
+    {"/odom", 0}, {"/odom", 5}, {"/lidar", 8}, {"/camera", 10}, {"/odom", 10}, {"/lidar", 18},
+    {"/camera", 20}, {"/odom", 21}}, storage_filter);
+  rosbag2_cpp::readers::SynchronizationOptions options;
+  options.topics = {"/camera", "/lidar", "/odom"};
+  options.slop = 3;
+  rosbag2_cpp::readers::SynchronizingReader synchronizing_reader(options, std::move(reader));
+  synchronizing_reader.open({}, {});
+
+  // The old odometry is discarded, the last tuple is decided at the end of the bag.
+  EXPECT_THAT(
+    read_tuples(synchronizing_reader),
+    ElementsAre(ElementsAre(10, 8, 10), ElementsAre(20, 18, 21)));
+}
+
+TEST(SynchronizingReaderTest, messages_are_synchronized_by_publish_time_if_asked_to) {
+  rosbag2_storage::StorageFilter storage_filter;
+  auto reader = std::make_unique<FakeReader>(
+    std::vector<std::pair<std::string, rcutils_time_point_value_t>>{
+    {"/a", 10}, {"/b", 20}, {"/b", 30}}, storage_filter);
+  reader->messages_[0]->publish_time_stamp = 5;
+  reader->messages_[1]->publish_time_stamp = 4;
+  reader->messages_[2]->publish_time_stamp = 6;
+  rosbag2_cpp::readers::SynchronizationOptions options;
+  options.topics = {"/a", "/b"};
+  options.slop = 1;
+  options.by_publish_time = true;
+  rosbag2_cpp::readers::SynchronizingReader synchronizing_reader(options, std::move(reader));
+  synchronizing_reader.open({}, {});
+
+  EXPECT_TRUE(storage_filter.order_by_publish_time);
+  EXPECT_THAT(read_tuples(synchronizing_reader), ElementsAre(ElementsAre(10, 20)));
+}
+
+TEST(SynchronizingReaderTest, queues_keep_the_latest_messages) {
+  rosbag2_storage::StorageFilter storage_filter;
+  auto reader = std::make_unique<FakeReader>(
+    std::vector<std::pair<std::string, rcutils_time_point_value_t>>{
+    {"/a", 1}, {"/a", 2}, {"/a", 3}, {"/b", 1}, {"/b", 3}}, storage_filter);
+  rosbag2_cpp::readers::SynchronizationOptions options;
+  options.topics = {"/a", "/b"};
+  options.queue_size = 2;
+  rosbag2_cpp::readers::SynchronizingReader synchronizing_reader(options, std::move(reader));
+  synchronizing_reader.open({}, {});
+
+  EXPECT_THAT(read_tuples(synchronizing_reader), ElementsAre(ElementsAre(3, 3)));
+}
+
+TEST(SynchronizingReaderTest, invalid_options_are_rejected) {
+  rosbag2_cpp::readers::SynchronizationOptions options;
+  options.topics = {"/a"};
+  EXPECT_THROW(rosbag2_cpp::readers::SynchronizingReader{options}, std::invalid_argument);
+  options.topics = {"/a", "/a"};
+  EXPECT_THROW(rosbag2_cpp::readers::SynchronizingReader{options}, std::invalid_argument);
+  options.topics = {"/a", "/b"};
+  options.slop = -1;
+  EXPECT_THROW(rosbag2_cpp::readers::SynchronizingReader{options}, std::invalid_argument);
+  options.slop = 0;
+  options.queue_size = 0;
+  EXPECT_THROW(rosbag2_cpp::readers::SynchronizingReader{options}, std::invalid_argument);
+}
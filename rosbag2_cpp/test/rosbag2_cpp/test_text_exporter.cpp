@@ -0,0 +1,250 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+#include "rcpputils/shared_library.hpp"
+
+#include "rosbag2_cpp/cdr_message_formatter.hpp"
+#include "rosbag2_cpp/text_exporter.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+
+#include "rosbag2_test_common/memory_management.hpp"
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "test_msgs/message_fixtures.hpp"
+
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+class TextExporterTest : public TemporaryDirectoryFixture
+{
+public:
+  TextExporterTest()
+  {
+    storage_factory_ = std::make_unique<StrictMock<MockStorageFactory>>();
+    metadata_io_ = std::make_unique<NiceMock<MockMetadataIo>>();
+
+    ON_CALL(*storage_factory_, open_read_only(_, _)).WillByDefault(
+      [this](const std::string & uri, const std::string &) {
+        const auto messages = file_messages_.at(rcpputils::fs::path(uri).filename().string());
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        auto read_count = std::make_shared<size_t>(0);
+        ON_CALL(*storage, has_next()).WillByDefault(
+          [messages, read_count]() {return *read_count < messages.size();});
+        ON_CALL(*storage, read_next()).WillByDefault(
+          [messages, read_count]() {return messages[(*read_count)++];});
+        return storage;
+      });
+    ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+  }
+
+  const rosidl_message_type_support_t * get_type_support(const std::string & type)
+  {
+    return rosbag2_cpp::get_typesupport(type, "rosidl_typesupport_cpp", library_);
+  }
+
+  template<typename T>
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_bag_message(
+    const std::string & topic_name, rcutils_time_point_value_t time_stamp,
+    std::shared_ptr<T> message)
+  {
+    auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    bag_message->topic_name = topic_name;
+    bag_message->time_stamp = time_stamp;
+    bag_message->serialized_data = memory_management_.serialize_message(message);
+    return bag_message;
+  }
+
+  rosbag2_storage::BagMetadata make_metadata(const std::vector<std::string> & file_names)
+  {
+    rosbag2_storage::BagMetadata metadata{};
+    metadata.version = 4;
+    metadata.storage_identifier = "sqlite3";
+    metadata.relative_file_paths = file_names;
+    metadata.topics_with_message_count.push_back(
+      {{"/basic/types", "test_msgs/BasicTypes", "cdr", ""}, 3});
+    metadata.topics_with_message_count.push_back(
+      {{"/strings", "test_msgs/Strings", "cdr", ""}, 1});
+    return metadata;
+  }
+
+  static std::string read_file(const std::string & path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  MemoryManagement memory_management_;
+  std::shared_ptr<rcpputils::SharedLibrary> library_;
+  std::unique_ptr<StrictMock<MockStorageFactory>> storage_factory_;
+  std::unique_ptr<MockMetadataIo> metadata_io_;
+  std::map<std::string, std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>>
+  file_messages_;
+};
+
+TEST_F(TextExporterTest, formats_numbers_and_strings_as_json) {
+  auto message = get_messages_basic_types()[0];
+  message->bool_value = true;
+  message->int64_value = -9223372036854775807 - 1;
+  message->uint64_value = 18446744073709551615u;
+  message->float32_value = 0.1f;
+  message->float64_value = std::nan("");
+  auto strings_message = get_messages_strings()[0];
+  strings_message->string_value = "say \"hi\"\n";
+
+  rosbag2_cpp::CdrMessageFormatter formatter(get_type_support("test_msgs/BasicTypes"));
+  std::string json = "previous line\n";
+  formatter.append_json(*memory_management_.serialize_message(message), json);
+  rosbag2_cpp::CdrMessageFormatter strings_formatter(get_type_support("test_msgs/Strings"));
+  std::string strings_json;
+  strings_formatter.append_json(
+    *memory_management_.serialize_message(strings_message), strings_json);
+
+  EXPECT_THAT(json, StartsWith("previous line\n{\"bool_value\":true,"));
+  EXPECT_THAT(json, HasSubstr("\"int64_value\":-9223372036854775808"));
+  EXPECT_THAT(json, HasSubstr("\"uint64_value\":18446744073709551615"));
+  EXPECT_THAT(json, HasSubstr("\"float32_value\":0.1,"));
+  EXPECT_THAT(json, HasSubstr("\"float64_value\":null,"));
+  EXPECT_THAT(json, EndsWith("}"));
+  EXPECT_THAT(strings_json, HasSubstr("\"string_value\":\"say \\\"hi\\\"\\n\""));
+}
+
+TEST_F(TextExporterTest, formats_nested_messages_and_sequences_as_csv) {
+  auto message = get_messages_nested()[0];
+  message->basic_types_value.int32_value = -42;
+  auto sequences_message = get_messages_unbounded_sequences()[0];
+  sequences_message->int32_values = {1, -2, 3};
+
+  rosbag2_cpp::CdrMessageFormatter formatter(get_type_support("test_msgs/Nested"));
+  std::string header;
+  formatter.append_csv_header(header);
+  std::string row;
+  formatter.append_csv_row(*memory_management_.serialize_message(message), row);
+  rosbag2_cpp::CdrMessageFormatter sequences_formatter(
+    get_type_support("test_msgs/UnboundedSequences"));
+  std::string sequences_row;
+  sequences_formatter.append_csv_row(
+    *memory_management_.serialize_message(sequences_message), sequences_row);
+
+  EXPECT_THAT(header, StartsWith("basic_types_value.bool_value,"));
+  EXPECT_THAT(header, HasSubstr(",basic_types_value.int32_value,"));
+  EXPECT_THAT(row, HasSubstr(",-42,"));
+  EXPECT_THAT(sequences_row, HasSubstr("\"[1,-2,3]\""));
+}
+
+TEST_F(TextExporterTest, bagfiles_are_exported_in_parallel_and_joined_in_order) {
+  const auto messages = get_messages_basic_types();
+  file_messages_["bag_0.db3"] = {
+    make_bag_message("/basic/types", 1, messages[0]),
+    make_bag_message("/strings", 2, get_messages_strings()[0])};
+  file_messages_["bag_1.db3"] = {};
+  file_messages_["bag_2.db3"] = {
+    make_bag_message("/basic/types", 3, messages[1]),
+    make_bag_message("/basic/types", 4, messages[2])};
+  EXPECT_CALL(*metadata_io_, read_metadata(temporary_dir_path_)).WillOnce(
+    Return(make_metadata({"bag_0.db3", "bag_1.db3", "bag_2.db3"})));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(3);
+
+  const auto directory = (rcpputils::fs::path(temporary_dir_path_) / "export").string();
+  rosbag2_cpp::TextExporter exporter(std::move(storage_factory_), std::move(metadata_io_));
+  const auto topics = exporter.export_bag(
+    temporary_dir_path_, directory, rosbag2_cpp::TextFormat::CSV, {"/basic/types"}, 3);
+
+  ASSERT_THAT(topics, SizeIs(1u));
+  EXPECT_THAT(topics[0].topic_name, Eq("/basic/types"));
+  EXPECT_THAT(
+    topics[0].file_path,
+    Eq((rcpputils::fs::path(directory) / "basic__types.csv").string()));
+  EXPECT_THAT(topics[0].message_count, Eq(3u));
+  std::vector<std::string> lines;
+  std::istringstream content(read_file(topics[0].file_path));
+  for (std::string line; std::getline(content, line); ) {
+    lines.push_back(line);
+  }
+  ASSERT_THAT(lines, SizeIs(4u));
+  EXPECT_THAT(lines[0], StartsWith("time_stamp,bool_value,"));
+  EXPECT_THAT(lines[1], StartsWith("1,"));
+  EXPECT_THAT(lines[2], StartsWith("3,"));
+  EXPECT_THAT(lines[3], StartsWith("4,"));
+  // Only the joined files are left.
+  EXPECT_FALSE(rcpputils::fs::exists(rcpputils::fs::path(topics[0].file_path + ".0.part")));
+  EXPECT_FALSE(rcpputils::fs::exists(rcpputils::fs::path(directory) / "strings.csv"));
+}
+
+TEST_F(TextExporterTest, every_cdr_topic_is_exported_as_ndjson_by_default) {
+  file_messages_["bag_0.db3"] = {
+    make_bag_message("/basic/types", 1, get_messages_basic_types()[0]),
+    make_bag_message("/strings", 2, get_messages_strings()[0])};
+  auto metadata = make_metadata({"bag_0.db3"});
+  metadata.topics_with_message_count.push_back(
+    {{"/json", "std_msgs/String", "json", ""}, 0});
+  EXPECT_CALL(*metadata_io_, read_metadata(_)).WillOnce(Return(metadata));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, _)).Times(1);
+
+  const auto directory = (rcpputils::fs::path(temporary_dir_path_) / "export").string();
+  rosbag2_cpp::TextExporter exporter(std::move(storage_factory_), std::move(metadata_io_));
+  const auto topics = exporter.export_bag(
+    temporary_dir_path_, directory, rosbag2_cpp::TextFormat::NDJSON);
+
+  ASSERT_THAT(topics, SizeIs(2u));
+  EXPECT_THAT(topics[1].topic_name, Eq("/strings"));
+  EXPECT_THAT(topics[1].file_path, EndsWith("strings.ndjson"));
+  EXPECT_THAT(read_file(topics[1].file_path), StartsWith("{\"time_stamp\":2,\"message\":{"));
+  EXPECT_THAT(read_file(topics[1].file_path), EndsWith("}}\n"));
+}
+
+TEST_F(TextExporterTest, compressed_bags_and_topics_not_serialized_as_cdr_are_rejected) {
+  auto metadata = make_metadata({"bag_0.db3"});
+  metadata.topics_with_message_count.push_back(
+    {{"/json", "std_msgs/String", "json", ""}, 0});
+  auto compressed_metadata = metadata;
+  compressed_metadata.compression_format = "zstd";
+  EXPECT_CALL(*metadata_io_, read_metadata(_))
+  .WillOnce(Return(compressed_metadata))
+  .WillOnce(Return(metadata))
+  .WillOnce(Return(metadata));
+
+  rosbag2_cpp::TextExporter exporter(std::move(storage_factory_), std::move(metadata_io_));
+  EXPECT_THROW(
+    exporter.export_bag(temporary_dir_path_, temporary_dir_path_, rosbag2_cpp::TextFormat::CSV),
+    std::runtime_error);
+  EXPECT_THROW(
+    exporter.export_bag(
+      temporary_dir_path_, temporary_dir_path_, rosbag2_cpp::TextFormat::CSV, {"/json"}),
+    std::runtime_error);
+  EXPECT_THROW(
+    exporter.export_bag(
+      temporary_dir_path_, temporary_dir_path_, rosbag2_cpp::TextFormat::CSV, {"/missing"}),
+    std::runtime_error);
+}
@@ -0,0 +1,145 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#ifdef __linux__
+# include <sched.h>
+# include <sys/resource.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+using namespace ::testing;  // NOLINT
+
+using rosbag2_cpp::ThreadPool;
+using rosbag2_cpp::ThreadPoolOptions;
+using rosbag2_cpp::ThreadRole;
+using rosbag2_cpp::ThreadScheduling;
+
+TEST(ThreadPoolTest, submitted_tasks_return_their_results_and_exceptions) {
+  ThreadPoolOptions options;
+  options.size = 2;
+  ThreadPool pool(options);
+  EXPECT_THAT(pool.get_size(), Eq(2u));
+
+  auto result = pool.submit([]() {return std::string("result");});
+  auto error = pool.submit([]() -> int {throw std::runtime_error("error");});
+
+  EXPECT_THAT(result.get(), Eq("result"));
+  EXPECT_THROW(error.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, tasks_submitted_before_destruction_are_run) {
+  std::atomic<int> run_count {0};
+  {
+    ThreadPoolOptions options;
+    options.size = 1;
+    ThreadPool pool(options);
+    for (int i = 0; i < 100; ++i) {
+      // The futures are dropped, which does not wait for the tasks.
+      pool.submit(
+        [&run_count]() {
+          std::this_thread::sleep_for(std::chrono::microseconds(10));
+          ++run_count;
+        });
+    }
+  }
+
+  EXPECT_THAT(run_count.load(), Eq(100));
+}
+
+TEST(ThreadPoolTest, tasks_run_concurrently_on_all_threads) {
+  ThreadPoolOptions options;
+  options.size = 3;
+  ThreadPool pool(options);
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> waiting_count {0};
+
+  std::vector<std::future<void>> tasks;
+  for (int i = 0; i < 3; ++i) {
+    tasks.push_back(
+      pool.submit(
+        [&waiting_count, released]() {
+          ++waiting_count;
+          released.wait();
+        }));
+  }
+  while (waiting_count.load() < 3) {
+    std::this_thread::yield();
+  }
+  release.set_value();
+  for (auto & task : tasks) {
+    task.get();
+  }
+}
+
+TEST(ThreadPoolTest, shared_pool_cannot_be_reconfigured_once_started) {
+  ThreadPoolOptions invalid_options;
+  invalid_options.nice = 20;
+  EXPECT_THROW(ThreadPool::configure_shared(invalid_options), std::invalid_argument);
+
+  ThreadPoolOptions options;
+  options.size = 2;
+  options.cpu_affinity = {0};
+  ThreadPool::configure_shared(options);
+#ifdef __linux__
+  auto cpu = ThreadPool::get_shared().submit([]() {return sched_getcpu();});
+  EXPECT_THAT(cpu.get(), Eq(0));
+#endif
+  EXPECT_THAT(ThreadPool::get_shared().get_size(), Eq(2u));
+
+  EXPECT_NO_THROW(ThreadPool::configure_shared(options));
+  options.size = 3;
+  EXPECT_THROW(ThreadPool::configure_shared(options), std::logic_error);
+}
+
+TEST(ThreadPoolTest, threads_are_scheduled_by_their_role) {
+  ThreadScheduling invalid_scheduling;
+  invalid_scheduling.realtime_priority = 100;
+  EXPECT_THROW(
+    ThreadPool::configure_role(ThreadRole::WRITER, invalid_scheduling), std::invalid_argument);
+  EXPECT_THROW(
+    ThreadPool::configure_role(ThreadRole::BACKGROUND, ThreadScheduling{}),
+    std::invalid_argument);
+
+  ThreadScheduling scheduling;
+  scheduling.cpu_affinity = {0};
+  scheduling.nice = 5;
+  ThreadPool::configure_role(ThreadRole::WRITER, scheduling);
+#ifdef __linux__
+  int cpu = -1;
+  int nice = 0;
+  std::thread writer_thread{
+    [&cpu, &nice]() {
+      ThreadPool::configure_current_thread(ThreadRole::WRITER);
+      cpu = sched_getcpu();
+      nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+    }};
+  writer_thread.join();
+  EXPECT_THAT(cpu, Eq(0));
+  EXPECT_THAT(nice, Eq(5));
+#endif
+}
@@ -0,0 +1,237 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/reader_interfaces/base_reader_interface.hpp"
+#include "rosbag2_cpp/typed_reader.hpp"
+#include "rosbag2_cpp/typed_writer.hpp"
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "test_msgs/msg/basic_types.hpp"
+#include "test_msgs/msg/strings.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+// Keeps the written messages, either as they are or as copies, like a writer caching them or
+// writing them right away, and the serialized data they were written with.
+class InMemoryWriter : public rosbag2_cpp::writer_interfaces::BaseWriterInterface
+{
+public:
+  InMemoryWriter(
+    std::vector<rosbag2_storage::TopicMetadata> & topics,
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages,
+    std::vector<const rcutils_uint8_array_t *> & written_data, bool copies_messages)
+  : topics_(topics), messages_(messages), written_data_(written_data),
+    copies_messages_(copies_messages) {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {
+  }
+
+  void reset() override {}
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override
+  {
+    topics_.push_back(topic_with_type);
+  }
+
+  void remove_topic(const rosbag2_storage::TopicMetadata &) override {}
+
+  void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override
+  {
+    written_data_.push_back(message->serialized_data.get());
+    if (copies_messages_) {
+      auto copy = std::make_shared<rosbag2_storage::SerializedBagMessage>(*message);
+      copy->serialized_data = rosbag2_storage::make_serialized_message(
+        message->serialized_data->buffer, message->serialized_data->buffer_length);
+      message = copy;
+    }
+    messages_.push_back(message);
+  }
+
+private:
+  std::vector<rosbag2_storage::TopicMetadata> & topics_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages_;
+  std::vector<const rcutils_uint8_array_t *> & written_data_;
+  bool copies_messages_;
+};
+
+class InMemoryReader : public rosbag2_cpp::reader_interfaces::BaseReaderInterface
+{
+public:
+  InMemoryReader(
+    std::vector<rosbag2_storage::TopicMetadata> topics,
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages)
+  : topics_(std::move(topics)), messages_(std::move(messages)) {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {
+  }
+
+  void reset() override {}
+
+  bool has_next() override
+  {
+    while (position_ < messages_.size() && !filter_.topics.empty() &&
+      messages_[position_]->topic_name != filter_.topics[0])
+    {
+      ++position_;
+    }
+    return position_ < messages_.size();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    return messages_.at(position_++);
+  }
+
+  const rosbag2_storage::BagMetadata & get_metadata() const override
+  {
+    return metadata_;
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() const override
+  {
+    return topics_;
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    filter_ = storage_filter;
+  }
+
+  void reset_filter() override
+  {
+    filter_ = rosbag2_storage::StorageFilter();
+  }
+
+private:
+  std::vector<rosbag2_storage::TopicMetadata> topics_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+  rosbag2_storage::BagMetadata metadata_;
+  rosbag2_storage::StorageFilter filter_;
+  size_t position_ {0};
+};
+}  // namespace
+
+class TypedReaderWriterTest : public Test
+{
+public:
+  std::unique_ptr<rosbag2_cpp::Writer> make_writer(bool copies_messages)
+  {
+    return std::make_unique<rosbag2_cpp::Writer>(
+      std::make_unique<InMemoryWriter>(topics_, messages_, written_data_, copies_messages));
+  }
+
+  std::unique_ptr<rosbag2_cpp::Reader> make_reader()
+  {
+    return std::make_unique<rosbag2_cpp::Reader>(
+      std::make_unique<InMemoryReader>(topics_, messages_));
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> topics_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages_;
+  std::vector<const rcutils_uint8_array_t *> written_data_;
+};
+
+TEST_F(TypedReaderWriterTest, written_messages_are_read_into_the_same_message_object) {
+  {
+    auto writer = make_writer(false);
+    rosbag2_cpp::TypedWriter<test_msgs::msg::BasicTypes> basic_types_writer(*writer, "basic");
+    rosbag2_cpp::TypedWriter<test_msgs::msg::Strings> strings_writer(*writer, "strings");
+    test_msgs::msg::BasicTypes basic_types;
+    test_msgs::msg::Strings strings;
+    for (int32_t i = 1; i <= 3; ++i) {
+      basic_types.int32_value = i;
+      basic_types.float64_value = i * 0.5;
+      basic_types_writer.write(basic_types, i * 100);
+      strings.string_value = std::string(static_cast<size_t>(i) * 10, 'x');
+      strings_writer.write(strings, i * 100 + 50);
+    }
+  }
+
+  ASSERT_THAT(topics_, SizeIs(2));
+  EXPECT_THAT(topics_[0].name, StrEq("basic"));
+  EXPECT_THAT(topics_[0].type, StrEq("test_msgs/msg/BasicTypes"));
+  EXPECT_THAT(topics_[0].serialization_format, StrEq(rmw_get_serialization_format()));
+  ASSERT_THAT(messages_, SizeIs(6));
+
+  auto reader = make_reader();
+  rosbag2_cpp::TypedReader<test_msgs::msg::Strings> strings_reader(*reader, "strings");
+  test_msgs::msg::Strings strings;
+  std::vector<size_t> lengths;
+  std::vector<rcutils_time_point_value_t> time_stamps;
+  while (strings_reader.read_next(strings)) {
+    lengths.push_back(strings.string_value.size());
+    time_stamps.push_back(strings_reader.get_time_stamp());
+  }
+  EXPECT_THAT(lengths, ElementsAre(10u, 20u, 30u));
+  EXPECT_THAT(time_stamps, ElementsAre(150, 250, 350));
+  EXPECT_FALSE(strings_reader.read_next(strings));
+  EXPECT_THAT(strings.string_value, SizeIs(30u));
+
+  test_msgs::msg::BasicTypes basic_types;
+  rosbag2_cpp::TypedReader<test_msgs::msg::BasicTypes>::deserialize(
+    *messages_[2]->serialized_data, basic_types);
+  EXPECT_THAT(basic_types.int32_value, Eq(2));
+  EXPECT_THAT(basic_types.float64_value, DoubleEq(1.0));
+}
+
+TEST_F(TypedReaderWriterTest, serialized_data_is_reused_once_the_writer_released_it) {
+  test_msgs::msg::BasicTypes message;
+  {
+    auto writer = make_writer(true);
+    rosbag2_cpp::TypedWriter<test_msgs::msg::BasicTypes> typed_writer(*writer, "basic");
+    typed_writer.write(message, 1);
+    typed_writer.write(message, 2);
+  }
+  ASSERT_THAT(written_data_, SizeIs(2));
+  EXPECT_THAT(written_data_[1], Eq(written_data_[0]));
+  EXPECT_THAT(messages_[1]->time_stamp, Eq(2));
+
+  messages_.clear();
+  written_data_.clear();
+  {
+    auto writer = make_writer(false);
+    rosbag2_cpp::TypedWriter<test_msgs::msg::BasicTypes> typed_writer(*writer, "basic");
+    typed_writer.write(message, 1);
+    typed_writer.write(message, 2);
+  }
+  ASSERT_THAT(written_data_, SizeIs(2));
+  EXPECT_THAT(written_data_[1], Ne(written_data_[0]));
+  EXPECT_THAT(messages_[0]->time_stamp, Eq(1));
+}
+
+TEST_F(TypedReaderWriterTest, reader_throws_for_missing_topic_or_other_type) {
+  topics_.push_back({"basic", "test_msgs/BasicTypes", rmw_get_serialization_format(), ""});
+  auto reader = make_reader();
+
+  EXPECT_NO_THROW(rosbag2_cpp::TypedReader<test_msgs::msg::BasicTypes>(*reader, "basic"));
+  EXPECT_THROW(
+    rosbag2_cpp::TypedReader<test_msgs::msg::BasicTypes>(*reader, "missing"), std::runtime_error);
+  EXPECT_THROW(
+    rosbag2_cpp::TypedReader<test_msgs::msg::Strings>(*reader, "basic"), std::runtime_error);
+}
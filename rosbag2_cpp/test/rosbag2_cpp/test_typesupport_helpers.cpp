@@ -88,3 +88,20 @@ TEST(TypesupportHelpersTest, returns_c_type_info_for_valid_library) {
     std::string(string_typesupport->typesupport_identifier),
     ContainsRegex("rosidl_typesupport"));
 }
+
+TEST(TypesupportHelpersTest, returns_cached_library_and_type_support_when_called_again) {
+  std::shared_ptr<rcpputils::SharedLibrary> first_library;
+  std::shared_ptr<rcpputils::SharedLibrary> second_library;
+  std::shared_ptr<rcpputils::SharedLibrary> other_type_library;
+  auto first_typesupport = rosbag2_cpp::get_typesupport(
+    "test_msgs/msg/Arrays", "rosidl_typesupport_cpp", first_library);
+  auto second_typesupport = rosbag2_cpp::get_typesupport(
+    "test_msgs/msg/Arrays", "rosidl_typesupport_cpp", second_library);
+  rosbag2_cpp::get_typesupport(
+    "test_msgs/msg/Strings", "rosidl_typesupport_cpp", other_type_library);
+
+  EXPECT_THAT(second_typesupport, Eq(first_typesupport));
+  EXPECT_THAT(second_library, Eq(first_library));
+  // Types of the same package share their library.
+  EXPECT_THAT(other_type_library, Eq(first_library));
+}
@@ -0,0 +1,164 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/verifier.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "mock_metadata_io.hpp"
+#include "mock_storage.hpp"
+#include "mock_storage_factory.hpp"
+
+using namespace testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+class VerifierTest : public TemporaryDirectoryFixture
+{
+public:
+  // Readable messages of a file and whether reading the next one fails.
+  struct FileContent
+  {
+    size_t message_count;
+    bool is_corrupt;
+  };
+
+  VerifierTest()
+  {
+    storage_factory_ = std::make_unique<StrictMock<MockStorageFactory>>();
+    metadata_io_ = std::make_unique<NiceMock<MockMetadataIo>>();
+
+    ON_CALL(*storage_factory_, open_read_only(_, _)).WillByDefault(
+      [this](const std::string & uri, const std::string &) {
+        const auto content = file_contents_.at(uri);
+        auto storage = std::make_shared<NiceMock<MockStorage>>();
+        auto read_count = std::make_shared<size_t>(0);
+        ON_CALL(*storage, has_next()).WillByDefault(
+          [content, read_count]() {
+            return *read_count < content.message_count || content.is_corrupt;
+          });
+        ON_CALL(*storage, read_next()).WillByDefault(
+          [content, read_count]() {
+            if (*read_count == content.message_count) {
+              throw std::runtime_error("Chunk is corrupt.");
+            }
+            ++*read_count;
+            return std::make_shared<rosbag2_storage::SerializedBagMessage>();
+          });
+        return storage;
+      });
+  }
+
+  void add_file(const std::string & relative_file_path, FileContent content)
+  {
+    const auto path = (rcpputils::fs::path(temporary_dir_path_) / relative_file_path).string();
+    std::ofstream(path) << "data";
+    file_contents_[path] = content;
+  }
+
+  std::unique_ptr<StrictMock<MockStorageFactory>> storage_factory_;
+  std::unique_ptr<MockMetadataIo> metadata_io_;
+  std::map<std::string, FileContent> file_contents_;
+};
+
+TEST_F(VerifierTest, every_file_is_read_completely) {
+  add_file("bag_0.db3", {10, false});
+  add_file("bag_1.db3", {5, true});
+  add_file("bag_2.db3", {0, false});
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(3);
+
+  rosbag2_cpp::Verifier verifier(std::move(storage_factory_), std::move(metadata_io_));
+  const auto verifications = verifier.verify(
+    temporary_dir_path_, "sqlite3", {"bag_0.db3", "bag_1.db3", "bag_2.db3"}, 2);
+
+  ASSERT_THAT(verifications, SizeIs(3u));
+  EXPECT_THAT(verifications[0].path, Eq("bag_0.db3"));
+  EXPECT_THAT(verifications[0].message_count, Eq(10u));
+  EXPECT_THAT(verifications[0].error, IsEmpty());
+  EXPECT_THAT(verifications[1].message_count, Eq(5u));
+  EXPECT_THAT(verifications[1].error, HasSubstr("Reading message 6 failed: Chunk is corrupt."));
+  EXPECT_THAT(verifications[2].message_count, Eq(0u));
+  EXPECT_THAT(verifications[2].error, IsEmpty());
+}
+
+TEST_F(VerifierTest, files_are_checked_against_the_metadata) {
+  add_file("bag_0.db3", {10, false});
+  add_file("bag_1.db3", {4, false});
+  add_file("bag_2.db3", {1, false});
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.version = 6;
+  metadata.storage_identifier = "sqlite3";
+  metadata.relative_file_paths = {"bag_0.db3", "bag_1.db3", "missing_0.db3"};
+  metadata.files = {{"bag_0.db3"}, {"bag_1.db3"}, {"missing_0.db3"}};
+  metadata.files[0].message_count = 10;
+  metadata.files[1].message_count = 5;
+  EXPECT_CALL(*metadata_io_, metadata_file_exists(temporary_dir_path_)).WillOnce(Return(true));
+  EXPECT_CALL(*metadata_io_, read_metadata(temporary_dir_path_)).WillOnce(Return(metadata));
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).Times(3);
+
+  rosbag2_cpp::Verifier verifier(std::move(storage_factory_), std::move(metadata_io_));
+  const auto verifications = verifier.verify(
+    temporary_dir_path_, "", {"bag_0.db3", "bag_1.db3", "bag_2.db3"});
+
+  ASSERT_THAT(verifications, SizeIs(4u));
+  EXPECT_THAT(verifications[0].error, IsEmpty());
+  EXPECT_THAT(verifications[1].error, HasSubstr("lists 5 messages, but the file has 4"));
+  EXPECT_THAT(verifications[2].path, Eq("missing_0.db3"));
+  EXPECT_THAT(verifications[2].error, HasSubstr("does not exist"));
+  EXPECT_THAT(verifications[3].path, Eq("bag_2.db3"));
+  EXPECT_THAT(verifications[3].error, IsEmpty());
+}
+
+TEST_F(VerifierTest, files_which_cannot_be_opened_are_corrupt) {
+  add_file("bag_0.db3", {10, false});
+  EXPECT_CALL(*storage_factory_, open_read_only(_, "sqlite3")).WillOnce(Return(nullptr));
+
+  rosbag2_cpp::Verifier verifier(std::move(storage_factory_), std::move(metadata_io_));
+  const auto verifications = verifier.verify(temporary_dir_path_, "sqlite3", {"bag_0.db3"});
+
+  ASSERT_THAT(verifications, SizeIs(1u));
+  EXPECT_THAT(verifications[0].error, HasSubstr("could not be opened"));
+}
+
+TEST_F(VerifierTest, verify_throws_without_storage_id_or_bagfiles) {
+  rosbag2_cpp::Verifier verifier(std::move(storage_factory_), std::move(metadata_io_));
+  EXPECT_THROW(
+    verifier.verify(temporary_dir_path_, "", {"bag_0.db3"}), std::invalid_argument);
+  EXPECT_THROW(verifier.verify(temporary_dir_path_, "sqlite3", {}), std::runtime_error);
+}
+
+TEST_F(VerifierTest, verify_throws_on_bags_compressed_per_file) {
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.storage_identifier = "sqlite3";
+  metadata.compression_mode = "FILE";
+  ON_CALL(*metadata_io_, metadata_file_exists(_)).WillByDefault(Return(true));
+  ON_CALL(*metadata_io_, read_metadata(_)).WillByDefault(Return(metadata));
+
+  rosbag2_cpp::Verifier verifier(std::move(storage_factory_), std::move(metadata_io_));
+  EXPECT_THROW(
+    verifier.verify(temporary_dir_path_, "", {"bag_0.db3.zstd"}), std::runtime_error);
+}
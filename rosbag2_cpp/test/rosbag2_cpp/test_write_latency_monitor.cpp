@@ -0,0 +1,114 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_cpp/writers/write_latency_monitor.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace std::chrono_literals;  // NOLINT
+using rosbag2_cpp::writers::WriteLatencyMonitor;
+
+namespace
+{
+std::shared_ptr<const rosbag2_storage::SerializedBagMessage> make_message(
+  const std::string & topic_name, size_t size)
+{
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->topic_name = topic_name;
+  auto serialized_data = std::make_shared<rcutils_uint8_array_t>();
+  serialized_data->buffer = nullptr;
+  serialized_data->buffer_length = size;
+  serialized_data->buffer_capacity = 0;
+  message->serialized_data = serialized_data;
+  return message;
+}
+}  // namespace
+
+class WriteLatencyMonitorTest : public Test
+{
+public:
+  WriteLatencyMonitorTest()
+  : monitor_(100ms, 5s, 10s),
+    start_(std::chrono::steady_clock::now()),
+    messages_({
+      make_message("/camera", 3000), make_message("/lidar", 2000), make_message("/camera", 3000),
+      make_message("/imu", 100), make_message("/tf", 50)})
+  {}
+
+  WriteLatencyMonitor monitor_;
+  std::chrono::steady_clock::time_point start_;
+  WriteLatencyMonitor::Messages messages_;
+};
+
+TEST_F(WriteLatencyMonitorTest, writes_within_the_budget_produce_no_warning)
+{
+  EXPECT_THAT(monitor_.record_write(messages_, 100ms, start_), IsEmpty());
+  EXPECT_THAT(monitor_.get_slow_write_count(), Eq(0u));
+}
+
+TEST_F(WriteLatencyMonitorTest, slow_writes_warn_with_the_topics_contributing_the_most_bytes)
+{
+  const auto warning = monitor_.record_write(messages_, 250ms, start_);
+
+  EXPECT_THAT(
+    warning, HasSubstr(
+      "Writing 5 messages (8.0 KiB) to the storage took 250.0 ms, over the budget of 100.0 ms."));
+  EXPECT_THAT(
+    warning,
+    HasSubstr("Topics with the most bytes: /camera (5.9 KiB), /lidar (2.0 KiB), /imu (100 B)."));
+  EXPECT_THAT(monitor_.get_slow_write_count(), Eq(1u));
+}
+
+TEST_F(WriteLatencyMonitorTest, warnings_are_limited_to_one_per_interval)
+{
+  EXPECT_THAT(monitor_.record_write(messages_, 200ms, start_), Not(IsEmpty()));
+  EXPECT_THAT(monitor_.record_write(messages_, 200ms, start_ + 1s), IsEmpty());
+  EXPECT_THAT(monitor_.record_backlog(messages_, start_ + 2s), IsEmpty());
+
+  const auto warning = monitor_.record_write(messages_, 200ms, start_ + 5s);
+  EXPECT_THAT(warning, HasSubstr("2 similar warnings were suppressed since the last one."));
+  EXPECT_THAT(monitor_.get_slow_write_count(), Eq(3u));
+}
+
+TEST_F(WriteLatencyMonitorTest, backlog_warns_about_the_waiting_messages)
+{
+  const auto warning = monitor_.record_backlog(messages_, start_);
+
+  EXPECT_THAT(warning, StartsWith("5 messages (8.0 KiB) are waiting for the storage"));
+  EXPECT_THAT(warning, HasSubstr("/camera (5.9 KiB)"));
+}
+
+TEST_F(WriteLatencyMonitorTest, percentiles_follow_the_recent_writes)
+{
+  for (int i = 0; i < 99; ++i) {
+    monitor_.record_write(messages_, 1ms, start_);
+  }
+  monitor_.record_write(messages_, 50ms, start_);
+  EXPECT_THAT(monitor_.get_percentile(0.5), Eq(std::chrono::microseconds(1024)));
+  EXPECT_THAT(monitor_.get_percentile(1.0), Eq(std::chrono::microseconds(65536)));
+
+  // The earlier writes have decayed to a small fraction after ten half lives.
+  for (int i = 0; i < 10; ++i) {
+    monitor_.record_write(messages_, 50ms, start_ + 100s);
+  }
+  EXPECT_THAT(monitor_.get_percentile(0.5), Eq(std::chrono::microseconds(65536)));
+}
@@ -180,3 +180,12 @@ TEST_F(Ros2MessageTest, duplicate_set_topic_does_not_leak) {
 
   EXPECT_THAT(message->topic_name, StrEq("Topic name"));
 }
+
+TEST_F(Ros2MessageTest, set_topic_name_replaces_different_topic_name) {
+  auto message = get_allocated_message("test_msgs/BoundedSequences");
+
+  rosbag2_cpp::introspection_message_set_topic_name(message.get(), "Topic name");
+  rosbag2_cpp::introspection_message_set_topic_name(message.get(), "Other topic name");
+
+  EXPECT_THAT(message->topic_name, StrEq("Other topic name"));
+}
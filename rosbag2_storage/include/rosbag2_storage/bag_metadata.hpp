@@ -25,24 +25,103 @@
 namespace rosbag2_storage
 {
 
+/**
+ * Number and size of the messages of a topic per bucket of time, e.g. for the timeline of a bag
+ * browser. The buckets are aligned to multiples of their duration since the epoch, which is a
+ * power of two nanoseconds, so histograms of the same topic are merged by adding up buckets.
+ */
+struct MessageHistogram
+{
+  // Start of the first bucket.
+  std::chrono::time_point<std::chrono::high_resolution_clock> starting_time{};
+  // Duration of every bucket, zero if the topic has no histogram, e.g. of an older bag.
+  std::chrono::nanoseconds bucket_duration{0};
+  std::vector<uint64_t> message_counts{};
+  // Sizes of the serialized messages, before any compression.
+  std::vector<uint64_t> sizes{};
+};
+
 struct TopicInformation
 {
   TopicMetadata topic_metadata;
   size_t message_count;
+  // Sizes of the serialized messages as recorded, before any compression.
+  // Zero if unknown, e.g. for bags recorded before they were part of the metadata.
+  uint64_t total_size = 0;
+  uint64_t max_message_size = 0;
+  // Size of the messages after compression, if the bag is compressed per message, else zero.
+  uint64_t compressed_size = 0;
+  // Messages received but not written, because the writer's cache overflowed while the disk
+  // could not keep up. They are not counted in message_count.
+  uint64_t dropped_message_count = 0;
+  // Format the messages of the topic are compressed with in a bag compressed per message, if it
+  // is not the compression format of the bag, or "none" if they are not compressed at all.
+  std::string compression_format{};
+  // Whether repeated messages of the topic are stored without data, as references to the data of
+  // the previous message of the topic with data in the same file.
+  bool deduplicated = false;
+  // Whether the messages of the topic are stored as keyframes or as the changes to the previous
+  // message of the topic, each starting with a byte telling which of the two it is.
+  bool delta_encoded = false;
+  // Messages per bucket of time, written by recorders since metadata version 14.
+  MessageHistogram histogram{};
+};
+
+struct FileInformation
+{
+  std::string path;
+  // False if the file's indices have not been built yet, e.g. because the file is still
+  // being recorded with deferred index creation. Readers then fall back to unindexed access.
+  bool indexed = true;
+  // Time range of the messages in the file, used to find the file to seek into.
+  std::chrono::time_point<std::chrono::high_resolution_clock> starting_time{};
+  std::chrono::nanoseconds duration{0};
+  // Index of the stripe directory the file was written to, or of the shard of the bag directory
+  // which wrote it after the stripe directories, 0 for the bag directory.
+  // Files of different stripes are written at the same time, so their time ranges overlap.
+  size_t stripe = 0;
+  // Names of the topics with messages in the file.
+  // Readers filtering by topic skip files without any of the filtered topics.
+  // Empty if unknown, then the file may hold messages of any topic.
+  std::vector<std::string> topics{};
+  // Number of messages of each of the topics, in the same order. Empty if unknown.
+  std::vector<uint64_t> topic_message_counts{};
+  // Number of messages in the file, updated by the metadata checkpoints written while recording.
+  uint64_t message_count = 0;
+  // Size of the file on disk once it was closed, zero while it is written or if unknown.
+  uint64_t size = 0;
 };
 
 struct BagMetadata
 {
-  int version = 4;  // upgrade this number when changing the content of the struct
+  int version = 14;  // upgrade this number when changing the content of the struct
   uint64_t bag_size = 0;  // Will not be serialized
   std::string storage_identifier;
   std::vector<std::string> relative_file_paths;
+  std::vector<FileInformation> files;
   std::chrono::nanoseconds duration;
   std::chrono::time_point<std::chrono::high_resolution_clock> starting_time;
   uint64_t message_count;
   std::vector<TopicInformation> topics_with_message_count;
   std::string compression_format;
   std::string compression_mode;
+  // Largest amount of serialized message data held in the writer's cache during recording.
+  uint64_t cache_high_water_mark_bytes = 0;
+  // Files holding the dictionaries needed to decompress messages, in the format of the compressor.
+  std::vector<std::string> compression_dictionaries;
+  // Identity shared by the bags recorded together by the recorders of several hosts, which are
+  // merged into a single bag once recorded. Empty for bags recorded on their own.
+  std::string bag_id;
+  // Time to add to the recording host's clock to get the reference clock of the hosts, which was
+  // added to the time stamps of the messages when they were written.
+  std::chrono::nanoseconds clock_offset{0};
+  // Algorithm the messages or chunks of a bag compressed per message or chunk are encrypted with,
+  // empty if the bag is not encrypted.
+  std::string encryption_format;
+  // Key id of the key the bag's own key is encrypted with, and the bag's key encrypted with it in
+  // hexadecimal. The key of a bag is never stored in the clear.
+  std::string encryption_key_id;
+  std::string encrypted_key;
 };
 
 }  // namespace rosbag2_storage
@@ -0,0 +1,69 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__BUFFER_SLICE_HPP_
+#define ROSBAG2_STORAGE__BUFFER_SLICE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/visibility_control.hpp"
+
+namespace rosbag2_storage
+{
+
+/**
+ * Bytes within a buffer shared by several messages, e.g. a memory mapped file, a decompressed
+ * chunk or a receive buffer. The owner keeps the buffer alive as long as the slice exists, and
+ * whoever fills the buffer must neither move nor change the bytes of the slice meanwhile, only
+ * bytes after them may still be written.
+ */
+struct BufferSlice
+{
+  const uint8_t * data = nullptr;
+  size_t size = 0;
+  std::shared_ptr<const void> owner;
+};
+
+/**
+ * Returns a slice of the serialized data, which shares its ownership.
+ * \throws std::out_of_range if the range is not within the data.
+ */
+ROSBAG2_STORAGE_PUBLIC
+BufferSlice
+make_buffer_slice(
+  const std::shared_ptr<const rcutils_uint8_array_t> & serialized_data, size_t offset,
+  size_t size);
+
+/**
+ * Returns serialized data referencing the slice instead of a copy of it, which is stored in a
+ * SerializedBagMessage and published like any other serialized data, and keeps the owner alive.
+ * Resizing or growing the data copies it out of the slice first, so the shared buffer is never
+ * written to.
+ */
+ROSBAG2_STORAGE_PUBLIC
+std::shared_ptr<rcutils_uint8_array_t>
+make_serialized_data_view(BufferSlice slice);
+
+/// Whether the serialized data references a slice made by make_serialized_data_view().
+ROSBAG2_STORAGE_PUBLIC
+bool
+is_serialized_data_view(const rcutils_uint8_array_t & serialized_data);
+
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__BUFFER_SLICE_HPP_
@@ -0,0 +1,137 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__MEMORY_ARENA_HPP_
+#define ROSBAG2_STORAGE__MEMORY_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "rcutils/allocator.h"
+
+#include "rosbag2_storage/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage
+{
+
+struct MemoryArenaOptions
+{
+  // Bytes of the arena, rounded up to whole huge pages of 2 MiB.
+  // Defaults to 0, which disables the arena.
+  uint64_t size = 0;
+
+  // Maps huge pages reserved by the administrator, e.g. through /proc/sys/vm/nr_hugepages,
+  // instead of asking the kernel for transparent huge pages. Only supported on Linux.
+  bool explicit_huge_pages = false;
+
+  // NUMA node the memory of the arena is bound to. Only supported on Linux.
+  // Defaults to -1, which takes the memory of the node of the thread creating the arena.
+  int numa_node = -1;
+};
+
+/**
+ * Memory for the serialized data of messages, mapped at once with huge pages and touched before
+ * it is used, so holding many messages neither misses the TLB for every few kilobytes nor
+ * page-faults while recording or playing.
+ *
+ * Blocks are handed out in sizes of powers of two and kept for blocks of the same size once
+ * freed, so the arena never returns memory to the system. If it has no block left for a size,
+ * the memory is allocated from the heap instead.
+ */
+class ROSBAG2_STORAGE_PUBLIC MemoryArena
+{
+public:
+  /**
+   * Maps the memory of the arena and touches all of it.
+   * \throws std::invalid_argument if the size is 0.
+   * \throws std::runtime_error if the memory cannot be mapped, e.g. because not enough explicit
+   * huge pages are reserved.
+   */
+  explicit MemoryArena(const MemoryArenaOptions & options);
+
+  /// Unmaps the memory. The blocks handed out must have been freed before.
+  ~MemoryArena();
+
+  MemoryArena(const MemoryArena &) = delete;
+  MemoryArena & operator=(const MemoryArena &) = delete;
+
+  /// \return a block of at least the given size, or nullptr if the arena has none left.
+  void * allocate(size_t size);
+
+  /// Frees a block of the arena.
+  void deallocate(void * pointer);
+
+  /// Whether the pointer is a block of the arena.
+  bool contains(const void * pointer) const;
+
+  /// Bytes the block can hold, at least the size it was allocated with.
+  size_t get_capacity(const void * pointer) const;
+
+  /**
+   * An allocator handing out blocks of the arena, and memory of the heap once the arena has no
+   * block left for a size. The arena must outlive the memory allocated by it.
+   */
+  rcutils_allocator_t get_allocator();
+
+  uint64_t get_size() const;
+
+  /// Bytes of the blocks handed out and not freed yet.
+  uint64_t get_allocated_bytes() const;
+
+  /**
+   * Sets the options of the shared arena, created on first use.
+   * \throws std::logic_error if the shared arena was created already with other options.
+   */
+  static void configure_shared(const MemoryArenaOptions & options);
+
+  /**
+   * The arena the buffers of messages are allocated from, created on first use and kept until
+   * the process exits. Readers and writers get it when they are opened, so it is mapped and
+   * touched before the first message.
+   * \return nullptr if it is not configured.
+   */
+  static MemoryArena * get_shared();
+
+  /// The allocator of the shared arena, or the default allocator if it is not configured.
+  static rcutils_allocator_t get_shared_allocator();
+
+private:
+  uint8_t * begin_ {nullptr};
+  size_t size_ {0};
+  mutable std::mutex mutex_;
+  // Bytes of the arena handed out as blocks so far, freed or not.
+  size_t used_bytes_ {0};
+  uint64_t allocated_bytes_ {0};
+  // Freed blocks of every size class, linked through their first bytes.
+  std::vector<void *> free_blocks_;
+};
+
+}  // namespace rosbag2_storage
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE__MEMORY_ARENA_HPP_
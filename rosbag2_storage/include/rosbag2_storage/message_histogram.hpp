@@ -0,0 +1,71 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__MESSAGE_HISTOGRAM_HPP_
+#define ROSBAG2_STORAGE__MESSAGE_HISTOGRAM_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/visibility_control.hpp"
+
+namespace rosbag2_storage
+{
+
+/// Duration of the buckets of a new histogram, about 17 ms.
+constexpr std::chrono::nanoseconds kInitialHistogramBucketDuration{1 << 24};
+/// Buckets of a histogram at most, it is coarsened by doubling its bucket duration beyond.
+constexpr size_t kMaxHistogramBuckets = 1024;
+
+/**
+ * Counts a message in its bucket, extending the histogram to its time stamp if needed.
+ */
+ROSBAG2_STORAGE_PUBLIC
+void
+add_to_histogram(
+  MessageHistogram & histogram, rcutils_time_point_value_t time_stamp, uint64_t size);
+
+/**
+ * Removes a message counted by add_to_histogram(), e.g. when it is dropped before it is written.
+ */
+ROSBAG2_STORAGE_PUBLIC
+void
+remove_from_histogram(
+  MessageHistogram & histogram, rcutils_time_point_value_t time_stamp, uint64_t size);
+
+/**
+ * Adds the messages of another histogram of the topic, e.g. of another bagfile or host,
+ * coarsening the buckets of the histograms to the larger bucket duration of the two.
+ * Histograms without buckets leave the other one as it is.
+ */
+ROSBAG2_STORAGE_PUBLIC
+void
+merge_histograms(MessageHistogram & histogram, const MessageHistogram & other);
+
+/**
+ * Returns the histogram with buckets of the given duration, which must be the bucket duration
+ * of the histogram multiplied by a power of two.
+ * \throws std::invalid_argument if the duration is not such a multiple.
+ */
+ROSBAG2_STORAGE_PUBLIC
+MessageHistogram
+coarsen_histogram(const MessageHistogram & histogram, std::chrono::nanoseconds bucket_duration);
+
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__MESSAGE_HISTOGRAM_HPP_
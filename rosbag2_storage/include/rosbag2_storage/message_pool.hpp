@@ -0,0 +1,81 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__MESSAGE_POOL_HPP_
+#define ROSBAG2_STORAGE__MESSAGE_POOL_HPP_
+
+#include <cstddef>
+#include <memory>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage
+{
+
+/**
+ * Recycles messages and their serialized data buffers once the last reference to them is
+ * released, so reading many messages does not allocate memory for every one of them.
+ *
+ * A released buffer is handed out again for data which fits into it, or grown otherwise.
+ * Up to max_pooled_objects messages and as many buffers are kept. Objects may be released
+ * from any thread, also after the pool has been destroyed.
+ */
+class ROSBAG2_STORAGE_PUBLIC MessagePool
+{
+public:
+  explicit MessagePool(size_t max_pooled_objects = 256);
+
+  ~MessagePool();
+
+  MessagePool(const MessagePool &) = delete;
+  MessagePool & operator=(const MessagePool &) = delete;
+
+  /**
+   * Returns a message without serialized data, time stamp and topic.
+   */
+  std::shared_ptr<SerializedBagMessage> make_message();
+
+  /**
+   * Returns a buffer of at least the given capacity and a length of 0,
+   * like rosbag2_storage::make_empty_serialized_message().
+   */
+  std::shared_ptr<rcutils_uint8_array_t> make_empty_serialized_message(size_t size);
+
+  size_t get_pooled_message_count() const;
+
+  size_t get_pooled_buffer_count() const;
+
+private:
+  struct Pools;
+  std::shared_ptr<Pools> pools_;
+};
+
+}  // namespace rosbag2_storage
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE__MESSAGE_POOL_HPP_
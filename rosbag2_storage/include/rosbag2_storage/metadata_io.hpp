@@ -15,7 +15,9 @@
 #ifndef ROSBAG2_STORAGE__METADATA_IO_HPP_
 #define ROSBAG2_STORAGE__METADATA_IO_HPP_
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "rosbag2_storage/bag_metadata.hpp"
 #include "rosbag2_storage/visibility_control.hpp"
@@ -27,20 +29,79 @@ class MetadataIo
 {
 public:
   static constexpr const char * const metadata_filename = "metadata.yaml";
+  // Compact encoding of the metadata of bags of version 7 and newer, read in favor of the YAML
+  // file unless the YAML file was written after it.
+  static constexpr const char * const binary_metadata_filename = "metadata.bin";
+  // Appended to the name of a compressed bagfile for the uncompressed summary next to it.
+  static constexpr const char * const file_summary_suffix = ".summary.yaml";
 
   virtual ~MetadataIo() = default;
 
+  /**
+   * Writes the metadata file, and the binary metadata file if the version of the metadata
+   * has one.
+   */
   ROSBAG2_STORAGE_PUBLIC
   virtual void write_metadata(const std::string & uri, const BagMetadata & metadata);
 
+  /**
+   * Writes a checkpoint of metadata which is still being recorded, by appending what changed
+   * since the last call to the binary metadata file. The YAML metadata file is only written by
+   * write_metadata, when recording stops. Metadata versions without a binary metadata file are
+   * written by write_metadata instead.
+   */
+  ROSBAG2_STORAGE_PUBLIC
+  virtual void append_metadata(const std::string & uri, const BagMetadata & metadata);
+
+  /**
+   * Parsed metadata files are cached for the whole process and parsed again only once their
+   * modification time or size changed, or they were written by write_metadata.
+   * The bag size is determined on every call.
+   */
   ROSBAG2_STORAGE_PUBLIC
   virtual BagMetadata read_metadata(const std::string & uri);
 
   ROSBAG2_STORAGE_PUBLIC
   virtual bool metadata_file_exists(const std::string & uri);
 
+  /**
+   * Writes the summary of a single bagfile next to it, e.g. of a file compressed as a whole,
+   * which cannot be queried without decompressing it. The summary is the metadata of a bag of
+   * only this file, whose path is given relative to the bag directory.
+   *
+   * \param file_path path of the bagfile the summary is written next to
+   * \param summary metadata of the file
+   */
+  ROSBAG2_STORAGE_PUBLIC
+  virtual void write_file_summary(const std::string & file_path, const BagMetadata & summary);
+
+  /// Whether the bag directory has summaries of its files.
+  ROSBAG2_STORAGE_PUBLIC
+  virtual bool file_summaries_exist(const std::string & uri);
+
+  /**
+   * Reads the summaries of the files of the bag directory into the metadata of the bag, e.g. if
+   * its metadata file was lost. Only the summaries are read, never the files.
+   * The files are ordered by their starting time, and their paths include the bag directory.
+   *
+   * \throws std::runtime_error if the directory has no summaries or one cannot be parsed
+   */
+  ROSBAG2_STORAGE_PUBLIC
+  virtual BagMetadata read_file_summaries(const std::string & uri);
+
 private:
+  std::vector<std::string> get_file_summary_names(const std::string & uri);
   std::string get_metadata_file_name(const std::string & uri);
+  std::string get_binary_metadata_file_name(const std::string & uri);
+  void write_binary_metadata(const std::string & uri, const BagMetadata & metadata);
+
+  // Metadata last written to the binary metadata file of appended_uri_, which checkpoints are
+  // compared to, and the sizes of the file and its full record, to rewrite the file once the
+  // updates appended to it outgrow the full record.
+  std::string appended_uri_;
+  BagMetadata appended_metadata_;
+  uint64_t binary_file_size_ = 0;
+  uint64_t full_record_size_ = 0;
 };
 
 }  // namespace rosbag2_storage
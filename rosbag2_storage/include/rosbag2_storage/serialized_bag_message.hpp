@@ -15,6 +15,7 @@
 #ifndef ROSBAG2_STORAGE__SERIALIZED_BAG_MESSAGE_HPP_
 #define ROSBAG2_STORAGE__SERIALIZED_BAG_MESSAGE_HPP_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -24,11 +25,21 @@
 namespace rosbag2_storage
 {
 
+// Identifier of a topic assigned by a writer. See BaseWriteInterface::set_topic_handle().
+using TopicHandle = int64_t;
+constexpr TopicHandle INVALID_TOPIC_HANDLE = -1;
+
 struct SerializedBagMessage
 {
   std::shared_ptr<rcutils_uint8_array_t> serialized_data;
   rcutils_time_point_value_t time_stamp;
   std::string topic_name;
+  // Optional handle of the topic, from Writer::get_topic_handle() of the writer the message is
+  // written to. Writers and storages look up `topic_name` if it is INVALID_TOPIC_HANDLE.
+  TopicHandle topic_handle = INVALID_TOPIC_HANDLE;
+  // Time the message was published at, as reported by the middleware, or 0 if it is not known.
+  // Storages may return the receive time stamp for messages recorded without publish time.
+  rcutils_time_point_value_t publish_time_stamp = 0;
 };
 
 }  // namespace rosbag2_storage
@@ -0,0 +1,64 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__SERIALIZED_BAG_MESSAGE_VIEW_HPP_
+#define ROSBAG2_STORAGE__SERIALIZED_BAG_MESSAGE_VIEW_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+namespace rosbag2_storage
+{
+
+/**
+ * A message read without taking ownership of it, for processing messages which are not kept.
+ * The topic name and the serialized data are valid only while the view is passed to a callback.
+ * If the owner of the serialized data is set, copying the slice keeps the data alive beyond that.
+ */
+struct SerializedBagMessageView
+{
+  const std::string * topic_name = nullptr;
+  rcutils_time_point_value_t time_stamp = 0;
+  rcutils_time_point_value_t publish_time_stamp = 0;
+  BufferSlice serialized_data;
+};
+
+/// Called with the views of a batch of messages in reading order.
+using SerializedBagMessageViewBatchCallback =
+  std::function<void (const std::vector<SerializedBagMessageView> &)>;
+
+/// View of the message, which is valid as long as the message, and shares its serialized data.
+inline SerializedBagMessageView make_message_view(const SerializedBagMessage & message)
+{
+  SerializedBagMessageView view;
+  view.topic_name = &message.topic_name;
+  view.time_stamp = message.time_stamp;
+  view.publish_time_stamp = message.publish_time_stamp;
+  if (message.serialized_data) {
+    view.serialized_data = {
+      message.serialized_data->buffer, message.serialized_data->buffer_length,
+      message.serialized_data};
+  }
+  return view;
+}
+
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__SERIALIZED_BAG_MESSAGE_VIEW_HPP_
@@ -0,0 +1,76 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__SHARED_CLASS_LOADER_HPP_
+#define ROSBAG2_STORAGE__SHARED_CLASS_LOADER_HPP_
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "pluginlib/class_loader.hpp"
+
+namespace rosbag2_storage
+{
+
+/**
+ * Class loader of a plugin interface shared by all factories of the process, since creating
+ * one parses the plugin descriptions of all packages. The declared classes are looked up once
+ * and instances are created under a lock, because class loaders are not thread-safe.
+ */
+template<typename InterfaceT>
+class SharedClassLoader
+{
+public:
+  /**
+   * Returns the class loader of the interface, which is created by the first call.
+   *
+   * \param package Package which declares the plugin interface.
+   * \param base_class Fully qualified name of the plugin interface.
+   * \throws pluginlib::ClassLoaderException if the class loader cannot be created.
+   */
+  static SharedClassLoader & get_instance(const char * package, const char * base_class)
+  {
+    // Never destroyed, so plugins can outlive the static destruction of the loader.
+    static auto instance = new SharedClassLoader(package, base_class);
+    return *instance;
+  }
+
+  bool is_declared(const std::string & class_name) const
+  {
+    return declared_classes_.count(class_name) > 0;
+  }
+
+  InterfaceT * create_unmanaged_instance(const std::string & class_name)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return class_loader_.createUnmanagedInstance(class_name);
+  }
+
+private:
+  SharedClassLoader(const char * package, const char * base_class)
+  : class_loader_(package, base_class)
+  {
+    const auto declared_classes = class_loader_.getDeclaredClasses();
+    declared_classes_.insert(declared_classes.begin(), declared_classes.end());
+  }
+
+  pluginlib::ClassLoader<InterfaceT> class_loader_;
+  std::unordered_set<std::string> declared_classes_;
+  std::mutex mutex_;
+};
+
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__SHARED_CLASS_LOADER_HPP_
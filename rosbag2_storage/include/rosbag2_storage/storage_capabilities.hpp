@@ -0,0 +1,49 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__STORAGE_CAPABILITIES_HPP_
+#define ROSBAG2_STORAGE__STORAGE_CAPABILITIES_HPP_
+
+namespace rosbag2_storage
+{
+
+// Optional features of a storage plugin, which let readers and writers pick the fastest way to
+// use it. A plugin which does not report its capabilities is used without any of them.
+struct StorageCapabilities
+{
+  // Writing a vector of messages at once is faster than writing them one by one,
+  // e.g. because they are written in one transaction. Otherwise writers write the messages of
+  // their cache one by one.
+  bool batch_write = false;
+
+  // seek() continues reading at a time without reading the messages before it.
+  // Otherwise readers skip the earlier messages with the start time of the storage filter.
+  bool seek = false;
+
+  // Messages read are allocated from the message pool given with set_message_pool(). Readers
+  // hand their pool only to storages which use it.
+  bool message_pool = false;
+
+  // Messages of a topic are read by their index with read_topic_message() and looked up by time
+  // with find_topic_message().
+  bool random_access = false;
+
+  // The sampling of the storage filter is evaluated without reading the skipped messages.
+  // Otherwise the sampling is ignored and readers warn about it.
+  bool sampling = false;
+};
+
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__STORAGE_CAPABILITIES_HPP_
@@ -0,0 +1,87 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__STORAGE_CONFIG_HPP_
+#define ROSBAG2_STORAGE__STORAGE_CONFIG_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace rosbag2_storage
+{
+
+// Storage plugin specific settings, handed to the storage when it is opened.
+struct StorageConfig
+{
+  // Name of a preset profile defined by the storage plugin, e.g. "resilient" or
+  // "max_throughput" for sqlite3. An empty string selects the plugin's defaults.
+  std::string preset_profile;
+
+  // Build indices only when the storage is closed instead of when it is created.
+  // This makes writing faster, but a file that is not closed properly stays unindexed.
+  bool defer_index_creation = false;
+
+  // Additionally index messages by topic and time, which speeds up reading a selection of
+  // topics at the cost of slower writing and a larger file.
+  bool topic_timestamp_index = false;
+
+  // Store the messages of every topic together in time stamp order instead of in the order they
+  // are written, if the storage supports it. Reading a selection of topics then reads contiguous
+  // parts of the file instead of pages shared with all other topics, but writing is slower.
+  bool cluster_messages_by_topic = false;
+
+  // Store a CRC-32C checksum of every message, which is checked when the message is read,
+  // if the storage supports it. Storages which always checksum their data ignore this.
+  bool checksums = false;
+
+  // Messages larger than this many bytes are appended to a data file next to the storage file
+  // instead of being stored in it, if the storage supports it. Zero stores all messages inline.
+  uint64_t large_message_threshold = 0;
+
+  // Limits for batching single message writes into one transaction. The transaction is committed
+  // as soon as one of the limits is reached. Zero disables a limit, and if all are disabled
+  // every message is committed on its own.
+  uint64_t transaction_max_messages = 0;
+  uint64_t transaction_max_bytes = 0;
+  std::chrono::milliseconds transaction_max_duration{0};
+
+  // "host:port" of an ingest server the storage streams its files to instead of writing them,
+  // if the storage supports it. At most stream_max_memory_bytes of data not acknowledged by the
+  // server are kept in memory, the rest is spilled to a local file until it is sent.
+  std::string stream_address;
+  uint64_t stream_max_memory_bytes = 64 * 1024 * 1024;
+
+  // Disk space reserved for every file created for writing, if the storage and the file system
+  // support it, so appending to the file does not fragment it. The size of the file is not
+  // changed, and the space not used is released when the file is closed. Zero reserves none.
+  uint64_t preallocate_size = 0;
+
+  // Start writing back the data of a file being written every this many bytes, if the storage
+  // supports it, instead of leaving it to the kernel, which writes back all the dirty pages at
+  // once and stalls the writes meanwhile. Zero leaves writing back to the kernel.
+  uint64_t writeback_interval_bytes = 0;
+
+  // Size of the chunks of memory the memory storage copies the messages into. Larger messages
+  // get a chunk of their own.
+  uint64_t memory_chunk_size = 1024 * 1024;
+
+  // Memory all files of the memory storage may use together, writes beyond it fail. Zero keeps
+  // the limit of the memory bag store, which is unlimited by default.
+  uint64_t memory_max_bytes = 0;
+};
+
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__STORAGE_CONFIG_HPP_
@@ -50,6 +50,11 @@ public:
   std::shared_ptr<storage_interfaces::ReadWriteInterface>
   open_read_write(const std::string & uri, const std::string & storage_id) override;
 
+  std::shared_ptr<storage_interfaces::ReadWriteInterface>
+  open_read_write(
+    const std::string & uri, const std::string & storage_id,
+    const StorageConfig & storage_config) override;
+
 private:
   std::unique_ptr<StorageFactoryImpl> impl_;
 };
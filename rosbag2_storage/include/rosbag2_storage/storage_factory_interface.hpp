@@ -18,6 +18,7 @@
 #include <memory>
 #include <string>
 
+#include "rosbag2_storage/storage_config.hpp"
 #include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
 #include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
 #include "rosbag2_storage/visibility_control.hpp"
@@ -35,6 +36,15 @@ public:
 
   virtual std::shared_ptr<storage_interfaces::ReadWriteInterface>
   open_read_write(const std::string & uri, const std::string & storage_id) = 0;
+
+  virtual std::shared_ptr<storage_interfaces::ReadWriteInterface>
+  open_read_write(
+    const std::string & uri, const std::string & storage_id,
+    const StorageConfig & storage_config)
+  {
+    (void) storage_config;
+    return open_read_write(uri, storage_id);
+  }
 };
 
 }  // namespace rosbag2_storage
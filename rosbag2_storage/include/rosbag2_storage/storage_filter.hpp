@@ -15,20 +15,141 @@
 #ifndef ROSBAG2_STORAGE__STORAGE_FILTER_HPP_
 #define ROSBAG2_STORAGE__STORAGE_FILTER_HPP_
 
+#include <cstdint>
+#include <regex>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "rcutils/time.h"
+
+#include "rosbag2_storage/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
 namespace rosbag2_storage
 {
 
+struct TopicTimeRange
+{
+  // Regular expression (ECMAScript) of the topic names the time range applies to. The whole
+  // name has to match.
+  std::string topics_regex;
+  // Time range in nanoseconds since epoch, [start_time, end_time]. A bound of 0 leaves that end
+  // of the range open.
+  rcutils_time_point_value_t start_time = 0;
+  rcutils_time_point_value_t end_time = 0;
+};
+
 struct StorageFilter
 {
   // Topic names to whitelist when reading a bag. Only messages matching these
   // specified topics will be returned. If list is empty, the filter is ignored
   // and all messages are returned.
   std::vector<std::string> topics;
+
+  // Regular expression (ECMAScript) for topic names to whitelist, in addition to the topics.
+  // The whole name has to match. If empty, only the topics are whitelisted.
+  std::string topics_regex;
+
+  // Message types, e.g. "sensor_msgs/msg/Image", to whitelist. Only messages of topics of these
+  // types are returned, of those whitelisted by name or regex if any. If empty, topics of all
+  // types are returned.
+  std::vector<std::string> topic_types;
+
+  // Time range to read, in nanoseconds since epoch. Only messages with a time stamp within
+  // [start_time, end_time] are returned. A bound of 0 leaves that end of the range open.
+  rcutils_time_point_value_t start_time = 0;
+  rcutils_time_point_value_t end_time = 0;
+
+  // Order the messages by their publish time stamp instead of the time they were received at.
+  // The time range and seeking then refer to the publish time stamp as well.
+  // Storages without publish time stamps keep ordering by receive time.
+  bool order_by_publish_time = false;
+
+  // Sampling of the messages of every topic, e.g. for previews or datasets, by the time stamps
+  // the messages are ordered by. A message is skipped if it is less than sample_interval
+  // nanoseconds after the last message kept of its topic. Of the messages kept, only every
+  // sample_stride-th one of a topic is returned, starting with its first one in the time range.
+  // 0 disables either. Only storages with the sampling capability sample the messages, others
+  // return every message, which the sequential reader warns about. Sampling restarts with every
+  // file of a split bag.
+  rcutils_duration_value_t sample_interval = 0;
+  uint64_t sample_stride = 0;
+
+  // Time ranges of single topics, within the time range above, e.g. all of /tf but /camera/.*
+  // only around an event. Messages of a topic matching any of the ranges are only returned
+  // within one of the ranges it matches, those of other topics at any time. The ranges do not
+  // whitelist topics, which the whitelists above still select.
+  std::vector<TopicTimeRange> topic_time_ranges;
+};
+
+/**
+ * Decides which topics pass the topic, regex and type whitelists of a storage filter.
+ *
+ * Storages resolve the topics of a file against it once when preparing to read, so messages
+ * are filtered by topic id rather than by name or type.
+ */
+class ROSBAG2_STORAGE_PUBLIC TopicFilter
+{
+public:
+  /**
+   * \throws std::regex_error if the topics regex of the filter or of a topic time range is
+   *   invalid.
+   */
+  explicit TopicFilter(const StorageFilter & storage_filter);
+
+  /**
+   * Whether topics of all names and types pass, i.e. the filter has no whitelist.
+   */
+  bool selects_all_topics() const;
+
+  bool is_selected(const std::string & topic_name, const std::string & topic_type) const;
+
+  // Time range [first, second], with the open bounds of a topic time range replaced by the
+  // smallest and largest time point.
+  using TimeRange = std::pair<rcutils_time_point_value_t, rcutils_time_point_value_t>;
+
+  bool has_topic_time_ranges() const;
+
+  /**
+   * Time ranges of the topic time ranges matching the topic. Empty if there are none, then
+   * messages of the topic pass at any time.
+   */
+  std::vector<TimeRange> get_time_ranges(const std::string & topic_name) const;
+
+  /**
+   * Whether a message at the time stamp passes the time ranges of its topic.
+   */
+  static bool is_within(
+    const std::vector<TimeRange> & time_ranges, rcutils_time_point_value_t time_stamp);
+
+  /**
+   * Whether messages between start_time and end_time, both included, may pass the time ranges
+   * of their topic.
+   */
+  static bool overlaps(
+    const std::vector<TimeRange> & time_ranges, rcutils_time_point_value_t start_time,
+    rcutils_time_point_value_t end_time);
+
+private:
+  std::vector<std::string> topics_;
+  bool has_topics_regex_;
+  std::regex topics_regex_;
+  std::vector<std::string> topic_types_;
+  std::vector<std::pair<std::regex, TimeRange>> topic_time_ranges_;
 };
 
 }  // namespace rosbag2_storage
 
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
 #endif  // ROSBAG2_STORAGE__STORAGE_FILTER_HPP_
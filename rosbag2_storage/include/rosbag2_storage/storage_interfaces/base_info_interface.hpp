@@ -17,8 +17,10 @@
 #define ROSBAG2_STORAGE__STORAGE_INTERFACES__BASE_INFO_INTERFACE_HPP_
 
 #include <string>
+#include <vector>
 
 #include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/storage_capabilities.hpp"
 #include "rosbag2_storage/visibility_control.hpp"
 
 namespace rosbag2_storage
@@ -51,6 +53,26 @@ public:
    * \returns the identifier.
    */
   virtual std::string get_storage_identifier() const = 0;
+
+  /**
+   * Returns the optional features supported by the storage plugin.
+   * \returns the capabilities, none of them by default.
+   */
+  virtual StorageCapabilities get_capabilities() const
+  {
+    return StorageCapabilities{};
+  }
+
+  /**
+   * Sums up the sizes of the serialized messages of every topic, which get_metadata() leaves out
+   * as it scans all messages. Used for bags whose metadata was recorded without the sizes.
+   * \returns the topics with their message count and sizes, or none if the storage plugin does
+   * not support it.
+   */
+  virtual std::vector<TopicInformation> get_topic_sizes()
+  {
+    return {};
+  }
 };
 
 }  // namespace storage_interfaces
@@ -17,6 +17,7 @@
 
 #include <string>
 
+#include "rosbag2_storage/storage_config.hpp"
 #include "rosbag2_storage/visibility_control.hpp"
 
 namespace rosbag2_storage
@@ -50,6 +51,20 @@ public:
    * The storage plugin will append the uri in the case of creating a new bagfile backing.
    */
   virtual void open(const std::string & uri, IOFlag io_flag) = 0;
+
+  /**
+   * Opens the storage plugin with plugin specific settings.
+   * Storage plugins without configurable settings ignore the storage_config.
+   * \param uri is the path to the bagfile, see open(uri, io_flag).
+   * \param io_flag is a hint for the type of storage plugin to open, see open(uri, io_flag).
+   * \param storage_config holds the plugin specific settings.
+   */
+  virtual void open(
+    const std::string & uri, IOFlag io_flag, const StorageConfig & storage_config)
+  {
+    (void) storage_config;
+    open(uri, io_flag);
+  }
 };
 
 }  // namespace storage_interfaces
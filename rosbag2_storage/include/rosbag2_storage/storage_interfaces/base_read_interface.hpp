@@ -16,10 +16,13 @@
 #define ROSBAG2_STORAGE__STORAGE_INTERFACES__BASE_READ_INTERFACE_HPP_
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "rosbag2_storage/message_pool.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/serialized_bag_message_view.hpp"
 #include "rosbag2_storage/topic_metadata.hpp"
 #include "rosbag2_storage/visibility_control.hpp"
 
@@ -37,7 +40,161 @@ public:
 
   virtual std::shared_ptr<SerializedBagMessage> read_next() = 0;
 
+  /**
+   * Reads the next messages, up to max_messages messages, stopping after the message which
+   * brings the serialized data read to max_bytes. A limit of 0 disables it.
+   * \return the messages read, which are none only if there are no more messages.
+   */
+  virtual std::vector<std::shared_ptr<SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes)
+  {
+    std::vector<std::shared_ptr<SerializedBagMessage>> messages;
+    size_t bytes = 0;
+    while ((max_messages == 0 || messages.size() < max_messages) &&
+      (max_bytes == 0 || bytes < max_bytes) && has_next())
+    {
+      messages.push_back(read_next());
+      bytes += messages.back()->serialized_data ?
+        messages.back()->serialized_data->buffer_length : 0;
+    }
+    return messages;
+  }
+
+  /**
+   * Passes the next messages to the callback as views, with the limits of read_next_batch(),
+   * which saves taking ownership of every message when they are not kept. Storage plugins pass
+   * views into their buffers where they can, by default the messages are read with
+   * read_next_batch().
+   * \return whether any message was passed, which is false only if there are no more messages.
+   */
+  virtual bool visit_next_batch(
+    const SerializedBagMessageViewBatchCallback & callback, size_t max_messages,
+    size_t max_bytes)
+  {
+    const auto messages = read_next_batch(max_messages, max_bytes);
+    if (messages.empty()) {
+      return false;
+    }
+    std::vector<SerializedBagMessageView> views;
+    views.reserve(messages.size());
+    for (const auto & message : messages) {
+      views.push_back(make_message_view(*message));
+    }
+    callback(views);
+    return true;
+  }
+
   virtual std::vector<TopicMetadata> get_all_topics_and_types() = 0;
+
+  /**
+   * Continues reading with the first message whose time stamp is at or after the given time.
+   * Messages are still subject to the storage filter.
+   * \param timestamp in nanoseconds since epoch.
+   * \throws std::runtime_error if the storage plugin does not support seeking.
+   */
+  virtual void seek(const rcutils_time_point_value_t & timestamp)
+  {
+    (void) timestamp;
+    throw std::runtime_error("This storage plugin does not support seeking.");
+  }
+
+  /**
+   * Number of messages of the topic, i.e. the end of the indices read_topic_message() takes.
+   * \throws std::runtime_error if the storage plugin does not support random access.
+   */
+  virtual uint64_t get_topic_message_count(const std::string & topic_name)
+  {
+    (void) topic_name;
+    throw std::runtime_error("This storage plugin does not support random access.");
+  }
+
+  /**
+   * Reads the message of the topic with the given index, counting the messages of the topic in
+   * time stamp order from 0. Neither depends on nor changes the storage filter or the position
+   * of read_next().
+   * \throws std::out_of_range if the topic has no message with the index.
+   * \throws std::runtime_error if the storage plugin does not support random access.
+   */
+  virtual std::shared_ptr<SerializedBagMessage> read_topic_message(
+    const std::string & topic_name, uint64_t index)
+  {
+    (void) topic_name;
+    (void) index;
+    throw std::runtime_error("This storage plugin does not support random access.");
+  }
+
+  /**
+   * Index of the first message of the topic with a time stamp at or after the given time, or
+   * the message count of the topic if there is none.
+   * \throws std::runtime_error if the storage plugin does not support random access.
+   */
+  virtual uint64_t find_topic_message(
+    const std::string & topic_name, const rcutils_time_point_value_t & timestamp)
+  {
+    (void) topic_name;
+    (void) timestamp;
+    throw std::runtime_error("This storage plugin does not support random access.");
+  }
+
+  /**
+   * Reads the latest message before the given time of each of the topics which has one, e.g. to
+   * publish the last values of latched topics when seeking, as the messages at the time are
+   * read next after seeking to it. Neither depends on nor changes the storage filter or the
+   * position of read_next(). By default the messages are found by random access.
+   * \throws std::runtime_error if the storage plugin does not support random access.
+   */
+  virtual std::vector<std::shared_ptr<SerializedBagMessage>> read_latest_messages(
+    const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+  {
+    std::vector<std::shared_ptr<SerializedBagMessage>> messages;
+    for (const auto & topic_name : topic_names) {
+      const auto index = find_topic_message(topic_name, timestamp);
+      if (index > 0) {
+        messages.push_back(read_topic_message(topic_name, index - 1));
+      }
+    }
+    return messages;
+  }
+
+  /**
+   * Makes the messages committed to a file which is still being recorded since has_next() last
+   * returned false readable, for following it while it is written.
+   * \return whether there are messages to read now. Storage plugins which cannot follow a file
+   * return has_next().
+   */
+  virtual bool poll_new_messages()
+  {
+    return has_next();
+  }
+
+  /**
+   * Allocates the messages read and their serialized data from the given pool, or as usual if
+   * it is null. Storage plugins which do not support pools ignore it.
+   */
+  virtual void set_message_pool(std::shared_ptr<MessagePool> message_pool)
+  {
+    (void) message_pool;
+  }
+
+  /**
+   * Copies the messages with time stamps in the inclusive range from start_time to end_time,
+   * and all topics, into a new file of the same storage at the uri, named as opening the uri
+   * for writing would name it. Storage plugins copy the stored messages as they are, without
+   * reading them into memory one by one. Neither depends on nor changes the storage filter or
+   * the position of read_next().
+   * \return the path of the file written.
+   * \throws std::runtime_error if the file exists or the storage plugin does not support
+   * slicing.
+   */
+  virtual std::string slice(
+    const std::string & uri, const rcutils_time_point_value_t & start_time,
+    const rcutils_time_point_value_t & end_time)
+  {
+    (void) uri;
+    (void) start_time;
+    (void) end_time;
+    throw std::runtime_error("This storage plugin does not support slicing.");
+  }
 };
 
 }  // namespace storage_interfaces
@@ -40,7 +40,35 @@ public:
 
   virtual void create_topic(const TopicMetadata & topic) = 0;
 
+  /**
+   * Creates the topics like create_topic() does, which storages may do at once, e.g. in a single
+   * transaction.
+   *
+   * \param topics the topics to create
+   */
+  virtual void create_topics(const std::vector<TopicMetadata> & topics)
+  {
+    for (const auto & topic : topics) {
+      create_topic(topic);
+    }
+  }
+
   virtual void remove_topic(const TopicMetadata & topic) = 0;
+
+  /**
+   * Assigns a handle to a topic previously created with create_topic().
+   * Messages whose SerializedBagMessage::topic_handle is the handle are written to the topic
+   * without looking it up by name. Writers assign small, dense handles which stay the same for a
+   * topic in all storages of a bag. Storages which do not support handles ignore them.
+   *
+   * \param topic_name name of the created topic
+   * \param handle the handle of the topic, not negative
+   */
+  virtual void set_topic_handle(const std::string & topic_name, TopicHandle handle)
+  {
+    (void) topic_name;
+    (void) handle;
+  }
 };
 
 }  // namespace storage_interfaces
@@ -34,6 +34,7 @@ class ROSBAG2_STORAGE_PUBLIC ReadOnlyInterface
 public:
   virtual ~ReadOnlyInterface() = default;
 
+  using BaseIOInterface::open;
   void open(const std::string & uri, IOFlag io_flag = IOFlag::READ_ONLY) override = 0;
 
   uint64_t get_bagfile_size() const override = 0;
@@ -33,6 +33,7 @@ class ROSBAG2_STORAGE_PUBLIC ReadWriteInterface
 public:
   ~ReadWriteInterface() override = default;
 
+  using ReadOnlyInterface::open;
   void open(const std::string & uri, IOFlag io_flag = IOFlag::READ_WRITE) override = 0;
 
   uint64_t get_bagfile_size() const override = 0;
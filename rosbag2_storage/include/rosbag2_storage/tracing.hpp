@@ -0,0 +1,57 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__TRACING_HPP_
+#define ROSBAG2_STORAGE__TRACING_HPP_
+
+/**
+ * Tracepoints on the hot path of recording and playback, for ros2_tracing or LTTng directly.
+ * The events of the "rosbag2" provider are enabled e.g. with
+ *
+ *   ros2 trace --ust 'rosbag2:*' 'ros2:*'
+ *
+ * Messages are identified by their topic name and time stamp, so the events of a message can be
+ * joined into a timeline from its subscription callback to the storage, or from reading it to
+ * publishing it.
+ *
+ * The tracepoints are compiled in if LTTng is found and ROSBAG2_DISABLE_TRACING is not set when
+ * building rosbag2_storage. They are inline and only check whether their event is enabled, and
+ * their arguments are only evaluated if it is. If they are compiled out, ROSBAG2_TRACEPOINT
+ * expands to nothing.
+ *
+ * The probes are registered by rosbag2_storage. Every other library using the tracepoints defines
+ * ROSBAG2_TRACEPOINT_DEFINE before including this header in exactly one of its source files,
+ * which defines the tracepoints of the library.
+ */
+
+#include "rosbag2_storage/tracing_config.hpp"
+
+#ifdef ROSBAG2_TRACING_ENABLED
+
+#ifdef ROSBAG2_TRACEPOINT_DEFINE
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#endif
+
+#include "rosbag2_storage/tracing_provider.h"
+
+#define ROSBAG2_TRACEPOINT(event_name, ...) tracepoint(rosbag2, event_name, __VA_ARGS__)
+
+#else
+
+#define ROSBAG2_TRACEPOINT(event_name, ...) ((void) 0)
+
+#endif  // ROSBAG2_TRACING_ENABLED
+
+#endif  // ROSBAG2_STORAGE__TRACING_HPP_
@@ -0,0 +1,211 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tracepoint provider of the events of rosbag2_storage/tracing.hpp, only included if tracing is
+// enabled. Use rosbag2_storage/tracing.hpp instead of including it directly.
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER rosbag2
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "rosbag2_storage/tracing_provider.h"
+
+#if !defined(ROSBAG2_STORAGE__TRACING_PROVIDER_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define ROSBAG2_STORAGE__TRACING_PROVIDER_H_
+
+#include <stdint.h>
+
+#include <lttng/tracepoint.h>
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  subscription_callback,
+  TP_ARGS(
+    const char *, topic_name_arg,
+    int64_t, time_stamp_arg,
+    uint64_t, size_arg
+  ),
+  TP_FIELDS(
+    ctf_string(topic_name, topic_name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+    ctf_integer(uint64_t, size, size_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  writer_write,
+  TP_ARGS(
+    const char *, topic_name_arg,
+    int64_t, time_stamp_arg,
+    uint64_t, size_arg
+  ),
+  TP_FIELDS(
+    ctf_string(topic_name, topic_name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+    ctf_integer(uint64_t, size, size_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  cache_flush_begin,
+  TP_ARGS(
+    uint64_t, message_count_arg
+  ),
+  TP_FIELDS(
+    ctf_integer(uint64_t, message_count, message_count_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  cache_flush_end,
+  TP_ARGS(
+    uint64_t, message_count_arg
+  ),
+  TP_FIELDS(
+    ctf_integer(uint64_t, message_count, message_count_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  storage_write,
+  TP_ARGS(
+    const char *, topic_name_arg,
+    int64_t, time_stamp_arg
+  ),
+  TP_FIELDS(
+    ctf_string(topic_name, topic_name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  storage_write_batch_begin,
+  TP_ARGS(
+    uint64_t, message_count_arg
+  ),
+  TP_FIELDS(
+    ctf_integer(uint64_t, message_count, message_count_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  storage_write_batch_end,
+  TP_ARGS(
+    uint64_t, message_count_arg
+  ),
+  TP_FIELDS(
+    ctf_integer(uint64_t, message_count, message_count_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  storage_commit_begin,
+  TP_ARGS(
+    uint64_t, message_count_arg
+  ),
+  TP_FIELDS(
+    ctf_integer(uint64_t, message_count, message_count_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  storage_commit_end,
+  TP_ARGS(
+    uint64_t, message_count_arg
+  ),
+  TP_FIELDS(
+    ctf_integer(uint64_t, message_count, message_count_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  split,
+  TP_ARGS(
+    const char *, closed_file_arg,
+    const char *, opened_file_arg
+  ),
+  TP_FIELDS(
+    ctf_string(closed_file, closed_file_arg)
+    ctf_string(opened_file, opened_file_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  compression_begin,
+  TP_ARGS(
+    const char *, name_arg,
+    int64_t, time_stamp_arg,
+    uint64_t, size_arg
+  ),
+  TP_FIELDS(
+    ctf_string(name, name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+    ctf_integer(uint64_t, size, size_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  compression_end,
+  TP_ARGS(
+    const char *, name_arg,
+    int64_t, time_stamp_arg,
+    uint64_t, size_arg
+  ),
+  TP_FIELDS(
+    ctf_string(name, name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+    ctf_integer(uint64_t, size, size_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  read_next,
+  TP_ARGS(
+    const char *, topic_name_arg,
+    int64_t, time_stamp_arg
+  ),
+  TP_FIELDS(
+    ctf_string(topic_name, topic_name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+  )
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  publish,
+  TP_ARGS(
+    const char *, topic_name_arg,
+    int64_t, time_stamp_arg
+  ),
+  TP_FIELDS(
+    ctf_string(topic_name, topic_name_arg)
+    ctf_integer(int64_t, time_stamp, time_stamp_arg)
+  )
+)
+
+#endif  // ROSBAG2_STORAGE__TRACING_PROVIDER_H_
+
+#include <lttng/tracepoint-event.h>
@@ -0,0 +1,564 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "binary_metadata.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rosbag2_storage
+{
+namespace binary_metadata
+{
+namespace
+{
+
+constexpr const char MAGIC[] = "ROSBAG2M";
+constexpr const size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+constexpr const uint32_t FORMAT_VERSION = 1;
+
+enum RecordType : uint8_t
+{
+  FULL_RECORD = 1,
+  UPDATE_RECORD = 2,
+};
+
+using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+/// Appends little endian integers and length prefixed strings to a buffer.
+class Encoder
+{
+public:
+  explicit Encoder(std::string & buffer)
+  : buffer_(buffer) {}
+
+  void put_uint8(uint8_t value)
+  {
+    buffer_.push_back(static_cast<char>(value));
+  }
+
+  void put_uint32(uint32_t value)
+  {
+    for (int i = 0; i < 4; ++i) {
+      put_uint8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  void put_uint64(uint64_t value)
+  {
+    for (int i = 0; i < 8; ++i) {
+      put_uint8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  void put_int64(int64_t value)
+  {
+    put_uint64(static_cast<uint64_t>(value));
+  }
+
+  void put_string(const std::string & value)
+  {
+    put_uint64(value.size());
+    buffer_.append(value);
+  }
+
+  void put_strings(const std::vector<std::string> & values)
+  {
+    put_uint64(values.size());
+    for (const auto & value : values) {
+      put_string(value);
+    }
+  }
+
+  void put_topic(const TopicInformation & topic, int version)
+  {
+    put_string(topic.topic_metadata.name);
+    put_string(topic.topic_metadata.type);
+    put_string(topic.topic_metadata.serialization_format);
+    put_string(topic.topic_metadata.offered_qos_profiles);
+    put_uint64(topic.message_count);
+    put_uint64(topic.total_size);
+    put_uint64(topic.max_message_size);
+    put_uint64(topic.compressed_size);
+    if (version >= 9) {
+      put_uint64(topic.dropped_message_count);
+    }
+    if (version >= 10) {
+      put_string(topic.compression_format);
+    }
+    if (version >= 12) {
+      put_uint8(topic.deduplicated ? 1 : 0);
+    }
+    if (version >= 13) {
+      put_uint8(topic.delta_encoded ? 1 : 0);
+    }
+    if (version >= 14) {
+      put_histogram(topic.histogram);
+    }
+  }
+
+  void put_histogram(const MessageHistogram & histogram)
+  {
+    put_int64(histogram.starting_time.time_since_epoch().count());
+    put_int64(histogram.bucket_duration.count());
+    put_uint64(histogram.message_counts.size());
+    for (size_t i = 0; i < histogram.message_counts.size(); ++i) {
+      put_uint64(histogram.message_counts[i]);
+      put_uint64(histogram.sizes[i]);
+    }
+  }
+
+  void put_file(const FileInformation & file)
+  {
+    put_string(file.path);
+    put_uint8(file.indexed ? 1 : 0);
+    put_int64(file.starting_time.time_since_epoch().count());
+    put_int64(file.duration.count());
+    put_uint64(file.stripe);
+    put_strings(file.topics);
+    put_uint64(file.topic_message_counts.size());
+    for (const auto count : file.topic_message_counts) {
+      put_uint64(count);
+    }
+    put_uint64(file.message_count);
+    put_uint64(file.size);
+  }
+
+private:
+  std::string & buffer_;
+};
+
+/// Reads what Encoder wrote, throwing a runtime_error when reading past the end.
+class Decoder
+{
+public:
+  Decoder(const std::string & buffer, size_t begin, size_t end)
+  : buffer_(buffer), position_(begin), end_(end) {}
+
+  bool at_end() const
+  {
+    return position_ == end_;
+  }
+
+  uint8_t get_uint8()
+  {
+    require(1);
+    return static_cast<uint8_t>(buffer_[position_++]);
+  }
+
+  uint32_t get_uint32()
+  {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= static_cast<uint32_t>(get_uint8()) << (8 * i);
+    }
+    return value;
+  }
+
+  uint64_t get_uint64()
+  {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(get_uint8()) << (8 * i);
+    }
+    return value;
+  }
+
+  int64_t get_int64()
+  {
+    return static_cast<int64_t>(get_uint64());
+  }
+
+  std::string get_string()
+  {
+    const auto size = get_size();
+    std::string value = buffer_.substr(position_, size);
+    position_ += size;
+    return value;
+  }
+
+  std::vector<std::string> get_strings()
+  {
+    std::vector<std::string> values(get_size());
+    for (auto & value : values) {
+      value = get_string();
+    }
+    return values;
+  }
+
+  TopicInformation get_topic(int version)
+  {
+    TopicInformation topic{};
+    topic.topic_metadata.name = get_string();
+    topic.topic_metadata.type = get_string();
+    topic.topic_metadata.serialization_format = get_string();
+    topic.topic_metadata.offered_qos_profiles = get_string();
+    topic.message_count = get_uint64();
+    topic.total_size = get_uint64();
+    topic.max_message_size = get_uint64();
+    topic.compressed_size = get_uint64();
+    if (version >= 9) {
+      topic.dropped_message_count = get_uint64();
+    }
+    if (version >= 10) {
+      topic.compression_format = get_string();
+    }
+    if (version >= 12) {
+      topic.deduplicated = get_uint8() != 0;
+    }
+    if (version >= 13) {
+      topic.delta_encoded = get_uint8() != 0;
+    }
+    if (version >= 14) {
+      topic.histogram = get_histogram();
+    }
+    return topic;
+  }
+
+  MessageHistogram get_histogram()
+  {
+    MessageHistogram histogram;
+    histogram.starting_time = TimePoint(std::chrono::nanoseconds(get_int64()));
+    histogram.bucket_duration = std::chrono::nanoseconds(get_int64());
+    const auto bucket_count = get_size();
+    histogram.message_counts.resize(bucket_count);
+    histogram.sizes.resize(bucket_count);
+    for (size_t i = 0; i < bucket_count; ++i) {
+      histogram.message_counts[i] = get_uint64();
+      histogram.sizes[i] = get_uint64();
+    }
+    return histogram;
+  }
+
+  FileInformation get_file()
+  {
+    FileInformation file{};
+    file.path = get_string();
+    file.indexed = get_uint8() != 0;
+    file.starting_time = TimePoint(std::chrono::nanoseconds(get_int64()));
+    file.duration = std::chrono::nanoseconds(get_int64());
+    file.stripe = get_uint64();
+    file.topics = get_strings();
+    file.topic_message_counts.resize(get_size());
+    for (auto & count : file.topic_message_counts) {
+      count = get_uint64();
+    }
+    file.message_count = get_uint64();
+    file.size = get_uint64();
+    return file;
+  }
+
+  /// Reads a size or count, which cannot be larger than the bytes left.
+  size_t get_size()
+  {
+    const auto size = get_uint64();
+    require(size);
+    return static_cast<size_t>(size);
+  }
+
+private:
+  void require(uint64_t size) const
+  {
+    if (size > end_ - position_) {
+      throw std::runtime_error("The binary metadata is truncated.");
+    }
+  }
+
+  const std::string & buffer_;
+  size_t position_;
+  size_t end_;
+};
+
+bool same_topic(const TopicInformation & a, const TopicInformation & b)
+{
+  return a.topic_metadata == b.topic_metadata && a.message_count == b.message_count &&
+         a.total_size == b.total_size && a.max_message_size == b.max_message_size &&
+         a.compressed_size == b.compressed_size &&
+         a.dropped_message_count == b.dropped_message_count &&
+         a.compression_format == b.compression_format && a.deduplicated == b.deduplicated &&
+         a.delta_encoded == b.delta_encoded &&
+         a.histogram.starting_time == b.histogram.starting_time &&
+         a.histogram.bucket_duration == b.histogram.bucket_duration &&
+         a.histogram.message_counts == b.histogram.message_counts &&
+         a.histogram.sizes == b.histogram.sizes;
+}
+
+bool same_file(const FileInformation & a, const FileInformation & b)
+{
+  return a.path == b.path && a.indexed == b.indexed && a.starting_time == b.starting_time &&
+         a.duration == b.duration && a.stripe == b.stripe && a.topics == b.topics &&
+         a.topic_message_counts == b.topic_message_counts &&
+         a.message_count == b.message_count && a.size == b.size;
+}
+
+// Index of the first element of current which differs from previous.
+template<typename T, typename Equal>
+size_t first_change(const std::vector<T> & previous, const std::vector<T> & current, Equal equal)
+{
+  size_t index = 0;
+  while (index < previous.size() && index < current.size() &&
+    equal(previous[index], current[index]))
+  {
+    ++index;
+  }
+  return index;
+}
+
+std::string encode_record(RecordType type, const std::string & payload)
+{
+  std::string record;
+  Encoder encoder(record);
+  encoder.put_uint8(type);
+  encoder.put_string(payload);
+  return record;
+}
+
+void decode_full_record(Decoder & decoder, BagMetadata & metadata)
+{
+  metadata.version = static_cast<int>(decoder.get_uint32());
+  metadata.storage_identifier = decoder.get_string();
+  metadata.relative_file_paths = decoder.get_strings();
+  metadata.files.resize(decoder.get_size());
+  for (auto & file : metadata.files) {
+    file = decoder.get_file();
+  }
+  metadata.duration = std::chrono::nanoseconds(decoder.get_int64());
+  metadata.starting_time = TimePoint(std::chrono::nanoseconds(decoder.get_int64()));
+  metadata.message_count = decoder.get_uint64();
+  metadata.topics_with_message_count.resize(decoder.get_size());
+  for (auto & topic : metadata.topics_with_message_count) {
+    topic = decoder.get_topic(metadata.version);
+  }
+  metadata.compression_format = decoder.get_string();
+  metadata.compression_mode = decoder.get_string();
+  metadata.cache_high_water_mark_bytes = decoder.get_uint64();
+  metadata.compression_dictionaries = decoder.get_strings();
+  if (metadata.version >= 8) {
+    metadata.bag_id = decoder.get_string();
+    metadata.clock_offset = std::chrono::nanoseconds(decoder.get_int64());
+  }
+  if (metadata.version >= 11) {
+    metadata.encryption_format = decoder.get_string();
+    metadata.encryption_key_id = decoder.get_string();
+    metadata.encrypted_key = decoder.get_string();
+  }
+}
+
+void decode_update_record(Decoder & decoder, BagMetadata & metadata)
+{
+  metadata.duration = std::chrono::nanoseconds(decoder.get_int64());
+  metadata.starting_time = TimePoint(std::chrono::nanoseconds(decoder.get_int64()));
+  metadata.message_count = decoder.get_uint64();
+  metadata.cache_high_water_mark_bytes = decoder.get_uint64();
+
+  const auto first_changed_path = decoder.get_uint64();
+  if (first_changed_path > metadata.relative_file_paths.size()) {
+    throw std::runtime_error("The binary metadata updates files it does not have.");
+  }
+  metadata.relative_file_paths.resize(static_cast<size_t>(first_changed_path));
+  for (auto path_count = decoder.get_size(); path_count > 0; --path_count) {
+    metadata.relative_file_paths.push_back(decoder.get_string());
+  }
+
+  const auto first_changed_file = decoder.get_uint64();
+  if (first_changed_file > metadata.files.size()) {
+    throw std::runtime_error("The binary metadata updates files it does not have.");
+  }
+  metadata.files.resize(static_cast<size_t>(first_changed_file));
+  for (auto file_count = decoder.get_size(); file_count > 0; --file_count) {
+    metadata.files.push_back(decoder.get_file());
+  }
+
+  auto & topics = metadata.topics_with_message_count;
+  std::unordered_map<std::string, size_t> topic_indices;
+  for (size_t i = 0; i < topics.size(); ++i) {
+    topic_indices[topics[i].topic_metadata.name] = i;
+  }
+  for (auto topic_count = decoder.get_size(); topic_count > 0; --topic_count) {
+    auto topic = decoder.get_topic(metadata.version);
+    const auto existing = topic_indices.find(topic.topic_metadata.name);
+    if (existing == topic_indices.end()) {
+      topic_indices[topic.topic_metadata.name] = topics.size();
+      topics.push_back(std::move(topic));
+    } else {
+      topics[existing->second] = std::move(topic);
+    }
+  }
+}
+
+}  // namespace
+
+std::string encode_header()
+{
+  std::string header(MAGIC, MAGIC_SIZE);
+  Encoder(header).put_uint32(FORMAT_VERSION);
+  return header;
+}
+
+std::string encode_full_record(const BagMetadata & metadata)
+{
+  std::string payload;
+  Encoder encoder(payload);
+  encoder.put_uint32(static_cast<uint32_t>(metadata.version));
+  encoder.put_string(metadata.storage_identifier);
+  encoder.put_strings(metadata.relative_file_paths);
+  encoder.put_uint64(metadata.files.size());
+  for (const auto & file : metadata.files) {
+    encoder.put_file(file);
+  }
+  encoder.put_int64(metadata.duration.count());
+  encoder.put_int64(metadata.starting_time.time_since_epoch().count());
+  encoder.put_uint64(metadata.message_count);
+  encoder.put_uint64(metadata.topics_with_message_count.size());
+  for (const auto & topic : metadata.topics_with_message_count) {
+    encoder.put_topic(topic, metadata.version);
+  }
+  encoder.put_string(metadata.compression_format);
+  encoder.put_string(metadata.compression_mode);
+  encoder.put_uint64(metadata.cache_high_water_mark_bytes);
+  encoder.put_strings(metadata.compression_dictionaries);
+  if (metadata.version >= 8) {
+    encoder.put_string(metadata.bag_id);
+    encoder.put_int64(metadata.clock_offset.count());
+  }
+  if (metadata.version >= 11) {
+    encoder.put_string(metadata.encryption_format);
+    encoder.put_string(metadata.encryption_key_id);
+    encoder.put_string(metadata.encrypted_key);
+  }
+  return encode_record(FULL_RECORD, payload);
+}
+
+bool encode_update_record(
+  const BagMetadata & previous, const BagMetadata & current, std::string & record)
+{
+  if (previous.version != current.version ||
+    previous.storage_identifier != current.storage_identifier ||
+    previous.compression_format != current.compression_format ||
+    previous.compression_mode != current.compression_mode ||
+    previous.compression_dictionaries != current.compression_dictionaries ||
+    previous.bag_id != current.bag_id || previous.clock_offset != current.clock_offset ||
+    previous.encryption_format != current.encryption_format ||
+    previous.encryption_key_id != current.encryption_key_id ||
+    previous.encrypted_key != current.encrypted_key)
+  {
+    return false;
+  }
+
+  // Topics are matched by name, as their order may change between checkpoints.
+  std::unordered_map<std::string, const TopicInformation *> previous_topics;
+  for (const auto & topic : previous.topics_with_message_count) {
+    previous_topics[topic.topic_metadata.name] = &topic;
+  }
+  std::vector<const TopicInformation *> changed_topics;
+  size_t kept_topic_count = 0;
+  for (const auto & topic : current.topics_with_message_count) {
+    const auto existing = previous_topics.find(topic.topic_metadata.name);
+    if (existing == previous_topics.end()) {
+      changed_topics.push_back(&topic);
+      continue;
+    }
+    ++kept_topic_count;
+    if (!same_topic(*existing->second, topic)) {
+      changed_topics.push_back(&topic);
+    }
+  }
+  if (kept_topic_count != previous_topics.size()) {
+    return false;  // a topic was removed
+  }
+
+  std::string payload;
+  Encoder encoder(payload);
+  encoder.put_int64(current.duration.count());
+  encoder.put_int64(current.starting_time.time_since_epoch().count());
+  encoder.put_uint64(current.message_count);
+  encoder.put_uint64(current.cache_high_water_mark_bytes);
+
+  const auto first_changed_path = first_change(
+    previous.relative_file_paths, current.relative_file_paths,
+    [](const std::string & a, const std::string & b) {return a == b;});
+  encoder.put_uint64(first_changed_path);
+  encoder.put_uint64(current.relative_file_paths.size() - first_changed_path);
+  for (size_t i = first_changed_path; i < current.relative_file_paths.size(); ++i) {
+    encoder.put_string(current.relative_file_paths[i]);
+  }
+
+  const auto first_changed_file = first_change(previous.files, current.files, same_file);
+  encoder.put_uint64(first_changed_file);
+  encoder.put_uint64(current.files.size() - first_changed_file);
+  for (size_t i = first_changed_file; i < current.files.size(); ++i) {
+    encoder.put_file(current.files[i]);
+  }
+
+  encoder.put_uint64(changed_topics.size());
+  for (const auto topic : changed_topics) {
+    encoder.put_topic(*topic, current.version);
+  }
+  record = encode_record(UPDATE_RECORD, payload);
+  return true;
+}
+
+BagMetadata decode(const std::string & contents)
+{
+  if (contents.compare(0, MAGIC_SIZE, MAGIC) != 0) {
+    throw std::runtime_error("The file is no binary metadata file.");
+  }
+  Decoder header(contents, MAGIC_SIZE, contents.size());
+  if (header.get_uint32() > FORMAT_VERSION) {
+    throw std::runtime_error("The binary metadata file was written by a newer version of rosbag2.");
+  }
+
+  BagMetadata metadata{};
+  bool has_full_record = false;
+  size_t position = MAGIC_SIZE + 4;
+  while (position < contents.size()) {
+    Decoder record(contents, position, contents.size());
+    uint8_t type = 0;
+    size_t payload_size = 0;
+    try {
+      type = record.get_uint8();
+      payload_size = static_cast<size_t>(record.get_uint64());
+    } catch (const std::runtime_error &) {
+      break;
+    }
+    const size_t payload_begin = position + 9;
+    if (payload_size > contents.size() - payload_begin) {
+      break;  // cut off while it was appended
+    }
+    Decoder payload(contents, payload_begin, payload_begin + payload_size);
+    if (type == FULL_RECORD) {
+      decode_full_record(payload, metadata);
+      has_full_record = true;
+    } else if (type == UPDATE_RECORD) {
+      if (!has_full_record) {
+        throw std::runtime_error("The binary metadata has an update without a full record.");
+      }
+      decode_update_record(payload, metadata);
+    }
+    // Records of unknown types, written by newer versions, are skipped.
+    position = payload_begin + payload_size;
+  }
+  if (!has_full_record) {
+    throw std::runtime_error("The binary metadata file is empty.");
+  }
+  return metadata;
+}
+
+}  // namespace binary_metadata
+}  // namespace rosbag2_storage
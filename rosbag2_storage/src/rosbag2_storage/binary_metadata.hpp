@@ -0,0 +1,61 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE__BINARY_METADATA_HPP_
+#define ROSBAG2_STORAGE__BINARY_METADATA_HPP_
+
+#include <string>
+
+#include "rosbag2_storage/bag_metadata.hpp"
+
+namespace rosbag2_storage
+{
+
+/**
+ * The binary metadata file holds the same content as the YAML metadata file, encoded compactly
+ * so it is parsed fast even for bags with thousands of files and topics.
+ * It starts with a header followed by records. A full record holds all of the metadata, an update
+ * record only what changed since the previous record, so checkpoints written while recording
+ * append to the file instead of rewriting it. A record cut off by a recorder being killed while
+ * appending it is ignored.
+ */
+namespace binary_metadata
+{
+
+// Bags of older metadata versions only have a YAML metadata file.
+constexpr const int MIN_METADATA_VERSION = 7;
+
+std::string encode_header();
+
+/// Encodes all of the metadata as a full record.
+std::string encode_full_record(const BagMetadata & metadata);
+
+/**
+ * Encodes the changes from previous to current as an update record.
+ * \return false if the changes cannot be expressed as an update, e.g. because a topic was removed,
+ *   then a full record needs to be written instead.
+ */
+bool encode_update_record(
+  const BagMetadata & previous, const BagMetadata & current, std::string & record);
+
+/**
+ * Decodes the contents of a binary metadata file.
+ * \throws std::runtime_error if the contents are not a valid binary metadata file.
+ */
+BagMetadata decode(const std::string & contents);
+
+}  // namespace binary_metadata
+}  // namespace rosbag2_storage
+
+#endif  // ROSBAG2_STORAGE__BINARY_METADATA_HPP_
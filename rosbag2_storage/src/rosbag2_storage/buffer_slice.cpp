@@ -0,0 +1,110 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage/buffer_slice.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace rosbag2_storage
+{
+
+namespace
+{
+struct SerializedDataView
+{
+  rcutils_uint8_array_t array;
+  BufferSlice slice;
+
+  ~SerializedDataView()
+  {
+    array.allocator.deallocate(array.buffer, array.allocator.state);
+  }
+};
+
+// The allocator of views, whose state is the view. The buffer of a view is either the slice or
+// memory allocated as usual.
+void * view_allocate(size_t size, void * state)
+{
+  (void) state;
+  return std::malloc(size);
+}
+
+void view_deallocate(void * pointer, void * state)
+{
+  if (pointer != static_cast<const SerializedDataView *>(state)->slice.data) {
+    std::free(pointer);
+  }
+}
+
+void * view_reallocate(void * pointer, size_t size, void * state)
+{
+  const auto view = static_cast<const SerializedDataView *>(state);
+  if (pointer != view->slice.data) {
+    return std::realloc(pointer, size);
+  }
+  auto copy = std::malloc(size);
+  if (copy && view->slice.size > 0) {
+    std::memcpy(copy, pointer, std::min(size, view->slice.size));
+  }
+  return copy;
+}
+
+void * view_zero_allocate(size_t number_of_elements, size_t size_of_element, void * state)
+{
+  (void) state;
+  return std::calloc(number_of_elements, size_of_element);
+}
+}  // namespace
+
+BufferSlice
+make_buffer_slice(
+  const std::shared_ptr<const rcutils_uint8_array_t> & serialized_data, size_t offset,
+  size_t size)
+{
+  if (offset > serialized_data->buffer_length ||
+    size > serialized_data->buffer_length - offset)
+  {
+    throw std::out_of_range("Slice exceeds the serialized data.");
+  }
+  return {serialized_data->buffer + offset, size, serialized_data};
+}
+
+std::shared_ptr<rcutils_uint8_array_t>
+make_serialized_data_view(BufferSlice slice)
+{
+  auto view = std::make_shared<SerializedDataView>();
+  view->array.buffer = const_cast<uint8_t *>(slice.data);
+  view->array.buffer_length = slice.size;
+  view->array.buffer_capacity = slice.size;
+  view->array.allocator.allocate = view_allocate;
+  view->array.allocator.deallocate = view_deallocate;
+  view->array.allocator.reallocate = view_reallocate;
+  view->array.allocator.zero_allocate = view_zero_allocate;
+  view->array.allocator.state = view.get();
+  view->slice = std::move(slice);
+  return std::shared_ptr<rcutils_uint8_array_t>(view, &view->array);
+}
+
+bool
+is_serialized_data_view(const rcutils_uint8_array_t & serialized_data)
+{
+  return serialized_data.allocator.deallocate == view_deallocate;
+}
+
+}  // namespace rosbag2_storage
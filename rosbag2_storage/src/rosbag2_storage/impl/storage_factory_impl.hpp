@@ -16,7 +16,6 @@
 #ifndef ROSBAG2_STORAGE__IMPL__STORAGE_FACTORY_IMPL_HPP_
 #define ROSBAG2_STORAGE__IMPL__STORAGE_FACTORY_IMPL_HPP_
 
-#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,6 +25,7 @@
 #include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
 #include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
 
+#include "rosbag2_storage/shared_class_loader.hpp"
 #include "rosbag2_storage/storage_factory.hpp"
 #include "rosbag2_storage/storage_traits.hpp"
 #include "rosbag2_storage/logging.hpp"
@@ -36,34 +36,25 @@ namespace rosbag2_storage
 using storage_interfaces::ReadOnlyInterface;
 using storage_interfaces::ReadWriteInterface;
 
-template<typename InterfaceT>
-std::shared_ptr<pluginlib::ClassLoader<InterfaceT>>
-get_class_loader()
-{
-  const char * lookup_name = StorageTraits<InterfaceT>::name;
-  return std::make_shared<pluginlib::ClassLoader<InterfaceT>>("rosbag2_storage", lookup_name);
-}
-
 template<
   typename InterfaceT,
   storage_interfaces::IOFlag flag = StorageTraits<InterfaceT>::io_flag
 >
 std::shared_ptr<InterfaceT>
 get_interface_instance(
-  std::shared_ptr<pluginlib::ClassLoader<InterfaceT>> class_loader,
+  SharedClassLoader<InterfaceT> & class_loader,
   const std::string & storage_id,
-  const std::string & uri)
+  const std::string & uri,
+  const StorageConfig & storage_config = StorageConfig{})
 {
-  const auto & registered_classes = class_loader->getDeclaredClasses();
-  auto class_exists = std::find(registered_classes.begin(), registered_classes.end(), storage_id);
-  if (class_exists == registered_classes.end()) {
+  if (!class_loader.is_declared(storage_id)) {
     ROSBAG2_STORAGE_LOG_DEBUG_STREAM("Requested storage id '" << storage_id << "' does not exist");
     return nullptr;
   }
 
   std::shared_ptr<InterfaceT> instance = nullptr;
   try {
-    auto unmanaged_instance = class_loader->createUnmanagedInstance(storage_id);
+    auto unmanaged_instance = class_loader.create_unmanaged_instance(storage_id);
     instance = std::shared_ptr<InterfaceT>(unmanaged_instance);
   } catch (const std::runtime_error & ex) {
     ROSBAG2_STORAGE_LOG_ERROR_STREAM(
@@ -72,7 +63,7 @@ get_interface_instance(
   }
 
   try {
-    instance->open(uri, flag);
+    instance->open(uri, flag, storage_config);
     return instance;
   } catch (const std::runtime_error & ex) {
     ROSBAG2_STORAGE_LOG_ERROR_STREAM(
@@ -87,14 +78,16 @@ public:
   StorageFactoryImpl()
   {
     try {
-      read_write_class_loader_ = get_class_loader<ReadWriteInterface>();
+      read_write_class_loader_ = &SharedClassLoader<ReadWriteInterface>::get_instance(
+        "rosbag2_storage", StorageTraits<ReadWriteInterface>::name);
     } catch (const std::exception & e) {
       ROSBAG2_STORAGE_LOG_ERROR_STREAM("Unable to create class load instance: " << e.what());
       throw e;
     }
 
     try {
-      read_only_class_loader_ = get_class_loader<ReadOnlyInterface>();
+      read_only_class_loader_ = &SharedClassLoader<ReadOnlyInterface>::get_instance(
+        "rosbag2_storage", StorageTraits<ReadOnlyInterface>::name);
     } catch (const std::exception & e) {
       ROSBAG2_STORAGE_LOG_ERROR_STREAM("Unable to create class load instance: " << e.what());
       throw e;
@@ -104,9 +97,11 @@ public:
   virtual ~StorageFactoryImpl() = default;
 
   std::shared_ptr<ReadWriteInterface> open_read_write(
-    const std::string & uri, const std::string & storage_id)
+    const std::string & uri, const std::string & storage_id,
+    const StorageConfig & storage_config = StorageConfig{})
   {
-    auto instance = get_interface_instance(read_write_class_loader_, storage_id, uri);
+    auto instance = get_interface_instance(
+      *read_write_class_loader_, storage_id, uri, storage_config);
 
     if (instance == nullptr) {
       ROSBAG2_STORAGE_LOG_ERROR_STREAM(
@@ -120,11 +115,11 @@ public:
     const std::string & uri, const std::string & storage_id)
   {
     // try to load the instance as read_only interface
-    auto instance = get_interface_instance(read_only_class_loader_, storage_id, uri);
+    auto instance = get_interface_instance(*read_only_class_loader_, storage_id, uri);
     // try to load as read_write if not successful
     if (instance == nullptr) {
       instance = get_interface_instance<ReadWriteInterface, storage_interfaces::IOFlag::READ_ONLY>(
-        read_write_class_loader_, storage_id, uri);
+        *read_write_class_loader_, storage_id, uri);
     }
 
     if (instance == nullptr) {
@@ -136,8 +131,8 @@ public:
   }
 
 private:
-  std::shared_ptr<pluginlib::ClassLoader<ReadWriteInterface>> read_write_class_loader_;
-  std::shared_ptr<pluginlib::ClassLoader<ReadOnlyInterface>> read_only_class_loader_;
+  SharedClassLoader<ReadWriteInterface> * read_write_class_loader_;
+  SharedClassLoader<ReadOnlyInterface> * read_only_class_loader_;
 };
 
 }  // namespace rosbag2_storage
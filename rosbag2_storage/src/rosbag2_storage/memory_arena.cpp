@@ -0,0 +1,303 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage/memory_arena.hpp"
+
+#ifdef __linux__
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_storage/logging.hpp"
+
+namespace
+{
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+// Blocks of size class k take kMinBlockSize << k bytes of the arena, including their header.
+constexpr size_t kMinBlockSize = 64;
+constexpr size_t kSizeClassCount = 40;
+// Holds the size class of the block and keeps its data aligned like memory of malloc.
+constexpr size_t kHeaderSize = 16;
+#ifdef __linux__
+// From linux/mempolicy.h, which is not available everywhere.
+constexpr int kMpolBind = 2;
+#endif
+
+size_t get_block_size(size_t size_class)
+{
+  return kMinBlockSize << size_class;
+}
+
+// kSizeClassCount if no block is large enough.
+size_t get_size_class(size_t size)
+{
+  size_t size_class = 0;
+  while (size_class < kSizeClassCount && get_block_size(size_class) - kHeaderSize < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+uint8_t * get_block(const void * pointer)
+{
+  return static_cast<uint8_t *>(const_cast<void *>(pointer)) - kHeaderSize;
+}
+
+void * allocate_from_arena(size_t size, void * state)
+{
+  auto pointer = static_cast<rosbag2_storage::MemoryArena *>(state)->allocate(size);
+  return pointer ? pointer : std::malloc(size);
+}
+
+void deallocate_from_arena(void * pointer, void * state)
+{
+  auto arena = static_cast<rosbag2_storage::MemoryArena *>(state);
+  if (arena->contains(pointer)) {
+    arena->deallocate(pointer);
+  } else {
+    std::free(pointer);
+  }
+}
+
+void * reallocate_from_arena(void * pointer, size_t size, void * state)
+{
+  auto arena = static_cast<rosbag2_storage::MemoryArena *>(state);
+  if (!pointer) {
+    return allocate_from_arena(size, state);
+  }
+  // Memory of the heap stays on the heap, since its size is not known to copy it.
+  if (!arena->contains(pointer)) {
+    return std::realloc(pointer, size);
+  }
+  const auto capacity = arena->get_capacity(pointer);
+  if (size <= capacity) {
+    return pointer;
+  }
+  auto reallocated = allocate_from_arena(size, state);
+  if (reallocated) {
+    std::memcpy(reallocated, pointer, capacity);
+    arena->deallocate(pointer);
+  }
+  return reallocated;
+}
+
+void * zero_allocate_from_arena(size_t count, size_t element_size, void * state)
+{
+  if (element_size != 0 && count > std::numeric_limits<size_t>::max() / element_size) {
+    return nullptr;
+  }
+  auto pointer = allocate_from_arena(count * element_size, state);
+  if (pointer) {
+    std::memset(pointer, 0, count * element_size);
+  }
+  return pointer;
+}
+
+struct SharedMemoryArena
+{
+  std::mutex mutex;
+  rosbag2_storage::MemoryArenaOptions options;
+  // Read without locking, since every buffer of a message asks for the shared arena.
+  std::atomic_bool is_configured {false};
+  // Never destroyed, since buffers allocated from it may be freed while the process exits.
+  std::atomic<rosbag2_storage::MemoryArena *> arena {nullptr};
+};
+
+SharedMemoryArena & get_shared_memory_arena()
+{
+  static SharedMemoryArena shared_memory_arena;
+  return shared_memory_arena;
+}
+}  // unnamed namespace
+
+namespace rosbag2_storage
+{
+
+MemoryArena::MemoryArena(const MemoryArenaOptions & options)
+: size_((options.size + kHugePageSize - 1) / kHugePageSize * kHugePageSize),
+  free_blocks_(kSizeClassCount, nullptr)
+{
+  if (size_ == 0) {
+    throw std::invalid_argument("The memory arena needs a size.");
+  }
+#ifdef __linux__
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS | (options.explicit_huge_pages ? MAP_HUGETLB : 0);
+  auto memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error(
+            "Failed to map " + std::to_string(size_) + " bytes for the memory arena: " +
+            std::strerror(errno));
+  }
+  begin_ = static_cast<uint8_t *>(memory);
+  if (!options.explicit_huge_pages && madvise(begin_, size_, MADV_HUGEPAGE) != 0) {
+    ROSBAG2_STORAGE_LOG_WARN_STREAM(
+      "Failed to use transparent huge pages for the memory arena: " << std::strerror(errno));
+  }
+  if (options.numa_node >= 0) {
+    // The memory is placed on the node when it is touched below.
+    const auto bits_per_word = 8 * sizeof(unsigned long);  // NOLINT
+    std::vector<unsigned long> node_mask(options.numa_node / bits_per_word + 1, 0);  // NOLINT
+    node_mask.back() = 1ul << (options.numa_node % bits_per_word);
+    if (syscall(
+        SYS_mbind, begin_, size_, kMpolBind, node_mask.data(),
+        node_mask.size() * bits_per_word + 1, 0) != 0)
+    {
+      ROSBAG2_STORAGE_LOG_WARN_STREAM(
+        "Failed to bind the memory arena to NUMA node " << options.numa_node << ": " <<
+          std::strerror(errno));
+    }
+  }
+#else
+  if (options.explicit_huge_pages || options.numa_node >= 0) {
+    ROSBAG2_STORAGE_LOG_WARN(
+      "Huge pages and NUMA nodes for the memory arena are only supported on Linux.");
+  }
+  begin_ = static_cast<uint8_t *>(std::malloc(size_));
+  if (!begin_) {
+    throw std::runtime_error(
+            "Failed to allocate " + std::to_string(size_) + " bytes for the memory arena.");
+  }
+#endif
+  // Touches every page, so using the arena never page-faults.
+  std::memset(begin_, 0, size_);
+}
+
+MemoryArena::~MemoryArena()
+{
+#ifdef __linux__
+  munmap(begin_, size_);
+#else
+  std::free(begin_);
+#endif
+}
+
+void * MemoryArena::allocate(size_t size)
+{
+  const auto size_class = get_size_class(size);
+  if (size_class >= kSizeClassCount) {
+    return nullptr;
+  }
+  const auto block_size = get_block_size(size_class);
+  uint8_t * block = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto & free_block = free_blocks_[size_class];
+    if (free_block) {
+      block = get_block(free_block);
+      free_block = *static_cast<void **>(free_block);
+    } else if (size_ - used_bytes_ >= block_size) {
+      block = begin_ + used_bytes_;
+      used_bytes_ += block_size;
+    } else {
+      return nullptr;
+    }
+    allocated_bytes_ += block_size;
+  }
+  *reinterpret_cast<uint32_t *>(block) = static_cast<uint32_t>(size_class);
+  return block + kHeaderSize;
+}
+
+void MemoryArena::deallocate(void * pointer)
+{
+  const auto size_class = *reinterpret_cast<const uint32_t *>(get_block(pointer));
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto & free_block = free_blocks_[size_class];
+  *static_cast<void **>(pointer) = free_block;
+  free_block = pointer;
+  allocated_bytes_ -= get_block_size(size_class);
+}
+
+bool MemoryArena::contains(const void * pointer) const
+{
+  const auto address = static_cast<const uint8_t *>(pointer);
+  return address >= begin_ && address < begin_ + size_;
+}
+
+size_t MemoryArena::get_capacity(const void * pointer) const
+{
+  return get_block_size(*reinterpret_cast<const uint32_t *>(get_block(pointer))) - kHeaderSize;
+}
+
+rcutils_allocator_t MemoryArena::get_allocator()
+{
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  allocator.allocate = allocate_from_arena;
+  allocator.deallocate = deallocate_from_arena;
+  allocator.reallocate = reallocate_from_arena;
+  allocator.zero_allocate = zero_allocate_from_arena;
+  allocator.state = this;
+  return allocator;
+}
+
+uint64_t MemoryArena::get_size() const
+{
+  return size_;
+}
+
+uint64_t MemoryArena::get_allocated_bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return allocated_bytes_;
+}
+
+void MemoryArena::configure_shared(const MemoryArenaOptions & options)
+{
+  auto & shared = get_shared_memory_arena();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  if (shared.arena && (shared.options.size != options.size ||
+    shared.options.explicit_huge_pages != options.explicit_huge_pages ||
+    shared.options.numa_node != options.numa_node))
+  {
+    throw std::logic_error("The shared memory arena was created already with other options.");
+  }
+  shared.options = options;
+  shared.is_configured = options.size > 0;
+}
+
+MemoryArena * MemoryArena::get_shared()
+{
+  auto & shared = get_shared_memory_arena();
+  if (!shared.is_configured) {
+    return nullptr;
+  }
+  auto arena = shared.arena.load();
+  if (arena) {
+    return arena;
+  }
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  if (!shared.arena) {
+    shared.arena = new MemoryArena(shared.options);
+  }
+  return shared.arena;
+}
+
+rcutils_allocator_t MemoryArena::get_shared_allocator()
+{
+  auto arena = get_shared();
+  return arena ? arena->get_allocator() : rcutils_get_default_allocator();
+}
+
+}  // namespace rosbag2_storage
@@ -0,0 +1,188 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage/message_histogram.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+namespace rosbag2_storage
+{
+
+namespace
+{
+using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+int64_t floor_to_multiple(int64_t time, int64_t duration)
+{
+  auto remainder = time % duration;
+  if (remainder < 0) {
+    remainder += duration;
+  }
+  return time - remainder;
+}
+
+int64_t get_start(const MessageHistogram & histogram)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    histogram.starting_time.time_since_epoch()).count();
+}
+
+int64_t get_end(const MessageHistogram & histogram)
+{
+  return get_start(histogram) +
+         static_cast<int64_t>(histogram.message_counts.size()) * histogram.bucket_duration.count();
+}
+
+bool is_empty(const MessageHistogram & histogram)
+{
+  return histogram.bucket_duration.count() <= 0 || histogram.message_counts.empty();
+}
+
+// Histogram of the buckets from start to end with the bucket duration, without messages.
+MessageHistogram make_empty_histogram(
+  int64_t start, int64_t end, std::chrono::nanoseconds bucket_duration)
+{
+  MessageHistogram histogram;
+  histogram.starting_time = TimePoint(std::chrono::nanoseconds(start));
+  histogram.bucket_duration = bucket_duration;
+  const auto bucket_count = static_cast<size_t>((end - start) / bucket_duration.count());
+  histogram.message_counts.assign(bucket_count, 0u);
+  histogram.sizes.assign(bucket_count, 0u);
+  return histogram;
+}
+
+// Adds the buckets of a histogram with the same bucket duration, which it covers.
+void add_buckets(MessageHistogram & histogram, const MessageHistogram & other)
+{
+  const auto offset = static_cast<size_t>(
+    (get_start(other) - get_start(histogram)) / histogram.bucket_duration.count());
+  for (size_t i = 0; i < other.message_counts.size(); ++i) {
+    histogram.message_counts[offset + i] += other.message_counts[i];
+    histogram.sizes[offset + i] += other.sizes[i];
+  }
+}
+
+void limit_bucket_count(MessageHistogram & histogram)
+{
+  while (histogram.message_counts.size() > kMaxHistogramBuckets) {
+    histogram = coarsen_histogram(histogram, histogram.bucket_duration * 2);
+  }
+}
+}  // namespace
+
+void add_to_histogram(
+  MessageHistogram & histogram, rcutils_time_point_value_t time_stamp, uint64_t size)
+{
+  if (is_empty(histogram)) {
+    const auto first_bucket_start =
+      floor_to_multiple(time_stamp, kInitialHistogramBucketDuration.count());
+    histogram = make_empty_histogram(
+      first_bucket_start, first_bucket_start + kInitialHistogramBucketDuration.count(),
+      kInitialHistogramBucketDuration);
+  }
+  // The histogram is coarsened before it is extended, so a time stamp far off does not
+  // allocate more than the maximum number of buckets.
+  int64_t bucket_start;
+  int64_t start;
+  int64_t end;
+  while (true) {
+    const auto duration = histogram.bucket_duration.count();
+    bucket_start = floor_to_multiple(time_stamp, duration);
+    start = std::min(get_start(histogram), bucket_start);
+    end = std::max(get_end(histogram), bucket_start + duration);
+    if (static_cast<uint64_t>((end - start) / duration) <= kMaxHistogramBuckets) {
+      break;
+    }
+    histogram = coarsen_histogram(histogram, histogram.bucket_duration * 2);
+  }
+  if (start < get_start(histogram) || end > get_end(histogram)) {
+    auto extended_histogram = make_empty_histogram(start, end, histogram.bucket_duration);
+    add_buckets(extended_histogram, histogram);
+    histogram = std::move(extended_histogram);
+  }
+  const auto index =
+    static_cast<size_t>((bucket_start - start) / histogram.bucket_duration.count());
+  ++histogram.message_counts[index];
+  histogram.sizes[index] += size;
+}
+
+void remove_from_histogram(
+  MessageHistogram & histogram, rcutils_time_point_value_t time_stamp, uint64_t size)
+{
+  if (is_empty(histogram) || time_stamp < get_start(histogram) ||
+    time_stamp >= get_end(histogram))
+  {
+    return;
+  }
+  const auto index = static_cast<size_t>(
+    (time_stamp - get_start(histogram)) / histogram.bucket_duration.count());
+  if (histogram.message_counts[index] > 0) {
+    --histogram.message_counts[index];
+  }
+  histogram.sizes[index] -= std::min(histogram.sizes[index], size);
+}
+
+void merge_histograms(MessageHistogram & histogram, const MessageHistogram & other)
+{
+  if (is_empty(other)) {
+    return;
+  }
+  if (is_empty(histogram)) {
+    histogram = other;
+    limit_bucket_count(histogram);
+    return;
+  }
+  const auto bucket_duration = std::max(histogram.bucket_duration, other.bucket_duration);
+  const auto coarse_histogram = coarsen_histogram(histogram, bucket_duration);
+  const auto coarse_other = coarsen_histogram(other, bucket_duration);
+  auto merged_histogram = make_empty_histogram(
+    std::min(get_start(coarse_histogram), get_start(coarse_other)),
+    std::max(get_end(coarse_histogram), get_end(coarse_other)), bucket_duration);
+  add_buckets(merged_histogram, coarse_histogram);
+  add_buckets(merged_histogram, coarse_other);
+  limit_bucket_count(merged_histogram);
+  histogram = std::move(merged_histogram);
+}
+
+MessageHistogram coarsen_histogram(
+  const MessageHistogram & histogram, std::chrono::nanoseconds bucket_duration)
+{
+  if (is_empty(histogram)) {
+    return histogram;
+  }
+  const auto ratio = bucket_duration.count() / histogram.bucket_duration.count();
+  if (ratio < 1 || bucket_duration.count() % histogram.bucket_duration.count() != 0 ||
+    (ratio & (ratio - 1)) != 0)
+  {
+    throw std::invalid_argument(
+            "The bucket duration is not the one of the histogram multiplied by a power of two.");
+  }
+  const auto start = floor_to_multiple(get_start(histogram), bucket_duration.count());
+  auto coarse_histogram = make_empty_histogram(
+    start, floor_to_multiple(get_end(histogram) - 1, bucket_duration.count()) +
+    bucket_duration.count(), bucket_duration);
+  const auto offset = static_cast<size_t>(
+    (get_start(histogram) - start) / histogram.bucket_duration.count());
+  for (size_t i = 0; i < histogram.message_counts.size(); ++i) {
+    const auto index = (offset + i) / static_cast<size_t>(ratio);
+    coarse_histogram.message_counts[index] += histogram.message_counts[i];
+    coarse_histogram.sizes[index] += histogram.sizes[i];
+  }
+  return coarse_histogram;
+}
+
+}  // namespace rosbag2_storage
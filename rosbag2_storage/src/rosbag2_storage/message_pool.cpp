@@ -0,0 +1,198 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage/message_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcutils/error_handling.h"
+
+#include "rosbag2_storage/logging.hpp"
+#include "rosbag2_storage/memory_arena.hpp"
+
+namespace
+{
+rcutils_uint8_array_t * allocate_buffer(size_t size)
+{
+  auto buffer = new rcutils_uint8_array_t;
+  *buffer = rcutils_get_zero_initialized_uint8_array();
+  auto allocator = rosbag2_storage::MemoryArena::get_shared_allocator();
+  if (rcutils_uint8_array_init(buffer, size, &allocator) != RCUTILS_RET_OK) {
+    delete buffer;
+    throw std::runtime_error(
+            "Error allocating resources for serialized message: " +
+            std::string(rcutils_get_error_string().str));
+  }
+  return buffer;
+}
+
+void free_buffer(rcutils_uint8_array_t * buffer)
+{
+  int error = rcutils_uint8_array_fini(buffer);
+  delete buffer;
+  if (error != RCUTILS_RET_OK) {
+    ROSBAG2_STORAGE_LOG_ERROR_STREAM(
+      "Leaking memory. Error: " << rcutils_get_error_string().str);
+  }
+}
+}  // unnamed namespace
+
+namespace rosbag2_storage
+{
+
+// Shared with the deleters of the objects handed out, so they can outlive the pool.
+struct MessagePool::Pools
+{
+  explicit Pools(size_t max_pooled_objects)
+  : max_pooled_objects(max_pooled_objects)
+  {
+    // Returning objects to the pool never allocates.
+    messages.reserve(max_pooled_objects);
+    buffers.reserve(max_pooled_objects);
+  }
+
+  ~Pools()
+  {
+    for (auto message : messages) {
+      delete message;
+    }
+    for (auto buffer : buffers) {
+      free_buffer(buffer);
+    }
+  }
+
+  bool give_back(SerializedBagMessage * message)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (messages.size() >= max_pooled_objects) {
+      return false;
+    }
+    messages.push_back(message);
+    return true;
+  }
+
+  bool give_back(rcutils_uint8_array_t * buffer)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (buffers.size() >= max_pooled_objects) {
+      return false;
+    }
+    buffers.push_back(buffer);
+    return true;
+  }
+
+  const size_t max_pooled_objects;
+  std::mutex mutex;
+  std::vector<SerializedBagMessage *> messages;
+  std::vector<rcutils_uint8_array_t *> buffers;
+};
+
+MessagePool::MessagePool(size_t max_pooled_objects)
+: pools_(std::make_shared<Pools>(max_pooled_objects))
+{}
+
+MessagePool::~MessagePool() = default;
+
+std::shared_ptr<SerializedBagMessage> MessagePool::make_message()
+{
+  SerializedBagMessage * message = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(pools_->mutex);
+    if (!pools_->messages.empty()) {
+      message = pools_->messages.back();
+      pools_->messages.pop_back();
+    }
+  }
+  if (!message) {
+    message = new SerializedBagMessage();
+  }
+  message->time_stamp = 0;
+  message->publish_time_stamp = 0;
+
+  std::weak_ptr<Pools> weak_pools = pools_;
+  return std::shared_ptr<SerializedBagMessage>(
+    message,
+    [weak_pools](SerializedBagMessage * message) {
+      // Releases the buffer before locking the pool, as it may also be returned to it.
+      message->serialized_data.reset();
+      message->topic_name.clear();
+      message->topic_handle = INVALID_TOPIC_HANDLE;
+      auto pools = weak_pools.lock();
+      if (!pools || !pools->give_back(message)) {
+        delete message;
+      }
+    });
+}
+
+std::shared_ptr<rcutils_uint8_array_t> MessagePool::make_empty_serialized_message(size_t size)
+{
+  rcutils_uint8_array_t * buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(pools_->mutex);
+    auto & buffers = pools_->buffers;
+    if (!buffers.empty()) {
+      // Prefer a buffer which fits, otherwise grow one instead of allocating another one.
+      auto fitting_buffer = std::find_if(
+        buffers.begin(), buffers.end(),
+        [size](const rcutils_uint8_array_t * buffer) {return buffer->buffer_capacity >= size;});
+      if (fitting_buffer == buffers.end()) {
+        fitting_buffer = buffers.end() - 1;
+      }
+      buffer = *fitting_buffer;
+      *fitting_buffer = buffers.back();
+      buffers.pop_back();
+    }
+  }
+
+  if (!buffer) {
+    buffer = allocate_buffer(size);
+  } else if (buffer->buffer_capacity < size) {
+    if (rcutils_uint8_array_resize(buffer, size) != RCUTILS_RET_OK) {
+      free_buffer(buffer);
+      throw std::runtime_error(
+              "Error resizing serialized message: " +
+              std::string(rcutils_get_error_string().str));
+    }
+  }
+  buffer->buffer_length = 0;
+
+  std::weak_ptr<Pools> weak_pools = pools_;
+  return std::shared_ptr<rcutils_uint8_array_t>(
+    buffer,
+    [weak_pools](rcutils_uint8_array_t * buffer) {
+      auto pools = weak_pools.lock();
+      if (!pools || !pools->give_back(buffer)) {
+        free_buffer(buffer);
+      }
+    });
+}
+
+size_t MessagePool::get_pooled_message_count() const
+{
+  std::lock_guard<std::mutex> lock(pools_->mutex);
+  return pools_->messages.size();
+}
+
+size_t MessagePool::get_pooled_buffer_count() const
+{
+  std::lock_guard<std::mutex> lock(pools_->mutex);
+  return pools_->buffers.size();
+}
+
+}  // namespace rosbag2_storage
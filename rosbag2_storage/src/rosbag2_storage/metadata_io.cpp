@@ -14,16 +14,34 @@
 
 #include "rosbag2_storage/metadata_io.hpp"
 
+#include <sys/stat.h>
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <dirent.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
 #include "rcutils/filesystem.h"
 
+#include "rosbag2_storage/message_histogram.hpp"
 #include "rosbag2_storage/topic_metadata.hpp"
 
+#include "binary_metadata.hpp"
+
 #ifdef _WIN32
 // This is necessary because of a bug in yaml-cpp's cmake
 #define YAML_CPP_DLL
@@ -88,6 +106,36 @@ struct convert<rosbag2_storage::TopicMetadata>
   }
 };
 
+template<>
+struct convert<rosbag2_storage::MessageHistogram>
+{
+  static Node encode(const rosbag2_storage::MessageHistogram & histogram)
+  {
+    Node node;
+    node["starting_time"] = histogram.starting_time;
+    node["bucket_duration"] = histogram.bucket_duration;
+    // A bucket per element would take a line each.
+    node["message_counts"] = histogram.message_counts;
+    node["message_counts"].SetStyle(EmitterStyle::Flow);
+    node["sizes"] = histogram.sizes;
+    node["sizes"].SetStyle(EmitterStyle::Flow);
+    return node;
+  }
+
+  static bool decode(const Node & node, rosbag2_storage::MessageHistogram & histogram)
+  {
+    histogram.starting_time = node["starting_time"]
+      .as<std::chrono::time_point<std::chrono::high_resolution_clock>>();
+    histogram.bucket_duration = node["bucket_duration"].as<std::chrono::nanoseconds>();
+    histogram.message_counts = node["message_counts"].as<std::vector<uint64_t>>();
+    histogram.sizes = node["sizes"].as<std::vector<uint64_t>>();
+    if (histogram.sizes.size() != histogram.message_counts.size()) {
+      return false;
+    }
+    return true;
+  }
+};
+
 template<>
 struct convert<rosbag2_storage::TopicInformation>
 {
@@ -96,6 +144,26 @@ struct convert<rosbag2_storage::TopicInformation>
     Node node;
     node["topic_metadata"] = metadata.topic_metadata;
     node["message_count"] = metadata.message_count;
+    node["total_size"] = metadata.total_size;
+    node["max_message_size"] = metadata.max_message_size;
+    if (metadata.compressed_size > 0) {
+      node["compressed_size"] = metadata.compressed_size;
+    }
+    if (metadata.dropped_message_count > 0) {
+      node["dropped_message_count"] = metadata.dropped_message_count;
+    }
+    if (!metadata.compression_format.empty()) {
+      node["compression_format"] = metadata.compression_format;
+    }
+    if (metadata.deduplicated) {
+      node["deduplicated"] = true;
+    }
+    if (metadata.delta_encoded) {
+      node["delta_encoded"] = true;
+    }
+    if (metadata.histogram.bucket_duration.count() > 0) {
+      node["histogram"] = metadata.histogram;
+    }
     return node;
   }
 
@@ -104,6 +172,20 @@ struct convert<rosbag2_storage::TopicInformation>
     metadata.topic_metadata = decode_for_version<rosbag2_storage::TopicMetadata>(
       node["topic_metadata"], version);
     metadata.message_count = node["message_count"].as<uint64_t>();
+    metadata.total_size = node["total_size"] ? node["total_size"].as<uint64_t>() : 0;
+    metadata.max_message_size =
+      node["max_message_size"] ? node["max_message_size"].as<uint64_t>() : 0;
+    metadata.compressed_size =
+      node["compressed_size"] ? node["compressed_size"].as<uint64_t>() : 0;
+    metadata.dropped_message_count =
+      node["dropped_message_count"] ? node["dropped_message_count"].as<uint64_t>() : 0;
+    metadata.compression_format =
+      node["compression_format"] ? node["compression_format"].as<std::string>() : "";
+    metadata.deduplicated = node["deduplicated"] && node["deduplicated"].as<bool>();
+    metadata.delta_encoded = node["delta_encoded"] && node["delta_encoded"].as<bool>();
+    if (node["histogram"]) {
+      metadata.histogram = node["histogram"].as<rosbag2_storage::MessageHistogram>();
+    }
     return true;
   }
 };
@@ -147,7 +229,7 @@ struct convert<std::chrono::nanoseconds>
 
   static bool decode(const Node & node, std::chrono::nanoseconds & time_in_ns)
   {
-    time_in_ns = std::chrono::nanoseconds(node["nanoseconds"].as<uint64_t>());
+    time_in_ns = std::chrono::nanoseconds(node["nanoseconds"].as<int64_t>());
     return true;
   }
 };
@@ -171,6 +253,54 @@ struct convert<std::chrono::time_point<std::chrono::high_resolution_clock>>
   }
 };
 
+template<>
+struct convert<rosbag2_storage::FileInformation>
+{
+  static Node encode(const rosbag2_storage::FileInformation & file)
+  {
+    Node node;
+    node["path"] = file.path;
+    node["indexed"] = file.indexed;
+    node["starting_time"] = file.starting_time;
+    node["duration"] = file.duration;
+    if (file.stripe > 0) {
+      node["stripe"] = file.stripe;
+    }
+    if (!file.topics.empty()) {
+      node["topics"] = file.topics;
+    }
+    if (!file.topic_message_counts.empty()) {
+      node["topic_message_counts"] = file.topic_message_counts;
+    }
+    node["message_count"] = file.message_count;
+    if (file.size > 0) {
+      node["size"] = file.size;
+    }
+    return node;
+  }
+
+  static bool decode(const Node & node, rosbag2_storage::FileInformation & file)
+  {
+    file.path = node["path"].as<std::string>();
+    file.indexed = node["indexed"].as<bool>();
+    if (node["starting_time"]) {
+      file.starting_time = node["starting_time"]
+        .as<std::chrono::time_point<std::chrono::high_resolution_clock>>();
+      file.duration = node["duration"].as<std::chrono::nanoseconds>();
+    }
+    file.stripe = node["stripe"] ? node["stripe"].as<size_t>() : 0;
+    if (node["topics"]) {
+      file.topics = node["topics"].as<std::vector<std::string>>();
+    }
+    if (node["topic_message_counts"]) {
+      file.topic_message_counts = node["topic_message_counts"].as<std::vector<uint64_t>>();
+    }
+    file.message_count = node["message_count"] ? node["message_count"].as<uint64_t>() : 0;
+    file.size = node["size"] ? node["size"].as<uint64_t>() : 0;
+    return true;
+  }
+};
+
 template<>
 struct convert<rosbag2_storage::BagMetadata>
 {
@@ -189,6 +319,26 @@ struct convert<rosbag2_storage::BagMetadata>
       node["compression_format"] = metadata.compression_format;
       node["compression_mode"] = metadata.compression_mode;
     }
+
+    if (metadata.version >= 5) {
+      node["files"] = metadata.files;
+      node["cache_high_water_mark_bytes"] = metadata.cache_high_water_mark_bytes;
+    }
+
+    if (metadata.version >= 6) {
+      node["compression_dictionaries"] = metadata.compression_dictionaries;
+    }
+
+    if (metadata.version >= 8) {
+      node["bag_id"] = metadata.bag_id;
+      node["clock_offset"] = metadata.clock_offset;
+    }
+
+    if (metadata.version >= 11) {
+      node["encryption_format"] = metadata.encryption_format;
+      node["encryption_key_id"] = metadata.encryption_key_id;
+      node["encrypted_key"] = metadata.encrypted_key;
+    }
     return node;
   }
 
@@ -209,12 +359,208 @@ struct convert<rosbag2_storage::BagMetadata>
       metadata.compression_format = node["compression_format"].as<std::string>();
       metadata.compression_mode = node["compression_mode"].as<std::string>();
     }
+
+    if (metadata.version >= 5) {
+      metadata.files = node["files"].as<std::vector<rosbag2_storage::FileInformation>>();
+      metadata.cache_high_water_mark_bytes = node["cache_high_water_mark_bytes"].as<uint64_t>();
+    } else {  // files of older bags have always been indexed
+      metadata.files.clear();
+      for (const auto & path : metadata.relative_file_paths) {
+        metadata.files.push_back({path, true});
+      }
+    }
+
+    if (metadata.version >= 6) {
+      metadata.compression_dictionaries =
+        node["compression_dictionaries"].as<std::vector<std::string>>();
+    }
+
+    if (metadata.version >= 8) {
+      metadata.bag_id = node["bag_id"].as<std::string>();
+      metadata.clock_offset = node["clock_offset"].as<std::chrono::nanoseconds>();
+    }
+
+    if (metadata.version >= 11) {
+      metadata.encryption_format = node["encryption_format"].as<std::string>();
+      metadata.encryption_key_id = node["encryption_key_id"].as<std::string>();
+      metadata.encrypted_key = node["encrypted_key"].as<std::string>();
+    }
     return true;
   }
 };
 
 }  // namespace YAML
 
+namespace
+{
+
+// Identifies a version of a metadata file by its modification time and size.
+struct FileStamp
+{
+  int64_t modification_time_ns;
+  int64_t size;
+
+  bool operator==(const FileStamp & other) const
+  {
+    return modification_time_ns == other.modification_time_ns && size == other.size;
+  }
+};
+
+bool get_file_stamp(const std::string & file_name, FileStamp & file_stamp)
+{
+#ifdef _WIN32
+  struct _stat64 status;
+  if (_stat64(file_name.c_str(), &status) != 0) {
+    return false;
+  }
+  file_stamp.modification_time_ns = static_cast<int64_t>(status.st_mtime) * 1000000000;
+#else
+  struct stat status;
+  if (stat(file_name.c_str(), &status) != 0) {
+    return false;
+  }
+# ifdef __APPLE__
+  const auto & modification_time = status.st_mtimespec;
+# else
+  const auto & modification_time = status.st_mtim;
+# endif
+  file_stamp.modification_time_ns =
+    static_cast<int64_t>(modification_time.tv_sec) * 1000000000 + modification_time.tv_nsec;
+#endif
+  file_stamp.size = static_cast<int64_t>(status.st_size);
+  return true;
+}
+
+/**
+ * Parsed metadata files of the process, so reopening a bag does not parse its metadata again
+ * as long as the file is unchanged. Heap allocated and never destroyed, so it can be used
+ * during static destruction.
+ */
+class MetadataCache
+{
+public:
+  static MetadataCache & get_instance()
+  {
+    static auto instance = new MetadataCache();
+    return *instance;
+  }
+
+  bool find(
+    const std::string & file_name, const FileStamp & file_stamp,
+    rosbag2_storage::BagMetadata & metadata)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto entry = entries_.find(file_name);
+    if (entry == entries_.end() || !(entry->second.file_stamp == file_stamp)) {
+      return false;
+    }
+    metadata = entry->second.metadata;
+    return true;
+  }
+
+  void insert(
+    const std::string & file_name, const FileStamp & file_stamp,
+    const rosbag2_storage::BagMetadata & metadata)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.size() >= kMaxEntries) {
+      entries_.clear();
+    }
+    entries_[file_name] = Entry{file_stamp, metadata};
+  }
+
+  void erase(const std::string & file_name)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(file_name);
+  }
+
+private:
+  struct Entry
+  {
+    FileStamp file_stamp;
+    rosbag2_storage::BagMetadata metadata;
+  };
+
+  static constexpr size_t kMaxEntries = 4096;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+constexpr size_t MetadataCache::kMaxEntries;
+
+// Written to a temporary file which replaces the file, so a recorder killed while writing a
+// checkpoint leaves either the previous or the new file, never a partial one.
+void replace_file(const std::string & file_name, const std::string & contents)
+{
+  const auto temporary_file_name = file_name + ".tmp";
+  {
+    std::ofstream fout(temporary_file_name, std::ios::binary);
+    fout.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    fout.flush();
+    if (!fout) {
+      throw std::runtime_error("Failed to write metadata file " + temporary_file_name);
+    }
+  }
+  if (std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0) {
+    // Renaming onto an existing file fails on Windows.
+    std::remove(file_name.c_str());
+    if (std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0) {
+      std::remove(temporary_file_name.c_str());
+      throw std::runtime_error("Failed to write metadata file " + file_name);
+    }
+  }
+}
+
+std::vector<std::string> list_file_names(const std::string & directory)
+{
+  std::vector<std::string> file_names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA find_data;
+  const auto find_handle = FindFirstFileA((directory + "\\*").c_str(), &find_data);
+  if (find_handle == INVALID_HANDLE_VALUE) {
+    return file_names;
+  }
+  do {
+    if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+      file_names.emplace_back(find_data.cFileName);
+    }
+  } while (FindNextFileA(find_handle, &find_data));
+  FindClose(find_handle);
+#else
+  DIR * dir = opendir(directory.c_str());
+  if (!dir) {
+    return file_names;
+  }
+  while (const struct dirent * entry = readdir(dir)) {
+    if (entry->d_type != DT_DIR) {
+      file_names.emplace_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+#endif
+  return file_names;
+}
+
+bool ends_with(const std::string & text, const std::string & suffix)
+{
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool read_file(const std::string & file_name, std::string & contents)
+{
+  std::ifstream fin(file_name, std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+  contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+  return !fin.bad();
+}
+
+}  // namespace
+
 namespace rosbag2_storage
 {
 
@@ -222,16 +568,113 @@ void MetadataIo::write_metadata(const std::string & uri, const BagMetadata & met
 {
   YAML::Node metadata_node;
   metadata_node["rosbag2_bagfile_information"] = metadata;
-  std::ofstream fout(get_metadata_file_name(uri));
-  fout << metadata_node;
+  YAML::Emitter emitter;
+  emitter << metadata_node;
+  const auto metadata_file_name = get_metadata_file_name(uri);
+  MetadataCache::get_instance().erase(metadata_file_name);
+  // The YAML file is written first, so the binary file is not older than it.
+  replace_file(metadata_file_name, emitter.c_str());
+  if (metadata.version >= binary_metadata::MIN_METADATA_VERSION) {
+    write_binary_metadata(uri, metadata);
+  } else {
+    const auto binary_metadata_file_name = get_binary_metadata_file_name(uri);
+    MetadataCache::get_instance().erase(binary_metadata_file_name);
+    std::remove(binary_metadata_file_name.c_str());
+    appended_uri_.clear();
+  }
+}
+
+void MetadataIo::append_metadata(const std::string & uri, const BagMetadata & metadata)
+{
+  if (metadata.version < binary_metadata::MIN_METADATA_VERSION) {
+    write_metadata(uri, metadata);
+    return;
+  }
+  std::string record;
+  if (appended_uri_ != uri || binary_file_size_ > 2 * full_record_size_ ||
+    !binary_metadata::encode_update_record(appended_metadata_, metadata, record))
+  {
+    write_binary_metadata(uri, metadata);
+    return;
+  }
+
+  const auto binary_metadata_file_name = get_binary_metadata_file_name(uri);
+  MetadataCache::get_instance().erase(binary_metadata_file_name);
+  {
+    std::ofstream fout(binary_metadata_file_name, std::ios::binary | std::ios::app);
+    fout.write(record.data(), static_cast<std::streamsize>(record.size()));
+    fout.flush();
+    if (!fout) {
+      throw std::runtime_error("Failed to write metadata file " + binary_metadata_file_name);
+    }
+  }
+  appended_metadata_ = metadata;
+  binary_file_size_ += record.size();
+}
+
+void MetadataIo::write_binary_metadata(const std::string & uri, const BagMetadata & metadata)
+{
+  const auto binary_metadata_file_name = get_binary_metadata_file_name(uri);
+  MetadataCache::get_instance().erase(binary_metadata_file_name);
+  const auto header = binary_metadata::encode_header();
+  const auto record = binary_metadata::encode_full_record(metadata);
+  replace_file(binary_metadata_file_name, header + record);
+  appended_uri_ = uri;
+  appended_metadata_ = metadata;
+  binary_file_size_ = header.size() + record.size();
+  full_record_size_ = record.size();
 }
 
 BagMetadata MetadataIo::read_metadata(const std::string & uri)
 {
+  const auto yaml_file_name = get_metadata_file_name(uri);
+  const auto binary_metadata_file_name = get_binary_metadata_file_name(uri);
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  FileStamp yaml_file_stamp;
+  const bool has_yaml_file = get_file_stamp(yaml_file_name, yaml_file_stamp);
+  FileStamp binary_file_stamp;
+  const bool has_binary_file = get_file_stamp(binary_metadata_file_name, binary_file_stamp);
+  // A YAML file written after the binary one was rewritten by a version without binary files.
+  const bool use_binary_file = has_binary_file &&
+    (!has_yaml_file ||
+    binary_file_stamp.modification_time_ns >= yaml_file_stamp.modification_time_ns);
+  const auto & metadata_file_name = use_binary_file ? binary_metadata_file_name : yaml_file_name;
+  const bool has_file_stamp = use_binary_file || has_yaml_file;
+  const auto & file_stamp = use_binary_file ? binary_file_stamp : yaml_file_stamp;
+  BagMetadata metadata;
+  if (has_file_stamp &&
+    MetadataCache::get_instance().find(metadata_file_name, file_stamp, metadata))
+  {
+    // The bag files may have changed without the metadata file.
+    metadata.bag_size = rcutils_calculate_directory_size(uri.c_str(), allocator);
+    return metadata;
+  }
+
+  if (use_binary_file) {
+    std::string contents;
+    if (!read_file(binary_metadata_file_name, contents)) {
+      throw std::runtime_error("Failed to read metadata file " + binary_metadata_file_name);
+    }
+    try {
+      metadata = binary_metadata::decode(contents);
+      MetadataCache::get_instance().insert(metadata_file_name, file_stamp, metadata);
+      metadata.bag_size = rcutils_calculate_directory_size(uri.c_str(), allocator);
+      return metadata;
+    } catch (const std::runtime_error & ex) {
+      if (!has_yaml_file) {
+        throw std::runtime_error(
+                std::string("Exception on parsing binary metadata file: ") + ex.what());
+      }
+      // Fall back to the YAML file, which holds the metadata as of when recording stopped.
+    }
+  }
+
   try {
-    YAML::Node yaml_file = YAML::LoadFile(get_metadata_file_name(uri));
-    auto metadata = yaml_file["rosbag2_bagfile_information"].as<rosbag2_storage::BagMetadata>();
-    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    YAML::Node yaml_file = YAML::LoadFile(yaml_file_name);
+    metadata = yaml_file["rosbag2_bagfile_information"].as<rosbag2_storage::BagMetadata>();
+    if (has_yaml_file) {
+      MetadataCache::get_instance().insert(yaml_file_name, yaml_file_stamp, metadata);
+    }
     metadata.bag_size = rcutils_calculate_directory_size(uri.c_str(), allocator);
     return metadata;
   } catch (const YAML::Exception & ex) {
@@ -239,6 +682,93 @@ BagMetadata MetadataIo::read_metadata(const std::string & uri)
   }
 }
 
+void MetadataIo::write_file_summary(const std::string & file_path, const BagMetadata & summary)
+{
+  YAML::Node summary_node;
+  summary_node["rosbag2_bagfile_information"] = summary;
+  YAML::Emitter emitter;
+  emitter << summary_node;
+  replace_file(file_path + file_summary_suffix, emitter.c_str());
+}
+
+bool MetadataIo::file_summaries_exist(const std::string & uri)
+{
+  return !get_file_summary_names(uri).empty();
+}
+
+BagMetadata MetadataIo::read_file_summaries(const std::string & uri)
+{
+  std::vector<BagMetadata> summaries;
+  for (const auto & summary_name : get_file_summary_names(uri)) {
+    const auto summary_file_name = (rcpputils::fs::path(uri) / summary_name).string();
+    try {
+      YAML::Node yaml_file = YAML::LoadFile(summary_file_name);
+      summaries.push_back(
+        yaml_file["rosbag2_bagfile_information"].as<rosbag2_storage::BagMetadata>());
+    } catch (const YAML::Exception & ex) {
+      throw std::runtime_error(
+              "Exception on parsing file summary " + summary_file_name + ": " + ex.what());
+    }
+  }
+  if (summaries.empty()) {
+    throw std::runtime_error("The bag " + uri + " has no file summaries.");
+  }
+  std::stable_sort(
+    summaries.begin(), summaries.end(),
+    [](const BagMetadata & left, const BagMetadata & right) {
+      return left.starting_time < right.starting_time;
+    });
+
+  auto metadata = summaries.front();
+  metadata.relative_file_paths.clear();
+  metadata.files.clear();
+  metadata.topics_with_message_count.clear();
+  metadata.message_count = 0;
+  auto ending_time = metadata.starting_time;
+  for (const auto & summary : summaries) {
+    for (const auto & path : summary.relative_file_paths) {
+      metadata.relative_file_paths.push_back((rcpputils::fs::path(uri) / path).string());
+    }
+    for (auto file : summary.files) {
+      file.path = (rcpputils::fs::path(uri) / file.path).string();
+      metadata.files.push_back(file);
+    }
+    for (const auto & topic : summary.topics_with_message_count) {
+      const auto merged_topic = std::find_if(
+        metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+        [&topic](const TopicInformation & candidate) {
+          return candidate.topic_metadata.name == topic.topic_metadata.name;
+        });
+      if (merged_topic == metadata.topics_with_message_count.end()) {
+        metadata.topics_with_message_count.push_back(topic);
+      } else {
+        merged_topic->message_count += topic.message_count;
+        merged_topic->total_size += topic.total_size;
+        merged_topic->max_message_size =
+          std::max(merged_topic->max_message_size, topic.max_message_size);
+        merge_histograms(merged_topic->histogram, topic.histogram);
+      }
+    }
+    metadata.message_count += summary.message_count;
+    ending_time = std::max(ending_time, summary.starting_time + summary.duration);
+  }
+  metadata.duration = ending_time - metadata.starting_time;
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  metadata.bag_size = rcutils_calculate_directory_size(uri.c_str(), allocator);
+  return metadata;
+}
+
+std::vector<std::string> MetadataIo::get_file_summary_names(const std::string & uri)
+{
+  auto file_names = list_file_names(uri);
+  file_names.erase(
+    std::remove_if(
+      file_names.begin(), file_names.end(),
+      [](const std::string & file_name) {return !ends_with(file_name, file_summary_suffix);}),
+    file_names.end());
+  return file_names;
+}
+
 std::string MetadataIo::get_metadata_file_name(const std::string & uri)
 {
   std::string metadata_file = (rcpputils::fs::path(uri) / metadata_filename).string();
@@ -246,9 +776,15 @@ std::string MetadataIo::get_metadata_file_name(const std::string & uri)
   return metadata_file;
 }
 
+std::string MetadataIo::get_binary_metadata_file_name(const std::string & uri)
+{
+  return (rcpputils::fs::path(uri) / binary_metadata_filename).string();
+}
+
 bool MetadataIo::metadata_file_exists(const std::string & uri)
 {
-  return rcpputils::fs::path(get_metadata_file_name(uri)).exists();
+  return rcpputils::fs::path(get_metadata_file_name(uri)).exists() ||
+         rcpputils::fs::path(get_binary_metadata_file_name(uri)).exists();
 }
 
 }  // namespace rosbag2_storage
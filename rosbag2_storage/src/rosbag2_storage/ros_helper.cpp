@@ -19,12 +19,11 @@
 
 #include "rcutils/types.h"
 #include "rosbag2_storage/logging.hpp"
+#include "rosbag2_storage/memory_arena.hpp"
 
 namespace rosbag2_storage
 {
 
-static rcutils_allocator_t allocator = rcutils_get_default_allocator();
-
 std::shared_ptr<rcutils_uint8_array_t>
 make_serialized_message(const void * data, size_t size)
 {
@@ -40,6 +39,7 @@ make_empty_serialized_message(size_t size)
 {
   auto msg = new rcutils_uint8_array_t;
   *msg = rcutils_get_zero_initialized_uint8_array();
+  auto allocator = MemoryArena::get_shared_allocator();
   auto ret = rcutils_uint8_array_init(msg, size, &allocator);
   if (ret != RCUTILS_RET_OK) {
     throw std::runtime_error(
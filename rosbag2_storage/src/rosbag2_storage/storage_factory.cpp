@@ -47,4 +47,10 @@ std::shared_ptr<ReadWriteInterface> StorageFactory::open_read_write(
 {
   return impl_->open_read_write(uri, storage_id);
 }
+
+std::shared_ptr<ReadWriteInterface> StorageFactory::open_read_write(
+  const std::string & uri, const std::string & storage_id, const StorageConfig & storage_config)
+{
+  return impl_->open_read_write(uri, storage_id, storage_config);
+}
 }  // namespace rosbag2_storage
@@ -0,0 +1,104 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace rosbag2_storage
+{
+
+TopicFilter::TopicFilter(const StorageFilter & storage_filter)
+: topics_(storage_filter.topics),
+  has_topics_regex_(!storage_filter.topics_regex.empty()),
+  topic_types_(storage_filter.topic_types)
+{
+  if (has_topics_regex_) {
+    topics_regex_ = std::regex(
+      storage_filter.topics_regex, std::regex::ECMAScript | std::regex::optimize);
+  }
+  for (const auto & topic_time_range : storage_filter.topic_time_ranges) {
+    topic_time_ranges_.emplace_back(
+      std::regex(topic_time_range.topics_regex, std::regex::ECMAScript | std::regex::optimize),
+      TimeRange{
+        topic_time_range.start_time > 0 ?
+        topic_time_range.start_time : std::numeric_limits<rcutils_time_point_value_t>::min(),
+        topic_time_range.end_time > 0 ?
+        topic_time_range.end_time : std::numeric_limits<rcutils_time_point_value_t>::max()});
+  }
+}
+
+bool TopicFilter::selects_all_topics() const
+{
+  return topics_.empty() && !has_topics_regex_ && topic_types_.empty();
+}
+
+bool TopicFilter::is_selected(
+  const std::string & topic_name, const std::string & topic_type) const
+{
+  if (!topic_types_.empty() &&
+    std::find(topic_types_.begin(), topic_types_.end(), topic_type) == topic_types_.end())
+  {
+    return false;
+  }
+  if (topics_.empty() && !has_topics_regex_) {
+    return true;
+  }
+  return std::find(topics_.begin(), topics_.end(), topic_name) != topics_.end() ||
+         (has_topics_regex_ && std::regex_match(topic_name, topics_regex_));
+}
+
+bool TopicFilter::has_topic_time_ranges() const
+{
+  return !topic_time_ranges_.empty();
+}
+
+std::vector<TopicFilter::TimeRange> TopicFilter::get_time_ranges(
+  const std::string & topic_name) const
+{
+  std::vector<TimeRange> time_ranges;
+  for (const auto & topic_time_range : topic_time_ranges_) {
+    if (std::regex_match(topic_name, topic_time_range.first)) {
+      time_ranges.push_back(topic_time_range.second);
+    }
+  }
+  return time_ranges;
+}
+
+bool TopicFilter::is_within(
+  const std::vector<TimeRange> & time_ranges, rcutils_time_point_value_t time_stamp)
+{
+  return overlaps(time_ranges, time_stamp, time_stamp);
+}
+
+bool TopicFilter::overlaps(
+  const std::vector<TimeRange> & time_ranges, rcutils_time_point_value_t start_time,
+  rcutils_time_point_value_t end_time)
+{
+  if (time_ranges.empty()) {
+    return true;
+  }
+  for (const auto & time_range : time_ranges) {
+    if (time_range.first <= end_time && start_time <= time_range.second) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace rosbag2_storage
@@ -0,0 +1,83 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+std::string to_string(const rcutils_uint8_array_t & serialized_data)
+{
+  return std::string(
+    reinterpret_cast<const char *>(serialized_data.buffer), serialized_data.buffer_length);
+}
+}  // namespace
+
+TEST(BufferSliceTest, views_reference_the_shared_buffer_and_keep_it_alive) {
+  const std::string data = "first second";
+  auto buffer = rosbag2_storage::make_serialized_message(data.data(), data.size());
+  std::weak_ptr<rcutils_uint8_array_t> weak_buffer = buffer;
+
+  auto first = rosbag2_storage::make_serialized_data_view(
+    rosbag2_storage::make_buffer_slice(buffer, 0, 5));
+  auto second = rosbag2_storage::make_serialized_data_view(
+    rosbag2_storage::make_buffer_slice(buffer, 6, 6));
+  EXPECT_THAT(first->buffer, Eq(buffer->buffer));
+  EXPECT_THAT(to_string(*first), StrEq("first"));
+  EXPECT_THAT(to_string(*second), StrEq("second"));
+  EXPECT_TRUE(rosbag2_storage::is_serialized_data_view(*first));
+  EXPECT_FALSE(rosbag2_storage::is_serialized_data_view(*buffer));
+
+  buffer.reset();
+  first.reset();
+  EXPECT_FALSE(weak_buffer.expired());
+  EXPECT_THAT(to_string(*second), StrEq("second"));
+  second.reset();
+  EXPECT_TRUE(weak_buffer.expired());
+}
+
+TEST(BufferSliceTest, resizing_a_view_copies_it_out_of_the_shared_buffer) {
+  auto owner = std::make_shared<std::vector<uint8_t>>(
+    std::vector<uint8_t>{'a', 'b', 'c', 'd', 'e', 'f'});
+  auto view = rosbag2_storage::make_serialized_data_view({owner->data() + 1, 3, owner});
+
+  ASSERT_THAT(rcutils_uint8_array_resize(view.get(), 8), Eq(RCUTILS_RET_OK));
+  EXPECT_THAT(view->buffer, Ne(owner->data() + 1));
+  view->buffer_length = 4;
+  view->buffer[3] = 'x';
+  EXPECT_THAT(to_string(*view), StrEq("bcdx"));
+  EXPECT_THAT(*owner, ElementsAre('a', 'b', 'c', 'd', 'e', 'f'));
+
+  ASSERT_THAT(rcutils_uint8_array_resize(view.get(), 16), Eq(RCUTILS_RET_OK));
+  EXPECT_THAT(to_string(*view), StrEq("bcdx"));
+}
+
+TEST(BufferSliceTest, slices_must_be_within_the_serialized_data) {
+  auto buffer = rosbag2_storage::make_serialized_message("data", 4);
+
+  EXPECT_THAT(rosbag2_storage::make_buffer_slice(buffer, 4, 0).size, Eq(0u));
+  EXPECT_THROW(rosbag2_storage::make_buffer_slice(buffer, 2, 3), std::out_of_range);
+  EXPECT_THROW(rosbag2_storage::make_buffer_slice(buffer, 5, 0), std::out_of_range);
+}
@@ -0,0 +1,102 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/memory_arena.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+using namespace ::testing;  // NOLINT
+
+using rosbag2_storage::MemoryArena;
+using rosbag2_storage::MemoryArenaOptions;
+
+namespace
+{
+MemoryArenaOptions make_options(uint64_t size)
+{
+  MemoryArenaOptions options;
+  options.size = size;
+  return options;
+}
+}  // namespace
+
+TEST(MemoryArenaTest, freed_blocks_are_reused_for_the_same_size) {
+  MemoryArena arena(make_options(1));
+  // Rounded up to a huge page.
+  EXPECT_THAT(arena.get_size(), Eq(2u * 1024u * 1024u));
+
+  auto block = arena.allocate(100);
+  ASSERT_THAT(block, NotNull());
+  EXPECT_TRUE(arena.contains(block));
+  EXPECT_THAT(arena.get_capacity(block), Ge(100u));
+  EXPECT_THAT(arena.get_allocated_bytes(), Gt(0u));
+  std::memset(block, 1, 100);
+
+  arena.deallocate(block);
+  EXPECT_THAT(arena.get_allocated_bytes(), Eq(0u));
+  EXPECT_THAT(arena.allocate(90), Eq(block));
+  EXPECT_THAT(arena.allocate(90), Ne(block));
+
+  int on_the_stack = 0;
+  EXPECT_FALSE(arena.contains(&on_the_stack));
+}
+
+TEST(MemoryArenaTest, allocator_falls_back_to_the_heap_when_the_arena_is_exhausted) {
+  MemoryArena arena(make_options(1));
+  auto allocator = arena.get_allocator();
+
+  auto small = allocator.allocate(1000, allocator.state);
+  EXPECT_TRUE(arena.contains(small));
+  // Grows in place up to the capacity of the block, and moves to a larger block beyond it.
+  std::memset(small, 7, 1000);
+  auto grown = allocator.reallocate(small, arena.get_capacity(small), allocator.state);
+  EXPECT_THAT(grown, Eq(small));
+  grown = allocator.reallocate(small, 4000, allocator.state);
+  EXPECT_TRUE(arena.contains(grown));
+  EXPECT_THAT(static_cast<unsigned char *>(grown)[999], Eq(7));
+
+  auto large = allocator.allocate(4 * 1024 * 1024, allocator.state);
+  ASSERT_THAT(large, NotNull());
+  EXPECT_FALSE(arena.contains(large));
+  allocator.deallocate(large, allocator.state);
+
+  auto zeroed = static_cast<unsigned char *>(allocator.zero_allocate(10, 10, allocator.state));
+  EXPECT_THAT(std::vector<unsigned char>(zeroed, zeroed + 100), Each(Eq(0)));
+  allocator.deallocate(zeroed, allocator.state);
+  allocator.deallocate(grown, allocator.state);
+  EXPECT_THAT(arena.get_allocated_bytes(), Eq(0u));
+}
+
+TEST(MemoryArenaTest, messages_are_allocated_from_the_shared_arena_once_configured) {
+  auto message = rosbag2_storage::make_empty_serialized_message(100);
+  EXPECT_THAT(MemoryArena::get_shared(), IsNull());
+
+  MemoryArena::configure_shared(make_options(4 * 1024 * 1024));
+  auto arena = MemoryArena::get_shared();
+  ASSERT_THAT(arena, NotNull());
+  auto arena_message = rosbag2_storage::make_empty_serialized_message(100);
+  EXPECT_TRUE(arena->contains(arena_message->buffer));
+  EXPECT_FALSE(arena->contains(message->buffer));
+
+  EXPECT_NO_THROW(MemoryArena::configure_shared(make_options(4 * 1024 * 1024)));
+  EXPECT_THROW(MemoryArena::configure_shared(make_options(1)), std::logic_error);
+}
@@ -0,0 +1,95 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <stdexcept>
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/message_histogram.hpp"
+
+using namespace ::testing;  // NOLINT
+using rosbag2_storage::kInitialHistogramBucketDuration;
+using rosbag2_storage::kMaxHistogramBuckets;
+using rosbag2_storage::MessageHistogram;
+
+namespace
+{
+int64_t get_start(const MessageHistogram & histogram)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    histogram.starting_time.time_since_epoch()).count();
+}
+}  // namespace
+
+TEST(MessageHistogramTest, messages_are_counted_in_buckets_aligned_to_their_duration) {
+  const int64_t duration = kInitialHistogramBucketDuration.count();
+  MessageHistogram histogram;
+  rosbag2_storage::add_to_histogram(histogram, 10 * duration + 5, 100);
+  rosbag2_storage::add_to_histogram(histogram, 10 * duration + 7, 50);
+  rosbag2_storage::add_to_histogram(histogram, 12 * duration, 10);
+  // Earlier messages, e.g. of another topic written out of order, extend it to the front.
+  rosbag2_storage::add_to_histogram(histogram, 9 * duration + 1, 1);
+
+  EXPECT_THAT(histogram.bucket_duration, Eq(kInitialHistogramBucketDuration));
+  EXPECT_THAT(get_start(histogram), Eq(9 * duration));
+  EXPECT_THAT(histogram.message_counts, ElementsAre(1u, 2u, 0u, 1u));
+  EXPECT_THAT(histogram.sizes, ElementsAre(1u, 150u, 0u, 10u));
+
+  rosbag2_storage::remove_from_histogram(histogram, 10 * duration + 5, 100);
+  EXPECT_THAT(histogram.message_counts, ElementsAre(1u, 1u, 0u, 1u));
+  EXPECT_THAT(histogram.sizes, ElementsAre(1u, 50u, 0u, 10u));
+}
+
+TEST(MessageHistogramTest, long_histograms_are_coarsened_to_the_maximum_bucket_count) {
+  const int64_t duration = kInitialHistogramBucketDuration.count();
+  MessageHistogram histogram;
+  rosbag2_storage::add_to_histogram(histogram, 0, 1);
+  rosbag2_storage::add_to_histogram(histogram, 3 * kMaxHistogramBuckets * duration, 1);
+
+  EXPECT_THAT(histogram.bucket_duration, Eq(kInitialHistogramBucketDuration * 4));
+  EXPECT_THAT(histogram.message_counts, SizeIs(Le(kMaxHistogramBuckets)));
+  EXPECT_THAT(histogram.message_counts.front(), Eq(1u));
+  EXPECT_THAT(histogram.message_counts.back(), Eq(1u));
+
+  // A time stamp far off coarsens the histogram instead of allocating its buckets.
+  rosbag2_storage::add_to_histogram(histogram, 1600000000000000000, 1);
+  EXPECT_THAT(histogram.message_counts, SizeIs(Le(kMaxHistogramBuckets)));
+  EXPECT_THAT(histogram.message_counts.front(), Eq(2u));
+  EXPECT_THAT(histogram.message_counts.back(), Eq(1u));
+}
+
+TEST(MessageHistogramTest, histograms_of_different_bucket_durations_are_merged) {
+  const int64_t duration = kInitialHistogramBucketDuration.count();
+  MessageHistogram fine;
+  rosbag2_storage::add_to_histogram(fine, 0, 1);
+  rosbag2_storage::add_to_histogram(fine, duration, 2);
+  rosbag2_storage::add_to_histogram(fine, 5 * duration, 4);
+  const auto coarse =
+    rosbag2_storage::coarsen_histogram(fine, kInitialHistogramBucketDuration * 4);
+  EXPECT_THAT(coarse.message_counts, ElementsAre(2u, 1u));
+  EXPECT_THAT(coarse.sizes, ElementsAre(3u, 4u));
+
+  MessageHistogram merged = coarse;
+  rosbag2_storage::merge_histograms(merged, fine);
+  rosbag2_storage::merge_histograms(merged, MessageHistogram{});
+  EXPECT_THAT(merged.bucket_duration, Eq(kInitialHistogramBucketDuration * 4));
+  EXPECT_THAT(merged.message_counts, ElementsAre(4u, 2u));
+  EXPECT_THAT(merged.sizes, ElementsAre(6u, 8u));
+
+  EXPECT_THROW(
+    rosbag2_storage::coarsen_histogram(fine, kInitialHistogramBucketDuration * 3),
+    std::invalid_argument);
+}
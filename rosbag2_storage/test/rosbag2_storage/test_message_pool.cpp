@@ -0,0 +1,86 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <thread>
+
+#include "rosbag2_storage/message_pool.hpp"
+
+using namespace ::testing;  // NOLINT
+
+TEST(message_pool, released_messages_are_reused_and_reset) {
+  rosbag2_storage::MessagePool pool;
+
+  auto message = pool.make_message();
+  message->topic_name = "topic";
+  message->time_stamp = 42;
+  message->serialized_data = pool.make_empty_serialized_message(8);
+  const auto * const message_address = message.get();
+  message.reset();
+
+  EXPECT_THAT(pool.get_pooled_message_count(), Eq(1u));
+  EXPECT_THAT(pool.get_pooled_buffer_count(), Eq(1u));
+
+  message = pool.make_message();
+  EXPECT_THAT(message.get(), Eq(message_address));
+  EXPECT_THAT(message->topic_name, IsEmpty());
+  EXPECT_THAT(message->time_stamp, Eq(0));
+  EXPECT_THAT(message->serialized_data, IsNull());
+  EXPECT_THAT(pool.get_pooled_message_count(), Eq(0u));
+}
+
+TEST(message_pool, buffers_are_reused_if_they_fit_and_grown_otherwise) {
+  rosbag2_storage::MessagePool pool;
+
+  auto buffer = pool.make_empty_serialized_message(64);
+  buffer->buffer_length = 64;
+  const auto * const buffer_address = buffer.get();
+  buffer.reset();
+
+  buffer = pool.make_empty_serialized_message(32);
+  EXPECT_THAT(buffer.get(), Eq(buffer_address));
+  EXPECT_THAT(buffer->buffer_length, Eq(0u));
+  EXPECT_THAT(buffer->buffer_capacity, Ge(64u));
+  buffer.reset();
+
+  buffer = pool.make_empty_serialized_message(128);
+  EXPECT_THAT(buffer.get(), Eq(buffer_address));
+  EXPECT_THAT(buffer->buffer_capacity, Ge(128u));
+}
+
+TEST(message_pool, keeps_at_most_max_pooled_objects) {
+  rosbag2_storage::MessagePool pool(1);
+
+  auto first_message = pool.make_message();
+  auto second_message = pool.make_message();
+  first_message.reset();
+  second_message.reset();
+
+  EXPECT_THAT(pool.get_pooled_message_count(), Eq(1u));
+}
+
+TEST(message_pool, messages_can_be_released_after_the_pool_and_from_other_threads) {
+  auto pool = std::make_unique<rosbag2_storage::MessagePool>();
+  auto message = pool->make_message();
+  message->serialized_data = pool->make_empty_serialized_message(16);
+  auto other_message = pool->make_message();
+
+  std::thread([&other_message]() {other_message.reset();}).join();
+  EXPECT_THAT(pool->get_pooled_message_count(), Eq(1u));
+
+  pool.reset();
+  message.reset();
+}
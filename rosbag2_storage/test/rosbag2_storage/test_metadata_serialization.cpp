@@ -15,7 +15,9 @@
 #include <gmock/gmock.h>
 
 #include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,6 +27,8 @@
 # include <Windows.h>
 #endif
 
+#include "rcpputils/filesystem_helper.hpp"
+
 #include "rosbag2_storage/bag_metadata.hpp"
 #include "rosbag2_storage/metadata_io.hpp"
 #include "rosbag2_test_common/temporary_directory_fixture.hpp"
@@ -132,3 +136,486 @@ TEST_F(MetadataFixture, metadata_reads_v4_fills_offered_qos_profiles)
   auto actual_first_topic = read_metadata.topics_with_message_count[0];
   EXPECT_THAT(actual_first_topic.topic_metadata.offered_qos_profiles, Eq(offered_qos_profiles));
 }
+
+TEST_F(MetadataFixture, metadata_reads_v5_files_and_cache_statistics)
+{
+  BagMetadata metadata{};
+  metadata.version = 5;
+  metadata.relative_file_paths = {"bag_0.db3", "bag_1.db3"};
+  metadata.files = {{"bag_0.db3", true}, {"bag_1.db3", false}};
+  metadata.cache_high_water_mark_bytes = 4096;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[0].path, Eq("bag_0.db3"));
+  EXPECT_TRUE(read_metadata.files[0].indexed);
+  EXPECT_THAT(read_metadata.files[1].path, Eq("bag_1.db3"));
+  EXPECT_FALSE(read_metadata.files[1].indexed);
+  EXPECT_THAT(read_metadata.cache_high_water_mark_bytes, Eq(4096u));
+}
+
+TEST_F(MetadataFixture, metadata_reads_v6_compression_dictionaries)
+{
+  BagMetadata metadata{};
+  metadata.version = 6;
+  metadata.compression_format = "zstd";
+  metadata.compression_mode = "MESSAGE";
+  metadata.compression_dictionaries = {"bag/dictionary_1.zstd_dict", "bag/dictionary_2.zstd_dict"};
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  EXPECT_THAT(read_metadata.compression_dictionaries, Eq(metadata.compression_dictionaries));
+}
+
+TEST_F(MetadataFixture, metadata_reads_v8_bag_id_and_clock_offset)
+{
+  BagMetadata metadata{};
+  metadata.bag_id = "vehicle_run_42";
+  metadata.clock_offset = std::chrono::nanoseconds(-1500);
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  // Read from the YAML file as well as from the binary file.
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  EXPECT_THAT(read_metadata.bag_id, Eq("vehicle_run_42"));
+  EXPECT_THAT(read_metadata.clock_offset, Eq(std::chrono::nanoseconds(-1500)));
+
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  const auto yaml_file_name = temporary_dir_path_ + "/" + MetadataIo::metadata_filename;
+  ASSERT_EQ(std::remove(yaml_file_name.c_str()), 0);
+  read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  EXPECT_THAT(read_metadata.bag_id, Eq("vehicle_run_42"));
+  EXPECT_THAT(read_metadata.clock_offset, Eq(std::chrono::nanoseconds(-1500)));
+}
+
+TEST_F(MetadataFixture, metadata_reads_v11_encryption_key)
+{
+  BagMetadata metadata{};
+  metadata.compression_format = "zstd";
+  metadata.compression_mode = "CHUNK";
+  metadata.encryption_format = "aes_gcm";
+  metadata.encryption_key_id = "0123456789abcdef";
+  metadata.encrypted_key = "00112233";
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  const auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  EXPECT_THAT(read_metadata.encryption_format, Eq("aes_gcm"));
+  EXPECT_THAT(read_metadata.encryption_key_id, Eq("0123456789abcdef"));
+  EXPECT_THAT(read_metadata.encrypted_key, Eq("00112233"));
+}
+
+TEST_F(MetadataFixture, metadata_reads_v9_dropped_message_counts)
+{
+  BagMetadata metadata{};
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", ""}, 10, 100, 20});
+  metadata.topics_with_message_count.push_back(
+    {{"/camera", "type2", "cdr", ""}, 20, 800, 50, 0, 7});
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[0].dropped_message_count, Eq(0u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].dropped_message_count, Eq(7u));
+
+  // An update of only the dropped messages is appended to the binary file.
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  metadata.topics_with_message_count[0].dropped_message_count = 2;
+  metadata_io_->append_metadata(temporary_dir_path_, metadata);
+  const auto yaml_file_name = temporary_dir_path_ + "/" + MetadataIo::metadata_filename;
+  ASSERT_EQ(std::remove(yaml_file_name.c_str()), 0);
+  read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[0].dropped_message_count, Eq(2u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].dropped_message_count, Eq(7u));
+}
+
+TEST_F(MetadataFixture, metadata_reads_compression_formats_of_topics)
+{
+  BagMetadata metadata{};
+  metadata.compression_format = "zstd";
+  metadata.compression_mode = "MESSAGE";
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", ""}, 10});
+  metadata.topics_with_message_count.push_back(
+    {{"/image", "type2", "cdr", ""}, 20, 0, 0, 0, 0, "none"});
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  const auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[0].compression_format, Eq(""));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].compression_format, Eq("none"));
+}
+
+TEST_F(MetadataFixture, metadata_reads_deduplicated_topics)
+{
+  BagMetadata metadata{};
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", ""}, 10});
+  metadata.topics_with_message_count.push_back(
+    {{"/map", "type2", "cdr", ""}, 20, 0, 0, 0, 0, "", true});
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  const auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_FALSE(read_metadata.topics_with_message_count[0].deduplicated);
+  EXPECT_TRUE(read_metadata.topics_with_message_count[1].deduplicated);
+}
+
+TEST_F(MetadataFixture, metadata_reads_delta_encoded_topics)
+{
+  BagMetadata metadata{};
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", ""}, 10});
+  metadata.topics_with_message_count.push_back(
+    {{"/costmap", "type2", "cdr", ""}, 20, 0, 0, 0, 0, "", false, true});
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  const auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_FALSE(read_metadata.topics_with_message_count[0].delta_encoded);
+  EXPECT_TRUE(read_metadata.topics_with_message_count[1].delta_encoded);
+}
+
+TEST_F(MetadataFixture, metadata_reads_histograms_of_topics)
+{
+  BagMetadata metadata{};
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", ""}, 10});
+  metadata.topics_with_message_count.push_back({{"/camera", "type2", "cdr", ""}, 3});
+  auto & histogram = metadata.topics_with_message_count[1].histogram;
+  histogram.starting_time =
+    std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::seconds(16));
+  histogram.bucket_duration = std::chrono::nanoseconds(1 << 24);
+  histogram.message_counts = {2, 0, 1};
+  histogram.sizes = {2000, 0, 1000};
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  ASSERT_EQ(std::remove(binary_file_name.c_str()), 0);
+  const auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(
+    read_metadata.topics_with_message_count[0].histogram.bucket_duration.count(), Eq(0));
+  const auto & read_histogram = read_metadata.topics_with_message_count[1].histogram;
+  EXPECT_THAT(read_histogram.starting_time, Eq(histogram.starting_time));
+  EXPECT_THAT(read_histogram.bucket_duration, Eq(histogram.bucket_duration));
+  EXPECT_THAT(read_histogram.message_counts, ElementsAre(2u, 0u, 1u));
+  EXPECT_THAT(read_histogram.sizes, ElementsAre(2000u, 0u, 1000u));
+}
+
+TEST_F(MetadataFixture, metadata_reads_stripes_of_files)
+{
+  BagMetadata metadata{};
+  metadata.relative_file_paths = {"bag_0.db3", "/mnt/disk1/bag/bag_0.db3"};
+  metadata.files = {{"bag_0.db3", true}, {"/mnt/disk1/bag/bag_0.db3", true}};
+  metadata.files[1].stripe = 1;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[0].stripe, Eq(0u));
+  EXPECT_THAT(read_metadata.files[1].stripe, Eq(1u));
+  EXPECT_THAT(read_metadata.relative_file_paths[1], Eq("/mnt/disk1/bag/bag_0.db3"));
+}
+
+TEST_F(MetadataFixture, metadata_reads_topics_of_files)
+{
+  BagMetadata metadata{};
+  metadata.relative_file_paths = {"bag_0.db3", "camera/camera_0.db3"};
+  metadata.files = {{"bag_0.db3", true}, {"camera/camera_0.db3", true}};
+  metadata.files[0].topics = {"/tf", "/odom"};
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[0].topics, ElementsAre("/tf", "/odom"));
+  EXPECT_THAT(read_metadata.files[1].topics, IsEmpty());
+}
+
+TEST_F(MetadataFixture, metadata_reads_message_counts_of_files)
+{
+  BagMetadata metadata{};
+  metadata.relative_file_paths = {"bag_0.db3", "bag_1.db3"};
+  metadata.files = {{"bag_0.db3", true}, {"bag_1.db3", true}};
+  metadata.files[0].message_count = 120;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[0].message_count, Eq(120u));
+  EXPECT_THAT(read_metadata.files[1].message_count, Eq(0u));
+}
+
+TEST_F(MetadataFixture, metadata_reads_sizes_of_topics)
+{
+  BagMetadata metadata{};
+  metadata.topics_with_message_count.push_back({{"topic1", "type1", "rmw1", ""}, 10, 1000, 200});
+  metadata.topics_with_message_count.push_back(
+    {{"topic2", "type2", "rmw2", ""}, 20, 4000, 300, 1000});
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  const auto & first_topic = read_metadata.topics_with_message_count[0];
+  EXPECT_THAT(first_topic.total_size, Eq(1000u));
+  EXPECT_THAT(first_topic.max_message_size, Eq(200u));
+  EXPECT_THAT(first_topic.compressed_size, Eq(0u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].compressed_size, Eq(1000u));
+}
+
+TEST_F(MetadataFixture, writing_metadata_replaces_the_metadata_file)
+{
+  BagMetadata metadata{};
+  metadata.message_count = 10;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  metadata.message_count = 20;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  EXPECT_THAT(metadata_io_->read_metadata(temporary_dir_path_).message_count, Eq(20u));
+  std::ifstream temporary_file(
+    temporary_dir_path_ + "/" + MetadataIo::metadata_filename + ".tmp");
+  EXPECT_FALSE(temporary_file.good());
+}
+
+TEST_F(MetadataFixture, metadata_reads_v4_considers_all_files_indexed)
+{
+  BagMetadata metadata{};
+  metadata.version = 4;
+  metadata.relative_file_paths = {"bag_0.db3", "bag_1.db3"};
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[1].path, Eq("bag_1.db3"));
+  EXPECT_TRUE(read_metadata.files[0].indexed);
+  EXPECT_TRUE(read_metadata.files[1].indexed);
+}
+
+TEST_F(MetadataFixture, metadata_is_read_again_after_metadata_file_changed)
+{
+  BagMetadata metadata{};
+  metadata.version = 4;
+  metadata.message_count = 50;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  EXPECT_THAT(metadata_io_->read_metadata(temporary_dir_path_).message_count, Eq(50u));
+  EXPECT_THAT(metadata_io_->read_metadata(temporary_dir_path_).message_count, Eq(50u));
+
+  // Written by another process, which cannot invalidate the cache of this one.
+  const std::string bagfile = "rosbag2_bagfile_information:\n"
+    "  version: 4\n"
+    "  storage_identifier: sqlite3\n"
+    "  relative_file_paths: []\n"
+    "  duration:\n"
+    "    nanoseconds: 0\n"
+    "  starting_time:\n"
+    "    nanoseconds_since_epoch: 0\n"
+    "  message_count: 1234\n"
+    "  topics_with_message_count: []\n"
+    "  compression_format: \"\"\n"
+    "  compression_mode: \"\"\n";
+  {
+    std::ofstream fout(temporary_dir_path_ + "/" + MetadataIo::metadata_filename);
+    fout << bagfile;
+  }
+
+  EXPECT_THAT(metadata_io_->read_metadata(temporary_dir_path_).message_count, Eq(1234u));
+}
+
+TEST_F(MetadataFixture, metadata_of_version_14_is_also_written_in_binary)
+{
+  BagMetadata metadata{};
+  metadata.storage_identifier = "sqlite3";
+  metadata.relative_file_paths = {"bag_0.db3", "camera/camera_0.db3"};
+  metadata.files = {{"bag_0.db3", true}, {"camera/camera_0.db3", false}};
+  metadata.files[0].starting_time =
+    std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(1000));
+  metadata.files[0].duration = std::chrono::nanoseconds(500);
+  metadata.files[0].message_count = 7;
+  metadata.files[1].stripe = 1;
+  metadata.files[1].topics = {"/camera"};
+  metadata.duration = std::chrono::nanoseconds(2000);
+  metadata.message_count = 30;
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", "qos1"}, 10, 100, 20});
+  metadata.topics_with_message_count.push_back(
+    {{"/camera", "type2", "cdr", ""}, 20, 800, 50, 400, 3, "none", true, true});
+  metadata.topics_with_message_count[1].histogram.bucket_duration = std::chrono::seconds(1);
+  metadata.topics_with_message_count[1].histogram.message_counts = {15, 5};
+  metadata.topics_with_message_count[1].histogram.sizes = {600, 200};
+  metadata.compression_format = "zstd";
+  metadata.compression_mode = "MESSAGE";
+  metadata.cache_high_water_mark_bytes = 4096;
+  metadata.compression_dictionaries = {"dictionary_1.zstd_dict"};
+  metadata.encryption_format = "aes_gcm";
+  metadata.encryption_key_id = "0123456789abcdef";
+  metadata.encrypted_key = "00112233";
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+
+  // Only the binary file is left to read.
+  const auto yaml_file_name = temporary_dir_path_ + "/" + MetadataIo::metadata_filename;
+  ASSERT_EQ(std::remove(yaml_file_name.c_str()), 0);
+  ASSERT_TRUE(metadata_io_->metadata_file_exists(temporary_dir_path_));
+  auto read_metadata = metadata_io_->read_metadata(temporary_dir_path_);
+
+  EXPECT_THAT(read_metadata.version, Eq(14));
+  EXPECT_THAT(read_metadata.storage_identifier, Eq("sqlite3"));
+  EXPECT_THAT(read_metadata.relative_file_paths, Eq(metadata.relative_file_paths));
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[0].starting_time, Eq(metadata.files[0].starting_time));
+  EXPECT_THAT(read_metadata.files[0].duration, Eq(metadata.files[0].duration));
+  EXPECT_THAT(read_metadata.files[0].message_count, Eq(7u));
+  EXPECT_FALSE(read_metadata.files[1].indexed);
+  EXPECT_THAT(read_metadata.files[1].stripe, Eq(1u));
+  EXPECT_THAT(read_metadata.files[1].topics, ElementsAre("/camera"));
+  EXPECT_THAT(read_metadata.duration, Eq(metadata.duration));
+  EXPECT_THAT(read_metadata.message_count, Eq(30u));
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(
+    read_metadata.topics_with_message_count[0].topic_metadata,
+    Eq(metadata.topics_with_message_count[0].topic_metadata));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].total_size, Eq(800u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].compressed_size, Eq(400u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].dropped_message_count, Eq(3u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].compression_format, Eq("none"));
+  EXPECT_FALSE(read_metadata.topics_with_message_count[0].deduplicated);
+  EXPECT_TRUE(read_metadata.topics_with_message_count[1].deduplicated);
+  EXPECT_FALSE(read_metadata.topics_with_message_count[0].delta_encoded);
+  EXPECT_TRUE(read_metadata.topics_with_message_count[1].delta_encoded);
+  EXPECT_THAT(
+    read_metadata.topics_with_message_count[1].histogram.bucket_duration,
+    Eq(std::chrono::seconds(1)));
+  EXPECT_THAT(
+    read_metadata.topics_with_message_count[1].histogram.message_counts, ElementsAre(15u, 5u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].histogram.sizes, ElementsAre(600u, 200u));
+  EXPECT_THAT(read_metadata.compression_format, Eq("zstd"));
+  EXPECT_THAT(read_metadata.compression_mode, Eq("MESSAGE"));
+  EXPECT_THAT(read_metadata.cache_high_water_mark_bytes, Eq(4096u));
+  EXPECT_THAT(read_metadata.compression_dictionaries, Eq(metadata.compression_dictionaries));
+  EXPECT_THAT(read_metadata.encryption_format, Eq("aes_gcm"));
+  EXPECT_THAT(read_metadata.encryption_key_id, Eq("0123456789abcdef"));
+  EXPECT_THAT(read_metadata.encrypted_key, Eq("00112233"));
+}
+
+TEST_F(MetadataFixture, metadata_of_older_versions_is_not_written_in_binary)
+{
+  BagMetadata metadata{};
+  metadata.version = 6;
+  metadata_io_->write_metadata(temporary_dir_path_, metadata);
+  std::ifstream binary_file(
+    temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename);
+  EXPECT_FALSE(binary_file.good());
+}
+
+TEST_F(MetadataFixture, metadata_checkpoints_are_appended_to_the_binary_metadata)
+{
+  BagMetadata metadata{};
+  metadata.storage_identifier = "sqlite3";
+  metadata.relative_file_paths = {"bag_0.db3"};
+  metadata.files = {{"bag_0.db3", true}};
+  metadata.topics_with_message_count.push_back({{"/tf", "type1", "cdr", ""}, 0});
+  metadata_io_->append_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  const auto file_size = [&binary_file_name]() {
+      std::ifstream file(binary_file_name, std::ios::binary | std::ios::ate);
+      return static_cast<int64_t>(file.tellg());
+    };
+  const auto first_size = file_size();
+
+  metadata.relative_file_paths.push_back("bag_1.db3");
+  metadata.files[0].message_count = 5;
+  metadata.files.push_back({"bag_1.db3", true});
+  metadata.topics_with_message_count[0].message_count = 5;
+  metadata.topics_with_message_count.push_back({{"/odom", "type2", "cdr", ""}, 3});
+  metadata.message_count = 8;
+  metadata_io_->append_metadata(temporary_dir_path_, metadata);
+  const auto second_size = file_size();
+  EXPECT_GT(second_size, first_size);
+
+  metadata.files[1].message_count = 2;
+  metadata.topics_with_message_count[1].message_count = 5;
+  metadata.message_count = 10;
+  metadata_io_->append_metadata(temporary_dir_path_, metadata);
+  // Appending only what changed adds less than the whole metadata.
+  EXPECT_LT(file_size() - second_size, first_size);
+
+  std::ifstream yaml_file(temporary_dir_path_ + "/" + MetadataIo::metadata_filename);
+  EXPECT_FALSE(yaml_file.good());
+  const auto read_metadata = MetadataIo().read_metadata(temporary_dir_path_);
+  EXPECT_THAT(read_metadata.relative_file_paths, ElementsAre("bag_0.db3", "bag_1.db3"));
+  ASSERT_THAT(read_metadata.files, SizeIs(2u));
+  EXPECT_THAT(read_metadata.files[0].message_count, Eq(5u));
+  EXPECT_THAT(read_metadata.files[1].message_count, Eq(2u));
+  EXPECT_THAT(read_metadata.message_count, Eq(10u));
+  ASSERT_THAT(read_metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[0].message_count, Eq(5u));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].topic_metadata.name, Eq("/odom"));
+  EXPECT_THAT(read_metadata.topics_with_message_count[1].message_count, Eq(5u));
+}
+
+TEST_F(MetadataFixture, metadata_checkpoint_cut_off_while_appending_is_ignored)
+{
+  BagMetadata metadata{};
+  metadata.message_count = 10;
+  metadata_io_->append_metadata(temporary_dir_path_, metadata);
+  metadata.message_count = 20;
+  metadata_io_->append_metadata(temporary_dir_path_, metadata);
+
+  const auto binary_file_name = temporary_dir_path_ + "/" + MetadataIo::binary_metadata_filename;
+  std::string contents;
+  {
+    std::ifstream fin(binary_file_name, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream fout(binary_file_name, std::ios::binary | std::ios::trunc);
+    fout.write(contents.data(), static_cast<std::streamsize>(contents.size() - 3));
+  }
+
+  EXPECT_THAT(metadata_io_->read_metadata(temporary_dir_path_).message_count, Eq(10u));
+}
+
+TEST_F(MetadataFixture, file_summaries_are_merged_into_the_metadata_of_the_bag)
+{
+  EXPECT_FALSE(metadata_io_->file_summaries_exist(temporary_dir_path_));
+
+  auto make_summary = [](const std::string & file_name, int64_t starting_time, size_t count) {
+      BagMetadata summary{};
+      summary.storage_identifier = "sqlite3";
+      summary.compression_format = "zstd";
+      summary.compression_mode = "FILE";
+      summary.relative_file_paths = {file_name};
+      summary.files.resize(1);
+      summary.files[0].path = file_name;
+      summary.files[0].starting_time =
+        std::chrono::time_point<std::chrono::high_resolution_clock>(
+        std::chrono::nanoseconds(starting_time));
+      summary.files[0].duration = std::chrono::nanoseconds(10);
+      summary.files[0].message_count = count;
+      summary.starting_time = summary.files[0].starting_time;
+      summary.duration = summary.files[0].duration;
+      summary.message_count = count;
+      summary.topics_with_message_count.push_back({{"topic1", "type1", "rmw1", ""}, count});
+      summary.topics_with_message_count.push_back({{"topic2", "type2", "rmw2", ""}, 0});
+      return summary;
+    };
+  const auto first_file = (rcpputils::fs::path(temporary_dir_path_) / "bag_0.db3.zstd").string();
+  const auto second_file = (rcpputils::fs::path(temporary_dir_path_) / "bag_1.db3.zstd").string();
+  metadata_io_->write_file_summary(second_file, make_summary("bag_1.db3.zstd", 200, 3));
+  metadata_io_->write_file_summary(first_file, make_summary("bag_0.db3.zstd", 100, 2));
+
+  ASSERT_TRUE(metadata_io_->file_summaries_exist(temporary_dir_path_));
+  EXPECT_FALSE(metadata_io_->metadata_file_exists(temporary_dir_path_));
+  const auto metadata = metadata_io_->read_file_summaries(temporary_dir_path_);
+  EXPECT_THAT(metadata.storage_identifier, Eq("sqlite3"));
+  EXPECT_THAT(metadata.compression_mode, Eq("FILE"));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre(first_file, second_file));
+  ASSERT_THAT(metadata.files, SizeIs(2u));
+  EXPECT_THAT(metadata.files[1].path, Eq(second_file));
+  EXPECT_THAT(metadata.message_count, Eq(5u));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch(), Eq(std::chrono::nanoseconds(100)));
+  EXPECT_THAT(metadata.duration, Eq(std::chrono::nanoseconds(110)));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(2u));
+  EXPECT_THAT(metadata.topics_with_message_count[0].message_count, Eq(5u));
+  EXPECT_THAT(metadata.topics_with_message_count[1].message_count, Eq(0u));
+}
@@ -29,6 +29,7 @@ class TestPlugin : public rosbag2_storage::storage_interfaces::ReadWriteInterfac
 public:
   ~TestPlugin() override;
 
+  using rosbag2_storage::storage_interfaces::ReadWriteInterface::open;
   void open(const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag flag) override;
 
   void create_topic(const rosbag2_storage::TopicMetadata & topic) override;
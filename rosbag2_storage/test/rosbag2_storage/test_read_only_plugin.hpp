@@ -27,6 +27,7 @@ class TestReadOnlyPlugin : public rosbag2_storage::storage_interfaces::ReadOnlyI
 public:
   ~TestReadOnlyPlugin() override;
 
+  using rosbag2_storage::storage_interfaces::ReadOnlyInterface::open;
   void open(const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag flag) override;
 
   bool has_next() override;
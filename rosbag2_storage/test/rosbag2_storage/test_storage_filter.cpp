@@ -0,0 +1,90 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <regex>
+
+#include "rosbag2_storage/storage_filter.hpp"
+
+using namespace ::testing;  // NOLINT
+
+TEST(topic_filter, empty_filter_selects_all_topics) {
+  rosbag2_storage::TopicFilter topic_filter{rosbag2_storage::StorageFilter{}};
+
+  EXPECT_TRUE(topic_filter.selects_all_topics());
+  EXPECT_TRUE(topic_filter.is_selected("/camera", "sensor_msgs/msg/Image"));
+}
+
+TEST(topic_filter, topics_and_regex_are_alternatives) {
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"/imu"};
+  storage_filter.topics_regex = "/camera/.*";
+  rosbag2_storage::TopicFilter topic_filter{storage_filter};
+
+  EXPECT_FALSE(topic_filter.selects_all_topics());
+  EXPECT_TRUE(topic_filter.is_selected("/imu", "sensor_msgs/msg/Imu"));
+  EXPECT_TRUE(topic_filter.is_selected("/camera/left", "sensor_msgs/msg/Image"));
+  EXPECT_FALSE(topic_filter.is_selected("/front/camera/left", "sensor_msgs/msg/Image"));
+  EXPECT_FALSE(topic_filter.is_selected("/odom", "nav_msgs/msg/Odometry"));
+}
+
+TEST(topic_filter, types_restrict_the_selected_topics) {
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topic_types = {"sensor_msgs/msg/Image"};
+  rosbag2_storage::TopicFilter all_images{storage_filter};
+
+  EXPECT_TRUE(all_images.is_selected("/camera/left", "sensor_msgs/msg/Image"));
+  EXPECT_TRUE(all_images.is_selected("/front", "sensor_msgs/msg/Image"));
+  EXPECT_FALSE(all_images.is_selected("/camera/info", "sensor_msgs/msg/CameraInfo"));
+
+  storage_filter.topics_regex = "/camera/.*";
+  rosbag2_storage::TopicFilter camera_images{storage_filter};
+
+  EXPECT_TRUE(camera_images.is_selected("/camera/left", "sensor_msgs/msg/Image"));
+  EXPECT_FALSE(camera_images.is_selected("/front", "sensor_msgs/msg/Image"));
+  EXPECT_FALSE(camera_images.is_selected("/camera/info", "sensor_msgs/msg/CameraInfo"));
+}
+
+TEST(topic_filter, invalid_regex_throws) {
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics_regex = "/camera/(";
+
+  EXPECT_THROW(rosbag2_storage::TopicFilter{storage_filter}, std::regex_error);
+}
+
+TEST(topic_filter, topic_time_ranges_restrict_the_time_stamps_of_matching_topics) {
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topic_time_ranges = {{"/camera/.*", 10, 20}, {"/camera/left", 30, 0}};
+  rosbag2_storage::TopicFilter topic_filter{storage_filter};
+
+  EXPECT_TRUE(topic_filter.selects_all_topics());
+  EXPECT_TRUE(topic_filter.has_topic_time_ranges());
+  EXPECT_THAT(topic_filter.get_time_ranges("/tf"), IsEmpty());
+  EXPECT_TRUE(rosbag2_storage::TopicFilter::is_within(topic_filter.get_time_ranges("/tf"), 5));
+
+  const auto right = topic_filter.get_time_ranges("/camera/right");
+  EXPECT_THAT(right, SizeIs(1));
+  EXPECT_FALSE(rosbag2_storage::TopicFilter::is_within(right, 9));
+  EXPECT_TRUE(rosbag2_storage::TopicFilter::is_within(right, 10));
+  EXPECT_TRUE(rosbag2_storage::TopicFilter::is_within(right, 20));
+  EXPECT_FALSE(rosbag2_storage::TopicFilter::is_within(right, 30));
+
+  const auto left = topic_filter.get_time_ranges("/camera/left");
+  EXPECT_THAT(left, SizeIs(2));
+  EXPECT_FALSE(rosbag2_storage::TopicFilter::is_within(left, 25));
+  EXPECT_TRUE(rosbag2_storage::TopicFilter::is_within(left, 1000));
+  EXPECT_TRUE(rosbag2_storage::TopicFilter::overlaps(left, 21, 30));
+  EXPECT_FALSE(rosbag2_storage::TopicFilter::overlaps(left, 21, 29));
+}
@@ -0,0 +1,329 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__BINARY_LOG_STORAGE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__BINARY_LOG_STORAGE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/types.h"
+#include "rosbag2_storage/message_pool.hpp"
+#include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage_plugins
+{
+
+namespace binary_log
+{
+class BufferReader;
+class BufferWriter;
+class DirectFileWriter;
+class MappedFile;
+class RemoteFile;
+class StreamSink;
+enum class Opcode : uint8_t;
+}  // namespace binary_log
+
+class FileWriteback;
+
+/**
+ * Storage which appends the messages to a file in large chunks, each followed by an index of
+ * the time stamps and topics of its messages. Writing is a sequential stream of large writes,
+ * without the per message overhead of a database.
+ *
+ * A summary of all topics and chunks is appended when the storage is closed, so opening a file
+ * reads only its end. Files which were not closed properly are recovered by scanning the chunk
+ * headers, losing only the messages of the chunk being written.
+ *
+ * Files opened with READ_ONLY are mapped into memory, and the serialized data of the messages
+ * read points into the mapping, which stays alive as long as any of the messages.
+ */
+class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC BinaryLogStorage
+  : public rosbag2_storage::storage_interfaces::ReadWriteInterface
+{
+public:
+  BinaryLogStorage();
+
+  ~BinaryLogStorage() override;
+
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag =
+    rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE) override;
+
+  /**
+   * Opens the file with a preset profile given in storage_config:
+   * - "" (default): chunks of up to 4 MiB.
+   * - "resilient": chunks of up to 64 KiB or 100 ms of messages, so little is lost on a crash.
+   * - "max_throughput": chunks of up to 32 MiB.
+   * - "direct_io": chunks of up to 32 MiB, written with direct I/O bypassing the page cache.
+   *   On Linux several writes are kept in flight with io_uring, and the latencies of the writes
+   *   are logged on close. Falls back to buffered writes if the file system does not support
+   *   direct I/O.
+   *
+   * The transaction limits of storage_config, if any is set, limit the chunks instead.
+   * Every complete chunk is handed to the operating system.
+   * If storage_config.stream_address is set, a file opened with READ_WRITE is streamed to that
+   * binary_log::IngestServer instead of written, as the file named after the bag folder and the
+   * file, e.g. "my_bag/my_bag_0.binlog". It cannot be read while it is written then, and close
+   * waits for the server to acknowledge the whole file.
+   * Opening a file which was not closed properly with APPEND drops its incomplete last chunk.
+   * A uri starting with "http://" or "s3://" is read with HTTP range requests, see
+   * binary_log::RemoteFile, and can only be opened with READ_ONLY. Only the summary at the end of
+   * the file and the chunks selected by the filter are downloaded, the next chunks of up to
+   * 64 MiB in parallel while the chunks downloaded before are read.
+   * \throws std::runtime_error if the preset profile is unknown or the file cannot be opened.
+   */
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag,
+    const rosbag2_storage::StorageConfig & storage_config) override;
+
+  void remove_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  void set_topic_handle(
+    const std::string & topic_name, rosbag2_storage::TopicHandle handle) override;
+
+  void write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) override;
+
+  void write(
+    const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
+  override;
+
+  /// Reading a file opened for writing first writes the chunk being filled.
+  bool has_next() override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
+
+  /// The views reference the mapped file, or the chunks read, without taking ownership.
+  bool visit_next_batch(
+    const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+    size_t max_messages, size_t max_bytes) override;
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() override;
+
+  rosbag2_storage::BagMetadata get_metadata() override;
+
+  std::string get_relative_file_path() const override;
+
+  uint64_t get_bagfile_size() const override;
+
+  std::string get_storage_identifier() const override;
+
+  rosbag2_storage::StorageCapabilities get_capabilities() const override;
+
+  uint64_t get_minimum_split_file_size() const override;
+
+  /// Chunks without a message of the filtered topics and time range are not read at all.
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  void reset_filter() override;
+
+  /**
+   * Continues reading at the given time, looked up in the chunk time ranges.
+   * Seeking before the start time of the storage filter reads from the start time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  void set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool) override;
+
+  /**
+   * Copies the chunks within the time range as they are, along with their indices. Of the chunks
+   * at the ends of the time range, the bytes of the messages within it are appended to new
+   * chunks. Files being streamed cannot be sliced.
+   */
+  std::string slice(
+    const std::string & uri, const rcutils_time_point_value_t & start_time,
+    const rcutils_time_point_value_t & end_time) override;
+
+private:
+  struct Topic
+  {
+    rosbag2_storage::TopicMetadata metadata;
+    bool removed;
+    uint64_t message_count;
+    rcutils_time_point_value_t min_timestamp;
+    rcutils_time_point_value_t max_timestamp;
+  };
+
+  struct IndexEntry
+  {
+    uint32_t topic_id;
+    rcutils_time_point_value_t time_stamp;
+    rcutils_time_point_value_t publish_time_stamp;
+    uint64_t offset;
+  };
+
+  struct Chunk
+  {
+    uint64_t offset;
+    // Zero if the index was lost, it is then rebuilt from the messages of the chunk.
+    uint64_t index_offset;
+    rcutils_time_point_value_t min_timestamp;
+    rcutils_time_point_value_t max_timestamp;
+    rcutils_time_point_value_t min_publish_timestamp;
+    rcutils_time_point_value_t max_publish_timestamp;
+    uint32_t message_count;
+    std::vector<uint32_t> topic_ids;
+  };
+
+  // Body of a record, either within the file mapping or copied from the file.
+  struct RecordBody
+  {
+    const uint8_t * mapped_data;
+    size_t mapped_size;
+    std::vector<uint8_t> copied_data;
+
+    const uint8_t * data() const
+    {
+      return mapped_data ? mapped_data : copied_data.data();
+    }
+
+    size_t size() const
+    {
+      return mapped_data ? mapped_size : copied_data.size();
+    }
+  };
+
+  // A chunk read into memory, with the entries to read from it in reading order.
+  struct LoadedChunk
+  {
+    size_t chunk_number;
+    RecordBody body;
+    std::vector<IndexEntry> entries;
+    size_t next_entry;
+  };
+
+  static void read_chunk_header(binary_log::BufferReader & reader, Chunk & chunk);
+
+  void close();
+  void load_file();
+  bool read_summary(uint64_t file_size);
+  void recover(uint64_t file_size);
+  void add_chunk(Chunk chunk, const std::vector<IndexEntry> & entries);
+  void truncate_file(uint64_t size);
+  void write_raw(const void * data, size_t size);
+  void flush_file();
+  void write_record(binary_log::Opcode opcode, const std::vector<uint8_t> & body);
+  void write_topic(binary_log::BufferWriter & writer, uint32_t topic_id) const;
+  void write_chunk();
+  // Returns the offset of the index written.
+  uint64_t write_chunk_index(uint64_t chunk_offset, const std::vector<IndexEntry> & entries);
+  void write_summary();
+  uint32_t get_topic_id(const rosbag2_storage::SerializedBagMessage & message) const;
+  void append_message(
+    uint32_t topic_id, rcutils_time_point_value_t time_stamp,
+    rcutils_time_point_value_t publish_time_stamp, const uint8_t * data, size_t data_size);
+  bool is_chunk_limit_reached() const;
+  uint64_t get_file_size() const;
+  std::vector<uint8_t> read_raw(uint64_t offset, size_t size) const;
+  RecordBody read_record(uint64_t offset, uint8_t expected_opcode) const;
+  // Reads the index of the chunk, or rebuilds it from the chunk body if the index was lost.
+  std::vector<IndexEntry> read_chunk_index(
+    const Chunk & chunk, const RecordBody & chunk_body) const;
+  /// \throws std::runtime_error if the checksum of the messages does not match.
+  void verify_chunk(const RecordBody & chunk_body) const;
+  void prepare_for_reading();
+  bool is_selected_topic(uint32_t topic_id) const;
+  bool is_selected(const Chunk & chunk) const;
+  bool is_selected(const IndexEntry & entry) const;
+  rcutils_time_point_value_t get_read_start_time() const;
+  rcutils_time_point_value_t get_order_timestamp(const IndexEntry & entry) const;
+  void load_chunks();
+  void load_chunk(size_t chunk_number);
+  void prefetch_remote_chunks();
+  // Takes the next message from the loaded chunks, which has_next() must have loaded. A chunk
+  // whose messages are all taken is moved to read_chunks, which keeps the views into it valid.
+  rosbag2_storage::SerializedBagMessageView take_next_message(
+    std::vector<LoadedChunk> & read_chunks);
+
+  std::FILE * file_ {nullptr};
+  // Writes instead of file_ if the file is written with direct I/O.
+  std::unique_ptr<binary_log::DirectFileWriter> direct_file_writer_;
+  // Writes instead of file_, which is null then, if the file is streamed to an ingest server.
+  std::unique_ptr<binary_log::StreamSink> stream_sink_;
+  // Reads instead of file_, which is null then, if the file is remote.
+  std::unique_ptr<binary_log::RemoteFile> remote_file_;
+  // Preallocates and writes back the file written, if configured.
+  std::unique_ptr<FileWriteback> file_writeback_;
+  std::string relative_path_;
+  bool is_writable_ {false};
+  // Format version of the file, which selects the checksum of its chunks.
+  uint32_t format_version_ {0};
+  // Size of the file up to the last record read or written, excluding the summary.
+  uint64_t file_size_ {0};
+  // Whether writing can continue without seeking, i.e. nothing was read since the last write.
+  mutable bool is_file_position_at_end_ {false};
+  std::vector<Topic> topics_;
+  std::unordered_map<std::string, uint32_t> topic_ids_;
+  // Topic ids indexed by the handles the writer assigned, -1 if unassigned.
+  std::vector<int64_t> topic_ids_by_handle_;
+  std::vector<Chunk> chunks_;
+
+  // The chunk being filled, i.e. its messages and index.
+  std::vector<uint8_t> chunk_body_;
+  std::vector<IndexEntry> chunk_entries_;
+  Chunk chunk_ {};
+  uint32_t chunk_crc_ {0};
+  std::chrono::steady_clock::time_point chunk_start_time_ {};
+  uint64_t chunk_max_messages_ {0};
+  uint64_t chunk_max_bytes_ {0};
+  std::chrono::milliseconds chunk_max_duration_ {0};
+
+  // Null if the file is written or cannot be mapped, it is then read with copies.
+  std::shared_ptr<const binary_log::MappedFile> mapped_file_ {};
+  bool is_reading_prepared_ {false};
+  // Numbers of the chunks to read, ordered by their first time stamp in reading order.
+  std::vector<size_t> chunks_to_read_;
+  size_t next_chunk_to_read_ {0};
+  // Position in chunks_to_read_ up to which the chunks of a remote file were prefetched.
+  size_t next_chunk_to_prefetch_ {0};
+  std::vector<LoadedChunk> loaded_chunks_;
+  rosbag2_storage::StorageFilter storage_filter_ {};
+  // Topics passing storage_filter_, by topic id, resolved when preparing to read.
+  std::vector<bool> is_selected_topic_;
+  // Time ranges of the topics with time ranges of their own in storage_filter_, by topic id.
+  std::vector<std::vector<rosbag2_storage::TopicFilter::TimeRange>> topic_time_ranges_;
+  bool selects_all_topics_ {true};
+  rcutils_time_point_value_t seek_time_ {0};
+  std::shared_ptr<rosbag2_storage::MessagePool> message_pool_ {};
+};
+
+}  // namespace rosbag2_storage_plugins
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__BINARY_LOG_STORAGE_HPP_
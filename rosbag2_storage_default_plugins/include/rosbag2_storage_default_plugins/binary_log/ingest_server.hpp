@@ -0,0 +1,94 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__INGEST_SERVER_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__INGEST_SERVER_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+/**
+ * Receives binary logs streamed by the binary_log storage, see storage_config.stream_address,
+ * and appends each to the file of its stream name below the root directory.
+ *
+ * Every frame is written and handed to the operating system before it is acknowledged, so the
+ * file exactly holds the data acknowledged. A stream continued after a lost connection is
+ * appended to the file. The bag's metadata is not streamed, the received bag is completed with
+ * `ros2 bag reindex`.
+ */
+class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC IngestServer
+{
+public:
+  /**
+   * Listens on the TCP port, zero picks a free port.
+   * \throws std::runtime_error if it cannot listen or the platform is not supported.
+   */
+  IngestServer(uint16_t port, const std::string & root_directory);
+
+  ~IngestServer();
+
+  IngestServer(const IngestServer &) = delete;
+  IngestServer & operator=(const IngestServer &) = delete;
+
+  uint16_t get_port() const;
+
+  /// Stops listening, closes all connections and waits for their threads.
+  void stop();
+
+private:
+  void accept_connections();
+  // Requires mutex_ to be locked.
+  void join_finished_connection_threads();
+  void serve_connection(int socket);
+  void receive_stream(int socket);
+
+  const std::string root_directory_;
+  int listening_socket_ {-1};
+  uint16_t port_ {0};
+  std::mutex mutex_;
+  bool is_stopped_ {false};
+  std::set<int> connection_sockets_;
+  std::thread accept_thread_;
+  std::vector<std::thread> connection_threads_;
+  // Connection threads which are done, joined on the next accepted connection.
+  std::vector<std::thread::id> finished_connection_threads_;
+};
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__INGEST_SERVER_HPP_
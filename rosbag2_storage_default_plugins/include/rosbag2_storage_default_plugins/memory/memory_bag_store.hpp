@@ -0,0 +1,102 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_BAG_STORE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_BAG_STORE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage_plugins
+{
+
+namespace memory
+{
+struct MemoryFile;
+}  // namespace memory
+
+/**
+ * Process-wide store of the files written by the memory storage, keyed by their path.
+ *
+ * The messages of a file are kept in chunks of memory, which are released once the file is
+ * removed from the store and no storage has it open anymore. A bag written with the memory
+ * storage can be read within the same process only.
+ */
+class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC MemoryBagStore
+{
+public:
+  static MemoryBagStore & get_instance();
+
+  MemoryBagStore(const MemoryBagStore &) = delete;
+  MemoryBagStore & operator=(const MemoryBagStore &) = delete;
+
+  /// Limits the memory of all chunks, writes beyond the limit fail. 0 disables the limit.
+  void set_max_bytes(uint64_t max_bytes);
+
+  uint64_t get_max_bytes() const;
+
+  /// Memory of all chunks, including those of removed files which are still open.
+  uint64_t get_size_bytes() const;
+
+  bool contains(const std::string & path) const;
+
+  void remove(const std::string & path);
+
+  void clear();
+
+  /// \throws std::runtime_error if the file already exists.
+  std::shared_ptr<memory::MemoryFile> create_file(const std::string & path);
+
+  /// \throws std::runtime_error if the file does not exist.
+  std::shared_ptr<memory::MemoryFile> open_file(const std::string & path) const;
+
+  /**
+   * Returns a chunk of the given size. Chunks are filled in place and never resized, so the
+   * messages read from a chunk may reference it while it is still being filled.
+   * \throws std::runtime_error if the chunk exceeds the memory limit.
+   */
+  std::shared_ptr<std::vector<uint8_t>> allocate_chunk(size_t size);
+
+private:
+  MemoryBagStore();
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<memory::MemoryFile>> files_;
+  std::atomic<uint64_t> max_bytes_ {0};
+  // Released by the chunks themselves, so chunks may outlive their file.
+  std::atomic<uint64_t> size_bytes_ {0};
+};
+
+}  // namespace rosbag2_storage_plugins
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_BAG_STORE_HPP_
@@ -0,0 +1,154 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_STORAGE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_STORAGE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rcutils/types.h"
+#include "rosbag2_storage/message_pool.hpp"
+#include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage_plugins
+{
+
+namespace memory
+{
+struct MemoryFile;
+}  // namespace memory
+
+/**
+ * Storage which keeps the messages in chunks of memory instead of writing them to disk.
+ *
+ * The files are kept in the process-wide MemoryBagStore, keyed by their path, so a bag written
+ * with this storage can be read by another storage within the same process until it is removed
+ * from the store. The memory used by all files can be limited with MemoryBagStore::set_max_bytes
+ * or the memory_max_bytes of the storage config.
+ */
+class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC MemoryStorage
+  : public rosbag2_storage::storage_interfaces::ReadWriteInterface
+{
+public:
+  MemoryStorage();
+
+  ~MemoryStorage() override;
+
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag =
+    rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE) override;
+
+  /**
+   * The storage has no preset profiles, and the transaction limits of storage_config are
+   * ignored since every message is stored right away. A memory_max_bytes other than 0 replaces
+   * the memory limit of the store for all files.
+   * \throws std::runtime_error if a preset profile is given, if the chunk size is 0, if the file
+   * to create already exists in the store, or if the file to read does not.
+   */
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag,
+    const rosbag2_storage::StorageConfig & storage_config) override;
+
+  void remove_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic) override;
+
+  void set_topic_handle(
+    const std::string & topic_name, rosbag2_storage::TopicHandle handle) override;
+
+  /// \throws std::runtime_error if the message exceeds the memory limit of the store.
+  void write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) override;
+
+  void write(
+    const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
+  override;
+
+  /// Messages written after reading started are read after the next seek or filter change.
+  bool has_next() override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() override;
+
+  rosbag2_storage::BagMetadata get_metadata() override;
+
+  std::string get_relative_file_path() const override;
+
+  /// Size of the serialized data of all messages of the file.
+  uint64_t get_bagfile_size() const override;
+
+  std::string get_storage_identifier() const override;
+
+  rosbag2_storage::StorageCapabilities get_capabilities() const override;
+
+  uint64_t get_minimum_split_file_size() const override;
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  void reset_filter() override;
+
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  void set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool) override;
+
+private:
+  // Requires the mutex of the file to be locked.
+  void write_locked(const rosbag2_storage::SerializedBagMessage & message);
+  uint32_t get_topic_id(const rosbag2_storage::SerializedBagMessage & message) const;
+  void prepare_for_reading();
+
+  std::shared_ptr<memory::MemoryFile> file_ {};
+  // Topic ids in the file indexed by the handles the writer assigned, -1 if unassigned.
+  std::vector<int64_t> topic_ids_by_handle_;
+  std::string relative_path_;
+  bool is_writable_ {false};
+  // The chunk being filled, a file opened with APPEND starts a new one.
+  std::shared_ptr<std::vector<uint8_t>> chunk_ {};
+  size_t chunk_used_ {0};
+  // Messages are copied into chunks of this size, larger messages get a chunk of their own.
+  size_t chunk_size_ {0};
+
+  bool is_reading_prepared_ {false};
+  // Numbers of the entries to read, in reading order.
+  std::vector<size_t> entries_to_read_;
+  size_t next_entry_to_read_ {0};
+  rosbag2_storage::StorageFilter storage_filter_ {};
+  rcutils_time_point_value_t seek_time_ {0};
+  std::shared_ptr<rosbag2_storage::MessagePool> message_pool_ {};
+};
+
+}  // namespace rosbag2_storage_plugins
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_STORAGE_HPP_
@@ -0,0 +1,222 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__ROS1_BAG_STORAGE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__ROS1_BAG_STORAGE_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rcutils/types.h"
+#include "rosbag2_storage/message_pool.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+// This is necessary because of using stl types here. It is completely safe, because
+// a) the member is not accessible from the outside
+// b) there are no inline functions.
+#ifdef _WIN32
+# pragma warning(push)
+# pragma warning(disable:4251)
+#endif
+
+namespace rosbag2_storage_plugins
+{
+
+namespace binary_log
+{
+class MappedFile;
+}  // namespace binary_log
+
+namespace ros1_bag
+{
+class ChunkDecompressor;
+}  // namespace ros1_bag
+
+/**
+ * Storage which reads ROS 1 bags of format version 2.0 as they are, without converting them
+ * first. The file is mapped into memory, and opening it reads only the connections and chunk
+ * infos at its end.
+ *
+ * Chunks compressed with bz2 or lz4 are decompressed on a pool of threads ahead of the reader.
+ * Messages of uncompressed chunks point into the mapping, which stays alive as long as any of
+ * them.
+ *
+ * The messages keep their ROS 1 serialization, with the serialization format "ros1", and the
+ * types of their topics are named like in ROS 2, e.g. "std_msgs/msg/String". Connections of the
+ * same topic, e.g. of several publishers, are read as one topic.
+ */
+class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC Ros1BagStorage
+  : public rosbag2_storage::storage_interfaces::ReadOnlyInterface
+{
+public:
+  Ros1BagStorage();
+
+  ~Ros1BagStorage() override;
+
+  using rosbag2_storage::storage_interfaces::ReadOnlyInterface::open;
+
+  /**
+   * Opens the bag file at the uri, which ROS 1 bags can only be opened for reading with.
+   * \throws std::runtime_error if the io_flag is not READ_ONLY, or the file is not a ROS 1 bag
+   * of format version 2.0 or was not closed properly.
+   */
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag =
+    rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY) override;
+
+  bool has_next() override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
+
+  /// The views reference the mapped file, or the chunks decompressed, without taking ownership.
+  bool visit_next_batch(
+    const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+    size_t max_messages, size_t max_bytes) override;
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() override;
+
+  rosbag2_storage::BagMetadata get_metadata() override;
+
+  std::string get_relative_file_path() const override;
+
+  uint64_t get_bagfile_size() const override;
+
+  std::string get_storage_identifier() const override;
+
+  rosbag2_storage::StorageCapabilities get_capabilities() const override;
+
+  /**
+   * Chunks without a message of the connections of the filtered topics and time range are not
+   * read at all, and of the others only the indices of those connections are read.
+   */
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
+
+  void reset_filter() override;
+
+  /**
+   * Continues reading at the given time, looked up in the time ranges of the chunk infos.
+   * Seeking before the start time of the storage filter reads from the start time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  void set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool) override;
+
+private:
+  struct Topic
+  {
+    rosbag2_storage::TopicMetadata metadata;
+    uint64_t message_count;
+    rcutils_time_point_value_t min_timestamp;
+    rcutils_time_point_value_t max_timestamp;
+  };
+
+  struct Chunk
+  {
+    uint64_t offset;
+    rcutils_time_point_value_t min_timestamp;
+    rcutils_time_point_value_t max_timestamp;
+    // Connection ids and the number of their messages in the chunk.
+    std::vector<std::pair<uint32_t, uint32_t>> connection_counts;
+  };
+
+  struct IndexEntry
+  {
+    uint32_t topic_id;
+    rcutils_time_point_value_t time_stamp;
+    // Offset of the message record in the uncompressed chunk data.
+    uint32_t offset;
+  };
+
+  // A chunk read into memory, with the entries to read from it in time stamp order.
+  struct LoadedChunk
+  {
+    // Within the file mapping if the chunk is not compressed, else within decompressed_data.
+    const uint8_t * data;
+    size_t size;
+    std::shared_ptr<const std::vector<uint8_t>> decompressed_data;
+    std::vector<IndexEntry> entries;
+    size_t next_entry;
+  };
+
+  // A chunk to read next, which is decompressed ahead unless it is not compressed.
+  struct PendingChunk
+  {
+    size_t chunk_number;
+    std::future<std::vector<uint8_t>> decompressed_data;
+  };
+
+  void close();
+  void load_file();
+  void read_index_section(uint64_t index_position);
+  void add_connection(
+    uint32_t connection_id, const std::string & topic_name, const uint8_t * connection_header,
+    size_t connection_header_size);
+  void prepare_for_reading();
+  // Whether the data is within the file mapping rather than a decompressed chunk.
+  bool is_mapped(const uint8_t * data) const;
+  bool is_selected(const Chunk & chunk) const;
+  bool is_selected_connection(uint32_t connection_id) const;
+  rcutils_time_point_value_t get_read_start_time() const;
+  // Submits the chunks after the one read next for decompression, up to the read ahead limit.
+  void decompress_ahead();
+  void load_chunks();
+  void load_chunk(PendingChunk pending_chunk);
+  // Takes the next message from the loaded chunks, which has_next() must have loaded. A chunk
+  // whose messages are all taken is moved to read_chunks, which keeps the views into it valid.
+  rosbag2_storage::SerializedBagMessageView take_next_message(
+    std::vector<LoadedChunk> & read_chunks);
+
+  std::string relative_path_;
+  std::shared_ptr<const binary_log::MappedFile> mapped_file_ {};
+  std::vector<Topic> topics_;
+  std::unordered_map<std::string, uint32_t> topic_ids_;
+  // Topic id of every connection id.
+  std::unordered_map<uint32_t, uint32_t> connection_topic_ids_;
+  std::vector<Chunk> chunks_;
+
+  std::unique_ptr<ros1_bag::ChunkDecompressor> chunk_decompressor_;
+  bool is_reading_prepared_ {false};
+  // Numbers of the chunks to read, ordered by their first time stamp.
+  std::vector<size_t> chunks_to_read_;
+  size_t next_chunk_to_read_ {0};
+  // The chunks from next_chunk_to_read_ on which are decompressed ahead.
+  std::deque<PendingChunk> pending_chunks_;
+  std::vector<LoadedChunk> loaded_chunks_;
+  rosbag2_storage::StorageFilter storage_filter_ {};
+  // Topics passing storage_filter_, by topic id, resolved when preparing to read.
+  std::vector<bool> is_selected_topic_;
+  // Time ranges of the topics with time ranges of their own in storage_filter_, by topic id.
+  std::vector<std::vector<rosbag2_storage::TopicFilter::TimeRange>> topic_time_ranges_;
+  rcutils_time_point_value_t seek_time_ {0};
+  std::shared_ptr<rosbag2_storage::MessagePool> message_pool_ {};
+};
+
+}  // namespace rosbag2_storage_plugins
+
+#ifdef _WIN32
+# pragma warning(pop)
+#endif
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__ROS1_BAG_STORAGE_HPP_
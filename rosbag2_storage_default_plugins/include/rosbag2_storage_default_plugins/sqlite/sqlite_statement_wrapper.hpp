@@ -48,6 +48,15 @@ public:
   SqliteStatementWrapper & operator=(const SqliteStatementWrapper &) = delete;
   ~SqliteStatementWrapper();
 
+  // A BLOB column value in memory owned by SQLite, which is only valid until the statement
+  // steps to the next row. Lets the caller copy the value into memory of its choice.
+  struct BlobView
+  {
+    const void * data = nullptr;
+    size_t size = 0;
+    bool is_null = true;
+  };
+
   template<typename ... Columns>
   class QueryResult
   {
@@ -100,12 +109,28 @@ public:
         if (next_row_idx_ == POSITION_END) {
           throw SqliteException("Cannot dereference iterator at end of result set!");
         }
-        if (is_row_cache_valid()) {
-          return row_cache_;
+        if (!is_row_cache_valid()) {
+          obtain_row_values();
+        }
+        return row_cache_;
+      }
+
+      /**
+       * Reads the values of the current row and passes them to the visitor as rvalues, so they
+       * can be moved into their destinations instead of copying the row.
+       * Does not step to the next row.
+       * \return The result of the visitor.
+       */
+      template<typename Visitor>
+      decltype(auto) consume_row(Visitor && visitor) const
+      {
+        if (next_row_idx_ == POSITION_END) {
+          throw SqliteException("Cannot dereference iterator at end of result set!");
         }
         RowType row{};
-        obtain_row_values(row);
-        return row;
+        obtain_row_values_impl(row, std::index_sequence_for<Columns ...>{});
+        return pass_row_values(
+          std::forward<Visitor>(visitor), row, std::index_sequence_for<Columns ...>{});
       }
 
       bool operator==(const Iterator & other) const
@@ -119,13 +144,19 @@ public:
 
 private:
       template<typename Indices = std::index_sequence_for<Columns ...>>
-      void obtain_row_values(RowType & row) const
+      void obtain_row_values() const
       {
-        obtain_row_values_impl(row, Indices{});
-        row_cache_ = row;
+        obtain_row_values_impl(row_cache_, Indices{});
         cached_row_idx_ = next_row_idx_ - 1;
       }
 
+      template<typename Visitor, size_t ... Is>
+      static decltype(auto) pass_row_values(
+        Visitor && visitor, RowType & row, std::index_sequence<Is ...>)
+      {
+        return std::forward<Visitor>(visitor)(std::move(std::get<Is>(row)) ...);
+      }
+
       template<size_t I, size_t ... Is, typename RemainingIndices = std::index_sequence<Is ...>>
       void obtain_row_values_impl(RowType & row, std::index_sequence<I, Is ...>) const
       {
@@ -164,6 +195,16 @@ private:
       return *begin();
     }
 
+    /// Passes the values of every row to the visitor, see Iterator::consume_row.
+    template<typename Visitor>
+    void for_each_row(Visitor && visitor)
+    {
+      const auto end_iterator = end();
+      for (auto row = begin(); row != end_iterator; ++row) {
+        row.consume_row(visitor);
+      }
+    }
+
 private:
     void try_access_data()
     {
@@ -189,6 +230,10 @@ private:
   std::shared_ptr<SqliteStatementWrapper> bind(const std::string & value);
   std::shared_ptr<SqliteStatementWrapper> bind(std::shared_ptr<rcutils_uint8_array_t> value);
 
+  /**
+   * Resets the statement, clears its bindings and releases all blobs bound to it.
+   * Called by execute_and_reset(), also if executing the statement fails.
+   */
   std::shared_ptr<SqliteStatementWrapper> reset();
 
 private:
@@ -200,6 +245,7 @@ private:
   void obtain_column_value(size_t index, double & value) const;
   void obtain_column_value(size_t index, std::string & value) const;
   void obtain_column_value(size_t index, std::shared_ptr<rcutils_uint8_array_t> & value) const;
+  void obtain_column_value(size_t index, BlobView & value) const;
 
   template<typename T>
   void check_and_report_bind_error(int return_code, T value);
@@ -16,12 +16,18 @@
 #define ROSBAG2_STORAGE_DEFAULT_PLUGINS__SQLITE__SQLITE_STORAGE_HPP_
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "rcutils/types.h"
+#include "rosbag2_storage/message_pool.hpp"
 #include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
 #include "rosbag2_storage/storage_filter.hpp"
@@ -40,11 +46,14 @@
 namespace rosbag2_storage_plugins
 {
 
+class FileWriteback;
+class SqliteDataFile;
+
 class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC SqliteStorage
   : public rosbag2_storage::storage_interfaces::ReadWriteInterface
 {
 public:
-  SqliteStorage() = default;
+  SqliteStorage();
 
   ~SqliteStorage() override;
 
@@ -53,10 +62,55 @@ public:
     rosbag2_storage::storage_interfaces::IOFlag io_flag =
     rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE) override;
 
+  /**
+   * Opens the database with a preset profile given in storage_config:
+   * - "" (default): write-ahead log with synchronous = NORMAL.
+   * - "resilient": write-ahead log with synchronous = FULL, i.e. no committed message is lost
+   *   even on power loss.
+   * - "max_throughput": no journal, no syncing, large pages and caches and an exclusive lock.
+   *   The bagfile cannot be read while being recorded and will likely be corrupt if recording
+   *   is interrupted by a crash.
+   *
+   * If storage_config.defer_index_creation is set, the timestamp index is only built when the
+   * storage is destroyed. Files opened for reading which lack the index, e.g. because recording
+   * was interrupted, are indexed when opened with APPEND and read without index otherwise.
+   *
+   * If storage_config.topic_timestamp_index is set, an additional (topic_id, timestamp) index
+   * is created, which speeds up reading a few topics out of many.
+   *
+   * If storage_config.cluster_messages_by_topic is set when creating a database, the messages
+   * table is stored without rowid in (topic_id, timestamp, id) order, so the messages of a
+   * topic are in contiguous pages. The topics read are then merged in time stamp order.
+   * Messages of such databases are always selected instead of read by incremental BLOB I/O.
+   *
+   * If storage_config.checksums is set, the CRC-32C of every message is stored along with it
+   * and checked when the message is read, which then throws if the message is corrupt.
+   *
+   * If storage_config.large_message_threshold is set when creating a database, the data of
+   * larger messages is appended to a data file next to it, named after the database with
+   * "-data" appended, and the database stores its offset and length instead. The data file has
+   * to be kept with the database.
+   *
+   * If any of the transaction limits in storage_config is set, single message writes are
+   * batched into a transaction which is committed once a limit is reached, and on destruction.
+   * With a maximum duration, a thread commits the transaction when it expires even if no more
+   * messages are written.
+   * \throws std::runtime_error if the preset profile is unknown.
+   */
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag,
+    const rosbag2_storage::StorageConfig & storage_config) override;
+
   void remove_topic(const rosbag2_storage::TopicMetadata & topic) override;
 
   void create_topic(const rosbag2_storage::TopicMetadata & topic) override;
 
+  void create_topics(const std::vector<rosbag2_storage::TopicMetadata> & topics) override;
+
+  void set_topic_handle(
+    const std::string & topic_name, rosbag2_storage::TopicHandle handle) override;
+
   void write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) override;
 
   void write(
@@ -67,33 +121,163 @@ public:
 
   std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override;
 
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_next_batch(
+    size_t max_messages, size_t max_bytes) override;
+
   std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() override;
 
+  /**
+   * Reads the message counts and time ranges from the topic summary kept by the writer, and
+   * counts only the messages written since it was last committed. Files without summary,
+   * e.g. recorded by older versions, are scanned completely.
+   */
   rosbag2_storage::BagMetadata get_metadata() override;
 
+  /// Reads the lengths of the serialized data of all messages, but not the data itself.
+  std::vector<rosbag2_storage::TopicInformation> get_topic_sizes() override;
+
   std::string get_relative_file_path() const override;
 
+  /**
+   * Estimated from the data written since the file size was last read from the file system,
+   * which happens again after 1000 messages, or after 64 KiB but at least 1/64 of the size.
+   */
   uint64_t get_bagfile_size() const override;
 
   std::string get_storage_identifier() const override;
 
+  rosbag2_storage::StorageCapabilities get_capabilities() const override;
+
   uint64_t get_minimum_split_file_size() const override;
 
   void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override;
 
   void reset_filter() override;
 
+  /**
+   * Continues reading at the given time, looked up in the timestamp index.
+   * Seeking before the start time of the storage filter reads from the start time.
+   */
+  void seek(const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * The messages of a topic are indexed when it is first accessed at random, by reading their
+   * ids and time stamps in time stamp order. With topic_timestamp_idx this reads only the index,
+   * otherwise all messages are scanned. Messages are then read by their id.
+   */
+  uint64_t get_topic_message_count(const std::string & topic_name) override;
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_topic_message(
+    const std::string & topic_name, uint64_t index) override;
+
+  uint64_t find_topic_message(
+    const std::string & topic_name, const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * Reads the latest message of every topic by topic_timestamp_idx if the database has it,
+   * without indexing the topics in memory.
+   */
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override;
+
+  /**
+   * Queries the messages committed after the last message read, in the order of the filter,
+   * if the database changed since the last query according to PRAGMA data_version. Readers of a
+   * database in write-ahead log mode do not block its writer, and see the messages committed
+   * when their query started.
+   */
+  bool poll_new_messages() override;
+
+  void set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool) override;
+
+  /**
+   * Attaches this database to a new one with the same layout, and copies the topics and the
+   * messages found in the timestamp index with INSERT ... SELECT in one transaction. The data
+   * of large messages is copied from data file to data file. The indices of the new database
+   * are built after copying.
+   */
+  std::string slice(
+    const std::string & uri, const rcutils_time_point_value_t & start_time,
+    const rcutils_time_point_value_t & end_time) override;
+
 private:
+  struct TopicSummary
+  {
+    uint64_t message_count;
+    rcutils_time_point_value_t min_timestamp;
+    rcutils_time_point_value_t max_timestamp;
+  };
+
+  // Sampling of a topic so far, continued by the messages followed in poll_new_messages().
+  struct SampledTopic
+  {
+    // Number of messages which passed the sample interval.
+    uint64_t message_count;
+    rcutils_time_point_value_t last_timestamp;
+  };
+
+  // Ids and time stamps of the messages of a topic, in time stamp order.
+  struct TopicIndex
+  {
+    std::vector<int64_t> message_ids;
+    std::vector<rcutils_time_point_value_t> timestamps;
+  };
+
   void initialize();
+  void create_indices();
+  bool has_schema_entry(const std::string & type, const std::string & name) const;
+  bool has_column(const std::string & table, const std::string & column) const;
+  bool has_timestamp_index() const;
+  std::string offered_qos_profiles_column() const;
+  int64_t read_data_version() const;
+  int64_t read_topic_summaries(std::unordered_map<int, TopicSummary> & topic_summaries) const;
+  void update_topic_summary(int topic_id, rcutils_time_point_value_t timestamp);
+  void write_topic_summaries();
+  bool read_monotonic_timestamps() const;
+  void write_monotonic_timestamps(bool monotonic_timestamps);
+  // Expects write_mutex_ to be held.
+  uint64_t read_bagfile_size() const;
   void prepare_for_writing();
   void prepare_for_reading();
+  // Fills temp.sampled_messages with the ids of the messages in the time range, and of the
+  // condition on the time ranges of single topics if any, which pass the sampling of the filter,
+  // by their time stamps in the order column.
+  void select_sampled_messages(
+    const std::vector<int> & topic_ids, bool all_topics, const std::string & order_column,
+    rcutils_time_point_value_t start_time, rcutils_time_point_value_t end_time,
+    const std::string & time_range_condition);
   void fill_topics_and_types();
+  // Columns of the messages table which read_row() reads.
+  std::string get_read_columns() const;
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_current_row();
+  const TopicIndex & get_topic_index(const std::string & topic_name);
   void activate_transaction();
   void commit_transaction();
+  bool is_transaction_batching_enabled() const;
+  bool is_transaction_limit_reached() const;
+  void write_message(const std::shared_ptr<const rosbag2_storage::SerializedBagMessage> & message);
+  void start_commit_thread();
+  void stop_commit_thread();
+  void commit_expired_transactions();
+  int get_topic_id(const rosbag2_storage::SerializedBagMessage & message) const;
+  SqliteDataFile & get_data_file();
 
+  // Data (null for large messages, which are read by id), timestamp, topic id, message id,
+  // publish timestamp (0 for databases without publish timestamps), checksum (-1 for
+  // databases without checksums) and offset and length of the data in the data file (-1 and 0
+  // for messages stored in the database).
   using ReadQueryResult = SqliteStatementWrapper::QueryResult<
-    std::shared_ptr<rcutils_uint8_array_t>, rcutils_time_point_value_t, std::string>;
+    SqliteStatementWrapper::BlobView, rcutils_time_point_value_t, int, int64_t,
+    rcutils_time_point_value_t, int64_t, int64_t, int64_t>;
+
+  // Reads the message of the row and steps to the next one, storing its id if asked to.
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_row(
+    ReadQueryResult::Iterator & row, int64_t * message_id_read = nullptr);
 
+  // Preallocates and writes back the database written, if configured. Declared before the
+  // database, so it is closed after the database wrote its last pages.
+  std::unique_ptr<FileWriteback> file_writeback_;
   std::shared_ptr<SqliteWrapper> database_;
   SqliteStatement write_statement_ {};
   SqliteStatement read_statement_ {};
@@ -101,10 +285,74 @@ private:
   ReadQueryResult::Iterator current_message_row_ {
     nullptr, SqliteStatementWrapper::QueryResult<>::Iterator::POSITION_END};
   std::unordered_map<std::string, int> topics_;
+  // Topic ids indexed by the handles the writer assigned, -1 if unassigned or removed.
+  std::vector<int> topic_ids_by_handle_;
+  // All topics of the database, read once per open and reset when topics are created or removed.
   std::vector<rosbag2_storage::TopicMetadata> all_topics_and_types_;
+  bool has_all_topics_and_types_ {false};
+  // Topic names by id of all topics in the database, filled when preparing for reading.
+  std::unordered_map<int, std::string> topic_names_by_id_;
+  // Index of every topic accessed at random, built on first access and kept until reopening.
+  std::unordered_map<std::string, TopicIndex> topic_indices_;
+  SqliteStatement topic_message_statement_ {};
+  SqliteStatement latest_message_statement_ {};
   std::string relative_path_;
   std::atomic_bool active_transaction_ {false};
+  bool defer_index_creation_ {false};
+  bool topic_timestamp_index_ {false};
+  // Whether the messages table has a publish_timestamp column, missing in older databases.
+  bool has_publish_timestamp_ {false};
+  // Whether the topics table has an offered_qos_profiles column, missing in older databases.
+  bool has_offered_qos_profiles_ {false};
+  // Whether the messages table has a checksum column, only written if checksums are enabled.
+  bool has_checksum_ {false};
+  // Whether the messages table has data_offset and data_length columns, which refer to the
+  // data file for messages larger than large_message_threshold_.
+  bool has_data_file_ {false};
+  // Whether the messages table is clustered by topic and time stamp, which is marked by its
+  // message_id_idx. Its messages have no rowid, and write() assigns their ids.
+  bool is_clustered_ {false};
+  uint64_t large_message_threshold_ {0};
+  // Opened when first needed for reading, and when opening the database for writing.
+  std::shared_ptr<SqliteDataFile> data_file_ {};
+  // Bound as data of the messages in the data file. Not null, which would bind NULL instead.
+  std::shared_ptr<rcutils_uint8_array_t> empty_data_ {};
+  mutable bool has_bagfile_size_ {false};
+  mutable uint64_t bagfile_size_ {0};
+  mutable uint64_t bytes_written_since_size_check_ {0};
+  mutable uint64_t messages_written_since_size_check_ {0};
+  uint64_t transaction_max_messages_ {0};
+  uint64_t transaction_max_bytes_ {0};
+  std::chrono::milliseconds transaction_max_duration_ {0};
+  uint64_t transaction_message_count_ {0};
+  uint64_t transaction_byte_count_ {0};
+  std::chrono::steady_clock::time_point transaction_start_time_ {};
+  // Held by the methods which write to the database, so the thread committing transactions
+  // which exceed transaction_max_duration_ does not interleave with them, and while the size
+  // of the bagfile written so far is estimated.
+  mutable std::mutex write_mutex_;
+  std::condition_variable commit_thread_wakeup_;
+  std::thread commit_thread_;
+  bool stop_commit_thread_ {false};
   rosbag2_storage::StorageFilter storage_filter_ {};
+  rcutils_time_point_value_t seek_time_ {0};
+  // Largest id of the messages read since the filter was set or seeking, which the query of
+  // poll_new_messages() continues after, and the data version of the database when the read
+  // query was prepared. -1 if no message was read or nothing is followed.
+  int64_t max_read_message_id_ {-1};
+  int64_t follow_after_message_id_ {-1};
+  int64_t data_version_ {0};
+  std::unordered_map<int, SampledTopic> sampled_topics_;
+  std::shared_ptr<rosbag2_storage::MessagePool> message_pool_ {};
+  // Per topic summary of all messages up to last_message_id_, kept when writing a database
+  // which has a summary table. Written to the table on every commit.
+  bool has_topic_summary_ {false};
+  bool topic_summaries_changed_ {false};
+  std::unordered_map<int, TopicSummary> topic_summaries_;
+  int64_t last_message_id_ {0};
+  // Whether the messages were written in time stamp order, so their ids are in that order, too.
+  bool has_monotonic_timestamps_ {false};
+  rcutils_time_point_value_t max_written_timestamp_ {0};
 };
 
 }  // namespace rosbag2_storage_plugins
@@ -19,9 +19,11 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "rcutils/types.h"
+#include "rosbag2_storage/message_pool.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
 #include "rosbag2_storage/storage_interfaces/base_io_interface.hpp"
 #include "rosbag2_storage_default_plugins/sqlite/sqlite_statement_wrapper.hpp"
@@ -35,18 +37,51 @@ using DBPtr = sqlite3 *;
 class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC SqliteWrapper
 {
 public:
-  SqliteWrapper(const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag);
+  /**
+   * Opens the database at uri.
+   * \param pragmas are executed in the given order after opening the database for writing,
+   * e.g. "journal_mode = WAL". If empty, "journal_mode = WAL" and "synchronous = NORMAL" are used.
+   * They are not applied if the database is opened read-only, which is memory mapped instead.
+   */
+  SqliteWrapper(
+    const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag,
+    const std::vector<std::string> & pragmas = {});
   SqliteWrapper();
   ~SqliteWrapper();
 
   SqliteStatement prepare_statement(const std::string & query);
 
+  /**
+   * Returns the statement prepared for query, preparing it only on the first call.
+   * The statement is reset before it is returned, so its bindings and results of the previous
+   * use are discarded. Meant for statements executed repeatedly, like opening transactions.
+   * The results of the statement have to be consumed before the same query is requested again.
+   */
+  SqliteStatement get_cached_statement(const std::string & query);
+
   size_t get_last_insert_id();
 
+  /**
+   * Reads a BLOB value straight into a new buffer, using SQLite's incremental BLOB I/O.
+   * Unlike selecting it in a query, SQLite does not first copy a large value into memory of its
+   * own. The BLOB handle is kept open and moved to the next row read from the same column.
+   * The buffer is taken from message_pool unless it is null.
+   * \throws SqliteException if the row does not exist or the value cannot be read.
+   */
+  std::shared_ptr<rcutils_uint8_array_t> read_blob(
+    const std::string & table, const std::string & column, int64_t row_id,
+    const std::shared_ptr<rosbag2_storage::MessagePool> & message_pool = nullptr);
+
   operator bool();
 
 private:
+  void close_blob();
+
   DBPtr db_ptr;
+  sqlite3_blob * blob_ptr_ {nullptr};
+  std::string blob_table_;
+  std::string blob_column_;
+  std::unordered_map<std::string, SqliteStatement> statement_cache_;
 };
 
 
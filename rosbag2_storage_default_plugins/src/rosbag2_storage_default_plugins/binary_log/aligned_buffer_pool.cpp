@@ -0,0 +1,108 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aligned_buffer_pool.hpp"
+
+#ifdef _WIN32
+# include <malloc.h>
+#endif
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+/**
+ * Free buffers aligned to blocks. Heap allocated and never destroyed, so buffers can be released
+ * during static destruction.
+ */
+class AlignedBufferPool
+{
+public:
+  static AlignedBufferPool & get_instance()
+  {
+    static auto instance = new AlignedBufferPool();
+    return *instance;
+  }
+
+  uint8_t * acquire()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_buffers_.empty()) {
+        const auto buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+        return buffer;
+      }
+    }
+#ifdef _WIN32
+    const auto buffer = _aligned_malloc(ALIGNED_BUFFER_SIZE, BLOCK_SIZE);
+#else
+    void * buffer = nullptr;
+    if (posix_memalign(&buffer, BLOCK_SIZE, ALIGNED_BUFFER_SIZE) != 0) {
+      buffer = nullptr;
+    }
+#endif
+    if (!buffer) {
+      throw std::bad_alloc();
+    }
+    return static_cast<uint8_t *>(buffer);
+  }
+
+  void release(uint8_t * buffer)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_buffers_.size() < MAX_FREE_BUFFERS) {
+        free_buffers_.push_back(buffer);
+        return;
+      }
+    }
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    std::free(buffer);
+#endif
+  }
+
+private:
+  // Enough for the writes in flight of a few bags recorded at once, more buffers are freed.
+  static constexpr size_t MAX_FREE_BUFFERS = 32;
+
+  std::mutex mutex_;
+  std::vector<uint8_t *> free_buffers_;
+};
+
+constexpr size_t AlignedBufferPool::MAX_FREE_BUFFERS;
+}  // namespace
+
+void AlignedBufferDeleter::operator()(uint8_t * buffer) const
+{
+  AlignedBufferPool::get_instance().release(buffer);
+}
+
+AlignedBuffer acquire_aligned_buffer()
+{
+  return AlignedBuffer(AlignedBufferPool::get_instance().acquire());
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
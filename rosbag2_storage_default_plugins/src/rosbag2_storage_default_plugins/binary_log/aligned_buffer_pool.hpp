@@ -0,0 +1,50 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__ALIGNED_BUFFER_POOL_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__ALIGNED_BUFFER_POOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+// Direct I/O requires file offsets, sizes and memory aligned to blocks.
+constexpr size_t BLOCK_SIZE = 4096;
+constexpr size_t ALIGNED_BUFFER_SIZE = 4 * 1024 * 1024;
+
+struct AlignedBufferDeleter
+{
+  /// Returns the buffer to the pool.
+  void operator()(uint8_t * buffer) const;
+};
+
+/// A buffer of ALIGNED_BUFFER_SIZE bytes aligned to BLOCK_SIZE.
+using AlignedBuffer = std::unique_ptr<uint8_t, AlignedBufferDeleter>;
+
+/**
+ * Takes a buffer from a pool shared by all writers of the process, so buffers are not allocated
+ * again for every split of a bag.
+ * \throws std::bad_alloc if a new buffer cannot be allocated.
+ */
+AlignedBuffer acquire_aligned_buffer();
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__ALIGNED_BUFFER_POOL_HPP_
@@ -0,0 +1,165 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "binary_log_format.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../crc32c.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+std::array<uint32_t, 256> make_crc32_table()
+{
+  std::array<uint32_t, 256> table;
+  for (uint32_t i = 0; i < table.size(); ++i) {
+    uint32_t value = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      value = (value & 1u) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+    }
+    table[i] = value;
+  }
+  return table;
+}
+}  // namespace
+
+void BufferWriter::write_uint8(uint8_t value)
+{
+  buffer_.push_back(value);
+}
+
+void BufferWriter::write_uint32(uint32_t value)
+{
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buffer_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void BufferWriter::write_uint64(uint64_t value)
+{
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buffer_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void BufferWriter::write_int64(int64_t value)
+{
+  write_uint64(static_cast<uint64_t>(value));
+}
+
+void BufferWriter::write_string(const std::string & value)
+{
+  if (value.size() > MAX_FIELD_SIZE) {
+    throw std::runtime_error("String is too long for a binary log record.");
+  }
+  write_uint32(static_cast<uint32_t>(value.size()));
+  write_bytes(value.data(), value.size());
+}
+
+void BufferWriter::write_bytes(const void * data, size_t size)
+{
+  if (size > 0) {
+    const auto position = buffer_.size();
+    buffer_.resize(position + size);
+    std::memcpy(buffer_.data() + position, data, size);
+  }
+}
+
+void BufferWriter::overwrite_uint32(size_t position, uint32_t value)
+{
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buffer_.at(position + i) = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint8_t BufferReader::read_uint8()
+{
+  check_remaining(sizeof(uint8_t));
+  return data_[position_++];
+}
+
+uint32_t BufferReader::read_uint32()
+{
+  check_remaining(sizeof(uint32_t));
+  uint32_t value = 0;
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    value |= static_cast<uint32_t>(data_[position_++]) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t BufferReader::read_uint64()
+{
+  check_remaining(sizeof(uint64_t));
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    value |= static_cast<uint64_t>(data_[position_++]) << (8 * i);
+  }
+  return value;
+}
+
+int64_t BufferReader::read_int64()
+{
+  return static_cast<int64_t>(read_uint64());
+}
+
+std::string BufferReader::read_string()
+{
+  const auto size = read_uint32();
+  const auto data = read_bytes(size);
+  return std::string(reinterpret_cast<const char *>(data), size);
+}
+
+const uint8_t * BufferReader::read_bytes(size_t size)
+{
+  check_remaining(size);
+  const auto data = data_ + position_;
+  position_ += size;
+  return data;
+}
+
+void BufferReader::check_remaining(size_t size) const
+{
+  if (size > size_ - position_) {
+    throw std::runtime_error("Binary log record is truncated.");
+  }
+}
+
+uint32_t update_crc32(uint32_t crc, const uint8_t * data, size_t size)
+{
+  static const auto table = make_crc32_table();
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+uint32_t update_chunk_crc(uint32_t format_version, uint32_t crc, const uint8_t * data, size_t size)
+{
+  return format_version <= CRC32_FORMAT_VERSION ?
+         update_crc32(crc, data, size) : update_crc32c(crc, data, size);
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
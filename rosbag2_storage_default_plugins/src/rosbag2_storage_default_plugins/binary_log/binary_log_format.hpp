@@ -0,0 +1,157 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__BINARY_LOG_FORMAT_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__BINARY_LOG_FORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A binary log file is a file header followed by records, all integers in little endian:
+//
+//   file header:  8 byte FILE_MAGIC, uint32 version, uint32 reserved
+//   record:       uint8 opcode, uint64 body length, body
+//
+// TOPIC          uint32 topic id, string name, string type, string serialization format,
+//                string offered QoS profiles (strings are a uint32 length and the characters)
+// TOPIC_REMOVED  uint32 topic id
+// CHUNK          int64 first and last time stamp, int64 first and last publish time stamp,
+//                uint32 message count, uint32 CRC-32C of the messages, messages
+//                (uint32 topic id, int64 time stamp, int64 publish time stamp,
+//                uint32 data length, data)
+// CHUNK_INDEX    uint64 file offset of the chunk record, uint32 entry count, entries sorted by
+//                time stamp (uint32 topic id, int64 time stamp, int64 publish time stamp,
+//                uint64 offset of the message in the chunk body)
+// SUMMARY        uint32 topic count, topics (TOPIC body, uint8 removed, uint64 message count,
+//                int64 first and last time stamp), uint32 chunk count, chunks (uint64 file
+//                offset of the chunk and of its index, CHUNK header fields up to the count,
+//                uint32 topic id count, topic ids)
+// FOOTER         uint64 file offset of the summary record, 8 byte FOOTER_MAGIC
+//
+// Files of version 1 have the CRC-32 (as used by zlib) of the messages in their chunks instead.
+//
+// Every chunk record is directly followed by its index record. The summary and the footer are
+// written when the file is closed, files without them are recovered by scanning the records.
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+constexpr const char FILE_MAGIC[] = "RB2BLOG\n";
+constexpr const char FOOTER_MAGIC[] = "RB2BEND\n";
+constexpr const size_t MAGIC_SIZE = 8;
+constexpr const uint32_t FORMAT_VERSION = 2;
+// Last version whose chunks have the CRC-32 of their messages instead of the CRC-32C.
+constexpr const uint32_t CRC32_FORMAT_VERSION = 1;
+constexpr const size_t FILE_HEADER_SIZE = MAGIC_SIZE + 2 * sizeof(uint32_t);
+
+constexpr const size_t RECORD_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint64_t);
+constexpr const size_t CHUNK_HEADER_SIZE = 4 * sizeof(int64_t) + 2 * sizeof(uint32_t);
+constexpr const size_t MESSAGE_HEADER_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(int64_t);
+constexpr const size_t INDEX_ENTRY_SIZE = sizeof(uint32_t) + 2 * sizeof(int64_t) +
+  sizeof(uint64_t);
+constexpr const size_t FOOTER_BODY_SIZE = sizeof(uint64_t) + MAGIC_SIZE;
+constexpr const size_t FOOTER_SIZE = RECORD_HEADER_SIZE + FOOTER_BODY_SIZE;
+// Serialized data and strings are stored with a uint32 length, so larger ones are rejected.
+constexpr const uint64_t MAX_FIELD_SIZE = UINT32_MAX;
+
+enum class Opcode : uint8_t
+{
+  TOPIC = 1,
+  TOPIC_REMOVED = 2,
+  CHUNK = 3,
+  CHUNK_INDEX = 4,
+  SUMMARY = 5,
+  FOOTER = 6
+};
+
+/// Appends little endian values to a buffer.
+class BufferWriter
+{
+public:
+  explicit BufferWriter(std::vector<uint8_t> & buffer)
+  : buffer_(buffer) {}
+
+  void write_uint8(uint8_t value);
+
+  void write_uint32(uint32_t value);
+
+  void write_uint64(uint64_t value);
+
+  void write_int64(int64_t value);
+
+  /// \throws std::runtime_error if the string is longer than MAX_FIELD_SIZE.
+  void write_string(const std::string & value);
+
+  void write_bytes(const void * data, size_t size);
+
+  /// Overwrites a uint32 written before at the given position of the buffer.
+  void overwrite_uint32(size_t position, uint32_t value);
+
+private:
+  std::vector<uint8_t> & buffer_;
+};
+
+/// Reads little endian values from a buffer.
+class BufferReader
+{
+public:
+  BufferReader(const uint8_t * data, size_t size)
+  : data_(data), size_(size) {}
+
+  /// \throws std::runtime_error for all reads if the buffer is too short.
+  uint8_t read_uint8();
+
+  uint32_t read_uint32();
+
+  uint64_t read_uint64();
+
+  int64_t read_int64();
+
+  std::string read_string();
+
+  /// Returns a pointer to the next size bytes and skips them.
+  const uint8_t * read_bytes(size_t size);
+
+  size_t get_position() const
+  {
+    return position_;
+  }
+
+  size_t get_remaining() const
+  {
+    return size_ - position_;
+  }
+
+private:
+  void check_remaining(size_t size) const;
+
+  const uint8_t * data_;
+  size_t size_;
+  size_t position_ {0};
+};
+
+/// Continues the CRC-32 (as used by zlib) of the data preceding this data.
+uint32_t update_crc32(uint32_t crc, const uint8_t * data, size_t size);
+
+/// Continues the checksum of chunks of the given format version.
+uint32_t update_chunk_crc(uint32_t format_version, uint32_t crc, const uint8_t * data, size_t size);
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__BINARY_LOG_FORMAT_HPP_
@@ -0,0 +1,1471 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage_default_plugins/binary_log/binary_log_storage.hpp"
+
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include "binary_log_format.hpp"
+#include "direct_file_writer.hpp"
+#include "mapped_file.hpp"
+#include "remote_file.hpp"
+#include "stream_sink.hpp"
+#include "write_queue.hpp"
+#include "../file_writeback.hpp"
+#include "../logging.hpp"
+
+namespace
+{
+constexpr const auto FILE_EXTENSION = ".binlog";
+
+// A file holds at least its header and a chunk of a few messages.
+constexpr const uint64_t MIN_SPLIT_FILE_SIZE = 4096;
+// Bytes of the next chunks downloaded ahead of reading a remote file.
+constexpr const uint64_t REMOTE_READ_AHEAD_BYTES = 64 * 1024 * 1024;
+
+struct ChunkLimits
+{
+  uint64_t max_messages;
+  uint64_t max_bytes;
+  std::chrono::milliseconds max_duration;
+};
+
+ChunkLimits get_chunk_limits(const rosbag2_storage::StorageConfig & storage_config)
+{
+  if (storage_config.transaction_max_messages > 0 || storage_config.transaction_max_bytes > 0 ||
+    storage_config.transaction_max_duration.count() > 0)
+  {
+    return {
+      storage_config.transaction_max_messages,
+      storage_config.transaction_max_bytes,
+      storage_config.transaction_max_duration};
+  }
+  if (storage_config.preset_profile.empty()) {
+    return {0, 4 * 1024 * 1024, std::chrono::milliseconds(0)};
+  }
+  if (storage_config.preset_profile == "resilient") {
+    return {0, 64 * 1024, std::chrono::milliseconds(100)};
+  }
+  if (storage_config.preset_profile == "max_throughput" ||
+    storage_config.preset_profile == "direct_io")
+  {
+    return {0, 32 * 1024 * 1024, std::chrono::milliseconds(0)};
+  }
+  throw std::runtime_error(
+          "Unknown binary_log storage preset profile '" + storage_config.preset_profile + "'.");
+}
+
+void seek_file(std::FILE * file, uint64_t offset)
+{
+#ifdef _WIN32
+  const auto result = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+  const auto result = fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  if (result != 0) {
+    throw std::runtime_error("Failed to seek in binary log.");
+  }
+}
+
+// Name of the file on the ingest server, the bag folder and the file name.
+std::string get_stream_name(const std::string & path)
+{
+  const rcpputils::fs::path file_path(path);
+  const auto folder = file_path.parent_path().filename().string();
+  const auto file_name = file_path.filename().string();
+  return folder.empty() || folder == "." || folder == ".." ? file_name : folder + "/" + file_name;
+}
+
+std::unique_ptr<rosbag2_storage_plugins::binary_log::DirectFileWriter> make_direct_file_writer(
+  const std::string & path, uint64_t size)
+{
+  try {
+    return std::make_unique<rosbag2_storage_plugins::binary_log::DirectFileWriter>(path, size);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+      "Writing binary log '" << path << "' without direct I/O: " << e.what());
+    return nullptr;
+  }
+}
+}  // namespace
+
+namespace rosbag2_storage_plugins
+{
+
+using binary_log::BufferReader;
+using binary_log::BufferWriter;
+using binary_log::Opcode;
+
+BinaryLogStorage::BinaryLogStorage() = default;
+
+BinaryLogStorage::~BinaryLogStorage()
+{
+  close();
+}
+
+void BinaryLogStorage::open(
+  const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag)
+{
+  open(uri, io_flag, rosbag2_storage::StorageConfig{});
+}
+
+void BinaryLogStorage::open(
+  const std::string & uri,
+  rosbag2_storage::storage_interfaces::IOFlag io_flag,
+  const rosbag2_storage::StorageConfig & storage_config)
+{
+  const auto chunk_limits = get_chunk_limits(storage_config);
+  const bool use_direct_io = storage_config.preset_profile == "direct_io";
+  close();
+
+  topics_.clear();
+  topic_ids_.clear();
+  topic_ids_by_handle_.clear();
+  chunks_.clear();
+  chunk_body_.clear();
+  chunk_entries_.clear();
+  chunk_crc_ = 0;
+  chunk_max_messages_ = chunk_limits.max_messages;
+  chunk_max_bytes_ = chunk_limits.max_bytes;
+  chunk_max_duration_ = chunk_limits.max_duration;
+  is_reading_prepared_ = false;
+  loaded_chunks_.clear();
+
+  if (io_flag == rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE) {
+    relative_path_ = uri + FILE_EXTENSION;
+
+    // READ_WRITE requires the file to not exist.
+    if (rcpputils::fs::path(relative_path_).exists()) {
+      throw std::runtime_error(
+              "Failed to create bag: File '" + relative_path_ + "' already exists!");
+    }
+    if (!storage_config.stream_address.empty()) {
+      stream_sink_ = std::make_unique<binary_log::StreamSink>(
+        storage_config.stream_address, get_stream_name(relative_path_), relative_path_,
+        storage_config.stream_max_memory_bytes);
+    } else {
+      file_ = std::fopen(relative_path_.c_str(), "w+b");
+      if (!file_) {
+        throw std::runtime_error("Failed to create bag: Cannot open '" + relative_path_ + "'.");
+      }
+      if (storage_config.preallocate_size > 0 || storage_config.writeback_interval_bytes > 0) {
+        file_writeback_ = std::make_unique<FileWriteback>(
+          relative_path_, storage_config.preallocate_size,
+          storage_config.writeback_interval_bytes);
+      }
+    }
+    is_writable_ = true;
+    file_size_ = 0;
+    format_version_ = binary_log::FORMAT_VERSION;
+    is_file_position_at_end_ = true;
+    if (use_direct_io && !stream_sink_) {
+      direct_file_writer_ = make_direct_file_writer(relative_path_, 0);
+    }
+
+    std::vector<uint8_t> header;
+    BufferWriter writer(header);
+    writer.write_bytes(binary_log::FILE_MAGIC, binary_log::MAGIC_SIZE);
+    writer.write_uint32(binary_log::FORMAT_VERSION);
+    writer.write_uint32(0);
+    write_raw(header.data(), header.size());
+  } else if (binary_log::RemoteFile::is_remote(uri)) {
+    relative_path_ = uri;
+    if (io_flag != rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY) {
+      throw std::runtime_error("Failed to open bag: Remote file '" + uri + "' is read only.");
+    }
+    remote_file_ = std::make_unique<binary_log::RemoteFile>(uri);
+    try {
+      load_file();
+    } catch (const std::runtime_error &) {
+      remote_file_.reset();
+      throw;
+    }
+  } else {  // APPEND and READ_ONLY
+    relative_path_ = uri;
+
+    // APPEND and READ_ONLY require the file to exist.
+    if (!rcpputils::fs::path(relative_path_).exists()) {
+      throw std::runtime_error(
+              "Failed to read from bag: File '" + relative_path_ + "' does not exist!");
+    }
+    is_writable_ = io_flag == rosbag2_storage::storage_interfaces::IOFlag::APPEND;
+    file_ = std::fopen(relative_path_.c_str(), is_writable_ ? "r+b" : "rb");
+    if (!file_) {
+      throw std::runtime_error("Failed to read from bag: Cannot open '" + relative_path_ + "'.");
+    }
+    is_file_position_at_end_ = false;
+
+    try {
+      load_file();
+      if (is_writable_) {
+        // New records replace the summary, or the incomplete records of a crashed recording.
+        truncate_file(file_size_);
+        if (use_direct_io) {
+          direct_file_writer_ = make_direct_file_writer(relative_path_, file_size_);
+        }
+      }
+    } catch (const std::runtime_error &) {
+      std::fclose(file_);
+      file_ = nullptr;
+      throw;
+    }
+
+    if (!is_writable_) {
+      try {
+        mapped_file_ = std::make_shared<binary_log::MappedFile>(
+          file_, rcpputils::fs::path(relative_path_).file_size());
+      } catch (const std::runtime_error & e) {
+        ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM(
+          "Reading binary log '" << relative_path_ << "' without mapping it: " << e.what());
+      }
+    }
+  }
+
+  ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+    "Opened binary log '" << relative_path_ << "' for " <<
+    (io_flag == rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY ? "reading" : "writing") <<
+    (stream_sink_ ? " to " + storage_config.stream_address : "") << ".");
+}
+
+void BinaryLogStorage::close()
+{
+  if (!file_ && !stream_sink_ && !remote_file_) {
+    return;
+  }
+  if (is_writable_) {
+    try {
+      write_chunk();
+      write_summary();
+    } catch (const std::runtime_error & e) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+        "Failed to close binary log '" << relative_path_ << "': " << e.what() <<
+          ". It will be recovered when opened.");
+    }
+  }
+  // Messages read before keep the mapping alive.
+  mapped_file_.reset();
+  loaded_chunks_.clear();
+  if (direct_file_writer_) {
+    const auto & write_queue = direct_file_writer_->get_write_queue();
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+      "Write latencies of binary log '" << relative_path_ << "' with " <<
+      (write_queue.is_asynchronous() ? "io_uring" : "pwrite") << ": " <<
+        write_queue.get_latency_histogram().to_string() << ".");
+    direct_file_writer_.reset();
+  }
+  if (stream_sink_) {
+    stream_sink_->close();
+    stream_sink_.reset();
+  } else if (remote_file_) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM(
+      "Read remote binary log '" << relative_path_ << "' with " <<
+        remote_file_->get_request_count() << " range requests.");
+    remote_file_.reset();
+  } else {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+  file_writeback_.reset();
+  is_writable_ = false;
+}
+
+void BinaryLogStorage::load_file()
+{
+  const auto file_size = get_file_size();
+  if (file_size < binary_log::FILE_HEADER_SIZE) {
+    throw std::runtime_error("Failed to read from bag: '" + relative_path_ + "' is too short.");
+  }
+  const auto header = read_raw(0, binary_log::FILE_HEADER_SIZE);
+  BufferReader reader(header.data(), header.size());
+  if (std::memcmp(
+      reader.read_bytes(binary_log::MAGIC_SIZE), binary_log::FILE_MAGIC,
+      binary_log::MAGIC_SIZE) != 0)
+  {
+    throw std::runtime_error(
+            "Failed to read from bag: '" + relative_path_ + "' is not a binary log.");
+  }
+  const auto version = reader.read_uint32();
+  if (version > binary_log::FORMAT_VERSION) {
+    throw std::runtime_error(
+            "Failed to read from bag: '" + relative_path_ + "' has the newer format version " +
+            std::to_string(version) + ".");
+  }
+  // Chunks appended to the file keep the checksum of its version.
+  format_version_ = version;
+
+  if (!read_summary(file_size)) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+      "Binary log '" << relative_path_ << "' was not closed properly. Recovering its chunks.");
+    topics_.clear();
+    topic_ids_.clear();
+    chunks_.clear();
+    recover(file_size);
+  }
+}
+
+bool BinaryLogStorage::read_summary(uint64_t file_size)
+{
+  if (file_size < binary_log::FILE_HEADER_SIZE + binary_log::FOOTER_SIZE) {
+    return false;
+  }
+  file_size_ = file_size - binary_log::FOOTER_SIZE;
+  try {
+    const auto footer = read_record(file_size_, static_cast<uint8_t>(Opcode::FOOTER));
+    BufferReader footer_reader(footer.data(), footer.size());
+    const auto summary_offset = footer_reader.read_uint64();
+    if (footer.size() != binary_log::FOOTER_BODY_SIZE ||
+      std::memcmp(
+        footer_reader.read_bytes(binary_log::MAGIC_SIZE), binary_log::FOOTER_MAGIC,
+        binary_log::MAGIC_SIZE) != 0 ||
+      summary_offset < binary_log::FILE_HEADER_SIZE || summary_offset >= file_size_)
+    {
+      return false;
+    }
+
+    const auto summary = read_record(summary_offset, static_cast<uint8_t>(Opcode::SUMMARY));
+    BufferReader reader(summary.data(), summary.size());
+    const auto topic_count = reader.read_uint32();
+    for (uint32_t i = 0; i < topic_count; ++i) {
+      if (reader.read_uint32() != i) {
+        return false;
+      }
+      Topic topic;
+      topic.metadata.name = reader.read_string();
+      topic.metadata.type = reader.read_string();
+      topic.metadata.serialization_format = reader.read_string();
+      topic.metadata.offered_qos_profiles = reader.read_string();
+      topic.removed = reader.read_uint8() != 0;
+      topic.message_count = reader.read_uint64();
+      topic.min_timestamp = reader.read_int64();
+      topic.max_timestamp = reader.read_int64();
+      if (!topic.removed) {
+        topic_ids_[topic.metadata.name] = i;
+      }
+      topics_.push_back(std::move(topic));
+    }
+    const auto chunk_count = reader.read_uint32();
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+      Chunk chunk;
+      chunk.offset = reader.read_uint64();
+      chunk.index_offset = reader.read_uint64();
+      chunk.min_timestamp = reader.read_int64();
+      chunk.max_timestamp = reader.read_int64();
+      chunk.min_publish_timestamp = reader.read_int64();
+      chunk.max_publish_timestamp = reader.read_int64();
+      chunk.message_count = reader.read_uint32();
+      const auto topic_id_count = reader.read_uint32();
+      for (uint32_t j = 0; j < topic_id_count; ++j) {
+        chunk.topic_ids.push_back(reader.read_uint32());
+      }
+      chunks_.push_back(std::move(chunk));
+    }
+    file_size_ = summary_offset;
+    return true;
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+}
+
+void BinaryLogStorage::recover(uint64_t file_size)
+{
+  uint64_t position = binary_log::FILE_HEADER_SIZE;
+  uint64_t valid_end = position;
+  // A chunk whose index is not read yet, and the end of its record.
+  bool has_pending_chunk = false;
+  Chunk pending_chunk {};
+  uint64_t pending_chunk_end = 0;
+
+  // Only the index of the last chunk can be missing, rebuilds it from the messages.
+  const auto add_pending_chunk_without_index = [&]() {
+      has_pending_chunk = false;
+      const auto body = read_record(pending_chunk.offset, static_cast<uint8_t>(Opcode::CHUNK));
+      add_chunk(pending_chunk, read_chunk_index(pending_chunk, body));
+      valid_end = pending_chunk_end;
+    };
+
+  while (file_size - position >= binary_log::RECORD_HEADER_SIZE) {
+    const auto header = read_raw(position, binary_log::RECORD_HEADER_SIZE);
+    BufferReader header_reader(header.data(), header.size());
+    const auto opcode = static_cast<Opcode>(header_reader.read_uint8());
+    const auto length = header_reader.read_uint64();
+    if (length > file_size - position - binary_log::RECORD_HEADER_SIZE) {
+      break;
+    }
+    const auto record_end = position + binary_log::RECORD_HEADER_SIZE + length;
+
+    try {
+      if (has_pending_chunk && opcode != Opcode::CHUNK_INDEX) {
+        add_pending_chunk_without_index();
+      }
+      switch (opcode) {
+        case Opcode::TOPIC: {
+            const auto body = read_record(position, static_cast<uint8_t>(opcode));
+            BufferReader reader(body.data(), body.size());
+            if (reader.read_uint32() != topics_.size()) {
+              throw std::runtime_error("Unexpected topic id.");
+            }
+            Topic topic {{}, false, 0, 0, 0};
+            topic.metadata.name = reader.read_string();
+            topic.metadata.type = reader.read_string();
+            topic.metadata.serialization_format = reader.read_string();
+            topic.metadata.offered_qos_profiles = reader.read_string();
+            topic_ids_[topic.metadata.name] = static_cast<uint32_t>(topics_.size());
+            topics_.push_back(std::move(topic));
+            break;
+          }
+        case Opcode::TOPIC_REMOVED: {
+            const auto body = read_record(position, static_cast<uint8_t>(opcode));
+            BufferReader reader(body.data(), body.size());
+            const auto topic_id = reader.read_uint32();
+            if (topic_id >= topics_.size()) {
+              throw std::runtime_error("Unknown topic id.");
+            }
+            auto & topic = topics_[topic_id];
+            topic.removed = true;
+            topic_ids_.erase(topic.metadata.name);
+            break;
+          }
+        case Opcode::CHUNK: {
+            if (length < binary_log::CHUNK_HEADER_SIZE) {
+              throw std::runtime_error("Chunk is too short.");
+            }
+            const auto chunk_header = read_raw(
+              position + binary_log::RECORD_HEADER_SIZE, binary_log::CHUNK_HEADER_SIZE);
+            BufferReader reader(chunk_header.data(), chunk_header.size());
+            pending_chunk = Chunk {};
+            pending_chunk.offset = position;
+            read_chunk_header(reader, pending_chunk);
+            pending_chunk_end = record_end;
+            has_pending_chunk = true;
+            break;
+          }
+        case Opcode::CHUNK_INDEX: {
+            if (!has_pending_chunk) {
+              throw std::runtime_error("Chunk index without chunk.");
+            }
+            pending_chunk.index_offset = position;
+            add_chunk(pending_chunk, read_chunk_index(pending_chunk, RecordBody {}));
+            has_pending_chunk = false;
+            break;
+          }
+        case Opcode::SUMMARY:
+        case Opcode::FOOTER:
+          // Summaries of earlier sessions of appended files.
+          break;
+        default:
+          throw std::runtime_error("Unknown record.");
+      }
+    } catch (const std::runtime_error & e) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+        "Dropping the records of binary log '" << relative_path_ << "' from offset " <<
+          position << ": " << e.what());
+      has_pending_chunk = false;
+      break;
+    }
+
+    position = record_end;
+    if (!has_pending_chunk) {
+      valid_end = record_end;
+    }
+  }
+
+  if (has_pending_chunk) {
+    try {
+      add_pending_chunk_without_index();
+    } catch (const std::runtime_error & e) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+        "Dropping the last chunk of binary log '" << relative_path_ << "': " << e.what());
+    }
+  }
+  file_size_ = valid_end;
+}
+
+void BinaryLogStorage::read_chunk_header(BufferReader & reader, Chunk & chunk)
+{
+  chunk.min_timestamp = reader.read_int64();
+  chunk.max_timestamp = reader.read_int64();
+  chunk.min_publish_timestamp = reader.read_int64();
+  chunk.max_publish_timestamp = reader.read_int64();
+  chunk.message_count = reader.read_uint32();
+}
+
+void BinaryLogStorage::add_chunk(Chunk chunk, const std::vector<IndexEntry> & entries)
+{
+  for (const auto & entry : entries) {
+    auto & topic = topics_[entry.topic_id];
+    topic.min_timestamp = topic.message_count == 0 ?
+      entry.time_stamp : std::min(topic.min_timestamp, entry.time_stamp);
+    topic.max_timestamp = topic.message_count == 0 ?
+      entry.time_stamp : std::max(topic.max_timestamp, entry.time_stamp);
+    ++topic.message_count;
+    chunk.topic_ids.push_back(entry.topic_id);
+  }
+  std::sort(chunk.topic_ids.begin(), chunk.topic_ids.end());
+  chunk.topic_ids.erase(
+    std::unique(chunk.topic_ids.begin(), chunk.topic_ids.end()), chunk.topic_ids.end());
+  chunks_.push_back(std::move(chunk));
+}
+
+void BinaryLogStorage::truncate_file(uint64_t size)
+{
+  if (std::fflush(file_) != 0) {
+    throw std::runtime_error("Failed to flush binary log '" + relative_path_ + "'.");
+  }
+#ifdef _WIN32
+  const auto result = _chsize_s(_fileno(file_), static_cast<__int64>(size));
+#else
+  const auto result = ftruncate(fileno(file_), static_cast<off_t>(size));
+#endif
+  if (result != 0) {
+    throw std::runtime_error("Failed to truncate binary log '" + relative_path_ + "'.");
+  }
+  is_file_position_at_end_ = false;
+}
+
+void BinaryLogStorage::write_raw(const void * data, size_t size)
+{
+  if (stream_sink_) {
+    stream_sink_->write(data, size);
+    file_size_ += size;
+    return;
+  }
+  if (direct_file_writer_) {
+    direct_file_writer_->write(data, size);
+    file_size_ += size;
+    return;
+  }
+  if (!is_file_position_at_end_) {
+    seek_file(file_, file_size_);
+    is_file_position_at_end_ = true;
+  }
+  if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+    throw std::runtime_error("Failed to write to binary log '" + relative_path_ + "'.");
+  }
+  file_size_ += size;
+}
+
+void BinaryLogStorage::flush_file()
+{
+  if (stream_sink_) {
+    // The data is sent as soon as it is written.
+    return;
+  }
+  if (direct_file_writer_) {
+    direct_file_writer_->flush();
+  } else if (std::fflush(file_) != 0) {
+    throw std::runtime_error("Failed to flush binary log '" + relative_path_ + "'.");
+  }
+  if (file_writeback_) {
+    file_writeback_->update();
+  }
+}
+
+void BinaryLogStorage::write_record(Opcode opcode, const std::vector<uint8_t> & body)
+{
+  std::vector<uint8_t> header;
+  BufferWriter writer(header);
+  writer.write_uint8(static_cast<uint8_t>(opcode));
+  writer.write_uint64(body.size());
+  write_raw(header.data(), header.size());
+  write_raw(body.data(), body.size());
+}
+
+void BinaryLogStorage::write_topic(BufferWriter & writer, uint32_t topic_id) const
+{
+  const auto & metadata = topics_[topic_id].metadata;
+  writer.write_uint32(topic_id);
+  writer.write_string(metadata.name);
+  writer.write_string(metadata.type);
+  writer.write_string(metadata.serialization_format);
+  writer.write_string(metadata.offered_qos_profiles);
+}
+
+void BinaryLogStorage::write_chunk()
+{
+  if (chunk_entries_.empty()) {
+    return;
+  }
+
+  chunk_.offset = file_size_;
+  chunk_.message_count = static_cast<uint32_t>(chunk_entries_.size());
+  std::vector<uint8_t> header;
+  BufferWriter writer(header);
+  writer.write_uint8(static_cast<uint8_t>(Opcode::CHUNK));
+  writer.write_uint64(binary_log::CHUNK_HEADER_SIZE + chunk_body_.size());
+  writer.write_int64(chunk_.min_timestamp);
+  writer.write_int64(chunk_.max_timestamp);
+  writer.write_int64(chunk_.min_publish_timestamp);
+  writer.write_int64(chunk_.max_publish_timestamp);
+  writer.write_uint32(chunk_.message_count);
+  writer.write_uint32(chunk_crc_);
+  write_raw(header.data(), header.size());
+  write_raw(chunk_body_.data(), chunk_body_.size());
+
+  std::stable_sort(
+    chunk_entries_.begin(), chunk_entries_.end(),
+    [](const IndexEntry & lhs, const IndexEntry & rhs) {
+      return lhs.time_stamp < rhs.time_stamp;
+    });
+  for (const auto & entry : chunk_entries_) {
+    chunk_.topic_ids.push_back(entry.topic_id);
+  }
+  chunk_.index_offset = write_chunk_index(chunk_.offset, chunk_entries_);
+  // Hands the complete chunk to the operating system, so it survives a crash of the process.
+  flush_file();
+
+  std::sort(chunk_.topic_ids.begin(), chunk_.topic_ids.end());
+  chunk_.topic_ids.erase(
+    std::unique(chunk_.topic_ids.begin(), chunk_.topic_ids.end()), chunk_.topic_ids.end());
+  chunks_.push_back(std::move(chunk_));
+  chunk_ = Chunk {};
+  chunk_body_.clear();
+  chunk_entries_.clear();
+  chunk_crc_ = 0;
+}
+
+uint64_t BinaryLogStorage::write_chunk_index(
+  uint64_t chunk_offset, const std::vector<IndexEntry> & entries)
+{
+  std::vector<uint8_t> index;
+  index.reserve(sizeof(uint64_t) + sizeof(uint32_t) +
+    entries.size() * binary_log::INDEX_ENTRY_SIZE);
+  BufferWriter index_writer(index);
+  index_writer.write_uint64(chunk_offset);
+  index_writer.write_uint32(static_cast<uint32_t>(entries.size()));
+  for (const auto & entry : entries) {
+    index_writer.write_uint32(entry.topic_id);
+    index_writer.write_int64(entry.time_stamp);
+    index_writer.write_int64(entry.publish_time_stamp);
+    index_writer.write_uint64(entry.offset);
+  }
+  const auto index_offset = file_size_;
+  write_record(Opcode::CHUNK_INDEX, index);
+  return index_offset;
+}
+
+void BinaryLogStorage::write_summary()
+{
+  std::vector<uint8_t> summary;
+  BufferWriter writer(summary);
+  writer.write_uint32(static_cast<uint32_t>(topics_.size()));
+  for (uint32_t topic_id = 0; topic_id < topics_.size(); ++topic_id) {
+    const auto & topic = topics_[topic_id];
+    write_topic(writer, topic_id);
+    writer.write_uint8(topic.removed ? 1 : 0);
+    writer.write_uint64(topic.message_count);
+    writer.write_int64(topic.min_timestamp);
+    writer.write_int64(topic.max_timestamp);
+  }
+  writer.write_uint32(static_cast<uint32_t>(chunks_.size()));
+  for (const auto & chunk : chunks_) {
+    writer.write_uint64(chunk.offset);
+    writer.write_uint64(chunk.index_offset);
+    writer.write_int64(chunk.min_timestamp);
+    writer.write_int64(chunk.max_timestamp);
+    writer.write_int64(chunk.min_publish_timestamp);
+    writer.write_int64(chunk.max_publish_timestamp);
+    writer.write_uint32(chunk.message_count);
+    writer.write_uint32(static_cast<uint32_t>(chunk.topic_ids.size()));
+    for (const auto topic_id : chunk.topic_ids) {
+      writer.write_uint32(topic_id);
+    }
+  }
+
+  const auto summary_offset = file_size_;
+  write_record(Opcode::SUMMARY, summary);
+  std::vector<uint8_t> footer;
+  BufferWriter footer_writer(footer);
+  footer_writer.write_uint64(summary_offset);
+  footer_writer.write_bytes(binary_log::FOOTER_MAGIC, binary_log::MAGIC_SIZE);
+  write_record(Opcode::FOOTER, footer);
+  flush_file();
+}
+
+void BinaryLogStorage::create_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  if (topic_ids_.find(topic.name) != topic_ids_.end()) {
+    return;
+  }
+  const auto topic_id = static_cast<uint32_t>(topics_.size());
+  topics_.push_back({topic, false, 0, 0, 0});
+  topic_ids_.emplace(topic.name, topic_id);
+  if (is_writable_) {
+    // Written right away, so it precedes every chunk with messages of the topic.
+    std::vector<uint8_t> body;
+    BufferWriter writer(body);
+    write_topic(writer, topic_id);
+    write_record(Opcode::TOPIC, body);
+  }
+}
+
+void BinaryLogStorage::set_topic_handle(
+  const std::string & topic_name, rosbag2_storage::TopicHandle handle)
+{
+  const auto topic_id = topic_ids_.find(topic_name);
+  if (handle < 0 || topic_id == topic_ids_.end()) {
+    return;
+  }
+  const auto index = static_cast<size_t>(handle);
+  if (index >= topic_ids_by_handle_.size()) {
+    topic_ids_by_handle_.resize(index + 1, -1);
+  }
+  topic_ids_by_handle_[index] = topic_id->second;
+}
+
+void BinaryLogStorage::remove_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  const auto topic_id = topic_ids_.find(topic.name);
+  if (topic_id == topic_ids_.end()) {
+    return;
+  }
+  topics_[topic_id->second].removed = true;
+  if (is_writable_) {
+    std::vector<uint8_t> body;
+    BufferWriter writer(body);
+    writer.write_uint32(topic_id->second);
+    write_record(Opcode::TOPIC_REMOVED, body);
+  }
+  topic_ids_.erase(topic_id);
+}
+
+uint32_t BinaryLogStorage::get_topic_id(const rosbag2_storage::SerializedBagMessage & message)
+const
+{
+  const auto handle = message.topic_handle;
+  if (handle >= 0 && static_cast<size_t>(handle) < topic_ids_by_handle_.size()) {
+    const auto topic_id = topic_ids_by_handle_[static_cast<size_t>(handle)];
+    if (topic_id >= 0 && !topics_[static_cast<size_t>(topic_id)].removed) {
+      return static_cast<uint32_t>(topic_id);
+    }
+  }
+
+  const auto topic_id = topic_ids_.find(message.topic_name);
+  if (topic_id == topic_ids_.end()) {
+    throw std::runtime_error(
+            "Topic '" + message.topic_name +
+            "' has not been created yet! Call 'create_topic' first.");
+  }
+  return topic_id->second;
+}
+
+void BinaryLogStorage::write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
+{
+  if (!is_writable_) {
+    throw std::runtime_error("Binary log '" + relative_path_ + "' is not open for writing.");
+  }
+
+  const auto topic_id = get_topic_id(*message);
+  // Messages without publish time stamp are ordered by their receive time.
+  const auto publish_time_stamp =
+    message->publish_time_stamp != 0 ? message->publish_time_stamp : message->time_stamp;
+  const auto & data = message->serialized_data;
+  append_message(
+    topic_id, message->time_stamp, publish_time_stamp, data ? data->buffer : nullptr,
+    data ? data->buffer_length : 0);
+}
+
+void BinaryLogStorage::append_message(
+  uint32_t topic_id, rcutils_time_point_value_t time_stamp,
+  rcutils_time_point_value_t publish_time_stamp, const uint8_t * data, size_t data_size)
+{
+  if (data_size > binary_log::MAX_FIELD_SIZE) {
+    throw std::runtime_error(
+            "Message of " + std::to_string(data_size) + " bytes exceeds the maximum size of " +
+            std::to_string(binary_log::MAX_FIELD_SIZE) + " bytes of the binary_log storage.");
+  }
+
+  if (chunk_entries_.empty()) {
+    chunk_.min_timestamp = time_stamp;
+    chunk_.max_timestamp = time_stamp;
+    chunk_.min_publish_timestamp = publish_time_stamp;
+    chunk_.max_publish_timestamp = publish_time_stamp;
+    chunk_start_time_ = std::chrono::steady_clock::now();
+  } else {
+    chunk_.min_timestamp = std::min(chunk_.min_timestamp, time_stamp);
+    chunk_.max_timestamp = std::max(chunk_.max_timestamp, time_stamp);
+    chunk_.min_publish_timestamp = std::min(chunk_.min_publish_timestamp, publish_time_stamp);
+    chunk_.max_publish_timestamp = std::max(chunk_.max_publish_timestamp, publish_time_stamp);
+  }
+
+  const auto message_position = chunk_body_.size();
+  BufferWriter writer(chunk_body_);
+  writer.write_uint32(topic_id);
+  writer.write_int64(time_stamp);
+  writer.write_int64(publish_time_stamp);
+  writer.write_uint32(static_cast<uint32_t>(data_size));
+  if (data_size > 0) {
+    writer.write_bytes(data, data_size);
+  }
+  chunk_crc_ = binary_log::update_chunk_crc(
+    format_version_, chunk_crc_, chunk_body_.data() + message_position,
+    chunk_body_.size() - message_position);
+  chunk_entries_.push_back(
+    {topic_id, time_stamp, publish_time_stamp,
+      binary_log::CHUNK_HEADER_SIZE + message_position});
+
+  auto & topic = topics_[topic_id];
+  topic.min_timestamp = topic.message_count == 0 ?
+    time_stamp : std::min(topic.min_timestamp, time_stamp);
+  topic.max_timestamp = topic.message_count == 0 ?
+    time_stamp : std::max(topic.max_timestamp, time_stamp);
+  ++topic.message_count;
+
+  if (is_chunk_limit_reached()) {
+    write_chunk();
+  }
+}
+
+void BinaryLogStorage::write(
+  const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
+{
+  for (const auto & message : messages) {
+    write(message);
+  }
+}
+
+bool BinaryLogStorage::is_chunk_limit_reached() const
+{
+  // The duration is only checked on writes, a chunk is never written from another thread.
+  if (chunk_max_messages_ > 0 && chunk_entries_.size() >= chunk_max_messages_) {
+    return true;
+  }
+  if (chunk_max_bytes_ > 0 && chunk_body_.size() >= chunk_max_bytes_) {
+    return true;
+  }
+  return chunk_max_duration_.count() > 0 &&
+         std::chrono::steady_clock::now() - chunk_start_time_ >= chunk_max_duration_;
+}
+
+uint64_t BinaryLogStorage::get_file_size() const
+{
+  if (mapped_file_) {
+    return mapped_file_->size();
+  }
+  if (remote_file_) {
+    return remote_file_->size();
+  }
+  return rcpputils::fs::path(relative_path_).file_size();
+}
+
+std::vector<uint8_t> BinaryLogStorage::read_raw(uint64_t offset, size_t size) const
+{
+  if (remote_file_) {
+    return remote_file_->read(offset, size);
+  }
+  is_file_position_at_end_ = false;
+  seek_file(file_, offset);
+  std::vector<uint8_t> data(size);
+  if (size > 0 && std::fread(data.data(), 1, size, file_) != size) {
+    throw std::runtime_error("Failed to read from binary log '" + relative_path_ + "'.");
+  }
+  return data;
+}
+
+BinaryLogStorage::RecordBody BinaryLogStorage::read_record(
+  uint64_t offset, uint8_t expected_opcode) const
+{
+  const auto file_size = get_file_size();
+  if (offset > file_size || file_size - offset < binary_log::RECORD_HEADER_SIZE) {
+    throw std::runtime_error(
+            "Truncated record at offset " + std::to_string(offset) + " of binary log '" +
+            relative_path_ + "'.");
+  }
+  RecordBody body {nullptr, 0, {}};
+  if (!mapped_file_) {
+    body.copied_data = read_raw(offset, binary_log::RECORD_HEADER_SIZE);
+  }
+  BufferReader reader(
+    mapped_file_ ? mapped_file_->data() + offset : body.copied_data.data(),
+    binary_log::RECORD_HEADER_SIZE);
+  const auto opcode = reader.read_uint8();
+  const auto length = reader.read_uint64();
+  if (opcode != expected_opcode) {
+    throw std::runtime_error(
+            "Unexpected record at offset " + std::to_string(offset) + " of binary log '" +
+            relative_path_ + "'.");
+  }
+  if (length > file_size - offset - binary_log::RECORD_HEADER_SIZE) {
+    throw std::runtime_error(
+            "Truncated record at offset " + std::to_string(offset) + " of binary log '" +
+            relative_path_ + "'.");
+  }
+
+  if (mapped_file_) {
+    body.mapped_data = mapped_file_->data() + offset + binary_log::RECORD_HEADER_SIZE;
+    body.mapped_size = static_cast<size_t>(length);
+  } else {
+    body.copied_data = read_raw(
+      offset + binary_log::RECORD_HEADER_SIZE, static_cast<size_t>(length));
+  }
+  return body;
+}
+
+std::vector<BinaryLogStorage::IndexEntry> BinaryLogStorage::read_chunk_index(
+  const Chunk & chunk, const RecordBody & chunk_body) const
+{
+  std::vector<IndexEntry> entries;
+  entries.reserve(chunk.message_count);
+
+  if (chunk.index_offset != 0) {
+    const auto index = read_record(chunk.index_offset, static_cast<uint8_t>(Opcode::CHUNK_INDEX));
+    BufferReader reader(index.data(), index.size());
+    if (reader.read_uint64() != chunk.offset) {
+      throw std::runtime_error("Chunk index belongs to another chunk.");
+    }
+    const auto entry_count = reader.read_uint32();
+    for (uint32_t i = 0; i < entry_count; ++i) {
+      IndexEntry entry;
+      entry.topic_id = reader.read_uint32();
+      entry.time_stamp = reader.read_int64();
+      entry.publish_time_stamp = reader.read_int64();
+      entry.offset = reader.read_uint64();
+      entries.push_back(entry);
+    }
+  } else {
+    verify_chunk(chunk_body);
+    BufferReader reader(chunk_body.data(), chunk_body.size());
+    reader.read_bytes(binary_log::CHUNK_HEADER_SIZE);
+    while (reader.get_remaining() > 0) {
+      IndexEntry entry;
+      entry.offset = reader.get_position();
+      entry.topic_id = reader.read_uint32();
+      entry.time_stamp = reader.read_int64();
+      entry.publish_time_stamp = reader.read_int64();
+      reader.read_bytes(reader.read_uint32());
+      entries.push_back(entry);
+    }
+    std::stable_sort(
+      entries.begin(), entries.end(), [](const IndexEntry & lhs, const IndexEntry & rhs) {
+        return lhs.time_stamp < rhs.time_stamp;
+      });
+  }
+
+  for (const auto & entry : entries) {
+    if (entry.topic_id >= topics_.size()) {
+      throw std::runtime_error("Chunk has messages of an unknown topic.");
+    }
+  }
+  return entries;
+}
+
+void BinaryLogStorage::verify_chunk(const RecordBody & chunk_body) const
+{
+  BufferReader reader(chunk_body.data(), chunk_body.size());
+  Chunk chunk;
+  read_chunk_header(reader, chunk);
+  const auto crc = reader.read_uint32();
+  if (binary_log::update_chunk_crc(
+      format_version_, 0, chunk_body.data() + binary_log::CHUNK_HEADER_SIZE,
+      chunk_body.size() - binary_log::CHUNK_HEADER_SIZE) != crc)
+  {
+    throw std::runtime_error("Chunk is corrupt.");
+  }
+}
+
+bool BinaryLogStorage::has_next()
+{
+  if (!is_reading_prepared_) {
+    prepare_for_reading();
+  }
+  load_chunks();
+  return !loaded_chunks_.empty();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> BinaryLogStorage::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("No more messages in binary log '" + relative_path_ + "'.");
+  }
+
+  std::vector<LoadedChunk> read_chunks;
+  const auto view = take_next_message(read_chunks);
+  const auto data = view.serialized_data.data;
+  const auto data_size = view.serialized_data.size;
+
+  auto bag_message = message_pool_ ?
+    message_pool_->make_message() : std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  if (mapped_file_ && data_size > 0) {
+    bag_message->serialized_data =
+      binary_log::make_serialized_data_view(mapped_file_, data, data_size);
+  } else {
+    bag_message->serialized_data = message_pool_ ?
+      message_pool_->make_empty_serialized_message(data_size) :
+      rosbag2_storage::make_empty_serialized_message(data_size);
+    if (data_size > 0) {
+      std::memcpy(bag_message->serialized_data->buffer, data, data_size);
+    }
+    bag_message->serialized_data->buffer_length = data_size;
+  }
+  bag_message->time_stamp = view.time_stamp;
+  bag_message->topic_name = *view.topic_name;
+  bag_message->publish_time_stamp = view.publish_time_stamp;
+  return bag_message;
+}
+
+bool BinaryLogStorage::visit_next_batch(
+  const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+  size_t max_messages, size_t max_bytes)
+{
+  std::vector<rosbag2_storage::SerializedBagMessageView> views;
+  std::vector<LoadedChunk> read_chunks;
+  size_t bytes = 0;
+  while ((max_messages == 0 || views.size() < max_messages) &&
+    (max_bytes == 0 || bytes < max_bytes) && has_next())
+  {
+    views.push_back(take_next_message(read_chunks));
+    bytes += views.back().serialized_data.size;
+  }
+  if (views.empty()) {
+    return false;
+  }
+  callback(views);
+  return true;
+}
+
+rosbag2_storage::SerializedBagMessageView BinaryLogStorage::take_next_message(
+  std::vector<LoadedChunk> & read_chunks)
+{
+  // The chunks overlap in time only if messages were written out of time stamp order.
+  auto next_chunk = loaded_chunks_.begin();
+  for (auto loaded_chunk = loaded_chunks_.begin(); loaded_chunk != loaded_chunks_.end();
+    ++loaded_chunk)
+  {
+    if (get_order_timestamp(loaded_chunk->entries[loaded_chunk->next_entry]) <
+      get_order_timestamp(next_chunk->entries[next_chunk->next_entry]))
+    {
+      next_chunk = loaded_chunk;
+    }
+  }
+  const auto & entry = next_chunk->entries[next_chunk->next_entry++];
+
+  BufferReader reader(next_chunk->body.data(), next_chunk->body.size());
+  reader.read_bytes(static_cast<size_t>(entry.offset));
+  const auto topic_id = reader.read_uint32();
+  rosbag2_storage::SerializedBagMessageView view;
+  view.time_stamp = reader.read_int64();
+  view.publish_time_stamp = reader.read_int64();
+  view.serialized_data.size = reader.read_uint32();
+  view.serialized_data.data = reader.read_bytes(view.serialized_data.size);
+  view.topic_name = &topics_.at(topic_id).metadata.name;
+
+  if (next_chunk->next_entry == next_chunk->entries.size()) {
+    // Copied data keeps its address when the chunk is moved.
+    read_chunks.push_back(std::move(*next_chunk));
+    loaded_chunks_.erase(next_chunk);
+  }
+  return view;
+}
+
+void BinaryLogStorage::prepare_for_reading()
+{
+  // The topics passing the filter by name, regex or type are resolved once, so chunks and
+  // messages are selected by topic id.
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter_);
+  selects_all_topics_ = topic_filter.selects_all_topics();
+  is_selected_topic_.assign(topics_.size(), false);
+  topic_time_ranges_.assign(topics_.size(), {});
+  for (size_t topic_id = 0; topic_id < topics_.size(); ++topic_id) {
+    is_selected_topic_[topic_id] =
+      topic_filter.is_selected(topics_[topic_id].metadata.name, topics_[topic_id].metadata.type);
+    topic_time_ranges_[topic_id] = topic_filter.get_time_ranges(topics_[topic_id].metadata.name);
+  }
+
+  if (stream_sink_) {
+    throw std::runtime_error(
+            "Cannot read binary log '" + relative_path_ + "' while it is streamed.");
+  }
+  if (is_writable_) {
+    write_chunk();
+  }
+
+  chunks_to_read_.clear();
+  for (size_t chunk_number = 0; chunk_number < chunks_.size(); ++chunk_number) {
+    if (is_selected(chunks_[chunk_number])) {
+      chunks_to_read_.push_back(chunk_number);
+    }
+  }
+  const bool by_publish_time = storage_filter_.order_by_publish_time;
+  std::stable_sort(
+    chunks_to_read_.begin(), chunks_to_read_.end(),
+    [this, by_publish_time](size_t lhs, size_t rhs) {
+      return by_publish_time ?
+      chunks_[lhs].min_publish_timestamp < chunks_[rhs].min_publish_timestamp :
+      chunks_[lhs].min_timestamp < chunks_[rhs].min_timestamp;
+    });
+  next_chunk_to_read_ = 0;
+  next_chunk_to_prefetch_ = 0;
+  loaded_chunks_.clear();
+  is_reading_prepared_ = true;
+
+  if (mapped_file_) {
+    // Reading all topics streams through the file, a selection of topics skips chunks.
+    mapped_file_->advise(
+      selects_all_topics_ ?
+      binary_log::MappedFile::AccessPattern::SEQUENTIAL :
+      binary_log::MappedFile::AccessPattern::NORMAL);
+  }
+}
+
+rcutils_time_point_value_t BinaryLogStorage::get_read_start_time() const
+{
+  return std::max(seek_time_, storage_filter_.start_time);
+}
+
+rcutils_time_point_value_t BinaryLogStorage::get_order_timestamp(const IndexEntry & entry) const
+{
+  return storage_filter_.order_by_publish_time ? entry.publish_time_stamp : entry.time_stamp;
+}
+
+bool BinaryLogStorage::is_selected_topic(uint32_t topic_id) const
+{
+  return topic_id < is_selected_topic_.size() && is_selected_topic_[topic_id];
+}
+
+bool BinaryLogStorage::is_selected(const Chunk & chunk) const
+{
+  const auto min_timestamp = storage_filter_.order_by_publish_time ?
+    chunk.min_publish_timestamp : chunk.min_timestamp;
+  const auto max_timestamp = storage_filter_.order_by_publish_time ?
+    chunk.max_publish_timestamp : chunk.max_timestamp;
+  const auto start_time = get_read_start_time();
+  if ((start_time > 0 && max_timestamp < start_time) ||
+    (storage_filter_.end_time > 0 && min_timestamp > storage_filter_.end_time))
+  {
+    return false;
+  }
+  // Chunks are skipped if none of their selected topics has a time range overlapping them.
+  for (const auto topic_id : chunk.topic_ids) {
+    if (is_selected_topic(topic_id) &&
+      rosbag2_storage::TopicFilter::overlaps(
+        topic_time_ranges_[topic_id], min_timestamp, max_timestamp))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BinaryLogStorage::is_selected(const IndexEntry & entry) const
+{
+  const auto timestamp = get_order_timestamp(entry);
+  const auto start_time = get_read_start_time();
+  return (start_time <= 0 || timestamp >= start_time) &&
+         (storage_filter_.end_time <= 0 || timestamp <= storage_filter_.end_time) &&
+         is_selected_topic(entry.topic_id) &&
+         rosbag2_storage::TopicFilter::is_within(topic_time_ranges_[entry.topic_id], timestamp);
+}
+
+void BinaryLogStorage::load_chunks()
+{
+  // Loads every chunk which starts before the next message of the loaded chunks, so messages
+  // written out of time stamp order are merged into order.
+  if (remote_file_) {
+    prefetch_remote_chunks();
+  }
+  while (next_chunk_to_read_ < chunks_to_read_.size()) {
+    const auto & chunk = chunks_[chunks_to_read_[next_chunk_to_read_]];
+    const auto chunk_start = storage_filter_.order_by_publish_time ?
+      chunk.min_publish_timestamp : chunk.min_timestamp;
+    if (!loaded_chunks_.empty()) {
+      auto next_timestamp = INT64_MAX;
+      for (const auto & loaded_chunk : loaded_chunks_) {
+        next_timestamp = std::min(
+          next_timestamp, get_order_timestamp(loaded_chunk.entries[loaded_chunk.next_entry]));
+      }
+      if (chunk_start > next_timestamp) {
+        return;
+      }
+    }
+    load_chunk(chunks_to_read_[next_chunk_to_read_++]);
+
+    // Reads the next chunk ahead while this one is played.
+    if (mapped_file_ && next_chunk_to_read_ < chunks_to_read_.size()) {
+      const auto & next_chunk = chunks_[chunks_to_read_[next_chunk_to_read_]];
+      if (next_chunk.index_offset > next_chunk.offset) {
+        mapped_file_->will_need(next_chunk.offset, next_chunk.index_offset - next_chunk.offset);
+      }
+    }
+    if (remote_file_) {
+      prefetch_remote_chunks();
+    }
+  }
+}
+
+void BinaryLogStorage::prefetch_remote_chunks()
+{
+  // Downloads the chunks to read next along with their indices, which directly follow them, up
+  // to REMOTE_READ_AHEAD_BYTES ahead. Chunks skipped by the filter are not downloaded at all.
+  const auto get_chunk_size = [](const Chunk & chunk) -> uint64_t {
+      return chunk.index_offset > chunk.offset ?
+             chunk.index_offset - chunk.offset + binary_log::RECORD_HEADER_SIZE +
+             sizeof(uint64_t) + sizeof(uint32_t) +
+             uint64_t{chunk.message_count} * binary_log::INDEX_ENTRY_SIZE :
+             0u;
+    };
+  next_chunk_to_prefetch_ = std::max(next_chunk_to_prefetch_, next_chunk_to_read_);
+  uint64_t read_ahead_bytes = 0;
+  for (auto i = next_chunk_to_read_; i < next_chunk_to_prefetch_; ++i) {
+    read_ahead_bytes += get_chunk_size(chunks_[chunks_to_read_[i]]);
+  }
+  while (next_chunk_to_prefetch_ < chunks_to_read_.size() &&
+    read_ahead_bytes < REMOTE_READ_AHEAD_BYTES)
+  {
+    const auto & chunk = chunks_[chunks_to_read_[next_chunk_to_prefetch_++]];
+    const auto chunk_size = get_chunk_size(chunk);
+    remote_file_->prefetch(chunk.offset, chunk_size);
+    read_ahead_bytes += chunk_size;
+  }
+}
+
+void BinaryLogStorage::load_chunk(size_t chunk_number)
+{
+  const auto & chunk = chunks_[chunk_number];
+  LoadedChunk loaded_chunk;
+  loaded_chunk.chunk_number = chunk_number;
+  loaded_chunk.body = read_record(chunk.offset, static_cast<uint8_t>(Opcode::CHUNK));
+  if (chunk.index_offset != 0) {
+    verify_chunk(loaded_chunk.body);
+  }
+  for (const auto & entry : read_chunk_index(chunk, loaded_chunk.body)) {
+    if (is_selected(entry)) {
+      loaded_chunk.entries.push_back(entry);
+    }
+  }
+  if (loaded_chunk.entries.empty()) {
+    return;
+  }
+  if (storage_filter_.order_by_publish_time) {
+    std::stable_sort(
+      loaded_chunk.entries.begin(), loaded_chunk.entries.end(),
+      [](const IndexEntry & lhs, const IndexEntry & rhs) {
+        return lhs.publish_time_stamp < rhs.publish_time_stamp;
+      });
+  }
+  loaded_chunk.next_entry = 0;
+  loaded_chunks_.push_back(std::move(loaded_chunk));
+}
+
+std::vector<rosbag2_storage::TopicMetadata> BinaryLogStorage::get_all_topics_and_types()
+{
+  std::vector<rosbag2_storage::TopicMetadata> topics_and_types;
+  for (const auto & topic : topics_) {
+    if (!topic.removed) {
+      topics_and_types.push_back(topic.metadata);
+    }
+  }
+  return topics_and_types;
+}
+
+rosbag2_storage::BagMetadata BinaryLogStorage::get_metadata()
+{
+  rosbag2_storage::BagMetadata metadata;
+  metadata.storage_identifier = get_storage_identifier();
+  metadata.relative_file_paths = {get_relative_file_path()};
+  metadata.message_count = 0;
+  metadata.topics_with_message_count = {};
+
+  rcutils_time_point_value_t min_time = INT64_MAX;
+  rcutils_time_point_value_t max_time = 0;
+  for (const auto & topic : topics_) {
+    if (topic.removed || topic.message_count == 0) {
+      continue;
+    }
+    metadata.topics_with_message_count.push_back(
+      {topic.metadata, static_cast<size_t>(topic.message_count)});
+    metadata.message_count += topic.message_count;
+    min_time = std::min(min_time, topic.min_timestamp);
+    max_time = std::max(max_time, topic.max_timestamp);
+  }
+  std::sort(
+    metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+    [](const rosbag2_storage::TopicInformation & lhs,
+    const rosbag2_storage::TopicInformation & rhs) {
+      return lhs.topic_metadata.name < rhs.topic_metadata.name;
+    });
+
+  if (metadata.message_count == 0) {
+    min_time = 0;
+    max_time = 0;
+  }
+
+  metadata.starting_time =
+    std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(min_time));
+  metadata.duration = std::chrono::nanoseconds(max_time) - std::chrono::nanoseconds(min_time);
+  metadata.bag_size = get_bagfile_size();
+
+  return metadata;
+}
+
+std::string BinaryLogStorage::get_relative_file_path() const
+{
+  return relative_path_;
+}
+
+uint64_t BinaryLogStorage::get_bagfile_size() const
+{
+  if (is_writable_) {
+    // Includes the chunk being filled, which is written before the file is split.
+    return file_size_ + chunk_body_.size();
+  }
+  if (remote_file_) {
+    return remote_file_->size();
+  }
+  const auto bag_path = rcpputils::fs::path{get_relative_file_path()};
+  return bag_path.exists() ? bag_path.file_size() : 0u;
+}
+
+std::string BinaryLogStorage::get_storage_identifier() const
+{
+  return "binary_log";
+}
+
+rosbag2_storage::StorageCapabilities BinaryLogStorage::get_capabilities() const
+{
+  rosbag2_storage::StorageCapabilities capabilities;
+  capabilities.seek = true;
+  capabilities.message_pool = true;
+  return capabilities;
+}
+
+uint64_t BinaryLogStorage::get_minimum_split_file_size() const
+{
+  return MIN_SPLIT_FILE_SIZE;
+}
+
+void BinaryLogStorage::set_filter(const rosbag2_storage::StorageFilter & storage_filter)
+{
+  storage_filter_ = storage_filter;
+  is_reading_prepared_ = false;
+}
+
+void BinaryLogStorage::reset_filter()
+{
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  is_reading_prepared_ = false;
+}
+
+void BinaryLogStorage::seek(const rcutils_time_point_value_t & timestamp)
+{
+  seek_time_ = timestamp;
+  is_reading_prepared_ = false;
+}
+
+void BinaryLogStorage::set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool)
+{
+  message_pool_ = std::move(message_pool);
+}
+
+std::string BinaryLogStorage::slice(
+  const std::string & uri, const rcutils_time_point_value_t & start_time,
+  const rcutils_time_point_value_t & end_time)
+{
+  if (stream_sink_) {
+    throw std::runtime_error(
+            "Binary log '" + relative_path_ + "' is streamed and cannot be sliced.");
+  }
+  if (is_writable_) {
+    write_chunk();
+  }
+
+  BinaryLogStorage slice;
+  slice.open(uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+  // Topics are created in the order of their ids, and removed right away like they were
+  // before a topic of the same name was created again, so the copied chunks keep their ids.
+  for (const auto & topic : topics_) {
+    slice.create_topic(topic.metadata);
+    if (topic.removed) {
+      slice.remove_topic(topic.metadata);
+    }
+  }
+
+  for (const auto & chunk : chunks_) {
+    if (chunk.max_timestamp < start_time || chunk.min_timestamp > end_time) {
+      continue;
+    }
+    const auto body = read_record(chunk.offset, static_cast<uint8_t>(Opcode::CHUNK));
+    const auto entries = read_chunk_index(chunk, body);
+    if (chunk.min_timestamp < start_time || chunk.max_timestamp > end_time) {
+      // Of the chunks at the ends of the time range, only the messages within it are appended.
+      for (const auto & entry : entries) {
+        if (entry.time_stamp < start_time || entry.time_stamp > end_time) {
+          continue;
+        }
+        BufferReader reader(body.data() + entry.offset, body.size() - entry.offset);
+        reader.read_bytes(sizeof(uint32_t) + 2 * sizeof(int64_t));
+        const auto data_size = reader.read_uint32();
+        slice.append_message(
+          entry.topic_id, entry.time_stamp, entry.publish_time_stamp,
+          reader.read_bytes(data_size), data_size);
+      }
+      continue;
+    }
+
+    // Chunks within the time range are copied as a whole, with their index.
+    slice.write_chunk();
+    Chunk copied_chunk = chunk;
+    copied_chunk.offset = slice.file_size_;
+    copied_chunk.topic_ids.clear();
+    std::vector<uint8_t> record;
+    BufferWriter writer(record);
+    writer.write_uint8(static_cast<uint8_t>(Opcode::CHUNK));
+    writer.write_uint64(body.size());
+    if (format_version_ == slice.format_version_) {
+      slice.write_raw(record.data(), record.size());
+      slice.write_raw(body.data(), body.size());
+    } else {
+      // The chunks of older files have another checksum, which is verified and replaced.
+      verify_chunk(body);
+      writer.write_bytes(body.data(), body.size());
+      writer.overwrite_uint32(
+        binary_log::RECORD_HEADER_SIZE + binary_log::CHUNK_HEADER_SIZE - sizeof(uint32_t),
+        binary_log::update_chunk_crc(
+          slice.format_version_, 0, body.data() + binary_log::CHUNK_HEADER_SIZE,
+          body.size() - binary_log::CHUNK_HEADER_SIZE));
+      slice.write_raw(record.data(), record.size());
+    }
+    copied_chunk.index_offset = slice.write_chunk_index(copied_chunk.offset, entries);
+    slice.add_chunk(std::move(copied_chunk), entries);
+  }
+  slice.write_chunk();
+  slice.flush_file();
+  // The summary is written when the slice is closed.
+  return slice.get_relative_file_path();
+}
+
+}  // namespace rosbag2_storage_plugins
+
+#include "pluginlib/class_list_macros.hpp"  // NOLINT
+PLUGINLIB_EXPORT_CLASS(
+  rosbag2_storage_plugins::BinaryLogStorage,
+  rosbag2_storage::storage_interfaces::ReadWriteInterface)
@@ -0,0 +1,145 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "direct_file_writer.hpp"
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "aligned_buffer_pool.hpp"
+#include "write_queue.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+std::runtime_error make_error(const std::string & message)
+{
+  return std::runtime_error(message + ": " + std::strerror(errno));
+}
+}  // namespace
+
+constexpr size_t DirectFileWriter::WRITE_QUEUE_DEPTH;
+
+DirectFileWriter::DirectFileWriter(const std::string & path, uint64_t size)
+{
+#if defined(_WIN32) || !(defined(O_DIRECT) || defined(F_NOCACHE))
+  (void) path;
+  (void) size;
+  throw std::runtime_error("Direct I/O is not supported on this platform.");
+#else
+# ifdef O_DIRECT
+  file_descriptor_ = ::open(path.c_str(), O_RDWR | O_DIRECT | O_CLOEXEC);
+# else
+  // macOS has no O_DIRECT, the page cache is bypassed per file descriptor instead.
+  file_descriptor_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (file_descriptor_ >= 0 && fcntl(file_descriptor_, F_NOCACHE, 1) != 0) {
+    ::close(file_descriptor_);
+    file_descriptor_ = -1;
+  }
+# endif
+  if (file_descriptor_ < 0) {
+    throw make_error("Failed to open file for direct I/O");
+  }
+
+  buffer_ = acquire_aligned_buffer();
+  // The partial last block is written again with the data appended to it.
+  buffer_offset_ = size - size % BLOCK_SIZE;
+  buffer_size_ = static_cast<size_t>(size - buffer_offset_);
+  if (buffer_size_ > 0) {
+    const auto result = pread(
+      file_descriptor_, buffer_.get(), BLOCK_SIZE, static_cast<off_t>(buffer_offset_));
+    if (result < 0 || static_cast<size_t>(result) < buffer_size_) {
+      const auto error = make_error("Failed to read the end of the file for direct I/O");
+      ::close(file_descriptor_);
+      throw error;
+    }
+  }
+  write_queue_ = std::make_unique<WriteQueue>(file_descriptor_, WRITE_QUEUE_DEPTH);
+#endif
+}
+
+DirectFileWriter::~DirectFileWriter()
+{
+  // Waits for the writes in flight before the file is closed.
+  write_queue_.reset();
+#ifndef _WIN32
+  ::close(file_descriptor_);
+#endif
+}
+
+void DirectFileWriter::write(const void * data, size_t size)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    const auto copied_size = std::min(size, ALIGNED_BUFFER_SIZE - buffer_size_);
+    std::memcpy(buffer_.get() + buffer_size_, bytes, copied_size);
+    buffer_size_ += copied_size;
+    bytes += copied_size;
+    size -= copied_size;
+    if (buffer_size_ == ALIGNED_BUFFER_SIZE) {
+      auto next_buffer = acquire_aligned_buffer();
+      write_queue_->push(std::move(buffer_), ALIGNED_BUFFER_SIZE, buffer_offset_);
+      buffer_ = std::move(next_buffer);
+      buffer_offset_ += ALIGNED_BUFFER_SIZE;
+      buffer_size_ = 0;
+    }
+  }
+  // The buffers filled by one write are submitted at once.
+  write_queue_->submit();
+}
+
+void DirectFileWriter::flush()
+{
+  if (buffer_size_ > 0) {
+    // Only the partial last block is kept to be written again.
+    const auto full_blocks_size = buffer_size_ - buffer_size_ % BLOCK_SIZE;
+    const auto padding = (BLOCK_SIZE - buffer_size_ % BLOCK_SIZE) % BLOCK_SIZE;
+    auto next_buffer = acquire_aligned_buffer();
+    std::memcpy(
+      next_buffer.get(), buffer_.get() + full_blocks_size, buffer_size_ - full_blocks_size);
+    std::memset(buffer_.get() + buffer_size_, 0, padding);
+    write_queue_->push(std::move(buffer_), buffer_size_ + padding, buffer_offset_);
+    buffer_ = std::move(next_buffer);
+    const auto file_size = buffer_offset_ + buffer_size_;
+    buffer_offset_ += full_blocks_size;
+    buffer_size_ -= full_blocks_size;
+
+    write_queue_->wait();
+#ifndef _WIN32
+    if (padding > 0 && ftruncate(file_descriptor_, static_cast<off_t>(file_size)) != 0) {
+      throw make_error("Failed to truncate file written with direct I/O");
+    }
+#endif
+  } else {
+    write_queue_->wait();
+  }
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
@@ -0,0 +1,82 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__DIRECT_FILE_WRITER_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__DIRECT_FILE_WRITER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "aligned_buffer_pool.hpp"
+#include "write_queue.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+/**
+ * Appends to a file with direct I/O, bypassing the page cache, so writing large amounts of data
+ * neither evicts the pages of other processes nor stalls when the kernel writes them back.
+ *
+ * The data is staged in aligned buffers, and full buffers are handed to a write queue which
+ * keeps several of them in flight. The last partial block is padded on flush and cut off by
+ * truncating the file, it is written again with the data appended to it.
+ */
+class DirectFileWriter
+{
+public:
+  // Writes in flight, i.e. up to 32 MiB, enough to keep fast drives busy.
+  static constexpr size_t WRITE_QUEUE_DEPTH = 8;
+
+  /**
+   * Opens the existing file to append to it at the given size.
+   * \throws std::runtime_error if the platform or the file system does not support direct I/O.
+   */
+  DirectFileWriter(const std::string & path, uint64_t size);
+
+  ~DirectFileWriter();
+
+  DirectFileWriter(const DirectFileWriter &) = delete;
+  DirectFileWriter & operator=(const DirectFileWriter &) = delete;
+
+  /// \throws std::runtime_error if writing fails.
+  void write(const void * data, size_t size);
+
+  /**
+   * Writes all data staged so far to the file and waits until it is written.
+   * \throws std::runtime_error if writing fails.
+   */
+  void flush();
+
+  const WriteQueue & get_write_queue() const
+  {
+    return *write_queue_;
+  }
+
+private:
+  int file_descriptor_ {-1};
+  std::unique_ptr<WriteQueue> write_queue_;
+  AlignedBuffer buffer_;
+  // Offset of the buffer in the file, always aligned to blocks.
+  uint64_t buffer_offset_ {0};
+  size_t buffer_size_ {0};
+};
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__DIRECT_FILE_WRITER_HPP_
@@ -0,0 +1,311 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage_default_plugins/binary_log/ingest_server.hpp"
+
+#ifndef _WIN32
+# include <netinet/in.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/types.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "binary_log_format.hpp"
+#include "stream_protocol.hpp"
+#include "../logging.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+constexpr const int ACCEPT_POLL_INTERVAL_MS = 100;
+
+std::runtime_error make_error(const std::string & message)
+{
+  return std::runtime_error(message + ": " + std::strerror(errno));
+}
+
+// Stream names are relative paths below the root directory, e.g. "my_bag/my_bag_0.binlog".
+bool is_valid_stream_name(const std::string & name)
+{
+  if (name.empty() || name.find('\\') != std::string::npos || name.find('\0') !=
+    std::string::npos)
+  {
+    return false;
+  }
+  std::istringstream components(name);
+  std::string component;
+  while (std::getline(components, component, '/')) {
+    if (component.empty() || component == "." || component == "..") {
+      return false;
+    }
+  }
+  return name.back() != '/';
+}
+
+bool send_ack(int socket, uint64_t size)
+{
+  std::vector<uint8_t> ack;
+  BufferWriter writer(ack);
+  writer.write_uint64(size);
+  return send_all(socket, ack.data(), ack.size());
+}
+}  // namespace
+
+IngestServer::IngestServer(uint16_t port, const std::string & root_directory)
+: root_directory_(root_directory)
+{
+#ifdef _WIN32
+  (void) port;
+  throw std::runtime_error("Ingesting binary logs is not supported on this platform.");
+#else
+  listening_socket_ = ::socket(AF_INET6, SOCK_STREAM, 0);
+  if (listening_socket_ < 0) {
+    throw make_error("Failed to create ingest server socket");
+  }
+  // Accepts IPv4 connections as well, and listening again right after a restart.
+  int enabled = 1;
+  int disabled = 0;
+  setsockopt(listening_socket_, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+  setsockopt(listening_socket_, IPPROTO_IPV6, IPV6_V6ONLY, &disabled, sizeof(disabled));
+  sockaddr_in6 address {};
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  socklen_t address_size = sizeof(address);
+  if (::bind(listening_socket_, reinterpret_cast<sockaddr *>(&address), address_size) != 0 ||
+    ::listen(listening_socket_, SOMAXCONN) != 0 ||
+    getsockname(listening_socket_, reinterpret_cast<sockaddr *>(&address), &address_size) != 0)
+  {
+    const auto error = make_error("Failed to listen on port " + std::to_string(port));
+    close_socket(listening_socket_);
+    throw error;
+  }
+  port_ = ntohs(address.sin6_port);
+  accept_thread_ = std::thread(&IngestServer::accept_connections, this);
+  ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+    "Ingesting binary logs on port " << port_ << " into '" << root_directory_ << "'.");
+#endif
+}
+
+IngestServer::~IngestServer()
+{
+  stop();
+}
+
+uint16_t IngestServer::get_port() const
+{
+  return port_;
+}
+
+void IngestServer::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_stopped_) {
+      return;
+    }
+    is_stopped_ = true;
+  }
+  if (accept_thread_.joinable()) {
+    accept_thread_.join();
+  }
+  close_socket(listening_socket_);
+  listening_socket_ = -1;
+#ifndef _WIN32
+  {
+    // Wakes connection threads waiting for data.
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto socket : connection_sockets_) {
+      shutdown(socket, SHUT_RDWR);
+    }
+  }
+#endif
+  for (auto & thread : connection_threads_) {
+    thread.join();
+  }
+  connection_threads_.clear();
+  finished_connection_threads_.clear();
+}
+
+void IngestServer::accept_connections()
+{
+#ifndef _WIN32
+  while (true) {
+    pollfd descriptor {};
+    descriptor.fd = listening_socket_;
+    descriptor.events = POLLIN;
+    const auto ready = ::poll(&descriptor, 1, ACCEPT_POLL_INTERVAL_MS);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_stopped_) {
+      return;
+    }
+    if (ready != 1) {
+      continue;
+    }
+    const auto socket = ::accept(listening_socket_, nullptr, nullptr);
+    if (socket < 0) {
+      continue;
+    }
+    join_finished_connection_threads();
+    connection_sockets_.insert(socket);
+    connection_threads_.emplace_back(&IngestServer::serve_connection, this, socket);
+  }
+#endif
+}
+
+void IngestServer::join_finished_connection_threads()
+{
+  for (const auto & thread_id : finished_connection_threads_) {
+    const auto thread = std::find_if(
+      connection_threads_.begin(), connection_threads_.end(),
+      [&thread_id](const std::thread & thread) {return thread.get_id() == thread_id;});
+    if (thread != connection_threads_.end()) {
+      // The thread only returns after marking itself finished.
+      thread->join();
+      connection_threads_.erase(thread);
+    }
+  }
+  finished_connection_threads_.clear();
+}
+
+void IngestServer::serve_connection(int socket)
+{
+  // A malformed stream only ends its own connection.
+  try {
+    receive_stream(socket);
+  } catch (const std::exception & e) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Failed to receive binary log stream: " << e.what());
+  } catch (...) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Failed to receive binary log stream: Unknown error.");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  connection_sockets_.erase(socket);
+  close_socket(socket);
+  finished_connection_threads_.push_back(std::this_thread::get_id());
+}
+
+void IngestServer::receive_stream(int socket)
+{
+  std::vector<uint8_t> buffer(STREAM_MAGIC_SIZE + sizeof(uint32_t));
+  std::string name;
+  if (receive_all(socket, buffer.data(), buffer.size()) &&
+    std::memcmp(buffer.data(), STREAM_MAGIC, STREAM_MAGIC_SIZE) == 0)
+  {
+    BufferReader reader(buffer.data() + STREAM_MAGIC_SIZE, sizeof(uint32_t));
+    const auto name_size = reader.read_uint32();
+    if (name_size <= MAX_STREAM_NAME_SIZE) {
+      name.resize(name_size);
+      if (!receive_all(socket, &name[0], name.size())) {
+        name.clear();
+      }
+    }
+  }
+
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> file(nullptr, &std::fclose);
+  uint64_t size = 0;
+  const auto path = rcpputils::fs::path(root_directory_) / name;
+  if (!is_valid_stream_name(name)) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Rejected binary log stream with invalid name '" << name << "'.");
+  } else {
+    const auto folder = path.parent_path();
+    if (folder.is_directory() || rcpputils::fs::create_directories(folder)) {
+      size = path.exists() ? static_cast<uint64_t>(path.file_size()) : 0u;
+      file.reset(std::fopen(path.string().c_str(), "ab"));
+    }
+    if (!file) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+        "Failed to receive binary log stream '" << name << "': Cannot open '" <<
+          path.string() << "'.");
+    }
+  }
+
+  bool is_complete = false;
+  if (file && send_ack(socket, size)) {
+    std::vector<uint8_t> data;
+    uint8_t frame_type = 0;
+    while (!is_complete && receive_all(socket, &frame_type, sizeof(frame_type))) {
+      buffer.resize(frame_type == static_cast<uint8_t>(FrameType::DATA) ?
+        FRAME_HEADER_SIZE - sizeof(frame_type) : END_FRAME_SIZE - sizeof(frame_type));
+      if ((frame_type != static_cast<uint8_t>(FrameType::DATA) &&
+        frame_type != static_cast<uint8_t>(FrameType::END)) ||
+        !receive_all(socket, buffer.data(), buffer.size()))
+      {
+        break;
+      }
+      BufferReader reader(buffer.data(), buffer.size());
+      const auto offset = reader.read_uint64();
+      if (frame_type == static_cast<uint8_t>(FrameType::END)) {
+        // The END frame carries the size of the complete file.
+        is_complete = offset == size;
+        if (!is_complete) {
+          ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+            "Binary log stream '" << name << "' ended at byte " << offset << ", but " << size <<
+              " were received.");
+        }
+        break;
+      }
+      const auto data_size = reader.read_uint32();
+      if (offset != size || data_size > MAX_FRAME_DATA_SIZE) {
+        ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+          "Binary log stream '" << name << "' continues at byte " << offset << ", but " << size <<
+            " were received.");
+        break;
+      }
+      data.resize(data_size);
+      if (!receive_all(socket, data.data(), data.size())) {
+        break;
+      }
+      if (std::fwrite(data.data(), 1, data.size(), file.get()) != data.size() ||
+        std::fflush(file.get()) != 0)
+      {
+        ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+          "Failed to write binary log stream '" << name << "' to '" << path.string() << "'.");
+        break;
+      }
+      size += data.size();
+      if (!send_ack(socket, size)) {
+        break;
+      }
+    }
+  }
+  if (is_complete) {
+    send_ack(socket, size);
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+      "Received binary log stream '" << name << "' of " << size << " bytes.");
+  }
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
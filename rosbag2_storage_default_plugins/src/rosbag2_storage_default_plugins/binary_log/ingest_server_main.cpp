@@ -0,0 +1,65 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "rosbag2_storage_default_plugins/binary_log/ingest_server.hpp"
+
+namespace
+{
+std::atomic<bool> is_interrupted {false};
+
+void handle_signal(int)
+{
+  is_interrupted = true;
+}
+}  // namespace
+
+// Receives binary logs streamed by recorders until interrupted, e.g.
+//   ros2 run rosbag2_storage_default_plugins binary_log_ingest 7400 /data/bags
+int main(int argc, char ** argv)
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <port> <directory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+  try {
+    const auto port = std::stoul(argv[1]);
+    if (port > 65535) {
+      throw std::out_of_range("port");
+    }
+    rosbag2_storage_plugins::binary_log::IngestServer server(
+      static_cast<uint16_t>(port), argv[2]);
+    std::cout << "Listening on port " << server.get_port() << std::endl;
+    while (!is_interrupted) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  } catch (const std::logic_error &) {
+    std::cerr << "Invalid port '" << argv[1] << "'." << std::endl;
+    return EXIT_FAILURE;
+  } catch (const std::runtime_error & e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
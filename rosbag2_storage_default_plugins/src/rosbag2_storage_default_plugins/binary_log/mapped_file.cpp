@@ -0,0 +1,114 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+# include <io.h>
+# include <Windows.h>
+#else
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include "rosbag2_storage/buffer_slice.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+MappedFile::MappedFile(std::FILE * file, uint64_t size)
+{
+  if (size == 0 || size > std::numeric_limits<size_t>::max()) {
+    throw std::runtime_error("File cannot be mapped into memory.");
+  }
+#ifdef _WIN32
+  const auto file_handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+  mapping_handle_ = CreateFileMappingA(
+    file_handle, nullptr, PAGE_WRITECOPY, static_cast<DWORD>(size >> 32),
+    static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+  if (!mapping_handle_) {
+    throw std::runtime_error("File cannot be mapped into memory.");
+  }
+  data_ = static_cast<uint8_t *>(
+    MapViewOfFile(mapping_handle_, FILE_MAP_COPY, 0, 0, static_cast<SIZE_T>(size)));
+  if (!data_) {
+    CloseHandle(mapping_handle_);
+    throw std::runtime_error("File cannot be mapped into memory.");
+  }
+#else
+  const auto data = mmap(
+    nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("File cannot be mapped into memory.");
+  }
+  data_ = static_cast<uint8_t *>(data);
+#endif
+  size_ = static_cast<size_t>(size);
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_handle_);
+#else
+  munmap(data_, size_);
+#endif
+}
+
+void MappedFile::advise(AccessPattern access_pattern) const
+{
+#ifdef _WIN32
+  (void) access_pattern;
+#else
+  madvise(
+    data_, size_, access_pattern == AccessPattern::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_NORMAL);
+#endif
+}
+
+void MappedFile::will_need(uint64_t offset, uint64_t size) const
+{
+  if (offset >= size_) {
+    return;
+  }
+  size = std::min<uint64_t>(size, size_ - offset);
+#ifdef _WIN32
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = data_ + offset;
+  range.NumberOfBytes = static_cast<SIZE_T>(size);
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+  // madvise requires an address aligned to pages.
+  static const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const auto aligned_offset = offset - offset % page_size;
+  madvise(
+    data_ + aligned_offset, static_cast<size_t>(size + offset - aligned_offset), MADV_WILLNEED);
+#endif
+}
+
+std::shared_ptr<rcutils_uint8_array_t> make_serialized_data_view(
+  const std::shared_ptr<const MappedFile> & mapped_file, const uint8_t * data, size_t size)
+{
+  return rosbag2_storage::make_serialized_data_view({data, size, mapped_file});
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
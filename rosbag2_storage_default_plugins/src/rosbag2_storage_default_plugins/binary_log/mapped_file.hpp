@@ -0,0 +1,88 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__MAPPED_FILE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#include "rcutils/types/uint8_array.h"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+/**
+ * Maps a file into memory copy-on-write, so data handed out from the mapping can be modified in
+ * place, e.g. by decompression, without changing the file.
+ */
+class MappedFile
+{
+public:
+  enum class AccessPattern
+  {
+    NORMAL,
+    SEQUENTIAL
+  };
+
+  /**
+   * Maps the first size bytes of the open file.
+   * \throws std::runtime_error if the file cannot be mapped, e.g. if it exceeds the address space.
+   */
+  MappedFile(std::FILE * file, uint64_t size);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+
+  const uint8_t * data() const
+  {
+    return data_;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  /// Hints the expected access pattern of the whole mapping to the operating system.
+  void advise(AccessPattern access_pattern) const;
+
+  /// Hints that the given range will be read soon, so the operating system reads it ahead.
+  void will_need(uint64_t offset, uint64_t size) const;
+
+private:
+  uint8_t * data_ {nullptr};
+  size_t size_ {0};
+#ifdef _WIN32
+  void * mapping_handle_ {nullptr};
+#endif
+};
+
+/**
+ * Returns serialized data pointing into the mapping, which keeps the mapping alive.
+ * Resizing the data copies it out of the mapping first.
+ */
+std::shared_ptr<rcutils_uint8_array_t> make_serialized_data_view(
+  const std::shared_ptr<const MappedFile> & mapped_file, const uint8_t * data, size_t size);
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__MAPPED_FILE_HPP_
@@ -0,0 +1,521 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_file.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "stream_protocol.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+constexpr const char HTTP_SCHEME[] = "http://";
+constexpr const char HTTPS_SCHEME[] = "https://";
+constexpr const char S3_SCHEME[] = "s3://";
+constexpr const size_t MAX_HEADER_SIZE = 64 * 1024;
+constexpr const int MAX_ATTEMPTS = 4;
+constexpr const std::chrono::milliseconds MIN_RETRY_DELAY {100};
+
+bool starts_with(const std::string & value, const char * prefix)
+{
+  return value.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+std::string to_lower(std::string value)
+{
+  std::transform(
+    value.begin(), value.end(), value.begin(), [](unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+  return value;
+}
+
+// Parses a decimal number which makes up the whole value.
+bool parse_size(const std::string & value, uint64_t & size)
+{
+  const auto is_digit = [](unsigned char c) {return std::isdigit(c) != 0;};
+  if (value.empty() || !std::all_of(value.begin(), value.end(), is_digit)) {
+    return false;
+  }
+  errno = 0;
+  size = std::strtoull(value.c_str(), nullptr, 10);
+  return errno == 0;
+}
+
+// Parses the value "bytes <first>-<last>/<size>" of a Content-Range header.
+bool parse_content_range(
+  const std::string & content_range, uint64_t & first, uint64_t & last, uint64_t & size)
+{
+  constexpr const char UNIT[] = "bytes ";
+  if (!starts_with(content_range, UNIT)) {
+    return false;
+  }
+  const auto first_start = std::strlen(UNIT);
+  const auto range_separator = content_range.find('-', first_start);
+  const auto size_separator = content_range.find('/', first_start);
+  if (size_separator == std::string::npos || range_separator > size_separator) {
+    return false;
+  }
+  const auto first_value = content_range.substr(first_start, range_separator - first_start);
+  const auto last_value =
+    content_range.substr(range_separator + 1, size_separator - range_separator - 1);
+  return parse_size(first_value, first) && parse_size(last_value, last) &&
+         parse_size(content_range.substr(size_separator + 1), size) &&
+         first <= last && last < size;
+}
+
+// A failed request which may succeed when it is sent again, e.g. after a lost connection.
+class RetryableError : public std::runtime_error
+{
+public:
+  using std::runtime_error::runtime_error;
+};
+}  // namespace
+
+RemoteLocation parse_remote_location(const std::string & url)
+{
+  auto http_url = url;
+  if (starts_with(url, S3_SCHEME)) {
+    const auto path = url.substr(std::strlen(S3_SCHEME));
+    const auto separator = path.find('/');
+    if (separator == std::string::npos || separator == 0 || separator + 1 == path.size()) {
+      throw std::runtime_error("Invalid URL '" + url + "', expected 's3://bucket/key'.");
+    }
+    const auto bucket = path.substr(0, separator);
+    const auto key = path.substr(separator + 1);
+    const char * endpoint = std::getenv("AWS_ENDPOINT_URL");
+    if (endpoint && *endpoint) {
+      std::string endpoint_url(endpoint);
+      while (!endpoint_url.empty() && endpoint_url.back() == '/') {
+        endpoint_url.pop_back();
+      }
+      http_url = endpoint_url + "/" + bucket + "/" + key;
+    } else {
+      http_url = std::string(HTTP_SCHEME) + bucket + ".s3.amazonaws.com/" + key;
+    }
+  }
+  if (starts_with(http_url, HTTPS_SCHEME)) {
+    throw std::runtime_error(
+            "Cannot read '" + url + "': HTTPS is not supported, use an HTTP endpoint.");
+  }
+  if (!starts_with(http_url, HTTP_SCHEME)) {
+    throw std::runtime_error("Invalid URL '" + url + "', expected 'http://' or 's3://'.");
+  }
+
+  const auto authority_start = std::strlen(HTTP_SCHEME);
+  const auto authority_end = http_url.find_first_of("/?", authority_start);
+  const auto authority = http_url.substr(authority_start, authority_end - authority_start);
+  RemoteLocation location;
+  location.target = authority_end == std::string::npos ? "/" : http_url.substr(authority_end);
+  if (location.target.front() == '?') {
+    location.target.insert(0, "/");
+  }
+  // IPv6 addresses are enclosed in brackets.
+  const auto host_end = authority.find(']');
+  const auto port_separator = authority.find(':', host_end == std::string::npos ? 0 : host_end);
+  location.host = authority.substr(0, port_separator);
+  location.port =
+    port_separator == std::string::npos ? "80" : authority.substr(port_separator + 1);
+  if (location.host.size() > 2 && location.host.front() == '[' && location.host.back() == ']') {
+    location.host = location.host.substr(1, location.host.size() - 2);
+  }
+  if (location.host.empty() || location.port.empty()) {
+    throw std::runtime_error("Invalid URL '" + url + "', it has no host.");
+  }
+  return location;
+}
+
+/// Sends range requests over a connection kept alive between them.
+class RemoteFile::Connection
+{
+public:
+  Connection(const std::string & url, const RemoteLocation & location)
+  : url_(url), location_(location)
+  {
+    host_header_ = location_.host.find(':') == std::string::npos ?
+      location_.host : "[" + location_.host + "]";
+    if (location_.port != "80") {
+      host_header_ += ":" + location_.port;
+    }
+  }
+
+  ~Connection()
+  {
+    disconnect();
+  }
+
+  /**
+   * Requests the range, e.g. "bytes=0-99" or "bytes=-100" for the last 100 bytes, connecting
+   * again and retrying after transient failures.
+   * \return the data of the range, and the size of the file in file_size.
+   * \throws std::runtime_error if the response is larger than the max_size bytes requested.
+   */
+  std::vector<uint8_t> get(const std::string & range, uint64_t max_size, uint64_t & file_size)
+  {
+    auto retry_delay = MIN_RETRY_DELAY;
+    std::string error;
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+      if (attempt > 0) {
+        std::this_thread::sleep_for(retry_delay);
+        retry_delay *= 2;
+      }
+      try {
+        return request(range, max_size, file_size);
+      } catch (const RetryableError & e) {
+        disconnect();
+        error = e.what();
+      } catch (const std::runtime_error &) {
+        disconnect();
+        throw;
+      }
+    }
+    throw std::runtime_error("Failed to read '" + url_ + "': " + error);
+  }
+
+private:
+  std::vector<uint8_t> request(
+    const std::string & range, uint64_t max_size, uint64_t & file_size)
+  {
+    if (socket_ < 0) {
+      socket_ = connect_socket({location_.host, location_.port});
+      if (socket_ < 0) {
+        throw RetryableError(
+                "Cannot connect to " + location_.host + ":" + location_.port + ".");
+      }
+      buffer_.clear();
+    }
+    const auto request = "GET " + location_.target + " HTTP/1.1\r\n" +
+      "Host: " + host_header_ + "\r\n" +
+      "Range: " + range + "\r\n" +
+      "User-Agent: rosbag2\r\n\r\n";
+    if (!send_all(socket_, request.data(), request.size())) {
+      throw RetryableError("Lost connection.");
+    }
+
+    // Receives the status line and headers, and the start of the body.
+    size_t header_end = std::string::npos;
+    while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (buffer_.size() > MAX_HEADER_SIZE) {
+        throw std::runtime_error("Failed to read '" + url_ + "': Response header too large.");
+      }
+      char data[4096];
+      const auto received = receive_some(socket_, data, sizeof(data), SOCKET_TIMEOUT);
+      if (received <= 0) {
+        throw RetryableError("Lost connection.");
+      }
+      buffer_.append(data, static_cast<size_t>(received));
+    }
+    const auto header = buffer_.substr(0, header_end);
+    buffer_.erase(0, header_end + 4);
+
+    const auto status_start = header.find(' ');
+    const int status = status_start == std::string::npos ?
+      0 : std::atoi(header.c_str() + status_start + 1);
+    bool keeps_connection = starts_with(header, "HTTP/1.1");
+    std::string content_length;
+    std::string content_range;
+    size_t line_start = header.find("\r\n");
+    while (line_start != std::string::npos) {
+      line_start += 2;
+      const auto line_end = header.find("\r\n", line_start);
+      const auto line = header.substr(line_start, line_end - line_start);
+      line_start = line_end;
+      const auto separator = line.find(':');
+      if (separator == std::string::npos) {
+        continue;
+      }
+      const auto name = to_lower(line.substr(0, separator));
+      const auto value_start = line.find_first_not_of(' ', separator + 1);
+      const auto value = value_start == std::string::npos ? "" : line.substr(value_start);
+      if (name == "content-length") {
+        content_length = value;
+      } else if (name == "content-range") {
+        content_range = value;
+      } else if (name == "connection" && to_lower(value) == "close") {
+        keeps_connection = false;
+      } else if (name == "transfer-encoding" && to_lower(value) != "identity") {
+        throw std::runtime_error(
+                "Failed to read '" + url_ + "': Transfer encoding '" + value +
+                "' is not supported.");
+      }
+    }
+
+    if (status != 206) {
+      const auto message = "Failed to read '" + url_ + "': HTTP status " +
+        std::to_string(status) + ".";
+      // Timeouts, throttling and server errors are transient.
+      if (status == 408 || status == 429 || status >= 500) {
+        throw RetryableError(message);
+      }
+      if (status == 200) {
+        throw std::runtime_error(message + " The server does not support range requests.");
+      }
+      throw std::runtime_error(message);
+    }
+    // The body is only allocated once its length matches the range requested and received.
+    uint64_t size = 0;
+    uint64_t first = 0;
+    uint64_t last = 0;
+    if (!parse_size(content_length, size) ||
+      !parse_content_range(content_range, first, last, file_size) ||
+      size != last - first + 1 || size > max_size)
+    {
+      throw std::runtime_error("Failed to read '" + url_ + "': Invalid range response.");
+    }
+
+    std::vector<uint8_t> body(static_cast<size_t>(size));
+    const auto buffered = std::min<size_t>(buffer_.size(), body.size());
+    std::memcpy(body.data(), buffer_.data(), buffered);
+    buffer_.erase(0, buffered);
+    if (body.size() > buffered &&
+      !receive_all(socket_, body.data() + buffered, body.size() - buffered))
+    {
+      throw RetryableError("Lost connection.");
+    }
+    if (!keeps_connection) {
+      disconnect();
+    }
+    return body;
+  }
+
+  void disconnect()
+  {
+    close_socket(socket_);
+    socket_ = -1;
+    buffer_.clear();
+  }
+
+  const std::string url_;
+  const RemoteLocation location_;
+  std::string host_header_;
+  int socket_ {-1};
+  // Bytes received after the end of the last response header.
+  std::string buffer_;
+};
+
+bool RemoteFile::is_remote(const std::string & uri)
+{
+  return starts_with(uri, HTTP_SCHEME) || starts_with(uri, HTTPS_SCHEME) ||
+         starts_with(uri, S3_SCHEME);
+}
+
+RemoteFile::RemoteFile(
+  const std::string & url, size_t block_size, size_t cache_size, size_t max_requests)
+: url_(url),
+  location_(parse_remote_location(url)),
+  block_size_(std::max<size_t>(block_size, 1u)),
+  max_cached_blocks_(std::max<size_t>(cache_size / block_size_, 2u))
+{
+  // The last block holds the summary and the footer, which are read first.
+  const auto tail = Connection(url_, location_).get(
+    "bytes=-" + std::to_string(block_size_), block_size_, size_);
+  request_count_ = 1;
+  if (size_ == 0 || tail.size() > size_) {
+    throw std::runtime_error("Failed to read '" + url_ + "': Invalid range response.");
+  }
+  const auto last_block_number = (size_ - 1) / block_size_;
+  const auto last_block_offset = last_block_number * block_size_;
+  const auto tail_offset = size_ - tail.size();
+  if (tail_offset <= last_block_offset) {
+    insert_block(
+      last_block_number, std::make_shared<const std::vector<uint8_t>>(
+        tail.begin() + static_cast<std::ptrdiff_t>(last_block_offset - tail_offset), tail.end()));
+  }
+
+  for (size_t i = 0; i < std::max<size_t>(max_requests, 1u); ++i) {
+    download_threads_.emplace_back(&RemoteFile::download, this);
+  }
+}
+
+RemoteFile::~RemoteFile()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  block_requested_.notify_all();
+  for (auto & download_thread : download_threads_) {
+    download_thread.join();
+  }
+}
+
+std::vector<uint8_t> RemoteFile::read(uint64_t offset, size_t size)
+{
+  if (offset > size_ || size > size_ - offset) {
+    throw std::runtime_error(
+            "Failed to read '" + url_ + "': Range exceeds the file size of " +
+            std::to_string(size_) + " bytes.");
+  }
+  std::vector<uint8_t> data(size);
+  if (size == 0) {
+    return data;
+  }
+  const auto first_block_number = offset / block_size_;
+  const auto last_block_number = (offset + size - 1) / block_size_;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (auto block_number = first_block_number; block_number <= last_block_number; ++block_number) {
+    request_block(block_number, true);
+  }
+  for (auto block_number = first_block_number; block_number <= last_block_number; ++block_number) {
+    auto block = blocks_.end();
+    block_downloaded_.wait(
+      lock, [this, block_number, &block] {
+        // A block evicted while waiting for the blocks before it is requested again.
+        request_block(block_number, true);
+        block = blocks_.find(block_number);
+        return block->second.data || !block->second.error.empty();
+      });
+    if (!block->second.error.empty()) {
+      const auto error = block->second.error;
+      blocks_.erase(block);
+      throw std::runtime_error(error);
+    }
+    lru_blocks_.splice(lru_blocks_.begin(), lru_blocks_, block->second.lru_position);
+
+    const auto block_offset = block_number * block_size_;
+    const auto start = std::max(offset, block_offset);
+    const auto end = std::min(offset + size, block_offset + block->second.data->size());
+    std::memcpy(
+      data.data() + (start - offset), block->second.data->data() + (start - block_offset),
+      static_cast<size_t>(end - start));
+  }
+  return data;
+}
+
+void RemoteFile::prefetch(uint64_t offset, uint64_t size)
+{
+  if (size == 0 || offset >= size_) {
+    return;
+  }
+  const auto first_block_number = offset / block_size_;
+  const auto last_block_number = (std::min(offset + size, size_) - 1) / block_size_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto block_number = first_block_number; block_number <= last_block_number; ++block_number) {
+    if (pending_block_count_ >= max_cached_blocks_ / 2) {
+      return;
+    }
+    request_block(block_number, false);
+  }
+}
+
+uint64_t RemoteFile::get_request_count() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return request_count_;
+}
+
+void RemoteFile::request_block(uint64_t block_number, bool is_urgent)
+{
+  const auto block = blocks_.find(block_number);
+  if (block == blocks_.end()) {
+    blocks_[block_number] = Block{nullptr, "", lru_blocks_.end()};
+    ++pending_block_count_;
+    if (is_urgent) {
+      requested_blocks_.push_front(block_number);
+    } else {
+      requested_blocks_.push_back(block_number);
+    }
+    block_requested_.notify_one();
+  } else if (is_urgent && !block->second.data && block->second.error.empty()) {
+    // A block prefetched but not downloaded yet is downloaded next.
+    const auto request = std::find(
+      requested_blocks_.begin(), requested_blocks_.end(), block_number);
+    if (request != requested_blocks_.end() && request != requested_blocks_.begin()) {
+      requested_blocks_.erase(request);
+      requested_blocks_.push_front(block_number);
+    }
+  }
+}
+
+void RemoteFile::insert_block(
+  uint64_t block_number, std::shared_ptr<const std::vector<uint8_t>> data)
+{
+  auto & block = blocks_[block_number];
+  block.data = std::move(data);
+  lru_blocks_.push_front(block_number);
+  block.lru_position = lru_blocks_.begin();
+  evict_blocks();
+}
+
+void RemoteFile::evict_blocks()
+{
+  while (lru_blocks_.size() > max_cached_blocks_) {
+    blocks_.erase(lru_blocks_.back());
+    lru_blocks_.pop_back();
+  }
+}
+
+void RemoteFile::download()
+{
+  Connection connection(url_, location_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    block_requested_.wait(lock, [this] {return is_stopped_ || !requested_blocks_.empty();});
+    if (is_stopped_) {
+      return;
+    }
+    const auto block_number = requested_blocks_.front();
+    requested_blocks_.pop_front();
+    ++request_count_;
+    lock.unlock();
+
+    const auto offset = block_number * block_size_;
+    const auto last_byte = std::min<uint64_t>(offset + block_size_, size_) - 1;
+    std::shared_ptr<const std::vector<uint8_t>> data;
+    std::string error;
+    try {
+      uint64_t file_size = 0;
+      auto block_data = connection.get(
+        "bytes=" + std::to_string(offset) + "-" + std::to_string(last_byte),
+        last_byte - offset + 1, file_size);
+      if (block_data.size() != last_byte - offset + 1) {
+        throw std::runtime_error("Failed to read '" + url_ + "': Invalid range response.");
+      }
+      data = std::make_shared<const std::vector<uint8_t>>(std::move(block_data));
+    } catch (const std::runtime_error & e) {
+      error = e.what();
+    }
+
+    lock.lock();
+    --pending_block_count_;
+    if (data) {
+      insert_block(block_number, std::move(data));
+    } else {
+      blocks_[block_number].error = error;
+    }
+    block_downloaded_.notify_all();
+  }
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
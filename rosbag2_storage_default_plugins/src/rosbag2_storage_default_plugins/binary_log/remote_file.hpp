@@ -0,0 +1,148 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__REMOTE_FILE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__REMOTE_FILE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+/// Location of a file served over HTTP, split from a URL like "http://host:port/path".
+struct RemoteLocation
+{
+  std::string host;
+  std::string port;
+  // Path and query of the URL, e.g. of a presigned URL.
+  std::string target;
+};
+
+/**
+ * Resolves the URL of a remote file: "http://host[:port]/path" as it is, and "s3://bucket/key"
+ * to the endpoint in the environment variable AWS_ENDPOINT_URL, as "endpoint/bucket/key", or to
+ * "http://bucket.s3.amazonaws.com/key" if it is not set.
+ * \throws std::runtime_error if the URL has another scheme or no host.
+ */
+RemoteLocation parse_remote_location(const std::string & url);
+
+/**
+ * Reads a file from object storage or a web server with HTTP range requests, so only the parts
+ * read are downloaded.
+ *
+ * The file is read in blocks of block_size bytes, which are cached, least recently used first
+ * evicted beyond cache_size bytes. Blocks are downloaded by up to max_requests threads in
+ * parallel, each with a connection of its own, so prefetching a large range, e.g. the next chunks
+ * of a binary log, downloads its blocks at the same time while the blocks read before are used.
+ *
+ * Requests are not signed, so objects of S3 need to be public, read with presigned URLs or
+ * through an endpoint which signs the requests. HTTPS is not supported.
+ */
+class RemoteFile
+{
+public:
+  static constexpr const size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+  static constexpr const size_t DEFAULT_CACHE_SIZE = 256 * 1024 * 1024;
+  static constexpr const size_t DEFAULT_MAX_REQUESTS = 8;
+
+  /// Whether the uri is the URL of a remote file rather than a local path.
+  static bool is_remote(const std::string & uri);
+
+  /**
+   * Requests the last block of the file, which tells its size.
+   * \throws std::runtime_error if the URL is invalid or the file cannot be read.
+   */
+  explicit RemoteFile(
+    const std::string & url, size_t block_size = DEFAULT_BLOCK_SIZE,
+    size_t cache_size = DEFAULT_CACHE_SIZE, size_t max_requests = DEFAULT_MAX_REQUESTS);
+
+  ~RemoteFile();
+
+  RemoteFile(const RemoteFile &) = delete;
+  RemoteFile & operator=(const RemoteFile &) = delete;
+
+  uint64_t size() const
+  {
+    return size_;
+  }
+
+  /**
+   * Reads the range, downloading the blocks which are not cached in parallel.
+   * \throws std::runtime_error if the range exceeds the file or a block cannot be downloaded.
+   */
+  std::vector<uint8_t> read(uint64_t offset, size_t size);
+
+  /**
+   * Downloads the blocks of the range in the background, after the blocks requested before.
+   * At most half of the cache is requested ahead, so blocks prefetched are not evicted before
+   * they are read, the blocks beyond are not requested.
+   */
+  void prefetch(uint64_t offset, uint64_t size);
+
+  /// Number of range requests sent, e.g. to tell how much of the file was downloaded.
+  uint64_t get_request_count() const;
+
+private:
+  struct Block
+  {
+    // Null while the block is downloaded.
+    std::shared_ptr<const std::vector<uint8_t>> data;
+    std::string error;
+    std::list<uint64_t>::iterator lru_position;
+  };
+
+  class Connection;
+
+  // Called with the lock held. Urgent blocks are downloaded before the blocks prefetched.
+  void request_block(uint64_t block_number, bool is_urgent);
+  void insert_block(uint64_t block_number, std::shared_ptr<const std::vector<uint8_t>> data);
+  void evict_blocks();
+  void download();
+
+  const std::string url_;
+  const RemoteLocation location_;
+  const size_t block_size_;
+  const size_t max_cached_blocks_;
+  uint64_t size_ {0};
+
+  std::vector<std::thread> download_threads_;
+  mutable std::mutex mutex_;
+  std::condition_variable block_requested_;
+  std::condition_variable block_downloaded_;
+  std::unordered_map<uint64_t, Block> blocks_;
+  // Numbers of the downloaded blocks, the most recently used first.
+  std::list<uint64_t> lru_blocks_;
+  std::deque<uint64_t> requested_blocks_;
+  // Blocks requested or being downloaded.
+  size_t pending_block_count_ {0};
+  uint64_t request_count_ {0};
+  bool is_stopped_ {false};
+};
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__REMOTE_FILE_HPP_
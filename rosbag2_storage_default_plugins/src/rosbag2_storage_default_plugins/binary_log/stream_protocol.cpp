@@ -0,0 +1,213 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stream_protocol.hpp"
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/time.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+StreamAddress parse_stream_address(const std::string & address)
+{
+  const auto separator = address.rfind(':');
+  if (separator == std::string::npos || separator == 0 || separator + 1 == address.size()) {
+    throw std::runtime_error(
+            "Invalid stream address '" + address + "', expected 'host:port'.");
+  }
+  auto host = address.substr(0, separator);
+  // IPv6 addresses are enclosed in brackets.
+  if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  return {host, address.substr(separator + 1)};
+}
+
+#ifdef _WIN32
+int connect_socket(const StreamAddress &)
+{
+  return -1;
+}
+
+void close_socket(int) {}
+
+bool send_all(int, const void *, size_t)
+{
+  return false;
+}
+
+bool receive_all(int, void *, size_t)
+{
+  return false;
+}
+
+int64_t receive_some(int, void *, size_t, std::chrono::milliseconds)
+{
+  return -1;
+}
+#else
+namespace
+{
+// Connects without waiting longer than SOCKET_TIMEOUT for an unreachable host.
+bool connect_with_timeout(int socket, const sockaddr * address, socklen_t address_size)
+{
+  const auto flags = fcntl(socket, F_GETFL, 0);
+  if (flags < 0 || fcntl(socket, F_SETFL, flags | O_NONBLOCK) != 0) {
+    return false;
+  }
+  if (::connect(socket, address, address_size) != 0) {
+    if (errno != EINPROGRESS) {
+      return false;
+    }
+    pollfd descriptor {};
+    descriptor.fd = socket;
+    descriptor.events = POLLOUT;
+    const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(SOCKET_TIMEOUT);
+    int error = 0;
+    socklen_t error_size = sizeof(error);
+    if (::poll(&descriptor, 1, static_cast<int>(timeout.count())) != 1 ||
+      getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &error_size) != 0 || error != 0)
+    {
+      return false;
+    }
+  }
+  return fcntl(socket, F_SETFL, flags) == 0;
+}
+}  // namespace
+
+int connect_socket(const StreamAddress & address)
+{
+  addrinfo hints {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo * addresses = nullptr;
+  if (getaddrinfo(address.host.c_str(), address.port.c_str(), &hints, &addresses) != 0) {
+    return -1;
+  }
+  int connected_socket = -1;
+  for (auto candidate = addresses; candidate && connected_socket < 0;
+    candidate = candidate->ai_next)
+  {
+    connected_socket = ::socket(candidate->ai_family, candidate->ai_socktype, 0);
+    if (connected_socket < 0) {
+      continue;
+    }
+    if (!connect_with_timeout(connected_socket, candidate->ai_addr, candidate->ai_addrlen)) {
+      ::close(connected_socket);
+      connected_socket = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  if (connected_socket >= 0) {
+    timeval timeout {};
+    timeout.tv_sec = SOCKET_TIMEOUT.count();
+    setsockopt(connected_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(connected_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    // Frames are sent as header and data, which should not wait for each other.
+    int enabled = 1;
+    setsockopt(connected_socket, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+# ifdef SO_NOSIGPIPE
+    setsockopt(connected_socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+# endif
+  }
+  return connected_socket;
+}
+
+void close_socket(int socket)
+{
+  if (socket >= 0) {
+    ::close(socket);
+  }
+}
+
+bool send_all(int socket, const void * data, size_t size)
+{
+# ifdef MSG_NOSIGNAL
+  constexpr int flags = MSG_NOSIGNAL;
+# else
+  constexpr int flags = 0;
+# endif
+  auto bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    const auto sent = ::send(socket, bytes, size, flags);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+
+bool receive_all(int socket, void * data, size_t size)
+{
+  auto bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    const auto received = ::recv(socket, bytes, size, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= static_cast<size_t>(received);
+  }
+  return true;
+}
+
+int64_t receive_some(int socket, void * data, size_t size, std::chrono::milliseconds timeout)
+{
+  pollfd descriptor {};
+  descriptor.fd = socket;
+  descriptor.events = POLLIN;
+  const auto ready = ::poll(&descriptor, 1, static_cast<int>(timeout.count()));
+  if (ready < 0) {
+    return errno == EINTR ? 0 : -1;
+  }
+  if (ready == 0) {
+    return 0;
+  }
+  const auto received = ::recv(socket, data, size, MSG_DONTWAIT);
+  if (received < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+  }
+  // A readable socket without data was closed by the server.
+  return received == 0 ? -1 : received;
+}
+#endif
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
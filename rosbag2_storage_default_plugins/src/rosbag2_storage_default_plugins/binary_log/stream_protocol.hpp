@@ -0,0 +1,89 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__STREAM_PROTOCOL_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__STREAM_PROTOCOL_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A binary log is streamed to an ingest server over TCP as the bytes of its file, all integers
+// in little endian:
+//
+//   client hello:  8 byte STREAM_MAGIC, string name of the file (uint32 length, characters)
+//   server hello:  uint64 size of the file on the server, where the client continues
+//   DATA frame:    uint8 frame type, uint64 file offset, uint32 data length, data
+//   END frame:     uint8 frame type, uint64 file size
+//   ACK:           uint64 size of the file written by the server so far
+//
+// The client sends frames without waiting for their acknowledgements, and keeps the data until
+// it is acknowledged. After a lost connection the client connects again and continues at the
+// size reported by the server. The server acknowledges the END frame once the file is complete.
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+constexpr const char STREAM_MAGIC[] = "RB2BSTR\n";
+constexpr const size_t STREAM_MAGIC_SIZE = 8;
+constexpr const size_t FRAME_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint32_t);
+constexpr const size_t END_FRAME_SIZE = sizeof(uint8_t) + sizeof(uint64_t);
+constexpr const size_t ACK_SIZE = sizeof(uint64_t);
+// Largest data of a frame, and of a file name.
+constexpr const size_t MAX_FRAME_DATA_SIZE = 256 * 1024;
+constexpr const size_t MAX_STREAM_NAME_SIZE = 4096;
+// Time after which a client gives up on a blocked send or receive and connects again.
+constexpr const std::chrono::seconds SOCKET_TIMEOUT {5};
+
+enum class FrameType : uint8_t
+{
+  DATA = 1,
+  END = 2
+};
+
+/// Host and port of an address given as "host:port", e.g. "ingest.local:7400" or "[::1]:7400".
+struct StreamAddress
+{
+  std::string host;
+  std::string port;
+};
+
+/// \throws std::runtime_error if the address has no host or port.
+StreamAddress parse_stream_address(const std::string & address);
+
+/// Connects a TCP socket with SOCKET_TIMEOUT for sends and receives, returns -1 on failure.
+int connect_socket(const StreamAddress & address);
+
+/// Closes a socket, if it is not -1.
+void close_socket(int socket);
+
+/// Sends all bytes, returns false if the connection was lost.
+bool send_all(int socket, const void * data, size_t size);
+
+/// Receives exactly size bytes, returns false if the connection was lost or closed.
+bool receive_all(int socket, void * data, size_t size);
+
+/**
+ * Receives the bytes available within the timeout, up to size.
+ * Returns their number, zero if none arrived in time, or -1 if the connection was lost or closed.
+ */
+int64_t receive_some(int socket, void * data, size_t size, std::chrono::milliseconds timeout);
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__STREAM_PROTOCOL_HPP_
@@ -0,0 +1,460 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stream_sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "binary_log_format.hpp"
+#include "stream_protocol.hpp"
+#include "../logging.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+constexpr const size_t MIN_SEGMENT_SIZE = 4096;
+constexpr const std::chrono::milliseconds MIN_RECONNECT_DELAY {100};
+constexpr const std::chrono::milliseconds MAX_RECONNECT_DELAY {5000};
+constexpr const std::chrono::milliseconds ACK_WAIT_INTERVAL {100};
+
+std::runtime_error make_error(const std::string & message)
+{
+  return std::runtime_error(message + ": " + std::strerror(errno));
+}
+
+size_t get_segment_size(uint64_t max_memory_bytes)
+{
+  return static_cast<size_t>(
+    std::min<uint64_t>(
+      StreamSink::SEGMENT_SIZE, std::max<uint64_t>(max_memory_bytes, MIN_SEGMENT_SIZE)));
+}
+
+void seek_file(std::FILE * file, uint64_t position)
+{
+#ifdef _WIN32
+  const auto result = _fseeki64(file, static_cast<__int64>(position), SEEK_SET);
+#else
+  const auto result = fseeko(file, static_cast<off_t>(position), SEEK_SET);
+#endif
+  if (result != 0) {
+    throw make_error("Failed to seek in spill file");
+  }
+}
+}  // namespace
+
+constexpr size_t StreamSink::SEGMENT_SIZE;
+constexpr std::chrono::seconds StreamSink::CLOSE_TIMEOUT;
+
+StreamSink::StreamSink(
+  const std::string & address, const std::string & stream_name,
+  const std::string & local_path, uint64_t max_memory_bytes)
+: address_(parse_stream_address(address)),
+  stream_name_(stream_name),
+  local_path_(local_path),
+  spill_path_(local_path + ".spill"),
+  segment_size_(get_segment_size(max_memory_bytes)),
+  max_memory_bytes_(std::max<uint64_t>(max_memory_bytes, segment_size_))
+{
+#ifdef _WIN32
+  throw std::runtime_error("Streaming binary logs is not supported on this platform.");
+#else
+  if (stream_name_.empty() || stream_name_.size() > MAX_STREAM_NAME_SIZE) {
+    throw std::runtime_error("Invalid stream name '" + stream_name_ + "'.");
+  }
+  spill_file_ = std::fopen(spill_path_.c_str(), "w+b");
+  if (!spill_file_) {
+    throw make_error("Failed to create spill file '" + spill_path_ + "'");
+  }
+  sender_ = std::thread(&StreamSink::run, this);
+#endif
+}
+
+StreamSink::~StreamSink()
+{
+  close();
+}
+
+void StreamSink::write(const void * data, size_t size)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto bytes = static_cast<const uint8_t *>(data);
+  // Data goes to memory only if nothing waits in the spill file, which keeps it in order.
+  if (spill_size_ == 0) {
+    while (size > 0 && memory_size_ < max_memory_bytes_) {
+      if (segments_.empty() || segments_.back().size() == segment_size_) {
+        segments_.emplace_back();
+        segments_.back().reserve(segment_size_);
+      }
+      auto & segment = segments_.back();
+      const auto copied_size = std::min(
+        {size, segment_size_ - segment.size(),
+          static_cast<size_t>(max_memory_bytes_ - memory_size_)});
+      // Stays within the reserved capacity, so the sender thread can read the segment.
+      segment.insert(segment.end(), bytes, bytes + copied_size);
+      memory_size_ += copied_size;
+      written_size_ += copied_size;
+      bytes += copied_size;
+      size -= copied_size;
+    }
+  }
+  if (size > 0) {
+    write_to_spill_file(bytes, size);
+    written_size_ += size;
+  }
+  data_written_.notify_one();
+}
+
+void StreamSink::close(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!spill_file_) {
+    return;
+  }
+  is_closing_ = true;
+  data_written_.notify_one();
+  data_acked_.wait_for(lock, timeout, [this] {return is_stream_complete() || is_failed_;});
+  const bool is_complete = is_stream_complete();
+  is_stopped_ = true;
+  data_written_.notify_one();
+  lock.unlock();
+  sender_.join();
+  lock.lock();
+  disconnect();
+
+  if (is_complete) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+      "Streamed " << written_size_ << " bytes of '" << stream_name_ << "' to " <<
+        address_.host << ":" << address_.port << ".");
+  } else {
+    keep_unsent_data();
+  }
+  std::fclose(spill_file_);
+  spill_file_ = nullptr;
+  std::remove(spill_path_.c_str());
+}
+
+uint64_t StreamSink::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_size_;
+}
+
+void StreamSink::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto reconnect_delay = MIN_RECONNECT_DELAY;
+  while (!is_stopped_) {
+    if (socket_ < 0) {
+      if (is_failed_ || !connect(lock)) {
+        data_written_.wait_for(lock, reconnect_delay, [this] {return is_stopped_;});
+        reconnect_delay = std::min(reconnect_delay * 2, MAX_RECONNECT_DELAY);
+        continue;
+      }
+      reconnect_delay = MIN_RECONNECT_DELAY;
+    }
+
+    try {
+      refill_from_spill_file();
+    } catch (const std::runtime_error & e) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+        "Stopped streaming '" << stream_name_ << "': " << e.what() << ".");
+      is_failed_ = true;
+      data_acked_.notify_all();
+      disconnect();
+      continue;
+    }
+
+    bool is_connected = true;
+    if (sent_offset_ < get_memory_end()) {
+      // Acknowledgements are taken as they come, without waiting for them.
+      is_connected = send_next_frame(lock) && receive_acks(lock, std::chrono::milliseconds(0));
+    } else if (is_closing_ && !is_end_sent_ && spill_size_ == 0) {
+      is_connected = send_end_frame(lock);
+    } else if (acked_size_ < sent_offset_) {
+      is_connected = receive_acks(lock, ACK_WAIT_INTERVAL);
+    } else {
+      data_written_.wait(
+        lock, [this] {
+          return is_stopped_ || sent_offset_ < get_memory_end() || (is_closing_ && !is_end_sent_);
+        });
+    }
+    if (!is_connected && socket_ >= 0) {
+      if (!is_failed_) {
+        ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+          "Lost connection to ingest server " << address_.host << ":" << address_.port <<
+            " streaming '" << stream_name_ << "', connecting again.");
+      }
+      disconnect();
+    }
+  }
+}
+
+bool StreamSink::connect(std::unique_lock<std::mutex> & lock)
+{
+  lock.unlock();
+  const auto socket = connect_socket(address_);
+  std::vector<uint8_t> hello;
+  BufferWriter writer(hello);
+  writer.write_bytes(STREAM_MAGIC, STREAM_MAGIC_SIZE);
+  writer.write_string(stream_name_);
+  std::vector<uint8_t> reply(ACK_SIZE);
+  const bool is_connected = socket >= 0 &&
+    send_all(socket, hello.data(), hello.size()) &&
+    receive_all(socket, reply.data(), reply.size());
+  lock.lock();
+
+  if (!is_connected) {
+    close_socket(socket);
+    // Only the first of the failed attempts in a row is logged.
+    if (failed_connects_++ == 0) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+        "Cannot connect to ingest server " << address_.host << ":" << address_.port <<
+          " to stream '" << stream_name_ << "', trying again. Up to " << max_memory_bytes_ <<
+          " bytes are kept in memory, the data beyond in '" << spill_path_ << "'.");
+    }
+    return false;
+  }
+  BufferReader reader(reply.data(), reply.size());
+  const auto server_size = reader.read_uint64();
+  // The server may only have received more than was acknowledged before, having nothing at
+  // all the first time.
+  if (server_size < memory_offset_ || server_size > written_size_ ||
+    (!has_connected_ && server_size > 0))
+  {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Ingest server " << address_.host << ":" << address_.port << " has " << server_size <<
+        " bytes of '" << stream_name_ << "', which do not continue the " << written_size_ <<
+        " bytes written. Stopped streaming.");
+    close_socket(socket);
+    is_failed_ = true;
+    data_acked_.notify_all();
+    return false;
+  }
+  if (failed_connects_ > 0 || has_connected_) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+      "Connected to ingest server " << address_.host << ":" << address_.port <<
+        ", streaming '" << stream_name_ << "' from byte " << server_size << ".");
+  }
+  failed_connects_ = 0;
+  has_connected_ = true;
+  socket_ = socket;
+  acked_size_ = server_size;
+  sent_offset_ = server_size;
+  release_acked_segments();
+  return true;
+}
+
+void StreamSink::disconnect()
+{
+  close_socket(socket_);
+  socket_ = -1;
+  is_end_sent_ = false;
+  received_acks_.clear();
+}
+
+bool StreamSink::send_next_frame(std::unique_lock<std::mutex> & lock)
+{
+  auto segment_offset = memory_offset_;
+  auto segment = segments_.begin();
+  while (segment_offset + segment->size() <= sent_offset_) {
+    segment_offset += segment->size();
+    ++segment;
+  }
+  const auto offset = sent_offset_;
+  const auto position = static_cast<size_t>(offset - segment_offset);
+  const auto data = segment->data() + position;
+  const auto size = std::min(segment->size() - position, MAX_FRAME_DATA_SIZE);
+  std::vector<uint8_t> header;
+  BufferWriter writer(header);
+  writer.write_uint8(static_cast<uint8_t>(FrameType::DATA));
+  writer.write_uint64(offset);
+  writer.write_uint32(static_cast<uint32_t>(size));
+
+  // Only this thread removes segments, and the data sent is not changed by appending.
+  const auto socket = socket_;
+  lock.unlock();
+  const bool is_sent = send_all(socket, header.data(), header.size()) &&
+    send_all(socket, data, size);
+  lock.lock();
+  if (is_sent) {
+    sent_offset_ = offset + size;
+  }
+  return is_sent;
+}
+
+bool StreamSink::send_end_frame(std::unique_lock<std::mutex> & lock)
+{
+  std::vector<uint8_t> frame;
+  BufferWriter writer(frame);
+  writer.write_uint8(static_cast<uint8_t>(FrameType::END));
+  writer.write_uint64(written_size_);
+
+  const auto socket = socket_;
+  lock.unlock();
+  const bool is_sent = send_all(socket, frame.data(), frame.size());
+  lock.lock();
+  is_end_sent_ = is_sent;
+  data_acked_.notify_all();
+  return is_sent;
+}
+
+bool StreamSink::receive_acks(
+  std::unique_lock<std::mutex> & lock, std::chrono::milliseconds timeout)
+{
+  uint8_t buffer[64 * ACK_SIZE];
+  const auto socket = socket_;
+  lock.unlock();
+  const auto received_size = receive_some(socket, buffer, sizeof(buffer), timeout);
+  lock.lock();
+  if (received_size < 0) {
+    return false;
+  }
+  received_acks_.insert(received_acks_.end(), buffer, buffer + received_size);
+  const auto acks_size = received_acks_.size() - received_acks_.size() % ACK_SIZE;
+  if (acks_size == 0) {
+    return true;
+  }
+  // Only the last acknowledgement matters, they acknowledge the size written so far.
+  BufferReader reader(received_acks_.data() + acks_size - ACK_SIZE, ACK_SIZE);
+  const auto acked_size = reader.read_uint64();
+  received_acks_.erase(received_acks_.begin(), received_acks_.begin() + acks_size);
+  if (acked_size < acked_size_ || acked_size > sent_offset_) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Ingest server " << address_.host << ":" << address_.port << " acknowledged " <<
+        acked_size << " bytes of '" << stream_name_ << "', but " << sent_offset_ <<
+        " were sent.");
+    return false;
+  }
+  acked_size_ = acked_size;
+  release_acked_segments();
+  return true;
+}
+
+bool StreamSink::is_stream_complete() const
+{
+  return is_end_sent_ && acked_size_ == written_size_;
+}
+
+void StreamSink::release_acked_segments()
+{
+  while (!segments_.empty() && memory_offset_ + segments_.front().size() <= acked_size_) {
+    memory_offset_ += segments_.front().size();
+    memory_size_ -= segments_.front().size();
+    segments_.pop_front();
+  }
+  data_acked_.notify_all();
+}
+
+void StreamSink::refill_from_spill_file()
+{
+  while (spill_size_ > 0 && memory_size_ < max_memory_bytes_) {
+    const auto size = static_cast<size_t>(
+      std::min({spill_size_, static_cast<uint64_t>(segment_size_),
+        max_memory_bytes_ - memory_size_}));
+    std::vector<uint8_t> segment;
+    segment.reserve(segment_size_);
+    segment.resize(size);
+    seek_file(spill_file_, spill_read_position_);
+    if (std::fread(segment.data(), 1, size, spill_file_) != size) {
+      throw make_error("Failed to read spill file '" + spill_path_ + "'");
+    }
+    segments_.push_back(std::move(segment));
+    memory_size_ += size;
+    spill_read_position_ += size;
+    spill_size_ -= size;
+    if (spill_size_ == 0) {
+      // The spill file is written from its start again.
+      spill_read_position_ = 0;
+    }
+  }
+}
+
+void StreamSink::write_to_spill_file(const void * data, size_t size)
+{
+  if (spill_size_ == 0) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM(
+      "Spilling data of '" << stream_name_ << "' to '" << spill_path_ << "' at byte " <<
+        written_size_ << ".");
+  }
+  seek_file(spill_file_, spill_read_position_ + spill_size_);
+  if (std::fwrite(data, 1, size, spill_file_) != size) {
+    throw make_error("Failed to write to spill file '" + spill_path_ + "'");
+  }
+  spill_size_ += size;
+}
+
+void StreamSink::keep_unsent_data()
+{
+  const auto unsent_path = local_path_ + ".unsent";
+  auto unsent_file = std::fopen(unsent_path.c_str(), "wb");
+  bool is_kept = unsent_file != nullptr;
+  auto segment_offset = memory_offset_;
+  for (const auto & segment : segments_) {
+    // The first segment may be partially acknowledged.
+    const auto position = static_cast<size_t>(
+      std::max(segment_offset, acked_size_) - segment_offset);
+    const auto size = segment.size() - position;
+    is_kept = is_kept && std::fwrite(segment.data() + position, 1, size, unsent_file) == size;
+    segment_offset += segment.size();
+  }
+  std::vector<uint8_t> buffer(segment_size_);
+  try {
+    while (is_kept && spill_size_ > 0) {
+      const auto size = static_cast<size_t>(std::min<uint64_t>(spill_size_, buffer.size()));
+      seek_file(spill_file_, spill_read_position_);
+      is_kept = std::fread(buffer.data(), 1, size, spill_file_) == size &&
+        std::fwrite(buffer.data(), 1, size, unsent_file) == size;
+      spill_read_position_ += size;
+      spill_size_ -= size;
+    }
+  } catch (const std::runtime_error &) {
+    is_kept = false;
+  }
+  if (unsent_file && std::fclose(unsent_file) != 0) {
+    is_kept = false;
+  }
+
+  if (is_kept) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Ingest server " << address_.host << ":" << address_.port << " did not acknowledge '" <<
+        stream_name_ << "' from byte " << acked_size_ << " of " << written_size_ <<
+        ". The rest is kept in '" << unsent_path << "', append it to the received file.");
+  } else {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+      "Ingest server " << address_.host << ":" << address_.port << " did not acknowledge '" <<
+        stream_name_ << "' from byte " << acked_size_ << " of " << written_size_ <<
+        ", and the rest cannot be kept in '" << unsent_path << "': " << std::strerror(errno));
+  }
+}
+
+uint64_t StreamSink::get_memory_end() const
+{
+  return memory_offset_ + memory_size_;
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
@@ -0,0 +1,138 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__STREAM_SINK_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__STREAM_SINK_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stream_protocol.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+/**
+ * Streams the bytes of a binary log to an ingest server instead of writing them to a file.
+ *
+ * The data is sent by a thread of its own, in frames which are not waiting for the
+ * acknowledgements of the frames before, and is kept until the server acknowledges it.
+ * At most max_memory_bytes are kept in memory, the data beyond is appended to a spill file and
+ * read back once the server acknowledged enough, so a slow or lost link neither blocks the
+ * writer nor grows the memory. A lost connection is established again, and the server tells
+ * where to continue.
+ */
+class StreamSink
+{
+public:
+  // Size of the buffers the data is kept in, and read back from the spill file.
+  static constexpr size_t SEGMENT_SIZE = 1024 * 1024;
+  // Time close() waits for the server to acknowledge all data.
+  static constexpr std::chrono::seconds CLOSE_TIMEOUT {30};
+
+  /**
+   * Starts streaming to the server at the "host:port" address, as the file of the stream name.
+   * The spill file is local_path + ".spill", the data not sent on close local_path + ".unsent".
+   * \throws std::runtime_error if the address or the stream name is invalid, the platform does
+   * not support streaming or the spill file cannot be created.
+   */
+  StreamSink(
+    const std::string & address, const std::string & stream_name,
+    const std::string & local_path, uint64_t max_memory_bytes);
+
+  ~StreamSink();
+
+  StreamSink(const StreamSink &) = delete;
+  StreamSink & operator=(const StreamSink &) = delete;
+
+  /**
+   * Hands the data to the sender thread, which sends it as soon as possible.
+   * \throws std::runtime_error if writing to the spill file fails.
+   */
+  void write(const void * data, size_t size);
+
+  /**
+   * Sends the end of the stream and waits for the server to acknowledge all data.
+   * If it does not within the timeout, the data not acknowledged is kept in the ".unsent" file
+   * and an error is logged, appending it to the file received by the server completes it.
+   */
+  void close(std::chrono::milliseconds timeout = CLOSE_TIMEOUT);
+
+  /// Size of the data written so far.
+  uint64_t size() const;
+
+private:
+  void run();
+  bool connect(std::unique_lock<std::mutex> & lock);
+  void disconnect();
+  bool send_next_frame(std::unique_lock<std::mutex> & lock);
+  bool send_end_frame(std::unique_lock<std::mutex> & lock);
+  bool receive_acks(std::unique_lock<std::mutex> & lock, std::chrono::milliseconds timeout);
+  bool is_stream_complete() const;
+  void release_acked_segments();
+  void refill_from_spill_file();
+  void write_to_spill_file(const void * data, size_t size);
+  void keep_unsent_data();
+  uint64_t get_memory_end() const;
+
+  const StreamAddress address_;
+  const std::string stream_name_;
+  const std::string local_path_;
+  const std::string spill_path_;
+  const size_t segment_size_;
+  const uint64_t max_memory_bytes_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable data_written_;
+  std::condition_variable data_acked_;
+  std::thread sender_;
+  // Only the sender thread uses the socket.
+  int socket_ {-1};
+  size_t failed_connects_ {0};
+  bool has_connected_ {false};
+  bool is_closing_ {false};
+  bool is_end_sent_ {false};
+  bool is_stopped_ {false};
+  // Set if the server has data which does not fit to the stream, it is not sent again then.
+  bool is_failed_ {false};
+  std::vector<uint8_t> received_acks_;
+
+  // Data not acknowledged yet, starting at memory_offset_ of the stream, and continued by the
+  // data in the spill file.
+  std::deque<std::vector<uint8_t>> segments_;
+  uint64_t memory_offset_ {0};
+  uint64_t memory_size_ {0};
+  std::FILE * spill_file_ {nullptr};
+  uint64_t spill_read_position_ {0};
+  uint64_t spill_size_ {0};
+
+  uint64_t written_size_ {0};
+  uint64_t sent_offset_ {0};
+  uint64_t acked_size_ {0};
+};
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__STREAM_SINK_HPP_
@@ -0,0 +1,393 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "write_queue.hpp"
+
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  ifdef __NR_io_uring_setup
+#   define ROSBAG2_BINARY_LOG_HAS_IO_URING
+#  endif
+# endif
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../logging.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+namespace
+{
+std::string get_error_string(int error_number)
+{
+  return std::strerror(error_number);
+}
+}  // namespace
+
+void WriteLatencyHistogram::add(std::chrono::steady_clock::duration latency)
+{
+  const auto latency_us = static_cast<uint64_t>(
+    std::max<int64_t>(
+      0, std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+  // Bucket i holds latencies below 2^i µs.
+  size_t bucket = 0;
+  while (bucket + 1 < bucket_counts_.size() && (latency_us >> bucket) > 0) {
+    ++bucket;
+  }
+  ++bucket_counts_[bucket];
+  ++count_;
+  max_us_ = std::max(max_us_, latency_us);
+}
+
+uint64_t WriteLatencyHistogram::get_quantile_us(double quantile) const
+{
+  if (count_ == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count_))));
+  uint64_t cumulative_count = 0;
+  for (size_t bucket = 0; bucket < bucket_counts_.size(); ++bucket) {
+    cumulative_count += bucket_counts_[bucket];
+    if (cumulative_count >= rank) {
+      return std::min(uint64_t {1} << bucket, max_us_);
+    }
+  }
+  return max_us_;
+}
+
+std::string WriteLatencyHistogram::to_string() const
+{
+  std::stringstream stream;
+  stream << count_ << " writes, p50 <= " << get_quantile_us(0.5) << " us, p99 <= " <<
+    get_quantile_us(0.99) << " us, max " << max_us_ << " us";
+  return stream.str();
+}
+
+#ifdef ROSBAG2_BINARY_LOG_HAS_IO_URING
+struct WriteQueue::Ring
+{
+  Ring(int file_descriptor, size_t entries)
+  : file_descriptor(file_descriptor), iovecs(entries)
+  {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_descriptor = static_cast<int>(
+      syscall(__NR_io_uring_setup, static_cast<unsigned>(entries), &params));
+    if (ring_descriptor < 0) {
+      throw std::runtime_error("io_uring is not available: " + get_error_string(errno));
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ring = map(sq_ring_size, IORING_OFF_SQ_RING);
+    cq_ring = map(cq_ring_size, IORING_OFF_CQ_RING);
+    sqes = reinterpret_cast<io_uring_sqe *>(map(sqes_size, IORING_OFF_SQES));
+    if (!sq_ring || !cq_ring || !sqes) {
+      const auto error = get_error_string(errno);
+      release();
+      throw std::runtime_error("io_uring cannot be mapped: " + error);
+    }
+
+    sq_tail = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned *>(sq_ring + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned *>(cq_ring + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq_ring + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned *>(cq_ring + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq_ring + params.cq_off.cqes);
+  }
+
+  ~Ring()
+  {
+    release();
+  }
+
+  uint8_t * map(size_t size, off_t offset) const
+  {
+    const auto data = mmap(
+      nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_descriptor, offset);
+    return data == MAP_FAILED ? nullptr : static_cast<uint8_t *>(data);
+  }
+
+  void release()
+  {
+    if (sqes) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring) {
+      munmap(sq_ring, sq_ring_size);
+    }
+    close(ring_descriptor);
+  }
+
+  // Queues a write without handing it to the kernel yet.
+  void prepare_write(size_t request_index, uint8_t * data, size_t size, uint64_t offset)
+  {
+    // Only this thread writes the tail, the kernel reads it.
+    const auto tail = *sq_tail;
+    const auto index = tail & sq_mask;
+    auto & sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    // Writing with an iovec works on all kernels with io_uring, plain writes need Linux 5.6.
+    iovecs[request_index].iov_base = data;
+    iovecs[request_index].iov_len = size;
+    sqe.opcode = IORING_OP_WRITEV;
+    sqe.fd = file_descriptor;
+    sqe.addr = reinterpret_cast<uint64_t>(&iovecs[request_index]);
+    sqe.len = 1;
+    sqe.off = offset;
+    sqe.user_data = request_index;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  /// Returns the number of writes submitted, or -1 with errno set.
+  int enter(size_t submit_count, size_t min_complete_count)
+  {
+    const unsigned flags = min_complete_count > 0 ? IORING_ENTER_GETEVENTS : 0;
+    return static_cast<int>(
+      syscall(
+        __NR_io_uring_enter, ring_descriptor, static_cast<unsigned>(submit_count),
+        static_cast<unsigned>(min_complete_count), flags, nullptr, 0));
+  }
+
+  int file_descriptor;
+  int ring_descriptor {-1};
+  uint8_t * sq_ring {nullptr};
+  size_t sq_ring_size {0};
+  uint8_t * cq_ring {nullptr};
+  size_t cq_ring_size {0};
+  io_uring_sqe * sqes {nullptr};
+  size_t sqes_size {0};
+  unsigned * sq_tail {nullptr};
+  unsigned sq_mask {0};
+  unsigned * sq_array {nullptr};
+  unsigned * cq_head {nullptr};
+  unsigned * cq_tail {nullptr};
+  unsigned cq_mask {0};
+  io_uring_cqe * cqes {nullptr};
+  // The buffers of the writes, which the kernel reads until the writes are submitted.
+  std::vector<iovec> iovecs;
+};
+#else
+struct WriteQueue::Ring
+{
+};
+#endif
+
+WriteQueue::WriteQueue(int file_descriptor, size_t depth)
+: file_descriptor_(file_descriptor)
+{
+#ifdef ROSBAG2_BINARY_LOG_HAS_IO_URING
+  try {
+    ring_ = std::make_unique<Ring>(file_descriptor, depth);
+    requests_.resize(depth);
+    for (size_t request_index = depth; request_index > 0; --request_index) {
+      free_requests_.push_back(request_index - 1);
+    }
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM(
+      "Writing with pwrite instead of io_uring: " << e.what());
+  }
+#else
+  (void) depth;
+#endif
+}
+
+WriteQueue::~WriteQueue()
+{
+  // The kernel reads the buffers until the writes are completed, so they are waited for even if
+  // writing failed. Errors were reported to the writer, if it waited.
+  try {
+    wait();
+  } catch (const std::runtime_error &) {
+    try {
+      while (in_flight_count_ > 0) {
+        wait_for_completion();
+      }
+    } catch (const std::runtime_error &) {
+    }
+  }
+}
+
+bool WriteQueue::is_asynchronous() const
+{
+  return ring_ != nullptr;
+}
+
+void WriteQueue::push(AlignedBuffer buffer, size_t size, uint64_t offset)
+{
+  if (!error_.empty()) {
+    throw std::runtime_error(error_);
+  }
+  if (!ring_) {
+    const auto start_time = std::chrono::steady_clock::now();
+    write_synchronously(buffer.get(), size, offset);
+    latency_histogram_.add(std::chrono::steady_clock::now() - start_time);
+    return;
+  }
+
+#ifdef ROSBAG2_BINARY_LOG_HAS_IO_URING
+  while (free_requests_.empty()) {
+    submit();
+    wait_for_completion();
+  }
+  const auto request_index = free_requests_.back();
+  free_requests_.pop_back();
+  auto & request = requests_[request_index];
+  request.size = size;
+  request.offset = offset;
+  ring_->prepare_write(request_index, buffer.get(), size, offset);
+  request.buffer = std::move(buffer);
+  queued_requests_.push_back(request_index);
+#endif
+}
+
+void WriteQueue::submit()
+{
+#ifdef ROSBAG2_BINARY_LOG_HAS_IO_URING
+  size_t submitted_count = 0;
+  while (submitted_count < queued_requests_.size()) {
+    const auto submit_time = std::chrono::steady_clock::now();
+    const auto result = ring_->enter(queued_requests_.size() - submitted_count, 0);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      queued_requests_.erase(
+        queued_requests_.begin(), queued_requests_.begin() + submitted_count);
+      throw std::runtime_error("Failed to submit writes: " + get_error_string(errno));
+    }
+    // The kernel takes the queued writes in order.
+    for (int index = 0; index < result; ++index) {
+      requests_[queued_requests_[submitted_count++]].submit_time = submit_time;
+    }
+    in_flight_count_ += static_cast<size_t>(result);
+  }
+  queued_requests_.clear();
+#endif
+}
+
+void WriteQueue::wait()
+{
+  if (ring_) {
+    submit();
+    while (in_flight_count_ > 0) {
+      wait_for_completion();
+    }
+  }
+  if (!error_.empty()) {
+    throw std::runtime_error(error_);
+  }
+}
+
+void WriteQueue::wait_for_completion()
+{
+#ifdef ROSBAG2_BINARY_LOG_HAS_IO_URING
+  auto head = *ring_->cq_head;
+  while (head == __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE)) {
+    if (ring_->enter(0, 1) < 0 && errno != EINTR) {
+      throw std::runtime_error("Failed to wait for writes: " + get_error_string(errno));
+    }
+  }
+  // Takes all completions at once.
+  while (head != __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE)) {
+    const auto & cqe = ring_->cqes[head & ring_->cq_mask];
+    const auto request_index = static_cast<size_t>(cqe.user_data);
+    const auto result = static_cast<int64_t>(cqe.res);
+    ++head;
+    __atomic_store_n(ring_->cq_head, head, __ATOMIC_RELEASE);
+    complete(request_index, result);
+  }
+#endif
+}
+
+void WriteQueue::complete(size_t request_index, int64_t result)
+{
+  auto & request = requests_[request_index];
+  latency_histogram_.add(std::chrono::steady_clock::now() - request.submit_time);
+  --in_flight_count_;
+  if (result < 0) {
+    if (error_.empty()) {
+      error_ = "Failed to write: " + get_error_string(static_cast<int>(-result));
+    }
+  } else if (static_cast<size_t>(result) < request.size) {
+    // Writes of regular files are only cut short by errors, which the rest of the write reports.
+    try {
+      write_synchronously(
+        request.buffer.get() + result, request.size - static_cast<size_t>(result),
+        request.offset + static_cast<uint64_t>(result));
+    } catch (const std::runtime_error & e) {
+      if (error_.empty()) {
+        error_ = e.what();
+      }
+    }
+  }
+  request.buffer.reset();
+  free_requests_.push_back(request_index);
+}
+
+void WriteQueue::write_synchronously(const uint8_t * data, size_t size, uint64_t offset)
+{
+#ifdef _WIN32
+  (void) data;
+  (void) size;
+  (void) offset;
+  throw std::runtime_error("Failed to write: pwrite is not supported on this platform.");
+#else
+  size_t written_size = 0;
+  while (written_size < size) {
+    const auto result = pwrite(
+      file_descriptor_, data + written_size, size - written_size,
+      static_cast<off_t>(offset + written_size));
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Failed to write: " + get_error_string(errno));
+    }
+    written_size += static_cast<size_t>(result);
+  }
+#endif
+}
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
@@ -0,0 +1,138 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__WRITE_QUEUE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__WRITE_QUEUE_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aligned_buffer_pool.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace binary_log
+{
+
+/// Histogram of the time from submitting a write to its completion, in powers of two of µs.
+class WriteLatencyHistogram
+{
+public:
+  void add(std::chrono::steady_clock::duration latency);
+
+  uint64_t get_count() const
+  {
+    return count_;
+  }
+
+  /// Upper bound of the bucket holding the given quantile, e.g. 0.99, in microseconds.
+  uint64_t get_quantile_us(double quantile) const;
+
+  uint64_t get_max_us() const
+  {
+    return max_us_;
+  }
+
+  /// Summary for logging, e.g. "120 writes, p50 <= 512 us, p99 <= 4096 us, max 3900 us".
+  std::string to_string() const;
+
+private:
+  std::array<uint64_t, 40> bucket_counts_ {};
+  uint64_t count_ {0};
+  uint64_t max_us_ {0};
+};
+
+/**
+ * Writes of aligned buffers to a file, several of which are kept in flight at once.
+ *
+ * On Linux the writes are submitted to the kernel with io_uring in batches, so writing does not
+ * block until all writes in flight are taken. On other platforms, older kernels, or if
+ * io_uring is not permitted, every write is done with pwrite when pushed.
+ */
+class WriteQueue
+{
+public:
+  /// \param depth Maximum number of writes in flight.
+  WriteQueue(int file_descriptor, size_t depth);
+
+  /// Waits for the writes in flight, ignoring their errors.
+  ~WriteQueue();
+
+  WriteQueue(const WriteQueue &) = delete;
+  WriteQueue & operator=(const WriteQueue &) = delete;
+
+  bool is_asynchronous() const;
+
+  /**
+   * Queues writing the first size bytes of the buffer at the offset of the file, the buffer is
+   * released when written. Waits for a write to complete if depth writes are in flight.
+   * \throws std::runtime_error if a previous write failed.
+   */
+  void push(AlignedBuffer buffer, size_t size, uint64_t offset);
+
+  /**
+   * Hands the queued writes to the kernel at once.
+   * \throws std::runtime_error if submitting fails.
+   */
+  void submit();
+
+  /**
+   * Submits the queued writes and waits for all writes in flight.
+   * \throws std::runtime_error if a write failed.
+   */
+  void wait();
+
+  const WriteLatencyHistogram & get_latency_histogram() const
+  {
+    return latency_histogram_;
+  }
+
+private:
+  // The io_uring instance, which is null if writes are done with pwrite.
+  struct Ring;
+
+  struct Request
+  {
+    AlignedBuffer buffer;
+    size_t size;
+    uint64_t offset;
+    std::chrono::steady_clock::time_point submit_time;
+  };
+
+  void write_synchronously(const uint8_t * data, size_t size, uint64_t offset);
+
+  void wait_for_completion();
+  void complete(size_t request_index, int64_t result);
+
+  int file_descriptor_;
+  std::unique_ptr<Ring> ring_;
+  std::vector<Request> requests_;
+  std::vector<size_t> free_requests_;
+  // Requests queued in the ring but not submitted yet, in the order of queueing.
+  std::vector<size_t> queued_requests_;
+  size_t in_flight_count_ {0};
+  // The error of the first failed write, empty if all writes succeeded.
+  std::string error_;
+  WriteLatencyHistogram latency_histogram_;
+};
+
+}  // namespace binary_log
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__BINARY_LOG__WRITE_QUEUE_HPP_
@@ -0,0 +1,128 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# include <nmmintrin.h>
+# define ROSBAG2_STORAGE_DEFAULT_PLUGINS_CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+# include <arm_acle.h>
+# define ROSBAG2_STORAGE_DEFAULT_PLUGINS_CRC32C_ARMV8
+#endif
+
+namespace rosbag2_storage_plugins
+{
+
+namespace
+{
+using Crc32cTables = std::array<std::array<uint32_t, 256>, 8>;
+
+// Table k continues the CRC over k zero bytes following the byte, for 8 bytes per step.
+Crc32cTables make_crc32c_tables()
+{
+  Crc32cTables tables;
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t value = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      value = (value & 1u) ? (0x82F63B78u ^ (value >> 1)) : (value >> 1);
+    }
+    tables[0][i] = value;
+  }
+  for (size_t k = 1; k < tables.size(); ++k) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFFu];
+    }
+  }
+  return tables;
+}
+
+#if defined(ROSBAG2_STORAGE_DEFAULT_PLUGINS_CRC32C_SSE42)
+__attribute__((target("sse4.2")))
+uint32_t update_crc32c_with_instructions(uint32_t crc, const uint8_t * data, size_t size)
+{
+  uint64_t value = ~crc;
+  for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    value = _mm_crc32_u64(value, word);
+  }
+  auto value32 = static_cast<uint32_t>(value);
+  for (; size > 0; ++data, --size) {
+    value32 = _mm_crc32_u8(value32, *data);
+  }
+  return ~value32;
+}
+
+bool has_crc32c_instructions()
+{
+  return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(ROSBAG2_STORAGE_DEFAULT_PLUGINS_CRC32C_ARMV8)
+uint32_t update_crc32c_with_instructions(uint32_t crc, const uint8_t * data, size_t size)
+{
+  crc = ~crc;
+  for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; size > 0; ++data, --size) {
+    crc = __crc32cb(crc, *data);
+  }
+  return ~crc;
+}
+
+bool has_crc32c_instructions()
+{
+  // The compiler was told that every processor the code runs on has them.
+  return true;
+}
+#endif
+}  // namespace
+
+uint32_t update_crc32c(uint32_t crc, const uint8_t * data, size_t size)
+{
+#if defined(ROSBAG2_STORAGE_DEFAULT_PLUGINS_CRC32C_SSE42) || \
+  defined(ROSBAG2_STORAGE_DEFAULT_PLUGINS_CRC32C_ARMV8)
+  static const bool use_instructions = has_crc32c_instructions();
+  if (use_instructions) {
+    return update_crc32c_with_instructions(crc, data, size);
+  }
+#endif
+  return update_crc32c_without_instructions(crc, data, size);
+}
+
+uint32_t update_crc32c_without_instructions(uint32_t crc, const uint8_t * data, size_t size)
+{
+  static const auto tables = make_crc32c_tables();
+  crc = ~crc;
+  for (; size >= 8; data += 8, size -= 8) {
+    const uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |
+      static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 |
+      static_cast<uint32_t>(data[3]) << 24);
+    crc = tables[7][low & 0xFFu] ^ tables[6][(low >> 8) & 0xFFu] ^
+      tables[5][(low >> 16) & 0xFFu] ^ tables[4][low >> 24] ^
+      tables[3][data[4]] ^ tables[2][data[5]] ^ tables[1][data[6]] ^ tables[0][data[7]];
+  }
+  for (; size > 0; ++data, --size) {
+    crc = tables[0][(crc ^ *data) & 0xFFu] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+}  // namespace rosbag2_storage_plugins
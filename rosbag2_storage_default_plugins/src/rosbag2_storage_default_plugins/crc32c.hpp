@@ -0,0 +1,41 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__CRC32C_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__CRC32C_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+namespace rosbag2_storage_plugins
+{
+
+/**
+ * Continues the CRC-32C (Castagnoli) of the data preceding this data.
+ *
+ * Uses the CRC32 instructions of SSE 4.2 on x86-64 and of ARMv8 if the processor has them,
+ * which checksum several bytes per cycle, and a table otherwise.
+ */
+ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC
+uint32_t update_crc32c(uint32_t crc, const uint8_t * data, size_t size);
+
+/// The table based implementation of update_crc32c(), used without CRC32 instructions.
+ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC
+uint32_t update_crc32c_without_instructions(uint32_t crc, const uint8_t * data, size_t size);
+
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__CRC32C_HPP_
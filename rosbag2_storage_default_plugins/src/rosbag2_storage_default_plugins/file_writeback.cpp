@@ -0,0 +1,165 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "file_writeback.hpp"
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "logging.hpp"
+
+namespace rosbag2_storage_plugins
+{
+
+namespace
+{
+#ifndef _WIN32
+// Reserves the disk space without changing the size of the file.
+bool allocate_file_space(int file_descriptor, uint64_t size)
+{
+# if defined(__linux__)
+  return fallocate(file_descriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0;
+# elif defined(__APPLE__)
+  fstore_t store {};
+  store.fst_flags = F_ALLOCATECONTIG | F_ALLOCATEALL;
+  store.fst_posmode = F_PEOFPOSMODE;
+  store.fst_length = static_cast<off_t>(size);
+  if (fcntl(file_descriptor, F_PREALLOCATE, &store) == 0) {
+    return true;
+  }
+  // Contiguous space is a preference, not a requirement.
+  store.fst_flags = F_ALLOCATEALL;
+  return fcntl(file_descriptor, F_PREALLOCATE, &store) == 0;
+# else
+  (void) file_descriptor;
+  (void) size;
+  errno = ENOTSUP;
+  return false;
+# endif
+}
+#endif
+}  // namespace
+
+FileWriteback::FileWriteback(
+  const std::string & path, uint64_t preallocate_size, uint64_t writeback_interval)
+: path_(path), writeback_interval_(writeback_interval)
+{
+  if (preallocate_size == 0 && writeback_interval == 0) {
+    return;
+  }
+#ifdef _WIN32
+  (void) preallocate_size;
+  writeback_interval_ = 0;
+  ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+    "Preallocating and writing back '" << path_ << "' is not supported on this platform.");
+#else
+  file_descriptor_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+  if (file_descriptor_ < 0) {
+    writeback_interval_ = 0;
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+      "Failed to open '" << path_ << "' to preallocate and write it back: " <<
+        std::strerror(errno) << ".");
+    return;
+  }
+  if (preallocate_size > 0) {
+    is_preallocated_ = allocate_file_space(file_descriptor_, preallocate_size);
+    if (!is_preallocated_) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+        "Failed to preallocate " << preallocate_size << " bytes for '" << path_ << "': " <<
+          std::strerror(errno) << ".");
+    }
+  }
+#endif
+}
+
+FileWriteback::~FileWriteback()
+{
+#ifndef _WIN32
+  if (file_descriptor_ < 0) {
+    return;
+  }
+  struct stat file_status;
+  if (fstat(file_descriptor_, &file_status) == 0) {
+    const auto file_size = static_cast<uint64_t>(file_status.st_size);
+    if (writeback_interval_ > 0 && file_size > written_back_size_) {
+      start_writeback(file_size);
+    }
+    // Truncating to the size the file has frees the blocks reserved beyond it.
+    if (is_preallocated_ && ftruncate(file_descriptor_, file_status.st_size) != 0) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+        "Failed to release the space preallocated for '" << path_ << "': " <<
+          std::strerror(errno) << ".");
+    }
+  }
+  ::close(file_descriptor_);
+#endif
+}
+
+void FileWriteback::update()
+{
+#ifndef _WIN32
+  if (writeback_interval_ == 0) {
+    return;
+  }
+  struct stat file_status;
+  if (fstat(file_descriptor_, &file_status) != 0) {
+    return;
+  }
+  const auto file_size = static_cast<uint64_t>(file_status.st_size);
+  if (file_size >= written_back_size_ + writeback_interval_) {
+    start_writeback(file_size);
+  }
+#endif
+}
+
+void FileWriteback::start_writeback(uint64_t file_size)
+{
+#if defined(__linux__)
+  // Waiting for the previous range throttles the writer to the speed of the disk, a little
+  // at a time, instead of all at once when the kernel runs out of dirty pages.
+  auto result = writeback_size_ == 0 ? 0 : sync_file_range(
+    file_descriptor_, static_cast<off_t>(writeback_offset_), static_cast<off_t>(writeback_size_),
+    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+  if (result == 0) {
+    writeback_offset_ = written_back_size_;
+    writeback_size_ = file_size - written_back_size_;
+    result = sync_file_range(
+      file_descriptor_, static_cast<off_t>(writeback_offset_),
+      static_cast<off_t>(writeback_size_), SYNC_FILE_RANGE_WRITE);
+  }
+#elif !defined(_WIN32)
+  // Without writing back a range of the file, all of it is written back and waited for.
+  const auto result = fsync(file_descriptor_);
+#else
+  const int result = 0;
+#endif
+  if (result != 0) {
+    writeback_interval_ = 0;
+    ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+      "Failed to write back '" << path_ << "', leaving it to the kernel: " <<
+        std::strerror(errno) << ".");
+    return;
+  }
+  written_back_size_ = file_size;
+}
+
+}  // namespace rosbag2_storage_plugins
@@ -0,0 +1,82 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__FILE_WRITEBACK_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__FILE_WRITEBACK_HPP_
+
+#include <cstdint>
+#include <string>
+
+#include "rosbag2_storage_default_plugins/visibility_control.hpp"
+
+namespace rosbag2_storage_plugins
+{
+
+/**
+ * Controls how the disk space of a file being appended to is allocated and how its data is
+ * written back by the kernel.
+ *
+ * Disk space reserved up front keeps a file growing by small appends from being fragmented.
+ * It is reserved without changing the size of the file, so readers and the size checked for
+ * splitting only see the data written, and what is not used is released again.
+ *
+ * Writing back the data appended every writeback interval bytes keeps the kernel from
+ * accumulating dirty pages and stalling the writes once it flushes them all at once, e.g. on
+ * a commit or when the file is split. The writeback of an interval is only waited for once
+ * the next one is started, which keeps about two intervals of the file dirty.
+ *
+ * Both are best effort: if the platform or the file system does not support them, a warning
+ * is logged and the file is written as usual.
+ */
+class ROSBAG2_STORAGE_DEFAULT_PLUGINS_PUBLIC FileWriteback
+{
+public:
+  /**
+   * Opens the existing file and reserves preallocate_size bytes of disk space for it.
+   * A preallocate_size of zero reserves none, and a writeback_interval of zero leaves writing
+   * back the data to the kernel.
+   */
+  FileWriteback(const std::string & path, uint64_t preallocate_size, uint64_t writeback_interval);
+
+  /// Starts writing back the remaining data and releases the space reserved beyond the file.
+  ~FileWriteback();
+
+  FileWriteback(const FileWriteback &) = delete;
+  FileWriteback & operator=(const FileWriteback &) = delete;
+
+  /// Called after writing to the file, starts writing back the data written since if enough.
+  void update();
+
+  bool is_preallocated() const
+  {
+    return is_preallocated_;
+  }
+
+private:
+  void start_writeback(uint64_t file_size);
+
+  std::string path_;
+  int file_descriptor_ {-1};
+  uint64_t writeback_interval_ {0};
+  bool is_preallocated_ {false};
+  // The data up to here was handed to the kernel to write back.
+  uint64_t written_back_size_ {0};
+  // Range of the last writeback started, which is waited for before starting the next one.
+  uint64_t writeback_offset_ {0};
+  uint64_t writeback_size_ {0};
+};
+
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__FILE_WRITEBACK_HPP_
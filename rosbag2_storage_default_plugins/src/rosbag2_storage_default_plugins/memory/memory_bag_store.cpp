@@ -0,0 +1,130 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage_default_plugins/memory/memory_bag_store.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "memory_file.hpp"
+
+namespace rosbag2_storage_plugins
+{
+
+MemoryBagStore & MemoryBagStore::get_instance()
+{
+  // Never destroyed, so chunks released at exit still find the store.
+  static auto instance = new MemoryBagStore();
+  return *instance;
+}
+
+MemoryBagStore::MemoryBagStore() = default;
+
+void MemoryBagStore::set_max_bytes(uint64_t max_bytes)
+{
+  max_bytes_ = max_bytes;
+}
+
+uint64_t MemoryBagStore::get_max_bytes() const
+{
+  return max_bytes_;
+}
+
+uint64_t MemoryBagStore::get_size_bytes() const
+{
+  return size_bytes_;
+}
+
+bool MemoryBagStore::contains(const std::string & path) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return files_.find(path) != files_.end();
+}
+
+void MemoryBagStore::remove(const std::string & path)
+{
+  std::shared_ptr<memory::MemoryFile> file;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto file_it = files_.find(path);
+    if (file_it == files_.end()) {
+      return;
+    }
+    file = std::move(file_it->second);
+    files_.erase(file_it);
+  }
+  // The chunks of the file are released here, unless a storage still has it open.
+}
+
+void MemoryBagStore::clear()
+{
+  std::unordered_map<std::string, std::shared_ptr<memory::MemoryFile>> files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files.swap(files_);
+  }
+}
+
+std::shared_ptr<memory::MemoryFile> MemoryBagStore::create_file(const std::string & path)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto & file = files_[path];
+  if (file) {
+    throw std::runtime_error("Failed to create bag: File '" + path + "' already exists!");
+  }
+  file = std::make_shared<memory::MemoryFile>();
+  return file;
+}
+
+std::shared_ptr<memory::MemoryFile> MemoryBagStore::open_file(const std::string & path) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto file_it = files_.find(path);
+  if (file_it == files_.end()) {
+    throw std::runtime_error("Failed to read from bag: File '" + path + "' does not exist!");
+  }
+  return file_it->second;
+}
+
+std::shared_ptr<std::vector<uint8_t>> MemoryBagStore::allocate_chunk(size_t size)
+{
+  auto size_bytes = size_bytes_.load();
+  do {
+    const auto max_bytes = max_bytes_.load();
+    if (max_bytes > 0 && size_bytes + size > max_bytes) {
+      throw std::runtime_error(
+              "Memory bag store limit of " + std::to_string(max_bytes) + " bytes exceeded.");
+    }
+  } while (!size_bytes_.compare_exchange_weak(size_bytes, size_bytes + size));
+
+  std::unique_ptr<std::vector<uint8_t>> chunk;
+  try {
+    chunk = std::make_unique<std::vector<uint8_t>>();
+    chunk->resize(size);
+  } catch (...) {
+    size_bytes_ -= size;
+    throw;
+  }
+  return std::shared_ptr<std::vector<uint8_t>>(
+    chunk.release(),
+    [this, size](std::vector<uint8_t> * chunk) {
+      size_bytes_ -= size;
+      delete chunk;
+    });
+}
+
+}  // namespace rosbag2_storage_plugins
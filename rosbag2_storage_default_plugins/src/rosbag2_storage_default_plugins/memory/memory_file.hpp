@@ -0,0 +1,67 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_FILE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_FILE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/time.h"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace memory
+{
+
+struct MemoryTopic
+{
+  rosbag2_storage::TopicMetadata metadata;
+  bool removed;
+  uint64_t message_count;
+  rcutils_time_point_value_t min_timestamp;
+  rcutils_time_point_value_t max_timestamp;
+};
+
+struct MemoryEntry
+{
+  uint32_t topic_id;
+  rcutils_time_point_value_t time_stamp;
+  rcutils_time_point_value_t publish_time_stamp;
+  uint32_t chunk_number;
+  size_t offset;
+  size_t size;
+};
+
+// Messages of a file in the memory bag store, shared by the storages which have it open.
+struct MemoryFile
+{
+  std::mutex mutex;
+  std::vector<MemoryTopic> topics;
+  std::unordered_map<std::string, uint32_t> topic_ids;
+  // Chunks are never resized, so the data of the entries never moves.
+  std::vector<std::shared_ptr<std::vector<uint8_t>>> chunks;
+  std::vector<MemoryEntry> entries;
+  uint64_t size_bytes {0};
+};
+
+}  // namespace memory
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__MEMORY__MEMORY_FILE_HPP_
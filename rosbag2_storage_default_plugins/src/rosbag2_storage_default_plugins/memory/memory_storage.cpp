@@ -0,0 +1,402 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage_default_plugins/memory/memory_storage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage_default_plugins/memory/memory_bag_store.hpp"
+
+#include "memory_file.hpp"
+#include "../logging.hpp"
+
+namespace
+{
+constexpr const auto FILE_EXTENSION = ".mem";
+}  // namespace
+
+namespace rosbag2_storage_plugins
+{
+
+using memory::MemoryEntry;
+using memory::MemoryFile;
+
+MemoryStorage::MemoryStorage() = default;
+
+MemoryStorage::~MemoryStorage() = default;
+
+void MemoryStorage::open(
+  const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag)
+{
+  open(uri, io_flag, rosbag2_storage::StorageConfig{});
+}
+
+void MemoryStorage::open(
+  const std::string & uri,
+  rosbag2_storage::storage_interfaces::IOFlag io_flag,
+  const rosbag2_storage::StorageConfig & storage_config)
+{
+  if (!storage_config.preset_profile.empty()) {
+    throw std::runtime_error(
+            "Unknown memory storage preset profile '" + storage_config.preset_profile + "'.");
+  }
+  if (storage_config.memory_chunk_size == 0) {
+    throw std::runtime_error("The chunk size of the memory storage must not be 0.");
+  }
+
+  file_.reset();
+  topic_ids_by_handle_.clear();
+  chunk_.reset();
+  chunk_used_ = 0;
+  chunk_size_ = static_cast<size_t>(storage_config.memory_chunk_size);
+  is_reading_prepared_ = false;
+  entries_to_read_.clear();
+  next_entry_to_read_ = 0;
+
+  auto & store = MemoryBagStore::get_instance();
+  if (storage_config.memory_max_bytes > 0) {
+    store.set_max_bytes(storage_config.memory_max_bytes);
+  }
+  if (io_flag == rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE) {
+    relative_path_ = uri + FILE_EXTENSION;
+    file_ = store.create_file(relative_path_);
+  } else {  // APPEND and READ_ONLY
+    relative_path_ = uri;
+    file_ = store.open_file(relative_path_);
+  }
+  is_writable_ = io_flag != rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY;
+
+  ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+    "Opened memory bag file '" << relative_path_ << "' for " <<
+    (is_writable_ ? "writing" : "reading") << ".");
+}
+
+void MemoryStorage::create_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  if (file_->topic_ids.find(topic.name) != file_->topic_ids.end()) {
+    return;
+  }
+  const auto topic_id = static_cast<uint32_t>(file_->topics.size());
+  file_->topics.push_back({topic, false, 0, 0, 0});
+  file_->topic_ids.emplace(topic.name, topic_id);
+}
+
+void MemoryStorage::set_topic_handle(
+  const std::string & topic_name, rosbag2_storage::TopicHandle handle)
+{
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  const auto topic_id = file_->topic_ids.find(topic_name);
+  if (handle < 0 || topic_id == file_->topic_ids.end()) {
+    return;
+  }
+  const auto index = static_cast<size_t>(handle);
+  if (index >= topic_ids_by_handle_.size()) {
+    topic_ids_by_handle_.resize(index + 1, -1);
+  }
+  topic_ids_by_handle_[index] = topic_id->second;
+}
+
+void MemoryStorage::remove_topic(const rosbag2_storage::TopicMetadata & topic)
+{
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  const auto topic_id = file_->topic_ids.find(topic.name);
+  if (topic_id == file_->topic_ids.end()) {
+    return;
+  }
+  file_->topics[topic_id->second].removed = true;
+  file_->topic_ids.erase(topic_id);
+}
+
+uint32_t MemoryStorage::get_topic_id(const rosbag2_storage::SerializedBagMessage & message) const
+{
+  const auto handle = message.topic_handle;
+  if (handle >= 0 && static_cast<size_t>(handle) < topic_ids_by_handle_.size()) {
+    const auto topic_id = topic_ids_by_handle_[static_cast<size_t>(handle)];
+    if (topic_id >= 0 && !file_->topics[static_cast<size_t>(topic_id)].removed) {
+      return static_cast<uint32_t>(topic_id);
+    }
+  }
+
+  const auto topic_id = file_->topic_ids.find(message.topic_name);
+  if (topic_id == file_->topic_ids.end()) {
+    throw std::runtime_error(
+            "Topic '" + message.topic_name +
+            "' has not been created yet! Call 'create_topic' first.");
+  }
+  return topic_id->second;
+}
+
+void MemoryStorage::write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
+{
+  if (!is_writable_) {
+    throw std::runtime_error("Memory bag file '" + relative_path_ + "' is not open for writing.");
+  }
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  write_locked(*message);
+}
+
+void MemoryStorage::write(
+  const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
+{
+  if (!is_writable_) {
+    throw std::runtime_error("Memory bag file '" + relative_path_ + "' is not open for writing.");
+  }
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  for (const auto & message : messages) {
+    write_locked(*message);
+  }
+}
+
+void MemoryStorage::write_locked(const rosbag2_storage::SerializedBagMessage & message)
+{
+  const auto topic_id = get_topic_id(message);
+  // Messages without publish time stamp are ordered by their receive time.
+  const auto publish_time_stamp =
+    message.publish_time_stamp != 0 ? message.publish_time_stamp : message.time_stamp;
+  const auto & data = message.serialized_data;
+  const size_t data_size = data ? data->buffer_length : 0;
+
+  if (!chunk_ || chunk_->size() - chunk_used_ < data_size) {
+    chunk_ = MemoryBagStore::get_instance().allocate_chunk(std::max(chunk_size_, data_size));
+    chunk_used_ = 0;
+    file_->chunks.push_back(chunk_);
+  }
+  const auto offset = chunk_used_;
+  if (data_size > 0) {
+    std::memcpy(chunk_->data() + offset, data->buffer, data_size);
+    chunk_used_ += data_size;
+  }
+  file_->entries.push_back(
+    {topic_id, message.time_stamp, publish_time_stamp,
+      static_cast<uint32_t>(file_->chunks.size() - 1), offset, data_size});
+  file_->size_bytes += data_size;
+
+  auto & topic = file_->topics[topic_id];
+  topic.min_timestamp = topic.message_count == 0 ?
+    message.time_stamp : std::min(topic.min_timestamp, message.time_stamp);
+  topic.max_timestamp = topic.message_count == 0 ?
+    message.time_stamp : std::max(topic.max_timestamp, message.time_stamp);
+  ++topic.message_count;
+}
+
+bool MemoryStorage::has_next()
+{
+  if (!is_reading_prepared_) {
+    prepare_for_reading();
+  }
+  return next_entry_to_read_ < entries_to_read_.size();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> MemoryStorage::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("No more messages in memory bag file '" + relative_path_ + "'.");
+  }
+
+  MemoryEntry entry;
+  const uint8_t * data = nullptr;
+  std::shared_ptr<std::vector<uint8_t>> chunk;
+  auto bag_message = message_pool_ ?
+    message_pool_->make_message() : std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  {
+    std::lock_guard<std::mutex> lock(file_->mutex);
+    entry = file_->entries[entries_to_read_[next_entry_to_read_++]];
+    // Chunks are never resized and bytes already written to them never change, so the message
+    // references the chunk instead of a copy of its data, and keeps the chunk alive.
+    chunk = file_->chunks[entry.chunk_number];
+    data = chunk->data() + entry.offset;
+    bag_message->topic_name = file_->topics[entry.topic_id].metadata.name;
+  }
+
+  bag_message->serialized_data =
+    rosbag2_storage::make_serialized_data_view({data, entry.size, chunk});
+  bag_message->time_stamp = entry.time_stamp;
+  bag_message->publish_time_stamp = entry.publish_time_stamp;
+  return bag_message;
+}
+
+void MemoryStorage::prepare_for_reading()
+{
+  const auto start_time = std::max(seek_time_, storage_filter_.start_time);
+  const bool by_publish_time = storage_filter_.order_by_publish_time;
+  const auto get_order_timestamp = [by_publish_time](const MemoryEntry & entry) {
+      return by_publish_time ? entry.publish_time_stamp : entry.time_stamp;
+    };
+
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter_);
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  std::vector<bool> is_selected_topic(file_->topics.size());
+  std::vector<std::vector<rosbag2_storage::TopicFilter::TimeRange>> topic_time_ranges(
+    file_->topics.size());
+  for (size_t topic_id = 0; topic_id < file_->topics.size(); ++topic_id) {
+    const auto & topic = file_->topics[topic_id].metadata;
+    is_selected_topic[topic_id] = topic_filter.is_selected(topic.name, topic.type);
+    topic_time_ranges[topic_id] = topic_filter.get_time_ranges(topic.name);
+  }
+
+  entries_to_read_.clear();
+  for (size_t entry_number = 0; entry_number < file_->entries.size(); ++entry_number) {
+    const auto & entry = file_->entries[entry_number];
+    const auto timestamp = get_order_timestamp(entry);
+    if (is_selected_topic[entry.topic_id] &&
+      (start_time <= 0 || timestamp >= start_time) &&
+      (storage_filter_.end_time <= 0 || timestamp <= storage_filter_.end_time) &&
+      rosbag2_storage::TopicFilter::is_within(topic_time_ranges[entry.topic_id], timestamp))
+    {
+      entries_to_read_.push_back(entry_number);
+    }
+  }
+  const auto & entries = file_->entries;
+  const auto is_earlier = [&entries, &get_order_timestamp](size_t lhs, size_t rhs) {
+      return get_order_timestamp(entries[lhs]) < get_order_timestamp(entries[rhs]);
+    };
+  // Messages are usually written in time stamp order already.
+  if (!std::is_sorted(entries_to_read_.begin(), entries_to_read_.end(), is_earlier)) {
+    std::stable_sort(entries_to_read_.begin(), entries_to_read_.end(), is_earlier);
+  }
+  next_entry_to_read_ = 0;
+  is_reading_prepared_ = true;
+}
+
+std::vector<rosbag2_storage::TopicMetadata> MemoryStorage::get_all_topics_and_types()
+{
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  std::vector<rosbag2_storage::TopicMetadata> topics_and_types;
+  for (const auto & topic : file_->topics) {
+    if (!topic.removed) {
+      topics_and_types.push_back(topic.metadata);
+    }
+  }
+  return topics_and_types;
+}
+
+rosbag2_storage::BagMetadata MemoryStorage::get_metadata()
+{
+  rosbag2_storage::BagMetadata metadata;
+  metadata.storage_identifier = get_storage_identifier();
+  metadata.relative_file_paths = {get_relative_file_path()};
+  metadata.message_count = 0;
+  metadata.topics_with_message_count = {};
+  metadata.bag_size = get_bagfile_size();
+
+  rcutils_time_point_value_t min_time = INT64_MAX;
+  rcutils_time_point_value_t max_time = 0;
+  {
+    std::lock_guard<std::mutex> lock(file_->mutex);
+    for (const auto & topic : file_->topics) {
+      if (topic.removed || topic.message_count == 0) {
+        continue;
+      }
+      metadata.topics_with_message_count.push_back(
+        {topic.metadata, static_cast<size_t>(topic.message_count)});
+      metadata.message_count += topic.message_count;
+      min_time = std::min(min_time, topic.min_timestamp);
+      max_time = std::max(max_time, topic.max_timestamp);
+    }
+  }
+  std::sort(
+    metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+    [](const rosbag2_storage::TopicInformation & lhs,
+    const rosbag2_storage::TopicInformation & rhs) {
+      return lhs.topic_metadata.name < rhs.topic_metadata.name;
+    });
+
+  if (metadata.message_count == 0) {
+    min_time = 0;
+    max_time = 0;
+  }
+
+  metadata.starting_time =
+    std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(min_time));
+  metadata.duration = std::chrono::nanoseconds(max_time) - std::chrono::nanoseconds(min_time);
+
+  return metadata;
+}
+
+std::string MemoryStorage::get_relative_file_path() const
+{
+  return relative_path_;
+}
+
+uint64_t MemoryStorage::get_bagfile_size() const
+{
+  if (!file_) {
+    return 0u;
+  }
+  std::lock_guard<std::mutex> lock(file_->mutex);
+  return file_->size_bytes;
+}
+
+std::string MemoryStorage::get_storage_identifier() const
+{
+  return "memory";
+}
+
+rosbag2_storage::StorageCapabilities MemoryStorage::get_capabilities() const
+{
+  rosbag2_storage::StorageCapabilities capabilities;
+  // Batches are written while the file is locked once.
+  capabilities.batch_write = true;
+  capabilities.seek = true;
+  capabilities.message_pool = true;
+  return capabilities;
+}
+
+uint64_t MemoryStorage::get_minimum_split_file_size() const
+{
+  return chunk_size_;
+}
+
+void MemoryStorage::set_filter(const rosbag2_storage::StorageFilter & storage_filter)
+{
+  storage_filter_ = storage_filter;
+  is_reading_prepared_ = false;
+}
+
+void MemoryStorage::reset_filter()
+{
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  is_reading_prepared_ = false;
+}
+
+void MemoryStorage::seek(const rcutils_time_point_value_t & timestamp)
+{
+  seek_time_ = timestamp;
+  is_reading_prepared_ = false;
+}
+
+void MemoryStorage::set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool)
+{
+  message_pool_ = std::move(message_pool);
+}
+
+}  // namespace rosbag2_storage_plugins
+
+#include "pluginlib/class_list_macros.hpp"  // NOLINT
+PLUGINLIB_EXPORT_CLASS(
+  rosbag2_storage_plugins::MemoryStorage,
+  rosbag2_storage::storage_interfaces::ReadWriteInterface)
@@ -0,0 +1,136 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "chunk_decompressor.hpp"
+
+#include <bzlib.h>
+#include <lz4frame.h>
+
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rosbag2_cpp/thread_pool.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace ros1_bag
+{
+
+namespace
+{
+constexpr const size_t MAX_THREAD_COUNT = 8;
+
+std::vector<uint8_t> decompress_bz2(
+  const uint8_t * data, size_t size, size_t uncompressed_size)
+{
+  if (size > std::numeric_limits<unsigned int>::max() ||
+    uncompressed_size > std::numeric_limits<unsigned int>::max())
+  {
+    throw std::runtime_error("bz2 chunk is too large.");
+  }
+  std::vector<uint8_t> decompressed(uncompressed_size);
+  auto decompressed_size = static_cast<unsigned int>(uncompressed_size);
+  const auto result = BZ2_bzBuffToBuffDecompress(
+    reinterpret_cast<char *>(decompressed.data()), &decompressed_size,
+    const_cast<char *>(reinterpret_cast<const char *>(data)), static_cast<unsigned int>(size),
+    0, 0);
+  if (result != BZ_OK) {
+    throw std::runtime_error("bz2 decompression error " + std::to_string(result) + ".");
+  }
+  decompressed.resize(decompressed_size);
+  return decompressed;
+}
+
+std::vector<uint8_t> decompress_lz4(
+  const uint8_t * data, size_t size, size_t uncompressed_size)
+{
+  // ROS 1 writes lz4 chunks as a single LZ4 frame.
+  LZ4F_dctx * context = nullptr;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION))) {
+    throw std::runtime_error("Could not create an LZ4 decompression context.");
+  }
+  std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)> context_guard(
+    context, &LZ4F_freeDecompressionContext);
+
+  std::vector<uint8_t> decompressed(uncompressed_size);
+  size_t input_position = 0;
+  size_t output_position = 0;
+  size_t result = 1;
+  while (result != 0 && input_position < size) {
+    auto input_size = size - input_position;
+    auto output_size = decompressed.size() - output_position;
+    result = LZ4F_decompress(
+      context, decompressed.data() + output_position, &output_size, data + input_position,
+      &input_size, nullptr);
+    if (LZ4F_isError(result)) {
+      throw std::runtime_error(
+              std::string("lz4 decompression error: ") + LZ4F_getErrorName(result) + ".");
+    }
+    input_position += input_size;
+    output_position += output_size;
+    if (input_size == 0 && output_size == 0) {
+      break;
+    }
+  }
+  if (result != 0) {
+    throw std::runtime_error("lz4 chunk is truncated or larger than its size.");
+  }
+  decompressed.resize(output_position);
+  return decompressed;
+}
+}  // namespace
+
+std::vector<uint8_t> decompress_chunk(
+  const std::string & compression, const uint8_t * data, size_t size, size_t uncompressed_size)
+{
+  std::vector<uint8_t> decompressed;
+  if (compression == "none") {
+    decompressed.assign(data, data + size);
+  } else if (compression == "bz2") {
+    decompressed = decompress_bz2(data, size, uncompressed_size);
+  } else if (compression == "lz4") {
+    decompressed = decompress_lz4(data, size, uncompressed_size);
+  } else {
+    throw std::runtime_error("Unknown chunk compression '" + compression + "'.");
+  }
+  if (decompressed.size() != uncompressed_size) {
+    throw std::runtime_error(
+            "Chunk decompressed to " + std::to_string(decompressed.size()) + " instead of " +
+            std::to_string(uncompressed_size) + " bytes.");
+  }
+  return decompressed;
+}
+
+std::future<std::vector<uint8_t>> ChunkDecompressor::submit(
+  const std::string & compression, const uint8_t * data, size_t size, size_t uncompressed_size,
+  std::shared_ptr<const void> owner)
+{
+  return rosbag2_cpp::ThreadPool::get_shared().submit(
+    [compression, data, size, uncompressed_size, owner]() {
+      return decompress_chunk(compression, data, size, uncompressed_size);
+    });
+}
+
+size_t ChunkDecompressor::get_thread_count() const
+{
+  return std::min(rosbag2_cpp::ThreadPool::get_shared().get_size(), MAX_THREAD_COUNT);
+}
+
+}  // namespace ros1_bag
+}  // namespace rosbag2_storage_plugins
@@ -0,0 +1,61 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__CHUNK_DECOMPRESSOR_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__CHUNK_DECOMPRESSOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rosbag2_storage_plugins
+{
+namespace ros1_bag
+{
+
+/**
+ * Decompresses the data of a chunk record, compressed with "none", "bz2" or "lz4".
+ * \throws std::runtime_error if the compression is unknown, the data is corrupt, or it does not
+ * decompress to uncompressed_size bytes.
+ */
+std::vector<uint8_t> decompress_chunk(
+  const std::string & compression, const uint8_t * data, size_t size, size_t uncompressed_size);
+
+/**
+ * Decompresses chunks on the thread pool shared by rosbag2, in the order they are submitted, so
+ * the chunks after the one being read are decompressed ahead of the reader.
+ */
+class ChunkDecompressor
+{
+public:
+  /**
+   * Decompresses the data of a chunk, see decompress_chunk(), which the owner keeps alive until
+   * it is decompressed.
+   * \return the future of the decompressed data, or of the exception decompressing it throws.
+   */
+  std::future<std::vector<uint8_t>> submit(
+    const std::string & compression, const uint8_t * data, size_t size,
+    size_t uncompressed_size, std::shared_ptr<const void> owner);
+
+  /// The number of chunks decompressed at once, the threads of the shared pool up to 8.
+  size_t get_thread_count() const;
+};
+
+}  // namespace ros1_bag
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__CHUNK_DECOMPRESSOR_HPP_
@@ -0,0 +1,144 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ros1_bag_format.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../binary_log/binary_log_format.hpp"
+
+namespace rosbag2_storage_plugins
+{
+namespace ros1_bag
+{
+
+using binary_log::BufferReader;
+
+HeaderFields::HeaderFields(const uint8_t * data, size_t size)
+{
+  BufferReader reader(data, size);
+  while (reader.get_remaining() > 0) {
+    const auto field_size = reader.read_uint32();
+    const auto field = reader.read_bytes(field_size);
+    const auto separator = std::find(field, field + field_size, '=');
+    if (separator == field + field_size) {
+      throw std::runtime_error("Record header field has no '='.");
+    }
+    fields_.push_back(
+      {std::string(field, separator), separator + 1,
+        static_cast<size_t>(field + field_size - separator - 1)});
+  }
+}
+
+bool HeaderFields::has(const std::string & name) const
+{
+  return std::any_of(
+    fields_.begin(), fields_.end(), [&name](const Field & field) {
+      return field.name == name;
+    });
+}
+
+const HeaderFields::Field & HeaderFields::get_field(
+  const std::string & name, size_t expected_size) const
+{
+  for (const auto & field : fields_) {
+    if (field.name == name) {
+      if (expected_size > 0 && field.size != expected_size) {
+        throw std::runtime_error("Record header field '" + name + "' has an unexpected size.");
+      }
+      return field;
+    }
+  }
+  throw std::runtime_error("Record header has no field '" + name + "'.");
+}
+
+std::string HeaderFields::get_string(const std::string & name) const
+{
+  const auto & field = get_field(name, 0);
+  return std::string(reinterpret_cast<const char *>(field.value), field.size);
+}
+
+uint8_t HeaderFields::get_uint8(const std::string & name) const
+{
+  return *get_field(name, sizeof(uint8_t)).value;
+}
+
+uint32_t HeaderFields::get_uint32(const std::string & name) const
+{
+  BufferReader reader(get_field(name, sizeof(uint32_t)).value, sizeof(uint32_t));
+  return reader.read_uint32();
+}
+
+uint64_t HeaderFields::get_uint64(const std::string & name) const
+{
+  BufferReader reader(get_field(name, sizeof(uint64_t)).value, sizeof(uint64_t));
+  return reader.read_uint64();
+}
+
+rcutils_time_point_value_t HeaderFields::get_time(const std::string & name) const
+{
+  BufferReader reader(get_field(name, 2 * sizeof(uint32_t)).value, 2 * sizeof(uint32_t));
+  const auto sec = reader.read_uint32();
+  return to_nanoseconds(sec, reader.read_uint32());
+}
+
+Opcode HeaderFields::get_opcode() const
+{
+  return static_cast<Opcode>(get_uint8("op"));
+}
+
+Record read_record(const uint8_t * buffer, size_t size, size_t offset, bool parse_header)
+{
+  if (offset > size) {
+    throw std::runtime_error("Truncated record at offset " + std::to_string(offset) + ".");
+  }
+  try {
+    BufferReader reader(buffer + offset, size - offset);
+    const auto header_size = reader.read_uint32();
+    const auto header = reader.read_bytes(header_size);
+    Record record;
+    if (parse_header) {
+      record.header = HeaderFields(header, header_size);
+    }
+    record.data_size = reader.read_uint32();
+    record.data = reader.read_bytes(record.data_size);
+    record.size = reader.get_position();
+    return record;
+  } catch (const std::runtime_error & e) {
+    throw std::runtime_error(
+            "Invalid record at offset " + std::to_string(offset) + ": " + e.what());
+  }
+}
+
+rcutils_time_point_value_t to_nanoseconds(uint32_t sec, uint32_t nsec)
+{
+  return static_cast<rcutils_time_point_value_t>(sec) * 1000000000 + nsec;
+}
+
+std::string to_ros2_type_name(const std::string & ros1_type_name)
+{
+  const auto separator = ros1_type_name.find('/');
+  if (separator == std::string::npos || ros1_type_name.find('/', separator + 1) !=
+    std::string::npos)
+  {
+    return ros1_type_name;
+  }
+  return ros1_type_name.substr(0, separator) + "/msg/" + ros1_type_name.substr(separator + 1);
+}
+
+}  // namespace ros1_bag
+}  // namespace rosbag2_storage_plugins
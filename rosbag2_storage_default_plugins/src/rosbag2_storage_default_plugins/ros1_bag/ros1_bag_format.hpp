@@ -0,0 +1,137 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__ROS1_BAG_FORMAT_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__ROS1_BAG_FORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rcutils/time.h"
+
+// A ROS 1 bag file of format version 2.0 is the version line followed by records, all integers
+// in little endian:
+//
+//   record:  uint32 header length, header fields, uint32 data length, data
+//   field:   uint32 field length, name, '=', value
+//
+// Every record header has the field "op" with the opcode of the record, and times are a uint32
+// of seconds and a uint32 of nanoseconds.
+//
+// BAG_HEADER    header: uint64 index_pos, uint32 conn_count, uint32 chunk_count
+//               data: padding
+// CHUNK         header: string compression ("none", "bz2" or "lz4"), uint32 size uncompressed
+//               data: CONNECTION and MESSAGE_DATA records, compressed
+// INDEX_DATA    header: uint32 ver (1), uint32 conn, uint32 count
+//               data: count entries (time, uint32 offset of the message in the chunk data)
+// CONNECTION    header: uint32 conn, string topic
+//               data: header fields of the connection, e.g. type, md5sum, message_definition
+// MESSAGE_DATA  header: uint32 conn, time time
+//               data: the message, serialized by ROS 1
+// CHUNK_INFO    header: uint32 ver (1), uint64 chunk_pos, time start_time, time end_time,
+//               uint32 count
+//               data: count entries (uint32 conn, uint32 message count)
+//
+// Every chunk record is directly followed by an INDEX_DATA record for each connection with
+// messages in the chunk. At index_pos, after the chunks, a CONNECTION record for every
+// connection and a CHUNK_INFO record for every chunk follow. Bags which were not closed
+// properly have an index_pos of 0 and are reindexed by `rosbag reindex`.
+
+namespace rosbag2_storage_plugins
+{
+namespace ros1_bag
+{
+
+constexpr const char VERSION_LINE[] = "#ROSBAG V2.0\n";
+constexpr const size_t VERSION_LINE_SIZE = sizeof(VERSION_LINE) - 1;
+
+enum class Opcode : uint8_t
+{
+  MESSAGE_DATA = 0x02,
+  BAG_HEADER = 0x03,
+  INDEX_DATA = 0x04,
+  CHUNK = 0x05,
+  CHUNK_INFO = 0x06,
+  CONNECTION = 0x07
+};
+
+constexpr const size_t INDEX_ENTRY_SIZE = 3 * sizeof(uint32_t);
+constexpr const size_t CHUNK_INFO_ENTRY_SIZE = 2 * sizeof(uint32_t);
+
+/// Header fields of a record or of a connection, pointing into the buffer they are parsed from.
+class HeaderFields
+{
+public:
+  HeaderFields() = default;
+
+  /// \throws std::runtime_error if the fields are truncated or a field has no '='.
+  HeaderFields(const uint8_t * data, size_t size);
+
+  bool has(const std::string & name) const;
+
+  /// \throws std::runtime_error for all getters if the field is missing or has another size.
+  std::string get_string(const std::string & name) const;
+
+  uint8_t get_uint8(const std::string & name) const;
+
+  uint32_t get_uint32(const std::string & name) const;
+
+  uint64_t get_uint64(const std::string & name) const;
+
+  /// Returns the time in nanoseconds since epoch.
+  rcutils_time_point_value_t get_time(const std::string & name) const;
+
+  Opcode get_opcode() const;
+
+private:
+  struct Field
+  {
+    std::string name;
+    const uint8_t * value;
+    size_t size;
+  };
+
+  const Field & get_field(const std::string & name, size_t expected_size) const;
+
+  std::vector<Field> fields_;
+};
+
+struct Record
+{
+  // Empty if the header was not parsed.
+  HeaderFields header;
+  const uint8_t * data;
+  size_t data_size;
+  // Size of the whole record, i.e. the offset of the next record from this one.
+  size_t size;
+};
+
+/**
+ * Reads the record at the offset of the buffer. The header of message records, whose
+ * connection and time are known from the index, need not be parsed.
+ * \throws std::runtime_error if the record is truncated.
+ */
+Record read_record(const uint8_t * buffer, size_t size, size_t offset, bool parse_header = true);
+
+rcutils_time_point_value_t to_nanoseconds(uint32_t sec, uint32_t nsec);
+
+/// Returns the name ROS 2 gives to a message type of ROS 1, e.g. "std_msgs/msg/String".
+std::string to_ros2_type_name(const std::string & ros1_type_name);
+
+}  // namespace ros1_bag
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__ROS1_BAG__ROS1_BAG_FORMAT_HPP_
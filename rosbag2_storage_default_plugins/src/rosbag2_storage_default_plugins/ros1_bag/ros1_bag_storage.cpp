@@ -0,0 +1,617 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_storage_default_plugins/ros1_bag/ros1_bag_storage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include "chunk_decompressor.hpp"
+#include "ros1_bag_format.hpp"
+#include "../binary_log/binary_log_format.hpp"
+#include "../binary_log/mapped_file.hpp"
+#include "../logging.hpp"
+
+namespace
+{
+constexpr const auto SERIALIZATION_FORMAT = "ros1";
+
+// Chunks decompressed ahead of the reader per thread decompressing them.
+constexpr const size_t CHUNKS_AHEAD_PER_THREAD = 2;
+}  // namespace
+
+namespace rosbag2_storage_plugins
+{
+
+using binary_log::BufferReader;
+using ros1_bag::Opcode;
+
+Ros1BagStorage::Ros1BagStorage() = default;
+
+Ros1BagStorage::~Ros1BagStorage()
+{
+  close();
+}
+
+void Ros1BagStorage::open(
+  const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag)
+{
+  if (io_flag != rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY) {
+    throw std::runtime_error("ROS 1 bags can only be opened for reading.");
+  }
+  close();
+
+  relative_path_ = uri;
+  if (!rcpputils::fs::path(relative_path_).exists()) {
+    throw std::runtime_error(
+            "Failed to read from bag: File '" + relative_path_ + "' does not exist!");
+  }
+  const auto file = std::fopen(relative_path_.c_str(), "rb");
+  if (!file) {
+    throw std::runtime_error("Failed to read from bag: Cannot open '" + relative_path_ + "'.");
+  }
+  try {
+    // The mapping stays valid after the file is closed.
+    mapped_file_ = std::make_shared<binary_log::MappedFile>(
+      file, rcpputils::fs::path(relative_path_).file_size());
+  } catch (const std::runtime_error & e) {
+    std::fclose(file);
+    throw std::runtime_error(
+            "Failed to read from bag: Cannot map '" + relative_path_ + "': " + e.what());
+  }
+  std::fclose(file);
+
+  try {
+    load_file();
+  } catch (const std::runtime_error & e) {
+    close();
+    throw std::runtime_error("Failed to read from bag '" + relative_path_ + "': " + e.what());
+  }
+  chunk_decompressor_ = std::make_unique<ros1_bag::ChunkDecompressor>();
+
+  ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
+    "Opened ROS 1 bag '" << relative_path_ << "' with " << topics_.size() << " topics in " <<
+      chunks_.size() << " chunks for reading.");
+}
+
+void Ros1BagStorage::close()
+{
+  // Chunks still being decompressed reference the mapping until they are done.
+  pending_chunks_.clear();
+  chunk_decompressor_.reset();
+  loaded_chunks_.clear();
+  // Messages read before keep the mapping alive.
+  mapped_file_.reset();
+  topics_.clear();
+  topic_ids_.clear();
+  connection_topic_ids_.clear();
+  chunks_.clear();
+  is_reading_prepared_ = false;
+}
+
+void Ros1BagStorage::load_file()
+{
+  const auto data = mapped_file_->data();
+  const auto size = mapped_file_->size();
+  if (size < ros1_bag::VERSION_LINE_SIZE ||
+    std::memcmp(data, ros1_bag::VERSION_LINE, ros1_bag::VERSION_LINE_SIZE) != 0)
+  {
+    throw std::runtime_error("Not a ROS 1 bag of format version 2.0.");
+  }
+
+  const auto bag_header = ros1_bag::read_record(data, size, ros1_bag::VERSION_LINE_SIZE);
+  if (bag_header.header.get_opcode() != Opcode::BAG_HEADER) {
+    throw std::runtime_error("No bag header.");
+  }
+  const auto index_position = bag_header.header.get_uint64("index_pos");
+  if (index_position == 0) {
+    throw std::runtime_error(
+            "The bag was not closed properly and has no index. Reindex it with "
+            "`rosbag reindex` first.");
+  }
+  read_index_section(index_position);
+
+  if (chunks_.size() != bag_header.header.get_uint32("chunk_count") ||
+    connection_topic_ids_.size() != bag_header.header.get_uint32("conn_count"))
+  {
+    throw std::runtime_error("Incomplete index.");
+  }
+}
+
+void Ros1BagStorage::read_index_section(uint64_t index_position)
+{
+  const auto data = mapped_file_->data();
+  const auto size = mapped_file_->size();
+  auto offset = static_cast<size_t>(index_position);
+  while (offset < size) {
+    const auto record = ros1_bag::read_record(data, size, offset);
+    offset += record.size;
+    const auto opcode = record.header.get_opcode();
+    if (opcode == Opcode::CONNECTION) {
+      add_connection(
+        record.header.get_uint32("conn"), record.header.get_string("topic"), record.data,
+        record.data_size);
+    } else if (opcode == Opcode::CHUNK_INFO) {
+      if (record.header.get_uint32("ver") != 1) {
+        throw std::runtime_error("Chunk info of an unknown version.");
+      }
+      Chunk chunk;
+      chunk.offset = record.header.get_uint64("chunk_pos");
+      chunk.min_timestamp = record.header.get_time("start_time");
+      chunk.max_timestamp = record.header.get_time("end_time");
+      const auto connection_count = record.header.get_uint32("count");
+      BufferReader reader(record.data, record.data_size);
+      for (uint32_t i = 0; i < connection_count; ++i) {
+        const auto connection_id = reader.read_uint32();
+        chunk.connection_counts.emplace_back(connection_id, reader.read_uint32());
+      }
+      chunks_.push_back(std::move(chunk));
+    }
+  }
+
+  for (const auto & chunk : chunks_) {
+    for (const auto & connection_count : chunk.connection_counts) {
+      const auto topic_id = connection_topic_ids_.find(connection_count.first);
+      if (topic_id == connection_topic_ids_.end()) {
+        throw std::runtime_error("Messages of an unknown connection.");
+      }
+      auto & topic = topics_[topic_id->second];
+      topic.message_count += connection_count.second;
+      topic.min_timestamp = std::min(topic.min_timestamp, chunk.min_timestamp);
+      topic.max_timestamp = std::max(topic.max_timestamp, chunk.max_timestamp);
+    }
+  }
+}
+
+void Ros1BagStorage::add_connection(
+  uint32_t connection_id, const std::string & topic_name, const uint8_t * connection_header,
+  size_t connection_header_size)
+{
+  // Connections of the same topic, e.g. of several publishers, are one topic.
+  auto topic_id = topic_ids_.find(topic_name);
+  if (topic_id == topic_ids_.end()) {
+    const ros1_bag::HeaderFields fields(connection_header, connection_header_size);
+    Topic topic;
+    topic.metadata.name = topic_name;
+    topic.metadata.type = ros1_bag::to_ros2_type_name(fields.get_string("type"));
+    topic.metadata.serialization_format = SERIALIZATION_FORMAT;
+    topic.message_count = 0;
+    topic.min_timestamp = INT64_MAX;
+    topic.max_timestamp = 0;
+    topic_id = topic_ids_.emplace(topic_name, static_cast<uint32_t>(topics_.size())).first;
+    topics_.push_back(std::move(topic));
+  }
+  connection_topic_ids_[connection_id] = topic_id->second;
+}
+
+bool Ros1BagStorage::has_next()
+{
+  if (!mapped_file_) {
+    return false;
+  }
+  if (!is_reading_prepared_) {
+    prepare_for_reading();
+  }
+  load_chunks();
+  return !loaded_chunks_.empty();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> Ros1BagStorage::read_next()
+{
+  if (!has_next()) {
+    throw std::runtime_error("No more messages in ROS 1 bag '" + relative_path_ + "'.");
+  }
+
+  std::vector<LoadedChunk> read_chunks;
+  const auto view = take_next_message(read_chunks);
+  const auto data = view.serialized_data.data;
+  const auto data_size = view.serialized_data.size;
+
+  auto bag_message = message_pool_ ?
+    message_pool_->make_message() : std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  if (data_size > 0 && is_mapped(data)) {
+    bag_message->serialized_data =
+      binary_log::make_serialized_data_view(mapped_file_, data, data_size);
+  } else {
+    bag_message->serialized_data = message_pool_ ?
+      message_pool_->make_empty_serialized_message(data_size) :
+      rosbag2_storage::make_empty_serialized_message(data_size);
+    if (data_size > 0) {
+      std::memcpy(bag_message->serialized_data->buffer, data, data_size);
+    }
+    bag_message->serialized_data->buffer_length = data_size;
+  }
+  bag_message->time_stamp = view.time_stamp;
+  bag_message->topic_name = *view.topic_name;
+  bag_message->publish_time_stamp = view.publish_time_stamp;
+  return bag_message;
+}
+
+bool Ros1BagStorage::visit_next_batch(
+  const rosbag2_storage::SerializedBagMessageViewBatchCallback & callback,
+  size_t max_messages, size_t max_bytes)
+{
+  std::vector<rosbag2_storage::SerializedBagMessageView> views;
+  std::vector<LoadedChunk> read_chunks;
+  size_t bytes = 0;
+  while ((max_messages == 0 || views.size() < max_messages) &&
+    (max_bytes == 0 || bytes < max_bytes) && has_next())
+  {
+    views.push_back(take_next_message(read_chunks));
+    bytes += views.back().serialized_data.size;
+  }
+  if (views.empty()) {
+    return false;
+  }
+  callback(views);
+  return true;
+}
+
+bool Ros1BagStorage::is_mapped(const uint8_t * data) const
+{
+  const std::less<const uint8_t *> less;
+  return !less(data, mapped_file_->data()) &&
+         less(data, mapped_file_->data() + mapped_file_->size());
+}
+
+rosbag2_storage::SerializedBagMessageView Ros1BagStorage::take_next_message(
+  std::vector<LoadedChunk> & read_chunks)
+{
+  // The chunks overlap in time if messages were received out of time stamp order.
+  auto next_chunk = loaded_chunks_.begin();
+  for (auto loaded_chunk = loaded_chunks_.begin(); loaded_chunk != loaded_chunks_.end();
+    ++loaded_chunk)
+  {
+    if (loaded_chunk->entries[loaded_chunk->next_entry].time_stamp <
+      next_chunk->entries[next_chunk->next_entry].time_stamp)
+    {
+      next_chunk = loaded_chunk;
+    }
+  }
+  const auto & entry = next_chunk->entries[next_chunk->next_entry++];
+
+  // The connection and time of the message are known from the index.
+  const auto record = ros1_bag::read_record(
+    next_chunk->data, next_chunk->size, entry.offset, false);
+  rosbag2_storage::SerializedBagMessageView view;
+  view.time_stamp = entry.time_stamp;
+  // ROS 1 bags have no publish time stamps.
+  view.publish_time_stamp = entry.time_stamp;
+  view.serialized_data.data = record.data;
+  view.serialized_data.size = record.data_size;
+  view.topic_name = &topics_[entry.topic_id].metadata.name;
+
+  if (next_chunk->next_entry == next_chunk->entries.size()) {
+    // Decompressed data keeps its address when the chunk is moved.
+    read_chunks.push_back(std::move(*next_chunk));
+    loaded_chunks_.erase(next_chunk);
+  }
+  return view;
+}
+
+void Ros1BagStorage::prepare_for_reading()
+{
+  // The topics passing the filter by name, regex or type are resolved once, so chunks and
+  // messages are selected by connection.
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter_);
+  is_selected_topic_.assign(topics_.size(), false);
+  topic_time_ranges_.assign(topics_.size(), {});
+  for (size_t topic_id = 0; topic_id < topics_.size(); ++topic_id) {
+    is_selected_topic_[topic_id] =
+      topic_filter.is_selected(topics_[topic_id].metadata.name, topics_[topic_id].metadata.type);
+    topic_time_ranges_[topic_id] = topic_filter.get_time_ranges(topics_[topic_id].metadata.name);
+  }
+
+  chunks_to_read_.clear();
+  for (size_t chunk_number = 0; chunk_number < chunks_.size(); ++chunk_number) {
+    if (is_selected(chunks_[chunk_number])) {
+      chunks_to_read_.push_back(chunk_number);
+    }
+  }
+  std::stable_sort(
+    chunks_to_read_.begin(), chunks_to_read_.end(), [this](size_t lhs, size_t rhs) {
+      return chunks_[lhs].min_timestamp < chunks_[rhs].min_timestamp;
+    });
+  next_chunk_to_read_ = 0;
+  // Chunks decompressed for the previous filter or time are dropped, or finish unused.
+  pending_chunks_.clear();
+  loaded_chunks_.clear();
+  is_reading_prepared_ = true;
+
+  // Reading all topics streams through the file, a selection of topics skips chunks.
+  mapped_file_->advise(
+    topic_filter.selects_all_topics() ?
+    binary_log::MappedFile::AccessPattern::SEQUENTIAL :
+    binary_log::MappedFile::AccessPattern::NORMAL);
+}
+
+rcutils_time_point_value_t Ros1BagStorage::get_read_start_time() const
+{
+  return std::max(seek_time_, storage_filter_.start_time);
+}
+
+bool Ros1BagStorage::is_selected_connection(uint32_t connection_id) const
+{
+  const auto topic_id = connection_topic_ids_.find(connection_id);
+  return topic_id != connection_topic_ids_.end() && is_selected_topic_[topic_id->second];
+}
+
+bool Ros1BagStorage::is_selected(const Chunk & chunk) const
+{
+  const auto start_time = get_read_start_time();
+  if ((start_time > 0 && chunk.max_timestamp < start_time) ||
+    (storage_filter_.end_time > 0 && chunk.min_timestamp > storage_filter_.end_time))
+  {
+    return false;
+  }
+  // Chunks are skipped if none of their selected topics has a time range overlapping them.
+  for (const auto & connection_count : chunk.connection_counts) {
+    if (connection_count.second > 0 && is_selected_connection(connection_count.first) &&
+      rosbag2_storage::TopicFilter::overlaps(
+        topic_time_ranges_[connection_topic_ids_.at(connection_count.first)],
+        chunk.min_timestamp, chunk.max_timestamp))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Ros1BagStorage::decompress_ahead()
+{
+  const auto chunks_ahead = chunk_decompressor_->get_thread_count() * CHUNKS_AHEAD_PER_THREAD;
+  while (pending_chunks_.size() < chunks_ahead &&
+    next_chunk_to_read_ + pending_chunks_.size() < chunks_to_read_.size())
+  {
+    PendingChunk pending_chunk;
+    pending_chunk.chunk_number = chunks_to_read_[next_chunk_to_read_ + pending_chunks_.size()];
+    const auto & chunk = chunks_[pending_chunk.chunk_number];
+    const auto record = ros1_bag::read_record(
+      mapped_file_->data(), mapped_file_->size(), static_cast<size_t>(chunk.offset));
+    const auto compression = record.header.get_string("compression");
+    if (compression == "none") {
+      // Read from the mapping when it is loaded, which the operating system reads ahead.
+      mapped_file_->will_need(chunk.offset, record.size);
+    } else {
+      pending_chunk.decompressed_data = chunk_decompressor_->submit(
+        compression, record.data, record.data_size, record.header.get_uint32("size"),
+        mapped_file_);
+    }
+    pending_chunks_.push_back(std::move(pending_chunk));
+  }
+}
+
+void Ros1BagStorage::load_chunks()
+{
+  // Loads every chunk which starts before the next message of the loaded chunks, so messages
+  // received out of time stamp order are merged into order.
+  while (next_chunk_to_read_ < chunks_to_read_.size()) {
+    const auto & chunk = chunks_[chunks_to_read_[next_chunk_to_read_]];
+    if (!loaded_chunks_.empty()) {
+      auto next_timestamp = INT64_MAX;
+      for (const auto & loaded_chunk : loaded_chunks_) {
+        next_timestamp = std::min(
+          next_timestamp, loaded_chunk.entries[loaded_chunk.next_entry].time_stamp);
+      }
+      if (chunk.min_timestamp > next_timestamp) {
+        return;
+      }
+    }
+    decompress_ahead();
+    auto pending_chunk = std::move(pending_chunks_.front());
+    pending_chunks_.pop_front();
+    ++next_chunk_to_read_;
+    load_chunk(std::move(pending_chunk));
+  }
+}
+
+void Ros1BagStorage::load_chunk(PendingChunk pending_chunk)
+{
+  const auto & chunk = chunks_[pending_chunk.chunk_number];
+  const auto data = mapped_file_->data();
+  const auto size = mapped_file_->size();
+  const auto record = ros1_bag::read_record(data, size, static_cast<size_t>(chunk.offset));
+  if (record.header.get_opcode() != Opcode::CHUNK) {
+    throw std::runtime_error(
+            "Chunk info of ROS 1 bag '" + relative_path_ + "' does not point to a chunk.");
+  }
+
+  // The chunk is followed by an index of the messages of each of its connections, of which
+  // only those of the selected connections are read.
+  std::vector<IndexEntry> entries;
+  const auto start_time = get_read_start_time();
+  auto offset = static_cast<size_t>(chunk.offset) + record.size;
+  for (size_t i = 0; i < chunk.connection_counts.size(); ++i) {
+    const auto index = ros1_bag::read_record(data, size, offset);
+    offset += index.size;
+    if (index.header.get_opcode() != Opcode::INDEX_DATA || index.header.get_uint32("ver") != 1) {
+      throw std::runtime_error(
+              "Chunk of ROS 1 bag '" + relative_path_ + "' is not followed by its index.");
+    }
+    const auto connection_id = index.header.get_uint32("conn");
+    if (!is_selected_connection(connection_id)) {
+      continue;
+    }
+    const auto topic_id = connection_topic_ids_.at(connection_id);
+    const auto count = index.header.get_uint32("count");
+    BufferReader reader(index.data, index.data_size);
+    for (uint32_t j = 0; j < count; ++j) {
+      const auto sec = reader.read_uint32();
+      const auto nsec = reader.read_uint32();
+      IndexEntry entry;
+      entry.topic_id = topic_id;
+      entry.time_stamp = ros1_bag::to_nanoseconds(sec, nsec);
+      entry.offset = reader.read_uint32();
+      if ((start_time <= 0 || entry.time_stamp >= start_time) &&
+        (storage_filter_.end_time <= 0 || entry.time_stamp <= storage_filter_.end_time) &&
+        rosbag2_storage::TopicFilter::is_within(topic_time_ranges_[topic_id], entry.time_stamp))
+      {
+        entries.push_back(entry);
+      }
+    }
+  }
+  if (entries.empty()) {
+    return;
+  }
+  // The indices of the connections are merged in time stamp order, keeping the order in which
+  // messages of the same time were received.
+  std::stable_sort(
+    entries.begin(), entries.end(), [](const IndexEntry & lhs, const IndexEntry & rhs) {
+      return lhs.time_stamp < rhs.time_stamp ||
+      (lhs.time_stamp == rhs.time_stamp && lhs.offset < rhs.offset);
+    });
+
+  LoadedChunk loaded_chunk;
+  if (pending_chunk.decompressed_data.valid()) {
+    loaded_chunk.decompressed_data = std::make_shared<const std::vector<uint8_t>>(
+      pending_chunk.decompressed_data.get());
+    loaded_chunk.data = loaded_chunk.decompressed_data->data();
+    loaded_chunk.size = loaded_chunk.decompressed_data->size();
+  } else {
+    loaded_chunk.data = record.data;
+    loaded_chunk.size = record.data_size;
+  }
+  loaded_chunk.entries = std::move(entries);
+  loaded_chunk.next_entry = 0;
+  loaded_chunks_.push_back(std::move(loaded_chunk));
+}
+
+std::vector<rosbag2_storage::TopicMetadata> Ros1BagStorage::get_all_topics_and_types()
+{
+  std::vector<rosbag2_storage::TopicMetadata> topics_and_types;
+  for (const auto & topic : topics_) {
+    topics_and_types.push_back(topic.metadata);
+  }
+  return topics_and_types;
+}
+
+rosbag2_storage::BagMetadata Ros1BagStorage::get_metadata()
+{
+  rosbag2_storage::BagMetadata metadata;
+  metadata.storage_identifier = get_storage_identifier();
+  metadata.relative_file_paths = {get_relative_file_path()};
+  metadata.message_count = 0;
+  metadata.topics_with_message_count = {};
+
+  rcutils_time_point_value_t min_time = INT64_MAX;
+  rcutils_time_point_value_t max_time = 0;
+  for (const auto & topic : topics_) {
+    if (topic.message_count == 0) {
+      continue;
+    }
+    rosbag2_storage::TopicInformation topic_information;
+    topic_information.topic_metadata = topic.metadata;
+    topic_information.message_count = static_cast<size_t>(topic.message_count);
+    metadata.topics_with_message_count.push_back(topic_information);
+    metadata.message_count += topic.message_count;
+    min_time = std::min(min_time, topic.min_timestamp);
+    max_time = std::max(max_time, topic.max_timestamp);
+  }
+  std::sort(
+    metadata.topics_with_message_count.begin(), metadata.topics_with_message_count.end(),
+    [](const rosbag2_storage::TopicInformation & lhs,
+    const rosbag2_storage::TopicInformation & rhs) {
+      return lhs.topic_metadata.name < rhs.topic_metadata.name;
+    });
+
+  if (metadata.message_count == 0) {
+    min_time = 0;
+    max_time = 0;
+  }
+
+  metadata.starting_time =
+    std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(min_time));
+  metadata.duration = std::chrono::nanoseconds(max_time) - std::chrono::nanoseconds(min_time);
+  metadata.bag_size = get_bagfile_size();
+
+  rosbag2_storage::FileInformation file;
+  file.path = get_relative_file_path();
+  file.starting_time = metadata.starting_time;
+  file.duration = metadata.duration;
+  file.message_count = metadata.message_count;
+  file.size = metadata.bag_size;
+  for (const auto & topic : metadata.topics_with_message_count) {
+    file.topics.push_back(topic.topic_metadata.name);
+    file.topic_message_counts.push_back(topic.message_count);
+  }
+  metadata.files = {file};
+  return metadata;
+}
+
+std::string Ros1BagStorage::get_relative_file_path() const
+{
+  return relative_path_;
+}
+
+uint64_t Ros1BagStorage::get_bagfile_size() const
+{
+  return mapped_file_ ? static_cast<uint64_t>(mapped_file_->size()) : 0u;
+}
+
+std::string Ros1BagStorage::get_storage_identifier() const
+{
+  return "ros1_bag";
+}
+
+rosbag2_storage::StorageCapabilities Ros1BagStorage::get_capabilities() const
+{
+  rosbag2_storage::StorageCapabilities capabilities;
+  capabilities.seek = true;
+  capabilities.message_pool = true;
+  return capabilities;
+}
+
+void Ros1BagStorage::set_filter(const rosbag2_storage::StorageFilter & storage_filter)
+{
+  storage_filter_ = storage_filter;
+  is_reading_prepared_ = false;
+}
+
+void Ros1BagStorage::reset_filter()
+{
+  storage_filter_ = rosbag2_storage::StorageFilter();
+  is_reading_prepared_ = false;
+}
+
+void Ros1BagStorage::seek(const rcutils_time_point_value_t & timestamp)
+{
+  seek_time_ = timestamp;
+  is_reading_prepared_ = false;
+}
+
+void Ros1BagStorage::set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool)
+{
+  message_pool_ = std::move(message_pool);
+}
+
+}  // namespace rosbag2_storage_plugins
+
+#include "pluginlib/class_list_macros.hpp"  // NOLINT
+PLUGINLIB_EXPORT_CLASS(
+  rosbag2_storage_plugins::Ros1BagStorage,
+  rosbag2_storage::storage_interfaces::ReadOnlyInterface)
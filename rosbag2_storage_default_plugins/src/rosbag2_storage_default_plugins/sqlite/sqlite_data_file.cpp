@@ -0,0 +1,107 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sqlite_data_file.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+namespace rosbag2_storage_plugins
+{
+
+SqliteDataFile::SqliteDataFile(const std::string & database_path, bool writable)
+: path_(get_path(database_path))
+{
+  const bool exists = rcpputils::fs::path(path_).exists();
+  if (!writable && !exists) {
+    throw std::runtime_error(
+            "Data file '" + path_ + "' of the large messages of '" + database_path +
+            "' does not exist.");
+  }
+  file_ = std::fopen(path_.c_str(), writable ? (exists ? "r+b" : "w+b") : "rb");
+  if (!file_) {
+    throw std::runtime_error("Failed to open data file '" + path_ + "'.");
+  }
+  // The data is written in large pieces, which are not worth copying into a buffer.
+  std::setvbuf(file_, nullptr, _IONBF, 0);
+  size_ = rcpputils::fs::path(path_).file_size();
+}
+
+SqliteDataFile::~SqliteDataFile()
+{
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+std::string SqliteDataFile::get_path(const std::string & database_path)
+{
+  return database_path + "-data";
+}
+
+uint64_t SqliteDataFile::append(const rcutils_uint8_array_t & data)
+{
+  if (!is_position_at_end_) {
+    seek(size_);
+    is_position_at_end_ = true;
+  }
+  const auto offset = size_;
+  if (data.buffer_length > 0 &&
+    (std::fwrite(data.buffer, 1, data.buffer_length, file_) != data.buffer_length ||
+    std::fflush(file_) != 0))
+  {
+    // The next append overwrites what was written of the data.
+    is_position_at_end_ = false;
+    throw std::runtime_error("Failed to write to data file '" + path_ + "'.");
+  }
+  size_ += data.buffer_length;
+  return offset;
+}
+
+std::shared_ptr<rcutils_uint8_array_t> SqliteDataFile::read(
+  uint64_t offset, uint64_t length,
+  const std::shared_ptr<rosbag2_storage::MessagePool> & message_pool) const
+{
+  auto data = message_pool ?
+    message_pool->make_empty_serialized_message(static_cast<size_t>(length)) :
+    rosbag2_storage::make_empty_serialized_message(static_cast<size_t>(length));
+  seek(offset);
+  is_position_at_end_ = false;
+  if (length > 0 && std::fread(data->buffer, 1, static_cast<size_t>(length), file_) != length) {
+    throw std::runtime_error(
+            "Data file '" + path_ + "' ends before the data at offset " +
+            std::to_string(offset) + ".");
+  }
+  data->buffer_length = static_cast<size_t>(length);
+  return data;
+}
+
+void SqliteDataFile::seek(uint64_t offset) const
+{
+#ifdef _WIN32
+  const auto result = _fseeki64(file_, static_cast<__int64>(offset), SEEK_SET);
+#else
+  const auto result = fseeko(file_, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  if (result != 0) {
+    throw std::runtime_error("Failed to seek in data file '" + path_ + "'.");
+  }
+}
+
+}  // namespace rosbag2_storage_plugins
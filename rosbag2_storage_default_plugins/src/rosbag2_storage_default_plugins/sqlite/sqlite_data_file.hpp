@@ -0,0 +1,84 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_STORAGE_DEFAULT_PLUGINS__SQLITE__SQLITE_DATA_FILE_HPP_
+#define ROSBAG2_STORAGE_DEFAULT_PLUGINS__SQLITE__SQLITE_DATA_FILE_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/message_pool.hpp"
+
+namespace rosbag2_storage_plugins
+{
+
+/**
+ * File next to a database which holds the data of its large messages back to back, so they are
+ * written and read sequentially instead of spread over chains of overflow pages. The database
+ * stores the offset and length of the data of such messages instead of the data itself.
+ */
+class SqliteDataFile
+{
+public:
+  /**
+   * Opens the data file of the database, or creates it if writable and missing.
+   * \throws std::runtime_error if the file cannot be opened.
+   */
+  SqliteDataFile(const std::string & database_path, bool writable);
+
+  ~SqliteDataFile();
+
+  SqliteDataFile(const SqliteDataFile &) = delete;
+  SqliteDataFile & operator=(const SqliteDataFile &) = delete;
+
+  /// Path of the data file of the database.
+  static std::string get_path(const std::string & database_path);
+
+  /**
+   * Appends the data and hands it to the operating system, so a database row referring to it
+   * is never committed before the data. Returns the offset of the data in the file.
+   * \throws std::runtime_error if the data cannot be written.
+   */
+  uint64_t append(const rcutils_uint8_array_t & data);
+
+  /**
+   * Reads the data at the offset, into a buffer of the pool if given.
+   * \throws std::runtime_error if the file ends before.
+   */
+  std::shared_ptr<rcutils_uint8_array_t> read(
+    uint64_t offset, uint64_t length,
+    const std::shared_ptr<rosbag2_storage::MessagePool> & message_pool) const;
+
+  uint64_t size() const
+  {
+    return size_;
+  }
+
+private:
+  void seek(uint64_t offset) const;
+
+  std::string path_;
+  std::FILE * file_ {nullptr};
+  uint64_t size_ {0};
+  // Whether the file position is at its end, which reading moves it away from.
+  mutable bool is_position_at_end_ {false};
+};
+
+}  // namespace rosbag2_storage_plugins
+
+#endif  // ROSBAG2_STORAGE_DEFAULT_PLUGINS__SQLITE__SQLITE_DATA_FILE_HPP_
@@ -56,6 +56,9 @@ std::shared_ptr<SqliteStatementWrapper> SqliteStatementWrapper::execute_and_rese
 {
   int return_code = sqlite3_step(statement_);
   if (!is_query_ok(return_code)) {
+    // Reset anyway so the statement can be reused and bound blobs are released.
+    reset();
+
     std::stringstream errmsg;
     errmsg << "Error when processing SQL statement. SQLite error (" <<
       return_code << "): " << sqlite3_errstr(return_code);
@@ -103,6 +106,8 @@ std::shared_ptr<SqliteStatementWrapper> SqliteStatementWrapper::bind(const std::
 std::shared_ptr<SqliteStatementWrapper>
 SqliteStatementWrapper::bind(std::shared_ptr<rcutils_uint8_array_t> value)
 {
+  // The blob is bound with SQLITE_STATIC, so it has to be kept alive until the next reset().
+  // Only the blobs bound since the last reset() are held, i.e. at most one per parameter.
   written_blobs_cache_.push_back(value);
   auto return_code = sqlite3_bind_blob(
     statement_, ++last_bound_parameter_index_,
@@ -160,11 +165,22 @@ void SqliteStatementWrapper::obtain_column_value(size_t index, std::string & val
 void SqliteStatementWrapper::obtain_column_value(
   size_t index, std::shared_ptr<rcutils_uint8_array_t> & value) const
 {
+  if (sqlite3_column_type(statement_, static_cast<int>(index)) == SQLITE_NULL) {
+    value = nullptr;
+    return;
+  }
   auto data = sqlite3_column_blob(statement_, static_cast<int>(index));
   auto size = static_cast<size_t>(sqlite3_column_bytes(statement_, static_cast<int>(index)));
   value = rosbag2_storage::make_serialized_message(data, size);
 }
 
+void SqliteStatementWrapper::obtain_column_value(size_t index, BlobView & value) const
+{
+  value.is_null = sqlite3_column_type(statement_, static_cast<int>(index)) == SQLITE_NULL;
+  value.data = sqlite3_column_blob(statement_, static_cast<int>(index));
+  value.size = static_cast<size_t>(sqlite3_column_bytes(statement_, static_cast<int>(index)));
+}
+
 void SqliteStatementWrapper::check_and_report_bind_error(int return_code)
 {
   if (return_code != SQLITE_OK) {
@@ -16,24 +16,37 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstring>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
 #include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+// Defines the tracepoints of rosbag2_storage_default_plugins.
+#define ROSBAG2_TRACEPOINT_DEFINE
+#include "rosbag2_storage/tracing.hpp"
 #include "rosbag2_storage_default_plugins/sqlite/sqlite_statement_wrapper.hpp"
 #include "rosbag2_storage_default_plugins/sqlite/sqlite_exception.hpp"
 
+#include "../crc32c.hpp"
+#include "../file_writeback.hpp"
 #include "../logging.hpp"
+#include "sqlite_data_file.hpp"
 
 namespace
 {
@@ -58,22 +71,106 @@ bool is_read_write(const rosbag2_storage::storage_interfaces::IOFlag io_flag)
 
 constexpr const auto FILE_EXTENSION = ".db3";
 
+std::vector<std::string> get_pragmas_for_preset_profile(const std::string & preset_profile)
+{
+  if (preset_profile.empty()) {
+    return {};
+  }
+  if (preset_profile == "resilient") {
+    return {"journal_mode = WAL", "synchronous = FULL"};
+  }
+  if (preset_profile == "max_throughput") {
+    // page_size has to be set before any table is created and before leaving the default journal.
+    return {
+      "page_size = 65536",
+      "cache_size = -65536",  // in KiB, i.e. 64 MiB
+      "locking_mode = EXCLUSIVE",
+      "journal_mode = OFF",
+      "synchronous = OFF",
+      "mmap_size = 268435456"
+    };
+  }
+  throw std::runtime_error("Unknown sqlite3 storage preset profile '" + preset_profile + "'.");
+}
+
+int64_t get_checksum(const rcutils_uint8_array_t & data)
+{
+  return rosbag2_storage_plugins::update_crc32c(0, data.buffer, data.buffer_length);
+}
+
 // Minimum size of a sqlite3 database file in bytes (84 kiB).
 constexpr const uint64_t MIN_SPLIT_FILE_SIZE = 86016;
+
+// The bagfile size is estimated from the written data and only read from the file system
+// after this many messages, or bytes but at least this fraction of the size, have been written
+// since the last time. Rows and index entries take roughly this many bytes besides the data.
+constexpr const uint64_t SIZE_RECONCILIATION_BYTES = 64 * 1024;
+constexpr const uint64_t SIZE_RECONCILIATION_FRACTION = 64;
+constexpr const uint64_t SIZE_RECONCILIATION_MESSAGES = 1000;
+constexpr const uint64_t ESTIMATED_MESSAGE_OVERHEAD = 48;
+
+// Messages larger than this are read with incremental BLOB I/O instead of being selected.
+// Below, the cost of moving the BLOB handle to the row outweighs the saved copy.
+constexpr const int MAX_SELECTED_BLOB_SIZE = 64 * 1024;
+
+// SQLite's default limit of the terms of a compound SELECT. If more topics of a clustered
+// database are read, they are read in time stamp order by timestamp_idx instead of merged.
+constexpr const size_t MAX_MERGED_TOPICS = 500;
+
+// Condition that the time stamp in the column is within one of the time ranges. The bounds are
+// integers, so they are part of the query rather than bound.
+std::string time_ranges_condition(
+  const std::vector<rosbag2_storage::TopicFilter::TimeRange> & time_ranges,
+  const std::string & column)
+{
+  std::string condition;
+  for (const auto & time_range : time_ranges) {
+    condition += std::string(condition.empty() ? "(" : " OR ") + column + " BETWEEN " +
+      std::to_string(time_range.first) + " AND " + std::to_string(time_range.second);
+  }
+  return condition + ")";
+}
 }  // namespace
 
 namespace rosbag2_storage_plugins
 {
+SqliteStorage::SqliteStorage() = default;
+
 SqliteStorage::~SqliteStorage()
 {
+  stop_commit_thread();
+  if (topic_summaries_changed_) {
+    // Commits the summary of the messages written outside of batched transactions.
+    activate_transaction();
+  }
   if (active_transaction_) {
     commit_transaction();
   }
+  if (defer_index_creation_) {
+    try {
+      create_indices();
+    } catch (const SqliteException & e) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+        "Failed to create index for '" << relative_path_ << "': " << e.what() <<
+          ". Reading it will be slower.");
+    }
+  }
 }
 
 void SqliteStorage::open(
   const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag)
 {
+  open(uri, io_flag, rosbag2_storage::StorageConfig{});
+}
+
+void SqliteStorage::open(
+  const std::string & uri,
+  rosbag2_storage::storage_interfaces::IOFlag io_flag,
+  const rosbag2_storage::StorageConfig & storage_config)
+{
+  const auto pragmas = get_pragmas_for_preset_profile(storage_config.preset_profile);
+  stop_commit_thread();
+
   if (is_read_write(io_flag)) {
     relative_path_ = uri + FILE_EXTENSION;
 
@@ -93,20 +190,91 @@ void SqliteStorage::open(
   }
 
   try {
-    database_ = std::make_unique<SqliteWrapper>(relative_path_, io_flag);
+    database_ = std::make_unique<SqliteWrapper>(relative_path_, io_flag, pragmas);
+    // Databases recorded by older versions have no publish time stamps. As the first query,
+    // this also fails if the file is not a valid database.
+    has_publish_timestamp_ = has_column("messages", "publish_timestamp");
+    has_offered_qos_profiles_ = has_column("topics", "offered_qos_profiles");
+    has_checksum_ = has_column("messages", "checksum");
+    has_data_file_ = has_column("messages", "data_offset");
+    is_clustered_ = has_schema_entry("index", "message_id_idx");
   } catch (const SqliteException & e) {
     throw std::runtime_error("Failed to setup storage. Error: " + std::string(e.what()));
   }
 
   // initialize only for READ_WRITE since the DB is already initialized if in APPEND.
+  defer_index_creation_ = false;
+  transaction_max_messages_ = storage_config.transaction_max_messages;
+  transaction_max_bytes_ = storage_config.transaction_max_bytes;
+  transaction_max_duration_ = storage_config.transaction_max_duration;
+  topic_timestamp_index_ = storage_config.topic_timestamp_index;
+  large_message_threshold_ = storage_config.large_message_threshold;
+  data_file_ = nullptr;
+  file_writeback_.reset();
+  has_topic_summary_ = false;
+  topic_summaries_changed_ = false;
+  topic_summaries_.clear();
+  all_topics_and_types_.clear();
+  has_all_topics_and_types_ = false;
+  last_message_id_ = 0;
+  has_monotonic_timestamps_ = false;
+  max_written_timestamp_ = 0;
   if (is_read_write(io_flag)) {
+    defer_index_creation_ = storage_config.defer_index_creation;
+    has_checksum_ = storage_config.checksums;
+    has_data_file_ = large_message_threshold_ > 0;
+    is_clustered_ = storage_config.cluster_messages_by_topic;
     initialize();
+    if (storage_config.preallocate_size > 0 || storage_config.writeback_interval_bytes > 0) {
+      file_writeback_ = std::make_unique<FileWriteback>(
+        relative_path_, storage_config.preallocate_size, storage_config.writeback_interval_bytes);
+    }
+  } else if (!has_timestamp_index()) {
+    // The file was recorded with deferred index creation but not closed properly.
+    if (io_flag == rosbag2_storage::storage_interfaces::IOFlag::APPEND) {
+      create_indices();
+    } else {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_WARN_STREAM(
+        "Database '" << relative_path_ << "' has no timestamp index. "
+          "Reading messages will be slower.");
+    }
+  }
+  if (io_flag == rosbag2_storage::storage_interfaces::IOFlag::APPEND &&
+    has_schema_entry("table", "topic_summary"))
+  {
+    last_message_id_ = read_topic_summaries(topic_summaries_);
+    has_topic_summary_ = true;
+  }
+  if (!is_read_write(io_flag)) {
+    has_monotonic_timestamps_ = read_monotonic_timestamps();
+    max_written_timestamp_ = 0;
+    for (const auto & summary : topic_summaries_) {
+      max_written_timestamp_ = std::max(max_written_timestamp_, summary.second.max_timestamp);
+    }
+  }
+
+  if (has_data_file_ && io_flag != rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY) {
+    // Created along with the database, so readers find it even if no message was large.
+    data_file_ = std::make_shared<SqliteDataFile>(relative_path_, true);
+    empty_data_ = rosbag2_storage::make_empty_serialized_message(1);
+    empty_data_->buffer_length = 0;
+  }
+
+  has_bagfile_size_ = false;
+
+  if (transaction_max_duration_.count() > 0 &&
+    io_flag != rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY)
+  {
+    start_commit_thread();
   }
 
   // Reset the read and write statements in case the database changed.
   // These will be reinitialized lazily on the first read or write.
   read_statement_ = nullptr;
   write_statement_ = nullptr;
+  topic_indices_.clear();
+  topic_message_statement_ = nullptr;
+  latest_message_statement_ = nullptr;
 
   ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_INFO_STREAM(
     "Opened database '" << relative_path_ << "' for " << to_string(io_flag) << ".");
@@ -119,9 +287,12 @@ void SqliteStorage::activate_transaction()
   }
 
   ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM("begin transaction");
-  database_->prepare_statement("BEGIN TRANSACTION;")->execute_and_reset();
+  database_->get_cached_statement("BEGIN TRANSACTION;")->execute_and_reset();
 
   active_transaction_ = true;
+  transaction_message_count_ = 0;
+  transaction_byte_count_ = 0;
+  transaction_start_time_ = std::chrono::steady_clock::now();
 }
 
 void SqliteStorage::commit_transaction()
@@ -130,42 +301,182 @@ void SqliteStorage::commit_transaction()
     return;
   }
 
+  write_topic_summaries();
+
   ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM("commit transaction");
-  database_->prepare_statement("COMMIT;")->execute_and_reset();
+  ROSBAG2_TRACEPOINT(storage_commit_begin, transaction_message_count_);
+  database_->get_cached_statement("COMMIT;")->execute_and_reset();
+  ROSBAG2_TRACEPOINT(storage_commit_end, transaction_message_count_);
 
   active_transaction_ = false;
+  if (file_writeback_) {
+    file_writeback_->update();
+  }
+}
+
+void SqliteStorage::start_commit_thread()
+{
+  stop_commit_thread_ = false;
+  commit_thread_ = std::thread(&SqliteStorage::commit_expired_transactions, this);
+}
+
+void SqliteStorage::stop_commit_thread()
+{
+  if (!commit_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    stop_commit_thread_ = true;
+  }
+  commit_thread_wakeup_.notify_one();
+  commit_thread_.join();
+}
+
+void SqliteStorage::commit_expired_transactions()
+{
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  while (!stop_commit_thread_) {
+    const auto expiry = active_transaction_ ?
+      transaction_start_time_ + transaction_max_duration_ :
+      std::chrono::steady_clock::now() + transaction_max_duration_;
+    commit_thread_wakeup_.wait_until(lock, expiry);
+    if (stop_commit_thread_ || !active_transaction_ ||
+      std::chrono::steady_clock::now() - transaction_start_time_ < transaction_max_duration_)
+    {
+      continue;
+    }
+    try {
+      commit_transaction();
+    } catch (const SqliteException & e) {
+      ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
+        "Failed to commit the expired transaction of '" << relative_path_ << "': " << e.what());
+    }
+  }
 }
 
 void SqliteStorage::write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message)
+{
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  write_message(message);
+}
+
+void SqliteStorage::write_message(
+  const std::shared_ptr<const rosbag2_storage::SerializedBagMessage> & message)
 {
   if (!write_statement_) {
     prepare_for_writing();
   }
-  auto topic_entry = topics_.find(message->topic_name);
+
+  const bool batch_writes = is_transaction_batching_enabled();
+  if (batch_writes) {
+    activate_transaction();
+  }
+
+  const auto topic_id = get_topic_id(*message);
+  if (has_publish_timestamp_) {
+    // Messages without publish time stamp are ordered by their receive time.
+    const auto publish_time_stamp =
+      message->publish_time_stamp != 0 ? message->publish_time_stamp : message->time_stamp;
+    const bool is_large_message = has_data_file_ && large_message_threshold_ > 0 &&
+      message->serialized_data->buffer_length > large_message_threshold_;
+    write_statement_->bind(
+      message->time_stamp, topic_id,
+      is_large_message ? empty_data_ : message->serialized_data, publish_time_stamp);
+    if (has_checksum_) {
+      write_statement_->bind(get_checksum(*message->serialized_data));
+    }
+    if (is_large_message) {
+      const auto length = message->serialized_data->buffer_length;
+      const auto offset = data_file_->append(*message->serialized_data);
+      write_statement_->bind(static_cast<int64_t>(offset), static_cast<int64_t>(length));
+    } else if (has_data_file_) {
+      write_statement_->bind(static_cast<int64_t>(-1), static_cast<int64_t>(0));
+    }
+  } else {
+    write_statement_->bind(message->time_stamp, topic_id, message->serialized_data);
+  }
+  if (is_clustered_) {
+    write_statement_->bind(++last_message_id_);
+  }
+  write_statement_->execute_and_reset();
+  if (has_topic_summary_) {
+    update_topic_summary(topic_id, message->time_stamp);
+  }
+  if (has_monotonic_timestamps_ && message->time_stamp < max_written_timestamp_) {
+    write_monotonic_timestamps(false);
+  }
+  max_written_timestamp_ = std::max(max_written_timestamp_, message->time_stamp);
+  ROSBAG2_TRACEPOINT(storage_write, message->topic_name.c_str(), message->time_stamp);
+
+  bytes_written_since_size_check_ += message->serialized_data->buffer_length;
+  ++messages_written_since_size_check_;
+
+  if (batch_writes) {
+    ++transaction_message_count_;
+    transaction_byte_count_ += message->serialized_data->buffer_length;
+    if (is_transaction_limit_reached()) {
+      commit_transaction();
+    }
+  } else if (file_writeback_ && !active_transaction_) {
+    // The message was committed on its own.
+    file_writeback_->update();
+  }
+}
+
+bool SqliteStorage::is_transaction_batching_enabled() const
+{
+  return transaction_max_messages_ > 0 || transaction_max_bytes_ > 0 ||
+         transaction_max_duration_.count() > 0;
+}
+
+bool SqliteStorage::is_transaction_limit_reached() const
+{
+  if (transaction_max_messages_ > 0 && transaction_message_count_ >= transaction_max_messages_) {
+    return true;
+  }
+  if (transaction_max_bytes_ > 0 && transaction_byte_count_ >= transaction_max_bytes_) {
+    return true;
+  }
+  return transaction_max_duration_.count() > 0 &&
+         std::chrono::steady_clock::now() - transaction_start_time_ >= transaction_max_duration_;
+}
+
+int SqliteStorage::get_topic_id(const rosbag2_storage::SerializedBagMessage & message) const
+{
+  const auto handle = message.topic_handle;
+  if (handle >= 0 && static_cast<size_t>(handle) < topic_ids_by_handle_.size() &&
+    topic_ids_by_handle_[static_cast<size_t>(handle)] >= 0)
+  {
+    return topic_ids_by_handle_[static_cast<size_t>(handle)];
+  }
+
+  auto topic_entry = topics_.find(message.topic_name);
   if (topic_entry == end(topics_)) {
     throw SqliteException(
-            "Topic '" + message->topic_name +
+            "Topic '" + message.topic_name +
             "' has not been created yet! Call 'create_topic' first.");
   }
-
-  write_statement_->bind(message->time_stamp, topic_entry->second, message->serialized_data);
-  write_statement_->execute_and_reset();
+  return topic_entry->second;
 }
 
 void SqliteStorage::write(
   const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
 {
+  std::lock_guard<std::mutex> lock(write_mutex_);
   if (!write_statement_) {
     prepare_for_writing();
   }
 
+  ROSBAG2_TRACEPOINT(storage_write_batch_begin, messages.size());
   activate_transaction();
 
   for (auto & message : messages) {
-    write(message);
+    write_message(message);
   }
 
   commit_transaction();
+  ROSBAG2_TRACEPOINT(storage_write_batch_end, messages.size());
 }
 
 bool SqliteStorage::has_next()
@@ -183,18 +494,99 @@ std::shared_ptr<rosbag2_storage::SerializedBagMessage> SqliteStorage::read_next(
     prepare_for_reading();
   }
 
-  auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
-  bag_message->serialized_data = std::get<0>(*current_message_row_);
-  bag_message->time_stamp = std::get<1>(*current_message_row_);
-  bag_message->topic_name = std::get<2>(*current_message_row_);
+  return read_current_row();
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SqliteStorage::read_next_batch(size_t max_messages, size_t max_bytes)
+{
+  if (!read_statement_) {
+    prepare_for_reading();
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  messages.reserve(max_messages);
+  size_t bytes = 0;
+  while ((max_messages == 0 || messages.size() < max_messages) &&
+    (max_bytes == 0 || bytes < max_bytes) && current_message_row_ != message_result_.end())
+  {
+    messages.push_back(read_current_row());
+    bytes += messages.back()->serialized_data->buffer_length;
+  }
+  return messages;
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> SqliteStorage::read_current_row()
+{
+  int64_t message_id = 0;
+  auto message = read_row(current_message_row_, &message_id);
+  max_read_message_id_ = std::max(max_read_message_id_, message_id);
+  return message;
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> SqliteStorage::read_row(
+  ReadQueryResult::Iterator & row, int64_t * message_id_read)
+{
+  auto bag_message = message_pool_ ?
+    message_pool_->make_message() : std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  int64_t message_id = 0;
+  int64_t checksum = -1;
+  row.consume_row(
+    [this, &bag_message, &message_id, &checksum](
+      const SqliteStatementWrapper::BlobView & data, rcutils_time_point_value_t time_stamp,
+      int topic_id, int64_t id, rcutils_time_point_value_t publish_time_stamp,
+      int64_t stored_checksum, int64_t data_offset, int64_t data_length) {
+      message_id = id;
+      checksum = stored_checksum;
+      if (data_offset >= 0) {
+        bag_message->serialized_data = get_data_file().read(
+          static_cast<uint64_t>(data_offset), static_cast<uint64_t>(data_length), message_pool_);
+      } else if (data.is_null) {
+        bag_message->serialized_data =
+          database_->read_blob("messages", "data", id, message_pool_);
+      } else {
+        // Copied before the statement steps to the next row, which invalidates the data.
+        bag_message->serialized_data = message_pool_ ?
+          message_pool_->make_empty_serialized_message(data.size) :
+          rosbag2_storage::make_empty_serialized_message(data.size);
+        if (data.size > 0) {
+          std::memcpy(bag_message->serialized_data->buffer, data.data, data.size);
+        }
+        bag_message->serialized_data->buffer_length = data.size;
+      }
+      bag_message->time_stamp = time_stamp;
+      bag_message->topic_name = topic_names_by_id_.at(topic_id);
+      bag_message->publish_time_stamp = publish_time_stamp;
+    });
 
-  ++current_message_row_;
+  ++row;
+  // Databases without checksums select -1, which no CRC-32C is.
+  if (checksum >= 0 && get_checksum(*bag_message->serialized_data) != checksum) {
+    throw SqliteException(
+            "Message " + std::to_string(message_id) + " of '" + relative_path_ +
+            "' is corrupt: its checksum does not match.");
+  }
+  if (message_id_read) {
+    *message_id_read = message_id;
+  }
   return bag_message;
 }
 
+SqliteDataFile & SqliteStorage::get_data_file()
+{
+  if (!data_file_) {
+    try {
+      data_file_ = std::make_shared<SqliteDataFile>(relative_path_, false);
+    } catch (const std::runtime_error & e) {
+      throw SqliteException(e.what());
+    }
+  }
+  return *data_file_;
+}
+
 std::vector<rosbag2_storage::TopicMetadata> SqliteStorage::get_all_topics_and_types()
 {
-  if (all_topics_and_types_.empty()) {
+  if (!has_all_topics_and_types_) {
     fill_topics_and_types();
   }
 
@@ -202,10 +594,36 @@ std::vector<rosbag2_storage::TopicMetadata> SqliteStorage::get_all_topics_and_ty
 }
 
 uint64_t SqliteStorage::get_bagfile_size() const
+{
+  // Called on every write when splitting, so avoid a stat() call per message, even if the
+  // messages are large. Locked, as the I/O thread of the writer may be writing meanwhile.
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  const auto reconciliation_bytes =
+    std::max(SIZE_RECONCILIATION_BYTES, bagfile_size_ / SIZE_RECONCILIATION_FRACTION);
+  if (has_bagfile_size_ &&
+    bytes_written_since_size_check_ < reconciliation_bytes &&
+    messages_written_since_size_check_ < SIZE_RECONCILIATION_MESSAGES)
+  {
+    return bagfile_size_ + bytes_written_since_size_check_ +
+           messages_written_since_size_check_ * ESTIMATED_MESSAGE_OVERHEAD;
+  }
+
+  return read_bagfile_size();
+}
+
+uint64_t SqliteStorage::read_bagfile_size() const
 {
   const auto bag_path = rcpputils::fs::path{get_relative_file_path()};
 
-  return bag_path.exists() ? bag_path.file_size() : 0u;
+  bagfile_size_ = bag_path.exists() ? bag_path.file_size() : 0u;
+  if (has_data_file_) {
+    const auto data_file_path = rcpputils::fs::path{SqliteDataFile::get_path(relative_path_)};
+    bagfile_size_ += data_file_path.exists() ? data_file_path.file_size() : 0u;
+  }
+  has_bagfile_size_ = true;
+  bytes_written_since_size_check_ = 0;
+  messages_written_since_size_check_ = 0;
+  return bagfile_size_;
 }
 
 void SqliteStorage::initialize()
@@ -217,86 +635,586 @@ void SqliteStorage::initialize()
     "serialization_format TEXT NOT NULL," \
     "offered_qos_profiles TEXT NOT NULL);";
   database_->prepare_statement(create_stmt)->execute_and_reset();
-  create_stmt = "CREATE TABLE messages(" \
-    "id INTEGER PRIMARY KEY," \
+  // A clustered table is stored in the order of its primary key instead of its rowid, which it
+  // then lacks. Its ids are assigned by write() and looked up in message_id_idx.
+  create_stmt = "CREATE TABLE messages(" +
+    std::string(is_clustered_ ? "id INTEGER NOT NULL," : "id INTEGER PRIMARY KEY,") +
     "topic_id INTEGER NOT NULL," \
     "timestamp INTEGER NOT NULL, " \
-    "data BLOB NOT NULL);";
+    "data BLOB NOT NULL," \
+    "publish_timestamp INTEGER NOT NULL" +
+    std::string(has_checksum_ ? ", checksum INTEGER NOT NULL" : "") +
+    std::string(
+    has_data_file_ ? ", data_offset INTEGER NOT NULL, data_length INTEGER NOT NULL" : "") +
+    std::string(is_clustered_ ? ", PRIMARY KEY (topic_id, timestamp, id)) WITHOUT ROWID;" : ");");
   database_->prepare_statement(create_stmt)->execute_and_reset();
-  create_stmt = "CREATE INDEX timestamp_idx ON messages (timestamp ASC);";
+  if (is_clustered_) {
+    database_->prepare_statement("CREATE UNIQUE INDEX message_id_idx ON messages (id);")
+    ->execute_and_reset();
+  }
+  has_publish_timestamp_ = true;
+  has_offered_qos_profiles_ = true;
+  // Covers the messages up to last_message_id, so get_metadata() need not scan all messages.
+  create_stmt = "CREATE TABLE topic_summary(" \
+    "topic_id INTEGER PRIMARY KEY," \
+    "message_count INTEGER NOT NULL," \
+    "min_timestamp INTEGER NOT NULL," \
+    "max_timestamp INTEGER NOT NULL," \
+    "last_message_id INTEGER NOT NULL);";
+  database_->prepare_statement(create_stmt)->execute_and_reset();
+  has_topic_summary_ = true;
+  create_stmt = "CREATE TABLE storage_info(" \
+    "key TEXT PRIMARY KEY," \
+    "value INTEGER NOT NULL);";
   database_->prepare_statement(create_stmt)->execute_and_reset();
+  write_monotonic_timestamps(true);
+  if (!defer_index_creation_) {
+    create_indices();
+  }
+}
+
+void SqliteStorage::create_indices()
+{
+  ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_DEBUG_STREAM("create indices");
+  database_->prepare_statement(
+    "CREATE INDEX IF NOT EXISTS timestamp_idx ON messages (timestamp ASC);")->execute_and_reset();
+  // Clustered databases are ordered by topic and time stamp anyway.
+  if (topic_timestamp_index_ && !is_clustered_) {
+    database_->prepare_statement(
+      "CREATE INDEX IF NOT EXISTS topic_timestamp_idx ON messages (topic_id, timestamp ASC);")
+    ->execute_and_reset();
+  }
+  if (has_publish_timestamp_) {
+    database_->prepare_statement(
+      "CREATE INDEX IF NOT EXISTS publish_timestamp_idx ON messages (publish_timestamp ASC);")
+    ->execute_and_reset();
+  }
+}
+
+bool SqliteStorage::has_schema_entry(const std::string & type, const std::string & name) const
+{
+  auto statement = database_->prepare_statement(
+    "SELECT COUNT(*) FROM sqlite_master WHERE type = ? AND name = ?;");
+  statement->bind(type, name);
+  return std::get<0>(statement->execute_query<int>().get_single_line()) > 0;
+}
+
+bool SqliteStorage::has_column(const std::string & table, const std::string & column) const
+{
+  auto statement = database_->prepare_statement(
+    "SELECT COUNT(*) FROM pragma_table_info(?) WHERE name = ?;");
+  statement->bind(table, column);
+  return std::get<0>(statement->execute_query<int>().get_single_line()) > 0;
+}
+
+bool SqliteStorage::has_timestamp_index() const
+{
+  return has_schema_entry("index", "timestamp_idx");
+}
+
+std::string SqliteStorage::offered_qos_profiles_column() const
+{
+  return has_offered_qos_profiles_ ? "topics.offered_qos_profiles" : "''";
+}
+
+int64_t SqliteStorage::read_topic_summaries(
+  std::unordered_map<int, TopicSummary> & topic_summaries) const
+{
+  auto add_to_summary = [&topic_summaries](
+    int topic_id, uint64_t message_count,
+    rcutils_time_point_value_t min_timestamp, rcutils_time_point_value_t max_timestamp) {
+      auto summary = topic_summaries.emplace(
+        topic_id, TopicSummary{0, min_timestamp, max_timestamp}).first;
+      summary->second.message_count += message_count;
+      summary->second.min_timestamp = std::min(summary->second.min_timestamp, min_timestamp);
+      summary->second.max_timestamp = std::max(summary->second.max_timestamp, max_timestamp);
+    };
+
+  topic_summaries.clear();
+  int64_t last_message_id = 0;
+  if (has_schema_entry("table", "topic_summary")) {
+    auto statement = database_->prepare_statement(
+      "SELECT topic_id, message_count, min_timestamp, max_timestamp, last_message_id "
+      "FROM topic_summary;");
+    statement->execute_query<int, int64_t, int64_t, int64_t, int64_t>().for_each_row(
+      [&add_to_summary, &last_message_id](
+        int topic_id, int64_t message_count, int64_t min_timestamp, int64_t max_timestamp,
+        int64_t summarized_message_id) {
+        add_to_summary(
+          topic_id, static_cast<uint64_t>(message_count), min_timestamp, max_timestamp);
+        last_message_id = std::max(last_message_id, summarized_message_id);
+      });
+  }
+
+  // Messages are never deleted, so the ones missing in the summary, e.g. because recording was
+  // interrupted, are those with a higher id. Without summary, all messages are counted.
+  auto statement = database_->prepare_statement(
+    "SELECT topic_id, COUNT(*), MIN(timestamp), MAX(timestamp), MAX(id) FROM messages "
+    "WHERE id > ? GROUP BY topic_id;");
+  statement->bind(last_message_id);
+  int64_t last_counted_message_id = last_message_id;
+  statement->execute_query<int, int64_t, int64_t, int64_t, int64_t>().for_each_row(
+    [&add_to_summary, &last_counted_message_id](
+      int topic_id, int64_t message_count, int64_t min_timestamp, int64_t max_timestamp,
+      int64_t max_message_id) {
+      add_to_summary(
+        topic_id, static_cast<uint64_t>(message_count), min_timestamp, max_timestamp);
+      last_counted_message_id = std::max(last_counted_message_id, max_message_id);
+    });
+  return last_counted_message_id;
+}
+
+void SqliteStorage::update_topic_summary(int topic_id, rcutils_time_point_value_t timestamp)
+{
+  // The ids of clustered databases are assigned by write() instead.
+  if (!is_clustered_) {
+    last_message_id_ = static_cast<int64_t>(database_->get_last_insert_id());
+  }
+  auto summary = topic_summaries_.emplace(topic_id, TopicSummary{0, timestamp, timestamp}).first;
+  ++summary->second.message_count;
+  summary->second.min_timestamp = std::min(summary->second.min_timestamp, timestamp);
+  summary->second.max_timestamp = std::max(summary->second.max_timestamp, timestamp);
+  topic_summaries_changed_ = true;
+}
+
+bool SqliteStorage::read_monotonic_timestamps() const
+{
+  if (!has_schema_entry("table", "storage_info")) {
+    return false;
+  }
+  auto statement = database_->prepare_statement(
+    "SELECT COUNT(*) FROM storage_info WHERE key = 'monotonic_timestamps' AND value = 1;");
+  return std::get<0>(statement->execute_query<int>().get_single_line()) > 0;
+}
+
+void SqliteStorage::write_monotonic_timestamps(bool monotonic_timestamps)
+{
+  auto statement = database_->prepare_statement(
+    "INSERT OR REPLACE INTO storage_info (key, value) VALUES ('monotonic_timestamps', ?);");
+  statement->bind(monotonic_timestamps ? 1 : 0);
+  statement->execute_and_reset();
+  has_monotonic_timestamps_ = monotonic_timestamps;
+}
+
+void SqliteStorage::write_topic_summaries()
+{
+  if (!topic_summaries_changed_) {
+    return;
+  }
+
+  auto statement = database_->prepare_statement(
+    "INSERT OR REPLACE INTO topic_summary "
+    "(topic_id, message_count, min_timestamp, max_timestamp, last_message_id) "
+    "VALUES (?, ?, ?, ?, ?);");
+  for (const auto & summary : topic_summaries_) {
+    statement->bind(
+      summary.first, static_cast<int64_t>(summary.second.message_count),
+      summary.second.min_timestamp, summary.second.max_timestamp, last_message_id_);
+    statement->execute_and_reset();
+  }
+  topic_summaries_changed_ = false;
 }
 
 void SqliteStorage::create_topic(const rosbag2_storage::TopicMetadata & topic)
 {
-  if (topics_.find(topic.name) == std::end(topics_)) {
-    auto insert_topic =
-      database_->prepare_statement(
-      "INSERT INTO topics (name, type, serialization_format, offered_qos_profiles) "
-      "VALUES (?, ?, ?, ?)");
+  create_topics({topic});
+}
+
+void SqliteStorage::create_topics(const std::vector<rosbag2_storage::TopicMetadata> & topics)
+{
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  // Inserted in one transaction, so the database is synced once instead of once per topic.
+  // Topics created during a batch of messages are committed with the batch.
+  const bool is_own_transaction = !active_transaction_;
+  activate_transaction();
+
+  auto insert_topic =
+    database_->get_cached_statement(
+    "INSERT INTO topics (name, type, serialization_format, offered_qos_profiles) "
+    "VALUES (?, ?, ?, ?)");
+  for (const auto & topic : topics) {
+    if (topics_.find(topic.name) != std::end(topics_)) {
+      continue;
+    }
     insert_topic->bind(
       topic.name, topic.type, topic.serialization_format, topic.offered_qos_profiles);
     insert_topic->execute_and_reset();
-    topics_.emplace(topic.name, static_cast<int>(database_->get_last_insert_id()));
+    const auto topic_id = static_cast<int>(database_->get_last_insert_id());
+    topics_.emplace(topic.name, topic_id);
+    has_all_topics_and_types_ = false;
   }
+
+  if (is_own_transaction) {
+    commit_transaction();
+  }
+}
+
+void SqliteStorage::set_topic_handle(
+  const std::string & topic_name, rosbag2_storage::TopicHandle handle)
+{
+  // Called while the writer's I/O thread may be writing messages, which look up their topic ids.
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  const auto topic = topics_.find(topic_name);
+  if (handle < 0 || topic == std::end(topics_)) {
+    return;
+  }
+  const auto index = static_cast<size_t>(handle);
+  if (index >= topic_ids_by_handle_.size()) {
+    topic_ids_by_handle_.resize(index + 1, -1);
+  }
+  topic_ids_by_handle_[index] = topic->second;
 }
 
 void SqliteStorage::remove_topic(const rosbag2_storage::TopicMetadata & topic)
 {
-  if (topics_.find(topic.name) != std::end(topics_)) {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  const auto topic_entry = topics_.find(topic.name);
+  if (topic_entry != std::end(topics_)) {
+    std::replace(
+      topic_ids_by_handle_.begin(), topic_ids_by_handle_.end(), topic_entry->second, -1);
     auto delete_topic =
-      database_->prepare_statement(
+      database_->get_cached_statement(
       "DELETE FROM topics where name = ? and type = ? and serialization_format = ?");
     delete_topic->bind(topic.name, topic.type, topic.serialization_format);
     delete_topic->execute_and_reset();
-    topics_.erase(topic.name);
+    topics_.erase(topic_entry);
+    has_all_topics_and_types_ = false;
   }
 }
 
 void SqliteStorage::prepare_for_writing()
 {
+  // Only databases with publish time stamps can have checksums or a data file.
+  std::string columns = "timestamp, topic_id, data";
+  std::string values = "?, ?, ?";
+  if (has_publish_timestamp_) {
+    columns += ", publish_timestamp";
+    values += ", ?";
+  }
+  if (has_checksum_) {
+    columns += ", checksum";
+    values += ", ?";
+  }
+  if (has_data_file_) {
+    columns += ", data_offset, data_length";
+    values += ", ?, ?";
+  }
+  if (is_clustered_) {
+    columns += ", id";
+    values += ", ?";
+  }
   write_statement_ = database_->prepare_statement(
-    "INSERT INTO messages (timestamp, topic_id, data) VALUES (?, ?, ?);");
+    "INSERT INTO messages (" + columns + ") VALUES (" + values + ");");
 }
 
 void SqliteStorage::prepare_for_reading()
 {
-  if (!storage_filter_.topics.empty()) {
-    // Construct string for selected topics
-    std::string topic_list{""};
-    for (auto & topic : storage_filter_.topics) {
-      topic_list += "'" + topic + "'";
-      if (&topic != &storage_filter_.topics.back()) {
-        topic_list += ",";
+  // Resolve topic names, and the topics passing the filter by name, regex or type, once, so
+  // the messages are neither joined with the topics nor filtered by name per row.
+  const rosbag2_storage::TopicFilter topic_filter(storage_filter_);
+  std::vector<int> topic_ids;
+  topic_names_by_id_.clear();
+  // Time ranges of the selected topics which have time ranges of their own.
+  std::map<int, std::vector<rosbag2_storage::TopicFilter::TimeRange>> topic_time_ranges;
+  bool all_topics_have_time_ranges = true;
+  auto topics_statement = database_->get_cached_statement("SELECT id, name, type FROM topics;");
+  topics_statement->execute_query<int, std::string, std::string>().for_each_row(
+    [this, &topic_filter, &topic_ids, &topic_time_ranges, &all_topics_have_time_ranges](
+      int id, std::string && name, std::string && type) {
+      const bool is_selected = topic_filter.is_selected(name, type);
+      if (!topic_filter.selects_all_topics() && is_selected) {
+        topic_ids.push_back(id);
+      }
+      if (is_selected && topic_filter.has_topic_time_ranges()) {
+        auto time_ranges = topic_filter.get_time_ranges(name);
+        if (time_ranges.empty()) {
+          all_topics_have_time_ranges = false;
+        } else {
+          topic_time_ranges.emplace(id, std::move(time_ranges));
+        }
       }
+      topic_names_by_id_.emplace(id, std::move(name));
+    });
+
+  // The time range is looked up in timestamp_idx, or publish_timestamp_idx when ordering by
+  // publish time, so seeking does not scan skipped messages.
+  const std::string order_column =
+    storage_filter_.order_by_publish_time && has_publish_timestamp_ ?
+    "publish_timestamp" : "timestamp";
+  // Messages of topics with time ranges of their own are only read within them. If all topics
+  // read have such ranges, the time range read is narrowed to the ranges' bounds as well.
+  auto filter_start_time = storage_filter_.start_time;
+  auto end_time = storage_filter_.end_time;
+  std::string time_range_condition;
+  if (!topic_time_ranges.empty()) {
+    std::string topic_list;
+    for (const auto & topic : topic_time_ranges) {
+      topic_list += (topic_list.empty() ? "" : ",") + std::to_string(topic.first);
+      time_range_condition += " OR topic_id = " + std::to_string(topic.first) + " AND " +
+        time_ranges_condition(topic.second, order_column);
     }
+    time_range_condition = "(topic_id NOT IN (" + topic_list + ")" + time_range_condition + ")";
+  }
+  if (all_topics_have_time_ranges && !topic_time_ranges.empty()) {
+    auto ranges_start = std::numeric_limits<rcutils_time_point_value_t>::max();
+    auto ranges_end = std::numeric_limits<rcutils_time_point_value_t>::min();
+    for (const auto & topic : topic_time_ranges) {
+      for (const auto & time_range : topic.second) {
+        ranges_start = std::min(ranges_start, time_range.first);
+        ranges_end = std::max(ranges_end, time_range.second);
+      }
+    }
+    filter_start_time = std::max(filter_start_time, ranges_start);
+    if (ranges_end < std::numeric_limits<rcutils_time_point_value_t>::max()) {
+      end_time = end_time > 0 ? std::min(end_time, ranges_end) : ranges_end;
+    }
+  }
+  const bool sample = storage_filter_.sample_stride > 1 || storage_filter_.sample_interval > 0;
+  if (sample) {
+    select_sampled_messages(
+      topic_ids, topic_filter.selects_all_topics(), order_column, filter_start_time, end_time,
+      time_range_condition);
+  }
+  // Every topic of a clustered database is read in time stamp order from its own contiguous part
+  // of the table, and SQLite merges them in a compound query, which needs no temporary sort.
+  std::vector<int> merged_topic_ids;
+  if (is_clustered_ && order_column == "timestamp") {
+    if (topic_filter.selects_all_topics()) {
+      for (const auto & topic : topic_names_by_id_) {
+        merged_topic_ids.push_back(topic.first);
+      }
+    } else {
+      merged_topic_ids = topic_ids;
+    }
+    if (merged_topic_ids.size() > MAX_MERGED_TOPICS) {
+      merged_topic_ids.clear();
+    }
+  }
+  const bool merge_topics = !merged_topic_ids.empty();
+  // If the messages were written in time stamp order, they are read in id order instead, which
+  // never needs a temporary sort. The time range is then translated to an id range.
+  const bool read_by_id =
+    !merge_topics && has_monotonic_timestamps_ && order_column == "timestamp";
+  const auto start_time = std::max(seek_time_, filter_start_time);
+  std::string conditions;
+  if (follow_after_message_id_ >= 0) {
+    conditions += "id > ?";
+  }
+  if (start_time > 0) {
+    conditions += std::string(conditions.empty() ? "" : " AND ") + (read_by_id ?
+      "id >= (SELECT id FROM messages WHERE timestamp >= ? ORDER BY timestamp LIMIT 1)" :
+      order_column + " >= ?");
+  }
+  if (end_time > 0) {
+    conditions += std::string(conditions.empty() ? "" : " AND ") + (read_by_id ?
+      "id <= (SELECT id FROM messages WHERE timestamp <= ? ORDER BY timestamp DESC LIMIT 1)" :
+      order_column + " <= ?");
+  }
+  if (sample) {
+    conditions += std::string(conditions.empty() ? "" : " AND ") +
+      "id IN (SELECT id FROM temp.sampled_messages)";
+  }
 
-    read_statement_ = database_->prepare_statement(
-      "SELECT data, timestamp, topics.name "
-      "FROM messages JOIN topics ON messages.topic_id = topics.id "
-      "WHERE topics.name IN (" + topic_list + ")"
-      "ORDER BY messages.timestamp;");
+  std::string query;
+  if (merge_topics) {
+    for (size_t i = 0; i < merged_topic_ids.size(); ++i) {
+      const auto time_ranges = topic_time_ranges.find(merged_topic_ids[i]);
+      query += std::string(i == 0 ? "" : " UNION ALL ") +
+        "SELECT " + get_read_columns() + " FROM messages WHERE topic_id = ?" +
+        (conditions.empty() ? std::string() : " AND " + conditions) +
+        (time_ranges == topic_time_ranges.end() ? std::string() :
+        " AND " + time_ranges_condition(time_ranges->second, order_column));
+    }
+    query += " ORDER BY timestamp, id;";
+  } else {
+    if (!topic_filter.selects_all_topics()) {
+      // SQLite accepts an empty list if none of the filtered topics is in the database.
+      std::string placeholders;
+      for (size_t i = 0; i < topic_ids.size(); ++i) {
+        placeholders += i == 0 ? "?" : ",?";
+      }
+      conditions = "topic_id IN (" + placeholders + ")" +
+        (conditions.empty() ? std::string() : " AND " + conditions);
+    }
+    if (!time_range_condition.empty()) {
+      conditions += (conditions.empty() ? "" : " AND ") + time_range_condition;
+    }
+    query = "SELECT " + get_read_columns() + " FROM messages " +
+      (conditions.empty() ? std::string() : "WHERE " + conditions + " ") +
+      "ORDER BY " + (read_by_id ? std::string("id") : order_column) + ";";
+  }
+
+  read_statement_ = database_->prepare_statement(query);
+  auto bind_conditions = [this, start_time, end_time]() {
+      if (follow_after_message_id_ >= 0) {
+        read_statement_->bind(follow_after_message_id_);
+      }
+      if (start_time > 0) {
+        read_statement_->bind(start_time);
+      }
+      if (end_time > 0) {
+        read_statement_->bind(end_time);
+      }
+    };
+  if (merge_topics) {
+    for (const auto topic_id : merged_topic_ids) {
+      read_statement_->bind(topic_id);
+      bind_conditions();
+    }
   } else {
-    read_statement_ = database_->prepare_statement(
-      "SELECT data, timestamp, topics.name "
-      "FROM messages JOIN topics ON messages.topic_id = topics.id "
-      "ORDER BY messages.timestamp;");
+    for (const auto topic_id : topic_ids) {
+      read_statement_->bind(topic_id);
+    }
+    bind_conditions();
   }
+  // Read before the query, so a commit in between is noticed by the next poll.
+  data_version_ = read_data_version();
   message_result_ = read_statement_->execute_query<
-    std::shared_ptr<rcutils_uint8_array_t>, rcutils_time_point_value_t, std::string>();
+    SqliteStatementWrapper::BlobView, rcutils_time_point_value_t, int, int64_t,
+    rcutils_time_point_value_t, int64_t, int64_t, int64_t>();
   current_message_row_ = message_result_.begin();
 }
 
-void SqliteStorage::fill_topics_and_types()
+void SqliteStorage::select_sampled_messages(
+  const std::vector<int> & topic_ids, bool all_topics, const std::string & order_column,
+  rcutils_time_point_value_t start_time, rcutils_time_point_value_t end_time,
+  const std::string & time_range_condition)
 {
+  // The previous query may still read the table, which SQLite then does not let us clear.
+  current_message_row_ = ReadQueryResult::Iterator(
+    nullptr, SqliteStatementWrapper::QueryResult<>::Iterator::POSITION_END);
+  message_result_ = ReadQueryResult(nullptr);
+  read_statement_ = nullptr;
+  // Messages followed after the last query continue the sampling of their topics.
+  if (follow_after_message_id_ < 0) {
+    sampled_topics_.clear();
+  }
+
+  // The temporary table is private to the connection, so it is written by read-only ones, too.
+  database_->get_cached_statement(
+    "CREATE TEMP TABLE IF NOT EXISTS sampled_messages (id INTEGER PRIMARY KEY);")
+  ->execute_and_reset();
+  database_->get_cached_statement("SAVEPOINT sample;")->execute_and_reset();
+  database_->get_cached_statement("DELETE FROM temp.sampled_messages;")->execute_and_reset();
+
+  // Only ids, topics and time stamps are read, which topic_timestamp_idx or the primary key of a
+  // clustered table cover, so no message data is read. The sampling starts at the filter's time
+  // range rather than the seek time, so seeking returns the same messages as reading through.
+  std::string conditions;
+  if (!all_topics) {
+    std::string placeholders;
+    for (size_t i = 0; i < topic_ids.size(); ++i) {
+      placeholders += i == 0 ? "?" : ",?";
+    }
+    conditions = "topic_id IN (" + placeholders + ")";
+  }
+  if (follow_after_message_id_ >= 0) {
+    conditions += std::string(conditions.empty() ? "" : " AND ") + "id > ?";
+  }
+  if (start_time > 0) {
+    conditions += std::string(conditions.empty() ? "" : " AND ") + order_column + " >= ?";
+  }
+  if (end_time > 0) {
+    conditions += std::string(conditions.empty() ? "" : " AND ") + order_column + " <= ?";
+  }
+  if (!time_range_condition.empty()) {
+    conditions += (conditions.empty() ? "" : " AND ") + time_range_condition;
+  }
   auto statement = database_->prepare_statement(
-    "SELECT name, type, serialization_format FROM topics ORDER BY id;");
-  auto query_results = statement->execute_query<std::string, std::string, std::string>();
+    "SELECT id, topic_id, " + order_column + " FROM messages " +
+    (conditions.empty() ? std::string() : "WHERE " + conditions + " ") +
+    "ORDER BY topic_id, " + order_column + ", id;");
+  if (!all_topics) {
+    for (const auto topic_id : topic_ids) {
+      statement->bind(topic_id);
+    }
+  }
+  if (follow_after_message_id_ >= 0) {
+    statement->bind(follow_after_message_id_);
+  }
+  if (start_time > 0) {
+    statement->bind(start_time);
+  }
+  if (end_time > 0) {
+    statement->bind(end_time);
+  }
 
-  for (auto result : query_results) {
-    all_topics_and_types_.push_back(
-      {std::get<0>(result), std::get<1>(result), std::get<2>(result), ""});
+  auto insert = database_->get_cached_statement(
+    "INSERT INTO temp.sampled_messages (id) VALUES (?);");
+  const auto stride = std::max<uint64_t>(storage_filter_.sample_stride, 1);
+  const auto interval = storage_filter_.sample_interval;
+  statement->execute_query<int64_t, int, rcutils_time_point_value_t>().for_each_row(
+    [this, &insert, stride, interval](
+      int64_t id, int topic_id, rcutils_time_point_value_t timestamp) {
+      auto sampled_topic = sampled_topics_.find(topic_id);
+      if (sampled_topic == sampled_topics_.end()) {
+        sampled_topic = sampled_topics_.emplace(topic_id, SampledTopic{0, timestamp}).first;
+      } else if (interval > 0 && timestamp - sampled_topic->second.last_timestamp < interval) {
+        return;
+      }
+      sampled_topic->second.last_timestamp = timestamp;
+      if (sampled_topic->second.message_count++ % stride == 0) {
+        insert->bind(id);
+        insert->execute_and_reset();
+      }
+    });
+  database_->get_cached_statement("RELEASE sample;")->execute_and_reset();
+}
+
+bool SqliteStorage::poll_new_messages()
+{
+  if (read_statement_ && current_message_row_ != message_result_.end()) {
+    return true;
+  }
+  if (read_statement_ && read_data_version() == data_version_) {
+    return false;
   }
+  follow_after_message_id_ = max_read_message_id_;
+  // Resetting the finished query ends its read transaction, so the next one sees the latest
+  // commit.
+  if (read_statement_) {
+    read_statement_->reset();
+  }
+  read_statement_ = nullptr;
+  prepare_for_reading();
+  return current_message_row_ != message_result_.end();
+}
+
+int64_t SqliteStorage::read_data_version() const
+{
+  // Changes whenever another connection commits to the database.
+  auto statement = database_->prepare_statement("PRAGMA data_version;");
+  return std::get<0>(statement->execute_query<int64_t>().get_single_line());
+}
+
+std::string SqliteStorage::get_read_columns() const
+{
+  // Large messages are not selected but read incrementally by id in read_row(), so SQLite
+  // copies them only once, straight into the message buffer. Tables without rowid, i.e.
+  // clustered ones, cannot be read incrementally.
+  const std::string data = is_clustered_ ? std::string("data") :
+    "CASE WHEN length(data) <= " + std::to_string(MAX_SELECTED_BLOB_SIZE) + " THEN data END";
+  return data + ", timestamp, topic_id, id, " +
+         (has_publish_timestamp_ ? "publish_timestamp" : "0") + ", " +
+         (has_checksum_ ? "checksum" : "-1") + ", " +
+         (has_data_file_ ? "data_offset, data_length" : "-1, 0");
+}
+
+void SqliteStorage::fill_topics_and_types()
+{
+  all_topics_and_types_.clear();
+  auto statement = database_->get_cached_statement(
+    "SELECT name, type, serialization_format, " + offered_qos_profiles_column() +
+    " FROM topics ORDER BY id;");
+  statement->execute_query<std::string, std::string, std::string, std::string>().for_each_row(
+    [this](
+      std::string && name, std::string && type, std::string && serialization_format,
+      std::string && offered_qos_profiles) {
+      all_topics_and_types_.push_back(
+        {std::move(name), std::move(type), std::move(serialization_format),
+          std::move(offered_qos_profiles)});
+    });
+  has_all_topics_and_types_ = true;
 }
 
 std::string SqliteStorage::get_storage_identifier() const
@@ -304,6 +1222,18 @@ std::string SqliteStorage::get_storage_identifier() const
   return "sqlite3";
 }
 
+rosbag2_storage::StorageCapabilities SqliteStorage::get_capabilities() const
+{
+  rosbag2_storage::StorageCapabilities capabilities;
+  // Batches are written in one transaction.
+  capabilities.batch_write = true;
+  capabilities.seek = true;
+  capabilities.message_pool = true;
+  capabilities.random_access = true;
+  capabilities.sampling = true;
+  return capabilities;
+}
+
 std::string SqliteStorage::get_relative_file_path() const
 {
   return relative_path_;
@@ -316,6 +1246,7 @@ uint64_t SqliteStorage::get_minimum_split_file_size() const
 
 rosbag2_storage::BagMetadata SqliteStorage::get_metadata()
 {
+  std::lock_guard<std::mutex> lock(write_mutex_);
   rosbag2_storage::BagMetadata metadata;
   metadata.storage_identifier = get_storage_identifier();
   metadata.relative_file_paths = {get_relative_file_path()};
@@ -323,28 +1254,34 @@ rosbag2_storage::BagMetadata SqliteStorage::get_metadata()
   metadata.message_count = 0;
   metadata.topics_with_message_count = {};
 
-  auto statement = database_->prepare_statement(
-    "SELECT name, type, serialization_format, COUNT(messages.id), MIN(messages.timestamp), "
-    "MAX(messages.timestamp) "
-    "FROM messages JOIN topics on topics.id = messages.topic_id "
-    "GROUP BY topics.name;");
-  auto query_results = statement->execute_query<
-    std::string, std::string, std::string, int, rcutils_time_point_value_t,
-    rcutils_time_point_value_t>();
+  std::unordered_map<int, TopicSummary> topic_summaries;
+  read_topic_summaries(topic_summaries);
 
+  auto statement = database_->get_cached_statement(
+    "SELECT id, name, type, serialization_format, " + offered_qos_profiles_column() +
+    " FROM topics ORDER BY name;");
   rcutils_time_point_value_t min_time = INT64_MAX;
   rcutils_time_point_value_t max_time = 0;
-  for (auto result : query_results) {
-    metadata.topics_with_message_count.push_back(
-      {
-        {std::get<0>(result), std::get<1>(result), std::get<2>(result), ""},
-        static_cast<size_t>(std::get<3>(result))
-      });
+  statement->execute_query<int, std::string, std::string, std::string, std::string>()
+  .for_each_row(
+    [&topic_summaries, &metadata, &min_time, &max_time](
+      int topic_id, std::string && name, std::string && type,
+      std::string && serialization_format, std::string && offered_qos_profiles) {
+      const auto summary = topic_summaries.find(topic_id);
+      if (summary == topic_summaries.end() || summary->second.message_count == 0) {
+        return;
+      }
+      metadata.topics_with_message_count.push_back(
+        {
+          {std::move(name), std::move(type), std::move(serialization_format),
+            std::move(offered_qos_profiles)},
+          static_cast<size_t>(summary->second.message_count)
+        });
 
-    metadata.message_count += std::get<3>(result);
-    min_time = std::get<4>(result) < min_time ? std::get<4>(result) : min_time;
-    max_time = std::get<5>(result) > max_time ? std::get<5>(result) : max_time;
-  }
+      metadata.message_count += summary->second.message_count;
+      min_time = std::min(min_time, summary->second.min_timestamp);
+      max_time = std::max(max_time, summary->second.max_timestamp);
+    });
 
   if (metadata.message_count == 0) {
     min_time = 0;
@@ -354,20 +1291,252 @@ rosbag2_storage::BagMetadata SqliteStorage::get_metadata()
   metadata.starting_time =
     std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(min_time));
   metadata.duration = std::chrono::nanoseconds(max_time) - std::chrono::nanoseconds(min_time);
-  metadata.bag_size = get_bagfile_size();
+  metadata.bag_size = read_bagfile_size();
 
   return metadata;
 }
 
+std::vector<rosbag2_storage::TopicInformation> SqliteStorage::get_topic_sizes()
+{
+  // length() of a blob is read from the record header, without loading the blob.
+  const std::string size = has_data_file_ ?
+    "CASE WHEN messages.data_offset >= 0 THEN messages.data_length "
+    "ELSE LENGTH(messages.data) END" :
+    "LENGTH(messages.data)";
+  auto statement = database_->prepare_statement(
+    "SELECT topics.name, topics.type, topics.serialization_format, " +
+    offered_qos_profiles_column() + ", COUNT(*), "
+    "SUM(" + size + "), MAX(" + size + ") "
+    "FROM messages JOIN topics ON messages.topic_id = topics.id "
+    "GROUP BY topics.id ORDER BY topics.name;");
+  std::vector<rosbag2_storage::TopicInformation> topics;
+  statement->execute_query<
+    std::string, std::string, std::string, std::string, int64_t, int64_t, int64_t>()
+  .for_each_row(
+    [&topics](
+      std::string && name, std::string && type, std::string && serialization_format,
+      std::string && offered_qos_profiles, int64_t message_count, int64_t total_size,
+      int64_t max_message_size) {
+      rosbag2_storage::TopicInformation topic{};
+      topic.topic_metadata = {
+        std::move(name), std::move(type), std::move(serialization_format),
+        std::move(offered_qos_profiles)};
+      topic.message_count = static_cast<size_t>(message_count);
+      topic.total_size = static_cast<uint64_t>(total_size);
+      topic.max_message_size = static_cast<uint64_t>(max_message_size);
+      topics.push_back(std::move(topic));
+    });
+  return topics;
+}
+
 void SqliteStorage::set_filter(
   const rosbag2_storage::StorageFilter & storage_filter)
 {
   storage_filter_ = storage_filter;
+  max_read_message_id_ = -1;
+  follow_after_message_id_ = -1;
+  read_statement_ = nullptr;
 }
 
 void SqliteStorage::reset_filter()
 {
   storage_filter_ = rosbag2_storage::StorageFilter();
+  max_read_message_id_ = -1;
+  follow_after_message_id_ = -1;
+  read_statement_ = nullptr;
+}
+
+void SqliteStorage::seek(const rcutils_time_point_value_t & timestamp)
+{
+  seek_time_ = timestamp;
+  max_read_message_id_ = -1;
+  follow_after_message_id_ = -1;
+  // The next read prepares a new query starting at the seek time.
+  read_statement_ = nullptr;
+}
+
+uint64_t SqliteStorage::get_topic_message_count(const std::string & topic_name)
+{
+  return get_topic_index(topic_name).message_ids.size();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> SqliteStorage::read_topic_message(
+  const std::string & topic_name, uint64_t index)
+{
+  const auto & topic_index = get_topic_index(topic_name);
+  if (index >= topic_index.message_ids.size()) {
+    throw std::out_of_range(
+            "Topic '" + topic_name + "' of '" + relative_path_ + "' has no message " +
+            std::to_string(index) + ".");
+  }
+
+  if (!topic_message_statement_) {
+    topic_message_statement_ = database_->prepare_statement(
+      "SELECT " + get_read_columns() + " FROM messages WHERE id = ?;");
+  }
+  topic_message_statement_->reset();
+  topic_message_statement_->bind(topic_index.message_ids[index]);
+  auto result = topic_message_statement_->execute_query<
+    SqliteStatementWrapper::BlobView, rcutils_time_point_value_t, int, int64_t,
+    rcutils_time_point_value_t, int64_t, int64_t, int64_t>();
+  auto row = result.begin();
+  if (row == result.end()) {
+    throw SqliteException(
+            "Message " + std::to_string(topic_index.message_ids[index]) + " of '" +
+            relative_path_ + "' was not found.");
+  }
+  auto message = read_row(row);
+  // Ends the read transaction, so the statement does not keep a snapshot of the database.
+  topic_message_statement_->reset();
+  return message;
+}
+
+uint64_t SqliteStorage::find_topic_message(
+  const std::string & topic_name, const rcutils_time_point_value_t & timestamp)
+{
+  const auto & timestamps = get_topic_index(topic_name).timestamps;
+  return static_cast<uint64_t>(
+    std::lower_bound(timestamps.begin(), timestamps.end(), timestamp) - timestamps.begin());
+}
+
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+SqliteStorage::read_latest_messages(
+  const std::vector<std::string> & topic_names, const rcutils_time_point_value_t & timestamp)
+{
+  if (!latest_message_statement_) {
+    latest_message_statement_ = database_->prepare_statement(
+      "SELECT " + get_read_columns() + " FROM messages WHERE topic_id = ? AND timestamp < ? "
+      "ORDER BY timestamp DESC, id DESC LIMIT 1;");
+  }
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  auto topic_statement = database_->get_cached_statement("SELECT id FROM topics WHERE name = ?;");
+  for (const auto & topic_name : topic_names) {
+    topic_statement->reset();
+    topic_statement->bind(topic_name);
+    topic_statement->execute_query<int>().for_each_row(
+      [this, &topic_name, &timestamp, &messages](int topic_id) {
+        // read_row() names the messages by their topic id.
+        topic_names_by_id_.emplace(topic_id, topic_name);
+        latest_message_statement_->reset();
+        latest_message_statement_->bind(topic_id, timestamp);
+        auto result = latest_message_statement_->execute_query<
+          SqliteStatementWrapper::BlobView, rcutils_time_point_value_t, int, int64_t,
+          rcutils_time_point_value_t, int64_t, int64_t, int64_t>();
+        auto row = result.begin();
+        if (row != result.end()) {
+          messages.push_back(read_row(row));
+        }
+      });
+  }
+  // Ends the read transaction, so the statement does not keep a snapshot of the database.
+  latest_message_statement_->reset();
+  return messages;
+}
+
+const SqliteStorage::TopicIndex & SqliteStorage::get_topic_index(const std::string & topic_name)
+{
+  const auto cached_index = topic_indices_.find(topic_name);
+  if (cached_index != topic_indices_.end()) {
+    return cached_index->second;
+  }
+
+  TopicIndex topic_index;
+  auto topic_statement = database_->get_cached_statement("SELECT id FROM topics WHERE name = ?;");
+  topic_statement->bind(topic_name);
+  topic_statement->execute_query<int>().for_each_row(
+    [this, &topic_name, &topic_index](int topic_id) {
+      // read_row() names the messages by their topic id.
+      topic_names_by_id_.emplace(topic_id, topic_name);
+      // The id breaks ties in the same order as topic_timestamp_idx, which sorts by it last.
+      auto statement = database_->prepare_statement(
+        "SELECT id, timestamp FROM messages WHERE topic_id = ? ORDER BY timestamp, id;");
+      statement->bind(topic_id);
+      statement->execute_query<int64_t, rcutils_time_point_value_t>().for_each_row(
+        [&topic_index](int64_t message_id, rcutils_time_point_value_t timestamp) {
+          topic_index.message_ids.push_back(message_id);
+          topic_index.timestamps.push_back(timestamp);
+        });
+    });
+  return topic_indices_.emplace(topic_name, std::move(topic_index)).first->second;
+}
+
+void SqliteStorage::set_message_pool(std::shared_ptr<rosbag2_storage::MessagePool> message_pool)
+{
+  message_pool_ = std::move(message_pool);
+}
+
+std::string SqliteStorage::slice(
+  const std::string & uri, const rcutils_time_point_value_t & start_time,
+  const rcutils_time_point_value_t & end_time)
+{
+  rosbag2_storage::StorageConfig slice_config{};
+  slice_config.checksums = has_checksum_;
+  slice_config.cluster_messages_by_topic = is_clustered_;
+  slice_config.large_message_threshold = has_data_file_ ? 1 : 0;
+  slice_config.topic_timestamp_index = has_schema_entry("index", "topic_timestamp_idx");
+  // Indexing the copied messages once is faster than updating the indices per row.
+  slice_config.defer_index_creation = true;
+  SqliteStorage slice;
+  slice.open(uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, slice_config);
+
+  // Attached to the writable connection of the slice, as databases attached to a read-only
+  // connection are read-only, too. Attaching is not possible within a transaction.
+  auto attach = slice.database_->prepare_statement("ATTACH DATABASE ? AS source;");
+  attach->bind(relative_path_);
+  attach->execute_and_reset();
+  slice.activate_transaction();
+
+  slice.database_->prepare_statement(
+    "INSERT INTO topics (id, name, type, serialization_format, offered_qos_profiles) "
+    "SELECT id, name, type, serialization_format, " + offered_qos_profiles_column() +
+    " FROM source.topics;")->execute_and_reset();
+
+  // The slice has all the columns of this database, and publish time stamps in any case.
+  std::string columns = "id, topic_id, timestamp, data, publish_timestamp";
+  std::string source_columns = std::string("id, topic_id, timestamp, data, ") +
+    (has_publish_timestamp_ ? "publish_timestamp" : "timestamp");
+  if (has_checksum_) {
+    columns += ", checksum";
+    source_columns += ", checksum";
+  }
+  if (has_data_file_) {
+    columns += ", data_offset, data_length";
+    source_columns += ", data_offset, data_length";
+  }
+  auto copy_messages = slice.database_->prepare_statement(
+    "INSERT INTO messages (" + columns + ") SELECT " + source_columns +
+    " FROM source.messages WHERE timestamp >= ? AND timestamp <= ?;");
+  copy_messages->bind(start_time, end_time);
+  copy_messages->execute_and_reset();
+
+  if (has_data_file_) {
+    // The data of large messages is appended to the data file of the slice in id order, so it
+    // stays in the order it was recorded in.
+    std::vector<std::tuple<int64_t, int64_t, int64_t>> large_messages;
+    slice.database_->prepare_statement(
+      "SELECT id, data_offset, data_length FROM messages WHERE data_offset >= 0 ORDER BY id;")
+    ->execute_query<int64_t, int64_t, int64_t>().for_each_row(
+      [&large_messages](int64_t message_id, int64_t data_offset, int64_t data_length) {
+        large_messages.emplace_back(message_id, data_offset, data_length);
+      });
+    auto update_offset = slice.database_->prepare_statement(
+      "UPDATE messages SET data_offset = ? WHERE id = ?;");
+    for (const auto & large_message : large_messages) {
+      const auto data = get_data_file().read(
+        static_cast<uint64_t>(std::get<1>(large_message)),
+        static_cast<uint64_t>(std::get<2>(large_message)), nullptr);
+      update_offset->bind(
+        static_cast<int64_t>(slice.data_file_->append(*data)), std::get<0>(large_message));
+      update_offset->execute_and_reset();
+    }
+  }
+
+  slice.last_message_id_ = slice.read_topic_summaries(slice.topic_summaries_);
+  slice.topic_summaries_changed_ = true;
+  slice.write_monotonic_timestamps(has_monotonic_timestamps_);
+  slice.commit_transaction();
+  slice.database_->prepare_statement("DETACH DATABASE source;")->execute_and_reset();
+  return slice.get_relative_file_path();
 }
 
 }  // namespace rosbag2_storage_plugins
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "rcutils/types.h"
+#include "rosbag2_storage/ros_helper.hpp"
 #include "rosbag2_storage/serialized_bag_message.hpp"
 
 #include "rosbag2_storage_default_plugins/sqlite/sqlite_exception.hpp"
@@ -31,7 +32,8 @@ namespace rosbag2_storage_plugins
 {
 
 SqliteWrapper::SqliteWrapper(
-  const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag)
+  const std::string & uri, rosbag2_storage::storage_interfaces::IOFlag io_flag,
+  const std::vector<std::string> & pragmas)
 : db_ptr(nullptr)
 {
   if (io_flag == rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY) {
@@ -44,8 +46,8 @@ SqliteWrapper::SqliteWrapper(
         rc << "): " << sqlite3_errstr(rc);
       throw SqliteException{errmsg.str()};
     }
-    // throws an exception if the database is not valid.
-    prepare_statement("PRAGMA schema_version;")->execute_and_reset();
+    // Reading pages from the mapped file spares copying them from the OS into SQLite's cache.
+    prepare_statement("PRAGMA mmap_size = 268435456;")->execute_and_reset();
   } else {
     int rc = sqlite3_open_v2(
       uri.c_str(), &db_ptr,
@@ -56,8 +58,13 @@ SqliteWrapper::SqliteWrapper(
         rc << "): " << sqlite3_errstr(rc);
       throw SqliteException{errmsg.str()};
     }
-    prepare_statement("PRAGMA journal_mode = WAL;")->execute_and_reset();
-    prepare_statement("PRAGMA synchronous = NORMAL;")->execute_and_reset();
+    if (pragmas.empty()) {
+      prepare_statement("PRAGMA journal_mode = WAL;")->execute_and_reset();
+      prepare_statement("PRAGMA synchronous = NORMAL;")->execute_and_reset();
+    }
+    for (const auto & pragma : pragmas) {
+      prepare_statement("PRAGMA " + pragma + ";")->execute_and_reset();
+    }
   }
 
   sqlite3_extended_result_codes(db_ptr, 1);
@@ -68,6 +75,9 @@ SqliteWrapper::SqliteWrapper()
 
 SqliteWrapper::~SqliteWrapper()
 {
+  close_blob();
+  // Cached statements are finalized before closing, otherwise the database stays open.
+  statement_cache_.clear();
   const int rc = sqlite3_close(db_ptr);
   if (rc != SQLITE_OK) {
     ROSBAG2_STORAGE_DEFAULT_PLUGINS_LOG_ERROR_STREAM(
@@ -81,11 +91,67 @@ SqliteStatement SqliteWrapper::prepare_statement(const std::string & query)
   return std::make_shared<SqliteStatementWrapper>(db_ptr, query);
 }
 
+SqliteStatement SqliteWrapper::get_cached_statement(const std::string & query)
+{
+  auto & statement = statement_cache_[query];
+  if (!statement) {
+    statement = prepare_statement(query);
+    return statement;
+  }
+  return statement->reset();
+}
+
 size_t SqliteWrapper::get_last_insert_id()
 {
   return sqlite3_last_insert_rowid(db_ptr);
 }
 
+std::shared_ptr<rcutils_uint8_array_t> SqliteWrapper::read_blob(
+  const std::string & table, const std::string & column, int64_t row_id,
+  const std::shared_ptr<rosbag2_storage::MessagePool> & message_pool)
+{
+  int rc;
+  if (blob_ptr_ && blob_table_ == table && blob_column_ == column) {
+    rc = sqlite3_blob_reopen(blob_ptr_, row_id);
+  } else {
+    close_blob();
+    rc = sqlite3_blob_open(
+      db_ptr, "main", table.c_str(), column.c_str(), row_id, 0, &blob_ptr_);
+    blob_table_ = table;
+    blob_column_ = column;
+  }
+  if (rc != SQLITE_OK) {
+    // A handle which failed to move to the row is aborted and can only be closed.
+    close_blob();
+    std::stringstream errmsg;
+    errmsg << "Could not open BLOB '" << column << "' of row " << row_id << " in table '" <<
+      table << "'. SQLite error (" << rc << "): " << sqlite3_errstr(rc);
+    throw SqliteException{errmsg.str()};
+  }
+
+  const auto size = sqlite3_blob_bytes(blob_ptr_);
+  auto blob = message_pool ?
+    message_pool->make_empty_serialized_message(static_cast<size_t>(size)) :
+    rosbag2_storage::make_empty_serialized_message(static_cast<size_t>(size));
+  rc = sqlite3_blob_read(blob_ptr_, blob->buffer, size, 0);
+  if (rc != SQLITE_OK) {
+    std::stringstream errmsg;
+    errmsg << "Could not read BLOB '" << column << "' of row " << row_id << " in table '" <<
+      table << "'. SQLite error (" << rc << "): " << sqlite3_errstr(rc);
+    throw SqliteException{errmsg.str()};
+  }
+  blob->buffer_length = static_cast<size_t>(size);
+  return blob;
+}
+
+void SqliteWrapper::close_blob()
+{
+  if (blob_ptr_) {
+    sqlite3_blob_close(blob_ptr_);
+    blob_ptr_ = nullptr;
+  }
+}
+
 SqliteWrapper::operator bool()
 {
   return db_ptr != nullptr;
@@ -0,0 +1,793 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include "rosbag2_storage_default_plugins/binary_log/binary_log_storage.hpp"
+#include "rosbag2_storage_default_plugins/binary_log/ingest_server.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+using rosbag2_storage::storage_interfaces::IOFlag;
+
+#ifndef _WIN32
+namespace
+{
+// Serves a file over HTTP on a local port, answering range requests like object storage does,
+// or claiming a far larger body than it sends if so asked.
+class RangeServer
+{
+public:
+  explicit RangeServer(const std::string & path, bool overstates_length = false)
+  : overstates_length_(overstates_length)
+  {
+    std::ifstream input(path, std::ios::binary);
+    data_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    listen_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_size = sizeof(address);
+    bind(listen_socket_, reinterpret_cast<sockaddr *>(&address), address_size);
+    listen(listen_socket_, 16);
+    getsockname(listen_socket_, reinterpret_cast<sockaddr *>(&address), &address_size);
+    port_ = ntohs(address.sin_port);
+    accept_thread_ = std::thread(&RangeServer::accept_connections, this);
+  }
+
+  ~RangeServer()
+  {
+    shutdown(listen_socket_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_socket_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < connection_threads_.size(); ++i) {
+      shutdown(connection_sockets_[i], SHUT_RDWR);
+      connection_threads_[i].join();
+      close(connection_sockets_[i]);
+    }
+  }
+
+  std::string get_url(const std::string & path) const
+  {
+    return "http://127.0.0.1:" + std::to_string(port_) + "/" + path;
+  }
+
+private:
+  void accept_connections()
+  {
+    int connection_socket;
+    while ((connection_socket = accept(listen_socket_, nullptr, nullptr)) >= 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      connection_sockets_.push_back(connection_socket);
+      connection_threads_.emplace_back(&RangeServer::serve, this, connection_socket);
+    }
+  }
+
+  void serve(int connection_socket)
+  {
+    std::string buffer;
+    char received[4096];
+    ssize_t received_size;
+    while ((received_size = recv(connection_socket, received, sizeof(received), 0)) > 0) {
+      buffer.append(received, static_cast<size_t>(received_size));
+      size_t header_end;
+      while ((header_end = buffer.find("\r\n\r\n")) != std::string::npos) {
+        const auto header = buffer.substr(0, header_end);
+        buffer.erase(0, header_end + 4);
+        if (!send_range(connection_socket, header)) {
+          return;
+        }
+      }
+    }
+  }
+
+  // Answers "Range: bytes=first-last" and "Range: bytes=-suffix_size".
+  bool send_range(int connection_socket, const std::string & header)
+  {
+    const auto range_start = header.find("Range: bytes=") + std::string("Range: bytes=").size();
+    const auto separator = header.find('-', range_start);
+    const auto range_end = header.find("\r\n", separator);
+    const auto last = std::string(header, separator + 1, range_end - separator - 1);
+    size_t first = 0;
+    size_t end = data_.size();
+    if (separator == range_start) {
+      first = end - std::min(end, std::stoul(last));
+    } else {
+      first = std::stoul(header.substr(range_start, separator - range_start));
+      end = std::min(end, std::stoul(last) + 1);
+    }
+    const auto content_length = overstates_length_ ? "1000000000000" : std::to_string(end - first);
+    const auto response = "HTTP/1.1 206 Partial Content\r\nContent-Length: " +
+      content_length + "\r\nContent-Range: bytes " + std::to_string(first) + "-" +
+      std::to_string(end - 1) + "/" + std::to_string(data_.size()) + "\r\n\r\n" +
+      data_.substr(first, end - first);
+    return send(connection_socket, response.data(), response.size(), MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(response.size());
+  }
+
+  std::string data_;
+  bool overstates_length_;
+  int listen_socket_;
+  uint16_t port_;
+  std::thread accept_thread_;
+  std::mutex mutex_;
+  std::vector<int> connection_sockets_;
+  std::vector<std::thread> connection_threads_;
+};
+}  // namespace
+#endif
+
+class BinaryLogStorageTestFixture : public TemporaryDirectoryFixture
+{
+public:
+  BinaryLogStorageTestFixture()
+  {
+    uri_ = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+    file_path_ = uri_ + ".binlog";
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+    const std::string & topic_name, rcutils_time_point_value_t time_stamp,
+    const std::string & content)
+  {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->serialized_data = rosbag2_storage::make_serialized_message(
+      content.data(), content.size());
+    message->time_stamp = time_stamp;
+    message->topic_name = topic_name;
+    return message;
+  }
+
+  // Writes messages of topic1 and topic2 at the given time stamps, named after their position.
+  void write_messages(
+    rosbag2_storage_plugins::BinaryLogStorage & storage,
+    const std::vector<std::pair<std::string, rcutils_time_point_value_t>> & messages)
+  {
+    storage.create_topic({"topic1", "type1", "rmw1", ""});
+    storage.create_topic({"topic2", "type2", "rmw2", ""});
+    for (const auto & message : messages) {
+      storage.write(
+        make_message(
+          message.first, message.second, "message " + std::to_string(message.second)));
+    }
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_all_messages(
+    rosbag2_storage::storage_interfaces::ReadOnlyInterface & storage)
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+    while (storage.has_next()) {
+      messages.push_back(storage.read_next());
+    }
+    return messages;
+  }
+
+  std::vector<rcutils_time_point_value_t> get_time_stamps(
+    const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages)
+  {
+    std::vector<rcutils_time_point_value_t> time_stamps;
+    for (const auto & message : messages) {
+      time_stamps.push_back(message->time_stamp);
+    }
+    return time_stamps;
+  }
+
+  // Copies the file as it is on disk, without its last bytes, like after a crash.
+  std::string copy_file(const std::string & path, size_t dropped_bytes = 0)
+  {
+    std::ifstream input(path, std::ios::binary);
+    std::vector<char> data{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    data.resize(data.size() - dropped_bytes);
+    const auto copy_path = path + ".copy";
+    std::ofstream output(copy_path, std::ios::binary | std::ios::trunc);
+    output.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return copy_path;
+  }
+
+  rosbag2_storage::StorageConfig make_config_with_chunk_messages(uint64_t max_messages)
+  {
+    rosbag2_storage::StorageConfig storage_config;
+    storage_config.transaction_max_messages = max_messages;
+    return storage_config;
+  }
+
+  std::string uri_;
+  std::string file_path_;
+};
+
+TEST_F(BinaryLogStorageTestFixture, messages_are_written_and_read_in_time_stamp_order) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+    write_messages(storage, {{"topic1", 3}, {"topic2", 1}, {"topic1", 4}, {"topic2", 2}});
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(storage);
+
+  ASSERT_THAT(get_time_stamps(messages), ElementsAre(1, 2, 3, 4));
+  EXPECT_THAT(messages[0]->topic_name, Eq("topic2"));
+  EXPECT_THAT(messages[2]->topic_name, Eq("topic1"));
+  EXPECT_THAT(
+    std::string(
+      reinterpret_cast<const char *>(messages[3]->serialized_data->buffer),
+      messages[3]->serialized_data->buffer_length), Eq("message 4"));
+  EXPECT_THAT(messages[3]->publish_time_stamp, Eq(4));
+}
+
+TEST_F(BinaryLogStorageTestFixture, messages_read_from_a_mapped_file_outlive_the_storage) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+    write_messages(storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}});
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(file_path_, IOFlag::READ_ONLY);
+    messages = read_all_messages(storage);
+  }
+
+  ASSERT_THAT(messages, SizeIs(3));
+  for (const auto & message : messages) {
+    EXPECT_THAT(
+      std::string(
+        reinterpret_cast<const char *>(message->serialized_data->buffer),
+        message->serialized_data->buffer_length),
+      Eq("message " + std::to_string(message->time_stamp)));
+  }
+}
+
+TEST_F(BinaryLogStorageTestFixture, visit_next_batch_passes_views_valid_across_chunks) {
+  // The file opened for writing is not mapped, so the views reference the chunks read.
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+  write_messages(storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}, {"topic2", 4}});
+
+  std::vector<std::string> contents;
+  std::vector<std::string> topic_names;
+  const auto collect = [&](const std::vector<rosbag2_storage::SerializedBagMessageView> & views) {
+      for (const auto & view : views) {
+        contents.emplace_back(
+          reinterpret_cast<const char *>(view.serialized_data.data), view.serialized_data.size);
+        topic_names.push_back(*view.topic_name);
+      }
+    };
+  EXPECT_TRUE(storage.visit_next_batch(collect, 3, 0));
+  EXPECT_THAT(contents, SizeIs(3));
+  EXPECT_TRUE(storage.visit_next_batch(collect, 0, 0));
+  EXPECT_FALSE(storage.visit_next_batch(collect, 0, 0));
+
+  EXPECT_THAT(contents, ElementsAre("message 1", "message 2", "message 3", "message 4"));
+  EXPECT_THAT(topic_names, ElementsAre("topic1", "topic2", "topic1", "topic2"));
+}
+
+TEST_F(BinaryLogStorageTestFixture, messages_read_from_mapped_files_reference_the_mapping) {
+  rosbag2_storage_plugins::BinaryLogStorage writing_storage;
+  writing_storage.open(uri_, IOFlag::READ_WRITE);
+  EXPECT_TRUE(writing_storage.get_capabilities().seek);
+  write_messages(writing_storage, {{"topic1", 1}});
+  writing_storage.open(uri_ + "_other", IOFlag::READ_WRITE);
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  ASSERT_TRUE(storage.has_next());
+  EXPECT_TRUE(rosbag2_storage::is_serialized_data_view(*storage.read_next()->serialized_data));
+}
+
+TEST_F(BinaryLogStorageTestFixture, mapped_messages_can_be_modified_without_changing_the_file) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(storage, {{"topic1", 1}, {"topic1", 2}});
+  }
+
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(file_path_, IOFlag::READ_ONLY);
+    auto messages = read_all_messages(storage);
+    ASSERT_THAT(messages, SizeIs(2));
+
+    auto & first = *messages[0]->serialized_data;
+    first.buffer[0] = 'M';
+    auto & second = *messages[1]->serialized_data;
+    ASSERT_THAT(rcutils_uint8_array_resize(&second, 100), Eq(RCUTILS_RET_OK));
+    second.buffer_length = 100;
+    second.buffer[99] = 'x';
+    EXPECT_THAT(
+      std::string(reinterpret_cast<const char *>(second.buffer), 9), Eq("message 2"));
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(storage);
+  ASSERT_THAT(messages, SizeIs(2));
+  EXPECT_THAT(messages[0]->serialized_data->buffer[0], Eq('m'));
+  EXPECT_THAT(messages[1]->serialized_data->buffer_length, Eq(9u));
+}
+
+TEST_F(BinaryLogStorageTestFixture, get_metadata_returns_the_summary_written_on_close) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+    write_messages(storage, {{"topic1", 10}, {"topic2", 20}, {"topic1", 40}});
+    storage.create_topic({"topic3", "type3", "rmw3", ""});
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  const auto metadata = storage.get_metadata();
+
+  EXPECT_THAT(metadata.storage_identifier, Eq("binary_log"));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre(file_path_));
+  EXPECT_THAT(metadata.message_count, Eq(3u));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(2));
+  EXPECT_THAT(metadata.topics_with_message_count[0].topic_metadata.name, Eq("topic1"));
+  EXPECT_THAT(metadata.topics_with_message_count[0].message_count, Eq(2u));
+  EXPECT_THAT(metadata.topics_with_message_count[1].topic_metadata.type, Eq("type2"));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch(), Eq(std::chrono::nanoseconds(10)));
+  EXPECT_THAT(metadata.duration, Eq(std::chrono::nanoseconds(30)));
+  EXPECT_THAT(metadata.bag_size, Gt(0u));
+  EXPECT_THAT(storage.get_all_topics_and_types(), SizeIs(3));
+}
+
+TEST_F(BinaryLogStorageTestFixture, read_next_returns_messages_of_the_filtered_topics_and_time) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+    write_messages(
+      storage, {{"topic1", 1}, {"topic1", 2}, {"topic2", 3}, {"topic1", 4}, {"topic2", 5}});
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic2"};
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(3, 5));
+
+  storage_filter.topics = {};
+  storage_filter.start_time = 2;
+  storage_filter.end_time = 4;
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(2, 3, 4));
+
+  // The first chunk holds no message of topic1 within its time range, nor of topic2.
+  storage_filter.start_time = 0;
+  storage_filter.end_time = 0;
+  storage_filter.topic_time_ranges = {{"topic1", 3, 4}};
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(3, 4, 5));
+
+  storage.reset_filter();
+  EXPECT_THAT(read_all_messages(storage), SizeIs(5));
+}
+
+TEST_F(BinaryLogStorageTestFixture, seek_continues_reading_at_the_given_time) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+    write_messages(storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}, {"topic2", 4}});
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  storage.read_next();
+  storage.seek(3);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(3, 4));
+  storage.seek(0);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(BinaryLogStorageTestFixture, messages_can_be_ordered_by_publish_time) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    storage.create_topic({"topic1", "type1", "rmw1", ""});
+    auto first_message = make_message("topic1", 1, "first");
+    first_message->publish_time_stamp = 20;
+    storage.write(first_message);
+    auto second_message = make_message("topic1", 2, "second");
+    second_message->publish_time_stamp = 10;
+    storage.write(second_message);
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.order_by_publish_time = true;
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(2, 1));
+}
+
+TEST_F(BinaryLogStorageTestFixture, file_which_was_not_closed_is_recovered_from_its_chunks) {
+  rosbag2_storage_plugins::BinaryLogStorage writing_storage;
+  writing_storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+  write_messages(
+    writing_storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}, {"topic2", 4}, {"topic1", 5}});
+
+  // The last message is not written yet, as its chunk is not full.
+  const auto copy_path = copy_file(file_path_);
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(copy_path, IOFlag::READ_ONLY);
+
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2, 3, 4));
+  const auto metadata = storage.get_metadata();
+  EXPECT_THAT(metadata.message_count, Eq(4u));
+  EXPECT_THAT(metadata.topics_with_message_count, SizeIs(2));
+}
+
+TEST_F(BinaryLogStorageTestFixture, chunk_with_incomplete_index_is_recovered_from_its_messages) {
+  rosbag2_storage_plugins::BinaryLogStorage writing_storage;
+  writing_storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+  write_messages(writing_storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 4}, {"topic2", 3}});
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(copy_file(file_path_, 5), IOFlag::READ_ONLY);
+
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(BinaryLogStorageTestFixture, reading_a_corrupt_chunk_throws) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage writing_storage;
+    writing_storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(writing_storage, {{"topic1", 1}, {"topic2", 2}});
+  }
+  std::fstream file(file_path_, std::ios::binary | std::ios::in | std::ios::out);
+  std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  const auto position = data.find("message 2");
+  ASSERT_THAT(position, Ne(std::string::npos));
+  file.seekp(static_cast<std::streamoff>(position));
+  file.put('M');
+  file.close();
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  EXPECT_THROW(read_all_messages(storage), std::runtime_error);
+}
+
+TEST_F(BinaryLogStorageTestFixture, incomplete_last_chunk_is_dropped_when_appending) {
+  rosbag2_storage_plugins::BinaryLogStorage writing_storage;
+  writing_storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+  write_messages(writing_storage, {{"topic1", 1}, {"topic2", 2}});
+  writing_storage.write(make_message("topic1", 3, std::string(100, 'x')));
+  writing_storage.write(make_message("topic1", 4, std::string(100, 'x')));
+
+  const auto copy_path = copy_file(file_path_, 150);
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(copy_path, IOFlag::APPEND);
+    storage.write(make_message("topic2", 5, "appended"));
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(copy_path, IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(storage);
+  EXPECT_THAT(get_time_stamps(messages), ElementsAre(1, 2, 5));
+  EXPECT_THAT(storage.get_metadata().message_count, Eq(3u));
+}
+
+TEST_F(BinaryLogStorageTestFixture, appending_continues_a_closed_file) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(storage, {{"topic1", 1}, {"topic2", 2}});
+  }
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(file_path_, IOFlag::APPEND);
+    storage.create_topic({"topic3", "type3", "rmw3", ""});
+    storage.write(make_message("topic3", 3, "appended"));
+    storage.write(make_message("topic1", 4, "appended"));
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(storage);
+  ASSERT_THAT(get_time_stamps(messages), ElementsAre(1, 2, 3, 4));
+  EXPECT_THAT(messages[2]->topic_name, Eq("topic3"));
+  EXPECT_THAT(storage.get_metadata().topics_with_message_count, SizeIs(3));
+}
+
+TEST_F(BinaryLogStorageTestFixture, files_written_with_direct_io_are_read_and_appended) {
+  rosbag2_storage::StorageConfig storage_config;
+  storage_config.preset_profile = "direct_io";
+  storage_config.transaction_max_messages = 2;
+  // Messages larger than the buffer of direct I/O and chunks ending within blocks.
+  const std::string large_content(5 * 1024 * 1024, 'l');
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, storage_config);
+    write_messages(storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}});
+    storage.write(make_message("topic2", 4, large_content));
+  }
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(file_path_, IOFlag::APPEND, storage_config);
+    storage.write(make_message("topic1", 5, "appended"));
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(storage);
+  ASSERT_THAT(get_time_stamps(messages), ElementsAre(1, 2, 3, 4, 5));
+  EXPECT_THAT(messages[3]->serialized_data->buffer_length, Eq(large_content.size()));
+  EXPECT_THAT(messages[3]->serialized_data->buffer[large_content.size() - 1], Eq('l'));
+  EXPECT_THAT(storage.get_bagfile_size(), Eq(rcpputils::fs::path(file_path_).file_size()));
+}
+
+TEST_F(BinaryLogStorageTestFixture, preallocated_files_written_back_early_keep_their_size) {
+  auto storage_config = make_config_with_chunk_messages(1);
+  storage_config.preallocate_size = 1024 * 1024;
+  storage_config.writeback_interval_bytes = 1;
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, storage_config);
+    write_messages(storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}});
+    EXPECT_THAT(storage.get_bagfile_size(), Lt(1024u * 1024u));
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2, 3));
+  EXPECT_THAT(storage.get_bagfile_size(), Eq(rcpputils::fs::path(file_path_).file_size()));
+}
+
+TEST_F(BinaryLogStorageTestFixture, messages_with_topic_handles_are_written_to_the_right_topic) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    storage.create_topic({"topic1", "type1", "rmw1", ""});
+    storage.create_topic({"topic2", "type2", "rmw2", ""});
+    storage.set_topic_handle("topic2", 0);
+    storage.set_topic_handle("topic1", 2);
+    auto message = make_message("topic2", 1, "message");
+    message->topic_handle = 0;
+    storage.write(message);
+    // Handles of no topic fall back to the topic name.
+    auto other_message = make_message("topic2", 2, "message");
+    other_message->topic_handle = 1;
+    storage.write(other_message);
+    EXPECT_THROW(storage.write(make_message("unknown", 3, "message")), std::runtime_error);
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(storage);
+  ASSERT_THAT(messages, SizeIs(2));
+  EXPECT_THAT(messages[0]->topic_name, Eq("topic2"));
+  EXPECT_THAT(messages[1]->topic_name, Eq("topic2"));
+}
+
+TEST_F(BinaryLogStorageTestFixture, removed_topics_are_not_listed) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    storage.create_topic({"topic1", "type1", "rmw1", ""});
+    storage.create_topic({"topic2", "type2", "rmw2", ""});
+    storage.remove_topic({"topic1", "type1", "rmw1", ""});
+    EXPECT_THAT(storage.get_all_topics_and_types(), SizeIs(1));
+  }
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(copy_file(file_path_, 1), IOFlag::READ_ONLY);
+  const auto topics = storage.get_all_topics_and_types();
+  ASSERT_THAT(topics, SizeIs(1));
+  EXPECT_THAT(topics[0].name, Eq("topic2"));
+}
+
+TEST_F(BinaryLogStorageTestFixture, reading_a_file_opened_for_writing_writes_the_current_chunk) {
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(uri_, IOFlag::READ_WRITE);
+  write_messages(storage, {{"topic1", 1}, {"topic2", 2}});
+  const auto size_before_reading = storage.get_bagfile_size();
+
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2));
+  EXPECT_THAT(storage.get_bagfile_size(), Gt(size_before_reading));
+}
+
+TEST_F(BinaryLogStorageTestFixture, slices_copy_inner_chunks_and_the_messages_in_range_of_others) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(2));
+    write_messages(
+      storage, {{"topic1", 1}, {"topic2", 2}, {"topic1", 3}, {"topic2", 4}, {"topic1", 5},
+        {"topic2", 6}});
+    storage.remove_topic({"topic1", "type1", "rmw1", ""});
+    storage.create_topic({"topic1", "type3", "rmw3", ""});
+    storage.write(make_message("topic1", 7, "message 7"));
+  }
+
+  const auto slice_uri = (rcpputils::fs::path(temporary_dir_path_) / "slice").string();
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  EXPECT_THAT(storage.slice(slice_uri, 2, 5), StrEq(slice_uri + ".binlog"));
+  EXPECT_THROW(storage.slice(slice_uri, 2, 5), std::runtime_error);
+
+  rosbag2_storage_plugins::BinaryLogStorage slice;
+  slice.open(slice_uri + ".binlog", IOFlag::READ_ONLY);
+  const auto messages = read_all_messages(slice);
+  EXPECT_THAT(get_time_stamps(messages), ElementsAre(2, 3, 4, 5));
+  std::vector<std::string> contents;
+  for (const auto & message : messages) {
+    contents.emplace_back(
+      reinterpret_cast<const char *>(message->serialized_data->buffer),
+      message->serialized_data->buffer_length);
+  }
+  EXPECT_THAT(contents, ElementsAre("message 2", "message 3", "message 4", "message 5"));
+  EXPECT_THAT(messages[1]->topic_name, StrEq("topic1"));
+
+  // Like in the sliced file, the messages of the removed topic are not counted.
+  const auto metadata = slice.get_metadata();
+  EXPECT_THAT(metadata.message_count, Eq(2u));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch().count(), Eq(2));
+  const auto topics = slice.get_all_topics_and_types();
+  ASSERT_THAT(topics, SizeIs(2));
+  EXPECT_THAT(topics[1].type, StrEq("type3"));
+}
+
+#ifndef _WIN32
+TEST_F(BinaryLogStorageTestFixture, streamed_file_is_spilled_until_the_ingest_server_is_up) {
+  const auto received_directory = rcpputils::fs::path(temporary_dir_path_) / "received";
+  // Finds a free port for the server started later.
+  auto server = std::make_unique<rosbag2_storage_plugins::binary_log::IngestServer>(
+    0, received_directory.string());
+  const auto port = server->get_port();
+  server.reset();
+
+  rosbag2_storage::StorageConfig storage_config = make_config_with_chunk_messages(2);
+  storage_config.stream_address = "127.0.0.1:" + std::to_string(port);
+  storage_config.stream_max_memory_bytes = 4096;
+  std::vector<std::pair<std::string, rcutils_time_point_value_t>> messages;
+  for (rcutils_time_point_value_t time_stamp = 1; time_stamp <= 1000; ++time_stamp) {
+    messages.emplace_back(time_stamp % 2 ? "topic1" : "topic2", time_stamp);
+  }
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, storage_config);
+    write_messages(storage, messages);
+    EXPECT_FALSE(rcpputils::fs::path(file_path_).exists());
+    EXPECT_TRUE(rcpputils::fs::path(file_path_ + ".spill").exists());
+    EXPECT_THROW(storage.has_next(), std::runtime_error);
+
+    server = std::make_unique<rosbag2_storage_plugins::binary_log::IngestServer>(
+      port, received_directory.string());
+  }
+  server.reset();
+  EXPECT_FALSE(rcpputils::fs::path(file_path_ + ".spill").exists());
+  EXPECT_FALSE(rcpputils::fs::path(file_path_ + ".unsent").exists());
+
+  const auto received_path = received_directory /
+    rcpputils::fs::path(temporary_dir_path_).filename() / "rosbag.binlog";
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(received_path.string(), IOFlag::READ_ONLY);
+  const auto time_stamps = get_time_stamps(read_all_messages(storage));
+  ASSERT_THAT(time_stamps, SizeIs(1000));
+  EXPECT_THAT(time_stamps.front(), Eq(1));
+  EXPECT_THAT(time_stamps.back(), Eq(1000));
+  EXPECT_THAT(storage.get_metadata().message_count, Eq(1000u));
+}
+
+TEST_F(BinaryLogStorageTestFixture, remote_file_is_read_with_range_requests_of_filtered_chunks) {
+  std::vector<std::pair<std::string, rcutils_time_point_value_t>> messages;
+  for (rcutils_time_point_value_t time_stamp = 1; time_stamp <= 1000; ++time_stamp) {
+    messages.emplace_back(time_stamp <= 500 ? "topic1" : "topic2", time_stamp);
+  }
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE, make_config_with_chunk_messages(10));
+    write_messages(storage, messages);
+  }
+  RangeServer server(file_path_);
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  storage.open(server.get_url("rosbag.binlog"), IOFlag::READ_ONLY);
+  EXPECT_THAT(storage.get_metadata().message_count, Eq(1000u));
+  EXPECT_THAT(storage.get_bagfile_size(), Eq(rcpputils::fs::path(file_path_).file_size()));
+  const auto all_messages = read_all_messages(storage);
+  ASSERT_THAT(all_messages, SizeIs(1000));
+  EXPECT_THAT(all_messages.back()->topic_name, Eq("topic2"));
+  EXPECT_THAT(
+    std::string(
+      reinterpret_cast<const char *>(all_messages.back()->serialized_data->buffer),
+      all_messages.back()->serialized_data->buffer_length), Eq("message 1000"));
+
+  RangeServer filtered_server(file_path_);
+  rosbag2_storage_plugins::BinaryLogStorage filtered_storage;
+  filtered_storage.open(filtered_server.get_url("rosbag.binlog"), IOFlag::READ_ONLY);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic1"};
+  filtered_storage.set_filter(storage_filter);
+  const auto time_stamps = get_time_stamps(read_all_messages(filtered_storage));
+  ASSERT_THAT(time_stamps, SizeIs(500));
+  EXPECT_THAT(time_stamps.back(), Eq(500));
+
+  EXPECT_THROW(
+    storage.open(server.get_url("rosbag.binlog"), IOFlag::APPEND), std::runtime_error);
+}
+
+TEST_F(BinaryLogStorageTestFixture, remote_file_rejects_responses_larger_than_the_range) {
+  {
+    rosbag2_storage_plugins::BinaryLogStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(storage, {{"topic", 1}});
+  }
+  RangeServer server(file_path_, true);
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  EXPECT_THROW(
+    storage.open(server.get_url("rosbag.binlog"), IOFlag::READ_ONLY), std::runtime_error);
+}
+
+TEST_F(BinaryLogStorageTestFixture, open_throws_on_unsupported_or_unreachable_urls) {
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  EXPECT_THROW(storage.open("https://host/rosbag.binlog", IOFlag::READ_ONLY), std::runtime_error);
+  EXPECT_THROW(storage.open("http://:80/rosbag.binlog", IOFlag::READ_ONLY), std::runtime_error);
+  EXPECT_THROW(storage.open("s3://bucket", IOFlag::READ_ONLY), std::runtime_error);
+}
+#endif
+
+TEST_F(BinaryLogStorageTestFixture, open_throws_on_invalid_stream_address) {
+  rosbag2_storage::StorageConfig storage_config;
+  storage_config.stream_address = "no_port";
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  EXPECT_THROW(storage.open(uri_, IOFlag::READ_WRITE, storage_config), std::runtime_error);
+}
+
+TEST_F(BinaryLogStorageTestFixture, open_throws_on_unknown_preset_or_existing_file) {
+  rosbag2_storage::StorageConfig storage_config;
+  storage_config.preset_profile = "unknown";
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  EXPECT_THROW(storage.open(uri_, IOFlag::READ_WRITE, storage_config), std::runtime_error);
+
+  storage.open(uri_, IOFlag::READ_WRITE);
+  rosbag2_storage_plugins::BinaryLogStorage other_storage;
+  EXPECT_THROW(other_storage.open(uri_, IOFlag::READ_WRITE), std::runtime_error);
+}
+
+TEST_F(BinaryLogStorageTestFixture, open_throws_on_files_which_are_not_binary_logs) {
+  const auto path = uri_ + ".txt";
+  std::ofstream(path) << "neither a binary log nor long enough";
+
+  rosbag2_storage_plugins::BinaryLogStorage storage;
+  EXPECT_THROW(storage.open(path, IOFlag::READ_ONLY), std::runtime_error);
+}
@@ -0,0 +1,254 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include "rosbag2_storage_default_plugins/memory/memory_bag_store.hpp"
+#include "rosbag2_storage_default_plugins/memory/memory_storage.hpp"
+
+using namespace ::testing;  // NOLINT
+
+using rosbag2_storage::storage_interfaces::IOFlag;
+using rosbag2_storage_plugins::MemoryBagStore;
+using rosbag2_storage_plugins::MemoryStorage;
+
+class MemoryStorageTestFixture : public Test
+{
+public:
+  MemoryStorageTestFixture()
+  : uri_("rosbag"), file_path_("rosbag.mem")
+  {}
+
+  ~MemoryStorageTestFixture() override
+  {
+    MemoryBagStore::get_instance().clear();
+    MemoryBagStore::get_instance().set_max_bytes(0);
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_message(
+    const std::string & topic_name, rcutils_time_point_value_t time_stamp,
+    const std::string & content)
+  {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->serialized_data = rosbag2_storage::make_serialized_message(
+      content.data(), content.size());
+    message->time_stamp = time_stamp;
+    message->topic_name = topic_name;
+    return message;
+  }
+
+  // Writes messages of topic1 and topic2 at the given time stamps, named after their position.
+  void write_messages(
+    MemoryStorage & storage,
+    const std::vector<std::pair<std::string, rcutils_time_point_value_t>> & messages)
+  {
+    storage.create_topic({"topic1", "type1", "rmw1", ""});
+    storage.create_topic({"topic2", "type2", "rmw2", ""});
+    for (const auto & message : messages) {
+      storage.write(
+        make_message(
+          message.first, message.second, "message " + std::to_string(message.second)));
+    }
+  }
+
+  std::vector<rcutils_time_point_value_t> read_all_time_stamps(MemoryStorage & storage)
+  {
+    std::vector<rcutils_time_point_value_t> time_stamps;
+    while (storage.has_next()) {
+      time_stamps.push_back(storage.read_next()->time_stamp);
+    }
+    return time_stamps;
+  }
+
+  std::string uri_;
+  std::string file_path_;
+};
+
+TEST_F(MemoryStorageTestFixture, messages_are_written_and_read_in_time_stamp_order) {
+  {
+    MemoryStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(storage, {{"topic1", 3}, {"topic2", 1}, {"topic1", 4}, {"topic2", 2}});
+  }
+  EXPECT_TRUE(MemoryBagStore::get_instance().contains(file_path_));
+
+  MemoryStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  while (storage.has_next()) {
+    messages.push_back(storage.read_next());
+  }
+
+  ASSERT_THAT(messages, SizeIs(4));
+  EXPECT_THAT(messages[0]->time_stamp, Eq(1));
+  EXPECT_THAT(messages[0]->topic_name, Eq("topic2"));
+  EXPECT_THAT(messages[2]->topic_name, Eq("topic1"));
+  EXPECT_THAT(
+    std::string(
+      reinterpret_cast<const char *>(messages[3]->serialized_data->buffer),
+      messages[3]->serialized_data->buffer_length), Eq("message 4"));
+  EXPECT_THAT(messages[3]->publish_time_stamp, Eq(4));
+}
+
+TEST_F(MemoryStorageTestFixture, get_metadata_summarizes_the_written_messages) {
+  MemoryStorage storage;
+  storage.open(uri_, IOFlag::READ_WRITE);
+  write_messages(storage, {{"topic1", 10}, {"topic2", 20}, {"topic1", 40}});
+  storage.create_topic({"topic3", "type3", "rmw3", ""});
+  const auto metadata = storage.get_metadata();
+
+  EXPECT_THAT(metadata.storage_identifier, Eq("memory"));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre(file_path_));
+  EXPECT_THAT(metadata.message_count, Eq(3u));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(2));
+  EXPECT_THAT(metadata.topics_with_message_count[0].topic_metadata.name, Eq("topic1"));
+  EXPECT_THAT(metadata.topics_with_message_count[0].message_count, Eq(2u));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch(), Eq(std::chrono::nanoseconds(10)));
+  EXPECT_THAT(metadata.duration, Eq(std::chrono::nanoseconds(30)));
+  EXPECT_THAT(metadata.bag_size, Eq(3 * std::string("message 10").size()));
+  EXPECT_THAT(storage.get_all_topics_and_types(), SizeIs(3));
+}
+
+TEST_F(MemoryStorageTestFixture, read_next_returns_messages_of_the_filtered_topics_and_time) {
+  MemoryStorage storage;
+  storage.open(uri_, IOFlag::READ_WRITE);
+  write_messages(
+    storage, {{"topic1", 1}, {"topic1", 2}, {"topic2", 3}, {"topic1", 4}, {"topic2", 5}});
+
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic2"};
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(read_all_time_stamps(storage), ElementsAre(3, 5));
+
+  storage_filter.topics = {};
+  storage_filter.start_time = 2;
+  storage_filter.end_time = 4;
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(read_all_time_stamps(storage), ElementsAre(2, 3, 4));
+
+  storage.reset_filter();
+  storage.seek(4);
+  EXPECT_THAT(read_all_time_stamps(storage), ElementsAre(4, 5));
+}
+
+TEST_F(MemoryStorageTestFixture, capabilities_include_batch_writes_and_seeking) {
+  MemoryStorage storage;
+  storage.open(uri_, IOFlag::READ_WRITE);
+  const auto capabilities = storage.get_capabilities();
+  EXPECT_TRUE(capabilities.batch_write);
+  EXPECT_TRUE(capabilities.seek);
+}
+
+TEST_F(MemoryStorageTestFixture, appending_continues_a_file) {
+  {
+    MemoryStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(storage, {{"topic1", 1}, {"topic2", 2}});
+  }
+  {
+    MemoryStorage storage;
+    storage.open(file_path_, IOFlag::APPEND);
+    storage.write(make_message("topic2", 3, "message 3"));
+  }
+
+  MemoryStorage storage;
+  storage.open(file_path_, IOFlag::READ_ONLY);
+  EXPECT_THAT(read_all_time_stamps(storage), ElementsAre(1, 2, 3));
+  EXPECT_THROW(storage.write(make_message("topic1", 4, "message 4")), std::runtime_error);
+}
+
+TEST_F(MemoryStorageTestFixture, open_throws_on_unknown_preset_existing_or_missing_file) {
+  MemoryStorage storage;
+  rosbag2_storage::StorageConfig storage_config;
+  storage_config.preset_profile = "resilient";
+  EXPECT_THROW(storage.open(uri_, IOFlag::READ_WRITE, storage_config), std::runtime_error);
+  EXPECT_THROW(storage.open(file_path_, IOFlag::READ_ONLY), std::runtime_error);
+
+  storage.open(uri_, IOFlag::READ_WRITE);
+  MemoryStorage other_storage;
+  EXPECT_THROW(other_storage.open(uri_, IOFlag::READ_WRITE), std::runtime_error);
+}
+
+TEST_F(MemoryStorageTestFixture, writes_beyond_the_memory_limit_throw) {
+  auto & store = MemoryBagStore::get_instance();
+  store.set_max_bytes(2 * 1024 * 1024);
+  const std::string large_content(2 * 1024 * 1024, 'x');
+  {
+    MemoryStorage storage;
+    storage.open(uri_, IOFlag::READ_WRITE);
+    write_messages(storage, {{"topic1", 1}});
+    // A message larger than a chunk gets a chunk of its own.
+    EXPECT_THROW(storage.write(make_message("topic1", 2, large_content)), std::runtime_error);
+    EXPECT_THAT(store.get_size_bytes(), Eq(1024u * 1024u));
+    EXPECT_THAT(storage.get_metadata().message_count, Eq(1u));
+  }
+
+  store.remove(file_path_);
+  EXPECT_FALSE(store.contains(file_path_));
+  EXPECT_THAT(store.get_size_bytes(), Eq(0u));
+
+  MemoryStorage storage;
+  storage.open(uri_, IOFlag::READ_WRITE);
+  write_messages(storage, {});
+  storage.write(make_message("topic1", 2, large_content));
+  EXPECT_THAT(store.get_size_bytes(), Eq(large_content.size()));
+}
+
+TEST_F(MemoryStorageTestFixture, messages_read_stay_valid_while_writing_and_after_removal) {
+  auto & store = MemoryBagStore::get_instance();
+  MemoryStorage writer;
+  writer.open(uri_, IOFlag::READ_WRITE);
+  write_messages(writer, {{"topic1", 1}});
+
+  MemoryStorage reader;
+  reader.open(file_path_, IOFlag::READ_ONLY);
+  ASSERT_TRUE(reader.has_next());
+  const auto message = reader.read_next();
+
+  // Fills the chunk the message was read from and allocates another one.
+  writer.write(make_message("topic1", 2, std::string(1024 * 1024, 'x')));
+  store.remove(file_path_);
+
+  const auto & data = *message->serialized_data;
+  EXPECT_THAT(
+    std::string(reinterpret_cast<const char *>(data.buffer), data.buffer_length),
+    Eq("message 1"));
+}
+
+TEST_F(MemoryStorageTestFixture, storage_config_sets_the_chunk_size_and_memory_limit) {
+  auto & store = MemoryBagStore::get_instance();
+  rosbag2_storage::StorageConfig storage_config;
+  storage_config.memory_chunk_size = 0;
+  MemoryStorage storage;
+  EXPECT_THROW(storage.open(uri_, IOFlag::READ_WRITE, storage_config), std::runtime_error);
+
+  storage_config.memory_chunk_size = 1024;
+  storage_config.memory_max_bytes = 2048;
+  storage.open(uri_, IOFlag::READ_WRITE, storage_config);
+  EXPECT_THAT(store.get_max_bytes(), Eq(2048u));
+  EXPECT_THAT(storage.get_minimum_split_file_size(), Eq(1024u));
+
+  write_messages(storage, {{"topic1", 1}});
+  EXPECT_THAT(store.get_size_bytes(), Eq(1024u));
+  EXPECT_THROW(
+    storage.write(make_message("topic1", 2, std::string(2048, 'x'))), std::runtime_error);
+}
@@ -0,0 +1,435 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <bzlib.h>
+#include <lz4frame.h>
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+#include "rosbag2_storage_default_plugins/ros1_bag/ros1_bag_storage.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+using rosbag2_storage::storage_interfaces::IOFlag;
+
+namespace
+{
+struct Ros1Message
+{
+  uint32_t connection_id;
+  // Nanoseconds since epoch, which ROS 1 stores as seconds and nanoseconds.
+  uint64_t time;
+};
+
+struct Ros1Connection
+{
+  uint32_t id;
+  std::string topic;
+  std::string type;
+};
+
+void append_uint32(std::string & buffer, uint32_t value)
+{
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buffer.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void append_uint64(std::string & buffer, uint64_t value)
+{
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buffer.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+std::string make_time(uint64_t time)
+{
+  std::string value;
+  append_uint32(value, static_cast<uint32_t>(time / 1000000000));
+  append_uint32(value, static_cast<uint32_t>(time % 1000000000));
+  return value;
+}
+
+std::string make_uint32(uint32_t value)
+{
+  std::string bytes;
+  append_uint32(bytes, value);
+  return bytes;
+}
+
+std::string make_uint64(uint64_t value)
+{
+  std::string bytes;
+  append_uint64(bytes, value);
+  return bytes;
+}
+
+std::string make_fields(const std::map<std::string, std::string> & fields)
+{
+  std::string header;
+  for (const auto & field : fields) {
+    append_uint32(header, static_cast<uint32_t>(field.first.size() + 1 + field.second.size()));
+    header += field.first + "=" + field.second;
+  }
+  return header;
+}
+
+std::string make_record(
+  const std::map<std::string, std::string> & fields, const std::string & data)
+{
+  std::string record;
+  const auto header = make_fields(fields);
+  append_uint32(record, static_cast<uint32_t>(header.size()));
+  record += header;
+  append_uint32(record, static_cast<uint32_t>(data.size()));
+  record += data;
+  return record;
+}
+
+std::string make_content(const Ros1Message & message)
+{
+  return "message " + std::to_string(message.time);
+}
+
+std::string compress(const std::string & compression, const std::string & data)
+{
+  if (compression == "bz2") {
+    std::string compressed(data.size() + data.size() / 100 + 600, '\0');
+    auto compressed_size = static_cast<unsigned int>(compressed.size());
+    EXPECT_THAT(
+      BZ2_bzBuffToBuffCompress(
+        &compressed[0], &compressed_size, const_cast<char *>(data.data()),
+        static_cast<unsigned int>(data.size()), 9, 0, 0),
+      Eq(BZ_OK));
+    compressed.resize(compressed_size);
+    return compressed;
+  }
+  if (compression == "lz4") {
+    std::string compressed(LZ4F_compressFrameBound(data.size(), nullptr), '\0');
+    const auto compressed_size = LZ4F_compressFrame(
+      &compressed[0], compressed.size(), data.data(), data.size(), nullptr);
+    EXPECT_FALSE(LZ4F_isError(compressed_size));
+    compressed.resize(compressed_size);
+    return compressed;
+  }
+  return data;
+}
+}  // namespace
+
+class Ros1BagStorageTestFixture : public TemporaryDirectoryFixture
+{
+public:
+  Ros1BagStorageTestFixture()
+  {
+    file_path_ = (rcpputils::fs::path(temporary_dir_path_) / "ros1.bag").string();
+  }
+
+  // Writes a bag like ROS 1 does, with a chunk of the given compression per vector of messages.
+  void write_bag(
+    const std::vector<Ros1Connection> & connections,
+    const std::vector<std::vector<Ros1Message>> & chunks, const std::string & compression,
+    bool closed = true)
+  {
+    std::string bag = "#ROSBAG V2.0\n";
+    const auto bag_header_position = bag.size();
+    bag += make_bag_header(0, 0, 0);
+
+    std::string chunk_infos;
+    for (const auto & messages : chunks) {
+      const auto chunk_position = bag.size();
+      std::string chunk;
+      std::map<uint32_t, std::string> index_entries;
+      std::map<uint32_t, uint32_t> connection_counts;
+      uint64_t start_time = UINT64_MAX;
+      uint64_t end_time = 0;
+      for (const auto & message : messages) {
+        if (connection_counts[message.connection_id]++ == 0) {
+          chunk += make_connection_record(connections, message.connection_id);
+        }
+        index_entries[message.connection_id] += make_time(message.time) +
+          make_uint32(static_cast<uint32_t>(chunk.size()));
+        chunk += make_record(
+          {{"op", "\x02"}, {"conn", make_uint32(message.connection_id)},
+            {"time", make_time(message.time)}},
+          make_content(message));
+        start_time = std::min(start_time, message.time);
+        end_time = std::max(end_time, message.time);
+      }
+      bag += make_record(
+        {{"op", "\x05"}, {"compression", compression},
+          {"size", make_uint32(static_cast<uint32_t>(chunk.size()))}},
+        compress(compression, chunk));
+
+      std::string chunk_info_data;
+      for (const auto & connection_count : connection_counts) {
+        bag += make_record(
+          {{"op", "\x04"}, {"ver", make_uint32(1)},
+            {"conn", make_uint32(connection_count.first)},
+            {"count", make_uint32(connection_count.second)}},
+          index_entries[connection_count.first]);
+        chunk_info_data += make_uint32(connection_count.first) +
+          make_uint32(connection_count.second);
+      }
+      chunk_infos += make_record(
+        {{"op", "\x06"}, {"ver", make_uint32(1)}, {"chunk_pos", make_uint64(chunk_position)},
+          {"start_time", make_time(start_time)}, {"end_time", make_time(end_time)},
+          {"count", make_uint32(static_cast<uint32_t>(connection_counts.size()))}},
+        chunk_info_data);
+    }
+
+    if (closed) {
+      const auto index_position = bag.size();
+      for (const auto & connection : connections) {
+        bag += make_connection_record(connections, connection.id);
+      }
+      bag += chunk_infos;
+      bag.replace(
+        bag_header_position, 4096,
+        make_bag_header(
+          index_position, static_cast<uint32_t>(connections.size()),
+          static_cast<uint32_t>(chunks.size())));
+    }
+    std::ofstream(file_path_, std::ios::binary | std::ios::trunc) << bag;
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_all_messages(
+    rosbag2_storage::storage_interfaces::ReadOnlyInterface & storage)
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+    while (storage.has_next()) {
+      messages.push_back(storage.read_next());
+    }
+    return messages;
+  }
+
+  std::vector<rcutils_time_point_value_t> get_time_stamps(
+    const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages)
+  {
+    std::vector<rcutils_time_point_value_t> time_stamps;
+    for (const auto & message : messages) {
+      time_stamps.push_back(message->time_stamp);
+    }
+    return time_stamps;
+  }
+
+  std::vector<std::string> get_contents(
+    const std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages)
+  {
+    std::vector<std::string> contents;
+    for (const auto & message : messages) {
+      contents.emplace_back(
+        reinterpret_cast<const char *>(message->serialized_data->buffer),
+        message->serialized_data->buffer_length);
+    }
+    return contents;
+  }
+
+  const std::vector<Ros1Connection> connections_ {
+    {0, "/chatter", "std_msgs/String"},
+    {1, "/scan", "sensor_msgs/LaserScan"},
+    // A second publisher of /chatter.
+    {2, "/chatter", "std_msgs/String"}};
+  std::string file_path_;
+
+private:
+  std::string make_bag_header(uint64_t index_position, uint32_t conn_count, uint32_t chunk_count)
+  {
+    const std::map<std::string, std::string> fields {
+      {"op", "\x03"}, {"index_pos", make_uint64(index_position)},
+      {"conn_count", make_uint32(conn_count)}, {"chunk_count", make_uint32(chunk_count)}};
+    // ROS 1 pads the bag header record to 4096 bytes, so it is rewritten in place on close.
+    return make_record(fields, std::string(4096 - make_record(fields, "").size(), ' '));
+  }
+
+  std::string make_connection_record(
+    const std::vector<Ros1Connection> & connections, uint32_t connection_id)
+  {
+    for (const auto & connection : connections) {
+      if (connection.id == connection_id) {
+        return make_record(
+          {{"op", "\x07"}, {"conn", make_uint32(connection.id)}, {"topic", connection.topic}},
+          make_fields(
+            {{"topic", connection.topic}, {"type", connection.type}, {"md5sum", "*"},
+              {"message_definition", ""}}));
+      }
+    }
+    throw std::invalid_argument("Unknown connection.");
+  }
+};
+
+TEST_F(Ros1BagStorageTestFixture, messages_of_chunks_of_every_compression_are_read_in_order) {
+  for (const auto compression : {"none", "bz2", "lz4"}) {
+    SCOPED_TRACE(compression);
+    // The chunks overlap in time like those of messages received out of time stamp order.
+    write_bag(
+      connections_, {{{0, 1}, {1, 3}, {2, 2}}, {{0, 4}, {1, 5}}, {{0, 2500000000}}}, compression);
+
+    rosbag2_storage_plugins::Ros1BagStorage storage;
+    storage.open(file_path_);
+    const auto messages = read_all_messages(storage);
+
+    EXPECT_THAT(get_time_stamps(messages), ElementsAre(1, 2, 3, 4, 5, 2500000000));
+    EXPECT_THAT(
+      get_contents(messages),
+      ElementsAre(
+        "message 1", "message 2", "message 3", "message 4", "message 5", "message 2500000000"));
+    ASSERT_THAT(messages, SizeIs(6));
+    EXPECT_THAT(messages[1]->topic_name, Eq("/chatter"));
+    EXPECT_THAT(messages[2]->topic_name, Eq("/scan"));
+    EXPECT_THAT(messages[2]->publish_time_stamp, Eq(3));
+  }
+}
+
+TEST_F(Ros1BagStorageTestFixture, get_metadata_returns_the_topics_of_the_connection_index) {
+  write_bag(connections_, {{{0, 10}, {1, 20}}, {{2, 30}, {0, 40}}}, "lz4");
+
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  storage.open(file_path_);
+  const auto metadata = storage.get_metadata();
+
+  EXPECT_THAT(metadata.storage_identifier, Eq("ros1_bag"));
+  EXPECT_THAT(metadata.relative_file_paths, ElementsAre(file_path_));
+  EXPECT_THAT(metadata.message_count, Eq(4u));
+  ASSERT_THAT(metadata.topics_with_message_count, SizeIs(2));
+  // The messages of both connections of /chatter are counted for the topic.
+  EXPECT_THAT(metadata.topics_with_message_count[0].topic_metadata.name, Eq("/chatter"));
+  EXPECT_THAT(
+    metadata.topics_with_message_count[0].topic_metadata.type, Eq("std_msgs/msg/String"));
+  EXPECT_THAT(
+    metadata.topics_with_message_count[0].topic_metadata.serialization_format, Eq("ros1"));
+  EXPECT_THAT(metadata.topics_with_message_count[0].message_count, Eq(3u));
+  EXPECT_THAT(
+    metadata.topics_with_message_count[1].topic_metadata.type, Eq("sensor_msgs/msg/LaserScan"));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch(), Eq(std::chrono::nanoseconds(10)));
+  EXPECT_THAT(metadata.duration, Eq(std::chrono::nanoseconds(30)));
+  EXPECT_THAT(metadata.bag_size, Gt(0u));
+  EXPECT_THAT(storage.get_all_topics_and_types(), SizeIs(2));
+}
+
+TEST_F(Ros1BagStorageTestFixture, read_next_returns_messages_of_the_filtered_topics_and_time) {
+  write_bag(connections_, {{{0, 1}, {0, 2}}, {{1, 3}, {2, 4}}, {{1, 5}}}, "bz2");
+
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  storage.open(file_path_);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"/scan"};
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(3, 5));
+
+  storage_filter.topics = {};
+  storage_filter.topic_types = {"std_msgs/msg/String"};
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2, 4));
+
+  storage_filter.topic_types = {};
+  storage_filter.start_time = 2;
+  storage_filter.end_time = 4;
+  storage.set_filter(storage_filter);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(2, 3, 4));
+
+  storage.reset_filter();
+  EXPECT_THAT(read_all_messages(storage), SizeIs(5));
+}
+
+TEST_F(Ros1BagStorageTestFixture, seek_continues_reading_at_the_given_time) {
+  write_bag(connections_, {{{0, 1}, {1, 2}}, {{0, 3}, {1, 4}}, {{0, 5}}}, "lz4");
+
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  EXPECT_TRUE(storage.get_capabilities().seek);
+  storage.open(file_path_);
+  storage.read_next();
+  storage.seek(4);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(4, 5));
+  storage.seek(0);
+  EXPECT_THAT(get_time_stamps(read_all_messages(storage)), ElementsAre(1, 2, 3, 4, 5));
+}
+
+TEST_F(Ros1BagStorageTestFixture, messages_of_uncompressed_chunks_point_into_the_mapped_file) {
+  write_bag(connections_, {{{0, 1}}}, "none");
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> uncompressed_message;
+  {
+    rosbag2_storage_plugins::Ros1BagStorage storage;
+    storage.open(file_path_);
+    uncompressed_message = storage.read_next();
+  }
+  EXPECT_TRUE(rosbag2_storage::is_serialized_data_view(*uncompressed_message->serialized_data));
+  EXPECT_THAT(get_contents({uncompressed_message}), ElementsAre("message 1"));
+
+  write_bag(connections_, {{{0, 1}}}, "bz2");
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  storage.open(file_path_);
+  EXPECT_FALSE(rosbag2_storage::is_serialized_data_view(*storage.read_next()->serialized_data));
+}
+
+TEST_F(Ros1BagStorageTestFixture, visit_next_batch_passes_views_valid_across_chunks) {
+  write_bag(connections_, {{{0, 1}, {1, 2}}, {{0, 3}, {1, 4}}}, "lz4");
+
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  storage.open(file_path_);
+  std::vector<std::string> contents;
+  const auto collect = [&](const std::vector<rosbag2_storage::SerializedBagMessageView> & views) {
+      for (const auto & view : views) {
+        contents.emplace_back(
+          reinterpret_cast<const char *>(view.serialized_data.data), view.serialized_data.size);
+      }
+    };
+  EXPECT_TRUE(storage.visit_next_batch(collect, 0, 0));
+  EXPECT_FALSE(storage.visit_next_batch(collect, 0, 0));
+
+  EXPECT_THAT(contents, ElementsAre("message 1", "message 2", "message 3", "message 4"));
+}
+
+TEST_F(Ros1BagStorageTestFixture, reading_a_corrupt_chunk_throws) {
+  write_bag(connections_, {{{0, 1}, {1, 2}}}, "bz2");
+  {
+    std::fstream file(file_path_, std::ios::binary | std::ios::in | std::ios::out);
+    // Overwrites the compressed data after the chunk record header.
+    file.seekp(13 + 4096 + 80);
+    file << std::string(16, 'x');
+  }
+
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  storage.open(file_path_);
+  EXPECT_THROW(storage.has_next(), std::runtime_error);
+}
+
+TEST_F(Ros1BagStorageTestFixture, open_throws_on_unindexed_bags_and_other_files) {
+  write_bag(connections_, {{{0, 1}}}, "none", false);
+  rosbag2_storage_plugins::Ros1BagStorage storage;
+  EXPECT_THROW(storage.open(file_path_), std::runtime_error);
+
+  write_bag(connections_, {{{0, 1}}}, "none");
+  EXPECT_THROW(storage.open(file_path_, IOFlag::READ_WRITE), std::runtime_error);
+  EXPECT_THROW(storage.open(file_path_ + ".missing"), std::runtime_error);
+
+  const auto path = file_path_ + ".txt";
+  std::ofstream(path) << "neither a ROS 1 bag nor long enough";
+  EXPECT_THROW(storage.open(path), std::runtime_error);
+}
@@ -0,0 +1,318 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "rcutils/types.h"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "rosbag2_storage_default_plugins/sqlite/sqlite_statement_wrapper.hpp"
+#include "rosbag2_storage_default_plugins/sqlite/sqlite_wrapper.hpp"
+
+// Every allocation of this process by operator new is counted, to report the allocations per
+// bound or read message of the statement wrapper.
+namespace
+{
+std::atomic<size_t> g_allocations{0};
+}  // namespace
+
+void * operator new(std::size_t size)
+{
+  ++g_allocations;
+  void * pointer = std::malloc(size == 0 ? 1 : size);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void * pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+namespace
+{
+
+using rosbag2_storage_plugins::SqliteStatement;
+using rosbag2_storage_plugins::SqliteStatementWrapper;
+using rosbag2_storage_plugins::SqliteWrapper;
+
+// Inserted rows are rolled back once this much data is in the database, so that benchmarking
+// large blobs does not exhaust the memory.
+constexpr const size_t MAX_INSERTED_BYTES = 64 << 20;
+
+// An in-memory database with the messages table of the sqlite storage, so that the benchmarks
+// measure the statement wrapper and SQLite rather than the disk.
+class MessagesDatabase
+{
+public:
+  explicit MessagesDatabase(size_t blob_size)
+  : db_(":memory:", rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE),
+    blob_(make_blob(blob_size))
+  {
+    db_.prepare_statement(
+      "CREATE TABLE messages(id INTEGER PRIMARY KEY, topic_id INTEGER NOT NULL, "
+      "timestamp INTEGER NOT NULL, data BLOB NOT NULL);")->execute_and_reset();
+  }
+
+  SqliteWrapper & db()
+  {
+    return db_;
+  }
+
+  std::shared_ptr<rcutils_uint8_array_t> blob() const
+  {
+    return blob_;
+  }
+
+  SqliteStatement prepare_insert()
+  {
+    return db_.prepare_statement(
+      "INSERT INTO messages (timestamp, topic_id, data) VALUES (?, ?, ?);");
+  }
+
+  void insert_row()
+  {
+    prepare_insert()->bind(rcutils_time_point_value_t{1}, 1, blob_)->execute_and_reset();
+  }
+
+  void begin()
+  {
+    db_.prepare_statement("BEGIN TRANSACTION;")->execute_and_reset();
+  }
+
+  void rollback()
+  {
+    db_.prepare_statement("ROLLBACK;")->execute_and_reset();
+  }
+
+private:
+  static std::shared_ptr<rcutils_uint8_array_t> make_blob(size_t size)
+  {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<char>(i * 31);
+    }
+    return rosbag2_storage::make_serialized_message(data.data(), data.size());
+  }
+
+  SqliteWrapper db_;
+  std::shared_ptr<rcutils_uint8_array_t> blob_;
+};
+
+// Bytes are only reported by the benchmarks copying the blob, binding does not depend on its
+// size.
+void set_counters(benchmark::State & state, size_t copied_bytes, size_t allocations)
+{
+  const auto iterations = static_cast<int64_t>(state.iterations());
+  if (copied_bytes > 0) {
+    state.SetBytesProcessed(iterations * static_cast<int64_t>(copied_bytes));
+  }
+  state.SetItemsProcessed(iterations);
+  state.counters["allocations_per_message"] = benchmark::Counter(
+    static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// Binds the parameters of an insert without executing it, i.e. the cost of the wrapper's
+// variadic bind, its error checking and keeping the blob alive in written_blobs_cache_.
+void BM_bind_and_reset(benchmark::State & state)
+{
+  const auto blob_size = static_cast<size_t>(state.range(0));
+  MessagesDatabase database(blob_size);
+  auto statement = database.prepare_insert();
+  auto blob = database.blob();
+
+  const size_t allocations_before = g_allocations;
+  for (auto _ : state) {
+    statement->bind(rcutils_time_point_value_t{1}, 1, blob)->reset();
+  }
+  set_counters(state, 0, g_allocations - allocations_before);
+}
+
+// The same as BM_bind_and_reset with the SQLite API, as the baseline of the wrapper's overhead.
+void BM_bind_and_reset_raw(benchmark::State & state)
+{
+  const auto blob_size = static_cast<size_t>(state.range(0));
+  MessagesDatabase database(blob_size);
+  auto blob = database.blob();
+  // The wrapper does not expose its database, so the statement is prepared on a database of its
+  // own with the same table.
+  sqlite3_stmt * statement = nullptr;
+  sqlite3 * db = nullptr;
+  if (sqlite3_open(":memory:", &db) != SQLITE_OK ||
+    sqlite3_exec(
+      db, "CREATE TABLE messages(id INTEGER PRIMARY KEY, topic_id INTEGER NOT NULL, "
+      "timestamp INTEGER NOT NULL, data BLOB NOT NULL);", nullptr, nullptr, nullptr) != SQLITE_OK ||
+    sqlite3_prepare_v2(
+      db, "INSERT INTO messages (timestamp, topic_id, data) VALUES (?, ?, ?);", -1, &statement,
+      nullptr) != SQLITE_OK)
+  {
+    state.SkipWithError(sqlite3_errmsg(db));
+    sqlite3_close(db);
+    return;
+  }
+
+  const size_t allocations_before = g_allocations;
+  for (auto _ : state) {
+    sqlite3_bind_int64(statement, 1, 1);
+    sqlite3_bind_int(statement, 2, 1);
+    sqlite3_bind_blob(
+      statement, 3, blob->buffer, static_cast<int>(blob->buffer_length), SQLITE_STATIC);
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+  }
+  set_counters(state, 0, g_allocations - allocations_before);
+
+  sqlite3_finalize(statement);
+  sqlite3_close(db);
+}
+
+// Inserts a message per iteration like the sqlite storage's write, within a transaction.
+void BM_bind_and_execute(benchmark::State & state)
+{
+  const auto blob_size = static_cast<size_t>(state.range(0));
+  MessagesDatabase database(blob_size);
+  auto statement = database.prepare_insert();
+  auto blob = database.blob();
+  database.begin();
+
+  size_t inserted_bytes = 0;
+  size_t allocations = 0;
+  size_t allocations_before = g_allocations;
+  for (auto _ : state) {
+    statement->bind(rcutils_time_point_value_t{1}, 1, blob)->execute_and_reset();
+    inserted_bytes += blob_size;
+    if (inserted_bytes >= MAX_INSERTED_BYTES) {
+      state.PauseTiming();
+      allocations += g_allocations - allocations_before;
+      database.rollback();
+      database.begin();
+      inserted_bytes = 0;
+      allocations_before = g_allocations;
+      state.ResumeTiming();
+    }
+  }
+  allocations += g_allocations - allocations_before;
+  set_counters(state, blob_size, allocations);
+  database.rollback();
+}
+
+// Reads a message per iteration, copying the blob into a new serialized message like the
+// sqlite storage's read_next.
+void BM_step_and_read_copy(benchmark::State & state)
+{
+  const auto blob_size = static_cast<size_t>(state.range(0));
+  MessagesDatabase database(blob_size);
+  database.insert_row();
+  auto statement = database.db().prepare_statement(
+    "SELECT timestamp, topic_id, data FROM messages WHERE id = ?;");
+
+  size_t read_bytes = 0;
+  const size_t allocations_before = g_allocations;
+  for (auto _ : state) {
+    statement->bind(1)->execute_query<
+      rcutils_time_point_value_t, int, std::shared_ptr<rcutils_uint8_array_t>>().for_each_row(
+      [&read_bytes](
+        rcutils_time_point_value_t, int, std::shared_ptr<rcutils_uint8_array_t> data) {
+        read_bytes += data->buffer_length;
+      });
+    statement->reset();
+  }
+  set_counters(state, blob_size, g_allocations - allocations_before);
+  if (read_bytes != blob_size * state.iterations()) {
+    state.SkipWithError("Unexpected size of the read messages");
+  }
+}
+
+// Reads a message per iteration without copying the blob out of SQLite, i.e. the cost of
+// stepping and of the wrapper's column access alone.
+void BM_step_and_read_view(benchmark::State & state)
+{
+  const auto blob_size = static_cast<size_t>(state.range(0));
+  MessagesDatabase database(blob_size);
+  database.insert_row();
+  auto statement = database.db().prepare_statement(
+    "SELECT timestamp, topic_id, data FROM messages WHERE id = ?;");
+
+  size_t read_bytes = 0;
+  const size_t allocations_before = g_allocations;
+  for (auto _ : state) {
+    statement->bind(1)->execute_query<
+      rcutils_time_point_value_t, int, SqliteStatementWrapper::BlobView>().for_each_row(
+      [&read_bytes](
+        rcutils_time_point_value_t, int, SqliteStatementWrapper::BlobView data) {
+        benchmark::DoNotOptimize(data.data);
+        read_bytes += data.size;
+      });
+    statement->reset();
+  }
+  set_counters(state, blob_size, g_allocations - allocations_before);
+  if (read_bytes != blob_size * state.iterations()) {
+    state.SkipWithError("Unexpected size of the read messages");
+  }
+}
+
+// Reads a message per iteration through incremental blob I/O, like the sqlite storage does for
+// large messages.
+void BM_read_blob(benchmark::State & state)
+{
+  const auto blob_size = static_cast<size_t>(state.range(0));
+  MessagesDatabase database(blob_size);
+  database.insert_row();
+
+  size_t read_bytes = 0;
+  const size_t allocations_before = g_allocations;
+  for (auto _ : state) {
+    read_bytes += database.db().read_blob("messages", "data", 1)->buffer_length;
+  }
+  set_counters(state, blob_size, g_allocations - allocations_before);
+  if (read_bytes != blob_size * state.iterations()) {
+    state.SkipWithError("Unexpected size of the read messages");
+  }
+}
+
+void blob_sizes(benchmark::internal::Benchmark * benchmark)
+{
+  for (int64_t size : {int64_t{16}, int64_t{1} << 10, int64_t{1} << 20, int64_t{10} << 20}) {
+    benchmark->Arg(size);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_bind_and_reset)->Apply(blob_sizes);
+BENCHMARK(BM_bind_and_reset_raw)->Apply(blob_sizes);
+BENCHMARK(BM_bind_and_execute)->Apply(blob_sizes);
+BENCHMARK(BM_step_and_read_copy)->Apply(blob_sizes);
+BENCHMARK(BM_step_and_read_view)->Apply(blob_sizes);
+BENCHMARK(BM_read_blob)->Apply(blob_sizes);
+
+BENCHMARK_MAIN();
@@ -14,8 +14,10 @@
 
 #include <gmock/gmock.h>
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -24,8 +26,11 @@
 
 #include "rcutils/snprintf.h"
 
+#include "rosbag2_storage/message_pool.hpp"
 #include "rosbag2_storage/storage_filter.hpp"
 
+#include "rosbag2_storage_default_plugins/sqlite/sqlite_exception.hpp"
+
 #include "storage_test_fixture.hpp"
 
 using namespace ::testing;  // NOLINT
@@ -160,6 +165,48 @@ TEST_F(StorageTestFixture, read_next_returns_filtered_messages) {
   EXPECT_FALSE(readable_storage2->has_next());
 }
 
+TEST_F(StorageTestFixture, read_next_returns_messages_filtered_by_topic_type_and_regex) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("left image", 1, "/camera/left", "sensor_msgs/msg/Image", "cdr"),
+    std::make_tuple("left info", 2, "/camera/info", "sensor_msgs/msg/CameraInfo", "cdr"),
+    std::make_tuple("front image", 3, "/front", "sensor_msgs/msg/Image", "cdr"),
+    std::make_tuple("imu", 4, "/imu", "sensor_msgs/msg/Imu", "cdr")};
+
+  write_messages_to_sqlite(string_messages);
+  auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+  std::unique_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> readable_storage =
+    std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(db_filename);
+
+  const auto read_topic_names = [&readable_storage]() {
+      std::vector<std::string> topic_names;
+      while (readable_storage->has_next()) {
+        topic_names.push_back(readable_storage->read_next()->topic_name);
+      }
+      return topic_names;
+    };
+
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topic_types = {"sensor_msgs/msg/Image"};
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(read_topic_names(), ElementsAre("/camera/left", "/front"));
+
+  storage_filter.topics_regex = "/camera/.*";
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(read_topic_names(), ElementsAre("/camera/left"));
+
+  storage_filter.topic_types.clear();
+  storage_filter.topics = {"/imu"};
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(read_topic_names(), ElementsAre("/camera/left", "/camera/info", "/imu"));
+
+  storage_filter = rosbag2_storage::StorageFilter();
+  storage_filter.topic_types = {"std_msgs/msg/String"};
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(read_topic_names(), IsEmpty());
+}
+
 TEST_F(StorageTestFixture, get_all_topics_and_types_returns_the_correct_vector) {
   std::unique_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> writable_storage =
     std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
@@ -188,6 +235,80 @@ TEST_F(StorageTestFixture, get_all_topics_and_types_returns_the_correct_vector)
   }));
 }
 
+TEST_F(StorageTestFixture, topics_created_at_once_are_committed_and_skip_existing_ones) {
+  auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  writable_storage->open((rcpputils::fs::path(temporary_dir_path_) / "rosbag").string());
+  writable_storage->create_topic({"topic1", "type1", "rmw1", ""});
+  writable_storage->create_topics(
+  {
+    {"topic1", "type1", "rmw1", ""},
+    {"topic2", "type2", "rmw2", ""},
+    {"topic3", "type3", "rmw3", ""}
+  });
+
+  // Read while the writable storage is still open.
+  rosbag2_storage_plugins::SqliteStorage readable_storage;
+  readable_storage.open(
+    writable_storage->get_relative_file_path(),
+    rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_THAT(
+    readable_storage.get_all_topics_and_types(), ElementsAreArray(
+  {
+    rosbag2_storage::TopicMetadata{"topic1", "type1", "rmw1", ""},
+    rosbag2_storage::TopicMetadata{"topic2", "type2", "rmw2", ""},
+    rosbag2_storage::TopicMetadata{"topic3", "type3", "rmw3", ""}
+  }));
+}
+
+TEST_F(StorageTestFixture, get_all_topics_and_types_returns_the_offered_qos_profiles) {
+  auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  writable_storage->open((rcpputils::fs::path(temporary_dir_path_) / "rosbag").string());
+  writable_storage->create_topic({"topic1", "type1", "rmw1", "- reliability: 2"});
+  EXPECT_THAT(
+    writable_storage->get_all_topics_and_types(), ElementsAre(
+      rosbag2_storage::TopicMetadata{"topic1", "type1", "rmw1", "- reliability: 2"}));
+  writable_storage->create_topic({"topic2", "type2", "rmw2", "- reliability: 1"});
+  const auto read_only_filename = writable_storage->get_relative_file_path();
+  writable_storage.reset();
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(
+    read_only_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+
+  EXPECT_THAT(
+    readable_storage->get_all_topics_and_types(), ElementsAreArray(
+  {
+    rosbag2_storage::TopicMetadata{"topic1", "type1", "rmw1", "- reliability: 2"},
+    rosbag2_storage::TopicMetadata{"topic2", "type2", "rmw2", "- reliability: 1"}
+  }));
+}
+
+TEST_F(StorageTestFixture, topics_of_databases_without_offered_qos_profiles_are_read) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>> messages =
+  {std::make_tuple("message", 1, "topic1", "type1", "rmw_format")};
+  write_messages_to_sqlite(messages);
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+
+  {
+    // As recorded by older versions
+    rosbag2_storage_plugins::SqliteWrapper db(
+      db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement("ALTER TABLE topics RENAME TO old_topics;")->execute_and_reset();
+    db.prepare_statement(
+      "CREATE TABLE topics AS SELECT id, name, type, serialization_format FROM old_topics;")
+    ->execute_and_reset();
+    db.prepare_statement("DROP TABLE old_topics;")->execute_and_reset();
+  }
+
+  const auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+
+  EXPECT_THAT(
+    readable_storage->get_all_topics_and_types(), ElementsAre(
+      rosbag2_storage::TopicMetadata{"topic1", "type1", "rmw_format", ""}));
+  EXPECT_THAT(readable_storage->get_metadata().message_count, Eq(1u));
+}
+
 TEST_F(StorageTestFixture, get_metadata_returns_correct_struct) {
   std::vector<std::string> string_messages = {"first message", "second message", "third message"};
   std::vector<std::string> topics = {"topic1", "topic2"};
@@ -245,6 +366,35 @@ TEST_F(StorageTestFixture, get_metadata_returns_correct_struct_if_no_messages) {
   EXPECT_THAT(metadata.duration, Eq(std::chrono::seconds(0)));
 }
 
+TEST_F(StorageTestFixture, get_topic_sizes_sums_up_the_sizes_of_the_messages_of_every_topic) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>> messages =
+  {std::make_tuple("short", static_cast<int64_t>(1e9), "topic1", "type1", "rmw_format"),
+    std::make_tuple("a longer message", static_cast<int64_t>(2e9), "topic1", "type1", "rmw_format"),
+    std::make_tuple("message", static_cast<int64_t>(3e9), "topic2", "type2", "rmw_format")};
+  write_messages_to_sqlite(messages);
+
+  const auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  std::vector<size_t> sizes;
+  while (readable_storage->has_next()) {
+    sizes.push_back(readable_storage->read_next()->serialized_data->buffer_length);
+  }
+  ASSERT_THAT(sizes, SizeIs(3u));
+
+  const auto topics = readable_storage->get_topic_sizes();
+
+  ASSERT_THAT(topics, SizeIs(2u));
+  EXPECT_THAT(topics[0].topic_metadata.name, Eq("topic1"));
+  EXPECT_THAT(topics[0].message_count, Eq(2u));
+  EXPECT_THAT(topics[0].total_size, Eq(sizes[0] + sizes[1]));
+  EXPECT_THAT(topics[0].max_message_size, Eq(sizes[1]));
+  EXPECT_THAT(topics[1].topic_metadata.name, Eq("topic2"));
+  EXPECT_THAT(topics[1].message_count, Eq(1u));
+  EXPECT_THAT(topics[1].total_size, Eq(sizes[2]));
+  EXPECT_THAT(topics[1].max_message_size, Eq(sizes[2]));
+}
+
 TEST_F(StorageTestFixture, remove_topics_and_types_returns_the_empty_vector) {
   std::unique_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> writable_storage =
     std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
@@ -304,3 +454,1114 @@ TEST_F(StorageTestFixture, get_relative_file_path_returns_db_name_with_ext) {
     rosbag2_storage::storage_interfaces::IOFlag::APPEND);
   EXPECT_EQ(append_storage->get_relative_file_path(), storage_filename);
 }
+
+TEST_F(StorageTestFixture, messages_with_topic_handles_are_written_to_the_right_topic) {
+  std::unique_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> writable_storage =
+    std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+
+  const auto read_write_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  writable_storage->open(read_write_filename);
+  writable_storage->create_topic({"topic1", "type1", "rmw1", ""});
+  writable_storage->create_topic({"topic2", "type2", "rmw2", ""});
+
+  const rosbag2_storage::TopicHandle topic1_handle = 3;
+  const rosbag2_storage::TopicHandle topic2_handle = 0;
+  writable_storage->set_topic_handle("topic1", topic1_handle);
+  writable_storage->set_topic_handle("topic2", topic2_handle);
+  // Handles of unknown topics are ignored.
+  writable_storage->set_topic_handle("unknown_topic", 1);
+
+  auto make_message =
+    [this](const std::string & topic_name, rosbag2_storage::TopicHandle handle) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message("message");
+      message->topic_name = topic_name;
+      message->topic_handle = handle;
+      return message;
+    };
+  writable_storage->write(make_message("topic1", topic1_handle));
+  writable_storage->write(make_message("topic2", topic2_handle));
+  // Messages without a handle, or with one of no topic, are looked up by their topic name.
+  writable_storage->write(make_message("topic1", 1));
+  writable_storage->write(make_message("topic2", rosbag2_storage::INVALID_TOPIC_HANDLE));
+
+  const auto metadata = writable_storage->get_metadata();
+  EXPECT_THAT(
+    metadata.topics_with_message_count, UnorderedElementsAreArray(
+  {
+    rosbag2_storage::TopicInformation{rosbag2_storage::TopicMetadata{
+        "topic1", "type1", "rmw1", ""}, 2u},
+    rosbag2_storage::TopicInformation{rosbag2_storage::TopicMetadata{
+        "topic2", "type2", "rmw2", ""}, 2u}
+  }));
+
+  writable_storage->remove_topic({"topic1", "type1", "rmw1", ""});
+  EXPECT_THROW(
+    writable_storage->write(make_message("topic1", topic1_handle)),
+    rosbag2_storage_plugins::SqliteException);
+}
+
+TEST_F(StorageTestFixture, preallocated_databases_written_back_early_keep_their_size) {
+  rosbag2_storage::StorageConfig config{};
+  config.preallocate_size = 1024 * 1024;
+  config.writeback_interval_bytes = 1;
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "preallocated").string();
+  {
+    rosbag2_storage_plugins::SqliteStorage storage;
+    storage.open(uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, config);
+    storage.create_topic({"topic", "type", "rmw", ""});
+    for (rcutils_time_point_value_t time_stamp : {1, 2, 3}) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message("message");
+      message->topic_name = "topic";
+      message->time_stamp = time_stamp;
+      storage.write(message);
+    }
+    EXPECT_THAT(storage.get_bagfile_size(), Lt(1024u * 1024u));
+  }
+
+  rosbag2_storage_plugins::SqliteStorage storage;
+  storage.open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  std::vector<rcutils_time_point_value_t> time_stamps;
+  while (storage.has_next()) {
+    time_stamps.push_back(storage.read_next()->time_stamp);
+  }
+  EXPECT_THAT(time_stamps, ElementsAre(1, 2, 3));
+}
+
+TEST_F(StorageTestFixture, storage_preset_profiles_configure_the_database) {
+  const auto resilient_uri = (rcpputils::fs::path(temporary_dir_path_) / "resilient").string();
+  const auto max_throughput_uri =
+    (rcpputils::fs::path(temporary_dir_path_) / "max_throughput").string();
+  for (const auto & preset : {"resilient", "max_throughput"}) {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.preset_profile = preset;
+    writable_storage->open(
+      (rcpputils::fs::path(temporary_dir_path_) / preset).string(),
+      rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage->create_topic({"topic", "type", "rmw", ""});
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->serialized_data = make_serialized_message("message");
+    message->topic_name = "topic";
+    writable_storage->write(message);
+  }
+
+  rosbag2_storage_plugins::SqliteWrapper resilient_db(
+    resilient_uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  auto journal_mode = resilient_db.prepare_statement("PRAGMA journal_mode;")
+    ->execute_query<std::string>().get_single_line();
+  EXPECT_THAT(std::get<0>(journal_mode), StrEq("wal"));
+
+  rosbag2_storage_plugins::SqliteWrapper max_throughput_db(
+    max_throughput_uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  auto page_size = max_throughput_db.prepare_statement("PRAGMA page_size;")
+    ->execute_query<int>().get_single_line();
+  EXPECT_THAT(std::get<0>(page_size), Eq(65536));
+  auto message_count = max_throughput_db.prepare_statement("SELECT COUNT(*) FROM messages;")
+    ->execute_query<int>().get_single_line();
+  EXPECT_THAT(std::get<0>(message_count), Eq(1));
+}
+
+TEST_F(StorageTestFixture, open_throws_on_unknown_storage_preset_profile) {
+  auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  rosbag2_storage::StorageConfig storage_config{};
+  storage_config.preset_profile = "unknown";
+
+  EXPECT_THROW(
+    writable_storage->open(
+      (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string(),
+      rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config),
+    std::runtime_error);
+}
+
+TEST_F(StorageTestFixture, deferred_timestamp_index_is_created_when_storage_is_closed) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  rosbag2_storage::StorageConfig storage_config{};
+  storage_config.defer_index_creation = true;
+  writable_storage->open(
+    uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+  writable_storage->create_topic({"topic", "type", "rmw", ""});
+  for (const auto time_stamp : {3, 1, 2}) {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->serialized_data = make_serialized_message("message");
+    message->time_stamp = time_stamp;
+    message->topic_name = "topic";
+    writable_storage->write(message);
+  }
+
+  auto count_timestamp_indices = [&uri]() {
+      rosbag2_storage_plugins::SqliteWrapper db(
+        uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+      return std::get<0>(
+        db.prepare_statement(
+          "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = 'timestamp_idx';")
+        ->execute_query<int>().get_single_line());
+    };
+  EXPECT_THAT(count_timestamp_indices(), Eq(0));
+
+  // An unindexed file can still be read in order.
+  {
+    auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+    std::vector<rcutils_time_point_value_t> time_stamps;
+    while (readable_storage->has_next()) {
+      time_stamps.push_back(readable_storage->read_next()->time_stamp);
+    }
+    EXPECT_THAT(time_stamps, ElementsAre(1, 2, 3));
+  }
+
+  writable_storage.reset();
+  EXPECT_THAT(count_timestamp_indices(), Eq(1));
+}
+
+TEST_F(StorageTestFixture, opening_unindexed_storage_for_append_creates_timestamp_index) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    writable_storage->open(uri);
+  }
+  {
+    rosbag2_storage_plugins::SqliteWrapper db(
+      uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement("DROP INDEX timestamp_idx;")->execute_and_reset();
+  }
+
+  auto append_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  append_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::APPEND);
+
+  rosbag2_storage_plugins::SqliteWrapper db(
+    uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  auto index_count = db.prepare_statement(
+    "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = 'timestamp_idx';")
+    ->execute_query<int>().get_single_line();
+  EXPECT_THAT(std::get<0>(index_count), Eq(1));
+}
+
+TEST_F(StorageTestFixture, batched_transactions_are_committed_when_a_limit_is_reached) {
+  auto count_committed_messages = [](const std::string & db_file) {
+      rosbag2_storage_plugins::SqliteWrapper db(
+        db_file, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+      return std::get<0>(
+        db.prepare_statement("SELECT COUNT(*) FROM messages;")
+        ->execute_query<int>().get_single_line());
+    };
+  auto make_message = [this](const std::string & data) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message(data);
+      message->topic_name = "topic";
+      return message;
+    };
+  auto open_storage = [this](const std::string & name, rosbag2_storage::StorageConfig config) {
+      auto storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+      storage->open(
+        (rcpputils::fs::path(temporary_dir_path_) / name).string(),
+        rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, config);
+      storage->create_topic({"topic", "type", "rmw", ""});
+      return storage;
+    };
+
+  {
+    rosbag2_storage::StorageConfig config{};
+    config.transaction_max_messages = 3;
+    auto storage = open_storage("by_count", config);
+    const auto db_file = storage->get_relative_file_path();
+    storage->write(make_message("message"));
+    storage->write(make_message("message"));
+    EXPECT_THAT(count_committed_messages(db_file), Eq(0));
+    storage->write(make_message("message"));
+    EXPECT_THAT(count_committed_messages(db_file), Eq(3));
+    storage->write(make_message("message"));
+    storage.reset();
+    EXPECT_THAT(count_committed_messages(db_file), Eq(4));
+  }
+  {
+    rosbag2_storage::StorageConfig config{};
+    config.transaction_max_bytes = 1024;
+    auto storage = open_storage("by_size", config);
+    const auto db_file = storage->get_relative_file_path();
+    storage->write(make_message("small"));
+    EXPECT_THAT(count_committed_messages(db_file), Eq(0));
+    storage->write(make_message(std::string(1024, 'x')));
+    EXPECT_THAT(count_committed_messages(db_file), Eq(2));
+  }
+  {
+    rosbag2_storage::StorageConfig config{};
+    config.transaction_max_duration = std::chrono::milliseconds(50);
+    auto storage = open_storage("by_duration", config);
+    const auto db_file = storage->get_relative_file_path();
+    storage->write(make_message("message"));
+    storage->write(make_message("message"));
+    // Expired transactions are committed even if no more messages are written.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (count_committed_messages(db_file) < 2 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_THAT(count_committed_messages(db_file), Eq(2));
+  }
+}
+
+TEST_F(StorageTestFixture, get_bagfile_size_accounts_for_written_messages) {
+  auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  writable_storage->open((rcpputils::fs::path(temporary_dir_path_) / "rosbag").string());
+  writable_storage->create_topic({"topic", "type", "rmw", ""});
+
+  const auto initial_size = writable_storage->get_bagfile_size();
+  auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  message->serialized_data = make_serialized_message(std::string(1024, 'x'));
+  message->topic_name = "topic";
+  writable_storage->write(message);
+  EXPECT_GE(writable_storage->get_bagfile_size(), initial_size + 1024u);
+
+  // The metadata always reports the size on disk.
+  const auto bag_path = rcpputils::fs::path(writable_storage->get_relative_file_path());
+  EXPECT_EQ(writable_storage->get_metadata().bag_size, bag_path.file_size());
+}
+
+TEST_F(StorageTestFixture, filtered_topics_are_read_using_the_topic_timestamp_index) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.topic_timestamp_index = true;
+    writable_storage->open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    for (const auto & topic : {"topic1", "topic2", "topic'3"}) {
+      writable_storage->create_topic({topic, "type", "rmw", ""});
+    }
+    const std::vector<std::pair<std::string, int64_t>> messages = {
+      {"topic1", 1}, {"topic'3", 4}, {"topic2", 3}, {"topic'3", 2}, {"topic1", 5}};
+    for (const auto & message : messages) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->serialized_data = make_serialized_message("message");
+      bag_message->topic_name = message.first;
+      bag_message->time_stamp = message.second;
+      writable_storage->write(bag_message);
+    }
+  }
+
+  rosbag2_storage_plugins::SqliteWrapper db(
+    uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  auto index_count = db.prepare_statement(
+    "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = 'topic_timestamp_idx';")
+    ->execute_query<int>().get_single_line();
+  EXPECT_THAT(std::get<0>(index_count), Eq(1));
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic'3", "topic1", "unknown"};
+  readable_storage->set_filter(storage_filter);
+
+  std::vector<std::pair<std::string, int64_t>> read_messages;
+  while (readable_storage->has_next()) {
+    auto message = readable_storage->read_next();
+    read_messages.emplace_back(message->topic_name, message->time_stamp);
+  }
+  EXPECT_THAT(
+    read_messages, ElementsAre(
+      std::make_pair(std::string("topic1"), int64_t{1}),
+      std::make_pair(std::string("topic'3"), int64_t{2}),
+      std::make_pair(std::string("topic'3"), int64_t{4}),
+      std::make_pair(std::string("topic1"), int64_t{5})));
+}
+
+TEST_F(StorageTestFixture, messages_clustered_by_topic_are_merged_in_time_stamp_order) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  auto write_messages = [this](
+    rosbag2_storage::storage_interfaces::ReadWriteInterface & writable_storage,
+    const std::vector<std::pair<std::string, int64_t>> & messages) {
+      for (const auto & message : messages) {
+        auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+        bag_message->serialized_data = make_serialized_message(message.first);
+        bag_message->topic_name = message.first;
+        bag_message->time_stamp = message.second;
+        writable_storage.write(bag_message);
+      }
+    };
+  {
+    rosbag2_storage_plugins::SqliteStorage writable_storage;
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.cluster_messages_by_topic = true;
+    writable_storage.open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    for (const auto & topic : {"topic1", "topic2", "topic3"}) {
+      writable_storage.create_topic({topic, "type", "rmw", ""});
+    }
+    write_messages(
+      writable_storage,
+      {{"topic1", 1}, {"topic3", 4}, {"topic2", 3}, {"topic3", 2}, {"topic1", 4}});
+  }
+  {
+    // Appended messages continue the ids, which break ties of equal time stamps.
+    rosbag2_storage_plugins::SqliteStorage appending_storage;
+    appending_storage.open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::APPEND);
+    appending_storage.create_topic({"topic4", "type", "rmw", ""});
+    write_messages(appending_storage, {{"topic4", 6}, {"topic4", 4}});
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  auto read_messages = [&readable_storage]() {
+      std::vector<std::pair<std::string, int64_t>> messages;
+      while (readable_storage->has_next()) {
+        auto message = readable_storage->read_next();
+        messages.emplace_back(message->topic_name, message->time_stamp);
+      }
+      return messages;
+    };
+  using Message = std::pair<std::string, int64_t>;
+  EXPECT_THAT(
+    read_messages(), ElementsAre(
+      Message{"topic1", 1}, Message{"topic3", 2}, Message{"topic2", 3}, Message{"topic3", 4},
+      Message{"topic1", 4}, Message{"topic4", 4}, Message{"topic4", 6}));
+
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic1", "topic3", "unknown"};
+  storage_filter.start_time = 2;
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(
+    read_messages(), ElementsAre(
+      Message{"topic3", 2}, Message{"topic3", 4}, Message{"topic1", 4}));
+
+  // Messages are found by their id, without rowid.
+  ASSERT_THAT(readable_storage->get_topic_message_count("topic1"), Eq(2u));
+  EXPECT_THAT(
+    deserialize_message(readable_storage->read_topic_message("topic1", 1)->serialized_data),
+    StrEq("topic1"));
+  EXPECT_THAT(readable_storage->get_metadata().message_count, Eq(7u));
+}
+
+TEST_F(StorageTestFixture, read_next_returns_messages_within_the_filtered_time_range) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("topic1 message", 1, "topic1", "", ""),
+    std::make_tuple("topic2 message", 2, "topic2", "", ""),
+    std::make_tuple("topic1 message", 3, "topic1", "", ""),
+    std::make_tuple("topic2 message", 4, "topic2", "", "")};
+
+  write_messages_to_sqlite(string_messages);
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic1"};
+  storage_filter.start_time = 2;
+  storage_filter.end_time = 3;
+  readable_storage->set_filter(storage_filter);
+
+  EXPECT_TRUE(readable_storage->has_next());
+  auto message = readable_storage->read_next();
+  EXPECT_THAT(message->topic_name, Eq("topic1"));
+  EXPECT_THAT(message->time_stamp, Eq(3));
+  EXPECT_FALSE(readable_storage->has_next());
+}
+
+TEST_F(StorageTestFixture, seek_continues_reading_at_the_given_time) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("first message", 1, "topic1", "", ""),
+    std::make_tuple("second message", 2, "topic2", "", ""),
+    std::make_tuple("third message", 3, "topic1", "", ""),
+    std::make_tuple("fourth message", 4, "topic2", "", "")};
+
+  write_messages_to_sqlite(string_messages);
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(1));
+
+  readable_storage->seek(3);
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(3));
+
+  // Seeking backwards is possible, too, and keeps the filter.
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic2"};
+  readable_storage->set_filter(storage_filter);
+  readable_storage->seek(0);
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(2));
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(4));
+  EXPECT_FALSE(readable_storage->has_next());
+
+  readable_storage->seek(5);
+  EXPECT_FALSE(readable_storage->has_next());
+}
+
+TEST_F(StorageTestFixture, messages_of_a_topic_are_read_by_index_and_found_by_time) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.topic_timestamp_index = true;
+    writable_storage->open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage->create_topic({"topic1", "type", "rmw", ""});
+    writable_storage->create_topic({"topic2", "type", "rmw", ""});
+    const std::vector<std::pair<std::string, int64_t>> messages = {
+      {"topic1", 10}, {"topic2", 15}, {"topic1", 30}, {"topic1", 20}, {"topic2", 25}};
+    for (const auto & message : messages) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->serialized_data =
+        make_serialized_message(message.first + " " + std::to_string(message.second));
+      bag_message->topic_name = message.first;
+      bag_message->time_stamp = message.second;
+      writable_storage->write(bag_message);
+    }
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_TRUE(readable_storage->get_capabilities().random_access);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.topics = {"topic2"};
+  readable_storage->set_filter(storage_filter);
+
+  // Messages are indexed in time stamp order, regardless of the filter.
+  EXPECT_THAT(readable_storage->get_topic_message_count("topic1"), Eq(3u));
+  EXPECT_THAT(readable_storage->get_topic_message_count("unknown"), Eq(0u));
+  auto message = readable_storage->read_topic_message("topic1", 1);
+  EXPECT_THAT(message->topic_name, Eq("topic1"));
+  EXPECT_THAT(message->time_stamp, Eq(20));
+  EXPECT_THAT(deserialize_message(message->serialized_data), Eq("topic1 20"));
+  EXPECT_THAT(readable_storage->read_topic_message("topic1", 2)->time_stamp, Eq(30));
+  EXPECT_THROW(readable_storage->read_topic_message("topic1", 3), std::out_of_range);
+
+  EXPECT_THAT(readable_storage->find_topic_message("topic1", 0), Eq(0u));
+  EXPECT_THAT(readable_storage->find_topic_message("topic1", 20), Eq(1u));
+  EXPECT_THAT(readable_storage->find_topic_message("topic1", 21), Eq(2u));
+  EXPECT_THAT(readable_storage->find_topic_message("topic1", 31), Eq(3u));
+
+  // Reading sequentially is not affected.
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(15));
+  EXPECT_THAT(readable_storage->read_topic_message("topic2", 1)->time_stamp, Eq(25));
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(25));
+  EXPECT_FALSE(readable_storage->has_next());
+}
+
+TEST_F(StorageTestFixture, latest_messages_before_a_time_are_read_per_topic) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.topic_timestamp_index = true;
+    writable_storage->open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage->create_topic({"/tf_static", "type", "rmw", ""});
+    writable_storage->create_topic({"/map", "type", "rmw", ""});
+    writable_storage->create_topic({"/scan", "type", "rmw", ""});
+    const std::vector<std::pair<std::string, int64_t>> messages = {
+      {"/tf_static", 1}, {"/map", 2}, {"/scan", 3}, {"/map", 4}, {"/scan", 5}, {"/map", 6}};
+    for (const auto & message : messages) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->serialized_data =
+        make_serialized_message(message.first + " " + std::to_string(message.second));
+      bag_message->topic_name = message.first;
+      bag_message->time_stamp = message.second;
+      writable_storage->write(bag_message);
+    }
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  readable_storage->seek(6);
+
+  // The messages at the time itself are read next.
+  auto messages = readable_storage->read_latest_messages({"/tf_static", "/map", "unknown"}, 6);
+  ASSERT_THAT(messages, SizeIs(2));
+  EXPECT_THAT(messages[0]->topic_name, Eq("/tf_static"));
+  EXPECT_THAT(messages[0]->time_stamp, Eq(1));
+  EXPECT_THAT(messages[1]->topic_name, Eq("/map"));
+  EXPECT_THAT(messages[1]->time_stamp, Eq(4));
+  EXPECT_THAT(deserialize_message(messages[1]->serialized_data), Eq("/map 4"));
+  EXPECT_THAT(readable_storage->read_latest_messages({"/map"}, 2), IsEmpty());
+
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(6));
+  EXPECT_FALSE(readable_storage->has_next());
+}
+
+TEST_F(StorageTestFixture, messages_committed_while_reading_are_polled) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  writable_storage->open(uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+  writable_storage->create_topic({"/a", "type", "rmw", ""});
+  auto write_message = [this, &writable_storage](const std::string & topic, int64_t time_stamp) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->serialized_data = make_serialized_message(topic);
+      bag_message->topic_name = topic;
+      bag_message->time_stamp = time_stamp;
+      writable_storage->write(bag_message);
+    };
+  write_message("/a", 1);
+  write_message("/a", 2);
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  rosbag2_storage::StorageFilter storage_filter{};
+  storage_filter.topics = {"/a", "/b"};
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(1));
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(2));
+  EXPECT_FALSE(readable_storage->has_next());
+  EXPECT_FALSE(readable_storage->poll_new_messages());
+
+  // Topics created after the query are read, too.
+  writable_storage->create_topic({"/b", "type", "rmw", ""});
+  write_message("/b", 3);
+  write_message("/a", 4);
+  EXPECT_FALSE(readable_storage->has_next());
+  ASSERT_TRUE(readable_storage->poll_new_messages());
+  auto message = readable_storage->read_next();
+  EXPECT_THAT(message->topic_name, Eq("/b"));
+  EXPECT_THAT(message->time_stamp, Eq(3));
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(4));
+  EXPECT_FALSE(readable_storage->poll_new_messages());
+}
+
+TEST_F(StorageTestFixture, large_messages_are_read_incrementally_and_intact) {
+  const std::string large_message(200 * 1024, 'x');
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("small message", 1, "topic1", "", ""),
+    std::make_tuple(large_message, 2, "topic2", "", ""),
+    std::make_tuple("small message", 3, "topic1", "", ""),
+    std::make_tuple(large_message, 4, "topic2", "", "")};
+
+  write_messages_to_sqlite(string_messages);
+  auto read_messages = read_all_messages_from_sqlite();
+
+  ASSERT_THAT(read_messages, SizeIs(4));
+  for (size_t i = 0; i < read_messages.size(); ++i) {
+    EXPECT_THAT(
+      deserialize_message(read_messages[i]->serialized_data), Eq(std::get<0>(string_messages[i])));
+    EXPECT_THAT(read_messages[i]->time_stamp, Eq(std::get<1>(string_messages[i])));
+    EXPECT_THAT(read_messages[i]->topic_name, Eq(std::get<2>(string_messages[i])));
+  }
+}
+
+TEST_F(StorageTestFixture, messages_with_checksums_are_read_and_corrupt_ones_throw) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.checksums = true;
+    writable_storage->open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage->create_topic({"topic", "type", "rmw", ""});
+    for (const auto & content : {std::string("small message"), std::string(200 * 1024, 'x')}) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message(content);
+      message->topic_name = "topic";
+      writable_storage->write(message);
+    }
+  }
+
+  auto read_messages = read_all_messages_from_sqlite();
+  ASSERT_THAT(read_messages, SizeIs(2));
+  EXPECT_THAT(deserialize_message(read_messages[0]->serialized_data), Eq("small message"));
+  EXPECT_THAT(
+    deserialize_message(read_messages[1]->serialized_data), Eq(std::string(200 * 1024, 'x')));
+
+  {
+    rosbag2_storage_plugins::SqliteWrapper db(
+      uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement("UPDATE messages SET data = X'00010000' WHERE id = 2;")
+    ->execute_and_reset();
+  }
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  ASSERT_TRUE(readable_storage->has_next());
+  readable_storage->read_next();
+  ASSERT_TRUE(readable_storage->has_next());
+  EXPECT_THROW(readable_storage->read_next(), rosbag2_storage_plugins::SqliteException);
+}
+
+TEST_F(StorageTestFixture, messages_above_the_large_message_threshold_are_read_from_data_file) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  const std::vector<std::string> contents =
+  {"small message", std::string(200 * 1024, 'x'), "small message", std::string(300 * 1024, 'y')};
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.large_message_threshold = 1024;
+    storage_config.checksums = true;
+    writable_storage->open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage->create_topic({"topic", "type", "rmw", ""});
+    for (size_t i = 0; i < contents.size(); ++i) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message(contents[i]);
+      message->time_stamp = static_cast<rcutils_time_point_value_t>(i + 1);
+      message->topic_name = "topic";
+      writable_storage->write(message);
+    }
+    EXPECT_THAT(writable_storage->get_bagfile_size(), Ge(500u * 1024u));
+  }
+
+  const auto data_file_path = rcpputils::fs::path(uri + ".db3-data");
+  ASSERT_TRUE(data_file_path.exists());
+  EXPECT_THAT(data_file_path.file_size(), Ge(500u * 1024u));
+  EXPECT_THAT(rcpputils::fs::path(uri + ".db3").file_size(), Lt(100u * 1024u));
+
+  auto read_messages = read_all_messages_from_sqlite();
+  ASSERT_THAT(read_messages, SizeIs(contents.size()));
+  for (size_t i = 0; i < read_messages.size(); ++i) {
+    EXPECT_THAT(deserialize_message(read_messages[i]->serialized_data), Eq(contents[i]));
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  const auto topic_sizes = readable_storage->get_topic_sizes();
+  ASSERT_THAT(topic_sizes, SizeIs(1));
+  EXPECT_THAT(topic_sizes[0].max_message_size, Ge(300u * 1024u));
+}
+
+TEST_F(StorageTestFixture, slices_copy_the_messages_of_the_time_range_with_their_data_files) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  const std::vector<std::pair<std::string, std::string>> messages =
+  {{"topic1", "small message"}, {"topic2", std::string(200 * 1024, 'x')},
+    {"topic1", "small message"}, {"topic2", std::string(300 * 1024, 'y')},
+    {"topic1", "late message"}};
+  {
+    rosbag2_storage_plugins::SqliteStorage writable_storage;
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.large_message_threshold = 1024;
+    storage_config.checksums = true;
+    writable_storage.open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage.create_topic({"topic1", "type1", "rmw", "qos1"});
+    writable_storage.create_topic({"topic2", "type2", "rmw", "qos2"});
+    for (size_t i = 0; i < messages.size(); ++i) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message(messages[i].second);
+      message->time_stamp = static_cast<rcutils_time_point_value_t>(i + 1);
+      message->topic_name = messages[i].first;
+      writable_storage.write(message);
+    }
+  }
+
+  const auto slice_uri = (rcpputils::fs::path(temporary_dir_path_) / "slice").string();
+  rosbag2_storage_plugins::SqliteStorage readable_storage;
+  readable_storage.open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_THAT(readable_storage.slice(slice_uri, 2, 4), StrEq(slice_uri + ".db3"));
+  EXPECT_THROW(readable_storage.slice(slice_uri, 2, 4), std::runtime_error);
+
+  rosbag2_storage_plugins::SqliteStorage slice_storage;
+  slice_storage.open(
+    slice_uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_THAT(slice_storage.get_all_topics_and_types(), SizeIs(2));
+  std::vector<std::string> contents;
+  std::vector<rcutils_time_point_value_t> time_stamps;
+  while (slice_storage.has_next()) {
+    const auto message = slice_storage.read_next();
+    contents.push_back(deserialize_message(message->serialized_data));
+    time_stamps.push_back(message->time_stamp);
+  }
+  EXPECT_THAT(contents, ElementsAre(messages[1].second, messages[2].second, messages[3].second));
+  EXPECT_THAT(time_stamps, ElementsAre(2, 3, 4));
+  EXPECT_TRUE(rcpputils::fs::path(slice_uri + ".db3-data").exists());
+
+  const auto metadata = slice_storage.get_metadata();
+  EXPECT_THAT(metadata.message_count, Eq(3u));
+  EXPECT_THAT(metadata.starting_time.time_since_epoch().count(), Eq(2));
+  for (const auto & topic : metadata.topics_with_message_count) {
+    EXPECT_THAT(topic.message_count, Eq(topic.topic_metadata.name == "topic1" ? 1u : 2u));
+    EXPECT_THAT(
+      topic.topic_metadata.offered_qos_profiles,
+      StrEq(topic.topic_metadata.name == "topic1" ? "qos1" : "qos2"));
+  }
+}
+
+TEST_F(StorageTestFixture, get_metadata_reads_the_topic_summary_written_on_close) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>> messages =
+  {std::make_tuple("message", 1, "topic1", "type1", "rmw_format"),
+    std::make_tuple("message", 2, "topic2", "type2", "rmw_format"),
+    std::make_tuple("message", 3, "topic1", "type1", "rmw_format")};
+  write_messages_to_sqlite(messages);
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+
+  {
+    rosbag2_storage_plugins::SqliteWrapper db(
+      db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+    auto summary = db.prepare_statement(
+      "SELECT SUM(message_count), MIN(min_timestamp), MAX(max_timestamp) FROM topic_summary;")
+      ->execute_query<int, int64_t, int64_t>().get_single_line();
+    EXPECT_THAT(summary, Eq(std::make_tuple(3, int64_t{1}, int64_t{3})));
+  }
+  {
+    // Tampering with the summary shows that the messages are not counted again.
+    rosbag2_storage_plugins::SqliteWrapper db(
+      db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement("UPDATE topic_summary SET message_count = 42;")->execute_and_reset();
+  }
+
+  const auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_THAT(readable_storage->get_metadata().message_count, Eq(84u));
+}
+
+TEST_F(StorageTestFixture, get_metadata_counts_messages_missing_in_the_topic_summary) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>> messages =
+  {std::make_tuple("message", 2, "topic1", "type1", "rmw_format"),
+    std::make_tuple("message", 3, "topic1", "type1", "rmw_format")};
+  write_messages_to_sqlite(messages);
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+
+  {
+    // As if recording was interrupted before the summary was committed
+    rosbag2_storage_plugins::SqliteWrapper db(
+      db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement(
+      "INSERT INTO messages (timestamp, topic_id, data, publish_timestamp) "
+      "VALUES (1, 1, x'00', 1), (5, 1, x'00', 5);")
+    ->execute_and_reset();
+  }
+
+  const auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  const auto metadata = readable_storage->get_metadata();
+
+  EXPECT_THAT(metadata.message_count, Eq(4u));
+  EXPECT_THAT(
+    metadata.starting_time, Eq(
+      std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(1))));
+  EXPECT_THAT(metadata.duration, Eq(std::chrono::nanoseconds(4)));
+}
+
+TEST_F(StorageTestFixture, get_metadata_scans_messages_of_files_without_topic_summary) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>> messages =
+  {std::make_tuple("message", 1, "topic1", "type1", "rmw_format"),
+    std::make_tuple("message", 2, "topic2", "type2", "rmw_format"),
+    std::make_tuple("message", 3, "topic1", "type1", "rmw_format")};
+  write_messages_to_sqlite(messages);
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+
+  {
+    rosbag2_storage_plugins::SqliteWrapper db(
+      db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement("DROP TABLE topic_summary;")->execute_and_reset();
+  }
+
+  const auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  const auto metadata = readable_storage->get_metadata();
+
+  EXPECT_THAT(
+    metadata.topics_with_message_count, ElementsAreArray(
+  {
+    rosbag2_storage::TopicInformation{rosbag2_storage::TopicMetadata{
+        "topic1", "type1", "rmw_format", ""}, 2u},
+    rosbag2_storage::TopicInformation{rosbag2_storage::TopicMetadata{
+        "topic2", "type2", "rmw_format", ""}, 1u}
+  }));
+  EXPECT_THAT(metadata.message_count, Eq(3u));
+}
+
+TEST_F(StorageTestFixture, read_next_batch_respects_the_message_and_byte_limits) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages;
+  for (int64_t i = 1; i <= 10; ++i) {
+    string_messages.push_back(std::make_tuple("message", i, "topic", "", ""));
+  }
+  write_messages_to_sqlite(string_messages);
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(
+    (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string(),
+    rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  const auto message_size =
+    readable_storage->read_next_batch(1, 0)[0]->serialized_data->buffer_length;
+
+  auto batch = readable_storage->read_next_batch(3, 0);
+  ASSERT_THAT(batch, SizeIs(3));
+  EXPECT_THAT(batch[0]->time_stamp, Eq(2));
+  EXPECT_THAT(batch[2]->time_stamp, Eq(4));
+
+  // The message reaching the byte limit is still part of the batch.
+  batch = readable_storage->read_next_batch(0, message_size + 1);
+  ASSERT_THAT(batch, SizeIs(2));
+  EXPECT_THAT(batch[0]->time_stamp, Eq(5));
+
+  batch = readable_storage->read_next_batch(0, 0);
+  ASSERT_THAT(batch, SizeIs(4));
+  EXPECT_THAT(batch[3]->time_stamp, Eq(10));
+  EXPECT_THAT(readable_storage->read_next_batch(10, 0), IsEmpty());
+}
+
+TEST_F(StorageTestFixture, messages_are_read_into_pooled_messages_and_buffers) {
+  const std::string large_message(200 * 1024, 'x');
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("small message", 1, "topic", "", ""),
+    std::make_tuple(large_message, 2, "topic", "", ""),
+    std::make_tuple("small message", 3, "topic", "", "")};
+  write_messages_to_sqlite(string_messages);
+
+  auto message_pool = std::make_shared<rosbag2_storage::MessagePool>();
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(
+    (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string(),
+    rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  readable_storage->set_message_pool(message_pool);
+
+  for (const auto & string_message : string_messages) {
+    ASSERT_TRUE(readable_storage->has_next());
+    auto message = readable_storage->read_next();
+    EXPECT_THAT(deserialize_message(message->serialized_data), Eq(std::get<0>(string_message)));
+    EXPECT_THAT(message->time_stamp, Eq(std::get<1>(string_message)));
+    EXPECT_THAT(message->topic_name, Eq("topic"));
+    message.reset();
+    EXPECT_THAT(message_pool->get_pooled_message_count(), Eq(1u));
+    EXPECT_THAT(message_pool->get_pooled_buffer_count(), Eq(1u));
+  }
+}
+
+TEST_F(StorageTestFixture, messages_can_be_ordered_and_seeked_by_publish_time) {
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    writable_storage->open(db_filename);
+    writable_storage->create_topic({"topic", "type", "rmw_format", ""});
+    // Received in a different order than published, the last one without publish time.
+    const std::vector<std::pair<int64_t, int64_t>> time_stamps = {{10, 3}, {11, 1}, {12, 0}};
+    for (const auto & time_stamp : time_stamps) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = make_serialized_message("message");
+      message->topic_name = "topic";
+      message->time_stamp = time_stamp.first;
+      message->publish_time_stamp = time_stamp.second;
+      writable_storage->write(message);
+    }
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(
+    db_filename + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(10));
+
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.order_by_publish_time = true;
+  readable_storage->set_filter(storage_filter);
+  auto message = readable_storage->read_next();
+  EXPECT_THAT(message->time_stamp, Eq(11));
+  EXPECT_THAT(message->publish_time_stamp, Eq(1));
+  EXPECT_THAT(readable_storage->read_next()->time_stamp, Eq(10));
+  message = readable_storage->read_next();
+  EXPECT_THAT(message->time_stamp, Eq(12));
+  EXPECT_THAT(message->publish_time_stamp, Eq(12));
+  EXPECT_FALSE(readable_storage->has_next());
+
+  readable_storage->seek(2);
+  EXPECT_THAT(readable_storage->read_next()->publish_time_stamp, Eq(3));
+}
+
+TEST_F(StorageTestFixture, messages_of_files_without_publish_time_are_ordered_by_receive_time) {
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("first message", 1, "topic", "", ""),
+    std::make_tuple("second message", 2, "topic", "", "")};
+  write_messages_to_sqlite(string_messages);
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+
+  {
+    // Restores the schema of older versions.
+    rosbag2_storage_plugins::SqliteWrapper db(
+      db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE);
+    db.prepare_statement(
+      "CREATE TABLE old_messages AS SELECT id, topic_id, timestamp, data FROM messages;")
+    ->execute_and_reset();
+    db.prepare_statement("DROP TABLE messages;")->execute_and_reset();
+    db.prepare_statement("ALTER TABLE old_messages RENAME TO messages;")->execute_and_reset();
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.order_by_publish_time = true;
+  readable_storage->set_filter(storage_filter);
+  readable_storage->seek(2);
+
+  auto message = readable_storage->read_next();
+  EXPECT_THAT(message->time_stamp, Eq(2));
+  EXPECT_THAT(message->publish_time_stamp, Eq(0));
+  EXPECT_FALSE(readable_storage->has_next());
+}
+
+TEST_F(StorageTestFixture, time_ranges_of_files_written_in_and_out_of_time_stamp_order_are_read) {
+  const auto db_filename = (rcpputils::fs::path(temporary_dir_path_) / "rosbag.db3").string();
+  auto read_time_stamps_from = [&db_filename](
+    rcutils_time_point_value_t start_time, rcutils_time_point_value_t end_time) {
+      auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+      readable_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+      rosbag2_storage::StorageFilter storage_filter;
+      storage_filter.start_time = start_time;
+      storage_filter.end_time = end_time;
+      readable_storage->set_filter(storage_filter);
+      std::vector<rcutils_time_point_value_t> time_stamps;
+      while (readable_storage->has_next()) {
+        time_stamps.push_back(readable_storage->read_next()->time_stamp);
+      }
+      return time_stamps;
+    };
+  auto has_monotonic_timestamps = [&db_filename]() {
+      rosbag2_storage_plugins::SqliteWrapper db(
+        db_filename, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+      return std::get<0>(
+        db.prepare_statement(
+          "SELECT value FROM storage_info WHERE key = 'monotonic_timestamps';")
+        ->execute_query<int>().get_single_line()) == 1;
+    };
+
+  std::vector<std::tuple<std::string, int64_t, std::string, std::string, std::string>>
+  string_messages =
+  {std::make_tuple("message", 1, "topic", "", ""),
+    std::make_tuple("message", 2, "topic", "", ""),
+    std::make_tuple("message", 2, "topic", "", ""),
+    std::make_tuple("message", 4, "topic", "", "")};
+  write_messages_to_sqlite(string_messages);
+  EXPECT_TRUE(has_monotonic_timestamps());
+  EXPECT_THAT(read_time_stamps_from(2, 3), ElementsAre(2, 2));
+  EXPECT_THAT(read_time_stamps_from(5, 0), IsEmpty());
+
+  {
+    auto appending_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    appending_storage->open(db_filename, rosbag2_storage::storage_interfaces::IOFlag::APPEND);
+    appending_storage->create_topic({"other_topic", "", "", ""});
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->serialized_data = make_serialized_message("message");
+    message->topic_name = "other_topic";
+    message->time_stamp = 3;
+    appending_storage->write(message);
+  }
+  EXPECT_FALSE(has_monotonic_timestamps());
+  EXPECT_THAT(read_time_stamps_from(2, 3), ElementsAre(2, 2, 3));
+  EXPECT_THAT(read_time_stamps_from(0, 0), ElementsAre(1, 2, 2, 3, 4));
+}
+
+TEST_F(StorageTestFixture, messages_are_sampled_by_stride_and_interval_per_topic) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  {
+    auto writable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+    rosbag2_storage::StorageConfig storage_config{};
+    storage_config.topic_timestamp_index = true;
+    writable_storage->open(
+      uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+    writable_storage->create_topic({"fast", "type", "rmw", ""});
+    writable_storage->create_topic({"slow", "type", "rmw", ""});
+    for (int64_t time_stamp = 1; time_stamp <= 10; ++time_stamp) {
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->serialized_data = make_serialized_message("message");
+      bag_message->topic_name = time_stamp % 3 == 0 ? "slow" : "fast";
+      bag_message->time_stamp = time_stamp;
+      writable_storage->write(bag_message);
+    }
+  }
+
+  auto readable_storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  readable_storage->open(uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  EXPECT_TRUE(readable_storage->get_capabilities().sampling);
+  auto read_messages = [&readable_storage]() {
+      std::vector<std::pair<std::string, int64_t>> messages;
+      while (readable_storage->has_next()) {
+        auto message = readable_storage->read_next();
+        messages.emplace_back(message->topic_name, message->time_stamp);
+      }
+      return messages;
+    };
+  using Message = std::pair<std::string, int64_t>;
+
+  // Fast messages are at 1, 2, 4, 5, 7, 8, 10, slow ones at 3, 6, 9.
+  rosbag2_storage::StorageFilter storage_filter;
+  storage_filter.sample_stride = 2;
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(
+    read_messages(), ElementsAre(
+      Message{"fast", 1}, Message{"slow", 3}, Message{"fast", 4}, Message{"fast", 7},
+      Message{"slow", 9}, Message{"fast", 10}));
+
+  // Sampling counts from the start of the time range, but not from the seek time.
+  storage_filter.topics = {"fast"};
+  storage_filter.start_time = 2;
+  readable_storage->set_filter(storage_filter);
+  readable_storage->seek(5);
+  EXPECT_THAT(read_messages(), ElementsAre(Message{"fast", 5}, Message{"fast", 8}));
+
+  storage_filter = {};
+  storage_filter.sample_interval = 3;
+  readable_storage->set_filter(storage_filter);
+  readable_storage->seek(0);
+  EXPECT_THAT(
+    read_messages(), ElementsAre(
+      Message{"fast", 1}, Message{"slow", 3}, Message{"fast", 4}, Message{"slow", 6},
+      Message{"fast", 7}, Message{"slow", 9}, Message{"fast", 10}));
+
+  // The stride applies to the messages passing the interval.
+  storage_filter.sample_interval = 2;
+  storage_filter.sample_stride = 2;
+  storage_filter.topics = {"fast"};
+  readable_storage->set_filter(storage_filter);
+  EXPECT_THAT(read_messages(), ElementsAre(Message{"fast", 1}, Message{"fast", 7}));
+}
+
+TEST_F(StorageTestFixture, topics_with_time_ranges_of_their_own_are_read_within_them) {
+  const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+  auto read_messages = [](
+    rosbag2_storage_plugins::SqliteStorage & readable_storage,
+    const rosbag2_storage::StorageFilter & storage_filter) {
+      readable_storage.set_filter(storage_filter);
+      std::vector<std::pair<std::string, int64_t>> messages;
+      while (readable_storage.has_next()) {
+        auto message = readable_storage.read_next();
+        messages.emplace_back(message->topic_name, message->time_stamp);
+      }
+      return messages;
+    };
+  using Message = std::pair<std::string, int64_t>;
+
+  for (const bool cluster_messages_by_topic : {false, true}) {
+    const auto file_uri = uri + (cluster_messages_by_topic ? "_clustered" : "");
+    {
+      rosbag2_storage_plugins::SqliteStorage writable_storage;
+      rosbag2_storage::StorageConfig storage_config{};
+      storage_config.cluster_messages_by_topic = cluster_messages_by_topic;
+      writable_storage.open(
+        file_uri, rosbag2_storage::storage_interfaces::IOFlag::READ_WRITE, storage_config);
+      for (const auto & topic : {"/tf", "/camera/left", "/camera/right"}) {
+        writable_storage.create_topic({topic, "type", "rmw", ""});
+      }
+      for (int64_t time_stamp = 1; time_stamp <= 6; ++time_stamp) {
+        for (const auto & topic : {"/tf", "/camera/left", "/camera/right"}) {
+          auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+          bag_message->serialized_data = make_serialized_message("message");
+          bag_message->topic_name = topic;
+          bag_message->time_stamp = time_stamp;
+          writable_storage.write(bag_message);
+        }
+      }
+    }
+
+    rosbag2_storage_plugins::SqliteStorage readable_storage;
+    readable_storage.open(
+      file_uri + ".db3", rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+    rosbag2_storage::StorageFilter storage_filter;
+    storage_filter.topics = {"/tf", "/camera/left"};
+    storage_filter.end_time = 5;
+    storage_filter.topic_time_ranges = {{"/camera/.*", 2, 3}, {"/camera/left", 5, 0}};
+    EXPECT_THAT(
+      read_messages(readable_storage, storage_filter), ElementsAre(
+        Message{"/tf", 1}, Message{"/tf", 2}, Message{"/camera/left", 2}, Message{"/tf", 3},
+        Message{"/camera/left", 3}, Message{"/tf", 4}, Message{"/tf", 5},
+        Message{"/camera/left", 5}));
+
+    // Only topics with time ranges of their own are read, so the ranges bound the time read.
+    storage_filter.topics = {};
+    storage_filter.end_time = 0;
+    storage_filter.topic_time_ranges = {{"/camera/.*", 2, 3}, {"/tf", 3, 3}};
+    EXPECT_THAT(
+      read_messages(readable_storage, storage_filter), ElementsAre(
+        Message{"/camera/left", 2}, Message{"/camera/right", 2}, Message{"/tf", 3},
+        Message{"/camera/left", 3}, Message{"/camera/right", 3}));
+  }
+}
@@ -0,0 +1,95 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/message_pool.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "rosbag2_storage_default_plugins/sqlite/sqlite_storage.hpp"
+
+#include "rosbag2_test_common/allocation_counter.hpp"
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+constexpr size_t MESSAGE_SIZE = 100;
+constexpr size_t MESSAGE_COUNT = 2000;
+constexpr size_t WARM_UP_MESSAGE_COUNT = 100;
+// The pool recycles the message and its buffer, only the control blocks of their shared
+// pointers are allocated.
+constexpr size_t MAX_POOLED_ALLOCATIONS_PER_MESSAGE = 2;
+}  // namespace
+
+class SqliteStorageAllocationsTestFixture : public TemporaryDirectoryFixture
+{
+public:
+  std::string write_bag()
+  {
+    const auto uri = (rcpputils::fs::path(temporary_dir_path_) / "rosbag").string();
+    rosbag2_storage_plugins::SqliteStorage storage;
+    storage.open(uri);
+    storage.create_topic({"topic", "type", "rmw", ""});
+    std::vector<uint8_t> data(MESSAGE_SIZE, 0x42);
+    std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> messages;
+    for (size_t i = 0; i < MESSAGE_COUNT; ++i) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+      message->time_stamp = static_cast<rcutils_time_point_value_t>(i + 1);
+      message->topic_name = "topic";
+      messages.push_back(message);
+    }
+    storage.write(messages);
+    return uri + ".db3";
+  }
+};
+
+TEST_F(
+  SqliteStorageAllocationsTestFixture, read_next_allocates_only_shared_pointers_with_message_pool)
+{
+  if (!AllocationCounter::is_supported()) {
+    return;
+  }
+  const auto db_file = write_bag();
+  rosbag2_storage_plugins::SqliteStorage storage;
+  storage.open(db_file, rosbag2_storage::storage_interfaces::IOFlag::READ_ONLY);
+  storage.set_message_pool(std::make_shared<rosbag2_storage::MessagePool>());
+
+  size_t read_messages = 0;
+  // The messages are released right away, which returns them to the pool. Matchers are not
+  // used while counting, as they allocate.
+  auto read_message = [&storage, &read_messages]() {
+      ASSERT_TRUE(storage.has_next());
+      auto message = storage.read_next();
+      ASSERT_EQ(MESSAGE_SIZE, message->serialized_data->buffer_length);
+      ++read_messages;
+    };
+  const auto allocations = count_steady_state_allocations(
+    read_message, WARM_UP_MESSAGE_COUNT, MESSAGE_COUNT - WARM_UP_MESSAGE_COUNT);
+
+  EXPECT_THAT(read_messages, Eq(MESSAGE_COUNT));
+  EXPECT_THAT(
+    allocations,
+    Le(MAX_POOLED_ALLOCATIONS_PER_MESSAGE * (MESSAGE_COUNT - WARM_UP_MESSAGE_COUNT)));
+}
@@ -0,0 +1,97 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+
+#include "rosbag2_storage_default_plugins/sqlite/sqlite_storage.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+constexpr size_t MESSAGE_SIZE = 1024 * 1024;
+constexpr size_t MESSAGE_COUNT = 1024;  // 1 GiB in total
+constexpr size_t WARM_UP_MESSAGE_COUNT = 64;
+constexpr size_t CACHE_SIZE = 16;
+// Generous bound covering the SQLite page cache and allocator noise.
+constexpr size_t MAX_RSS_GROWTH = 64 * 1024 * 1024;
+
+size_t get_resident_set_size()
+{
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  statm >> total_pages >> resident_pages;
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+}  // namespace
+
+class SqliteStorageMemoryTestFixture : public TemporaryDirectoryFixture
+{
+public:
+  std::shared_ptr<const rosbag2_storage::SerializedBagMessage> make_message()
+  {
+    std::vector<uint8_t> data(MESSAGE_SIZE, 0x42);
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->serialized_data = rosbag2_storage::make_serialized_message(data.data(), data.size());
+    message->time_stamp = ++time_stamp_;
+    message->topic_name = "topic";
+    return message;
+  }
+
+  rcutils_time_point_value_t time_stamp_{0};
+};
+
+TEST_F(SqliteStorageMemoryTestFixture, resident_memory_stays_flat_when_recording_1gb) {
+  auto storage = std::make_unique<rosbag2_storage_plugins::SqliteStorage>();
+  storage->open((rcpputils::fs::path(temporary_dir_path_) / "rosbag").string());
+  storage->create_topic({"topic", "type", "rmw", ""});
+
+  size_t rss_after_warm_up = 0;
+  std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> cache;
+  for (size_t i = 0; i < MESSAGE_COUNT; ++i) {
+    if (i % 2 == 0) {
+      storage->write(make_message());
+    } else {
+      cache.push_back(make_message());
+      if (cache.size() == CACHE_SIZE) {
+        storage->write(cache);
+        cache.clear();
+      }
+    }
+    if (i + 1 == WARM_UP_MESSAGE_COUNT) {
+      rss_after_warm_up = get_resident_set_size();
+    }
+  }
+  storage->write(cache);
+  cache.clear();
+
+  EXPECT_THAT(get_resident_set_size(), Lt(rss_after_warm_up + MAX_RSS_GROWTH));
+}
@@ -17,6 +17,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "rcpputils/filesystem_helper.hpp"
 
@@ -110,6 +111,23 @@ TEST_F(SqliteWrapperTestFixture, all_result_rows_are_available) {
   ASSERT_THAT(row_value, Eq(4));
 }
 
+TEST_F(SqliteWrapperTestFixture, row_values_are_passed_to_visitor) {
+  db_.prepare_statement("CREATE TABLE test (id INTEGER, name TEXT);")->execute_and_reset();
+  db_.prepare_statement("INSERT INTO test (id, name) VALUES (1, 'one');")->execute_and_reset();
+  db_.prepare_statement("INSERT INTO test (id, name) VALUES (2, 'two');")->execute_and_reset();
+
+  std::vector<std::pair<int, std::string>> rows;
+  db_.prepare_statement("SELECT id, name FROM test ORDER BY id ASC;")
+  ->execute_query<int, std::string>().for_each_row(
+    [&rows](int id, std::string && name) {
+      rows.emplace_back(id, std::move(name));
+    });
+
+  EXPECT_THAT(
+    rows, ElementsAre(
+      std::make_pair(1, std::string("one")), std::make_pair(2, std::string("two"))));
+}
+
 TEST_F(SqliteWrapperTestFixture, only_a_single_iterator_is_allowed_per_result) {
   auto result = db_.prepare_statement("SELECT 1;")->execute_query<int>();
 
@@ -147,3 +165,54 @@ TEST_F(SqliteWrapperTestFixture, get_single_line_handles_empty_result_set) {
 
   EXPECT_THROW(result.get_single_line(), rosbag2_storage_plugins::SqliteException);
 }
+
+TEST_F(SqliteWrapperTestFixture, bound_blobs_are_released_after_execution) {
+  db_.prepare_statement("CREATE TABLE test (id INTEGER PRIMARY KEY, data BLOB);")
+  ->execute_and_reset();
+  auto statement = db_.prepare_statement("INSERT INTO test (id, data) VALUES (?, ?);");
+  std::shared_ptr<rcutils_uint8_array_t> message = make_serialized_message("message");
+
+  statement->bind(1, message)->execute_and_reset();
+  EXPECT_THAT(message.use_count(), Eq(1));
+
+  // Inserting the same primary key again fails, which must not leak the blob either.
+  EXPECT_THROW(
+    statement->bind(1, message)->execute_and_reset(), rosbag2_storage_plugins::SqliteException);
+  EXPECT_THAT(message.use_count(), Eq(1));
+
+  statement->bind(2, message)->execute_and_reset();
+  EXPECT_THAT(message.use_count(), Eq(1));
+}
+
+TEST_F(SqliteWrapperTestFixture, blobs_can_be_read_incrementally_by_row_id) {
+  db_.prepare_statement("CREATE TABLE test (id INTEGER PRIMARY KEY, data BLOB);")
+  ->execute_and_reset();
+  auto statement = db_.prepare_statement("INSERT INTO test (id, data) VALUES (?, ?);");
+  statement->bind(1, make_serialized_message("first message"))->execute_and_reset();
+  statement->bind(2, make_serialized_message("second message"))->execute_and_reset();
+
+  EXPECT_THAT(deserialize_message(db_.read_blob("test", "data", 2)), StrEq("second message"));
+  EXPECT_THAT(deserialize_message(db_.read_blob("test", "data", 1)), StrEq("first message"));
+  EXPECT_THROW(db_.read_blob("test", "data", 3), rosbag2_storage_plugins::SqliteException);
+  // The handle is reopened after a failed read.
+  EXPECT_THAT(deserialize_message(db_.read_blob("test", "data", 1)), StrEq("first message"));
+}
+
+TEST_F(SqliteWrapperTestFixture, cached_statements_are_prepared_once_and_reset_for_reuse) {
+  db_.prepare_statement("CREATE TABLE test (id INTEGER PRIMARY KEY);")->execute_and_reset();
+  const std::string query = "SELECT id FROM test WHERE id > ?;";
+  auto statement = db_.get_cached_statement(query);
+  statement->bind(0);
+  // The results are discarded without being read, the cached statement is reset anyway.
+  statement->execute_query<int>();
+
+  db_.get_cached_statement("INSERT INTO test (id) VALUES (?);")->bind(1)->execute_and_reset();
+  db_.get_cached_statement("INSERT INTO test (id) VALUES (?);")->bind(2)->execute_and_reset();
+
+  auto cached_statement = db_.get_cached_statement(query);
+  EXPECT_THAT(cached_statement, Eq(statement));
+  std::vector<int> ids;
+  cached_statement->bind(1)->execute_query<int>().for_each_row(
+    [&ids](int id) {ids.push_back(id);});
+  EXPECT_THAT(ids, ElementsAre(2));
+}
@@ -0,0 +1,50 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../src/rosbag2_storage_default_plugins/crc32c.hpp"
+
+using namespace ::testing;  // NOLINT
+
+using rosbag2_storage_plugins::update_crc32c;
+using rosbag2_storage_plugins::update_crc32c_without_instructions;
+
+TEST(Crc32cTest, checksum_matches_the_check_value_of_crc32c) {
+  const std::string data = "123456789";
+  const auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+
+  EXPECT_THAT(update_crc32c(0, bytes, data.size()), Eq(0xE3069283u));
+  EXPECT_THAT(update_crc32c_without_instructions(0, bytes, data.size()), Eq(0xE3069283u));
+  EXPECT_THAT(update_crc32c(0, bytes, 0), Eq(0u));
+}
+
+TEST(Crc32cTest, checksum_can_be_continued_and_does_not_depend_on_the_instructions) {
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+
+  // Sizes and offsets which are not multiples of the 8 bytes checksummed per step.
+  for (size_t split : {0u, 1u, 7u, 8u, 13u, 500u}) {
+    const auto crc = update_crc32c(
+      update_crc32c(0, data.data(), split), data.data() + split, data.size() - split - 3);
+    EXPECT_THAT(
+      crc, Eq(update_crc32c_without_instructions(0, data.data(), data.size() - 3))) << split;
+  }
+}
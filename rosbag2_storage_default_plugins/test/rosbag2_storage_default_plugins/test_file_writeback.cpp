@@ -0,0 +1,104 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#ifndef _WIN32
+# include <sys/stat.h>
+#endif
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_test_common/temporary_directory_fixture.hpp"
+
+#include "../../src/rosbag2_storage_default_plugins/file_writeback.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+using rosbag2_storage_plugins::FileWriteback;
+
+class FileWritebackTest : public TemporaryDirectoryFixture
+{
+public:
+  FileWritebackTest()
+  {
+    path_ = (rcpputils::fs::path(temporary_dir_path_) / "file").string();
+    std::ofstream(path_, std::ios::binary) << "header";
+  }
+
+  void append(const std::string & data)
+  {
+    std::ofstream(path_, std::ios::binary | std::ios::app) << data;
+  }
+
+  uint64_t get_allocated_size()
+  {
+#ifndef _WIN32
+    struct stat file_status;
+    if (stat(path_.c_str(), &file_status) == 0) {
+      return static_cast<uint64_t>(file_status.st_blocks) * 512u;
+    }
+#endif
+    return 0;
+  }
+
+  std::string path_;
+};
+
+TEST_F(FileWritebackTest, preallocated_space_keeps_the_file_size_and_is_released_on_close) {
+  const uint64_t preallocate_size = 4 * 1024 * 1024;
+  {
+    FileWriteback file_writeback(path_, preallocate_size, 0);
+    EXPECT_THAT(rcpputils::fs::path(path_).file_size(), Eq(6u));
+    append(std::string(1000, 'x'));
+    file_writeback.update();
+    if (file_writeback.is_preallocated()) {
+      EXPECT_THAT(get_allocated_size(), Ge(preallocate_size));
+    }
+  }
+
+  EXPECT_THAT(rcpputils::fs::path(path_).file_size(), Eq(1006u));
+  EXPECT_THAT(get_allocated_size(), Lt(preallocate_size));
+}
+
+TEST_F(FileWritebackTest, data_written_back_at_the_interval_is_kept) {
+  {
+    FileWriteback file_writeback(path_, 0, 4096);
+    for (int i = 0; i < 10; ++i) {
+      append(std::string(3000, static_cast<char>('a' + i)));
+      file_writeback.update();
+    }
+  }
+
+  std::ifstream input(path_, std::ios::binary);
+  const std::string data{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+  ASSERT_THAT(data.size(), Eq(30006u));
+  EXPECT_THAT(data.substr(0, 6), Eq("header"));
+  EXPECT_THAT(data.substr(27006), Eq(std::string(3000, 'j')));
+}
+
+TEST_F(FileWritebackTest, missing_file_is_left_alone) {
+  const auto missing_path = (rcpputils::fs::path(temporary_dir_path_) / "missing").string();
+  FileWriteback file_writeback(missing_path, 4096, 4096);
+  file_writeback.update();
+
+  EXPECT_FALSE(file_writeback.is_preallocated());
+  EXPECT_FALSE(rcpputils::fs::path(missing_path).exists());
+}
@@ -13,11 +13,22 @@
 #  See the License for the specific language governing permissions and
 #  limitations under the License.
 
-cd ./build/bin
+# Runs the benchmarks of the given storage plugins, by default "sqlite3 binary_log".
+# The CSV files are written to the current directory.
+# Usage: ./run_all_benchmarks.sh [<storage id>...]
 
-./small_messages_benchmark
-./big_messages_benchmark
-./mixed_messages_benchmark
+storages="${*:-sqlite3 binary_log}"
 
-cd ../..
+rm -f small_messages_benchmark.csv big_messages_benchmark.csv \
+  mixed_messages_benchmark.csv storage_preset_benchmark.csv read_benchmark.csv \
+  compression_benchmark.csv
 
+for storage in $storages; do
+  ros2 run rosbag2_storage_evaluation small_messages_benchmark "$storage"
+  ros2 run rosbag2_storage_evaluation big_messages_benchmark "$storage"
+  ros2 run rosbag2_storage_evaluation mixed_messages_benchmark "$storage"
+  ros2 run rosbag2_storage_evaluation read_benchmark "$storage"
+done
+
+ros2 run rosbag2_storage_evaluation storage_preset_benchmark sqlite3
+ros2 run rosbag2_storage_evaluation compression_benchmark
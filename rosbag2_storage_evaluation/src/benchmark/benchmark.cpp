@@ -29,3 +29,15 @@ void ros2bag::write_csv_file(
   benchmark.write_csv(file, with_header);
   file.close();
 }
+
+void ros2bag::write_json_file(
+  std::string const & file_name, Benchmark const & benchmark, bool truncate)
+{
+  std::ofstream file;
+  if (truncate) {
+    std::remove(file_name.c_str());
+  }
+  file.open(file_name, std::ofstream::out | std::ofstream::app);
+  benchmark.write_json(file);
+  file.close();
+}
@@ -34,11 +34,16 @@ public:
 
   virtual void write_csv(std::ostream & out_stream, bool with_header) const = 0;
 
+  virtual void write_json(std::ostream & out_stream) const = 0;
+
 };
 
 void write_csv_file(
   std::string const & file_name, Benchmark const & benchmark, bool with_header);
 
+/// Appends the results as one line of JSON, or starts a new file if truncate is set.
+void write_json_file(std::string const & file_name, Benchmark const & benchmark, bool truncate);
+
 }
 
 #endif //ROS2_ROSBAG_EVALUATION_BENCHMARK_H
@@ -0,0 +1,262 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmark/compression/compression_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_compression/compression_factory.hpp"
+#include "rosbag2_compression/message_chunk.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+
+using namespace ros2bag;
+
+namespace
+{
+
+struct Measurement
+{
+  uint64_t compressed_bytes = 0;
+  std::chrono::nanoseconds compression_time{0};
+  std::chrono::nanoseconds decompression_time{0};
+  long compression_peak_memory = 0;
+  long decompression_peak_memory = 0;
+};
+
+/// Growth of the peak resident set size since construction, where it can be reset (Linux).
+class PeakMemory
+{
+public:
+  PeakMemory()
+  {
+    reset_peak_resident_set_size();
+    start_ = peak_resident_set_size();
+  }
+
+  long growth() const
+  {
+    return std::max(0L, peak_resident_set_size() - start_);
+  }
+
+private:
+  long start_;
+};
+
+template<typename OperationT>
+std::chrono::nanoseconds measure(OperationT && operation)
+{
+  auto const start = std::chrono::steady_clock::now();
+  operation();
+  return std::chrono::steady_clock::now() - start;
+}
+
+// Messages are compressed in place, so the copies compressed are made before measuring.
+std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> make_inputs(
+  PayloadCorpus const & corpus, CompressionBenchmarkOptions const & options)
+{
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> inputs;
+  if (options.compression_mode == rosbag2_compression::CompressionMode::CHUNK) {
+    rosbag2_compression::MessageChunk chunk;
+    for (auto const & message : corpus.messages) {
+      chunk.add_message(*message);
+      if (options.chunk_max_bytes > 0 && chunk.get_size() >= options.chunk_max_bytes) {
+        inputs.push_back(chunk.release());
+      }
+    }
+    if (!chunk.empty()) {
+      inputs.push_back(chunk.release());
+    }
+    return inputs;
+  }
+
+  for (auto const & message : corpus.messages) {
+    auto input = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    input->topic_name = message->topic_name;
+    input->time_stamp = message->time_stamp;
+    input->serialized_data = rosbag2_storage::make_serialized_message(
+      message->serialized_data->buffer, message->serialized_data->buffer_length);
+    inputs.push_back(std::move(input));
+  }
+  return inputs;
+}
+
+Measurement measure_messages(
+  PayloadCorpus const & corpus,
+  CompressionBenchmarkOptions const & options,
+  rosbag2_compression::BaseCompressorInterface & compressor,
+  rosbag2_compression::BaseDecompressorInterface & decompressor,
+  Profiler & profiler)
+{
+  auto inputs = make_inputs(corpus, options);
+  std::vector<size_t> sizes;
+  for (auto const & input : inputs) {
+    sizes.push_back(input->serialized_data->buffer_length);
+  }
+
+  Measurement measurement;
+  LatencyHistogram & compression_latency = profiler.latency_histogram("compress");
+  PeakMemory compression_memory;
+  for (auto const & input : inputs) {
+    auto const latency = measure([&] {compressor.compress_serialized_bag_message(input.get());});
+    compression_latency.record(latency);
+    measurement.compression_time += latency;
+    measurement.compressed_bytes += input->serialized_data->buffer_length;
+  }
+  measurement.compression_peak_memory = compression_memory.growth();
+
+  LatencyHistogram & decompression_latency = profiler.latency_histogram("decompress");
+  PeakMemory decompression_memory;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    auto const & input = inputs[i];
+    auto const latency = measure(
+      [&] {decompressor.decompress_serialized_bag_message(input.get());});
+    decompression_latency.record(latency);
+    measurement.decompression_time += latency;
+    if (input->serialized_data->buffer_length != sizes[i]) {
+      throw std::runtime_error("A message was not restored by decompressing it.");
+    }
+  }
+  measurement.decompression_peak_memory = decompression_memory.growth();
+  return measurement;
+}
+
+// The file is written like a bagfile holding the messages, without the framing of a storage.
+Measurement measure_file(
+  PayloadCorpus const & corpus,
+  std::string const & working_directory,
+  rosbag2_compression::BaseCompressorInterface & compressor,
+  rosbag2_compression::BaseDecompressorInterface & decompressor,
+  Profiler & profiler)
+{
+  auto const uri =
+    (rcpputils::fs::path(working_directory) / "compression_benchmark_corpus").string();
+  {
+    std::ofstream file(uri, std::ios::binary | std::ios::trunc);
+    for (auto const & message : corpus.messages) {
+      file.write(
+        reinterpret_cast<char const *>(message->serialized_data->buffer),
+        static_cast<std::streamsize>(message->serialized_data->buffer_length));
+    }
+    if (!file) {
+      throw std::runtime_error("Could not write '" + uri + "'.");
+    }
+  }
+
+  Measurement measurement;
+  std::string compressed_uri;
+  PeakMemory compression_memory;
+  measurement.compression_time = measure([&] {compressed_uri = compressor.compress_uri(uri);});
+  measurement.compression_peak_memory = compression_memory.growth();
+  profiler.latency_histogram("compress").record(measurement.compression_time);
+  measurement.compressed_bytes = rcpputils::fs::path(compressed_uri).file_size();
+  rcpputils::fs::remove(rcpputils::fs::path(uri));
+
+  std::string decompressed_uri;
+  PeakMemory decompression_memory;
+  measurement.decompression_time = measure(
+    [&] {decompressed_uri = decompressor.decompress_uri(compressed_uri);});
+  measurement.decompression_peak_memory = decompression_memory.growth();
+  profiler.latency_histogram("decompress").record(measurement.decompression_time);
+  auto const decompressed_size = rcpputils::fs::path(decompressed_uri).file_size();
+  rcpputils::fs::remove(rcpputils::fs::path(compressed_uri));
+  rcpputils::fs::remove(rcpputils::fs::path(decompressed_uri));
+  if (decompressed_size != corpus.size()) {
+    throw std::runtime_error("The file was not restored by decompressing it.");
+  }
+  return measurement;
+}
+
+std::string megabytes_per_second(uint64_t bytes, std::chrono::nanoseconds time)
+{
+  auto const seconds = std::chrono::duration<double>(time).count();
+  return std::to_string(seconds > 0.0 ? bytes / seconds / 1e6 : 0.0);
+}
+
+}  // namespace
+
+void CompressionBenchmark::run() const
+{
+  rosbag2_compression::CompressionFactory factory;
+  auto compressor = factory.create_compressor(options_.compression_format);
+  auto decompressor = factory.create_decompressor(options_.compression_format);
+  rosbag2_compression::CompressionOptions compression_options;
+  compression_options.compression_format = options_.compression_format;
+  compression_options.compression_mode = options_.compression_mode;
+  compression_options.compression_level = options_.compression_level;
+  compression_options.compression_worker_threads = options_.compression_worker_threads;
+  compression_options.chunk_max_bytes = options_.chunk_max_bytes;
+  compressor->set_compression_options(compression_options);
+  for (auto const & topic : corpus_->topics) {
+    compressor->register_topic(topic);
+  }
+
+  profiler_->take_time_for("start compression time");
+  auto const measurement =
+    options_.compression_mode == rosbag2_compression::CompressionMode::FILE ?
+    measure_file(*corpus_, working_directory_, *compressor, *decompressor, *profiler_) :
+    measure_messages(*corpus_, options_, *compressor, *decompressor, *profiler_);
+  profiler_->take_time_for("end compression time");
+
+  auto const uncompressed_bytes = corpus_->size();
+  profiler_->track_result("uncompressed size (bytes)", std::to_string(uncompressed_bytes));
+  profiler_->track_result(
+    "compressed size (bytes)", std::to_string(measurement.compressed_bytes));
+  profiler_->track_result(
+    "compression ratio",
+    std::to_string(static_cast<double>(measurement.compressed_bytes) / uncompressed_bytes));
+  profiler_->track_result(
+    "compression throughput (MB/s)",
+    megabytes_per_second(uncompressed_bytes, measurement.compression_time));
+  profiler_->track_result(
+    "decompression throughput (MB/s)",
+    megabytes_per_second(uncompressed_bytes, measurement.decompression_time));
+  profiler_->track_result(
+    "compression peak memory (bytes)", std::to_string(measurement.compression_peak_memory));
+  profiler_->track_result(
+    "decompression peak memory (bytes)",
+    std::to_string(measurement.decompression_peak_memory));
+  profiler_->track_disk_usage(static_cast<long>(measurement.compressed_bytes));
+  profiler_->track_memory_usage();
+}
+
+void CompressionBenchmark::write_csv(std::ostream & out_stream, bool with_header) const
+{
+  if (with_header) {
+    out_stream << profiler_->csv_header() << std::endl;
+  }
+  out_stream << profiler_->csv_entry() << std::endl;
+}
+
+void CompressionBenchmark::write_json(std::ostream & out_stream) const
+{
+  out_stream << profiler_->json_entry() << std::endl;
+}
+
+std::string CompressionBenchmarkOptions::description() const
+{
+  auto description = compression_format + "/" +
+    rosbag2_compression::compression_mode_to_string(compression_mode) + "/level " +
+    std::to_string(compression_level);
+  if (compression_mode == rosbag2_compression::CompressionMode::FILE) {
+    description += "/" + std::to_string(compression_worker_threads) + " worker threads";
+  }
+  return description;
+}
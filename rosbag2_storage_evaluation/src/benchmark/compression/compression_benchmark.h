@@ -0,0 +1,86 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_COMPRESSION_BENCHMARK_H
+#define ROS2_ROSBAG_EVALUATION_COMPRESSION_BENCHMARK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "generators/payload_generator.h"
+#include "profiler/profiler.h"
+#include "rosbag2_compression/compression_options.hpp"
+
+namespace ros2bag
+{
+
+/// Compression format and settings of a run, as given to ros2 bag record.
+struct CompressionBenchmarkOptions
+{
+  std::string compression_format = "zstd";
+  rosbag2_compression::CompressionMode compression_mode =
+    rosbag2_compression::CompressionMode::MESSAGE;
+  int compression_level = 1;
+  uint64_t compression_worker_threads = 0;
+  uint64_t chunk_max_bytes = 1024 * 1024;
+
+  /// Format, mode, level and worker threads, the description of the benchmark in the CSV.
+  std::string description() const;
+};
+
+/**
+ * Measures compressing a corpus with a compressor of the CompressionFactory like the compression
+ * writer does in the given mode, and decompressing it again like the compression reader: every
+ * message on its own in MESSAGE mode, the messages collected into chunks of chunk_max_bytes in
+ * CHUNK mode, and a file of all messages in FILE mode. The compressor is created anew for every
+ * run, and the decompressed data is checked to have its original size.
+ *
+ * The throughputs are the uncompressed size divided by the time spent in the compressor and in
+ * the decompressor. The peak memory is the growth of the peak resident set size while
+ * compressing or decompressing, which is only measured on Linux.
+ */
+class CompressionBenchmark : public Benchmark
+{
+public:
+  CompressionBenchmark(
+    std::shared_ptr<PayloadCorpus const> corpus,
+    CompressionBenchmarkOptions options,
+    std::string working_directory,
+    std::unique_ptr<Profiler> profiler)
+    : corpus_(std::move(corpus)), options_(std::move(options)),
+    working_directory_(std::move(working_directory)), profiler_(std::move(profiler))
+  {}
+
+  ~CompressionBenchmark() override = default;
+
+  /// \throws std::runtime_error if the data is not restored by decompressing it.
+  void run() const override;
+
+  void write_csv(std::ostream & out_stream, bool with_header) const override;
+
+  void write_json(std::ostream & out_stream) const override;
+
+private:
+  std::shared_ptr<PayloadCorpus const> corpus_;
+  CompressionBenchmarkOptions options_;
+  std::string working_directory_;
+  std::unique_ptr<Profiler> profiler_;
+};
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_COMPRESSION_BENCHMARK_H
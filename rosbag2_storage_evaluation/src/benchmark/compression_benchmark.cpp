@@ -0,0 +1,228 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/compression/compression_benchmark.h"
+#include "benchmark/writer/storage/storage_writer_benchmark.h"
+#include "generators/payload_generator.h"
+#include "profiler/profiler.h"
+
+using namespace ros2bag;
+
+namespace
+{
+
+char const kUsage[] =
+  "Usage: compression_benchmark [--formats <format>,...] [--modes <mode>,...] "
+  "[--levels <level>,...] [--threads <count>,...] [--corpora <name>,...] "
+  "[--corpus-size <MB>] [--bag <uri>] [--repetitions <count>]";
+
+struct Options
+{
+  std::vector<std::string> formats = {"zstd", "lz4", "lz4hc", "image"};
+  std::vector<rosbag2_compression::CompressionMode> modes = {
+    rosbag2_compression::CompressionMode::MESSAGE,
+    rosbag2_compression::CompressionMode::CHUNK,
+    rosbag2_compression::CompressionMode::FILE};
+  // Levels and worker threads of every format, unless given.
+  std::vector<int> levels;
+  std::vector<uint64_t> threads;
+  std::vector<std::string> corpora = generated_corpus_names();
+  uint64_t corpus_size_mb = 16;
+  std::string bag_uri;
+  unsigned int repetitions = 1;
+};
+
+std::vector<std::string> split(std::string const & list)
+{
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    auto const end = std::min(list.find(',', begin), list.size());
+    items.push_back(list.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return items;
+}
+
+template<typename NumberT>
+std::vector<NumberT> parse_numbers(std::string const & option, std::string const & list)
+{
+  std::vector<NumberT> numbers;
+  for (auto const & item : split(list)) {
+    try {
+      numbers.push_back(static_cast<NumberT>(std::stoll(item)));
+    } catch (std::logic_error const &) {
+      throw std::invalid_argument("Invalid value '" + list + "' of " + option + ".");
+    }
+  }
+  return numbers;
+}
+
+Options parse_options(int argc, char ** argv)
+{
+  Options options;
+  for (int i = 1; i < argc; i += 2) {
+    std::string const option = argv[i];
+    if (i + 1 >= argc) {
+      throw std::invalid_argument(kUsage);
+    }
+    std::string const value = argv[i + 1];
+    if (option == "--formats") {
+      options.formats = split(value);
+    } else if (option == "--modes") {
+      options.modes.clear();
+      for (auto const & mode : split(value)) {
+        auto const compression_mode = rosbag2_compression::compression_mode_from_string(mode);
+        if (compression_mode == rosbag2_compression::CompressionMode::NONE) {
+          throw std::invalid_argument("Invalid value '" + value + "' of --modes.");
+        }
+        options.modes.push_back(compression_mode);
+      }
+    } else if (option == "--levels") {
+      options.levels = parse_numbers<int>(option, value);
+    } else if (option == "--threads") {
+      options.threads = parse_numbers<uint64_t>(option, value);
+    } else if (option == "--corpora") {
+      options.corpora = split(value);
+    } else if (option == "--corpus-size") {
+      options.corpus_size_mb = parse_numbers<uint64_t>(option, value).at(0);
+    } else if (option == "--bag") {
+      options.bag_uri = value;
+    } else if (option == "--repetitions") {
+      options.repetitions = parse_numbers<unsigned int>(option, value).at(0);
+    } else {
+      throw std::invalid_argument(kUsage);
+    }
+  }
+  return options;
+}
+
+// Levels spanning the range of each format from its fastest to its strongest settings.
+std::vector<int> default_levels(std::string const & format)
+{
+  static std::map<std::string, std::vector<int>> const levels = {
+    {"zstd", {1, 3, 9, 19}},
+    {"lz4", {-8, 0}},
+    {"lz4hc", {3, 9, 12}},
+    {"image", {1, 3, 9}}};
+  auto const format_levels = levels.find(format);
+  return format_levels == levels.end() ? std::vector<int>{1} : format_levels->second;
+}
+
+// Only zstd, and the image format based on it, compress files with worker threads.
+std::vector<uint64_t> default_threads(std::string const & format)
+{
+  if (format == "zstd" || format == "image") {
+    return {0, 2, 4};
+  }
+  return {0};
+}
+
+void run_benchmark(
+  std::shared_ptr<PayloadCorpus const> const & corpus,
+  CompressionBenchmarkOptions const & options,
+  bool with_header)
+{
+  std::vector<std::pair<std::string, std::string>> meta_data = {
+    {"description",           options.description()},
+    {"corpus",                corpus->name},
+    {"compression format",    options.compression_format},
+    {"compression mode",      rosbag2_compression::compression_mode_to_string(
+        options.compression_mode)},
+    {"compression level",     std::to_string(options.compression_level)},
+    {"worker threads",        std::to_string(options.compression_worker_threads)},
+    {"number of messages",    std::to_string(corpus->messages.size())}
+  };
+
+  CompressionBenchmark benchmark(
+    corpus, options, ".", std::make_unique<Profiler>(meta_data, ""));
+
+  benchmark.run();
+
+  write_csv_file("compression_benchmark.csv", benchmark, with_header);
+  write_json_file("compression_benchmark.jsonl", benchmark, with_header);
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  /**
+   * Compresses and decompresses every corpus with every format in every mode, at the levels of
+   * each format and, in FILE mode, with each number of worker threads. The corpora hold 16 MB of
+   * generated messages each, and the messages of a bag given with --bag are added as a corpus of
+   * real data.
+   */
+  Options options;
+  std::vector<std::shared_ptr<PayloadCorpus const>> corpora;
+  try {
+    options = parse_options(argc, argv);
+    for (auto const & name : options.corpora) {
+      corpora.push_back(
+        std::make_shared<PayloadCorpus>(generate_corpus(name, options.corpus_size_mb * 1000000)));
+    }
+    if (!options.bag_uri.empty()) {
+      corpora.push_back(
+        std::make_shared<PayloadCorpus>(
+          load_bag_corpus(options.bag_uri, options.corpus_size_mb * 1000000)));
+    }
+  } catch (std::exception const & e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool with_header = needs_csv_header("compression_benchmark.csv");
+  for (auto const & corpus : corpora) {
+    for (auto const & format : options.formats) {
+      auto const levels = options.levels.empty() ? default_levels(format) : options.levels;
+      auto const threads = options.threads.empty() ? default_threads(format) : options.threads;
+      for (auto const mode : options.modes) {
+        for (auto const level : levels) {
+          // Worker threads only compress files.
+          auto const mode_threads = mode == rosbag2_compression::CompressionMode::FILE ?
+            threads : std::vector<uint64_t>{0};
+          for (auto const worker_threads : mode_threads) {
+            CompressionBenchmarkOptions benchmark_options;
+            benchmark_options.compression_format = format;
+            benchmark_options.compression_mode = mode;
+            benchmark_options.compression_level = level;
+            benchmark_options.compression_worker_threads = worker_threads;
+            try {
+              for (unsigned int i = 0; i < options.repetitions; ++i) {
+                run_benchmark(corpus, benchmark_options, with_header);
+                with_header = false;
+              }
+            } catch (std::exception const & e) {
+              // E.g. a level given for all formats which one of them does not support.
+              std::cerr << "Skipping " << benchmark_options.description() << ": " << e.what() <<
+                std::endl;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -14,18 +14,21 @@
  *  limitations under the License.
  */
 
-#include "writer/sqlite/separate_topic_table_sqlite_writer.h"
-#include "benchmark/writer/sqlite/sqlite_writer_benchmark.h"
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "benchmark/writer/storage/storage_writer_benchmark.h"
 #include "generators/message_generator.h"
 #include "profiler/profiler.h"
-#include "writer/sqlite/one_table_sqlite_writer.h"
+#include "writer/storage/storage_writer.h"
 
 using namespace ros2bag;
 
 void run_benchmark(
   std::string const & description,
-  std::shared_ptr<MessageWriter> writer,
-  std::string const & db_name,
+  std::shared_ptr<StorageWriter> writer,
+  std::string const & bag_name,
   unsigned int loop_count,
   unsigned int number_of_small_messages,
   unsigned int small_message_blob_size,
@@ -59,23 +62,22 @@ void run_benchmark(
     specification.emplace_back("topic/big/" + std::to_string(i), big_message_blob_size);
   }
 
-  SqliteWriterBenchmark benchmark(
+  StorageWriterBenchmark benchmark(
     std::make_unique<MessageGenerator>(loop_count, specification),
     std::move(writer),
-    std::make_unique<Profiler>(meta_data, db_name));
+    std::make_unique<Profiler>(meta_data, bag_name));
 
-  std::remove(db_name.c_str());
   benchmark.run();
-  std::remove(db_name.c_str());
 
   write_csv_file("mixed_messages_benchmark.csv", benchmark, with_header);
+  write_json_file("mixed_messages_benchmark.jsonl", benchmark, with_header);
 }
 
 void run_benchmark_repeatedly(
   unsigned int times,
   std::string const & description,
-  std::shared_ptr<MessageWriter> writer,
-  std::string const & db_name,
+  std::shared_ptr<StorageWriter> writer,
+  std::string const & bag_name,
   unsigned int loop_count,
   unsigned int number_of_small_messages,
   unsigned int small_message_blob_size,
@@ -90,7 +92,7 @@ void run_benchmark_repeatedly(
     run_benchmark(
       description,
       writer,
-      db_name,
+      bag_name,
       loop_count,
       number_of_small_messages,
       small_message_blob_size,
@@ -111,11 +113,17 @@ int main(int argc, char ** argv)
    * Stream:
    * *
    */
-  std::string db_name = "mixed_messages_benchmark.db";
-  unsigned int const transaction_size = 10000;
-
+  StorageBenchmarkOptions options;
+  try {
+    options = parse_storage_benchmark_options(argc, argv);
+  } catch (std::invalid_argument const & e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
 
-  auto const write_header = true;
+  std::string bag_name = "mixed_messages_benchmark";
+  // Messages written to the storage at once, like the cache of the rosbag2 writer.
+  unsigned int const transaction_size = 10000;
 
   auto const small_messages = 1000;
   auto const small_message_blob_size = 10;
@@ -128,49 +136,20 @@ int main(int argc, char ** argv)
 
   auto const loop_count = 300; // gives roughly 10GB
 
-
-
   run_benchmark_repeatedly(3,
-    "OneTableSqlite",
-    std::make_shared<OneTableSqliteWriter>(
-      db_name,
-      transaction_size,
-      Indices({{"MESSAGES", "TIMESTAMP"},
-               {"MESSAGES", "TOPIC"}}),
-      // Setting to "journal_mode" to "OFF" increases writing speed, but turns off transactions.
-      Pragmas({{"journal_mode", "MEMORY"},
-               {"synchronous",  "OFF"}})
-    ),
-    db_name,
-    loop_count,
-    small_messages,
-    small_message_blob_size,
-    medium_messages,
-    medium_message_blob_size,
-    big_messages,
-    big_message_blob_size, transaction_size, write_header);
-
-  run_benchmark_repeatedly(5,
-    "SeparateTopicTableSqlite",
-    std::make_shared<SeparateTopicTableSqliteWriter>(
-      db_name,
-      transaction_size,
-      Indices({{"MESSAGES", "TIMESTAMP"},
-               {"MESSAGES", "TOPIC_ID"},
-               {"TOPICS",   "TOPIC"}}),
-      // Setting to "journal_mode" to "OFF" increases writing speed, but turns off transactions.
-      Pragmas({{"foreign_keys", "ON"},
-               {"journal_mode", "MEMORY"},
-               {"synchronous",  "OFF"}})
-    ),
-    db_name,
+    options.description(),
+    std::make_shared<StorageWriter>(
+      bag_name, options.storage_id, options.storage_config, transaction_size),
+    bag_name,
     loop_count,
     small_messages,
     small_message_blob_size,
     medium_messages,
     medium_message_blob_size,
     big_messages,
-    big_message_blob_size, transaction_size, write_header);
+    big_message_blob_size,
+    transaction_size,
+    needs_csv_header("mixed_messages_benchmark.csv"));
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,138 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "benchmark/reader/storage/storage_reader_benchmark.h"
+#include "benchmark/writer/storage/storage_writer_benchmark.h"
+#include "generators/message_generator.h"
+#include "profiler/profiler.h"
+#include "reader/storage/storage_reader.h"
+#include "writer/storage/storage_writer.h"
+
+using namespace ros2bag;
+
+void write_bag(
+  StorageWriter & writer,
+  unsigned int loop_count,
+  MessageGenerator::Specification const & specification)
+{
+  MessageGenerator generator(loop_count, specification);
+  writer.open();
+  while (generator.has_next()) {
+    writer.write(generator.next());
+  }
+  writer.create_index();
+  writer.close();
+}
+
+void run_benchmark(
+  std::string const & description,
+  std::shared_ptr<StorageReader> reader,
+  std::string const & bag_file,
+  ReadScenario scenario,
+  bool cold_page_cache,
+  std::string const & filtered_topic,
+  unsigned int random_access_count,
+  bool with_header = false)
+{
+  std::vector<std::pair<std::string, std::string>> meta_data = {
+    {"description",         description},
+    {"scenario",            to_string(scenario)},
+    {"page cache",          cold_page_cache ? "cold" : "warm"},
+    {"number of messages",  std::to_string(reader->message_count())},
+    {"random accesses",     std::to_string(
+        scenario == ReadScenario::RANDOM_ACCESS ? random_access_count : 0)}
+  };
+
+  StorageReaderBenchmark benchmark(
+    std::move(reader),
+    scenario,
+    cold_page_cache,
+    filtered_topic,
+    random_access_count,
+    std::make_unique<Profiler>(meta_data, bag_file));
+
+  benchmark.run();
+
+  write_csv_file("read_benchmark.csv", benchmark, with_header);
+  write_json_file("read_benchmark.jsonl", benchmark, with_header);
+}
+
+int main(int argc, char ** argv)
+{
+  /**
+   * Writes a bag of about 1.1 GB with 10 topics of 1000 byte messages and one topic of 100 KB
+   * messages, and reads it in every scenario, with a cold and a warm page cache.
+   */
+  StorageBenchmarkOptions options;
+  try {
+    options = parse_storage_benchmark_options(argc, argv);
+  } catch (std::invalid_argument const & e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string bag_name = "read_benchmark";
+  unsigned int const transaction_size = 1000;
+  unsigned int const loop_count = 10000;
+  unsigned int const random_access_count = 1000;
+  std::string const filtered_topic = "topic/small/0";
+
+  MessageGenerator::Specification specification;
+  for (auto i = 0; i < 10; ++i) {
+    specification.emplace_back("topic/small/" + std::to_string(i), 1000);
+  }
+  specification.emplace_back("topic/big/0", 100000);
+
+  StorageWriter writer(bag_name, options.storage_id, options.storage_config, transaction_size);
+  write_bag(writer, loop_count, specification);
+  auto const bag_file = writer.file_path();
+  // Storages which keep their files in memory cannot be read with a cold page cache.
+  bool const is_on_disk = std::ifstream(bag_file).good();
+
+  auto reader = std::make_shared<StorageReader>(bag_file, options.storage_id);
+  reader->open();
+  reader->close();
+
+  bool with_header = needs_csv_header("read_benchmark.csv");
+  for (auto const scenario : {ReadScenario::FULL_SCAN, ReadScenario::TOPIC_FILTER,
+      ReadScenario::TIME_RANGE, ReadScenario::RANDOM_ACCESS})
+  {
+    for (bool const cold_page_cache : {true, false}) {
+      if (cold_page_cache && !is_on_disk) {
+        continue;
+      }
+      for (int i = 0; i < 3; ++i) {
+        run_benchmark(
+          options.description(),
+          reader,
+          bag_file,
+          scenario,
+          cold_page_cache,
+          filtered_topic,
+          random_access_count,
+          with_header);
+        with_header = false;
+      }
+    }
+  }
+
+  reader.reset();
+  writer.reset();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmark/reader/storage/storage_reader_benchmark.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+using namespace ros2bag;
+
+std::string ros2bag::to_string(ReadScenario scenario)
+{
+  switch (scenario) {
+    case ReadScenario::FULL_SCAN:
+      return "full scan";
+    case ReadScenario::TOPIC_FILTER:
+      return "topic filter";
+    case ReadScenario::TIME_RANGE:
+      return "time range";
+    case ReadScenario::RANDOM_ACCESS:
+      return "random access";
+  }
+  return "unknown";
+}
+
+void StorageReaderBenchmark::run() const
+{
+  if (cold_page_cache_) {
+    reader_->evict_from_page_cache();
+  } else {
+    reader_->load_into_page_cache();
+  }
+
+  profiler_->take_time_for("start opening time");
+  reader_->open();
+  profiler_->take_time_for("start reading time");
+  auto const read_start = std::chrono::steady_clock::now();
+
+  uint64_t message_count = 0;
+  uint64_t byte_count = 0;
+  if (scenario_ == ReadScenario::RANDOM_ACCESS) {
+    // The same time stamps are accessed in every run.
+    std::mt19937_64 random_engine(42);
+    std::uniform_int_distribution<int64_t> random_offset(0, reader_->duration().count());
+    LatencyHistogram & access_latency = profiler_->latency_histogram("random access");
+    for (unsigned int i = 0; i < random_access_count_; ++i) {
+      auto const access_start = std::chrono::steady_clock::now();
+      reader_->seek(reader_->starting_time() + std::chrono::duration_cast<
+          Message::Timestamp::duration>(std::chrono::nanoseconds(random_offset(random_engine))));
+      if (reader_->has_next()) {
+        byte_count += reader_->read_next();
+        ++message_count;
+      }
+      access_latency.record(std::chrono::steady_clock::now() - access_start);
+    }
+  } else {
+    if (scenario_ == ReadScenario::TOPIC_FILTER) {
+      reader_->set_topic_filter({filtered_topic_});
+    } else if (scenario_ == ReadScenario::TIME_RANGE) {
+      auto const tenth = std::chrono::duration_cast<Message::Timestamp::duration>(
+        reader_->duration() / 10);
+      auto const start = reader_->starting_time() + tenth * 9 / 2;
+      reader_->set_time_range(start, start + tenth);
+    }
+    LatencyHistogram & read_latency = profiler_->latency_histogram("read");
+    while (reader_->has_next()) {
+      auto const message_start = std::chrono::steady_clock::now();
+      byte_count += reader_->read_next();
+      read_latency.record(std::chrono::steady_clock::now() - message_start);
+      ++message_count;
+    }
+  }
+
+  auto const read_seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - read_start).count();
+  profiler_->take_time_for("end reading time");
+  reader_->close();
+
+  profiler_->track_result("messages read", std::to_string(message_count));
+  profiler_->track_result("bytes read", std::to_string(byte_count));
+  profiler_->track_result(
+    "read throughput (MB/s)",
+    std::to_string(read_seconds > 0 ? static_cast<double>(byte_count) / 1e6 / read_seconds : 0));
+  profiler_->track_result(
+    "read throughput (messages/s)",
+    std::to_string(read_seconds > 0 ? static_cast<double>(message_count) / read_seconds : 0));
+  profiler_->track_disk_usage();
+  profiler_->track_memory_usage();
+}
+
+void StorageReaderBenchmark::write_csv(std::ostream & out_stream, bool with_header) const
+{
+  if (with_header) {
+    out_stream << profiler_->csv_header() << std::endl;
+  }
+  out_stream << profiler_->csv_entry() << std::endl;
+}
+
+void StorageReaderBenchmark::write_json(std::ostream & out_stream) const
+{
+  out_stream << profiler_->json_entry() << std::endl;
+}
@@ -0,0 +1,84 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_STORAGE_READER_BENCHMARK_H
+#define ROS2_ROSBAG_EVALUATION_STORAGE_READER_BENCHMARK_H
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "profiler/profiler.h"
+#include "reader/storage/storage_reader.h"
+
+namespace ros2bag
+{
+
+enum class ReadScenario
+{
+  // Reads all messages, like playing a whole bag.
+  FULL_SCAN,
+  // Reads the messages of a single topic.
+  TOPIC_FILTER,
+  // Reads the messages of the middle tenth of the bag, seeking to its start.
+  TIME_RANGE,
+  // Seeks to random time stamps and reads a single message at each of them.
+  RANDOM_ACCESS
+};
+
+std::string to_string(ReadScenario scenario);
+
+/**
+ * Measures reading a file written before with a rosbag2 storage plugin, reporting the
+ * throughput in MB/s and messages/s. With a cold page cache, the file is dropped from the page
+ * cache before reading, otherwise it is read once before.
+ */
+class StorageReaderBenchmark : public Benchmark
+{
+public:
+  StorageReaderBenchmark(
+    std::shared_ptr<StorageReader> reader,
+    ReadScenario scenario,
+    bool cold_page_cache,
+    std::string const & filtered_topic,
+    unsigned int random_access_count,
+    std::unique_ptr<Profiler> profiler)
+    : reader_(std::move(reader))
+    , scenario_(scenario)
+    , cold_page_cache_(cold_page_cache)
+    , filtered_topic_(filtered_topic)
+    , random_access_count_(random_access_count)
+    , profiler_(std::move(profiler))
+  {}
+
+  ~StorageReaderBenchmark() override = default;
+
+  void run() const override;
+
+  void write_csv(std::ostream & out_stream, bool with_header) const override;
+
+  void write_json(std::ostream & out_stream) const override;
+
+private:
+  std::shared_ptr<StorageReader> reader_;
+  ReadScenario const scenario_;
+  bool const cold_page_cache_;
+  std::string const filtered_topic_;
+  unsigned int const random_access_count_;
+  std::unique_ptr<Profiler> profiler_;
+};
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_STORAGE_READER_BENCHMARK_H
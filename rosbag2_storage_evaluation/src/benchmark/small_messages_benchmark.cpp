@@ -14,19 +14,21 @@
  *  limitations under the License.
  */
 
-#include "writer/sqlite/separate_topic_table_sqlite_writer.h"
+#include <iostream>
+#include <stdexcept>
 #include <utility>
-#include "benchmark/writer/sqlite/sqlite_writer_benchmark.h"
+
+#include "benchmark/writer/storage/storage_writer_benchmark.h"
 #include "generators/message_generator.h"
 #include "profiler/profiler.h"
-#include "writer/sqlite/one_table_sqlite_writer.h"
+#include "writer/storage/storage_writer.h"
 
 using namespace ros2bag;
 
 void run_benchmark(
   std::string const & description,
-  std::shared_ptr<MessageWriter> writer,
-  std::string const & db_name,
+  std::shared_ptr<StorageWriter> writer,
+  std::string const & bag_name,
   unsigned int number_of_messages,
   unsigned int message_blob_size,
   unsigned int transaction_size,
@@ -41,23 +43,22 @@ void run_benchmark(
 
   MessageGenerator::Specification specification = {std::make_tuple("topic", message_blob_size)};
 
-  SqliteWriterBenchmark benchmark(
+  StorageWriterBenchmark benchmark(
     std::make_unique<MessageGenerator>(number_of_messages, specification),
     std::move(writer),
-    std::make_unique<Profiler>(meta_data, db_name));
+    std::make_unique<Profiler>(meta_data, bag_name));
 
-  std::remove(db_name.c_str());
   benchmark.run();
-  std::remove(db_name.c_str());
 
   write_csv_file("small_messages_benchmark.csv", benchmark, with_header);
+  write_json_file("small_messages_benchmark.jsonl", benchmark, with_header);
 }
 
 void run_benchmark_repeatedly(
   unsigned int times,
   std::string const & description,
-  std::shared_ptr<MessageWriter> writer,
-  std::string const & db_name,
+  std::shared_ptr<StorageWriter> writer,
+  std::string const & bag_name,
   unsigned int number_of_messages,
   unsigned int message_blob_size,
   unsigned int transaction_size,
@@ -67,7 +68,7 @@ void run_benchmark_repeatedly(
     run_benchmark(
       description,
       writer,
-      db_name,
+      bag_name,
       number_of_messages,
       message_blob_size,
       transaction_size,
@@ -81,46 +82,29 @@ int main(int argc, char ** argv)
   /**
    * We write a total of 1GB to the Bagfile
    */
-  std::string db_name = "small_messages_writer_benchmark.db";
+  StorageBenchmarkOptions options;
+  try {
+    options = parse_storage_benchmark_options(argc, argv);
+  } catch (std::invalid_argument const & e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string bag_name = "small_messages_benchmark";
   unsigned int msg_size_bytes = 10;
   unsigned int msg_count = 100000000;
+  // Messages written to the storage at once, like the cache of the rosbag2 writer.
   unsigned int transaction_size = 10000;
 
-  auto const write_header = true;
-
-  run_benchmark_repeatedly(5,
-    "OneTableSqlite",
-    std::make_shared<OneTableSqliteWriter>(
-      db_name,
-      transaction_size,
-      Indices({{"MESSAGES", "TIMESTAMP"},
-               {"MESSAGES", "TOPIC"}}),
-      // Setting to "journal_mode" to "OFF" increases writing speed, but turns off transactions.
-      Pragmas({{"journal_mode", "MEMORY"},
-               {"synchronous",  "OFF"}})
-    ),
-    db_name,
-    msg_count,
-    msg_size_bytes,
-    transaction_size, write_header);
-
   run_benchmark_repeatedly(5,
-    "SeparateTopicTableSqlite",
-    std::make_shared<SeparateTopicTableSqliteWriter>(
-      db_name,
-      transaction_size,
-      Indices({{"MESSAGES", "TIMESTAMP"},
-               {"MESSAGES", "TOPIC_ID"},
-               {"TOPICS",   "TOPIC"}}),
-      // Setting to "journal_mode" to "OFF" increases writing speed, but turns off transactions.
-      Pragmas({{"foreign_keys", "ON"},
-               {"journal_mode", "MEMORY"},
-               {"synchronous",  "OFF"}})
-    ),
-    db_name,
+    options.description(),
+    std::make_shared<StorageWriter>(
+      bag_name, options.storage_id, options.storage_config, transaction_size),
+    bag_name,
     msg_count,
     msg_size_bytes,
-    transaction_size);
+    transaction_size,
+    needs_csv_header("small_messages_benchmark.csv"));
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2020,  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <iostream>
+#include <utility>
+
+#include "benchmark/writer/storage/storage_writer_benchmark.h"
+#include "generators/message_generator.h"
+#include "profiler/profiler.h"
+#include "writer/storage/storage_writer.h"
+
+using namespace ros2bag;
+
+void run_benchmark(
+  std::string const & description,
+  std::shared_ptr<StorageWriter> writer,
+  std::string const & bag_name,
+  unsigned int number_of_messages,
+  unsigned int message_blob_size,
+  unsigned int transaction_size,
+  bool with_header = false)
+{
+  std::vector<std::pair<std::string, std::string>> meta_data = {
+    {"description",               description},
+    {"number of messages",        std::to_string(number_of_messages)},
+    {"message blob size (bytes)", std::to_string(message_blob_size)},
+    {"transaction size",          std::to_string(transaction_size)}
+  };
+
+  MessageGenerator::Specification specification = {std::make_tuple("topic", message_blob_size)};
+
+  StorageWriterBenchmark benchmark(
+    std::make_unique<MessageGenerator>(number_of_messages, specification),
+    std::move(writer),
+    std::make_unique<Profiler>(meta_data, bag_name));
+
+  benchmark.run();
+
+  write_csv_file("storage_preset_benchmark.csv", benchmark, with_header);
+  write_json_file("storage_preset_benchmark.jsonl", benchmark, with_header);
+}
+
+int main(int argc, char ** argv)
+{
+  /**
+   * Compares the preset profiles of a storage plugin, by default those of the sqlite3
+   * storage plugin (see SqliteStorage::open). We write about 1GB to the Bagfile.
+   * Usage: storage_preset_benchmark [<storage id> [<storage preset profile>...]]
+   */
+  std::string storage_id = argc > 1 ? argv[1] : "sqlite3";
+  std::vector<std::string> presets = {"", "resilient", "max_throughput"};
+  if (argc > 2) {
+    presets.assign(argv + 2, argv + argc);
+  }
+
+  std::string bag_name = "storage_preset_benchmark";
+  unsigned int msg_size_bytes = 1000;
+  unsigned int msg_count = 1000000;
+  unsigned int transaction_size = 1000;
+
+  bool with_header = needs_csv_header("storage_preset_benchmark.csv");
+  for (auto const & preset : presets) {
+    StorageBenchmarkOptions options;
+    options.storage_id = storage_id;
+    options.storage_config.preset_profile = preset;
+    auto writer = std::make_shared<StorageWriter>(
+      bag_name, options.storage_id, options.storage_config, transaction_size);
+    for (int i = 0; i < 5; ++i) {
+      run_benchmark(
+        options.description(),
+        writer,
+        bag_name,
+        msg_count,
+        msg_size_bytes,
+        transaction_size,
+        with_header);
+      with_header = false;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -16,7 +16,9 @@
 
 #include "benchmark/writer/sqlite/sqlite_writer_benchmark.h"
 
+#include <chrono>
 #include <fstream>
+#include <utility>
 
 #include "writer/sqlite/one_table_sqlite_writer.h"
 
@@ -33,8 +35,12 @@ void SqliteWriterBenchmark::run() const
     "write_throughput", generator_->total_msg_count());
 
   writer_->open();
+  LatencyHistogram & write_latency = profiler_->latency_histogram("write");
   while (generator_->has_next()) {
-    writer_->write(generator_->next());
+    auto message = generator_->next();
+    auto const write_start = std::chrono::steady_clock::now();
+    writer_->write(std::move(message));
+    write_latency.record(std::chrono::steady_clock::now() - write_start);
     throughput_tick();
   }
 
@@ -47,6 +53,7 @@ void SqliteWriterBenchmark::run() const
 
   profiler_->take_time_for("end indexing time");
   profiler_->track_disk_usage();
+  profiler_->track_memory_usage();
 }
 
 void SqliteWriterBenchmark::write_csv(std::ostream & out_stream, bool with_header) const
@@ -56,3 +63,8 @@ void SqliteWriterBenchmark::write_csv(std::ostream & out_stream, bool with_heade
   }
   out_stream << profiler_->csv_entry() << std::endl;
 }
+
+void SqliteWriterBenchmark::write_json(std::ostream & out_stream) const
+{
+  out_stream << profiler_->json_entry() << std::endl;
+}
@@ -44,6 +44,7 @@ int main(int argc, char ** argv)
   benchmark.run();
 
   write_csv_file("sqlite3_writer_benchmark.csv", benchmark, true);
+  write_json_file("sqlite3_writer_benchmark.jsonl", benchmark, true);
 
   return EXIT_SUCCESS;
 }
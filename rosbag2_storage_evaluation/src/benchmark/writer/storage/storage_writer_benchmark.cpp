@@ -0,0 +1,98 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmark/writer/storage/storage_writer_benchmark.h"
+
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace ros2bag;
+
+void StorageWriterBenchmark::run() const
+{
+  generator_->reset();
+  writer_->reset();
+
+  profiler_->take_time_for("start writing time");
+
+  Profiler::TickProgress throughput_tick = profiler_->measure_progress(
+    "write_throughput", generator_->total_msg_count());
+
+  writer_->open();
+  LatencyHistogram & write_latency = profiler_->latency_histogram("write");
+  while (generator_->has_next()) {
+    auto message = generator_->next();
+    auto const write_start = std::chrono::steady_clock::now();
+    writer_->write(std::move(message));
+    write_latency.record(std::chrono::steady_clock::now() - write_start);
+    throughput_tick();
+  }
+  writer_->create_index();
+
+  profiler_->take_time_for("end writing time");
+
+  profiler_->take_time_for("start indexing time");
+
+  writer_->close();
+
+  profiler_->take_time_for("end indexing time");
+  profiler_->track_disk_usage(static_cast<long>(writer_->bagfile_size()));
+  profiler_->track_memory_usage();
+
+  writer_->reset();
+}
+
+void StorageWriterBenchmark::write_csv(std::ostream & out_stream, bool with_header) const
+{
+  if (with_header) {
+    out_stream << profiler_->csv_header() << std::endl;
+  }
+  out_stream << profiler_->csv_entry() << std::endl;
+}
+
+void StorageWriterBenchmark::write_json(std::ostream & out_stream) const
+{
+  out_stream << profiler_->json_entry() << std::endl;
+}
+
+std::string StorageBenchmarkOptions::description() const
+{
+  if (storage_config.preset_profile.empty()) {
+    return storage_id;
+  }
+  return storage_id + "/" + storage_config.preset_profile;
+}
+
+StorageBenchmarkOptions ros2bag::parse_storage_benchmark_options(int argc, char ** argv)
+{
+  if (argc > 3) {
+    throw std::invalid_argument(
+      std::string("Usage: ") + argv[0] + " [<storage id> [<storage preset profile>]]");
+  }
+  StorageBenchmarkOptions options;
+  if (argc > 1) {
+    options.storage_id = argv[1];
+  }
+  if (argc > 2) {
+    options.storage_config.preset_profile = argv[2];
+  }
+  return options;
+}
+
+bool ros2bag::needs_csv_header(std::string const & file_name)
+{
+  return !std::ifstream(file_name).good();
+}
@@ -0,0 +1,77 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_STORAGE_WRITER_BENCHMARK_H
+#define ROS2_ROSBAG_EVALUATION_STORAGE_WRITER_BENCHMARK_H
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "generators/message_generator.h"
+#include "profiler/profiler.h"
+#include "rosbag2_storage/storage_config.hpp"
+#include "writer/storage/storage_writer.h"
+
+namespace ros2bag
+{
+
+/**
+ * Measures writing the generated messages with a rosbag2 storage plugin. The indexing time is
+ * the time to close the storage, which builds the indices and flushes the file.
+ */
+class StorageWriterBenchmark : public Benchmark
+{
+public:
+  StorageWriterBenchmark(
+    std::unique_ptr<MessageGenerator> generator,
+    std::shared_ptr<StorageWriter> writer,
+    std::unique_ptr<Profiler> profiler)
+    : generator_(std::move(generator)), writer_(std::move(writer)), profiler_(std::move(profiler))
+  {}
+
+  ~StorageWriterBenchmark() override = default;
+
+  void run() const override;
+
+  void write_csv(std::ostream & out_stream, bool with_header) const override;
+
+  void write_json(std::ostream & out_stream) const override;
+
+private:
+  std::unique_ptr<MessageGenerator> generator_;
+  std::shared_ptr<StorageWriter> writer_;
+  std::unique_ptr<Profiler> profiler_;
+};
+
+/// Storage and settings of a benchmark, given on the command line as
+/// `[<storage id> [<storage preset profile>]]`, by default the sqlite3 storage.
+struct StorageBenchmarkOptions
+{
+  std::string storage_id = "sqlite3";
+  rosbag2_storage::StorageConfig storage_config;
+
+  /// Name of the storage and its preset profile, the description of the benchmark in the CSV.
+  std::string description() const;
+};
+
+/// \throws std::invalid_argument if there are too many arguments.
+StorageBenchmarkOptions parse_storage_benchmark_options(int argc, char ** argv);
+
+/// Whether the CSV file does not exist yet, so runs of several storages are written to one file.
+bool needs_csv_header(std::string const & file_name);
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_STORAGE_WRITER_BENCHMARK_H
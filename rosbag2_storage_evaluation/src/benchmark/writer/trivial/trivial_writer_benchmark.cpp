@@ -17,7 +17,9 @@
 #include "trivial_writer_benchmark.h"
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <utility>
 
 #include "writer/stream/message_stream_writer.h"
 
@@ -34,14 +36,19 @@ void TrivialWriterBenchmark::run() const
   profiler_->take_time_for("started writing messages");
 
   writer_->open();
+  LatencyHistogram & write_latency = profiler_->latency_histogram("write");
   while (generator_->has_next()) {
-    writer_->write(generator_->next());
+    auto message = generator_->next();
+    auto const write_start = std::chrono::steady_clock::now();
+    writer_->write(std::move(message));
+    write_latency.record(std::chrono::steady_clock::now() - write_start);
     throughput_tick();
   }
   writer_->close();
 
   profiler_->take_time_for("finished writing messages");
   profiler_->track_disk_usage();
+  profiler_->track_memory_usage();
 }
 
 void TrivialWriterBenchmark::write_csv(std::ostream & out_stream, bool with_header) const
@@ -52,6 +59,11 @@ void TrivialWriterBenchmark::write_csv(std::ostream & out_stream, bool with_head
   out_stream << profiler_->csv_entry() << std::endl;
 }
 
+void TrivialWriterBenchmark::write_json(std::ostream & out_stream) const
+{
+  out_stream << profiler_->json_entry() << std::endl;
+}
+
 int main(int argc, char ** argv)
 {
   if (argc != 4) {
@@ -76,6 +88,7 @@ int main(int argc, char ** argv)
   benchmark.run();
 
   write_csv_file("trivial_writer_benchmark.csv", benchmark, true);
+  write_json_file("trivial_writer_benchmark.jsonl", benchmark, true);
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,354 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "generators/payload_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+
+using namespace ros2bag;
+
+namespace
+{
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// Serializes messages as CDR in the byte order of the machine, like the rmw does.
+class CdrWriter
+{
+public:
+  CdrWriter()
+  {
+    uint16_t const probe = 1;
+    uint8_t little_endian = 0;
+    std::memcpy(&little_endian, &probe, 1);
+    data_ = {0, little_endian, 0, 0};
+  }
+
+  template<typename T>
+  void write(T value)
+  {
+    align(sizeof(T));
+    auto const offset = data_.size();
+    data_.resize(offset + sizeof(T));
+    std::memcpy(data_.data() + offset, &value, sizeof(T));
+  }
+
+  void write_string(std::string const & value)
+  {
+    write(static_cast<uint32_t>(value.size() + 1));
+    data_.insert(data_.end(), value.begin(), value.end());
+    data_.push_back(0);
+  }
+
+  void write_bytes(std::vector<uint8_t> const & bytes)
+  {
+    write(static_cast<uint32_t>(bytes.size()));
+    data_.insert(data_.end(), bytes.begin(), bytes.end());
+  }
+
+  void write_header(int64_t time_stamp, std::string const & frame_id)
+  {
+    write(static_cast<int32_t>(time_stamp / 1000000000));
+    write(static_cast<uint32_t>(time_stamp % 1000000000));
+    write_string(frame_id);
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> release(
+    std::string const & topic_name, int64_t time_stamp)
+  {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    message->topic_name = topic_name;
+    message->time_stamp = time_stamp;
+    message->serialized_data =
+      rosbag2_storage::make_serialized_message(data_.data(), data_.size());
+    return message;
+  }
+
+private:
+  // Alignment is relative to the end of the encapsulation header.
+  void align(size_t alignment)
+  {
+    while ((data_.size() - 4) % alignment != 0) {
+      data_.push_back(0);
+    }
+  }
+
+  std::vector<uint8_t> data_;
+};
+
+uint8_t to_byte(double value)
+{
+  return static_cast<uint8_t>(std::min(255.0, std::max(0.0, std::round(value))));
+}
+
+// A gradient with a few moving shapes, and the noise of a camera sensor.
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_image(
+  size_t frame, int64_t time_stamp, std::mt19937 & random)
+{
+  uint32_t const width = 640;
+  uint32_t const height = 480;
+  std::normal_distribution<double> noise(0.0, 2.0);
+  std::vector<uint8_t> pixels;
+  pixels.reserve(width * height * 3);
+  double const shift = static_cast<double>(frame) * 4.0;
+  for (uint32_t row = 0; row < height; ++row) {
+    for (uint32_t column = 0; column < width; ++column) {
+      double const x = column + shift;
+      bool const in_box = std::fmod(x, 200.0) < 60.0 && row > 180 && row < 320;
+      double const shade = in_box ? 40.0 : 0.0;
+      double const red = 90.0 + 0.2 * row + 30.0 * std::sin(x / 80.0) - shade;
+      pixels.push_back(to_byte(red + noise(random)));
+      pixels.push_back(to_byte(110.0 + 0.1 * column + shade + noise(random)));
+      pixels.push_back(to_byte(140.0 - 0.15 * row - shade + noise(random)));
+    }
+  }
+
+  CdrWriter cdr;
+  cdr.write_header(time_stamp, "camera");
+  cdr.write(height);
+  cdr.write(width);
+  cdr.write_string("rgb8");
+  cdr.write(static_cast<uint8_t>(0));
+  cdr.write(width * 3);
+  cdr.write_bytes(pixels);
+  return cdr.release("/camera/image_raw", time_stamp);
+}
+
+// A scan of the walls of a room, seen from a robot turning slowly.
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_point_cloud(
+  size_t scan, int64_t time_stamp, std::mt19937 & random)
+{
+  uint32_t const rings = 16;
+  uint32_t const azimuth_steps = 1800;
+  std::normal_distribution<float> range_noise(0.0f, 0.02f);
+  std::vector<uint8_t> points;
+  points.reserve(rings * azimuth_steps * 4 * sizeof(float));
+  auto const add_float = [&points](float value) {
+      uint8_t bytes[sizeof(float)];
+      std::memcpy(bytes, &value, sizeof(float));
+      points.insert(points.end(), bytes, bytes + sizeof(float));
+    };
+  double const heading = static_cast<double>(scan) * 0.01;
+  for (uint32_t step = 0; step < azimuth_steps; ++step) {
+    double const azimuth = 2.0 * kPi * step / azimuth_steps;
+    // Distance to the walls of a room of 12 by 8 meters around the sensor.
+    double const direction = azimuth + heading;
+    double const range = std::min(
+      6.0 / std::max(std::abs(std::cos(direction)), 1e-3),
+      4.0 / std::max(std::abs(std::sin(direction)), 1e-3));
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+      double const elevation = (-15.0 + 2.0 * ring) * kPi / 180.0;
+      float const distance = static_cast<float>(range / std::cos(elevation)) + range_noise(random);
+      add_float(static_cast<float>(distance * std::cos(elevation) * std::cos(azimuth)));
+      add_float(static_cast<float>(distance * std::cos(elevation) * std::sin(azimuth)));
+      add_float(static_cast<float>(distance * std::sin(elevation)));
+      add_float(static_cast<float>(std::round(100.0 / (1.0 + distance))));
+    }
+  }
+
+  CdrWriter cdr;
+  cdr.write_header(time_stamp, "lidar");
+  cdr.write(static_cast<uint32_t>(1));
+  cdr.write(rings * azimuth_steps);
+  std::vector<std::string> const fields = {"x", "y", "z", "intensity"};
+  cdr.write(static_cast<uint32_t>(fields.size()));
+  for (size_t field = 0; field < fields.size(); ++field) {
+    cdr.write_string(fields[field]);
+    cdr.write(static_cast<uint32_t>(field * sizeof(float)));
+    cdr.write(static_cast<uint8_t>(7));  // sensor_msgs/msg/PointField::FLOAT32
+    cdr.write(static_cast<uint32_t>(1));
+  }
+  cdr.write(static_cast<uint8_t>(0));
+  cdr.write(static_cast<uint32_t>(4 * sizeof(float)));
+  cdr.write(static_cast<uint32_t>(points.size()));
+  cdr.write_bytes(points);
+  cdr.write(static_cast<uint8_t>(1));
+  return cdr.release("/points", time_stamp);
+}
+
+// The transforms of the links of a robot arm moving slowly.
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_tf(
+  size_t update, int64_t time_stamp, std::mt19937 &)
+{
+  uint32_t const links = 30;
+  CdrWriter cdr;
+  cdr.write(links);
+  for (uint32_t link = 0; link < links; ++link) {
+    cdr.write_header(time_stamp, link == 0 ? "base_link" : "link_" + std::to_string(link - 1));
+    cdr.write_string("link_" + std::to_string(link));
+    double const angle = 0.3 * std::sin(static_cast<double>(update) * 0.01 + link);
+    cdr.write(0.1 * link);
+    cdr.write(0.0);
+    cdr.write(0.25);
+    cdr.write(0.0);
+    cdr.write(0.0);
+    cdr.write(std::sin(angle / 2.0));
+    cdr.write(std::cos(angle / 2.0));
+  }
+  return cdr.release("/tf", time_stamp);
+}
+
+// Log lines of a few nodes, formatted from templates like most log output.
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> make_log(
+  size_t line, int64_t time_stamp, std::mt19937 & random)
+{
+  std::vector<std::string> const nodes = {
+    "controller", "planner", "camera_driver", "localization"};
+  std::uniform_int_distribution<int> value(0, 9999);
+  auto const node = line % nodes.size();
+  std::string text;
+  switch (value(random) % 4) {
+    case 0:
+      text = "Received goal " + std::to_string(value(random)) + " with tolerance 0." +
+        std::to_string(value(random) % 100);
+      break;
+    case 1:
+      text = "Publishing frame " + std::to_string(line) + " after " +
+        std::to_string(value(random) % 50) + " ms";
+      break;
+    case 2:
+      text = "Pose estimate x=" + std::to_string(value(random) / 1000.0) + " y=" +
+        std::to_string(value(random) / 1000.0) + " covariance " + std::to_string(value(random));
+      break;
+    default:
+      text = "Control loop missed its deadline by " + std::to_string(value(random) % 200) + " us";
+      break;
+  }
+
+  CdrWriter cdr;
+  cdr.write(static_cast<int32_t>(time_stamp / 1000000000));
+  cdr.write(static_cast<uint32_t>(time_stamp % 1000000000));
+  cdr.write(static_cast<uint8_t>(value(random) % 8 == 0 ? 30 : 20));
+  cdr.write_string(nodes[node]);
+  cdr.write_string(text);
+  cdr.write_string("/opt/robot/src/" + nodes[node] + "/src/" + nodes[node] + "_node.cpp");
+  cdr.write_string("on_timer");
+  cdr.write(static_cast<uint32_t>(100 + 10 * node));
+  return cdr.release("/rosout", time_stamp);
+}
+
+}  // namespace
+
+uint64_t PayloadCorpus::size() const
+{
+  uint64_t size = 0;
+  for (auto const & message : messages) {
+    size += message->serialized_data->buffer_length;
+  }
+  return size;
+}
+
+std::vector<std::string> ros2bag::generated_corpus_names()
+{
+  return {"image", "point_cloud", "tf", "log"};
+}
+
+PayloadCorpus ros2bag::generate_corpus(std::string const & name, uint64_t size_bytes)
+{
+  using MakeMessage = std::shared_ptr<rosbag2_storage::SerializedBagMessage> (*)(
+    size_t, int64_t, std::mt19937 &);
+  MakeMessage make_message = nullptr;
+  int64_t period = 0;
+  PayloadCorpus corpus;
+  corpus.name = name;
+  if (name == "image") {
+    make_message = make_image;
+    period = 33333333;
+    corpus.topics = {{"/camera/image_raw", "sensor_msgs/msg/Image", "cdr", ""}};
+  } else if (name == "point_cloud") {
+    make_message = make_point_cloud;
+    period = 100000000;
+    corpus.topics = {{"/points", "sensor_msgs/msg/PointCloud2", "cdr", ""}};
+  } else if (name == "tf") {
+    make_message = make_tf;
+    period = 10000000;
+    corpus.topics = {{"/tf", "tf2_msgs/msg/TFMessage", "cdr", ""}};
+  } else if (name == "log") {
+    make_message = make_log;
+    period = 1000000;
+    corpus.topics = {{"/rosout", "rcl_interfaces/msg/Log", "cdr", ""}};
+  } else {
+    throw std::invalid_argument("Unknown corpus '" + name + "'.");
+  }
+
+  std::mt19937 random(42);
+  uint64_t size = 0;
+  for (size_t i = 0; size < size_bytes; ++i) {
+    corpus.messages.push_back(make_message(i, static_cast<int64_t>(i) * period, random));
+    size += corpus.messages.back()->serialized_data->buffer_length;
+  }
+  return corpus;
+}
+
+PayloadCorpus ros2bag::load_bag_corpus(std::string const & uri, uint64_t max_bytes)
+{
+  rosbag2_storage::MetadataIo metadata_io;
+  if (!metadata_io.metadata_file_exists(uri)) {
+    throw std::runtime_error("No bag metadata found in '" + uri + "'.");
+  }
+  auto const metadata = metadata_io.read_metadata(uri);
+  if (!metadata.compression_format.empty()) {
+    throw std::runtime_error("The bag '" + uri + "' is compressed already.");
+  }
+
+  PayloadCorpus corpus;
+  corpus.name = "bag";
+  rosbag2_storage::StorageFactory storage_factory;
+  uint64_t size = 0;
+  for (auto const & relative_file_path : metadata.relative_file_paths) {
+    if (size >= max_bytes) {
+      break;
+    }
+    // Bags before version 4 name their files relative to the parent directory.
+    auto const base_path = metadata.version < 4 ?
+      rcpputils::fs::path(uri).parent_path() : rcpputils::fs::path(uri);
+    auto const file_path = rcpputils::fs::path(relative_file_path).is_absolute() ?
+      rcpputils::fs::path(relative_file_path) : base_path / relative_file_path;
+    auto storage = storage_factory.open_read_only(
+      file_path.string(), metadata.storage_identifier);
+    if (!storage) {
+      throw std::runtime_error("Could not open '" + file_path.string() + "'.");
+    }
+    if (corpus.topics.empty()) {
+      corpus.topics = storage->get_all_topics_and_types();
+    }
+    while (size < max_bytes && storage->has_next()) {
+      auto const message = storage->read_next();
+      // The data is copied, as storages may hand out views which are only valid while open.
+      auto const & data = *message->serialized_data;
+      auto copy = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      copy->topic_name = message->topic_name;
+      copy->time_stamp = message->time_stamp;
+      copy->serialized_data = rosbag2_storage::make_serialized_message(
+        data.buffer, data.buffer_length);
+      size += data.buffer_length;
+      corpus.messages.push_back(std::move(copy));
+    }
+  }
+  if (corpus.messages.empty()) {
+    throw std::runtime_error("The bag '" + uri + "' has no messages.");
+  }
+  return corpus;
+}
@@ -0,0 +1,64 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_PAYLOAD_GENERATOR_H
+#define ROS2_ROSBAG_EVALUATION_PAYLOAD_GENERATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+namespace ros2bag
+{
+
+/// Serialized messages which are compressed together, like the messages of a bag.
+struct PayloadCorpus
+{
+  std::string name;
+  std::vector<rosbag2_storage::TopicMetadata> topics;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+
+  /// Size of the serialized data of all messages in bytes.
+  uint64_t size() const;
+};
+
+/**
+ * Names of the generated corpora, whose messages are serialized as CDR like recorded ones:
+ * "image" (640x480 rgb8 sensor_msgs/msg/Image frames of a smooth scene with sensor noise),
+ * "point_cloud" (sensor_msgs/msg/PointCloud2 scans of a 16 ring lidar in a room), "tf"
+ * (tf2_msgs/msg/TFMessage of a robot with 30 links) and "log" (rcl_interfaces/msg/Log lines
+ * of /rosout).
+ */
+std::vector<std::string> generated_corpus_names();
+
+/**
+ * Generates messages of the named corpus until they hold at least size_bytes bytes. The messages
+ * are the same for every run, so runs are comparable.
+ * \throws std::invalid_argument if the corpus is unknown.
+ */
+PayloadCorpus generate_corpus(std::string const & name, uint64_t size_bytes);
+
+/**
+ * Reads the messages of an uncompressed bag, up to max_bytes bytes, as a corpus of real data.
+ * \throws std::runtime_error if the bag cannot be read or is compressed.
+ */
+PayloadCorpus load_bag_corpus(std::string const & uri, uint64_t max_bytes);
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_PAYLOAD_GENERATOR_H
@@ -0,0 +1,102 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "profiler/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ros2bag;
+
+namespace
+{
+
+constexpr unsigned int kSubBucketBits = 7;
+constexpr uint64_t kExactValues = uint64_t{1} << kSubBucketBits;
+constexpr uint64_t kSubBucketsPerPower = kExactValues / 2;
+constexpr size_t kBucketCount = (64 - kSubBucketBits + 2) * kSubBucketsPerPower;
+
+unsigned int most_significant_bit(uint64_t value)
+{
+#if defined(__GNUC__)
+  return 63 - static_cast<unsigned int>(__builtin_clzll(value));
+#else
+  unsigned int bit = 0;
+  while (value >>= 1) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+// Values of [2^m, 2^(m+1)) share the bucket of their 7 most significant bits.
+size_t bucket_index(uint64_t value)
+{
+  if (value < kExactValues) {
+    return static_cast<size_t>(value);
+  }
+  unsigned int shift = most_significant_bit(value) - kSubBucketBits + 1;
+  return static_cast<size_t>(shift * kSubBucketsPerPower + (value >> shift));
+}
+
+uint64_t highest_value_of_bucket(size_t index)
+{
+  if (index < kExactValues) {
+    return index;
+  }
+  uint64_t shift = index / kSubBucketsPerPower - 1;
+  uint64_t sub_bucket = index - shift * kSubBucketsPerPower;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+: buckets_(kBucketCount, 0), count_(0), max_(0)
+{}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+  auto value = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(latency.count(), 0));
+  ++buckets_[bucket_index(value)];
+  ++count_;
+  max_ = std::max(max_, value);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+  return count_;
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double percentage) const
+{
+  if (count_ == 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(percentage / 100 * static_cast<double>(count_)));
+  rank = std::min(std::max<uint64_t>(rank, 1), count_);
+  uint64_t counted = 0;
+  for (size_t index = 0; index < buckets_.size(); ++index) {
+    counted += buckets_[index];
+    if (counted >= rank) {
+      return std::chrono::nanoseconds(std::min(highest_value_of_bucket(index), max_));
+    }
+  }
+  return max();
+}
+
+std::chrono::nanoseconds LatencyHistogram::max() const
+{
+  return std::chrono::nanoseconds(max_);
+}
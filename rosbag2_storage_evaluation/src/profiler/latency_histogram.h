@@ -0,0 +1,53 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_LATENCY_HISTOGRAM_H
+#define ROS2_ROSBAG_EVALUATION_LATENCY_HISTOGRAM_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace ros2bag
+{
+
+/**
+ * Histogram of the latencies of an operation, e.g. of writing one message. Latencies below
+ * 128 ns are counted exactly, larger ones in 64 buckets per power of two, so the percentiles
+ * are overestimated by less than 1.6% while the memory used does not grow with the number of
+ * latencies recorded.
+ */
+class LatencyHistogram
+{
+public:
+  LatencyHistogram();
+
+  void record(std::chrono::nanoseconds latency);
+
+  uint64_t count() const;
+
+  /// Latency which the given percentage of the recorded latencies does not exceed, 0 if empty.
+  std::chrono::nanoseconds percentile(double percentage) const;
+
+  std::chrono::nanoseconds max() const;
+
+private:
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t max_;
+};
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_LATENCY_HISTOGRAM_H
@@ -0,0 +1,138 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "profiler/memory_usage.h"
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <string>
+
+namespace
+{
+
+std::atomic<uint64_t> allocations {0};
+std::atomic<uint64_t> allocated_bytes {0};
+
+void * counted_allocation(std::size_t size) noexcept
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void * counted_allocation_or_throw(std::size_t size)
+{
+  void * pointer = counted_allocation(size);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+}  // namespace
+
+// Replacing the global allocation functions counts the allocations of the whole process,
+// including those of the storage plugins.
+void * operator new(std::size_t size)
+{
+  return counted_allocation_or_throw(size);
+}
+
+void * operator new[](std::size_t size)
+{
+  return counted_allocation_or_throw(size);
+}
+
+void * operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+  return counted_allocation(size);
+}
+
+void * operator new[](std::size_t size, std::nothrow_t const &) noexcept
+{
+  return counted_allocation(size);
+}
+
+void operator delete(void * pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void * pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void * pointer, std::nothrow_t const &) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void * pointer, std::nothrow_t const &) noexcept
+{
+  std::free(pointer);
+}
+
+ros2bag::AllocationCounters ros2bag::allocation_counters()
+{
+  return {
+    allocations.load(std::memory_order_relaxed), allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+long ros2bag::peak_resident_set_size()
+{
+#ifdef __linux__
+  // Unlike getrusage, VmHWM is reset by reset_peak_resident_set_size.
+  std::ifstream status("/proc/self/status");
+  std::string key;
+  while (status >> key) {
+    if (key == "VmHWM:") {
+      long kilobytes = 0;
+      status >> kilobytes;
+      return kilobytes * 1024;
+    }
+    status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+#endif
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024;
+#endif
+}
+
+void ros2bag::reset_peak_resident_set_size()
+{
+#ifdef __linux__
+  // Writing 5 resets the peak resident set size to the current one, since Linux 4.0.
+  std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
@@ -0,0 +1,43 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_MEMORY_USAGE_H
+#define ROS2_ROSBAG_EVALUATION_MEMORY_USAGE_H
+
+#include <cstdint>
+
+namespace ros2bag
+{
+
+struct AllocationCounters
+{
+  uint64_t allocations;
+  uint64_t allocated_bytes;
+};
+
+/**
+ * Counters of the allocations with operator new since the start of the process, in all threads.
+ * Allocations with malloc, e.g. by SQLite, are not counted.
+ */
+AllocationCounters allocation_counters();
+
+/// Peak resident set size of the process in bytes, since the start or the last reset.
+long peak_resident_set_size();
+
+/// Starts measuring the peak resident set size anew, where supported (Linux).
+void reset_peak_resident_set_size();
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_MEMORY_USAGE_H
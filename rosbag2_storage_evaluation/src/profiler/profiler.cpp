@@ -16,12 +16,54 @@
 
 #include "profiler/profiler.h"
 
+#include <cctype>
+#include <cstdlib>
 #include <fstream>
+#include <iomanip>
 #include <sstream>
 
+#include "common/strings.h"
+
 using namespace ros2bag;
 using namespace std::literals::chrono_literals;
 
+namespace
+{
+
+std::string json_string(std::string const & value)
+{
+  std::ostringstream quoted;
+  quoted << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      quoted << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+             << std::dec;
+    } else {
+      quoted << c;
+    }
+  }
+  quoted << '"';
+  return quoted.str();
+}
+
+// Numbers are written as JSON numbers, like pandas reads them from the CSV.
+std::string json_value(std::string const & value)
+{
+  bool is_number = !value.empty() &&
+    (std::isdigit(static_cast<unsigned char>(value[0])) || value[0] == '-') &&
+    value.find_first_not_of("0123456789+-.eE") == std::string::npos;
+  if (is_number) {
+    char * end = nullptr;
+    std::strtod(value.c_str(), &end);
+    is_number = *end == '\0';
+  }
+  return is_number ? value : json_string(value);
+}
+
+}  // namespace
+
 void Profiler::take_time_for(std::string const & task)
 {
   time_points_.emplace_back(task, std::chrono::system_clock::now());
@@ -34,42 +76,95 @@ void Profiler::track_disk_usage()
   disk_usage_ = file.tellg();
 }
 
-std::string Profiler::csv_header() const
+void Profiler::track_disk_usage(long disk_usage)
 {
-  std::ostringstream header;
-
-  for (auto const & m : meta_data_) {
-    header << m.first << ",";
-  }
+  disk_usage_ = disk_usage;
+}
 
-  for (auto const & t : time_points_) {
-    header << t.first << " (ms),";
+LatencyHistogram & Profiler::latency_histogram(std::string const & operation)
+{
+  for (auto const & histogram : latency_histograms_) {
+    if (histogram.first == operation) {
+      return *histogram.second;
+    }
   }
+  latency_histograms_.emplace_back(operation, std::make_unique<LatencyHistogram>());
+  return *latency_histograms_.back().second;
+}
 
-  header << "disk usage (bytes)";
-
-  return header.str();
+void Profiler::track_result(std::string const & name, std::string const & value)
+{
+  results_.emplace_back(name, value);
 }
 
-std::string Profiler::csv_entry() const
+void Profiler::track_memory_usage()
 {
-  std::ostringstream entry;
+  peak_resident_set_size_ = peak_resident_set_size();
+  auto const allocations = allocation_counters();
+  allocations_.allocations = allocations.allocations - allocations_at_start_.allocations;
+  allocations_.allocated_bytes =
+    allocations.allocated_bytes - allocations_at_start_.allocated_bytes;
+}
 
-  for (auto const & m : meta_data_) {
-    entry << m.second << ",";
-  }
+std::vector<std::pair<std::string, std::string>> Profiler::columns() const
+{
+  auto columns = meta_data_;
 
   if (!time_points_.empty()) {
     auto const start = time_points_.front().second;
     for (auto const & t : time_points_) {
       auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(t.second - start);
-      entry << timestamp.count() << ",";
+      columns.emplace_back(t.first + " (ms)", std::to_string(timestamp.count()));
     }
   }
 
-  entry << disk_usage_;
+  columns.insert(columns.end(), results_.begin(), results_.end());
+
+  std::vector<std::pair<std::string, double>> const percentiles = {
+    {"p50", 50}, {"p99", 99}, {"p99.9", 99.9}};
+  for (auto const & histogram : latency_histograms_) {
+    for (auto const & percentile : percentiles) {
+      columns.emplace_back(
+        histogram.first + " latency " + percentile.first + " (ns)",
+        std::to_string(histogram.second->percentile(percentile.second).count()));
+    }
+    columns.emplace_back(
+      histogram.first + " latency max (ns)", std::to_string(histogram.second->max().count()));
+  }
+
+  columns.emplace_back("disk usage (bytes)", std::to_string(disk_usage_));
+  columns.emplace_back("peak resident set size (bytes)", std::to_string(peak_resident_set_size_));
+  columns.emplace_back("allocations", std::to_string(allocations_.allocations));
+  columns.emplace_back("allocated (bytes)", std::to_string(allocations_.allocated_bytes));
+
+  return columns;
+}
+
+std::string Profiler::csv_header() const
+{
+  std::vector<std::string> header;
+  for (auto const & column : columns()) {
+    header.push_back(column.first);
+  }
+  return strings::join(header, ",");
+}
+
+std::string Profiler::csv_entry() const
+{
+  std::vector<std::string> entry;
+  for (auto const & column : columns()) {
+    entry.push_back(column.second);
+  }
+  return strings::join(entry, ",");
+}
 
-  return entry.str();
+std::string Profiler::json_entry() const
+{
+  std::vector<std::string> members;
+  for (auto const & column : columns()) {
+    members.push_back(json_string(column.first) + ": " + json_value(column.second));
+  }
+  return strings::join(members, ", ", "{", "}");
 }
 
 Profiler::TickProgress Profiler::measure_progress(
@@ -18,10 +18,13 @@
 #define ROS2_ROSBAG_EVALUATION_PROFILER_H
 
 #include <chrono>
+#include <memory>
 #include <vector>
 #include <functional>
 
 #include "benchmark/benchmark.h"
+#include "profiler/latency_histogram.h"
+#include "profiler/memory_usage.h"
 
 namespace ros2bag
 {
@@ -33,7 +36,10 @@ public:
     std::vector<std::pair<std::string, std::string>> const & meta_data,
     std::string const & file_name)
     : meta_data_(meta_data), file_name_(file_name)
-  {}
+  {
+    reset_peak_resident_set_size();
+    allocations_at_start_ = allocation_counters();
+  }
 
   ~Profiler() = default;
 
@@ -41,10 +47,29 @@ public:
 
   void track_disk_usage();
 
+  // For files which are not on disk as a whole, e.g. kept in memory.
+  void track_disk_usage(long disk_usage);
+
+  /**
+   * Histogram to record the latencies of the given operation in, which adds its percentiles
+   * p50, p99 and p99.9 and its maximum to the results. The histogram is created on the first
+   * call, so it should be looked up outside of the measured loop.
+   */
+  LatencyHistogram & latency_histogram(std::string const & operation);
+
+  /// Adds a measured value, e.g. a throughput, as a column after the time points.
+  void track_result(std::string const & name, std::string const & value);
+
+  /// Takes the peak resident set size and the allocations since the profiler was created.
+  void track_memory_usage();
+
   std::string csv_header() const;
 
   std::string csv_entry() const;
 
+  /// The results as one JSON object, with the columns of the CSV as keys.
+  std::string json_entry() const;
+
   using TickProgress = std::function<void()>;
 
   TickProgress measure_progress(
@@ -55,9 +80,16 @@ public:
 
 private:
   std::string file_name_;
+  std::vector<std::pair<std::string, std::string>> columns() const;
+
   long disk_usage_;
   std::vector<std::pair<std::string, std::string>> meta_data_;
   std::vector<std::pair<std::string, std::chrono::system_clock::time_point>> time_points_;
+  std::vector<std::pair<std::string, std::unique_ptr<LatencyHistogram>>> latency_histograms_;
+  std::vector<std::pair<std::string, std::string>> results_;
+  AllocationCounters allocations_at_start_ {};
+  AllocationCounters allocations_ {};
+  long peak_resident_set_size_ {0};
 };
 
 }
@@ -17,6 +17,8 @@
 #ifndef ROS2_ROSBAG_EVALUATION_MESSAGE_READER_H
 #define ROS2_ROSBAG_EVALUATION_MESSAGE_READER_H
 
+#include <cstddef>
+#include <string>
 #include <vector>
 
 #include "generators/message.h"
@@ -24,6 +26,11 @@
 namespace ros2bag
 {
 
+/**
+ * Reads the messages of a bag in time stamp order, optionally only those of some topics or of
+ * a time range. The data of the messages is not copied into Messages, so reading measures the
+ * storage only.
+ */
 class MessageReader
 {
 public:
@@ -35,7 +42,20 @@ public:
 
   virtual void close() = 0;
 
-  virtual std::vector<Message> read() = 0;
+  virtual bool has_next() = 0;
+
+  /// Reads the next message and returns the size of its data in bytes.
+  virtual size_t read_next() = 0;
+
+  /// Reads only the messages of the given topics, or of all topics if the list is empty.
+  virtual void set_topic_filter(std::vector<std::string> const & topics) = 0;
+
+  /// Reads only the messages within [start, end], and starts reading again at start.
+  virtual void set_time_range(
+    Message::Timestamp const & start, Message::Timestamp const & end) = 0;
+
+  /// Continues reading at the first message at or after the time stamp.
+  virtual void seek(Message::Timestamp const & timestamp) = 0;
 };
 
 }
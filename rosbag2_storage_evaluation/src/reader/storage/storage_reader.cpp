@@ -0,0 +1,125 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "reader/storage/storage_reader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "rosbag2_storage/bag_metadata.hpp"
+
+using namespace ros2bag;
+
+namespace
+{
+
+rcutils_time_point_value_t to_nanoseconds(Message::Timestamp const & timestamp)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    timestamp.time_since_epoch()).count();
+}
+
+}  // namespace
+
+StorageReader::StorageReader(std::string const & file_path, std::string const & storage_id)
+  : file_path_(file_path)
+  , storage_id_(storage_id)
+  , message_pool_(std::make_shared<rosbag2_storage::MessagePool>())
+  , duration_(0)
+  , message_count_(0)
+{}
+
+StorageReader::~StorageReader()
+{
+  close();
+}
+
+void StorageReader::open()
+{
+  close();
+  storage_ = storage_factory_.open_read_only(file_path_, storage_id_);
+  if (!storage_) {
+    throw std::runtime_error(
+      "File \"" + file_path_ + "\" could not be opened with storage \"" + storage_id_ + "\".");
+  }
+  storage_->set_message_pool(message_pool_);
+  storage_filter_ = rosbag2_storage::StorageFilter();
+
+  auto const metadata = storage_->get_metadata();
+  starting_time_ = Message::Timestamp(
+    std::chrono::duration_cast<Message::Timestamp::duration>(
+      metadata.starting_time.time_since_epoch()));
+  duration_ = metadata.duration;
+  message_count_ = metadata.message_count;
+}
+
+void StorageReader::close()
+{
+  storage_.reset();
+}
+
+bool StorageReader::has_next()
+{
+  return storage_->has_next();
+}
+
+size_t StorageReader::read_next()
+{
+  auto const message = storage_->read_next();
+  return message->serialized_data ? message->serialized_data->buffer_length : 0;
+}
+
+void StorageReader::set_topic_filter(std::vector<std::string> const & topics)
+{
+  storage_filter_.topics = topics;
+  storage_->set_filter(storage_filter_);
+}
+
+void StorageReader::set_time_range(
+  Message::Timestamp const & start, Message::Timestamp const & end)
+{
+  storage_filter_.start_time = to_nanoseconds(start);
+  storage_filter_.end_time = to_nanoseconds(end);
+  storage_->set_filter(storage_filter_);
+}
+
+void StorageReader::seek(Message::Timestamp const & timestamp)
+{
+  storage_->seek(to_nanoseconds(timestamp));
+}
+
+bool StorageReader::evict_from_page_cache() const
+{
+  int const fd = ::open(file_path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  // Only pages which were written to the disk are dropped.
+  ::fdatasync(fd);
+  bool const evicted = ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  ::close(fd);
+  return evicted;
+}
+
+void StorageReader::load_into_page_cache() const
+{
+  std::ifstream file(file_path_, std::ifstream::binary);
+  std::vector<char> buffer(1024 * 1024);
+  while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+  }
+}
@@ -0,0 +1,102 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_STORAGE_READER_H
+#define ROS2_ROSBAG_EVALUATION_STORAGE_READER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosbag2_storage/message_pool.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/storage_interfaces/read_only_interface.hpp"
+
+#include "reader/message_reader.h"
+
+namespace ros2bag
+{
+
+/**
+ * Reads the messages of a file with a rosbag2 storage plugin, opened through the StorageFactory
+ * like rosbag2 does. The messages are allocated from a MessagePool, as the rosbag2 reader does.
+ */
+class StorageReader : public MessageReader
+{
+public:
+  StorageReader(std::string const & file_path, std::string const & storage_id);
+
+  ~StorageReader() override;
+
+  void open() override;
+
+  void close() override;
+
+  bool has_next() override;
+
+  size_t read_next() override;
+
+  void set_topic_filter(std::vector<std::string> const & topics) override;
+
+  void set_time_range(Message::Timestamp const & start, Message::Timestamp const & end) override;
+
+  void seek(Message::Timestamp const & timestamp) override;
+
+  /// Time stamp of the first message of the file, as given by the metadata of the storage.
+  Message::Timestamp starting_time() const
+  {
+    return starting_time_;
+  }
+
+  /// Time between the first and the last message of the file.
+  std::chrono::nanoseconds duration() const
+  {
+    return duration_;
+  }
+
+  uint64_t message_count() const
+  {
+    return message_count_;
+  }
+
+  /**
+   * Drops the file from the page cache of the operating system, so it is read from the disk
+   * again. Returns false if the file is not on disk, e.g. kept in memory by the storage.
+   */
+  bool evict_from_page_cache() const;
+
+  /// Reads the whole file once, so it is in the page cache of the operating system.
+  void load_into_page_cache() const;
+
+private:
+  std::string const file_path_;
+  std::string const storage_id_;
+
+  // Storages must be destroyed before the factory which loaded their plugin.
+  rosbag2_storage::StorageFactory storage_factory_;
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface> storage_;
+  std::shared_ptr<rosbag2_storage::MessagePool> message_pool_;
+  rosbag2_storage::StorageFilter storage_filter_;
+  Message::Timestamp starting_time_;
+  std::chrono::nanoseconds duration_;
+  uint64_t message_count_;
+};
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_STORAGE_READER_H
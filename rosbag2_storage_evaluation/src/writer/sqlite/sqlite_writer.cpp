@@ -26,8 +26,9 @@ void SqliteWriter::open()
   if (!is_open()) {
     open_ = true;
     db_ = sqlite::open_db(filename_);
-    initialize_tables(db_);
+    // Some pragmas, e.g. page_size, only take effect before the first table is created.
     set_pragmas();
+    initialize_tables(db_);
     prepare_statements(db_);
   }
 }
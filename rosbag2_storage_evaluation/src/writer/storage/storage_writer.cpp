@@ -0,0 +1,127 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "writer/storage/storage_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+using namespace ros2bag;
+
+StorageWriter::StorageWriter(
+  std::string const & uri,
+  std::string const & storage_id,
+  rosbag2_storage::StorageConfig const & storage_config,
+  unsigned int batch_size)
+  : uri_(uri)
+  , storage_id_(storage_id)
+  , storage_config_(storage_config)
+  , batch_size_(batch_size)
+  , run_count_(0)
+  , bagfile_size_(0)
+{}
+
+StorageWriter::~StorageWriter()
+{
+  close();
+}
+
+void StorageWriter::open()
+{
+  close();
+  topic_handles_.clear();
+  serialized_blobs_.clear();
+  batch_.reserve(batch_size_);
+
+  auto const uri = uri_ + "_" + std::to_string(run_count_++);
+  storage_ = storage_factory_.open_read_write(uri, storage_id_, storage_config_);
+  if (!storage_) {
+    throw std::runtime_error("Storage \"" + storage_id_ + "\" could not be opened.");
+  }
+  file_path_ = storage_->get_relative_file_path();
+}
+
+void StorageWriter::close()
+{
+  if (!storage_) {
+    return;
+  }
+  write_batch();
+  auto const reported_size = storage_->get_bagfile_size();
+  storage_.reset();
+
+  std::ifstream file(file_path_, std::ifstream::binary | std::ifstream::ate);
+  bagfile_size_ = file ? static_cast<uint64_t>(file.tellg()) : reported_size;
+}
+
+void StorageWriter::write(MessagePtr message)
+{
+  auto topic_handle = topic_handles_.find(message->topic());
+  if (topic_handle == topic_handles_.end()) {
+    storage_->create_topic({message->topic(), "rosbag2_storage_evaluation/Blob", "cdr", ""});
+    auto const handle = static_cast<rosbag2_storage::TopicHandle>(topic_handles_.size());
+    storage_->set_topic_handle(message->topic(), handle);
+    topic_handle = topic_handles_.emplace(message->topic(), handle).first;
+  }
+
+  auto const blob = message->blob();
+  auto & serialized_blob = serialized_blobs_[blob.get()];
+  if (!serialized_blob) {
+    serialized_blob = rosbag2_storage::make_serialized_message(blob->data(), blob->size());
+  }
+
+  auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+  bag_message->serialized_data = serialized_blob;
+  bag_message->time_stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    message->timestamp().time_since_epoch()).count();
+  bag_message->topic_name = message->topic();
+  bag_message->topic_handle = topic_handle->second;
+
+  if (batch_size_ <= 1) {
+    storage_->write(bag_message);
+    return;
+  }
+  batch_.push_back(bag_message);
+  if (batch_.size() >= batch_size_) {
+    write_batch();
+  }
+}
+
+void StorageWriter::create_index()
+{
+  // The plugins build their indices when they are closed.
+  write_batch();
+}
+
+void StorageWriter::reset()
+{
+  close();
+  if (!file_path_.empty()) {
+    std::remove(file_path_.c_str());
+    file_path_.clear();
+  }
+}
+
+void StorageWriter::write_batch()
+{
+  if (!batch_.empty()) {
+    storage_->write(batch_);
+    batch_.clear();
+  }
+}
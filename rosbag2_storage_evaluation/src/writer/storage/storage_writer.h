@@ -0,0 +1,100 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROS2_ROSBAG_EVALUATION_STORAGE_WRITER_H
+#define ROS2_ROSBAG_EVALUATION_STORAGE_WRITER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_config.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
+
+#include "writer/message_writer.h"
+
+namespace ros2bag
+{
+
+/**
+ * Writes the messages with a rosbag2 storage plugin, opened through the StorageFactory like
+ * rosbag2 does. Messages are written in batches of batch_size messages, as the cache of the
+ * rosbag2 writer does. The plugins build their indices on close.
+ */
+class StorageWriter : public MessageWriter
+{
+public:
+  StorageWriter(
+    std::string const & uri,
+    std::string const & storage_id,
+    rosbag2_storage::StorageConfig const & storage_config,
+    unsigned int batch_size);
+
+  ~StorageWriter() override;
+
+  void open() override;
+
+  void close() override;
+
+  void write(MessagePtr message) override;
+
+  void create_index() override;
+
+  /// Removes the file written by the last run.
+  void reset() override;
+
+  /// Size of the file written by the last run, as reported by the storage if it is not on disk.
+  uint64_t bagfile_size() const
+  {
+    return bagfile_size_;
+  }
+
+  /// File written by the last run, which is kept until reset.
+  std::string const & file_path() const
+  {
+    return file_path_;
+  }
+
+private:
+  void write_batch();
+
+  std::string const uri_;
+  std::string const storage_id_;
+  rosbag2_storage::StorageConfig const storage_config_;
+  unsigned int const batch_size_;
+  // Every run writes a file of its own, so storages which keep their files in memory can be
+  // opened again.
+  unsigned int run_count_;
+
+  // Storages must be destroyed before the factory which loaded their plugin.
+  rosbag2_storage::StorageFactory storage_factory_;
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage_;
+  std::string file_path_;
+  uint64_t bagfile_size_;
+  std::unordered_map<std::string, rosbag2_storage::TopicHandle> topic_handles_;
+  // The generator repeats the same blob for every message of a topic, which is serialized once.
+  std::unordered_map<std::vector<unsigned char> const *, std::shared_ptr<rcutils_uint8_array_t>>
+  serialized_blobs_;
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage const>> batch_;
+};
+
+}
+
+#endif //ROS2_ROSBAG_EVALUATION_STORAGE_WRITER_H
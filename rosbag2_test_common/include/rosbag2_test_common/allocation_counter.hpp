@@ -0,0 +1,132 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TEST_COMMON__ALLOCATION_COUNTER_HPP_
+#define ROSBAG2_TEST_COMMON__ALLOCATION_COUNTER_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+
+// Allocations are counted by replacing malloc, which glibc supports, unless a sanitizer replaces
+// it already.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+# define ROSBAG2_TEST_COMMON__COUNTS_ALLOCATIONS
+#endif
+
+namespace rosbag2_test_common
+{
+namespace allocation_counter_detail
+{
+// Per thread, so the allocations of other threads, e.g. of the middleware, are not counted.
+inline size_t & allocation_count()
+{
+  static thread_local size_t count = 0;
+  return count;
+}
+}  // namespace allocation_counter_detail
+
+/**
+ * Counts the allocations of the calling thread with malloc, calloc and realloc since it was
+ * created or reset. These include the allocations of operator new and of the default rcutils
+ * allocator.
+ *
+ * Including this header replaces the allocation functions of the test executable, so it must be
+ * included by only one of its source files. They are only replaced with glibc, elsewhere nothing
+ * is counted and is_supported() returns false.
+ */
+class AllocationCounter
+{
+public:
+  AllocationCounter()
+  : start_(allocation_counter_detail::allocation_count())
+  {}
+
+  static constexpr bool is_supported()
+  {
+#ifdef ROSBAG2_TEST_COMMON__COUNTS_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  size_t allocations() const
+  {
+    return allocation_counter_detail::allocation_count() - start_;
+  }
+
+  void reset()
+  {
+    start_ = allocation_counter_detail::allocation_count();
+  }
+
+private:
+  size_t start_;
+};
+
+/**
+ * Calls the operation warm_up_calls times, so pools and caches reach their steady state, and
+ * returns the allocations of the calling thread during measured_calls further calls.
+ */
+template<typename Operation>
+size_t count_steady_state_allocations(
+  Operation && operation, size_t warm_up_calls, size_t measured_calls)
+{
+  for (size_t i = 0; i < warm_up_calls; ++i) {
+    operation();
+  }
+  AllocationCounter counter;
+  for (size_t i = 0; i < measured_calls; ++i) {
+    operation();
+  }
+  return counter.allocations();
+}
+
+}  // namespace rosbag2_test_common
+
+#ifdef ROSBAG2_TEST_COMMON__COUNTS_ALLOCATIONS
+extern "C" {
+
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * pointer, size_t size);
+void __libc_free(void * pointer);
+
+void * malloc(size_t size) noexcept
+{
+  ++rosbag2_test_common::allocation_counter_detail::allocation_count();
+  return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size) noexcept
+{
+  ++rosbag2_test_common::allocation_counter_detail::allocation_count();
+  return __libc_calloc(count, size);
+}
+
+void * realloc(void * pointer, size_t size) noexcept
+{
+  ++rosbag2_test_common::allocation_counter_detail::allocation_count();
+  return __libc_realloc(pointer, size);
+}
+
+void free(void * pointer) noexcept
+{
+  __libc_free(pointer);
+}
+
+}  // extern "C"
+#endif
+
+#endif  // ROSBAG2_TEST_COMMON__ALLOCATION_COUNTER_HPP_
@@ -0,0 +1,105 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BENCHMARK_HELPERS_HPP_
+#define BENCHMARK_HELPERS_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_storage/metadata_io.hpp"
+
+// Helpers shared by the benchmark executables.
+namespace benchmark_helpers
+{
+
+/// \throws std::invalid_argument if the value of the option is not a number.
+inline uint64_t parse_number(const std::string & option, const std::string & value)
+{
+  try {
+    return std::stoull(value);
+  } catch (const std::logic_error &) {
+    throw std::invalid_argument("Invalid value '" + value + "' of " + option + ".");
+  }
+}
+
+/// \throws std::invalid_argument if the value of the option is not a list of numbers.
+inline std::vector<double> parse_number_list(const std::string & option, const std::string & value)
+{
+  std::vector<double> numbers;
+  size_t begin = 0;
+  while (begin <= value.size()) {
+    auto end = std::min(value.find(',', begin), value.size());
+    try {
+      numbers.push_back(std::stod(value.substr(begin, end - begin)));
+    } catch (const std::logic_error &) {
+      throw std::invalid_argument("Invalid value '" + value + "' of " + option + ".");
+    }
+    begin = end + 1;
+  }
+  return numbers;
+}
+
+inline double to_seconds(std::chrono::nanoseconds duration)
+{
+  return std::chrono::duration<double>(duration).count();
+}
+
+/// Appends a row of values to a CSV file, preceded by the header if the file is new.
+inline void append_csv_row(
+  const std::string & file_name,
+  const std::vector<std::string> & header,
+  const std::vector<std::string> & values)
+{
+  auto to_row = [](const std::vector<std::string> & cells) {
+      std::string row;
+      for (const auto & cell : cells) {
+        row += (row.empty() ? "" : ",") + cell;
+      }
+      return row;
+    };
+  bool with_header = !std::ifstream(file_name).good();
+  std::ofstream csv(file_name, std::ios::app);
+  if (with_header) {
+    csv << to_row(header) << std::endl;
+  }
+  csv << to_row(values) << std::endl;
+}
+
+/// Removes the files of a bag listed in its metadata, and the bag directory if it is empty then.
+inline void remove_bag(const std::string & uri)
+{
+  rosbag2_storage::MetadataIo metadata_io;
+  if (metadata_io.metadata_file_exists(uri)) {
+    for (const auto & file : metadata_io.read_metadata(uri).relative_file_paths) {
+      rcpputils::fs::remove(rcpputils::fs::path(uri) / file);
+    }
+    rcpputils::fs::remove(
+      rcpputils::fs::path(uri) / rosbag2_storage::MetadataIo::metadata_filename);
+    rcpputils::fs::remove(
+      rcpputils::fs::path(uri) / rosbag2_storage::MetadataIo::binary_metadata_filename);
+  }
+  rcpputils::fs::remove(rcpputils::fs::path(uri));
+}
+
+}  // namespace benchmark_helpers
+
+#endif  // BENCHMARK_HELPERS_HPP_
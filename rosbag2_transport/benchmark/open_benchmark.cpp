@@ -0,0 +1,457 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how long it takes to start reading a bag: generates bags with the given numbers of
+// splits and topics and measures the time to the first message of the SequentialReader, of the
+// SequentialCompressionReader and of playback, and the time to read the metadata like
+// `ros2 bag info`. The phases of a start are measured one at a time as well: parsing the
+// metadata, loading the storage plugin and opening the first file, loading the type support of
+// every topic and creating its publisher.
+//
+// Libraries stay loaded in the process once a measurement loaded them, so only the first
+// repetition of the first configuration includes loading them.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/serialization.hpp"
+#include "rclcpp/serialized_message.hpp"
+
+#include "rcpputils/filesystem_helper.hpp"
+#include "rcpputils/shared_library.hpp"
+
+#include "rosbag2_compression/compression_options.hpp"
+#include "rosbag2_compression/sequential_compression_reader.hpp"
+#include "rosbag2_compression/sequential_compression_writer.hpp"
+
+#include "rosbag2_cpp/info.hpp"
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+#include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_factory.hpp"
+
+#include "rosbag2_transport/play_options.hpp"
+#include "rosbag2_transport/rosbag2_transport.hpp"
+#include "rosbag2_transport/storage_options.hpp"
+
+#include "std_msgs/msg/byte_multi_array.hpp"
+
+#include "benchmark_helpers.hpp"
+
+using namespace benchmark_helpers;  // NOLINT
+using namespace std::chrono_literals;  // NOLINT
+
+namespace
+{
+
+const char kUsage[] =
+  "Usage: open_benchmark [options]\n"
+  "  --split-counts <n1,n2,...>    Numbers of files of the bags opened, default 1,10,100.\n"
+  "  --topic-counts <n1,n2,...>    Numbers of topics of the bags opened, default 1,10,100.\n"
+  "  --repetitions <n>             Measurements of every bag, of which the median is\n"
+  "                                reported, default 3.\n"
+  "  --storage <storage id>        Storage plugin of the bags, default sqlite3.\n"
+  "  --output <directory>          Prefix of the bags, which are removed afterwards.\n"
+  "                                Default open_benchmark.\n"
+  "  --csv <file>                  Appends the results to a CSV file.\n";
+
+const char kMessageType[] = "std_msgs/msg/ByteMultiArray";
+
+struct BenchmarkOptions
+{
+  std::vector<double> split_counts = {1, 10, 100};
+  std::vector<double> topic_counts = {1, 10, 100};
+  size_t repetitions = 3;
+  std::string storage_id = "sqlite3";
+  std::string output = "open_benchmark";
+  std::string csv_file;
+};
+
+/// \throws std::invalid_argument if the arguments are invalid.
+BenchmarkOptions parse_options(int argc, char ** argv)
+{
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (i + 1 == argc) {
+      throw std::invalid_argument("Missing value of " + option + ".");
+    }
+    std::string value = argv[++i];
+    if (option == "--split-counts") {
+      options.split_counts = parse_number_list(option, value);
+    } else if (option == "--topic-counts") {
+      options.topic_counts = parse_number_list(option, value);
+    } else if (option == "--repetitions") {
+      options.repetitions = parse_number(option, value);
+    } else if (option == "--storage") {
+      options.storage_id = value;
+    } else if (option == "--output") {
+      options.output = value;
+    } else if (option == "--csv") {
+      options.csv_file = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + option + ".");
+    }
+  }
+  auto is_positive = [](double number) {return number >= 1;};
+  if (!std::all_of(options.split_counts.begin(), options.split_counts.end(), is_positive) ||
+    !std::all_of(options.topic_counts.begin(), options.topic_counts.end(), is_positive) ||
+    options.repetitions == 0)
+  {
+    throw std::invalid_argument("Split counts, topic counts and repetitions must be positive.");
+  }
+  return options;
+}
+
+std::string topic_name(size_t topic)
+{
+  return "/open_benchmark/topic" + std::to_string(topic);
+}
+
+rosbag2_cpp::StorageOptions make_storage_options(
+  const std::string & uri, const BenchmarkOptions & options)
+{
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.uri = uri;
+  storage_options.storage_id = options.storage_id;
+  return storage_options;
+}
+
+/**
+ * Writes a bag of the given number of files, each with a message of every topic, one millisecond
+ * apart. The messages are compressed with zstd if the writer is a SequentialCompressionWriter.
+ */
+void generate_bag(
+  std::unique_ptr<rosbag2_cpp::writer_interfaces::BaseWriterInterface> writer_impl,
+  const std::string & uri, size_t splits, size_t topics, const BenchmarkOptions & options)
+{
+  auto storage_options = make_storage_options(uri, options);
+  storage_options.max_bagfile_messages = splits > 1 ? topics : 0;
+  rosbag2_cpp::Writer writer(std::move(writer_impl));
+  writer.open(storage_options, {"cdr", "cdr"});
+  for (size_t topic = 0; topic < topics; ++topic) {
+    writer.create_topic({topic_name(topic), kMessageType, "cdr", ""});
+  }
+
+  std_msgs::msg::ByteMultiArray message;
+  message.data.resize(100, 0);
+  rclcpp::SerializedMessage serialized_message;
+  rclcpp::Serialization<std_msgs::msg::ByteMultiArray>().serialize_message(
+    &message, &serialized_message);
+  const auto & rcl_message = serialized_message.get_rcl_serialized_message();
+  const auto start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  for (size_t index = 0; index < splits * topics; ++index) {
+    auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    bag_message->serialized_data = rosbag2_storage::make_serialized_message(
+      rcl_message.buffer, rcl_message.buffer_length);
+    bag_message->time_stamp = start_time + static_cast<rcutils_time_point_value_t>(index) *
+      std::chrono::nanoseconds(1ms).count();
+    bag_message->topic_name = topic_name(index % topics);
+    writer.write(bag_message);
+  }
+}
+
+// Subscribes to the topics of a bag and notes when the first message of any of them arrives.
+class FirstMessageSubscriber
+{
+public:
+  explicit FirstMessageSubscriber(size_t topics)
+  : node_(std::make_shared<rclcpp::Node>(
+        "open_benchmark_subscriber",
+        rclcpp::NodeOptions().start_parameter_event_publisher(false).enable_rosout(false)))
+  {
+    for (size_t topic = 0; topic < topics; ++topic) {
+      subscriptions_.push_back(
+        node_->create_subscription<std_msgs::msg::ByteMultiArray>(
+          topic_name(topic), rclcpp::QoS{rclcpp::KeepAll()},
+          [this](std::shared_ptr<const std_msgs::msg::ByteMultiArray>) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!received_) {
+              received_ = true;
+              first_received_ = std::chrono::steady_clock::now();
+              received_condition_.notify_all();
+            }
+          }));
+    }
+    executor_.add_node(node_);
+    spin_thread_ = std::thread([this]() {executor_.spin();});
+  }
+
+  ~FirstMessageSubscriber()
+  {
+    executor_.cancel();
+    spin_thread_.join();
+  }
+
+  /// \throws std::runtime_error if no message arrives within the timeout.
+  std::chrono::steady_clock::time_point wait_for_first_message(
+    std::chrono::nanoseconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!received_condition_.wait_for(lock, timeout, [this]() {return received_;})) {
+      throw std::runtime_error("No message was received from the player.");
+    }
+    return first_received_;
+  }
+
+private:
+  std::shared_ptr<rclcpp::Node> node_;
+  std::vector<std::shared_ptr<rclcpp::Subscription<std_msgs::msg::ByteMultiArray>>>
+  subscriptions_;
+  rclcpp::executors::SingleThreadedExecutor executor_;
+  std::thread spin_thread_;
+  std::mutex mutex_;
+  std::condition_variable received_condition_;
+  bool received_ = false;
+  std::chrono::steady_clock::time_point first_received_;
+};
+
+// Durations of one measurement of a bag.
+struct OpenTimes
+{
+  std::chrono::nanoseconds metadata_parse{0};
+  std::chrono::nanoseconds plugin_load{0};
+  std::chrono::nanoseconds typesupport_load{0};
+  std::chrono::nanoseconds publisher_creation{0};
+  std::chrono::nanoseconds info{0};
+  std::chrono::nanoseconds sequential_reader{0};
+  std::chrono::nanoseconds compression_reader{0};
+  std::chrono::nanoseconds play{0};
+};
+
+template<typename Function>
+std::chrono::nanoseconds measure(Function function)
+{
+  const auto start = std::chrono::steady_clock::now();
+  function();
+  return std::chrono::steady_clock::now() - start;
+}
+
+/// \throws std::runtime_error if a reader does not find any message.
+template<typename Reader>
+std::chrono::nanoseconds measure_first_message(
+  const rosbag2_cpp::StorageOptions & storage_options)
+{
+  return measure(
+    [&storage_options]() {
+      Reader reader;
+      reader.open(storage_options, {"cdr", "cdr"});
+      if (!reader.has_next() || !reader.read_next()) {
+        throw std::runtime_error("The bag " + storage_options.uri + " has no messages.");
+      }
+    });
+}
+
+/**
+ * Measures the phases of opening the bag one at a time, then the time to the first message of
+ * the readers and of playback. The compression reader reads the compressed copy of the bag.
+ */
+OpenTimes measure_open(
+  const std::string & uri, const std::string & compressed_uri, size_t topics,
+  const BenchmarkOptions & options)
+{
+  OpenTimes times;
+  rosbag2_storage::BagMetadata metadata;
+  times.metadata_parse = measure(
+    [&uri, &metadata]() {metadata = rosbag2_storage::MetadataIo().read_metadata(uri);});
+  times.plugin_load = measure(
+    [&uri, &metadata, &options]() {
+      rosbag2_storage::StorageFactory storage_factory;
+      const auto file = rcpputils::fs::path(uri) / metadata.relative_file_paths.front();
+      if (!storage_factory.open_read_only(file.string(), options.storage_id)) {
+        throw std::runtime_error("Could not open " + file.string() + ".");
+      }
+    });
+  times.typesupport_load = measure(
+    [&metadata]() {
+      std::vector<std::shared_ptr<rcpputils::SharedLibrary>> libraries;
+      for (const auto & topic : metadata.topics_with_message_count) {
+        std::shared_ptr<rcpputils::SharedLibrary> library;
+        rosbag2_cpp::get_typesupport(
+          topic.topic_metadata.type, "rosidl_typesupport_cpp", library);
+        libraries.push_back(library);
+      }
+    });
+  {
+    auto node = std::make_shared<rclcpp::Node>(
+      "open_benchmark_publisher",
+      rclcpp::NodeOptions().start_parameter_event_publisher(false).enable_rosout(false));
+    std::vector<std::shared_ptr<rclcpp::Publisher<std_msgs::msg::ByteMultiArray>>> publishers;
+    times.publisher_creation = measure(
+      [&node, &publishers, &metadata]() {
+        for (const auto & topic : metadata.topics_with_message_count) {
+          publishers.push_back(
+            node->create_publisher<std_msgs::msg::ByteMultiArray>(
+              topic.topic_metadata.name, rclcpp::QoS(10)));
+        }
+      });
+  }
+
+  const auto storage_options = make_storage_options(uri, options);
+  times.info = measure(
+    [&uri, &options]() {rosbag2_cpp::Info().read_metadata(uri, options.storage_id);});
+  times.sequential_reader =
+    measure_first_message<rosbag2_cpp::readers::SequentialReader>(storage_options);
+  times.compression_reader =
+    measure_first_message<rosbag2_compression::SequentialCompressionReader>(
+    make_storage_options(compressed_uri, options));
+
+  // Only the first message is played, as fast as possible once every topic is subscribed.
+  FirstMessageSubscriber subscriber(topics);
+  rosbag2_transport::PlayOptions play_options{};
+  play_options.as_fast_as_possible = true;
+  play_options.duration = 1e-6;
+  play_options.wait_for_subscribers = 1;
+  const auto play_start = std::chrono::steady_clock::now();
+  {
+    rosbag2_transport::Rosbag2Transport transport(
+      std::make_shared<rosbag2_cpp::Reader>(
+        std::make_unique<rosbag2_cpp::readers::SequentialReader>()),
+      std::make_shared<rosbag2_cpp::Writer>(
+        std::make_unique<rosbag2_cpp::writers::SequentialWriter>()),
+      std::make_shared<rosbag2_cpp::Info>());
+    transport.play(storage_options, play_options);
+  }
+  times.play = subscriber.wait_for_first_message(10s) - play_start;
+  return times;
+}
+
+double median_ms(
+  const std::vector<OpenTimes> & measurements, std::chrono::nanoseconds OpenTimes::* time)
+{
+  std::vector<std::chrono::nanoseconds> durations;
+  for (const auto & measurement : measurements) {
+    durations.push_back(measurement.*time);
+  }
+  std::sort(durations.begin(), durations.end());
+  return to_seconds(durations[durations.size() / 2]) * 1e3;
+}
+
+void report(
+  const BenchmarkOptions & options, size_t splits, size_t topics,
+  const std::vector<OpenTimes> & measurements)
+{
+  const std::vector<std::chrono::nanoseconds OpenTimes::*> columns = {
+    &OpenTimes::metadata_parse, &OpenTimes::plugin_load, &OpenTimes::typesupport_load,
+    &OpenTimes::publisher_creation, &OpenTimes::info, &OpenTimes::sequential_reader,
+    &OpenTimes::compression_reader, &OpenTimes::play};
+  std::vector<std::string> values = {
+    options.storage_id, std::to_string(splits), std::to_string(topics)};
+  std::cout << std::fixed << std::setprecision(3) << std::right <<
+    std::setw(8) << splits << std::setw(8) << topics;
+  for (const auto column : columns) {
+    const auto milliseconds = median_ms(measurements, column);
+    std::cout << std::setw(12) << milliseconds;
+    values.push_back(std::to_string(milliseconds));
+  }
+  std::cout << std::endl;
+
+  if (!options.csv_file.empty()) {
+    append_csv_row(
+      options.csv_file,
+      {"storage id", "splits", "topics", "metadata parse (ms)", "plugin load (ms)",
+        "typesupport load (ms)", "publisher creation (ms)", "info (ms)",
+        "sequential reader (ms)", "compression reader (ms)", "play (ms)"},
+      values);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  BenchmarkOptions options;
+  try {
+    options = parse_options(argc, argv);
+  } catch (const std::invalid_argument & e) {
+    std::cerr << e.what() << std::endl << kUsage;
+    return EXIT_FAILURE;
+  }
+
+  rclcpp::init(0, nullptr);
+  std::cout << std::right << std::setw(8) << "splits" << std::setw(8) << "topics" <<
+    std::setw(12) << "metadata" << std::setw(12) << "plugin" << std::setw(12) << "typesupport" <<
+    std::setw(12) << "publishers" << std::setw(12) << "info" << std::setw(12) << "reader" <<
+    std::setw(12) << "compressed" << std::setw(12) << "play" << "  (median ms)" << std::endl;
+  int exit_code = EXIT_SUCCESS;
+  for (auto split_count : options.split_counts) {
+    for (auto topic_count : options.topic_counts) {
+      const auto splits = static_cast<size_t>(split_count);
+      const auto topics = static_cast<size_t>(topic_count);
+      const auto uri = options.output + "_" + std::to_string(splits) + "x" +
+        std::to_string(topics);
+      const auto compressed_uri = uri + "_zstd";
+      if (rcpputils::fs::exists(rcpputils::fs::path(uri)) ||
+        rcpputils::fs::exists(rcpputils::fs::path(compressed_uri)))
+      {
+        std::cerr << "The bag " << uri << " already exists." << std::endl;
+        exit_code = EXIT_FAILURE;
+        break;
+      }
+      try {
+        generate_bag(
+          std::make_unique<rosbag2_cpp::writers::SequentialWriter>(), uri, splits, topics,
+          options);
+        const rosbag2_compression::CompressionOptions compression_options{
+          "zstd", rosbag2_compression::CompressionMode::MESSAGE};
+        generate_bag(
+          std::make_unique<rosbag2_compression::SequentialCompressionWriter>(compression_options),
+          compressed_uri, splits, topics, options);
+        std::vector<OpenTimes> measurements;
+        for (size_t repetition = 0; repetition < options.repetitions; ++repetition) {
+          measurements.push_back(measure_open(uri, compressed_uri, topics, options));
+        }
+        report(options, splits, topics, measurements);
+      } catch (const std::exception & e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        exit_code = EXIT_FAILURE;
+      }
+      for (const auto & bag : {uri, compressed_uri}) {
+        try {
+          remove_bag(bag);
+        } catch (const std::exception & e) {
+          std::cerr << "Failed to remove the bag: " << e.what() << std::endl;
+        }
+      }
+      if (exit_code != EXIT_SUCCESS || !rclcpp::ok()) {
+        break;
+      }
+    }
+    if (exit_code != EXIT_SUCCESS || !rclcpp::ok()) {
+      break;
+    }
+  }
+  rclcpp::shutdown();
+  return exit_code;
+}
@@ -0,0 +1,425 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how accurately the Player reproduces the timing of a bag: generates a bag of topics
+// publishing at a fixed frequency, plays it at several rates and compares the time every message
+// is received at with the time it is due at according to the recorded timeline.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/serialization.hpp"
+#include "rclcpp/serialized_message.hpp"
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/info.hpp"
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/topic_metadata.hpp"
+
+#include "rosbag2_transport/play_options.hpp"
+#include "rosbag2_transport/rosbag2_transport.hpp"
+#include "rosbag2_transport/storage_options.hpp"
+
+#include "std_msgs/msg/byte_multi_array.hpp"
+
+#include "benchmark_helpers.hpp"
+
+using namespace benchmark_helpers;  // NOLINT
+using namespace std::chrono_literals;  // NOLINT
+
+namespace
+{
+
+const char kUsage[] =
+  "Usage: play_benchmark [options]\n"
+  "  --topic-counts <n1,n2,...>    Numbers of topics of the bags played, default 1,10.\n"
+  "  --rates <r1,r2,...>           Rates the bags are played at, default 0.5,1,2.\n"
+  "  --frequency <Hz>              Frequency of the messages of every topic, default 100.\n"
+  "  --message-size <bytes>        Default 100.\n"
+  "  --duration <seconds>          Length of the bags played, default 10.\n"
+  "  --storage <storage id>        Storage plugin of the bags, default sqlite3.\n"
+  "  --busy-wait-period <us>       Busy-wait period of the player, default 0.\n"
+  "  --publishing-threads <n>      Publishing threads of the player, default 0.\n"
+  "  --output <directory>          Prefix of the bags, which are removed afterwards.\n"
+  "                                Default play_benchmark.\n"
+  "  --csv <file>                  Appends the results to a CSV file.\n";
+
+const char kMessageType[] = "std_msgs/msg/ByteMultiArray";
+
+struct BenchmarkOptions
+{
+  std::vector<double> topic_counts = {1, 10};
+  std::vector<double> rates = {0.5, 1, 2};
+  double frequency = 100.0;
+  size_t message_size = 100;
+  std::chrono::seconds duration{10};
+  std::string storage_id = "sqlite3";
+  std::chrono::microseconds busy_wait_period{0};
+  size_t publishing_threads = 0;
+  std::string output = "play_benchmark";
+  std::string csv_file;
+};
+
+/// \throws std::invalid_argument if the arguments are invalid.
+BenchmarkOptions parse_options(int argc, char ** argv)
+{
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (i + 1 == argc) {
+      throw std::invalid_argument("Missing value of " + option + ".");
+    }
+    std::string value = argv[++i];
+    if (option == "--topic-counts") {
+      options.topic_counts = parse_number_list(option, value);
+    } else if (option == "--rates") {
+      options.rates = parse_number_list(option, value);
+    } else if (option == "--frequency") {
+      options.frequency = parse_number_list(option, value).front();
+    } else if (option == "--message-size") {
+      options.message_size = parse_number(option, value);
+    } else if (option == "--duration") {
+      options.duration = std::chrono::seconds(parse_number(option, value));
+    } else if (option == "--storage") {
+      options.storage_id = value;
+    } else if (option == "--busy-wait-period") {
+      options.busy_wait_period = std::chrono::microseconds(parse_number(option, value));
+    } else if (option == "--publishing-threads") {
+      options.publishing_threads = parse_number(option, value);
+    } else if (option == "--output") {
+      options.output = value;
+    } else if (option == "--csv") {
+      options.csv_file = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + option + ".");
+    }
+  }
+  auto is_positive = [](double number) {return number > 0;};
+  if (!std::all_of(options.topic_counts.begin(), options.topic_counts.end(), is_positive) ||
+    !std::all_of(options.rates.begin(), options.rates.end(), is_positive) ||
+    options.frequency <= 0 || options.duration.count() == 0)
+  {
+    throw std::invalid_argument("Topic counts, rates, frequency and duration must be positive.");
+  }
+  // The recorded time stamp is stored at the start of every message.
+  options.message_size = std::max(options.message_size, sizeof(rcutils_time_point_value_t));
+  return options;
+}
+
+std::string topic_name(size_t topic)
+{
+  return "/play_benchmark/topic" + std::to_string(topic);
+}
+
+/**
+ * Writes a bag of the given number of topics, each with messages at the frequency of the
+ * options. The topics are staggered evenly within the period, so the player interleaves them.
+ *
+ * \return the number of messages written.
+ */
+size_t generate_bag(const std::string & uri, size_t topics, const BenchmarkOptions & options)
+{
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.uri = uri;
+  storage_options.storage_id = options.storage_id;
+  rosbag2_cpp::Writer writer(std::make_unique<rosbag2_cpp::writers::SequentialWriter>());
+  writer.open(storage_options, {"cdr", "cdr"});
+  for (size_t topic = 0; topic < topics; ++topic) {
+    writer.create_topic({topic_name(topic), kMessageType, "cdr", ""});
+  }
+
+  const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double>(1.0 / options.frequency));
+  const auto messages_per_topic = static_cast<size_t>(
+    to_seconds(options.duration) * options.frequency);
+  const auto start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  std_msgs::msg::ByteMultiArray message;
+  message.data.resize(options.message_size, 0);
+  rclcpp::Serialization<std_msgs::msg::ByteMultiArray> serialization;
+  for (size_t index = 0; index < messages_per_topic; ++index) {
+    for (size_t topic = 0; topic < topics; ++topic) {
+      rcutils_time_point_value_t time_stamp = start_time + index * period.count() +
+        topic * period.count() / topics;
+      std::memcpy(message.data.data(), &time_stamp, sizeof(time_stamp));
+      rclcpp::SerializedMessage serialized_message;
+      serialization.serialize_message(&message, &serialized_message);
+      const auto & rcl_message = serialized_message.get_rcl_serialized_message();
+
+      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      bag_message->serialized_data = rosbag2_storage::make_serialized_message(
+        rcl_message.buffer, rcl_message.buffer_length);
+      bag_message->time_stamp = time_stamp;
+      bag_message->topic_name = topic_name(topic);
+      writer.write(bag_message);
+    }
+  }
+  return messages_per_topic * topics;
+}
+
+// Receive time and recorded time stamp of a message.
+struct Sample
+{
+  std::chrono::steady_clock::time_point received;
+  rcutils_time_point_value_t time_stamp;
+};
+
+// Subscribes to the topics of a bag, keeping a sample of every message received.
+class TimingSubscriber
+{
+public:
+  explicit TimingSubscriber(size_t topics)
+  : node_(std::make_shared<rclcpp::Node>(
+        "play_benchmark_subscriber",
+        rclcpp::NodeOptions().start_parameter_event_publisher(false).enable_rosout(false))),
+    samples_(topics)
+  {
+    for (size_t topic = 0; topic < topics; ++topic) {
+      samples_[topic].reserve(1024);
+      subscriptions_.push_back(
+        node_->create_subscription<std_msgs::msg::ByteMultiArray>(
+          topic_name(topic), rclcpp::QoS{rclcpp::KeepAll()},
+          [this, topic](std::shared_ptr<const std_msgs::msg::ByteMultiArray> message) {
+            Sample sample{std::chrono::steady_clock::now(), 0};
+            if (message->data.size() >= sizeof(sample.time_stamp)) {
+              std::memcpy(&sample.time_stamp, message->data.data(), sizeof(sample.time_stamp));
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            samples_[topic].push_back(sample);
+          }));
+    }
+    executor_.add_node(node_);
+    spin_thread_ = std::thread([this]() {executor_.spin();});
+  }
+
+  ~TimingSubscriber()
+  {
+    executor_.cancel();
+    spin_thread_.join();
+  }
+
+  /// Stops receiving and returns the samples of all topics.
+  std::vector<std::vector<Sample>> stop()
+  {
+    executor_.cancel();
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_;
+  }
+
+private:
+  std::shared_ptr<rclcpp::Node> node_;
+  std::vector<std::shared_ptr<rclcpp::Subscription<std_msgs::msg::ByteMultiArray>>>
+  subscriptions_;
+  rclcpp::executors::SingleThreadedExecutor executor_;
+  std::thread spin_thread_;
+  std::mutex mutex_;
+  std::vector<std::vector<Sample>> samples_;
+};
+
+double percentile(const std::vector<double> & sorted_values, double fraction)
+{
+  if (sorted_values.empty()) {
+    return 0.0;
+  }
+  auto index = static_cast<size_t>(fraction * (sorted_values.size() - 1) + 0.5);
+  return sorted_values[std::min(index, sorted_values.size() - 1)];
+}
+
+struct TimingResults
+{
+  size_t received_messages = 0;
+  // Milliseconds every message was received after it was due, sorted.
+  std::vector<double> lateness;
+  // Milliseconds the interval to the previous message of the topic differs from the recorded
+  // interval scaled by the rate, as absolute values, sorted.
+  std::vector<double> interval_errors;
+};
+
+/**
+ * Compares the receive times with the recorded timeline scaled by the rate. Playback has no
+ * common clock with the subscriber, so the timeline is aligned with the earliest message
+ * relative to it: the lateness is the delay on top of the smallest delay of any message.
+ */
+TimingResults evaluate(const std::vector<std::vector<Sample>> & samples, double rate)
+{
+  TimingResults results;
+  rcutils_time_point_value_t first_time_stamp = std::numeric_limits<int64_t>::max();
+  for (const auto & topic_samples : samples) {
+    results.received_messages += topic_samples.size();
+    for (const auto & sample : topic_samples) {
+      first_time_stamp = std::min(first_time_stamp, sample.time_stamp);
+    }
+  }
+  if (results.received_messages == 0) {
+    return results;
+  }
+
+  // Receive time minus the scaled bag time, in nanoseconds of the steady clock.
+  auto offset = [first_time_stamp, rate](const Sample & sample) {
+      auto bag_time = static_cast<double>(sample.time_stamp - first_time_stamp) / rate;
+      auto received = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        sample.received.time_since_epoch());
+      return static_cast<double>(received.count()) - bag_time;
+    };
+  double min_offset = std::numeric_limits<double>::max();
+  for (const auto & topic_samples : samples) {
+    for (const auto & sample : topic_samples) {
+      min_offset = std::min(min_offset, offset(sample));
+    }
+  }
+  for (const auto & topic_samples : samples) {
+    for (size_t i = 0; i < topic_samples.size(); ++i) {
+      results.lateness.push_back((offset(topic_samples[i]) - min_offset) / 1e6);
+      if (i > 0) {
+        results.interval_errors.push_back(
+          std::abs(offset(topic_samples[i]) - offset(topic_samples[i - 1])) / 1e6);
+      }
+    }
+  }
+  std::sort(results.lateness.begin(), results.lateness.end());
+  std::sort(results.interval_errors.begin(), results.interval_errors.end());
+  return results;
+}
+
+TimingResults play_bag(
+  const std::string & uri, size_t topics, double rate, const BenchmarkOptions & options)
+{
+  TimingSubscriber subscriber(topics);
+
+  rosbag2_transport::PlayOptions play_options{};
+  play_options.read_ahead_queue_size = 1000;
+  play_options.rate = static_cast<float>(rate);
+  play_options.busy_wait_period = options.busy_wait_period;
+  play_options.publishing_threads = options.publishing_threads;
+  play_options.wait_for_subscribers = 1;
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.uri = uri;
+  storage_options.storage_id = options.storage_id;
+  {
+    rosbag2_transport::Rosbag2Transport transport(
+      std::make_shared<rosbag2_cpp::Reader>(
+        std::make_unique<rosbag2_cpp::readers::SequentialReader>()),
+      std::make_shared<rosbag2_cpp::Writer>(
+        std::make_unique<rosbag2_cpp::writers::SequentialWriter>()),
+      std::make_shared<rosbag2_cpp::Info>());
+    transport.play(storage_options, play_options);
+  }
+  // Gives the messages published last the time to arrive.
+  std::this_thread::sleep_for(500ms);
+  return evaluate(subscriber.stop(), rate);
+}
+
+void report(
+  const BenchmarkOptions & options, size_t topics, double rate, size_t expected_messages,
+  const TimingResults & results)
+{
+  auto lost = expected_messages - std::min(expected_messages, results.received_messages);
+  std::cout << std::fixed << std::setprecision(3) << std::right <<
+    std::setw(8) << topics << std::setw(8) << rate << std::setw(12) << results.received_messages <<
+    std::setw(8) << lost << std::setw(10) << percentile(results.lateness, 0.5) <<
+    std::setw(10) << percentile(results.lateness, 0.9) <<
+    std::setw(10) << percentile(results.lateness, 0.99) <<
+    std::setw(10) << percentile(results.lateness, 1.0) <<
+    std::setw(10) << percentile(results.interval_errors, 0.5) <<
+    std::setw(10) << percentile(results.interval_errors, 0.99) << std::endl;
+
+  if (!options.csv_file.empty()) {
+    append_csv_row(
+      options.csv_file,
+      {"storage id", "topics", "frequency (Hz)", "message size (bytes)", "rate",
+        "busy wait period (us)", "publishing threads", "messages", "lost",
+        "lateness p50 (ms)", "lateness p90 (ms)", "lateness p99 (ms)", "lateness max (ms)",
+        "interval error p50 (ms)", "interval error p99 (ms)"},
+      {options.storage_id, std::to_string(topics), std::to_string(options.frequency),
+        std::to_string(options.message_size), std::to_string(rate),
+        std::to_string(options.busy_wait_period.count()),
+        std::to_string(options.publishing_threads), std::to_string(results.received_messages),
+        std::to_string(lost), std::to_string(percentile(results.lateness, 0.5)),
+        std::to_string(percentile(results.lateness, 0.9)),
+        std::to_string(percentile(results.lateness, 0.99)),
+        std::to_string(percentile(results.lateness, 1.0)),
+        std::to_string(percentile(results.interval_errors, 0.5)),
+        std::to_string(percentile(results.interval_errors, 0.99))});
+  }
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  BenchmarkOptions options;
+  try {
+    options = parse_options(argc, argv);
+  } catch (const std::invalid_argument & e) {
+    std::cerr << e.what() << std::endl << kUsage;
+    return EXIT_FAILURE;
+  }
+
+  rclcpp::init(0, nullptr);
+  std::cout << std::right << std::setw(8) << "topics" << std::setw(8) << "rate" <<
+    std::setw(12) << "messages" << std::setw(8) << "lost" <<
+    std::setw(40) << "lateness p50/p90/p99/max (ms)" <<
+    std::setw(20) << "interval p50/p99" << std::endl;
+  int exit_code = EXIT_SUCCESS;
+  for (auto topic_count : options.topic_counts) {
+    const auto topics = static_cast<size_t>(topic_count);
+    const auto uri = options.output + "_" + std::to_string(topics);
+    if (rcpputils::fs::exists(rcpputils::fs::path(uri))) {
+      std::cerr << "The bag " << uri << " already exists." << std::endl;
+      exit_code = EXIT_FAILURE;
+      break;
+    }
+    try {
+      auto messages = generate_bag(uri, topics, options);
+      for (auto rate : options.rates) {
+        report(options, topics, rate, messages, play_bag(uri, topics, rate, options));
+      }
+    } catch (const std::exception & e) {
+      std::cerr << "Benchmark failed: " << e.what() << std::endl;
+      exit_code = EXIT_FAILURE;
+    }
+    try {
+      remove_bag(uri);
+    } catch (const std::exception & e) {
+      std::cerr << "Failed to remove the bag: " << e.what() << std::endl;
+    }
+    if (exit_code != EXIT_SUCCESS || !rclcpp::ok()) {
+      break;
+    }
+  }
+  rclcpp::shutdown();
+  return exit_code;
+}
@@ -0,0 +1,740 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the throughput the recording stack sustains: synthetic publishers publish for a given
+// time, while the Recorder records them with a SequentialWriter into a storage plugin. Reports
+// the messages and bytes passing each stage, the messages lost on the way and the CPU time used.
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/resource.h>
+# include <time.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/serialization.hpp"
+#include "rclcpp/serialized_message.hpp"
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_cpp/info.hpp"
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+#include "rosbag2_storage/storage_factory.hpp"
+#include "rosbag2_storage/storage_factory_interface.hpp"
+#include "rosbag2_storage/storage_interfaces/read_write_interface.hpp"
+
+#include "rosbag2_transport/record_options.hpp"
+#include "rosbag2_transport/rosbag2_transport.hpp"
+#include "rosbag2_transport/storage_options.hpp"
+
+#include "std_msgs/msg/byte_multi_array.hpp"
+
+#include "benchmark_helpers.hpp"
+
+using namespace benchmark_helpers;  // NOLINT
+using namespace std::chrono_literals;  // NOLINT
+
+namespace
+{
+
+const char kUsage[] =
+  "Usage: record_benchmark [options]\n"
+  "  --publishers <topics>x<bytes>@<rate>[:best_effort]\n"
+  "      Group of topics, each publishing messages of the given size at the given rate in Hz,\n"
+  "      0 for as fast as possible. Can be given several times. Default 10x1000@100.\n"
+  "  --qos-depth <depth>           History depth of the publishers, default 10.\n"
+  "  --duration <seconds>          Time to publish, default 10.\n"
+  "  --storage <storage id>        Storage plugin to record with, default sqlite3.\n"
+  "  --storage-preset-profile <profile>\n"
+  "  --max-cache-size <messages>   Default 100.\n"
+  "  --cache-overflow-policy block|drop_oldest|drop_newest\n"
+  "  --recorder-threads <threads>  Default 1.\n"
+  "  --output <directory>          Bag to record, removed afterwards. Default record_benchmark.\n"
+  "  --csv <file>                  Appends the results to a CSV file.\n";
+
+struct PublisherGroup
+{
+  size_t topics;
+  size_t message_size;
+  double rate;
+  bool best_effort;
+};
+
+struct BenchmarkOptions
+{
+  std::vector<PublisherGroup> publisher_groups;
+  size_t qos_depth = 10;
+  std::chrono::milliseconds duration{10000};
+  rosbag2_transport::StorageOptions storage_options;
+  uint64_t recorder_threads = 1;
+  std::string csv_file;
+};
+
+// Parses a group of topics given as <topics>x<bytes>@<rate>[:best_effort].
+PublisherGroup parse_publisher_group(const std::string & value)
+{
+  PublisherGroup group{};
+  auto size_position = value.find('x');
+  auto rate_position = value.find('@');
+  auto qos_position = value.find(':');
+  if (size_position == std::string::npos || rate_position == std::string::npos ||
+    rate_position < size_position)
+  {
+    throw std::invalid_argument("Invalid publishers '" + value + "'.");
+  }
+  try {
+    group.topics = std::stoul(value.substr(0, size_position));
+    group.message_size = std::stoul(
+      value.substr(size_position + 1, rate_position - size_position - 1));
+    group.rate = std::stod(value.substr(rate_position + 1, qos_position - rate_position - 1));
+  } catch (const std::logic_error &) {
+    throw std::invalid_argument("Invalid publishers '" + value + "'.");
+  }
+  if (qos_position != std::string::npos) {
+    auto reliability = value.substr(qos_position + 1);
+    if (reliability != "best_effort" && reliability != "reliable") {
+      throw std::invalid_argument("Unknown reliability '" + reliability + "'.");
+    }
+    group.best_effort = reliability == "best_effort";
+  }
+  if (group.topics == 0 || group.rate < 0) {
+    throw std::invalid_argument("Invalid publishers '" + value + "'.");
+  }
+  return group;
+}
+
+rosbag2_cpp::CacheOverflowPolicy parse_cache_overflow_policy(const std::string & value)
+{
+  if (value == "block") {
+    return rosbag2_cpp::CacheOverflowPolicy::BLOCK;
+  }
+  if (value == "drop_oldest") {
+    return rosbag2_cpp::CacheOverflowPolicy::DROP_OLDEST;
+  }
+  if (value == "drop_newest") {
+    return rosbag2_cpp::CacheOverflowPolicy::DROP_NEWEST;
+  }
+  throw std::invalid_argument("Unknown cache overflow policy '" + value + "'.");
+}
+
+/// \throws std::invalid_argument if the arguments are invalid.
+BenchmarkOptions parse_options(int argc, char ** argv)
+{
+  BenchmarkOptions options;
+  options.storage_options.uri = "record_benchmark";
+  options.storage_options.storage_id = "sqlite3";
+  options.storage_options.max_cache_size = 100;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (i + 1 == argc) {
+      throw std::invalid_argument("Missing value of " + option + ".");
+    }
+    std::string value = argv[++i];
+    if (option == "--publishers") {
+      options.publisher_groups.push_back(parse_publisher_group(value));
+    } else if (option == "--qos-depth") {
+      options.qos_depth = parse_number(option, value);
+    } else if (option == "--duration") {
+      options.duration = std::chrono::seconds(parse_number(option, value));
+    } else if (option == "--storage") {
+      options.storage_options.storage_id = value;
+    } else if (option == "--storage-preset-profile") {
+      options.storage_options.storage_preset_profile = value;
+    } else if (option == "--max-cache-size") {
+      options.storage_options.max_cache_size = parse_number(option, value);
+    } else if (option == "--cache-overflow-policy") {
+      options.storage_options.cache_overflow_policy = parse_cache_overflow_policy(value);
+    } else if (option == "--recorder-threads") {
+      options.recorder_threads = parse_number(option, value);
+    } else if (option == "--output") {
+      options.storage_options.uri = value;
+    } else if (option == "--csv") {
+      options.csv_file = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + option + ".");
+    }
+  }
+  if (options.publisher_groups.empty()) {
+    options.publisher_groups.push_back(PublisherGroup{10, 1000, 100.0, false});
+  }
+  return options;
+}
+
+std::chrono::nanoseconds thread_cpu_time()
+{
+#ifdef _WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time);
+  auto to_100ns = [](const FILETIME & time) {
+      return (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+  return std::chrono::nanoseconds((to_100ns(kernel_time) + to_100ns(user_time)) * 100);
+#else
+  timespec time{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#endif
+}
+
+std::chrono::nanoseconds process_cpu_time()
+{
+#ifdef _WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time);
+  auto to_100ns = [](const FILETIME & time) {
+      return (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+  return std::chrono::nanoseconds((to_100ns(kernel_time) + to_100ns(user_time)) * 100);
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#endif
+}
+
+// Messages and bytes passing a stage and the CPU time the stage used, updated from any thread.
+struct StageStatistics
+{
+  std::atomic<uint64_t> messages{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<int64_t> cpu_time_ns{0};
+
+  void add_message(const rosbag2_storage::SerializedBagMessage & message)
+  {
+    ++messages;
+    bytes += message.serialized_data ? message.serialized_data->buffer_length : 0;
+  }
+
+  void add_cpu_time(std::chrono::nanoseconds cpu_time)
+  {
+    cpu_time_ns += cpu_time.count();
+  }
+};
+
+// Adds the CPU time of the current thread during its lifetime to a stage.
+class ScopedCpuTimer
+{
+public:
+  explicit ScopedCpuTimer(StageStatistics & statistics)
+  : statistics_(statistics), start_(thread_cpu_time())
+  {}
+
+  ~ScopedCpuTimer()
+  {
+    statistics_.add_cpu_time(thread_cpu_time() - start_);
+  }
+
+private:
+  StageStatistics & statistics_;
+  std::chrono::nanoseconds start_;
+};
+
+// Storage counting the messages written and the CPU time used by the storage plugin it wraps.
+class MeasuredStorage : public rosbag2_storage::storage_interfaces::ReadWriteInterface
+{
+public:
+  MeasuredStorage(
+    std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage,
+    StageStatistics & statistics)
+  : storage_(std::move(storage)), statistics_(statistics)
+  {}
+
+  ~MeasuredStorage() override
+  {
+    // Closing the storage writes what it buffered.
+    ScopedCpuTimer timer(statistics_);
+    storage_.reset();
+  }
+
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag) override
+  {
+    storage_->open(uri, io_flag);
+  }
+
+  void open(
+    const std::string & uri,
+    rosbag2_storage::storage_interfaces::IOFlag io_flag,
+    const rosbag2_storage::StorageConfig & storage_config) override
+  {
+    storage_->open(uri, io_flag, storage_config);
+  }
+
+  void write(std::shared_ptr<const rosbag2_storage::SerializedBagMessage> message) override
+  {
+    ScopedCpuTimer timer(statistics_);
+    storage_->write(message);
+    statistics_.add_message(*message);
+  }
+
+  void write(
+    const std::vector<std::shared_ptr<const rosbag2_storage::SerializedBagMessage>> & messages)
+  override
+  {
+    ScopedCpuTimer timer(statistics_);
+    storage_->write(messages);
+    for (const auto & message : messages) {
+      statistics_.add_message(*message);
+    }
+  }
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic) override
+  {
+    storage_->create_topic(topic);
+  }
+
+  void remove_topic(const rosbag2_storage::TopicMetadata & topic) override
+  {
+    storage_->remove_topic(topic);
+  }
+
+  void set_topic_handle(
+    const std::string & topic_name, rosbag2_storage::TopicHandle handle) override
+  {
+    storage_->set_topic_handle(topic_name, handle);
+  }
+
+  bool has_next() override
+  {
+    return storage_->has_next();
+  }
+
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next() override
+  {
+    return storage_->read_next();
+  }
+
+  std::vector<rosbag2_storage::TopicMetadata> get_all_topics_and_types() override
+  {
+    return storage_->get_all_topics_and_types();
+  }
+
+  rosbag2_storage::BagMetadata get_metadata() override
+  {
+    return storage_->get_metadata();
+  }
+
+  std::string get_relative_file_path() const override
+  {
+    return storage_->get_relative_file_path();
+  }
+
+  uint64_t get_bagfile_size() const override
+  {
+    return storage_->get_bagfile_size();
+  }
+
+  std::string get_storage_identifier() const override
+  {
+    return storage_->get_storage_identifier();
+  }
+
+  rosbag2_storage::StorageCapabilities get_capabilities() const override
+  {
+    return storage_->get_capabilities();
+  }
+
+  uint64_t get_minimum_split_file_size() const override
+  {
+    return storage_->get_minimum_split_file_size();
+  }
+
+  void set_filter(const rosbag2_storage::StorageFilter & storage_filter) override
+  {
+    storage_->set_filter(storage_filter);
+  }
+
+  void reset_filter() override
+  {
+    storage_->reset_filter();
+  }
+
+private:
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage_;
+  StageStatistics & statistics_;
+};
+
+class MeasuredStorageFactory : public rosbag2_storage::StorageFactoryInterface
+{
+public:
+  explicit MeasuredStorageFactory(StageStatistics & statistics)
+  : statistics_(statistics)
+  {}
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadOnlyInterface>
+  open_read_only(const std::string & uri, const std::string & storage_id) override
+  {
+    return factory_.open_read_only(uri, storage_id);
+  }
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface>
+  open_read_write(const std::string & uri, const std::string & storage_id) override
+  {
+    return measure(factory_.open_read_write(uri, storage_id));
+  }
+
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface>
+  open_read_write(
+    const std::string & uri, const std::string & storage_id,
+    const rosbag2_storage::StorageConfig & storage_config) override
+  {
+    return measure(factory_.open_read_write(uri, storage_id, storage_config));
+  }
+
+private:
+  std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> measure(
+    std::shared_ptr<rosbag2_storage::storage_interfaces::ReadWriteInterface> storage)
+  {
+    if (!storage) {
+      return storage;
+    }
+    return std::make_shared<MeasuredStorage>(std::move(storage), statistics_);
+  }
+
+  rosbag2_storage::StorageFactory factory_;
+  StageStatistics & statistics_;
+};
+
+// Writer counting the messages handed over by the Recorder.
+class MeasuredWriter : public rosbag2_cpp::writer_interfaces::BaseWriterInterface
+{
+public:
+  MeasuredWriter(
+    std::unique_ptr<rosbag2_cpp::writer_interfaces::BaseWriterInterface> writer,
+    StageStatistics & statistics)
+  : writer_(std::move(writer)), statistics_(statistics)
+  {}
+
+  void open(
+    const rosbag2_cpp::StorageOptions & storage_options,
+    const rosbag2_cpp::ConverterOptions & converter_options) override
+  {
+    writer_->open(storage_options, converter_options);
+  }
+
+  void reset() override
+  {
+    writer_->reset();
+  }
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override
+  {
+    writer_->create_topic(topic_with_type);
+  }
+
+  void remove_topic(const rosbag2_storage::TopicMetadata & topic_with_type) override
+  {
+    writer_->remove_topic(topic_with_type);
+  }
+
+  void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override
+  {
+    statistics_.add_message(*message);
+    writer_->write(message);
+  }
+
+  rosbag2_storage::TopicHandle get_topic_handle(const std::string & topic_name) const override
+  {
+    return writer_->get_topic_handle(topic_name);
+  }
+
+  void add_event_callbacks(const rosbag2_cpp::bag_events::WriterEventCallbacks & callbacks)
+  override
+  {
+    writer_->add_event_callbacks(callbacks);
+  }
+
+  bool take_snapshot() override
+  {
+    return writer_->take_snapshot();
+  }
+
+private:
+  std::unique_ptr<rosbag2_cpp::writer_interfaces::BaseWriterInterface> writer_;
+  StageStatistics & statistics_;
+};
+
+struct BenchmarkResults
+{
+  StageStatistics published;
+  StageStatistics recorded;
+  StageStatistics stored;
+  std::chrono::nanoseconds publishing_time{0};
+  // From the start of publishing until every message is written and the bag is closed.
+  std::chrono::nanoseconds recording_time{0};
+  std::chrono::nanoseconds process_cpu_time{0};
+};
+
+// Publishes the messages of a group of topics at its rate, one message per topic at a time.
+void publish_group(
+  const PublisherGroup & group,
+  const std::vector<std::shared_ptr<rclcpp::Publisher<std_msgs::msg::ByteMultiArray>>> & publishers,
+  std::chrono::steady_clock::time_point end_time,
+  StageStatistics & statistics)
+{
+  std_msgs::msg::ByteMultiArray message;
+  message.data.resize(group.message_size, 0xA5);
+  rclcpp::SerializedMessage serialized_message;
+  rclcpp::Serialization<std_msgs::msg::ByteMultiArray> serialization;
+  serialization.serialize_message(&message, &serialized_message);
+  const auto serialized_size = serialized_message.size();
+
+  ScopedCpuTimer timer(statistics);
+  std::unique_ptr<rclcpp::WallRate> rate;
+  if (group.rate > 0) {
+    rate = std::make_unique<rclcpp::WallRate>(group.rate);
+  }
+  while (rclcpp::ok() && std::chrono::steady_clock::now() < end_time) {
+    for (const auto & publisher : publishers) {
+      publisher->publish(serialized_message);
+      ++statistics.messages;
+      statistics.bytes += serialized_size;
+    }
+    if (rate) {
+      rate->sleep();
+    }
+  }
+}
+
+bool wait_for_subscriptions(
+  const std::vector<std::vector<std::shared_ptr<rclcpp::Publisher<std_msgs::msg::ByteMultiArray>>>>
+  & publishers,
+  std::chrono::milliseconds timeout)
+{
+  auto end_time = std::chrono::steady_clock::now() + timeout;
+  for (const auto & group_publishers : publishers) {
+    for (const auto & publisher : group_publishers) {
+      while (publisher->get_subscription_count() == 0) {
+        if (!rclcpp::ok() || std::chrono::steady_clock::now() > end_time) {
+          return false;
+        }
+        std::this_thread::sleep_for(10ms);
+      }
+    }
+  }
+  return true;
+}
+
+// Waits until the Recorder received no message for a while, or gives up after the timeout.
+void wait_for_recorder_to_drain(const StageStatistics & recorded, std::chrono::seconds timeout)
+{
+  auto end_time = std::chrono::steady_clock::now() + timeout;
+  auto messages = recorded.messages.load();
+  while (std::chrono::steady_clock::now() < end_time) {
+    std::this_thread::sleep_for(500ms);
+    auto new_messages = recorded.messages.load();
+    if (new_messages == messages) {
+      return;
+    }
+    messages = new_messages;
+  }
+}
+
+void run_benchmark(const BenchmarkOptions & options, BenchmarkResults & results)
+{
+  auto node = std::make_shared<rclcpp::Node>(
+    "record_benchmark_publisher",
+    rclcpp::NodeOptions().start_parameter_event_publisher(false).enable_rosout(false));
+
+  rosbag2_transport::RecordOptions record_options{};
+  record_options.all = false;
+  record_options.is_discovery_disabled = false;
+  record_options.rmw_serialization_format = "cdr";
+  record_options.topic_polling_interval = 100ms;
+  record_options.recorder_threads = options.recorder_threads;
+
+  std::vector<std::vector<std::shared_ptr<rclcpp::Publisher<std_msgs::msg::ByteMultiArray>>>>
+  publishers;
+  for (size_t group = 0; group < options.publisher_groups.size(); ++group) {
+    const auto & publisher_group = options.publisher_groups[group];
+    rclcpp::QoS qos{rclcpp::KeepLast(options.qos_depth)};
+    if (publisher_group.best_effort) {
+      qos.best_effort();
+    }
+    publishers.emplace_back();
+    for (size_t topic = 0; topic < publisher_group.topics; ++topic) {
+      auto topic_name = "/record_benchmark/group" + std::to_string(group) + "/topic" +
+        std::to_string(topic);
+      publishers.back().push_back(
+        node->create_publisher<std_msgs::msg::ByteMultiArray>(topic_name, qos));
+      record_options.topics.push_back(topic_name);
+    }
+  }
+
+  auto writer = std::make_shared<rosbag2_cpp::Writer>(
+    std::make_unique<MeasuredWriter>(
+      std::make_unique<rosbag2_cpp::writers::SequentialWriter>(
+        std::make_unique<MeasuredStorageFactory>(results.stored)),
+      results.recorded));
+  auto recording = std::async(
+    std::launch::async, [&options, &record_options, writer]() {
+      rosbag2_transport::Rosbag2Transport transport(
+        std::make_shared<rosbag2_cpp::Reader>(
+          std::make_unique<rosbag2_cpp::readers::SequentialReader>()),
+        writer,
+        std::make_shared<rosbag2_cpp::Info>());
+      transport.record(options.storage_options, record_options);
+    });
+
+  if (!wait_for_subscriptions(publishers, 10s)) {
+    rclcpp::shutdown();
+    recording.get();
+    throw std::runtime_error("The recorder did not subscribe to the topics.");
+  }
+
+  auto process_cpu_start = process_cpu_time();
+  auto start_time = std::chrono::steady_clock::now();
+  auto end_time = start_time + options.duration;
+  std::vector<std::future<void>> publishing;
+  for (size_t group = 0; group < options.publisher_groups.size(); ++group) {
+    publishing.push_back(
+      std::async(
+        std::launch::async, publish_group, std::cref(options.publisher_groups[group]),
+        std::cref(publishers[group]), end_time, std::ref(results.published)));
+  }
+  for (auto & publisher_future : publishing) {
+    publisher_future.get();
+  }
+  results.publishing_time = std::chrono::steady_clock::now() - start_time;
+
+  wait_for_recorder_to_drain(results.recorded, 5s);
+  rclcpp::shutdown();
+  recording.get();
+  // Destroying the writer writes the cached messages and closes the storage.
+  writer.reset();
+  results.recording_time = std::chrono::steady_clock::now() - start_time;
+  results.process_cpu_time = process_cpu_time() - process_cpu_start;
+}
+
+void report(const BenchmarkOptions & options, const BenchmarkResults & results)
+{
+  struct Stage
+  {
+    std::string name;
+    const StageStatistics & statistics;
+    std::chrono::nanoseconds time;
+    std::chrono::nanoseconds cpu_time;
+  };
+  auto published_cpu = std::chrono::nanoseconds(results.published.cpu_time_ns.load());
+  auto stored_cpu = std::chrono::nanoseconds(results.stored.cpu_time_ns.load());
+  // Everything which is neither publishing nor the storage plugin, including the middleware.
+  auto recorded_cpu = std::max(
+    results.process_cpu_time - published_cpu - stored_cpu, std::chrono::nanoseconds(0));
+  std::vector<Stage> stages = {
+    {"publish", results.published, results.publishing_time, published_cpu},
+    {"record", results.recorded, results.recording_time, recorded_cpu},
+    {"storage", results.stored, results.recording_time, stored_cpu}
+  };
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::left << std::setw(10) << "stage" << std::right <<
+    std::setw(12) << "messages" << std::setw(12) << "msgs/s" << std::setw(10) << "MB/s" <<
+    std::setw(10) << "lost" << std::setw(10) << "lost %" << std::setw(10) << "CPU s" <<
+    std::setw(10) << "CPU %" << std::endl;
+
+  const auto published_messages = results.published.messages.load();
+  std::vector<std::string> csv_header = {"storage id", "preset profile", "duration (s)"};
+  std::vector<std::string> csv_values = {
+    options.storage_options.storage_id, options.storage_options.storage_preset_profile,
+    std::to_string(to_seconds(results.publishing_time))};
+  uint64_t previous_messages = published_messages;
+  for (const auto & stage : stages) {
+    auto messages = stage.statistics.messages.load();
+    auto seconds = to_seconds(stage.time);
+    auto lost = previous_messages > messages ? previous_messages - messages : 0;
+    auto messages_per_second = seconds > 0 ? messages / seconds : 0.0;
+    auto megabytes_per_second = seconds > 0 ? stage.statistics.bytes.load() / seconds / 1e6 : 0.0;
+    auto lost_percent = previous_messages > 0 ? 100.0 * lost / previous_messages : 0.0;
+    auto cpu_seconds = to_seconds(stage.cpu_time);
+    auto cpu_percent = seconds > 0 ? 100.0 * cpu_seconds / seconds : 0.0;
+    std::cout << std::left << std::setw(10) << stage.name << std::right <<
+      std::setw(12) << messages << std::setw(12) << messages_per_second <<
+      std::setw(10) << megabytes_per_second << std::setw(10) << lost <<
+      std::setw(10) << lost_percent << std::setw(10) << cpu_seconds <<
+      std::setw(10) << cpu_percent << std::endl;
+    for (const auto & column : {"messages", "msgs/s", "MB/s", "lost", "CPU s"}) {
+      csv_header.push_back(stage.name + " " + column);
+    }
+    csv_values.insert(
+      csv_values.end(), {
+        std::to_string(messages), std::to_string(messages_per_second),
+        std::to_string(megabytes_per_second), std::to_string(lost),
+        std::to_string(cpu_seconds)});
+    previous_messages = messages;
+  }
+  std::cout << "total lost: " << (published_messages - std::min(
+      published_messages, results.stored.messages.load())) << " of " << published_messages <<
+    " messages, process CPU: " << to_seconds(results.process_cpu_time) << " s" << std::endl;
+
+  if (!options.csv_file.empty()) {
+    append_csv_row(options.csv_file, csv_header, csv_values);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  BenchmarkOptions options;
+  try {
+    options = parse_options(argc, argv);
+  } catch (const std::invalid_argument & e) {
+    std::cerr << e.what() << std::endl << kUsage;
+    return EXIT_FAILURE;
+  }
+  if (rcpputils::fs::exists(rcpputils::fs::path(options.storage_options.uri))) {
+    std::cerr << "The bag " << options.storage_options.uri << " already exists." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  rclcpp::init(0, nullptr);
+  BenchmarkResults results;
+  int exit_code = EXIT_SUCCESS;
+  try {
+    run_benchmark(options, results);
+    report(options, results);
+  } catch (const std::exception & e) {
+    std::cerr << "Benchmark failed: " << e.what() << std::endl;
+    exit_code = EXIT_FAILURE;
+  }
+  rclcpp::shutdown();
+  try {
+    remove_bag(options.storage_options.uri);
+  } catch (const std::exception & e) {
+    std::cerr << "Failed to remove the bag: " << e.what() << std::endl;
+  }
+  return exit_code;
+}
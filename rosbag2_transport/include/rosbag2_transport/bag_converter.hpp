@@ -0,0 +1,136 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TRANSPORT__BAG_CONVERTER_HPP_
+#define ROSBAG2_TRANSPORT__BAG_CONVERTER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "rosbag2_cpp/info.hpp"
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/writer.hpp"
+
+#include "rosbag2_storage/bag_metadata.hpp"
+#include "rosbag2_storage/metadata_io.hpp"
+
+#include "rosbag2_transport/convert_options.hpp"
+#include "rosbag2_transport/storage_options.hpp"
+#include "rosbag2_transport/visibility_control.hpp"
+
+namespace rosbag2_transport
+{
+
+struct ConversionSummary
+{
+  uint64_t message_count = 0;
+  // Size of the serialized messages written, before any compression.
+  uint64_t bytes = 0;
+  // Wall time of the conversion, including finishing the converted bag.
+  std::chrono::nanoseconds duration{0};
+};
+
+/**
+ * Writes the messages of one or more bags to a new bag, e.g. to leave out topics, to recompress
+ * it, to change its storage or serialization format, or to re-split it by the split options of
+ * the output bag.
+ *
+ * Reading, converting the serialization format and writing (including compressing) run on
+ * threads of their own, which pass batches of messages on. Several bags are read on a thread
+ * each and merged into one timeline by time stamp, holding at most a few batches of every bag.
+ * With ConvertOptions::keep_splits, the bagfiles of a single bag are converted in parallel
+ * instead.
+ */
+class BagConverter
+{
+public:
+  /// Creates the reader of the bag with the given metadata.
+  using ReaderFactory = std::function<
+    std::unique_ptr<rosbag2_cpp::Reader>(const rosbag2_storage::BagMetadata & metadata)>;
+  /// Creates the writer of the converted bag.
+  using WriterFactory = std::function<
+    std::unique_ptr<rosbag2_cpp::Writer>(const ConvertOptions & convert_options)>;
+
+  /// Readers and writers depend on the compression of the bags, see the default factories.
+  ROSBAG2_TRANSPORT_PUBLIC
+  BagConverter();
+
+  /// Constructor for testing, allows to set the readers, writers and bag info to use
+  ROSBAG2_TRANSPORT_PUBLIC
+  BagConverter(
+    ReaderFactory reader_factory, WriterFactory writer_factory,
+    std::shared_ptr<rosbag2_cpp::Info> info,
+    std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io =
+    std::make_unique<rosbag2_storage::MetadataIo>());
+
+  /**
+   * Converts the bag.
+   *
+   * \param input_options Options of the bag to read, i.e. its uri and storage.
+   * \param output_options Options of the bag to write, e.g. its uri, storage and splitting.
+   * \param convert_options Topics, serialization format and compression of the converted bag.
+   * \return The number and size of the messages written and the time it took.
+   * \throws std::invalid_argument if the options cannot be applied to the bag.
+   * \throws std::runtime_error if the bag cannot be read or written.
+   */
+  ROSBAG2_TRANSPORT_PUBLIC
+  ConversionSummary convert(
+    const StorageOptions & input_options, const StorageOptions & output_options,
+    const ConvertOptions & convert_options);
+
+  /**
+   * Merges the bags into one bag, ordered by time stamp. Messages of the same time stamp are
+   * written in the order of the bags.
+   *
+   * All bags need to have the same serialization format, and topics of the same name the same
+   * type.
+   *
+   * \sa convert(const StorageOptions &, const StorageOptions &, const ConvertOptions &)
+   */
+  ROSBAG2_TRANSPORT_PUBLIC
+  ConversionSummary convert(
+    const std::vector<StorageOptions> & input_options, const StorageOptions & output_options,
+    const ConvertOptions & convert_options);
+
+  /// Reads compressed bags with a compression reader and bags of overlapping files merged.
+  ROSBAG2_TRANSPORT_PUBLIC
+  static std::unique_ptr<rosbag2_cpp::Reader> make_default_reader(
+    const rosbag2_storage::BagMetadata & metadata);
+
+  /// Writes with a compression writer if a compression format is set.
+  ROSBAG2_TRANSPORT_PUBLIC
+  static std::unique_ptr<rosbag2_cpp::Writer> make_default_writer(
+    const ConvertOptions & convert_options);
+
+private:
+  ConversionSummary convert_bags(
+    const std::vector<StorageOptions> & input_options, const StorageOptions & output_options,
+    const ConvertOptions & convert_options,
+    const std::vector<rosbag2_storage::BagMetadata> & metadata, size_t conversion_threads);
+  ConversionSummary convert_splits(
+    const StorageOptions & input_options, const StorageOptions & output_options,
+    const ConvertOptions & convert_options, const rosbag2_storage::BagMetadata & metadata);
+
+  ReaderFactory reader_factory_;
+  WriterFactory writer_factory_;
+  std::shared_ptr<rosbag2_cpp::Info> info_;
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io_;
+};
+
+}  // namespace rosbag2_transport
+
+#endif  // ROSBAG2_TRANSPORT__BAG_CONVERTER_HPP_
@@ -0,0 +1,54 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TRANSPORT__CONVERT_OPTIONS_HPP_
+#define ROSBAG2_TRANSPORT__CONVERT_OPTIONS_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "rosbag2_compression/compression_options.hpp"
+
+namespace rosbag2_transport
+{
+
+struct ConvertOptions
+{
+public:
+  // Topic names to convert. If the list is empty, all topics are converted.
+  std::vector<std::string> topics = {};
+  // Topics matching this regular expression are left out of the converted bag. Empty for none.
+  std::string exclude = "";
+
+  // Serialization format of the messages of the converted bag. Empty to keep the format.
+  std::string output_serialization_format = "";
+
+  // Compression of the converted bag. Not compressed if the compression format is empty.
+  rosbag2_compression::CompressionOptions compression_options{
+    "", rosbag2_compression::CompressionMode::NONE};
+
+  // Convert every bagfile into a bagfile of its own, all files at once, instead of reading the
+  // whole bag in order. Requires an uncompressed bag whose files do not overlap in time, and no
+  // splitting or dictionary training of the converted bag.
+  bool keep_splits = false;
+
+  // Threads converting the serialization format of the messages, or bagfiles at once with
+  // keep_splits. 0 for one per processor.
+  size_t max_threads = 0;
+};
+
+}  // namespace rosbag2_transport
+
+#endif  // ROSBAG2_TRANSPORT__CONVERT_OPTIONS_HPP_
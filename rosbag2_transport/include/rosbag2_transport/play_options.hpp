@@ -15,16 +15,36 @@
 #ifndef ROSBAG2_TRANSPORT__PLAY_OPTIONS_HPP_
 #define ROSBAG2_TRANSPORT__PLAY_OPTIONS_HPP_
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "rclcpp/qos.hpp"
 
+#include "rosbag2_cpp/message_transform_chain.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+
 namespace rosbag2_transport
 {
 
+// Progress of a playback, see PlayOptions::progress_callback.
+struct PlayProgress
+{
+  // Messages played, counted from the start of the current loop when looping.
+  uint64_t played_messages = 0;
+  // Messages of the bag, 0 if the bag has no metadata.
+  uint64_t total_messages = 0;
+  // Time stamp of the message played last in nanoseconds, 0 if none was played yet.
+  int64_t time_stamp = 0;
+  // Time since playing started, including waiting for subscribers and looping.
+  std::chrono::nanoseconds elapsed{0};
+};
+
 struct PlayOptions
 {
 public:
@@ -39,6 +59,105 @@ public:
 
   std::unordered_map<std::string, rclcpp::QoS> topic_qos_profile_overrides = {};
   bool loop = false;
+
+  // Topics whose latest message before the time playback starts at or seeks to is published
+  // right away, like the values of topics published once, e.g. a map or parameters. Topics
+  // recorded with transient local durability, e.g. /tf_static, are latched in any case.
+  std::vector<std::string> latched_topics = {};
+
+  // Seconds into the bag to start playing at. The messages before are skipped by seeking.
+  double start_offset = 0.0;
+  // Seconds of the bag to play, counted from the start offset. 0 plays until the end of the bag.
+  double duration = 0.0;
+
+  // Play the messages in the order and at the time they were published at instead of the time
+  // they were recorded at. Messages recorded without publish time keep their receive time.
+  bool order_by_publish_time = false;
+
+  // Bytes of serialized data the read-ahead queue holds at most, in addition to the limit of
+  // read_ahead_queue_size messages. 0 for no limit.
+  size_t read_ahead_queue_bytes = 0;
+
+  // Time before a message is due at which the player stops sleeping and busy-waits instead.
+  // Avoids the wake-up latency of the scheduler at the cost of keeping a core busy.
+  std::chrono::microseconds busy_wait_period{0};
+  // SCHED_FIFO priority of the publishing thread, 0 keeps the normal scheduling. Linux only.
+  int realtime_priority = 0;
+  // CPUs the publishing thread is pinned to, empty to not pin it. Linux only.
+  std::vector<int> cpu_affinity = {};
+
+  // Threads publishing the messages once they are due, each for its share of the topics, so a
+  // slow publish only delays the topics of its thread. 0 publishes on the playing thread.
+  size_t publishing_threads = 0;
+
+  // Publish every message as soon as the one before is published, regardless of the recorded
+  // timing and the rate, e.g. to benchmark the reader or to feed offline pipelines.
+  bool as_fast_as_possible = false;
+  // Number of subscriptions every topic needs to be matched with before playing starts, 0 to
+  // start right away.
+  size_t wait_for_subscribers = 0;
+
+  // Create the publisher of a topic when its first message is read ahead of playing it, instead
+  // of creating the publishers of all played topics before playing starts. Saves creating and
+  // discovering publishers of topics without messages in the played time range, but subscribers
+  // may miss the first messages of a topic until they discovered its publisher. Ignored when
+  // waiting for subscribers.
+  bool lazy_publishers = false;
+
+  // Frequency in Hz at which the bag time is published on /clock while playing, scaled by the
+  // rate, 0 to not publish it.
+  double clock_publish_frequency = 0.0;
+
+  // Rewrite the header.stamp of the played messages to the time they are published at, in their
+  // serialized data without deserializing them: to the bag time if the clock is published, to
+  // the system time otherwise. Messages of types without header.stamp are played unchanged.
+  bool rewrite_header_stamps = false;
+
+  // Start in paused state, waiting for the ~/resume or ~/play_next service of the player node.
+  bool start_paused = false;
+
+  // Time of the reference clock in nanoseconds since epoch at which playing starts, so the players
+  // of several hosts start together, 0 to start right away. The reference clock is the system
+  // clock plus the clock_offset in nanoseconds, like when recording with a clock offset. Messages
+  // due before a start time which passed already are published right away, to catch up. Ignored
+  // when playing as fast as possible.
+  int64_t start_at = 0;
+  int64_t clock_offset = 0;
+  // Time stamp of the bag which is due at start_at, 0 for the first message played.
+  int64_t start_at_time_stamp = 0;
+
+  // Folder of the bag of a host in a bag finalized from the bags of several hosts, see
+  // rosbag2_cpp::DistributedBagFinalizer, to play only the topics the host recorded. Its messages
+  // are played on the timeline of the whole bag: start_offset is counted from the start of the
+  // whole bag, which is due at start_at. Empty plays the whole bag. Used for a single bag only.
+  std::string host_folder = "";
+
+  // Bytes of serialized data up to which the messages of the first loop are kept in memory, so
+  // the following loops do not read the bag again. 0 to always read from storage.
+  size_t loop_cache_bytes = 0;
+
+  // Read the whole bag into memory before playing, so playback does not access the storage.
+  // The serialized data is held once, and shared by the messages queued for playing, so
+  // preload_max_bytes caps the memory used. Preloaded messages are kept after being played, as
+  // they are played again when looping. Bags with more than preload_max_bytes of serialized data
+  // are played from storage instead, 0 for no limit.
+  bool preload = false;
+  size_t preload_max_bytes = 0;
+
+  // Called every progress_interval while playing, from the thread serving the player node, if
+  // set. Slow callbacks delay the control services but not the playback.
+  std::function<void(const PlayProgress &)> progress_callback = nullptr;
+  std::chrono::milliseconds progress_interval{1000};
+
+  // Scheduling of the threads started while playing by their role, applied when they start,
+  // e.g. of the publishing threads. Roles not given are scheduled like the background threads.
+  std::map<rosbag2_cpp::ThreadRole, rosbag2_cpp::ThreadScheduling> thread_scheduling{};
+
+  // Transforms of the topics and the messages read from the bag before they are published, in
+  // order, e.g. to remap, filter or downsample topics without a relay node. Topic options like
+  // topics_to_filter and latched_topics refer to the topics of the bag, QoS overrides to the
+  // topics as published.
+  std::vector<rosbag2_cpp::MessageTransformOptions> transforms{};
 };
 
 }  // namespace rosbag2_transport
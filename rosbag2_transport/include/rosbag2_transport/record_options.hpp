@@ -16,14 +16,39 @@
 #define ROSBAG2_TRANSPORT__RECORD_OPTIONS_HPP_
 
 #include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 
+#include "rosbag2_cpp/message_transform_chain.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+
 namespace rosbag2_transport
 {
+// Limits the messages recorded from a topic, see MessageThrottle.
+struct TopicThrottle
+{
+  // Records only every decimation-th message received, 1 records every message.
+  uint64_t decimation = 1;
+  // Highest rate in Hz at which messages are recorded, 0 for no limit.
+  double max_frequency = 0.0;
+};
+
+// Progress of a recording, see RecordOptions::progress_callback.
+struct RecordProgress
+{
+  // Messages and bytes of serialized data written to the bag.
+  uint64_t recorded_messages = 0;
+  uint64_t recorded_bytes = 0;
+  // Time since recording started, including waiting for topics.
+  std::chrono::nanoseconds elapsed{0};
+};
+
 struct RecordOptions
 {
 public:
@@ -35,8 +60,43 @@ public:
   std::string node_prefix = "";
   std::string compression_mode = "";
   std::string compression_format = "";
+  // Threads compressing closed bagfiles and closed bagfiles waiting for them in FILE mode.
+  uint64_t compression_threads = 1;
+  uint64_t compression_queue_size = 1;
+  int compression_level = 1;
+  uint64_t compression_worker_threads = 0;
+  uint64_t dictionary_training_messages = 0;
+  std::string compression_dictionary = "";
+  uint64_t chunk_max_bytes = 1024 * 1024;
+  uint64_t chunk_max_duration_ms = 0;
+  bool adaptive_compression_level = false;
+  int compression_level_min = 1;
+  int compression_level_max = 9;
   std::unordered_map<std::string, rclcpp::QoS> topic_qos_profile_overrides{};
   bool include_hidden_topics = false;
+  // Threads receiving messages. With more than one, every topic gets its own callback group and
+  // the received messages are written by a separate thread. 0 uses one thread per CPU core.
+  uint64_t recorder_threads = 1;
+  // Throttling of individual topics by their full name. Other topics are recorded completely.
+  std::unordered_map<std::string, TopicThrottle> topic_throttles{};
+  // Regular expressions selecting the topics recorded if no topics are given. Topics are recorded
+  // if any part of their name matches `regex` and none matches `exclude`. Empty to not filter.
+  std::string regex = "";
+  std::string exclude = "";
+  // Period of publishing the recorder statistics on ~/statistics, 0 to not publish them.
+  std::chrono::milliseconds statistics_interval{0};
+  // Called every progress_interval while recording, from a thread receiving the messages, if
+  // set. Slow callbacks delay receiving the messages of that thread.
+  std::function<void(const RecordProgress &)> progress_callback = nullptr;
+  std::chrono::milliseconds progress_interval{1000};
+  // Scheduling of the threads started while recording by their role, applied when they start:
+  // the threads receiving the messages, writing them and compressing them. Roles not given are
+  // scheduled like the background threads.
+  std::map<rosbag2_cpp::ThreadRole, rosbag2_cpp::ThreadScheduling> thread_scheduling{};
+  // Transforms of the topics and the received messages before they are written, in order, e.g.
+  // to remap, filter or downsample topics without a relay node. Throttled messages are dropped
+  // before, and topic options like the throttles refer to the topics as received.
+  std::vector<rosbag2_cpp::MessageTransformOptions> transforms{};
 };
 
 }  // namespace rosbag2_transport
@@ -20,6 +20,8 @@
 #include <string>
 #include <vector>
 
+#include "rosbag2_cpp/readers/multi_bag_reader.hpp"
+
 #include "rosbag2_transport/play_options.hpp"
 #include "rosbag2_transport/record_options.hpp"
 #include "rosbag2_transport/storage_options.hpp"
@@ -76,13 +78,30 @@ public:
   ROSBAG2_TRANSPORT_PUBLIC
   void play(const StorageOptions & storage_options, const PlayOptions & play_options);
 
+  /**
+   * Replay the bagfiles of several bags together, e.g. recorded by several recorders during the
+   * same run. Their messages are merged by time stamp while every bag is read ahead on a thread
+   * of its own. A single bag is played like play() does.
+   *
+   * \param storage_options Options regarding the storage of every bag
+   * \param play_options Options regarding the playback (e.g. queue size)
+   * \param reader_factory creates the reader of a bag, a SequentialReader if empty
+   */
+  ROSBAG2_TRANSPORT_PUBLIC
+  void play(
+    const std::vector<StorageOptions> & storage_options, const PlayOptions & play_options,
+    rosbag2_cpp::readers::MultiBagReader::ReaderFactory reader_factory = nullptr);
+
   /**
    * Print the bag info contained in the metadata yaml file.
    *
    * \param uri path to the metadata yaml file.
+   * \param verbose whether to print the sizes of the topics, which are read from the bagfiles
+   * if the metadata has none.
    */
   ROSBAG2_TRANSPORT_PUBLIC
-  void print_bag_info(const std::string & uri, const std::string & storage_id);
+  void print_bag_info(
+    const std::string & uri, const std::string & storage_id, bool verbose = false);
 
 private:
   std::shared_ptr<Rosbag2Node> setup_node(std::string node_prefix = "");
@@ -0,0 +1,651 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rosbag2_transport/bag_converter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/filesystem_helper.hpp"
+
+#include "rosbag2_compression/sequential_compression_reader.hpp"
+#include "rosbag2_compression/sequential_compression_writer.hpp"
+
+#include "rosbag2_cpp/converter.hpp"
+#include "rosbag2_cpp/readers/merging_reader.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+#include "rosbag2_storage/message_histogram.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+
+namespace rosbag2_transport
+{
+
+namespace
+{
+
+using MessageBatch = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+
+// Messages are passed between the stages in batches of at most this many messages or bytes,
+// and each stage queues up to QUEUED_BATCHES batches for the next one.
+constexpr const size_t BATCH_MESSAGES = 1024;
+constexpr const size_t BATCH_BYTES = 16 * 1024 * 1024;
+constexpr const size_t QUEUED_BATCHES = 4;
+
+/// Blocking queue between two stages, which either stage closes when it stops.
+class StageQueue
+{
+public:
+  /// \return false if the queue is closed, i.e. the next stage stopped.
+  bool push(MessageBatch batch)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] {return closed_ || batches_.size() < QUEUED_BATCHES;});
+    if (closed_) {
+      return false;
+    }
+    batches_.push_back(std::move(batch));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /// \return false if the queue is closed and all batches are taken.
+  bool pop(MessageBatch & batch)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] {return closed_ || !batches_.empty();});
+    if (batches_.empty()) {
+      return false;
+    }
+    batch = std::move(batches_.front());
+    batches_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<MessageBatch> batches_;
+  bool closed_ = false;
+};
+
+/// Reads the batches of messages of the topics from the bag.
+void read_batches(
+  rosbag2_cpp::Reader & reader, const std::unordered_set<std::string> & topics,
+  StageQueue & batches)
+{
+  for (auto batch = reader.read_next_batch(BATCH_MESSAGES, BATCH_BYTES); !batch.empty();
+    batch = reader.read_next_batch(BATCH_MESSAGES, BATCH_BYTES))
+  {
+    batch.erase(
+      std::remove_if(
+        batch.begin(), batch.end(),
+        [&topics](const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message) {
+          return topics.count(message->topic_name) == 0;
+        }), batch.end());
+    if (!batch.empty() && !batches.push(std::move(batch))) {
+      return;
+    }
+  }
+}
+
+/// Merges the batches of several bags by time stamp, of equal time stamps in the order of the bags.
+void merge_batches(std::vector<StageQueue> & bag_batches, StageQueue & merged_batches)
+{
+  struct Cursor
+  {
+    MessageBatch batch;
+    size_t next = 0;
+  };
+  std::vector<Cursor> cursors(bag_batches.size());
+  using NextMessage = std::pair<rcutils_time_point_value_t, size_t>;
+  std::priority_queue<NextMessage, std::vector<NextMessage>, std::greater<NextMessage>>
+  next_messages;
+  // Waits for the next batch of the bag once its batch is merged, as its next message may be
+  // the earliest one.
+  const auto advance = [&](size_t bag) {
+      auto & cursor = cursors[bag];
+      if (cursor.next == cursor.batch.size()) {
+        cursor.batch.clear();
+        cursor.next = 0;
+        if (!bag_batches[bag].pop(cursor.batch)) {
+          return;
+        }
+      }
+      next_messages.emplace(cursor.batch[cursor.next]->time_stamp, bag);
+    };
+  for (size_t bag = 0; bag < cursors.size(); ++bag) {
+    advance(bag);
+  }
+
+  MessageBatch batch;
+  size_t batch_bytes = 0;
+  while (!next_messages.empty()) {
+    const auto bag = next_messages.top().second;
+    next_messages.pop();
+    auto & message = cursors[bag].batch[cursors[bag].next++];
+    batch_bytes += message->serialized_data ? message->serialized_data->buffer_length : 0;
+    batch.push_back(std::move(message));
+    advance(bag);
+    if (batch.size() >= BATCH_MESSAGES || batch_bytes >= BATCH_BYTES) {
+      if (!merged_batches.push(std::move(batch))) {
+        return;
+      }
+      batch.clear();
+      batch_bytes = 0;
+    }
+  }
+  if (!batch.empty()) {
+    merged_batches.push(std::move(batch));
+  }
+}
+
+/// Reads, converts and writes the messages of the topics, each stage on a thread of its own.
+/// Several bags are read on a thread each and merged by a stage of their own.
+ConversionSummary run_pipeline(
+  const std::vector<std::unique_ptr<rosbag2_cpp::Reader>> & readers,
+  rosbag2_cpp::Writer & writer, rosbag2_cpp::Converter * converter,
+  const std::unordered_set<std::string> & topics)
+{
+  const bool merges = readers.size() > 1;
+  std::vector<StageQueue> bag_batches(merges ? readers.size() : 0);
+  StageQueue merged_batches;
+  StageQueue converted_batches;
+  std::vector<std::exception_ptr> read_errors(readers.size());
+  std::exception_ptr merge_error;
+  std::exception_ptr conversion_error;
+  std::exception_ptr write_error;
+
+  std::vector<std::thread> read_threads;
+  for (size_t i = 0; i < readers.size(); ++i) {
+    read_threads.emplace_back(
+      [&, i]() {
+        rosbag2_cpp::ThreadPool::configure_current_thread();
+        auto & batches = merges ? bag_batches[i] : merged_batches;
+        try {
+          read_batches(*readers[i], topics, batches);
+        } catch (...) {
+          read_errors[i] = std::current_exception();
+          // Does not merge the remaining bags without the messages of this one.
+          merged_batches.close();
+        }
+        batches.close();
+      });
+  }
+  std::thread merge_thread;
+  if (merges) {
+    merge_thread = std::thread(
+      [&]() {
+        rosbag2_cpp::ThreadPool::configure_current_thread();
+        try {
+          merge_batches(bag_batches, merged_batches);
+        } catch (...) {
+          merge_error = std::current_exception();
+        }
+        for (auto & batches : bag_batches) {
+          batches.close();
+        }
+        merged_batches.close();
+      });
+  }
+  std::thread conversion_thread([&]() {
+      rosbag2_cpp::ThreadPool::configure_current_thread();
+      try {
+        MessageBatch batch;
+        while (merged_batches.pop(batch)) {
+          if (converter) {
+            converter->convert(batch);
+          }
+          if (!converted_batches.push(std::move(batch))) {
+            break;
+          }
+        }
+      } catch (...) {
+        conversion_error = std::current_exception();
+      }
+      // Also stops reading if converting failed.
+      merged_batches.close();
+      converted_batches.close();
+    });
+
+  ConversionSummary summary{};
+  try {
+    MessageBatch batch;
+    while (converted_batches.pop(batch)) {
+      for (auto & message : batch) {
+        const auto size = message->serialized_data ? message->serialized_data->buffer_length : 0;
+        writer.write(std::move(message));
+        ++summary.message_count;
+        summary.bytes += size;
+      }
+    }
+  } catch (...) {
+    write_error = std::current_exception();
+  }
+  merged_batches.close();
+  converted_batches.close();
+  for (auto & batches : bag_batches) {
+    batches.close();
+  }
+  conversion_thread.join();
+  if (merge_thread.joinable()) {
+    merge_thread.join();
+  }
+  for (auto & thread : read_threads) {
+    thread.join();
+  }
+
+  for (const auto & error : read_errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  for (const auto & error : {merge_error, conversion_error, write_error}) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return summary;
+}
+
+bool has_overlapping_files(const rosbag2_storage::BagMetadata & metadata)
+{
+  // Stripes and topic groups are written at the same time, i.e. their files overlap in time.
+  return std::any_of(
+    metadata.files.begin(), metadata.files.end(),
+    [](const rosbag2_storage::FileInformation & file) {
+      return file.stripe > 0 || !file.topics.empty();
+    });
+}
+
+std::string resolve_path(
+  const std::string & uri, const std::string & relative_file_path, int version)
+{
+  const auto path = rcpputils::fs::path(relative_file_path);
+  if (path.is_absolute()) {
+    return path.string();
+  }
+  // In bags before version 4, file paths are prefixed with the bag directory.
+  const auto base_path =
+    version < 4 ? rcpputils::fs::path(uri).parent_path() : rcpputils::fs::path(uri);
+  return (base_path / path).string();
+}
+
+void move_file(const std::string & from, const std::string & to)
+{
+  if (std::rename(from.c_str(), to.c_str()) != 0) {
+    throw std::runtime_error("Could not move bagfile '" + from + "' to '" + to + "'.");
+  }
+}
+
+void validate_options(
+  const StorageOptions & output_options, const ConvertOptions & convert_options)
+{
+  try {
+    std::regex exclude(convert_options.exclude);
+  } catch (const std::regex_error & e) {
+    throw std::invalid_argument(
+            "Invalid regular expression of the excluded topics: " + std::string(e.what()));
+  }
+  if (!convert_options.keep_splits) {
+    return;
+  }
+  if (output_options.max_bagfile_size > 0 || output_options.max_bagfile_duration > 0 ||
+    output_options.max_bagfile_messages > 0)
+  {
+    throw std::invalid_argument("Splits cannot be kept if the converted bag is split itself.");
+  }
+  if (convert_options.compression_options.dictionary_training_messages > 0 ||
+    !convert_options.compression_options.compression_dictionary.empty())
+  {
+    throw std::invalid_argument(
+            "Splits cannot be kept if the converted bag is compressed with a dictionary.");
+  }
+}
+
+}  // namespace
+
+BagConverter::BagConverter()
+: BagConverter(
+    &BagConverter::make_default_reader, &BagConverter::make_default_writer,
+    std::make_shared<rosbag2_cpp::Info>())
+{}
+
+BagConverter::BagConverter(
+  ReaderFactory reader_factory, WriterFactory writer_factory,
+  std::shared_ptr<rosbag2_cpp::Info> info,
+  std::unique_ptr<rosbag2_storage::MetadataIo> metadata_io)
+: reader_factory_(std::move(reader_factory)),
+  writer_factory_(std::move(writer_factory)),
+  info_(std::move(info)),
+  metadata_io_(std::move(metadata_io))
+{}
+
+std::unique_ptr<rosbag2_cpp::Reader> BagConverter::make_default_reader(
+  const rosbag2_storage::BagMetadata & metadata)
+{
+  if (!metadata.compression_format.empty()) {
+    return std::make_unique<rosbag2_cpp::Reader>(
+      std::make_unique<rosbag2_compression::SequentialCompressionReader>());
+  }
+  if (has_overlapping_files(metadata)) {
+    return std::make_unique<rosbag2_cpp::Reader>(
+      std::make_unique<rosbag2_cpp::readers::MergingReader>());
+  }
+  return std::make_unique<rosbag2_cpp::Reader>(
+    std::make_unique<rosbag2_cpp::readers::SequentialReader>());
+}
+
+std::unique_ptr<rosbag2_cpp::Writer> BagConverter::make_default_writer(
+  const ConvertOptions & convert_options)
+{
+  if (!convert_options.compression_options.compression_format.empty()) {
+    return std::make_unique<rosbag2_cpp::Writer>(
+      std::make_unique<rosbag2_compression::SequentialCompressionWriter>(
+        convert_options.compression_options));
+  }
+  return std::make_unique<rosbag2_cpp::Writer>(
+    std::make_unique<rosbag2_cpp::writers::SequentialWriter>());
+}
+
+ConversionSummary BagConverter::convert(
+  const StorageOptions & input_options, const StorageOptions & output_options,
+  const ConvertOptions & convert_options)
+{
+  return convert(std::vector<StorageOptions>{input_options}, output_options, convert_options);
+}
+
+ConversionSummary BagConverter::convert(
+  const std::vector<StorageOptions> & input_options, const StorageOptions & output_options,
+  const ConvertOptions & convert_options)
+{
+  if (input_options.empty()) {
+    throw std::invalid_argument("No bag to convert.");
+  }
+  validate_options(output_options, convert_options);
+  if (convert_options.keep_splits && input_options.size() > 1) {
+    throw std::invalid_argument("Splits cannot be kept if several bags are merged.");
+  }
+  std::vector<rosbag2_storage::BagMetadata> metadata;
+  for (const auto & options : input_options) {
+    metadata.push_back(info_->read_metadata(options.uri, options.storage_id));
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  ConversionSummary summary{};
+  if (convert_options.keep_splits) {
+    if (!metadata[0].compression_format.empty() || has_overlapping_files(metadata[0])) {
+      throw std::invalid_argument(
+              "Splits can only be kept for uncompressed bags whose files do not overlap.");
+    }
+    summary = convert_splits(input_options[0], output_options, convert_options, metadata[0]);
+  } else {
+    // The converter uses its threads in addition to the thread running the conversion stage.
+    const auto max_threads = convert_options.max_threads > 0 ?
+      convert_options.max_threads : std::max(1u, std::thread::hardware_concurrency());
+    summary = convert_bags(
+      input_options, output_options, convert_options, metadata, max_threads - 1);
+  }
+  summary.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start);
+  return summary;
+}
+
+ConversionSummary BagConverter::convert_bags(
+  const std::vector<StorageOptions> & input_options, const StorageOptions & output_options,
+  const ConvertOptions & convert_options,
+  const std::vector<rosbag2_storage::BagMetadata> & metadata, size_t conversion_threads)
+{
+  std::string input_format;
+  for (const auto & bag_metadata : metadata) {
+    if (bag_metadata.topics_with_message_count.empty()) {
+      continue;
+    }
+    const auto & format =
+      bag_metadata.topics_with_message_count[0].topic_metadata.serialization_format;
+    if (!input_format.empty() && format != input_format) {
+      throw std::invalid_argument(
+              "Bags of the serialization formats '" + input_format + "' and '" + format +
+              "' cannot be merged.");
+    }
+    input_format = format;
+  }
+  const auto output_format = convert_options.output_serialization_format.empty() ?
+    input_format : convert_options.output_serialization_format;
+
+  std::vector<std::unique_ptr<rosbag2_cpp::Reader>> readers;
+  for (size_t i = 0; i < input_options.size(); ++i) {
+    readers.push_back(reader_factory_(metadata[i]));
+    // The messages are converted by a stage of their own rather than by the reader.
+    readers.back()->open(input_options[i], {input_format, input_format});
+    if (!convert_options.topics.empty()) {
+      rosbag2_storage::StorageFilter storage_filter{};
+      storage_filter.topics = convert_options.topics;
+      readers.back()->set_filter(storage_filter);
+    }
+  }
+
+  const auto exclude = convert_options.exclude.empty() ? nullptr :
+    std::make_unique<std::regex>(convert_options.exclude);
+  std::vector<rosbag2_storage::TopicMetadata> topics;
+  std::unordered_set<std::string> topic_names;
+  for (const auto & reader : readers) {
+    for (auto topic : reader->get_all_topics_and_types()) {
+      const bool is_filtered = !convert_options.topics.empty() &&
+        std::find(convert_options.topics.begin(), convert_options.topics.end(), topic.name) ==
+        convert_options.topics.end();
+      if (is_filtered || (exclude && std::regex_search(topic.name, *exclude))) {
+        continue;
+      }
+      if (topic_names.count(topic.name) > 0) {
+        const auto & known_topic = *std::find_if(
+          topics.begin(), topics.end(),
+          [&topic](const rosbag2_storage::TopicMetadata & known) {
+            return known.name == topic.name;
+          });
+        if (known_topic.type != topic.type) {
+          throw std::invalid_argument(
+                  "Topic '" + topic.name + "' has the types '" + known_topic.type + "' and '" +
+                  topic.type + "' in the bags to merge.");
+        }
+        continue;
+      }
+      topic.serialization_format = output_format;
+      topic_names.insert(topic.name);
+      topics.push_back(std::move(topic));
+    }
+  }
+
+  std::unique_ptr<rosbag2_cpp::Converter> converter;
+  if (!topics.empty() && output_format != input_format) {
+    converter = std::make_unique<rosbag2_cpp::Converter>(
+      rosbag2_cpp::ConverterOptions{input_format, output_format, conversion_threads});
+    for (const auto & topic : topics) {
+      converter->add_topic(topic.name, topic.type);
+    }
+  }
+
+  auto writer = writer_factory_(convert_options);
+  writer->open(output_options, {output_format, output_format});
+  for (const auto & topic : topics) {
+    writer->create_topic(topic);
+  }
+  const auto summary = run_pipeline(readers, *writer, converter.get(), topic_names);
+  // Finishes the bag, e.g. compresses its last file, before the messages are reported written.
+  writer->get_implementation_handle().reset();
+  return summary;
+}
+
+ConversionSummary BagConverter::convert_splits(
+  const StorageOptions & input_options, const StorageOptions & output_options,
+  const ConvertOptions & convert_options, const rosbag2_storage::BagMetadata & metadata)
+{
+  const auto output_path = rcpputils::fs::path(output_options.uri);
+  if (!output_path.is_directory() && !rcpputils::fs::create_directories(output_path)) {
+    throw std::runtime_error("Failed to create folder \"" + output_options.uri + "\".");
+  }
+  const auto bag_name = output_path.filename().string();
+  const auto split_name = [&bag_name](size_t index) {
+      return bag_name + "_" + std::to_string(index);
+    };
+
+  // Every bagfile is converted into a bag of its own in the output directory, whose file is
+  // moved into the output bag afterwards.
+  const auto & relative_file_paths = metadata.relative_file_paths;
+  std::vector<rosbag2_storage::BagMetadata> split_metadata(relative_file_paths.size());
+  std::vector<ConversionSummary> summaries(relative_file_paths.size());
+  std::vector<std::exception_ptr> errors(relative_file_paths.size());
+  std::atomic<size_t> next_file{0};
+  const auto convert_files = [&]() {
+      for (size_t i = next_file++; i < relative_file_paths.size(); i = next_file++) {
+        try {
+          auto split_input_options = input_options;
+          split_input_options.uri =
+            resolve_path(input_options.uri, relative_file_paths[i], metadata.version);
+          auto split_output_options = output_options;
+          split_output_options.uri = (output_path / split_name(i)).string();
+          summaries[i] = convert_bags(
+            {split_input_options}, split_output_options, convert_options, {metadata}, 0);
+          split_metadata[i] = metadata_io_->read_metadata(split_output_options.uri);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      }
+    };
+  const auto max_threads = convert_options.max_threads > 0 ?
+    convert_options.max_threads : std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(max_threads, relative_file_paths.size()); ++i) {
+    threads.emplace_back(
+      [&convert_files]() {
+        rosbag2_cpp::ThreadPool::configure_current_thread();
+        convert_files();
+      });
+  }
+  convert_files();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  for (const auto & error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  rosbag2_storage::BagMetadata merged_metadata{};
+  merged_metadata.message_count = 0;
+  merged_metadata.duration = std::chrono::nanoseconds(0);
+  merged_metadata.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+    std::chrono::nanoseconds::max());
+  auto ending_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+    std::chrono::nanoseconds::min());
+  ConversionSummary summary{};
+  for (size_t i = 0; i < split_metadata.size(); ++i) {
+    const auto & split = split_metadata[i];
+    const auto split_path = output_path / split_name(i);
+    merged_metadata.storage_identifier = split.storage_identifier;
+    merged_metadata.compression_format = split.compression_format;
+    merged_metadata.compression_mode = split.compression_mode;
+    merged_metadata.cache_high_water_mark_bytes = std::max(
+      merged_metadata.cache_high_water_mark_bytes, split.cache_high_water_mark_bytes);
+
+    // The files of the bag of split i are renamed like the files of a bag split at i, e.g.
+    // "bag_3_0.db3" to "bag_3.db3".
+    for (const auto & relative_file_path : split.relative_file_paths) {
+      const auto file_name = rcpputils::fs::path(relative_file_path).filename().string();
+      const auto prefix = split_name(i) + "_0";
+      const auto target_name = file_name.compare(0, prefix.size(), prefix) == 0 ?
+        split_name(i) + file_name.substr(prefix.size()) : file_name;
+      move_file((split_path / relative_file_path).string(), (output_path / target_name).string());
+      merged_metadata.relative_file_paths.push_back(target_name);
+      for (auto file : split.files) {
+        if (file.path == relative_file_path) {
+          file.path = target_name;
+          merged_metadata.files.push_back(file);
+        }
+      }
+    }
+    rcpputils::fs::remove(split_path / rosbag2_storage::MetadataIo::metadata_filename);
+    rcpputils::fs::remove(split_path / rosbag2_storage::MetadataIo::binary_metadata_filename);
+    rcpputils::fs::remove(split_path);
+
+    for (const auto & topic : split.topics_with_message_count) {
+      auto merged_topic = std::find_if(
+        merged_metadata.topics_with_message_count.begin(),
+        merged_metadata.topics_with_message_count.end(),
+        [&topic](const rosbag2_storage::TopicInformation & merged) {
+          return merged.topic_metadata.name == topic.topic_metadata.name;
+        });
+      if (merged_topic == merged_metadata.topics_with_message_count.end()) {
+        merged_metadata.topics_with_message_count.push_back(topic);
+        continue;
+      }
+      merged_topic->message_count += topic.message_count;
+      merged_topic->total_size += topic.total_size;
+      merged_topic->max_message_size =
+        std::max(merged_topic->max_message_size, topic.max_message_size);
+      merged_topic->compressed_size += topic.compressed_size;
+      merged_topic->dropped_message_count += topic.dropped_message_count;
+      merged_topic->deduplicated = merged_topic->deduplicated || topic.deduplicated;
+      merged_topic->delta_encoded = merged_topic->delta_encoded || topic.delta_encoded;
+      rosbag2_storage::merge_histograms(merged_topic->histogram, topic.histogram);
+    }
+    if (split.message_count > 0) {
+      merged_metadata.starting_time = std::min(merged_metadata.starting_time, split.starting_time);
+      ending_time = std::max(ending_time, split.starting_time + split.duration);
+    }
+    merged_metadata.message_count += split.message_count;
+    summary.message_count += summaries[i].message_count;
+    summary.bytes += summaries[i].bytes;
+  }
+  if (merged_metadata.message_count > 0) {
+    merged_metadata.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      ending_time - merged_metadata.starting_time);
+  } else {
+    merged_metadata.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::nanoseconds(0));
+  }
+  metadata_io_->write_metadata(output_options.uri, merged_metadata);
+  return summary;
+}
+
+}  // namespace rosbag2_transport
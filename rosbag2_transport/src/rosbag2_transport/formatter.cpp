@@ -29,7 +29,7 @@
 namespace rosbag2_transport
 {
 
-void Formatter::format_bag_meta_data(const rosbag2_storage::BagMetadata & metadata)
+void Formatter::format_bag_meta_data(const rosbag2_storage::BagMetadata & metadata, bool verbose)
 {
   auto start_time = metadata.starting_time.time_since_epoch();
   auto end_time = start_time + metadata.duration;
@@ -51,6 +51,16 @@ void Formatter::format_bag_meta_data(const rosbag2_storage::BagMetadata & metada
   info_stream << "Topic information: ";
   format_topics_with_type(
     metadata.topics_with_message_count, info_stream, indentation_spaces);
+  if (verbose) {
+    info_stream << "Topic sizes:       ";
+    format_topic_sizes(
+      metadata.topics_with_message_count, metadata.duration, info_stream, indentation_spaces);
+    const auto compression_ratio = compute_compression_ratio(metadata);
+    if (!metadata.compression_format.empty() && compression_ratio > 0) {
+      info_stream << "Compression ratio: " << std::setprecision(2) << std::fixed <<
+        compression_ratio << std::endl;
+    }
+  }
 
   // print to console
   std::cout << info_stream.str() << std::endl;
@@ -140,6 +150,9 @@ void Formatter::format_topics_with_type(
       info_stream << "Topic: " << ti.topic_metadata.name << " | ";
       info_stream << "Type: " << ti.topic_metadata.type << " | ";
       info_stream << "Count: " << ti.message_count << " | ";
+      if (ti.dropped_message_count > 0) {
+        info_stream << "Dropped: " << ti.dropped_message_count << " | ";
+      }
       info_stream << "Serialization Format: " << ti.topic_metadata.serialization_format;
       info_stream << std::endl;
     };
@@ -152,6 +165,65 @@ void Formatter::format_topics_with_type(
   }
 }
 
+void Formatter::format_topic_sizes(
+  const std::vector<rosbag2_storage::TopicInformation> & topics,
+  std::chrono::nanoseconds duration,
+  std::stringstream & info_stream,
+  int indentation_spaces)
+{
+  if (topics.empty()) {
+    info_stream << std::endl;
+    return;
+  }
+
+  const double duration_in_sec = std::chrono::duration<double>(duration).count();
+  auto print_topic_sizes =
+    [&info_stream, duration_in_sec](const rosbag2_storage::TopicInformation & ti) -> void {
+      info_stream << "Topic: " << ti.topic_metadata.name << " | ";
+      if (ti.message_count > 0 && ti.total_size == 0) {
+        info_stream << "Size: unknown" << std::endl;
+        return;
+      }
+      info_stream << "Size: " << format_file_size(ti.total_size) << " | ";
+      info_stream << "Average: " <<
+        format_file_size(ti.message_count > 0 ? ti.total_size / ti.message_count : 0) << " | ";
+      info_stream << "Max: " << format_file_size(ti.max_message_size);
+      if (duration_in_sec > 0) {
+        info_stream << " | Rate: " << std::setprecision(2) << std::fixed <<
+          static_cast<double>(ti.message_count) / duration_in_sec << " Hz";
+        info_stream << " | Bandwidth: " << format_file_size(
+          static_cast<uint64_t>(static_cast<double>(ti.total_size) / duration_in_sec)) << "/s";
+      }
+      if (ti.compressed_size > 0) {
+        info_stream << " | Compression ratio: " << std::setprecision(2) << std::fixed <<
+          static_cast<double>(ti.total_size) / static_cast<double>(ti.compressed_size);
+      }
+      info_stream << std::endl;
+    };
+
+  print_topic_sizes(topics[0]);
+  size_t number_of_topics = topics.size();
+  for (size_t j = 1; j < number_of_topics; ++j) {
+    indent(info_stream, indentation_spaces);
+    print_topic_sizes(topics[j]);
+  }
+}
+
+double Formatter::compute_compression_ratio(const rosbag2_storage::BagMetadata & metadata)
+{
+  uint64_t total_size = 0;
+  for (const auto & topic : metadata.topics_with_message_count) {
+    if (topic.message_count > 0 && topic.total_size == 0) {
+      return 0;
+    }
+    total_size += topic.total_size;
+  }
+  if (total_size == 0 || metadata.bag_size == 0) {
+    return 0;
+  }
+  return static_cast<double>(total_size) / static_cast<double>(metadata.bag_size);
+}
+
 void Formatter::indent(std::stringstream & info_stream, int number_of_spaces)
 {
   info_stream << std::string(number_of_spaces, ' ');
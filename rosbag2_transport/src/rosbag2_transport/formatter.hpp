@@ -29,7 +29,9 @@ namespace rosbag2_transport
 class Formatter
 {
 public:
-  static void format_bag_meta_data(const rosbag2_storage::BagMetadata & metadata);
+  /// Verbose output adds the sizes, rates and bandwidths of the topics.
+  static void format_bag_meta_data(
+    const rosbag2_storage::BagMetadata & metadata, bool verbose = false);
 
   static std::unordered_map<std::string, std::string> format_duration(
     std::chrono::high_resolution_clock::duration duration);
@@ -48,6 +50,16 @@ public:
     std::stringstream & info_stream,
     int indentation_spaces);
 
+  /// Rates and bandwidths are averages over the duration of the bag.
+  static void format_topic_sizes(
+    const std::vector<rosbag2_storage::TopicInformation> & topics,
+    std::chrono::nanoseconds duration,
+    std::stringstream & info_stream,
+    int indentation_spaces);
+
+  /// Ratio of the size of the messages to the bag size, or 0 if the message sizes are unknown.
+  static double compute_compression_ratio(const rosbag2_storage::BagMetadata & metadata);
+
 private:
   static void indent(std::stringstream & info_stream, int number_of_spaces);
 };
@@ -15,8 +15,12 @@
 #include "generic_publisher.hpp"
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
 namespace
 {
 rcl_publisher_options_t rosbag2_get_publisher_options(const rclcpp::QoS & qos)
@@ -35,11 +39,18 @@ GenericPublisher::GenericPublisher(
   const rosidl_message_type_support_t & type_support,
   const std::string & topic_name,
   const rclcpp::QoS & qos)
-: rclcpp::PublisherBase(node_base, topic_name, type_support, rosbag2_get_publisher_options(qos))
+: rclcpp::PublisherBase(node_base, topic_name, type_support, rosbag2_get_publisher_options(qos)),
+  type_support_(type_support),
+  publish_loaned_messages_(can_loan_messages())
 {}
 
 void GenericPublisher::publish(std::shared_ptr<rmw_serialized_message_t> message)
 {
+  if (publish_loaned_messages_) {
+    publish_loaned_message(*message);
+    return;
+  }
+
   auto return_code = rcl_publish_serialized_message(
     get_publisher_handle(), message.get(), NULL);
 
@@ -48,4 +59,34 @@ void GenericPublisher::publish(std::shared_ptr<rmw_serialized_message_t> message
   }
 }
 
+bool GenericPublisher::publishes_loaned_messages() const
+{
+  return publish_loaned_messages_;
+}
+
+void GenericPublisher::publish_loaned_message(const rmw_serialized_message_t & message)
+{
+  void * loaned_message = nullptr;
+  auto return_code = rcl_borrow_loaned_message(
+    get_publisher_handle(), &type_support_, &loaned_message);
+  if (return_code != RCL_RET_OK) {
+    rclcpp::exceptions::throw_from_rcl_error(return_code, "failed to borrow loaned message");
+  }
+
+  // Loans hold messages of the type rather than serialized ones, so the message is deserialized
+  // into the middleware's memory, which is the only copy of its data.
+  if (rmw_deserialize(&message, &type_support_, loaned_message) != RMW_RET_OK) {
+    const std::string error = rmw_get_error_string().str;
+    rmw_reset_error();
+    rcl_return_loaned_message_from_publisher(get_publisher_handle(), loaned_message);
+    throw std::runtime_error("failed to deserialize message into loaned message: " + error);
+  }
+
+  // The middleware takes back the loan, whether publishing succeeds or not.
+  return_code = rcl_publish_loaned_message(get_publisher_handle(), loaned_message, NULL);
+  if (return_code != RCL_RET_OK) {
+    rclcpp::exceptions::throw_from_rcl_error(return_code, "failed to publish loaned message");
+  }
+}
+
 }  // namespace rosbag2_transport
@@ -34,7 +34,21 @@ public:
 
   virtual ~GenericPublisher() = default;
 
+  /**
+   * Publishes the serialized message. If the middleware can loan messages of the type, e.g. with
+   * shared memory transport, the message is deserialized straight into a loan of the middleware
+   * and the loan is published, which saves the middleware copying the serialized message.
+   */
   void publish(std::shared_ptr<rmw_serialized_message_t> message);
+
+  /// Whether messages are published as loans of the middleware.
+  bool publishes_loaned_messages() const;
+
+private:
+  void publish_loaned_message(const rmw_serialized_message_t & message);
+
+  const rosidl_message_type_support_t & type_support_;
+  const bool publish_loaned_messages_;
 };
 
 }  // namespace rosbag2_transport
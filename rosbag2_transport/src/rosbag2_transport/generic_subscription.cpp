@@ -19,6 +19,8 @@
 
 #include "rclcpp/any_subscription_callback.hpp"
 #include "rclcpp/subscription.hpp"
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
 
 #include "rosbag2_transport/logging.hpp"
 
@@ -30,6 +32,9 @@ rcl_subscription_options_t rosbag2_get_subscription_options(const rclcpp::QoS &
   options.qos = qos.get_rmw_qos_profile();
   return options;
 }
+
+// Messages are usually released by the writer soon after being received, unless they are cached.
+constexpr size_t kMaxPooledMessages = 32;
 }  // unnamed namespace
 
 namespace rosbag2_transport
@@ -40,14 +45,18 @@ GenericSubscription::GenericSubscription(
   const rosidl_message_type_support_t & ts,
   const std::string & topic_name,
   const rclcpp::QoS & qos,
-  std::function<void(std::shared_ptr<rmw_serialized_message_t>)> callback)
+  std::function<void(
+    std::shared_ptr<rmw_serialized_message_t>, const rclcpp::MessageInfo &)> callback,
+  bool take_loaned_messages)
 : SubscriptionBase(
     node_base,
     ts,
     topic_name,
     rosbag2_get_subscription_options(qos),
-    true),
-  default_allocator_(rcutils_get_default_allocator()),
+    // The executor only takes loans from subscriptions which are not serialized.
+    !take_loaned_messages),
+  message_pool_(kMaxPooledMessages),
+  type_support_(ts),
   callback_(callback),
   qos_(qos)
 {}
@@ -65,16 +74,25 @@ std::shared_ptr<rmw_serialized_message_t> GenericSubscription::create_serialized
 void GenericSubscription::handle_message(
   std::shared_ptr<void> & message, const rclcpp::MessageInfo & message_info)
 {
-  (void) message_info;
   auto typed_message = std::static_pointer_cast<rmw_serialized_message_t>(message);
-  callback_(typed_message);
+  callback_(typed_message, message_info);
 }
 
 void GenericSubscription::handle_loaned_message(
   void * message, const rclcpp::MessageInfo & message_info)
 {
-  (void) message;
-  (void) message_info;
+  // The loan is returned once this returns, so the message is serialized into a pooled buffer,
+  // which is the only copy of its data.
+  auto serialized_message = borrow_serialized_message(0);
+  auto serialize_return = rmw_serialize(message, &type_support_, serialized_message.get());
+  if (serialize_return != RMW_RET_OK) {
+    ROSBAG2_TRANSPORT_LOG_ERROR_STREAM(
+      "Failed to serialize loaned message on topic '" << get_topic_name() << "': " <<
+        rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  callback_(serialized_message, message_info);
 }
 
 void GenericSubscription::return_message(std::shared_ptr<void> & message)
@@ -97,25 +115,8 @@ const rclcpp::QoS & GenericSubscription::qos_profile() const
 std::shared_ptr<rmw_serialized_message_t>
 GenericSubscription::borrow_serialized_message(size_t capacity)
 {
-  auto message = new rmw_serialized_message_t;
-  *message = rmw_get_zero_initialized_serialized_message();
-  auto init_return = rmw_serialized_message_init(message, capacity, &default_allocator_);
-  if (init_return != RCL_RET_OK) {
-    rclcpp::exceptions::throw_from_rcl_error(init_return);
-  }
-
-  auto serialized_msg = std::shared_ptr<rmw_serialized_message_t>(
-    message,
-    [](rmw_serialized_message_t * msg) {
-      auto fini_return = rmw_serialized_message_fini(msg);
-      delete msg;
-      if (fini_return != RCL_RET_OK) {
-        ROSBAG2_TRANSPORT_LOG_ERROR_STREAM(
-          "Failed to destroy serialized message: " << rcl_get_error_string().str);
-      }
-    });
-
-  return serialized_msg;
+  // rmw_serialized_message_t is an rcutils_uint8_array_t, which the middleware grows as needed.
+  return message_pool_.make_empty_serialized_message(capacity);
 }
 
 }  // namespace rosbag2_transport
@@ -20,8 +20,11 @@
 
 #include "rclcpp/any_subscription_callback.hpp"
 #include "rclcpp/macros.hpp"
+#include "rclcpp/message_info.hpp"
 #include "rclcpp/subscription.hpp"
 
+#include "rosbag2_storage/message_pool.hpp"
+
 namespace rosbag2_transport
 {
 
@@ -43,14 +46,19 @@ public:
    * \param node_base NodeBaseInterface pointer used in parts of the setup.
    * \param ts Type support handle
    * \param topic_name Topic name
-   * \param callback Callback for new messages of serialized form
+   * \param callback Callback for new messages of serialized form, with their message info
+   * \param take_loaned_messages Whether the messages are taken as loans of the middleware, which
+   * requires can_loan_messages(). Loaned messages are serialized straight from the middleware's
+   * memory and the loan is returned right away.
    */
   GenericSubscription(
     rclcpp::node_interfaces::NodeBaseInterface * node_base,
     const rosidl_message_type_support_t & ts,
     const std::string & topic_name,
     const rclcpp::QoS & qos,
-    std::function<void(std::shared_ptr<rmw_serialized_message_t>)> callback);
+    std::function<void(
+      std::shared_ptr<rmw_serialized_message_t>, const rclcpp::MessageInfo &)> callback,
+    bool take_loaned_messages = false);
 
   // Same as create_serialized_message() as the subscription is to serialized_messages only
   std::shared_ptr<void> create_message() override;
@@ -75,8 +83,12 @@ private:
   RCLCPP_DISABLE_COPY(GenericSubscription)
 
   std::shared_ptr<rmw_serialized_message_t> borrow_serialized_message(size_t capacity);
-  rcutils_allocator_t default_allocator_;
-  std::function<void(std::shared_ptr<rmw_serialized_message_t>)> callback_;
+  // Buffers released by the writer are taken for the next messages again, so they soon have
+  // the capacity of the usual message on this topic and are not grown anymore.
+  rosbag2_storage::MessagePool message_pool_;
+  const rosidl_message_type_support_t & type_support_;
+  std::function<void(
+      std::shared_ptr<rmw_serialized_message_t>, const rclcpp::MessageInfo &)> callback_;
   const rclcpp::QoS qos_;
 };
 
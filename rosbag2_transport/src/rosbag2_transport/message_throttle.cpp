@@ -0,0 +1,42 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "message_throttle.hpp"
+
+#include <algorithm>
+
+namespace rosbag2_transport
+{
+
+MessageThrottle::MessageThrottle(const TopicThrottle & throttle)
+: decimation_(std::max<uint64_t>(throttle.decimation, 1u)),
+  min_period_(
+    throttle.max_frequency > 0.0 ?
+    static_cast<rcutils_time_point_value_t>(1e9 / throttle.max_frequency) : 0)
+{}
+
+bool MessageThrottle::should_record(rcutils_time_point_value_t receive_time)
+{
+  if (received_count_++ % decimation_ != 0u) {
+    return false;
+  }
+  if (min_period_ > 0 && has_recorded_ && receive_time - last_recorded_time_ < min_period_) {
+    return false;
+  }
+  has_recorded_ = true;
+  last_recorded_time_ = receive_time;
+  return true;
+}
+
+}  // namespace rosbag2_transport
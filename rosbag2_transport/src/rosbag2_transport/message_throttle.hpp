@@ -0,0 +1,50 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TRANSPORT__MESSAGE_THROTTLE_HPP_
+#define ROSBAG2_TRANSPORT__MESSAGE_THROTTLE_HPP_
+
+#include <cstdint>
+
+#include "rcutils/time.h"
+
+#include "rosbag2_transport/record_options.hpp"
+
+namespace rosbag2_transport
+{
+
+/**
+ * Decides which of the messages received on a topic are recorded, according to its TopicThrottle.
+ * Every decimation-th message is considered, and of those only the ones received at least
+ * 1 / max_frequency seconds after the last recorded message are recorded.
+ */
+class MessageThrottle
+{
+public:
+  explicit MessageThrottle(const TopicThrottle & throttle);
+
+  /// Whether the message received at the given time is recorded. Called for every message.
+  bool should_record(rcutils_time_point_value_t receive_time);
+
+private:
+  uint64_t decimation_;
+  rcutils_time_point_value_t min_period_;
+  uint64_t received_count_{0};
+  bool has_recorded_{false};
+  rcutils_time_point_value_t last_recorded_time_{0};
+};
+
+}  // namespace rosbag2_transport
+
+#endif  // ROSBAG2_TRANSPORT__MESSAGE_THROTTLE_HPP_
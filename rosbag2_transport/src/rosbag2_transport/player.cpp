@@ -14,24 +14,45 @@
 
 #include "player.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <queue>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "rcl/graph.h"
 
+#include "rclcpp/executors/single_threaded_executor.hpp"
 #include "rclcpp/rclcpp.hpp"
 
+#include "rcpputils/scope_exit.hpp"
+
 #include "rcutils/time.h"
+#include "rcutils/types/uint8_array.h"
 
+#include "rosbag2_cpp/cdr_field_extractor.hpp"
+#include "rosbag2_cpp/memory_budget.hpp"
 #include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
 #include "rosbag2_cpp/typesupport_helpers.hpp"
 
+#include "rosbag2_storage/buffer_slice.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
 #include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_storage/tracing.hpp"
 
 #include "rosbag2_transport/logging.hpp"
 
@@ -41,6 +62,10 @@
 
 namespace
 {
+// Size of the blocks of memory preloaded messages are copied into. Larger messages are copied
+// into blocks of their own.
+constexpr size_t kPreloadBlockSize = 64 * 1024 * 1024;
+
 /**
  * Determine which QoS to offer for a topic.
  * The priority of the profile selected is:
@@ -49,11 +74,13 @@ namespace
  *
  * \param topic_name The full name of the topic, with namespace (ex. /arm/joint_status).
  * \param topic_qos_profile_overrides A map of topic to QoS profile overrides.
+ * \param parsed_qos_profiles The offered QoS profiles parsed so far, by their YAML.
  * @return The QoS profile to be used for subscribing.
  */
 rclcpp::QoS publisher_qos_for_topic(
   const rosbag2_storage::TopicMetadata & topic,
-  const std::unordered_map<std::string, rclcpp::QoS> & topic_qos_profile_overrides)
+  const std::unordered_map<std::string, rclcpp::QoS> & topic_qos_profile_overrides,
+  std::unordered_map<std::string, std::vector<rosbag2_transport::Rosbag2QoS>> & parsed_qos_profiles)
 {
   using rosbag2_transport::Rosbag2QoS;
   auto qos_it = topic_qos_profile_overrides.find(topic.name);
@@ -64,10 +91,138 @@ rclcpp::QoS publisher_qos_for_topic(
     return Rosbag2QoS{};
   }
 
-  const auto profiles_yaml = YAML::Load(topic.offered_qos_profiles);
-  const auto offered_qos_profiles = profiles_yaml.as<std::vector<Rosbag2QoS>>();
-  return Rosbag2QoS::adapt_offer_to_recorded_offers(topic.name, offered_qos_profiles);
+  auto parsed_it = parsed_qos_profiles.find(topic.offered_qos_profiles);
+  if (parsed_it == parsed_qos_profiles.end()) {
+    const auto profiles_yaml = YAML::Load(topic.offered_qos_profiles);
+    parsed_it = parsed_qos_profiles.emplace(
+      topic.offered_qos_profiles, profiles_yaml.as<std::vector<Rosbag2QoS>>()).first;
+  }
+  return Rosbag2QoS::adapt_offer_to_recorded_offers(topic.name, parsed_it->second);
+}
+
+// Locates the header stamp of the messages of a topic, null if their type has none.
+std::shared_ptr<const rosbag2_cpp::CdrFieldExtractor> create_header_stamp_extractor(
+  const rosbag2_storage::TopicMetadata & topic)
+{
+  try {
+    std::shared_ptr<rcpputils::SharedLibrary> library;
+    const auto type_support =
+      rosbag2_cpp::get_typesupport(topic.type, "rosidl_typesupport_cpp", library);
+    return std::make_shared<const rosbag2_cpp::CdrFieldExtractor>(type_support, "header.stamp");
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_INFO_STREAM(
+      "Header stamps of topic '" << topic.name << "' are not rewritten: " << e.what());
+    return nullptr;
+  }
+}
+
+// Sleeps until shortly before the given time and busy-waits for the rest of it.
+void sleep_until_with_busy_wait(
+  const std::chrono::steady_clock::time_point & time,
+  const std::chrono::microseconds & busy_wait_period)
+{
+  std::this_thread::sleep_until(time - busy_wait_period);
+  while (std::chrono::steady_clock::now() < time) {
+  }
 }
+
+// Applies the real-time priority and CPU affinity of the play options to the calling thread and
+// restores the previous settings when destroyed.
+class PlaybackThreadScheduling
+{
+public:
+  explicit PlaybackThreadScheduling(const rosbag2_transport::PlayOptions & options)
+  {
+#ifdef __linux__
+    const auto thread = pthread_self();
+    if (options.realtime_priority > 0 &&
+      pthread_getschedparam(thread, &previous_policy_, &previous_param_) == 0)
+    {
+      sched_param param{};
+      param.sched_priority = options.realtime_priority;
+      const int error = pthread_setschedparam(thread, SCHED_FIFO, &param);
+      if (error == 0) {
+        priority_changed_ = true;
+      } else {
+        ROSBAG2_TRANSPORT_LOG_WARN_STREAM(
+          "Failed to set SCHED_FIFO priority " << options.realtime_priority << ": " <<
+            std::strerror(error));
+      }
+    }
+    if (!options.cpu_affinity.empty() &&
+      pthread_getaffinity_np(thread, sizeof(previous_cpus_), &previous_cpus_) == 0)
+    {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (const auto cpu : options.cpu_affinity) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+          CPU_SET(cpu, &cpus);
+        }
+      }
+      const int error = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+      if (error == 0) {
+        affinity_changed_ = true;
+      } else {
+        ROSBAG2_TRANSPORT_LOG_WARN_STREAM("Failed to set CPU affinity: " << std::strerror(error));
+      }
+    }
+#else
+    if (options.realtime_priority > 0 || !options.cpu_affinity.empty()) {
+      ROSBAG2_TRANSPORT_LOG_WARN(
+        "Real-time priority and CPU affinity are not supported on this platform.");
+    }
+#endif
+  }
+
+  ~PlaybackThreadScheduling()
+  {
+#ifdef __linux__
+    const auto thread = pthread_self();
+    if (priority_changed_) {
+      pthread_setschedparam(thread, previous_policy_, &previous_param_);
+    }
+    if (affinity_changed_) {
+      pthread_setaffinity_np(thread, sizeof(previous_cpus_), &previous_cpus_);
+    }
+#endif
+  }
+
+  PlaybackThreadScheduling(const PlaybackThreadScheduling &) = delete;
+  PlaybackThreadScheduling & operator=(const PlaybackThreadScheduling &) = delete;
+
+private:
+#ifdef __linux__
+  bool priority_changed_ {false};
+  int previous_policy_ {SCHED_OTHER};
+  sched_param previous_param_ {};
+  bool affinity_changed_ {false};
+  cpu_set_t previous_cpus_ {};
+#endif
+};
+
+// Spins a node on its own thread while in scope.
+class NodeSpinner
+{
+public:
+  explicit NodeSpinner(std::shared_ptr<rclcpp::Node> node)
+  {
+    executor_.add_node(node);
+    thread_ = std::thread([this]() {executor_.spin();});
+  }
+
+  ~NodeSpinner()
+  {
+    executor_.cancel();
+    thread_.join();
+  }
+
+  NodeSpinner(const NodeSpinner &) = delete;
+  NodeSpinner & operator=(const NodeSpinner &) = delete;
+
+private:
+  rclcpp::executors::SingleThreadedExecutor executor_;
+  std::thread thread_;
+};
 }  // namespace
 
 namespace rosbag2_transport
@@ -77,131 +232,1036 @@ const std::chrono::milliseconds
 Player::queue_read_wait_period_ = std::chrono::milliseconds(100);
 
 Player::Player(
-  std::shared_ptr<rosbag2_cpp::Reader> reader, std::shared_ptr<Rosbag2Node> rosbag2_transport)
-: reader_(std::move(reader)), rosbag2_transport_(rosbag2_transport)
-{}
+  std::shared_ptr<rosbag2_cpp::Reader> reader, std::shared_ptr<Rosbag2Node> rosbag2_transport,
+  bool spin_node)
+: reader_(std::move(reader)), spin_node_(spin_node), rosbag2_transport_(rosbag2_transport)
+{
+  create_control_services();
+}
+
+void Player::stop()
+{
+  stop_playing_ = true;
+  // Wakes the player and the loader, which check for stopping at least every wait period.
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+  }
+  playback_changed_.notify_all();
+  notify_queue_waiter(queue_filled_);
+  notify_queue_waiter(queue_drained_);
+}
+
+bool Player::is_playing() const
+{
+  return rclcpp::ok() && !stop_playing_;
+}
+
+void Player::create_control_services()
+{
+  pause_service_ = rosbag2_transport_->create_service<std_srvs::srv::Trigger>(
+    "~/pause",
+    [this](
+      const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+      std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+    {
+      pause();
+      response->success = true;
+    });
+  resume_service_ = rosbag2_transport_->create_service<std_srvs::srv::Trigger>(
+    "~/resume",
+    [this](
+      const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+      std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+    {
+      resume();
+      response->success = true;
+    });
+  play_next_service_ = rosbag2_transport_->create_service<std_srvs::srv::Trigger>(
+    "~/play_next",
+    [this](
+      const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+      std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+    {
+      response->success = play_next();
+      if (!response->success) {
+        response->message = "Playback is not paused.";
+      }
+    });
+  set_rate_service_ = rosbag2_transport_->create_service<rosbag2_interfaces::srv::SetRate>(
+    "~/set_rate",
+    [this](
+      const std::shared_ptr<rosbag2_interfaces::srv::SetRate::Request> request,
+      std::shared_ptr<rosbag2_interfaces::srv::SetRate::Response> response)
+    {
+      response->success = set_rate(request->rate);
+    });
+  seek_service_ = rosbag2_transport_->create_service<rosbag2_interfaces::srv::Seek>(
+    "~/seek",
+    [this](
+      const std::shared_ptr<rosbag2_interfaces::srv::Seek::Request> request,
+      std::shared_ptr<rosbag2_interfaces::srv::Seek::Response> response)
+    {
+      response->success = seek(rclcpp::Time(request->time).nanoseconds());
+    });
+}
 
 bool Player::is_storage_completely_loaded() const
 {
+  // Rethrows the errors of the loader.
   if (storage_loading_future_.valid() &&
     storage_loading_future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
   {
     storage_loading_future_.get();
   }
-  return !storage_loading_future_.valid();
+  if (!storage_loading_future_.valid()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return storage_loaded_;
 }
 
 void Player::play(const PlayOptions & options)
 {
   topic_qos_profile_overrides_ = options.topic_qos_profile_overrides;
+  order_by_publish_time_ = options.order_by_publish_time;
+  stamps_bag_time_ = options.clock_publish_frequency > 0.0 && !options.as_fast_as_possible;
+  queue_max_messages_ = options.read_ahead_queue_size;
+  queue_max_bytes_ = options.read_ahead_queue_bytes;
+  // At least 1, so tiny queues are still refilled once they are empty.
+  queue_lower_boundary_ = std::max<size_t>(
+    1u, static_cast<size_t>(queue_max_messages_ * read_ahead_lower_bound_percentage_));
+  queue_lower_boundary_bytes_ = std::max<size_t>(
+    1u, static_cast<size_t>(queue_max_bytes_ * read_ahead_lower_bound_percentage_));
+  {
+    std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+    transforms_ = rosbag2_cpp::MessageTransformChain(options.transforms);
+  }
   prepare_publishers(options);
+  cached_messages_.clear();
+  cached_bytes_ = 0;
+  cache_max_bytes_ = options.loop_cache_bytes;
+  filling_cache_ = options.loop && cache_max_bytes_ > 0;
+  cache_complete_ = false;
+  reading_cache_ = false;
+  if (options.preload) {
+    preload_messages(options.preload_max_bytes);
+  }
+
+  start_pending_ = options.start_at > 0 && !options.as_fast_as_possible;
+  start_reporting_progress(options);
+
+  // Serves the control services while playing.
+  std::unique_ptr<NodeSpinner> spinner;
+  if (spin_node_) {
+    spinner = std::make_unique<NodeSpinner>(rosbag2_transport_);
+  }
+  wait_for_subscribers(options.wait_for_subscribers);
+  if (options.start_offset > 0.0) {
+    std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+    publish_latched_messages(loop_start_time_);
+  }
+  // Publishers and the open reader are kept when looping, so the bag is only rewound.
+  play_once(options);
+  while (options.loop && is_playing()) {
+    rewind();
+    play_once(options);
+  }
+  progress_timer_.reset();
+}
+
+void Player::start_reporting_progress(const PlayOptions & options)
+{
+  played_messages_ = 0;
+  last_played_time_stamp_ = 0;
+  if (!options.progress_callback || options.progress_interval.count() <= 0) {
+    return;
+  }
+  const auto total_messages = reader_->get_metadata().message_count;
+  const auto start_time = std::chrono::steady_clock::now();
+  progress_timer_ = rosbag2_transport_->create_wall_timer(
+    options.progress_interval,
+    [this, total_messages, start_time, callback = options.progress_callback]() {
+      PlayProgress progress{};
+      progress.played_messages = played_messages_;
+      progress.total_messages = total_messages;
+      progress.time_stamp = last_played_time_stamp_;
+      progress.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time);
+      callback(progress);
+    });
+}
+
+void Player::play_once(const PlayOptions & options)
+{
+  storage_loaded_ = false;
+  stop_loading_ = false;
+
+  // The first message is read right away, so the timeline has its origin before playing starts.
+  {
+    std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+    if (has_next_message()) {
+      auto first_message = read_next_message();
+      time_first_message_ = replay_time_point(*first_message);
+      enqueue_loaded_messages({std::move(first_message)});
+    }
+  }
 
   storage_loading_future_ = std::async(
     std::launch::async,
-    [this, options]() {load_storage_content(options);});
+    [this]() {load_storage_content();});
 
-  wait_for_filled_queue(options);
+  try {
+    wait_for_filled_queue();
+    play_messages_from_queue(options);
+  } catch (...) {
+    stop_loading_storage_content();
+    throw;
+  }
+  stop_loading_storage_content();
+}
 
-  play_messages_from_queue(options);
+bool Player::has_next_message()
+{
+  if (reading_cache_) {
+    return cache_position_ < cached_messages_.size();
+  }
+  return reader_->has_next();
+}
+
+std::shared_ptr<rosbag2_storage::SerializedBagMessage> Player::read_next_message()
+{
+  if (reading_cache_) {
+    return cached_messages_[cache_position_++];
+  }
+  auto message = reader_->read_next();
+  add_to_message_cache(message);
+  return message;
+}
+
+void Player::add_to_message_cache(
+  const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message)
+{
+  if (!filling_cache_) {
+    return;
+  }
+  cached_bytes_ += message->serialized_data ? message->serialized_data->buffer_length : 0u;
+  cached_messages_.push_back(message);
+  if (cached_bytes_ > cache_max_bytes_) {
+    ROSBAG2_TRANSPORT_LOG_INFO(
+      "The bag exceeds the loop cache, it is read from storage again in every loop.");
+    stop_filling_message_cache();
+  } else if (!reader_->has_next()) {
+    filling_cache_ = false;
+    cache_complete_ = true;
+  }
+}
+
+void Player::stop_filling_message_cache()
+{
+  filling_cache_ = false;
+  cached_messages_.clear();
+  cached_messages_.shrink_to_fit();
+  cached_bytes_ = 0;
 }
 
-void Player::wait_for_filled_queue(const PlayOptions & options) const
+void Player::preload_messages(size_t max_bytes)
 {
+  // Each message is copied into consecutive memory as soon as it is read, which releases the
+  // buffer it was read into, so the bag is held in memory once. The queued messages share the
+  // blocks, so playing allocates nothing.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  std::shared_ptr<std::vector<uint8_t>> block;
+  size_t bytes = 0;
+  while (reader_->has_next()) {
+    auto message = reader_->read_next();
+    const auto length = message->serialized_data ? message->serialized_data->buffer_length : 0u;
+    bytes += length;
+    if (max_bytes > 0 && bytes > max_bytes) {
+      ROSBAG2_TRANSPORT_LOG_WARN_STREAM(
+        "The bag exceeds the preload limit of " << max_bytes << " bytes and is played from "
+          "storage instead.");
+      reader_->seek(loop_start_time_);
+      return;
+    }
+    if (length > 0) {
+      // Reserved blocks are never reallocated, so the views into them stay valid.
+      if (!block || block->capacity() - block->size() < length) {
+        block = std::make_shared<std::vector<uint8_t>>();
+        block->reserve(std::max(length, kPreloadBlockSize));
+      }
+      const auto offset = block->size();
+      const auto data = message->serialized_data->buffer;
+      block->insert(block->end(), data, data + length);
+      message->serialized_data =
+        rosbag2_storage::make_serialized_data_view({block->data() + offset, length, block});
+    }
+    messages.push_back(std::move(message));
+  }
+
+  ROSBAG2_TRANSPORT_LOG_INFO_STREAM(
+    "Preloaded " << messages.size() << " messages (" << bytes << " bytes).");
+  cached_messages_ = std::move(messages);
+  cached_bytes_ = bytes;
+  filling_cache_ = false;
+  cache_complete_ = true;
+  reading_cache_ = true;
+  cache_position_ = 0;
+}
+
+void Player::rewind()
+{
+  std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+  if (cache_complete_) {
+    reading_cache_ = true;
+    cache_position_ = 0;
+    return;
+  }
+  // An incomplete cache, e.g. after seeking, is of no use for the next loop.
+  if (filling_cache_) {
+    stop_filling_message_cache();
+  }
+  reader_->seek(loop_start_time_);
+}
+
+void Player::wait_for_subscribers(size_t subscriber_count)
+{
+  if (subscriber_count == 0) {
+    return;
+  }
+  ROSBAG2_TRANSPORT_LOG_INFO_STREAM(
+    "Waiting for " << subscriber_count << " subscriptions on every topic...");
+  // Matching subscriptions change the graph. The wait period bounds the time it takes to notice
+  // a shutdown.
+  auto graph_event = rosbag2_transport_->get_graph_event();
+  // The publishers of all played topics were created for this.
+  auto all_topics_subscribed = [this, subscriber_count]() {
+      std::lock_guard<std::mutex> lock(publishers_mutex_);
+      for (const auto & topic_publisher : publishers_) {
+        if (topic_publisher.second.publisher &&
+          topic_publisher.second.publisher->get_subscription_count() < subscriber_count)
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+  while (!all_topics_subscribed() && is_playing()) {
+    rosbag2_transport_->wait_for_graph_change(graph_event, queue_read_wait_period_);
+    graph_event->check_and_clear();
+  }
+}
+
+void Player::wait_for_filled_queue()
+{
+  // Woken as soon as the loader enqueued a batch. The wait period bounds the time it takes to
+  // notice a shutdown or a failed loader.
+  std::unique_lock<std::mutex> lock(queue_mutex_);
   while (
-    message_queue_.size_approx() < options.read_ahead_queue_size &&
-    !is_storage_completely_loaded() && rclcpp::ok())
+    !is_queue_full() && !storage_loaded_ && is_playing() &&
+    storage_loading_future_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
   {
-    std::this_thread::sleep_for(queue_read_wait_period_);
+    queue_filled_.wait_for(lock, queue_read_wait_period_);
   }
 }
 
-void Player::load_storage_content(const PlayOptions & options)
+void Player::wait_for_queued_message()
 {
-  TimePoint time_first_message;
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  queue_filled_.wait_for(
+    lock, queue_read_wait_period_,
+    [this]() {return message_queue_.size_approx() > 0 || storage_loaded_;});
+}
 
-  ReplayableMessage message;
-  if (reader_->has_next()) {
-    message.message = reader_->read_next();
-    message.time_since_start = std::chrono::nanoseconds(0);
-    time_first_message = TimePoint(std::chrono::nanoseconds(message.message->time_stamp));
-    message_queue_.enqueue(message);
+void Player::notify_queue_waiter(std::condition_variable & condition)
+{
+  // Locking once orders the notification after the waiter checked the queue or started waiting,
+  // so it is not lost.
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
   }
+  condition.notify_one();
+}
 
-  auto queue_lower_boundary =
-    static_cast<size_t>(options.read_ahead_queue_size * read_ahead_lower_bound_percentage_);
-  auto queue_upper_boundary = options.read_ahead_queue_size;
+void Player::load_storage_content()
+{
+  rosbag2_cpp::ThreadPool::configure_current_thread();
+  // Keeps running at the end of the bag, since seeking may continue reading.
+  while (is_playing()) {
+    {
+      // Woken by the player once the queue drops below the lower boundary.
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_drained_.wait_for(
+        lock, queue_read_wait_period_,
+        [this]() {
+          return stop_loading_ || (!storage_loaded_ && is_queue_below_lower_boundary());
+        });
+      if (stop_loading_) {
+        return;
+      }
+      if (storage_loaded_ || !is_queue_below_lower_boundary()) {
+        continue;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+      enqueue_up_to_boundary();
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      storage_loaded_ = !has_next_message();
+    }
+    queue_filled_.notify_one();
+  }
+}
 
-  while (reader_->has_next() && rclcpp::ok()) {
-    if (message_queue_.size_approx() < queue_lower_boundary) {
-      enqueue_up_to_boundary(time_first_message, queue_upper_boundary);
-    } else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+void Player::stop_loading_storage_content()
+{
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_loading_ = true;
+  }
+  queue_drained_.notify_one();
+  if (storage_loading_future_.valid()) {
+    storage_loading_future_.get();
+  }
+}
+
+void Player::enqueue_up_to_boundary()
+{
+  if (reading_cache_) {
+    if (transforms_.empty()) {
+      while (!is_queue_full() && cache_position_ < cached_messages_.size()) {
+        enqueue_loaded_message(cached_messages_[cache_position_++]);
+      }
+      return;
+    }
+    if (is_queue_full()) {
+      return;
     }
+    // Transformed as a batch, of at most the free space of the queue.
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> bag_messages;
+    const auto free_messages = queue_max_messages_ - message_queue_.size_approx();
+    while (bag_messages.size() < free_messages && cache_position_ < cached_messages_.size()) {
+      bag_messages.push_back(cached_messages_[cache_position_++]);
+    }
+    enqueue_loaded_messages(std::move(bag_messages));
+    return;
+  }
+  if (is_queue_full()) {
+    return;
   }
+  // The batch ends with the message which reaches the byte budget, so the queue may exceed it by
+  // at most one message.
+  const auto max_messages = queue_max_messages_ - message_queue_.size_approx();
+  size_t max_bytes = queue_max_bytes_ > 0 ? queue_max_bytes_ - queued_bytes_ : 0u;
+  const auto available_bytes = queue_memory_account_->get_available_bytes();
+  if (available_bytes < std::numeric_limits<uint64_t>::max()) {
+    // An empty queue reads at least one message.
+    const auto budget_bytes = static_cast<size_t>(std::max<uint64_t>(available_bytes, 1u));
+    max_bytes = max_bytes > 0 ? std::min(max_bytes, budget_bytes) : budget_bytes;
+  }
+
+  auto bag_messages = reader_->read_next_batch(max_messages, max_bytes);
+  for (const auto & bag_message : bag_messages) {
+    add_to_message_cache(bag_message);
+  }
+  enqueue_loaded_messages(std::move(bag_messages));
 }
 
-void Player::enqueue_up_to_boundary(const TimePoint & time_first_message, uint64_t boundary)
+void Player::enqueue_loaded_messages(
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> bag_messages)
 {
-  ReplayableMessage message;
-  for (size_t i = message_queue_.size_approx(); i < boundary; i++) {
-    if (!reader_->has_next()) {
-      break;
+  transform_messages(bag_messages);
+  for (auto & bag_message : bag_messages) {
+    enqueue_loaded_message(std::move(bag_message));
+  }
+}
+
+void Player::transform_messages(
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & bag_messages)
+{
+  if (transforms_.empty()) {
+    return;
+  }
+  // Cached messages are played again when looping, so the transforms change copies of them,
+  // which share their serialized data.
+  if (filling_cache_ || reading_cache_) {
+    for (auto & bag_message : bag_messages) {
+      bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>(*bag_message);
     }
-    message.message = reader_->read_next();
-    message.time_since_start =
-      TimePoint(std::chrono::nanoseconds(message.message->time_stamp)) - time_first_message;
+  }
+  transforms_.transform(bag_messages);
+}
+
+void Player::enqueue_loaded_message(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> bag_message)
+{
+  ReplayableMessage message;
+  message.message = std::move(bag_message);
+  message.time_since_start = replay_time_point(*message.message) - time_first_message_;
+  message.seek_generation = seek_generation_;
+  if (resolve_publisher(message)) {
+    enqueue_message(std::move(message));
+  }
+}
+
+bool Player::resolve_publisher(ReplayableMessage & message)
+{
+  const auto topic_publisher = publishers_.find(message.message->topic_name);
+  if (topic_publisher == publishers_.end()) {
+    ROSBAG2_TRANSPORT_LOG_WARN_STREAM(
+      "Skipping message on topic '" << message.message->topic_name << "' without publisher.");
+    return false;
+  }
+  // Lazy publishers are created here, when their first message is read ahead of playing it.
+  message.publisher = &get_publisher(topic_publisher->first, topic_publisher->second);
+  message.publishing_thread = topic_publisher->second.publishing_thread;
+  message.header_stamp = topic_publisher->second.header_stamp.get();
+  return true;
+}
 
-    message_queue_.enqueue(message);
+GenericPublisher & Player::get_publisher(
+  const std::string & topic_name, TopicPublisher & publisher)
+{
+  std::lock_guard<std::mutex> lock(publishers_mutex_);
+  if (!publisher.publisher) {
+    publisher.publisher =
+      rosbag2_transport_->create_generic_publisher(topic_name, publisher.type, publisher.qos);
   }
+  return *publisher.publisher;
+}
+
+void Player::enqueue_message(ReplayableMessage && message)
+{
+  const auto & serialized_data = message.message->serialized_data;
+  const auto size = serialized_data ? serialized_data->buffer_length : 0u;
+  queued_bytes_ += size;
+  queue_memory_account_->allocate(size);
+  message_queue_.enqueue(std::move(message));
+}
+
+bool Player::is_queue_full() const
+{
+  return message_queue_.size_approx() >= queue_max_messages_ ||
+         (queue_max_bytes_ > 0 && queued_bytes_ >= queue_max_bytes_) ||
+         (message_queue_.size_approx() > 0 && queue_memory_account_->is_budget_exhausted());
+}
+
+bool Player::is_queue_below_lower_boundary() const
+{
+  return message_queue_.size_approx() < queue_lower_boundary_ &&
+         (queue_max_bytes_ == 0 || queued_bytes_ < queue_lower_boundary_bytes_) &&
+         (message_queue_.size_approx() == 0 || !queue_memory_account_->is_budget_exhausted());
 }
 
 void Player::play_messages_from_queue(const PlayOptions & options)
 {
-  start_time_ = std::chrono::system_clock::now();
-  do {
+  PlaybackThreadScheduling scheduling{options};
+  timing_error_count_ = 0;
+  timing_error_sum_us_ = 0.0;
+  timing_error_squared_sum_us_ = 0.0;
+  timing_error_max_us_ = 0.0;
+  played_messages_ = 0;
+  // The publishing threads are joined as well when playing throws.
+  auto publishing_threads_guard = rcpputils::make_scope_exit([this]() {stop_publishing_threads();});
+  start_publishing_threads();
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    playback_start_time_ = std::chrono::steady_clock::now();
+    start_time_ = playback_start_time_;
+    start_position_ = std::chrono::nanoseconds(0);
+    // Use rate if in valid range
+    rate_ = options.rate > 0.0 ? options.rate : 1.0;
+    paused_ = options.start_paused;
+    pending_steps_ = 0;
+    if (start_pending_) {
+      synchronize_start(options);
+      start_pending_ = false;
+    }
+    next_clock_time_ = start_time_;
+  }
+  // The queue is checked after the loader state, so the last batch is not missed.
+  while (!(is_storage_completely_loaded() && message_queue_.size_approx() == 0) && is_playing()) {
     play_messages_until_queue_empty(options);
-    if (!is_storage_completely_loaded() && rclcpp::ok()) {
-      ROSBAG2_TRANSPORT_LOG_WARN(
-        "Message queue starved. Messages will be delayed. Consider "
-        "increasing the --read-ahead-queue-size option.");
+    if (!is_storage_completely_loaded() && is_playing()) {
+      // Playing as fast as possible usually outruns the loader, which delays nothing.
+      if (!options.as_fast_as_possible) {
+        ROSBAG2_TRANSPORT_LOG_WARN(
+          "Message queue starved. Messages will be delayed. Consider "
+          "increasing the --read-ahead-queue-size option.");
+      }
+      wait_for_queued_message();
+    }
+  }
+  publishing_threads_guard.cancel();
+  stop_publishing_threads();
+  report_playback_statistics();
+}
+
+void Player::start_publishing_threads()
+{
+  stop_publishing_ = false;
+  for (size_t i = 0; i < publishing_thread_count_; ++i) {
+    publishing_threads_.push_back(std::make_unique<PublishingThread>());
+  }
+  for (auto & publishing_thread : publishing_threads_) {
+    auto queue = &publishing_thread->queue;
+    publishing_thread->thread = std::thread(
+      [this, queue]() {
+        rosbag2_cpp::ThreadPool::configure_current_thread(rosbag2_cpp::ThreadRole::PLAYER);
+        ReplayableMessage message;
+        while (!stop_publishing_) {
+          if (queue->wait_dequeue_timed(message, queue_read_wait_period_) &&
+            message.seek_generation == seek_generation_)
+          {
+            publish_message_logging_errors(message);
+          }
+        }
+        // Messages which are due already are still published when stopping.
+        while (queue->try_dequeue(message)) {
+          publish_message_logging_errors(message);
+        }
+      });
+  }
+}
+
+void Player::stop_publishing_threads()
+{
+  stop_publishing_ = true;
+  for (auto & publishing_thread : publishing_threads_) {
+    // Threads are not started if starting a previous one threw.
+    if (publishing_thread->thread.joinable()) {
+      publishing_thread->thread.join();
     }
-  } while (!is_storage_completely_loaded() && rclcpp::ok());
+  }
+  publishing_threads_.clear();
+}
+
+void Player::publish_message(const ReplayableMessage & message)
+{
+  if (message.header_stamp) {
+    message.publisher->publish(
+      rewrite_header_stamp(
+        message.message, *message.header_stamp,
+        replay_time_point(*message.message).time_since_epoch().count()));
+  } else {
+    message.publisher->publish(message.message->serialized_data);
+  }
+  ROSBAG2_TRACEPOINT(
+    publish, message.message->topic_name.c_str(), message.message->time_stamp);
+}
+
+std::shared_ptr<rcutils_uint8_array_t> Player::rewrite_header_stamp(
+  const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message,
+  const rosbag2_cpp::CdrFieldExtractor & header_stamp, rcutils_time_point_value_t bag_time) const
+{
+  if (!message->serialized_data) {
+    return message->serialized_data;
+  }
+  // Only a buffer the message owns alone is written to. Others are shared, e.g. views with the
+  // other preloaded messages or decoded data with the reference of the delta decoder.
+  const bool shared = message->serialized_data.use_count() != 1 ||
+    rosbag2_storage::is_serialized_data_view(*message->serialized_data);
+  auto serialized_data = message->serialized_data;
+  if (shared) {
+    serialized_data = rosbag2_storage::make_serialized_message(
+      serialized_data->buffer, serialized_data->buffer_length);
+  }
+  const auto stamp = stamps_bag_time_ ? bag_time :
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  try {
+    header_stamp.rewrite_time(*serialized_data, stamp);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_WARN_STREAM(
+      "Publishing message on topic '" << message->topic_name << "' with its recorded header "
+        "stamp: " << e.what());
+  }
+  return serialized_data;
+}
+
+void Player::publish_message_logging_errors(const ReplayableMessage & message)
+{
+  // Exceptions must not escape the publishing threads.
+  try {
+    publish_message(message);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_ERROR_STREAM("Failed to publish message: " << e.what());
+  }
 }
 
 void Player::play_messages_until_queue_empty(const PlayOptions & options)
 {
   ReplayableMessage message;
 
-  float rate = 1.0;
-  // Use rate if in valid range
-  if (options.rate > 0.0) {
-    rate = options.rate;
+  while (message_queue_.try_dequeue(message) && is_playing()) {
+    const auto & serialized_data = message.message->serialized_data;
+    const auto size = serialized_data ? serialized_data->buffer_length : 0u;
+    queued_bytes_ -= size;
+    queue_memory_account_->release(size);
+    if (is_queue_below_lower_boundary()) {
+      notify_queue_waiter(queue_drained_);
+    }
+    if (!wait_until_due(message, options)) {
+      continue;
+    }
+    ++played_messages_;
+    last_played_time_stamp_ = message.message->time_stamp;
+    if (publishing_threads_.empty()) {
+      publish_message(message);
+    } else {
+      publishing_threads_[message.publishing_thread]->queue.enqueue(std::move(message));
+    }
   }
+}
 
-  while (message_queue_.try_dequeue(message) && rclcpp::ok()) {
-    std::this_thread::sleep_until(
-      start_time_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
-        1.0 / rate * message.time_since_start));
-    if (rclcpp::ok()) {
-      publishers_[message.message->topic_name]->publish(message.message->serialized_data);
+bool Player::wait_until_due(const ReplayableMessage & message, const PlayOptions & options)
+{
+  const bool publishes_clock = clock_publisher_ && !options.as_fast_as_possible;
+  std::chrono::steady_clock::time_point due_time;
+  std::unique_lock<std::mutex> lock(playback_mutex_);
+  while (true) {
+    if (!is_playing() || message.seek_generation != seek_generation_) {
+      return false;
     }
+    const auto now = std::chrono::steady_clock::now();
+    if (publishes_clock && now >= next_clock_time_) {
+      publish_clock(next_clock_time_);
+      next_clock_time_ = std::max(next_clock_time_ + clock_period_, now);
+      continue;
+    }
+    auto wake_time = now + queue_read_wait_period_;
+    if (paused_) {
+      if (pending_steps_ > 0) {
+        // Played right away, and the paused timeline moves on to the message.
+        --pending_steps_;
+        start_position_ = message.time_since_start;
+        start_time_ = now;
+        return true;
+      }
+    } else if (options.as_fast_as_possible) {
+      return true;
+    } else {
+      due_time = get_due_time(message);
+      wake_time = due_time - options.busy_wait_period;
+      if (now >= wake_time) {
+        break;
+      }
+    }
+    if (publishes_clock) {
+      wake_time = std::min(wake_time, next_clock_time_);
+    }
+    playback_changed_.wait_until(lock, wake_time);
   }
+  lock.unlock();
+
+  sleep_until_with_busy_wait(due_time, std::chrono::microseconds(0));
+  add_timing_error(std::chrono::steady_clock::now() - due_time);
+  return is_playing();
+}
+
+std::chrono::nanoseconds Player::get_position(
+  const std::chrono::steady_clock::time_point & time) const
+{
+  if (paused_) {
+    return start_position_;
+  }
+  return start_position_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+    rate_ * (time - start_time_));
+}
+
+std::chrono::steady_clock::time_point Player::get_due_time(
+  const ReplayableMessage & message) const
+{
+  return start_time_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+    (message.time_since_start - start_position_) / rate_);
+}
+
+void Player::rebase_timeline(const std::chrono::steady_clock::time_point & time)
+{
+  start_position_ = get_position(time);
+  start_time_ = time;
+}
+
+void Player::synchronize_start(const PlayOptions & options)
+{
+  const auto reference_time = std::chrono::system_clock::now().time_since_epoch() +
+    std::chrono::nanoseconds(options.clock_offset);
+  const auto time_to_start = std::chrono::nanoseconds(options.start_at) -
+    std::chrono::duration_cast<std::chrono::nanoseconds>(reference_time);
+  start_time_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(time_to_start);
+  if (options.start_at_time_stamp > 0) {
+    start_position_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      TimePoint(std::chrono::nanoseconds(options.start_at_time_stamp)) - time_first_message_);
+  }
+  if (time_to_start.count() < 0) {
+    ROSBAG2_TRANSPORT_LOG_WARN_STREAM(
+      "The start time passed " << -std::chrono::duration<double>(time_to_start).count() <<
+        " s ago. The messages due since are published right away.");
+  }
+}
+
+void Player::publish_clock(const std::chrono::steady_clock::time_point & time)
+{
+  const auto bag_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    time_first_message_.time_since_epoch()) + get_position(time);
+  rosgraph_msgs::msg::Clock clock;
+  clock.clock = rclcpp::Time(bag_time.count());
+  clock_publisher_->publish(clock);
+}
+
+void Player::pause()
+{
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    rebase_timeline(std::chrono::steady_clock::now());
+    paused_ = true;
+  }
+  playback_changed_.notify_all();
+}
+
+void Player::resume()
+{
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    rebase_timeline(std::chrono::steady_clock::now());
+    paused_ = false;
+  }
+  playback_changed_.notify_all();
+}
+
+bool Player::play_next()
+{
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    if (!paused_) {
+      return false;
+    }
+    ++pending_steps_;
+  }
+  playback_changed_.notify_all();
+  return true;
+}
+
+bool Player::set_rate(double rate)
+{
+  if (rate <= 0.0) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    rebase_timeline(std::chrono::steady_clock::now());
+    rate_ = rate;
+  }
+  playback_changed_.notify_all();
+  return true;
+}
+
+bool Player::seek(rcutils_time_point_value_t time)
+{
+  // The loader only reads and enqueues while holding the reader lock, so it is stopped while
+  // seeking, and every message it loads after this is of the new generation. The queue has a
+  // single consumer, so it is not cleared here, but the player and the publishing threads drop
+  // the messages queued before.
+  std::lock_guard<std::mutex> reader_lock(reader_mutex_);
+  if (cache_complete_) {
+    // Like the storage, continues at the first message not recorded before the time.
+    const auto cached_message = std::find_if(
+      cached_messages_.begin(), cached_messages_.end(),
+      [time](const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message) {
+        return message->time_stamp >= time;
+      });
+    cache_position_ = static_cast<size_t>(cached_message - cached_messages_.begin());
+    reading_cache_ = true;
+  } else {
+    try {
+      reader_->seek(time);
+    } catch (const std::runtime_error & e) {
+      ROSBAG2_TRANSPORT_LOG_ERROR_STREAM("Failed to seek: " << e.what());
+      return false;
+    }
+    // An incomplete cache only holds the bag in order from its start.
+    if (filling_cache_) {
+      stop_filling_message_cache();
+    }
+  }
+  ++seek_generation_;
+  publish_latched_messages(time);
+  {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    start_position_ = std::max(
+      std::chrono::nanoseconds(0),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        TimePoint(std::chrono::nanoseconds(time)) - time_first_message_));
+    start_time_ = std::chrono::steady_clock::now();
+    pending_steps_ = 0;
+  }
+  playback_changed_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    storage_loaded_ = false;
+  }
+  queue_drained_.notify_one();
+  return true;
+}
+
+void Player::publish_latched_messages(rcutils_time_point_value_t time)
+{
+  if (latched_topic_names_.empty()) {
+    return;
+  }
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  try {
+    messages = reader_->read_latest_messages(latched_topic_names_, time);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_WARN_STREAM(
+      "Failed to read the latest messages of the latched topics: " << e.what());
+    return;
+  }
+  transform_messages(messages);
+  for (const auto & message : messages) {
+    // Transforms may move messages to topics which are not played.
+    const auto topic_publisher = publishers_.find(message->topic_name);
+    if (topic_publisher == publishers_.end()) {
+      continue;
+    }
+    try {
+      const auto & header_stamp = topic_publisher->second.header_stamp;
+      get_publisher(message->topic_name, topic_publisher->second).publish(
+        header_stamp ?
+        rewrite_header_stamp(message, *header_stamp, time) :
+        message->serialized_data);
+    } catch (const std::runtime_error & e) {
+      ROSBAG2_TRANSPORT_LOG_ERROR_STREAM("Failed to publish message: " << e.what());
+    }
+  }
+}
+
+void Player::add_timing_error(std::chrono::nanoseconds timing_error)
+{
+  const auto timing_error_us = std::chrono::duration<double, std::micro>(timing_error).count();
+  ++timing_error_count_;
+  timing_error_sum_us_ += timing_error_us;
+  timing_error_squared_sum_us_ += timing_error_us * timing_error_us;
+  timing_error_max_us_ = std::max(timing_error_max_us_, timing_error_us);
+}
+
+void Player::report_playback_statistics() const
+{
+  if (played_messages_ == 0) {
+    return;
+  }
+  // Publishing threads are joined already, so this includes the time of their last publish.
+  const auto seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - playback_start_time_).count();
+  ROSBAG2_TRANSPORT_LOG_INFO_STREAM(
+    "Played " << played_messages_ << " messages in " << seconds << " s (" <<
+      static_cast<double>(played_messages_) / std::max(seconds, 1e-9) << " messages/s).");
+  if (timing_error_count_ == 0) {
+    return;
+  }
+  const auto count = static_cast<double>(timing_error_count_);
+  const auto mean = timing_error_sum_us_ / count;
+  const auto variance = std::max(timing_error_squared_sum_us_ / count - mean * mean, 0.0);
+  ROSBAG2_TRANSPORT_LOG_INFO_STREAM(
+    "Timing error: mean " << mean << " us, standard deviation " << std::sqrt(variance) <<
+      " us, max " << timing_error_max_us_ << " us.");
 }
 
 void Player::prepare_publishers(const PlayOptions & options)
 {
+  const auto & filtered_topics = options.topics_to_filter;
+  std::vector<std::string> played_topic_names;
+  bool has_dropped_topics = false;
+
+  auto topics = reader_->get_all_topics_and_types();
+  latched_topic_names_.clear();
+  for (const auto & bag_topic : topics) {
+    // Published with the name, type and QoS profiles the transforms give the topic, if any.
+    auto topic = bag_topic;
+    if (!transforms_.transform_topic(topic)) {
+      has_dropped_topics = true;
+      continue;
+    }
+    auto topic_qos = publisher_qos_for_topic(
+      topic, topic_qos_profile_overrides_, parsed_qos_profiles_);
+    auto topic_publisher = publishers_.find(topic.name);
+    if (topic_publisher == publishers_.end()) {
+      topic_publisher = publishers_.insert(
+        std::make_pair(
+          topic.name, TopicPublisher{nullptr, 0, topic.type, topic_qos, nullptr})).first;
+    }
+    const bool played = filtered_topics.empty() ||
+      std::find(filtered_topics.begin(), filtered_topics.end(), bag_topic.name) !=
+      filtered_topics.end();
+    if (played) {
+      played_topic_names.push_back(bag_topic.name);
+    }
+    // The type of a topic does not change between playbacks, so its stamp is located once.
+    auto & header_stamp = topic_publisher->second.header_stamp;
+    if (!options.rewrite_header_stamps) {
+      header_stamp.reset();
+    } else if (played && !header_stamp) {
+      header_stamp = create_header_stamp_extractor(topic);
+    }
+    // Waiting for subscribers needs the publishers of all played topics.
+    if (played && (!options.lazy_publishers || options.wait_for_subscribers > 0)) {
+      get_publisher(topic.name, topic_publisher->second);
+    }
+    const bool latched =
+      topic_qos.get_rmw_qos_profile().durability == RMW_QOS_POLICY_DURABILITY_TRANSIENT_LOCAL ||
+      std::find(options.latched_topics.begin(), options.latched_topics.end(), bag_topic.name) !=
+      options.latched_topics.end();
+    if (played && latched) {
+      latched_topic_names_.push_back(bag_topic.name);
+    }
+  }
+
   rosbag2_storage::StorageFilter storage_filter;
-  storage_filter.topics = options.topics_to_filter;
+  storage_filter.topics = filtered_topics;
+  storage_filter.order_by_publish_time = options.order_by_publish_time;
+  // The topics dropped by the transforms are not read at all. If none is played, the transforms
+  // drop the messages read instead, as an empty list of topics would read all of them.
+  if (has_dropped_topics && !played_topic_names.empty()) {
+    storage_filter.topics = std::move(played_topic_names);
+  }
+
+  const auto start_time = reader_->get_metadata().starting_time +
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double>(options.start_offset));
+  if (options.duration > 0.0) {
+    const auto end_time = start_time + std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(options.duration));
+    storage_filter.end_time = end_time.time_since_epoch().count();
+  }
   reader_->set_filter(storage_filter);
 
-  auto topics = reader_->get_all_topics_and_types();
-  for (const auto & topic : topics) {
-    auto topic_qos = publisher_qos_for_topic(topic, topic_qos_profile_overrides_);
-    publishers_.insert(
-      std::make_pair(
-        topic.name, rosbag2_transport_->create_generic_publisher(
-          topic.name, topic.type, topic_qos)));
+  loop_start_time_ = start_time.time_since_epoch().count();
+  if (options.start_offset > 0.0) {
+    reader_->seek(loop_start_time_);
   }
+
+  if (options.clock_publish_frequency > 0.0 && !clock_publisher_) {
+    clock_publisher_ =
+      rosbag2_transport_->create_publisher<rosgraph_msgs::msg::Clock>("/clock", rclcpp::QoS(10));
+    clock_period_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(1.0 / options.clock_publish_frequency));
+  }
+
+  // Each topic is published by a single thread, which keeps its messages in order.
+  publishing_thread_count_ = std::min(options.publishing_threads, publishers_.size());
+  size_t publishing_thread = 0;
+  for (auto & topic_publisher : publishers_) {
+    topic_publisher.second.publishing_thread = publishing_thread;
+    if (publishing_thread_count_ > 0) {
+      publishing_thread = (publishing_thread + 1) % publishing_thread_count_;
+    }
+  }
+}
+
+TimePoint Player::replay_time_point(const rosbag2_storage::SerializedBagMessage & message) const
+{
+  const auto time_stamp = order_by_publish_time_ && message.publish_time_stamp != 0 ?
+    message.publish_time_stamp : message.time_stamp;
+  return TimePoint(std::chrono::nanoseconds(time_stamp));
 }
 
 }  // namespace rosbag2_transport
@@ -15,19 +15,41 @@
 #ifndef ROSBAG2_TRANSPORT__PLAYER_HPP_
 #define ROSBAG2_TRANSPORT__PLAYER_HPP_
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "moodycamel/readerwriterqueue.h"
 
+#include "rclcpp/publisher.hpp"
 #include "rclcpp/qos.hpp"
+#include "rclcpp/service.hpp"
+
+#include "rcutils/time.h"
+#include "rcutils/types/uint8_array.h"
+
+#include "rosbag2_cpp/cdr_field_extractor.hpp"
+#include "rosbag2_cpp/memory_budget.hpp"
+#include "rosbag2_cpp/message_transform_chain.hpp"
+
+#include "rosbag2_interfaces/srv/seek.hpp"
+#include "rosbag2_interfaces/srv/set_rate.hpp"
 
 #include "rosbag2_transport/play_options.hpp"
 
+#include "rosgraph_msgs/msg/clock.hpp"
+
+#include "std_srvs/srv/trigger.hpp"
+
+#include "qos.hpp"
 #include "replayable_message.hpp"
 
 using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
@@ -46,30 +68,206 @@ class Rosbag2Node;
 class Player
 {
 public:
+  /**
+   * Also offers services on the node to control playback while play() runs:
+   * - ~/pause and ~/resume (std_srvs/Trigger) stop and continue the timeline.
+   * - ~/play_next (std_srvs/Trigger) publishes the next message right away while paused.
+   * - ~/set_rate (rosbag2_interfaces/SetRate) changes the rate from the current position on.
+   * - ~/seek (rosbag2_interfaces/Seek) continues at a bag time, dropping the read-ahead queue.
+   *
+   * The node is spun by play() unless spin_node is false, e.g. because a component container
+   * spins it.
+   */
   explicit Player(
     std::shared_ptr<rosbag2_cpp::Reader> reader,
-    std::shared_ptr<Rosbag2Node> rosbag2_transport);
+    std::shared_ptr<Rosbag2Node> rosbag2_transport,
+    bool spin_node = true);
 
+  // Plays until the end of the bag, or forever when looping, until stop() or shutdown.
   void play(const PlayOptions & options);
 
+  // Makes play() return soon, from any thread.
+  void stop();
+
 private:
-  void load_storage_content(const PlayOptions & options);
+  void create_control_services();
+  bool is_playing() const;
+  void play_once(const PlayOptions & options);
+  // Reading and rewinding, from the message cache once it holds the whole bag.
+  // Called with reader_mutex_ held.
+  bool has_next_message();
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> read_next_message();
+  void add_to_message_cache(const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message);
+  void stop_filling_message_cache();
+  void preload_messages(size_t max_bytes);
+  void rewind();
+  void load_storage_content();
+  void stop_loading_storage_content();
   bool is_storage_completely_loaded() const;
-  void enqueue_up_to_boundary(const TimePoint & time_first_message, uint64_t boundary);
-  void wait_for_filled_queue(const PlayOptions & options) const;
+  void enqueue_up_to_boundary();
+  // Transforms the messages read and enqueues them, with reader_mutex_ held.
+  void enqueue_loaded_messages(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> bag_messages);
+  void transform_messages(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & bag_messages);
+  void enqueue_loaded_message(std::shared_ptr<rosbag2_storage::SerializedBagMessage> bag_message);
+  void enqueue_message(ReplayableMessage && message);
+  bool is_queue_full() const;
+  bool is_queue_below_lower_boundary() const;
+  void wait_for_filled_queue();
+  void wait_for_queued_message();
+  void notify_queue_waiter(std::condition_variable & condition);
   void play_messages_from_queue(const PlayOptions & options);
   void play_messages_until_queue_empty(const PlayOptions & options);
+  // Waits until the message is due, which pausing, stepping and changing the rate affect.
+  // Returns false if the message was dropped by seeking or shutdown.
+  bool wait_until_due(const ReplayableMessage & message, const PlayOptions & options);
+  bool resolve_publisher(ReplayableMessage & message);
+  void publish_message(const ReplayableMessage & message);
+  // Serialized data of a message with its header stamp rewritten to the time it is published
+  // at, which is the given bag time if the clock is published.
+  std::shared_ptr<rcutils_uint8_array_t> rewrite_header_stamp(
+    const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message,
+    const rosbag2_cpp::CdrFieldExtractor & header_stamp,
+    rcutils_time_point_value_t bag_time) const;
+  void publish_message_logging_errors(const ReplayableMessage & message);
+  void start_publishing_threads();
+  void stop_publishing_threads();
+  // Timeline, guarded by playback_mutex_.
+  std::chrono::nanoseconds get_position(const std::chrono::steady_clock::time_point & time) const;
+  std::chrono::steady_clock::time_point get_due_time(const ReplayableMessage & message) const;
+  void rebase_timeline(const std::chrono::steady_clock::time_point & time);
+  // Moves the timeline so the start time stamp is due at the start time of the reference clock.
+  void synchronize_start(const PlayOptions & options);
+  void publish_clock(const std::chrono::steady_clock::time_point & time);
+  void pause();
+  void resume();
+  bool play_next();
+  bool set_rate(double rate);
+  bool seek(rcutils_time_point_value_t time);
+  // Publishes the latest message before the time of every latched topic, so subscribers have
+  // their values when playback continues at the time. The reader has to be locked.
+  void publish_latched_messages(rcutils_time_point_value_t time);
+  void add_timing_error(std::chrono::nanoseconds timing_error);
+  void report_playback_statistics() const;
+  // Reports the progress periodically if a callback is given.
+  void start_reporting_progress(const PlayOptions & options);
+  void wait_for_subscribers(size_t subscriber_count);
   void prepare_publishers(const PlayOptions & options);
+  struct TopicPublisher;
+  // Creates the publisher of the topic unless it exists already.
+  GenericPublisher & get_publisher(const std::string & topic_name, TopicPublisher & publisher);
+  TimePoint replay_time_point(const rosbag2_storage::SerializedBagMessage & message) const;
   static constexpr double read_ahead_lower_bound_percentage_ = 0.9;
   static const std::chrono::milliseconds queue_read_wait_period_;
 
   std::shared_ptr<rosbag2_cpp::Reader> reader_;
+  bool spin_node_ {true};
+  std::atomic_bool stop_playing_ {false};
+  // Held by the loader while it reads and enqueues a batch, and while seeking.
+  std::mutex reader_mutex_;
+  // Transforms of the topics and messages before they are published, guarded by reader_mutex_.
+  rosbag2_cpp::MessageTransformChain transforms_;
+  // Bag time which looping rewinds to.
+  rcutils_time_point_value_t loop_start_time_ {0};
+  // Messages kept in memory, either preloaded or those of the first loop if they fit into
+  // cache_max_bytes_, so they are played from memory once complete.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> cached_messages_;
+  size_t cached_bytes_ {0};
+  size_t cache_max_bytes_ {0};
+  size_t cache_position_ {0};
+  bool filling_cache_ {false};
+  bool cache_complete_ {false};
+  bool reading_cache_ {false};
   moodycamel::ReaderWriterQueue<ReplayableMessage> message_queue_;
-  std::chrono::time_point<std::chrono::system_clock> start_time_;
+  // Signal the loader when the queue drops below the lower boundary and the player when the
+  // loader enqueued a batch or reached the end of the bag. The queue itself is lock-free.
+  mutable std::mutex queue_mutex_;
+  std::condition_variable queue_drained_;
+  std::condition_variable queue_filled_;
+  // The queue is full once it holds either the maximum number of messages or bytes, and is
+  // refilled once it holds less than the lower boundary of both.
+  size_t queue_max_messages_ {0};
+  size_t queue_max_bytes_ {0};
+  size_t queue_lower_boundary_ {0};
+  size_t queue_lower_boundary_bytes_ {0};
+  // Serialized data of the queued messages, added by the loader and removed by the player.
+  std::atomic<size_t> queued_bytes_ {0};
+  // Books the queued bytes on the shared memory budget. The queue counts as full while the budget
+  // is exhausted, unless it is empty.
+  std::unique_ptr<rosbag2_cpp::MemoryBudget::Account> queue_memory_account_{
+    rosbag2_cpp::MemoryBudget::get_shared().open_account("player queue")};
+  // Set once the reader has no more messages, reset by seeking.
+  bool storage_loaded_ {false};
+  bool stop_loading_ {false};
+  // Incremented by seeking. Queued messages of earlier generations are dropped.
+  std::atomic<uint64_t> seek_generation_ {0};
+  // Replay time of the first message, which the positions on the timeline are relative to.
+  TimePoint time_first_message_;
+  // The timeline is at start_position_ at start_time_ and advances by rate_ unless paused.
+  // Steady, so playback is not affected by jumps of the system time.
+  std::mutex playback_mutex_;
+  std::condition_variable playback_changed_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::nanoseconds start_position_ {0};
+  double rate_ {1.0};
+  bool paused_ {false};
+  size_t pending_steps_ {0};
+  // Set until the first loop started at the start time of the options.
+  bool start_pending_ {false};
+  std::shared_ptr<rclcpp::Publisher<rosgraph_msgs::msg::Clock>> clock_publisher_;
+  std::chrono::nanoseconds clock_period_ {0};
+  std::chrono::steady_clock::time_point next_clock_time_;
   mutable std::future<void> storage_loading_future_;
   std::shared_ptr<Rosbag2Node> rosbag2_transport_;
-  std::unordered_map<std::string, std::shared_ptr<GenericPublisher>> publishers_;
+  std::shared_ptr<rclcpp::Service<std_srvs::srv::Trigger>> pause_service_;
+  std::shared_ptr<rclcpp::Service<std_srvs::srv::Trigger>> resume_service_;
+  std::shared_ptr<rclcpp::Service<std_srvs::srv::Trigger>> play_next_service_;
+  std::shared_ptr<rclcpp::Service<rosbag2_interfaces::srv::SetRate>> set_rate_service_;
+  std::shared_ptr<rclcpp::Service<rosbag2_interfaces::srv::Seek>> seek_service_;
+  struct TopicPublisher
+  {
+    // Null until the publisher is needed, the topics of the bag which are not played have none.
+    std::shared_ptr<GenericPublisher> publisher;
+    // Index of the publishing thread of the topic, if there are publishing threads.
+    size_t publishing_thread;
+    std::string type;
+    rclcpp::QoS qos;
+    // Set if the header stamps of the topic are rewritten, see PlayOptions.
+    std::shared_ptr<const rosbag2_cpp::CdrFieldExtractor> header_stamp;
+  };
+  // The topics are listed before playing, their publishers may be created by the loading thread.
+  std::unordered_map<std::string, TopicPublisher> publishers_;
+  std::mutex publishers_mutex_;
+  // Topics published with transient local durability or listed as latched in the play options.
+  std::vector<std::string> latched_topic_names_;
   std::unordered_map<std::string, rclcpp::QoS> topic_qos_profile_overrides_;
+  // Offered QoS profiles of the topics by their YAML, which is parsed once for all topics and
+  // playbacks sharing it.
+  std::unordered_map<std::string, std::vector<Rosbag2QoS>> parsed_qos_profiles_;
+  bool order_by_publish_time_ {false};
+  // Whether rewritten header stamps are the bag time instead of the system time.
+  bool stamps_bag_time_ {false};
+  // Publishes the messages of its topics in the order it receives them from the playing thread.
+  struct PublishingThread
+  {
+    moodycamel::BlockingReaderWriterQueue<ReplayableMessage> queue;
+    std::thread thread;
+  };
+  // Empty if the playing thread publishes itself.
+  std::vector<std::unique_ptr<PublishingThread>> publishing_threads_;
+  size_t publishing_thread_count_ {0};
+  std::atomic_bool stop_publishing_ {false};
+  // Lateness of the published messages against the time they were due at, reported when done.
+  uint64_t timing_error_count_ {0};
+  double timing_error_sum_us_ {0.0};
+  double timing_error_squared_sum_us_ {0.0};
+  double timing_error_max_us_ {0.0};
+  // Read by the progress timer while playing.
+  std::atomic<uint64_t> played_messages_ {0};
+  std::atomic<rcutils_time_point_value_t> last_played_time_stamp_ {0};
+  rclcpp::TimerBase::SharedPtr progress_timer_;
+  std::chrono::steady_clock::time_point playback_start_time_;
 };
 
 }  // namespace rosbag2_transport
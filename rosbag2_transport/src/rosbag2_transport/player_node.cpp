@@ -0,0 +1,101 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "player_node.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+#include "rmw/rmw.h"
+
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+
+#include "rosbag2_transport/logging.hpp"
+#include "rosbag2_transport/play_options.hpp"
+#include "rosbag2_transport/storage_options.hpp"
+
+#include "player.hpp"
+#include "rosbag2_node.hpp"
+
+namespace rosbag2_transport
+{
+
+PlayerNode::PlayerNode(const rclcpp::NodeOptions & options)
+: PlayerNode(
+    options,
+    std::make_shared<rosbag2_cpp::Reader>(
+      std::make_unique<rosbag2_cpp::readers::SequentialReader>()))
+{}
+
+PlayerNode::PlayerNode(
+  const rclcpp::NodeOptions & options, std::shared_ptr<rosbag2_cpp::Reader> reader)
+: node_(std::make_shared<Rosbag2Node>("rosbag2_player", options)), reader_(std::move(reader))
+{
+  StorageOptions storage_options{};
+  storage_options.uri = node_->declare_parameter<std::string>("uri", "");
+  storage_options.storage_id = node_->declare_parameter<std::string>("storage_id", "sqlite3");
+  if (storage_options.uri.empty()) {
+    throw std::invalid_argument("The parameter uri of the bag to play must be given.");
+  }
+
+  PlayOptions play_options{};
+  const auto read_ahead_queue_size =
+    node_->declare_parameter<int64_t>("read_ahead_queue_size", 1000);
+  if (read_ahead_queue_size <= 0) {
+    throw std::invalid_argument("The parameter read_ahead_queue_size must be positive.");
+  }
+  play_options.read_ahead_queue_size = static_cast<size_t>(read_ahead_queue_size);
+  play_options.topics_to_filter =
+    node_->declare_parameter<std::vector<std::string>>("topics", std::vector<std::string>{});
+  play_options.rate = static_cast<float>(node_->declare_parameter<double>("rate", 1.0));
+  play_options.loop = node_->declare_parameter<bool>("loop", false);
+  play_options.start_offset = node_->declare_parameter<double>("start_offset", 0.0);
+  play_options.duration = node_->declare_parameter<double>("duration", 0.0);
+  play_options.clock_publish_frequency =
+    node_->declare_parameter<double>("clock_publish_frequency", 0.0);
+  play_options.start_paused = node_->declare_parameter<bool>("start_paused", false);
+
+  reader_->open(storage_options, {"", rmw_get_serialization_format()});
+  // The container spins the node, which serves the control services and the progress.
+  player_ = std::make_unique<Player>(reader_, node_, false);
+  play_thread_ = std::thread(
+    [this, play_options]() {
+      try {
+        player_->play(play_options);
+      } catch (const std::runtime_error & e) {
+        ROSBAG2_TRANSPORT_LOG_ERROR("Failed to play: %s", e.what());
+      }
+    });
+}
+
+PlayerNode::~PlayerNode()
+{
+  player_->stop();
+  play_thread_.join();
+}
+
+rclcpp::node_interfaces::NodeBaseInterface::SharedPtr PlayerNode::get_node_base_interface()
+{
+  return node_->get_node_base_interface();
+}
+
+}  // namespace rosbag2_transport
+
+RCLCPP_COMPONENTS_REGISTER_NODE(rosbag2_transport::PlayerNode)
@@ -0,0 +1,72 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TRANSPORT__PLAYER_NODE_HPP_
+#define ROSBAG2_TRANSPORT__PLAYER_NODE_HPP_
+
+#include <memory>
+#include <thread>
+
+#include "rclcpp/node_interfaces/node_base_interface.hpp"
+#include "rclcpp/node_options.hpp"
+
+#include "rosbag2_transport/visibility_control.hpp"
+
+namespace rosbag2_cpp
+{
+class Reader;
+}  // namespace rosbag2_cpp
+
+namespace rosbag2_transport
+{
+
+class Player;
+class Rosbag2Node;
+
+/**
+ * Plays a bag as a component, which can be loaded into the container of the nodes subscribing
+ * to its topics, so the messages are delivered within the process.
+ *
+ * The bag is given by the parameters uri and storage_id, the playback by topics, rate, loop,
+ * start_offset, duration, read_ahead_queue_size, clock_publish_frequency and start_paused, like
+ * the options of `ros2 bag play`. Playing starts on a thread of its own when the component is
+ * loaded and stops when it is unloaded, while the container serves the control services of the
+ * player.
+ */
+class PlayerNode
+{
+public:
+  ROSBAG2_TRANSPORT_PUBLIC
+  explicit PlayerNode(const rclcpp::NodeOptions & options);
+
+  /// Constructor for testing, allows to set the reader to use
+  ROSBAG2_TRANSPORT_PUBLIC
+  PlayerNode(const rclcpp::NodeOptions & options, std::shared_ptr<rosbag2_cpp::Reader> reader);
+
+  ROSBAG2_TRANSPORT_PUBLIC
+  ~PlayerNode();
+
+  ROSBAG2_TRANSPORT_PUBLIC
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface();
+
+private:
+  std::shared_ptr<Rosbag2Node> node_;
+  std::shared_ptr<rosbag2_cpp::Reader> reader_;
+  std::unique_ptr<Player> player_;
+  std::thread play_thread_;
+};
+
+}  // namespace rosbag2_transport
+
+#endif  // ROSBAG2_TRANSPORT__PLAYER_NODE_HPP_
@@ -15,19 +15,35 @@
 #include "recorder.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <future>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "rclcpp/executors/multi_threaded_executor.hpp"
+#include "rcpputils/shared_library.hpp"
+
+#include "rosbag2_cpp/message_transform_chain.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_cpp/typesupport_helpers.hpp"
 #include "rosbag2_cpp/writer.hpp"
 
+#include "rosbag2_storage/message_pool.hpp"
+// Defines the tracepoints of rosbag2_transport.
+#define ROSBAG2_TRACEPOINT_DEFINE
+#include "rosbag2_storage/tracing.hpp"
+
 #include "rosbag2_transport/logging.hpp"
 
 #include "generic_subscription.hpp"
+#include "message_throttle.hpp"
 #include "qos.hpp"
 #include "rosbag2_node.hpp"
 
@@ -44,39 +60,113 @@
 # pragma warning(pop)
 #endif
 
+namespace
+{
+// Messages are usually released by the writer soon after being received, unless they are cached.
+constexpr size_t kMaxPooledMessages = 32;
+}  // unnamed namespace
+
 namespace rosbag2_transport
 {
+const std::chrono::milliseconds
+Recorder::writer_wait_period_ = std::chrono::milliseconds(100);
+
 Recorder::Recorder(std::shared_ptr<rosbag2_cpp::Writer> writer, std::shared_ptr<Rosbag2Node> node)
 : writer_(std::move(writer)), node_(std::move(node)) {}
 
+Recorder::~Recorder()
+{
+  stop();
+}
+
 void Recorder::record(const RecordOptions & record_options)
 {
+  start(record_options);
+  spin_node();
+  stop();
+}
+
+void Recorder::start(const RecordOptions & record_options)
+{
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    transforms_ = rosbag2_cpp::MessageTransformChain(record_options.transforms);
+  }
   topic_qos_profile_overrides_ = record_options.topic_qos_profile_overrides;
+  topic_throttles_ = record_options.topic_throttles;
+  // Invalid expressions throw std::regex_error, which is a std::runtime_error.
+  const auto regex_flags = std::regex::ECMAScript | std::regex::optimize;
+  include_regex_ = record_options.regex.empty() ?
+    nullptr : std::make_unique<std::regex>(record_options.regex, regex_flags);
+  exclude_regex_ = record_options.exclude.empty() ?
+    nullptr : std::make_unique<std::regex>(record_options.exclude, regex_flags);
   if (record_options.rmw_serialization_format.empty()) {
     throw std::runtime_error("No serialization format specified!");
   }
   serialization_format_ = record_options.rmw_serialization_format;
+  recorder_threads_ = record_options.recorder_threads;
+  has_recorder_scheduling_ =
+    record_options.thread_scheduling.count(rosbag2_cpp::ThreadRole::RECORDER) > 0;
+  start_publishing_statistics(record_options.statistics_interval);
+  start_reporting_progress(record_options);
+  if (is_multi_threaded()) {
+    stop_writing_ = false;
+    writer_thread_ = std::thread{[this]() {run_writer_thread();}};
+  }
   ROSBAG2_TRANSPORT_LOG_INFO("Listening for topics...");
   subscribe_topics(
     get_requested_or_available_topics(record_options.topics, record_options.include_hidden_topics));
 
-  std::future<void> discovery_future;
+  stop_discovery_ = false;
   if (!record_options.is_discovery_disabled) {
     auto discovery = std::bind(
       &Recorder::topics_discovery, this,
       record_options.topic_polling_interval,
       record_options.topics,
       record_options.include_hidden_topics);
-    discovery_future = std::async(std::launch::async, discovery);
+    discovery_future_ = std::async(std::launch::async, discovery);
   }
+}
 
-  record_messages();
-
-  if (discovery_future.valid()) {
-    discovery_future.wait();
+void Recorder::stop()
+{
+  stop_discovery_ = true;
+  if (discovery_future_.valid()) {
+    discovery_future_.wait();
+  }
+  if (writer_thread_.joinable()) {
+    stop_writing_ = true;
+    writer_thread_.join();
   }
 
   subscriptions_.clear();
+  dropped_topics_.clear();
+  statistics_timer_.reset();
+  progress_timer_.reset();
+}
+
+void Recorder::create_snapshot_service()
+{
+  snapshot_service_ = node_->create_service<std_srvs::srv::Trigger>(
+    "~/snapshot",
+    [this](
+      const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+      std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+    {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      try {
+        response->success = writer_->take_snapshot();
+        if (!response->success) {
+          response->message = "The writer is not in snapshot mode.";
+        }
+      } catch (const std::runtime_error & e) {
+        response->success = false;
+        response->message = e.what();
+      }
+      if (!response->success) {
+        ROSBAG2_TRANSPORT_LOG_ERROR_STREAM("Failed to take a snapshot: " << response->message);
+      }
+    });
 }
 
 void Recorder::topics_discovery(
@@ -84,20 +174,31 @@ void Recorder::topics_discovery(
   const std::vector<std::string> & requested_topics,
   bool include_hidden_topics)
 {
-  while (rclcpp::ok()) {
-    auto topics_to_subscribe =
-      get_requested_or_available_topics(requested_topics, include_hidden_topics);
-    for (const auto & topic_and_type : topics_to_subscribe) {
-      warn_if_new_qos_for_subscribed_topic(topic_and_type.first);
-    }
-    auto missing_topics = get_missing_topics(topics_to_subscribe);
-    subscribe_topics(missing_topics);
+  rosbag2_cpp::ThreadPool::configure_current_thread();
+  // The graph event is set whenever publishers or subscriptions appear or vanish, so the topics
+  // are only looked up again after a change. The polling interval bounds the time it takes to
+  // notice a shutdown.
+  auto graph_event = node_->get_graph_event();
+  bool graph_changed = true;
+  while (rclcpp::ok() && !stop_discovery_) {
+    if (graph_changed) {
+      auto topics_to_subscribe =
+        get_requested_or_available_topics(requested_topics, include_hidden_topics);
+      for (const auto & topic_and_type : topics_to_subscribe) {
+        warn_if_new_qos_for_subscribed_topic(topic_and_type.first);
+      }
+      auto missing_topics = get_missing_topics(topics_to_subscribe);
+      subscribe_topics(missing_topics);
 
-    if (!requested_topics.empty() && subscriptions_.size() == requested_topics.size()) {
-      ROSBAG2_TRANSPORT_LOG_INFO("All requested topics are subscribed. Stopping discovery...");
-      return;
+      if (!requested_topics.empty() &&
+        subscriptions_.size() + dropped_topics_.size() == requested_topics.size())
+      {
+        ROSBAG2_TRANSPORT_LOG_INFO("All requested topics are subscribed. Stopping discovery...");
+        return;
+      }
     }
-    std::this_thread::sleep_for(topic_polling_interval);
+    node_->wait_for_graph_change(graph_event, topic_polling_interval);
+    graph_changed = graph_event->check_and_clear();
   }
 }
 
@@ -106,9 +207,11 @@ Recorder::get_requested_or_available_topics(
   const std::vector<std::string> & requested_topics,
   bool include_hidden_topics)
 {
-  return requested_topics.empty() ?
-         node_->get_all_topics_with_types(include_hidden_topics) :
-         node_->get_topics_with_types(requested_topics);
+  if (!requested_topics.empty()) {
+    return node_->get_topics_with_types(requested_topics);
+  }
+  return node_->get_all_topics_with_types(
+    include_hidden_topics, include_regex_.get(), exclude_regex_.get());
 }
 
 std::unordered_map<std::string, std::string>
@@ -116,7 +219,9 @@ Recorder::get_missing_topics(const std::unordered_map<std::string, std::string>
 {
   std::unordered_map<std::string, std::string> missing_topics;
   for (const auto & i : all_topics) {
-    if (subscriptions_.find(i.first) == subscriptions_.end()) {
+    if (subscriptions_.find(i.first) == subscriptions_.end() &&
+      dropped_topics_.find(i.first) == dropped_topics_.end())
+    {
       missing_topics.emplace(i.first, i.second);
     }
   }
@@ -127,31 +232,88 @@ Recorder::get_missing_topics(const std::unordered_map<std::string, std::string>
 void Recorder::subscribe_topics(
   const std::unordered_map<std::string, std::string> & topics_and_types)
 {
+  // Querying the graph and loading the typesupport libraries takes most of the time when
+  // recording many topics, so it is done for all topics in parallel before subscribing.
+  auto & thread_pool = rosbag2_cpp::ThreadPool::get_shared();
+  std::vector<rosbag2_storage::TopicMetadata> topics;
+  std::vector<std::future<std::vector<rclcpp::TopicEndpointInfo>>> pending_endpoints;
+  topics.reserve(topics_and_types.size());
+  pending_endpoints.reserve(topics_and_types.size());
   for (const auto & topic_with_type : topics_and_types) {
-    subscribe_topic(
-      {
-        topic_with_type.first,
-        topic_with_type.second,
-        serialization_format_,
-        serialized_offered_qos_profiles_for_topic(topic_with_type.first)
-      });
+    topics.push_back({topic_with_type.first, topic_with_type.second, serialization_format_, ""});
+    pending_endpoints.push_back(
+      thread_pool.submit(
+        [this, topic_with_type]() {
+          // Subscribing finds the typesupport in the cache, or reports why it cannot be loaded.
+          try {
+            std::shared_ptr<rcpputils::SharedLibrary> library;
+            rosbag2_cpp::get_typesupport(
+              topic_with_type.second, "rosidl_typesupport_cpp", library);
+          } catch (const std::runtime_error &) {
+          }
+          // The graph is queried once per topic for both the recorded and the requested profiles.
+          return node_->get_publishers_info_by_topic(topic_with_type.first);
+        }));
+  }
+  for (auto & endpoints : pending_endpoints) {
+    endpoints.wait();
+  }
+  std::vector<std::vector<rclcpp::TopicEndpointInfo>> endpoints_of_topics;
+  endpoints_of_topics.reserve(topics.size());
+  for (size_t i = 0; i < topics.size(); ++i) {
+    endpoints_of_topics.push_back(pending_endpoints[i].get());
+    topics[i].offered_qos_profiles = serialized_offered_qos_profiles(endpoints_of_topics[i]);
   }
-}
 
-void Recorder::subscribe_topic(const rosbag2_storage::TopicMetadata & topic)
-{
-  // Need to create topic in writer before we are trying to create subscription. Since in
+  // Need to create topics in writer before we are trying to create subscriptions. Since in
   // callback for subscription we are calling writer_->write(bag_message); and it could happened
-  // that callback called before we reached out the line: writer_->create_topic(topic)
-  writer_->create_topic(topic);
+  // that callback called before we reached out the line: writer_->create_topics(topics).
+  // Creating them at once lets the storage insert them in a single transaction.
+  // Topics are written as the transforms change them, and not subscribed to if they drop them.
+  std::vector<bool> are_dropped(topics.size(), false);
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    if (transforms_.empty()) {
+      writer_->create_topics(topics);
+    } else {
+      std::vector<rosbag2_storage::TopicMetadata> transformed_topics;
+      for (size_t i = 0; i < topics.size(); ++i) {
+        auto topic = topics[i];
+        if (transforms_.transform_topic(topic)) {
+          transformed_topics.push_back(std::move(topic));
+        } else {
+          are_dropped[i] = true;
+          dropped_topics_.insert(topics[i].name);
+        }
+      }
+      writer_->create_topics(transformed_topics);
+    }
+  }
 
-  Rosbag2QoS subscription_qos{subscription_qos_for_topic(topic.name)};
+  for (size_t i = 0; i < topics.size(); ++i) {
+    if (!are_dropped[i]) {
+      subscribe_topic(topics[i], endpoints_of_topics[i]);
+    }
+  }
+}
+
+void Recorder::subscribe_topic(
+  const rosbag2_storage::TopicMetadata & topic,
+  const std::vector<rclcpp::TopicEndpointInfo> & endpoints)
+{
+  Rosbag2QoS subscription_qos{subscription_qos_for_topic(topic.name, endpoints)};
   auto subscription = create_subscription(topic.name, topic.type, subscription_qos);
   if (subscription) {
     subscriptions_.insert({topic.name, subscription});
     ROSBAG2_TRANSPORT_LOG_INFO_STREAM("Subscribed to topic '" << topic.name << "'");
   } else {
-    writer_->remove_topic(topic);
+    {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      auto transformed_topic = topic;
+      if (transforms_.transform_topic(transformed_topic)) {
+        writer_->remove_topic(transformed_topic);
+      }
+    }
     subscriptions_.erase(topic.name);
   }
 }
@@ -160,50 +322,269 @@ std::shared_ptr<GenericSubscription>
 Recorder::create_subscription(
   const std::string & topic_name, const std::string & topic_type, const rclcpp::QoS & qos)
 {
+  // Callbacks of a mutually exclusive group never run concurrently, which keeps the messages of
+  // a topic in order while different topics are received in parallel.
+  auto callback_group = is_multi_threaded() ?
+    node_->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive) : nullptr;
+  // Recycled messages keep the capacity of their topic name, so assigning it does not allocate.
+  auto message_pool = std::make_shared<rosbag2_storage::MessagePool>(kMaxPooledMessages);
+  std::shared_ptr<MessageThrottle> throttle;
+  const auto topic_throttle = topic_throttles_.find(topic_name);
+  if (topic_throttle != topic_throttles_.end()) {
+    throttle = std::make_shared<MessageThrottle>(topic_throttle->second);
+  }
+  std::shared_ptr<RecorderStatistics::TopicStatistics> topic_statistics;
+  if (is_collecting_statistics()) {
+    topic_statistics = statistics_.add_topic(topic_name);
+  }
+  // Spares the writer from looking up the topic by name. Transforms may rename topics.
+  auto topic_handle = rosbag2_storage::INVALID_TOPIC_HANDLE;
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    if (transforms_.empty()) {
+      topic_handle = writer_->get_topic_handle(topic_name);
+    }
+  }
   auto subscription = node_->create_generic_subscription(
     topic_name,
     topic_type,
     qos,
-    [this, topic_name](std::shared_ptr<rmw_serialized_message_t> message) {
-      auto bag_message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+    [this, topic_name, topic_handle, message_pool, throttle, topic_statistics](
+      std::shared_ptr<rmw_serialized_message_t> message, const rclcpp::MessageInfo & message_info)
+    {
+      const auto & rmw_message_info = message_info.get_rmw_message_info();
+      // The middleware reports the system time the message was received at, unless it is 0.
+      rcutils_time_point_value_t time_stamp = rmw_message_info.received_timestamp;
+      if (time_stamp == 0) {
+        int error = rcutils_system_time_now(&time_stamp);
+        if (error != RCUTILS_RET_OK) {
+          ROSBAG2_TRANSPORT_LOG_ERROR_STREAM(
+            "Error getting current time. Error:" << rcutils_get_error_string().str);
+        }
+      }
+      ROSBAG2_TRACEPOINT(
+        subscription_callback, topic_name.c_str(), time_stamp, message->buffer_length);
+      if (topic_statistics) {
+        ++topic_statistics->received_messages;
+        topic_statistics->received_bytes += message->buffer_length;
+      }
+      // Throttled messages are dropped before anything is allocated for them. The callbacks of
+      // a topic never run concurrently, so the throttle needs no locking.
+      if (throttle && !throttle->should_record(time_stamp)) {
+        if (topic_statistics) {
+          ++topic_statistics->throttled_messages;
+        }
+        return;
+      }
+
+      auto bag_message = message_pool->make_message();
       bag_message->serialized_data = message;
       bag_message->topic_name = topic_name;
-      rcutils_time_point_value_t time_stamp;
-      int error = rcutils_system_time_now(&time_stamp);
-      if (error != RCUTILS_RET_OK) {
-        ROSBAG2_TRANSPORT_LOG_ERROR_STREAM(
-          "Error getting current time. Error:" << rcutils_get_error_string().str);
-      }
+      bag_message->topic_handle = topic_handle;
       bag_message->time_stamp = time_stamp;
+      // Not every middleware reports the source time stamp, in which case it is 0.
+      bag_message->publish_time_stamp = rmw_message_info.source_timestamp;
 
-      writer_->write(bag_message);
-    });
+      if (!is_multi_threaded()) {
+        write_message(bag_message);
+        return;
+      }
+      message_queue_.enqueue(std::move(bag_message));
+    },
+    callback_group);
   return subscription;
 }
 
-void Recorder::record_messages() const
+void Recorder::spin_node()
+{
+  if (!has_recorder_scheduling_) {
+    spin_executor();
+    return;
+  }
+  // The threads of the executor inherit the scheduling of the thread starting them, so they are
+  // all scheduled by the recorder role, without changing the scheduling of the caller.
+  std::thread spin_thread{
+    [this]() {
+      rosbag2_cpp::ThreadPool::configure_current_thread(rosbag2_cpp::ThreadRole::RECORDER);
+      spin_executor();
+    }};
+  spin_thread.join();
+}
+
+void Recorder::spin_executor()
+{
+  if (!is_multi_threaded()) {
+    spin(node_);
+    return;
+  }
+
+  // The executor uses one thread per CPU core if the number of threads is 0.
+  rclcpp::executors::MultiThreadedExecutor executor{
+    rclcpp::ExecutorOptions(), static_cast<size_t>(recorder_threads_)};
+  executor.add_node(node_);
+  executor.spin();
+  executor.remove_node(node_);
+}
+
+void Recorder::start_publishing_statistics(std::chrono::milliseconds statistics_interval)
+{
+  if (statistics_interval.count() <= 0) {
+    return;
+  }
+  // Published below the node name, which is hidden, so the statistics are not recorded by
+  // default.
+  statistics_publisher_ =
+    node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("~/statistics", 10);
+  last_statistics_time_ = std::chrono::steady_clock::now();
+  statistics_timer_ = node_->create_wall_timer(
+    statistics_interval, [this]() {publish_statistics();});
+}
+
+void Recorder::publish_statistics()
+{
+  const auto now = std::chrono::steady_clock::now();
+  auto report = statistics_.make_report(now - last_statistics_time_, message_queue_.size_approx());
+  last_statistics_time_ = now;
+  report.header.stamp = node_->now();
+  statistics_publisher_->publish(report);
+}
+
+void Recorder::start_reporting_progress(const RecordOptions & record_options)
+{
+  if (!record_options.progress_callback || record_options.progress_interval.count() <= 0) {
+    return;
+  }
+  recorded_messages_ = 0;
+  recorded_bytes_ = 0;
+  const auto start_time = std::chrono::steady_clock::now();
+  progress_timer_ = node_->create_wall_timer(
+    record_options.progress_interval,
+    [this, start_time, callback = record_options.progress_callback]() {
+      RecordProgress progress{};
+      progress.recorded_messages = recorded_messages_;
+      progress.recorded_bytes = recorded_bytes_;
+      progress.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time);
+      callback(progress);
+    });
+}
+
+void Recorder::add_recorded_message(const rosbag2_storage::SerializedBagMessage & message)
+{
+  ++recorded_messages_;
+  recorded_bytes_ += message.serialized_data ? message.serialized_data->buffer_length : 0u;
+}
+
+void Recorder::run_writer_thread()
+{
+  rosbag2_cpp::ThreadPool::configure_current_thread(rosbag2_cpp::ThreadRole::WRITER);
+  // Everything queued since the last batch is written at once, up to the batch size.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages(
+    writer_batch_size_);
+  while (!stop_writing_) {
+    const auto count = message_queue_.wait_dequeue_bulk_timed(
+      messages.begin(), messages.size(), writer_wait_period_);
+    write_messages(messages, count);
+  }
+  // Queued messages are still written when stopping.
+  size_t count;
+  while ((count = message_queue_.try_dequeue_bulk(messages.begin(), messages.size())) > 0) {
+    write_messages(messages, count);
+  }
+}
+
+void Recorder::write_messages(
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages, size_t count)
+{
+  if (count == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  if (transforms_.empty()) {
+    for (size_t i = 0; i < count; ++i) {
+      write_transformed_message_logging_errors(messages[i]);
+      messages[i].reset();
+    }
+    return;
+  }
+  // The transforms may drop or add messages, so they get a batch of their own.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> transformed_messages(
+    std::make_move_iterator(messages.begin()),
+    std::make_move_iterator(messages.begin() + static_cast<std::ptrdiff_t>(count)));
+  try {
+    transforms_.transform(transformed_messages);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_ERROR_STREAM("Failed to transform messages: " << e.what());
+    return;
+  }
+  for (const auto & message : transformed_messages) {
+    write_transformed_message_logging_errors(message);
+  }
+}
+
+void Recorder::write_message(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  if (transforms_.empty()) {
+    write_transformed_message(message);
+    return;
+  }
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages{std::move(message)};
+  transforms_.transform(messages);
+  for (const auto & transformed_message : messages) {
+    write_transformed_message(transformed_message);
+  }
+}
+
+void Recorder::write_transformed_message(
+  const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message)
+{
+  const auto start = std::chrono::steady_clock::now();
+  writer_->write(message);
+  add_recorded_message(*message);
+  if (is_collecting_statistics()) {
+    statistics_.add_write_latency(std::chrono::steady_clock::now() - start);
+  }
+}
+
+void Recorder::write_transformed_message_logging_errors(
+  const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message)
+{
+  try {
+    write_transformed_message(message);
+  } catch (const std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_ERROR_STREAM("Failed to write message: " << e.what());
+  }
+}
+
+bool Recorder::is_multi_threaded() const
+{
+  return recorder_threads_ != 1u;
+}
+
+bool Recorder::is_collecting_statistics() const
 {
-  spin(node_);
+  return statistics_publisher_ != nullptr;
 }
 
-std::string Recorder::serialized_offered_qos_profiles_for_topic(const std::string & topic_name)
+std::string Recorder::serialized_offered_qos_profiles(
+  const std::vector<rclcpp::TopicEndpointInfo> & endpoints)
 {
   YAML::Node offered_qos_profiles;
-  auto endpoints = node_->get_publishers_info_by_topic(topic_name);
   for (const auto & info : endpoints) {
     offered_qos_profiles.push_back(Rosbag2QoS(info.qos_profile()));
   }
   return YAML::Dump(offered_qos_profiles);
 }
 
-rclcpp::QoS Recorder::subscription_qos_for_topic(const std::string & topic_name) const
+rclcpp::QoS Recorder::subscription_qos_for_topic(
+  const std::string & topic_name, const std::vector<rclcpp::TopicEndpointInfo> & endpoints) const
 {
   if (topic_qos_profile_overrides_.count(topic_name)) {
     ROSBAG2_TRANSPORT_LOG_INFO_STREAM("Overriding subscription profile for " << topic_name);
     return topic_qos_profile_overrides_.at(topic_name);
   }
-  return Rosbag2QoS::adapt_request_to_offers(
-    topic_name, node_->get_publishers_info_by_topic(topic_name));
+  return Rosbag2QoS::adapt_request_to_offers(topic_name, endpoints);
 }
 
 void Recorder::warn_if_new_qos_for_subscribed_topic(const std::string & topic_name)
@@ -15,22 +15,40 @@
 #ifndef ROSBAG2_TRANSPORT__RECORDER_HPP_
 #define ROSBAG2_TRANSPORT__RECORDER_HPP_
 
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <regex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "moodycamel/blockingconcurrentqueue.h"
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+#include "rclcpp/node_interfaces/node_graph_interface.hpp"
+#include "rclcpp/publisher.hpp"
 #include "rclcpp/qos.hpp"
+#include "rclcpp/service.hpp"
+#include "rclcpp/timer.hpp"
 
+#include "rosbag2_cpp/message_transform_chain.hpp"
 #include "rosbag2_cpp/writer.hpp"
 
 #include "rosbag2_storage/topic_metadata.hpp"
 
 #include "rosbag2_transport/record_options.hpp"
 
+#include "std_srvs/srv/trigger.hpp"
+
+#include "recorder_statistics.hpp"
+
 namespace rosbag2_cpp
 {
 class Writer;
@@ -47,8 +65,26 @@ class Recorder
 public:
   explicit Recorder(std::shared_ptr<rosbag2_cpp::Writer> writer, std::shared_ptr<Rosbag2Node> node);
 
+  ~Recorder();
+
+  // Records until rclcpp is shut down, spinning the node.
   void record(const RecordOptions & record_options);
 
+  /**
+   * Subscribes to the topics and keeps discovering new ones until stop() is called, but leaves
+   * spinning the node to the caller, e.g. to the executor of a component container.
+   */
+  void start(const RecordOptions & record_options);
+
+  // Stops discovering topics, writes the messages still queued and unsubscribes from all topics.
+  void stop();
+
+  /**
+   * Offers the ~/snapshot service, which writes the messages kept by a writer in snapshot mode
+   * to the bag. Must be called before record().
+   */
+  void create_snapshot_service();
+
   const std::unordered_set<std::string> &
   topics_using_fallback_qos() const
   {
@@ -78,12 +114,47 @@ private:
   void subscribe_topics(
     const std::unordered_map<std::string, std::string> & topics_and_types);
 
-  void subscribe_topic(const rosbag2_storage::TopicMetadata & topic);
+  // Subscribes to a topic which was created in the writer already.
+  void subscribe_topic(
+    const rosbag2_storage::TopicMetadata & topic,
+    const std::vector<rclcpp::TopicEndpointInfo> & endpoints);
 
   std::shared_ptr<GenericSubscription> create_subscription(
     const std::string & topic_name, const std::string & topic_type, const rclcpp::QoS & qos);
 
-  void record_messages() const;
+  void spin_node();
+  void spin_executor();
+
+  // Publishes the statistics periodically if an interval is given.
+  void start_publishing_statistics(std::chrono::milliseconds statistics_interval);
+
+  void publish_statistics();
+
+  // Reports the progress periodically if a callback is given.
+  void start_reporting_progress(const RecordOptions & record_options);
+
+  // Counts a message written to the bag for the progress.
+  void add_recorded_message(const rosbag2_storage::SerializedBagMessage & message);
+
+  // Writes the messages queued by the subscription callbacks in multi-threaded recording.
+  void run_writer_thread();
+
+  void write_message(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message);
+
+  void write_messages(
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages,
+    size_t count);
+
+  // Writes a message transformed already, with writer_mutex_ held.
+  void write_transformed_message(
+    const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message);
+
+  void write_transformed_message_logging_errors(
+    const std::shared_ptr<rosbag2_storage::SerializedBagMessage> & message);
+
+  bool is_multi_threaded() const;
+
+  bool is_collecting_statistics() const;
 
   /**
    * Find the QoS profile that should be used for subscribing.
@@ -92,21 +163,57 @@ private:
    * Otherwise, falls back to Rosbag2QoS::adapt_request_to_offers
    *
    *   \param topic_name The full name of the topic, with namespace (ex. /arm/joint_status).
+   *   \param endpoints The publishers currently offering the topic.
    *   \return The QoS profile to be used for subscribing.
    */
-  rclcpp::QoS subscription_qos_for_topic(const std::string & topic_name) const;
+  rclcpp::QoS subscription_qos_for_topic(
+    const std::string & topic_name,
+    const std::vector<rclcpp::TopicEndpointInfo> & endpoints) const;
 
-  // Serialize all currently offered QoS profiles for a topic into a YAML list.
-  std::string serialized_offered_qos_profiles_for_topic(const std::string & topic_name);
+  // Serialize the QoS profiles offered by the publishers of a topic into a YAML list.
+  static std::string serialized_offered_qos_profiles(
+    const std::vector<rclcpp::TopicEndpointInfo> & endpoints);
 
   void warn_if_new_qos_for_subscribed_topic(const std::string & topic_name);
 
+  static constexpr size_t writer_batch_size_ = 1000;
+  static const std::chrono::milliseconds writer_wait_period_;
+
   std::shared_ptr<rosbag2_cpp::Writer> writer_;
   std::shared_ptr<Rosbag2Node> node_;
   std::unordered_map<std::string, std::shared_ptr<GenericSubscription>> subscriptions_;
+  // Topics the transforms dropped, which are neither subscribed to nor looked up again.
+  std::unordered_set<std::string> dropped_topics_;
   std::unordered_set<std::string> topics_warned_about_incompatibility_;
   std::string serialization_format_;
   std::unordered_map<std::string, rclcpp::QoS> topic_qos_profile_overrides_;
+  std::unordered_map<std::string, TopicThrottle> topic_throttles_;
+  // Compiled once from RecordOptions::regex and RecordOptions::exclude, null if not given.
+  std::unique_ptr<std::regex> include_regex_;
+  std::unique_ptr<std::regex> exclude_regex_;
+  uint64_t recorder_threads_ = 1;
+  // Whether the executor spins on a thread of its own scheduled by the recorder role.
+  bool has_recorder_scheduling_ = false;
+  // Guards the writer, which is used by the subscription callbacks and topic discovery.
+  std::mutex writer_mutex_;
+  // Transforms of the topics and messages before they are written, guarded by writer_mutex_.
+  rosbag2_cpp::MessageTransformChain transforms_;
+  // Lock-free, so the subscription callbacks never wait for the writer thread.
+  moodycamel::BlockingConcurrentQueue<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>
+  message_queue_;
+  std::atomic_bool stop_writing_{false};
+  std::thread writer_thread_;
+  std::atomic_bool stop_discovery_{false};
+  std::future<void> discovery_future_;
+  std::shared_ptr<rclcpp::Service<std_srvs::srv::Trigger>> snapshot_service_;
+  // Only collected if statistics_publisher_ is set.
+  RecorderStatistics statistics_;
+  std::shared_ptr<rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>> statistics_publisher_;
+  rclcpp::TimerBase::SharedPtr statistics_timer_;
+  std::chrono::steady_clock::time_point last_statistics_time_;
+  std::atomic<uint64_t> recorded_messages_{0};
+  std::atomic<uint64_t> recorded_bytes_{0};
+  rclcpp::TimerBase::SharedPtr progress_timer_;
 };
 
 }  // namespace rosbag2_transport
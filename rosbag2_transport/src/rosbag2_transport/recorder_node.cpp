@@ -0,0 +1,111 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "recorder_node.hpp"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+#include "rmw/rmw.h"
+
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writers/sequential_writer.hpp"
+
+#include "rosbag2_transport/record_options.hpp"
+#include "rosbag2_transport/storage_options.hpp"
+
+#include "recorder.hpp"
+#include "rosbag2_node.hpp"
+
+namespace rosbag2_transport
+{
+
+RecorderNode::RecorderNode(const rclcpp::NodeOptions & options)
+: RecorderNode(
+    options,
+    std::make_shared<rosbag2_cpp::Writer>(
+      std::make_unique<rosbag2_cpp::writers::SequentialWriter>()))
+{}
+
+RecorderNode::RecorderNode(
+  const rclcpp::NodeOptions & options, std::shared_ptr<rosbag2_cpp::Writer> writer)
+: node_(std::make_shared<Rosbag2Node>("rosbag2_recorder", options)), writer_(std::move(writer))
+{
+  StorageOptions storage_options{};
+  storage_options.uri = node_->declare_parameter<std::string>("uri", "");
+  storage_options.storage_id = node_->declare_parameter<std::string>("storage_id", "sqlite3");
+  // Integer parameters are signed, so negative sizes are rejected.
+  const auto declare_size = [this](const std::string & name, int64_t default_value) {
+      const auto value = node_->declare_parameter<int64_t>(name, default_value);
+      if (value < 0) {
+        throw std::invalid_argument("The parameter " + name + " must not be negative.");
+      }
+      return static_cast<uint64_t>(value);
+    };
+  storage_options.max_bagfile_size = declare_size("max_bagfile_size", 0);
+  storage_options.max_bagfile_duration = declare_size("max_bagfile_duration", 0);
+  storage_options.max_cache_size = declare_size("max_cache_size", 0);
+  storage_options.bag_id = node_->declare_parameter<std::string>("bag_id", "");
+  storage_options.clock_offset_ns = node_->declare_parameter<int64_t>("clock_offset_ns", 0);
+  storage_options.stream_address = node_->declare_parameter<std::string>("stream_address", "");
+  storage_options.stream_max_memory_bytes =
+    declare_size("stream_max_memory_bytes", 64 * 1024 * 1024);
+  if (storage_options.uri.empty()) {
+    throw std::invalid_argument("The parameter uri of the bag to record to must be given.");
+  }
+
+  RecordOptions record_options{};
+  record_options.topics =
+    node_->declare_parameter<std::vector<std::string>>("topics", std::vector<std::string>{});
+  record_options.all = record_options.topics.empty();
+  record_options.regex = node_->declare_parameter<std::string>("regex", "");
+  record_options.exclude = node_->declare_parameter<std::string>("exclude", "");
+  record_options.include_hidden_topics =
+    node_->declare_parameter<bool>("include_hidden_topics", false);
+  record_options.is_discovery_disabled = node_->declare_parameter<bool>("no_discovery", false);
+  record_options.topic_polling_interval =
+    std::chrono::milliseconds(declare_size("topic_polling_interval_ms", 100));
+  record_options.rmw_serialization_format = node_->declare_parameter<std::string>(
+    "serialization_format", rmw_get_serialization_format());
+  // The node is spun by the executor of the container. With more than one thread, writing moves
+  // to a thread of its own and every topic gets a callback group for a multi-threaded executor.
+  record_options.recorder_threads = declare_size("recorder_threads", 1);
+
+  writer_->open(
+    storage_options, {rmw_get_serialization_format(), record_options.rmw_serialization_format});
+  recorder_ = std::make_unique<Recorder>(writer_, node_);
+  recorder_->start(record_options);
+}
+
+RecorderNode::~RecorderNode()
+{
+  // The messages still queued are written before the writer closes the bag.
+  recorder_.reset();
+  writer_.reset();
+}
+
+rclcpp::node_interfaces::NodeBaseInterface::SharedPtr RecorderNode::get_node_base_interface()
+{
+  return node_->get_node_base_interface();
+}
+
+}  // namespace rosbag2_transport
+
+RCLCPP_COMPONENTS_REGISTER_NODE(rosbag2_transport::RecorderNode)
@@ -0,0 +1,70 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TRANSPORT__RECORDER_NODE_HPP_
+#define ROSBAG2_TRANSPORT__RECORDER_NODE_HPP_
+
+#include <memory>
+
+#include "rclcpp/node_interfaces/node_base_interface.hpp"
+#include "rclcpp/node_options.hpp"
+
+#include "rosbag2_transport/visibility_control.hpp"
+
+namespace rosbag2_cpp
+{
+class Writer;
+}  // namespace rosbag2_cpp
+
+namespace rosbag2_transport
+{
+
+class Recorder;
+class Rosbag2Node;
+
+/**
+ * Records topics as a component, which can be loaded into the container of the nodes publishing
+ * them. Messages of publishers in the same process are then delivered by the middleware within
+ * the process instead of over the network, and loaned by middlewares supporting it.
+ *
+ * The bag is given by the parameters uri, storage_id, max_bagfile_size, max_bagfile_duration and
+ * max_cache_size, the topics by topics, regex, exclude, include_hidden_topics and no_discovery,
+ * like the options of `ros2 bag record`. All topics are recorded if no topics are given.
+ * Recording starts when the component is loaded and the bag is closed when it is unloaded.
+ */
+class RecorderNode
+{
+public:
+  ROSBAG2_TRANSPORT_PUBLIC
+  explicit RecorderNode(const rclcpp::NodeOptions & options);
+
+  /// Constructor for testing, allows to set the writer to use
+  ROSBAG2_TRANSPORT_PUBLIC
+  RecorderNode(const rclcpp::NodeOptions & options, std::shared_ptr<rosbag2_cpp::Writer> writer);
+
+  ROSBAG2_TRANSPORT_PUBLIC
+  ~RecorderNode();
+
+  ROSBAG2_TRANSPORT_PUBLIC
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface();
+
+private:
+  std::shared_ptr<Rosbag2Node> node_;
+  std::shared_ptr<rosbag2_cpp::Writer> writer_;
+  std::unique_ptr<Recorder> recorder_;
+};
+
+}  // namespace rosbag2_transport
+
+#endif  // ROSBAG2_TRANSPORT__RECORDER_NODE_HPP_
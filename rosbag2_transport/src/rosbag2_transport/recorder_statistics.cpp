@@ -0,0 +1,146 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "recorder_statistics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+diagnostic_msgs::msg::KeyValue make_key_value(const std::string & key, double value)
+{
+  diagnostic_msgs::msg::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = std::to_string(value);
+  return key_value;
+}
+
+// Nearest rank percentile of sorted latencies, in microseconds.
+double get_percentile_us(
+  const std::vector<std::chrono::nanoseconds> & sorted_latencies, double percentile)
+{
+  if (sorted_latencies.empty()) {
+    return 0.0;
+  }
+  const auto rank = static_cast<size_t>(percentile / 100.0 * sorted_latencies.size());
+  const auto index = std::min(rank, sorted_latencies.size() - 1u);
+  return std::chrono::duration<double, std::micro>(sorted_latencies[index]).count();
+}
+}  // unnamed namespace
+
+namespace rosbag2_transport
+{
+
+constexpr size_t RecorderStatistics::kMaxWriteLatencies;
+
+std::shared_ptr<RecorderStatistics::TopicStatistics> RecorderStatistics::add_topic(
+  const std::string & topic_name)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto & topic = topics_[topic_name];
+  if (!topic) {
+    topic = std::make_shared<TopicStatistics>();
+  }
+  return topic;
+}
+
+void RecorderStatistics::add_write_latency(std::chrono::nanoseconds latency)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (write_latencies_.size() < kMaxWriteLatencies) {
+    write_latencies_.push_back(latency);
+  } else {
+    write_latencies_[period_written_messages_ % kMaxWriteLatencies] = latency;
+  }
+  max_write_latency_ = std::max(max_write_latency_, latency);
+  ++period_written_messages_;
+  ++written_messages_;
+}
+
+diagnostic_msgs::msg::DiagnosticArray RecorderStatistics::make_report(
+  std::chrono::nanoseconds period, size_t queue_depth)
+{
+  const double seconds = std::max(std::chrono::duration<double>(period).count(), 1e-9);
+  diagnostic_msgs::msg::DiagnosticArray report;
+
+  std::vector<std::chrono::nanoseconds> write_latencies;
+  std::chrono::nanoseconds max_write_latency;
+  uint64_t period_written_messages;
+  uint64_t written_messages;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto & topic : topics_) {
+      const uint64_t received_messages = topic.second->received_messages;
+      const uint64_t received_bytes = topic.second->received_bytes;
+      const uint64_t throttled_messages = topic.second->throttled_messages;
+      auto & reported = reported_totals_[topic.first];
+
+      diagnostic_msgs::msg::DiagnosticStatus status;
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.name = topic.first;
+      status.values.push_back(
+        make_key_value(
+          "messages_per_second",
+          static_cast<double>(received_messages - reported.received_messages) / seconds));
+      status.values.push_back(
+        make_key_value(
+          "bytes_per_second",
+          static_cast<double>(received_bytes - reported.received_bytes) / seconds));
+      status.values.push_back(
+        make_key_value("received_messages", static_cast<double>(received_messages)));
+      status.values.push_back(
+        make_key_value("throttled_messages", static_cast<double>(throttled_messages)));
+      report.status.push_back(status);
+
+      reported = {received_messages, received_bytes, throttled_messages};
+    }
+    // The capacity of the ring buffer is kept for the next period.
+    write_latencies = write_latencies_;
+    write_latencies_.clear();
+    max_write_latency = max_write_latency_;
+    max_write_latency_ = std::chrono::nanoseconds(0);
+    period_written_messages = period_written_messages_;
+    period_written_messages_ = 0;
+    written_messages = written_messages_;
+  }
+
+  std::sort(write_latencies.begin(), write_latencies.end());
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status.name = "recorder";
+  status.values.push_back(make_key_value("queue_depth", static_cast<double>(queue_depth)));
+  status.values.push_back(
+    make_key_value(
+      "written_messages_per_second", static_cast<double>(period_written_messages) / seconds));
+  status.values.push_back(
+    make_key_value("written_messages", static_cast<double>(written_messages)));
+  status.values.push_back(
+    make_key_value("write_latency_p50_us", get_percentile_us(write_latencies, 50.0)));
+  status.values.push_back(
+    make_key_value("write_latency_p95_us", get_percentile_us(write_latencies, 95.0)));
+  status.values.push_back(
+    make_key_value("write_latency_p99_us", get_percentile_us(write_latencies, 99.0)));
+  status.values.push_back(
+    make_key_value(
+      "write_latency_max_us",
+      std::chrono::duration<double, std::micro>(max_write_latency).count()));
+  report.status.push_back(status);
+  return report;
+}
+
+}  // namespace rosbag2_transport
@@ -0,0 +1,87 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROSBAG2_TRANSPORT__RECORDER_STATISTICS_HPP_
+#define ROSBAG2_TRANSPORT__RECORDER_STATISTICS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+namespace rosbag2_transport
+{
+
+/**
+ * Collects the statistics of a recording, which are reported periodically as a
+ * diagnostic_msgs/DiagnosticArray. The array holds one status per topic, named after the topic,
+ * and a status named "recorder" with the queue depth and the latencies of writing messages.
+ * Latency percentiles are computed over the latest kMaxWriteLatencies messages of a period, so the
+ * memory used does not grow with the rate of messages.
+ */
+class RecorderStatistics
+{
+public:
+  static constexpr size_t kMaxWriteLatencies = 4096;
+
+  // Counters of a topic, updated by its subscription callback without locking.
+  struct TopicStatistics
+  {
+    std::atomic<uint64_t> received_messages{0};
+    std::atomic<uint64_t> received_bytes{0};
+    std::atomic<uint64_t> throttled_messages{0};
+  };
+
+  /// Returns the counters of a topic, which stay valid while they are used.
+  std::shared_ptr<TopicStatistics> add_topic(const std::string & topic_name);
+
+  /// Counts a message written, which took the given time to write.
+  void add_write_latency(std::chrono::nanoseconds latency);
+
+  /**
+   * Reports the statistics since the previous report and starts the next period.
+   *
+   * \param period Time since the previous report, which rates are computed over.
+   * \param queue_depth Number of messages received but not written yet.
+   */
+  diagnostic_msgs::msg::DiagnosticArray make_report(
+    std::chrono::nanoseconds period, size_t queue_depth);
+
+private:
+  struct ReportedTotals
+  {
+    uint64_t received_messages{0};
+    uint64_t received_bytes{0};
+    uint64_t throttled_messages{0};
+  };
+
+  std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<TopicStatistics>> topics_;
+  std::map<std::string, ReportedTotals> reported_totals_;
+  // Ring buffer of the latest latencies of the current period.
+  std::vector<std::chrono::nanoseconds> write_latencies_;
+  std::chrono::nanoseconds max_write_latency_{0};
+  uint64_t period_written_messages_{0};
+  uint64_t written_messages_{0};
+};
+
+}  // namespace rosbag2_transport
+
+#endif  // ROSBAG2_TRANSPORT__RECORDER_STATISTICS_HPP_
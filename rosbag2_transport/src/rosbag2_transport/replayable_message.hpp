@@ -16,17 +16,33 @@
 #define ROSBAG2_TRANSPORT__REPLAYABLE_MESSAGE_HPP_
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include "rosbag2_storage/serialized_bag_message.hpp"
 
+namespace rosbag2_cpp
+{
+class CdrFieldExtractor;
+}  // namespace rosbag2_cpp
+
 namespace rosbag2_transport
 {
 
+class GenericPublisher;
+
 struct ReplayableMessage
 {
   std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
   std::chrono::nanoseconds time_since_start;
+  // Resolved from the topic name when the message is loaded, so playing it needs no lookup.
+  GenericPublisher * publisher = nullptr;
+  size_t publishing_thread = 0;
+  // Locates the header stamp to rewrite before publishing, null to publish the message as is.
+  const rosbag2_cpp::CdrFieldExtractor * header_stamp = nullptr;
+  // Seek generation the message was loaded in, see Player::seek().
+  uint64_t seek_generation = 0;
 };
 
 }  // namespace rosbag2_transport
@@ -33,8 +33,8 @@
 namespace rosbag2_transport
 {
 
-Rosbag2Node::Rosbag2Node(const std::string & node_name)
-: rclcpp::Node(node_name)
+Rosbag2Node::Rosbag2Node(const std::string & node_name, const rclcpp::NodeOptions & options)
+: rclcpp::Node(node_name, options)
 {}
 
 std::shared_ptr<GenericPublisher> Rosbag2Node::create_generic_publisher(
@@ -43,15 +43,21 @@ std::shared_ptr<GenericPublisher> Rosbag2Node::create_generic_publisher(
   auto type_support = rosbag2_cpp::get_typesupport(
     type, "rosidl_typesupport_cpp",
     library_generic_publisher_);
-  return std::make_shared<GenericPublisher>(
+  auto publisher = std::make_shared<GenericPublisher>(
     get_node_base_interface().get(), *type_support, topic, qos);
+  if (publisher->publishes_loaned_messages()) {
+    ROSBAG2_TRANSPORT_LOG_INFO_STREAM("Publishing loaned messages on topic '" << topic << "'");
+  }
+  return publisher;
 }
 
 std::shared_ptr<GenericSubscription> Rosbag2Node::create_generic_subscription(
   const std::string & topic,
   const std::string & type,
   const rclcpp::QoS & qos,
-  std::function<void(std::shared_ptr<rmw_serialized_message_t>)> callback)
+  std::function<void(
+    std::shared_ptr<rmw_serialized_message_t>, const rclcpp::MessageInfo &)> callback,
+  rclcpp::CallbackGroup::SharedPtr callback_group)
 {
   auto type_support = rosbag2_cpp::get_typesupport(
     type, "rosidl_typesupport_cpp",
@@ -65,8 +71,20 @@ std::shared_ptr<GenericSubscription> Rosbag2Node::create_generic_subscription(
       topic,
       qos,
       callback);
+    // Middlewares with shared memory transport can loan messages of some types, which saves
+    // copying them from the middleware before they are serialized.
+    if (subscription->can_loan_messages()) {
+      subscription = std::make_shared<GenericSubscription>(
+        get_node_base_interface().get(),
+        *type_support,
+        topic,
+        qos,
+        callback,
+        true);
+      ROSBAG2_TRANSPORT_LOG_INFO_STREAM("Taking loaned messages on topic '" << topic << "'");
+    }
 
-    get_node_topics_interface()->add_subscription(subscription, nullptr);
+    get_node_topics_interface()->add_subscription(subscription, callback_group);
   } catch (const std::runtime_error & ex) {
     ROSBAG2_TRANSPORT_LOG_ERROR_STREAM(
       "Error subscribing to topic '" << topic << "'. Error: " << ex.what());
@@ -157,10 +175,25 @@ std::unordered_map<std::string, std::string> Rosbag2Node::get_topics_with_types(
 }
 
 std::unordered_map<std::string, std::string>
-Rosbag2Node::get_all_topics_with_types(bool include_hidden_topics)
+Rosbag2Node::get_all_topics_with_types(
+  bool include_hidden_topics, const std::regex * include_regex, const std::regex * exclude_regex)
 {
-  return filter_topics_with_more_than_one_type(
-    this->get_topic_names_and_types(), include_hidden_topics);
+  auto topics_and_types = this->get_topic_names_and_types();
+  if (include_regex || exclude_regex) {
+    for (auto topic_and_type = topics_and_types.begin();
+      topic_and_type != topics_and_types.end(); )
+    {
+      const auto & topic_name = topic_and_type->first;
+      if ((include_regex && !std::regex_search(topic_name, *include_regex)) ||
+        (exclude_regex && std::regex_search(topic_name, *exclude_regex)))
+      {
+        topic_and_type = topics_and_types.erase(topic_and_type);
+      } else {
+        ++topic_and_type;
+      }
+    }
+  }
+  return filter_topics_with_more_than_one_type(topics_and_types, include_hidden_topics);
 }
 
 std::unordered_map<std::string, std::string> Rosbag2Node::filter_topics_with_more_than_one_type(
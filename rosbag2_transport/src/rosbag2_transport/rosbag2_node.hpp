@@ -17,6 +17,7 @@
 
 #include <map>
 #include <memory>
+#include <regex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -34,7 +35,8 @@ namespace rosbag2_transport
 class Rosbag2Node : public rclcpp::Node
 {
 public:
-  explicit Rosbag2Node(const std::string & node_name);
+  explicit Rosbag2Node(
+    const std::string & node_name, const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~Rosbag2Node() override = default;
 
   std::shared_ptr<GenericPublisher>
@@ -46,7 +48,9 @@ public:
     const std::string & topic,
     const std::string & type,
     const rclcpp::QoS & qos,
-    std::function<void(std::shared_ptr<rmw_serialized_message_t>)> callback);
+    std::function<void(
+      std::shared_ptr<rmw_serialized_message_t>, const rclcpp::MessageInfo &)> callback,
+    rclcpp::CallbackGroup::SharedPtr callback_group = nullptr);
 
   std::unordered_map<std::string, std::string>
   get_topics_with_types(const std::vector<std::string> & topic_names);
@@ -54,8 +58,15 @@ public:
   std::string
   expand_topic_name(const std::string & topic_name);
 
+  /**
+   * Topics whose name does not match include_regex or matches exclude_regex are left out, if
+   * either is given. They are skipped before their types are checked.
+   */
   std::unordered_map<std::string, std::string>
-  get_all_topics_with_types(bool include_hidden_topics = false);
+  get_all_topics_with_types(
+    bool include_hidden_topics = false,
+    const std::regex * include_regex = nullptr,
+    const std::regex * exclude_regex = nullptr);
 
   std::unordered_map<std::string, std::string>
   filter_topics_with_more_than_one_type(
@@ -15,23 +15,33 @@
 
 #include "rosbag2_transport/rosbag2_transport.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <memory>
 #include <queue>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 
+#include "rcpputils/filesystem_helper.hpp"
+
 #include "rcutils/time.h"
 
 #include "rosbag2_cpp/info.hpp"
 #include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/multi_bag_reader.hpp"
 #include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
 #include "rosbag2_cpp/typesupport_helpers.hpp"
 #include "rosbag2_cpp/writer.hpp"
 #include "rosbag2_cpp/writers/sequential_writer.hpp"
 
+#include "rosbag2_storage/bag_metadata.hpp"
+
 #include "rosbag2_transport/logging.hpp"
 
 #include "formatter.hpp"
@@ -42,6 +52,39 @@
 namespace rosbag2_transport
 {
 
+namespace
+{
+// Called before opening the reader or writer, which starts some of the threads.
+void configure_thread_roles(
+  const std::map<rosbag2_cpp::ThreadRole, rosbag2_cpp::ThreadScheduling> & thread_scheduling)
+{
+  for (const auto & role_and_scheduling : thread_scheduling) {
+    rosbag2_cpp::ThreadPool::configure_role(
+      role_and_scheduling.first, role_and_scheduling.second);
+  }
+}
+
+// Plays the bag of a host on the timeline of the bag of all hosts it was finalized into.
+PlayOptions align_to_bag_of_all_hosts(
+  const PlayOptions & play_options, const rosbag2_storage::BagMetadata & bag_metadata,
+  const rosbag2_storage::BagMetadata & host_metadata)
+{
+  if (bag_metadata.bag_id.empty() || host_metadata.bag_id != bag_metadata.bag_id) {
+    throw std::runtime_error(
+            "The host folder \"" + play_options.host_folder + "\" is not a host of the bag.");
+  }
+  const auto start_time = bag_metadata.starting_time +
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double>(play_options.start_offset));
+  auto host_play_options = play_options;
+  host_play_options.start_offset = std::max(
+    0.0, std::chrono::duration<double>(start_time - host_metadata.starting_time).count());
+  host_play_options.start_at_time_stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    start_time.time_since_epoch()).count();
+  return host_play_options;
+}
+}  // namespace
+
 Rosbag2Transport::Rosbag2Transport()
 : reader_(std::make_shared<rosbag2_cpp::Reader>(
       std::make_unique<rosbag2_cpp::readers::SequentialReader>())),
@@ -70,12 +113,16 @@ void Rosbag2Transport::record(
   const StorageOptions & storage_options, const RecordOptions & record_options)
 {
   try {
+    configure_thread_roles(record_options.thread_scheduling);
     writer_->open(
       storage_options, {rmw_get_serialization_format(), record_options.rmw_serialization_format});
 
     auto transport_node = setup_node(record_options.node_prefix);
 
     Recorder recorder(writer_, transport_node);
+    if (storage_options.snapshot_mode) {
+      recorder.create_snapshot_service();
+    }
     recorder.record(record_options);
   } catch (std::runtime_error & e) {
     ROSBAG2_TRANSPORT_LOG_ERROR("Failed to record: %s", e.what());
@@ -94,19 +141,53 @@ void Rosbag2Transport::play(
   const StorageOptions & storage_options, const PlayOptions & play_options)
 {
   try {
+    configure_thread_roles(play_options.thread_scheduling);
     auto transport_node = setup_node(play_options.node_prefix);
     Player player(reader_, transport_node);
 
-    do {
+    if (play_options.host_folder.empty()) {
       reader_->open(storage_options, {"", rmw_get_serialization_format()});
       player.play(play_options);
-    } while (rclcpp::ok() && play_options.loop);
+      return;
+    }
+    auto host_storage_options = storage_options;
+    host_storage_options.uri =
+      (rcpputils::fs::path(storage_options.uri) / play_options.host_folder).string();
+    const auto bag_metadata =
+      info_->read_metadata(storage_options.uri, storage_options.storage_id);
+    const auto host_metadata =
+      info_->read_metadata(host_storage_options.uri, storage_options.storage_id);
+    reader_->open(host_storage_options, {"", rmw_get_serialization_format()});
+    player.play(align_to_bag_of_all_hosts(play_options, bag_metadata, host_metadata));
+  } catch (std::runtime_error & e) {
+    ROSBAG2_TRANSPORT_LOG_ERROR("Failed to play: %s", e.what());
+  }
+}
+
+void Rosbag2Transport::play(
+  const std::vector<StorageOptions> & storage_options, const PlayOptions & play_options,
+  rosbag2_cpp::readers::MultiBagReader::ReaderFactory reader_factory)
+{
+  if (storage_options.size() == 1u) {
+    play(storage_options.front(), play_options);
+    return;
+  }
+  try {
+    configure_thread_roles(play_options.thread_scheduling);
+    auto transport_node = setup_node(play_options.node_prefix);
+    auto multi_bag_reader = std::make_unique<rosbag2_cpp::readers::MultiBagReader>(
+      std::move(reader_factory));
+    multi_bag_reader->open(storage_options, {"", rmw_get_serialization_format()});
+    Player player(
+      std::make_shared<rosbag2_cpp::Reader>(std::move(multi_bag_reader)), transport_node);
+    player.play(play_options);
   } catch (std::runtime_error & e) {
     ROSBAG2_TRANSPORT_LOG_ERROR("Failed to play: %s", e.what());
   }
 }
 
-void Rosbag2Transport::print_bag_info(const std::string & uri, const std::string & storage_id)
+void Rosbag2Transport::print_bag_info(
+  const std::string & uri, const std::string & storage_id, bool verbose)
 {
   rosbag2_storage::BagMetadata metadata;
   try {
@@ -120,7 +201,15 @@ void Rosbag2Transport::print_bag_info(const std::string & uri, const std::string
     return;
   }
 
-  Formatter::format_bag_meta_data(metadata);
+  if (verbose) {
+    try {
+      info_->read_topic_sizes(uri, metadata);
+    } catch (std::runtime_error & e) {
+      ROSBAG2_TRANSPORT_LOG_WARN("Could not read the topic sizes: %s", e.what());
+    }
+  }
+
+  Formatter::format_bag_meta_data(metadata, verbose);
 }
 
 }  // namespace rosbag2_transport
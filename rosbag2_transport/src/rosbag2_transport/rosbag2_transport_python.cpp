@@ -14,23 +14,47 @@
 // limitations under the License.
 
 #include <Python.h>
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "rclcpp/qos.hpp"
 
 #include "rosbag2_compression/compression_options.hpp"
 #include "rosbag2_compression/sequential_compression_reader.hpp"
 #include "rosbag2_compression/sequential_compression_writer.hpp"
+#include "rosbag2_cpp/bag_generator.hpp"
+#include "rosbag2_cpp/bag_slicer.hpp"
+#include "rosbag2_cpp/dataset_exporter.hpp"
+#include "rosbag2_cpp/distributed_bag_finalizer.hpp"
 #include "rosbag2_cpp/info.hpp"
+#include "rosbag2_cpp/memory_budget.hpp"
+#include "rosbag2_cpp/message_transform_chain.hpp"
 #include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/readers/merging_reader.hpp"
+#include "rosbag2_cpp/readers/multi_bag_reader.hpp"
 #include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/reindexer.hpp"
+#include "rosbag2_cpp/text_exporter.hpp"
+#include "rosbag2_cpp/thread_pool.hpp"
+#include "rosbag2_cpp/verifier.hpp"
 #include "rosbag2_cpp/writer.hpp"
 #include "rosbag2_cpp/writers/sequential_writer.hpp"
+#include "rosbag2_storage/memory_arena.hpp"
 #include "rosbag2_storage/metadata_io.hpp"
+#include "rosbag2_storage/ros_helper.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosbag2_storage/storage_filter.hpp"
+#include "rosbag2_transport/bag_converter.hpp"
+#include "rosbag2_transport/convert_options.hpp"
 #include "rosbag2_transport/rosbag2_transport.hpp"
 #include "rosbag2_transport/record_options.hpp"
 #include "rosbag2_transport/storage_options.hpp"
@@ -78,6 +102,255 @@ std::unordered_map<std::string, rclcpp::QoS> PyObject_AsTopicQoSMap(PyObject * o
   return topic_qos_overrides;
 }
 
+/// Convert a Python dictionary of topic names to (decimation, max_frequency) tuples
+std::unordered_map<std::string, rosbag2_transport::TopicThrottle>
+PyObject_AsTopicThrottleMap(PyObject * object)
+{
+  std::unordered_map<std::string, rosbag2_transport::TopicThrottle> topic_throttles{};
+  if (!object) {
+    return topic_throttles;
+  }
+  if (!PyDict_Check(object)) {
+    throw std::runtime_error{"Topic throttles object is not a Python dictionary."};
+  }
+  PyObject * key{nullptr};
+  PyObject * value{nullptr};
+  Py_ssize_t pos{0};
+  while (PyDict_Next(object, &pos, &key, &value)) {
+    rosbag2_transport::TopicThrottle throttle{};
+    unsigned long long decimation = 1;  // NOLINT
+    if (!PyArg_ParseTuple(value, "Kd", &decimation, &throttle.max_frequency)) {
+      throw std::runtime_error{"Topic throttle is not a (decimation, max_frequency) tuple."};
+    }
+    throttle.decimation = decimation;
+    topic_throttles.insert({PyObject_AsStdString(key), throttle});
+  }
+  return topic_throttles;
+}
+
+/// Convert a Python dictionary of thread role names to (cpu_affinity, nice, realtime_priority)
+/// tuples
+std::map<rosbag2_cpp::ThreadRole, rosbag2_cpp::ThreadScheduling>
+PyObject_AsThreadScheduling(PyObject * object)
+{
+  static const std::map<std::string, rosbag2_cpp::ThreadRole> roles_by_name{
+    {"recorder", rosbag2_cpp::ThreadRole::RECORDER},
+    {"writer", rosbag2_cpp::ThreadRole::WRITER},
+    {"compression", rosbag2_cpp::ThreadRole::COMPRESSION},
+    {"player", rosbag2_cpp::ThreadRole::PLAYER}};
+  std::map<rosbag2_cpp::ThreadRole, rosbag2_cpp::ThreadScheduling> thread_scheduling{};
+  if (!object) {
+    return thread_scheduling;
+  }
+  if (!PyDict_Check(object)) {
+    throw std::runtime_error{"Thread scheduling object is not a Python dictionary."};
+  }
+  PyObject * key{nullptr};
+  PyObject * value{nullptr};
+  Py_ssize_t pos{0};
+  while (PyDict_Next(object, &pos, &key, &value)) {
+    const auto role = roles_by_name.find(PyObject_AsStdString(key));
+    if (role == roles_by_name.end()) {
+      throw std::runtime_error{"Unknown thread role " + PyObject_AsStdString(key) + "."};
+    }
+    rosbag2_cpp::ThreadScheduling scheduling{};
+    PyObject * cpu_affinity{nullptr};
+    if (!PyArg_ParseTuple(
+        value, "Oii", &cpu_affinity, &scheduling.nice, &scheduling.realtime_priority))
+    {
+      throw std::runtime_error{
+              "Thread scheduling is not a (cpu_affinity, nice, realtime_priority) tuple."};
+    }
+    PyObject * cpu_iterator = PyObject_GetIter(cpu_affinity);
+    if (cpu_iterator != nullptr) {
+      PyObject * cpu = nullptr;
+      while ((cpu = PyIter_Next(cpu_iterator))) {
+        scheduling.cpu_affinity.push_back(PyLong_AsSize_t(cpu));
+
+        Py_DECREF(cpu);
+      }
+      Py_DECREF(cpu_iterator);
+    }
+    thread_scheduling.insert({role->second, scheduling});
+  }
+  return thread_scheduling;
+}
+
+/// Convert a Python dictionary of (format, level or None) tuples by topic name or type to topic
+/// compression options
+std::unordered_map<std::string, rosbag2_compression::TopicCompressionOptions>
+PyObject_AsTopicCompression(PyObject * object)
+{
+  std::unordered_map<std::string, rosbag2_compression::TopicCompressionOptions> topic_compression{};
+  if (!object) {
+    return topic_compression;
+  }
+  if (!PyDict_Check(object)) {
+    throw std::runtime_error{"Topic compression object is not a Python dictionary."};
+  }
+  PyObject * key{nullptr};
+  PyObject * value{nullptr};
+  Py_ssize_t pos{0};
+  while (PyDict_Next(object, &pos, &key, &value)) {
+    char * compression_format = nullptr;
+    PyObject * compression_level = nullptr;
+    if (!PyArg_ParseTuple(value, "sO", &compression_format, &compression_level)) {
+      throw std::runtime_error{"Topic compression is not a (format, level) tuple."};
+    }
+    rosbag2_compression::TopicCompressionOptions options{};
+    options.compression_format = compression_format;
+    if (compression_level != Py_None) {
+      options.has_compression_level = true;
+      options.compression_level = static_cast<int>(PyLong_AsLong(compression_level));
+    }
+    topic_compression.insert({PyObject_AsStdString(key), options});
+  }
+  return topic_compression;
+}
+
+/// Convert a Python list of (name, topics_regex, min_message_size) tuples to topic groups
+std::vector<rosbag2_cpp::TopicGroup> PyObject_AsTopicGroups(PyObject * object)
+{
+  std::vector<rosbag2_cpp::TopicGroup> topic_groups{};
+  if (!object) {
+    return topic_groups;
+  }
+  if (!PyList_Check(object)) {
+    throw std::runtime_error{"Topic groups object is not a Python list."};
+  }
+  for (Py_ssize_t i = 0; i < PyList_Size(object); ++i) {
+    char * name = nullptr;
+    char * topics_regex = nullptr;
+    unsigned long long min_message_size = 0;  // NOLINT
+    if (!PyArg_ParseTuple(PyList_GetItem(object, i), "ssK", &name, &topics_regex,
+      &min_message_size))
+    {
+      throw std::runtime_error{"Topic group is not a (name, topics, min_message_size) tuple."};
+    }
+    topic_groups.push_back({name, topics_regex, min_message_size});
+  }
+  return topic_groups;
+}
+
+/// Convert a Python list of (name, parameters) tuples to message transforms
+std::vector<rosbag2_cpp::MessageTransformOptions> PyObject_AsMessageTransforms(PyObject * object)
+{
+  std::vector<rosbag2_cpp::MessageTransformOptions> transforms{};
+  if (!object) {
+    return transforms;
+  }
+  if (!PyList_Check(object)) {
+    throw std::runtime_error{"Message transforms object is not a Python list."};
+  }
+  for (Py_ssize_t i = 0; i < PyList_Size(object); ++i) {
+    char * name = nullptr;
+    char * parameters = nullptr;
+    if (!PyArg_ParseTuple(PyList_GetItem(object, i), "ss", &name, &parameters)) {
+      throw std::runtime_error{"Message transform is not a (name, parameters) tuple."};
+    }
+    transforms.push_back({name, parameters});
+  }
+  return transforms;
+}
+
+/// Convert the progress of a recording to a Python dictionary
+PyObject * PyDict_FromProgress(const rosbag2_transport::RecordProgress & progress)
+{
+  return Py_BuildValue(
+    "{s:K,s:K,s:d}",
+    "recorded_messages", static_cast<unsigned long long>(progress.recorded_messages),  // NOLINT
+    "recorded_bytes", static_cast<unsigned long long>(progress.recorded_bytes),  // NOLINT
+    "elapsed", std::chrono::duration<double>(progress.elapsed).count());
+}
+
+/// Convert the progress of a playback to a Python dictionary
+PyObject * PyDict_FromProgress(const rosbag2_transport::PlayProgress & progress)
+{
+  return Py_BuildValue(
+    "{s:K,s:K,s:L,s:d}",
+    "played_messages", static_cast<unsigned long long>(progress.played_messages),  // NOLINT
+    "total_messages", static_cast<unsigned long long>(progress.total_messages),  // NOLINT
+    "time_stamp", static_cast<long long>(progress.time_stamp),  // NOLINT
+    "elapsed", std::chrono::duration<double>(progress.elapsed).count());
+}
+
+/// Convert a Python callable to a progress callback, which calls it with a dictionary of the
+/// progress. Returning False from the callable stops recording or playing, as a shutdown does.
+template<typename Progress>
+std::function<void(const Progress &)> PyObject_AsProgressCallback(PyObject * object)
+{
+  if (!object || object == Py_None) {
+    return nullptr;
+  }
+  if (!PyCallable_Check(object)) {
+    throw std::runtime_error{"Progress callback is not callable."};
+  }
+  // Borrowed from the arguments of the call, which outlive recording or playing.
+  const auto callback = [object](const Progress & progress) {
+      PyGILState_STATE gil_state = PyGILState_Ensure();
+      PyObject * progress_dict = PyDict_FromProgress(progress);
+      PyObject * result =
+        progress_dict ? PyObject_CallFunctionObjArgs(object, progress_dict, nullptr) : nullptr;
+      if (!result) {
+        // Errors of the callback are printed, but do not stop recording or playing.
+        PyErr_Print();
+      }
+      const bool stop = result == Py_False;
+      Py_XDECREF(result);
+      Py_XDECREF(progress_dict);
+      PyGILState_Release(gil_state);
+      if (stop) {
+        rclcpp::shutdown();
+      }
+    };
+  return callback;
+}
+
+/// Create the reader of the bag in the directory: a SequentialCompressionReader for compressed
+/// bags, a MergingReader for bags whose files overlap in time, else a SequentialReader.
+std::unique_ptr<rosbag2_cpp::reader_interfaces::BaseReaderInterface>
+make_bag_reader(const std::string & uri)
+{
+  rosbag2_storage::MetadataIo metadata_io{};
+  if (!metadata_io.metadata_file_exists(uri)) {
+    return std::make_unique<rosbag2_cpp::readers::SequentialReader>();
+  }
+  const auto metadata = metadata_io.read_metadata(uri);
+  // Stripes and topic groups are written at the same time, i.e. their files overlap in time.
+  const bool has_overlapping_files = std::any_of(
+    metadata.files.begin(), metadata.files.end(),
+    [](const rosbag2_storage::FileInformation & file) {
+      return file.stripe > 0 || !file.topics.empty();
+    });
+  if (!metadata.compression_format.empty()) {
+    return std::make_unique<rosbag2_compression::SequentialCompressionReader>();
+  } else if (has_overlapping_files) {
+    return std::make_unique<rosbag2_cpp::readers::MergingReader>();
+  }
+  return std::make_unique<rosbag2_cpp::readers::SequentialReader>();
+}
+
+/// Run the function without holding the GIL, so other Python threads run while a bag is read or
+/// written. \return false with a RuntimeError set if the function throws.
+template<typename Function>
+bool call_without_gil(Function && function)
+{
+  bool failed = false;
+  std::string error;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    function();
+  } catch (const std::exception & e) {
+    failed = true;
+    error = e.what();
+  }
+  Py_END_ALLOW_THREADS
+  if (failed) {
+    PyErr_SetString(PyExc_RuntimeError, error.c_str());
+  }
+  return !failed;
+}
+
 }  // namespace
 
 static PyObject *
@@ -101,6 +374,68 @@ rosbag2_transport_record(PyObject * Py_UNUSED(self), PyObject * args, PyObject *
     "topics",
     "include_hidden_topics",
     "qos_profile_overrides",
+    "storage_preset_profile",
+    "defer_index_creation",
+    "transaction_max_messages",
+    "transaction_max_bytes",
+    "transaction_max_duration",
+    "max_cache_size_bytes",
+    "max_bagfile_duration",
+    "max_bagfile_messages",
+    "precreate_next_bagfile",
+    "topic_timestamp_index",
+    "compression_threads",
+    "compression_queue_size",
+    "compression_level",
+    "compression_worker_threads",
+    "dictionary_training_messages",
+    "compression_dictionary",
+    "chunk_max_bytes",
+    "chunk_max_duration_ms",
+    "adaptive_compression_level",
+    "compression_level_min",
+    "compression_level_max",
+    "recorder_threads",
+    "snapshot_mode",
+    "snapshot_max_bytes",
+    "snapshot_duration",
+    "topic_throttles",
+    "regex",
+    "exclude",
+    "statistics_interval_ms",
+    "stripe_directories",
+    "striping_policy",
+    "topic_groups",
+    "metadata_checkpoint_interval_ms",
+    "write_latency_budget_ms",
+    "progress_callback",
+    "progress_interval_ms",
+    "bag_id",
+    "clock_offset_ns",
+    "stream_address",
+    "stream_max_memory_bytes",
+    "topic_compression",
+    "compression_sample_messages",
+    "compression_resample_interval",
+    "incompressible_ratio",
+    "checksums",
+    "encryption_format",
+    "encryption_key_file",
+    "large_message_threshold",
+    "deduplicate_topics",
+    "delta_encode_topics",
+    "delta_keyframe_interval",
+    "reorder_window_ms",
+    "preallocate_bagfiles",
+    "writeback_interval_bytes",
+    "shards",
+    "thread_scheduling",
+    "cluster_messages_by_topic",
+    "retention_max_bytes",
+    "retention_max_age",
+    "staging_directory",
+    "migration_max_bytes_per_second",
+    "transforms",
     nullptr};
 
   char * uri = nullptr;
@@ -117,9 +452,73 @@ rosbag2_transport_record(PyObject * Py_UNUSED(self), PyObject * args, PyObject *
   uint64_t max_cache_size = 0u;
   PyObject * topics = nullptr;
   bool include_hidden_topics = false;
+  char * storage_preset_profile = nullptr;
+  bool defer_index_creation = false;
+  uint64_t transaction_max_messages = 0u;
+  uint64_t transaction_max_bytes = 0u;
+  uint64_t transaction_max_duration_ms = 0u;
+  uint64_t max_cache_size_bytes = 0u;
+  uint64_t max_bagfile_duration = 0u;
+  uint64_t max_bagfile_messages = 0u;
+  bool precreate_next_bagfile = false;
+  bool topic_timestamp_index = false;
+  uint64_t compression_threads = 1u;
+  uint64_t compression_queue_size = 1u;
+  int compression_level = 1;
+  uint64_t compression_worker_threads = 0u;
+  uint64_t dictionary_training_messages = 0u;
+  char * compression_dictionary = nullptr;
+  uint64_t chunk_max_bytes = 1024u * 1024u;
+  uint64_t chunk_max_duration_ms = 0u;
+  bool adaptive_compression_level = false;
+  int compression_level_min = 1;
+  int compression_level_max = 9;
+  uint64_t recorder_threads = 1u;
+  bool snapshot_mode = false;
+  uint64_t snapshot_max_bytes = 0u;
+  uint64_t snapshot_duration = 0u;
+  PyObject * topic_throttles = nullptr;
+  char * regex = nullptr;
+  char * exclude = nullptr;
+  uint64_t statistics_interval_ms = 0u;
+  PyObject * stripe_directories = nullptr;
+  char * striping_policy = nullptr;
+  PyObject * topic_groups = nullptr;
+  uint64_t metadata_checkpoint_interval_ms = 0u;
+  uint64_t write_latency_budget_ms = 0u;
+  PyObject * progress_callback = nullptr;
+  uint64_t progress_interval_ms = 1000u;
+  char * bag_id = nullptr;
+  long long clock_offset_ns = 0;  // NOLINT
+  char * stream_address = nullptr;
+  uint64_t stream_max_memory_bytes = 64 * 1024 * 1024;
+  PyObject * topic_compression = nullptr;
+  uint64_t compression_sample_messages = 0u;
+  uint64_t compression_resample_interval = 1000u;
+  double incompressible_ratio = 0.95;
+  bool checksums = false;
+  char * encryption_format = nullptr;
+  char * encryption_key_file = nullptr;
+  uint64_t large_message_threshold = 0u;
+  PyObject * deduplicate_topics = nullptr;
+  PyObject * delta_encode_topics = nullptr;
+  uint64_t delta_keyframe_interval = 100u;
+  uint64_t reorder_window_ms = 0u;
+  bool preallocate_bagfiles = false;
+  uint64_t writeback_interval_bytes = 0u;
+  uint64_t shards = 0u;
+  PyObject * thread_scheduling = nullptr;
+  bool cluster_messages_by_topic = false;
+  uint64_t retention_max_bytes = 0u;
+  uint64_t retention_max_age = 0u;
+  char * staging_directory = nullptr;
+  uint64_t migration_max_bytes_per_second = 0u;
+  PyObject * transforms = nullptr;
   if (
     !PyArg_ParseTupleAndKeywords(
-      args, kwargs, "ssssss|bbKKKObO", const_cast<char **>(kwlist),
+      args, kwargs,
+      "ssssss|bbKKKObOsbKKKKKKbbKKiKKsKKbiiKbKKOssKOsOKKOKsLsKOKKdbssKOOKKbKKObKKsKO",
+      const_cast<char **>(kwlist),
       &uri,
       &storage_id,
       &serilization_format,
@@ -133,7 +532,69 @@ rosbag2_transport_record(PyObject * Py_UNUSED(self), PyObject * args, PyObject *
       &max_cache_size,
       &topics,
       &include_hidden_topics,
-      &qos_profile_overrides
+      &qos_profile_overrides,
+      &storage_preset_profile,
+      &defer_index_creation,
+      &transaction_max_messages,
+      &transaction_max_bytes,
+      &transaction_max_duration_ms,
+      &max_cache_size_bytes,
+      &max_bagfile_duration,
+      &max_bagfile_messages,
+      &precreate_next_bagfile,
+      &topic_timestamp_index,
+      &compression_threads,
+      &compression_queue_size,
+      &compression_level,
+      &compression_worker_threads,
+      &dictionary_training_messages,
+      &compression_dictionary,
+      &chunk_max_bytes,
+      &chunk_max_duration_ms,
+      &adaptive_compression_level,
+      &compression_level_min,
+      &compression_level_max,
+      &recorder_threads,
+      &snapshot_mode,
+      &snapshot_max_bytes,
+      &snapshot_duration,
+      &topic_throttles,
+      &regex,
+      &exclude,
+      &statistics_interval_ms,
+      &stripe_directories,
+      &striping_policy,
+      &topic_groups,
+      &metadata_checkpoint_interval_ms,
+      &write_latency_budget_ms,
+      &progress_callback,
+      &progress_interval_ms,
+      &bag_id,
+      &clock_offset_ns,
+      &stream_address,
+      &stream_max_memory_bytes,
+      &topic_compression,
+      &compression_sample_messages,
+      &compression_resample_interval,
+      &incompressible_ratio,
+      &checksums,
+      &encryption_format,
+      &encryption_key_file,
+      &large_message_threshold,
+      &deduplicate_topics,
+      &delta_encode_topics,
+      &delta_keyframe_interval,
+      &reorder_window_ms,
+      &preallocate_bagfiles,
+      &writeback_interval_bytes,
+      &shards,
+      &thread_scheduling,
+      &cluster_messages_by_topic,
+      &retention_max_bytes,
+      &retention_max_age,
+      &staging_directory,
+      &migration_max_bytes_per_second,
+      &transforms
   ))
   {
     return nullptr;
@@ -142,22 +603,132 @@ rosbag2_transport_record(PyObject * Py_UNUSED(self), PyObject * args, PyObject *
   storage_options.uri = std::string(uri);
   storage_options.storage_id = std::string(storage_id);
   storage_options.max_bagfile_size = (uint64_t) max_bagfile_size;
+  storage_options.max_bagfile_duration = max_bagfile_duration;
+  storage_options.max_bagfile_messages = max_bagfile_messages;
+  storage_options.precreate_next_bagfile = precreate_next_bagfile;
+  storage_options.topic_timestamp_index = topic_timestamp_index;
+  storage_options.cluster_messages_by_topic = cluster_messages_by_topic;
+  storage_options.retention_max_bytes = retention_max_bytes;
+  storage_options.retention_max_age = retention_max_age;
+  storage_options.staging_directory = staging_directory ? std::string(staging_directory) : "";
+  storage_options.migration_max_bytes_per_second = migration_max_bytes_per_second;
+  storage_options.checksums = checksums;
+  storage_options.large_message_threshold = large_message_threshold;
   storage_options.max_cache_size = max_cache_size;
+  storage_options.max_cache_size_bytes = max_cache_size_bytes;
+  if (storage_preset_profile) {
+    storage_options.storage_preset_profile = std::string(storage_preset_profile);
+  }
+  storage_options.defer_index_creation = defer_index_creation;
+  storage_options.transaction_max_messages = transaction_max_messages;
+  storage_options.transaction_max_bytes = transaction_max_bytes;
+  storage_options.transaction_max_duration_ms = transaction_max_duration_ms;
+  storage_options.snapshot_mode = snapshot_mode;
+  storage_options.snapshot_max_bytes = snapshot_max_bytes;
+  storage_options.snapshot_duration = snapshot_duration;
+  if (stripe_directories) {
+    PyObject * directory_iterator = PyObject_GetIter(stripe_directories);
+    if (directory_iterator != nullptr) {
+      PyObject * directory;
+      while ((directory = PyIter_Next(directory_iterator))) {
+        storage_options.stripe_directories.emplace_back(PyUnicode_AsUTF8(directory));
+
+        Py_DECREF(directory);
+      }
+      Py_DECREF(directory_iterator);
+    }
+  }
+  if (deduplicate_topics) {
+    PyObject * topic_iterator = PyObject_GetIter(deduplicate_topics);
+    if (topic_iterator != nullptr) {
+      PyObject * topic;
+      while ((topic = PyIter_Next(topic_iterator))) {
+        storage_options.deduplicate_topics.emplace_back(PyUnicode_AsUTF8(topic));
+
+        Py_DECREF(topic);
+      }
+      Py_DECREF(topic_iterator);
+    }
+  }
+  if (delta_encode_topics) {
+    PyObject * topic_iterator = PyObject_GetIter(delta_encode_topics);
+    if (topic_iterator != nullptr) {
+      PyObject * topic;
+      while ((topic = PyIter_Next(topic_iterator))) {
+        storage_options.delta_encode_topics.emplace_back(PyUnicode_AsUTF8(topic));
+
+        Py_DECREF(topic);
+      }
+      Py_DECREF(topic_iterator);
+    }
+  }
+  storage_options.delta_keyframe_interval = delta_keyframe_interval;
+  storage_options.reorder_window_ms = reorder_window_ms;
+  if (striping_policy && std::string(striping_policy) == "topic_affinity") {
+    storage_options.striping_policy = rosbag2_cpp::StripingPolicy::TOPIC_AFFINITY;
+  }
+  storage_options.topic_groups = PyObject_AsTopicGroups(topic_groups);
+  storage_options.metadata_checkpoint_interval_ms = metadata_checkpoint_interval_ms;
+  storage_options.write_latency_budget_ms = write_latency_budget_ms;
+  storage_options.bag_id = bag_id ? std::string(bag_id) : "";
+  storage_options.clock_offset_ns = static_cast<int64_t>(clock_offset_ns);
+  storage_options.stream_address = stream_address ? std::string(stream_address) : "";
+  storage_options.stream_max_memory_bytes = stream_max_memory_bytes;
+  storage_options.preallocate_bagfiles = preallocate_bagfiles;
+  storage_options.writeback_interval_bytes = writeback_interval_bytes;
+  storage_options.shards = shards;
   record_options.all = all;
   record_options.is_discovery_disabled = no_discovery;
   record_options.topic_polling_interval = std::chrono::milliseconds(polling_interval_ms);
   record_options.node_prefix = std::string(node_prefix);
   record_options.compression_mode = std::string(compression_mode);
   record_options.compression_format = compression_format;
+  record_options.compression_threads = compression_threads;
+  record_options.compression_queue_size = compression_queue_size;
+  record_options.compression_level = compression_level;
+  record_options.compression_worker_threads = compression_worker_threads;
+  record_options.dictionary_training_messages = dictionary_training_messages;
+  record_options.compression_dictionary =
+    compression_dictionary ? std::string(compression_dictionary) : "";
+  record_options.chunk_max_bytes = chunk_max_bytes;
+  record_options.chunk_max_duration_ms = chunk_max_duration_ms;
+  record_options.adaptive_compression_level = adaptive_compression_level;
+  record_options.compression_level_min = compression_level_min;
+  record_options.compression_level_max = compression_level_max;
   record_options.include_hidden_topics = include_hidden_topics;
+  record_options.recorder_threads = recorder_threads;
+  record_options.regex = regex ? std::string(regex) : "";
+  record_options.exclude = exclude ? std::string(exclude) : "";
+  record_options.statistics_interval = std::chrono::milliseconds(statistics_interval_ms);
 
   rosbag2_compression::CompressionOptions compression_options{
     record_options.compression_format,
-    rosbag2_compression::compression_mode_from_string(record_options.compression_mode)
+    rosbag2_compression::compression_mode_from_string(record_options.compression_mode),
+    record_options.compression_threads,
+    record_options.compression_queue_size,
+    record_options.compression_level,
+    record_options.compression_worker_threads,
+    record_options.dictionary_training_messages,
+    record_options.compression_dictionary,
+    record_options.chunk_max_bytes,
+    record_options.chunk_max_duration_ms,
+    record_options.adaptive_compression_level,
+    record_options.compression_level_min,
+    record_options.compression_level_max
   };
+  compression_options.topic_compression = PyObject_AsTopicCompression(topic_compression);
+  compression_options.compression_sample_messages = compression_sample_messages;
+  compression_options.compression_resample_interval = compression_resample_interval;
+  compression_options.incompressible_ratio = incompressible_ratio;
+  compression_options.encryption_format = encryption_format ? std::string(encryption_format) : "";
+  compression_options.encryption_key_file =
+    encryption_key_file ? std::string(encryption_key_file) : "";
 
   auto topic_qos_overrides = PyObject_AsTopicQoSMap(qos_profile_overrides);
   record_options.topic_qos_profile_overrides = topic_qos_overrides;
+  record_options.topic_throttles = PyObject_AsTopicThrottleMap(topic_throttles);
+  record_options.thread_scheduling = PyObject_AsThreadScheduling(thread_scheduling);
+  record_options.transforms = PyObject_AsMessageTransforms(transforms);
 
   if (topics) {
     PyObject * topic_iterator = PyObject_GetIter(topics);
@@ -181,7 +752,7 @@ rosbag2_transport_record(PyObject * Py_UNUSED(self), PyObject * args, PyObject *
     std::make_unique<rosbag2_cpp::readers::SequentialReader>());
   std::shared_ptr<rosbag2_cpp::Writer> writer;
   // Change writer based on recording options
-  if (record_options.compression_format == "zstd") {
+  if (!record_options.compression_format.empty()) {
     writer = std::make_shared<rosbag2_cpp::Writer>(
       std::make_unique<rosbag2_compression::SequentialCompressionWriter>(compression_options));
   } else {
@@ -189,10 +760,31 @@ rosbag2_transport_record(PyObject * Py_UNUSED(self), PyObject * args, PyObject *
       std::make_unique<rosbag2_cpp::writers::SequentialWriter>());
   }
 
+  try {
+    record_options.progress_callback =
+      PyObject_AsProgressCallback<rosbag2_transport::RecordProgress>(progress_callback);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+  record_options.progress_interval = std::chrono::milliseconds(progress_interval_ms);
+
+  // Recording runs until shutdown, so other Python threads keep running meanwhile.
   rosbag2_transport::Rosbag2Transport transport(reader, writer, info);
-  transport.init();
-  transport.record(storage_options, record_options);
-  transport.shutdown();
+  const bool recorded = call_without_gil(
+    [&]() {
+      transport.init();
+      try {
+        transport.record(storage_options, record_options);
+      } catch (...) {
+        transport.shutdown();
+        throw;
+      }
+      transport.shutdown();
+    });
+  if (!recorded) {
+    return nullptr;
+  }
 
   Py_RETURN_NONE;
 }
@@ -212,6 +804,35 @@ rosbag2_transport_play(PyObject * Py_UNUSED(self), PyObject * args, PyObject * k
     "topics",
     "qos_profile_overrides",
     "loop",
+    "start_offset",
+    "duration",
+    "order_by_publish_time",
+    "decompression_directory",
+    "read_ahead_queue_bytes",
+    "busy_wait_us",
+    "realtime_priority",
+    "cpu_affinity",
+    "publishing_threads",
+    "as_fast_as_possible",
+    "wait_for_subscribers",
+    "clock_publish_frequency",
+    "start_paused",
+    "loop_cache_bytes",
+    "preload",
+    "preload_max_bytes",
+    "progress_callback",
+    "progress_interval_ms",
+    "decompression_threads",
+    "encryption_key_file",
+    "latched_topics",
+    "lazy_publishers",
+    "thread_scheduling",
+    "rewrite_header_stamps",
+    "uris",
+    "host_folder",
+    "start_at_ns",
+    "clock_offset_ns",
+    "transforms",
     nullptr
   };
 
@@ -223,9 +844,38 @@ rosbag2_transport_play(PyObject * Py_UNUSED(self), PyObject * args, PyObject * k
   PyObject * topics = nullptr;
   PyObject * qos_profile_overrides{nullptr};
   bool loop = false;
+  double start_offset = 0.0;
+  double duration = 0.0;
+  bool order_by_publish_time = false;
+  char * decompression_directory = nullptr;
+  size_t read_ahead_queue_bytes = 0;
+  uint64_t busy_wait_us = 0;
+  int realtime_priority = 0;
+  PyObject * cpu_affinity = nullptr;
+  size_t publishing_threads = 0;
+  bool as_fast_as_possible = false;
+  size_t wait_for_subscribers = 0;
+  double clock_publish_frequency = 0.0;
+  bool start_paused = false;
+  size_t loop_cache_bytes = 0;
+  bool preload = false;
+  size_t preload_max_bytes = 0;
+  PyObject * progress_callback = nullptr;
+  uint64_t progress_interval_ms = 1000u;
+  uint64_t decompression_threads = 0u;
+  char * encryption_key_file = nullptr;
+  PyObject * latched_topics = nullptr;
+  bool lazy_publishers = false;
+  PyObject * thread_scheduling = nullptr;
+  bool rewrite_header_stamps = false;
+  PyObject * uris = nullptr;
+  char * host_folder = nullptr;
+  long long start_at_ns = 0;  // NOLINT
+  long long clock_offset_ns = 0;  // NOLINT
+  PyObject * transforms = nullptr;
 
   if (!PyArg_ParseTupleAndKeywords(
-      args, kwargs, "sss|kfOOb", const_cast<char **>(kwlist),
+      args, kwargs, "sss|kfOObddbskKiOkbkdbkbkOKKsObObOsLLO", const_cast<char **>(kwlist),
       &uri,
       &storage_id,
       &node_prefix,
@@ -233,18 +883,71 @@ rosbag2_transport_play(PyObject * Py_UNUSED(self), PyObject * args, PyObject * k
       &rate,
       &topics,
       &qos_profile_overrides,
-      &loop))
+      &loop,
+      &start_offset,
+      &duration,
+      &order_by_publish_time,
+      &decompression_directory,
+      &read_ahead_queue_bytes,
+      &busy_wait_us,
+      &realtime_priority,
+      &cpu_affinity,
+      &publishing_threads,
+      &as_fast_as_possible,
+      &wait_for_subscribers,
+      &clock_publish_frequency,
+      &start_paused,
+      &loop_cache_bytes,
+      &preload,
+      &preload_max_bytes,
+      &progress_callback,
+      &progress_interval_ms,
+      &decompression_threads,
+      &encryption_key_file,
+      &latched_topics,
+      &lazy_publishers,
+      &thread_scheduling,
+      &rewrite_header_stamps,
+      &uris,
+      &host_folder,
+      &start_at_ns,
+      &clock_offset_ns,
+      &transforms))
   {
     return nullptr;
   }
 
   storage_options.uri = std::string(uri);
   storage_options.storage_id = std::string(storage_id);
+  storage_options.decompression_directory =
+    decompression_directory ? std::string(decompression_directory) : "";
+  storage_options.decompression_threads = decompression_threads;
+  storage_options.encryption_key_file =
+    encryption_key_file ? std::string(encryption_key_file) : "";
 
   play_options.node_prefix = std::string(node_prefix);
   play_options.read_ahead_queue_size = read_ahead_queue_size;
+  play_options.read_ahead_queue_bytes = read_ahead_queue_bytes;
+  play_options.busy_wait_period = std::chrono::microseconds(busy_wait_us);
+  play_options.realtime_priority = realtime_priority;
+  play_options.publishing_threads = publishing_threads;
+  play_options.as_fast_as_possible = as_fast_as_possible;
+  play_options.wait_for_subscribers = wait_for_subscribers;
+  play_options.lazy_publishers = lazy_publishers;
+  play_options.clock_publish_frequency = clock_publish_frequency;
+  play_options.start_paused = start_paused;
+  play_options.rewrite_header_stamps = rewrite_header_stamps;
+  play_options.loop_cache_bytes = loop_cache_bytes;
+  play_options.preload = preload;
+  play_options.preload_max_bytes = preload_max_bytes;
   play_options.rate = rate;
   play_options.loop = loop;
+  play_options.start_offset = start_offset;
+  play_options.duration = duration;
+  play_options.order_by_publish_time = order_by_publish_time;
+  play_options.host_folder = host_folder ? std::string(host_folder) : "";
+  play_options.start_at = static_cast<int64_t>(start_at_ns);
+  play_options.clock_offset = static_cast<int64_t>(clock_offset_ns);
 
   if (topics) {
     PyObject * topic_iterator = PyObject_GetIter(topics);
@@ -259,35 +962,89 @@ rosbag2_transport_play(PyObject * Py_UNUSED(self), PyObject * args, PyObject * k
     }
   }
 
+  if (latched_topics) {
+    PyObject * topic_iterator = PyObject_GetIter(latched_topics);
+    if (topic_iterator != nullptr) {
+      PyObject * topic = nullptr;
+      while ((topic = PyIter_Next(topic_iterator))) {
+        play_options.latched_topics.emplace_back(PyUnicode_AsUTF8(topic));
+
+        Py_DECREF(topic);
+      }
+      Py_DECREF(topic_iterator);
+    }
+  }
+
+  if (cpu_affinity) {
+    PyObject * cpu_iterator = PyObject_GetIter(cpu_affinity);
+    if (cpu_iterator != nullptr) {
+      PyObject * cpu = nullptr;
+      while ((cpu = PyIter_Next(cpu_iterator))) {
+        play_options.cpu_affinity.push_back(static_cast<int>(PyLong_AsLong(cpu)));
+
+        Py_DECREF(cpu);
+      }
+      Py_DECREF(cpu_iterator);
+    }
+  }
+
   auto topic_qos_overrides = PyObject_AsTopicQoSMap(qos_profile_overrides);
   play_options.topic_qos_profile_overrides = topic_qos_overrides;
+  play_options.thread_scheduling = PyObject_AsThreadScheduling(thread_scheduling);
+  play_options.transforms = PyObject_AsMessageTransforms(transforms);
+
+  // Every further bag is played together with the first one, with the same storage options.
+  std::vector<rosbag2_transport::StorageOptions> bag_storage_options{storage_options};
+  if (uris) {
+    PyObject * uri_iterator = PyObject_GetIter(uris);
+    if (uri_iterator != nullptr) {
+      PyObject * bag_uri = nullptr;
+      while ((bag_uri = PyIter_Next(uri_iterator))) {
+        bag_storage_options.push_back(storage_options);
+        bag_storage_options.back().uri = PyUnicode_AsUTF8(bag_uri);
+
+        Py_DECREF(bag_uri);
+      }
+      Py_DECREF(uri_iterator);
+    }
+  }
 
-  rosbag2_storage::MetadataIo metadata_io{};
-  rosbag2_storage::BagMetadata metadata{};
   // Specify defaults
   auto info = std::make_shared<rosbag2_cpp::Info>();
-  std::shared_ptr<rosbag2_cpp::Reader> reader;
+  // Change reader based on metadata options
+  auto reader = std::make_shared<rosbag2_cpp::Reader>(make_bag_reader(storage_options.uri));
   auto writer = std::make_shared<rosbag2_cpp::Writer>(
     std::make_unique<rosbag2_cpp::writers::SequentialWriter>());
-  // Change reader based on metadata options
-  if (metadata_io.metadata_file_exists(storage_options.uri)) {
-    metadata = metadata_io.read_metadata(storage_options.uri);
-    if (metadata.compression_format == "zstd") {
-      reader = std::make_shared<rosbag2_cpp::Reader>(
-        std::make_unique<rosbag2_compression::SequentialCompressionReader>());
-    } else {
-      reader = std::make_shared<rosbag2_cpp::Reader>(
-        std::make_unique<rosbag2_cpp::readers::SequentialReader>());
-    }
-  } else {
-    reader = std::make_shared<rosbag2_cpp::Reader>(
-      std::make_unique<rosbag2_cpp::readers::SequentialReader>());
+
+  try {
+    play_options.progress_callback =
+      PyObject_AsProgressCallback<rosbag2_transport::PlayProgress>(progress_callback);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
   }
+  play_options.progress_interval = std::chrono::milliseconds(progress_interval_ms);
 
+  // Playing a bag may take as long as it was recorded, so other Python threads keep running.
   rosbag2_transport::Rosbag2Transport transport(reader, writer, info);
-  transport.init();
-  transport.play(storage_options, play_options);
-  transport.shutdown();
+  const bool played = call_without_gil(
+    [&]() {
+      transport.init();
+      try {
+        transport.play(
+          bag_storage_options, play_options,
+          [](const rosbag2_transport::StorageOptions & options) {
+            return make_bag_reader(options.uri);
+          });
+      } catch (...) {
+        transport.shutdown();
+        throw;
+      }
+      transport.shutdown();
+    });
+  if (!played) {
+    return nullptr;
+  }
 
   Py_RETURN_NONE;
 }
@@ -295,12 +1052,13 @@ rosbag2_transport_play(PyObject * Py_UNUSED(self), PyObject * args, PyObject * k
 static PyObject *
 rosbag2_transport_info(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
 {
-  static const char * kwlist[] = {"uri", "storage_id", nullptr};
+  static const char * kwlist[] = {"uri", "storage_id", "verbose", nullptr};
 
   char * char_uri;
   char * char_storage_id;
+  bool verbose = false;
   if (!PyArg_ParseTupleAndKeywords(
-      args, kwargs, "ss", const_cast<char **>(kwlist), &char_uri, &char_storage_id))
+      args, kwargs, "ss|b", const_cast<char **>(kwlist), &char_uri, &char_storage_id, &verbose))
   {
     return nullptr;
   }
@@ -309,54 +1067,1604 @@ rosbag2_transport_info(PyObject * Py_UNUSED(self), PyObject * args, PyObject * k
   std::string storage_id = std::string(char_storage_id);
 
   rosbag2_transport::Rosbag2Transport transport;
-  transport.print_bag_info(uri, storage_id);
+  transport.print_bag_info(uri, storage_id, verbose);
 
   Py_RETURN_NONE;
 }
 
-/// Define the public methods of this module
-#if __GNUC__ >= 8
-# pragma GCC diagnostic push
-# pragma GCC diagnostic ignored "-Wcast-function-type"
-#endif
-static PyMethodDef rosbag2_transport_methods[] = {
+static PyObject *
+rosbag2_transport_reindex(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "uri", "storage_id", "relative_file_paths", "max_threads", nullptr};
+
+  char * char_uri;
+  char * char_storage_id;
+  PyObject * relative_file_paths = nullptr;
+  uint64_t max_threads = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "ss|OK", const_cast<char **>(kwlist), &char_uri, &char_storage_id,
+      &relative_file_paths, &max_threads))
   {
-    "record", reinterpret_cast<PyCFunction>(rosbag2_transport_record), METH_VARARGS | METH_KEYWORDS,
-    "Record to bag"
-  },
+    return nullptr;
+  }
+
+  std::vector<std::string> file_paths;
+  if (relative_file_paths) {
+    PyObject * path_iterator = PyObject_GetIter(relative_file_paths);
+    if (path_iterator != nullptr) {
+      PyObject * path;
+      while ((path = PyIter_Next(path_iterator))) {
+        file_paths.emplace_back(PyUnicode_AsUTF8(path));
+
+        Py_DECREF(path);
+      }
+      Py_DECREF(path_iterator);
+    }
+  }
+
+  rosbag2_storage::BagMetadata metadata;
+  try {
+    rosbag2_cpp::Reindexer reindexer;
+    metadata = reindexer.reindex(
+      std::string(char_uri), std::string(char_storage_id), file_paths,
+      static_cast<size_t>(max_threads));
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+
+  return PyLong_FromUnsignedLongLong(metadata.message_count);
+}
+
+static PyObject *
+rosbag2_transport_configure_threads(
+  PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"size", "cpu_affinity", "nice", nullptr};
+
+  uint64_t size = 0u;
+  PyObject * cpu_affinity = nullptr;
+  int nice = 0;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "|KOi", const_cast<char **>(kwlist), &size, &cpu_affinity, &nice))
   {
-    "play", reinterpret_cast<PyCFunction>(rosbag2_transport_play), METH_VARARGS | METH_KEYWORDS,
-    "Play bag"
-  },
+    return nullptr;
+  }
+
+  rosbag2_cpp::ThreadPoolOptions options;
+  options.size = static_cast<size_t>(size);
+  options.nice = nice;
+  if (cpu_affinity) {
+    PyObject * cpu_iterator = PyObject_GetIter(cpu_affinity);
+    if (cpu_iterator != nullptr) {
+      PyObject * cpu;
+      while ((cpu = PyIter_Next(cpu_iterator))) {
+        options.cpu_affinity.push_back(PyLong_AsSize_t(cpu));
+
+        Py_DECREF(cpu);
+      }
+      Py_DECREF(cpu_iterator);
+    }
+    if (PyErr_Occurred()) {
+      return nullptr;
+    }
+  }
+
+  try {
+    rosbag2_cpp::ThreadPool::configure_shared(options);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+rosbag2_transport_set_memory_budget(
+  PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"max_bytes", nullptr};
+
+  uint64_t max_bytes = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "K", const_cast<char **>(kwlist), &max_bytes))
   {
-    "info", reinterpret_cast<PyCFunction>(rosbag2_transport_info), METH_VARARGS | METH_KEYWORDS,
-    "Print bag info"
-  },
-  {nullptr, nullptr, 0, nullptr}  /* sentinel */
-};
-#if __GNUC__ >= 8
-# pragma GCC diagnostic pop
-#endif
+    return nullptr;
+  }
 
-PyDoc_STRVAR(
-  rosbag2_transport__doc__,
-  "Python module for rosbag2 transport");
+  rosbag2_cpp::MemoryBudget::get_shared().set_max_bytes(max_bytes);
+  Py_RETURN_NONE;
+}
 
-/// Define the Python module
-static struct PyModuleDef _rosbag2_transport_module = {
-  PyModuleDef_HEAD_INIT,
-  "_rosbag2_transport",
-  rosbag2_transport__doc__,
-  -1,   /* -1 means that the module keeps state in global variables */
-  rosbag2_transport_methods,
-  nullptr,
-  nullptr,
-  nullptr,
-  nullptr
-};
+static PyObject *
+rosbag2_transport_configure_memory_arena(
+  PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"size", "explicit_huge_pages", "numa_node", nullptr};
 
-/// Init function of this module
-PyMODINIT_FUNC PyInit__rosbag2_transport_py(void)
+  unsigned long long size = 0;  // NOLINT
+  bool explicit_huge_pages = false;
+  int numa_node = -1;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "K|bi", const_cast<char **>(kwlist), &size, &explicit_huge_pages, &numa_node))
+  {
+    return nullptr;
+  }
+
+  rosbag2_storage::MemoryArenaOptions options;
+  options.size = size;
+  options.explicit_huge_pages = explicit_huge_pages;
+  options.numa_node = numa_node;
+  try {
+    rosbag2_storage::MemoryArena::configure_shared(options);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+rosbag2_transport_get_memory_usage(PyObject * Py_UNUSED(self), PyObject * Py_UNUSED(args))
+{
+  const auto usage = rosbag2_cpp::MemoryBudget::get_shared().get_usage();
+  PyObject * stages = PyDict_New();
+  for (const auto & stage : usage.stages) {
+    PyObject * stage_usage = Py_BuildValue(
+      "{s:K,s:K}",
+      "bytes", static_cast<unsigned long long>(stage.second.bytes),  // NOLINT
+      "peak_bytes", static_cast<unsigned long long>(stage.second.peak_bytes));  // NOLINT
+    if (!stage_usage) {
+      Py_DECREF(stages);
+      return nullptr;
+    }
+    PyDict_SetItemString(stages, stage.first.c_str(), stage_usage);
+    Py_DECREF(stage_usage);
+  }
+  return Py_BuildValue(
+    "{s:K,s:K,s:K,s:N}",
+    "max_bytes", static_cast<unsigned long long>(usage.max_bytes),  // NOLINT
+    "bytes", static_cast<unsigned long long>(usage.bytes),  // NOLINT
+    "peak_bytes", static_cast<unsigned long long>(usage.peak_bytes),  // NOLINT
+    "stages", stages);
+}
+
+static PyObject *
+rosbag2_transport_verify(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "uri", "storage_id", "relative_file_paths", "max_threads", nullptr};
+
+  char * char_uri;
+  char * char_storage_id;
+  PyObject * relative_file_paths = nullptr;
+  uint64_t max_threads = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "ss|OK", const_cast<char **>(kwlist), &char_uri, &char_storage_id,
+      &relative_file_paths, &max_threads))
+  {
+    return nullptr;
+  }
+
+  std::vector<std::string> file_paths;
+  if (relative_file_paths) {
+    PyObject * path_iterator = PyObject_GetIter(relative_file_paths);
+    if (path_iterator != nullptr) {
+      PyObject * path;
+      while ((path = PyIter_Next(path_iterator))) {
+        file_paths.emplace_back(PyUnicode_AsUTF8(path));
+
+        Py_DECREF(path);
+      }
+      Py_DECREF(path_iterator);
+    }
+  }
+
+  const std::string uri(char_uri);
+  const std::string storage_id(char_storage_id);
+  std::vector<rosbag2_cpp::FileVerification> verifications;
+  if (!call_without_gil(
+      [&]() {
+        rosbag2_cpp::Verifier verifier;
+        verifications = verifier.verify(
+          uri, storage_id, file_paths, static_cast<size_t>(max_threads));
+      }))
+  {
+    return nullptr;
+  }
+
+  // (path, message count, error) of every file, the error is empty if the file is intact.
+  PyObject * file_list = PyList_New(static_cast<Py_ssize_t>(verifications.size()));
+  if (!file_list) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < verifications.size(); ++i) {
+    PyObject * file = Py_BuildValue(
+      "(sKs)", verifications[i].path.c_str(),
+      static_cast<unsigned long long>(verifications[i].message_count),  // NOLINT
+      verifications[i].error.c_str());
+    if (!file) {
+      Py_DECREF(file_list);
+      return nullptr;
+    }
+    PyList_SET_ITEM(file_list, static_cast<Py_ssize_t>(i), file);
+  }
+  return file_list;
+}
+
+static PyObject *
+rosbag2_transport_export_text(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
 {
-  return PyModule_Create(&_rosbag2_transport_module);
+  static const char * kwlist[] = {"uri", "directory", "format", "topics", "max_threads", nullptr};
+
+  char * char_uri;
+  char * char_directory;
+  char * char_format;
+  PyObject * topics = nullptr;
+  uint64_t max_threads = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "sss|OK", const_cast<char **>(kwlist), &char_uri, &char_directory,
+      &char_format, &topics, &max_threads))
+  {
+    return nullptr;
+  }
+
+  const std::string format(char_format);
+  if (format != "ndjson" && format != "csv") {
+    PyErr_SetString(PyExc_ValueError, "The format must be 'ndjson' or 'csv'.");
+    return nullptr;
+  }
+  std::vector<std::string> topic_names;
+  if (topics && topics != Py_None) {
+    PyObject * topic_iterator = PyObject_GetIter(topics);
+    if (topic_iterator != nullptr) {
+      PyObject * topic;
+      while ((topic = PyIter_Next(topic_iterator))) {
+        topic_names.emplace_back(PyUnicode_AsUTF8(topic));
+
+        Py_DECREF(topic);
+      }
+      Py_DECREF(topic_iterator);
+    }
+  }
+
+  const std::string uri(char_uri);
+  const std::string directory(char_directory);
+  std::vector<rosbag2_cpp::ExportedTopic> exported_topics;
+  if (!call_without_gil(
+      [&]() {
+        rosbag2_cpp::TextExporter exporter;
+        exported_topics = exporter.export_bag(
+          uri, directory,
+          format == "csv" ? rosbag2_cpp::TextFormat::CSV : rosbag2_cpp::TextFormat::NDJSON,
+          topic_names, static_cast<size_t>(max_threads));
+      }))
+  {
+    return nullptr;
+  }
+
+  // (topic name, file path, message count) of every exported topic.
+  PyObject * topic_list = PyList_New(static_cast<Py_ssize_t>(exported_topics.size()));
+  if (!topic_list) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < exported_topics.size(); ++i) {
+    PyObject * topic = Py_BuildValue(
+      "(ssK)", exported_topics[i].topic_name.c_str(), exported_topics[i].file_path.c_str(),
+      static_cast<unsigned long long>(exported_topics[i].message_count));  // NOLINT
+    if (!topic) {
+      Py_DECREF(topic_list);
+      return nullptr;
+    }
+    PyList_SET_ITEM(topic_list, static_cast<Py_ssize_t>(i), topic);
+  }
+  return topic_list;
+}
+
+static PyObject *
+rosbag2_transport_slice(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"uri", "output_uri", "start_offset", "duration", nullptr};
+
+  char * char_uri;
+  char * char_output_uri;
+  double start_offset = 0.0;
+  double duration = 0.0;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "ss|dd", const_cast<char **>(kwlist), &char_uri, &char_output_uri,
+      &start_offset, &duration))
+  {
+    return nullptr;
+  }
+
+  rosbag2_storage::BagMetadata metadata;
+  try {
+    // The offsets are counted from the start of the bag, like those of playback.
+    const std::string uri(char_uri);
+    rosbag2_storage::MetadataIo metadata_io{};
+    if (!metadata_io.metadata_file_exists(uri)) {
+      throw std::runtime_error("The bag \"" + uri + "\" has no metadata.");
+    }
+    const auto bag_start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      metadata_io.read_metadata(uri).starting_time.time_since_epoch()).count();
+    const auto start_time = bag_start_time + static_cast<int64_t>(start_offset * 1e9);
+    const auto end_time =
+      duration > 0.0 ? start_time + static_cast<int64_t>(duration * 1e9) : INT64_MAX;
+    rosbag2_cpp::BagSlicer slicer;
+    metadata = slicer.slice(uri, std::string(char_output_uri), start_time, end_time);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+
+  return PyLong_FromUnsignedLongLong(metadata.message_count);
+}
+
+static PyObject *
+rosbag2_transport_export_dataset(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "uri", "directory", "topics", "format", "samples_per_shard", "slop", "by_publish_time",
+    "max_threads", "storage_id", nullptr};
+
+  char * char_uri;
+  char * char_directory;
+  PyObject * topics = nullptr;
+  char * char_format = nullptr;
+  uint64_t samples_per_shard = 1000u;
+  int64_t slop = 0;
+  bool by_publish_time = false;
+  uint64_t max_threads = 0u;
+  char * char_storage_id = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "ssO|sKLbKs", const_cast<char **>(kwlist), &char_uri, &char_directory,
+      &topics, &char_format, &samples_per_shard, &slop, &by_publish_time, &max_threads,
+      &char_storage_id))
+  {
+    return nullptr;
+  }
+
+  const std::string format(char_format ? char_format : "webdataset");
+  if (format != "webdataset" && format != "tfrecord") {
+    PyErr_SetString(PyExc_ValueError, "The format must be 'webdataset' or 'tfrecord'.");
+    return nullptr;
+  }
+  rosbag2_cpp::DatasetExportOptions options;
+  PyObject * topic_iterator = PyObject_GetIter(topics);
+  if (topic_iterator != nullptr) {
+    PyObject * topic;
+    while ((topic = PyIter_Next(topic_iterator))) {
+      options.synchronization.topics.emplace_back(PyUnicode_AsUTF8(topic));
+
+      Py_DECREF(topic);
+    }
+    Py_DECREF(topic_iterator);
+  }
+  options.synchronization.slop = slop;
+  options.synchronization.by_publish_time = by_publish_time;
+  options.format = format == "tfrecord" ?
+    rosbag2_cpp::DatasetShardFormat::TFRECORD : rosbag2_cpp::DatasetShardFormat::WEBDATASET;
+  options.samples_per_shard = static_cast<size_t>(samples_per_shard);
+  options.max_threads = static_cast<size_t>(max_threads);
+
+  rosbag2_cpp::StorageOptions storage_options{};
+  storage_options.uri = std::string(char_uri);
+  storage_options.storage_id = char_storage_id ? std::string(char_storage_id) : "";
+  const std::string directory(char_directory);
+  rosbag2_cpp::DatasetExportResult result;
+  if (!call_without_gil(
+      [&]() {
+        const auto metadata =
+        rosbag2_cpp::Info().read_metadata(storage_options.uri, storage_options.storage_id);
+        const auto input_format = metadata.topics_with_message_count.empty() ? std::string() :
+        metadata.topics_with_message_count[0].topic_metadata.serialization_format;
+        // The exporter reads with SequentialReaders by default.
+        rosbag2_cpp::readers::ParallelReader::ReaderFactory reader_factory;
+        if (!metadata.compression_format.empty()) {
+          reader_factory = []() {
+              return std::make_unique<rosbag2_compression::SequentialCompressionReader>();
+            };
+        }
+        rosbag2_cpp::DatasetExporter exporter(options, reader_factory);
+        result = exporter.export_shards(
+          storage_options, {input_format, input_format}, directory);
+      }))
+  {
+    return nullptr;
+  }
+
+  // (shard paths, sample count)
+  PyObject * shard_list = PyList_New(static_cast<Py_ssize_t>(result.shard_paths.size()));
+  if (!shard_list) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < result.shard_paths.size(); ++i) {
+    PyObject * shard_path = PyUnicode_FromString(result.shard_paths[i].c_str());
+    if (!shard_path) {
+      Py_DECREF(shard_list);
+      return nullptr;
+    }
+    PyList_SET_ITEM(shard_list, static_cast<Py_ssize_t>(i), shard_path);
+  }
+  return Py_BuildValue(
+    "(NK)", shard_list, static_cast<unsigned long long>(result.sample_count));  // NOLINT
+}
+
+static PyObject *
+rosbag2_transport_finalize(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"uri", "host_folders", nullptr};
+
+  char * char_uri;
+  PyObject * host_folders = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "sO", const_cast<char **>(kwlist), &char_uri, &host_folders))
+  {
+    return nullptr;
+  }
+
+  std::vector<std::string> folders;
+  PyObject * folder_iterator = PyObject_GetIter(host_folders);
+  if (folder_iterator != nullptr) {
+    PyObject * folder;
+    while ((folder = PyIter_Next(folder_iterator))) {
+      folders.emplace_back(PyUnicode_AsUTF8(folder));
+
+      Py_DECREF(folder);
+    }
+    Py_DECREF(folder_iterator);
+  }
+
+  rosbag2_storage::BagMetadata metadata;
+  try {
+    rosbag2_cpp::DistributedBagFinalizer finalizer;
+    metadata = finalizer.finalize(std::string(char_uri), folders);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+
+  return PyLong_FromUnsignedLongLong(metadata.message_count);
+}
+
+static PyObject *
+rosbag2_transport_generate(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "uri", "spec", "storage_id", "max_bagfile_size", "max_threads", nullptr};
+
+  char * char_uri;
+  char * char_spec;
+  char * char_storage_id;
+  uint64_t max_bagfile_size = 0u;
+  uint64_t max_threads = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "sss|KK", const_cast<char **>(kwlist), &char_uri, &char_spec,
+      &char_storage_id, &max_bagfile_size, &max_threads))
+  {
+    return nullptr;
+  }
+
+  rosbag2_cpp::StorageOptions storage_options{};
+  storage_options.uri = std::string(char_uri);
+  storage_options.storage_id = std::string(char_storage_id);
+  storage_options.max_bagfile_size = max_bagfile_size;
+
+  uint64_t message_count = 0;
+  try {
+    const auto spec = rosbag2_cpp::BagGenerator::load_spec(std::string(char_spec));
+    rosbag2_cpp::BagGenerator generator;
+    message_count = generator.generate(spec, storage_options, static_cast<size_t>(max_threads));
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+
+  return PyLong_FromUnsignedLongLong(message_count);
+}
+
+static PyObject *
+rosbag2_transport_convert(PyObject * Py_UNUSED(self), PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "input_uris",
+    "input_storage_id",
+    "output_uri",
+    "output_storage_id",
+    "max_bagfile_size",
+    "max_bagfile_duration",
+    "topics",
+    "topic_groups",
+    "exclude",
+    "serialization_format",
+    "compression_mode",
+    "compression_format",
+    "compression_level",
+    "compression_threads",
+    "keep_splits",
+    "max_threads",
+    nullptr
+  };
+
+  PyObject * input_uris = nullptr;
+  char * char_input_storage_id;
+  char * char_output_uri;
+  char * char_output_storage_id;
+  uint64_t max_bagfile_size = 0u;
+  uint64_t max_bagfile_duration = 0u;
+  PyObject * topics = nullptr;
+  PyObject * topic_groups = nullptr;
+  char * exclude = nullptr;
+  char * serialization_format = nullptr;
+  char * compression_mode = nullptr;
+  char * compression_format = nullptr;
+  int compression_level = 1;
+  uint64_t compression_threads = 1u;
+  bool keep_splits = false;
+  uint64_t max_threads = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "Osss|KKOOssssiKbK", const_cast<char **>(kwlist),
+      &input_uris,
+      &char_input_storage_id,
+      &char_output_uri,
+      &char_output_storage_id,
+      &max_bagfile_size,
+      &max_bagfile_duration,
+      &topics,
+      &topic_groups,
+      &exclude,
+      &serialization_format,
+      &compression_mode,
+      &compression_format,
+      &compression_level,
+      &compression_threads,
+      &keep_splits,
+      &max_threads))
+  {
+    return nullptr;
+  }
+
+  std::vector<rosbag2_transport::StorageOptions> input_options;
+  PyObject * uri_iterator = PyObject_GetIter(input_uris);
+  if (uri_iterator != nullptr) {
+    PyObject * uri;
+    while ((uri = PyIter_Next(uri_iterator))) {
+      rosbag2_transport::StorageOptions bag_options{};
+      bag_options.uri = std::string(PyUnicode_AsUTF8(uri));
+      bag_options.storage_id = std::string(char_input_storage_id);
+      input_options.push_back(bag_options);
+
+      Py_DECREF(uri);
+    }
+    Py_DECREF(uri_iterator);
+  }
+  rosbag2_transport::StorageOptions output_options{};
+  output_options.uri = std::string(char_output_uri);
+  output_options.storage_id = std::string(char_output_storage_id);
+  output_options.max_bagfile_size = max_bagfile_size;
+  output_options.max_bagfile_duration = max_bagfile_duration;
+
+  rosbag2_transport::ConvertOptions convert_options{};
+  if (topics) {
+    PyObject * topic_iterator = PyObject_GetIter(topics);
+    if (topic_iterator != nullptr) {
+      PyObject * topic;
+      while ((topic = PyIter_Next(topic_iterator))) {
+        convert_options.topics.emplace_back(PyUnicode_AsUTF8(topic));
+
+        Py_DECREF(topic);
+      }
+      Py_DECREF(topic_iterator);
+    }
+  }
+  convert_options.exclude = exclude ? std::string(exclude) : "";
+  convert_options.output_serialization_format =
+    serialization_format ? std::string(serialization_format) : "";
+  convert_options.compression_options.compression_format =
+    compression_format ? std::string(compression_format) : "";
+  convert_options.compression_options.compression_mode =
+    rosbag2_compression::compression_mode_from_string(
+    compression_mode ? std::string(compression_mode) : "");
+  convert_options.compression_options.compression_level = compression_level;
+  convert_options.compression_options.compression_threads = compression_threads;
+  convert_options.keep_splits = keep_splits;
+  convert_options.max_threads = static_cast<size_t>(max_threads);
+
+  rosbag2_transport::ConversionSummary summary{};
+  try {
+    output_options.topic_groups = PyObject_AsTopicGroups(topic_groups);
+    rosbag2_transport::BagConverter converter;
+    summary = converter.convert(input_options, output_options, convert_options);
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+
+  const auto seconds = std::chrono::duration<double>(summary.duration).count();
+  return Py_BuildValue(
+    "KKd", static_cast<unsigned long long>(summary.message_count),  // NOLINT
+    static_cast<unsigned long long>(summary.bytes), seconds);  // NOLINT
+}
+
+/// Number of messages read at once when iterating a reader
+constexpr const size_t ITERATION_BATCH_MESSAGES = 1000;
+
+// The types are set up when the module is initialized.
+#if defined(__GNUC__)
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#endif
+static PyTypeObject PyBagMessageType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+static PyTypeObject PyBagReaderType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+static PyTypeObject PyBagWriterType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+#if defined(__GNUC__)
+# pragma GCC diagnostic pop
+#endif
+
+/// A message of a bag. Its serialized data is exposed read-only through the buffer protocol,
+/// so memoryview(message) or numpy.frombuffer(message, ...) do not copy it.
+struct PyBagMessage
+{
+  PyObject_HEAD
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+  // Buffers exported through the buffer protocol and not released yet, which reference the data.
+  Py_ssize_t export_count;
+};
+
+static PyObject * PyBagMessage_New(PyTypeObject * type, PyObject *, PyObject *)
+{
+  auto self = reinterpret_cast<PyBagMessage *>(type->tp_alloc(type, 0));
+  if (self) {
+    new (&self->message) std::shared_ptr<rosbag2_storage::SerializedBagMessage>(
+      std::make_shared<rosbag2_storage::SerializedBagMessage>());
+    self->message->time_stamp = 0;
+    self->export_count = 0;
+  }
+  return reinterpret_cast<PyObject *>(self);
+}
+
+static PyObject * PyBagMessage_FromMessage(
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message)
+{
+  auto self = reinterpret_cast<PyBagMessage *>(
+    PyBagMessage_New(&PyBagMessageType, nullptr, nullptr));
+  if (self) {
+    self->message = std::move(message);
+  }
+  return reinterpret_cast<PyObject *>(self);
+}
+
+/// BagMessage(topic_name, time_stamp, data) copies the data, e.g. bytes or a NumPy array.
+/// Like bytearray, it refuses to reinitialize a message whose data is still exported.
+static int PyBagMessage_Init(PyBagMessage * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"topic_name", "time_stamp", "data", nullptr};
+
+  if (self->export_count > 0) {
+    PyErr_SetString(
+      PyExc_BufferError, "Existing exports of data: object cannot be re-initialized");
+    return -1;
+  }
+
+  char * topic_name = nullptr;
+  long long time_stamp = 0;  // NOLINT
+  Py_buffer data{};
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "sLy*", const_cast<char **>(kwlist), &topic_name, &time_stamp, &data))
+  {
+    return -1;
+  }
+  try {
+    self->message->topic_name = std::string(topic_name);
+    self->message->time_stamp = time_stamp;
+    self->message->serialized_data = rosbag2_storage::make_serialized_message(
+      data.buf, static_cast<size_t>(data.len));
+  } catch (const std::exception & e) {
+    PyBuffer_Release(&data);
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return -1;
+  }
+  PyBuffer_Release(&data);
+  return 0;
+}
+
+static void PyBagMessage_Dealloc(PyBagMessage * self)
+{
+  self->message.~shared_ptr();
+  Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+static int PyBagMessage_GetBuffer(PyObject * object, Py_buffer * view, int flags)
+{
+  static uint8_t empty_data = 0;
+  const auto & message = reinterpret_cast<PyBagMessage *>(object)->message;
+  const auto & serialized_data = message->serialized_data;
+  void * buffer = serialized_data ? serialized_data->buffer : &empty_data;
+  const auto length = serialized_data ? serialized_data->buffer_length : 0;
+  if (PyBuffer_FillInfo(view, object, buffer, static_cast<Py_ssize_t>(length), 1, flags) < 0) {
+    return -1;
+  }
+  ++reinterpret_cast<PyBagMessage *>(object)->export_count;
+  return 0;
+}
+
+static void PyBagMessage_ReleaseBuffer(PyObject * object, Py_buffer *)
+{
+  --reinterpret_cast<PyBagMessage *>(object)->export_count;
+}
+
+static PyObject * PyBagMessage_GetTopicName(PyObject * self, void *)
+{
+  return PyUnicode_FromString(
+    reinterpret_cast<PyBagMessage *>(self)->message->topic_name.c_str());
+}
+
+static PyObject * PyBagMessage_GetTimeStamp(PyObject * self, void *)
+{
+  return PyLong_FromLongLong(reinterpret_cast<PyBagMessage *>(self)->message->time_stamp);
+}
+
+static PyObject * PyBagMessage_GetData(PyObject * self, void *)
+{
+  return PyMemoryView_FromObject(self);
+}
+
+static PyGetSetDef PyBagMessage_GetSet[] = {
+  {"topic_name", PyBagMessage_GetTopicName, nullptr,
+    "Name of the topic of the message", nullptr},
+  {"time_stamp", PyBagMessage_GetTimeStamp, nullptr,
+    "Time stamp of the message in nanoseconds", nullptr},
+  {"data", PyBagMessage_GetData, nullptr,
+    "Read-only memoryview of the serialized message, without copying it", nullptr},
+  {nullptr, nullptr, nullptr, nullptr, nullptr}  /* sentinel */
+};
+
+static PyBufferProcs PyBagMessage_BufferProcs = {
+  PyBagMessage_GetBuffer, PyBagMessage_ReleaseBuffer};
+
+/// Copy of the message of a BagMessage object, with a copy of its data, to be written.
+/// Writers compress or encrypt the data of the messages in place, and the object may be
+/// re-initialized while the writer still holds the message.
+/// \return the copy, or nullptr with a RuntimeError set if it could not be made
+static std::shared_ptr<rosbag2_storage::SerializedBagMessage> PyBagMessage_Copy(
+  PyBagMessage * self)
+{
+  try {
+    auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>(*self->message);
+    if (message->serialized_data) {
+      message->serialized_data = rosbag2_storage::make_serialized_message(
+        message->serialized_data->buffer, message->serialized_data->buffer_length);
+    }
+    return message;
+  } catch (const std::exception & e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+    return nullptr;
+  }
+}
+
+/// Convert a Python iterable of BagMessage objects to copies of their messages to be written
+static bool PyObject_AsBagMessages(
+  PyObject * object,
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> & messages)
+{
+  PyObject * iterator = PyObject_GetIter(object);
+  if (!iterator) {
+    return false;
+  }
+  PyObject * item;
+  while ((item = PyIter_Next(iterator))) {
+    const bool is_message = PyObject_TypeCheck(item, &PyBagMessageType);
+    auto message = is_message ?
+      PyBagMessage_Copy(reinterpret_cast<PyBagMessage *>(item)) : nullptr;
+    Py_DECREF(item);
+    if (!is_message) {
+      Py_DECREF(iterator);
+      PyErr_SetString(PyExc_TypeError, "Messages need to be BagMessage objects.");
+      return false;
+    }
+    if (!message) {
+      Py_DECREF(iterator);
+      return false;
+    }
+    messages.push_back(std::move(message));
+  }
+  Py_DECREF(iterator);
+  return !PyErr_Occurred();
+}
+
+/// Reads the messages of a bag in batches, with the reader ros2 bag play would use for it.
+/// Iterating the reader yields its messages. Not to be used from several threads at once.
+struct PyBagReader
+{
+  PyObject_HEAD
+  std::unique_ptr<rosbag2_cpp::Reader> reader;
+  // Messages read ahead while iterating the reader
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> pending;
+  size_t next_pending;
+};
+
+static PyObject * PyBagReader_New(PyTypeObject * type, PyObject *, PyObject *)
+{
+  auto self = reinterpret_cast<PyBagReader *>(type->tp_alloc(type, 0));
+  if (self) {
+    new (&self->reader) std::unique_ptr<rosbag2_cpp::Reader>();
+    new (&self->pending) std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>();
+    self->next_pending = 0;
+  }
+  return reinterpret_cast<PyObject *>(self);
+}
+
+/// Reader(uri, storage_id='', serialization_format='') opens the bag, converting its messages
+/// to the serialization format if one is given.
+static int PyBagReader_Init(PyBagReader * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"uri", "storage_id", "serialization_format", nullptr};
+
+  char * char_uri;
+  char * char_storage_id = nullptr;
+  char * char_serialization_format = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "s|ss", const_cast<char **>(kwlist), &char_uri, &char_storage_id,
+      &char_serialization_format))
+  {
+    return -1;
+  }
+  rosbag2_transport::StorageOptions storage_options{};
+  storage_options.uri = std::string(char_uri);
+  storage_options.storage_id = char_storage_id ? std::string(char_storage_id) : "";
+  const auto serialization_format =
+    char_serialization_format ? std::string(char_serialization_format) : "";
+
+  std::unique_ptr<rosbag2_cpp::Reader> reader;
+  const bool opened = call_without_gil(
+    [&]() {
+      const auto metadata =
+        rosbag2_cpp::Info().read_metadata(storage_options.uri, storage_options.storage_id);
+      const auto input_format = metadata.topics_with_message_count.empty() ? std::string() :
+        metadata.topics_with_message_count[0].topic_metadata.serialization_format;
+      reader = rosbag2_transport::BagConverter::make_default_reader(metadata);
+      reader->open(
+        storage_options,
+        {input_format, serialization_format.empty() ? input_format : serialization_format});
+    });
+  if (!opened) {
+    return -1;
+  }
+  self->reader = std::move(reader);
+  self->pending.clear();
+  self->next_pending = 0;
+  return 0;
+}
+
+static void PyBagReader_Dealloc(PyBagReader * self)
+{
+  self->pending.~vector();
+  self->reader.~unique_ptr();
+  Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+/// \return the reader, or nullptr with a RuntimeError set if it is closed
+static rosbag2_cpp::Reader * PyBagReader_Get(PyBagReader * self)
+{
+  if (!self->reader) {
+    PyErr_SetString(PyExc_RuntimeError, "Reader is closed.");
+  }
+  return self->reader.get();
+}
+
+static PyObject * PyBagReader_HasNext(PyBagReader * self, PyObject *)
+{
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  bool has_next = self->next_pending < self->pending.size();
+  if (!has_next && !call_without_gil([&]() {has_next = reader->has_next();})) {
+    return nullptr;
+  }
+  return PyBool_FromLong(has_next);
+}
+
+static PyObject * PyBagReader_ReadNextBatch(
+  PyBagReader * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"max_messages", "max_bytes", nullptr};
+
+  uint64_t max_messages = ITERATION_BATCH_MESSAGES;
+  uint64_t max_bytes = 0u;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "|KK", const_cast<char **>(kwlist), &max_messages, &max_bytes))
+  {
+    return nullptr;
+  }
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  // Messages read ahead by iterating the reader come first.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> batch;
+  for (size_t bytes = 0; self->next_pending < self->pending.size() &&
+    batch.size() < max_messages && (max_bytes == 0 || bytes < max_bytes); )
+  {
+    auto & message = self->pending[self->next_pending++];
+    bytes += message->serialized_data ? message->serialized_data->buffer_length : 0;
+    batch.push_back(std::move(message));
+  }
+  if (batch.empty() && !call_without_gil(
+      [&]() {
+        batch = reader->read_next_batch(
+          static_cast<size_t>(max_messages), static_cast<size_t>(max_bytes));
+      }))
+  {
+    return nullptr;
+  }
+  PyObject * messages = PyList_New(static_cast<Py_ssize_t>(batch.size()));
+  if (!messages) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < batch.size(); ++i) {
+    PyObject * message = PyBagMessage_FromMessage(std::move(batch[i]));
+    if (!message) {
+      Py_DECREF(messages);
+      return nullptr;
+    }
+    PyList_SET_ITEM(messages, static_cast<Py_ssize_t>(i), message);
+  }
+  return messages;
+}
+
+static PyObject * PyBagReader_ReadNext(PyBagReader * self, PyObject *)
+{
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  if (self->next_pending < self->pending.size()) {
+    return PyBagMessage_FromMessage(std::move(self->pending[self->next_pending++]));
+  }
+  std::shared_ptr<rosbag2_storage::SerializedBagMessage> message;
+  if (!call_without_gil([&]() {message = reader->read_next();})) {
+    return nullptr;
+  }
+  return PyBagMessage_FromMessage(std::move(message));
+}
+
+static PyObject * PyBagReader_IterNext(PyBagReader * self)
+{
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  if (self->next_pending == self->pending.size()) {
+    self->pending.clear();
+    self->next_pending = 0;
+    if (!call_without_gil(
+        [&]() {self->pending = reader->read_next_batch(ITERATION_BATCH_MESSAGES, 0);}))
+    {
+      return nullptr;
+    }
+    if (self->pending.empty()) {
+      // Returning nullptr without an error set stops the iteration.
+      return nullptr;
+    }
+  }
+  return PyBagMessage_FromMessage(std::move(self->pending[self->next_pending++]));
+}
+
+static PyObject * PyBagReader_GetAllTopicsAndTypes(PyBagReader * self, PyObject *)
+{
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  const auto topics = reader->get_all_topics_and_types();
+  PyObject * topic_list = PyList_New(static_cast<Py_ssize_t>(topics.size()));
+  if (!topic_list) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < topics.size(); ++i) {
+    PyObject * topic = Py_BuildValue(
+      "(sss)", topics[i].name.c_str(), topics[i].type.c_str(),
+      topics[i].serialization_format.c_str());
+    if (!topic) {
+      Py_DECREF(topic_list);
+      return nullptr;
+    }
+    PyList_SET_ITEM(topic_list, static_cast<Py_ssize_t>(i), topic);
+  }
+  return topic_list;
+}
+
+/// Convert a Python iterable of strings, or None, to a vector of strings
+static bool PyObject_AsStrings(PyObject * object, std::vector<std::string> & strings)
+{
+  if (!object || object == Py_None) {
+    return true;
+  }
+  PyObject * iterator = PyObject_GetIter(object);
+  if (!iterator) {
+    return false;
+  }
+  PyObject * item;
+  while ((item = PyIter_Next(iterator))) {
+    const char * string = PyUnicode_AsUTF8(item);
+    if (string) {
+      strings.emplace_back(string);
+    }
+    Py_DECREF(item);
+    if (!string) {
+      Py_DECREF(iterator);
+      return false;
+    }
+  }
+  Py_DECREF(iterator);
+  return !PyErr_Occurred();
+}
+
+/// Convert a Python iterable of (topics_regex, start_time, end_time) tuples, or None, to
+/// topic time ranges
+static bool PyObject_AsTopicTimeRanges(
+  PyObject * object, std::vector<rosbag2_storage::TopicTimeRange> & topic_time_ranges)
+{
+  if (!object || object == Py_None) {
+    return true;
+  }
+  PyObject * iterator = PyObject_GetIter(object);
+  if (!iterator) {
+    return false;
+  }
+  PyObject * item;
+  while ((item = PyIter_Next(iterator))) {
+    const char * topics_regex = nullptr;
+    long long start_time = 0;  // NOLINT
+    long long end_time = 0;  // NOLINT
+    const bool parsed = PyArg_ParseTuple(item, "sLL", &topics_regex, &start_time, &end_time);
+    if (parsed) {
+      topic_time_ranges.push_back({topics_regex, start_time, end_time});
+    }
+    Py_DECREF(item);
+    if (!parsed) {
+      Py_DECREF(iterator);
+      return false;
+    }
+  }
+  Py_DECREF(iterator);
+  return !PyErr_Occurred();
+}
+
+static PyObject * PyBagReader_SetFilter(PyBagReader * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "topics", "topics_regex", "topic_types", "sample_stride", "sample_interval",
+    "topic_time_ranges", nullptr};
+
+  PyObject * topics = nullptr;
+  char * topics_regex = nullptr;
+  PyObject * topic_types = nullptr;
+  unsigned long long sample_stride = 0;  // NOLINT
+  long long sample_interval = 0;  // NOLINT
+  PyObject * topic_time_ranges = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "|OsOKLO", const_cast<char **>(kwlist),
+      &topics, &topics_regex, &topic_types, &sample_stride, &sample_interval, &topic_time_ranges))
+  {
+    return nullptr;
+  }
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  rosbag2_storage::StorageFilter storage_filter{};
+  if (!PyObject_AsStrings(topics, storage_filter.topics) ||
+    !PyObject_AsStrings(topic_types, storage_filter.topic_types) ||
+    !PyObject_AsTopicTimeRanges(topic_time_ranges, storage_filter.topic_time_ranges))
+  {
+    return nullptr;
+  }
+  storage_filter.topics_regex = topics_regex ? topics_regex : "";
+  storage_filter.sample_stride = sample_stride;
+  storage_filter.sample_interval = sample_interval;
+  // Messages read ahead may be of other topics.
+  self->pending.clear();
+  self->next_pending = 0;
+  if (!call_without_gil([&]() {reader->set_filter(storage_filter);})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagReader_ResetFilter(PyBagReader * self, PyObject *)
+{
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  self->pending.clear();
+  self->next_pending = 0;
+  if (!call_without_gil([&]() {reader->reset_filter();})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagReader_Seek(PyBagReader * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"time_stamp", nullptr};
+
+  long long time_stamp = 0;  // NOLINT
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "L", const_cast<char **>(kwlist), &time_stamp))
+  {
+    return nullptr;
+  }
+  auto reader = PyBagReader_Get(self);
+  if (!reader) {
+    return nullptr;
+  }
+  self->pending.clear();
+  self->next_pending = 0;
+  const rcutils_time_point_value_t timestamp = time_stamp;
+  if (!call_without_gil([&]() {reader->seek(timestamp);})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagReader_Close(PyBagReader * self, PyObject *)
+{
+  self->pending.clear();
+  self->next_pending = 0;
+  auto reader = std::move(self->reader);
+  if (!call_without_gil([&]() {reader.reset();})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagReader_Exit(PyBagReader * self, PyObject *)
+{
+  return PyBagReader_Close(self, nullptr);
+}
+
+/// __enter__ of objects which are their own context manager
+static PyObject * return_self(PyObject * self, PyObject *)
+{
+  Py_INCREF(self);
+  return self;
+}
+
+#if __GNUC__ >= 8
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wcast-function-type"
+#endif
+static PyMethodDef PyBagReader_Methods[] = {
+  {
+    "has_next", reinterpret_cast<PyCFunction>(PyBagReader_HasNext), METH_NOARGS,
+    "Whether the bag has more messages"
+  },
+  {
+    "read_next", reinterpret_cast<PyCFunction>(PyBagReader_ReadNext), METH_NOARGS,
+    "Read the next message"
+  },
+  {
+    "read_next_batch", reinterpret_cast<PyCFunction>(PyBagReader_ReadNextBatch),
+    METH_VARARGS | METH_KEYWORDS,
+    "Read a list of up to max_messages messages, and of up to max_bytes bytes if it is not 0. "
+    "The list is empty at the end of the bag."
+  },
+  {
+    "get_all_topics_and_types", reinterpret_cast<PyCFunction>(PyBagReader_GetAllTopicsAndTypes),
+    METH_NOARGS, "List the (name, type, serialization_format) of the topics of the bag"
+  },
+  {
+    "set_filter", reinterpret_cast<PyCFunction>(PyBagReader_SetFilter),
+    METH_VARARGS | METH_KEYWORDS,
+    "Read only the messages of the topics, or of those matching topics_regex, and of the "
+    "topic_types if given. sample_stride reads only every n-th message of a topic, and "
+    "sample_interval skips messages less than as many nanoseconds after the last one of their "
+    "topic, if the storage supports sampling. topic_time_ranges is a list of (topics_regex, "
+    "start_time, end_time) to read the matching topics only within"
+  },
+  {
+    "reset_filter", reinterpret_cast<PyCFunction>(PyBagReader_ResetFilter), METH_NOARGS,
+    "Read the messages of all topics"
+  },
+  {
+    "seek", reinterpret_cast<PyCFunction>(PyBagReader_Seek), METH_VARARGS | METH_KEYWORDS,
+    "Continue reading at the first message at or after the time stamp in nanoseconds"
+  },
+  {
+    "close", reinterpret_cast<PyCFunction>(PyBagReader_Close), METH_NOARGS, "Close the bag"
+  },
+  {
+    "__enter__", reinterpret_cast<PyCFunction>(return_self), METH_NOARGS, nullptr
+  },
+  {
+    "__exit__", reinterpret_cast<PyCFunction>(PyBagReader_Exit), METH_VARARGS, nullptr
+  },
+  {nullptr, nullptr, 0, nullptr}  /* sentinel */
+};
+#if __GNUC__ >= 8
+# pragma GCC diagnostic pop
+#endif
+
+/// Writes messages to a bag, with the writer ros2 bag record would use for the options.
+/// Not to be used from several threads at once.
+struct PyBagWriter
+{
+  PyObject_HEAD
+  std::unique_ptr<rosbag2_cpp::Writer> writer;
+  std::string serialization_format;
+};
+
+static PyObject * PyBagWriter_New(PyTypeObject * type, PyObject *, PyObject *)
+{
+  auto self = reinterpret_cast<PyBagWriter *>(type->tp_alloc(type, 0));
+  if (self) {
+    new (&self->writer) std::unique_ptr<rosbag2_cpp::Writer>();
+    new (&self->serialization_format) std::string();
+  }
+  return reinterpret_cast<PyObject *>(self);
+}
+
+/// Writer(uri, storage_id='sqlite3', serialization_format='cdr', max_bagfile_size=0,
+/// max_bagfile_duration=0, compression_mode='none', compression_format='') creates the bag.
+static int PyBagWriter_Init(PyBagWriter * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "uri",
+    "storage_id",
+    "serialization_format",
+    "max_bagfile_size",
+    "max_bagfile_duration",
+    "compression_mode",
+    "compression_format",
+    nullptr
+  };
+
+  char * char_uri;
+  char * char_storage_id = nullptr;
+  char * char_serialization_format = nullptr;
+  uint64_t max_bagfile_size = 0u;
+  uint64_t max_bagfile_duration = 0u;
+  char * compression_mode = nullptr;
+  char * compression_format = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "s|ssKKss", const_cast<char **>(kwlist), &char_uri, &char_storage_id,
+      &char_serialization_format, &max_bagfile_size, &max_bagfile_duration, &compression_mode,
+      &compression_format))
+  {
+    return -1;
+  }
+  rosbag2_transport::StorageOptions storage_options{};
+  storage_options.uri = std::string(char_uri);
+  storage_options.storage_id = char_storage_id ? std::string(char_storage_id) : "sqlite3";
+  storage_options.max_bagfile_size = max_bagfile_size;
+  storage_options.max_bagfile_duration = max_bagfile_duration;
+  const auto serialization_format =
+    char_serialization_format ? std::string(char_serialization_format) : "cdr";
+
+  rosbag2_transport::ConvertOptions convert_options{};
+  std::unique_ptr<rosbag2_cpp::Writer> writer;
+  const bool opened = call_without_gil(
+    [&]() {
+      convert_options.compression_options.compression_format =
+        compression_format ? std::string(compression_format) : "";
+      convert_options.compression_options.compression_mode =
+        rosbag2_compression::compression_mode_from_string(
+        compression_mode ? std::string(compression_mode) : "");
+      writer = rosbag2_transport::BagConverter::make_default_writer(convert_options);
+      writer->open(storage_options, {serialization_format, serialization_format});
+    });
+  if (!opened) {
+    return -1;
+  }
+  self->writer = std::move(writer);
+  self->serialization_format = serialization_format;
+  return 0;
+}
+
+static void PyBagWriter_Dealloc(PyBagWriter * self)
+{
+  self->serialization_format.~basic_string();
+  self->writer.~unique_ptr();
+  Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+/// \return the writer, or nullptr with a RuntimeError set if it is closed
+static rosbag2_cpp::Writer * PyBagWriter_Get(PyBagWriter * self)
+{
+  if (!self->writer) {
+    PyErr_SetString(PyExc_RuntimeError, "Writer is closed.");
+  }
+  return self->writer.get();
+}
+
+static PyObject * PyBagWriter_CreateTopic(PyBagWriter * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {
+    "name", "type", "serialization_format", "offered_qos_profiles", nullptr};
+
+  char * name;
+  char * type;
+  char * serialization_format = nullptr;
+  char * offered_qos_profiles = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "ss|ss", const_cast<char **>(kwlist), &name, &type, &serialization_format,
+      &offered_qos_profiles))
+  {
+    return nullptr;
+  }
+  auto writer = PyBagWriter_Get(self);
+  if (!writer) {
+    return nullptr;
+  }
+  rosbag2_storage::TopicMetadata topic{};
+  topic.name = std::string(name);
+  topic.type = std::string(type);
+  topic.serialization_format =
+    serialization_format ? std::string(serialization_format) : self->serialization_format;
+  topic.offered_qos_profiles = offered_qos_profiles ? std::string(offered_qos_profiles) : "";
+  if (!call_without_gil([&]() {writer->create_topic(topic);})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagWriter_Write(PyBagWriter * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"message", nullptr};
+
+  PyObject * message = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(
+      args, kwargs, "O!", const_cast<char **>(kwlist), &PyBagMessageType, &message))
+  {
+    return nullptr;
+  }
+  auto writer = PyBagWriter_Get(self);
+  if (!writer) {
+    return nullptr;
+  }
+  auto bag_message = PyBagMessage_Copy(reinterpret_cast<PyBagMessage *>(message));
+  if (!bag_message) {
+    return nullptr;
+  }
+  if (!call_without_gil([&]() {writer->write(std::move(bag_message));})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagWriter_WriteBatch(PyBagWriter * self, PyObject * args, PyObject * kwargs)
+{
+  static const char * kwlist[] = {"messages", nullptr};
+
+  PyObject * messages = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", const_cast<char **>(kwlist), &messages)) {
+    return nullptr;
+  }
+  auto writer = PyBagWriter_Get(self);
+  if (!writer) {
+    return nullptr;
+  }
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> batch;
+  if (!PyObject_AsBagMessages(messages, batch)) {
+    return nullptr;
+  }
+  const bool written = call_without_gil(
+    [&]() {
+      for (auto & message : batch) {
+        writer->write(std::move(message));
+      }
+    });
+  if (!written) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagWriter_Close(PyBagWriter * self, PyObject *)
+{
+  // Finishes the bag, e.g. compresses its last file and writes its metadata.
+  auto writer = std::move(self->writer);
+  if (!call_without_gil([&]() {writer.reset();})) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * PyBagWriter_Exit(PyBagWriter * self, PyObject *)
+{
+  return PyBagWriter_Close(self, nullptr);
+}
+
+#if __GNUC__ >= 8
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wcast-function-type"
+#endif
+static PyMethodDef PyBagWriter_Methods[] = {
+  {
+    "create_topic", reinterpret_cast<PyCFunction>(PyBagWriter_CreateTopic),
+    METH_VARARGS | METH_KEYWORDS,
+    "Create a topic, by default in the serialization format of the writer"
+  },
+  {
+    "write", reinterpret_cast<PyCFunction>(PyBagWriter_Write), METH_VARARGS | METH_KEYWORDS,
+    "Write a BagMessage"
+  },
+  {
+    "write_batch", reinterpret_cast<PyCFunction>(PyBagWriter_WriteBatch),
+    METH_VARARGS | METH_KEYWORDS, "Write an iterable of BagMessage objects"
+  },
+  {
+    "close", reinterpret_cast<PyCFunction>(PyBagWriter_Close), METH_NOARGS,
+    "Finish the bag and close it"
+  },
+  {
+    "__enter__", reinterpret_cast<PyCFunction>(return_self), METH_NOARGS, nullptr
+  },
+  {
+    "__exit__", reinterpret_cast<PyCFunction>(PyBagWriter_Exit), METH_VARARGS, nullptr
+  },
+  {nullptr, nullptr, 0, nullptr}  /* sentinel */
+};
+#if __GNUC__ >= 8
+# pragma GCC diagnostic pop
+#endif
+
+/// Define the public methods of this module
+#if __GNUC__ >= 8
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wcast-function-type"
+#endif
+static PyMethodDef rosbag2_transport_methods[] = {
+  {
+    "record", reinterpret_cast<PyCFunction>(rosbag2_transport_record), METH_VARARGS | METH_KEYWORDS,
+    "Record to bag"
+  },
+  {
+    "play", reinterpret_cast<PyCFunction>(rosbag2_transport_play), METH_VARARGS | METH_KEYWORDS,
+    "Play bag"
+  },
+  {
+    "info", reinterpret_cast<PyCFunction>(rosbag2_transport_info), METH_VARARGS | METH_KEYWORDS,
+    "Print bag info"
+  },
+  {
+    "reindex", reinterpret_cast<PyCFunction>(rosbag2_transport_reindex),
+    METH_VARARGS | METH_KEYWORDS, "Rebuild the metadata of a bag from its bagfiles"
+  },
+  {
+    "configure_threads", reinterpret_cast<PyCFunction>(rosbag2_transport_configure_threads),
+    METH_VARARGS | METH_KEYWORDS,
+    "Set the size of the thread pool of rosbag2, and the CPUs and nice value of all its "
+    "background threads, before recording, playing or converting bags"
+  },
+  {
+    "set_memory_budget", reinterpret_cast<PyCFunction>(rosbag2_transport_set_memory_budget),
+    METH_VARARGS | METH_KEYWORDS,
+    "Set the bytes of message data the writer cache, the compression chunk, the snapshot buffer "
+    "and the player queue hold in memory at most, together. 0 removes the limit"
+  },
+  {
+    "configure_memory_arena",
+    reinterpret_cast<PyCFunction>(rosbag2_transport_configure_memory_arena),
+    METH_VARARGS | METH_KEYWORDS,
+    "Set the size, the kind of huge pages and the NUMA node of the memory the buffers of "
+    "messages are allocated from, mapped and touched when a bag is opened. 0 disables it"
+  },
+  {
+    "get_memory_usage", rosbag2_transport_get_memory_usage, METH_NOARGS,
+    "Get the bytes held in memory by every buffering stage, and their peaks, as a dict"
+  },
+  {
+    "verify", reinterpret_cast<PyCFunction>(rosbag2_transport_verify),
+    METH_VARARGS | METH_KEYWORDS, "Read every message of a bag to find corrupt bagfiles"
+  },
+  {
+    "export_text", reinterpret_cast<PyCFunction>(rosbag2_transport_export_text),
+    METH_VARARGS | METH_KEYWORDS, "Write the messages of a bag as NDJSON or CSV files per topic"
+  },
+  {
+    "slice", reinterpret_cast<PyCFunction>(rosbag2_transport_slice),
+    METH_VARARGS | METH_KEYWORDS, "Copy the messages of a time range of a bag to a new bag"
+  },
+  {
+    "export_dataset", reinterpret_cast<PyCFunction>(rosbag2_transport_export_dataset),
+    METH_VARARGS | METH_KEYWORDS,
+    "Write synchronized samples of topics as WebDataset or TFRecord shards for training"
+  },
+  {
+    "finalize", reinterpret_cast<PyCFunction>(rosbag2_transport_finalize),
+    METH_VARARGS | METH_KEYWORDS, "Merge the bags recorded by several hosts into a single bag"
+  },
+  {
+    "generate", reinterpret_cast<PyCFunction>(rosbag2_transport_generate),
+    METH_VARARGS | METH_KEYWORDS, "Write a bag of synthetic messages"
+  },
+  {
+    "convert", reinterpret_cast<PyCFunction>(rosbag2_transport_convert),
+    METH_VARARGS | METH_KEYWORDS, "Write the messages of one or more bags to a new bag"
+  },
+  {nullptr, nullptr, 0, nullptr}  /* sentinel */
+};
+#if __GNUC__ >= 8
+# pragma GCC diagnostic pop
+#endif
+
+PyDoc_STRVAR(
+  rosbag2_transport__doc__,
+  "Python module for rosbag2 transport, reading and writing bags with Reader and Writer");
+
+/// Define the Python module
+static struct PyModuleDef _rosbag2_transport_module = {
+  PyModuleDef_HEAD_INIT,
+  "_rosbag2_transport",
+  rosbag2_transport__doc__,
+  -1,   /* -1 means that the module keeps state in global variables */
+  rosbag2_transport_methods,
+  nullptr,
+  nullptr,
+  nullptr,
+  nullptr
+};
+
+/// Init function of this module
+PyMODINIT_FUNC PyInit__rosbag2_transport_py(void)
+{
+  PyBagMessageType.tp_name = "rosbag2_transport_py.BagMessage";
+  PyBagMessageType.tp_doc = "BagMessage(topic_name, time_stamp, data) of serialized data "
+    "exposed through the buffer protocol";
+  PyBagMessageType.tp_basicsize = sizeof(PyBagMessage);
+  PyBagMessageType.tp_flags = Py_TPFLAGS_DEFAULT;
+  PyBagMessageType.tp_new = PyBagMessage_New;
+  PyBagMessageType.tp_init = reinterpret_cast<initproc>(PyBagMessage_Init);
+  PyBagMessageType.tp_dealloc = reinterpret_cast<destructor>(PyBagMessage_Dealloc);
+  PyBagMessageType.tp_getset = PyBagMessage_GetSet;
+  PyBagMessageType.tp_as_buffer = &PyBagMessage_BufferProcs;
+
+  PyBagReaderType.tp_name = "rosbag2_transport_py.Reader";
+  PyBagReaderType.tp_doc = "Reader(uri, storage_id='', serialization_format='') of a bag";
+  PyBagReaderType.tp_basicsize = sizeof(PyBagReader);
+  PyBagReaderType.tp_flags = Py_TPFLAGS_DEFAULT;
+  PyBagReaderType.tp_new = PyBagReader_New;
+  PyBagReaderType.tp_init = reinterpret_cast<initproc>(PyBagReader_Init);
+  PyBagReaderType.tp_dealloc = reinterpret_cast<destructor>(PyBagReader_Dealloc);
+  PyBagReaderType.tp_iter = PyObject_SelfIter;
+  PyBagReaderType.tp_iternext = reinterpret_cast<iternextfunc>(PyBagReader_IterNext);
+  PyBagReaderType.tp_methods = PyBagReader_Methods;
+
+  PyBagWriterType.tp_name = "rosbag2_transport_py.Writer";
+  PyBagWriterType.tp_doc = "Writer(uri, storage_id='sqlite3', serialization_format='cdr', "
+    "max_bagfile_size=0, max_bagfile_duration=0, compression_mode='none', "
+    "compression_format='') of a bag";
+  PyBagWriterType.tp_basicsize = sizeof(PyBagWriter);
+  PyBagWriterType.tp_flags = Py_TPFLAGS_DEFAULT;
+  PyBagWriterType.tp_new = PyBagWriter_New;
+  PyBagWriterType.tp_init = reinterpret_cast<initproc>(PyBagWriter_Init);
+  PyBagWriterType.tp_dealloc = reinterpret_cast<destructor>(PyBagWriter_Dealloc);
+  PyBagWriterType.tp_methods = PyBagWriter_Methods;
+
+  if (PyType_Ready(&PyBagMessageType) < 0 || PyType_Ready(&PyBagReaderType) < 0 ||
+    PyType_Ready(&PyBagWriterType) < 0)
+  {
+    return nullptr;
+  }
+  PyObject * module = PyModule_Create(&_rosbag2_transport_module);
+  if (!module) {
+    return nullptr;
+  }
+  const std::pair<const char *, PyTypeObject *> types[] = {
+    {"BagMessage", &PyBagMessageType}, {"Reader", &PyBagReaderType},
+    {"Writer", &PyBagWriterType}};
+  for (const auto & type : types) {
+    Py_INCREF(type.second);
+    if (PyModule_AddObject(module, type.first, reinterpret_cast<PyObject *>(type.second)) < 0) {
+      Py_DECREF(type.second);
+      Py_DECREF(module);
+      return nullptr;
+    }
+  }
+  return module;
 }
@@ -28,6 +28,7 @@ class MockInfo : public rosbag2_cpp::Info
 public:
   MOCK_METHOD2(
     read_metadata, rosbag2_storage::BagMetadata(const std::string &, const std::string &));
+  MOCK_METHOD2(read_topic_sizes, void(const std::string &, rosbag2_storage::BagMetadata &));
 };
 
 #endif  // ROSBAG2_TRANSPORT__MOCK_INFO_HPP_
@@ -15,6 +15,7 @@
 #ifndef ROSBAG2_TRANSPORT__MOCK_SEQUENTIAL_READER_HPP_
 #define ROSBAG2_TRANSPORT__MOCK_SEQUENTIAL_READER_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
@@ -78,12 +79,49 @@ public:
     filter_ = rosbag2_storage::StorageFilter();
   }
 
+  void seek(const rcutils_time_point_value_t & timestamp) override
+  {
+    num_seeks_++;
+    num_read_ = 0;
+    while (num_read_ < messages_.size() && messages_[num_read_]->time_stamp < timestamp) {
+      num_read_++;
+    }
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> read_latest_messages(
+    const std::vector<std::string> & topic_names,
+    const rcutils_time_point_value_t & timestamp) override
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> latest_messages;
+    for (const auto & topic_name : topic_names) {
+      std::shared_ptr<rosbag2_storage::SerializedBagMessage> latest_message;
+      for (const auto & message : messages_) {
+        if (message->topic_name == topic_name && message->time_stamp < timestamp) {
+          latest_message = message;
+        }
+      }
+      if (latest_message) {
+        latest_messages.push_back(latest_message);
+      }
+    }
+    return latest_messages;
+  }
+
+  size_t get_num_seeks() const
+  {
+    return num_seeks_;
+  }
+
   void prepare(
     std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages,
     std::vector<rosbag2_storage::TopicMetadata> topics)
   {
     messages_ = std::move(messages);
     topics_ = std::move(topics);
+    if (!messages_.empty()) {
+      metadata_.starting_time = std::chrono::time_point<std::chrono::high_resolution_clock>(
+        std::chrono::nanoseconds(messages_.front()->time_stamp));
+    }
   }
 
 private:
@@ -91,6 +129,7 @@ private:
   rosbag2_storage::BagMetadata metadata_;
   std::vector<rosbag2_storage::TopicMetadata> topics_;
   size_t num_read_;
+  size_t num_seeks_ = 0;
   rosbag2_storage::StorageFilter filter_;
 };
 
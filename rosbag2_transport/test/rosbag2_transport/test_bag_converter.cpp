@@ -0,0 +1,229 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rosbag2_cpp/reader.hpp"
+#include "rosbag2_cpp/writer.hpp"
+#include "rosbag2_cpp/writer_interfaces/base_writer_interface.hpp"
+
+#include "rosbag2_storage/ros_helper.hpp"
+
+#include "rosbag2_transport/bag_converter.hpp"
+
+#include "mock_info.hpp"
+#include "mock_sequential_reader.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+struct WrittenBag
+{
+  std::vector<rosbag2_storage::TopicMetadata> topics;
+  std::vector<std::string> message_topics;
+  bool closed = false;
+};
+
+class RecordingWriter : public rosbag2_cpp::writer_interfaces::BaseWriterInterface
+{
+public:
+  RecordingWriter(WrittenBag & bag, size_t failing_message)
+  : bag_(bag), failing_message_(failing_message) {}
+
+  void open(const rosbag2_cpp::StorageOptions &, const rosbag2_cpp::ConverterOptions &) override
+  {}
+
+  void reset() override
+  {
+    bag_.closed = true;
+  }
+
+  void create_topic(const rosbag2_storage::TopicMetadata & topic) override
+  {
+    bag_.topics.push_back(topic);
+  }
+
+  void remove_topic(const rosbag2_storage::TopicMetadata &) override {}
+
+  void write(std::shared_ptr<rosbag2_storage::SerializedBagMessage> message) override
+  {
+    if (bag_.message_topics.size() == failing_message_) {
+      throw std::runtime_error("disk full");
+    }
+    bag_.message_topics.push_back(message->topic_name);
+  }
+
+private:
+  WrittenBag & bag_;
+  size_t failing_message_;
+};
+}  // namespace
+
+class BagConverterTest : public Test
+{
+public:
+  BagConverterTest()
+  : info_(std::make_shared<NiceMock<MockInfo>>())
+  {
+    metadata_.storage_identifier = "sqlite3";
+    for (const auto & topic : {"/a", "/b", "/c"}) {
+      topics_.push_back({topic, "test_msgs/msg/BasicTypes", "cdr", ""});
+      metadata_.topics_with_message_count.push_back({topics_.back(), 0});
+    }
+    ON_CALL(*info_, read_metadata(_, _)).WillByDefault(Return(metadata_));
+    bags_.push_back({make_messages(3000, 0, 1), topics_});
+  }
+
+  rosbag2_transport::BagConverter make_converter(size_t failing_message = SIZE_MAX)
+  {
+    return rosbag2_transport::BagConverter(
+      [this](const rosbag2_storage::BagMetadata &) {
+        // Every reader opened reads the next bag.
+        const auto & bag = bags_[opened_readers_++ % bags_.size()];
+        auto reader = std::make_unique<MockSequentialReader>();
+        reader->prepare(bag.first, bag.second);
+        return std::make_unique<rosbag2_cpp::Reader>(std::move(reader));
+      },
+      [this, failing_message](const rosbag2_transport::ConvertOptions &) {
+        return std::make_unique<rosbag2_cpp::Writer>(
+          std::make_unique<RecordingWriter>(written_bag_, failing_message));
+      },
+      info_);
+  }
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> make_messages(
+    int count, int first_time_stamp, int time_stamp_step) const
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+    for (int i = 0; i < count; ++i) {
+      auto message = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+      message->topic_name = topics_[i % 3].name;
+      message->time_stamp = first_time_stamp + i * time_stamp_step;
+      message->serialized_data = rosbag2_storage::make_serialized_message(&i, sizeof(i));
+      messages.push_back(message);
+    }
+    return messages;
+  }
+
+  std::shared_ptr<NiceMock<MockInfo>> info_;
+  rosbag2_storage::BagMetadata metadata_;
+  std::vector<rosbag2_storage::TopicMetadata> topics_;
+  std::vector<std::pair<
+      std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>,
+      std::vector<rosbag2_storage::TopicMetadata>>> bags_;
+  size_t opened_readers_ = 0;
+  WrittenBag written_bag_;
+  rosbag2_transport::StorageOptions input_options_{};
+  rosbag2_transport::StorageOptions output_options_{};
+  rosbag2_transport::ConvertOptions convert_options_{};
+};
+
+TEST_F(BagConverterTest, writes_all_messages_in_the_order_they_are_read) {
+  auto converter = make_converter();
+
+  const auto summary = converter.convert(input_options_, output_options_, convert_options_);
+
+  EXPECT_THAT(summary.message_count, Eq(3000u));
+  EXPECT_THAT(summary.bytes, Eq(3000u * sizeof(int)));
+  EXPECT_TRUE(written_bag_.closed);
+  ASSERT_THAT(written_bag_.topics, SizeIs(3));
+  EXPECT_THAT(written_bag_.topics[0].serialization_format, StrEq("cdr"));
+  ASSERT_THAT(written_bag_.message_topics, SizeIs(3000));
+  for (size_t i = 0; i < written_bag_.message_topics.size(); ++i) {
+    EXPECT_THAT(written_bag_.message_topics[i], StrEq(topics_[i % 3].name));
+  }
+}
+
+TEST_F(BagConverterTest, leaves_out_the_excluded_topics) {
+  convert_options_.exclude = "^/[ab]$";
+  auto converter = make_converter();
+
+  EXPECT_THAT(
+    converter.convert(input_options_, output_options_, convert_options_).message_count,
+    Eq(1000u));
+
+  ASSERT_THAT(written_bag_.topics, SizeIs(1));
+  EXPECT_THAT(written_bag_.topics[0].name, StrEq("/c"));
+  EXPECT_THAT(written_bag_.message_topics, Each(StrEq("/c")));
+}
+
+TEST_F(BagConverterTest, merges_bags_by_time_stamp) {
+  // Time stamps 0, 2, 4, ... and 1, 3, 5, ... of bags reading in batches of different sizes
+  bags_ = {{make_messages(3000, 0, 2), topics_}, {make_messages(1500, 1, 2), topics_}};
+  bags_[1].second.push_back({"/d", "test_msgs/msg/Strings", "cdr", ""});
+  for (auto & message : bags_[1].first) {
+    message->topic_name = "/d";
+  }
+  auto converter = make_converter();
+
+  const auto summary = converter.convert(
+    std::vector<rosbag2_transport::StorageOptions>{input_options_, input_options_},
+    output_options_, convert_options_);
+
+  EXPECT_THAT(summary.message_count, Eq(4500u));
+  EXPECT_THAT(written_bag_.topics, SizeIs(4));
+  ASSERT_THAT(written_bag_.message_topics, SizeIs(4500));
+  for (size_t i = 0; i < 3000; ++i) {
+    const auto & expected_topic = i % 2 == 0 ? topics_[(i / 2) % 3].name : std::string("/d");
+    EXPECT_THAT(written_bag_.message_topics[i], StrEq(expected_topic));
+  }
+}
+
+TEST_F(BagConverterTest, rejects_merging_topics_of_different_types) {
+  bags_.push_back(bags_[0]);
+  bags_[1].second[0].type = "test_msgs/msg/Strings";
+  auto converter = make_converter();
+
+  EXPECT_THROW(
+    converter.convert(
+      std::vector<rosbag2_transport::StorageOptions>{input_options_, input_options_},
+      output_options_, convert_options_),
+    std::invalid_argument);
+}
+
+TEST_F(BagConverterTest, stops_reading_and_throws_if_writing_fails) {
+  auto converter = make_converter(1500);
+
+  EXPECT_THROW(
+    converter.convert(input_options_, output_options_, convert_options_), std::runtime_error);
+  EXPECT_THAT(written_bag_.message_topics, SizeIs(1500));
+}
+
+TEST_F(BagConverterTest, rejects_invalid_options) {
+  auto converter = make_converter();
+
+  convert_options_.exclude = "[";
+  EXPECT_THROW(
+    converter.convert(input_options_, output_options_, convert_options_), std::invalid_argument);
+
+  convert_options_.exclude = "";
+  convert_options_.keep_splits = true;
+  output_options_.max_bagfile_size = 1024;
+  EXPECT_THROW(
+    converter.convert(input_options_, output_options_, convert_options_), std::invalid_argument);
+
+  output_options_.max_bagfile_size = 0;
+  metadata_.compression_format = "zstd";
+  EXPECT_CALL(*info_, read_metadata(_, _)).WillOnce(Return(metadata_));
+  EXPECT_THROW(
+    converter.convert(input_options_, output_options_, convert_options_), std::invalid_argument);
+}
@@ -86,6 +86,17 @@ TEST_F(FormatterTestFixture, format_topics_with_type_correctly_layouts_more_topi
   EXPECT_EQ(expected, formatted_output.str());
 }
 
+TEST_F(FormatterTestFixture, format_topics_with_type_prints_dropped_messages_of_topics) {
+  std::vector<rosbag2_storage::TopicInformation> topics;
+  topics.push_back({{"topic1", "type1", "rmw1", ""}, 100, 0, 0, 0, 7});
+  std::stringstream formatted_output;
+
+  formatter_->format_topics_with_type(topics, formatted_output, indentation_spaces_);
+  EXPECT_EQ(
+    "Topic: topic1 | Type: type1 | Count: 100 | Dropped: 7 | Serialization Format: rmw1\n",
+    formatted_output.str());
+}
+
 TEST_F(FormatterTestFixture, format_topics_with_type_prints_newline_if_there_are_no_topics) {
   std::vector<rosbag2_storage::TopicInformation> topics = {};
   std::stringstream formatted_output;
@@ -93,3 +104,30 @@ TEST_F(FormatterTestFixture, format_topics_with_type_prints_newline_if_there_are
   formatter_->format_topics_with_type(topics, formatted_output, 0);
   EXPECT_THAT(formatted_output.str(), Eq("\n"));
 }
+
+TEST_F(FormatterTestFixture, format_topic_sizes_prints_compression_ratio_of_compressed_topics) {
+  std::vector<rosbag2_storage::TopicInformation> topics;
+  topics.push_back({{"topic1", "type1", "rmw1", ""}, 10, 1000, 200, 250});
+  topics.push_back({{"topic2", "type2", "rmw2", ""}, 0});
+  std::stringstream formatted_output;
+
+  formatter_->format_topic_sizes(topics, 10s, formatted_output, indentation_spaces_);
+  auto expected =
+    std::string(
+    "Topic: topic1 | Size: 1000 B | Average: 100 B | Max: 200 B | Rate: 1.00 Hz | "
+    "Bandwidth: 100 B/s | Compression ratio: 4.00\n") +
+    std::string(indentation_spaces_, ' ') +
+    std::string("Topic: topic2 | Size: 0 B | Average: 0 B | Max: 0 B | Rate: 0.00 Hz | ") +
+    std::string("Bandwidth: 0 B/s\n");
+  EXPECT_EQ(expected, formatted_output.str());
+}
+
+TEST_F(FormatterTestFixture, compression_ratio_is_zero_if_topic_sizes_are_unknown) {
+  rosbag2_storage::BagMetadata metadata{};
+  metadata.bag_size = 500;
+  metadata.topics_with_message_count.push_back({{"topic1", "type1", "rmw1", ""}, 10, 1000});
+  EXPECT_THAT(formatter_->compute_compression_ratio(metadata), DoubleEq(2.0));
+
+  metadata.topics_with_message_count.push_back({{"topic2", "type2", "rmw2", ""}, 10});
+  EXPECT_THAT(formatter_->compute_compression_ratio(metadata), DoubleEq(0.0));
+}
@@ -63,3 +63,32 @@ TEST_F(Rosbag2TransportTestFixture, info_pretty_prints_information_from_bagfile)
     output, HasSubstr(
       "Topic: topic2 | Type: type2 | Count: 200 | Serialization Format: rmw2\n\n"));
 }
+
+TEST_F(Rosbag2TransportTestFixture, verbose_info_prints_sizes_read_for_topics_without_sizes)
+{
+  internal::CaptureStdout();
+
+  rosbag2_storage::BagMetadata bagfile;
+  bagfile.storage_identifier = "sqlite3";
+  bagfile.duration = std::chrono::seconds(2);
+  bagfile.message_count = 300;
+  bagfile.topics_with_message_count.push_back({{"topic1", "type1", "rmw1", ""}, 100});
+  bagfile.topics_with_message_count.push_back({{"topic2", "type2", "rmw2", ""}, 200});
+  EXPECT_CALL(*info_, read_metadata(_, _)).WillOnce(Return(bagfile));
+  EXPECT_CALL(*info_, read_topic_sizes("test", _)).WillOnce(
+    Invoke(
+      [](const std::string &, rosbag2_storage::BagMetadata & metadata) {
+        metadata.topics_with_message_count[0].total_size = 4096;
+        metadata.topics_with_message_count[0].max_message_size = 100;
+      }));
+
+  rosbag2_transport::Rosbag2Transport transport(reader_, writer_, info_);
+  transport.print_bag_info("test", "sqlite3", true);
+
+  std::string output = internal::GetCapturedStdout();
+  EXPECT_THAT(
+    output, HasSubstr(
+      "Topic sizes:       Topic: topic1 | Size: 4.0 KiB | Average: 40 B | Max: 100 B | "
+      "Rate: 50.00 Hz | Bandwidth: 2.0 KiB/s\n"
+      "                   Topic: topic2 | Size: unknown\n"));
+}
@@ -0,0 +1,69 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <vector>
+
+#include "message_throttle.hpp"
+
+using namespace ::testing;  // NOLINT
+
+namespace
+{
+std::vector<int> recorded_messages(
+  rosbag2_transport::MessageThrottle & throttle, int count, rcutils_time_point_value_t period)
+{
+  std::vector<int> recorded;
+  for (int i = 0; i < count; ++i) {
+    if (throttle.should_record(i * period)) {
+      recorded.push_back(i);
+    }
+  }
+  return recorded;
+}
+}  // namespace
+
+TEST(TestMessageThrottle, records_every_message_by_default)
+{
+  rosbag2_transport::MessageThrottle throttle{rosbag2_transport::TopicThrottle{}};
+  EXPECT_THAT(recorded_messages(throttle, 4, 1), ElementsAre(0, 1, 2, 3));
+}
+
+TEST(TestMessageThrottle, records_every_nth_message_with_decimation)
+{
+  rosbag2_transport::TopicThrottle limits;
+  limits.decimation = 5;
+  rosbag2_transport::MessageThrottle throttle{limits};
+  EXPECT_THAT(recorded_messages(throttle, 12, 1), ElementsAre(0, 5, 10));
+}
+
+TEST(TestMessageThrottle, drops_messages_received_faster_than_max_frequency)
+{
+  rosbag2_transport::TopicThrottle limits;
+  limits.max_frequency = 2.0;
+  rosbag2_transport::MessageThrottle throttle{limits};
+  // Received at 10 Hz, so every fifth message is 0.5 s after the last recorded one.
+  EXPECT_THAT(recorded_messages(throttle, 12, 100000000), ElementsAre(0, 5, 10));
+}
+
+TEST(TestMessageThrottle, applies_max_frequency_to_the_decimated_messages)
+{
+  rosbag2_transport::TopicThrottle limits;
+  limits.decimation = 2;
+  limits.max_frequency = 4.0;
+  rosbag2_transport::MessageThrottle throttle{limits};
+  // Every second message arrives 0.2 s apart, so only every fourth one is 0.25 s apart.
+  EXPECT_THAT(recorded_messages(throttle, 10, 100000000), ElementsAre(0, 4, 8));
+}
@@ -14,10 +14,14 @@
 
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <utility>
@@ -28,6 +32,10 @@
 
 #include "rosbag2_transport/rosbag2_transport.hpp"
 
+#include "rosgraph_msgs/msg/clock.hpp"
+
+#include "std_srvs/srv/trigger.hpp"
+
 #include "test_msgs/msg/arrays.hpp"
 #include "test_msgs/msg/basic_types.hpp"
 #include "test_msgs/message_fixtures.hpp"
@@ -106,6 +114,316 @@ TEST_F(RosBag2PlayTestFixture, recorded_messages_are_played_for_all_topics)
           ElementsAre(40.0f, 2.0f, 0.0f)))));
 }
 
+TEST_F(RosBag2PlayTestFixture, latched_topics_are_published_when_starting_at_an_offset)
+{
+  auto map_message = get_messages_basic_types()[0];
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"map", "test_msgs/BasicTypes", "", ""},
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+  };
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  map_message->int32_value = 1;
+  messages.push_back(serialize_test_message("map", 0, map_message));
+  map_message->int32_value = 2;
+  messages.push_back(serialize_test_message("map", 100000000, map_message));
+  messages.push_back(serialize_test_message("topic1", 300000000, map_message));
+  messages.push_back(serialize_test_message("topic1", 400000000, map_message));
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/map", 1);
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 2);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  // The map was published before the offset, so only its latest message is published.
+  play_options_.start_offset = 0.2;
+  play_options_.latched_topics = {"map"};
+  play_options_.wait_for_subscribers = 1;
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  await_received_messages.get();
+  auto replayed_maps = sub_->get_received_messages<test_msgs::msg::BasicTypes>("/map");
+  ASSERT_THAT(replayed_maps, SizeIs(1u));
+  EXPECT_THAT(replayed_maps[0]->int32_value, Eq(2));
+}
+
+TEST_F(RosBag2PlayTestFixture, progress_is_reported_while_playing)
+{
+  auto primitive_message = get_messages_basic_types()[0];
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+  };
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  for (int64_t i = 0; i < 5; ++i) {
+    messages.push_back(serialize_test_message("topic1", i * 100, primitive_message));
+  }
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  std::mutex progress_mutex;
+  std::vector<PlayProgress> reports;
+  play_options_.progress_interval = 20ms;
+  play_options_.progress_callback = [&](const PlayProgress & progress) {
+      std::lock_guard<std::mutex> lock(progress_mutex);
+      reports.push_back(progress);
+    };
+
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  std::lock_guard<std::mutex> lock(progress_mutex);
+  ASSERT_THAT(reports, SizeIs(Ge(2u)));
+  for (size_t i = 1; i < reports.size(); ++i) {
+    EXPECT_THAT(reports[i].played_messages, Ge(reports[i - 1].played_messages));
+    EXPECT_THAT(reports[i].time_stamp, Ge(reports[i - 1].time_stamp));
+    EXPECT_THAT(reports[i].elapsed, Gt(reports[i - 1].elapsed));
+  }
+  EXPECT_THAT(reports.back().played_messages, Le(5u));
+}
+
+TEST_F(RosBag2PlayTestFixture, messages_are_played_with_read_ahead_byte_budget)
+{
+  auto primitive_message = get_messages_basic_types()[0];
+  primitive_message->int32_value = 42;
+
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+  };
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 500, primitive_message),
+    serialize_test_message("topic1", 600, primitive_message),
+    serialize_test_message("topic1", 700, primitive_message),
+    serialize_test_message("topic1", 800, primitive_message)};
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  // The first messages may be missed while the subscription is matched.
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 2);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  // Smaller than a single message, so the queue never holds more than one.
+  play_options_.read_ahead_queue_bytes = 1;
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  await_received_messages.get();
+
+  auto replayed_test_primitives = sub_->get_received_messages<test_msgs::msg::BasicTypes>(
+    "/topic1");
+  EXPECT_THAT(replayed_test_primitives, SizeIs(Ge(2u)));
+  EXPECT_THAT(
+    replayed_test_primitives,
+    Each(Pointee(Field(&test_msgs::msg::BasicTypes::int32_value, 42))));
+}
+
+TEST_F(RosBag2PlayTestFixture, messages_are_played_in_order_by_publishing_threads)
+{
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+    {"topic2", "test_msgs/BasicTypes", "", ""},
+  };
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  for (int32_t i = 0; i < 3; ++i) {
+    auto primitive_message = get_messages_basic_types()[0];
+    primitive_message->int32_value = i;
+    messages.push_back(serialize_test_message("topic1", 500 + 100 * i, primitive_message));
+    messages.push_back(serialize_test_message("topic2", 550 + 100 * i, primitive_message));
+  }
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 2);
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic2", 2);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  play_options_.publishing_threads = 2;
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  await_received_messages.get();
+
+  for (const auto & topic : {"/topic1", "/topic2"}) {
+    auto replayed_test_primitives = sub_->get_received_messages<test_msgs::msg::BasicTypes>(
+      topic);
+    // The first messages may be missed while the subscriptions are matched.
+    std::vector<int32_t> values;
+    for (const auto & message : replayed_test_primitives) {
+      values.push_back(message->int32_value);
+    }
+    EXPECT_THAT(values, SizeIs(Ge(2u)));
+    EXPECT_THAT(values, WhenSorted(ContainerEq(values)));
+  }
+}
+
+TEST_F(RosBag2PlayTestFixture, bag_time_is_published_on_clock)
+{
+  auto primitive_message = get_messages_basic_types()[0];
+
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+  };
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 1000, primitive_message),
+    serialize_test_message("topic1", 1500, primitive_message)};
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<rosgraph_msgs::msg::Clock>("/clock", 2);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  play_options_.clock_publish_frequency = 20.0;
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  await_received_messages.get();
+
+  auto clock_messages = sub_->get_received_messages<rosgraph_msgs::msg::Clock>("/clock");
+  EXPECT_THAT(clock_messages, SizeIs(Ge(2u)));
+  // The clock runs from the first message of the bag to the last one.
+  for (const auto & clock_message : clock_messages) {
+    const auto bag_time = rclcpp::Time(clock_message->clock).nanoseconds();
+    EXPECT_THAT(bag_time, Ge(messages[0]->time_stamp));
+    EXPECT_THAT(bag_time, Le(messages[1]->time_stamp));
+  }
+}
+
+TEST_F(RosBag2PlayTestFixture, preloaded_messages_are_played)
+{
+  auto primitive_message1 = get_messages_basic_types()[0];
+  primitive_message1->int32_value = 42;
+  auto primitive_message2 = get_messages_basic_types()[0];
+  primitive_message2->int32_value = 43;
+
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+  };
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 500, primitive_message1),
+    serialize_test_message("topic1", 700, primitive_message2)};
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 2);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  play_options_.preload = true;
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  await_received_messages.get();
+
+  // The data is copied into the preload arena, which must keep it intact.
+  auto replayed_messages = sub_->get_received_messages<test_msgs::msg::BasicTypes>("/topic1");
+  EXPECT_THAT(
+    replayed_messages,
+    ElementsAre(
+      Pointee(Field(&test_msgs::msg::BasicTypes::int32_value, 42)),
+      Pointee(Field(&test_msgs::msg::BasicTypes::int32_value, 43))));
+}
+
+TEST_F(RosBag2PlayTestFixture, lazy_publishers_are_only_created_for_topics_with_messages_played)
+{
+  auto primitive_message = get_messages_basic_types()[0];
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+    {"topic2", "test_msgs/BasicTypes", "", ""},
+  };
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+  messages.push_back(serialize_test_message("topic2", 0, primitive_message));
+  for (int64_t i = 1; i <= 5; ++i) {
+    messages.push_back(serialize_test_message("topic1", i * 100000000, primitive_message));
+  }
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 1);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  // The only message of topic2 is before the start offset.
+  auto graph_node = std::make_shared<rclcpp::Node>("lazy_publishers_graph");
+  std::atomic<size_t> topic2_publishers{0};
+  play_options_.start_offset = 0.05;
+  play_options_.lazy_publishers = true;
+  play_options_.progress_interval = 20ms;
+  play_options_.progress_callback = [&](const PlayProgress &) {
+      topic2_publishers =
+        std::max<size_t>(topic2_publishers, graph_node->count_publishers("/topic2"));
+    };
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+
+  await_received_messages.get();
+  EXPECT_THAT(
+    sub_->get_received_messages<test_msgs::msg::BasicTypes>("/topic1"), SizeIs(Ge(1u)));
+  EXPECT_THAT(topic2_publishers.load(), Eq(0u));
+}
+
+TEST_F(RosBag2PlayTestFixture, paused_playback_publishes_messages_by_play_next_service)
+{
+  auto primitive_message = get_messages_basic_types()[0];
+
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""},
+  };
+
+  // Far apart, so only stepping plays the second message within the test timeout.
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 0, primitive_message),
+    serialize_test_message("topic1", 3600000000000, primitive_message)};
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 2);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  play_options_.start_paused = true;
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  auto playing = std::async(
+    std::launch::async,
+    [&]() {rosbag2_transport.play(storage_options_, play_options_);});
+
+  auto client_node = std::make_shared<rclcpp::Node>("play_next_client");
+  auto client = client_node->create_client<std_srvs::srv::Trigger>("/_rosbag2/play_next");
+  ASSERT_TRUE(client->wait_for_service(5s));
+  // The service fails until playback has started paused.
+  size_t steps = 0;
+  while (steps < messages.size() && playing.wait_for(0s) != std::future_status::ready) {
+    auto response = client->async_send_request(std::make_shared<std_srvs::srv::Trigger::Request>());
+    ASSERT_EQ(
+      rclcpp::spin_until_future_complete(client_node, response, 5s),
+      rclcpp::FutureReturnCode::SUCCESS);
+    if (response.get()->success) {
+      ++steps;
+    } else {
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+  ASSERT_EQ(playing.wait_for(5s), std::future_status::ready);
+  await_received_messages.get();
+
+  auto replayed_messages = sub_->get_received_messages<test_msgs::msg::BasicTypes>("/topic1");
+  EXPECT_THAT(replayed_messages, SizeIs(2u));
+}
+
 TEST_F(RosBag2PlayTestFixture, recorded_messages_are_played_for_filtered_topics)
 {
   auto primitive_message1 = get_messages_basic_types()[0];
@@ -0,0 +1,111 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "rosbag2_test_common/allocation_counter.hpp"
+
+#include "rosbag2_transport/rosbag2_transport.hpp"
+
+#include "test_msgs/msg/basic_types.hpp"
+#include "test_msgs/message_fixtures.hpp"
+
+#include "qos.hpp"
+
+#include "rosbag2_play_test_fixture.hpp"
+#include "rosbag2_transport_test_fixture.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_transport;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+namespace
+{
+constexpr size_t MESSAGE_COUNT = 2000;
+// Covers the allocations of setting up playback which vary between runs, so a single allocation
+// per message more than publishing itself fails the test.
+constexpr double MAX_ADDITIONAL_ALLOCATIONS_PER_MESSAGE = 0.5;
+}  // namespace
+
+class PlayAllocationsTestFixture : public RosBag2PlayTestFixture
+{
+public:
+  PlayAllocationsTestFixture()
+  : message_(get_messages_basic_types()[0])
+  {
+    auto mock_reader = std::make_unique<MockSequentialReader>();
+    mock_reader_ = mock_reader.get();
+    reader_ = std::make_shared<rosbag2_cpp::Reader>(std::move(mock_reader));
+    // Plays every time with the same node.
+    rosbag2_transport_ = std::make_unique<Rosbag2Transport>(reader_, writer_, info_);
+  }
+
+  // Allocations of the playing thread while playing the given number of messages, which are all
+  // due right away.
+  size_t count_play_allocations(size_t message_count)
+  {
+    std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages;
+    for (size_t i = 0; i < message_count; ++i) {
+      messages.push_back(serialize_test_message("topic", 500, message_));
+    }
+    mock_reader_->prepare(messages, {{"topic", "test_msgs/BasicTypes", "", ""}});
+
+    AllocationCounter counter;
+    rosbag2_transport_->play(storage_options_, play_options_);
+    return counter.allocations();
+  }
+
+  // Allocations of publishing the serialized message the given number of times, without rosbag2.
+  size_t count_publish_allocations(size_t message_count)
+  {
+    auto node = std::make_shared<rclcpp::Node>("allocations_test_publisher");
+    auto publisher = node->create_publisher<test_msgs::msg::BasicTypes>("topic", Rosbag2QoS{});
+    auto serialized_message = serialize_test_message("topic", 500, message_)->serialized_data;
+    auto publish = [&publisher, &serialized_message]() {publisher->publish(*serialized_message);};
+    return count_steady_state_allocations(publish, message_count, message_count);
+  }
+
+  std::shared_ptr<test_msgs::msg::BasicTypes> message_;
+  MockSequentialReader * mock_reader_;
+  std::unique_ptr<Rosbag2Transport> rosbag2_transport_;
+};
+
+TEST_F(PlayAllocationsTestFixture, playing_allocates_no_more_per_message_than_publishing)
+{
+  if (!AllocationCounter::is_supported()) {
+    return;
+  }
+  // Warms up the node and the middleware.
+  count_play_allocations(MESSAGE_COUNT);
+  // The setup of playback is the same for both, so the difference is due to the messages.
+  const auto allocations_few = count_play_allocations(MESSAGE_COUNT);
+  const auto allocations_many = count_play_allocations(2 * MESSAGE_COUNT);
+  const double play_allocations_per_message =
+    (static_cast<double>(allocations_many) - static_cast<double>(allocations_few)) /
+    MESSAGE_COUNT;
+
+  const double publish_allocations_per_message =
+    static_cast<double>(count_publish_allocations(MESSAGE_COUNT)) / MESSAGE_COUNT;
+
+  EXPECT_THAT(
+    play_allocations_per_message,
+    Le(publish_allocations_per_message + MAX_ADDITIONAL_ALLOCATIONS_PER_MESSAGE));
+}
@@ -84,3 +84,47 @@ TEST_F(RosBag2PlayTestFixture, messages_played_in_loop) {
     replayed_test_primitives,
     Each(Pointee(Field(&test_msgs::msg::BasicTypes::int32_value, test_value))));
 }
+
+TEST_F(RosBag2PlayTestFixture, messages_played_in_loop_from_cache_without_rewinding_reader) {
+  const size_t num_messages = 3;
+  const size_t expected_number_of_messages = num_messages * 3;
+
+  auto primitive_message1 = get_messages_basic_types()[0];
+
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"loop_test_topic", "test_msgs/BasicTypes", "", ""}
+  };
+
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages(num_messages,
+    serialize_test_message("loop_test_topic", 700, primitive_message1));
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  auto mock_reader = prepared_mock_reader.get();
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  sub_->add_subscription<test_msgs::msg::BasicTypes>(
+    "/loop_test_topic",
+    expected_number_of_messages);
+
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  rosbag2_transport::PlayOptions play_options{1000, "", 1.0, {}, {}, true};
+  play_options.loop_cache_bytes = 1024 * 1024;
+  auto rosbag2_transport_ptr = std::make_shared<rosbag2_transport::Rosbag2Transport>(
+    reader_,
+    writer_,
+    info_);
+  std::thread loop_thread(&rosbag2_transport::Rosbag2Transport::play, rosbag2_transport_ptr,
+    storage_options_, play_options);
+
+  await_received_messages.get();
+  rclcpp::shutdown();
+  loop_thread.join();
+
+  auto replayed_test_primitives = sub_->get_received_messages<test_msgs::msg::BasicTypes>(
+    "/loop_test_topic");
+  EXPECT_THAT(replayed_test_primitives.size(), Ge(expected_number_of_messages));
+  // The bag fits into the cache, so the reader is only read once.
+  EXPECT_THAT(mock_reader->get_num_seeks(), Eq(0u));
+}
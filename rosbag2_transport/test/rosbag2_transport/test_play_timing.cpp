@@ -156,3 +156,172 @@ TEST_F(Rosbag2TransportTestFixture, playing_respects_rate)
 
   rclcpp::shutdown();
 }
+
+TEST_F(Rosbag2TransportTestFixture, playing_starts_at_start_offset)
+{
+  rclcpp::init(0, nullptr);
+  auto primitive_message = get_messages_strings()[0];
+  primitive_message->string_value = "Hello World";
+
+  auto message_time_difference = std::chrono::seconds(1);
+  auto topics_and_types =
+    std::vector<rosbag2_storage::TopicMetadata>{{"topic1", "test_msgs/Strings", "", ""}};
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 0, primitive_message),
+    serialize_test_message("topic1", 0, primitive_message),
+    serialize_test_message("topic1", 0, primitive_message)};
+
+  for (size_t i = 0; i < messages.size(); ++i) {
+    messages[i]->time_stamp =
+      100 + static_cast<int64_t>(i) * std::chrono::nanoseconds(message_time_difference).count();
+  }
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topics_and_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  // Only the last message is played, so playing does not wait for the ones before.
+  play_options_.start_offset = 1.5;
+  auto start = std::chrono::steady_clock::now();
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+  auto replay_time = std::chrono::steady_clock::now() - start;
+
+  ASSERT_THAT(replay_time, Lt(message_time_difference));
+  rclcpp::shutdown();
+}
+
+TEST_F(Rosbag2TransportTestFixture, playing_with_busy_wait_respects_relative_timing)
+{
+  rclcpp::init(0, nullptr);
+  auto primitive_message = get_messages_strings()[0];
+  primitive_message->string_value = "Hello World";
+
+  auto message_time_difference = std::chrono::milliseconds(200);
+  auto topics_and_types =
+    std::vector<rosbag2_storage::TopicMetadata>{{"topic1", "test_msgs/Strings", "", ""}};
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 0, primitive_message),
+    serialize_test_message("topic1", 0, primitive_message)};
+
+  messages[0]->time_stamp = 100;
+  messages[1]->time_stamp =
+    messages[0]->time_stamp + std::chrono::nanoseconds(message_time_difference).count();
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topics_and_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  // The busy wait period is longer than the time between the messages, so the player only
+  // busy-waits.
+  play_options_.busy_wait_period = std::chrono::seconds(1);
+  auto start = std::chrono::steady_clock::now();
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+  auto replay_time = std::chrono::steady_clock::now() - start;
+
+  ASSERT_THAT(replay_time, Gt(message_time_difference));
+  ASSERT_THAT(replay_time, Lt(std::chrono::seconds(1)));
+  rclcpp::shutdown();
+}
+
+TEST_F(Rosbag2TransportTestFixture, playing_as_fast_as_possible_ignores_timing_of_messages)
+{
+  rclcpp::init(0, nullptr);
+  auto primitive_message = get_messages_strings()[0];
+  primitive_message->string_value = "Hello World";
+
+  auto message_time_difference = std::chrono::seconds(1);
+  auto topics_and_types =
+    std::vector<rosbag2_storage::TopicMetadata>{{"topic1", "test_msgs/Strings", "", ""}};
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 0, primitive_message),
+    serialize_test_message("topic1", 0, primitive_message),
+    serialize_test_message("topic1", 0, primitive_message)};
+
+  for (size_t i = 0; i < messages.size(); ++i) {
+    messages[i]->time_stamp =
+      100 + static_cast<int64_t>(i) * std::chrono::nanoseconds(message_time_difference).count();
+  }
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topics_and_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  play_options_.as_fast_as_possible = true;
+  auto start = std::chrono::steady_clock::now();
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+  auto replay_time = std::chrono::steady_clock::now() - start;
+
+  ASSERT_THAT(replay_time, Lt(message_time_difference));
+  rclcpp::shutdown();
+}
+
+TEST_F(Rosbag2TransportTestFixture, playing_starts_at_start_time_of_reference_clock)
+{
+  rclcpp::init(0, nullptr);
+  auto primitive_message = get_messages_strings()[0];
+  primitive_message->string_value = "Hello World";
+
+  auto topics_and_types =
+    std::vector<rosbag2_storage::TopicMetadata>{{"topic1", "test_msgs/Strings", "", ""}};
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 0, primitive_message)};
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topics_and_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  // The reference clock is half a second behind, so the start time is a second from now.
+  const auto clock_offset = std::chrono::milliseconds(-500);
+  play_options_.clock_offset = std::chrono::nanoseconds(clock_offset).count();
+  play_options_.start_at = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch() + clock_offset +
+    std::chrono::seconds(1)).count();
+  auto start = std::chrono::steady_clock::now();
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+  auto replay_time = std::chrono::steady_clock::now() - start;
+
+  ASSERT_THAT(replay_time, Gt(std::chrono::milliseconds(900)));
+  rclcpp::shutdown();
+}
+
+TEST_F(Rosbag2TransportTestFixture, playing_host_folder_follows_timeline_of_bag_of_all_hosts)
+{
+  rclcpp::init(0, nullptr);
+  auto primitive_message = get_messages_strings()[0];
+  primitive_message->string_value = "Hello World";
+
+  auto topics_and_types =
+    std::vector<rosbag2_storage::TopicMetadata>{{"topic1", "test_msgs/Strings", "", ""}};
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 1000, primitive_message)};
+
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topics_and_types);
+  reader_ = std::make_unique<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  // The host recorded its first message a second after the first message of all hosts.
+  rosbag2_storage::BagMetadata bag_metadata{};
+  bag_metadata.bag_id = "run_42";
+  rosbag2_storage::BagMetadata host_metadata = bag_metadata;
+  host_metadata.starting_time += std::chrono::seconds(1);
+  EXPECT_CALL(*info_, read_metadata(storage_options_.uri, storage_options_.storage_id))
+  .WillOnce(Return(bag_metadata));
+  const auto host_uri = storage_options_.uri + separator() + "host_a";
+  EXPECT_CALL(*info_, read_metadata(host_uri, storage_options_.storage_id))
+  .WillOnce(Return(host_metadata));
+
+  play_options_.host_folder = "host_a";
+  play_options_.start_at = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  auto start = std::chrono::steady_clock::now();
+  Rosbag2Transport rosbag2_transport(reader_, writer_, info_);
+  rosbag2_transport.play(storage_options_, play_options_);
+  auto replay_time = std::chrono::steady_clock::now() - start;
+
+  ASSERT_THAT(replay_time, Gt(std::chrono::milliseconds(900)));
+  rclcpp::shutdown();
+}
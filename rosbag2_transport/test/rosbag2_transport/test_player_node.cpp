@@ -0,0 +1,76 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "test_msgs/msg/basic_types.hpp"
+#include "test_msgs/message_fixtures.hpp"
+
+#include "player_node.hpp"
+#include "rosbag2_play_test_fixture.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace rosbag2_test_common;  // NOLINT
+
+TEST_F(RosBag2PlayTestFixture, player_node_plays_in_a_loop_until_it_is_destroyed)
+{
+  auto primitive_message = get_messages_basic_types()[0];
+  primitive_message->int32_value = 42;
+  auto topic_types = std::vector<rosbag2_storage::TopicMetadata>{
+    {"topic1", "test_msgs/BasicTypes", "", ""}};
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> messages =
+  {serialize_test_message("topic1", 500, primitive_message),
+    serialize_test_message("topic1", 700, primitive_message)};
+  auto prepared_mock_reader = std::make_unique<MockSequentialReader>();
+  prepared_mock_reader->prepare(messages, topic_types);
+  reader_ = std::make_shared<rosbag2_cpp::Reader>(std::move(prepared_mock_reader));
+
+  // More messages than the bag holds arrive only by looping.
+  sub_->add_subscription<test_msgs::msg::BasicTypes>("/topic1", 4);
+  auto await_received_messages = sub_->spin_subscriptions();
+
+  auto options = rclcpp::NodeOptions().parameter_overrides(
+    {rclcpp::Parameter("uri", "bag"), rclcpp::Parameter("loop", true)});
+  auto player_node = std::make_unique<rosbag2_transport::PlayerNode>(options, reader_);
+  // Spun like by a component container
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(player_node->get_node_base_interface());
+  auto spin_future = std::async(std::launch::async, [&executor]() {executor.spin();});
+
+  await_received_messages.get();
+  executor.cancel();
+  spin_future.get();
+  executor.remove_node(player_node->get_node_base_interface());
+  player_node.reset();
+
+  auto replayed_messages = sub_->get_received_messages<test_msgs::msg::BasicTypes>("/topic1");
+  EXPECT_THAT(replayed_messages, SizeIs(Ge(4u)));
+  EXPECT_THAT(
+    replayed_messages, Each(Pointee(Field(&test_msgs::msg::BasicTypes::int32_value, 42))));
+}
+
+TEST_F(RosBag2PlayTestFixture, player_node_needs_the_uri_of_the_bag)
+{
+  EXPECT_THROW(
+    rosbag2_transport::PlayerNode(rclcpp::NodeOptions(), reader_), std::invalid_argument);
+}
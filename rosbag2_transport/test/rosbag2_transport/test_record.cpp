@@ -68,6 +68,40 @@ TEST_F(RecordIntegrationTestFixture, published_messages_from_multiple_topics_are
   EXPECT_THAT(array_messages[0]->float32_values, Eq(array_message->float32_values));
 }
 
+TEST_F(RecordIntegrationTestFixture, messages_are_recorded_with_multiple_recorder_threads)
+{
+  auto array_message = get_messages_arrays()[0];
+  std::string array_topic = "/array_topic";
+
+  auto string_message = get_messages_strings()[1];
+  std::string string_topic = "/string_topic";
+
+  RecordOptions record_options{false, false, {string_topic, array_topic}, "rmw_format", 100ms};
+  record_options.recorder_threads = 2;
+  start_recording(record_options);
+
+  pub_man_.add_publisher<test_msgs::msg::Strings>(
+    string_topic, string_message, 2);
+  pub_man_.add_publisher<test_msgs::msg::Arrays>(
+    array_topic, array_message, 2);
+  run_publishers();
+  stop_recording();
+
+  MockSequentialWriter & writer =
+    static_cast<MockSequentialWriter &>(writer_->get_implementation_handle());
+  auto recorded_messages = writer.get_messages();
+  ASSERT_THAT(writer.get_topics(), SizeIs(2));
+  ASSERT_THAT(recorded_messages, SizeIs(4));
+  auto string_messages = filter_messages<test_msgs::msg::Strings>(
+    recorded_messages, string_topic);
+  auto array_messages = filter_messages<test_msgs::msg::Arrays>(
+    recorded_messages, array_topic);
+  ASSERT_THAT(string_messages, SizeIs(2));
+  ASSERT_THAT(array_messages, SizeIs(2));
+  EXPECT_THAT(string_messages[0]->string_value, Eq(string_message->string_value));
+  EXPECT_THAT(array_messages[0]->float32_values, Eq(array_message->float32_values));
+}
+
 TEST_F(RecordIntegrationTestFixture, qos_is_stored_in_metadata)
 {
   auto string_message = get_messages_strings()[1];
@@ -0,0 +1,69 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "test_msgs/msg/strings.hpp"
+#include "test_msgs/message_fixtures.hpp"
+
+#include "record_integration_fixture.hpp"
+#include "recorder_node.hpp"
+
+TEST_F(RecordIntegrationTestFixture, recorder_node_records_the_topics_of_its_parameters)
+{
+  auto string_message = get_messages_strings()[1];
+  std::string string_topic = "/string_topic";
+  auto options = rclcpp::NodeOptions().parameter_overrides(
+  {
+    rclcpp::Parameter("uri", "bag"),
+    rclcpp::Parameter("topics", std::vector<std::string>{string_topic})
+  });
+  auto recorder_node = std::make_unique<rosbag2_transport::RecorderNode>(options, writer_);
+
+  // Spun like by a component container
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(recorder_node->get_node_base_interface());
+  auto spin_future = std::async(std::launch::async, [&executor]() {executor.spin();});
+
+  pub_man_.add_publisher<test_msgs::msg::Strings>(string_topic, string_message, 2);
+  run_publishers();
+  executor.cancel();
+  spin_future.get();
+  executor.remove_node(recorder_node->get_node_base_interface());
+  recorder_node.reset();
+  rclcpp::shutdown();
+
+  MockSequentialWriter & writer =
+    static_cast<MockSequentialWriter &>(writer_->get_implementation_handle());
+  ASSERT_THAT(writer.get_topics(), SizeIs(1));
+  auto string_messages = filter_messages<test_msgs::msg::Strings>(
+    writer.get_messages(), string_topic);
+  ASSERT_THAT(string_messages, SizeIs(Ge(2u)));
+  EXPECT_THAT(string_messages[0]->string_value, Eq(string_message->string_value));
+}
+
+TEST_F(RecordIntegrationTestFixture, recorder_node_needs_the_uri_of_the_bag)
+{
+  EXPECT_THROW(
+    rosbag2_transport::RecorderNode(rclcpp::NodeOptions(), writer_), std::invalid_argument);
+  rclcpp::shutdown();
+}
@@ -0,0 +1,108 @@
+// Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include "recorder_statistics.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace std::chrono_literals;  // NOLINT
+
+namespace
+{
+double get_value(
+  const diagnostic_msgs::msg::DiagnosticArray & report,
+  const std::string & name, const std::string & key)
+{
+  for (const auto & status : report.status) {
+    if (status.name != name) {
+      continue;
+    }
+    for (const auto & key_value : status.values) {
+      if (key_value.key == key) {
+        return std::stod(key_value.value);
+      }
+    }
+  }
+  throw std::runtime_error("No value " + key + " for " + name);
+}
+}  // namespace
+
+TEST(TestRecorderStatistics, reports_rates_of_each_topic_since_last_report)
+{
+  rosbag2_transport::RecorderStatistics statistics;
+  auto topic = statistics.add_topic("/topic");
+  topic->received_messages += 4;
+  topic->received_bytes += 400;
+  topic->throttled_messages += 1;
+
+  auto report = statistics.make_report(2s, 0);
+  EXPECT_THAT(report.status, SizeIs(2));
+  EXPECT_THAT(get_value(report, "/topic", "messages_per_second"), DoubleEq(2.0));
+  EXPECT_THAT(get_value(report, "/topic", "bytes_per_second"), DoubleEq(200.0));
+  EXPECT_THAT(get_value(report, "/topic", "throttled_messages"), DoubleEq(1.0));
+
+  topic->received_messages += 1;
+  report = statistics.make_report(1s, 0);
+  EXPECT_THAT(get_value(report, "/topic", "messages_per_second"), DoubleEq(1.0));
+  EXPECT_THAT(get_value(report, "/topic", "bytes_per_second"), DoubleEq(0.0));
+  EXPECT_THAT(get_value(report, "/topic", "received_messages"), DoubleEq(5.0));
+}
+
+TEST(TestRecorderStatistics, add_topic_returns_same_counters_for_same_topic)
+{
+  rosbag2_transport::RecorderStatistics statistics;
+  EXPECT_THAT(statistics.add_topic("/topic"), Eq(statistics.add_topic("/topic")));
+}
+
+TEST(TestRecorderStatistics, reports_queue_depth_and_write_latency_percentiles)
+{
+  rosbag2_transport::RecorderStatistics statistics;
+  for (int i = 1; i <= 100; ++i) {
+    statistics.add_write_latency(std::chrono::microseconds(i));
+  }
+
+  auto report = statistics.make_report(1s, 7);
+  EXPECT_THAT(get_value(report, "recorder", "queue_depth"), DoubleEq(7.0));
+  EXPECT_THAT(get_value(report, "recorder", "written_messages_per_second"), DoubleEq(100.0));
+  EXPECT_THAT(get_value(report, "recorder", "write_latency_p50_us"), DoubleEq(51.0));
+  EXPECT_THAT(get_value(report, "recorder", "write_latency_p99_us"), DoubleEq(100.0));
+  EXPECT_THAT(get_value(report, "recorder", "write_latency_max_us"), DoubleEq(100.0));
+
+  // Latencies are only reported for the period they were measured in.
+  report = statistics.make_report(1s, 0);
+  EXPECT_THAT(get_value(report, "recorder", "write_latency_max_us"), DoubleEq(0.0));
+  EXPECT_THAT(get_value(report, "recorder", "written_messages"), DoubleEq(100.0));
+}
+
+TEST(TestRecorderStatistics, computes_write_latency_percentiles_over_latest_messages)
+{
+  rosbag2_transport::RecorderStatistics statistics;
+  const auto max_latencies = rosbag2_transport::RecorderStatistics::kMaxWriteLatencies;
+  statistics.add_write_latency(1ms);
+  for (size_t i = 0; i < max_latencies; ++i) {
+    statistics.add_write_latency(1us);
+  }
+
+  auto report = statistics.make_report(1s, 0);
+  EXPECT_THAT(
+    get_value(report, "recorder", "written_messages_per_second"),
+    DoubleEq(static_cast<double>(max_latencies + 1)));
+  EXPECT_THAT(get_value(report, "recorder", "write_latency_p99_us"), DoubleEq(1.0));
+  EXPECT_THAT(get_value(report, "recorder", "write_latency_max_us"), DoubleEq(1000.0));
+}
@@ -16,6 +16,7 @@
 
 #include <future>
 #include <memory>
+#include <regex>
 #include <string>
 #include <vector>
 
@@ -74,7 +75,8 @@ public:
     size_t counter = 0;
     auto subscription = node_->create_generic_subscription(
       topic_name, type, rosbag2_transport::Rosbag2QoS{},
-      [this, &counter, &messages](std::shared_ptr<rmw_serialized_message_t> message) {
+      [this, &counter, &messages](
+        std::shared_ptr<rmw_serialized_message_t> message, const rclcpp::MessageInfo &) {
         auto string_message =
         memory_management_.deserialize_message<test_msgs::msg::Strings>(message);
         messages.push_back(string_message->string_value);
@@ -161,7 +163,7 @@ TEST_F(RosBag2NodeFixture, generic_subscription_uses_qos)
   auto publisher = node_->create_publisher<test_msgs::msg::Strings>(topic_name, qos);
   auto subscription = node_->create_generic_subscription(
     topic_name, topic_type, qos,
-    [](std::shared_ptr<rmw_serialized_message_t>/* message */) {});
+    [](std::shared_ptr<rmw_serialized_message_t>/* message */, const rclcpp::MessageInfo &) {});
   auto connected = [publisher, subscription]() -> bool {
       return publisher->get_subscription_count() && subscription->get_publisher_count();
     };
@@ -259,3 +261,19 @@ TEST_F(RosBag2NodeFixture, get_all_topics_with_types_returns_all_topics)
   EXPECT_THAT(topics_and_types.find(second_topic)->second, StrEq("test_msgs/msg/Strings"));
   EXPECT_THAT(topics_and_types.find(third_topic)->second, StrEq("test_msgs/msg/Strings"));
 }
+
+TEST_F(RosBag2NodeFixture, get_all_topics_with_types_filters_topics_by_regex)
+{
+  create_publisher("/camera/image");
+  create_publisher("/camera/debug/image");
+  create_publisher("/lidar/points");
+
+  sleep_to_allow_topics_discovery();
+  const std::regex include_regex{"^/camera/"};
+  const std::regex exclude_regex{"/debug/"};
+  auto topics_and_types = node_->get_all_topics_with_types(
+    false, &include_regex, &exclude_regex);
+
+  EXPECT_THAT(topics_and_types, SizeIs(1u));
+  EXPECT_THAT(topics_and_types.count("/camera/image"), Eq(1u));
+}